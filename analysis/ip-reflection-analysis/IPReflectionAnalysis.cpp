@@ -7,6 +7,7 @@
 
 #include "IPReflectionAnalysis.h"
 
+#include <atomic>
 #include <fstream>
 
 #include <sparta/AbstractDomain.h>
@@ -16,6 +17,7 @@
 #include "CallGraph.h"
 #include "ConfigFiles.h"
 #include "MethodOverrideGraph.h"
+#include "PassManager.h"
 #include "Resolver.h"
 #include "Show.h"
 #include "SpartaInterprocedural.h"
@@ -125,18 +127,49 @@ struct Summary final : public AbstractDomain<Summary> {
   reflection::ReflectionSites m_reflection_sites;
 };
 
+using CallerContext = typename Caller::Domain;
+
+// What the last analysis of a method depended on and produced.
+struct MethodAnalysisState {
+  bool analyzed{false};
+  // The caller context the method was analyzed in.
+  CallerContext input;
+  // The caller context after the analysis, i.e. with the contexts of the
+  // callees added.
+  CallerContext output;
+  // The return values of the callees as the analysis saw them.
+  std::vector<std::pair<const DexMethod*, reflection::AbstractObjectDomain>>
+      callee_returns;
+};
+
 struct AnalysisParameters {
   // For speeding up reflection analysis
   reflection::MetadataCache refl_meta_cache;
+  // Each global iteration visits all methods, but only the methods whose
+  // caller context or callee summaries changed since their last analysis are
+  // analyzed again.
+  ConcurrentMap<const DexMethod*, MethodAnalysisState> method_states;
+  std::atomic<size_t> analyzed_methods{0};
+  std::atomic<size_t> reused_analyses{0};
 };
 
-using CallerContext = typename Caller::Domain;
-
 template <typename Base>
 class ReflectionAnalyzer : public Base {
  private:
   const DexMethod* m_method;
   Summary m_summary;
+  bool m_reused{false};
+
+  bool callee_returns_changed(const MethodAnalysisState& state) const {
+    for (const auto& [callee, value] : state.callee_returns) {
+      if (this->get_summaries()
+              ->get(callee, Summary::top())
+              .get_return_value() != value) {
+        return true;
+      }
+    }
+    return false;
+  }
 
  public:
   explicit ReflectionAnalyzer(const DexMethod* method) : m_method(method) {}
@@ -146,6 +179,22 @@ class ReflectionAnalyzer : public Base {
       return;
     }
 
+    auto* params = this->get_analysis_parameters();
+    auto previous = params->method_states.get(m_method, MethodAnalysisState());
+    if (previous.analyzed &&
+        previous.input.equals(*this->get_caller_context()) &&
+        !callee_returns_changed(previous)) {
+      // Nothing the analysis depends on changed, so neither would its results.
+      *this->get_caller_context() = std::move(previous.output);
+      m_reused = true;
+      params->reused_analyses++;
+      return;
+    }
+    params->analyzed_methods++;
+
+    MethodAnalysisState state;
+    state.analyzed = true;
+    state.input = *this->get_caller_context();
     reflection::SummaryQueryFn query_fn =
         [&](const IRInstruction* insn) -> reflection::AbstractObjectDomain {
       auto callees =
@@ -157,6 +206,7 @@ class ReflectionAnalyzer : public Base {
         auto domain = this->get_summaries()
                           ->get(method, Summary::top())
                           .get_return_value();
+        state.callee_returns.emplace_back(method, domain);
         ret.join_with(domain);
       }
       return ret;
@@ -191,10 +241,13 @@ class ReflectionAnalyzer : public Base {
         }
       }
     }
+    state.output = *this->get_caller_context();
+    params->method_states.insert_or_assign(
+        std::make_pair(m_method, std::move(state)));
   }
 
   void summarize() override {
-    if (!m_method) {
+    if (!m_method || m_reused) {
       return;
     }
     this->get_summaries()->maybe_update(m_method, [&](Summary& old) {
@@ -229,12 +282,14 @@ using Analysis =
 
 void IPReflectionAnalysisPass::run_pass(DexStoresVector& stores,
                                         ConfigFiles& conf,
-                                        PassManager& /* pm */) {
+                                        PassManager& pm) {
 
   Scope scope = build_class_scope(stores);
   AnalysisParameters param;
   auto analysis = Analysis(scope, m_max_iteration, &param);
   analysis.run();
+  pm.set_metric("analyzed_methods", param.analyzed_methods);
+  pm.set_metric("reused_analyses", param.reused_analyses);
   const auto& summaries = analysis.registry.get_map();
   m_result = std::make_shared<Result>();
   for (const auto& entry : summaries) {
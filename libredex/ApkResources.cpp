@@ -1145,6 +1145,7 @@ void ApkResources::fully_qualify_layout(
     const std::unordered_map<std::string, std::string>& element_to_class_name,
     const std::string& file_path,
     size_t* changes) {
+  resources::invalidate_xml_scan_cache();
   // Check if this file has any applicable elements to fully qualify. If any
   // are found, add their fully qualified element names to the document's
   // string pool, along with the replacement element name and attribute name
@@ -1396,6 +1397,7 @@ size_t getHashFromValues(const std::vector<android::Res_value>& values) {
 size_t ApkResources::remap_xml_reference_attributes(
     const std::string& filename,
     const std::map<uint32_t, uint32_t>& kept_to_remapped_ids) {
+  resources::invalidate_xml_scan_cache();
   if (is_raw_resource(filename)) {
     return 0;
   }
@@ -1451,6 +1453,7 @@ void obfuscate_xml_attributes(
 void ApkResources::obfuscate_xml_files(
     const std::unordered_set<std::string>& allowed_types,
     const std::unordered_set<std::string>& do_not_obfuscate_elements) {
+  resources::invalidate_xml_scan_cache();
   using path_t = boost::filesystem::path;
   using dir_iterator = boost::filesystem::directory_iterator;
 
@@ -1490,7 +1493,16 @@ void ResourcesArscFile::remap_res_ids_and_serialize(
     const std::vector<std::string>& /* resource_files */,
     const std::map<uint32_t, uint32_t>& old_to_new) {
   remap_ids(old_to_new);
-  serialize();
+  if (!m_ids_to_remove.empty() || !m_added_types.empty()) {
+    serialize();
+    return;
+  }
+  // The remapping was applied in place to the mapped file and nothing else
+  // alters the chunk layout, so the file already holds the final table and
+  // rebuilding it would only reproduce the same chunks.
+  RedexMappedFile f = std::move(m_f);
+  f.file.reset(); // Close the map.
+  mark_file_closed();
 }
 
 void ResourcesArscFile::nullify_res_ids_and_serialize(
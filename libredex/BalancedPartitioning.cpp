@@ -14,8 +14,9 @@
 #include "Debug.h"
 #include "WorkQueue.h"
 
-BalancedPartitioning::BalancedPartitioning(std::vector<Document*>& documents)
-    : documents(documents) {
+BalancedPartitioning::BalancedPartitioning(std::vector<Document*>& documents,
+                                           uint32_t iterations_per_split)
+    : documents(documents), ITERATIONS_PER_SPLIT(iterations_per_split) {
 
   // Pre-computing log2 values
   LOG2_CACHE[0] = 0.0;
@@ -192,27 +193,49 @@ uint32_t BalancedPartitioning::run_iteration(
     uint32_t right_bucket,
     SignaturesType& signatures,
     std::mt19937& rng) const {
+  uint32_t num_documents =
+      uint32_t(std::distance(document_begin, document_end));
+
+  // The top levels of the recursion have few, but large, splits, which would
+  // leave most threads idle. So large splits compute the signature caches and
+  // the move gains in parallel; both only read shared state, and every chunk
+  // writes separate elements, so the result does not depend on scheduling.
+  auto for_each_chunk = [&](uint32_t size, const auto& fn) {
+    if (num_documents < PARALLEL_SPLIT_SIZE) {
+      fn(0, size);
+      return;
+    }
+    uint32_t num_chunks =
+        (size + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+    workqueue_run_for<uint32_t>(0, num_chunks, [&](uint32_t chunk) {
+      uint32_t begin = chunk * PARALLEL_CHUNK_SIZE;
+      fn(begin, std::min(size, begin + PARALLEL_CHUNK_SIZE));
+    });
+  };
+
   // Initialize signature caches, if needed
-  for (KmerSignature& signature : signatures) {
-    if (signature.cache_is_invalid &&
-        (signature.left_count > 0 || signature.right_count > 0)) {
-      prepare_signature(signature);
-      signature.cache_is_invalid = false;
+  for_each_chunk(signatures.size(), [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+      KmerSignature& signature = signatures[i];
+      if (signature.cache_is_invalid &&
+          (signature.left_count > 0 || signature.right_count > 0)) {
+        prepare_signature(signature);
+        signature.cache_is_invalid = false;
+      }
     }
-  }
+  });
 
   // Compute move gains
-  uint32_t num_documents =
-      uint32_t(std::distance(document_begin, document_end));
   using GainPair = std::pair<double, uint32_t>;
   std::vector<GainPair> gains(num_documents);
-  for (auto it = document_begin; it != document_end; it++) {
-    Document* doc = *it;
-    uint32_t index = it - document_begin;
-    bool from_left_to_right = (doc->bucket == left_bucket);
-    double gain = move_gain(doc, from_left_to_right, signatures);
-    gains[index] = std::make_pair(gain, index);
-  }
+  for_each_chunk(num_documents, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t index = begin; index < end; index++) {
+      Document* doc = document_begin[index];
+      bool from_left_to_right = (doc->bucket == left_bucket);
+      double gain = move_gain(doc, from_left_to_right, signatures);
+      gains[index] = std::make_pair(gain, index);
+    }
+  });
 
   // Collect left and right gains
   auto left_gains = gains.begin();
@@ -44,7 +44,8 @@ class BalancedPartitioning {
   BalancedPartitioning& operator=(const BalancedPartitioning&) = delete;
 
  public:
-  explicit BalancedPartitioning(std::vector<Document*>& documents);
+  explicit BalancedPartitioning(std::vector<Document*>& documents,
+                                uint32_t iterations_per_split = 40);
 
   /// Run recursive graph partitioning that optimizes a given objective.
   void run() const;
@@ -137,7 +138,11 @@ class BalancedPartitioning {
   /// The depth of the recursive bisection.
   uint32_t SPLIT_DEPTH = 18;
   /// The maximum number of bp iterations per split.
-  uint32_t ITERATIONS_PER_SPLIT = 40;
+  uint32_t ITERATIONS_PER_SPLIT;
+  /// Splits of at least this many documents compute move gains in parallel,
+  /// in chunks of the given size.
+  static constexpr uint32_t PARALLEL_SPLIT_SIZE = 16384;
+  static constexpr uint32_t PARALLEL_CHUNK_SIZE = 4096;
   /// The probability for a vertex to skip a move from its current bucket to
   /// another bucket; it often helps to escape from a local optima.
   static constexpr double SKIP_PROBABILITY = 0.1;
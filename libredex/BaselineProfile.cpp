@@ -6,7 +6,9 @@
  */
 
 #include "BaselineProfile.h"
-#include "StlUtil.h"
+
+#include "ConcurrentContainers.h"
+#include "WorkQueue.h"
 
 namespace baseline_profiles {
 
@@ -14,9 +16,9 @@ BaselineProfile get_baseline_profile(
     const BaselineProfileConfig& config,
     const method_profiles::MethodProfiles& method_profiles,
     std::unordered_set<const DexMethodRef*>* method_refs_without_def) {
-  std::unordered_set<const DexType*> classes;
-  std::unordered_set<const DexMethod*> startup_methods;
-  std::unordered_set<const DexMethod*> post_startup_methods;
+  // Collecting the profiled methods is cheap; deriving their flags requires
+  // a lookup in every interaction, which we do in parallel.
+  std::unordered_set<const DexMethod*> profiled_methods;
   for (auto&& [interaction_id, interaction_config] :
        config.interaction_configs) {
     const auto& method_stats = method_profiles.method_stats(interaction_id);
@@ -28,62 +30,43 @@ BaselineProfile get_baseline_profile(
         }
         continue;
       }
-
-      if (stat.appear_percent < interaction_config.threshold ||
-          stat.call_count < interaction_config.call_threshold) {
-        continue;
-      }
-
-      if (interaction_config.startup) {
-        startup_methods.insert(method);
-      }
-      if (interaction_config.post_startup) {
-        post_startup_methods.insert(method);
-      }
-      if (interaction_config.classes) {
-        classes.insert(method->get_class());
-      }
+      profiled_methods.insert(method);
     }
   }
 
-  // methods = startup_methods | post_startup_methods
-  std::unordered_set<const DexMethod*> methods(startup_methods.begin(),
-                                               startup_methods.end());
-  methods.insert(post_startup_methods.begin(), post_startup_methods.end());
-
-  // startup_post_startup_methods = startup_methods & post_startup_methods
-  std::unordered_set<const DexMethod*> startup_post_startup_methods(
-      startup_methods.begin(), startup_methods.end());
-  std20::erase_if(startup_post_startup_methods, [&](const DexMethod* m) {
-    return !post_startup_methods.count(m);
-  });
-
-  // startup_methods -= startup_post_startup_methods
-  std20::erase_if(startup_methods, [&](const DexMethod* m) {
-    return startup_post_startup_methods.count(m);
-  });
-
-  // post_startup_methods -= startup_post_startup_methods
-  std20::erase_if(post_startup_methods, [&](const DexMethod* m) {
-    return startup_post_startup_methods.count(m);
-  });
+  InsertOnlyConcurrentMap<const DexMethod*, MethodFlags> concurrent_methods;
+  InsertOnlyConcurrentSet<const DexType*> concurrent_classes;
+  workqueue_run<const DexMethod*>(
+      [&](const DexMethod* method) {
+        MethodFlags flags;
+        bool include_class = false;
+        for (auto&& [interaction_id, interaction_config] :
+             config.interaction_configs) {
+          auto stat = method_profiles.get_method_stat(interaction_id, method);
+          if (!stat || stat->appear_percent < interaction_config.threshold ||
+              stat->call_count < interaction_config.call_threshold) {
+            continue;
+          }
+          flags.startup |= interaction_config.startup;
+          flags.post_startup |= interaction_config.post_startup;
+          include_class |= interaction_config.classes;
+        }
+        if (include_class) {
+          concurrent_classes.insert(method->get_class());
+        }
+        if (flags.startup || flags.post_startup) {
+          flags.hot = true;
+          concurrent_methods.emplace(method, flags);
+        }
+      },
+      profiled_methods);
 
   baseline_profiles::BaselineProfile res;
-  for (auto* method : methods) {
-    auto& flags = res.methods[method];
-    if (startup_post_startup_methods.count(method)) {
-      flags.hot = true;
-      flags.startup = true;
-      flags.post_startup = true;
-    } else if (startup_methods.count(method)) {
-      flags.hot = true;
-      flags.startup = true;
-    } else if (post_startup_methods.count(method)) {
-      flags.hot = true;
-      flags.post_startup = true;
-    }
+  res.methods.reserve(concurrent_methods.size());
+  for (auto&& [method, flags] : concurrent_methods) {
+    res.methods.emplace(method, flags);
   }
-  for (auto* type : classes) {
+  for (auto* type : concurrent_classes) {
     res.classes.insert(type_class(type));
   }
   return res;
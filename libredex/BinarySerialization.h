@@ -7,6 +7,7 @@
 
 #include <boost/bimap/bimap.hpp>
 #include <boost/bimap/unordered_set_of.hpp>
+#include <istream>
 #include <limits>
 #include <ostream>
 #include <type_traits>
@@ -25,6 +26,14 @@ std::enable_if_t<std::is_integral<V>::value> write(std::ostream& os,
   os.write((const char*)&value, sizeof(value));
 }
 
+template <class V>
+std::enable_if_t<std::is_integral<V>::value, V> read(std::istream& is) {
+  V value;
+  is.read((char*)&value, sizeof(value));
+  always_assert_log(is, "Unexpected end of input");
+  return value;
+}
+
 /*
  * Serialize an array by emitting its length first, followed by the elements
  * in the array.
@@ -35,6 +35,7 @@
 #include "RedexMappedFile.h"
 #include "RedexResources.h"
 #include "Trace.h"
+#include "WorkQueue.h"
 #include "androidfw/LocaleValue.h"
 #include "androidfw/ResourceTypes.h"
 #include "utils/Serialize.h"
@@ -915,6 +916,7 @@ void BundleResources::fully_qualify_layout(
     const std::unordered_map<std::string, std::string>& element_to_class_name,
     const std::string& file_path,
     size_t* changes) {
+  resources::invalidate_xml_scan_cache();
   read_protobuf_file_contents(
       file_path,
       [&](google::protobuf::io::CodedInputStream& input, size_t size) {
@@ -1334,6 +1336,7 @@ void BundleResources::collect_xml_attribute_string_values_for_file(
 size_t BundleResources::remap_xml_reference_attributes(
     const std::string& filename,
     const std::map<uint32_t, uint32_t>& kept_to_remapped_ids) {
+  resources::invalidate_xml_scan_cache();
   if (is_raw_resource(filename)) {
     return 0;
   }
@@ -1827,18 +1830,13 @@ void reorder_config_value_repeated_field(aapt::pb::ResourceTable* pb_restable) {
 }
 } // namespace
 
-void ResourcesPbFile::collect_resource_data_for_file(
+namespace {
+aapt::pb::ResourceTable read_resource_table(
     const std::string& resources_pb_path) {
-  uint32_t result = 0;
-  bool empty_package = true;
-  TRACE(RES,
-        9,
-        "BundleResources collecting resource data for file: %s",
-        resources_pb_path.c_str());
+  aapt::pb::ResourceTable pb_restable;
   read_protobuf_file_contents(
       resources_pb_path,
       [&](google::protobuf::io::CodedInputStream& input, size_t /* unused */) {
-        aapt::pb::ResourceTable pb_restable;
         bool read_finish = pb_restable.ParseFromCodedStream(&input);
         always_assert_log(read_finish, "BundleResoource failed to read %s",
                           resources_pb_path.c_str());
@@ -1854,49 +1852,88 @@ void ResourcesPbFile::collect_resource_data_for_file(
         // config_value comparison work with different order, reorder repeated
         // fields in config_value's value
         reorder_config_value_repeated_field(&pb_restable);
-        for (const aapt::pb::Package& pb_package : pb_restable.package()) {
-          auto current_package_id = pb_package.package_id().id();
-          if (result == 0) {
-            result = current_package_id;
-          } else {
-            always_assert_log(
-                result == current_package_id,
-                "Broken assumption for only one package for resources.");
-          }
-          TRACE(RES, 9, "Package: %s %X", pb_package.package_name().c_str(),
-                current_package_id);
-          m_package_id_to_module_name.emplace(
-              current_package_id, module_name_from_pb_path(resources_pb_path));
-          for (const aapt::pb::Type& pb_type : pb_package.type()) {
-            empty_package = false;
-            auto current_type_id = pb_type.type_id().id();
-            const auto& current_type_name = pb_type.name();
-            TRACE(RES, 9, "  Type: %s %X", current_type_name.c_str(),
-                  current_type_id);
-            always_assert(m_type_id_to_names.count(current_type_id) == 0 ||
-                          m_type_id_to_names.at(current_type_id) ==
-                              current_type_name);
-            m_type_id_to_names[current_type_id] = current_type_name;
-            for (const aapt::pb::Entry& pb_entry : pb_type.entry()) {
-              std::string name_string = pb_entry.name();
-              auto current_entry_id = pb_entry.entry_id().id();
-              auto current_resource_id = MAKE_RES_ID(
-                  current_package_id, current_type_id, current_entry_id);
-              TRACE(RES, 9, "    Entry: %s %X %X", pb_entry.name().c_str(),
-                    current_entry_id, current_resource_id);
-              sorted_res_ids.emplace_back(current_resource_id);
-              always_assert(m_existed_res_ids.count(current_resource_id) == 0);
-              m_existed_res_ids.emplace(current_resource_id);
-              id_to_name.emplace(current_resource_id, name_string);
-              name_to_ids[name_string].push_back(current_resource_id);
-              m_res_id_to_entry.emplace(current_resource_id, pb_entry);
-              m_res_id_to_configvalue.emplace(current_resource_id,
-                                              pb_entry.config_value());
-            }
-          }
-        }
-        std::sort(sorted_res_ids.begin(), sorted_res_ids.end());
       });
+  return pb_restable;
+}
+} // namespace
+
+void ResourcesPbFile::collect_resource_data_for_file(
+    const std::string& resources_pb_path) {
+  TRACE(RES,
+        9,
+        "BundleResources collecting resource data for file: %s",
+        resources_pb_path.c_str());
+  collect_resource_data(resources_pb_path,
+                        read_resource_table(resources_pb_path));
+}
+
+void ResourcesPbFile::collect_resource_data_for_files(
+    const std::vector<std::string>& resources_pb_paths) {
+  // Decoding the protobuf of each module is independent and dominates the
+  // cost, so do it in parallel. Merging stays in path order so that ids and
+  // names are recorded deterministically.
+  std::vector<aapt::pb::ResourceTable> pb_restables(resources_pb_paths.size());
+  workqueue_run_for<size_t>(0, resources_pb_paths.size(), [&](size_t i) {
+    TRACE(RES,
+          9,
+          "BundleResources collecting resource data for file: %s",
+          resources_pb_paths[i].c_str());
+    pb_restables[i] = read_resource_table(resources_pb_paths[i]);
+  });
+  for (size_t i = 0; i < resources_pb_paths.size(); i++) {
+    collect_resource_data(resources_pb_paths[i], std::move(pb_restables[i]));
+  }
+}
+
+void ResourcesPbFile::collect_resource_data(
+    const std::string& resources_pb_path,
+    aapt::pb::ResourceTable pb_restable) {
+  uint32_t result = 0;
+  bool empty_package = true;
+  for (aapt::pb::Package& pb_package : *pb_restable.mutable_package()) {
+    auto current_package_id = pb_package.package_id().id();
+    if (result == 0) {
+      result = current_package_id;
+    } else {
+      always_assert_log(
+          result == current_package_id,
+          "Broken assumption for only one package for resources.");
+    }
+    TRACE(RES, 9, "Package: %s %X", pb_package.package_name().c_str(),
+          current_package_id);
+    m_package_id_to_module_name.emplace(
+        current_package_id, module_name_from_pb_path(resources_pb_path));
+    for (aapt::pb::Type& pb_type : *pb_package.mutable_type()) {
+      empty_package = false;
+      auto current_type_id = pb_type.type_id().id();
+      const auto& current_type_name = pb_type.name();
+      TRACE(RES, 9, "  Type: %s %X", current_type_name.c_str(),
+            current_type_id);
+      always_assert(m_type_id_to_names.count(current_type_id) == 0 ||
+                    m_type_id_to_names.at(current_type_id) ==
+                        current_type_name);
+      m_type_id_to_names[current_type_id] = current_type_name;
+      for (aapt::pb::Entry& pb_entry : *pb_type.mutable_entry()) {
+        std::string name_string = pb_entry.name();
+        auto current_entry_id = pb_entry.entry_id().id();
+        auto current_resource_id = MAKE_RES_ID(
+            current_package_id, current_type_id, current_entry_id);
+        TRACE(RES, 9, "    Entry: %s %X %X", pb_entry.name().c_str(),
+              current_entry_id, current_resource_id);
+        sorted_res_ids.emplace_back(current_resource_id);
+        always_assert(m_existed_res_ids.count(current_resource_id) == 0);
+        m_existed_res_ids.emplace(current_resource_id);
+        id_to_name.emplace(current_resource_id, name_string);
+        name_to_ids[name_string].push_back(current_resource_id);
+        m_res_id_to_configvalue.emplace(current_resource_id,
+                                        pb_entry.config_value());
+        // The table is owned here, so the entry can be moved rather than
+        // deep-copied a second time.
+        m_res_id_to_entry.emplace(current_resource_id, std::move(pb_entry));
+      }
+    }
+  }
+  std::sort(sorted_res_ids.begin(), sorted_res_ids.end());
   if (result != 0 && !empty_package) {
     always_assert_log(m_package_ids.count(result) == 0,
                       "Redefinition of Package ID 0x%x which is unexpected",
@@ -2163,9 +2200,7 @@ std::set<android::ResTable_config> ResourcesPbFile::get_configs_with_values(
 std::unique_ptr<ResourceTableFile> BundleResources::load_res_table() {
   const auto& res_pb_file_paths = find_resources_files();
   auto to_return = std::make_unique<ResourcesPbFile>(ResourcesPbFile());
-  for (const auto& res_pb_file_path : res_pb_file_paths) {
-    to_return->collect_resource_data_for_file(res_pb_file_path);
-  }
+  to_return->collect_resource_data_for_files(res_pb_file_paths);
   return to_return;
 }
 
@@ -2306,6 +2341,7 @@ void obfuscate_xml_attributes(
 void BundleResources::obfuscate_xml_files(
     const std::unordered_set<std::string>& allowed_types,
     const std::unordered_set<std::string>& do_not_obfuscate_elements) {
+  resources::invalidate_xml_scan_cache();
   using path_t = boost::filesystem::path;
   using dir_iterator = boost::filesystem::directory_iterator;
 
@@ -61,6 +61,10 @@ class ResourcesPbFile : public ResourceTableFile {
   uint64_t resource_value_count(uint32_t res_id) override;
   void delete_resource(uint32_t res_id) override;
   void collect_resource_data_for_file(const std::string& resources_pb_path);
+  // Like collect_resource_data_for_file on each path, with the files decoded
+  // in parallel.
+  void collect_resource_data_for_files(
+      const std::vector<std::string>& resources_pb_paths);
   size_t get_hash_from_values(const ConfigValues& config_values);
   size_t obfuscate_resource_and_serialize(
       const std::vector<std::string>& resource_files,
@@ -87,6 +91,9 @@ class ResourcesPbFile : public ResourceTableFile {
   std::string resolve_module_name_for_package_id(uint32_t package_id);
 
  private:
+  void collect_resource_data(const std::string& resources_pb_path,
+                             aapt::pb::ResourceTable pb_restable);
+
   std::map<uint32_t, std::string> m_type_id_to_names;
   std::unordered_set<uint32_t> m_existed_res_ids;
   std::map<uint32_t, const aapt::pb::Entry> m_res_id_to_entry;
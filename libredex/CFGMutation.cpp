@@ -25,6 +25,8 @@ void CFGMutation::clear() {
   }
 
   m_changes.clear();
+  m_edge_adds.clear();
+  m_edge_deletes.clear();
 }
 
 CFGMutation::ChangeSet* CFGMutation::primary_change_of_move_result(
@@ -129,9 +131,37 @@ void CFGMutation::process_block_changes(cfg::Block* block, Changes& changes) {
   changes.clear();
 }
 
-void CFGMutation::flush() {
+uint32_t CFGMutation::flush_and_simplify() {
+  std::vector<BlockId> touched_blocks;
+  flush(&touched_blocks);
+  if (touched_blocks.empty()) {
+    return 0;
+  }
+  return m_cfg.simplify_blocks(std::move(touched_blocks));
+}
+
+void CFGMutation::flush(std::vector<BlockId>* touched_blocks) {
   auto timer_scope = s_timer.scope();
 
+  for (auto& [src, target, type] : m_edge_adds) {
+    if (touched_blocks) {
+      touched_blocks->push_back(src->id());
+      touched_blocks->push_back(target->id());
+    }
+    m_cfg.add_edge(src, target, type);
+  }
+  m_edge_adds.clear();
+  if (!m_edge_deletes.empty()) {
+    if (touched_blocks) {
+      for (auto* edge : m_edge_deletes) {
+        touched_blocks->push_back(edge->src()->id());
+        touched_blocks->push_back(edge->target()->id());
+      }
+    }
+    m_cfg.delete_edges(m_edge_deletes.begin(), m_edge_deletes.end());
+    m_edge_deletes.clear();
+  }
+
   if (m_changes.empty()) {
     return;
   }
@@ -155,7 +185,16 @@ void CFGMutation::flush() {
 
   Changes remaining_changes;
   auto next_block_id = m_cfg.get_last_block()->id() + 1;
+  const auto first_new_block_id = next_block_id;
   for (auto& [block, changes, slow] : ordered_changes) {
+    if (touched_blocks) {
+      // Changes may remove outgoing edges, e.g., when replacing a branch with
+      // a throw, leaving the successors unreachable.
+      touched_blocks->push_back(block->id());
+      for (auto* e : block->succs()) {
+        touched_blocks->push_back(e->target()->id());
+      }
+    }
     if (!slow) {
       process_block_changes(block, *changes);
       always_assert(changes->empty());
@@ -180,6 +219,12 @@ void CFGMutation::flush() {
     auto block = m_cfg.get_block(next_block_id);
     process_block_changes_slow(block, remaining_changes);
   }
+  if (touched_blocks) {
+    for (auto id = first_new_block_id; id <= m_cfg.get_last_block()->id();
+         id++) {
+      touched_blocks->push_back(id);
+    }
+  }
 
   // The effect of one change can erase the anchor for another.  The changes
   // left behind are the ones whose anchors were removed. They will never be
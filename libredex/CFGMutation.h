@@ -11,6 +11,7 @@
 #include "DexPosition.h"
 #include "IRInstruction.h"
 
+#include <tuple>
 #include <unordered_map>
 #include <vector>
 
@@ -23,6 +24,11 @@ namespace cfg {
 /// IR in a CFG whilst iterating over its instructions which is not supported in
 /// general as a modification to the IR could invalidate the iterator.
 ///
+/// Edges can be added and deleted as part of the same batch. Flushing with
+/// \c flush_and_simplify then only cleans up the part of the graph that the
+/// batch touched, instead of following \c flush with a whole-graph
+/// \c ControlFlowGraph::simplify.
+///
 /// TODO(T59235117) Flush mutation in the destructor.
 class CFGMutation {
  public:
@@ -170,6 +176,17 @@ class CFGMutation {
   /// Any removed instruction will be freed when the cfg is destroyed.
   void remove(const cfg::InstructionIterator& anchor);
 
+  /// Add an edge of \p type from \p src to \p target.
+  /// Edge changes are applied before instruction changes, additions before
+  /// deletions.
+  void add_edge(Block* src, Block* target, EdgeType type);
+
+  /// Delete \p edge, which must still exist at the time the change is
+  /// applied. Like \c ControlFlowGraph::delete_edge, this removes a branch
+  /// instruction left with a single target, so that branch must not be the
+  /// anchor of another change.
+  void delete_edge(Edge* edge);
+
   /// Remove all pending changes without applying them.
   void clear();
 
@@ -178,6 +195,11 @@ class CFGMutation {
   /// they are added to the mutation.
   void flush();
 
+  /// Like flush, followed by \c ControlFlowGraph::simplify_blocks on the
+  /// blocks whose instructions or edges changed, and on the blocks the changes
+  /// created. Returns the number of instructions removed by the latter.
+  uint32_t flush_and_simplify();
+
  private:
   static bool is_terminal(IROpcode op);
 
@@ -276,8 +298,14 @@ class CFGMutation {
   /// Apply changes in any order.
   void process_block_changes(cfg::Block* block, Changes& changes);
 
+  /// Implements flush. If \p touched_blocks is given, the ids of the blocks
+  /// affected by the changes are added to it.
+  void flush(std::vector<BlockId>* touched_blocks);
+
   cfg::ControlFlowGraph& m_cfg;
   std::unordered_map<cfg::Block*, Changes> m_changes;
+  std::vector<std::tuple<Block*, Block*, EdgeType>> m_edge_adds;
+  std::vector<Edge*> m_edge_deletes;
 };
 
 inline CFGMutation::CFGMutation(cfg::ControlFlowGraph& cfg) : m_cfg(cfg) {}
@@ -439,6 +467,16 @@ inline void CFGMutation::remove(const cfg::InstructionIterator& anchor) {
   get_change_set(anchor)->add_change(ChangeSet::Insert::Replacing, {});
 }
 
+inline void CFGMutation::add_edge(Block* src, Block* target, EdgeType type) {
+  m_edge_adds.emplace_back(src, target, type);
+}
+
+inline void CFGMutation::delete_edge(Edge* edge) {
+  m_edge_deletes.push_back(edge);
+}
+
+inline void CFGMutation::flush() { flush(nullptr); }
+
 inline bool CFGMutation::is_terminal(IROpcode op) {
   return opcode::is_branch(op) || opcode::is_throw(op) ||
          opcode::is_a_return(op);
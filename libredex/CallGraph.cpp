@@ -521,6 +521,252 @@ Graph::Graph(const BuildStrategy& strat)
   predecessors_wq.run_all();
 }
 
+CompactGraph::CompactGraph(const BuildStrategy& strat) {
+  auto timer_scope = s_timer.scope();
+  Timer t("CompactGraph::CompactGraph");
+
+  auto root_and_dynamic = strat.get_roots();
+  m_dynamic_methods = std::move(root_and_dynamic.dynamic_methods);
+
+  // Obtain the callsites of each method recursively.
+  InsertOnlyConcurrentSet<const DexMethod*> reachable;
+  InsertOnlyConcurrentMap<const DexMethod*, CallSites> method_callsites;
+  auto wq = workqueue_foreach<const DexMethod*>(
+      [&](sparta::WorkerState<const DexMethod*>* worker_state,
+          const DexMethod* method) {
+        auto callsites = strat.get_callsites(method);
+        for (const auto& callsite : callsites) {
+          if (reachable.insert(callsite.callee).second) {
+            worker_state->push_task(callsite.callee);
+          }
+        }
+        method_callsites.emplace(method, std::move(callsites));
+      },
+      redex_parallel::default_num_threads(),
+      /*push_tasks_while_running=*/true);
+  for (const DexMethod* root : root_and_dynamic.roots) {
+    if (reachable.insert(root).second) {
+      wq.add_item(root);
+    }
+  }
+  wq.run_all();
+
+  // Number the nodes in a deterministic order, after the ghost nodes.
+  m_methods.reserve(reachable.size() + 2);
+  m_methods.push_back(nullptr);
+  m_methods.push_back(nullptr);
+  m_methods.insert(m_methods.end(), reachable.begin(), reachable.end());
+  std::sort(m_methods.begin() + 2, m_methods.end(), compare_dexmethods);
+  m_nodes.reserve(reachable.size());
+  for (NodeId n = 2; n < m_methods.size(); n++) {
+    m_nodes.emplace(m_methods[n], n);
+  }
+
+  // Gather the outgoing edges of each node, grouped by callee in node order,
+  // like Graph does.
+  using Successors = std::vector<std::pair<NodeId, IRInstruction*>>;
+  std::vector<Successors> successors(m_methods.size());
+  for (const DexMethod* root : root_and_dynamic.roots) {
+    successors[entry()].emplace_back(m_nodes.at(root), nullptr);
+  }
+  std::sort(successors[entry()].begin(), successors[entry()].end());
+  workqueue_run_for<NodeId>(2, m_methods.size(), [&](NodeId n) {
+    const auto& callsites = method_callsites.at(m_methods[n]);
+    auto& node_successors = successors[n];
+    if (callsites.empty()) {
+      node_successors.emplace_back(exit(), nullptr);
+      return;
+    }
+    node_successors.reserve(callsites.size());
+    for (const auto& callsite : callsites) {
+      node_successors.emplace_back(m_nodes.at(callsite.callee),
+                                   callsite.invoke_insn);
+    }
+    std::stable_sort(node_successors.begin(), node_successors.end(),
+                     [](auto& p, auto& q) { return p.first < q.first; });
+  });
+
+  m_successors_begin.resize(m_methods.size() + 1);
+  for (NodeId n = 0; n < m_methods.size(); n++) {
+    m_successors_begin[n + 1] = m_successors_begin[n] + successors[n].size();
+  }
+  auto edges = m_successors_begin.back();
+  m_edge_sources.resize(edges);
+  m_edge_targets.resize(edges);
+  m_invoke_insns.resize(edges);
+  workqueue_run_for<NodeId>(0, m_methods.size(), [&](NodeId n) {
+    auto e = m_successors_begin[n];
+    for (auto [target, invoke_insn] : successors[n]) {
+      m_edge_sources[e] = n;
+      m_edge_targets[e] = target;
+      m_invoke_insns[e] = invoke_insn;
+      e++;
+    }
+    Successors().swap(successors[n]);
+  });
+
+  // The incoming edges of each node, ordered by caller.
+  m_predecessors_begin.resize(m_methods.size() + 1);
+  for (auto target : m_edge_targets) {
+    m_predecessors_begin[target + 1]++;
+  }
+  for (NodeId n = 0; n < m_methods.size(); n++) {
+    m_predecessors_begin[n + 1] += m_predecessors_begin[n];
+  }
+  m_predecessors.resize(edges);
+  std::vector<uint32_t> next(m_predecessors_begin.begin(),
+                             m_predecessors_begin.end() - 1);
+  for (EdgeId e = 0; e < edges; e++) {
+    m_predecessors[next[m_edge_targets[e]]++] = e;
+  }
+}
+
+void Graph::clear_successors(Node* node, std::unordered_set<Node*>* touched) {
+  for (auto& edge : node->m_successors) {
+    auto* callee = const_cast<Node*>(edge.callee());
+    std20::erase_if(callee->m_predecessors,
+                    [node](const Edge* e) { return e->caller() == node; });
+    touched->insert(callee);
+    if (edge.invoke_insn() != nullptr) {
+      m_insn_to_callee.erase(edge.invoke_insn());
+    }
+  }
+  node->m_successors.clear();
+}
+
+void Graph::update(const BuildStrategy& strat,
+                   const MethodVector& changed,
+                   const MethodVector& removed) {
+  auto timer_scope = s_timer.scope();
+  Timer t("Graph::update");
+
+  auto root_and_dynamic = strat.get_roots();
+  m_dynamic_methods = std::move(root_and_dynamic.dynamic_methods);
+  m_callee_to_callers.clear();
+
+  // Callee nodes whose predecessors changed, and need to be re-sorted.
+  std::unordered_set<Node*> touched;
+  std::unordered_set<Node*> scheduled;
+  std::vector<Node*> to_process;
+  auto schedule = [&](Node* node) {
+    if (scheduled.insert(node).second) {
+      to_process.push_back(node);
+    }
+  };
+
+  std::unordered_set<const DexMethod*> removed_set(removed.begin(),
+                                                   removed.end());
+  for (auto* method : removed) {
+    auto* node = m_nodes.get_unsafe(method);
+    if (node == nullptr || node->m_detached) {
+      continue;
+    }
+    for (auto* edge : node->m_predecessors) {
+      auto* caller = const_cast<Node*>(edge->caller());
+      if (!removed_set.count(caller->method())) {
+        schedule(caller);
+      }
+    }
+    clear_successors(node, &touched);
+    node->m_detached = true;
+  }
+  for (auto* method : changed) {
+    auto* node = m_nodes.get_unsafe(method);
+    if (node != nullptr && !node->m_detached && !removed_set.count(method)) {
+      schedule(node);
+    }
+  }
+  schedule(m_entry.get());
+
+  auto get_node = [&](const DexMethod* method) -> Node* {
+    auto [node, created] = m_nodes.emplace_unsafe(method, method);
+    if (created || node->m_detached) {
+      node->m_detached = false;
+      schedule(node);
+    }
+    return node;
+  };
+
+  while (!to_process.empty()) {
+    std::vector<Node*> batch;
+    batch.swap(to_process);
+    // Computing the callsites is the expensive part; do that in parallel.
+    std::vector<CallSites> batch_callsites(batch.size());
+    workqueue_run_for<size_t>(0, batch.size(), [&](size_t i) {
+      if (!batch[i]->is_entry()) {
+        batch_callsites[i] = strat.get_callsites(batch[i]->method());
+      }
+    });
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+      auto* caller_node = batch[i];
+      clear_successors(caller_node, &touched);
+
+      std::vector<std::pair<Node*, IRInstruction*>> targets;
+      if (caller_node->is_entry()) {
+        for (const DexMethod* root : root_and_dynamic.roots) {
+          targets.emplace_back(get_node(root), nullptr);
+        }
+      } else if (batch_callsites[i].empty()) {
+        targets.emplace_back(m_exit.get(), nullptr);
+      } else {
+        std::unordered_map<const IRInstruction*,
+                           std::unordered_set<const DexMethod*>>
+            insn_to_callee;
+        for (const auto& callsite : batch_callsites[i]) {
+          targets.emplace_back(get_node(callsite.callee),
+                               callsite.invoke_insn);
+          insn_to_callee[callsite.invoke_insn].emplace(callsite.callee);
+        }
+        for (auto&& [invoke_insn, callees] : insn_to_callee) {
+          m_insn_to_callee.emplace(invoke_insn, std::move(callees));
+        }
+      }
+
+      // Same order as in the constructor: grouped by callee, in callee order,
+      // then in callsite order.
+      std::stable_sort(targets.begin(), targets.end(), [](auto& p, auto& q) {
+        return compare_dexmethods(p.first->method(), q.first->method());
+      });
+      auto& caller_successors = caller_node->m_successors;
+      caller_successors.reserve(targets.size());
+      for (auto& [callee_node, invoke_insn] : targets) {
+        caller_successors.emplace_back(caller_node, callee_node, invoke_insn);
+        callee_node->m_predecessors.push_back(&caller_successors.back());
+        touched.insert(callee_node);
+      }
+    }
+  }
+
+  // Detach everything that is no longer reachable from the entry node.
+  std::unordered_set<const Node*> reachable;
+  std::vector<const Node*> stack{m_entry.get()};
+  reachable.insert(m_entry.get());
+  while (!stack.empty()) {
+    auto* node = stack.back();
+    stack.pop_back();
+    for (const auto& edge : node->m_successors) {
+      if (reachable.insert(edge.callee()).second) {
+        stack.push_back(edge.callee());
+      }
+    }
+  }
+  for (auto& [method, node] : m_nodes) {
+    if (!node.m_detached && !reachable.count(&node)) {
+      clear_successors(&node, &touched);
+      node.m_detached = true;
+    }
+  }
+
+  for (auto* node : touched) {
+    std::stable_sort(node->m_predecessors.begin(), node->m_predecessors.end(),
+                     [](const Edge* p, const Edge* q) {
+                       return compare_dexmethods(p->caller()->method(),
+                                                 q->caller()->method());
+                     });
+  }
+}
+
 const MethodSet& resolve_callees_in_graph(const Graph& graph,
                                           const IRInstruction* insn) {
   const auto& insn_to_callee = graph.get_insn_to_callee();
@@ -160,6 +160,8 @@ class Node final {
   std::vector<const Edge*> m_predecessors;
   std::vector<Edge> m_successors;
   NodeType m_type;
+  // Set for nodes that got removed or became unreachable during an update.
+  bool m_detached{false};
 
   friend class Graph;
 };
@@ -199,7 +201,8 @@ class Graph final {
   NodeId exit() const { return m_exit.get(); }
 
   bool has_node(const DexMethod* m) const {
-    return m_nodes.count_unsafe(const_cast<DexMethod*>(m)) != 0;
+    auto* node = m_nodes.get_unsafe(m);
+    return node != nullptr && !node->m_detached;
   }
 
   NodeId node(const DexMethod* m) const {
@@ -209,8 +212,8 @@ class Graph final {
     return m_nodes.get_unsafe(m);
   }
 
-  const InsertOnlyConcurrentMap<const IRInstruction*,
-                                std::unordered_set<const DexMethod*>>&
+  const ConcurrentMap<const IRInstruction*,
+                      std::unordered_set<const DexMethod*>>&
   get_insn_to_callee() const {
     return m_insn_to_callee;
   }
@@ -221,12 +224,37 @@ class Graph final {
 
   const MethodVector& get_callers(const DexMethod* callee) const;
 
+  /*
+   * Brings the graph up to date after some methods changed, without
+   * rebuilding it from scratch.
+   *
+   * - `changed` are methods whose code changed, or which got added;
+   * - `removed` are methods which got deleted.
+   *
+   * The outgoing edges of all changed methods, of the callers of removed
+   * methods, and of the ghost entry node are recomputed with `strat`, which
+   * must be the kind of strategy the graph was originally built with. Methods
+   * that become reachable are added recursively, and nodes that become
+   * unreachable are detached, so that the result matches a fresh build.
+   *
+   * Changes that alter how unchanged callers resolve their callees, e.g.
+   * adding an override of a virtual method, require including those callers
+   * in `changed`.
+   *
+   * This invalidates references previously obtained via get_callers().
+   */
+  void update(const BuildStrategy& strat,
+              const MethodVector& changed,
+              const MethodVector& removed);
+
  private:
+  void clear_successors(Node* node, std::unordered_set<Node*>* touched);
+
+
   std::unique_ptr<Node> m_entry;
   std::unique_ptr<Node> m_exit;
   InsertOnlyConcurrentMap<const DexMethod*, Node> m_nodes;
-  InsertOnlyConcurrentMap<const IRInstruction*,
-                          std::unordered_set<const DexMethod*>>
+  ConcurrentMap<const IRInstruction*, std::unordered_set<const DexMethod*>>
       m_insn_to_callee;
   mutable InsertOnlyConcurrentMap<const DexMethod*, MethodVector>
       m_callee_to_callers;
@@ -322,6 +350,151 @@ class GraphInterface {
   static NodeId target(const Graph&, const EdgeId& e) { return e->callee(); }
 };
 
+/*
+ * A frozen form of the call graph, in compressed sparse row format: nodes and
+ * edges are dense indices, the edges of each caller are contiguous, and the
+ * incoming edges of each callee are listed contiguously as well. It takes a
+ * fraction of the memory of a Graph, which allocates a node per method and an
+ * edge object per call site, and iterating over it touches far less memory.
+ *
+ * The nodes and edges are ordered as in a Graph built with the same strategy.
+ * A CompactGraph cannot be updated; build a new one instead.
+ */
+class CompactGraph final {
+ public:
+  using NodeId = uint32_t;
+  using EdgeId = uint32_t;
+
+  // The outgoing edges of a node, which are consecutive.
+  class EdgeIdInterval {
+   public:
+    class iterator {
+     public:
+      using value_type = EdgeId;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const value_type*;
+      using reference = const value_type&;
+      using iterator_category = std::input_iterator_tag;
+
+      explicit iterator(value_type current) : m_current(current) {}
+
+      reference operator*() const { return m_current; }
+
+      bool operator==(const iterator& other) const {
+        return m_current == other.m_current;
+      }
+
+      bool operator!=(const iterator& other) const {
+        return !(*this == other);
+      }
+
+      iterator& operator++() {
+        ++m_current;
+        return *this;
+      }
+
+     private:
+      value_type m_current;
+    };
+
+    EdgeIdInterval(EdgeId begin, EdgeId end) : m_begin(begin), m_end(end) {}
+
+    iterator begin() const { return iterator(m_begin); }
+    iterator end() const { return iterator(m_end); }
+    size_t size() const { return m_end - m_begin; }
+
+   private:
+    EdgeId m_begin;
+    EdgeId m_end;
+  };
+
+  // The incoming edges of a node.
+  class EdgeIdRange {
+   public:
+    using iterator = const EdgeId*;
+
+    EdgeIdRange(iterator begin, iterator end) : m_begin(begin), m_end(end) {}
+
+    iterator begin() const { return m_begin; }
+    iterator end() const { return m_end; }
+    size_t size() const { return m_end - m_begin; }
+
+   private:
+    iterator m_begin;
+    iterator m_end;
+  };
+
+  explicit CompactGraph(const BuildStrategy&);
+
+  NodeId entry() const { return 0; }
+  NodeId exit() const { return 1; }
+
+  size_t num_nodes() const { return m_methods.size(); }
+  size_t num_edges() const { return m_edge_targets.size(); }
+
+  // The method of a node, or nullptr for the ghost entry and exit nodes.
+  const DexMethod* method(NodeId n) const { return m_methods[n]; }
+
+  bool has_node(const DexMethod* m) const { return m_nodes.count(m); }
+  NodeId node(const DexMethod* m) const {
+    return m == nullptr ? entry() : m_nodes.at(m);
+  }
+
+  EdgeIdInterval callees(NodeId n) const {
+    return EdgeIdInterval(m_successors_begin[n], m_successors_begin[n + 1]);
+  }
+  EdgeIdRange callers(NodeId n) const {
+    return EdgeIdRange(m_predecessors.data() + m_predecessors_begin[n],
+                       m_predecessors.data() + m_predecessors_begin[n + 1]);
+  }
+
+  NodeId caller(EdgeId e) const { return m_edge_sources[e]; }
+  NodeId callee(EdgeId e) const { return m_edge_targets[e]; }
+  // The invoke instruction of the call site, or nullptr for the edges of the
+  // ghost entry and exit nodes.
+  IRInstruction* invoke_insn(EdgeId e) const { return m_invoke_insns[e]; }
+
+  const MethodSet& get_dynamic_methods() const { return m_dynamic_methods; }
+
+ private:
+  std::vector<const DexMethod*> m_methods;
+  std::unordered_map<const DexMethod*, NodeId> m_nodes;
+  // Offsets into the edge arrays, indexed by node, plus a final sentinel.
+  std::vector<EdgeId> m_successors_begin;
+  std::vector<EdgeId> m_edge_sources;
+  std::vector<NodeId> m_edge_targets;
+  std::vector<IRInstruction*> m_invoke_insns;
+  // Offsets into m_predecessors, indexed by node, plus a final sentinel.
+  std::vector<uint32_t> m_predecessors_begin;
+  std::vector<EdgeId> m_predecessors;
+  MethodSet m_dynamic_methods;
+};
+
+// The counterpart of GraphInterface for the compact call graph.
+class CompactGraphInterface {
+ public:
+  using Graph = CompactGraph;
+  using NodeId = CompactGraph::NodeId;
+  using EdgeId = CompactGraph::EdgeId;
+
+  static NodeId entry(const Graph& graph) { return graph.entry(); }
+  static NodeId exit(const Graph& graph) { return graph.exit(); }
+  static CompactGraph::EdgeIdRange predecessors(const Graph& graph,
+                                                const NodeId& m) {
+    return graph.callers(m);
+  }
+  static CompactGraph::EdgeIdInterval successors(const Graph& graph,
+                                                 const NodeId& m) {
+    return graph.callees(m);
+  }
+  static NodeId source(const Graph& graph, const EdgeId& e) {
+    return graph.caller(e);
+  }
+  static NodeId target(const Graph& graph, const EdgeId& e) {
+    return graph.callee(e);
+  }
+};
+
 const MethodSet& resolve_callees_in_graph(const Graph& graph,
                                           const IRInstruction* insn);
 
@@ -7,6 +7,7 @@
 
 #include "ClassHierarchy.h"
 
+#include "CompactClassHierarchy.h"
 #include "DexUtil.h"
 #include "RedexContext.h"
 #include "Resolver.h"
@@ -93,18 +94,6 @@ void gather_intf_extenders(const Scope& scope,
   }
 }
 
-void build_interface_map(InterfaceMap& interfaces,
-                         const ClassHierarchy& hierarchy,
-                         const DexClass* current,
-                         const TypeSet& implementors) {
-  for (const auto& intf : *current->get_interfaces()) {
-    interfaces[intf].insert(implementors.begin(), implementors.end());
-    const auto intf_cls = type_class(intf);
-    if (intf_cls == nullptr) continue;
-    build_interface_map(interfaces, hierarchy, intf_cls, implementors);
-  }
-}
-
 } // namespace
 
 ClassHierarchy build_internal_type_hierarchy(const Scope& scope) {
@@ -124,18 +113,7 @@ ClassHierarchy build_type_hierarchy(const Scope& scope) {
 }
 
 InterfaceMap build_interface_map(const ClassHierarchy& hierarchy) {
-  InterfaceMap interfaces;
-  // build the type hierarchy
-  for (const auto& cls_it : hierarchy) {
-    const auto cls = type_class(cls_it.first);
-    if (cls == nullptr) continue;
-    if (is_interface(cls)) continue;
-    TypeSet implementors;
-    get_all_children(hierarchy, cls->get_type(), implementors);
-    implementors.insert(cls->get_type());
-    build_interface_map(interfaces, hierarchy, cls, implementors);
-  }
-  return interfaces;
+  return CompactClassHierarchy(hierarchy).to_interface_map();
 }
 
 const TypeSet& get_children(const ClassHierarchy& hierarchy,
@@ -12,6 +12,7 @@
 #include <numeric>
 
 #include "DexUtil.h"
+#include "Show.h"
 #include "WorkQueue.h"
 
 ClassReferences::ClassReferences(const DexClass* cls) {
@@ -49,6 +50,13 @@ ClassReferencesCache::ClassReferencesCache(
       classes);
 }
 
+void ClassReferencesCache::insert(const DexClass* cls,
+                                  ClassReferences refs) {
+  auto emplaced = m_cache.emplace(cls, std::move(refs));
+  always_assert_log(emplaced.second, "References of %s already cached",
+                    SHOW(cls));
+}
+
 const ClassReferences& ClassReferencesCache::get(const DexClass* cls) const {
   return *m_cache
               .get_or_create_and_assert_equal(
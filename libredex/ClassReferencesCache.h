@@ -14,6 +14,7 @@
 #include "DexClass.h"
 
 struct ClassReferences {
+  ClassReferences() = default;
   explicit ClassReferences(const DexClass* cls);
 
   bool operator==(const ClassReferences& other) const;
@@ -30,6 +31,11 @@ class ClassReferencesCache {
   explicit ClassReferencesCache(const std::vector<DexClass*>& classes);
   const ClassReferences& get(const DexClass* cls) const;
 
+  // Records the references of a class up front instead of gathering them from
+  // the class, e.g. to replay references recorded by an earlier run. The
+  // vectors must be sorted and free of duplicates.
+  void insert(const DexClass* cls, ClassReferences refs);
+
  private:
   mutable InsertOnlyConcurrentMap<const DexClass*, ClassReferences> m_cache;
 };
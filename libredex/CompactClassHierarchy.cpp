@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "CompactClassHierarchy.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include "RedexContext.h"
+#include "Show.h"
+#include "TypeUtil.h"
+#include "WorkQueue.h"
+
+namespace {
+
+constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+// (dense id of the row, element)
+using RowEntry = std::pair<uint32_t, const DexType*>;
+
+/*
+ * Lays out the entries as rows indexed by dense id, and sorts each row like a
+ * TypeSet. The entries of a row must be unique.
+ */
+void build_rows(const std::vector<RowEntry>& entries,
+                std::vector<uint32_t>& offsets,
+                std::vector<const DexType*>& rows) {
+  uint32_t max_id = 0;
+  for (const auto& [id, _] : entries) {
+    max_id = std::max(max_id, id);
+  }
+  offsets.assign(entries.empty() ? 0 : max_id + 2, 0);
+  for (const auto& [id, _] : entries) {
+    offsets[id + 1]++;
+  }
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  rows.resize(entries.size());
+  std::vector<uint32_t> next(offsets);
+  std::vector<uint32_t> unsorted;
+  for (const auto& [id, type] : entries) {
+    auto pos = next[id]++;
+    rows[pos] = type;
+    if (pos == offsets[id] + 1) {
+      unsorted.push_back(id);
+    }
+  }
+  workqueue_run_for<size_t>(0, unsorted.size(), [&](size_t i) {
+    auto id = unsorted[i];
+    std::sort(rows.begin() + offsets[id], rows.begin() + offsets[id + 1],
+              dextypes_comparator());
+  });
+}
+
+// The interfaces of a class, and transitively their super interfaces as far as
+// they are known.
+void gather_interfaces(const DexClass* cls,
+                       std::vector<const DexType*>& interfaces) {
+  for (const auto* intf : *cls->get_interfaces()) {
+    interfaces.push_back(intf);
+    const auto* intf_cls = type_class(intf);
+    if (intf_cls != nullptr) {
+      gather_interfaces(intf_cls, interfaces);
+    }
+  }
+}
+
+} // namespace
+
+CompactClassHierarchy::CompactClassHierarchy(const Scope& scope,
+                                             bool include_external) {
+  std::vector<const DexClass*> classes;
+  for (const auto* cls : scope) {
+    if (!is_interface(cls)) {
+      classes.push_back(cls);
+    }
+  }
+  if (include_external) {
+    g_redex->walk_type_class([&](const DexType*, const DexClass* cls) {
+      if (cls->is_external() && !is_interface(cls)) {
+        classes.push_back(cls);
+      }
+    });
+  }
+  std::vector<const DexType*> types;
+  std::vector<Edge> edges;
+  for (const auto* cls : classes) {
+    types.push_back(cls->get_type());
+    const auto* super = cls->get_super_class();
+    if (super != nullptr) {
+      types.push_back(super);
+      edges.emplace_back(super, cls->get_type());
+    } else {
+      always_assert_log(cls->get_type() == type::java_lang_Object(), "%s",
+                        SHOW(cls->get_type()));
+    }
+  }
+  build(types, edges);
+}
+
+CompactClassHierarchy::CompactClassHierarchy(const ClassHierarchy& hierarchy) {
+  std::vector<const DexType*> types;
+  std::vector<Edge> edges;
+  types.reserve(hierarchy.size());
+  for (const auto& [parent, children] : hierarchy) {
+    types.push_back(parent);
+    for (const auto* child : children) {
+      types.push_back(child);
+      edges.emplace_back(parent, child);
+    }
+  }
+  build(types, edges);
+}
+
+void CompactClassHierarchy::build(const std::vector<const DexType*>& types,
+                                  const std::vector<Edge>& edges) {
+  std::vector<uint32_t> ids(types.size());
+  workqueue_run_for<size_t>(0, types.size(), [&](size_t i) {
+    ids[i] = g_redex->get_dense_id(types[i]);
+  });
+  auto max_id = ids.empty() ? 0 : *std::max_element(ids.begin(), ids.end());
+  std::vector<uint32_t> index_by_id(max_id + 1, NONE);
+  for (size_t i = 0; i < types.size(); ++i) {
+    if (index_by_id[ids[i]] == NONE) {
+      index_by_id[ids[i]] = m_types.size();
+      m_types.push_back(types[i]);
+    }
+  }
+  auto index = [&](const DexType* type) {
+    return index_by_id[g_redex->get_dense_id(type)];
+  };
+
+  // A type has at most one parent, so keeping the first edge to a child also
+  // drops duplicate edges.
+  std::vector<uint32_t> parents(m_types.size(), NONE);
+  std::vector<RowEntry> children;
+  children.reserve(edges.size());
+  for (const auto& [parent, child] : edges) {
+    auto& child_parent = parents[index(child)];
+    if (child_parent == NONE) {
+      child_parent = index(parent);
+      children.emplace_back(g_redex->get_dense_id(parent), child);
+    }
+  }
+  build_rows(children, m_children_offsets, m_children);
+
+  // A class implements the interfaces it declares, and the ones declared by
+  // its ancestors in the hierarchy.
+  std::vector<std::vector<const DexType*>> declared(m_types.size());
+  workqueue_run_for<size_t>(0, m_types.size(), [&](size_t i) {
+    const auto* cls = type_class(m_types[i]);
+    if (cls == nullptr || is_interface(cls)) {
+      return;
+    }
+    auto& interfaces = declared[i];
+    gather_interfaces(cls, interfaces);
+    std::sort(interfaces.begin(), interfaces.end());
+    interfaces.erase(std::unique(interfaces.begin(), interfaces.end()),
+                     interfaces.end());
+  });
+  std::vector<std::vector<uint32_t>> implemented(m_types.size());
+  workqueue_run_for<size_t>(0, m_types.size(), [&](size_t i) {
+    std::vector<const DexType*> interfaces;
+    for (uint32_t a = i; a != NONE; a = parents[a]) {
+      const auto& more = declared[a];
+      interfaces.insert(interfaces.end(), more.begin(), more.end());
+    }
+    std::sort(interfaces.begin(), interfaces.end());
+    interfaces.erase(std::unique(interfaces.begin(), interfaces.end()),
+                     interfaces.end());
+    auto& intf_ids = implemented[i];
+    intf_ids.reserve(interfaces.size());
+    for (const auto* intf : interfaces) {
+      intf_ids.push_back(g_redex->get_dense_id(intf));
+    }
+  });
+  std::vector<RowEntry> implementors;
+  for (size_t i = 0; i < m_types.size(); ++i) {
+    for (auto intf_id : implemented[i]) {
+      implementors.emplace_back(intf_id, m_types[i]);
+    }
+  }
+  build_rows(implementors, m_implementors_offsets, m_implementors);
+}
+
+CompactClassHierarchy::TypeRange CompactClassHierarchy::get_row(
+    const std::vector<uint32_t>& offsets,
+    const std::vector<const DexType*>& rows,
+    const DexType* type) {
+  auto id = g_redex->get_dense_id(type);
+  if (id + 1 >= offsets.size()) {
+    return TypeRange();
+  }
+  return TypeRange(rows.data() + offsets[id], rows.data() + offsets[id + 1]);
+}
+
+bool CompactClassHierarchy::implements(const DexType* cls,
+                                       const DexType* intf) const {
+  auto implementors = get_implementors(intf);
+  return std::binary_search(implementors.begin(), implementors.end(), cls,
+                            dextypes_comparator());
+}
+
+void CompactClassHierarchy::get_all_children(const DexType* type,
+                                             TypeSet& children) const {
+  for (const auto* child : get_children(type)) {
+    children.insert(child);
+    get_all_children(child, children);
+  }
+}
+
+ClassHierarchy CompactClassHierarchy::to_class_hierarchy() const {
+  ClassHierarchy hierarchy;
+  hierarchy.reserve(m_types.size());
+  for (const auto* type : m_types) {
+    auto children = get_children(type);
+    hierarchy.emplace(type, TypeSet(children.begin(), children.end()));
+  }
+  return hierarchy;
+}
+
+InterfaceMap CompactClassHierarchy::to_interface_map() const {
+  InterfaceMap interfaces;
+  std::vector<std::pair<uint32_t, TypeSet*>> rows;
+  for (uint32_t id = 0; id + 1 < m_implementors_offsets.size(); ++id) {
+    if (m_implementors_offsets[id] != m_implementors_offsets[id + 1]) {
+      rows.emplace_back(id, &interfaces[g_redex->get_type_by_dense_id(id)]);
+    }
+  }
+  // The sets are distinct nodes of the map, so they can be filled in parallel.
+  workqueue_run_for<size_t>(0, rows.size(), [&](size_t i) {
+    auto [id, implementors] = rows[i];
+    implementors->insert(m_implementors.begin() + m_implementors_offsets[id],
+                         m_implementors.begin() +
+                             m_implementors_offsets[id + 1]);
+  });
+  return interfaces;
+}
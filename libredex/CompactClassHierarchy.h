@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <boost/range/iterator_range.hpp>
+
+#include "ClassHierarchy.h"
+#include "DexClass.h"
+
+/*
+ * A read-only form of a ClassHierarchy and of its InterfaceMap (see
+ * ClassHierarchy.h), built in parallel.
+ *
+ * Both relations are stored as compressed sparse rows indexed by the dense id
+ * of a type (see RedexContext::get_dense_id): a vector of offsets, and a single
+ * contiguous array holding the rows one after the other. Looking up the
+ * children or the implementors of a type is two loads, and iterating over
+ * them a linear scan, instead of a hash lookup and a walk over the nodes of a
+ * std::set.
+ *
+ * Every row is sorted like a TypeSet, so iterating over a row visits the types
+ * in the same order as the map-based structures, which they can be converted
+ * to for existing clients.
+ */
+class CompactClassHierarchy {
+ public:
+  using TypeRange = boost::iterator_range<const DexType* const*>;
+
+  /*
+   * Builds the hierarchy of the non-interface classes of the scope, like
+   * build_internal_type_hierarchy, and also of the external classes when
+   * `include_external` is set, like build_type_hierarchy.
+   */
+  CompactClassHierarchy(const Scope& scope, bool include_external);
+
+  explicit CompactClassHierarchy(const ClassHierarchy& hierarchy);
+
+  // The types of the hierarchy, i.e. the keys of the equivalent ClassHierarchy.
+  const std::vector<const DexType*>& types() const { return m_types; }
+
+  // The direct children of a type.
+  TypeRange get_children(const DexType* type) const {
+    return get_row(m_children_offsets, m_children, type);
+  }
+
+  // All the classes implementing an interface, as in build_interface_map.
+  TypeRange get_implementors(const DexType* intf) const {
+    return get_row(m_implementors_offsets, m_implementors, intf);
+  }
+
+  bool implements(const DexType* cls, const DexType* intf) const;
+
+  void get_all_children(const DexType* type, TypeSet& children) const;
+
+  ClassHierarchy to_class_hierarchy() const;
+
+  InterfaceMap to_interface_map() const;
+
+ private:
+  using Edge = std::pair<const DexType*, const DexType*>;
+
+  // Builds both relations from the types of the hierarchy and the edges from
+  // each parent to a child.
+  void build(const std::vector<const DexType*>& types,
+             const std::vector<Edge>& edges);
+
+  static TypeRange get_row(const std::vector<uint32_t>& offsets,
+                           const std::vector<const DexType*>& rows,
+                           const DexType* type);
+
+  std::vector<const DexType*> m_types;
+  std::vector<uint32_t> m_children_offsets;
+  std::vector<const DexType*> m_children;
+  std::vector<uint32_t> m_implementors_offsets;
+  std::vector<const DexType*> m_implementors;
+};
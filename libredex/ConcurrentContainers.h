@@ -7,14 +7,18 @@
 
 #pragma once
 
+#include <atomic>
 #include <boost/intrusive/pointer_plus_bits.hpp>
 #include <cstring>
 #include <functional>
 #include <initializer_list>
 #include <iterator>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <stack>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -35,6 +39,21 @@ inline AccumulatingTimer s_reserving("cc_impl::reserving_seconds");
 inline size_t s_concurrent_destruction_threshold{
     std::numeric_limits<size_t>::max()};
 
+// Process-wide counters of how often a thread had to wait for a ConcurrentMap
+// slot lock, and the highest such count of any single slot, to spot maps whose
+// keys hot-spot on few slots.
+inline std::atomic<size_t> s_contended_locks{0};
+inline std::atomic<size_t> s_max_slot_contended_locks{0};
+
+inline void record_contended_lock(size_t slot_count) {
+  s_contended_locks.fetch_add(1, std::memory_order_relaxed);
+  auto max = s_max_slot_contended_locks.load(std::memory_order_relaxed);
+  while (slot_count > max &&
+         !s_max_slot_contended_locks.compare_exchange_weak(
+             max, slot_count, std::memory_order_relaxed)) {
+  }
+}
+
 bool is_thread_pool_active();
 
 void workqueue_run_for(size_t start,
@@ -84,8 +103,12 @@ size_t get_prime_number_greater_or_equal_to(size_t);
  * or `compact` is called. This ensures that get always returns a valid
  * reference, even in the face of concurrent erasing.
  *
- * TODO: Right now, we use the (default) std::memory_order_seq_cst everywhere.
- * Acquire/release semantics should be sufficient.
+ * Lookups and insertions use acquire loads and release publication: a node is
+ * fully constructed before the compare-exchange that links it into a chain,
+ * and every thread that reaches a node does so through an acquire load of the
+ * pointer to it. The element count is only a heuristic for resizing and is
+ * updated with relaxed ordering. Resizing and erasure are comparatively rare
+ * and keep the (default) std::memory_order_seq_cst.
  */
 template <typename Key, typename Value, typename Hash, typename KeyEqual>
 class ConcurrentHashtable final {
@@ -126,8 +149,8 @@ class ConcurrentHashtable final {
    * operations (concurrent or synchronous) invalidate all iterators.
    */
   iterator begin() {
-    auto* storage = m_storage.load();
-    auto* ptr = storage->ptrs[0].load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
+    auto* ptr = storage->ptrs[0].load(std::memory_order_acquire);
     return iterator(storage, 0, get_node(ptr));
   }
 
@@ -136,7 +159,7 @@ class ConcurrentHashtable final {
    * operations (concurrent or synchronous) invalidate all iterators.
    */
   iterator end() {
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     return iterator(storage, storage->size, nullptr);
   }
 
@@ -145,8 +168,8 @@ class ConcurrentHashtable final {
    * operations (concurrent or synchronous) invalidate all iterators.
    */
   const_iterator begin() const {
-    auto* storage = m_storage.load();
-    auto* ptr = storage->ptrs[0].load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
+    auto* ptr = storage->ptrs[0].load(std::memory_order_acquire);
     return const_iterator(storage, 0, get_node(ptr));
   }
 
@@ -155,7 +178,7 @@ class ConcurrentHashtable final {
    * operations (concurrent or synchronous) invalidate all iterators.
    */
   const_iterator end() const {
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     return const_iterator(storage, storage->size, nullptr);
   }
 
@@ -165,17 +188,17 @@ class ConcurrentHashtable final {
    */
   iterator find(const key_type& key) {
     auto hash = hasher()(key);
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     auto* ptrs = storage->ptrs;
     size_t i = hash % storage->size;
     auto* root_loc = &ptrs[i];
-    auto* root = root_loc->load();
+    auto* root = root_loc->load(std::memory_order_acquire);
     for (auto* ptr = root; ptr;) {
       auto* node = get_node(ptr);
       if (key_equal()(const_key_projection()(node->value), key)) {
         return iterator(storage, i, node);
       }
-      ptr = node->prev.load();
+      ptr = node->prev.load(std::memory_order_acquire);
     }
     return end();
   }
@@ -186,17 +209,17 @@ class ConcurrentHashtable final {
    */
   const_iterator find(const key_type& key) const {
     auto hash = hasher()(key);
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     auto* ptrs = storage->ptrs;
     size_t i = hash % storage->size;
     auto* root_loc = &ptrs[i];
-    auto* root = root_loc->load();
+    auto* root = root_loc->load(std::memory_order_acquire);
     for (auto* ptr = root; ptr;) {
       auto* node = get_node(ptr);
       if (key_equal()(const_key_projection()(node->value), key)) {
         return const_iterator(storage, i, node);
       }
-      ptr = node->prev.load();
+      ptr = node->prev.load(std::memory_order_acquire);
     }
     return end();
   }
@@ -204,7 +227,7 @@ class ConcurrentHashtable final {
   /*
    * This operation is always thread-safe.
    */
-  size_t size() const { return m_count.load(); }
+  size_t size() const { return m_count.load(std::memory_order_relaxed); }
 
   /*
    * This operation is always thread-safe.
@@ -289,18 +312,18 @@ class ConcurrentHashtable final {
    */
   value_type* get(const key_type& key) {
     auto hash = hasher()(key);
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     do {
       auto* ptrs = storage->ptrs;
       auto* root_loc = &ptrs[hash % storage->size];
-      auto* root = root_loc->load();
+      auto* root = root_loc->load(std::memory_order_acquire);
       for (auto* node = get_node(root); node;
-           node = get_node(node->prev.load())) {
+           node = get_node(node->prev.load(std::memory_order_acquire))) {
         if (key_equal()(const_key_projection()(node->value), key)) {
           return &node->value;
         }
       }
-      storage = storage->next.load();
+      storage = storage->next.load(std::memory_order_acquire);
     } while (storage);
     return nullptr;
   }
@@ -310,18 +333,18 @@ class ConcurrentHashtable final {
    */
   const value_type* get(const key_type& key) const {
     auto hash = hasher()(key);
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     do {
       auto* ptrs = storage->ptrs;
       auto* root_loc = &ptrs[hash % storage->size];
-      auto* root = root_loc->load();
+      auto* root = root_loc->load(std::memory_order_acquire);
       for (auto* node = get_node(root); node;
-           node = get_node(node->prev.load())) {
+           node = get_node(node->prev.load(std::memory_order_acquire))) {
         if (key_equal()(const_key_projection()(node->value), key)) {
           return &node->value;
         }
       }
-      storage = storage->next.load();
+      storage = storage->next.load(std::memory_order_acquire);
     } while (storage);
     return nullptr;
   }
@@ -333,19 +356,20 @@ class ConcurrentHashtable final {
   insertion_result try_emplace(const key_type& key, Args&&... args) {
     Node* new_node = nullptr;
     auto hash = hasher()(key);
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     while (true) {
       auto* ptrs = storage->ptrs;
       auto* root_loc = &ptrs[hash % storage->size];
-      auto* root = root_loc->load();
+      auto* root = root_loc->load(std::memory_order_acquire);
       for (auto* node = get_node(root); node;
-           node = get_node(node->prev.load())) {
+           node = get_node(node->prev.load(std::memory_order_acquire))) {
         if (key_equal()(const_key_projection()(node->value), key)) {
           return insertion_result(&node->value, new_node);
         }
       }
       if (is_moved_or_locked(root)) {
-        if (auto* next_storage = storage->next.load()) {
+        if (auto* next_storage =
+                storage->next.load(std::memory_order_acquire)) {
           storage = next_storage;
           continue;
         }
@@ -353,16 +377,18 @@ class ConcurrentHashtable final {
         root = get_node(root);
       }
       if (load_factor_exceeded(storage) && reserve(storage->size * 2)) {
-        storage = m_storage.load();
+        storage = m_storage.load(std::memory_order_acquire);
         continue;
       }
       if (!new_node) {
         new_node =
             new Node(ConstRefKeyArgsTag(), key, std::forward<Args>(args)...);
       }
-      new_node->prev = root;
-      if (root_loc->compare_exchange_strong(root, new_node)) {
-        m_count.fetch_add(1);
+      new_node->prev.store(root, std::memory_order_relaxed);
+      if (root_loc->compare_exchange_strong(root, new_node,
+                                            std::memory_order_release,
+                                            std::memory_order_acquire)) {
+        m_count.fetch_add(1, std::memory_order_relaxed);
         return insertion_result(&new_node->value);
       }
       // We lost a race with another insertion
@@ -376,20 +402,21 @@ class ConcurrentHashtable final {
   insertion_result try_emplace(key_type&& key, Args&&... args) {
     Node* new_node = nullptr;
     auto hash = hasher()(key);
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     const key_type* key_ptr = &key;
     while (true) {
       auto* ptrs = storage->ptrs;
       auto* root_loc = &ptrs[hash % storage->size];
-      auto* root = root_loc->load();
+      auto* root = root_loc->load(std::memory_order_acquire);
       for (auto* node = get_node(root); node;
-           node = get_node(node->prev.load())) {
+           node = get_node(node->prev.load(std::memory_order_acquire))) {
         if (key_equal()(const_key_projection()(node->value), *key_ptr)) {
           return insertion_result(&node->value, new_node);
         }
       }
       if (is_moved_or_locked(root)) {
-        if (auto* next_storage = storage->next.load()) {
+        if (auto* next_storage =
+                storage->next.load(std::memory_order_acquire)) {
           storage = next_storage;
           continue;
         }
@@ -397,7 +424,7 @@ class ConcurrentHashtable final {
         root = get_node(root);
       }
       if (load_factor_exceeded(storage) && reserve(storage->size * 2)) {
-        storage = m_storage.load();
+        storage = m_storage.load(std::memory_order_acquire);
         continue;
       }
       if (!new_node) {
@@ -405,9 +432,11 @@ class ConcurrentHashtable final {
                             std::forward<Args>(args)...);
         key_ptr = &const_key_projection()(new_node->value);
       }
-      new_node->prev = root;
-      if (root_loc->compare_exchange_strong(root, new_node)) {
-        m_count.fetch_add(1);
+      new_node->prev.store(root, std::memory_order_relaxed);
+      if (root_loc->compare_exchange_strong(root, new_node,
+                                            std::memory_order_release,
+                                            std::memory_order_acquire)) {
+        m_count.fetch_add(1, std::memory_order_relaxed);
         return insertion_result(&new_node->value);
       }
       // We lost a race with another insertion
@@ -420,20 +449,21 @@ class ConcurrentHashtable final {
   insertion_result try_insert(const value_type& value) {
     Node* new_node = nullptr;
     auto hash = hasher()(const_key_projection()(value));
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     while (true) {
       auto* ptrs = storage->ptrs;
       auto* root_loc = &ptrs[hash % storage->size];
-      auto* root = root_loc->load();
+      auto* root = root_loc->load(std::memory_order_acquire);
       for (auto* node = get_node(root); node;
-           node = get_node(node->prev.load())) {
+           node = get_node(node->prev.load(std::memory_order_acquire))) {
         if (key_equal()(const_key_projection()(node->value),
                         const_key_projection()(value))) {
           return insertion_result(&node->value, new_node);
         }
       }
       if (is_moved_or_locked(root)) {
-        if (auto* next_storage = storage->next.load()) {
+        if (auto* next_storage =
+                storage->next.load(std::memory_order_acquire)) {
           storage = next_storage;
           continue;
         }
@@ -441,15 +471,17 @@ class ConcurrentHashtable final {
         root = get_node(root);
       }
       if (load_factor_exceeded(storage) && reserve(storage->size * 2)) {
-        storage = m_storage.load();
+        storage = m_storage.load(std::memory_order_acquire);
         continue;
       }
       if (!new_node) {
         new_node = new Node(ConstRefValueTag(), value);
       }
-      new_node->prev = root;
-      if (root_loc->compare_exchange_strong(root, new_node)) {
-        m_count.fetch_add(1);
+      new_node->prev.store(root, std::memory_order_relaxed);
+      if (root_loc->compare_exchange_strong(root, new_node,
+                                            std::memory_order_release,
+                                            std::memory_order_acquire)) {
+        m_count.fetch_add(1, std::memory_order_relaxed);
         return insertion_result(&new_node->value);
       }
       // We lost a race with another insertion
@@ -462,14 +494,14 @@ class ConcurrentHashtable final {
   insertion_result try_insert(value_type&& value) {
     Node* new_node = nullptr;
     auto hash = hasher()(const_key_projection()(value));
-    auto* storage = m_storage.load();
+    auto* storage = m_storage.load(std::memory_order_acquire);
     auto* value_ptr = &value;
     while (true) {
       auto* ptrs = storage->ptrs;
       auto* root_loc = &ptrs[hash % storage->size];
-      auto* root = root_loc->load();
+      auto* root = root_loc->load(std::memory_order_acquire);
       for (auto* node = get_node(root); node;
-           node = get_node(node->prev.load())) {
+           node = get_node(node->prev.load(std::memory_order_acquire))) {
         if (key_equal()(const_key_projection()(node->value),
                         const_key_projection()(*value_ptr))) {
           // We lost a race with an equivalent insertion
@@ -477,7 +509,8 @@ class ConcurrentHashtable final {
         }
       }
       if (is_moved_or_locked(root)) {
-        if (auto* next_storage = storage->next.load()) {
+        if (auto* next_storage =
+                storage->next.load(std::memory_order_acquire)) {
           storage = next_storage;
           continue;
         }
@@ -485,7 +518,7 @@ class ConcurrentHashtable final {
         root = get_node(root);
       }
       if (load_factor_exceeded(storage) && reserve(storage->size * 2)) {
-        storage = m_storage.load();
+        storage = m_storage.load(std::memory_order_acquire);
         continue;
       }
       if (!new_node) {
@@ -493,9 +526,11 @@ class ConcurrentHashtable final {
             new Node(RvalueRefValueTag(), std::forward<value_type>(value));
         value_ptr = &new_node->value;
       }
-      new_node->prev = root;
-      if (root_loc->compare_exchange_strong(root, new_node)) {
-        m_count.fetch_add(1);
+      new_node->prev.store(root, std::memory_order_relaxed);
+      if (root_loc->compare_exchange_strong(root, new_node,
+                                            std::memory_order_release,
+                                            std::memory_order_acquire)) {
+        m_count.fetch_add(1, std::memory_order_relaxed);
         return insertion_result(&new_node->value);
       }
       // We lost a race with another insertion
@@ -746,7 +781,8 @@ class ConcurrentHashtable final {
   std::atomic<Erased*> m_erased;
 
   bool load_factor_exceeded(const Storage* storage) const {
-    return m_count.load() > storage->size * LOAD_FACTOR;
+    return m_count.load(std::memory_order_relaxed) >
+           storage->size * LOAD_FACTOR;
   }
 
   // Whether more elements can be found in the next Storage version, or if an
@@ -1219,7 +1255,7 @@ class ConcurrentMap final
     if (ptr == nullptr) {
       throw std::out_of_range("at");
     }
-    std::unique_lock<std::mutex> lock(this->get_lock_by_slot(slot));
+    auto lock = lock_slot(slot);
     return ptr->second;
   }
 
@@ -1253,7 +1289,7 @@ class ConcurrentMap final
     if (!ptr) {
       return default_value;
     }
-    std::unique_lock<std::mutex> lock(this->get_lock_by_slot(slot));
+    auto lock = lock_slot(slot);
     return ptr->second;
   }
 
@@ -1322,7 +1358,7 @@ class ConcurrentMap final
       return;
     }
     auto* constructed_value = insertion_result.incidentally_constructed_value();
-    std::unique_lock<std::mutex> lock(this->get_lock_by_slot(slot));
+    auto lock = lock_slot(slot);
     if (constructed_value) {
       insertion_result.stored_value_ptr->second =
           std::move(constructed_value->second);
@@ -1339,7 +1375,7 @@ class ConcurrentMap final
       return;
     }
     auto* constructed_value = insertion_result.incidentally_constructed_value();
-    std::unique_lock<std::mutex> lock(this->get_lock_by_slot(slot));
+    auto lock = lock_slot(slot);
     if (constructed_value) {
       insertion_result.stored_value_ptr->second =
           std::move(constructed_value->second);
@@ -1398,7 +1434,7 @@ class ConcurrentMap final
     if (!ptr) {
       return false;
     }
-    std::unique_lock<std::mutex> lock(this->get_lock_by_slot(slot));
+    auto lock = lock_slot(slot);
     observer(ptr->first, ptr->second);
     return true;
   }
@@ -1413,7 +1449,7 @@ class ConcurrentMap final
   void update(const Key& key, UpdateFn updater) {
     size_t slot = Hash()(key) % n_slots;
     auto& map = this->get_container(slot);
-    std::unique_lock<std::mutex> lock(this->get_lock_by_slot(slot));
+    auto lock = lock_slot(slot);
     auto insertion_result = map.try_emplace(key);
     auto* ptr = insertion_result.stored_value_ptr;
     updater(ptr->first, ptr->second, !insertion_result.success);
@@ -1424,7 +1460,7 @@ class ConcurrentMap final
   void update(Key&& key, UpdateFn updater) {
     size_t slot = Hash()(key) % n_slots;
     auto& map = this->get_container(slot);
-    std::unique_lock<std::mutex> lock(this->get_lock_by_slot(slot));
+    auto lock = lock_slot(slot);
     auto insertion_result = map.try_emplace(std::forward<Key>(key));
     auto* ptr = insertion_result.stored_value_ptr;
     updater(ptr->first, ptr->second, !insertion_result.success);
@@ -1464,10 +1500,39 @@ class ConcurrentMap final
     return ptr ? &ptr->second : nullptr;
   }
 
+  /*
+   * Number of times a thread had to wait for the lock of the given slot. This
+   * operation is always thread-safe.
+   */
+  size_t contended_lock_acquisitions(size_t slot) const {
+    return m_contention[slot].load(std::memory_order_relaxed);
+  }
+
+  /*
+   * Total number of times a thread had to wait for any slot lock. This
+   * operation is always thread-safe.
+   */
+  size_t contended_lock_acquisitions() const {
+    size_t s = 0;
+    for (size_t slot = 0; slot < n_slots; ++slot) {
+      s += contended_lock_acquisitions(slot);
+    }
+    return s;
+  }
+
  private:
-  std::mutex& get_lock_by_slot(size_t slot) const { return m_locks[slot]; }
+  std::unique_lock<std::mutex> lock_slot(size_t slot) const {
+    std::unique_lock<std::mutex> lock(m_locks[slot], std::try_to_lock);
+    if (!lock.owns_lock()) {
+      auto count = m_contention[slot].fetch_add(1, std::memory_order_relaxed);
+      cc_impl::record_contended_lock(count + 1);
+      lock.lock();
+    }
+    return lock;
+  }
 
   mutable std::mutex m_locks[n_slots];
+  mutable std::atomic<uint32_t> m_contention[n_slots]{};
 };
 
 /**
@@ -1767,6 +1832,186 @@ class InsertOnlyConcurrentMap final
   size_t erase(const Key& key) = delete;
 };
 
+/**
+ * An insert-only concurrent map for pointer keys and small values, stored in a
+ * single open-addressing table of fixed capacity instead of one heap node per
+ * entry.
+ *
+ * A key claims a slot with a single compare-exchange in a bounded linear probe
+ * window; its value is then constructed in place and published with a release
+ * store. Since slots are never vacated, a key whose whole window is occupied
+ * by other keys can never enter it later, so such keys are deterministically
+ * routed to an overflow InsertOnlyConcurrentMap. Size the table with the
+ * expected number of keys to keep the overflow (nearly) empty.
+ *
+ * Values never move once inserted; pointers returned by `get` and `emplace`
+ * remain valid until the map is destroyed. Null keys are not supported.
+ */
+template <typename Key, typename Value>
+class InsertOnlyConcurrentPointerMap final {
+  static_assert(std::is_pointer_v<Key>, "keys must be pointers");
+
+ public:
+  explicit InsertOnlyConcurrentPointerMap(size_t expected_size = 0) {
+    size_t capacity = MIN_CAPACITY;
+    while (capacity < expected_size * 2) {
+      capacity *= 2;
+    }
+    m_capacity_bits = 0;
+    while ((size_t(1) << m_capacity_bits) < capacity) {
+      m_capacity_bits++;
+    }
+    m_slots = std::make_unique<Slot[]>(capacity);
+  }
+
+  InsertOnlyConcurrentPointerMap(const InsertOnlyConcurrentPointerMap&) =
+      delete;
+  InsertOnlyConcurrentPointerMap& operator=(
+      const InsertOnlyConcurrentPointerMap&) = delete;
+
+  ~InsertOnlyConcurrentPointerMap() {
+    for (size_t i = 0; i < capacity(); ++i) {
+      auto& slot = m_slots[i];
+      if (slot.ready.load(std::memory_order_relaxed)) {
+        slot.value()->~Value();
+      }
+    }
+  }
+
+  /*
+   * This operation is always thread-safe.
+   */
+  const Value* get(Key key) const {
+    always_assert(key != nullptr);
+    auto mask = capacity() - 1;
+    auto index = home_index(key);
+    for (size_t probe = 0; probe < PROBE_LIMIT; ++probe) {
+      auto& slot = m_slots[(index + probe) & mask];
+      auto slot_key = slot.key.load(std::memory_order_acquire);
+      if (slot_key == key) {
+        return slot.wait_for_value();
+      }
+      if (slot_key == nullptr) {
+        return nullptr;
+      }
+    }
+    return m_overflow.get(key);
+  }
+
+  /*
+   * This operation is always thread-safe.
+   */
+  const Value& at(Key key) const {
+    auto* ptr = get(key);
+    if (ptr == nullptr) {
+      throw std::out_of_range("at");
+    }
+    return *ptr;
+  }
+
+  /*
+   * This operation is always thread-safe.
+   */
+  size_t count(Key key) const { return get(key) ? 1 : 0; }
+
+  /*
+   * Returns a pair consisting of a pointer on the inserted element (or the
+   * element that prevented the insertion) and a boolean denoting whether the
+   * insertion took place. The value is only constructed if the insertion takes
+   * place. This operation is always thread-safe.
+   */
+  template <typename... Args>
+  std::pair<const Value*, bool> emplace(Key key, Args&&... args) {
+    always_assert(key != nullptr);
+    auto mask = capacity() - 1;
+    auto index = home_index(key);
+    for (size_t probe = 0; probe < PROBE_LIMIT; ++probe) {
+      auto& slot = m_slots[(index + probe) & mask];
+      Key slot_key = slot.key.load(std::memory_order_acquire);
+      if (slot_key == nullptr &&
+          slot.key.compare_exchange_strong(slot_key, key,
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_acquire)) {
+        new (slot.value()) Value(std::forward<Args>(args)...);
+        slot.ready.store(true, std::memory_order_release);
+        m_size.fetch_add(1, std::memory_order_relaxed);
+        return {slot.value(), true};
+      }
+      if (slot_key == key) {
+        return {slot.wait_for_value(), false};
+      }
+    }
+    return m_overflow.emplace(
+        std::piecewise_construct, std::forward_as_tuple(key),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  /*
+   * This operation is always thread-safe.
+   */
+  size_t size() const {
+    return m_size.load(std::memory_order_relaxed) + m_overflow.size();
+  }
+
+  bool empty() const { return size() == 0; }
+
+  size_t capacity() const { return size_t(1) << m_capacity_bits; }
+
+  size_t overflow_size() const { return m_overflow.size(); }
+
+  /*
+   * Calls `fn(key, value)` for all entries. This operation is NOT thread-safe.
+   */
+  template <typename Fn>
+  void for_each(const Fn& fn) const {
+    for (size_t i = 0; i < capacity(); ++i) {
+      auto& slot = m_slots[i];
+      if (slot.ready.load(std::memory_order_relaxed)) {
+        fn(slot.key.load(std::memory_order_relaxed), *slot.value());
+      }
+    }
+    for (auto& [key, value] : m_overflow) {
+      fn(key, value);
+    }
+  }
+
+ private:
+  static constexpr size_t MIN_CAPACITY = 64;
+  static constexpr size_t PROBE_LIMIT = 16;
+
+  struct Slot {
+    std::atomic<Key> key{nullptr};
+    std::atomic<bool> ready{false};
+    alignas(Value) unsigned char storage[sizeof(Value)];
+
+    Value* value() { return reinterpret_cast<Value*>(storage); }
+    const Value* value() const {
+      return reinterpret_cast<const Value*>(storage);
+    }
+
+    // The key is published before the value is constructed; a racing reader
+    // spins until the inserting thread has finished.
+    Value* wait_for_value() const {
+      while (!ready.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      return const_cast<Value*>(value());
+    }
+  };
+
+  // Fibonacci hashing; pointers are aligned, so their low bits carry little
+  // information on their own.
+  size_t home_index(Key key) const {
+    auto bits = (uint64_t)reinterpret_cast<uintptr_t>(key);
+    return (size_t)((bits * 0x9E3779B97F4A7C15ULL) >> (64 - m_capacity_bits));
+  }
+
+  std::unique_ptr<Slot[]> m_slots;
+  size_t m_capacity_bits;
+  std::atomic<size_t> m_size{0};
+  InsertOnlyConcurrentMap<Key, Value> m_overflow;
+};
+
 /**
  * A concurrent container with map semantics that holds atomic values.
  *
@@ -2134,6 +2379,158 @@ class InsertOnlyConcurrentSet final
   size_t erase(const Key& key) = delete;
 };
 
+/**
+ * A concurrent cache for values that are expensive to compute, but can be
+ * recomputed when they are needed again, with a budget on the number of bytes
+ * the cached values may occupy.
+ *
+ * The cache is split into slots, each with its own lock and an equal share of
+ * the budget. When a slot goes over its share, entries get evicted in CLOCK
+ * order: a hand sweeps over the entries, evicting those that weren't looked up
+ * since the hand last passed them, which approximates LRU without any work on
+ * lookups beyond setting a bit. Values are handed out as shared pointers, so
+ * evicting an entry never invalidates a value that is still in use.
+ *
+ * A budget of zero means that the cache is unbounded.
+ */
+template <typename Key,
+          typename Value,
+          typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          size_t n_slots = cc_impl::kDefaultSlots>
+class ConcurrentClockCache final {
+ public:
+  using ValuePtr = std::shared_ptr<Value>;
+  using SizeFn = std::function<size_t(const Value&)>;
+
+  explicit ConcurrentClockCache(
+      size_t byte_budget = 0,
+      SizeFn size_fn = [](const Value&) { return sizeof(Value); })
+      : m_slot_budget((byte_budget + n_slots - 1) / n_slots),
+        m_size_fn(std::move(size_fn)) {}
+
+  ConcurrentClockCache(const ConcurrentClockCache&) = delete;
+  ConcurrentClockCache& operator=(const ConcurrentClockCache&) = delete;
+
+  /*
+   * Returns the cached value, or `nullptr` if there is none. Thread-safe.
+   */
+  ValuePtr get(const Key& key) {
+    auto& slot = get_slot(key);
+    std::lock_guard<std::mutex> lock(slot.mutex);
+    auto it = slot.index.find(key);
+    if (it == slot.index.end()) {
+      m_misses.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    m_hits.fetch_add(1, std::memory_order_relaxed);
+    it->second->referenced = true;
+    return it->second->value;
+  }
+
+  /*
+   * Returns the cached value, or caches and returns `creator(key)`. The
+   * creator runs without holding any lock, so it may use the cache itself. If
+   * another thread cached a value for the same key in the meantime, that one
+   * is returned. Thread-safe.
+   */
+  template <typename Creator>
+  ValuePtr get_or_create(const Key& key, const Creator& creator) {
+    if (auto value = get(key)) {
+      return value;
+    }
+    auto value = std::make_shared<Value>(creator(key));
+    auto bytes = m_size_fn(*value) + sizeof(Entry) + sizeof(Key) +
+                 4 * sizeof(void*);
+    auto& slot = get_slot(key);
+    std::lock_guard<std::mutex> lock(slot.mutex);
+    auto it = slot.index.find(key);
+    if (it != slot.index.end()) {
+      it->second->referenced = true;
+      return it->second->value;
+    }
+    // New entries go right behind the hand, so that they get swept last.
+    auto entry_it = slot.entries.insert(slot.hand, Entry{key, value, bytes});
+    slot.index.emplace(key, entry_it);
+    slot.bytes += bytes;
+    if (m_slot_budget > 0) {
+      evict(slot);
+    }
+    return value;
+  }
+
+  size_t hits() const { return m_hits.load(); }
+  size_t misses() const { return m_misses.load(); }
+  size_t evictions() const { return m_evictions.load(); }
+
+  /*
+   * The number of bytes currently accounted to cached entries. Thread-safe,
+   * but only a snapshot when there are concurrent insertions.
+   */
+  size_t size_in_bytes() const {
+    size_t bytes = 0;
+    for (auto& slot : m_slots) {
+      std::lock_guard<std::mutex> lock(slot.mutex);
+      bytes += slot.bytes;
+    }
+    return bytes;
+  }
+
+  size_t size() const {
+    size_t size = 0;
+    for (auto& slot : m_slots) {
+      std::lock_guard<std::mutex> lock(slot.mutex);
+      size += slot.index.size();
+    }
+    return size;
+  }
+
+ private:
+  struct Entry {
+    Key key;
+    ValuePtr value;
+    size_t bytes;
+    bool referenced{false};
+  };
+
+  using Entries = std::list<Entry>;
+
+  struct Slot {
+    mutable std::mutex mutex;
+    Entries entries;
+    std::unordered_map<Key, typename Entries::iterator, Hash, KeyEqual> index;
+    typename Entries::iterator hand{entries.end()};
+    size_t bytes{0};
+  };
+
+  Slot& get_slot(const Key& key) { return m_slots[Hash()(key) % n_slots]; }
+
+  // Must be called while holding the slot's lock.
+  void evict(Slot& slot) {
+    while (slot.bytes > m_slot_budget && !slot.entries.empty()) {
+      if (slot.hand == slot.entries.end()) {
+        slot.hand = slot.entries.begin();
+      }
+      if (slot.hand->referenced) {
+        slot.hand->referenced = false;
+        ++slot.hand;
+        continue;
+      }
+      slot.bytes -= slot.hand->bytes;
+      slot.index.erase(slot.hand->key);
+      slot.hand = slot.entries.erase(slot.hand);
+      m_evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  const size_t m_slot_budget;
+  const SizeFn m_size_fn;
+  Slot m_slots[n_slots];
+  std::atomic<size_t> m_hits{0};
+  std::atomic<size_t> m_misses{0};
+  std::atomic<size_t> m_evictions{0};
+};
+
 namespace cc_impl {
 
 template <typename Container, size_t n_slots>
@@ -20,6 +20,7 @@
 #include "FrameworkApi.h"
 #include "InlinerConfig.h"
 #include "MethodProfiles.h"
+#include "PersistentAnalysisCache.h"
 #include "ProguardMap.h"
 
 using namespace std::string_literals;
@@ -112,6 +113,30 @@ ConfigFiles::ConfigFiles(const Json::Value& config, const std::string& outdir)
 
 ConfigFiles::ConfigFiles(const Json::Value& config) : ConfigFiles(config, "") {}
 
+analysis_cache::PersistentAnalysisCache* ConfigFiles::get_analysis_cache() {
+  if (!m_analysis_cache_attempted) {
+    m_analysis_cache_attempted = true;
+    std::string dir;
+    m_json.get("analysis_cache_dir", "", dir);
+    if (!dir.empty()) {
+      m_analysis_cache =
+          std::make_unique<analysis_cache::PersistentAnalysisCache>(dir);
+    }
+  }
+  return m_analysis_cache.get();
+}
+
+analysis_cache::PersistentAnalysisCache& ConfigFiles::get_run_analysis_cache() {
+  if (auto* cache = get_analysis_cache()) {
+    return *cache;
+  }
+  if (!m_in_memory_analysis_cache) {
+    m_in_memory_analysis_cache =
+        std::make_unique<analysis_cache::PersistentAnalysisCache>("");
+  }
+  return *m_in_memory_analysis_cache;
+}
+
 ConfigFiles::~ConfigFiles() {
   // Here so that we can use `unique_ptr` to hide full class defs in the header.
 }
@@ -512,6 +537,9 @@ void ConfigFiles::load_inliner_config(inliner::InlinerConfig* inliner_config) {
   jw.get("intermediate_shrinking", false,
          inliner_config->intermediate_shrinking);
   jw.get("multiple_callers", false, inliner_config->multiple_callers);
+  jw.get("cache_shrunk_methods", true, inliner_config->cache_shrunk_methods);
+  jw.get("schedule_by_cost", false, inliner_config->schedule_by_cost);
+  jw.get("inlined_costs_cache_mb", 0, inliner_config->inlined_costs_cache_mb);
   auto& shrinker_config = inliner_config->shrinker;
   jw.get("run_const_prop", false, shrinker_config.run_const_prop);
   jw.get("run_cse", false, shrinker_config.run_cse);
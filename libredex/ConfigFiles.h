@@ -30,6 +30,10 @@ namespace Json {
 class Value;
 } // namespace Json
 
+namespace analysis_cache {
+class PersistentAnalysisCache;
+} // namespace analysis_cache
+
 namespace api {
 class AndroidSDK;
 } // namespace api
@@ -205,6 +209,18 @@ struct ConfigFiles {
 
   const api::AndroidSDK& get_android_sdk_api(int32_t min_sdk_api);
 
+  /**
+   * Get the persistent analysis cache configured via "analysis_cache_dir", or
+   * nullptr if no cache directory was configured.
+   */
+  analysis_cache::PersistentAnalysisCache* get_analysis_cache();
+
+  /**
+   * Get the persistent analysis cache if one was configured, and otherwise a
+   * cache that is only kept in memory for the duration of this run.
+   */
+  analysis_cache::PersistentAnalysisCache& get_run_analysis_cache();
+
   std::unordered_map<DexType*, size_t>& get_cls_interdex_groups() {
     if (m_cls_to_interdex_group.empty()) {
       build_cls_interdex_groups();
@@ -302,6 +318,11 @@ struct ConfigFiles {
   // min_sdk AndroidAPI
   int32_t m_min_sdk_api_level = 0;
   std::unique_ptr<api::AndroidSDK> m_android_min_sdk_api;
+  // Persistent cache for analysis results across runs.
+  bool m_analysis_cache_attempted{false};
+  std::unique_ptr<analysis_cache::PersistentAnalysisCache> m_analysis_cache;
+  std::unique_ptr<analysis_cache::PersistentAnalysisCache>
+      m_in_memory_analysis_cache;
   // interdex class group based on betamap
   // 0 when no interdex grouping.
   size_t m_num_interdex_groups = 0;
@@ -7,6 +7,7 @@
 
 #include "ControlFlow.h"
 
+#include <atomic>
 #include <boost/dynamic_bitset.hpp>
 #include <boost/numeric/conversion/cast.hpp>
 #include <iterator>
@@ -24,6 +25,7 @@
 #include "RedexContext.h"
 #include "Show.h"
 #include "SourceBlocks.h"
+#include "StlUtil.h"
 #include "Trace.h"
 #include "Transform.h"
 
@@ -786,6 +788,18 @@ std::ostream& operator<<(std::ostream& os, const Edge& e) {
 
 bool ControlFlowGraph::DEBUG = false;
 
+namespace {
+std::atomic<bool> s_profile_guided_layout{false};
+} // namespace
+
+void ControlFlowGraph::set_profile_guided_layout(bool enabled) {
+  s_profile_guided_layout = enabled;
+}
+
+bool ControlFlowGraph::profile_guided_layout() {
+  return s_profile_guided_layout;
+}
+
 ControlFlowGraph::ControlFlowGraph(IRList* ir,
                                    reg_t registers_size,
                                    bool editable)
@@ -1020,8 +1034,7 @@ void ControlFlowGraph::add_catch_edges(TryEnds& try_ends,
 BlockId ControlFlowGraph::next_block_id() const {
   // Choose the next largest id. Note that we can't use m_block.size() because
   // we may have deleted some blocks from the cfg.
-  const auto& rbegin = m_blocks.rbegin();
-  return (rbegin == m_blocks.rend()) ? 0 : (rbegin->first + 1);
+  return m_blocks.next_id();
 }
 
 void ControlFlowGraph::remove_unreachable_succ_edges() {
@@ -1084,13 +1097,102 @@ uint32_t ControlFlowGraph::simplify() {
   //        if they are at the head of a non-empty block.
   remove_empty_blocks();
 
-  for (auto& p : m_blocks) {
+  for (const auto& p : m_blocks) {
     p.second->m_entries.chain_consecutive_source_blocks();
   }
 
   return num_insns_removed;
 }
 
+uint32_t ControlFlowGraph::simplify_blocks(std::vector<BlockId> block_ids) {
+  always_assert(editable());
+  std::sort(block_ids.begin(), block_ids.end());
+  block_ids.erase(std::unique(block_ids.begin(), block_ids.end()),
+                  block_ids.end());
+  std20::erase_if(block_ids, [&](auto id) { return !m_blocks.count(id); });
+
+  // The region of the graph reachable from the given blocks. Any path from the
+  // entry to a block outside of the region avoids the region, so the
+  // reachability of the blocks outside of the region is assumed to be
+  // unchanged.
+  boost::dynamic_bitset<> in_region(next_block_id());
+  std::vector<Block*> region;
+  for (auto id : block_ids) {
+    in_region.set(id);
+    region.push_back(m_blocks.at(id));
+  }
+  for (size_t i = 0; i < region.size(); ++i) {
+    for (auto* e : region[i]->succs()) {
+      auto* target = e->target();
+      if (!in_region.test_set(target->id())) {
+        region.push_back(target);
+      }
+    }
+  }
+
+  // Within the region, blocks are reachable from the entry, or from
+  // predecessors outside of the region.
+  boost::dynamic_bitset<> reachable(in_region.size());
+  std::vector<Block*> worklist;
+  for (auto* b : region) {
+    bool root = b == entry_block() ||
+                std::any_of(b->preds().begin(), b->preds().end(), [&](Edge* e) {
+                  return !in_region[e->src()->id()];
+                });
+    if (root) {
+      reachable.set(b->id());
+      worklist.push_back(b);
+    }
+  }
+  while (!worklist.empty()) {
+    auto* b = worklist.back();
+    worklist.pop_back();
+    for (auto* e : b->succs()) {
+      if (!reachable.test_set(e->target()->id())) {
+        worklist.push_back(e->target());
+      }
+    }
+  }
+
+  std::sort(region.begin(), region.end(),
+            [](auto* a, auto* b) { return a->id() < b->id(); });
+  std::vector<Block*> unreachable;
+  for (auto* b : region) {
+    if (!reachable.test(b->id())) {
+      delete_succ_edges(b);
+      unreachable.push_back(b);
+    }
+  }
+  uint32_t num_insns_removed = 0;
+  bool registers_size_possibly_reduced = false;
+  std::vector<std::unique_ptr<DexPosition>> dangling;
+  for (auto* b : unreachable) {
+    remove_unreachable_block(b, &num_insns_removed,
+                             &registers_size_possibly_reduced, &dangling);
+  }
+  if (registers_size_possibly_reduced) {
+    recompute_registers_size();
+  }
+
+  // Only the given blocks may have become empty.
+  for (auto id : block_ids) {
+    auto it = m_blocks.find(id);
+    if (it != m_blocks.end()) {
+      remove_empty_block(it->second, &dangling);
+    }
+  }
+  fix_dangling_parents(std::move(dangling));
+
+  for (auto id : block_ids) {
+    auto it = m_blocks.find(id);
+    if (it != m_blocks.end()) {
+      it->second->m_entries.chain_consecutive_source_blocks();
+    }
+  }
+
+  return num_insns_removed;
+}
+
 // remove blocks with no predecessors
 std::pair<uint32_t, bool> ControlFlowGraph::remove_unreachable_blocks() {
   uint32_t num_insns_removed = 0;
@@ -1098,46 +1200,56 @@ std::pair<uint32_t, bool> ControlFlowGraph::remove_unreachable_blocks() {
   std::vector<std::unique_ptr<DexPosition>> dangling;
   bool registers_size_possibly_reduced = false;
   for (auto it = m_blocks.begin(); it != m_blocks.end();) {
-    Block* b = it->second;
-    const auto& preds = b->preds();
-    if (preds.empty() && b != entry_block()) {
-      if (b == exit_block()) {
-        set_exit_block(nullptr);
-      }
-      for (auto& mie : *b) {
-        if (mie.type == MFLOW_POSITION) {
-          dangling.push_back(std::move(mie.pos));
-        } else if (mie.type == MFLOW_OPCODE) {
-          auto insn = mie.insn;
-          if (insn->has_dest()) {
-            // +1 because registers start at zero
-            auto size_required = insn->dest() + insn->dest_is_wide() + 1;
-            if (size_required >= m_registers_size) {
-              // We're deleting an instruction that may have been the max
-              // register of the entire function.
-              registers_size_possibly_reduced = true;
-            }
-          }
-        }
-      }
-      num_insns_removed += b->num_opcodes();
-      always_assert(b->succs().empty());
-      always_assert(b->preds().empty());
-      // Deletion of a block deletes MIEs, but MIEs do not delete instructions.
-      // Gotta do this manually for now.
-      b->free();
-      delete b;
-      it = m_blocks.erase(it);
-    } else {
-      ++it;
-    }
+    // Advance first, as the block may get erased.
+    Block* b = (it++)->second;
+    remove_unreachable_block(b, &num_insns_removed,
+                             &registers_size_possibly_reduced, &dangling);
   }
-
   fix_dangling_parents(std::move(dangling));
 
   return std::make_pair(num_insns_removed, registers_size_possibly_reduced);
 }
 
+void ControlFlowGraph::remove_unreachable_block(
+    Block* b,
+    uint32_t* num_insns_removed,
+    bool* registers_size_possibly_reduced,
+    std::vector<std::unique_ptr<DexPosition>>* dangling) {
+  const auto& preds = b->preds();
+  if (!preds.empty() || b == entry_block()) {
+    return;
+  }
+  if (b == exit_block()) {
+    set_exit_block(nullptr);
+  }
+  for (auto& mie : *b) {
+    if (mie.type == MFLOW_POSITION) {
+      dangling->push_back(std::move(mie.pos));
+    } else if (mie.type == MFLOW_OPCODE) {
+      auto insn = mie.insn;
+      if (insn->has_dest()) {
+        // +1 because registers start at zero
+        auto size_required = insn->dest() + insn->dest_is_wide() + 1;
+        if (size_required >= m_registers_size) {
+          // We're deleting an instruction that may have been the max
+          // register of the entire function.
+          *registers_size_possibly_reduced = true;
+        }
+      }
+    }
+  }
+  *num_insns_removed += b->num_opcodes();
+  always_assert(b->succs().empty());
+  always_assert(b->preds().empty());
+  // Deletion of a block deletes MIEs, but MIEs do not delete instructions.
+  // Gotta do this manually for now.
+  auto id = b->id();
+  b->free();
+  delete b;
+  m_blocks.erase(id);
+  structure_changed();
+}
+
 void ControlFlowGraph::fix_dangling_parents(
     std::vector<std::unique_ptr<DexPosition>> dangling) {
   if (dangling.empty()) {
@@ -1190,115 +1302,119 @@ void ControlFlowGraph::remove_empty_blocks() {
   always_assert(editable());
   std::vector<std::unique_ptr<DexPosition>> dangling;
   for (auto it = m_blocks.begin(); it != m_blocks.end();) {
-    Block* b = it->second;
-    if (b->get_first_insn() != b->end() || b == exit_block()) {
-      ++it;
-      continue;
-    }
+    // Advance first, as the block may get erased.
+    Block* b = (it++)->second;
+    remove_empty_block(b, &dangling);
+  }
+  fix_dangling_parents(std::move(dangling));
+}
 
-    const auto& succs = get_succ_edges_if(
-        b, [](const Edge* e) { return e->type() != EDGE_GHOST; });
-    if (!succs.empty()) {
-      always_assert_log(succs.size() == 1,
-                        "too many successors for empty block %zu:\n%s",
-                        it->first, SHOW(*this));
-      const auto& succ_edge = succs[0];
-      Block* succ = succ_edge->target();
+void ControlFlowGraph::remove_empty_block(
+    Block* b, std::vector<std::unique_ptr<DexPosition>>* dangling) {
+  if (b->get_first_insn() != b->end() || b == exit_block()) {
+    return;
+  }
 
-      if (b == succ) { // `b` follows itself: an infinite loop
-        ++it;
-        continue;
-      }
+  const auto& succs = get_succ_edges_if(
+      b, [](const Edge* e) { return e->type() != EDGE_GHOST; });
+  if (!succs.empty()) {
+    always_assert_log(succs.size() == 1,
+                      "too many successors for empty block %zu:\n%s",
+                      b->id(), SHOW(*this));
+    const auto& succ_edge = succs[0];
+    Block* succ = succ_edge->target();
 
-      // Does it have source blocks, and the successor does have multiple
-      // predecessors?
-      bool move_source_blocks{false};
-      if (source_blocks::has_source_blocks(b)) {
-        // The entry block has a virtual in-edge, don't merge on a single
-        // back-edge.
-        if (succ->preds().size() == 1 && succ != m_entry_block) {
-          // Good case: just move the source blocks forward.
-          move_source_blocks = true;
-        } else if (g_redex->instrument_mode) {
-          // If we are instrumenting, it is necessary to keep the block for its
-          // source-blocks.
-          ++it;
-          continue;
-        }
+    if (b == succ) { // `b` follows itself: an infinite loop
+      return;
+    }
+
+    // Does it have source blocks, and the successor does have multiple
+    // predecessors?
+    bool move_source_blocks{false};
+    if (source_blocks::has_source_blocks(b)) {
+      // The entry block has a virtual in-edge, don't merge on a single
+      // back-edge.
+      if (succ->preds().size() == 1 && succ != m_entry_block) {
+        // Good case: just move the source blocks forward.
+        move_source_blocks = true;
+      } else if (g_redex->instrument_mode) {
+        // If we are instrumenting, it is necessary to keep the block for its
+        // source-blocks.
+        return;
       }
+    }
 
-      // b is empty and removable. Reorganize the edges so we can remove it
+    // b is empty and removable. Reorganize the edges so we can remove it
 
-      // Remove the one goto edge from b to succ
-      delete_edges_between(b, succ);
+    // Remove the one goto edge from b to succ
+    delete_edges_between(b, succ);
 
-      // If b was a predecessor of the exit block (for example, part of an
-      // infinite loop) we need to transfer that info to `succ` because `b` will
-      // be made unreachable and deleted by simplify
-      auto ghost = get_succ_edge_of_type(b, EDGE_GHOST);
-      if (ghost != nullptr) {
-        set_edge_source(ghost, succ);
-      }
+    // If b was a predecessor of the exit block (for example, part of an
+    // infinite loop) we need to transfer that info to `succ` because `b` will
+    // be made unreachable and deleted by simplify
+    auto ghost = get_succ_edge_of_type(b, EDGE_GHOST);
+    if (ghost != nullptr) {
+      set_edge_source(ghost, succ);
+    }
 
-      // Redirect from b's predecessors to b's successor (skipping b). We
-      // can't move edges around while we iterate through the edge list
-      // though.
-      std::vector<Edge*> need_redirect(b->m_preds.begin(), b->m_preds.end());
-      for (Edge* pred_edge : need_redirect) {
-        set_edge_target(pred_edge, succ);
-      }
+    // Redirect from b's predecessors to b's successor (skipping b). We
+    // can't move edges around while we iterate through the edge list
+    // though.
+    std::vector<Edge*> need_redirect(b->m_preds.begin(), b->m_preds.end());
+    for (Edge* pred_edge : need_redirect) {
+      set_edge_target(pred_edge, succ);
+    }
 
-      if (b == entry_block()) {
-        m_entry_block = succ;
-      }
+    if (b == entry_block()) {
+      set_entry_block(succ);
+    }
 
-      // Move positions if succ doesn't have any
-      auto first_it = succ->get_first_insn_before_position();
-      if (first_it != succ->end()) {
-        always_assert(
-            !opcode::is_a_move_result_pseudo(first_it->insn->opcode()));
-        for (auto& mie : *b) {
-          if (mie.type == MFLOW_POSITION) {
-            succ->m_entries.insert_before(first_it, std::move(mie.pos));
-          }
+    // Move positions if succ doesn't have any
+    auto first_it = succ->get_first_insn_before_position();
+    if (first_it != succ->end()) {
+      always_assert(
+          !opcode::is_a_move_result_pseudo(first_it->insn->opcode()));
+      for (auto& mie : *b) {
+        if (mie.type == MFLOW_POSITION) {
+          succ->m_entries.insert_before(first_it, std::move(mie.pos));
         }
       }
+    }
 
-      // Move all source blocks.
-      // Note: the order of source blocks does not really matter.
-      if (move_source_blocks) {
-        bool first = true;
-        for (auto& mie : *b) {
-          if (mie.type == MFLOW_SOURCE_BLOCK) {
-            if (first) {
-              succ->m_entries.insert_before(succ->begin(),
-                                            std::move(mie.src_block));
-            } else {
-              succ->m_entries.insert_after(succ->begin(),
-                                           std::move(mie.src_block));
-            }
-            first = false;
+    // Move all source blocks.
+    // Note: the order of source blocks does not really matter.
+    if (move_source_blocks) {
+      bool first = true;
+      for (auto& mie : *b) {
+        if (mie.type == MFLOW_SOURCE_BLOCK) {
+          if (first) {
+            succ->m_entries.insert_before(succ->begin(),
+                                          std::move(mie.src_block));
+          } else {
+            succ->m_entries.insert_after(succ->begin(),
+                                         std::move(mie.src_block));
           }
+          first = false;
         }
       }
     }
-    if (b == m_entry_block) {
-      // Don't delete the entry block. If it was empty and had a successor,
-      // we'd have replaced it just above.
-      ++it;
-      continue;
-    }
+  }
+  if (b == m_entry_block) {
+    // Don't delete the entry block. If it was empty and had a successor,
+    // we'd have replaced it just above.
+    return;
+  }
 
-    for (auto& mie : *b) {
-      if (mie.type == MFLOW_POSITION) {
-        dangling.push_back(std::move(mie.pos));
-      }
+  for (auto& mie : *b) {
+    if (mie.type == MFLOW_POSITION) {
+      dangling->push_back(std::move(mie.pos));
     }
-    b->free();
-    delete b;
-    it = m_blocks.erase(it);
   }
-  fix_dangling_parents(std::move(dangling));
+  auto id = b->id();
+  b->free();
+  delete b;
+  m_blocks.erase(id);
+  structure_changed();
 }
 
 void ControlFlowGraph::no_unreferenced_edges() const {
@@ -1780,7 +1896,7 @@ void ControlFlowGraph::deep_copy(ControlFlowGraph* new_cfg) const {
   cloner.fix_parent_positions();
 
   // patch the edge pointers in the blocks to their new cfg counterparts
-  for (auto& entry : new_cfg->m_blocks) {
+  for (const auto& entry : new_cfg->m_blocks) {
     Block* b = entry.second;
     for (Edge*& e : b->m_preds) {
       e = old_edge_to_new.at(e);
@@ -1865,8 +1981,14 @@ std::vector<Block*> ControlFlowGraph::order(
 
   build_chains(&chains, &block_to_chain);
   auto wto = build_wto(block_to_chain);
-  auto result = custom_strategy ? custom_strategy->order(*this, std::move(wto))
-                                : wto_chains(std::move(wto));
+  std::vector<Block*> result;
+  if (custom_strategy) {
+    result = custom_strategy->order(*this, std::move(wto));
+  } else if (s_profile_guided_layout.load(std::memory_order_relaxed)) {
+    result = profile_guided_chains(std::move(wto));
+  } else {
+    result = wto_chains(std::move(wto));
+  }
 
   always_assert_log(result.size() == m_blocks.size(),
                     "result has %zu blocks, m_blocks has %zu", result.size(),
@@ -2039,6 +2161,129 @@ std::vector<Block*> ControlFlowGraph::wto_chains(
   return main_order;
 }
 
+// Orders the chains in the spirit of Pettis-Hansen: chains connected by a hot
+// goto edge are placed after each other, hottest edges first, so that the
+// edge becomes a fallthrough. Chains that never executed, and catch handlers
+// without a profile, go to the end of the method. Everything else keeps its
+// position in the WTO, which is also the result for methods without profile.
+std::vector<Block*> ControlFlowGraph::profile_guided_chains(
+    sparta::WeakTopologicalOrdering<BlockChain*> wto) {
+  std::vector<BlockChain*> chains;
+  wto.visit_depth_first([&chains](BlockChain* c) { chains.push_back(c); });
+
+  std::vector<Block*> main_order;
+  main_order.reserve(this->num_blocks());
+  auto append = [&main_order](const BlockChain* c) {
+    main_order.insert(main_order.end(), c->begin(), c->end());
+  };
+
+  std::unordered_map<const Block*, float> weights;
+  for (const auto* c : chains) {
+    for (auto* b : *c) {
+      auto val =
+          source_blocks::get_max_val(source_blocks::get_first_source_block(b));
+      if (val) {
+        weights.emplace(b, *val);
+      }
+    }
+  }
+  if (weights.empty()) {
+    for (const auto* c : chains) {
+      append(c);
+    }
+    return main_order;
+  }
+
+  constexpr size_t NONE = std::numeric_limits<size_t>::max();
+  std::unordered_map<const Block*, size_t> head_to_index;
+  for (size_t i = 0; i < chains.size(); ++i) {
+    head_to_index.emplace(chains[i]->front(), i);
+  }
+
+  // Candidate fallthroughs, i.e. gotos from the end of one chain to the start
+  // of another, weighted by the colder of the two blocks.
+  struct Candidate {
+    float weight;
+    size_t from;
+    size_t to;
+  };
+  std::vector<Candidate> candidates;
+  for (size_t i = 0; i < chains.size(); ++i) {
+    auto* last = chains[i]->back();
+    auto* goto_edge = get_succ_edge_of_type(last, EDGE_GOTO);
+    if (goto_edge == nullptr) {
+      continue;
+    }
+    auto it = head_to_index.find(goto_edge->target());
+    if (it == head_to_index.end() || it->second == i ||
+        goto_edge->target() == m_entry_block) {
+      continue;
+    }
+    auto from_it = weights.find(last);
+    auto to_it = weights.find(goto_edge->target());
+    if (from_it == weights.end() || to_it == weights.end()) {
+      continue;
+    }
+    float weight = std::min(from_it->second, to_it->second);
+    if (weight > 0) {
+      candidates.push_back({weight, i, it->second});
+    }
+  }
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const Candidate& a, const Candidate& b) {
+                     return a.weight > b.weight;
+                   });
+  std::vector<size_t> next(chains.size(), NONE);
+  std::vector<size_t> prev(chains.size(), NONE);
+  for (const auto& c : candidates) {
+    if (next[c.from] != NONE || prev[c.to] != NONE) {
+      continue;
+    }
+    // Do not close a cycle.
+    size_t last = c.to;
+    while (next[last] != NONE) {
+      last = next[last];
+    }
+    if (last == c.from) {
+      continue;
+    }
+    next[c.from] = c.to;
+    prev[c.to] = c.from;
+  }
+
+  auto is_cold = [&](size_t i) {
+    for (size_t j = i; j != NONE; j = next[j]) {
+      for (auto* b : *chains[j]) {
+        auto it = weights.find(b);
+        if (it == weights.end() ? !b->is_catch() : it->second > 0) {
+          return false;
+        }
+      }
+    }
+    return true;
+  };
+  std::vector<size_t> cold;
+  for (size_t i = 0; i < chains.size(); ++i) {
+    if (prev[i] != NONE) {
+      continue;
+    }
+    // The entry block always comes first.
+    if (i != 0 && is_cold(i)) {
+      cold.push_back(i);
+      continue;
+    }
+    for (size_t j = i; j != NONE; j = next[j]) {
+      append(chains[j]);
+    }
+  }
+  for (auto i : cold) {
+    for (size_t j = i; j != NONE; j = next[j]) {
+      append(chains[j]);
+    }
+  }
+  return main_order;
+}
+
 // Add an MFLOW_TARGET at the end of each edge.
 // Insert GOTOs where necessary.
 void ControlFlowGraph::insert_branches_and_targets(
@@ -2295,6 +2540,7 @@ Block* ControlFlowGraph::create_block() {
   size_t id = next_block_id();
   Block* b = new Block(this, id);
   m_blocks.emplace(id, b);
+  structure_changed();
   return b;
 }
 
@@ -2466,9 +2712,9 @@ void ControlFlowGraph::calculate_exit_block() {
   std::vector<Block*> exit_blocks = collectExitBlocks(entry_block());
 
   if (exit_blocks.size() == 1) {
-    m_exit_block = exit_blocks[0];
+    set_exit_block(exit_blocks[0]);
   } else {
-    m_exit_block = create_block();
+    set_exit_block(create_block());
     for (Block* b : exit_blocks) {
       add_edge(b, m_exit_block, EDGE_GHOST);
     }
@@ -2480,7 +2726,7 @@ void ControlFlowGraph::reset_exit_block() {
     return;
   }
   if (get_pred_edge_of_type(m_exit_block, EDGE_GHOST) == nullptr) {
-    m_exit_block = nullptr;
+    set_exit_block(nullptr);
     return;
   }
   // If we get here, we have a "ghost" exit block, that was created to represent
@@ -2560,6 +2806,9 @@ void ControlFlowGraph::clear() {
   m_exit_block = nullptr;
 
   m_editable = true;
+
+  structure_changed();
+  m_cached_analyses.clear();
 }
 
 namespace {
@@ -2747,6 +2996,7 @@ void ControlFlowGraph::merge_blocks(Block* pred, Block* succ) {
   delete_pred_edges(succ);
   delete_succ_edges(succ);
   m_blocks.erase(succ->id());
+  structure_changed();
   delete succ;
 }
 
@@ -3102,6 +3352,7 @@ uint32_t ControlFlowGraph::remove_blocks(const std::vector<Block*>& blocks) {
 
     auto id = block->id();
     auto num_removed = m_blocks.erase(id);
+    structure_changed();
     always_assert_log(num_removed == 1,
                       "Block %zu wasn't in CFG. Attempted double delete?", id);
     block->m_entries.clear_and_dispose();
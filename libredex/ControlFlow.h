@@ -7,7 +7,13 @@
 
 #pragma once
 
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <memory>
 #include <type_traits>
+#include <typeindex>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -474,6 +480,165 @@ struct DominatorInfo {
 
 using BlockChain = std::vector<Block*>;
 
+/*
+ * The blocks of a graph, stored contiguously and indexed by their ids. Ids are
+ * handed out in increasing order, so the ids of removed blocks leave holes,
+ * which iteration skips. Iteration is in increasing id order, as it was with
+ * the std::map that this replaces.
+ *
+ * Iterators refer to an index rather than into the vector, so, like map
+ * iterators, they remain valid when blocks are added or other blocks removed.
+ */
+class BlockMap {
+  static constexpr size_t kEnd = std::numeric_limits<size_t>::max();
+
+ public:
+  class const_iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = std::pair<BlockId, Block*>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = value_type;
+
+    // Makes `it->first` and `it->second` work on a materialized pair.
+    struct Arrow {
+      value_type value;
+      const value_type* operator->() const { return &value; }
+    };
+
+    const_iterator() = default;
+
+    value_type operator*() const {
+      return {m_index, m_map->m_blocks[m_index]};
+    }
+
+    Arrow operator->() const { return Arrow{**this}; }
+
+    const_iterator& operator++() {
+      m_index = m_map->next_index(m_index + 1);
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      auto result = *this;
+      ++(*this);
+      return result;
+    }
+
+    const_iterator& operator--() {
+      m_index = m_map->prev_index(m_index);
+      return *this;
+    }
+
+    const_iterator operator--(int) {
+      auto result = *this;
+      --(*this);
+      return result;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return m_map == other.m_map && m_index == other.m_index;
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class BlockMap;
+    const_iterator(const BlockMap* map, size_t index)
+        : m_map(map), m_index(index) {}
+
+    const BlockMap* m_map{nullptr};
+    size_t m_index{kEnd};
+  };
+  using iterator = const_iterator;
+
+  const_iterator begin() const { return const_iterator(this, next_index(0)); }
+  const_iterator end() const { return const_iterator(this, kEnd); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  void clear() {
+    m_blocks.clear();
+    m_size = 0;
+  }
+
+  void reserve(size_t n) { m_blocks.reserve(n); }
+
+  size_t count(BlockId id) const {
+    return id < m_blocks.size() && m_blocks[id] != nullptr;
+  }
+
+  const_iterator find(BlockId id) const {
+    return count(id) ? const_iterator(this, id) : end();
+  }
+
+  Block* at(BlockId id) const {
+    always_assert_log(count(id), "No block with id %zu", id);
+    return m_blocks[id];
+  }
+
+  void emplace(BlockId id, Block* block) {
+    if (id >= m_blocks.size()) {
+      m_blocks.resize(id + 1, nullptr);
+    }
+    always_assert_log(m_blocks[id] == nullptr, "Duplicate block id %zu", id);
+    m_blocks[id] = block;
+    ++m_size;
+  }
+
+  size_t erase(BlockId id) {
+    if (!count(id)) {
+      return 0;
+    }
+    m_blocks[id] = nullptr;
+    --m_size;
+    // Keep the last entry occupied, so that the next id is the size.
+    while (!m_blocks.empty() && m_blocks.back() == nullptr) {
+      m_blocks.pop_back();
+    }
+    return 1;
+  }
+
+  const_iterator erase(const_iterator it) {
+    auto next = std::next(it);
+    erase(it.m_index);
+    return next;
+  }
+
+  // The block with the highest id, if any.
+  Block* last() const { return m_blocks.empty() ? nullptr : m_blocks.back(); }
+
+  // One more than the highest id in use.
+  BlockId next_id() const { return m_blocks.size(); }
+
+ private:
+  size_t next_index(size_t index) const {
+    while (index < m_blocks.size() && m_blocks[index] == nullptr) {
+      ++index;
+    }
+    return index < m_blocks.size() ? index : kEnd;
+  }
+
+  size_t prev_index(size_t index) const {
+    index = std::min(index, m_blocks.size());
+    while (index > 0) {
+      if (m_blocks[--index] != nullptr) {
+        return index;
+      }
+    }
+    not_reached_log("Decremented the begin iterator");
+  }
+
+  std::vector<Block*> m_blocks;
+  size_t m_size{0};
+};
+
 struct LinearizationStrategy {
   virtual ~LinearizationStrategy() {}
   virtual std::vector<Block*> order(
@@ -503,6 +668,12 @@ class ControlFlowGraph {
   IRList* linearize(
       const std::unique_ptr<LinearizationStrategy>& custom_strategy = nullptr);
 
+  // When set, linearizations without a custom strategy order the blocks by
+  // their source block profile, see `profile_guided_chains`. This applies to
+  // every later linearization, including the final one before output.
+  static void set_profile_guided_layout(bool enabled);
+  static bool profile_guided_layout();
+
   // Return the blocks of this CFG in an arbitrary order.
   //
   // NOTE: this function copies pointers to blocks from m_blocks.
@@ -534,8 +705,14 @@ class ControlFlowGraph {
 
   Block* entry_block() const { return m_entry_block; }
   Block* exit_block() const { return m_exit_block; }
-  void set_entry_block(Block* b) { m_entry_block = b; }
-  void set_exit_block(Block* b) { m_exit_block = b; }
+  void set_entry_block(Block* b) {
+    m_entry_block = b;
+    structure_changed();
+  }
+  void set_exit_block(Block* b) {
+    m_exit_block = b;
+    structure_changed();
+  }
   void reset_exit_block();
 
   /*
@@ -567,6 +744,7 @@ class ControlFlowGraph {
   }
 
   void add_edge(Edge* e) {
+    structure_changed();
     m_edges.insert(e);
     e->src()->m_succs.emplace_back(e);
     e->target()->m_preds.emplace_back(e);
@@ -906,6 +1084,34 @@ class ControlFlowGraph {
   size_t num_blocks() const { return m_blocks.size(); }
   size_t num_edges() const { return m_edges.size(); }
 
+  /*
+   * Changes whenever blocks or edges are added, removed or redirected, or the
+   * entry or exit block is set. Edits of the instructions within blocks don't
+   * change it.
+   */
+  uint64_t structure_generation() const { return m_structure_generation; }
+
+  /*
+   * Returns the analysis of type T of this graph, e.g. its dominators. It is
+   * computed by `compute`, which returns a std::unique_ptr<T>, unless it was
+   * already computed since the last structural change. The returned reference
+   * must not be used after the structure of the graph changes. Unlike other
+   * const methods, this must not be called concurrently on the same graph.
+   *
+   * See dominators::get_dominators and loop_impl::get_loop_info.
+   */
+  template <typename T, typename Compute>
+  const T& get_cached_analysis(Compute&& compute) const {
+    auto& cached = m_cached_analyses[std::type_index(typeid(T))];
+    if (!cached.analysis ||
+        cached.structure_generation != m_structure_generation) {
+      std::unique_ptr<T> analysis = compute();
+      cached.analysis = std::move(analysis);
+      cached.structure_generation = m_structure_generation;
+    }
+    return *static_cast<const T*>(cached.analysis.get());
+  }
+
   /*
    * Traverse the graph, starting from the entry node. Return a bitset with IDs
    * of reachable blocks having 1 and IDs of unreachable blocks (or unused IDs)
@@ -916,10 +1122,7 @@ class ControlFlowGraph {
   cfg::Block* get_block(BlockId id) const { return m_blocks.at(id); }
 
   // Returns the block with the highest block id.
-  cfg::Block* get_last_block() const {
-    const auto& rbegin = m_blocks.rbegin();
-    return rbegin == m_blocks.rend() ? nullptr : rbegin->second;
-  }
+  cfg::Block* get_last_block() const { return m_blocks.last(); }
 
   // remove blocks with no predecessors
   // returns pair of 1) the number of instructions removed, and 2) whether an
@@ -932,6 +1135,15 @@ class ControlFlowGraph {
   // returns the number of instructions removed
   uint32_t simplify();
 
+  // Like simplify, but only looks at the given blocks, and at the blocks
+  // reachable from them, instead of the whole graph: unreachable blocks are
+  // only looked for in that region, and empty blocks and source block chains
+  // only among the given blocks. If the rest of the graph was already
+  // simplified, this removes the same unreachable blocks as simplify. Ids of
+  // blocks that don't exist anymore are ignored.
+  // returns the number of instructions removed
+  uint32_t simplify_blocks(std::vector<BlockId> block_ids);
+
   // SIGABORT if the internal state of the CFG is invalid
   void sanity_check() const;
 
@@ -1061,7 +1273,7 @@ class ControlFlowGraph {
                          std::vector<std::pair<Block*, MethodItemEntry*>>>;
   using TryEnds = std::vector<std::pair<TryEntry*, Block*>>;
   using TryCatches = std::unordered_map<CatchEntry*, Block*>;
-  using Blocks = std::map<BlockId, Block*>;
+  using Blocks = BlockMap;
   friend class InstructionIteratorImpl<false>;
   friend class InstructionIteratorImpl<true>;
   friend class CFGInliner;
@@ -1100,6 +1312,8 @@ class ControlFlowGraph {
       const std::unordered_map<Block*, BlockChain*>& block_to_chain);
   std::vector<Block*> wto_chains(
       sparta::WeakTopologicalOrdering<BlockChain*> wto);
+  std::vector<Block*> profile_guided_chains(
+      sparta::WeakTopologicalOrdering<BlockChain*> wto);
 
   // Materialize target instructions and gotos corresponding to control-flow
   // edges. Used while turning back into a linear representation.
@@ -1132,6 +1346,17 @@ class ControlFlowGraph {
   // remove blocks with no entries
   void remove_empty_blocks();
 
+  // Helpers of remove_unreachable_blocks and remove_empty_blocks, which remove
+  // the given block, if applicable. Positions of deleted blocks are added to
+  // `dangling`.
+  void remove_unreachable_block(
+      Block* b,
+      uint32_t* num_insns_removed,
+      bool* registers_size_possibly_reduced,
+      std::vector<std::unique_ptr<DexPosition>>* dangling);
+  void remove_empty_block(Block* b,
+                          std::vector<std::unique_ptr<DexPosition>>* dangling);
+
   // Re-insert any parent pointer that got deleted. This is a useful
   // method to invoke just after removing positions to avoid leaving
   // behind dangling parents.
@@ -1171,6 +1396,7 @@ class ControlFlowGraph {
                          Block* target,
                          EdgePredicate predicate,
                          bool cleanup = true) {
+    structure_changed();
     auto& forward_edges = source->m_succs;
     EdgeSet to_remove;
     forward_edges.erase(
@@ -1204,6 +1430,7 @@ class ControlFlowGraph {
                               const ForwardIt& end,
                               EdgePredicate predicate,
                               bool cleanup = true) {
+    structure_changed();
     std::unordered_set<Block*> source_blocks;
     EdgeSet to_remove;
     for (auto it = begin; it != end; it++) {
@@ -1242,6 +1469,7 @@ class ControlFlowGraph {
                               const ForwardIt& end,
                               EdgePredicate predicate,
                               bool cleanup = true) {
+    structure_changed();
     std::unordered_set<Block*> target_blocks;
     std::unordered_set<Edge*> to_remove;
     for (auto it = begin; it != end; it++) {
@@ -1304,6 +1532,13 @@ class ControlFlowGraph {
 
   std::vector<Block*> blocks_post_helper(bool reverse) const;
 
+  void structure_changed() { ++m_structure_generation; }
+
+  struct CachedAnalysis {
+    uint64_t structure_generation;
+    std::shared_ptr<const void> analysis;
+  };
+
   // The memory of all blocks and edges in this graph are owned here
   Blocks m_blocks;
   EdgeSet m_edges;
@@ -1316,6 +1551,9 @@ class ControlFlowGraph {
   bool m_owns_insns{false};
   bool m_owns_removed_insns{true};
   std::vector<IRInstruction*> m_removed_insns;
+  uint64_t m_structure_generation{0};
+  mutable std::unordered_map<std::type_index, CachedAnalysis>
+      m_cached_analyses;
 };
 
 // A static-method-only API for use with the monotonic fixpoint iterator.
@@ -72,7 +72,7 @@ class StringSplitterIterator {
   StringSplitterIterator end() {
     return StringSplitterIterator(
         m_str, m_delim,
-        std::string_view(m_remaining.data() + m_remaining.size()), false);
+        std::string_view(m_remaining.data() + m_remaining.size(), 0), false);
   }
 
  private:
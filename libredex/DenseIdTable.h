@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "Debug.h"
+
+/*
+ * Hands out dense 32-bit ids for objects, and maps them back to the objects.
+ *
+ * The id of an object is stored in a slot inside the object itself, and is
+ * assigned on first request, so only objects that are actually looked up by id
+ * consume one. Id 0 is never handed out and denotes "no id".
+ *
+ * Both assignment and lookup are thread-safe and lock-free. The id-to-object
+ * table grows in chunks that are never moved, so lookups are two loads.
+ */
+template <typename T>
+class DenseIdTable {
+ public:
+  DenseIdTable() : m_chunks(new std::atomic<Chunk*>[kNumChunks]) {
+    for (size_t i = 0; i < kNumChunks; ++i) {
+      m_chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  DenseIdTable(const DenseIdTable&) = delete;
+  DenseIdTable& operator=(const DenseIdTable&) = delete;
+
+  ~DenseIdTable() {
+    for (size_t i = 0; i < kNumChunks; ++i) {
+      delete m_chunks[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  // Returns the id stored in `slot`, which must be owned by `obj`, assigning
+  // one first if needed.
+  uint32_t get_or_assign(T* obj, std::atomic<uint32_t>* slot) {
+    auto id = slot->load(std::memory_order_acquire);
+    if (id != 0) {
+      return id;
+    }
+    auto new_id = m_next.fetch_add(1, std::memory_order_relaxed);
+    always_assert_log(new_id != 0, "Ran out of dense ids");
+    // Publish the object before the id, so that everyone who can see the id
+    // can also look it up.
+    get_entry(new_id).store(obj, std::memory_order_release);
+    if (slot->compare_exchange_strong(id, new_id, std::memory_order_acq_rel)) {
+      return new_id;
+    }
+    // Some other thread won. Leave a hole.
+    get_entry(new_id).store(nullptr, std::memory_order_relaxed);
+    return id;
+  }
+
+  // Returns the object with the given id, or nullptr if there is none.
+  T* get(uint32_t id) const {
+    auto* chunk = m_chunks[id >> kChunkBits].load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+      return nullptr;
+    }
+    return chunk->entries[id & (kChunkSize - 1)].load(
+        std::memory_order_acquire);
+  }
+
+  // An upper bound for all ids handed out so far.
+  uint32_t end() const { return m_next.load(std::memory_order_relaxed); }
+
+ private:
+  static constexpr uint32_t kChunkBits = 16;
+  static constexpr size_t kChunkSize = size_t(1) << kChunkBits;
+  static constexpr size_t kNumChunks = size_t(1) << (32 - kChunkBits);
+
+  struct Chunk {
+    std::atomic<T*> entries[kChunkSize];
+    Chunk() {
+      for (auto& entry : entries) {
+        entry.store(nullptr, std::memory_order_relaxed);
+      }
+    }
+  };
+
+  std::atomic<T*>& get_entry(uint32_t id) {
+    auto& chunk_ptr = m_chunks[id >> kChunkBits];
+    auto* chunk = chunk_ptr.load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+      auto new_chunk = std::make_unique<Chunk>();
+      if (chunk_ptr.compare_exchange_strong(chunk, new_chunk.get(),
+                                            std::memory_order_acq_rel)) {
+        chunk = new_chunk.release();
+      }
+    }
+    return chunk->entries[id & (kChunkSize - 1)];
+  }
+
+  std::unique_ptr<std::atomic<Chunk*>[]> m_chunks;
+  std::atomic<uint32_t> m_next{1};
+};
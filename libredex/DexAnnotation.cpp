@@ -778,8 +778,8 @@ void DexAnnotationDirectory::gather_annotations(
 void DexAnnotationDirectory::vencode(
     DexOutputIdx* dodx,
     std::vector<uint32_t>& annodirout,
-    std::map<ParamAnnotations*, uint32_t>& xrefmap,
-    std::map<DexAnnotationSet*, uint32_t>& asetmap) {
+    const std::map<ParamAnnotations*, uint32_t>& xrefmap,
+    const std::map<DexAnnotationSet*, uint32_t>& asetmap) {
   uint32_t classoff = 0;
   uint32_t cntaf = 0;
   uint32_t cntam = 0;
@@ -787,7 +787,7 @@ void DexAnnotationDirectory::vencode(
   if (m_class) {
     always_assert_log(asetmap.count(m_class) != 0, "Uninitialized aset %p '%s'",
                       m_class, show(m_class).c_str());
-    classoff = asetmap[m_class];
+    classoff = asetmap.at(m_class);
   }
   if (m_field) {
     cntaf = (uint32_t)m_field->size();
@@ -813,7 +813,7 @@ void DexAnnotationDirectory::vencode(
       annodirout.push_back(dodx->fieldidx(p.first));
       always_assert_log(asetmap.count(das) != 0, "Uninitialized aset %p '%s'",
                         das, show(das).c_str());
-      annodirout.push_back(asetmap[das]);
+      annodirout.push_back(asetmap.at(das));
     }
   }
   if (m_method) {
@@ -825,7 +825,7 @@ void DexAnnotationDirectory::vencode(
       annodirout.push_back(midx);
       always_assert_log(asetmap.count(das) != 0, "Uninitialized aset %p '%s'",
                         das, show(das).c_str());
-      annodirout.push_back(asetmap[das]);
+      annodirout.push_back(asetmap.at(das));
     }
   }
   if (m_method_param) {
@@ -837,7 +837,7 @@ void DexAnnotationDirectory::vencode(
       annodirout.push_back(dodx->methodidx(p.first));
       always_assert_log(xrefmap.count(pa) != 0,
                         "Uninitialized ParamAnnotations %p", pa);
-      annodirout.push_back(xrefmap[pa]);
+      annodirout.push_back(xrefmap.at(pa));
     }
   }
 }
@@ -848,9 +848,10 @@ void DexAnnotationSet::gather_annotations(std::vector<DexAnnotation*>& list) {
   }
 }
 
-void DexAnnotationSet::vencode(DexOutputIdx* dodx,
-                               std::vector<uint32_t>& asetout,
-                               std::map<DexAnnotation*, uint32_t>& annoout) {
+void DexAnnotationSet::vencode(
+    DexOutputIdx* dodx,
+    std::vector<uint32_t>& asetout,
+    const std::map<DexAnnotation*, uint32_t>& annoout) {
   asetout.push_back((uint32_t)m_annotations.size());
   std::sort(m_annotations.begin(), m_annotations.end(),
             [](const auto& a, const auto& b) {
@@ -861,7 +862,7 @@ void DexAnnotationSet::vencode(DexOutputIdx* dodx,
                       "Uninitialized annotation %p '%s', bailing\n",
                       anno.get(),
                       show(anno.get()).c_str());
-    asetout.push_back(annoout[anno.get()]);
+    asetout.push_back(annoout.at(anno.get()));
   }
 }
 
@@ -567,7 +567,7 @@ class DexAnnotationSet : public Gatherable {
   }
   void vencode(DexOutputIdx* dodx,
                std::vector<uint32_t>& asetout,
-               std::map<DexAnnotation*, uint32_t>& annoout);
+               const std::map<DexAnnotation*, uint32_t>& annoout);
   void gather_annotations(std::vector<DexAnnotation*>& alist);
 };
 
@@ -637,8 +637,8 @@ class DexAnnotationDirectory {
   void gather_xrefs(std::vector<ParamAnnotations*>& xrefs);
   void vencode(DexOutputIdx* dodx,
                std::vector<uint32_t>& annodirout,
-               std::map<ParamAnnotations*, uint32_t>& xrefmap,
-               std::map<DexAnnotationSet*, uint32_t>& asetmap);
+               const std::map<ParamAnnotations*, uint32_t>& xrefmap,
+               const std::map<DexAnnotationSet*, uint32_t>& asetmap);
 
   friend std::string show(const DexAnnotationDirectory*);
 };
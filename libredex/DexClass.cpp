@@ -33,6 +33,7 @@
 #include <boost/optional.hpp>
 #include <memory>
 #include <mutex>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -80,6 +81,21 @@ void c_append_all(C& c, It first, It last) {
   InsertionHelper<C, typename C::value_type>().append_all(c, first, last);
 }
 
+// The nested gathers (code, annotations, encoded values) only fill vectors.
+// Callers mostly gather into a vector of the same type too, and then the
+// references are appended to it directly instead of going through a
+// temporary vector that is allocated and freed for every member.
+template <typename T, typename C, typename Fn>
+void gather_through_vector(C& c, const Fn& gather) {
+  if constexpr (std::is_same_v<C, std::vector<T>>) {
+    gather(c);
+  } else {
+    std::vector<T> vec;
+    gather(vec);
+    c_append_all(c, vec.begin(), vec.end());
+  }
+}
+
 } // namespace
 
 namespace {
@@ -129,6 +145,11 @@ const DexString* DexString::make_string(std::string_view nstr) {
   return g_redex->make_string(nstr);
 }
 
+std::vector<const DexString*> DexString::make_strings(
+    const std::vector<std::string_view>& nstrs) {
+  return g_redex->make_strings(nstrs);
+}
+
 // Return an existing DexString or nullptr if one does not exist.
 const DexString* DexString::get_string(std::string_view s) {
   return g_redex->get_string(s);
@@ -225,6 +246,11 @@ void DexFieldRef::change(const DexFieldSpec& ref, bool rename_on_collision) {
   g_redex->mutate_field(this, ref, rename_on_collision);
 }
 
+void DexFieldRef::change_names(
+    const std::vector<std::pair<DexFieldRef*, const DexString*>>& renames) {
+  g_redex->rename_fields(renames);
+}
+
 void DexFieldRef::erase_field(DexFieldRef* f) {
   return g_redex->erase_field(f);
 }
@@ -467,6 +493,29 @@ std::unique_ptr<DexDebugItem> DexDebugItem::get_dex_debug(DexIdx* idx,
   return std::unique_ptr<DexDebugItem>(new DexDebugItem(idx, offset));
 }
 
+std::vector<uint32_t> map_debug_positions(DexDebugItem* debugitem,
+                                          PositionMapper* pos_mapper) {
+  std::vector<uint32_t> lines;
+  auto& entries = debugitem->get_entries();
+  for (auto it = entries.begin(); it != entries.end();) {
+    auto addr = it->addr;
+    DexPosition* last_pos = nullptr;
+    for (; it != entries.end() && it->addr == addr; ++it) {
+      if (it->type == DexDebugEntryType::Position) {
+        always_assert_log(it->pos->file != nullptr,
+                          "Position file has nullptr");
+        pos_mapper->register_position(it->pos.get());
+        last_pos = it->pos.get();
+      }
+    }
+    // only the last position entry for a given address is emitted
+    if (last_pos != nullptr) {
+      lines.push_back(pos_mapper->position_to_line(last_pos));
+    }
+  }
+  return lines;
+}
+
 /*
  * Convert DexDebugEntries into debug opcodes.
  */
@@ -476,7 +525,19 @@ std::vector<std::unique_ptr<DexDebugInstruction>> generate_debug_instructions(
     uint32_t* line_start,
     std::vector<DebugLineItem>* line_info,
     uint32_t line_addin) {
+  auto lines = map_debug_positions(debugitem, pos_mapper);
+  return generate_debug_instructions(debugitem, lines, line_start, line_info,
+                                     line_addin);
+}
+
+std::vector<std::unique_ptr<DexDebugInstruction>> generate_debug_instructions(
+    const DexDebugItem* debugitem,
+    const std::vector<uint32_t>& lines,
+    uint32_t* line_start,
+    std::vector<DebugLineItem>* line_info,
+    uint32_t line_addin) {
   std::vector<std::unique_ptr<DexDebugInstruction>> dbgops;
+  auto next_line = lines.begin();
   uint32_t prev_addr = 0;
   boost::optional<uint32_t> prev_line;
   auto& entries = debugitem->get_entries();
@@ -489,8 +550,6 @@ std::vector<std::unique_ptr<DexDebugInstruction>> generate_debug_instructions(
     for (; it != entries.end() && it->addr == addr; ++it) {
       switch (it->type) {
       case DexDebugEntryType::Position:
-        always_assert_log(it->pos->file != nullptr,
-                          "Position file has nullptr");
         positions.push_back(it->pos.get());
         break;
       case DexDebugEntryType::Instruction:
@@ -502,12 +561,10 @@ std::vector<std::unique_ptr<DexDebugInstruction>> generate_debug_instructions(
     auto addr_delta = addr - prev_addr;
     prev_addr = addr;
 
-    for (auto pos : positions) {
-      pos_mapper->register_position(pos);
-    }
     // only emit the last position entry for a given address
     if (!positions.empty()) {
-      auto line_base = pos_mapper->position_to_line(positions.back());
+      always_assert(next_line != lines.end());
+      auto line_base = *next_line++;
       auto line = line_base | line_addin;
       line_info->emplace_back(DebugLineItem(it->addr, line_base));
       int32_t line_delta;
@@ -1072,6 +1129,7 @@ void DexClass::remove_method(const DexMethod* m) {
     meths.erase(it);
   }
   redex_assert(erased);
+  g_redex->invalidate_method_resolutions();
 }
 
 void DexMethod::become_virtual() {
@@ -1082,6 +1140,7 @@ void DexMethod::become_virtual() {
   m_virtual = true;
   auto& vmethods = cls->get_vmethods();
   insert_sorted(vmethods, this, compare_dexmethods);
+  g_redex->invalidate_method_resolutions();
 }
 
 DexMethod* DexMethodRef::make_concrete(DexAccessFlags access,
@@ -1114,6 +1173,11 @@ void DexMethodRef::change(const DexMethodSpec& ref, bool rename_on_collision) {
   g_redex->mutate_method(this, ref, rename_on_collision);
 }
 
+void DexMethodRef::change_names(
+    const std::vector<std::pair<DexMethodRef*, const DexString*>>& renames) {
+  g_redex->rename_methods(renames);
+}
+
 void DexMethod::make_non_concrete() {
   m_access = static_cast<DexAccessFlags>(0);
   m_concrete = false;
@@ -1276,6 +1340,21 @@ void DexClass::add_method(DexMethod* m) {
   } else {
     insert_sorted(m_dmethods, m, compare_dexmethods);
   }
+  g_redex->invalidate_method_resolutions();
+}
+
+void DexClass::set_super_class(DexType* super_class) {
+  always_assert_log(!m_external, "Unexpected external class %s\n",
+                    self_show().c_str());
+  m_super_class = super_class;
+  g_redex->invalidate_method_resolutions();
+}
+
+void DexClass::set_interfaces(DexTypeList* intfs) {
+  always_assert_log(!m_external, "Unexpected external class %s\n",
+                    self_show().c_str());
+  m_interfaces = intfs;
+  g_redex->invalidate_method_resolutions();
 }
 
 std::vector<DexField*> DexClass::get_all_fields() const {
@@ -1435,8 +1514,7 @@ void DexClass::load_class_annotations(DexIdx* idx, uint32_t anno_off) {
   if (anno_off == 0) return;
   const dex_annotations_directory_item* annodir =
       idx->get_data<dex_annotations_directory_item>(anno_off);
-  m_anno =
-      DexAnnotationSet::get_annotation_set(idx, annodir->class_annotations_off);
+  m_anno = idx->get_annotation_set(annodir->class_annotations_off);
   const uint32_t* annodata = (uint32_t*)(annodir + 1);
   always_assert_type_log(annodata <= annodata + annodir->fields_size * 2,
                          INVALID_DEX, "Dex overflow");
@@ -1447,7 +1525,7 @@ void DexClass::load_class_annotations(DexIdx* idx, uint32_t anno_off) {
     uint32_t fidx = *annodata++;
     uint32_t off = *annodata++;
     DexField* field = static_cast<DexField*>(idx->get_fieldidx(fidx));
-    auto aset = DexAnnotationSet::get_annotation_set(idx, off);
+    auto aset = idx->get_annotation_set(off);
     auto res = field->attach_annotation_set(std::move(aset));
     always_assert_type_log(res, INVALID_DEX, "Failed to attach annotation set");
   }
@@ -1460,7 +1538,7 @@ void DexClass::load_class_annotations(DexIdx* idx, uint32_t anno_off) {
     uint32_t midx = *annodata++;
     uint32_t off = *annodata++;
     DexMethod* method = static_cast<DexMethod*>(idx->get_methodidx(midx));
-    auto aset = DexAnnotationSet::get_annotation_set(idx, off);
+    auto aset = idx->get_annotation_set(off);
     auto res = method->attach_annotation_set(std::move(aset));
     always_assert_type_log(res, INVALID_DEX, "Failed to attach method set");
   }
@@ -1482,7 +1560,7 @@ void DexClass::load_class_annotations(DexIdx* idx, uint32_t anno_off) {
                              INVALID_DEX, "Dex overflow");
       for (uint32_t j = 0; j < count; j++) {
         uint32_t off = annoxref[j];
-        auto aset = DexAnnotationSet::get_annotation_set(idx, off);
+        auto aset = idx->get_annotation_set(off);
         if (aset != nullptr) {
           method->attach_param_annotation_set(j, std::move(aset));
           redex_assert(CONSTP(method)->get_param_anno());
@@ -1774,9 +1852,8 @@ void DexClass::gather_types(C& ltype) const {
   ltype.insert(ltype.end(), m_self);
   if (m_interfaces) m_interfaces->gather_types(ltype);
   if (m_anno) {
-    std::vector<DexType*> type_vec;
-    m_anno->gather_types(type_vec);
-    c_append_all(ltype, type_vec.begin(), type_vec.end());
+    gather_through_vector<DexType*>(
+        ltype, [&](auto& vec) { m_anno->gather_types(vec); });
   }
 
   // We also need to gather types needed for field and method refs.
@@ -1846,9 +1923,8 @@ void DexClass::gather_strings_internal(C& lstring, bool exclude_loads) const {
   }
   if (m_source_file) c_append(lstring, m_source_file);
   if (m_anno) {
-    std::vector<const DexString*> strings;
-    m_anno->gather_strings(strings);
-    c_append_all(lstring, strings.begin(), strings.end());
+    gather_through_vector<const DexString*>(
+        lstring, [&](auto& vec) { m_anno->gather_strings(vec); });
   }
 }
 void DexClass::gather_strings(std::vector<const DexString*>& lstring,
@@ -1877,9 +1953,8 @@ void DexClass::gather_fields(C& lfield) const {
     f->gather_fields(lfield);
   }
   if (m_anno) {
-    std::vector<DexFieldRef*> fields_vec; // Simplify refactor.
-    m_anno->gather_fields(fields_vec);
-    c_append_all(lfield, fields_vec.begin(), fields_vec.end());
+    gather_through_vector<DexFieldRef*>(
+        lfield, [&](auto& vec) { m_anno->gather_fields(vec); });
   }
 }
 INSTANTIATE(DexClass::gather_fields, DexFieldRef*)
@@ -1901,9 +1976,8 @@ void DexClass::gather_methods(C& lmethod) const {
     f->gather_methods(lmethod);
   }
   if (m_anno) {
-    std::vector<DexMethodRef*> method_vec; // Simplify refactor.
-    m_anno->gather_methods(method_vec);
-    c_append_all(lmethod, method_vec.begin(), method_vec.end());
+    gather_through_vector<DexMethodRef*>(
+        lmethod, [&](auto& vec) { m_anno->gather_methods(vec); });
   }
 }
 INSTANTIATE(DexClass::gather_methods, DexMethodRef*)
@@ -1995,19 +2069,19 @@ void DexFieldRef::gather_strings_shallow(
 
 template <typename C>
 void DexField::gather_types(C& ltype) const {
-  std::vector<DexType*> type_vec;
-  if (m_value) m_value->gather_types(type_vec);
-  if (m_anno) m_anno->gather_types(type_vec);
-  c_append_all(ltype, type_vec.begin(), type_vec.end());
+  gather_through_vector<DexType*>(ltype, [&](auto& vec) {
+    if (m_value) m_value->gather_types(vec);
+    if (m_anno) m_anno->gather_types(vec);
+  });
 }
 INSTANTIATE(DexField::gather_types, DexType*)
 
 template <typename C>
 void DexField::gather_strings_internal(C& lstring) const {
-  std::vector<const DexString*> string_vec;
-  if (m_value) m_value->gather_strings(string_vec);
-  if (m_anno) m_anno->gather_strings(string_vec);
-  c_append_all(lstring, string_vec.begin(), string_vec.end());
+  gather_through_vector<const DexString*>(lstring, [&](auto& vec) {
+    if (m_value) m_value->gather_strings(vec);
+    if (m_anno) m_anno->gather_strings(vec);
+  });
 }
 void DexField::gather_strings(std::vector<const DexString*>& lstring) const {
   gather_strings_internal(lstring);
@@ -2019,19 +2093,19 @@ void DexField::gather_strings(
 
 template <typename C>
 void DexField::gather_fields(C& lfield) const {
-  std::vector<DexFieldRef*> field_vec;
-  if (m_value) m_value->gather_fields(field_vec);
-  if (m_anno) m_anno->gather_fields(field_vec);
-  c_append_all(lfield, field_vec.begin(), field_vec.end());
+  gather_through_vector<DexFieldRef*>(lfield, [&](auto& vec) {
+    if (m_value) m_value->gather_fields(vec);
+    if (m_anno) m_anno->gather_fields(vec);
+  });
 }
 INSTANTIATE(DexField::gather_fields, DexFieldRef*)
 
 template <typename C>
 void DexField::gather_methods(C& lmethod) const {
-  std::vector<DexMethodRef*> method_vec;
-  if (m_value) m_value->gather_methods(method_vec);
-  if (m_anno) m_anno->gather_methods(method_vec);
-  c_append_all(lmethod, method_vec.begin(), method_vec.end());
+  gather_through_vector<DexMethodRef*>(lmethod, [&](auto& vec) {
+    if (m_value) m_value->gather_methods(vec);
+    if (m_anno) m_anno->gather_methods(vec);
+  });
 }
 INSTANTIATE(DexField::gather_methods, DexMethodRef*)
 
@@ -2049,17 +2123,17 @@ void DexMethod::set_external() {
 template <typename C>
 void DexMethod::gather_types(C& ltype) const {
   gather_types_shallow(ltype); // Handle DexMethodRef parts.
-  std::vector<DexType*> type_vec; // Simplify refactor.
-  if (m_code) m_code->gather_types(type_vec);
-  if (m_anno) m_anno->gather_types(type_vec);
-  auto param_anno = get_param_anno();
-  if (param_anno) {
-    for (auto& pair : *param_anno) {
-      auto& anno_set = pair.second;
-      anno_set->gather_types(type_vec);
+  gather_through_vector<DexType*>(ltype, [&](auto& vec) {
+    if (m_code) m_code->gather_types(vec);
+    if (m_anno) m_anno->gather_types(vec);
+    auto param_anno = get_param_anno();
+    if (param_anno) {
+      for (auto& pair : *param_anno) {
+        auto& anno_set = pair.second;
+        anno_set->gather_types(vec);
+      }
     }
-  }
-  c_append_all(ltype, type_vec.begin(), type_vec.end());
+  });
 }
 INSTANTIATE(DexMethod::gather_types, DexType*)
 
@@ -2071,9 +2145,8 @@ template <typename C>
 void DexMethod::gather_callsites(C& lcallsite) const {
   // We handle m_spec.cls and proto in the first-layer gather.
   if (m_code) {
-    std::vector<DexCallSite*> callsite_vec; // Simplify refactor.
-    m_code->gather_callsites(callsite_vec);
-    c_append_all(lcallsite, callsite_vec.begin(), callsite_vec.end());
+    gather_through_vector<DexCallSite*>(
+        lcallsite, [&](auto& vec) { m_code->gather_callsites(vec); });
   }
 }
 INSTANTIATE(DexMethod::gather_callsites, DexCallSite*)
@@ -2081,25 +2154,26 @@ INSTANTIATE(DexMethod::gather_callsites, DexCallSite*)
 template <typename C>
 void DexMethod::gather_methodhandles(C& lmethodhandle) const {
   // We handle m_spec.cls and proto in the first-layer gather.
-  std::vector<DexMethodHandle*> mhandles_vec; // Simplify refactor.
-  if (m_code) m_code->gather_methodhandles(mhandles_vec);
-  c_append_all(lmethodhandle, mhandles_vec.begin(), mhandles_vec.end());
+  if (m_code) {
+    gather_through_vector<DexMethodHandle*>(
+        lmethodhandle, [&](auto& vec) { m_code->gather_methodhandles(vec); });
+  }
 }
 INSTANTIATE(DexMethod::gather_methodhandles, DexMethodHandle*)
 template <typename C>
 void DexMethod::gather_strings_internal(C& lstring, bool exclude_loads) const {
   // We handle m_name and proto in the first-layer gather.
-  std::vector<const DexString*> strings_vec; // Simplify refactor.
-  if (m_code && !exclude_loads) m_code->gather_strings(strings_vec);
-  if (m_anno) m_anno->gather_strings(strings_vec);
-  auto param_anno = get_param_anno();
-  if (param_anno) {
-    for (auto& pair : *param_anno) {
-      auto& anno_set = pair.second;
-      anno_set->gather_strings(strings_vec);
+  gather_through_vector<const DexString*>(lstring, [&](auto& vec) {
+    if (m_code && !exclude_loads) m_code->gather_strings(vec);
+    if (m_anno) m_anno->gather_strings(vec);
+    auto param_anno = get_param_anno();
+    if (param_anno) {
+      for (auto& pair : *param_anno) {
+        auto& anno_set = pair.second;
+        anno_set->gather_strings(vec);
+      }
     }
-  }
-  c_append_all(lstring, strings_vec.begin(), strings_vec.end());
+  });
 }
 void DexMethod::gather_strings(std::vector<const DexString*>& lstring,
                                bool exclude_loads) const {
@@ -2112,26 +2186,25 @@ void DexMethod::gather_strings(std::unordered_set<const DexString*>& lstring,
 
 template <typename C>
 void DexMethod::gather_fields(C& lfield) const {
-  std::vector<DexFieldRef*> fields_vec; // Simplify refactor.
-  if (m_code) m_code->gather_fields(fields_vec);
-  if (m_anno) m_anno->gather_fields(fields_vec);
-  auto param_anno = get_param_anno();
-  if (param_anno) {
-    for (auto& pair : *param_anno) {
-      auto& anno_set = pair.second;
-      anno_set->gather_fields(fields_vec);
+  gather_through_vector<DexFieldRef*>(lfield, [&](auto& vec) {
+    if (m_code) m_code->gather_fields(vec);
+    if (m_anno) m_anno->gather_fields(vec);
+    auto param_anno = get_param_anno();
+    if (param_anno) {
+      for (auto& pair : *param_anno) {
+        auto& anno_set = pair.second;
+        anno_set->gather_fields(vec);
+      }
     }
-  }
-  c_append_all(lfield, fields_vec.begin(), fields_vec.end());
+  });
 }
 INSTANTIATE(DexMethod::gather_fields, DexFieldRef*)
 
 template <typename C>
 void DexMethod::gather_methods(C& lmethod) const {
   if (m_code) {
-    std::vector<DexMethodRef*> method_vec; // Simplify refactor.
-    m_code->gather_methods(method_vec);
-    c_append_all(lmethod, method_vec.begin(), method_vec.end());
+    gather_through_vector<DexMethodRef*>(
+        lmethod, [&](auto& vec) { m_code->gather_methods(vec); });
   }
   gather_methods_from_annos(lmethod);
 }
@@ -2139,16 +2212,16 @@ INSTANTIATE(DexMethod::gather_methods, DexMethodRef*)
 
 template <typename C>
 void DexMethod::gather_methods_from_annos(C& lmethod) const {
-  std::vector<DexMethodRef*> method_vec; // Simplify refactor.
-  if (m_anno) m_anno->gather_methods(method_vec);
-  auto param_anno = get_param_anno();
-  if (param_anno) {
-    for (auto& pair : *param_anno) {
-      auto& anno_set = pair.second;
-      anno_set->gather_methods(method_vec);
+  gather_through_vector<DexMethodRef*>(lmethod, [&](auto& vec) {
+    if (m_anno) m_anno->gather_methods(vec);
+    auto param_anno = get_param_anno();
+    if (param_anno) {
+      for (auto& pair : *param_anno) {
+        auto& anno_set = pair.second;
+        anno_set->gather_methods(vec);
+      }
     }
-  }
-  c_append_all(lmethod, method_vec.begin(), method_vec.end());
+  });
 }
 INSTANTIATE(DexMethod::gather_methods_from_annos, DexMethodRef*)
 
@@ -2208,6 +2281,11 @@ void DexType::set_name(const DexString* new_name) {
   g_redex->set_type_name(this, new_name);
 }
 
+void DexType::set_names(
+    const std::vector<std::pair<DexType*, const DexString*>>& renames) {
+  g_redex->set_type_names(renames);
+}
+
 DexProto* DexType::get_non_overlapping_proto(const DexString* method_name,
                                              DexProto* orig_proto) {
   auto methodref_in_context =
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
@@ -115,6 +116,11 @@ class DexString {
   // See also get_string()
   static const DexString* make_string(std::string_view nstr);
 
+  // Same as make_string for each of the given strings, but cheaper for many
+  // new strings at once. Useful for loaders.
+  static std::vector<const DexString*> make_strings(
+      const std::vector<std::string_view>& nstrs);
+
   // Return an existing DexString or nullptr if one does not exist.
   static const DexString* get_string(std::string_view s);
 
@@ -155,38 +161,37 @@ inline bool compare_dexstrings(const DexString* a, const DexString* b) {
   } else if (b == nullptr) {
     return false;
   }
-  if (a->is_simple() && b->is_simple())
+  if (a->is_simple() && b->is_simple()) {
 #if defined(__SSE4_2__) && defined(__linux__) && defined(__STRCMP_LESS__)
     return strcmp_less(a->c_str(), b->c_str());
 #else
-    return (strcmp(a->c_str(), b->c_str()) < 0);
+    // Simple strings can't contain (encoded) zeros, so this is strcmp.
+    int cmp = memcmp(a->c_str(), b->c_str(), std::min(a->size(), b->size()));
+    return cmp != 0 ? cmp < 0 : a->size() < b->size();
 #endif
+  }
   /*
-   * Bother, need to do code-point character-by-character
-   * comparison.
+   * The byte order of MUTF-8 agrees with the code-point order, except for
+   * the two-byte encoding of zero. So skip the common prefix, and only decode
+   * the first code point that differs.
    */
-  const char* sa = a->c_str();
-  const char* sb = b->c_str();
-  /* Equivalence test first, so we don't worry about walking
-   * off the end.
-   */
-  if (strcmp(sa, sb) == 0) return false;
-  if (strlen(sa) == 0) {
-    return true;
-  }
-  if (strlen(sb) == 0) {
-    return false;
-  }
-  while (1) {
-    uint32_t cpa = mutf8_next_code_point(sa);
-    uint32_t cpb = mutf8_next_code_point(sb);
-    if (cpa == cpb) {
-      if (*sa == '\0') return true;
-      if (*sb == '\0') return false;
-      continue;
-    }
-    return (cpa < cpb);
+  size_t common = std::min(a->size(), b->size());
+  size_t i = mismatch_offset(a->c_str(), b->c_str(), common);
+  if (i == common) {
+    return a->size() < b->size();
+  }
+  // Back up to the first byte of the code point, which isn't a continuation
+  // byte. The prefix is the same in both strings.
+  auto is_continuation = [](char c) {
+    return (static_cast<uint8_t>(c) & 0xc0) == 0x80;
+  };
+  while (i > 0 &&
+         (is_continuation(a->c_str()[i]) || is_continuation(b->c_str()[i]))) {
+    --i;
   }
+  const char* sa = a->c_str() + i;
+  const char* sb = b->c_str() + i;
+  return mutf8_next_code_point(sa) < mutf8_next_code_point(sb);
 }
 
 struct dexstrings_comparator {
@@ -200,6 +205,8 @@ class DexType {
 
   const DexString* m_name;
   std::atomic<DexClass*> m_self{nullptr};
+  // Assigned on demand, see RedexContext::get_dense_id.
+  std::atomic<uint32_t> m_dense_id{0};
 
   // See UNIQUENESS above for the rationale for the private constructor pattern.
   explicit DexType(const DexString* dstring) { m_name = dstring; }
@@ -238,6 +245,10 @@ class DexType {
 
   void set_name(const DexString* new_name);
 
+  // Renames many types at once; see RedexContext::set_type_names.
+  static void set_names(
+      const std::vector<std::pair<DexType*, const DexString*>>& renames);
+
   const DexString* get_name() const { return m_name; }
   const char* c_str() const { return get_name()->c_str(); }
   std::string_view str() const { return get_name()->str(); }
@@ -280,6 +291,8 @@ class DexFieldRef {
   DexFieldSpec m_spec;
   bool m_concrete;
   bool m_external;
+  // Assigned on demand, see RedexContext::get_dense_id.
+  std::atomic<uint32_t> m_dense_id{0};
 
   virtual ~DexFieldRef() {}
   DexFieldRef(DexType* container, const DexString* name, DexType* type) {
@@ -316,6 +329,10 @@ class DexFieldRef {
 
   void change(const DexFieldSpec& ref, bool rename_on_collision = false);
 
+  // Renames many fields at once; see RedexContext::rename_fields.
+  static void change_names(
+      const std::vector<std::pair<DexFieldRef*, const DexString*>>& renames);
+
   DexField* make_concrete(DexAccessFlags access_flags);
   DexField* make_concrete(DexAccessFlags access_flags,
                           std::unique_ptr<DexEncodedValue> v);
@@ -698,6 +715,23 @@ std::vector<std::unique_ptr<DexDebugInstruction>> generate_debug_instructions(
     std::vector<DebugLineItem>* line_info,
     uint32_t line_addin);
 
+/*
+ * Registers the positions of the given debug item with the position mapper,
+ * and returns the line of each address that has positions, in order.
+ * Position mappers assign lines in the order in which they see positions, so
+ * this must be called in emit order; generating the debug opcodes from the
+ * resulting lines does not touch the mapper, and can happen in parallel.
+ */
+std::vector<uint32_t> map_debug_positions(DexDebugItem* debugitem,
+                                          PositionMapper* pos_mapper);
+
+std::vector<std::unique_ptr<DexDebugInstruction>> generate_debug_instructions(
+    const DexDebugItem* debugitem,
+    const std::vector<uint32_t>& lines,
+    uint32_t* line_start,
+    std::vector<DebugLineItem>* line_info,
+    uint32_t line_addin);
+
 using DexCatches = std::vector<std::pair<DexType*, uint32_t>>;
 
 struct DexTryItem {
@@ -821,6 +855,8 @@ class DexMethodRef {
   DexMethodSpec m_spec;
   bool m_concrete;
   bool m_external;
+  // Assigned on demand, see RedexContext::get_dense_id.
+  std::atomic<uint32_t> m_dense_id{0};
 
   ~DexMethodRef() {}
   DexMethodRef(DexType* type, const DexString* name, DexProto* proto)
@@ -855,6 +891,10 @@ class DexMethodRef {
 
   void change(const DexMethodSpec& ref, bool rename_on_collision);
 
+  // Renames many methods at once; see RedexContext::rename_methods.
+  static void change_names(
+      const std::vector<std::pair<DexMethodRef*, const DexString*>>& renames);
+
   DexMethod* make_concrete(DexAccessFlags,
                            std::unique_ptr<DexCode>,
                            bool is_virtual);
@@ -1320,20 +1360,12 @@ class DexClass {
 
   void set_external();
 
-  void set_super_class(DexType* super_class) {
-    always_assert_log(!m_external, "Unexpected external class %s\n",
-                      self_show().c_str());
-    m_super_class = super_class;
-  }
+  void set_super_class(DexType* super_class);
 
   void combine_annotations_with(DexClass* other);
   void combine_annotations_with(DexAnnotationSet* other);
 
-  void set_interfaces(DexTypeList* intfs) {
-    always_assert_log(!m_external, "Unexpected external class %s\n",
-                      self_show().c_str());
-    m_interfaces = intfs;
-  }
+  void set_interfaces(DexTypeList* intfs);
 
   void clear_annotations();
   /* Encodes class_data_item, returns size in bytes.  No
@@ -35,6 +35,9 @@ class Impl final {
  public:
   explicit Impl(DexClass* cls) : m_cls(cls) {}
   DexHash run();
+  DexHash run(const DexMethod* method);
+  size_t run_canonical(const cfg::ControlFlowGraph& cfg);
+  size_t run_canonical(const cfg::Block* block);
   void print(std::ostream&);
 
  private:
@@ -527,6 +530,35 @@ DexHash Impl::run() {
   return get_hash();
 }
 
+DexHash Impl::run(const DexMethod* method) {
+  TRACE(HASHER, 2, "[hasher] ==== hashing method %s", SHOW(method));
+  hash(method);
+  return get_hash();
+}
+
+size_t Impl::run_canonical(const cfg::ControlFlowGraph& cfg) {
+  // Blocks are combined commutatively, as structural equality matches them by
+  // traversal rather than by id. Instructions leave their registers in
+  // m_registers_hash.
+  size_t blocks_hash = 0;
+  for (auto* b : cfg.blocks()) {
+    blocks_hash += run_canonical(b);
+  }
+  m_hash = 0;
+  hash((uint64_t)cfg.num_blocks());
+  hash((uint64_t)cfg.num_edges());
+  hash((uint64_t)blocks_hash);
+  return m_hash;
+}
+
+size_t Impl::run_canonical(const cfg::Block* block) {
+  m_hash = 0;
+  for (const auto& mie : ir_list::ConstInstructionIterable(*block)) {
+    hash(mie.insn);
+  }
+  return m_hash;
+}
+
 void Impl::print(std::ostream& ofs) {
   hash_metadata();
   ofs << "type " << show(m_cls) << " #" << hash_to_string(m_hash) << std::endl;
@@ -606,6 +638,21 @@ DexHash DexClassHasher::run() { return m_fwd->run(); }
 
 void DexClassHasher::print(std::ostream& os) { m_fwd->print(os); }
 
+DexHash DexMethodHasher::run() {
+  Impl impl(/* cls */ nullptr);
+  return impl.run(m_method);
+}
+
+size_t canonical_code_hash(const cfg::ControlFlowGraph& cfg) {
+  Impl impl(/* cls */ nullptr);
+  return impl.run_canonical(cfg);
+}
+
+size_t canonical_block_hash(const cfg::Block* block) {
+  Impl impl(/* cls */ nullptr);
+  return impl.run_canonical(block);
+}
+
 void print_classes(std::ostream& output, const Scope& classes) {
   std::unordered_map<DexClass*, std::stringstream> class_strs;
   walk::classes(classes, [&](DexClass* cls) {
@@ -22,6 +22,12 @@
 #include <vector>
 
 class DexClass;
+class DexMethod;
+
+namespace cfg {
+class Block;
+class ControlFlowGraph;
+} // namespace cfg
 
 using Scope = std::vector<DexClass*>;
 
@@ -58,6 +64,35 @@ class DexClassHasher final {
   std::unique_ptr<Fwd> m_fwd;
 };
 
+/*
+ * Hashes a single method (signature, annotations, access flags and code) in
+ * the same way as it contributes to its class hash. The result does not depend
+ * on addresses, so it is stable across runs and can be used as a content key
+ * for per-method analysis results.
+ */
+class DexMethodHasher final {
+ public:
+  explicit DexMethodHasher(const DexMethod* method) : m_method(method) {}
+  DexHash run();
+
+ private:
+  const DexMethod* m_method;
+};
+
+/*
+ * Hashes the instructions of a CFG such that structurally equal CFGs (see
+ * ControlFlowGraph::structural_equals) get the same hash. Registers, block ids
+ * and block order, positions and source blocks do not contribute, so the hash
+ * is also stable under register renaming. Meant for bucketing candidates of
+ * code comparisons; equal hashes do not imply equal code.
+ */
+size_t canonical_code_hash(const cfg::ControlFlowGraph& cfg);
+
+/*
+ * The same hash for the instructions of a single block, ignoring its edges.
+ */
+size_t canonical_block_hash(const cfg::Block* block);
+
 void print_classes(std::ostream& output, const Scope& classes);
 
 } // namespace hashing
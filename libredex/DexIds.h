@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include <sparta/PatriciaTreeKeyTrait.h>
+
+#include "DexClass.h"
+#include "RedexContext.h"
+
+/*
+ * 32-bit handles for DexType, DexFieldRef and DexMethodRef, based on the dense
+ * ids handed out by RedexContext.
+ *
+ * Patricia trees keyed by these handles use 32-bit instead of 64-bit keys,
+ * which makes their nodes smaller, and keeps the keys of related entities
+ * (which tend to get their ids at about the same time) closer together than
+ * heap addresses. Use them in place of pointer keys in abstract environments
+ * that dominate memory or iteration time.
+ *
+ * A default-constructed handle refers to nothing. Handles are only meaningful
+ * within one RedexContext.
+ */
+namespace dex_ids_impl {
+
+template <typename T>
+struct Lookup;
+
+template <>
+struct Lookup<DexType> {
+  static DexType* get(uint32_t id) { return g_redex->get_type_by_dense_id(id); }
+};
+
+template <>
+struct Lookup<DexFieldRef> {
+  static DexFieldRef* get(uint32_t id) {
+    return g_redex->get_field_by_dense_id(id);
+  }
+};
+
+template <>
+struct Lookup<DexMethodRef> {
+  static DexMethodRef* get(uint32_t id) {
+    return g_redex->get_method_by_dense_id(id);
+  }
+};
+
+} // namespace dex_ids_impl
+
+template <typename T>
+class DexId final {
+ public:
+  DexId() = default;
+
+  explicit DexId(const T* ptr)
+      : m_id(ptr == nullptr ? 0 : g_redex->get_dense_id(ptr)) {}
+
+  T* get() const {
+    return m_id == 0 ? nullptr : dex_ids_impl::Lookup<T>::get(m_id);
+  }
+
+  uint32_t id() const { return m_id; }
+
+  explicit operator bool() const { return m_id != 0; }
+
+  bool operator==(const DexId& other) const { return m_id == other.m_id; }
+  bool operator!=(const DexId& other) const { return m_id != other.m_id; }
+  bool operator<(const DexId& other) const { return m_id < other.m_id; }
+
+ private:
+  uint32_t m_id{0};
+};
+
+using DexTypeId = DexId<DexType>;
+using DexFieldRefId = DexId<DexFieldRef>;
+using DexMethodRefId = DexId<DexMethodRef>;
+
+namespace sparta {
+
+template <typename T>
+struct PatriciaTreeKeyTrait<DexId<T>> {
+  using IntegerType = uint32_t;
+};
+
+} // namespace sparta
+
+namespace std {
+
+template <typename T>
+struct hash<DexId<T>> {
+  size_t operator()(const DexId<T>& id) const { return id.id(); }
+};
+
+} // namespace std
@@ -114,7 +114,8 @@ DexMethodHandle* DexIdx::get_methodhandleidx_fromdex(uint32_t mhidx) {
   }
 }
 
-const DexString* DexIdx::get_stringidx_fromdex(uint32_t stridx) {
+std::string_view DexIdx::get_string_data(uint32_t stridx,
+                                         uint32_t* utfsize) const {
   redex_assert(stridx < m_string_ids_size);
   uint32_t stroff = m_string_ids[stridx].offset;
   // Bounds check is conservative. May incorrectly reject short strings
@@ -124,7 +125,7 @@ const DexString* DexIdx::get_stringidx_fromdex(uint32_t stridx) {
   const uint8_t* dstr = m_dexbase + stroff;
   /* Strip off uleb128 size encoding */
 
-  uint32_t utfsize = read_uleb128(&dstr);
+  *utfsize = read_uleb128(&dstr);
   // Find null terminator.
   auto null_cur = dstr;
   while (*null_cur != '\0' && null_cur < m_dexbase + get_file_size()) {
@@ -133,17 +134,38 @@ const DexString* DexIdx::get_stringidx_fromdex(uint32_t stridx) {
   always_assert_type_log(null_cur < m_dexbase + get_file_size(), INVALID_DEX,
                          "Missing null terminator");
 
-  auto ret = DexString::make_string(
-      std::string_view((const char*)dstr, null_cur - dstr));
+  return std::string_view((const char*)dstr, null_cur - dstr);
+}
+
+void DexIdx::check_string(const DexString* str, uint32_t utfsize) const {
   always_assert_type_log(
-      ret->length() == utfsize,
+      str->length() == utfsize,
       INVALID_DEX,
       "Parsed string UTF size is not the same as stringidx size. %u != %u",
-      ret->length(),
+      str->length(),
       utfsize);
+}
+
+const DexString* DexIdx::get_stringidx_fromdex(uint32_t stridx) {
+  uint32_t utfsize;
+  auto ret = DexString::make_string(get_string_data(stridx, &utfsize));
+  check_string(ret, utfsize);
   return ret;
 }
 
+void DexIdx::load_strings() {
+  std::vector<std::string_view> strs(m_string_ids_size);
+  std::vector<uint32_t> utfsizes(m_string_ids_size);
+  for (uint32_t i = 0; i < m_string_ids_size; ++i) {
+    strs[i] = get_string_data(i, &utfsizes[i]);
+  }
+  auto dex_strings = DexString::make_strings(strs);
+  for (uint32_t i = 0; i < m_string_ids_size; ++i) {
+    check_string(dex_strings[i], utfsizes[i]);
+    m_string_cache[i] = dex_strings[i];
+  }
+}
+
 DexType* DexIdx::get_typeidx_fromdex(uint32_t typeidx) {
   redex_assert(typeidx < m_type_ids_size);
   uint32_t stridx = m_type_ids[typeidx].string_idx;
@@ -194,3 +216,30 @@ DexTypeList* DexIdx::get_type_list(uint32_t offset) {
   }
   return DexTypeList::make_type_list(std::move(tlist));
 }
+
+std::unique_ptr<DexAnnotationSet> DexIdx::get_annotation_set(
+    uint32_t aset_off) {
+  if (aset_off == 0) {
+    return nullptr;
+  }
+  bool seen;
+  {
+    std::lock_guard<std::mutex> lock(m_annotation_set_cache_mutex);
+    auto [it, inserted] = m_annotation_set_cache.emplace(aset_off, nullptr);
+    if (it->second != nullptr) {
+      return std::make_unique<DexAnnotationSet>(*it->second);
+    }
+    seen = !inserted;
+  }
+  if (seen) {
+    std::shared_ptr<const DexAnnotationSet> cached =
+        DexAnnotationSet::get_annotation_set(this, aset_off);
+    std::lock_guard<std::mutex> lock(m_annotation_set_cache_mutex);
+    auto& entry = m_annotation_set_cache[aset_off];
+    if (entry == nullptr) {
+      entry = std::move(cached);
+    }
+    return std::make_unique<DexAnnotationSet>(*entry);
+  }
+  return DexAnnotationSet::get_annotation_set(this, aset_off);
+}
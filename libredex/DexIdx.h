@@ -8,8 +8,11 @@
 #pragma once
 
 #include <assert.h>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 
 #include "Debug.h"
 #include "DexDefs.h"
@@ -24,6 +27,7 @@ class DexMethodRef;
 class DexProto;
 class DexCallSite;
 class DexMethodHandle;
+class DexAnnotationSet;
 
 class DexIdx {
  private:
@@ -54,7 +58,15 @@ class DexIdx {
   std::vector<DexCallSite*> m_callsite_cache;
   std::vector<DexMethodHandle*> m_methodhandle_cache;
 
+  // Annotation sets by offset. A null entry is a set that was decoded once.
+  // Classes are loaded in parallel, so this one is guarded.
+  std::mutex m_annotation_set_cache_mutex;
+  std::unordered_map<uint32_t, std::shared_ptr<const DexAnnotationSet>>
+      m_annotation_set_cache;
+
   DexType* get_typeidx_fromdex(uint32_t typeidx);
+  std::string_view get_string_data(uint32_t stridx, uint32_t* utfsize) const;
+  void check_string(const DexString* str, uint32_t utfsize) const;
   const DexString* get_stringidx_fromdex(uint32_t stridx);
   DexFieldRef* get_fieldidx_fromdex(uint32_t fidx);
   DexMethodRef* get_methodidx_fromdex(uint32_t midx);
@@ -65,6 +77,10 @@ class DexIdx {
  public:
   explicit DexIdx(const dex_header* dh);
 
+  // Interns all strings of the dex file at once, which is cheaper than
+  // creating them one by one on first use.
+  void load_strings();
+
   const DexString* get_stringidx(uint32_t stridx) {
     always_assert_type_log(
         stridx < m_string_ids_size, RedexError::INVALID_DEX,
@@ -203,6 +219,11 @@ class DexIdx {
 
   DexTypeList* get_type_list(uint32_t offset);
 
+  // Dex files share one annotation_set_item between all the members with the
+  // same annotations. A set that is referenced more than once is decoded a
+  // second time to be kept around, and then copied for the other members.
+  std::unique_ptr<DexAnnotationSet> get_annotation_set(uint32_t aset_off);
+
   friend std::string show(DexIdx*);
 };
 
@@ -21,6 +21,7 @@
 
 #include <exception>
 #include <stdexcept>
+#include <unordered_set>
 #include <vector>
 
 DexLoader::DexLoader(const DexLocation* location)
@@ -683,6 +684,34 @@ void DexLoader::load_dex_class(int num) {
   // We're inserting nullptr because we can't mess up the indices of the other
   // classes in the vector. This vector is used via random access.
   m_classes->at(num) = dc;
+
+  if (dc != nullptr && m_balloon_on_load) {
+    balloon_class(dc);
+  }
+}
+
+void DexLoader::balloon_class(DexClass* cls) {
+  auto balloon_method = [&](DexMethod* m) {
+    if (!m->get_dex_code()) {
+      return;
+    }
+    if (m_throw_on_balloon_error) {
+      m->balloon();
+      return;
+    }
+    try {
+      m->balloon();
+    } catch (RedexException& re) {
+      m_balloon_errors.emplace(
+          m, std::make_pair(re.what(), std::make_exception_ptr(re)));
+    }
+  };
+  for (auto* m : cls->get_dmethods()) {
+    balloon_method(m);
+  }
+  for (auto* m : cls->get_vmethods()) {
+    balloon_method(m);
+  }
 }
 
 const dex_header* DexLoader::get_dex_header(const char* file_name) {
@@ -694,31 +723,66 @@ const dex_header* DexLoader::get_dex_header(const char* file_name) {
   return reinterpret_cast<const dex_header*>(m_file->const_data());
 }
 
+const dex_header* DexLoader::open_dex(const char* file_name,
+                                     int support_dex_version) {
+  const dex_header* dh = get_dex_header(file_name);
+  validate_dex_header(dh, m_file->size(), support_dex_version);
+  return dh;
+}
+
 DexClasses DexLoader::load_dex(const char* file_name,
                                dex_stats_t* stats,
                                int support_dex_version,
                                Parallel p) {
-  const dex_header* dh = get_dex_header(file_name);
-  validate_dex_header(dh, m_file->size(), support_dex_version);
+  const dex_header* dh = open_dex(file_name, support_dex_version);
   return load_dex(dh, stats, p);
 }
 
-DexClasses DexLoader::load_dex(const dex_header* dh,
-                               dex_stats_t* stats,
-                               Parallel p) {
+size_t DexLoader::prepare(const dex_header* dh, DexClasses* classes) {
   if (dh->class_defs_size == 0) {
-    return DexClasses(0);
+    return 0;
   }
   m_idx = std::make_unique<DexIdx>(dh);
+  m_idx->load_strings();
   auto off = (uint64_t)dh->class_defs_off;
   m_class_defs =
       reinterpret_cast<const dex_class_def*>((const uint8_t*)dh + off);
-  DexClasses classes(dh->class_defs_size);
-  m_classes = &classes;
+  classes->resize(dh->class_defs_size);
+  m_classes = classes;
+  return dh->class_defs_size;
+}
+
+DexType* DexLoader::get_class_def_type(size_t num) {
+  return m_idx->get_typeidx(m_class_defs[num].typeidx);
+}
+
+void DexLoader::finish(const dex_header* dh,
+                       dex_stats_t* stats,
+                       DexClasses* classes) {
+  if (dh->class_defs_size == 0) {
+    return;
+  }
+
+  gather_input_stats(stats, dh);
+
+  // Remove nulls from the classes list. They may have been introduced by benign
+  // duplicate classes.
+  classes->erase(std::remove(classes->begin(), classes->end(), nullptr),
+                 classes->end());
+}
+
+DexClasses DexLoader::load_dex(const dex_header* dh,
+                               dex_stats_t* stats,
+                               Parallel p) {
+  DexClasses classes;
+  auto num_classes = prepare(dh, &classes);
+  if (num_classes == 0) {
+    return classes;
+  }
 
   switch (p) {
   case Parallel::kNo: {
-    for (size_t i = 0; i < dh->class_defs_size; ++i) {
+    for (size_t i = 0; i < num_classes; ++i) {
       load_dex_class(i);
     }
     break;
@@ -728,7 +792,7 @@ DexClasses DexLoader::load_dex(const dex_header* dh,
     std::vector<std::exception_ptr> all_exceptions;
     std::mutex all_exceptions_mutex;
     workqueue_run_for<size_t>(
-        0, dh->class_defs_size,
+        0, num_classes,
         [&all_exceptions, &all_exceptions_mutex, this](uint32_t num) {
           try {
             load_dex_class(num);
@@ -748,14 +812,23 @@ DexClasses DexLoader::load_dex(const dex_header* dh,
   }
   }
 
-  gather_input_stats(stats, dh);
+  finish(dh, stats, &classes);
+  return classes;
+}
 
-  // Remove nulls from the classes list. They may have been introduced by benign
-  // duplicate classes.
-  classes.erase(std::remove(classes.begin(), classes.end(), nullptr),
-                classes.end());
+static void trace_balloon_errors(const DexLoader::BalloonErrors& errors) {
+  if (errors.empty()) {
+    return;
+  }
+  std::ostringstream oss;
+  oss << "Error lifting DexCode to IRCode for the following methods:"
+      << std::endl;
+  for (const auto& [method, data] : errors) {
+    oss << show(method) << ": " << data.first << std::endl;
+  }
 
-  return classes;
+  TRACE(MAIN, 1, "%s" /* format string must be a string literal */,
+        oss.str().c_str());
 }
 
 static void balloon_all(const Scope& scope,
@@ -771,9 +844,7 @@ static void balloon_all(const Scope& scope,
     break;
   }
   case DexLoader::Parallel::kYes: {
-    InsertOnlyConcurrentMap<DexMethod*,
-                            std::pair<std::string, std::exception_ptr>>
-        ir_balloon_errors;
+    DexLoader::BalloonErrors ir_balloon_errors;
     walk::parallel::methods(scope, [&](DexMethod* m) {
       if (m->get_dex_code()) {
         try {
@@ -793,16 +864,7 @@ static void balloon_all(const Scope& scope,
         }
         throw aggregate_exception(std::move(all_exceptions));
       }
-
-      std::ostringstream oss;
-      oss << "Error lifting DexCode to IRCode for the following methods:"
-          << std::endl;
-      for (const auto& [method, data] : ir_balloon_errors) {
-        oss << show(method) << ": " << data.first << std::endl;
-      }
-
-      TRACE(MAIN, 1, "%s" /* format string must be a string literal */,
-            oss.str().c_str());
+      trace_balloon_errors(ir_balloon_errors);
     }
     break;
   }
@@ -828,10 +890,85 @@ DexClasses load_classes_from_dex(const DexLocation* location,
   TRACE(MAIN, 1, "Loading classes from dex from %s",
         location->get_file_name().c_str());
   DexLoader dl(location);
+  if (balloon) {
+    dl.set_balloon_on_load(throw_on_balloon_error);
+  }
   auto classes = dl.load_dex(location->get_file_name().c_str(), stats,
                              support_dex_version, p);
-  if (balloon) {
-    balloon_all(classes, throw_on_balloon_error, p);
+  trace_balloon_errors(dl.balloon_errors());
+  return classes;
+}
+
+std::vector<DexClasses> load_classes_from_dexes(
+    const std::vector<const DexLocation*>& locations,
+    std::vector<dex_stats_t>* stats,
+    bool balloon,
+    bool throw_on_balloon_error,
+    int support_dex_version) {
+  std::vector<std::unique_ptr<DexLoader>> loaders;
+  std::vector<const dex_header*> headers;
+  std::vector<DexClasses> classes(locations.size());
+  stats->resize(locations.size());
+  loaders.reserve(locations.size());
+  headers.reserve(locations.size());
+  for (auto* location : locations) {
+    TRACE(MAIN, 1, "Loading classes from dex from %s",
+          location->get_file_name().c_str());
+    auto& dl = loaders.emplace_back(std::make_unique<DexLoader>(location));
+    if (balloon) {
+      dl->set_balloon_on_load(throw_on_balloon_error);
+    }
+    headers.push_back(
+        dl->open_dex(location->get_file_name().c_str(), support_dex_version));
+  }
+
+  // Pick the winner among duplicate definitions up front, so that the outcome
+  // doesn't depend on which worker gets to a class first. The losers are
+  // loaded sequentially after all winners have been published, which gives
+  // them the same treatment (tracing, or throwing for non-benign duplicates)
+  // as in the single-dex path.
+  std::vector<std::pair<uint32_t, uint32_t>> tasks;
+  std::vector<std::pair<uint32_t, uint32_t>> duplicates;
+  std::unordered_set<DexType*> seen_types;
+  for (uint32_t i = 0; i < loaders.size(); ++i) {
+    auto num_classes = loaders[i]->prepare(headers[i], &classes[i]);
+    for (uint32_t num = 0; num < num_classes; ++num) {
+      auto* type = loaders[i]->get_class_def_type(num);
+      if (type == nullptr || seen_types.insert(type).second) {
+        tasks.emplace_back(i, num);
+      } else {
+        duplicates.emplace_back(i, num);
+      }
+    }
+  }
+
+  std::vector<std::exception_ptr> all_exceptions;
+  std::mutex all_exceptions_mutex;
+  workqueue_run<std::pair<uint32_t, uint32_t>>(
+      [&](std::pair<uint32_t, uint32_t> task) {
+        try {
+          loaders[task.first]->load_dex_class(task.second);
+        } catch (const std::exception& exc) {
+          TRACE(MAIN, 1, "Worker throw the exception:%s", exc.what());
+          std::lock_guard<std::mutex> lock_guard(all_exceptions_mutex);
+          all_exceptions.emplace_back(std::current_exception());
+        }
+      },
+      tasks);
+  if (!all_exceptions.empty()) {
+    aggregate_exception ae(all_exceptions);
+    throw ae;
+  }
+
+  for (auto& [i, num] : duplicates) {
+    loaders[i]->load_dex_class(num);
+  }
+
+  workqueue_run_for<size_t>(0, loaders.size(), [&](size_t i) {
+    loaders[i]->finish(headers[i], &stats->at(i), &classes[i]);
+  });
+  for (auto& dl : loaders) {
+    trace_balloon_errors(dl->balloon_errors());
   }
   return classes;
 }
@@ -842,10 +979,11 @@ DexClasses load_classes_from_dex(const dex_header* dh,
                                  bool throw_on_balloon_error,
                                  DexLoader::Parallel p) {
   DexLoader dl(location);
-  auto classes = dl.load_dex(dh, nullptr, p);
   if (balloon) {
-    balloon_all(classes, throw_on_balloon_error, p);
+    dl.set_balloon_on_load(throw_on_balloon_error);
   }
+  auto classes = dl.load_dex(dh, nullptr, p);
+  trace_balloon_errors(dl.balloon_errors());
   return classes;
 }
 
@@ -9,6 +9,7 @@
 
 #include <boost/iostreams/device/mapped_file.hpp>
 
+#include "ConcurrentContainers.h"
 #include "DexClass.h"
 #include "DexDefs.h"
 #include "DexIdx.h"
@@ -21,13 +22,21 @@ class DexLoader {
   DexClasses* m_classes;
   std::unique_ptr<boost::iostreams::mapped_file> m_file;
   const DexLocation* m_location;
+  bool m_balloon_on_load{false};
+  bool m_throw_on_balloon_error{true};
 
  public:
   enum class Parallel { kYes, kNo };
 
+  using BalloonErrors =
+      InsertOnlyConcurrentMap<DexMethod*,
+                              std::pair<std::string, std::exception_ptr>>;
+
   explicit DexLoader(const DexLocation* location);
 
   const dex_header* get_dex_header(const char* file_name);
+  // Maps the file and validates its header.
+  const dex_header* open_dex(const char* file_name, int support_dex_version);
   DexClasses load_dex(const char* file_name,
                       dex_stats_t* stats,
                       int support_dex_version,
@@ -36,8 +45,37 @@ class DexLoader {
                       dex_stats_t* stats,
                       Parallel p = Parallel::kYes);
   void load_dex_class(int num);
+
+  // The individual steps of load_dex, for callers that schedule the
+  // load_dex_class calls of several dex files themselves. `prepare` returns
+  // the number of class defs.
+  size_t prepare(const dex_header* dh, DexClasses* classes);
+  DexType* get_class_def_type(size_t num);
+  void finish(const dex_header* dh, dex_stats_t* stats, DexClasses* classes);
+
+  /*
+   * Convert the methods of each class to IRCode right after the class got
+   * loaded, instead of in a separate walk over all classes afterwards. The
+   * code items of a class are decoded while they are still hot in cache, and
+   * at any point in time only the DexCode of the classes currently being
+   * loaded is alive, instead of the DexCode of the whole dex.
+   *
+   * Balloon errors are collected in balloon_errors() unless throw_on_error is
+   * set.
+   */
+  void set_balloon_on_load(bool throw_on_error) {
+    m_balloon_on_load = true;
+    m_throw_on_balloon_error = throw_on_error;
+  }
+  const BalloonErrors& balloon_errors() const { return m_balloon_errors; }
+
   void gather_input_stats(dex_stats_t* stats, const dex_header* dh);
   DexIdx* get_idx() { return m_idx.get(); }
+
+ private:
+  void balloon_class(DexClass* cls);
+
+  BalloonErrors m_balloon_errors;
 };
 
 DexClasses load_classes_from_dex(
@@ -53,6 +91,18 @@ DexClasses load_classes_from_dex(
     bool throw_on_balloon_error = true,
     int support_dex_version = 35,
     DexLoader::Parallel p = DexLoader::Parallel::kYes);
+/*
+ * Loads the classes of several dex files, using one set of workers for all of
+ * them, and returns them in the order of `locations`. Duplicate classes are
+ * resolved deterministically: the first definition in `locations` order wins,
+ * independent of scheduling.
+ */
+std::vector<DexClasses> load_classes_from_dexes(
+    const std::vector<const DexLocation*>& locations,
+    std::vector<dex_stats_t>* stats,
+    bool balloon = true,
+    bool throw_on_balloon_error = true,
+    int support_dex_version = 35);
 DexClasses load_classes_from_dex(
     const dex_header* dh,
     const DexLocation* location,
@@ -9,8 +9,11 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <atomic>
 #include <bitset>
 #include <boost/filesystem.hpp>
+#include <boost/functional/hash.hpp>
+#include <condition_variable>
 #include <exception>
 #include <fcntl.h>
 #include <fstream>
@@ -18,6 +21,9 @@
 #include <inttypes.h>
 #include <list>
 #include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <unordered_set>
@@ -44,6 +50,7 @@
 #include "DexPosition.h"
 #include "DexUtil.h"
 #include "GlobalConfig.h"
+#include "IODIBuckets.h"
 #include "IODIMetadata.h"
 #include "IRCode.h"
 #include "Macros.h"
@@ -211,6 +218,8 @@ void GatheredTypes::sort_dexmethod_emitlist_method_similarity_order(
   }
 
   bool use_compression_conscious_order{false};
+  bool use_lsh_candidates{false};
+  uint32_t iterations_per_split{40};
   MethodSimilarityOrderingConfig* similarity_config{nullptr};
   if (global_config.has_config_by_name("method_similarity_order")) {
     similarity_config =
@@ -218,6 +227,8 @@ void GatheredTypes::sort_dexmethod_emitlist_method_similarity_order(
             "method_similarity_order");
     use_compression_conscious_order =
         similarity_config->use_compression_conscious_order;
+    use_lsh_candidates = similarity_config->use_lsh_candidates;
+    iterations_per_split = similarity_config->iterations_per_split;
   }
 
   if (similarity_config != nullptr &&
@@ -247,10 +258,11 @@ void GatheredTypes::sort_dexmethod_emitlist_method_similarity_order(
       perf_sensitive_methods.size(), remaining_methods.size());
 
   if (use_compression_conscious_order) {
-    MethodSimilarityCompressionConsciousOrderer method_orderer;
+    MethodSimilarityCompressionConsciousOrderer method_orderer(
+        iterations_per_split);
     method_orderer.order(remaining_methods, this);
   } else {
-    MethodSimilarityGreedyOrderer method_orderer;
+    MethodSimilarityGreedyOrderer method_orderer(use_lsh_candidates);
     method_orderer.order(remaining_methods);
   }
 
@@ -592,7 +604,7 @@ DexOutput::DexOutput(
                          ? get_dex_output_size(config_files) * 2
                          : get_dex_output_size(config_files)) +
                     k_output_red_zone),
-      m_output(std::make_unique<uint8_t[]>(m_output_size)),
+      m_output(static_cast<uint8_t*>(calloc(m_output_size, 1))),
       m_gtypes(std::move(gtypes)),
       m_dodx(m_gtypes->get_dodx(m_output.get())),
       // Required because the BytecodeDebugger setting creates huge amounts
@@ -602,8 +614,9 @@ DexOutput::DexOutput(
       m_config_files(config_files),
       m_min_sdk(min_sdk),
       m_dex_output_config(dex_output_config) {
-  // Ensure a clean slate.
-  memset(m_output.get(), 0, m_output_size);
+  always_assert_log(m_output != nullptr,
+                    "Cannot allocate %zu bytes for the dex output buffer",
+                    m_output_size);
 
   always_assert_log(
       m_dodx.method_to_idx().size() <= kMaxMethodRefs,
@@ -751,6 +764,11 @@ void DexOutput::generate_string_data(SortMode mode) {
     TRACE(CUSTOMSORT, 2, "using default string pool sorting");
     string_order = m_gtypes->get_dexstring_emitlist();
   }
+  if (m_dex_output_config.startup_data_first) {
+    std::stable_partition(
+        string_order.begin(), string_order.end(),
+        [&](const DexString* str) { return m_startup_strings.count(str); });
+  }
   dex_string_id* stringids =
       (dex_string_id*)(m_output.get() + hdr.string_ids_off);
 
@@ -765,6 +783,9 @@ void DexOutput::generate_string_data(SortMode mode) {
     TRACE(CUSTOMSORT, 3, "str emit %s", SHOW(str));
     stringids[idx].offset = m_offset;
     str->encode(m_output.get() + m_offset);
+    if (m_startup_strings.count(str)) {
+      m_startup_ranges.emplace_back(m_offset, str->get_entry_size());
+    }
     inc_offset(str->get_entry_size());
     m_stats.num_strings++;
   }
@@ -890,8 +911,16 @@ void DexOutput::generate_class_data_items() {
     dco[it.code] = offset;
   }
   dex_class_def* cdefs = (dex_class_def*)(m_output.get() + hdr.class_defs_off);
+  std::vector<uint32_t> class_order(hdr.class_defs_size);
+  std::iota(class_order.begin(), class_order.end(), 0);
+  if (m_dex_output_config.startup_data_first) {
+    std::stable_partition(class_order.begin(), class_order.end(),
+                          [&](uint32_t i) {
+                            return m_startup_classes.count(m_classes->at(i));
+                          });
+  }
   uint32_t count = 0;
-  for (uint32_t i = 0; i < hdr.class_defs_size; i++) {
+  for (uint32_t i : class_order) {
     DexClass* clz = m_classes->at(i);
     if (!clz->has_class_data()) continue;
     /* No alignment constraints for this data */
@@ -899,6 +928,9 @@ void DexOutput::generate_class_data_items() {
     if (m_dex_output_config.write_class_sizes) {
       m_stats.class_size[clz] = size;
     }
+    if (m_startup_classes.count(clz)) {
+      m_startup_ranges.emplace_back(m_offset, size);
+    }
     cdefs[i].class_data_offset = m_offset;
     inc_offset(size);
     count += 1;
@@ -922,15 +954,92 @@ static void sync_all(const Scope& scope) {
   }
 }
 
-void DexOutput::generate_code_items(const std::vector<SortMode>& mode) {
-  TRACE(MAIN, 2, "generate_code_items");
-  /*
-   * Optimization note:  We should pass a sort routine to the
-   * emitlist to optimize pagecache efficiency.
-   */
-  uint32_t ci_start = align(m_offset);
-  sync_all(*m_classes);
+namespace {
+
+constexpr uint32_t k_page_size = 4096;
+
+bool crosses_page(uint32_t offset, uint32_t size) {
+  return size > 0 && offset / k_page_size != (offset + size - 1) / k_page_size;
+}
+
+// Returns the order in which to lay out code items with the given sizes,
+// starting at the given offset. Whenever a startup code item that fits into a
+// page would cross into the next one, the following startup code items that
+// still fit into the current page are moved ahead of it.
+std::vector<size_t> pack_startup_code_items(uint32_t offset,
+                                            const std::vector<int>& sizes,
+                                            const std::vector<bool>& startup) {
+  // How far ahead to look for code items to fill a page with.
+  constexpr size_t k_lookahead = 64;
+  auto align = [](uint32_t o) { return (o + 3) & ~3; };
+  std::vector<size_t> order;
+  order.reserve(sizes.size());
+  std::vector<bool> placed(sizes.size());
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    if (placed[i]) {
+      continue;
+    }
+    offset = align(offset);
+    if (startup[i] && (uint32_t)sizes[i] <= k_page_size &&
+        crosses_page(offset, sizes[i])) {
+      auto next_page = (offset / k_page_size + 1) * k_page_size;
+      for (size_t j = i + 1; j < sizes.size() && j <= i + k_lookahead; ++j) {
+        if (!placed[j] && startup[j] && offset + sizes[j] <= next_page) {
+          order.push_back(j);
+          placed[j] = true;
+          offset = align(offset + sizes[j]);
+        }
+      }
+    }
+    order.push_back(i);
+    placed[i] = true;
+    offset += sizes[i];
+  }
+  return order;
+}
 
+// An upper bound on the number of bytes DexCode::encode writes.
+size_t max_code_item_size(const DexCode* code) {
+  size_t insns_size = 0;
+  for (auto const& opc : code->get_instructions()) {
+    insns_size += opc->size();
+  }
+  // One more code unit for the padding before the tries.
+  size_t size = sizeof(dex_code_item) + (insns_size + 1) * sizeof(uint16_t);
+  // The handler list size, as a uleb128.
+  size += 5;
+  for (auto const& dextry : code->get_tries()) {
+    // The try item, and a handler with a sleb128 count and up to two uleb128
+    // values per catch.
+    size += sizeof(dex_tries_item) + 5 + dextry->m_catches.size() * 10;
+  }
+  return size;
+}
+
+// Encodes every distinct item of `items` once, in parallel, as the encodings
+// only read the index maps, and the maps of previously written items. Returns
+// the distinct items in order of first occurrence, along with their encodings.
+template <typename Item, typename Bytes, typename EncodeFn>
+std::pair<std::vector<Item*>, std::vector<Bytes>> encode_distinct(
+    const std::vector<Item*>& items, const EncodeFn& encode) {
+  std::vector<Item*> distinct;
+  std::unordered_set<Item*> seen;
+  for (auto* item : items) {
+    if (seen.insert(item).second) {
+      distinct.push_back(item);
+    }
+  }
+  std::vector<Bytes> encoded(distinct.size());
+  workqueue_run_for<size_t>(0, distinct.size(), [&](size_t i) {
+    encode(distinct[i], encoded[i]);
+  });
+  return {std::move(distinct), std::move(encoded)};
+}
+
+} // namespace
+
+std::vector<DexMethod*> DexOutput::get_code_item_emitlist(
+    const std::vector<SortMode>& mode) {
   // Get all methods.
   std::vector<DexMethod*> lmeth = m_gtypes->get_dexmethod_emitlist();
 
@@ -969,21 +1078,137 @@ void DexOutput::generate_code_items(const std::vector<SortMode>& mode) {
       break;
     }
   }
+  if (m_dex_output_config.startup_data_first) {
+    std::stable_partition(lmeth.begin(), lmeth.end(),
+                          [&](DexMethod* meth) { return is_startup(meth); });
+  }
+  std::vector<DexMethod*> emitted;
   for (DexMethod* meth : lmeth) {
     if (meth->get_access() & (ACC_ABSTRACT | ACC_NATIVE)) {
       // There is no code item for ABSTRACT or NATIVE methods.
       continue;
     }
-    TRACE(CUSTOMSORT, 3, "method emit %s %s", SHOW(meth->get_class()),
-          SHOW(meth));
-    DexCode* code = meth->get_dex_code();
     always_assert_log(
-        meth->is_concrete() && code != nullptr,
+        meth->is_concrete() && meth->get_dex_code() != nullptr,
         "Undefined method in generate_code_items()\n\t prototype: %s\n",
         SHOW(meth));
+    emitted.push_back(meth);
+  }
+  return emitted;
+}
+
+void DexOutput::generate_code_items(const std::vector<SortMode>& mode) {
+  TRACE(MAIN, 2, "generate_code_items");
+  /*
+   * Optimization note:  We should pass a sort routine to the
+   * emitlist to optimize pagecache efficiency.
+   */
+  uint32_t ci_start = align(m_offset);
+  sync_all(*m_classes);
+
+  auto emitted = get_code_item_emitlist(mode);
+
+  // Encoding only reads the (by now fixed) index maps, so all code items are
+  // encoded in parallel into separate buffers first. A serial pass then lays
+  // them out in order and copies the bytes.
+  std::vector<std::vector<uint32_t>> encoded(emitted.size());
+  std::vector<int> sizes(emitted.size());
+  workqueue_run_for<size_t>(0, emitted.size(), [&](size_t i) {
+    DexCode* code = emitted[i]->get_dex_code();
+    auto max_size = max_code_item_size(code);
+    encoded[i].resize((max_size + 3) / 4);
+    sizes[i] = code->encode(&m_dodx, encoded[i].data());
+    always_assert(sizes[i] >= 0 && (size_t)sizes[i] <= max_size);
+  });
+
+  // The encodings do not depend on the order, so alternative orderings can be
+  // estimated without encoding again.
+  if (!m_code_sort_mode_candidates.empty()) {
+    std::unordered_map<DexMethod*, size_t> indices;
+    for (size_t i = 0; i < emitted.size(); ++i) {
+      indices.emplace(emitted[i], i);
+    }
+    auto estimate = [&](const std::vector<DexMethod*>& order) {
+      std::vector<uint8_t> bytes;
+      for (auto* meth : order) {
+        auto i = indices.at(meth);
+        bytes.resize(align(bytes.size()));
+        auto* data = reinterpret_cast<const uint8_t*>(encoded[i].data());
+        bytes.insert(bytes.end(), data, data + sizes[i]);
+      }
+      return estimate_deflated_size(bytes.data(), bytes.size());
+    };
+    auto configured_estimate = estimate(emitted);
+    auto best_estimate = configured_estimate;
+    std::optional<size_t> best_candidate;
+    for (size_t c = 0; c < m_code_sort_mode_candidates.size(); ++c) {
+      auto order = get_code_item_emitlist(m_code_sort_mode_candidates[c]);
+      always_assert(order.size() == emitted.size());
+      auto candidate_estimate = estimate(order);
+      TRACE(OPUT, 3, "[code sort] candidate %zu: ~%zu deflated bytes", c,
+            candidate_estimate);
+      if (candidate_estimate < best_estimate) {
+        best_estimate = candidate_estimate;
+        best_candidate = c;
+        emitted = std::move(order);
+      }
+    }
+    if (best_candidate) {
+      TRACE(OPUT, 2,
+            "[code sort] chose candidate %zu: ~%zu instead of ~%zu deflated "
+            "bytes",
+            *best_candidate, best_estimate, configured_estimate);
+      std::vector<std::vector<uint32_t>> permuted(emitted.size());
+      std::vector<int> permuted_sizes(emitted.size());
+      for (size_t i = 0; i < emitted.size(); ++i) {
+        auto j = indices.at(emitted[i]);
+        permuted[i] = std::move(encoded[j]);
+        permuted_sizes[i] = sizes[j];
+      }
+      encoded = std::move(permuted);
+      sizes = std::move(permuted_sizes);
+      m_stats.num_code_sort_candidate_wins++;
+    }
+    m_stats.code_estimated_deflated_bytes += best_estimate;
+    m_stats.code_estimated_deflated_savings +=
+        configured_estimate - best_estimate;
+  }
+
+  if (m_dex_output_config.pack_startup_code_pages) {
+    std::vector<bool> startup(emitted.size());
+    for (size_t i = 0; i < emitted.size(); ++i) {
+      startup[i] = is_startup(emitted[i]);
+    }
+    auto order = pack_startup_code_items(ci_start, sizes, startup);
+    std::vector<DexMethod*> packed(emitted.size());
+    std::vector<std::vector<uint32_t>> packed_encoded(emitted.size());
+    std::vector<int> packed_sizes(emitted.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      packed[i] = emitted[order[i]];
+      packed_encoded[i] = std::move(encoded[order[i]]);
+      packed_sizes[i] = sizes[order[i]];
+    }
+    emitted = std::move(packed);
+    encoded = std::move(packed_encoded);
+    sizes = std::move(packed_sizes);
+  }
+
+  for (size_t i = 0; i < emitted.size(); ++i) {
+    DexMethod* meth = emitted[i];
+    TRACE(CUSTOMSORT, 3, "method emit %s %s", SHOW(meth->get_class()),
+          SHOW(meth));
+    DexCode* code = meth->get_dex_code();
     align_output();
-    int size = code->encode(&m_dodx, (uint32_t*)(m_output.get() + m_offset));
+    int size = sizes[i];
     check_method_instruction_size_limit(m_config_files, size, SHOW(meth));
+    memcpy(m_output.get() + m_offset, encoded[i].data(), size);
+    if (is_startup(meth)) {
+      m_startup_ranges.emplace_back(m_offset, size);
+      if (crosses_page(m_offset, size)) {
+        m_stats.num_startup_code_page_crossings++;
+      }
+    }
+    std::vector<uint32_t>().swap(encoded[i]);
     m_method_bytecode_offsets.emplace_back(meth->get_name()->c_str(), m_offset);
     m_code_item_emits.emplace_back(meth, code,
                                    (dex_code_item*)(m_output.get() + m_offset));
@@ -1125,10 +1350,15 @@ void DexOutput::unique_annotations(annomap_t& annomap,
   int annocnt = 0;
   uint32_t mentry_offset = m_offset;
   std::map<std::vector<uint8_t>, uint32_t> annotation_byte_offsets;
-  for (auto anno : annolist) {
+  auto [distinct, encoded] = encode_distinct<DexAnnotation,
+                                             std::vector<uint8_t>>(
+      annolist, [&](DexAnnotation* anno, std::vector<uint8_t>& bytes) {
+        anno->vencode(&m_dodx, bytes);
+      });
+  for (size_t i = 0; i < distinct.size(); ++i) {
+    auto* anno = distinct[i];
     if (annomap.count(anno)) continue;
-    std::vector<uint8_t> annotation_bytes;
-    anno->vencode(&m_dodx, annotation_bytes);
+    const auto& annotation_bytes = encoded[i];
     if (annotation_byte_offsets.count(annotation_bytes)) {
       annomap[anno] = annotation_byte_offsets[annotation_bytes];
       continue;
@@ -1155,10 +1385,15 @@ void DexOutput::unique_asets(annomap_t& annomap,
   int asetcnt = 0;
   uint32_t mentry_offset = align(m_offset);
   std::map<std::vector<uint32_t>, uint32_t> aset_offsets;
-  for (auto aset : asetlist) {
+  auto [distinct, encoded] = encode_distinct<DexAnnotationSet,
+                                             std::vector<uint32_t>>(
+      asetlist, [&](DexAnnotationSet* aset, std::vector<uint32_t>& bytes) {
+        aset->vencode(&m_dodx, bytes, annomap);
+      });
+  for (size_t i = 0; i < distinct.size(); ++i) {
+    auto* aset = distinct[i];
     if (asetmap.count(aset)) continue;
-    std::vector<uint32_t> aset_bytes;
-    aset->vencode(&m_dodx, aset_bytes, annomap);
+    const auto& aset_bytes = encoded[i];
     if (aset_offsets.count(aset_bytes)) {
       asetmap[aset] = aset_offsets[aset_bytes];
       continue;
@@ -1222,10 +1457,16 @@ void DexOutput::unique_adirs(asetmap_t& asetmap,
   int adircnt = 0;
   uint32_t mentry_offset = align(m_offset);
   std::map<std::vector<uint32_t>, uint32_t> adir_offsets;
-  for (auto adir : adirlist) {
+  auto [distinct, encoded] = encode_distinct<DexAnnotationDirectory,
+                                             std::vector<uint32_t>>(
+      adirlist,
+      [&](DexAnnotationDirectory* adir, std::vector<uint32_t>& bytes) {
+        adir->vencode(&m_dodx, bytes, xrefmap, asetmap);
+      });
+  for (size_t i = 0; i < distinct.size(); ++i) {
+    auto* adir = distinct[i];
     if (adirmap.count(adir)) continue;
-    std::vector<uint32_t> adir_bytes;
-    adir->vencode(&m_dodx, adir_bytes, xrefmap, asetmap);
+    const auto& adir_bytes = encoded[i];
     if (adir_offsets.count(adir_bytes)) {
       adirmap[adir] = adir_offsets[adir_bytes];
       continue;
@@ -1337,23 +1578,12 @@ int emit_debug_info_for_metadata(DexOutputIdx* dodx,
   return size;
 }
 
-int emit_debug_info(
-    DexOutputIdx* dodx,
-    bool emit_positions,
-    DexDebugItem* dbg,
-    DexCode* dc,
-    dex_code_item* dci,
-    PositionMapper* pos_mapper,
-    uint8_t* output,
-    uint32_t offset,
+// An upper bound of the size of an encoded debug info item: every uleb128
+// takes at most 5 bytes, and every debug opcode has at most four operands.
+size_t max_debug_info_size(
     uint32_t num_params,
-    std::unordered_map<DexCode*, std::vector<DebugLineItem>>* dbg_lines) {
-  // No align requirement for debug items.
-  DebugMetadata metadata = calculate_debug_metadata(
-      dbg, dc, dci, pos_mapper, num_params, dbg_lines, /*line_addin=*/0);
-  return emit_positions
-             ? emit_debug_info_for_metadata(dodx, metadata, output, offset)
-             : 0;
+    const std::vector<std::unique_ptr<DexDebugInstruction>>& dbgops) {
+  return 5 + 5 + num_params * 5 + dbgops.size() * (1 + 4 * 5) + 1;
 }
 
 struct MethodKey {
@@ -1439,6 +1669,19 @@ struct ParamSizeOrder {
   }
 };
 
+// The size of an IODI debug program without its line entries: the line start,
+// the parameter count and names, and the end of the sequence.
+uint32_t iodi_program_header_size(uint32_t param_size) {
+  uint32_t size = 1 + 1 + param_size + 1;
+  if (param_size >= 128) {
+    size += 1;
+    if (param_size >= 16384) {
+      size += 1;
+    }
+  }
+  return size;
+}
+
 uint32_t emit_instruction_offset_debug_info_helper(
     DexOutputIdx* dodx,
     PositionMapper* pos_mapper,
@@ -1613,111 +1856,30 @@ uint32_t emit_instruction_offset_debug_info_helper(
     using Iter = DebugMethodMap::const_iterator;
 
     // Bucket the set of methods specified by begin, end into appropriately
-    // sized buckets.
+    // sized buckets, so that no debug program inflates beyond
+    // MAX_BUCKET_INFLATED_SIZE, with as few program bytes as possible (see
+    // IODIBuckets.h).
     // Returns a pair:
-    // - A vector of {IODI size, method count} describing each bucket
+    // - A vector of buckets, each with its program length and method count
     // - A size_t reflecting the total inflated footprint using the returned
     //   bucketing
-    // If dry_run is specified then no allocations will be done and the vector
-    // will be emptied (this is used to query for the total inflation size).
-    auto create_buckets = [](Iter begin, Iter end, bool dry_run = false) {
-      // In order to understand this algorithm let's first define what
-      // the "inflated size" of an debug program is:
-      //
-      // The inflated size of a debug program D is the number of entries that
-      // dex2oat will create in a vector when inflating debug info into IR. This
-      // factor is computed as len(D) * ${number of methods using D}.
-      //
-      // Now, this function splits one large IODI program into multiple in order
-      // to reduce the inflated size of each debug program. We must do this so
-      // that dex2oat doesn't OOM. The algorithm proceeds as follows:
-      //
-      // - Define a max bucket size: MAX_BUCKET_INFLATED_SIZE. This is the limit
-      //   on the inflated size of any given IODI debug program. We use this to
-      //   determine how many buckets will be created.
-      // - Since len(D) = max{ len(method) | method uses D } given D a debug
-      //   program we can iterate from largest method to smallest, attempting
-      //   to add the next smallest program into the current bucket and
-      //   otherwise cutting the current bucket off. In pseudo code this is:
-      //
-      //   for method in methods, partially ordered from largest to smallest:
-      //     if method can fit in current bucket:
-      //       add method to current bucket
-      //     else
-      //       close up the current bucket and start a new one for method
-      //
-      //   There must be a precondition that the current bucket contains at
-      //   least one method, otherwise we may run into empty buckets and
-      //   silently ignored methods. We can prove that this by induction. First
-      //   some terminology:
-      //
-      //   bucket_n := The nth bucket that has been created, starting at 0
-      //   method_i := The ith largest method that's iterated over
-      //
-      //   Additionally we know that:
-      //
-      //   inflated_size(bucket_n) = max{ len(M) | M \in bucket_n }
-      //                                  * len(bucket_n)
-      //   and inflated_size(bucket_n) < MAX_BUCKET_INFLATED_SIZE
-      //
-      //   To establish the base case let's filter our set of methods to
-      //     filtered_methods = { M \in methods
-      //                            | len(methods) < MAX_BUCKET_INFLATED_SIZE }
-      //   Now we have method_0 \in filtered_methods is such that
-      //    len(method_0) < MAX_BUCKET_INFLATED_SIZE
-      //   so bucket_0 can at least contain method_0 and thus is non-empty.
-      //
-      //   For the inductive case fix N to be the index of the current bucket
-      //   and I to be the index of a method that cannot fit in the current
-      //   bucket, then we know bucket_N is non-empty (by our inductive
-      //   hypothesis) and thus, by above \exists M \in bucket_N exists s.t.
-      //   len(M) < MAX_BUCKET_INFLATED_SIZE. We know that
-      //   len(method_I) <= len(M) because the methods are partially ordered
-      //   from largest to smallest and method_I comes after M. Thus we
-      //   determine that len(method_I) <= len(M) < MAX_BUCKET_INFLATED_SIZE
-      //   and so method_I can fit into bucket_{N+1}.
-      //
-      // No logic here, just picking 2^{some power} so that vectors don't
-      // unnecessarily expand when inflating debug info for the current bucket.
-      static constexpr size_t MAX_BUCKET_INFLATED_SIZE = 2 * 2 * 2 * 1024;
-      std::vector<std::pair<uint32_t, uint32_t>> result;
-      size_t total_inflated_footprint = 0;
-      if (begin == end) {
-        return std::make_pair(result, total_inflated_footprint);
-      }
-      uint32_t bucket_size = 0;
-      uint32_t bucket_count = 0;
-      auto append_bucket = [&](uint32_t size, uint32_t count) {
-        total_inflated_footprint += size * count;
-        if (!dry_run) {
-          result.emplace_back(size, count);
-        }
-      };
-      // To start we need to bucket any method that's too big for its own good
-      // into its own bucket (this ensures the buckets calculated below contain
-      // at least one entry).
-      while (begin != end && begin->first.size > MAX_BUCKET_INFLATED_SIZE) {
-        append_bucket(begin->first.size, 1);
-        begin++;
-      }
-      for (auto iter = begin; iter != end; iter++) {
-        uint32_t next_size = std::max(bucket_size, iter->first.size);
-        uint32_t next_count = bucket_count + 1;
-        size_t inflated_footprint = next_size * next_count;
-        if (inflated_footprint > MAX_BUCKET_INFLATED_SIZE) {
-          always_assert(bucket_size != 0 && bucket_count != 0);
-          append_bucket(bucket_size, bucket_count);
-          bucket_size = 0;
-          bucket_count = 0;
-        } else {
-          bucket_size = next_size;
-          bucket_count = next_count;
-        }
+    //
+    // No logic here, just picking 2^{some power} so that vectors don't
+    // unnecessarily expand when inflating debug info for the current bucket.
+    static constexpr size_t MAX_BUCKET_INFLATED_SIZE = 2 * 2 * 2 * 1024;
+    auto create_buckets = [param_size](Iter begin, Iter end) {
+      std::vector<uint32_t> sizes;
+      for (auto it = begin; it != end; ++it) {
+        sizes.push_back(it->first.size);
       }
-      if (bucket_size > 0 && bucket_count > 0) {
-        append_bucket(bucket_size, bucket_count);
+      auto buckets =
+          iodi::optimal_buckets(sizes, MAX_BUCKET_INFLATED_SIZE,
+                                iodi_program_header_size(param_size));
+      size_t total_inflated_footprint = 0;
+      for (const auto& bucket : buckets) {
+        total_inflated_footprint += (size_t)bucket.size * bucket.count;
       }
-      return std::make_pair(result, total_inflated_footprint);
+      return std::make_pair(std::move(buckets), total_inflated_footprint);
     };
 
     auto compute = [&](const auto& sizes, bool dry_run) -> size_t {
@@ -1731,7 +1893,7 @@ uint32_t emit_instruction_offset_debug_info_helper(
       // methods small enough for the given constraints.
       size_t total_inflated_size = 0;
       do {
-        total_inflated_size = create_buckets(best_iter, end, true).second;
+        total_inflated_size = create_buckets(best_iter, end).second;
       } while (total_inflated_size > MAX_INFLATED_SIZE && ++best_iter != end);
       size_t total_ignored = std::distance(sizes.begin(), best_iter);
       if (!dry_run) {
@@ -1840,14 +2002,7 @@ uint32_t emit_instruction_offset_debug_info_helper(
       }
 
       size_t insns_size = best_iter != end ? best_iter->first.size : 0;
-      size_t padding = 1 + 1 + param_size + 1;
-      if (param_size >= 128) {
-        padding += 1;
-        if (param_size >= 16384) {
-          padding += 1;
-        }
-      }
-      auto iodi_size = insns_size + padding;
+      auto iodi_size = insns_size + iodi_program_header_size(param_size);
 
       if (requires_iodi_programs) {
         if (total_normal_dbg_cost < iodi_size) {
@@ -1896,6 +2051,12 @@ uint32_t emit_instruction_offset_debug_info_helper(
         if (num_small_enough == 0) {
           return 0;
         }
+        if (traceEnabled(IODI, 5)) {
+          // The size distribution that tools/iodi-buckets-bench replays.
+          for (auto it = best_iter; it != end; it++) {
+            TRACE(IODI, 5, "[IODI][size] %u %u", param_size, it->first.size);
+          }
+        }
         auto bucket_res = create_buckets(best_iter, end);
         auto& buckets = bucket_res.first;
         total_inflated_size = bucket_res.second;
@@ -1906,8 +2067,8 @@ uint32_t emit_instruction_offset_debug_info_helper(
               param_size, buckets.size(), total_inflated_size);
         auto& size_to_offset = param_size_to_oset[param_size];
         for (auto& bucket : buckets) {
-          auto bucket_size = bucket.first;
-          TRACE(IODI, 3, "  - %u methods in bucket size %u @ %u", bucket.second,
+          auto bucket_size = bucket.size;
+          TRACE(IODI, 3, "  - %u methods in bucket size %u @ %u", bucket.count,
                 bucket_size, offset);
           size_to_offset.emplace(bucket_size, offset);
           std::vector<std::unique_ptr<DexDebugInstruction>> dbgops;
@@ -2244,17 +2405,82 @@ void DexOutput::generate_debug_items() {
               "[IODI] WARNING: Not using IODI because no iodi metadata file was"
               " specified.\n");
     }
+    // The position mapper assigns lines in the order in which it sees
+    // positions, so positions are mapped serially, in emit order. Generating
+    // and encoding the debug programs then only reads shared state, and
+    // happens in parallel.
+    std::vector<const CodeItemEmit*> emits;
+    std::vector<std::vector<uint32_t>> lines;
     for (auto& it : m_code_item_emits) {
-      DexCode* dc = it.code;
-      dex_code_item* dci = it.code_item;
-      auto dbg = dc->get_debug_item();
+      auto dbg = it.code->get_debug_item();
       if (dbg == nullptr) continue;
+      emits.push_back(&it);
+      lines.push_back(map_debug_positions(dbg, m_pos_mapper));
+    }
+    struct EncodedDebugItem {
+      std::vector<uint8_t> bytes;
+      size_t hash{0};
+      std::vector<DebugLineItem> line_info;
+    };
+    std::vector<EncodedDebugItem> encoded(emits.size());
+    workqueue_run_for<size_t>(0, emits.size(), [&](size_t i) {
+      const auto* it = emits[i];
+      auto& enc = encoded[i];
+      uint32_t line_start = 0;
+      auto dbgops = generate_debug_instructions(it->code->get_debug_item(),
+                                                lines[i], &line_start,
+                                                &enc.line_info,
+                                                /*line_addin=*/0);
+      if (!emit_positions) {
+        return;
+      }
+      uint32_t num_params = it->method->get_proto()->get_args()->size();
+      auto max_size = max_debug_info_size(num_params, dbgops);
+      enc.bytes.resize(max_size);
+      auto size = DexDebugItem::encode(&m_dodx, enc.bytes.data(), line_start,
+                                       num_params, dbgops);
+      always_assert(size >= 0 && (size_t)size <= max_size);
+      enc.bytes.resize(size);
+      enc.hash = boost::hash_range(enc.bytes.begin(), enc.bytes.end());
+    });
+
+    std::vector<uint32_t> offsets(emits.size());
+    std::unordered_map<size_t, std::vector<size_t>> emitted_by_hash;
+    size_t num_shared = 0;
+    for (size_t i = 0; i < emits.size(); ++i) {
+      const auto* it = emits[i];
+      auto& enc = encoded[i];
+      if (m_code_debug_lines != nullptr) {
+        (*m_code_debug_lines)[it->code] = std::move(enc.line_info);
+      }
+      if (!emit_positions) {
+        dbgcount++;
+        continue;
+      }
+      if (m_dex_output_config.dedup_debug_items) {
+        auto& candidates = emitted_by_hash[enc.hash];
+        auto same = std::find_if(
+            candidates.begin(), candidates.end(),
+            [&](size_t j) { return encoded[j].bytes == enc.bytes; });
+        if (same != candidates.end()) {
+          offsets[i] = offsets[*same];
+          it->code_item->debug_info_off = offsets[i];
+          num_shared++;
+          continue;
+        }
+        candidates.push_back(i);
+      }
       dbgcount++;
-      size_t num_params = it.method->get_proto()->get_args()->size();
-      inc_offset(emit_debug_info(&m_dodx, emit_positions, dbg, dc, dci,
-                                 m_pos_mapper, m_output.get(), m_offset,
-                                 num_params, m_code_debug_lines));
+      offsets[i] = m_offset;
+      it->code_item->debug_info_off = m_offset;
+      memcpy(m_output.get() + m_offset, enc.bytes.data(), enc.bytes.size());
+      if (is_startup(it->method)) {
+        m_startup_ranges.emplace_back(m_offset, enc.bytes.size());
+      }
+      inc_offset(enc.bytes.size());
     }
+    TRACE(OPUT, 2, "Shared %zu of %zu debug info items", num_shared,
+          emits.size());
   }
   if (emit_positions) {
     insert_map_item(TYPE_DEBUG_INFO_ITEM, dbgcount, dbg_start,
@@ -2264,6 +2490,60 @@ void DexOutput::generate_debug_items() {
   m_stats.dbg_total_size += m_offset - dbg_start;
 }
 
+void DexOutput::gather_startup_classes(ConfigFiles& conf) {
+  // Classes ordered by the betamap are perf sensitive; other classes are
+  // touched during cold start if any of their methods is profiled there.
+  const method_profiles::StatsMap* cold_start_stats = nullptr;
+  auto& method_profiles = conf.get_method_profiles();
+  if (method_profiles.is_initialized()) {
+    cold_start_stats =
+        &method_profiles.method_stats(method_profiles::COLD_START);
+  }
+  for (auto* cls : *m_classes) {
+    bool startup = cls->is_perf_sensitive();
+    if (!startup && cold_start_stats != nullptr) {
+      auto methods = cls->get_all_methods();
+      startup = std::any_of(methods.begin(), methods.end(), [&](auto* m) {
+        return cold_start_stats->count(m);
+      });
+    }
+    if (!startup) {
+      continue;
+    }
+    m_startup_classes.insert(cls);
+    cls->gather_strings(m_startup_strings);
+    std::vector<DexType*> types;
+    cls->gather_types(types);
+    for (auto* type : types) {
+      m_startup_strings.insert(type->get_name());
+    }
+  }
+}
+
+bool DexOutput::is_startup(const DexMethod* method) const {
+  return m_startup_classes.count(type_class(method->get_class()));
+}
+
+void DexOutput::count_startup_pages() {
+  std::vector<bool> touched(m_offset / k_page_size + 1);
+  for (auto [offset, size] : m_startup_ranges) {
+    if (size == 0) {
+      continue;
+    }
+    auto last_page = (offset + size - 1) / k_page_size;
+    for (auto page = offset / k_page_size; page <= last_page; page++) {
+      touched[page] = true;
+    }
+  }
+  m_stats.num_startup_pages = std::count(touched.begin(), touched.end(), true);
+  TRACE(OPUT, 2,
+        "[startup] %zu startup classes touch %d of %u pages of dex %zu",
+        m_startup_classes.size(), m_stats.num_startup_pages,
+        m_offset / k_page_size + 1, m_dex_number);
+  TRACE(OPUT, 2, "[startup] %d startup code items cross a page boundary",
+        m_stats.num_startup_code_page_crossings);
+}
+
 void DexOutput::generate_map() {
   align_output();
   uint32_t* mapout = (uint32_t*)(m_output.get() + m_offset);
@@ -2786,6 +3066,9 @@ void DexOutput::prepare(SortMode string_mode,
                         ConfigFiles& conf,
                         const std::string& dex_magic) {
   m_gtypes->set_config(&conf);
+  m_code_sort_mode_candidates = get_code_sort_mode_candidates(
+      conf, m_store_name != nullptr ? *m_store_name : "");
+  gather_startup_classes(conf);
 
   fix_jumbos(m_classes, &m_dodx);
   init_header_offsets(dex_magic);
@@ -2804,24 +3087,40 @@ void DexOutput::prepare(SortMode string_mode,
   generate_annotations();
   generate_debug_items();
   generate_map();
+  count_startup_pages();
   finalize_header();
   compute_method_to_id_map(&m_dodx, m_classes, hdr.signature, m_method_to_id);
 }
 
 void DexOutput::write() {
+  write_dex_file();
+  write_symbol_files();
+}
+
+void DexOutput::write_dex_file() {
   struct stat st;
   int fd = open(m_filename, O_CREAT | O_TRUNC | O_WRONLY | O_BINARY, 0660);
   if (fd == -1) {
     perror("Error writing dex");
     return;
   }
-  ::write(fd, m_output.get(), m_offset);
+  // A single write may be cut short for large images.
+  const uint8_t* data = m_output.get();
+  size_t remaining = m_offset;
+  while (remaining > 0) {
+    auto written = ::write(fd, data, remaining);
+    if (written <= 0) {
+      perror("Error writing dex");
+      break;
+    }
+    data += written;
+    remaining -= written;
+  }
   if (0 == fstat(fd, &st)) {
     m_stats.num_bytes = st.st_size;
   }
   close(fd);
-
-  write_symbol_files();
+  m_output.reset();
 }
 
 class UniqueReferences {
@@ -2908,10 +3207,10 @@ static SortMode make_sort_bytecode(const std::string& sort_bytecode) {
   }
 }
 
-std::vector<SortMode> get_code_sort_mode(ConfigFiles& conf,
-                                         const std::string& store_name) {
-  const JsonWrapper& json_cfg = conf.get_json_config();
-  auto sort_bytecode_cfg = json_cfg.get("bytecode_sort_mode", Json::Value());
+static std::vector<SortMode> parse_code_sort_mode(
+    const Json::Value& sort_bytecode_cfg,
+    ConfigFiles& conf,
+    const std::string& store_name) {
   std::vector<SortMode> code_sort_mode;
 
   if (sort_bytecode_cfg.isString()) {
@@ -2945,6 +3244,55 @@ std::vector<SortMode> get_code_sort_mode(ConfigFiles& conf,
   return code_sort_mode;
 }
 
+std::vector<SortMode> get_code_sort_mode(ConfigFiles& conf,
+                                         const std::string& store_name) {
+  const JsonWrapper& json_cfg = conf.get_json_config();
+  auto sort_bytecode_cfg = json_cfg.get("bytecode_sort_mode", Json::Value());
+  return parse_code_sort_mode(sort_bytecode_cfg, conf, store_name);
+}
+
+std::vector<std::vector<SortMode>> get_code_sort_mode_candidates(
+    ConfigFiles& conf, const std::string& store_name) {
+  const JsonWrapper& json_cfg = conf.get_json_config();
+  auto candidates_cfg =
+      json_cfg.get("bytecode_sort_mode_candidates", Json::Value());
+  std::vector<std::vector<SortMode>> candidates;
+  for (const auto& candidate_cfg : candidates_cfg) {
+    candidates.push_back(parse_code_sort_mode(candidate_cfg, conf, store_name));
+  }
+  return candidates;
+}
+
+size_t estimate_deflated_size(const uint8_t* data, size_t size) {
+  constexpr size_t WINDOW_SIZE = 64 * 1024;
+  constexpr size_t MAX_SAMPLED_WINDOWS = 64;
+  size_t num_windows = (size + WINDOW_SIZE - 1) / WINDOW_SIZE;
+  if (num_windows == 0) {
+    return 0;
+  }
+  // Compress every stride-th window independently, which is what bounds the
+  // estimation time, and extrapolate from the sampled windows.
+  size_t stride = (num_windows + MAX_SAMPLED_WINDOWS - 1) / MAX_SAMPLED_WINDOWS;
+  size_t num_sampled = (num_windows + stride - 1) / stride;
+  std::vector<size_t> sampled_in(num_sampled);
+  std::vector<size_t> sampled_out(num_sampled);
+  workqueue_run_for<size_t>(0, num_sampled, [&](size_t i) {
+    size_t begin = i * stride * WINDOW_SIZE;
+    size_t len = std::min(WINDOW_SIZE, size - begin);
+    uLongf out_len = compressBound(len);
+    auto out = std::make_unique<Bytef[]>(out_len);
+    auto res = compress2(out.get(), &out_len, data + begin, len, 1);
+    always_assert_log(res == Z_OK, "compress2 failed with %d", res);
+    sampled_in[i] = len;
+    sampled_out[i] = out_len;
+  });
+  size_t total_in =
+      std::accumulate(sampled_in.begin(), sampled_in.end(), size_t(0));
+  size_t total_out =
+      std::accumulate(sampled_out.begin(), sampled_out.end(), size_t(0));
+  return (size_t)((double)total_out * size / total_in);
+}
+
 SortMode get_string_sort_mode(ConfigFiles& conf) {
   const JsonWrapper& json_cfg = conf.get_json_config();
   auto sort_strings = json_cfg.get("string_sort_mode", std::string());
@@ -2957,7 +3305,9 @@ SortMode get_string_sort_mode(ConfigFiles& conf) {
   return string_sort_mode;
 }
 
-enhanced_dex_stats_t write_classes_to_dex(
+namespace {
+
+std::unique_ptr<DexOutput> make_dex_output(
     const std::string& filename,
     DexClasses* classes,
     std::shared_ptr<GatheredTypes> gtypes,
@@ -2970,11 +3320,8 @@ enhanced_dex_stats_t write_classes_to_dex(
     std::unordered_map<DexMethod*, uint64_t>* method_to_id,
     std::unordered_map<DexCode*, std::vector<DebugLineItem>>* code_debug_lines,
     IODIMetadata* iodi_metadata,
-    const std::string& dex_magic,
     const DexOutputConfig& dex_output_config,
-    int min_sdk,
-    const std::vector<SortMode>& code_sort_mode,
-    SortMode string_sort_mode) {
+    int min_sdk) {
   const JsonWrapper& json_cfg = conf.get_json_config();
   bool force_single_dex = json_cfg.get("force_single_dex", false);
   if (force_single_dex) {
@@ -2987,15 +3334,118 @@ enhanced_dex_stats_t write_classes_to_dex(
 
   TRACE(OPUT, 2, "[write_classes_to_dex][filename] %s", filename.c_str());
 
-  DexOutput dout(filename.c_str(), classes, std::move(gtypes),
-                 normal_primary_dex, store_number, store_name, dex_number,
-                 debug_info_kind, iodi_metadata, conf, pos_mapper, method_to_id,
-                 code_debug_lines, dex_output_config, min_sdk);
+  return std::make_unique<DexOutput>(
+      filename.c_str(), classes, std::move(gtypes), normal_primary_dex,
+      store_number, store_name, dex_number, debug_info_kind, iodi_metadata,
+      conf, pos_mapper, method_to_id, code_debug_lines, dex_output_config,
+      min_sdk);
+}
+
+} // namespace
 
-  dout.prepare(string_sort_mode, code_sort_mode, conf, dex_magic);
-  dout.write();
-  dout.metrics();
-  return dout.m_stats;
+enhanced_dex_stats_t write_classes_to_dex(
+    const std::string& filename,
+    DexClasses* classes,
+    std::shared_ptr<GatheredTypes> gtypes,
+    size_t store_number,
+    const std::string* store_name,
+    size_t dex_number,
+    ConfigFiles& conf,
+    PositionMapper* pos_mapper,
+    DebugInfoKind debug_info_kind,
+    std::unordered_map<DexMethod*, uint64_t>* method_to_id,
+    std::unordered_map<DexCode*, std::vector<DebugLineItem>>* code_debug_lines,
+    IODIMetadata* iodi_metadata,
+    const std::string& dex_magic,
+    const DexOutputConfig& dex_output_config,
+    int min_sdk,
+    const std::vector<SortMode>& code_sort_mode,
+    SortMode string_sort_mode) {
+  auto dout = make_dex_output(filename, classes, std::move(gtypes),
+                              store_number, store_name, dex_number, conf,
+                              pos_mapper, debug_info_kind, method_to_id,
+                              code_debug_lines, iodi_metadata,
+                              dex_output_config, min_sdk);
+  dout->prepare(string_sort_mode, code_sort_mode, conf, dex_magic);
+  dout->write();
+  dout->metrics();
+  return std::move(dout->m_stats);
+}
+
+std::vector<enhanced_dex_stats_t> write_classes_to_dexes(
+    const std::vector<DexOutputJob>& jobs,
+    ConfigFiles& conf,
+    PositionMapper* pos_mapper,
+    DebugInfoKind debug_info_kind,
+    std::unordered_map<DexMethod*, uint64_t>* method_to_id,
+    std::unordered_map<DexCode*, std::vector<DebugLineItem>>* code_debug_lines,
+    IODIMetadata* iodi_metadata,
+    const std::string& dex_magic,
+    const DexOutputConfig& dex_output_config,
+    int min_sdk,
+    SortMode string_sort_mode,
+    size_t num_threads) {
+  bool has_cross_dex_state =
+      debug_info_kind != DebugInfoKind::NoCustomSymbolication ||
+      method_to_id != nullptr || code_debug_lines != nullptr ||
+      iodi_metadata != nullptr;
+  if (has_cross_dex_state && num_threads > 1) {
+    TRACE(OPUT, 1,
+          "[write_classes_to_dexes] debug info mode requires writing dexes "
+          "serially");
+    num_threads = 1;
+  }
+  num_threads = std::max<size_t>(1, std::min(num_threads, jobs.size()));
+  // These are lazily loaded, which must not happen concurrently.
+  conf.get_coldstart_methods();
+  conf.get_method_profiles();
+
+  std::vector<enhanced_dex_stats_t> stats(jobs.size());
+  // Jobs are claimed in order, so every job that is waiting for its turn to
+  // commit only waits for jobs that are already being worked on.
+  std::atomic<size_t> next_job{0};
+  std::mutex commit_mutex;
+  std::condition_variable commit_cv;
+  size_t next_commit = 0;
+  bool failed = false;
+  workqueue_run_for<size_t>(
+      0, num_threads,
+      [&](size_t) {
+        for (size_t i = next_job.fetch_add(1); i < jobs.size();
+             i = next_job.fetch_add(1)) {
+          const auto& job = jobs[i];
+          try {
+            auto dout = make_dex_output(
+                job.filename, job.classes,
+                std::make_shared<GatheredTypes>(job.classes), job.store_number,
+                job.store_name, job.dex_number, conf, pos_mapper,
+                debug_info_kind, method_to_id, code_debug_lines,
+                iodi_metadata, dex_output_config, min_sdk);
+            dout->prepare(string_sort_mode, *job.code_sort_mode, conf,
+                          dex_magic);
+            dout->write_dex_file();
+
+            std::unique_lock<std::mutex> lock(commit_mutex);
+            commit_cv.wait(lock, [&] { return failed || next_commit == i; });
+            if (failed) {
+              return;
+            }
+            dout->write_symbol_files();
+            dout->metrics();
+            stats[i] = std::move(dout->m_stats);
+            ++next_commit;
+          } catch (...) {
+            // Don't leave the other writers waiting for this dex.
+            std::lock_guard<std::mutex> lock(commit_mutex);
+            failed = true;
+            commit_cv.notify_all();
+            throw;
+          }
+          commit_cv.notify_all();
+        }
+      },
+      num_threads);
+  return stats;
 }
 
 void DexOutput::inc_offset(uint32_t v) {
@@ -7,8 +7,11 @@
 
 #pragma once
 
+#include <cstdlib>
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/optional/optional.hpp>
 
@@ -137,6 +140,18 @@ SortMode get_string_sort_mode(ConfigFiles& conf);
 std::vector<SortMode> get_code_sort_mode(ConfigFiles& conf,
                                          const std::string& store_name);
 
+// The alternative code sort modes given by "bytecode_sort_mode_candidates",
+// a list whose elements have the same format as "bytecode_sort_mode". When
+// there are any, each dex picks the one of the configured and the alternative
+// orderings of its code items that deflates best, as estimated by
+// estimate_deflated_size.
+std::vector<std::vector<SortMode>> get_code_sort_mode_candidates(
+    ConfigFiles& conf, const std::string& store_name);
+
+// Estimates the deflated size of the given bytes, by compressing a sample of
+// fixed-size windows with a fast zlib level.
+size_t estimate_deflated_size(const uint8_t* data, size_t size);
+
 enhanced_dex_stats_t write_classes_to_dex(
     const std::string& filename,
     DexClasses* classes,
@@ -156,6 +171,42 @@ enhanced_dex_stats_t write_classes_to_dex(
     const std::vector<SortMode>& code_sort_mode = {SortMode::CLASS_ORDER},
     SortMode string_sort_mode = SortMode::DEFAULT);
 
+struct DexOutputJob {
+  std::string filename;
+  DexClasses* classes;
+  size_t store_number;
+  const std::string* store_name;
+  size_t dex_number;
+  const std::vector<SortMode>* code_sort_mode;
+};
+
+/*
+ * Like write_classes_to_dex, for a batch of dexes, with up to `num_threads`
+ * dexes being laid out and written to disk concurrently.
+ *
+ * Everything that depends on the order of the dexes (the symbol files, which
+ * are appended to, and the cross-dex reference metrics) is still done one dex
+ * at a time, in job order, so the output is the same as when writing the
+ * dexes one after another. Position mapping, IODI and method id collection
+ * keep global state across dexes; when any of those is requested, the dexes
+ * are written serially.
+ *
+ * Returns the stats of each dex, in job order.
+ */
+std::vector<enhanced_dex_stats_t> write_classes_to_dexes(
+    const std::vector<DexOutputJob>& jobs,
+    ConfigFiles& conf,
+    PositionMapper* pos_mapper,
+    DebugInfoKind debug_info_kind,
+    std::unordered_map<DexMethod*, uint64_t>* method_to_id,
+    std::unordered_map<DexCode*, std::vector<DebugLineItem>>* code_debug_lines,
+    IODIMetadata* iodi_metadata,
+    const std::string& dex_magic,
+    const DexOutputConfig& dex_output_config,
+    int min_sdk,
+    SortMode string_sort_mode,
+    size_t num_threads);
+
 using cmp_dstring = bool (*)(const DexString*, const DexString*);
 using cmp_dtype = bool (*)(const DexType*, const DexType*);
 using cmp_dproto = bool (*)(const DexProto*, const DexProto*);
@@ -316,9 +367,15 @@ class DexOutput {
                                              << kIODILayerShift;
 
  private:
+  // The output buffer is calloc'ed, so that the pages of the (generously
+  // sized) buffer that are never written to are never committed either.
+  struct OutputDeleter {
+    void operator()(uint8_t* ptr) const { free(ptr); }
+  };
+
   DexClasses* m_classes;
   const size_t m_output_size;
-  std::unique_ptr<uint8_t[]> m_output;
+  std::unique_ptr<uint8_t, OutputDeleter> m_output;
   std::shared_ptr<GatheredTypes> m_gtypes;
   DexOutputIdx m_dodx;
   uint32_t m_offset;
@@ -347,6 +404,12 @@ class DexOutput {
   const ConfigFiles& m_config_files;
   int m_min_sdk;
   const DexOutputConfig m_dex_output_config;
+  std::vector<std::vector<SortMode>> m_code_sort_mode_candidates;
+  // Classes touched during cold start, and the strings they reference.
+  std::unordered_set<const DexClass*> m_startup_classes;
+  std::unordered_set<const DexString*> m_startup_strings;
+  // The (offset, size) of every data item of a startup class.
+  std::vector<std::pair<uint32_t, uint32_t>> m_startup_ranges;
 
   void insert_map_item(uint16_t maptype,
                        uint32_t size,
@@ -367,6 +430,9 @@ class DexOutput {
   // clinit methods come before all other methods, and remaining methods are
   // sorted by class.
   void generate_code_items(const std::vector<SortMode>& modes);
+  // The methods with code items, sorted as above.
+  std::vector<DexMethod*> get_code_item_emitlist(
+      const std::vector<SortMode>& modes);
   void generate_static_values();
   void unique_annotations(annomap_t& annomap,
                           std::vector<DexAnnotation*>& annolist);
@@ -383,10 +449,12 @@ class DexOutput {
   void generate_annotations();
   void generate_debug_items();
   void generate_typelist_data();
+  void gather_startup_classes(ConfigFiles& conf);
+  bool is_startup(const DexMethod* method) const;
+  void count_startup_pages();
   void generate_map();
   void finalize_header();
   void init_header_offsets(const std::string& dex_magic);
-  void write_symbol_files();
   uint32_t align(uint32_t offset) { return (offset + 3) & ~3; }
   void align_output() { m_offset = align(m_offset); }
 
@@ -416,6 +484,10 @@ class DexOutput {
                ConfigFiles& conf,
                const std::string& dex_magic);
   void write();
+  // The two halves of `write`. `write_dex_file` releases the output buffer
+  // once the dex is on disk.
+  void write_dex_file();
+  void write_symbol_files();
   void metrics();
   static void check_method_instruction_size_limit(const ConfigFiles& conf,
                                                   int size,
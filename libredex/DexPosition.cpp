@@ -126,8 +126,41 @@ std::unique_ptr<DexPosition> PositionPatternSwitchManager::make_switch_position(
                                        switch_id);
 }
 
+void PositionPatternSwitchManager::gather_strings(
+    std::vector<const DexString*>& lstring) const {
+  lstring.push_back(m_pattern_string);
+  lstring.push_back(m_switch_string);
+  lstring.push_back(m_unknown_source_string);
+  // All positions of patterns and switches, and their parents, are
+  // internalized.
+  for (auto& [pos, _] : m_positions) {
+    if (pos->method) {
+      lstring.push_back(pos->method);
+    }
+    if (pos->file) {
+      lstring.push_back(pos->file);
+    }
+  }
+}
+
+DexPosition* RealPositionMapper::canonicalize(DexPosition* pos) {
+  if (pos == nullptr) {
+    return nullptr;
+  }
+  auto it = m_canonical_positions.find(pos);
+  if (it != m_canonical_positions.end()) {
+    return it->second;
+  }
+  auto* parent = canonicalize(pos->parent);
+  auto [key_it, _] = m_canonical_positions_by_key.emplace(
+      PositionKey{pos->method, pos->file, pos->line, parent}, pos);
+  m_canonical_positions.emplace(pos, key_it->second);
+  return key_it->second;
+}
+
 void RealPositionMapper::register_position(DexPosition* pos) {
   always_assert(pos->file);
+  pos = canonicalize(pos);
   auto [_, emplaced] = m_pos_line_map.emplace(pos, -1);
   if (emplaced) {
     m_possibly_incomplete_positions.push(pos);
@@ -144,11 +177,11 @@ int64_t RealPositionMapper::add_position(DexPosition* pos) {
 }
 
 uint32_t RealPositionMapper::get_line(DexPosition* pos) {
-  return m_pos_line_map.at(pos) + 1;
+  return m_pos_line_map.at(m_canonical_positions.at(pos)) + 1;
 }
 
 uint32_t RealPositionMapper::position_to_line(DexPosition* pos) {
-  return add_position(pos) + 1;
+  return add_position(canonicalize(pos)) + 1;
 }
 
 void RealPositionMapper::write_map() {
@@ -236,9 +269,11 @@ void RealPositionMapper::process_pattern_switch_positions() {
         continue;
       }
       for (auto pos = c.position; pos && pos->file; pos = pos->parent) {
-        auto [it, emplaced] = m_pos_line_map.emplace(pos, m_positions.size());
+        auto* canonical_pos = canonicalize(pos);
+        auto [it, emplaced] =
+            m_pos_line_map.emplace(canonical_pos, m_positions.size());
         if (emplaced) {
-          m_positions.push_back(pos);
+          m_positions.push_back(canonical_pos);
         } else {
           always_assert(it->second != -1);
         }
@@ -127,6 +127,8 @@ class PositionPatternSwitchManager {
 
   const std::vector<PositionSwitch>& get_switches() const { return m_switches; }
 
+  void gather_strings(std::vector<const DexString*>& lstring) const;
+
  private:
   DexPosition* internalize(DexPosition* pos);
 
@@ -165,13 +167,41 @@ class PositionMapper {
  * position can be found.
  */
 class RealPositionMapper : public PositionMapper {
+  // Identifies a position by its contents, with the parent already mapped to
+  // its canonical position.
+  struct PositionKey {
+    const DexString* method;
+    const DexString* file;
+    uint32_t line;
+    DexPosition* parent;
+    bool operator==(const PositionKey& other) const {
+      return method == other.method && file == other.file &&
+             line == other.line && parent == other.parent;
+    }
+  };
+  friend size_t hash_value(const PositionKey& key) {
+    size_t seed = 0;
+    boost::hash_combine(seed, key.method);
+    boost::hash_combine(seed, key.file);
+    boost::hash_combine(seed, key.line);
+    boost::hash_combine(seed, key.parent);
+    return seed;
+  }
+
   std::string m_filename_v2;
   std::vector<DexPosition*> m_positions;
   std::unordered_map<DexPosition*, int64_t> m_pos_line_map;
   std::queue<DexPosition*> m_possibly_incomplete_positions;
   std::vector<std::unique_ptr<DexPosition>> m_owned_auxiliary_positions;
+  // Inlining the same callee many times leaves many positions with the same
+  // contents and equal parent chains. They are all mapped to the first such
+  // position, so that they share a single line in the map.
+  std::unordered_map<PositionKey, DexPosition*, boost::hash<PositionKey>>
+      m_canonical_positions_by_key;
+  std::unordered_map<const DexPosition*, DexPosition*> m_canonical_positions;
 
   void process_pattern_switch_positions();
+  DexPosition* canonicalize(DexPosition* pos);
 
  protected:
   int64_t add_position(DexPosition* pos);
@@ -35,6 +35,11 @@ dex_stats_t& dex_stats_t::operator+=(const dex_stats_t& rhs) {
   num_dbg_items += rhs.num_dbg_items;
   dbg_total_size += rhs.dbg_total_size;
   instruction_bytes += rhs.instruction_bytes;
+  num_code_sort_candidate_wins += rhs.num_code_sort_candidate_wins;
+  code_estimated_deflated_bytes += rhs.code_estimated_deflated_bytes;
+  code_estimated_deflated_savings += rhs.code_estimated_deflated_savings;
+  num_startup_pages += rhs.num_startup_pages;
+  num_startup_code_page_crossings += rhs.num_startup_code_page_crossings;
 
   header_item_count += rhs.header_item_count;
   header_item_bytes += rhs.header_item_bytes;
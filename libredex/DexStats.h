@@ -46,6 +46,18 @@ struct dex_stats_t {
 
   int instruction_bytes = 0;
 
+  /* Estimates made when choosing among candidate code orderings; see
+   * bytecode_sort_mode_candidates. */
+  int num_code_sort_candidate_wins = 0;
+  int code_estimated_deflated_bytes = 0;
+  int code_estimated_deflated_savings = 0;
+
+  /* The number of 4KB pages of the data section that contain string data,
+   * code items, class data or debug info of startup classes. */
+  int num_startup_pages = 0;
+  /* The number of startup code items that cross a 4KB page boundary. */
+  int num_startup_code_page_crossings = 0;
+
   /* Stats collected from the Map List section of a Dex. */
   int header_item_count = 0;
   int header_item_bytes = 0;
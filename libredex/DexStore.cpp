@@ -5,6 +5,7 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 
@@ -400,6 +401,31 @@ bool XDexMethodRefs::callee_has_cross_dex_refs(
          !is_subset_of(callee_dex_refs.types, refs.types);
 }
 
+void run_on_stores_in_parallel(const std::vector<DexStore*>& stores,
+                               const std::function<void(DexStore&)>& f) {
+  auto num_classes = [](const DexStore* store) {
+    size_t count = 0;
+    for (const auto& dex : store->get_dexen()) {
+      count += dex.size();
+    }
+    return count;
+  };
+  std::vector<std::pair<size_t, DexStore*>> by_size;
+  by_size.reserve(stores.size());
+  for (auto* store : stores) {
+    by_size.emplace_back(num_classes(store), store);
+  }
+  std::stable_sort(
+      by_size.begin(), by_size.end(),
+      [](const auto& a, const auto& b) { return a.first > b.first; });
+  std::vector<DexStore*> ordered;
+  ordered.reserve(by_size.size());
+  for (const auto& [_, store] : by_size) {
+    ordered.push_back(store);
+  }
+  workqueue_run<DexStore*>([&](DexStore* store) { f(*store); }, ordered);
+}
+
 void squash_into_one_dex(DexStoresVector& stores) {
   redex_assert(!stores.empty());
   auto& root_store = *stores.begin();
@@ -9,6 +9,7 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -418,6 +419,14 @@ class XDexMethodRefs : public XDexRefs {
       const std::unordered_set<DexType*>& refined_init_class_types);
 };
 
+/**
+ * Runs `f` on each of the given stores concurrently. Stores with the most
+ * classes are started first, so that a few large feature modules do not end
+ * up running alone at the end. `f` must only modify the store it is given.
+ */
+void run_on_stores_in_parallel(const std::vector<DexStore*>& stores,
+                               const std::function<void(DexStore&)>& f);
+
 /**
  * Squash the stores into a single dex.
  */
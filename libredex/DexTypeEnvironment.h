@@ -17,6 +17,7 @@
 #include <sparta/PatriciaTreeMapAbstractEnvironment.h>
 #include <sparta/PatriciaTreeSet.h>
 #include <sparta/ReducedProductAbstractDomain.h>
+#include <sparta/SmallPatriciaTreeMapAbstractEnvironment.h>
 
 #include "DexUtil.h"
 #include "NullnessDomain.h"
@@ -388,10 +389,12 @@ class DexTypeDomain final
 
 /*
  * We model the register to DexTypeDomain mapping using an Environment. A
- * write to a register always overwrites the existing mapping.
+ * write to a register always overwrites the existing mapping. As most methods
+ * use few registers, the bindings are kept inline until they outgrow a small
+ * array.
  */
 using RegTypeEnvironment =
-    sparta::PatriciaTreeMapAbstractEnvironment<reg_t, DexTypeDomain>;
+    sparta::SmallPatriciaTreeMapAbstractEnvironment<reg_t, DexTypeDomain>;
 
 /*
  * We model the field to DexTypeDomain mapping using an Environment. But we
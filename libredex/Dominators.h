@@ -8,8 +8,12 @@
 #pragma once
 
 #include <boost/optional/optional.hpp>
+#include <memory>
 #include <unordered_map>
 
+#include <sparta/MonotonicFixpointIterator.h>
+
+#include "ControlFlow.h"
 #include "GraphUtil.h"
 
 namespace dominators {
@@ -71,7 +75,7 @@ class SimpleFastDominators {
   NodeId get_idom(NodeId node) const { return m_idoms.at(node); }
 
   // Find the common dominator block that is closest to both blocks.
-  NodeId intersect(NodeId finger1, NodeId finger2) {
+  NodeId intersect(NodeId finger1, NodeId finger2) const {
     while (finger1 != finger2) {
       while (m_postorder_map.at(finger1) < m_postorder_map.at(finger2)) {
         finger1 = m_idoms.at(finger1);
@@ -89,4 +93,28 @@ class SimpleFastDominators {
   std::unordered_map<NodeId, size_t> m_postorder_map;
 };
 
+using CfgDominators = SimpleFastDominators<cfg::GraphInterface>;
+using CfgPostDominators = SimpleFastDominators<
+    sparta::BackwardsFixpointIterationAdaptor<cfg::GraphInterface>>;
+
+/*
+ * The dominators of the given cfg, computed lazily, and cached on the cfg
+ * until its structure changes.
+ */
+inline const CfgDominators& get_dominators(const cfg::ControlFlowGraph& cfg) {
+  return cfg.get_cached_analysis<CfgDominators>(
+      [&]() { return std::make_unique<CfgDominators>(cfg); });
+}
+
+/*
+ * The post-dominators of the given cfg, cached like get_dominators. The cfg
+ * must have an exit block; see cfg::ControlFlowGraph::calculate_exit_block.
+ */
+inline const CfgPostDominators& get_post_dominators(
+    const cfg::ControlFlowGraph& cfg) {
+  always_assert(cfg.exit_block() != nullptr);
+  return cfg.get_cached_analysis<CfgPostDominators>(
+      [&]() { return std::make_unique<CfgPostDominators>(cfg); });
+}
+
 } // namespace dominators
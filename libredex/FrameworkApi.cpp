@@ -7,10 +7,13 @@
 
 #include "FrameworkApi.h"
 
-#include <boost/algorithm/string.hpp>
-#include <fstream>
-#include <istream>
-#include <sstream>
+#include <boost/filesystem.hpp>
+#include <charconv>
+#include <optional>
+#include <string_view>
+
+#include "RedexMappedFile.h"
+#include "WorkQueue.h"
 
 namespace api {
 
@@ -91,51 +94,127 @@ bool FrameworkAPI::has_field(const std::string& simple_deobfuscated_name,
 
 namespace {
 
-void parse_framework_description(
-    std::istream& input,
-    std::unordered_map<const DexType*, FrameworkAPI>* framework_classes) {
-  std::string framework_cls_str;
-  std::string super_cls_str;
-  std::string class_name;
-  uint32_t num_methods;
-  uint32_t num_fields;
-  uint32_t access_flags;
+/*
+ * Splits the framework api description into whitespace separated tokens, as
+ * `operator>>` would, but without copying them out of the file contents.
+ */
+class Tokenizer {
+ public:
+  explicit Tokenizer(std::string_view input) : m_input(input) {}
+
+  std::optional<std::string_view> next() {
+    size_t start = m_input.find_first_not_of(" \t\r\n", m_pos);
+    if (start == std::string_view::npos) {
+      m_pos = m_input.size();
+      return std::nullopt;
+    }
+    size_t end = m_input.find_first_of(" \t\r\n", start);
+    if (end == std::string_view::npos) {
+      end = m_input.size();
+    }
+    m_pos = end;
+    return m_input.substr(start, end - start);
+  }
 
-  while (input >> framework_cls_str >> access_flags >> super_cls_str >>
-         num_methods >> num_fields) {
-    FrameworkAPI framework_api;
-    framework_api.cls = DexType::make_type(framework_cls_str);
-    always_assert_log(framework_classes->count(framework_api.cls) == 0,
-                      "Duplicated class name!");
-    framework_api.super_cls = DexType::make_type(super_cls_str);
-    framework_api.access_flags = DexAccessFlags(access_flags);
+  std::optional<uint32_t> next_uint() {
+    auto token = next();
+    if (!token) {
+      return std::nullopt;
+    }
+    uint32_t value;
+    auto* end = token->data() + token->size();
+    auto [ptr, ec] = std::from_chars(token->data(), end, value);
+    if (ec != std::errc() || ptr != end) {
+      return std::nullopt;
+    }
+    return value;
+  }
 
-    while (num_methods-- > 0) {
-      std::string method_str;
-      std::string tag;
-      uint32_t m_access_flags;
+ private:
+  std::string_view m_input;
+  size_t m_pos{0};
+};
 
-      input >> tag >> method_str >> m_access_flags;
+struct MemberDescription {
+  std::string_view name;
+  uint32_t access_flags;
+};
 
-      always_assert(tag == "M");
-      DexMethodRef* mref = DexMethod::make_method(method_str);
-      framework_api.mrefs_info.emplace_back(mref,
-                                            DexAccessFlags(m_access_flags));
-    }
+struct ClassDescription {
+  std::string_view cls;
+  std::string_view super_cls;
+  uint32_t access_flags;
+  std::vector<MemberDescription> methods;
+  std::vector<MemberDescription> fields;
+};
+
+void parse_members(Tokenizer& tokenizer,
+                   std::string_view expected_tag,
+                   uint32_t num_members,
+                   std::vector<MemberDescription>* members) {
+  members->reserve(num_members);
+  for (uint32_t i = 0; i < num_members; ++i) {
+    auto tag = tokenizer.next();
+    auto name = tokenizer.next();
+    auto access_flags = tokenizer.next_uint();
+    always_assert(tag && *tag == expected_tag && name && access_flags);
+    members->push_back({*name, *access_flags});
+  }
+}
 
-    while (num_fields-- > 0) {
-      std::string field_str;
-      std::string tag;
-      uint32_t f_access_flags;
+void parse_framework_description(
+    std::string_view input,
+    std::unordered_map<const DexType*, FrameworkAPI>* framework_classes) {
+  // Tokenizing is cheap compared to interning the types and member refs, so
+  // the classes are first split out sequentially, and then built in parallel.
+  std::vector<ClassDescription> descriptions;
+  Tokenizer tokenizer(input);
+  while (true) {
+    auto framework_cls_str = tokenizer.next();
+    auto access_flags = tokenizer.next_uint();
+    auto super_cls_str = tokenizer.next();
+    auto num_methods = tokenizer.next_uint();
+    auto num_fields = tokenizer.next_uint();
+    if (!framework_cls_str || !access_flags || !super_cls_str ||
+        !num_methods || !num_fields) {
+      break;
+    }
+    auto& description = descriptions.emplace_back();
+    description.cls = *framework_cls_str;
+    description.super_cls = *super_cls_str;
+    description.access_flags = *access_flags;
+    parse_members(tokenizer, "M", *num_methods, &description.methods);
+    parse_members(tokenizer, "F", *num_fields, &description.fields);
+  }
 
-      input >> tag >> field_str >> f_access_flags;
+  std::vector<FrameworkAPI> framework_apis(descriptions.size());
+  workqueue_run_for<size_t>(0, descriptions.size(), [&](size_t i) {
+    const auto& description = descriptions[i];
+    auto& framework_api = framework_apis[i];
+    framework_api.cls = DexType::make_type(description.cls);
+    framework_api.super_cls = DexType::make_type(description.super_cls);
+    framework_api.access_flags = DexAccessFlags(description.access_flags);
+
+    framework_api.mrefs_info.reserve(description.methods.size());
+    for (const auto& method : description.methods) {
+      DexMethodRef* mref = DexMethod::make_method(method.name);
+      framework_api.mrefs_info.emplace_back(
+          mref, DexAccessFlags(method.access_flags));
+    }
 
-      always_assert(tag == "F");
-      DexFieldRef* fref = DexField::make_field(field_str);
-      framework_api.frefs_info.emplace_back(fref,
-                                            DexAccessFlags(f_access_flags));
+    framework_api.frefs_info.reserve(description.fields.size());
+    for (const auto& field : description.fields) {
+      DexFieldRef* fref = DexField::make_field(field.name);
+      framework_api.frefs_info.emplace_back(
+          fref, DexAccessFlags(field.access_flags));
     }
+  });
 
+  framework_classes->reserve(framework_classes->size() +
+                             framework_apis.size());
+  for (auto& framework_api : framework_apis) {
+    always_assert_log(framework_classes->count(framework_api.cls) == 0,
+                      "Duplicated class name!");
     auto& map_entry = (*framework_classes)[framework_api.cls];
     map_entry = std::move(framework_api);
   }
@@ -147,19 +226,25 @@ void parse_framework_description(
 
 AndroidSDK AndroidSDK::from_string(const std::string& input) {
   AndroidSDK sdk{};
-
-  std::istringstream iss{input};
-  parse_framework_description(iss, &sdk.m_framework_classes);
-
+  parse_framework_description(input, &sdk.m_framework_classes);
   return sdk;
 }
 
 void AndroidSDK::load_framework_classes() {
-  std::ifstream infile(m_sdk_api_file.c_str());
-  assert_log(infile, "Failed to open framework api file: %s\n",
+  // The api files have tens of thousands of members, so they are mapped and
+  // tokenized in place rather than read through a stream.
+  boost::system::error_code ec;
+  auto file_size = boost::filesystem::file_size(m_sdk_api_file, ec);
+  assert_log(!ec, "Failed to open framework api file: %s\n",
              m_sdk_api_file.c_str());
+  std::optional<RedexMappedFile> file;
+  std::string_view contents;
+  if (!ec && file_size > 0) {
+    file = RedexMappedFile::open(m_sdk_api_file);
+    contents = std::string_view(file->const_data(), file->size());
+  }
 
-  parse_framework_description(infile, &m_framework_classes);
+  parse_framework_description(contents, &m_framework_classes);
 }
 
 } // namespace api
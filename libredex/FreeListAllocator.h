@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+/*
+ * A thread-caching free list for small objects of a single size that are
+ * allocated and freed at very high rates, such as IRInstructions and
+ * MethodItemEntries, which the CFG builder and linearization create and
+ * destroy by the million.
+ *
+ * Freed objects are kept on a per-thread list and handed out again by the
+ * next allocation on that thread, bypassing the general-purpose allocator.
+ * Objects can be freed on a different thread than the one that allocated
+ * them; the memory simply moves to the freeing thread's cache. Each cache is
+ * bounded, and anything beyond the bound is returned to the global
+ * allocator, so the total retained memory is at most
+ * `MaxCached * Size` bytes per thread.
+ *
+ * Use it by defining class-specific operator new / delete:
+ *
+ *   static void* operator new(size_t size) {
+ *     return FreeListAllocator<sizeof(Foo)>::allocate(size);
+ *   }
+ *   static void operator delete(void* ptr, size_t size) {
+ *     FreeListAllocator<sizeof(Foo)>::deallocate(ptr, size);
+ *   }
+ */
+template <size_t Size, size_t MaxCached = 4096>
+class FreeListAllocator {
+  static_assert(Size >= sizeof(void*), "Objects must be able to hold a link");
+
+ public:
+  static void* allocate(size_t size) {
+    if (size != Size) {
+      return ::operator new(size);
+    }
+    auto& cache = get_cache();
+    auto* node = cache.head;
+    if (node == nullptr) {
+      return ::operator new(Size);
+    }
+    cache.head = node->next;
+    --cache.size;
+    return node;
+  }
+
+  static void deallocate(void* ptr, size_t size) {
+    if (ptr == nullptr) {
+      return;
+    }
+    auto& cache = get_cache();
+    if (size != Size || cache.size >= MaxCached || cache.destroyed) {
+      ::operator delete(ptr);
+      return;
+    }
+    auto* node = static_cast<Node*>(ptr);
+    node->next = cache.head;
+    cache.head = node;
+    ++cache.size;
+  }
+
+  // The number of objects currently cached by the calling thread.
+  static size_t cached() { return get_cache().size; }
+
+ private:
+  struct Node {
+    Node* next;
+  };
+
+  struct Cache {
+    Node* head{nullptr};
+    size_t size{0};
+    // Objects may still be freed during thread (or program) shutdown, after
+    // the cache has been torn down. Those go straight back to the global
+    // allocator.
+    bool destroyed{false};
+
+    ~Cache() {
+      while (head != nullptr) {
+        auto* next = head->next;
+        ::operator delete(head);
+        head = next;
+      }
+      size = 0;
+      destroyed = true;
+    }
+  };
+
+  static Cache& get_cache() {
+    thread_local Cache cache;
+    return cache;
+  }
+};
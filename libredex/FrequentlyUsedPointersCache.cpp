@@ -7,8 +7,28 @@
 
 #include "FrequentlyUsedPointersCache.h"
 
+#include <string>
+
 #include "DexClass.h"
 
+namespace {
+
+FrequentlyUsedPointers::Boxing make_boxing(const std::string& boxed_name,
+                                           const std::string& primitive_name,
+                                           const std::string& unboxing_name) {
+  auto boxed = "Ljava/lang/" + boxed_name + ";";
+  return FrequentlyUsedPointers::Boxing{
+      DexType::make_type(boxed),
+      DexMethod::make_method(boxed + "." + unboxing_name + ":()" +
+                             primitive_name),
+      DexMethod::make_method("Ljava/lang/Number;." + unboxing_name + ":()" +
+                             primitive_name),
+      DexMethod::make_method(boxed + ".valueOf:(" + primitive_name + ")" +
+                             boxed)};
+}
+
+} // namespace
+
 void FrequentlyUsedPointers::load() {
 #define LOAD_FREQUENTLY_USED_TYPE(func_name, java_name) \
   m_type_##func_name = DexType::make_type(java_name);   \
@@ -29,4 +49,33 @@ void FrequentlyUsedPointers::load() {
 #define FOR_EACH LOAD_FREQUENTLY_USED_METHOD
   WELL_KNOWN_METHODS
 #undef FOR_EACH
+
+  size_t i = 0;
+#define LOAD_BOXED_TYPE(boxed_name, primitive_name, unboxing_name) \
+  m_boxings[i++] = make_boxing(#boxed_name, primitive_name, #unboxing_name);
+#define FOR_EACH LOAD_BOXED_TYPE
+  BOXED_TYPES
+#undef FOR_EACH
+}
+
+void FrequentlyUsedPointers::gather(
+    std::vector<const DexFieldRef*>& lfield,
+    std::vector<const DexMethodRef*>& lmethod) const {
+#define GATHER_FREQUENTLY_USED_FIELD(func_name, _) \
+  lfield.push_back(m_field_##func_name);
+#define FOR_EACH GATHER_FREQUENTLY_USED_FIELD
+  PRIMITIVE_PSEUDO_TYPE_FIELDS
+#undef FOR_EACH
+
+#define GATHER_FREQUENTLY_USED_METHOD(func_name, _) \
+  lmethod.push_back(m_method_##func_name);
+#define FOR_EACH GATHER_FREQUENTLY_USED_METHOD
+  WELL_KNOWN_METHODS
+#undef FOR_EACH
+
+  for (const auto& b : m_boxings) {
+    lmethod.push_back(b.unboxing);
+    lmethod.push_back(b.number_unboxing);
+    lmethod.push_back(b.value_of);
+  }
 }
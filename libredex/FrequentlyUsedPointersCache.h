@@ -7,13 +7,16 @@
 
 #pragma once
 
+#include <array>
 #include <unordered_set>
+#include <vector>
 
 #include "WellKnownTypes.h"
 
 class DexType;
 class DexFieldRef;
 class DexMethod;
+class DexMethodRef;
 
 #define STORE_TYPE(func_name, _)         \
  private:                                \
@@ -40,8 +43,33 @@ class DexMethod;
 // when RedexContext lifetime is over.
 class FrequentlyUsedPointers {
  public:
+  // A boxed type with the methods that convert from and to its primitive.
+  struct Boxing {
+    DexType* boxed{nullptr};
+    DexMethodRef* unboxing{nullptr};
+    // The corresponding method on Ljava/lang/Number;, see
+    // type::get_Number_unboxing_method_for_type.
+    DexMethodRef* number_unboxing{nullptr};
+    DexMethodRef* value_of{nullptr};
+  };
+
   void load();
 
+  // Returns the entry of the given boxed type, or nullptr if it is not one.
+  // This compares against a handful of pointers and does not hash.
+  const Boxing* boxing(const DexType* boxed) const {
+    for (const auto& b : m_boxings) {
+      if (b.boxed == boxed) {
+        return &b;
+      }
+    }
+    return nullptr;
+  }
+
+  // Appends the cached field and method references.
+  void gather(std::vector<const DexFieldRef*>& lfield,
+              std::vector<const DexMethodRef*>& lmethod) const;
+
 #define FOR_EACH STORE_TYPE
   WELL_KNOWN_TYPES
 #undef FOR_EACH
@@ -55,6 +83,13 @@ class FrequentlyUsedPointers {
 #undef FOR_EACH
 
   std::unordered_set<const DexType*> m_well_known_types;
+
+ private:
+#define COUNT_BOXED_TYPE(...) +1
+#define FOR_EACH COUNT_BOXED_TYPE
+  std::array<Boxing, 0 BOXED_TYPES> m_boxings;
+#undef FOR_EACH
+#undef COUNT_BOXED_TYPE
 };
 
 #undef STORE_TYPE
@@ -24,6 +24,16 @@ void InlinerConfig::bind_config() {
   bind("max_cost_for_constant_propagation", max_cost_for_constant_propagation,
        max_cost_for_constant_propagation);
   bind("multiple_callers", multiple_callers, multiple_callers);
+  bind("cache_shrunk_methods", cache_shrunk_methods, cache_shrunk_methods,
+       "Don't shrink methods again in later inliner invocations while their "
+       "code remains unchanged.");
+  bind("schedule_by_cost", schedule_by_cost, schedule_by_cost,
+       "Prioritize inlining work by the estimated size of the code along the "
+       "longest chain of waiting callers, to shorten the critical path.");
+  bind("inlined_costs_cache_mb", inlined_costs_cache_mb,
+       inlined_costs_cache_mb,
+       "Memory budget in MB for the inliner's cost caches; least recently used "
+       "entries get evicted and recomputed when needed. 0 means unbounded.");
   bind("run_const_prop", shrinker.run_const_prop, shrinker.run_const_prop);
   bind("run_cse", shrinker.run_cse, shrinker.run_cse);
   bind("run_dedup_blocks", shrinker.run_dedup_blocks,
@@ -61,6 +71,9 @@ void IRTypeCheckerConfig::bind_config() {
   bind("annotated_cfg_on_error", annotated_cfg_on_error,
        annotated_cfg_on_error);
   bind("check_classes", {}, check_classes);
+  bind("batch_passes", batch_passes, batch_passes,
+       "With run_after_each_pass, only check after every this many passes. A "
+       "failure names the passes that ran since the previous check.");
 }
 
 void HasherConfig::bind_config() {
@@ -72,12 +85,18 @@ void AssessorConfig::bind_config() {
   bind("run_initially", run_initially, run_initially);
   bind("run_finally", run_finally, run_finally);
   bind("run_sb_consistency", run_sb_consistency, run_sb_consistency);
+  bind("sb_consistency_sample_every", sb_consistency_sample_every,
+       sb_consistency_sample_every,
+       "Only check the source blocks of every n-th method, e.g. to keep the "
+       "check cheap in dev builds.");
 }
 
 void CheckUniqueDeobfuscatedNamesConfig::bind_config() {
   bind("run_after_each_pass", run_after_each_pass, run_after_each_pass);
   bind("run_initially", run_initially, run_initially);
   bind("run_finally", run_finally, run_finally);
+  bind("run_in_background", run_in_background, run_in_background,
+       "Check the names after a pass on a snapshot, while the next pass runs.");
 }
 
 void MethodProfileOrderingConfig::bind_config() {
@@ -96,6 +115,13 @@ void MethodSimilarityOrderingConfig::bind_config() {
        use_class_level_perf_sensitivity);
   bind("use_compression_conscious_order", use_compression_conscious_order,
        use_compression_conscious_order);
+  bind("use_lsh_candidates", use_lsh_candidates, use_lsh_candidates,
+       "Only score the methods that MinHash locality-sensitive hashing finds to "
+       "be likely similar, instead of all pairs of methods, when ordering "
+       "greedily.");
+  bind("iterations_per_split", iterations_per_split, iterations_per_split,
+       "The maximum number of balanced partitioning iterations per split, "
+       "when using the compression conscious order.");
   bind("disable", disable, disable);
   bind("store_name_to_disable", store_name_to_disable, store_name_to_disable);
 }
@@ -111,11 +137,67 @@ void ProguardConfig::bind_config() {
 void PassManagerConfig::bind_config() {
   bind("pass_aliases", pass_aliases, pass_aliases);
   bind("jemalloc_full_stats", jemalloc_full_stats, jemalloc_full_stats);
+  bind("jemalloc_purge_between_passes", jemalloc_purge_between_passes,
+       jemalloc_purge_between_passes,
+       "Return unused dirty pages of all jemalloc arenas to the OS after each "
+       "pass.");
+  bind("collect_garbage_after_passes", {}, collect_garbage_after_passes,
+       "Names of passes after which unreachable strings, type lists, protos "
+       "and member references get freed. Only safe for passes after which no "
+       "analysis holds on to such objects.");
   bind("violations_tracking", violations_tracking, violations_tracking);
+  bind("violations_tracking_sample_every", violations_tracking_sample_every,
+       violations_tracking_sample_every,
+       "Only track the violations of every n-th method.");
   bind("check_pass_order_properties", check_pass_order_properties,
        check_pass_order_properties);
   bind("check_properties_deep", check_properties_deep, check_properties_deep);
   bind("dump_mrefs", dump_mrefs, dump_mrefs);
+  bind("keep_editable_cfg", keep_editable_cfg, keep_editable_cfg,
+       "Keep the editable CFG of methods when cfg-friendly passes ask for a "
+       "fresh one, so that it is only linearized for legacy passes and at "
+       "the end.");
+  bind("fuse_method_local_passes", fuse_method_local_passes,
+       fuse_method_local_passes,
+       "Run each sequence of adjacent method-local passes as one per-method "
+       "pipeline in a single parallel walk over the code.");
+  bind("skip_unchanged_methods", skip_unchanged_methods,
+       skip_unchanged_methods,
+       "Let passes that support it skip the methods whose code did not change "
+       "since the end of their previous run.");
+  bind("perf_counters", perf_counters, perf_counters,
+       "Count cycles, instructions, cache misses and branch misses of each "
+       "pass with the hardware performance counters, where available, and "
+       "report them as metrics of the pass.");
+  bind("prefetch_analyses", prefetch_analyses, prefetch_analyses,
+       "Let an analysis pass that supports it compute its result in the "
+       "background, while the checks of the pass before it run.");
+  bind("memory_budget_mb", memory_budget_mb, memory_budget_mb,
+       "Before a pass, when the RSS plus the pass's budget in "
+       "pass_memory_budgets_mb exceeds this many MB, spill the preserved "
+       "analyses that the pass does not require to disk. They are reloaded "
+       "when asked for. 0 disables it.");
+  bind("pass_memory_budgets_mb", Json::Value(Json::objectValue),
+       pass_memory_budgets_mb,
+       "Map from pass name to the MB its VmHWM may grow by. Passes that "
+       "exceed it are reported with a warning and the over_memory_budget_mb "
+       "metric.");
+  bind("cost_history", cost_history, cost_history,
+       "Path of a JSON file with the wall time, memory and removed "
+       "instructions of each pass of past runs. When set, the predicted cost "
+       "of each pass for the scope is printed before running the passes, and "
+       "this run is added to the file.");
+  bind("fast_config_min_benefit", fast_config_min_benefit,
+       fast_config_min_benefit,
+       "For quicker debug builds, skip the passes that cost_history predicts "
+       "to remove fewer than this many instructions per second of wall time. "
+       "Passes that establish properties are never skipped. 0 disables it.");
+  bind("fast_config_min_time", fast_config_min_time, fast_config_min_time,
+       "Seconds that a pass must be predicted to run for before "
+       "fast_config_min_benefit skips it.");
+  bind("checkpoint_passes", {}, checkpoint_passes,
+       "Indexes of passes before which to write a checkpoint that redex-all "
+       "can resume from, see --resume-from-checkpoints.");
 }
 
 void ResourceConfig::bind_config() {
@@ -126,6 +208,18 @@ void ResourceConfig::bind_config() {
 
 void DexOutputConfig::bind_config() {
   bind("write_class_sizes", write_class_sizes, write_class_sizes);
+  bind("startup_data_first", startup_data_first, startup_data_first,
+       "Lay out the string data, code items, class data and debug info of "
+       "startup classes (perf sensitive classes, and classes with cold start "
+       "profiled methods) before those of all other classes.");
+  bind("pack_startup_code_pages", pack_startup_code_pages,
+       pack_startup_code_pages,
+       "Move small startup code items ahead of a startup code item that would "
+       "cross into the next page, so that they fill the current page and the "
+       "larger one starts on a fresh page.");
+  bind("dedup_debug_items", dedup_debug_items, dedup_debug_items,
+       "Emit identical debug info items only once, and share them between "
+       "code items.");
 }
 
 void JarLoaderConfig::bind_config() {
@@ -142,6 +236,9 @@ void GlobalConfig::bind_config() {
   Json::Value json_param;
   // Sorted alphabetically
   bind("agg_method_stats_files", {}, string_vector_param);
+  bind("analysis_cache_dir", "", string_param,
+       "Directory of a persistent cache for per-method analysis results, "
+       "keyed by content hashes, that is reused across Redex runs.");
   bind("android_sdk_api_15_file", "", string_param);
   bind("android_sdk_api_16_file", "", string_param);
   bind("android_sdk_api_17_file", "", string_param);
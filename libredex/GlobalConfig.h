@@ -39,6 +39,7 @@ struct IRTypeCheckerConfig : public Configurable {
   bool check_no_overwrite_this;
   bool annotated_cfg_on_error{false};
   bool check_classes;
+  size_t batch_passes{1};
 };
 
 struct HasherConfig : public Configurable {
@@ -67,6 +68,7 @@ struct AssessorConfig : public Configurable {
   bool run_initially{false};
   bool run_finally{false};
   bool run_sb_consistency{false};
+  unsigned int sb_consistency_sample_every{1};
 };
 
 struct CheckUniqueDeobfuscatedNamesConfig : public Configurable {
@@ -83,6 +85,7 @@ struct CheckUniqueDeobfuscatedNamesConfig : public Configurable {
   bool run_after_each_pass{false};
   bool run_initially{false};
   bool run_finally{false};
+  bool run_in_background{false};
 };
 
 struct OptDecisionsConfig : public Configurable {
@@ -128,6 +131,8 @@ struct MethodSimilarityOrderingConfig : public Configurable {
   bool disable{true};
   bool use_compression_conscious_order{false};
   bool use_class_level_perf_sensitivity{false};
+  bool use_lsh_candidates{false};
+  uint32_t iterations_per_split{40};
   std::string store_name_to_disable;
 };
 
@@ -155,10 +160,24 @@ struct PassManagerConfig : public Configurable {
 
   std::unordered_map<std::string, std::string> pass_aliases;
   bool jemalloc_full_stats{false};
+  bool jemalloc_purge_between_passes{false};
+  std::unordered_set<std::string> collect_garbage_after_passes;
   bool violations_tracking{false};
+  unsigned int violations_tracking_sample_every{1};
   bool check_pass_order_properties{false};
   bool check_properties_deep{false};
   bool dump_mrefs{false};
+  bool keep_editable_cfg{false};
+  bool fuse_method_local_passes{false};
+  bool skip_unchanged_methods{false};
+  bool perf_counters{false};
+  bool prefetch_analyses{false};
+  unsigned int memory_budget_mb{0};
+  Json::Value pass_memory_budgets_mb;
+  std::string cost_history;
+  float fast_config_min_benefit{0};
+  float fast_config_min_time{1};
+  std::vector<unsigned int> checkpoint_passes;
 };
 
 struct ResourceConfig : public Configurable {
@@ -191,6 +210,9 @@ struct DexOutputConfig : public Configurable {
   }
 
   bool write_class_sizes{false};
+  bool startup_data_first{false};
+  bool pack_startup_code_pages{false};
+  bool dedup_debug_items{false};
 };
 
 struct JarLoaderConfig : public Configurable {
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "IODIBuckets.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "Debug.h"
+
+namespace iodi {
+
+std::vector<Bucket> greedy_buckets(const std::vector<uint32_t>& sizes,
+                                   size_t max_bucket_inflated_size) {
+  std::vector<Bucket> result;
+  auto it = sizes.begin();
+  // Methods that are too big on their own get their own buckets.
+  for (; it != sizes.end() && *it > max_bucket_inflated_size; ++it) {
+    result.push_back({*it, 1});
+  }
+  uint32_t bucket_size = 0;
+  uint32_t bucket_count = 0;
+  for (; it != sizes.end(); ++it) {
+    uint32_t next_size = std::max(bucket_size, *it);
+    uint32_t next_count = bucket_count + 1;
+    if ((size_t)next_size * next_count > max_bucket_inflated_size) {
+      always_assert(bucket_size != 0 && bucket_count != 0);
+      result.push_back({bucket_size, bucket_count});
+      bucket_size = 0;
+      bucket_count = 0;
+    } else {
+      bucket_size = next_size;
+      bucket_count = next_count;
+    }
+  }
+  if (bucket_size > 0 && bucket_count > 0) {
+    result.push_back({bucket_size, bucket_count});
+  }
+  return result;
+}
+
+std::vector<Bucket> optimal_buckets(const std::vector<uint32_t>& sizes,
+                                    size_t max_bucket_inflated_size,
+                                    uint32_t header_bytes) {
+  // Methods of the same size always use the same program, so we bucket
+  // distinct sizes, i.e. cut the sequence of distinct sizes into ranges.
+  std::vector<Bucket> distinct;
+  for (auto size : sizes) {
+    if (!distinct.empty() && distinct.back().size == size) {
+      distinct.back().count++;
+    } else {
+      always_assert(distinct.empty() || distinct.back().size > size);
+      distinct.push_back({size, 1});
+    }
+  }
+
+  // best[j] is the cost of the best bucketing of the first j distinct sizes,
+  // as {program bytes, inflated size}, and first[j] the index of the first
+  // distinct size in its last bucket.
+  using Cost = std::pair<uint64_t, uint64_t>;
+  const auto n = distinct.size();
+  std::vector<Cost> best(n + 1, {std::numeric_limits<uint64_t>::max(), 0});
+  std::vector<size_t> first(n + 1, 0);
+  best[0] = {0, 0};
+  for (size_t j = 1; j <= n; ++j) {
+    uint64_t count = 0;
+    // Extending the last bucket to larger sizes only grows its inflated size,
+    // so the feasible buckets ending at j form a contiguous range. As sizes
+    // are distinct, a bucket of k of them inflates to at least k * k, so the
+    // range has at most sqrt(limit) elements.
+    for (size_t i = j; i-- > 0;) {
+      count += distinct[i].count;
+      uint64_t inflated = (uint64_t)distinct[i].size * count;
+      if (inflated > max_bucket_inflated_size && i + 1 < j) {
+        break;
+      }
+      Cost cost{best[i].first + header_bytes + distinct[i].size,
+                best[i].second + inflated};
+      if (cost < best[j]) {
+        best[j] = cost;
+        first[j] = i;
+      }
+    }
+  }
+
+  std::vector<Bucket> result;
+  for (size_t j = n; j > 0; j = first[j]) {
+    uint32_t count = 0;
+    for (size_t i = first[j]; i < j; ++i) {
+      count += distinct[i].count;
+    }
+    result.push_back({distinct[first[j]].size, count});
+  }
+  std::reverse(result.begin(), result.end());
+  return result;
+}
+
+BucketingCost evaluate_buckets(const std::vector<uint32_t>& sizes,
+                               const std::vector<Bucket>& buckets,
+                               uint32_t header_bytes) {
+  BucketingCost cost;
+  // The programs by increasing length; every program is emitted, even if it
+  // ends up unreferenced.
+  std::vector<uint32_t> lengths;
+  for (const auto& bucket : buckets) {
+    cost.programs++;
+    cost.program_bytes += header_bytes + bucket.size;
+    lengths.push_back(bucket.size);
+  }
+  std::sort(lengths.begin(), lengths.end());
+  lengths.erase(std::unique(lengths.begin(), lengths.end()), lengths.end());
+  std::vector<uint64_t> counts(lengths.size(), 0);
+  for (auto size : sizes) {
+    auto it = std::lower_bound(lengths.begin(), lengths.end(), size);
+    always_assert_log(it != lengths.end(), "No program covers size %u", size);
+    counts[it - lengths.begin()]++;
+  }
+  for (size_t i = 0; i < lengths.size(); ++i) {
+    uint64_t inflated = lengths[i] * counts[i];
+    cost.inflated_size += inflated;
+    cost.max_bucket_inflated_size =
+        std::max(cost.max_bucket_inflated_size, inflated);
+  }
+  return cost;
+}
+
+} // namespace iodi
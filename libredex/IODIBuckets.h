@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Bucketing of the shared debug programs of IODI (instruction offset debug
+ * info).
+ *
+ * For each arity, IODI emits a few debug programs that map every pc to a line,
+ * and every method uses the shortest of them that covers its code size. A
+ * program of length L costs a small header plus one byte per pc. When dex2oat
+ * inflates debug info, it creates L entries for every method that references
+ * the program, so the methods are split into buckets, each with its own
+ * program, such that L * #methods of no bucket exceeds a limit. More buckets
+ * lower the inflated size, at the cost of more program bytes.
+ *
+ * Method sizes are always given in non-increasing order, and buckets are
+ * returned in decreasing order of their (distinct) program lengths.
+ */
+namespace iodi {
+
+struct Bucket {
+  // The length of the shared program, i.e. the largest method in the bucket.
+  uint32_t size;
+  // The number of methods that use the program.
+  uint32_t count;
+};
+
+struct BucketingCost {
+  size_t programs{0};
+  // The encoded size of all programs.
+  uint64_t program_bytes{0};
+  // The number of entries dex2oat creates when inflating the programs of all
+  // methods, and of the most inflated program.
+  uint64_t inflated_size{0};
+  uint64_t max_bucket_inflated_size{0};
+};
+
+/*
+ * The bucketing IODI used before optimal_buckets: walks the methods from the
+ * largest to the smallest, and closes the current bucket when the next method
+ * does not fit. Kept as a baseline for benchmarks. Methods of the same size
+ * may be split across buckets of the same length here, in which case only the
+ * first of those programs is referenced.
+ */
+std::vector<Bucket> greedy_buckets(const std::vector<uint32_t>& sizes,
+                                   size_t max_bucket_inflated_size);
+
+/*
+ * Returns the bucketing with the fewest program bytes, and among those the
+ * smallest total inflated size, such that no bucket exceeds the inflated size
+ * limit. Only a bucket of methods that all have the same size may exceed it,
+ * as those methods necessarily share a program. Runs in time linear in the
+ * number of methods, times the square root of the limit.
+ */
+std::vector<Bucket> optimal_buckets(const std::vector<uint32_t>& sizes,
+                                    size_t max_bucket_inflated_size,
+                                    uint32_t header_bytes);
+
+/*
+ * Evaluates the given buckets, assigning every method to the shortest program
+ * that covers it, as DexOutput does.
+ */
+BucketingCost evaluate_buckets(const std::vector<uint32_t>& sizes,
+                               const std::vector<Bucket>& buckets,
+                               uint32_t header_bytes);
+
+} // namespace iodi
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "IRCheckpoint.h"
+
+#include <boost/filesystem.hpp>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+#include "BinarySerialization.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexMappedFile.h"
+#include "Show.h"
+#include "Trace.h"
+#include "Walkers.h"
+#include "WorkQueue.h"
+
+namespace {
+
+const std::string CHECKPOINT_FILE_NAME = "/ir_code.bin";
+constexpr uint32_t CHECKPOINT_MAGIC = 0xfaceb000;
+constexpr uint32_t CHECKPOINT_VERSION = 1;
+constexpr float kNoneVal = std::numeric_limits<float>::quiet_NaN();
+
+/*
+ * File layout, in native byte order:
+ *
+ *   header:  magic, version (see binary_serialization::write_header)
+ *            u32 number of records
+ *   record:  string descriptor
+ *            u32 registers size
+ *            u8 whether the editable CFG was built
+ *            string IRAssembler s-expression
+ *            u32 number of source block entries, in code order, each with
+ *              u32 number of chained blocks, each with
+ *                string source method, u32 id, u32 number of values, and
+ *                u32 value bits and u32 appear100 bits per value
+ *
+ * where a string is its u32 length followed by its bytes.
+ */
+void write_string(std::ostream& os, std::string_view str) {
+  always_assert(str.size() <= std::numeric_limits<uint32_t>::max());
+  binary_serialization::write<uint32_t>(os, str.size());
+  os.write(str.data(), str.size());
+}
+
+void write_float(std::ostream& os, float value) {
+  uint32_t bits;
+  static_assert(sizeof(bits) == sizeof(value));
+  memcpy(&bits, &value, sizeof(bits));
+  binary_serialization::write(os, bits);
+}
+
+// Writes the source blocks of `code`, and leaves only a placeholder in their
+// place, so that the s-expression does not carry their values.
+void write_source_blocks(std::ostream& os, IRCode* code) {
+  std::vector<MethodItemEntry*> entries;
+  for (auto& mie : *code) {
+    if (mie.type == MFLOW_SOURCE_BLOCK) {
+      entries.push_back(&mie);
+    }
+  }
+  binary_serialization::write<uint32_t>(os, entries.size());
+  for (auto* mie : entries) {
+    const auto* head = mie->src_block.get();
+    uint32_t chain_size = 0;
+    for (auto* sb = head; sb != nullptr; sb = sb->next.get()) {
+      chain_size++;
+    }
+    binary_serialization::write(os, chain_size);
+    for (auto* sb = head; sb != nullptr; sb = sb->next.get()) {
+      write_string(os, show(sb->src));
+      binary_serialization::write(os, sb->id);
+      binary_serialization::write(os, sb->vals_size);
+      for (uint32_t i = 0; i < sb->vals_size; ++i) {
+        const auto& val = sb->vals[i];
+        // A NaN value marks an absent value, as in SourceBlock::Val.
+        write_float(os, val ? val->val : kNoneVal);
+        write_float(os, val ? val->appear100 : 0.0f);
+      }
+    }
+    mie->src_block = std::make_unique<SourceBlock>(head->src, head->id);
+  }
+}
+
+std::string serialize_method(const DexMethod* method) {
+  const auto* code = method->get_code();
+  // Serialize a linearized copy, so that checkpointing leaves the CFG of the
+  // method untouched.
+  IRCode copy(*code);
+  if (copy.editable_cfg_built()) {
+    copy.clear_cfg();
+  }
+  std::ostringstream source_blocks;
+  write_source_blocks(source_blocks, &copy);
+
+  std::ostringstream os;
+  write_string(os, show(method));
+  binary_serialization::write<uint32_t>(os, code->get_registers_size());
+  binary_serialization::write<uint8_t>(os, code->editable_cfg_built());
+  write_string(os, assembler::to_string(&copy));
+  os << source_blocks.str();
+  return os.str();
+}
+
+// A bounds-checked cursor over the mapped checkpoint.
+class Reader {
+ public:
+  Reader(const char* begin, size_t size) : m_ptr(begin), m_end(begin + size) {}
+
+  template <typename T>
+  bool read(T* value) {
+    if ((size_t)(m_end - m_ptr) < sizeof(T)) {
+      return false;
+    }
+    memcpy(value, m_ptr, sizeof(T));
+    m_ptr += sizeof(T);
+    return true;
+  }
+
+  bool read_string(std::string_view* str) {
+    uint32_t size;
+    if (!read(&size) || (size_t)(m_end - m_ptr) < size) {
+      return false;
+    }
+    *str = std::string_view(m_ptr, size);
+    m_ptr += size;
+    return true;
+  }
+
+  bool at_end() const { return m_ptr == m_end; }
+
+ private:
+  const char* m_ptr;
+  const char* m_end;
+};
+
+struct SourceBlockRecord {
+  std::string_view src;
+  uint32_t id;
+  std::vector<SourceBlock::Val> vals;
+};
+
+struct MethodRecord {
+  std::string_view descriptor;
+  uint32_t registers_size;
+  uint8_t cfg_built;
+  std::string_view code;
+  std::vector<std::vector<SourceBlockRecord>> source_blocks;
+};
+
+bool read_float(Reader& reader, float* value) {
+  uint32_t bits;
+  if (!reader.read(&bits)) {
+    return false;
+  }
+  memcpy(value, &bits, sizeof(bits));
+  return true;
+}
+
+bool read_record(Reader& reader, MethodRecord* record) {
+  uint32_t num_heads;
+  if (!reader.read_string(&record->descriptor) ||
+      !reader.read(&record->registers_size) ||
+      !reader.read(&record->cfg_built) ||
+      !reader.read_string(&record->code) || !reader.read(&num_heads)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < num_heads; ++i) {
+    uint32_t chain_size;
+    if (!reader.read(&chain_size) || chain_size == 0) {
+      return false;
+    }
+    auto& chain = record->source_blocks.emplace_back();
+    for (uint32_t j = 0; j < chain_size; ++j) {
+      auto& sb = chain.emplace_back();
+      uint32_t vals_size;
+      if (!reader.read_string(&sb.src) || !reader.read(&sb.id) ||
+          !reader.read(&vals_size)) {
+        return false;
+      }
+      for (uint32_t k = 0; k < vals_size; ++k) {
+        float val;
+        float appear100;
+        if (!read_float(reader, &val) || !read_float(reader, &appear100)) {
+          return false;
+        }
+        sb.vals.push_back(val == val ? SourceBlock::Val(val, appear100)
+                                     : SourceBlock::Val::none());
+      }
+    }
+  }
+  return true;
+}
+
+std::unique_ptr<SourceBlock> make_source_blocks(
+    const std::vector<SourceBlockRecord>& chain) {
+  std::unique_ptr<SourceBlock> head;
+  for (const auto& sb : chain) {
+    auto block = std::make_unique<SourceBlock>(
+        DexString::make_string(sb.src), sb.id, sb.vals);
+    if (head == nullptr) {
+      head = std::move(block);
+    } else {
+      head->append(std::move(block));
+    }
+  }
+  return head;
+}
+
+std::unique_ptr<IRCode> restore_code(const MethodRecord& record) {
+  auto code = assembler::ircode_from_string(std::string(record.code));
+  code->set_registers_size(record.registers_size);
+  auto it = record.source_blocks.begin();
+  for (auto& mie : *code) {
+    if (mie.type != MFLOW_SOURCE_BLOCK) {
+      continue;
+    }
+    always_assert_log(it != record.source_blocks.end(),
+                      "Missing source blocks for %s",
+                      std::string(record.descriptor).c_str());
+    mie.src_block = make_source_blocks(*it++);
+  }
+  always_assert_log(it == record.source_blocks.end(),
+                    "Unused source blocks for %s",
+                    std::string(record.descriptor).c_str());
+  if (record.cfg_built) {
+    code->build_cfg();
+  }
+  return code;
+}
+
+} // namespace
+
+namespace ir_checkpoint {
+
+void dump(const Scope& classes, const std::string& output_dir) {
+  std::vector<DexMethod*> methods;
+  walk::code(classes, [&](DexMethod* method, IRCode&) {
+    methods.push_back(method);
+  });
+  std::vector<std::string> records(methods.size());
+  workqueue_run_for<size_t>(0, methods.size(), [&](size_t i) {
+    records[i] = serialize_method(methods[i]);
+  });
+
+  std::ofstream ostrm(output_dir + CHECKPOINT_FILE_NAME,
+                      std::ios::binary | std::ios::trunc);
+  binary_serialization::write_header(ostrm, CHECKPOINT_VERSION);
+  binary_serialization::write<uint32_t>(ostrm, records.size());
+  for (const auto& record : records) {
+    ostrm.write(record.data(), record.size());
+  }
+}
+
+bool load(const std::string& input_dir) {
+  std::string input_file = input_dir + CHECKPOINT_FILE_NAME;
+  if (!boost::filesystem::exists(input_file)) {
+    return false;
+  }
+  auto mapped_file = RedexMappedFile::open(input_file);
+  Reader reader(mapped_file.const_data(), mapped_file.size());
+  uint32_t magic;
+  uint32_t version;
+  uint32_t count;
+  if (!reader.read(&magic) || magic != CHECKPOINT_MAGIC ||
+      !reader.read(&version) || version != CHECKPOINT_VERSION ||
+      !reader.read(&count)) {
+    std::cerr << "Ignoring invalid IR checkpoint " << input_file << std::endl;
+    return false;
+  }
+  std::vector<MethodRecord> records(count);
+  std::vector<DexMethod*> methods(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    if (!read_record(reader, &records[i])) {
+      std::cerr << "Ignoring truncated IR checkpoint " << input_file
+                << std::endl;
+      return false;
+    }
+    auto* ref = DexMethod::get_method(records[i].descriptor);
+    if (ref == nullptr || !ref->is_def() ||
+        ref->as_def()->get_code() == nullptr) {
+      std::cerr << "Ignoring IR checkpoint " << input_file
+                << " with unknown method " << records[i].descriptor
+                << std::endl;
+      return false;
+    }
+    methods[i] = ref->as_def();
+  }
+  if (!reader.at_end()) {
+    std::cerr << "Ignoring IR checkpoint " << input_file
+              << " with trailing data" << std::endl;
+    return false;
+  }
+
+  workqueue_run_for<uint32_t>(0, count, [&](uint32_t i) {
+    auto* method = methods[i];
+    auto code = restore_code(records[i]);
+    code->set_debug_item(method->get_code()->release_debug_item());
+    method->set_code(std::move(code));
+  });
+  TRACE(MAIN, 1, "Restored the IR of %u methods from %s", count,
+        input_file.c_str());
+  return true;
+}
+
+} // namespace ir_checkpoint
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "DexClass.h"
+
+/*
+ * A checkpoint of the IRCode of all methods, written next to the intermediate
+ * dexes and the IR meta data, so that a later pipeline stage resumes from the
+ * IR of the previous stage rather than from its lowered dex code.
+ *
+ * For every method with code, the checkpoint records the instructions, try
+ * regions, positions (with their parent chains) and source blocks in the
+ * s-expression syntax of IRAssembler, along with the register count and
+ * whether the method had an editable CFG. Source block values are stored in
+ * binary, as the assembler syntax rounds them and drops chained blocks.
+ *
+ * Class structure, rstate and deobfuscated names still come from the
+ * intermediate dexes and the IR meta data, and the configuration from the
+ * entry file.
+ */
+namespace ir_checkpoint {
+
+void dump(const Scope& classes, const std::string& output_dir);
+
+/*
+ * Replaces the code of the methods of the checkpoint in `input_dir` with the
+ * checkpointed IRCode, keeping their current debug items. Returns false if
+ * there is no valid checkpoint, in which case no method is changed.
+ */
+bool load(const std::string& input_dir);
+
+} // namespace ir_checkpoint
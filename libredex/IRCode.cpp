@@ -8,6 +8,7 @@
 #include "IRCode.h"
 
 #include <algorithm>
+#include <atomic>
 #include <boost/bimap/bimap.hpp>
 #include <boost/bimap/unordered_set_of.hpp>
 #include <boost/numeric/conversion/cast.hpp>
@@ -42,6 +43,9 @@
 
 namespace {
 
+std::atomic<bool> s_keep_editable_cfg{false};
+std::atomic<size_t> s_kept_editable_cfgs{0};
+
 int bytecount(int32_t v) {
   int bytecount = 4;
   if ((int32_t)((int8_t)(v & 0xff)) == v) {
@@ -666,11 +670,16 @@ void IRCode::build_cfg(bool editable,
       !editable || !m_cfg_serialized_with_custom_strategy,
       "Cannot build editable CFG after being serialized with custom strategy. "
       "Rebuilding CFG will cause problems with basic block ordering.");
-  if (editable && !rebuild_editable_even_if_already_built &&
-      editable_cfg_built()) {
-    // If current code already has editable_cfg, and no need to rebuild a fresh
-    // editable cfg, just keep current cfg and return.
-    return;
+  if (editable && editable_cfg_built()) {
+    if (!rebuild_editable_even_if_already_built) {
+      // If current code already has editable_cfg, and no need to rebuild a
+      // fresh editable cfg, just keep current cfg and return.
+      return;
+    }
+    if (s_keep_editable_cfg.load(std::memory_order_relaxed)) {
+      s_kept_editable_cfgs.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
   }
   clear_cfg();
   m_cfg = std::make_unique<cfg::ControlFlowGraph>(m_ir_list, m_registers_size,
@@ -714,6 +723,12 @@ void IRCode::clear_cfg(
   }
 }
 
+void IRCode::set_keep_editable_cfg(bool keep) { s_keep_editable_cfg = keep; }
+
+bool IRCode::keep_editable_cfg() { return s_keep_editable_cfg; }
+
+size_t IRCode::get_kept_editable_cfgs() { return s_kept_editable_cfgs; }
+
 bool IRCode::cfg_built() const { return m_cfg != nullptr; }
 
 bool IRCode::editable_cfg_built() const {
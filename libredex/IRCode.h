@@ -176,6 +176,16 @@ class IRCode {
   void build_cfg(bool editable = true,
                  bool rebuild_editable_even_if_already_built = true);
 
+  // When set, an existing editable CFG is always kept by `build_cfg`, as if
+  // rebuild_editable_even_if_already_built was false. The editable CFG then
+  // stays the canonical form of the code between and within passes, and is
+  // only linearized when someone calls `clear_cfg`. Code that needs a fresh
+  // graph, e.g. with renumbered blocks, must clear the CFG first.
+  static void set_keep_editable_cfg(bool keep);
+  static bool keep_editable_cfg();
+  // The number of rebuilds that were skipped due to keep_editable_cfg.
+  static size_t get_kept_editable_cfgs();
+
   // if the cfg was editable, linearize it back into m_ir_list
   // custom_strategy controls the linearization of the CFG.
   //
@@ -14,31 +14,29 @@
 #include "DexUtil.h"
 #include "Show.h"
 
+#include <algorithm>
+#include <boost/functional/hash.hpp>
 #include <boost/range/any_range.hpp>
 #include <cstring>
 #include <iterator>
 
+static_assert(sizeof(void*) != 8 || sizeof(IRInstruction) == 24,
+              "IRInstruction should stay compact");
+
 IRInstruction::IRInstruction(IROpcode op) : m_opcode(op) {
-  auto count = opcode_impl::min_srcs_size(op);
-  if (count <= MAX_NUM_INLINE_SRCS) {
-    m_num_inline_srcs = count;
-  } else {
-    m_num_inline_srcs = MAX_NUM_INLINE_SRCS + 1;
-    m_srcs = new std::vector<reg_t>(count);
-  }
+  set_srcs_size(opcode_impl::min_srcs_size(op));
 }
 
 IRInstruction::IRInstruction(const IRInstruction& other)
     : m_opcode(other.m_opcode),
-      m_num_inline_srcs(other.m_num_inline_srcs),
+      m_num_srcs(other.m_num_srcs),
       m_dest(other.m_dest),
       m_literal(other.m_literal) {
-  if (m_num_inline_srcs <= MAX_NUM_INLINE_SRCS) {
-    for (auto i = 0; i < m_num_inline_srcs; ++i) {
-      m_inline_srcs[i] = other.m_inline_srcs[i];
-    }
+  if (has_inline_srcs()) {
+    std::copy_n(other.m_inline_srcs, MAX_NUM_INLINE_SRCS, m_inline_srcs);
   } else {
-    m_srcs = new std::vector<reg_t>(*other.m_srcs);
+    m_srcs = new reg_t[m_num_srcs];
+    std::copy_n(other.m_srcs, m_num_srcs, m_srcs);
   }
   if (other.has_data()) {
     m_data = other.m_data->clone();
@@ -46,8 +44,8 @@ IRInstruction::IRInstruction(const IRInstruction& other)
 }
 
 IRInstruction::~IRInstruction() {
-  if (m_num_inline_srcs > MAX_NUM_INLINE_SRCS) {
-    delete m_srcs;
+  if (!has_inline_srcs()) {
+    delete[] m_srcs;
   }
   if (has_data()) {
     delete m_data;
@@ -65,7 +63,7 @@ IRInstruction* IRInstruction::set_data(std::unique_ptr<DexOpcodeData> data) {
 // because they are unknown until we sync back to DexInstructions.
 bool IRInstruction::operator==(const IRInstruction& that) const {
   bool simple_fields_match = m_opcode == that.m_opcode &&
-                             m_num_inline_srcs == that.m_num_inline_srcs &&
+                             m_num_srcs == that.m_num_srcs &&
                              m_dest == that.m_dest;
   if (!simple_fields_match) {
     return false;
@@ -89,35 +87,7 @@ bool IRInstruction::operator==(const IRInstruction& that) const {
   }
 
   // Check the source registers union
-  if (m_num_inline_srcs <= MAX_NUM_INLINE_SRCS) {
-    for (auto i = 0; i < m_num_inline_srcs; ++i) {
-      if (m_inline_srcs[i] != that.m_inline_srcs[i]) {
-        return false;
-      }
-    }
-    return true;
-  } else {
-    return *m_srcs == *that.m_srcs;
-  }
-}
-
-reg_t IRInstruction::src(src_index_t i) const {
-  if (m_num_inline_srcs <= MAX_NUM_INLINE_SRCS) {
-    always_assert(i < m_num_inline_srcs);
-    return m_inline_srcs[i];
-  }
-  return m_srcs->at(i);
-}
-
-IRInstruction::reg_range IRInstruction::srcs() const {
-  if (m_num_inline_srcs <= MAX_NUM_INLINE_SRCS) {
-    const reg_t* begin = std::begin(m_inline_srcs);
-    const reg_t* end = begin + m_num_inline_srcs;
-    return reg_range(begin, end);
-  }
-  const reg_t* begin = m_srcs->data();
-  const reg_t* end = begin + m_srcs->size();
-  return reg_range(begin, end);
+  return std::equal(srcs_data(), srcs_data() + m_num_srcs, that.srcs_data());
 }
 
 std::vector<reg_t> IRInstruction::srcs_vec() const {
@@ -129,52 +99,25 @@ std::vector<reg_t> IRInstruction::srcs_vec() const {
   return result;
 }
 
-IRInstruction* IRInstruction::set_src(src_index_t i, reg_t reg) {
-  if (m_num_inline_srcs <= MAX_NUM_INLINE_SRCS) {
-    always_assert(i < m_num_inline_srcs);
-    m_inline_srcs[i] = reg;
-  } else {
-    m_srcs->at(i) = reg;
-  }
-  return this;
-}
-
-size_t IRInstruction::srcs_size() const {
-  if (m_num_inline_srcs <= MAX_NUM_INLINE_SRCS) {
-    return m_num_inline_srcs;
-  }
-  return m_srcs->size();
-}
-
 IRInstruction* IRInstruction::set_srcs_size(size_t count) {
-  if (m_num_inline_srcs <= MAX_NUM_INLINE_SRCS) {
-    if (count <= MAX_NUM_INLINE_SRCS) {
-      // staying in the inline state
-      m_num_inline_srcs = count;
-    } else {
-      // inline regs -> vector
-      auto srcs = new std::vector<reg_t>();
-      srcs->reserve(count);
-      for (auto i = 0; i < m_num_inline_srcs; ++i) {
-        srcs->push_back(m_inline_srcs[i]);
-      }
-      srcs->resize(count);
-      m_num_inline_srcs = MAX_NUM_INLINE_SRCS + 1;
-      m_srcs = srcs;
-    }
+  always_assert(count <= std::numeric_limits<uint16_t>::max());
+  if (count == m_num_srcs) {
+    return this;
+  }
+  // Registers beyond the old size are zero, as with std::vector::resize.
+  size_t kept = std::min<size_t>(count, m_num_srcs);
+  reg_t* old_srcs = has_inline_srcs() ? nullptr : m_srcs;
+  if (count <= MAX_NUM_INLINE_SRCS) {
+    reg_t srcs[MAX_NUM_INLINE_SRCS] = {0};
+    std::copy_n(srcs_data(), kept, srcs);
+    std::copy_n(srcs, MAX_NUM_INLINE_SRCS, m_inline_srcs);
   } else {
-    if (count <= MAX_NUM_INLINE_SRCS) {
-      // vector -> inline regs
-      auto old_srcs_ptr = m_srcs;
-      m_num_inline_srcs = count;
-      always_assert(count <= old_srcs_ptr->size());
-      std::memcpy(m_inline_srcs, old_srcs_ptr->data(), count * sizeof(reg_t));
-      delete old_srcs_ptr;
-    } else {
-      // staying in the vector state
-      m_srcs->resize(count);
-    }
+    auto* srcs = new reg_t[count]();
+    std::copy_n(srcs_data(), kept, srcs);
+    m_srcs = srcs;
   }
+  m_num_srcs = count;
+  delete[] old_srcs;
   return this;
 }
 
@@ -367,19 +310,8 @@ void IRInstruction::denormalize_registers() {
       }
     }
 
-    // update m_inline_srcs or m_srcs
-    if (m_num_inline_srcs > MAX_NUM_INLINE_SRCS) {
-      delete m_srcs;
-    }
-    if (srcs.size() <= MAX_NUM_INLINE_SRCS) {
-      m_num_inline_srcs = srcs.size();
-      for (size_t i = 0; i < srcs.size(); ++i) {
-        m_inline_srcs[i] = srcs.at(i);
-      }
-    } else {
-      m_num_inline_srcs = MAX_NUM_INLINE_SRCS + 1;
-      m_srcs = new std::vector<reg_t>(std::move(srcs));
-    }
+    set_srcs_size(srcs.size());
+    std::copy(srcs.begin(), srcs.end(), srcs_data());
   }
 }
 
@@ -411,14 +343,18 @@ bool needs_range_conversion(const IRInstruction* insn) {
 }
 
 uint64_t IRInstruction::hash() const {
-  uint64_t result = opcode();
+  // The parts are combined rather than xor'ed together, so that e.g. the
+  // registers of an instruction can't cancel out a change of its opcode. This
+  // makes the hash usable to fingerprint code.
+  size_t result = 0;
+  boost::hash_combine(result, opcode());
 
   for (size_t i = 0; i < srcs_size(); i++) {
-    result ^= src(i);
+    boost::hash_combine(result, src(i));
   }
 
   if (has_dest()) {
-    result ^= dest();
+    boost::hash_combine(result, dest());
   }
 
   switch (opcode::ref(opcode())) {
@@ -426,7 +362,7 @@ uint64_t IRInstruction::hash() const {
     size_t size = get_data()->data_size();
     const auto& data = get_data()->data();
     for (size_t i = 0; i < size; i++) {
-      result ^= data[i];
+      boost::hash_combine(result, data[i]);
     }
     break;
   }
@@ -438,7 +374,7 @@ uint64_t IRInstruction::hash() const {
   case opcode::Ref::Literal:
   case opcode::Ref::String:
   case opcode::Ref::Type: {
-    result ^= m_literal;
+    boost::hash_combine(result, m_literal);
     break;
   }
   case opcode::Ref::None:
@@ -14,6 +14,7 @@
 #include <vector>
 
 #include "Debug.h"
+#include "FreeListAllocator.h"
 #include "IROpcode.h"
 
 class DexCallSite;
@@ -141,6 +142,15 @@ class IRInstruction final {
   IRInstruction(const IRInstruction&);
   ~IRInstruction();
 
+  // Instructions are created and destroyed at very high rates by passes that
+  // clone or rewrite code, so they are recycled.
+  static void* operator new(size_t size) {
+    return FreeListAllocator<sizeof(IRInstruction)>::allocate(size);
+  }
+  static void operator delete(void* ptr, size_t size) {
+    FreeListAllocator<sizeof(IRInstruction)>::deallocate(ptr, size);
+  }
+
   /*
    * Ensures that wide registers only have their first register referenced
    * in the srcs list. This only affects invoke-* instructions.
@@ -194,7 +204,7 @@ class IRInstruction final {
    */
   bool has_dest() const { return opcode_impl::has_dest(m_opcode); }
 
-  size_t srcs_size() const;
+  size_t srcs_size() const { return m_num_srcs; }
 
   bool has_move_result_pseudo() const {
     return opcode_impl::has_move_result_pseudo(m_opcode);
@@ -258,7 +268,10 @@ class IRInstruction final {
     always_assert_log(has_dest(), "No dest for %s", show_opcode().c_str());
     return m_dest;
   }
-  reg_t src(src_index_t i) const;
+  reg_t src(src_index_t i) const {
+    always_assert(i < m_num_srcs);
+    return srcs_data()[i];
+  }
 
  private:
   using reg_range_super = boost::iterator_range<const reg_t*>;
@@ -271,7 +284,10 @@ class IRInstruction final {
     using reg_range_super::reg_range_super;
   };
   // Provides a read-only view into the source registers
-  reg_range srcs() const;
+  reg_range srcs() const {
+    const reg_t* begin = srcs_data();
+    return reg_range(begin, begin + m_num_srcs);
+  }
   // Provides a copy of the source registers
   std::vector<reg_t> srcs_vec() const;
 
@@ -287,7 +303,11 @@ class IRInstruction final {
     m_dest = reg;
     return this;
   }
-  IRInstruction* set_src(src_index_t i, reg_t reg);
+  IRInstruction* set_src(src_index_t i, reg_t reg) {
+    always_assert(i < m_num_srcs);
+    srcs_data()[i] = reg;
+    return this;
+  }
   IRInstruction* set_srcs_size(size_t count);
 
   int64_t get_literal() const {
@@ -416,21 +436,23 @@ class IRInstruction final {
   // 2 is chosen because it's the maximum number of registers (32 bits each) we
   // can fit in the size of a pointer (on a 64bit system).
   // In practice, most IRInstructions have 2 or fewer source registers, so we
-  // can avoid a vector allocation most of the time.
+  // can avoid an allocation most of the time.
   static constexpr uint8_t MAX_NUM_INLINE_SRCS = 2;
 
+  bool has_inline_srcs() const { return m_num_srcs <= MAX_NUM_INLINE_SRCS; }
+  const reg_t* srcs_data() const {
+    return has_inline_srcs() ? m_inline_srcs : m_srcs;
+  }
+  reg_t* srcs_data() { return has_inline_srcs() ? m_inline_srcs : m_srcs; }
+
   // The fields of IRInstruction are carefully selected and ordered to avoid
   // empty packing bytes and minimize total size. This is optimized for 8 byte
   // alignment on a 64bit system.
 
   IROpcode m_opcode; // 2 bytes
-  // m_num_inline_srcs can take a small set of possible values:
-  //   * 0, ..., MAX_NUM_INLINE_SRCS: the size of the valid section of
-  //     m_inline_srcs
-  //   * MAX_NUM_INLINE_SRCS + 1: indicates that m_srcs should be used, not
-  //     m_inline_srcs
-  uint16_t m_num_inline_srcs{0}; // 2 bytes. Could be 1 byte
-                                 // but extra byte would just be padding
+  // The number of source registers. Up to MAX_NUM_INLINE_SRCS, they are stored
+  // in m_inline_srcs, otherwise in the array pointed to by m_srcs.
+  uint16_t m_num_srcs{0}; // 2 bytes
   reg_t m_dest{0}; // 4 bytes
   // 8 bytes so far
   union {
@@ -448,11 +470,11 @@ class IRInstruction final {
   };
   // 16 bytes so far
   union {
-    // m_num_inline_srcs indicates how to interpret the union. See comment above
+    // m_num_srcs indicates how to interpret the union. See comment above
     reg_t m_inline_srcs[MAX_NUM_INLINE_SRCS] = {0};
-    // Use a pointer here because it's 8 bytes instead of ~24.
-    // Be careful to new and delete it correctly!
-    std::vector<reg_t>* m_srcs;
+    // An array of exactly m_num_srcs registers, allocated with new[]. Unlike
+    // a std::vector, this takes a single allocation.
+    reg_t* m_srcs;
   };
   // 24 bytes total
 };
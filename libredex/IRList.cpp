@@ -7,7 +7,11 @@
 
 #include "IRList.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <iterator>
+#include <memory>
 #include <sstream>
 #include <vector>
 
@@ -955,6 +959,96 @@ void IRList::insn_clear_and_dispose() {
   });
 }
 
+SourceBlock::Vals::Buffer* SourceBlock::Vals::allocate(size_t size) {
+  if (size == 0) {
+    return nullptr;
+  }
+  always_assert(size <= std::numeric_limits<uint32_t>::max());
+  auto* mem = ::operator new(sizeof(Buffer) + size * sizeof(Val));
+  return new (mem) Buffer(size);
+}
+
+SourceBlock::Vals::Vals(const Val* vals, size_t size)
+    : m_buffer(allocate(size)) {
+  if (m_buffer != nullptr) {
+    std::uninitialized_copy_n(vals, size, m_buffer->data());
+  }
+}
+
+SourceBlock::Val* SourceBlock::Vals::mutable_data(bool copy) {
+  if (m_buffer == nullptr) {
+    return nullptr;
+  }
+  if (m_buffer->refs.load(std::memory_order_acquire) == 1) {
+    return m_buffer->data();
+  }
+  auto* buffer = allocate(m_buffer->size);
+  if (copy) {
+    std::uninitialized_copy_n(m_buffer->data(), m_buffer->size,
+                              buffer->data());
+  } else {
+    std::uninitialized_default_construct_n(buffer->data(), m_buffer->size);
+  }
+  release();
+  m_buffer = buffer;
+  return buffer->data();
+}
+
+void SourceBlock::Vals::share(const Vals& other) {
+  if (m_buffer == other.m_buffer) {
+    return;
+  }
+  if (other.m_buffer != nullptr) {
+    other.m_buffer->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+  release();
+  m_buffer = other.m_buffer;
+}
+
+void SourceBlock::fill_vals(const Val& val) {
+  std::fill_n(vals.mutable_data(/* copy */ false), vals_size, val);
+}
+
+void SourceBlock::scale(const float* factors, size_t size) {
+  size = std::min<size_t>(size, vals_size);
+  if (std::all_of(factors, factors + size,
+                  [](float factor) { return factor == 1.0f; })) {
+    return;
+  }
+  // A missing value is NaN, and stays NaN, so there's no need to check.
+  auto* data = mutable_vals();
+  for (size_t i = 0; i != size; ++i) {
+    data[i].m_val.val *= factors[i];
+  }
+}
+
+void SourceBlock::max(const SourceBlock& other) {
+  size_t len = std::min(vals_size, other.vals_size);
+  if (len == 0 || vals.is_shared_with(other.vals)) {
+    return;
+  }
+  const auto* theirs = other.vals.m_buffer->data();
+  if (vals_size == other.vals_size &&
+      std::memcmp(vals.m_buffer->data(), theirs, len * sizeof(Val)) == 0) {
+    // Merging equal values is common, e.g. for duplicated blocks. Only keep
+    // one copy of them.
+    vals.share(other.vals);
+    return;
+  }
+  auto* ours = mutable_vals();
+  for (size_t i = 0; i != len; ++i) {
+    auto& a = ours[i].m_val;
+    const auto& b = theirs[i].m_val;
+    // A missing value is NaN, which fmax ignores.
+    bool a_none = a.val != a.val;
+    bool b_none = b.val != b.val;
+    a.appear100 = a_none   ? b.appear100
+                  : b_none ? a.appear100
+                           : std::max(a.appear100, b.appear100);
+    a.val = std::fmax(a.val, b.val);
+  }
+}
+
 std::string SourceBlock::show(bool quoted_src) const {
   std::ostringstream o;
 
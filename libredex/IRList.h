@@ -10,6 +10,7 @@
 #include <boost/intrusive/list.hpp>
 #include <boost/optional.hpp>
 #include <boost/range/sub_range.hpp>
+#include <atomic>
 #include <functional>
 #include <iosfwd>
 #include <limits>
@@ -23,6 +24,7 @@
 #include <vector>
 
 #include "Debug.h"
+#include "FreeListAllocator.h"
 
 class DexCallSite;
 class DexDebugInstruction;
@@ -167,24 +169,69 @@ struct SourceBlock {
     }
 
    private:
+    friend struct SourceBlock;
+
     ValPair m_val;
   };
+
+  /*
+   * The values of a source block, one per interaction. Inlining and block
+   * duplication copy source blocks a lot, so copies share the values, which
+   * are only copied when one of the source blocks changes them.
+   */
+  class Vals {
+   public:
+    Vals() = default;
+    Vals(const Val* vals, size_t size);
+    Vals(const Vals& other) noexcept : m_buffer(other.m_buffer) {
+      if (m_buffer != nullptr) {
+        m_buffer->refs.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    Vals& operator=(const Vals&) = delete;
+    ~Vals() { release(); }
+
+    const Val& operator[](size_t i) const { return m_buffer->data()[i]; }
+
+    bool is_shared_with(const Vals& other) const {
+      return m_buffer == other.m_buffer;
+    }
+
+   private:
+    friend struct SourceBlock;
+
+    struct Buffer {
+      std::atomic<uint32_t> refs{1};
+      uint32_t size;
+      explicit Buffer(uint32_t size) : size(size) {}
+      // The values directly follow the header.
+      Val* data() { return reinterpret_cast<Val*>(this + 1); }
+    };
+    static_assert(sizeof(Buffer) % alignof(Val) == 0);
+
+    static Buffer* allocate(size_t size);
+    void release();
+    // Makes the values private to this object, copying them if `copy` is set.
+    Val* mutable_data(bool copy = true);
+    // Shares the values of the other object instead.
+    void share(const Vals& other);
+
+    Buffer* m_buffer{nullptr};
+  };
+
   const uint32_t vals_size{0};
-  const std::unique_ptr<Val[]> vals;
+  Vals vals;
 
   SourceBlock() = default;
   SourceBlock(const DexString* src, size_t id) : src(src), id(id) {}
   SourceBlock(const DexString* src, size_t id, const std::vector<Val>& v)
-      : src(src),
-        id(id),
-        vals_size(v.size()),
-        vals(clone_vals(v.data(), v.size())) {}
+      : src(src), id(id), vals_size(v.size()), vals(v.data(), v.size()) {}
   SourceBlock(const SourceBlock& other)
       : src(other.src),
         next(other.next == nullptr ? nullptr : new SourceBlock(*other.next)),
         id(other.id),
         vals_size(other.vals_size),
-        vals(clone_vals(other.vals.get(), other.vals_size)) {}
+        vals(other.vals) {}
 
   boost::optional<float> get_val(size_t i) const {
     return vals[i] ? boost::optional<float>(vals[i]->val) : boost::none;
@@ -193,13 +240,16 @@ struct SourceBlock {
     return vals[i] ? boost::optional<float>(vals[i]->appear100) : boost::none;
   }
 
-  static std::unique_ptr<Val[]> clone_vals(const Val* vals, size_t vals_size) {
-    auto res = std::make_unique<Val[]>(vals_size);
-    for (size_t i = 0; i < vals_size; i++) {
-      res[i] = vals[i];
-    }
-    return res;
-  }
+  // The values, made private to this source block so that they can be
+  // changed.
+  Val* mutable_vals() { return vals.mutable_data(); }
+
+  // Sets all the values to the given one.
+  void fill_vals(const Val& val);
+
+  // Multiplies the value of each of the first `size` interactions by its
+  // factor. Missing values stay missing.
+  void scale(const float* factors, size_t size);
 
   template <typename Fn>
   void foreach_val(const Fn& fn) const {
@@ -257,20 +307,19 @@ struct SourceBlock {
 
   std::string show(bool quoted_src = false) const;
 
-  void max(const SourceBlock& other) {
-    size_t len = std::min(vals_size, other.vals_size);
-    for (size_t i = 0; i != len; ++i) {
-      if (!vals[i]) {
-        vals[i] = other.vals[i];
-      } else if (other.vals[i]) {
-        vals[i]->val = std::max(vals[i]->val, other.vals[i]->val);
-        vals[i]->appear100 =
-            std::max(vals[i]->appear100, other.vals[i]->appear100);
-      }
-    }
-  }
+  // Keeps the maximum of the values of both source blocks.
+  void max(const SourceBlock& other);
 };
 
+inline void SourceBlock::Vals::release() {
+  if (m_buffer != nullptr &&
+      m_buffer->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    m_buffer->~Buffer();
+    ::operator delete(m_buffer);
+  }
+  m_buffer = nullptr;
+}
+
 static_assert(sizeof(void*) != 8 || sizeof(SourceBlock) == 32);
 
 /*
@@ -357,6 +406,15 @@ struct MethodItemEntry {
   MethodItemEntry() : type(MFLOW_FALLTHROUGH) {}
   ~MethodItemEntry();
 
+  // MethodItemEntries are created and destroyed at very high rates, e.g. every
+  // time a CFG gets built or linearized, so they are recycled.
+  static void* operator new(size_t size) {
+    return FreeListAllocator<sizeof(MethodItemEntry)>::allocate(size);
+  }
+  static void operator delete(void* ptr, size_t size) {
+    FreeListAllocator<sizeof(MethodItemEntry)>::deallocate(ptr, size);
+  }
+
   /*
    * This should only ever be used by the instruction lowering step. Do NOT use
    * it in passes!
@@ -9,15 +9,21 @@
 
 #include <fstream>
 #include <iostream>
+#include <string_view>
+#include <unordered_map>
 
+#include "RedexMappedFile.h"
 #include "Show.h"
-#include "StringBuilder.h"
-#include "Walkers.h"
 
 namespace {
 constexpr const char* IRMETA_FILE_NAME = "/irmeta.bin";
 
+// The magic number of the original, stream parsed format, which can still be
+// loaded.
 constexpr const char* IRMETA_MAGIC_NUMBER = "rdx.\n\x14\x12\x00";
+// The magic number of the mappable format, followed by a version.
+constexpr const char* IRMETA_MAPPABLE_MAGIC_NUMBER = "rdx.\n\x14\x13\x00";
+constexpr uint32_t IRMETA_VERSION = 2;
 
 PACKED(struct ir_meta_header_t {
   char magic[8];
@@ -27,13 +33,35 @@ PACKED(struct ir_meta_header_t {
   uint32_t rstate_size; // size of IRMetaIO::bit_rstate_t.
 });
 
-void serialize_str(const std::string_view str, std::ofstream& ostrm) {
-  char data[5];
-  write_uleb128((uint8_t*)data, str.size());
-  ostrm.write(data, uleb128_encoding_size(str.size()));
-  ostrm.write(str.data(), str.size());
-  ostrm.put('\0');
-}
+/**
+ * The mappable format consists of this header, an array of fixed-size
+ * records, and a string table of null terminated strings, which records refer
+ * to by offset. Loading it maps the file, and turns offsets into pointers.
+ */
+PACKED(struct ir_meta_mappable_header_t {
+  char magic[8];
+  uint32_t version;
+  uint32_t file_size;
+  uint32_t rstate_size; // size of IRMetaIO::bit_rstate_t.
+  uint32_t record_size; // size of ir_meta_record_t.
+  uint32_t records_off;
+  uint32_t records_count;
+  uint32_t strings_off;
+  uint32_t strings_size;
+});
+
+constexpr uint32_t NO_STRING = 0xffffffff;
+
+PACKED(struct ir_meta_record_t {
+  char type; // BlockType
+  // The descriptor of the class or member, e.g. LFoo;.bar:(I)V for a method.
+  uint32_t descriptor;
+  // The deobfuscated name, or NO_STRING if it is empty or the same as the
+  // descriptor; either way, loading sets it to the descriptor.
+  uint32_t deobfuscated_name;
+  // An IRMetaIO::bit_rstate_t.
+  char rstate[sizeof(ir_meta_io::IRMetaIO::bit_rstate_t)];
+});
 
 DexField* find_field(const DexClass* cls, const std::string& name) {
   auto result =
@@ -74,19 +102,6 @@ DexMethod* find_method(const DexClass* cls, const std::string& name_and_proto) {
   return *result2;
 }
 
-/**
- * Serialize deobfuscated_name and rstate of class, method or field.
- */
-template <typename T>
-void serialize_name_and_rstate(const T* obj, std::ofstream& ostrm) {
-  if (show(obj) != obj->get_deobfuscated_name_or_empty()) {
-    serialize_str(obj->get_deobfuscated_name_or_empty(), ostrm);
-  } else {
-    serialize_str("", ostrm);
-  }
-  ir_meta_io::IRMetaIO::serialize_rstate(obj->rstate, ostrm);
-}
-
 template <typename T>
 void deserialize_name_and_rstate(const char** _ptr, T* obj) {
   auto size = read_uleb128((const uint8_t**)_ptr);
@@ -103,8 +118,89 @@ void deserialize_name_and_rstate(const char** _ptr, T* obj) {
 enum BlockType : char { ClassBlock, FieldBlock, MethodBlock, EndOfBlock };
 
 /**
- * Serialize meta data of classes into binary format.
- * A class's meta looks like this:
+ * The strings and records of the mappable format; identical strings are
+ * stored once.
+ */
+class MappableWriter {
+ public:
+  template <typename T>
+  void add(BlockType type, const T* obj) {
+    ir_meta_record_t record;
+    record.type = type;
+    auto descriptor = show(obj);
+    record.descriptor = add_string(descriptor);
+    auto deobfuscated_name = obj->get_deobfuscated_name_or_empty();
+    record.deobfuscated_name =
+        deobfuscated_name.empty() || deobfuscated_name == descriptor
+            ? NO_STRING
+            : add_string(std::string(deobfuscated_name));
+    auto rstate = ir_meta_io::IRMetaIO::to_bit_rstate(obj->rstate);
+    memcpy(record.rstate, &rstate, sizeof(record.rstate));
+    m_records.push_back(record);
+  }
+
+  void write(std::ofstream& ostrm) const {
+    ir_meta_mappable_header_t header;
+    memcpy(header.magic, IRMETA_MAPPABLE_MAGIC_NUMBER, 8);
+    header.version = IRMETA_VERSION;
+    header.rstate_size = sizeof(ir_meta_io::IRMetaIO::bit_rstate_t);
+    header.record_size = sizeof(ir_meta_record_t);
+    header.records_off = sizeof(header);
+    header.records_count = m_records.size();
+    header.strings_off =
+        header.records_off + m_records.size() * sizeof(ir_meta_record_t);
+    header.strings_size = m_strings.size();
+    header.file_size = header.strings_off + header.strings_size;
+    ostrm.write((const char*)&header, sizeof(header));
+    ostrm.write((const char*)m_records.data(),
+                m_records.size() * sizeof(ir_meta_record_t));
+    ostrm.write(m_strings.data(), m_strings.size());
+  }
+
+ private:
+  uint32_t add_string(const std::string& str) {
+    auto it = m_string_offsets.find(str);
+    if (it != m_string_offsets.end()) {
+      return it->second;
+    }
+    uint32_t offset = m_strings.size();
+    m_strings.insert(m_strings.end(), str.begin(), str.end());
+    m_strings.push_back('\0');
+    m_string_offsets.emplace(str, offset);
+    return offset;
+  }
+
+  std::vector<ir_meta_record_t> m_records;
+  std::vector<char> m_strings;
+  std::unordered_map<std::string, uint32_t> m_string_offsets;
+};
+
+/**
+ * Collects the meta data of classes and of their members that do not have
+ * default meta data.
+ */
+void serialize_class_data(const Scope& classes, MappableWriter& writer) {
+  auto add_members = [&](BlockType type, const auto& members) {
+    for (const auto* member : members) {
+      if (!ir_meta_io::IRMetaIO::is_default_meta(member)) {
+        writer.add(type, member);
+      }
+    }
+  };
+  for (const DexClass* cls : classes) {
+    if (!ir_meta_io::IRMetaIO::is_default_meta(cls)) {
+      writer.add(BlockType::ClassBlock, cls);
+    }
+    add_members(BlockType::FieldBlock, cls->get_sfields());
+    add_members(BlockType::FieldBlock, cls->get_ifields());
+    add_members(BlockType::MethodBlock, cls->get_dmethods());
+    add_members(BlockType::MethodBlock, cls->get_vmethods());
+  }
+}
+
+/**
+ * Deserialize meta data of classes in the original format, where a class's
+ * meta looks like this:
  *  class_name
  *  deobfuscated_name
  *  ReferencedState
@@ -120,57 +216,6 @@ enum BlockType : char { ClassBlock, FieldBlock, MethodBlock, EndOfBlock };
  *    ...
  *  ...
  */
-void serialize_class_data(const Scope& classes, std::ofstream& ostrm) {
-  walk::classes(classes, [&](const DexClass* cls) {
-    // Fields
-    std::vector<const DexField*> fields;
-    for (const DexField* field : cls->get_sfields()) {
-      if (!ir_meta_io::IRMetaIO::is_default_meta(field)) {
-        fields.push_back(field);
-      }
-    }
-    for (const DexField* field : cls->get_ifields()) {
-      if (!ir_meta_io::IRMetaIO::is_default_meta(field)) {
-        fields.push_back(field);
-      }
-    }
-    // Methods
-    std::vector<const DexMethod*> methods;
-    for (const DexMethod* method : cls->get_dmethods()) {
-      if (!ir_meta_io::IRMetaIO::is_default_meta(method)) {
-        methods.push_back(method);
-      }
-    }
-    for (const DexMethod* method : cls->get_vmethods()) {
-      if (!ir_meta_io::IRMetaIO::is_default_meta(method)) {
-        methods.push_back(method);
-      }
-    }
-
-    // Classes
-    if (!fields.empty() || !methods.empty() ||
-        !ir_meta_io::IRMetaIO::is_default_meta(cls)) {
-      ostrm.put(BlockType::ClassBlock);
-      serialize_str(cls->c_str(), ostrm);
-      serialize_name_and_rstate(cls, ostrm);
-    }
-
-    for (const DexField* field : fields) {
-      ostrm.put(BlockType::FieldBlock);
-      serialize_str(field->c_str(), ostrm);
-      serialize_name_and_rstate(field, ostrm);
-    }
-
-    for (const DexMethod* method : methods) {
-      ostrm.put(BlockType::MethodBlock);
-      string_builders::StaticStringBuilder<3> b;
-      b << method->c_str() << ":" << show(method->get_proto());
-      serialize_str(b.str(), ostrm);
-      serialize_name_and_rstate(method, ostrm);
-    }
-  });
-}
-
 void deserialize_class_data(std::ifstream& istrm, uint32_t data_size) {
   auto data = std::make_unique<char[]>(data_size);
   istrm.read((char*)data.get(), data_size);
@@ -208,6 +253,79 @@ void deserialize_class_data(std::ifstream& istrm, uint32_t data_size) {
     }
   }
 }
+bool deserialize_mappable_class_data(const char* data, size_t size) {
+  ir_meta_mappable_header_t header;
+  if (size < sizeof(header)) {
+    std::cerr << "Truncated IR meta data\n";
+    return false;
+  }
+  memcpy(&header, data, sizeof(header));
+  if (header.version != IRMETA_VERSION ||
+      header.rstate_size != sizeof(ir_meta_io::IRMetaIO::bit_rstate_t) ||
+      header.record_size != sizeof(ir_meta_record_t)) {
+    std::cerr << "Could not load the outdated IR meta data\n";
+    return false;
+  }
+  if (header.file_size != size ||
+      header.records_off + (uint64_t)header.records_count *
+                               sizeof(ir_meta_record_t) >
+          header.strings_off ||
+      (uint64_t)header.strings_off + header.strings_size > size ||
+      (header.strings_size > 0 &&
+       data[header.strings_off + header.strings_size - 1] != '\0')) {
+    std::cerr << "Corrupted IR meta data\n";
+    return false;
+  }
+  const auto* records =
+      reinterpret_cast<const ir_meta_record_t*>(data + header.records_off);
+  const char* strings = data + header.strings_off;
+  auto get_string = [&](uint32_t offset) {
+    always_assert(offset < header.strings_size);
+    return std::string_view(strings + offset);
+  };
+  auto set_name_and_rstate = [&](const ir_meta_record_t& record, auto* obj) {
+    if (record.deobfuscated_name == NO_STRING) {
+      obj->set_deobfuscated_name(show(obj));
+    } else {
+      obj->set_deobfuscated_name(
+          std::string(get_string(record.deobfuscated_name)));
+    }
+    ir_meta_io::IRMetaIO::bit_rstate_t rstate;
+    memcpy(&rstate, record.rstate, sizeof(record.rstate));
+    ir_meta_io::IRMetaIO::from_bit_rstate(rstate, obj->rstate);
+  };
+  for (uint32_t i = 0; i < header.records_count; ++i) {
+    ir_meta_record_t record;
+    memcpy(&record, records + i, sizeof(record));
+    auto descriptor = get_string(record.descriptor);
+    switch (record.type) {
+    case BlockType::ClassBlock: {
+      DexClass* cls = type_class(DexType::get_type(descriptor));
+      always_assert_log(cls != nullptr, "Unknown class %s", descriptor.data());
+      set_name_and_rstate(record, cls);
+      break;
+    }
+    case BlockType::FieldBlock: {
+      auto* field = DexField::get_field(descriptor);
+      always_assert_log(field != nullptr && field->is_def(),
+                        "Unknown field %s", descriptor.data());
+      set_name_and_rstate(record, field->as_def());
+      break;
+    }
+    case BlockType::MethodBlock: {
+      auto* method = DexMethod::get_method(descriptor);
+      always_assert_log(method != nullptr && method->is_def(),
+                        "Unknown method %s", descriptor.data());
+      set_name_and_rstate(record, method->as_def());
+      break;
+    }
+    default: {
+      not_reached();
+    }
+    }
+  }
+  return true;
+}
 } // namespace
 
 namespace ir_meta_io {
@@ -216,22 +334,10 @@ void dump(const Scope& classes, const std::string& output_dir) {
   std::string output_file = output_dir + IRMETA_FILE_NAME;
   std::ofstream ostrm(output_file, std::ios::binary | std::ios::trunc);
 
-  ir_meta_header_t meta_header;
-  memcpy(meta_header.magic, IRMETA_MAGIC_NUMBER, 8);
-  meta_header.checksum = 0;
-  meta_header.file_size = 0;
-  meta_header.classes_size = 0;
-  meta_header.rstate_size = sizeof(IRMetaIO::bit_rstate_t);
-  ostrm.write((char*)&meta_header, sizeof(meta_header));
-
-  serialize_class_data(classes, ostrm);
-  meta_header.classes_size = (uint32_t)ostrm.tellp() - sizeof(meta_header);
-
+  MappableWriter writer;
+  serialize_class_data(classes, writer);
   // TODO(fengliu): Serialize pass related data
-
-  meta_header.file_size = ostrm.tellp();
-  ostrm.seekp(0);
-  ostrm.write((char*)&meta_header, sizeof(meta_header));
+  writer.write(ostrm);
 }
 
 bool load(const std::string& input_dir) {
@@ -244,6 +350,12 @@ bool load(const std::string& input_dir) {
 
   ir_meta_header_t meta_header;
   istrm.read((char*)&meta_header, sizeof(meta_header));
+  if (memcmp(meta_header.magic, IRMETA_MAPPABLE_MAGIC_NUMBER, 8) == 0) {
+    istrm.close();
+    auto mapped_file = RedexMappedFile::open(input_file);
+    return deserialize_mappable_class_data(mapped_file.const_data(),
+                                           mapped_file.size());
+  }
   if (strcmp(meta_header.magic, IRMETA_MAGIC_NUMBER) != 0) {
     std::cerr << "May be not valid meta file\n";
     return false;
@@ -266,6 +378,17 @@ void IRMetaIO::serialize_rstate(const ReferencedState& rstate,
   ostrm.write((char*)&bit_rstate, sizeof(bit_rstate));
 }
 
+IRMetaIO::bit_rstate_t IRMetaIO::to_bit_rstate(const ReferencedState& rstate) {
+  bit_rstate_t bit_rstate;
+  bit_rstate.inner_struct = rstate.inner_struct;
+  return bit_rstate;
+}
+
+void IRMetaIO::from_bit_rstate(const bit_rstate_t& bit_rstate,
+                               ReferencedState& rstate) {
+  rstate.inner_struct = bit_rstate.inner_struct;
+}
+
 void IRMetaIO::deserialize_rstate(const char** _ptr, ReferencedState& rstate) {
   bit_rstate_t* bit_rstate = (bit_rstate_t*)(*_ptr);
   rstate.inner_struct = bit_rstate->inner_struct;
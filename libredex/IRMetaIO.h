@@ -26,6 +26,9 @@ class IRMetaIO {
   static void serialize_rstate(const ReferencedState& rstate,
                                std::ofstream& ostrm);
   static void deserialize_rstate(const char** _ptr, ReferencedState& rstate);
+  static bit_rstate_t to_bit_rstate(const ReferencedState& rstate);
+  static void from_bit_rstate(const bit_rstate_t& bit_rstate,
+                              ReferencedState& rstate);
 
   /**
    * Only serialize meta data of class/method/field if they are not default
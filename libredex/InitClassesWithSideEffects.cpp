@@ -7,6 +7,10 @@
 
 #include "InitClassesWithSideEffects.h"
 
+#include <algorithm>
+#include <boost/functional/hash.hpp>
+
+#include "EditableCfgAdapter.h"
 #include "MethodUtil.h"
 #include "Timer.h"
 #include "Walkers.h"
@@ -14,31 +18,64 @@
 
 namespace init_classes {
 
+size_t InitClassesWithSideEffects::fingerprint(
+    const DexClass* cls, const std::vector<const DexMethod*>& methods) {
+  size_t seed = 0;
+  boost::hash_combine(seed, cls);
+  for (; cls && !cls->is_external();
+       cls = type_class(cls->get_super_class())) {
+    boost::hash_combine(seed, cls->get_type());
+    boost::hash_combine(seed, cls->get_clinit());
+  }
+  for (const auto* method : methods) {
+    boost::hash_combine(seed, method);
+    const auto* code = method->get_code();
+    if (!code) {
+      continue;
+    }
+    editable_cfg_adapter::iterate(code, [&](const MethodItemEntry& mie) {
+      boost::hash_combine(seed, mie.insn->hash());
+      return editable_cfg_adapter::LOOP_CONTINUE;
+    });
+  }
+  return seed;
+}
+
 const InitClasses* InitClassesWithSideEffects::compute(
     const DexClass* cls,
-    const method::ClInitHasNoSideEffectsPredicate& clinit_has_no_side_effects,
-    const InsertOnlyConcurrentSet<DexMethod*>* non_true_virtuals) {
+    const method::ClInitHasNoSideEffectsPredicate& clinit_has_no_side_effects) {
   const DexType* key = cls->get_type();
   auto [ptr, emplaced] =
       m_init_classes.get_or_create_and_assert_equal(key, [&](const auto*) {
+        Dependencies dependencies;
+        method::ClInitHasNoSideEffectsPredicate recording_predicate =
+            [&](const DexType* type) {
+              dependencies.types.push_back(type);
+              return clinit_has_no_side_effects(type);
+            };
         InitClasses classes;
         const auto* refined_cls = method::clinit_may_have_side_effects(
             cls, /* allow_benign_method_invocations */ true,
-            &clinit_has_no_side_effects, non_true_virtuals);
+            &recording_predicate, m_non_true_virtuals.get(),
+            &dependencies.methods);
         if (refined_cls == nullptr) {
         } else if (refined_cls != cls) {
-          classes = *compute(refined_cls, clinit_has_no_side_effects,
-                             non_true_virtuals);
+          dependencies.types.push_back(refined_cls->get_type());
+          classes = *compute(refined_cls, clinit_has_no_side_effects);
         } else {
           classes.push_back(cls);
           auto super_cls = type_class(cls->get_super_class());
           if (super_cls) {
-            const auto super_classes = compute(
-                super_cls, clinit_has_no_side_effects, non_true_virtuals);
+            dependencies.types.push_back(super_cls->get_type());
+            const auto super_classes =
+                compute(super_cls, clinit_has_no_side_effects);
             classes.insert(classes.end(), super_classes->begin(),
                            super_classes->end());
           }
         }
+        dependencies.fingerprint = fingerprint(cls, dependencies.methods);
+        m_dependencies.insert_or_assign(
+            std::make_pair(key, std::move(dependencies)));
         return classes;
       });
   if (emplaced && ptr->empty()) {
@@ -47,21 +84,13 @@ const InitClasses* InitClassesWithSideEffects::compute(
   return ptr;
 }
 
-InitClassesWithSideEffects::InitClassesWithSideEffects(
-    const Scope& scope,
-    bool create_init_class_insns,
-    const method_override_graph::Graph* method_override_graph)
-    : m_create_init_class_insns(create_init_class_insns) {
-  Timer t("InitClassesWithSideEffects");
-  std::unique_ptr<InsertOnlyConcurrentSet<DexMethod*>> non_true_virtuals;
-  if (method_override_graph) {
-    non_true_virtuals = std::make_unique<InsertOnlyConcurrentSet<DexMethod*>>(
-        method_override_graph::get_non_true_virtuals(*method_override_graph,
-                                                     scope));
-  }
+void InitClassesWithSideEffects::compute_fixpoint(
+    const Scope& classes,
+    const InsertOnlyConcurrentMap<const DexType*, InitClasses>& known) {
   size_t prev_trivial_init_classes;
   do {
     auto prev_init_classes = std::move(m_init_classes);
+    m_init_classes = known;
     prev_trivial_init_classes = m_trivial_init_classes.exchange(0);
     method::ClInitHasNoSideEffectsPredicate clinit_has_no_side_effects =
         [&](const DexType* type) {
@@ -74,9 +103,8 @@ InitClassesWithSideEffects::InitClassesWithSideEffects(
                          cls->rstate.clinit_has_no_side_effects());
         };
     ConcurrentSet<DexClass*> added_clinit_has_no_side_effects;
-    walk::parallel::classes(scope, [&](DexClass* cls) {
-      if (compute(cls, clinit_has_no_side_effects, non_true_virtuals.get())
-              ->empty() &&
+    walk::parallel::classes(classes, [&](DexClass* cls) {
+      if (compute(cls, clinit_has_no_side_effects)->empty() &&
           !cls->rstate.clinit_has_no_side_effects()) {
         added_clinit_has_no_side_effects.insert(cls);
       }
@@ -92,6 +120,105 @@ InitClassesWithSideEffects::InitClassesWithSideEffects(
   } while (m_trivial_init_classes > prev_trivial_init_classes);
 }
 
+bool InitClassesWithSideEffects::set_non_true_virtuals(
+    const Scope& scope,
+    const method_override_graph::Graph* method_override_graph) {
+  std::unique_ptr<InsertOnlyConcurrentSet<DexMethod*>> non_true_virtuals;
+  if (method_override_graph) {
+    non_true_virtuals = std::make_unique<InsertOnlyConcurrentSet<DexMethod*>>(
+        method_override_graph::get_non_true_virtuals(*method_override_graph,
+                                                     scope));
+  }
+  bool changed;
+  if (!non_true_virtuals || !m_non_true_virtuals) {
+    changed = non_true_virtuals != m_non_true_virtuals;
+  } else {
+    changed = non_true_virtuals->size() != m_non_true_virtuals->size() ||
+              std::any_of(non_true_virtuals->begin(), non_true_virtuals->end(),
+                          [&](DexMethod* method) {
+                            return !m_non_true_virtuals->count(method);
+                          });
+  }
+  m_non_true_virtuals = std::move(non_true_virtuals);
+  return changed;
+}
+
+InitClassesWithSideEffects::InitClassesWithSideEffects(
+    const Scope& scope,
+    bool create_init_class_insns,
+    const method_override_graph::Graph* method_override_graph)
+    : m_create_init_class_insns(create_init_class_insns) {
+  Timer t("InitClassesWithSideEffects");
+  set_non_true_virtuals(scope, method_override_graph);
+  compute_fixpoint(scope, {});
+}
+
+size_t InitClassesWithSideEffects::update(
+    const Scope& scope,
+    const method_override_graph::Graph* method_override_graph) {
+  Timer t("InitClassesWithSideEffects::update");
+  // Which methods are true virtuals affects the results of all classes.
+  bool all_stale = set_non_true_virtuals(scope, method_override_graph);
+
+  ConcurrentSet<const DexType*> changed;
+  walk::parallel::classes(scope, [&](DexClass* cls) {
+    const auto* dependencies = m_dependencies.get_unsafe(cls->get_type());
+    if (all_stale || dependencies == nullptr ||
+        dependencies->fingerprint !=
+            fingerprint(cls, dependencies->methods)) {
+      changed.insert(cls->get_type());
+    }
+  });
+  if (changed.empty()) {
+    return 0;
+  }
+
+  // Results that used a stale result are stale as well.
+  std::unordered_map<const DexType*, std::vector<const DexType*>> dependents;
+  for (const auto& [type, dependencies] : m_dependencies) {
+    for (const auto* dependency : dependencies.types) {
+      dependents[dependency].push_back(type);
+    }
+  }
+  std::unordered_set<const DexType*> stale(changed.begin(), changed.end());
+  std::vector<const DexType*> worklist(stale.begin(), stale.end());
+  while (!worklist.empty()) {
+    const auto* type = worklist.back();
+    worklist.pop_back();
+    auto it = dependents.find(type);
+    if (it == dependents.end()) {
+      continue;
+    }
+    for (const auto* dependent : it->second) {
+      if (stale.insert(dependent).second) {
+        worklist.push_back(dependent);
+      }
+    }
+  }
+
+  InsertOnlyConcurrentMap<const DexType*, InitClasses> known;
+  for (const auto& [type, classes] : m_init_classes) {
+    if (!stale.count(type)) {
+      known.emplace(type, classes);
+    }
+  }
+  for (const auto* type : stale) {
+    m_dependencies.erase(type);
+  }
+  // Stale results must not be consulted while recomputing.
+  m_init_classes = known;
+  Scope classes;
+  for (auto* cls : scope) {
+    if (stale.count(cls->get_type())) {
+      classes.push_back(cls);
+    }
+  }
+  compute_fixpoint(classes, known);
+  TRACE(ICL, 1, "InitClassesWithSideEffects: %zu of %zu classes recomputed",
+        stale.size(), scope.size());
+  return stale.size();
+}
+
 const InitClasses* InitClassesWithSideEffects::get(const DexType* type) const {
   auto it = m_init_classes.find(type);
   return it == m_init_classes.end() ? &m_empty_init_classes : &it->second;
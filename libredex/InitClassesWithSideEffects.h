@@ -23,18 +23,46 @@ using InitClasses = std::vector<const DexClass*>;
 /**
  * For a given scope, this class provides information about which static
  * initializer with side effects get triggered when some class is initialized.
+ *
+ * The result for each class records the code it was computed from, so that it
+ * can be brought up to date with `update` after the scope changed, instead of
+ * analyzing all static initializers again.
  */
 class InitClassesWithSideEffects {
  private:
+  // What the result for a class was computed from.
+  struct Dependencies {
+    size_t fingerprint{0};
+    // The methods whose code was analyzed.
+    std::vector<const DexMethod*> methods;
+    // The classes whose results were used.
+    std::vector<const DexType*> types;
+  };
+
   InsertOnlyConcurrentMap<const DexType*, InitClasses> m_init_classes;
+  ConcurrentMap<const DexType*, Dependencies> m_dependencies;
   std::atomic<size_t> m_trivial_init_classes{0};
   InitClasses m_empty_init_classes;
   bool m_create_init_class_insns;
+  std::unique_ptr<InsertOnlyConcurrentSet<DexMethod*>> m_non_true_virtuals;
+
+  static size_t fingerprint(const DexClass* cls,
+                            const std::vector<const DexMethod*>& methods);
+
+  const InitClasses* compute(const DexClass* cls,
+                             const method::ClInitHasNoSideEffectsPredicate&
+                                 clinit_has_no_side_effects);
+
+  // Computes the results for the given classes, starting from the already
+  // known results in `known`.
+  void compute_fixpoint(
+      const Scope& classes,
+      const InsertOnlyConcurrentMap<const DexType*, InitClasses>& known);
 
-  const InitClasses* compute(
-      const DexClass* cls,
-      const method::ClInitHasNoSideEffectsPredicate& clinit_has_no_side_effects,
-      const InsertOnlyConcurrentSet<DexMethod*>* non_true_virtuals);
+  // Returns whether the non-true virtuals changed.
+  bool set_non_true_virtuals(
+      const Scope& scope,
+      const method_override_graph::Graph* method_override_graph);
 
  public:
   InitClassesWithSideEffects(
@@ -42,6 +70,17 @@ class InitClassesWithSideEffects {
       bool create_init_class_insns,
       const method_override_graph::Graph* method_override_graph = nullptr);
 
+  // Brings the results up to date after the scope changed. Only the classes
+  // whose static initializers, or the code they call, or whose superclass
+  // chains changed are analyzed again, together with the classes whose
+  // results depended on them. This invalidates the pointers returned by `get`.
+  // Returns the number of classes whose results were recomputed.
+  size_t update(
+      const Scope& scope,
+      const method_override_graph::Graph* method_override_graph = nullptr);
+
+  bool create_init_class_insns() const { return m_create_init_class_insns; }
+
   // Determine list of classes with static initializers with side effects that
   // would get triggered when the given type is initialized. The list is ordered
   // such that base types come later.
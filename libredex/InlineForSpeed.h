@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <utility>
+#include <vector>
+
 #include "DexClass.h"
 #include "MethodProfiles.h"
 
@@ -18,6 +21,12 @@ class InlineForSpeed {
  public:
   virtual ~InlineForSpeed() {}
 
+  // Called with all caller/callee pairs before any of them is queried via
+  // should_inline_generic, so that decisions can be computed in bulk.
+  virtual void prepare_candidates(
+      const std::vector<std::pair<const DexMethod*, const DexMethod*>>&
+      /* candidates */) {}
+
   // Whether to inline the given callee method into the given caller in the
   // context of the given callsite (independent of callsite).
   virtual bool should_inline_generic(const DexMethod* caller_method,
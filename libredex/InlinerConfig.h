@@ -35,6 +35,15 @@ struct InlinerConfig {
   bool intermediate_shrinking{false};
   shrinker::ShrinkerConfig shrinker;
   bool shrink_other_methods{true};
+  // Remember which methods were shrunk at which code hash across inliner
+  // invocations, and don't shrink them again while they remain unchanged.
+  bool cache_shrunk_methods{true};
+  // Prioritize inlining work by the estimated cost of the longest chain of
+  // callers waiting for each method, instead of just the chain length.
+  bool schedule_by_cost{false};
+  // Memory budget in MB for the caches of inlined costs, including the
+  // call-site specific reduced code; 0 means unbounded.
+  size_t inlined_costs_cache_mb{0};
   bool unique_inlined_registers{true};
   bool respect_sketchy_methods{true};
   bool debug{false};
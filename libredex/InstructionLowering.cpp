@@ -356,6 +356,30 @@ size_t lower_check_cast(DexMethod*, IRCode* code, IRList::iterator* it_) {
   return extra_instructions;
 }
 
+/*
+ * Range instructions address their registers with 16 bits, no matter how low
+ * they are.
+ */
+void count_compact_registers(const DexInstruction* insn, Stats* stats) {
+  if (insn->has_range()) {
+    ++stats->reg_insns;
+    return;
+  }
+  if (!insn->has_dest() && insn->srcs_size() == 0) {
+    return;
+  }
+  ++stats->reg_insns;
+  if (insn->has_dest() && insn->dest() > 0xf) {
+    return;
+  }
+  for (unsigned i = 0; i < insn->srcs_size(); ++i) {
+    if (insn->src(i) > 0xf) {
+      return;
+    }
+  }
+  ++stats->compact_reg_insns;
+}
+
 void lower_fill_array_data(DexMethod*, IRCode* code, IRList::iterator* it_) {
   auto& it = *it_;
   const auto* insn = it->insn;
@@ -529,7 +553,10 @@ Stats lower(DexMethod* method, bool lower_with_cfg, ConfigFiles* conf) {
     if (it->type != MFLOW_DEX_OPCODE) {
       continue;
     }
+    auto op = it->dex_insn->opcode();
+    stats.binops += op >= DOPCODE_ADD_INT && op <= DOPCODE_REM_DOUBLE;
     stats.to_2addr += try_2addr_conversion(&*it);
+    count_compact_registers(it->dex_insn, &stats);
   }
   return stats;
 }
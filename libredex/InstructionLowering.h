@@ -27,6 +27,12 @@ namespace instruction_lowering {
 
 struct Stats {
   size_t to_2addr{0};
+  // Arithmetic binops, i.e. the instructions that have a /2addr form.
+  size_t binops{0};
+  // Instructions that address registers, and those among them whose registers
+  // all fit in 4 bits.
+  size_t reg_insns{0};
+  size_t compact_reg_insns{0};
   size_t move_for_check_cast{0};
   struct SparseSwitches {
     struct Data {
@@ -56,6 +62,9 @@ struct Stats {
 
   Stats& operator+=(const Stats& that) {
     to_2addr += that.to_2addr;
+    binops += that.binops;
+    reg_insns += that.reg_insns;
+    compact_reg_insns += that.compact_reg_insns;
     move_for_check_cast += that.move_for_check_cast;
     sparse_switches += that.sparse_switches;
     return *this;
@@ -69,8 +78,9 @@ struct Stats {
  *   - Pick the smallest opcode that can address its operands.
  *   - Insert move instructions as necessary for check-cast instructions that
  *     have different src and dest registers.
- *   - Record the number of instructions converted to /2addr form, and the
- *     number of move instructions inserted because of check-casts.
+ *   - Record the number of instructions converted to /2addr form, the number
+ *     of instructions whose registers all fit in 4 bits, and the number of
+ *     move instructions inserted because of check-casts.
  */
 Stats lower(DexMethod*,
             bool lower_with_cfg = false,
@@ -5,12 +5,18 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <boost/functional/hash.hpp>
 #include <boost/iostreams/device/mapped_file.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <sstream>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <zlib.h>
@@ -24,14 +30,17 @@
 #include <netinet/in.h>
 #endif
 
+#include "BinarySerialization.h"
 #include "Creators.h"
 #include "DexClass.h"
 #include "DuplicateClasses.h"
 #include "JarLoader.h"
+#include "PersistentAnalysisCache.h"
 #include "Show.h"
 #include "Trace.h"
 #include "TypeUtil.h"
 #include "Util.h"
+#include "WorkQueue.h"
 
 /******************
  * Begin Class Loading code.
@@ -243,10 +252,9 @@ bool extract_utf8(std::vector<cp_entry>& cpool,
   return true;
 }
 
-DexField* make_dexfield(std::vector<cp_entry>& cpool,
-                        DexType* self,
-                        cp_field_info& finfo,
-                        std::unordered_set<const DexField*>& added) {
+DexField* resolve_dexfield(std::vector<cp_entry>& cpool,
+                           DexType* self,
+                           const cp_field_info& finfo) {
   std::string_view dbuffer;
   std::string_view nbuffer;
   if (!extract_utf8(cpool, finfo.nameNdx, &nbuffer) ||
@@ -255,18 +263,20 @@ DexField* make_dexfield(std::vector<cp_entry>& cpool,
   }
   auto name = DexString::make_string(nbuffer);
   DexType* desc = DexType::make_type(dbuffer);
-  DexField* field =
-      static_cast<DexField*>(DexField::make_field(self, name, desc));
+  return static_cast<DexField*>(DexField::make_field(self, name, desc));
+}
 
+void define_dexfield(DexField* field,
+                     uint16_t aflags,
+                     std::unordered_set<const DexField*>& added) {
   // We cannot do an existence check because of mixed sources. At least make
   // sure we only add a field here once.
   auto inserted = added.insert(field).second;
   always_assert_type_log(inserted, INVALID_JAVA, "Duplicate field %s",
                          SHOW(field));
 
-  field->set_access((DexAccessFlags)finfo.aflags);
+  field->set_access((DexAccessFlags)aflags);
   field->set_external();
-  return field;
 }
 
 DexType* sSimpleTypeB;
@@ -400,10 +410,9 @@ DexTypeList* extract_arguments(std::string_view& buf) {
   return DexTypeList::make_type_list(std::move(args));
 }
 
-DexMethod* make_dexmethod(std::vector<cp_entry>& cpool,
-                          DexType* self,
-                          cp_method_info& finfo,
-                          std::unordered_set<const DexMethod*>& added) {
+DexMethod* resolve_dexmethod(std::vector<cp_entry>& cpool,
+                             DexType* self,
+                             const cp_method_info& finfo) {
   std::string_view dbuffer;
   std::string_view nbuffer;
   if (!extract_utf8(cpool, finfo.nameNdx, &nbuffer) ||
@@ -417,21 +426,26 @@ DexMethod* make_dexmethod(std::vector<cp_entry>& cpool,
   DexType* rtype = parse_type(ptr);
   if (rtype == nullptr) return nullptr;
   DexProto* proto = DexProto::make_proto(rtype, tlist);
-  DexMethod* method =
-      static_cast<DexMethod*>(DexMethod::make_method(self, name, proto));
+  return static_cast<DexMethod*>(DexMethod::make_method(self, name, proto));
+}
+
+bool define_dexmethod(DexMethod* method,
+                      uint16_t aflags,
+                      std::unordered_set<const DexMethod*>& added) {
   auto inserted = added.insert(method).second;
   always_assert_type_log(inserted, INVALID_JAVA, "Duplicate method %s",
                          SHOW(method));
   if (method->is_concrete()) {
     std::cerr << "Pre-concrete method attempted to load '" << show(method)
               << "', bailing\n";
-    return nullptr;
+    return false;
   }
-  uint32_t access = finfo.aflags;
+  auto name = method->get_name()->str();
+  uint32_t access = aflags;
   bool is_virt = true;
-  if (nbuffer[0] == '<') {
+  if (name[0] == '<') {
     is_virt = false;
-    if (nbuffer[1] == 'i') {
+    if (name[1] == 'i') {
       access |= ACC_CONSTRUCTOR;
     }
   } else if (access & (ACC_PRIVATE | ACC_STATIC))
@@ -439,57 +453,164 @@ DexMethod* make_dexmethod(std::vector<cp_entry>& cpool,
   method->set_access((DexAccessFlags)access);
   method->set_virtual(is_virt);
   method->set_external();
-  return method;
+  return true;
 }
 
-} // namespace
+/*
+ * A class file with its constant pool references resolved, and whose class
+ * and members are not defined yet. Resolving only interns types, strings and
+ * member references, so class files can be resolved in parallel; defining
+ * them has to happen in order, as the first definition of a class wins.
+ */
+struct resolved_class {
+  template <typename Member>
+  struct member {
+    uint16_t aflags;
+    Member* ref;
+    uint8_t* attributes;
+  };
 
-bool parse_class(uint8_t* buffer,
-                 size_t buffer_size,
-                 Scope* classes,
-                 attribute_hook_t attr_hook,
-                 const jar_loader::duplicate_allowed_hook_t& is_allowed,
-                 const DexLocation* jar_location) {
-  auto buffer_end = buffer + buffer_size;
-  uint32_t magic = read32(buffer, buffer_end);
-  uint16_t vminor DEBUG_ONLY = read16(buffer, buffer_end);
-  uint16_t vmajor DEBUG_ONLY = read16(buffer, buffer_end);
-  uint16_t cp_count = read16(buffer, buffer_end);
-  if (magic != kClassMagic) {
-    std::cerr << "Bad class magic " << std::hex << magic << ", Bailing\n";
-    return false;
-  }
+  uint8_t* buffer_end{nullptr};
   std::vector<cp_entry> cpool;
-  cpool.resize(cp_count);
-  /* The zero'th entry is always empty.  Java is annoying. */
-  for (size_t i = 1; i < cp_count; i++) {
-    if (!parse_cp_entry(buffer, buffer_end, cpool[i])) return false;
-    if (cpool[i].tag == CP_CONST_LONG || cpool[i].tag == CP_CONST_DOUBLE) {
-      if (i + 1 >= cp_count) {
-        std::cerr << "Bad long/double constant, bailing.\n";
-        return false;
+  bool is_module{false};
+  uint16_t aflags{0};
+  DexType* self{nullptr};
+  DexType* super{nullptr};
+  std::vector<DexType*> interfaces;
+  std::vector<member<DexField>> fields;
+  std::vector<member<DexMethod>> methods;
+  // Whether the whole class file could be resolved. If not, the error was
+  // reported, or is kept to be rethrown when the class gets defined.
+  bool ok{false};
+  std::exception_ptr error;
+};
+
+bool resolve_class_members(uint8_t* buffer, resolved_class& rc) {
+  auto buffer_end = rc.buffer_end;
+  DexType* self = rc.self;
+  auto& cpool = rc.cpool;
+  uint16_t super = read16(buffer, buffer_end);
+  uint16_t ifcount = read16(buffer, buffer_end);
+  if (super != 0) {
+    rc.super = make_dextype_from_cref(cpool, super);
+    if (rc.super == nullptr) {
+      std::cerr << "Bad super class cpool index " << super << ", Bailing\n";
+      return false;
+    }
+  }
+  for (int i = 0; i < ifcount; i++) {
+    uint16_t iface = read16(buffer, buffer_end);
+    DexType* iftype = make_dextype_from_cref(cpool, iface);
+    if (iftype == nullptr) {
+      std::cerr << "Bad interface cpool index " << super << ", Bailing\n";
+      return false;
+    }
+    rc.interfaces.push_back(iftype);
+  }
+
+  uint16_t fcount = read16(buffer, buffer_end);
+  for (int i = 0; i < fcount; i++) {
+    cp_field_info cpfield;
+    cpfield.aflags = read16(buffer, buffer_end);
+    cpfield.nameNdx = read16(buffer, buffer_end);
+    cpfield.descNdx = read16(buffer, buffer_end);
+    uint8_t* attrPtr = buffer;
+    skip_attributes(buffer, buffer_end);
+    DexField* field = resolve_dexfield(cpool, self, cpfield);
+    if (field == nullptr) return false;
+    rc.fields.push_back({cpfield.aflags, field, attrPtr});
+  }
+
+  uint16_t mcount = read16(buffer, buffer_end);
+  for (int i = 0; i < mcount; i++) {
+    cp_method_info cpmethod;
+    cpmethod.aflags = read16(buffer, buffer_end);
+    cpmethod.nameNdx = read16(buffer, buffer_end);
+    cpmethod.descNdx = read16(buffer, buffer_end);
+    uint8_t* attrPtr = buffer;
+    skip_attributes(buffer, buffer_end);
+    DexMethod* method = resolve_dexmethod(cpool, self, cpmethod);
+    if (method == nullptr) return false;
+    rc.methods.push_back({cpmethod.aflags, method, attrPtr});
+  }
+  return true;
+}
+
+/*
+ * Parses a class file and resolves its references. The buffer must outlive
+ * the result, which points into it.
+ */
+void resolve_class(uint8_t* buffer,
+                   size_t buffer_size,
+                   const DexLocation* jar_location,
+                   resolved_class& rc) {
+  try {
+    auto buffer_end = buffer + buffer_size;
+    rc.buffer_end = buffer_end;
+    uint32_t magic = read32(buffer, buffer_end);
+    uint16_t vminor DEBUG_ONLY = read16(buffer, buffer_end);
+    uint16_t vmajor DEBUG_ONLY = read16(buffer, buffer_end);
+    uint16_t cp_count = read16(buffer, buffer_end);
+    if (magic != kClassMagic) {
+      std::cerr << "Bad class magic " << std::hex << magic << ", Bailing\n";
+      return;
+    }
+    auto& cpool = rc.cpool;
+    cpool.resize(cp_count);
+    /* The zero'th entry is always empty.  Java is annoying. */
+    for (size_t i = 1; i < cp_count; i++) {
+      if (!parse_cp_entry(buffer, buffer_end, cpool[i])) return;
+      if (cpool[i].tag == CP_CONST_LONG || cpool[i].tag == CP_CONST_DOUBLE) {
+        if (i + 1 >= cp_count) {
+          std::cerr << "Bad long/double constant, bailing.\n";
+          return;
+        }
+        cpool[i + 1] = cpool[i];
+        i++;
       }
-      cpool[i + 1] = cpool[i];
-      i++;
     }
+    rc.aflags = read16(buffer, buffer_end);
+    uint16_t clazz = read16(buffer, buffer_end);
+
+    if (is_module((DexAccessFlags)rc.aflags)) {
+      // Classes with the ACC_MODULE access flag are special.  They contain
+      // metadata for the module/package system and don't have a superclass.
+      // Ignore them for now.
+      TRACE(MAIN, 5, "Warning: ignoring module-info class in jar '%s'",
+            jar_location->get_file_name().c_str());
+      rc.is_module = true;
+      rc.ok = true;
+      return;
+    }
+
+    rc.self = make_dextype_from_cref(cpool, clazz);
+    if (rc.self == nullptr) {
+      std::cerr << "Bad class cpool index " << clazz << ", Bailing\n";
+      return;
+    }
+    rc.ok = resolve_class_members(buffer, rc);
+  } catch (...) {
+    rc.error = std::current_exception();
   }
-  uint16_t aflags = read16(buffer, buffer_end);
-  uint16_t clazz = read16(buffer, buffer_end);
-  uint16_t super = read16(buffer, buffer_end);
-  uint16_t ifcount = read16(buffer, buffer_end);
+}
 
-  if (is_module((DexAccessFlags)aflags)) {
-    // Classes with the ACC_MODULE access flag are special.  They contain
-    // metadata for the module/package system and don't have a superclass.
-    // Ignore them for now.
-    TRACE(MAIN, 5, "Warning: ignoring module-info class in jar '%s'",
-          jar_location->get_file_name().c_str());
+/*
+ * Defines the class of a resolved class file, unless a class of that type
+ * exists already.
+ */
+bool define_class(const resolved_class& rc,
+                  Scope* classes,
+                  const attribute_hook_t& attr_hook,
+                  const jar_loader::duplicate_allowed_hook_t& is_allowed,
+                  const DexLocation* jar_location) {
+  if (rc.is_module) {
     return true;
   }
-
-  DexType* self = make_dextype_from_cref(cpool, clazz);
+  DexType* self = rc.self;
   if (self == nullptr) {
-    std::cerr << "Bad class cpool index " << clazz << ", Bailing\n";
+    if (rc.error) {
+      std::rethrow_exception(rc.error);
+    }
     return false;
   }
   DexClass* cls = type_class(self);
@@ -522,31 +643,24 @@ bool parse_class(uint8_t* buffer,
     }
     return true;
   }
+  if (rc.error) {
+    std::rethrow_exception(rc.error);
+  }
+  if (!rc.ok) {
+    return false;
+  }
 
   ClassCreator cc(self, jar_location);
   cc.set_external();
-  if (super != 0) {
-    DexType* sclazz = make_dextype_from_cref(cpool, super);
-    if (sclazz == nullptr) {
-      std::cerr << "Bad super class cpool index " << super << ", Bailing\n";
-      return false;
-    }
-    cc.set_super(sclazz);
-  }
-  cc.set_access((DexAccessFlags)aflags);
-  if (ifcount) {
-    for (int i = 0; i < ifcount; i++) {
-      uint16_t iface = read16(buffer, buffer_end);
-      DexType* iftype = make_dextype_from_cref(cpool, iface);
-      if (iftype == nullptr) {
-        std::cerr << "Bad interface cpool index " << super << ", Bailing\n";
-        return false;
-      }
-      cc.add_interface(iftype);
-    }
+  if (rc.super != nullptr) {
+    cc.set_super(rc.super);
+  }
+  cc.set_access((DexAccessFlags)rc.aflags);
+  for (auto* iftype : rc.interfaces) {
+    cc.add_interface(iftype);
   }
-  uint16_t fcount = read16(buffer, buffer_end);
 
+  auto buffer_end = rc.buffer_end;
   auto invoke_attr_hook =
       [&](const boost::variant<DexField*, DexMethod*>& field_or_method,
           uint8_t* attrPtr) {
@@ -559,7 +673,8 @@ bool parse_class(uint8_t* buffer,
           uint32_t attribute_length = read32(attrPtr, buffer_end);
           std::string_view attribute_name;
           auto extract_res =
-              extract_utf8(cpool, attribute_name_index, &attribute_name);
+              extract_utf8(const_cast<std::vector<cp_entry>&>(rc.cpool),
+                           attribute_name_index, &attribute_name);
           always_assert_log(
               extract_res,
               "attribute hook was specified, but failed to load the attribute "
@@ -570,35 +685,19 @@ bool parse_class(uint8_t* buffer,
       };
 
   std::unordered_set<const DexField*> added_fields;
-  for (int i = 0; i < fcount; i++) {
-    cp_field_info cpfield;
-    cpfield.aflags = read16(buffer, buffer_end);
-    cpfield.nameNdx = read16(buffer, buffer_end);
-    cpfield.descNdx = read16(buffer, buffer_end);
-    uint8_t* attrPtr = buffer;
-    skip_attributes(buffer, buffer_end);
-    DexField* field = make_dexfield(cpool, self, cpfield, added_fields);
-    if (field == nullptr) return false;
-    cc.add_field(field);
-    invoke_attr_hook({field}, attrPtr);
+  for (const auto& field : rc.fields) {
+    define_dexfield(field.ref, field.aflags, added_fields);
+    cc.add_field(field.ref);
+    invoke_attr_hook({field.ref}, field.attributes);
   }
 
-  uint16_t mcount = read16(buffer, buffer_end);
   std::unordered_set<const DexMethod*> added_methods;
-  if (mcount) {
-    for (int i = 0; i < mcount; i++) {
-      cp_method_info cpmethod;
-      cpmethod.aflags = read16(buffer, buffer_end);
-      cpmethod.nameNdx = read16(buffer, buffer_end);
-      cpmethod.descNdx = read16(buffer, buffer_end);
-
-      uint8_t* attrPtr = buffer;
-      skip_attributes(buffer, buffer_end);
-      DexMethod* method = make_dexmethod(cpool, self, cpmethod, added_methods);
-      if (method == nullptr) return false;
-      cc.add_method(method);
-      invoke_attr_hook({method}, attrPtr);
+  for (const auto& method : rc.methods) {
+    if (!define_dexmethod(method.ref, method.aflags, added_methods)) {
+      return false;
     }
+    cc.add_method(method.ref);
+    invoke_attr_hook({method.ref}, method.attributes);
   }
   DexClass* dc = cc.create();
   if (classes != nullptr) {
@@ -637,6 +736,19 @@ bool parse_class(uint8_t* buffer,
   return true;
 }
 
+} // namespace
+
+bool parse_class(uint8_t* buffer,
+                 size_t buffer_size,
+                 Scope* classes,
+                 attribute_hook_t attr_hook,
+                 const jar_loader::duplicate_allowed_hook_t& is_allowed,
+                 const DexLocation* jar_location) {
+  resolved_class rc;
+  resolve_class(buffer, buffer_size, jar_location, rc);
+  return define_class(rc, classes, attr_hook, is_allowed, jar_location);
+}
+
 bool load_class_file(const std::string& filename, Scope* classes) {
   // It's not exactly efficient to call init_basic_types repeatedly for each
   // class file that we load, but load_class_file should typically only be used
@@ -924,8 +1036,15 @@ bool decompress_class(jar_entry& file,
   return true;
 }
 
-constexpr size_t kStartBufferSize = 128 * 1024;
+// The number of class files decompressed and resolved in parallel before
+// their classes get defined, which bounds the memory held by their buffers.
+constexpr size_t kBatchSize = 512;
 
+/*
+ * Loads the classes of the class files of a jar. When `recorded` is given,
+ * the resolved classes, except for modules, are appended to it in the order
+ * of the entries.
+ */
 bool process_jar_entries(
     const DexLocation* location,
     std::vector<jar_entry>& files,
@@ -933,11 +1052,11 @@ bool process_jar_entries(
     const size_t map_size,
     Scope* classes,
     const attribute_hook_t& attr_hook,
-    const jar_loader::duplicate_allowed_hook_t& is_allowed) {
-  ssize_t bufsize = kStartBufferSize;
-  std::unique_ptr<uint8_t[]> outbuffer = std::make_unique<uint8_t[]>(bufsize);
+    const jar_loader::duplicate_allowed_hook_t& is_allowed,
+    std::vector<resolved_class>* recorded = nullptr) {
   constexpr std::string_view kClassEndString = ".class";
   init_basic_types();
+  std::vector<jar_entry*> class_files;
   for (auto& file : files) {
     if (file.cd_entry.ucomp_size == 0) continue;
 
@@ -947,26 +1066,60 @@ bool process_jar_entries(
     auto endcomp =
         filename.substr(filename.length() - kClassEndString.length());
     if (endcomp != kClassEndString) continue;
+    class_files.push_back(&file);
+  }
 
-    // Resize output if necessary.
-    if (bufsize < file.cd_entry.ucomp_size) {
-      while (bufsize < file.cd_entry.ucomp_size)
-        bufsize *= 2;
-      outbuffer = std::make_unique<uint8_t[]>(bufsize);
-    }
-
-    if (!decompress_class(file, mapping, map_size, outbuffer.get(), bufsize)) {
-      return false;
-    }
-
-    if (!parse_class(outbuffer.get(), bufsize, classes, attr_hook, is_allowed,
-                     location)) {
-      return false;
+  // Class files are decompressed and resolved in parallel, which interns all
+  // the types, strings and member references they use. Their classes are
+  // then defined in the order of the entries, so that the first class of a
+  // given type still wins, and failures are reported as before.
+  for (size_t begin = 0; begin < class_files.size(); begin += kBatchSize) {
+    auto end = std::min(begin + kBatchSize, class_files.size());
+    std::vector<std::unique_ptr<uint8_t[]>> buffers(end - begin);
+    std::vector<resolved_class> resolved(end - begin);
+    std::vector<uint8_t> decompressed(end - begin, false);
+    workqueue_run_for<size_t>(begin, end, [&](size_t i) {
+      auto& file = *class_files[i];
+      ssize_t bufsize = file.cd_entry.ucomp_size;
+      auto& buffer = buffers[i - begin];
+      buffer = std::make_unique<uint8_t[]>(bufsize);
+      if (!decompress_class(file, mapping, map_size, buffer.get(), bufsize)) {
+        return;
+      }
+      decompressed[i - begin] = true;
+      resolve_class(buffer.get(), bufsize, location, resolved[i - begin]);
+    });
+    for (size_t i = 0; i < end - begin; i++) {
+      if (!decompressed[i] ||
+          !define_class(resolved[i], classes, attr_hook, is_allowed,
+                        location)) {
+        return false;
+      }
+      if (recorded != nullptr && !resolved[i].is_module) {
+        // The constant pool and the attributes do not outlive the batch.
+        auto& rc = recorded->emplace_back(std::move(resolved[i]));
+        rc.buffer_end = nullptr;
+        rc.cpool = {};
+        for (auto& field : rc.fields) {
+          field.attributes = nullptr;
+        }
+        for (auto& method : rc.methods) {
+          method.attributes = nullptr;
+        }
+      }
     }
   }
   return true;
 }
 
+bool read_jar_entries(const uint8_t* mapping,
+                      size_t size,
+                      std::vector<jar_entry>& files) {
+  pk_cdir_end pce;
+  return find_central_directory(mapping, size, pce) &&
+         validate_pce(pce, size) && get_jar_entries(mapping, size, pce, files);
+}
+
 } // namespace
 
 namespace jar_loader {
@@ -983,15 +1136,8 @@ bool process_jar(const DexLocation* location,
                  Scope* classes,
                  const attribute_hook_t& attr_hook,
                  const jar_loader::duplicate_allowed_hook_t& is_allowed) {
-  pk_cdir_end pce;
   std::vector<jar_entry> files;
-  if (!find_central_directory(mapping, size, pce)) {
-    return false;
-  }
-  if (!validate_pce(pce, size)) {
-    return false;
-  }
-  if (!get_jar_entries(mapping, size, pce, files)) {
+  if (!read_jar_entries(mapping, size, files)) {
     return false;
   }
   if (!process_jar_entries(location, files, mapping, size, classes, attr_hook,
@@ -1025,6 +1171,269 @@ bool load_jar_file(const DexLocation* location,
   return true;
 }
 
+namespace {
+
+// Bump whenever the encoding of the recorded classes changes.
+constexpr uint32_t kLibraryClassesVersion = 1;
+constexpr uint32_t kNoString = std::numeric_limits<uint32_t>::max();
+
+uint64_t hash_jar(const uint8_t* mapping, size_t size) {
+  size_t hash = size;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, mapping + i, sizeof(word));
+    boost::hash_combine(hash, word);
+  }
+  for (; i < size; i++) {
+    boost::hash_combine(hash, mapping[i]);
+  }
+  return hash;
+}
+
+/*
+ * Encodes the resolved classes of a jar as a table of all the strings they
+ * refer to, followed by the classes, whose names, types and member
+ * signatures are indices into the table.
+ */
+std::string encode_classes(const std::vector<resolved_class>& classes) {
+  using namespace binary_serialization;
+  std::vector<const DexString*> strings;
+  std::unordered_map<const DexString*, uint32_t> string_ids;
+  std::ostringstream body;
+  auto write_string = [&](const DexString* str) {
+    auto [it, inserted] = string_ids.emplace(str, strings.size());
+    if (inserted) {
+      strings.push_back(str);
+    }
+    write<uint32_t>(body, it->second);
+  };
+  auto write_type = [&](const DexType* type) {
+    if (type == nullptr) {
+      write<uint32_t>(body, kNoString);
+    } else {
+      write_string(type->get_name());
+    }
+  };
+
+  write<uint32_t>(body, classes.size());
+  for (const auto& rc : classes) {
+    write<uint16_t>(body, rc.aflags);
+    write_type(rc.self);
+    write_type(rc.super);
+    write<uint32_t>(body, rc.interfaces.size());
+    for (const auto* intf : rc.interfaces) {
+      write_type(intf);
+    }
+    write<uint32_t>(body, rc.fields.size());
+    for (const auto& field : rc.fields) {
+      write<uint16_t>(body, field.aflags);
+      write_string(field.ref->get_name());
+      write_type(field.ref->get_type());
+    }
+    write<uint32_t>(body, rc.methods.size());
+    for (const auto& method : rc.methods) {
+      write<uint16_t>(body, method.aflags);
+      write_string(method.ref->get_name());
+      const auto* proto = method.ref->get_proto();
+      write_type(proto->get_rtype());
+      write<uint32_t>(body, proto->get_args()->size());
+      for (const auto* arg : *proto->get_args()) {
+        write_type(arg);
+      }
+    }
+  }
+
+  std::ostringstream os;
+  write<uint32_t>(os, strings.size());
+  for (const auto* str : strings) {
+    write<uint32_t>(os, str->size());
+    os.write(str->c_str(), str->size());
+  }
+  os << body.str();
+  return os.str();
+}
+
+// Reads from an encoding, and remembers whether it was too short.
+class encoded_reader {
+ public:
+  explicit encoded_reader(std::string_view data) : m_data(data) {}
+
+  template <typename T>
+  T read() {
+    T value{};
+    if (m_data.size() < sizeof(T)) {
+      m_ok = false;
+      return value;
+    }
+    memcpy(&value, m_data.data(), sizeof(T));
+    m_data.remove_prefix(sizeof(T));
+    return value;
+  }
+
+  std::string_view read_bytes(size_t size) {
+    if (m_data.size() < size) {
+      m_ok = false;
+      return {};
+    }
+    auto bytes = m_data.substr(0, size);
+    m_data.remove_prefix(size);
+    return bytes;
+  }
+
+  bool ok() const { return m_ok; }
+  void fail() { m_ok = false; }
+
+ private:
+  std::string_view m_data;
+  bool m_ok{true};
+};
+
+/*
+ * Resolves the classes of an encoding made by encode_classes. All strings are
+ * interned at once. Returns false if the encoding is corrupt.
+ */
+bool decode_classes(std::string_view data,
+                    std::vector<resolved_class>& classes) {
+  encoded_reader reader(data);
+  std::vector<std::string_view> views(reader.read<uint32_t>());
+  for (auto& view : views) {
+    view = reader.read_bytes(reader.read<uint32_t>());
+    if (!reader.ok()) {
+      return false;
+    }
+  }
+  auto strings = DexString::make_strings(views);
+  std::vector<DexType*> types(strings.size(), nullptr);
+  auto read_string = [&]() -> const DexString* {
+    auto id = reader.read<uint32_t>();
+    if (id >= strings.size()) {
+      reader.fail();
+      return nullptr;
+    }
+    return strings[id];
+  };
+  auto read_type = [&]() -> DexType* {
+    auto id = reader.read<uint32_t>();
+    if (id == kNoString) {
+      return nullptr;
+    }
+    if (id >= strings.size()) {
+      reader.fail();
+      return nullptr;
+    }
+    if (types[id] == nullptr) {
+      types[id] = DexType::make_type(strings[id]);
+    }
+    return types[id];
+  };
+
+  classes.resize(reader.read<uint32_t>());
+  for (auto& rc : classes) {
+    rc.aflags = reader.read<uint16_t>();
+    rc.self = read_type();
+    rc.super = read_type();
+    rc.interfaces.resize(reader.read<uint32_t>());
+    for (auto& intf : rc.interfaces) {
+      intf = read_type();
+    }
+    rc.fields.resize(reader.read<uint32_t>());
+    for (auto& field : rc.fields) {
+      field.aflags = reader.read<uint16_t>();
+      const auto* name = read_string();
+      auto* type = read_type();
+      if (!reader.ok() || rc.self == nullptr || type == nullptr) {
+        return false;
+      }
+      field.ref =
+          static_cast<DexField*>(DexField::make_field(rc.self, name, type));
+      field.attributes = nullptr;
+    }
+    rc.methods.resize(reader.read<uint32_t>());
+    for (auto& method : rc.methods) {
+      method.aflags = reader.read<uint16_t>();
+      const auto* name = read_string();
+      auto* rtype = read_type();
+      DexTypeList::ContainerType args(reader.read<uint32_t>());
+      for (auto& arg : args) {
+        arg = read_type();
+        if (!reader.ok()) {
+          return false;
+        }
+      }
+      if (!reader.ok() || rc.self == nullptr || rtype == nullptr ||
+          std::find(args.begin(), args.end(), nullptr) != args.end()) {
+        return false;
+      }
+      auto* proto = DexProto::make_proto(
+          rtype, DexTypeList::make_type_list(std::move(args)));
+      method.ref = static_cast<DexMethod*>(
+          DexMethod::make_method(rc.self, name, proto));
+      method.attributes = nullptr;
+    }
+    if (!reader.ok() || rc.self == nullptr ||
+        std::find(rc.interfaces.begin(), rc.interfaces.end(), nullptr) !=
+            rc.interfaces.end()) {
+      return false;
+    }
+    rc.ok = true;
+  }
+  return reader.ok();
+}
+
+} // namespace
+
+bool load_jar_file_cached(
+    const DexLocation* location,
+    analysis_cache::PersistentAnalysisCache& cache,
+    Scope* classes,
+    const jar_loader::duplicate_allowed_hook_t& is_allowed) {
+  boost::iostreams::mapped_file file;
+  try {
+    file.open(location->get_file_name().c_str(),
+              boost::iostreams::mapped_file::readonly);
+  } catch (const std::exception&) {
+    std::cerr << "error: cannot open jar file: " << location->get_file_name()
+              << "\n";
+    return false;
+  }
+  auto mapping = reinterpret_cast<const uint8_t*>(file.const_data());
+  auto& table = cache.get_table("library_classes", kLibraryClassesVersion);
+  auto key = hash_jar(mapping, file.size());
+
+  std::vector<resolved_class> resolved;
+  if (auto encoded = table.get(key)) {
+    init_basic_types();
+    if (decode_classes(*encoded, resolved)) {
+      TRACE(MAIN, 2, "Loaded %zu cached classes of %s", resolved.size(),
+            location->get_file_name().c_str());
+      for (const auto& rc : resolved) {
+        if (!define_class(rc, classes, /* attr_hook */ nullptr, is_allowed,
+                          location)) {
+          std::cerr << "error: cannot process jar: "
+                    << location->get_file_name() << "\n";
+          return false;
+        }
+      }
+      return true;
+    }
+    TRACE(MAIN, 1, "Ignoring corrupt cached classes of %s",
+          location->get_file_name().c_str());
+    resolved.clear();
+  }
+
+  std::vector<jar_entry> files;
+  if (!read_jar_entries(mapping, file.size(), files) ||
+      !process_jar_entries(location, files, mapping, file.size(), classes,
+                           /* attr_hook */ nullptr, is_allowed, &resolved)) {
+    std::cerr << "error: cannot process jar: " << location->get_file_name()
+              << "\n";
+    return false;
+  }
+  table.put(key, encode_classes(resolved));
+  return true;
+}
+
 // #define LOCAL_MAIN
 #ifdef LOCAL_MAIN
 int main(int argc, char* argv[]) {
@@ -12,6 +12,10 @@ class DexLocation;
 class DexField;
 class DexMethod;
 
+namespace analysis_cache {
+class PersistentAnalysisCache;
+} // namespace analysis_cache
+
 #include "boost/variant.hpp"
 
 #include "ConfigFiles.h"
@@ -46,6 +50,18 @@ bool load_jar_file(const DexLocation* location,
                    const jar_loader::duplicate_allowed_hook_t& is_allowed =
                        jar_loader::default_duplicate_allow_fn);
 
+/*
+ * Like load_jar_file, but without attribute hooks. The classes of the jar are
+ * recorded in the cache, keyed by the content of the jar, and loaded from
+ * there instead of parsing the jar again when it did not change.
+ */
+bool load_jar_file_cached(
+    const DexLocation* location,
+    analysis_cache::PersistentAnalysisCache& cache,
+    Scope* classes = nullptr,
+    const jar_loader::duplicate_allowed_hook_t& is_allowed =
+        jar_loader::default_duplicate_allow_fn);
+
 bool load_class_file(const std::string& filename, Scope* classes = nullptr);
 
 void init_basic_types();
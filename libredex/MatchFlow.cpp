@@ -20,6 +20,15 @@ result_t flow_t::find(cfg::ControlFlowGraph& cfg, location_t l) const {
 
 result_t flow_t::find(cfg::ControlFlowGraph& cfg,
                       std::initializer_list<location_t> ls) const {
+  return find(use_defs_t{cfg}, ls);
+}
+
+result_t flow_t::find(const use_defs_t& use_defs, location_t l) const {
+  return find(use_defs, {l});
+}
+
+result_t flow_t::find(const use_defs_t& use_defs,
+                      std::initializer_list<location_t> ls) const {
   std::unordered_set<detail::LocationIx> lixs(ls.size());
   for (auto l : ls) {
     always_assert(this == l.m_owner && "location_t from another flow_t");
@@ -27,14 +36,14 @@ result_t flow_t::find(cfg::ControlFlowGraph& cfg,
   }
 
   TRACE(MFLOW, 6, "find: Building Instruction Graph");
-  auto order = std::make_shared<detail::Order>();
-  auto dfg = detail::instruction_graph(cfg, m_constraints, lixs, order.get());
+  const auto& chains = *use_defs.m_chains;
+  auto dfg = detail::instruction_graph(chains, m_constraints, lixs);
 
   TRACE(MFLOW, 6, "find: Propagating Flow Constraints");
   dfg.propagate_flow_constraints(m_constraints);
 
   TRACE(MFLOW, 6, "find: Done.");
-  return result_t{dfg.locations(lixs), std::move(order)};
+  return result_t{dfg.locations(lixs), chains.order()};
 }
 
 result_t::insn_range result_t::matching(location_t l) const {
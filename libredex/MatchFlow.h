@@ -22,6 +22,7 @@ namespace mf {
 struct flag_t;
 struct location_t;
 struct result_t;
+struct use_defs_t;
 
 /**
  * Data Flow Matching
@@ -227,6 +228,27 @@ struct result_t;
  *     const   b 1
  *     add-int c a b
  */
+/**
+ * The data-flow facts of a control-flow graph that flow_t::find follows from
+ * the instructions matching its roots.  They do not depend on the constraints
+ * of a query, and computing them is the bulk of its cost, so clients issuing
+ * several queries against the same graph should compute them once, and pass
+ * them to each query, as long as the graph is not modified in between:
+ *
+ *   mf::use_defs_t ud(cfg);
+ *   auto res_f = f.find(ud, add);
+ *   auto res_g = g.find(ud, sub);
+ */
+struct use_defs_t {
+  explicit use_defs_t(const cfg::ControlFlowGraph& cfg)
+      : m_chains(std::make_shared<detail::UseDefChains>(cfg)) {}
+
+ private:
+  friend struct flow_t;
+
+  std::shared_ptr<const detail::UseDefChains> m_chains;
+};
+
 struct flow_t {
   /**
    * Add a new instruction constraint to this predicate.
@@ -239,14 +261,20 @@ struct flow_t {
 
   /**
    * Search for sub-trees originating from instructions matching the constraints
-   * at ls or l, in the given control-flow graph.  This operation requires that
-   * a unique exit block exists in `cfg`, and will calculate one (mutating the
-   * CFG) if it does not exist.
+   * at ls or l, in the given control-flow graph.
    */
   result_t find(cfg::ControlFlowGraph& cfg, location_t l) const;
   result_t find(cfg::ControlFlowGraph& cfg,
                 std::initializer_list<location_t> ls) const;
 
+  /**
+   * As above, reusing the use-def chains of a control-flow graph that has not
+   * changed since they were computed.
+   */
+  result_t find(const use_defs_t& use_defs, location_t l) const;
+  result_t find(const use_defs_t& use_defs,
+                std::initializer_list<location_t> ls) const;
+
  private:
   friend struct location_t;
 
@@ -13,8 +13,10 @@
 #include <boost/optional/optional.hpp>
 
 #include <sparta/MonotonicFixpointIterator.h>
+#include <sparta/PatriciaTreeMapAbstractPartition.h>
 #include <sparta/PatriciaTreeSetAbstractDomain.h>
 
+#include "BaseIRAnalyzer.h"
 #include "Show.h"
 #include "Trace.h"
 
@@ -68,6 +70,26 @@ struct SpartaDFG {
   static NodeId target(const Graph&, const EdgeId& e) { return e.to; }
 };
 
+// Types for ReachingDefsAnalysis' Abstract State.
+using RDDomain = sparta::PatriciaTreeSetAbstractDomain<IRInstruction*>;
+using RDPartition = sparta::PatriciaTreeMapAbstractPartition<reg_t, RDDomain>;
+
+/**
+ * The instructions whose result may be held by each register, including the
+ * pseudo RESULT_REGISTER.  Registers that no definition reaches are unbound.
+ */
+struct ReachingDefsAnalysis : public ir_analyzer::BaseIRAnalyzer<RDPartition> {
+  using Base = ir_analyzer::BaseIRAnalyzer<RDPartition>;
+  using Base::Base;
+
+  void analyze_instruction(const IRInstruction* insn,
+                           RDPartition* env) const override {
+    if (auto d = dest(insn)) {
+      env->set(*d, RDDomain(const_cast<IRInstruction*>(insn)));
+    }
+  }
+};
+
 // Types for InconsistentDFGNodesAnalysis' (IDN) Abstract State.
 using IDNDomain = sparta::PatriciaTreeSetAbstractDomain<IRInstruction*>;
 using IDNPartition =
@@ -188,81 +210,6 @@ const Constraint::Src& Constraint::src(src_index_t ix) const {
   }
 }
 
-void InstructionConstraintAnalysis::analyze_instruction(
-    IRInstruction* insn, ICAPartition* env) const {
-
-  // Curried lambda (o: Obligation) -> (dom: ICADomain) -> ICADomain returning
-  // a copy of dom with o added.
-  const auto add_obligation = [](Obligation o) {
-    return [o = std::move(o)](const ICADomain& dom) {
-      if (dom.is_bottom()) {
-        return ICADomain(o);
-      }
-
-      auto cpy = dom;
-      cpy.add(o);
-      return cpy;
-    };
-  };
-
-  // Propagate data-flow constraints if the instruction constraint at loc
-  // matches for the instruction being analyzed.
-  const auto propagate = [this, insn, env, add_obligation](LocationIx loc) {
-    const auto& constraint = m_constraints.at(loc);
-    if (!constraint.insn_matcher->matches(insn)) {
-      return;
-    }
-
-    for (size_t ix = 0; ix < insn->srcs_size(); ++ix) {
-      if (constraint.src(ix).loc == NO_LOC) {
-        continue;
-      }
-
-      reg_t src = insn->src(ix);
-      env->update(src, add_obligation(Obligation(loc, insn, ix)));
-    }
-  };
-
-  if (auto d = dest(insn)) {
-    // Instructions stomp their destination registers, so no other instruction
-    // can satisfy these obligations along this trace.
-    ICADomain obligations;
-    env->update(*d, [&obligations](const ICADomain& dom) {
-      obligations = dom;
-      return ICADomain::bottom();
-    });
-
-    always_assert(!obligations.is_top());
-    if (!obligations.is_bottom()) {
-      for (const Obligation& o : obligations.elements()) {
-        auto to_loc = std::get<0>(o);
-        auto to_src = std::get<2>(o);
-
-        const auto& from_src = m_constraints.at(to_loc).src(to_src);
-
-        if (opcode::is_a_move(insn->opcode())) {
-          if (from_src.alias == AliasFlag::alias) {
-            env->update(insn->src(0), add_obligation(o));
-            continue;
-          }
-        } else if (opcode::is_move_result_any(insn->opcode())) {
-          if (from_src.alias == AliasFlag::alias ||
-              from_src.alias == AliasFlag::result) {
-            env->update(RESULT_REGISTER, add_obligation(o));
-            continue;
-          }
-        }
-
-        propagate(from_src.loc);
-      }
-    }
-  }
-
-  for (auto root : m_roots) {
-    propagate(root);
-  }
-}
-
 DataFlowGraph::DataFlowGraph() {
   // Add the sentinel node, for pointing to entrypoints.
   add_node(NO_LOC, nullptr);
@@ -454,32 +401,107 @@ void DataFlowGraph::propagate_flow_constraints(
   }
 }
 
-DataFlowGraph instruction_graph(cfg::ControlFlowGraph& cfg,
-                                const std::vector<Constraint>& constraints,
-                                const std::unordered_set<LocationIx>& roots,
-                                Order* order) {
-  if (!cfg.exit_block()) {
-    // The instruction constraint analysis runs backwards and so requires a
-    // single exit block to start from.
-    cfg.calculate_exit_block();
+UseDefChains::UseDefChains(const cfg::ControlFlowGraph& cfg)
+    : m_order(std::make_shared<Order>()) {
+  ReachingDefsAnalysis analysis{cfg};
+  analysis.run({});
+
+  for (auto* block : cfg.blocks()) {
+    auto env = analysis.get_entry_state_at(block);
+    for (auto& mie : ir_list::InstructionIterable(block)) {
+      auto* insn = mie.insn;
+      auto& srcs = m_defs[insn];
+      const auto add_src = [&](reg_t reg) {
+        auto& src = srcs.emplace_back();
+        const auto& defs = env.get(reg);
+        if (!defs.is_bottom()) {
+          src.assign(defs.elements().begin(), defs.elements().end());
+        }
+      };
+
+      for (size_t ix = 0; ix < insn->srcs_size(); ++ix) {
+        add_src(insn->src(ix));
+      }
+      if (opcode::is_move_result_any(insn->opcode())) {
+        add_src(RESULT_REGISTER);
+      }
+      analysis.analyze_instruction(insn, &env);
+    }
+
+    for (auto it = block->rbegin(); it != block->rend(); ++it) {
+      if (it->type == MFLOW_OPCODE) {
+        m_order->emplace(it->insn, m_insns.size());
+        m_insns.push_back(it->insn);
+      }
+    }
   }
+}
 
-  InstructionConstraintAnalysis analysis{cfg, constraints, roots};
-  analysis.run({});
+const Source& UseDefChains::defs(const IRInstruction* insn,
+                                 src_index_t ix) const {
+  const auto& srcs = m_defs.at(insn);
+  always_assert(ix < srcs.size());
+  return srcs[ix];
+}
 
+std::vector<IRInstruction*> UseDefChains::sources(const IRInstruction* insn,
+                                                  src_index_t ix,
+                                                  AliasFlag alias) const {
+  const bool follow_moves = alias == AliasFlag::alias;
+  const bool follow_results =
+      alias == AliasFlag::alias || alias == AliasFlag::result;
+
+  std::vector<IRInstruction*> sources;
+  // Moves and move-results looked through, which may form cycles in loops.
+  std::unordered_set<const IRInstruction*> followed;
+  std::vector<std::pair<const IRInstruction*, src_index_t>> uses{{insn, ix}};
+  while (!uses.empty()) {
+    auto [use, use_ix] = uses.back();
+    uses.pop_back();
+    for (auto* def : defs(use, use_ix)) {
+      if (follow_moves && opcode::is_a_move(def->opcode())) {
+        if (followed.insert(def).second) {
+          uses.emplace_back(def, 0);
+        }
+      } else if (follow_results &&
+                 opcode::is_move_result_any(def->opcode())) {
+        if (followed.insert(def).second) {
+          uses.emplace_back(def, def->srcs_size());
+        }
+      } else {
+        sources.push_back(def);
+      }
+    }
+  }
+
+  const auto& order = *m_order;
+  std::sort(sources.begin(), sources.end(), [&order](auto* a, auto* b) {
+    return order.at(a) < order.at(b);
+  });
+  sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+  return sources;
+}
+
+DataFlowGraph instruction_graph(const UseDefChains& chains,
+                                const std::vector<Constraint>& constraints,
+                                const std::unordered_set<LocationIx>& roots) {
   DataFlowGraph graph;
 
+  // Nodes whose operands still need to be followed.
+  std::vector<DataFlowGraph::Node> frontier;
+
   // Check whether (loc, insn) should be in the graph, and adds it if necessary.
-  // Returns a boolean indicating whether the node was added or not.
+  // Returns a boolean indicating whether the node is in the graph or not.
   const auto test_node = [&](LocationIx loc, IRInstruction* insn) {
-    if (loc == NO_LOC) {
-      return false;
+    if (graph.has_node(loc, insn)) {
+      return true;
     }
 
     auto& constraint = constraints.at(loc);
     if (constraint.insn_matcher->matches(insn)) {
       TRACE(MFLOW, 6, "instruction_graph: L%zu matching %s", loc, SHOW(insn));
       graph.add_node(loc, insn);
+      frontier.emplace_back(loc, insn);
       return true;
     } else {
       TRACE(MFLOW, 8, "instruction_graph: L%zu failing  %s", loc, SHOW(insn));
@@ -487,65 +509,30 @@ DataFlowGraph instruction_graph(cfg::ControlFlowGraph& cfg,
     }
   };
 
-  // Check whether `insn` could serve as the operand implied by the obligation:
-  //   o = (to_loc, to_insn, to_src)
-  // and add the appropriate edge to the graph if so.
-  const auto test_edge = [&](Obligation o, IRInstruction* insn) {
-    auto to_loc = std::get<0>(o);
-    auto to_insn = std::get<1>(o);
-    auto to_src = std::get<2>(o);
-
-    auto& from_src = constraints.at(to_loc).src(to_src);
-
-    if (opcode::is_a_move(insn->opcode())) {
-      if (from_src.alias == AliasFlag::alias) {
-        return;
-      }
-    }
-
-    if (opcode::is_move_result_any(insn->opcode())) {
-      if (from_src.alias == AliasFlag::alias ||
-          from_src.alias == AliasFlag::result) {
-        return;
-      }
-    }
-
-    if (test_node(from_src.loc, insn)) {
-      graph.add_edge(from_src.loc, insn, to_src, to_loc, to_insn);
-    } else {
-      graph.mark_inconsistent(to_loc, to_insn, to_src);
+  for (auto* insn : chains.instructions()) {
+    for (auto root : roots) {
+      test_node(root, insn);
     }
-  };
+  }
 
-  for (auto* block : cfg.blocks()) {
-    // The obligations at the *end* of the block.
-    auto env = analysis.get_entry_state_at(block);
+  while (!frontier.empty()) {
+    auto [to_loc, to_insn] = frontier.back();
+    frontier.pop_back();
 
-    for (auto it = block->rbegin(); it != block->rend(); ++it) {
-      if (it->type != MFLOW_OPCODE) {
+    auto& constraint = constraints.at(to_loc);
+    for (src_index_t to_src = 0; to_src < to_insn->srcs_size(); ++to_src) {
+      auto& from_src = constraint.src(to_src);
+      if (from_src.loc == NO_LOC) {
         continue;
       }
 
-      auto* insn = it->insn;
-      for (auto root : roots) {
-        test_node(root, insn);
-      }
-
-      if (auto d = dest(insn)) {
-        const ICADomain& obligations = env.get(*d);
-        always_assert(!obligations.is_top());
-
-        if (!obligations.is_bottom()) {
-          for (const Obligation& o : obligations.elements()) {
-            test_edge(o, insn);
-          }
+      for (auto* insn : chains.sources(to_insn, to_src, from_src.alias)) {
+        if (test_node(from_src.loc, insn)) {
+          graph.add_edge(from_src.loc, insn, to_src, to_loc, to_insn);
+        } else {
+          graph.mark_inconsistent(to_loc, to_insn, to_src);
         }
       }
-
-      if (order) {
-        order->emplace(insn, order->size());
-      }
-      analysis.analyze_instruction(insn, &env);
     }
   }
 
@@ -553,5 +540,16 @@ DataFlowGraph instruction_graph(cfg::ControlFlowGraph& cfg,
   return graph;
 }
 
+DataFlowGraph instruction_graph(const cfg::ControlFlowGraph& cfg,
+                                const std::vector<Constraint>& constraints,
+                                const std::unordered_set<LocationIx>& roots,
+                                Order* order) {
+  UseDefChains chains{cfg};
+  if (order) {
+    *order = *chains.order();
+  }
+  return instruction_graph(chains, constraints, roots);
+}
+
 } // namespace detail
 } // namespace mf
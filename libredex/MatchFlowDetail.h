@@ -16,10 +16,7 @@
 #include <unordered_set>
 #include <vector>
 
-#include <sparta/HashedSetAbstractDomain.h>
-#include <sparta/PatriciaTreeMapAbstractPartition.h>
-
-#include "BaseIRAnalyzer.h"
+#include "ControlFlow.h"
 #include "IRInstruction.h"
 #include "Match.h"
 
@@ -144,33 +141,6 @@ struct Constraint {
   std::map<src_index_t, Src> m_src_ranges;
 };
 
-// Types for InstructionConstraintAnalysis' (ICA) Abstract State.
-using Obligation = std::tuple<LocationIx, IRInstruction*, src_index_t>;
-using ICADomain =
-    sparta::HashedSetAbstractDomain<Obligation, boost::hash<Obligation>>;
-using ICAPartition = sparta::PatriciaTreeMapAbstractPartition<reg_t, ICADomain>;
-
-/**
- * Tracks constraints imposed on instructions based on where their results flow
- * into.
- */
-struct InstructionConstraintAnalysis
-    : public ir_analyzer::BaseBackwardsIRAnalyzer<ICAPartition> {
-  using Base = ir_analyzer::BaseBackwardsIRAnalyzer<ICAPartition>;
-
-  InstructionConstraintAnalysis(const cfg::ControlFlowGraph& cfg,
-                                const std::vector<Constraint>& constraints,
-                                const std::unordered_set<LocationIx>& roots)
-      : Base(cfg), m_constraints(constraints), m_roots(roots) {}
-
-  void analyze_instruction(IRInstruction* insn,
-                           ICAPartition* env) const override;
-
- private:
-  const std::vector<Constraint>& m_constraints;
-  const std::unordered_set<LocationIx>& m_roots;
-};
-
 /**
  * Locations represents the following nested mapping:
  *
@@ -336,20 +306,62 @@ struct DataFlowGraph {
   std::unordered_map<Node, Adjacencies, boost::hash<Node>> m_adjacencies;
 };
 
+/**
+ * The definitions reaching each operand of each instruction of a CFG.  Unlike
+ * the data-flow graph, they do not depend on any constraint, so they are
+ * computed once per CFG, and queries only follow them from the instructions
+ * matching their roots.
+ *
+ * An instruction with a move-result defines the pseudo RESULT_REGISTER, which
+ * its move-result reads as an extra operand, at index srcs_size().
+ */
+struct UseDefChains {
+  explicit UseDefChains(const cfg::ControlFlowGraph& cfg);
+
+  /**
+   * All the instructions of the CFG, in the order in which queries visit
+   * them: blocks in order, and the instructions of each block backwards.
+   */
+  const std::vector<IRInstruction*>& instructions() const { return m_insns; }
+
+  /** The position of every instruction in instructions(). */
+  const std::shared_ptr<Order>& order() const { return m_order; }
+
+  /**
+   * The instructions that could supply the ix-th operand of insn, looking
+   * through moves and move-results as requested by `alias`, in the order of
+   * instructions().
+   */
+  std::vector<IRInstruction*> sources(const IRInstruction* insn,
+                                      src_index_t ix,
+                                      AliasFlag alias) const;
+
+ private:
+  const Source& defs(const IRInstruction* insn, src_index_t ix) const;
+
+  std::vector<IRInstruction*> m_insns;
+  std::shared_ptr<Order> m_order;
+  std::unordered_map<const IRInstruction*, Sources> m_defs;
+};
+
 /**
  * Calculate the use-def graph modulo instruction constraints in `constraints`,
  * transitively reachable from instructions matching the constraint in `roots`
- * in `cfg`.
+ * in the CFG of `chains`.
  *
  * - Nodes in the graph are (loc, insn) pairs -- an instruction and the location
  *   referring to an instruction constraint it matches.
  * - Edges (l, i) -[src]-> (k, j) indicate that the destination of instruction i
  *   flows into the src-th operand of instruction j.
- *
- * This function relies on a backward analysis, and so will calculate an exit
- * block for the supplied `cfg` if one does not already exist.
  */
-DataFlowGraph instruction_graph(cfg::ControlFlowGraph& cfg,
+DataFlowGraph instruction_graph(const UseDefChains& chains,
+                                const std::vector<Constraint>& constraints,
+                                const std::unordered_set<LocationIx>& roots);
+
+/**
+ * As above, computing the use-def chains of `cfg` for this query only.
+ */
+DataFlowGraph instruction_graph(const cfg::ControlFlowGraph& cfg,
                                 const std::vector<Constraint>& constraints,
                                 const std::unordered_set<LocationIx>& roots,
                                 Order* order = nullptr);
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MemberColumns.h"
+
+#include <algorithm>
+#include <type_traits>
+
+#include "IRCode.h"
+#include "ReachableClasses.h"
+#include "RedexContext.h"
+#include "Show.h"
+#include "WorkQueue.h"
+
+namespace {
+
+void gather_members(const DexClass* cls, std::vector<DexMethod*>& methods) {
+  const auto& dmethods = cls->get_dmethods();
+  const auto& vmethods = cls->get_vmethods();
+  methods.insert(methods.end(), dmethods.begin(), dmethods.end());
+  methods.insert(methods.end(), vmethods.begin(), vmethods.end());
+}
+
+void gather_members(const DexClass* cls, std::vector<DexField*>& fields) {
+  const auto& sfields = cls->get_sfields();
+  const auto& ifields = cls->get_ifields();
+  fields.insert(fields.end(), sfields.begin(), sfields.end());
+  fields.insert(fields.end(), ifields.begin(), ifields.end());
+}
+
+} // namespace
+
+template <typename DexMember>
+MemberColumns<DexMember>::MemberColumns(const Scope& scope) {
+  for (const auto* cls : scope) {
+    gather_members(cls, m_members);
+  }
+  auto n = m_members.size();
+  m_access.resize(n);
+  m_flags.resize(n);
+  if constexpr (std::is_same_v<DexMember, DexMethod>) {
+    m_code_sizes.resize(n);
+  }
+  std::vector<uint32_t> ids(n);
+  workqueue_run_for<uint32_t>(0, n, [&](uint32_t r) {
+    fill(r);
+    ids[r] = g_redex->get_dense_id(m_members[r]);
+  });
+  auto max_id = ids.empty() ? 0 : *std::max_element(ids.begin(), ids.end());
+  m_rows_by_id.resize(max_id + 1, NONE);
+  for (uint32_t r = 0; r < n; ++r) {
+    m_rows_by_id[ids[r]] = r;
+  }
+}
+
+template <typename DexMember>
+void MemberColumns<DexMember>::fill(uint32_t row) {
+  auto* member = m_members[row];
+  m_access[row] = member->get_access();
+  uint8_t flags = 0;
+  if (member->is_external()) {
+    flags |= IS_EXTERNAL;
+  }
+  if (::can_delete(member)) {
+    flags |= CAN_DELETE;
+  }
+  if (::can_rename(member)) {
+    flags |= CAN_RENAME;
+  }
+  m_flags[row] = flags;
+  if constexpr (std::is_same_v<DexMember, DexMethod>) {
+    const auto* code = member->get_code();
+    m_code_sizes[row] = code == nullptr ? 0 : code->sum_opcode_sizes();
+  }
+}
+
+template <typename DexMember>
+uint32_t MemberColumns<DexMember>::row(const DexMember* member) const {
+  auto id = g_redex->get_dense_id(member);
+  if (id >= m_rows_by_id.size()) {
+    return NONE;
+  }
+  return m_rows_by_id[id];
+}
+
+template <typename DexMember>
+void MemberColumns<DexMember>::update(const DexMember* member) {
+  auto r = row(member);
+  always_assert_log(r != NONE, "%s has no row", SHOW(member));
+  fill(r);
+}
+
+template class MemberColumns<DexMethod>;
+template class MemberColumns<DexField>;
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "DexAccess.h"
+#include "DexClass.h"
+
+/*
+ * Columnar snapshots of the member attributes that whole-scope filters read
+ * most: access flags, whether a member is external, can be deleted or can be
+ * renamed (as defined in ReachableClasses.h), and for methods the code size.
+ *
+ * Every attribute lives in its own dense vector, so that a filter over all
+ * members of a scope is a linear scan over a few bytes per member, instead of
+ * touching a heap-allocated DexMethod or DexField each. Rows are in scope
+ * order, and can also be looked up by the dense id of a member (see DexIds.h).
+ *
+ * The columns are a snapshot: code that changes the access flags, reference
+ * state or code of a member afterwards has to `update` its row, or build new
+ * columns.
+ */
+template <typename DexMember>
+class MemberColumns {
+ public:
+  static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+  explicit MemberColumns(const Scope& scope);
+
+  size_t size() const { return m_members.size(); }
+
+  DexMember* member(uint32_t row) const { return m_members[row]; }
+  DexAccessFlags access(uint32_t row) const { return m_access[row]; }
+  bool is_external(uint32_t row) const { return m_flags[row] & IS_EXTERNAL; }
+  bool can_delete(uint32_t row) const { return m_flags[row] & CAN_DELETE; }
+  bool can_rename(uint32_t row) const { return m_flags[row] & CAN_RENAME; }
+
+  // Always 0 for fields, and for methods without code.
+  uint32_t code_size(uint32_t row) const {
+    return m_code_sizes.empty() ? 0 : m_code_sizes[row];
+  }
+
+  // Returns the row of the given member, or NONE if it is not in the scope the
+  // columns were built from.
+  uint32_t row(const DexMember* member) const;
+
+  // Re-reads all attributes of the given member, which must have a row.
+  void update(const DexMember* member);
+
+  // Returns the members of all rows for which the predicate holds, in row
+  // order. The predicate gets the row.
+  template <typename Predicate>
+  std::vector<DexMember*> filter(const Predicate& pred) const {
+    std::vector<DexMember*> res;
+    for (uint32_t r = 0; r < m_members.size(); ++r) {
+      if (pred(r)) {
+        res.push_back(m_members[r]);
+      }
+    }
+    return res;
+  }
+
+ private:
+  enum : uint8_t {
+    IS_EXTERNAL = 1 << 0,
+    CAN_DELETE = 1 << 1,
+    CAN_RENAME = 1 << 2,
+  };
+
+  void fill(uint32_t row);
+
+  std::vector<DexMember*> m_members;
+  std::vector<DexAccessFlags> m_access;
+  std::vector<uint8_t> m_flags;
+  std::vector<uint32_t> m_code_sizes;
+  std::vector<uint32_t> m_rows_by_id;
+};
+
+using MethodColumns = MemberColumns<DexMethod>;
+using FieldColumns = MemberColumns<DexField>;
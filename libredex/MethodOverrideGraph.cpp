@@ -7,6 +7,7 @@
 
 #include "MethodOverrideGraph.h"
 
+#include <algorithm>
 #include <boost/range/adaptor/map.hpp>
 
 #include <iterator>
@@ -16,6 +17,7 @@
 #include "BinarySerialization.h"
 #include "CppUtil.h"
 #include "Show.h"
+#include "StlUtil.h"
 #include "Timer.h"
 #include "Walkers.h"
 
@@ -476,6 +478,37 @@ bool Graph::add_other_implementation_class(const DexMethod* overridden,
   return parent_inserted;
 }
 
+void Graph::remove_method(const DexMethod* method) {
+  auto* node = m_nodes.get_unsafe(method);
+  if (node == nullptr) {
+    return;
+  }
+  auto add_unique = [](std::vector<Node*>& nodes, Node* n) {
+    if (std::find(nodes.begin(), nodes.end(), n) == nodes.end()) {
+      nodes.push_back(n);
+    }
+  };
+  for (auto* parent : node->parents) {
+    std20::erase_if(parent->children, [&](auto* n) { return n == node; });
+    for (auto* child : node->children) {
+      add_unique(parent->children, child);
+    }
+  }
+  for (auto* child : node->children) {
+    std20::erase_if(child->parents, [&](auto* n) { return n == node; });
+    for (auto* parent : node->parents) {
+      add_unique(child->parents, parent);
+    }
+    auto& oii = child->other_interface_implementations;
+    if (oii && oii->parents.erase(method)) {
+      for (auto* parent : node->parents) {
+        oii->parents.insert(parent->method);
+      }
+    }
+  }
+  m_nodes.erase(method);
+}
+
 void Graph::dump(std::ostream& os) const {
   namespace bs = binary_serialization;
   bs::write_header(os, /* version */ 1);
@@ -497,7 +530,91 @@ void Graph::dump(std::ostream& os) const {
   gw.write(os, boost::adaptors::keys(m_nodes));
 }
 
-std::unique_ptr<const Graph> build_graph(const Scope& scope) {
+void Graph::save(std::ostream& os) const {
+  namespace bs = binary_serialization;
+  auto write_ptr = [&](const void* ptr) {
+    bs::write<uintptr_t>(os, reinterpret_cast<uintptr_t>(ptr));
+  };
+  auto write_nodes = [&](const std::vector<Node*>& nodes) {
+    bs::write<uint32_t>(os, nodes.size());
+    for (auto* node : nodes) {
+      write_ptr(node->method);
+    }
+  };
+  bs::write_header(os, /* version */ 1);
+  bs::write<uint64_t>(os, m_nodes.size());
+  for (const auto& [method, node] : m_nodes) {
+    write_ptr(method);
+    bs::write<uint8_t>(os, node.is_interface);
+    write_nodes(node.parents);
+    write_nodes(node.children);
+    const auto& oii = node.other_interface_implementations;
+    bs::write<uint8_t>(os, oii != nullptr);
+    if (oii != nullptr) {
+      bs::write<uint32_t>(os, oii->parents.size());
+      for (const auto* parent : oii->parents) {
+        write_ptr(parent);
+      }
+      bs::write<uint32_t>(os, oii->classes.size());
+      for (const auto* cls : oii->classes) {
+        write_ptr(cls);
+      }
+    }
+  }
+}
+
+std::unique_ptr<Graph> Graph::load(std::istream& is) {
+  namespace bs = binary_serialization;
+  always_assert_log(bs::read<uint32_t>(is) == 0xfaceb000 &&
+                        bs::read<uint32_t>(is) == 1,
+                    "Unexpected method override graph header");
+  auto read_ptr = [&](auto* ptr) {
+    return reinterpret_cast<decltype(ptr)>(bs::read<uintptr_t>(is));
+  };
+  auto graph = std::make_unique<Graph>();
+  // Edges can only be linked once all nodes exist.
+  std::vector<std::pair<Node*, std::vector<const DexMethod*>>> parents;
+  std::vector<std::pair<Node*, std::vector<const DexMethod*>>> children;
+  auto read_methods = [&]() {
+    std::vector<const DexMethod*> methods(bs::read<uint32_t>(is));
+    for (auto& method : methods) {
+      method = read_ptr((const DexMethod*)nullptr);
+    }
+    return methods;
+  };
+  auto num_nodes = bs::read<uint64_t>(is);
+  for (uint64_t i = 0; i < num_nodes; ++i) {
+    const auto* method = read_ptr((const DexMethod*)nullptr);
+    auto* node = graph->m_nodes.emplace_unsafe(method).first;
+    node->method = method;
+    node->is_interface = bs::read<uint8_t>(is) != 0;
+    parents.emplace_back(node, read_methods());
+    children.emplace_back(node, read_methods());
+    if (bs::read<uint8_t>(is) != 0) {
+      auto& oii = node->other_interface_implementations;
+      oii = std::make_unique<OtherInterfaceImplementations>();
+      for (auto* parent : read_methods()) {
+        oii->parents.insert(parent);
+      }
+      oii->classes.resize(bs::read<uint32_t>(is));
+      for (auto& cls : oii->classes) {
+        cls = read_ptr((const DexClass*)nullptr);
+      }
+    }
+  }
+  auto link = [&](auto& edges, auto member) {
+    for (auto& [node, methods] : edges) {
+      for (const auto* method : methods) {
+        (node->*member).push_back(graph->m_nodes.get_unsafe(method));
+      }
+    }
+  };
+  link(parents, &Node::parents);
+  link(children, &Node::children);
+  return graph;
+}
+
+std::unique_ptr<Graph> build_graph(const Scope& scope) {
   Timer t("Building method override graph");
   return GraphBuilder(scope).run();
 }
@@ -27,9 +27,10 @@ namespace method_override_graph {
 class Graph;
 
 /*
- * Slow-ish; users should build the graph once and cache it somewhere.
+ * Slow-ish; users should build the graph once and cache it somewhere. Passes
+ * can get a preserved instance via MethodOverrideGraphAnalysisPass.
  */
-std::unique_ptr<const Graph> build_graph(const Scope&);
+std::unique_ptr<Graph> build_graph(const Scope&);
 
 /*
  * Returns all the methods that override :method. The set does *not* include
@@ -120,8 +121,30 @@ class Graph {
                                       const DexMethod* overriding,
                                       const DexClass* cls);
 
+  /*
+   * Incremental fix-up for when a method stops participating in overriding,
+   * because it was deleted, made static / non-virtual, or renamed to a fresh
+   * name. The method's overriders are linked directly to the methods it
+   * overrode, so that overriding relationships that went through it are kept.
+   * This is at worst conservative: a rebuild may find fewer edges, never more.
+   *
+   * Methods that aren't true virtuals have no node, and removing them is a
+   * no-op. Not thread-safe.
+   */
+  void remove_method(const DexMethod* method);
+
   void dump(std::ostream&) const;
 
+  /*
+   * Writes the graph to a stream, to be read back by `load` in the same
+   * process. Methods and classes are identified by their addresses, so that
+   * nothing needs to be resolved on the way back, and so the methods and
+   * classes of the graph must not be deleted in between.
+   */
+  void save(std::ostream&) const;
+
+  static std::unique_ptr<Graph> load(std::istream&);
+
  private:
   static Node empty_node;
   ConcurrentMap<const DexMethod*, Node> m_nodes;
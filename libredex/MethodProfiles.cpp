@@ -8,13 +8,15 @@
 #include "MethodProfiles.h"
 
 #include <boost/algorithm/string.hpp>
-#include <fstream>
+#include <boost/filesystem.hpp>
 #include <iostream>
+#include <optional>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include "CppUtil.h"
 #include "GlobalConfig.h"
+#include "RedexMappedFile.h"
 #include "Show.h"
 #include "StlUtil.h"
 #include "WorkQueue.h"
@@ -44,6 +46,9 @@ bool parse_cells(std::string_view line, const Func& parse_cell) {
 
 bool empty_column(std::string_view sv) { return sv.empty() || sv == "\n"; }
 
+// Number of rows parsed by one task.
+constexpr size_t ROWS_PER_CHUNK = 16384;
+
 } // namespace
 
 AccumulatingTimer MethodProfiles::s_process_unresolved_lines_timer(
@@ -76,38 +81,86 @@ bool MethodProfiles::parse_stats_file(const std::string& csv_filename) {
     return false;
   }
 
-  // Using C-style file reading and parsing because it's faster than the
-  // iostreams equivalent and we expect to read very large csv files.
-  std::ifstream ifs(csv_filename);
-  if (!ifs.good()) {
+  // We expect to read very large csv files, so the file is mapped, and the
+  // rows are parsed and their methods resolved in parallel.
+  boost::system::error_code ec;
+  auto file_size = boost::filesystem::file_size(csv_filename, ec);
+  if (ec) {
     std::cerr << "FAILED to open " << csv_filename << std::endl;
     return false;
   }
+  std::optional<RedexMappedFile> file;
+  std::string_view contents;
+  if (file_size > 0) {
+    file = RedexMappedFile::open(csv_filename);
+    contents = std::string_view(file->const_data(), file->size());
+  }
 
-  // getline will allocate a buffer and put a pointer to it here
-  std::string line;
-  while (std::getline(ifs, line)) {
-    bool success = false;
-    if (line.back() == '\n') {
-      line.pop_back();
+  std::vector<std::string_view> lines;
+  size_t start = 0;
+  while (start < contents.size()) {
+    auto end = contents.find('\n', start);
+    if (end == std::string_view::npos) {
+      end = contents.size();
     }
+    auto line = contents.substr(start, end - start);
     // Just in case the files were generated on a Windows OS
     // or with Windows line ending.
-    if (line.back() == '\r') {
-      line.pop_back();
-    }
-    if (m_mode == NONE) {
-      success = parse_header(line);
-    } else {
-      success = parse_line(line);
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
     }
+    lines.push_back(line);
+    start = end + 1;
+  }
+  // The numbers are parsed with strtol and strtod, which stop at the
+  // separator that follows them. Only the last line may have none within the
+  // mapping, so that one is copied.
+  std::string last_line;
+  if (!contents.empty() && contents.back() != '\n') {
+    last_line = std::string(lines.back());
+    lines.back() = last_line;
+  }
+
+  // The header, and the optional metadata before it, determine how the rows
+  // are parsed.
+  size_t first_row = 0;
+  for (; first_row < lines.size() && m_mode != MAIN; ++first_row) {
+    bool success = m_mode == NONE ? parse_header(lines[first_row])
+                                  : parse_metadata(lines[first_row]);
     if (!success) {
       return false;
     }
   }
-  if (ifs.bad()) {
-    std::cerr << "FAILED to read a line!" << std::endl;
-    return false;
+
+  struct Chunk {
+    std::vector<ParsedMain> rows;
+    bool success{true};
+  };
+  size_t num_rows = lines.size() - first_row;
+  std::vector<Chunk> chunks((num_rows + ROWS_PER_CHUNK - 1) / ROWS_PER_CHUNK);
+  workqueue_run_for<size_t>(0, chunks.size(), [&](size_t c) {
+    auto begin = first_row + c * ROWS_PER_CHUNK;
+    auto end = std::min(begin + ROWS_PER_CHUNK, lines.size());
+    auto& chunk = chunks[c];
+    chunk.rows.reserve(end - begin);
+    for (auto i = begin; i < end; ++i) {
+      auto result = parse_main_internal(lines[i]);
+      if (!result) {
+        chunk.success = false;
+        return;
+      }
+      chunk.rows.push_back(std::move(*result));
+    }
+  });
+  // The rows are applied in file order, so that the first row for a method
+  // wins as before.
+  for (auto& chunk : chunks) {
+    for (auto& row : chunk.rows) {
+      (void)apply_main_internal_result(std::move(row), &m_interaction_id);
+    }
+    if (!chunk.success) {
+      return false;
+    }
   }
 
   TRACE(METH_PROF, 1,
@@ -118,7 +171,7 @@ bool MethodProfiles::parse_stats_file(const std::string& csv_filename) {
 
 // `strtol` and `strtod` requires c string to be null terminated,
 // std::string_view::data() doesn't have this guarantee. Our `string_view`s are
-// taken from `std::string`s. This should be safe.
+// followed by a separator, or taken from `std::string`s. This should be safe.
 template <typename IntType>
 IntType parse_int(std::string_view tok) {
   char* ptr = nullptr;
@@ -281,6 +334,20 @@ void MethodProfiles::set_method_stats(const std::string& interaction_id,
   m_method_stats.at(interaction_id)[m] = stats;
 }
 
+void MethodProfiles::gather_methods(
+    std::vector<const DexMethodRef*>& lmethod) const {
+  for (auto& [_, method_stats] : m_method_stats) {
+    for (auto& [method, _] : method_stats) {
+      lmethod.push_back(method);
+    }
+  }
+  for (auto& line : m_unresolved_lines) {
+    if (line.ref != nullptr) {
+      lmethod.push_back(line.ref);
+    }
+  }
+}
+
 size_t MethodProfiles::derive_stats(DexMethod* target,
                                     const std::vector<DexMethod*>& sources) {
   size_t res = 0;
@@ -136,6 +136,10 @@ class MethodProfiles {
   // Try to resolve previously unresolved lines
   void process_unresolved_lines();
 
+  // Appends all method references held by the profiles, including those of
+  // unresolved lines.
+  void gather_methods(std::vector<const DexMethodRef*>& lmethod) const;
+
   std::unordered_set<dex_member_refs::MethodDescriptorTokens>
   get_unresolved_method_descriptor_tokens() const;
 
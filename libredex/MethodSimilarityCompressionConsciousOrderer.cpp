@@ -133,7 +133,8 @@ void init_bipartite_graph(std::vector<BinaryFunction>& functions,
 
 /// Apply compression-conscious reordering function reordering using
 /// Balanced Graph Partitioning for a given set of functions.
-void apply_bpc(std::vector<BinaryFunction>& functions) {
+void apply_bpc(std::vector<BinaryFunction>& functions,
+               uint32_t iterations_per_split) {
   // Creating and initializing a bipartite graph in which one part is a given
   // set of documents (functions) and another part is the corresponding k-mers
   std::vector<Document> documents;
@@ -147,7 +148,7 @@ void apply_bpc(std::vector<BinaryFunction>& functions) {
   }
 
   // Run the reordering algorithm
-  BalancedPartitioning alg(documents_ptr);
+  BalancedPartitioning alg(documents_ptr, iterations_per_split);
   alg.run();
 
   // Verify that every document gets a correct bucket
@@ -254,7 +255,7 @@ void MethodSimilarityCompressionConsciousOrderer::order(
 
   // Apply the reordering
   if (!functions.empty()) {
-    apply_bpc(functions);
+    apply_bpc(functions, m_iterations_per_split);
   }
   methods.clear();
 
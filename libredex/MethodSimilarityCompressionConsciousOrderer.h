@@ -38,6 +38,13 @@ class MethodSimilarityCompressionConsciousOrderer {
   std::vector<uint8_t> get_encoded_method_content(
       DexMethod* meth, DexOutputIdx& dodx, std::unique_ptr<uint8_t[]>& output);
 
+  // The maximum number of balanced partitioning iterations per split.
+  uint32_t m_iterations_per_split;
+
  public:
+  explicit MethodSimilarityCompressionConsciousOrderer(
+      uint32_t iterations_per_split = 40)
+      : m_iterations_per_split(iterations_per_split) {}
+
   void order(std::vector<DexMethod*>& methods, GatheredTypes* m_gtypes);
 };
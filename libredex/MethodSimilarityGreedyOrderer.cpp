@@ -8,6 +8,7 @@
 #include "MethodSimilarityGreedyOrderer.h"
 
 #include "DexInstruction.h"
+#include "MinHashLsh.h"
 #include "Show.h"
 #include "Timer.h"
 #include "Trace.h"
@@ -111,20 +112,26 @@ void MethodSimilarityGreedyOrderer::compute_score() {
   // Maximum number of code items can be 65536.
   redex_assert(m_id_to_method.size() <= (1 << 16));
 
+  // With LSH, only the candidate neighbors of each method get scored, which
+  // is near-linear in the number of methods instead of quadratic.
+  std::vector<std::vector<uint32_t>> candidates;
+  if (m_use_lsh_candidates) {
+    std::vector<std::vector<uint32_t>> features(m_id_to_method.size());
+    for (size_t id = 0; id < features.size(); id++) {
+      features[id] = m_method_id_to_code_hash_ids[id];
+    }
+    candidates = min_hash::candidate_neighbors(features);
+  }
+
   std::vector<MethodId> indices(m_id_to_method.size());
   std::iota(indices.begin(), indices.end(), 0);
   workqueue_run<MethodId>(
       [&](MethodId i_id) {
-        const auto& code_hash_ids_i = m_method_id_to_code_hash_ids[i_id];
+        const auto& code_hash_ids_i = m_method_id_to_code_hash_ids.at(i_id);
         std::unordered_map<ScoreValue, boost::dynamic_bitset<>> score_map;
 
-        for (uint32_t j_id = 0; j_id < (uint32_t)m_id_to_method.size();
-             j_id++) {
-          if (i_id == j_id) {
-            continue;
-          }
-
-          const auto& code_hash_ids_j = m_method_id_to_code_hash_ids[j_id];
+        auto score_against = [&](uint32_t j_id) {
+          const auto& code_hash_ids_j = m_method_id_to_code_hash_ids.at(j_id);
           auto score = get_score(code_hash_ids_i, code_hash_ids_j);
           if (score.value() >= 0) {
             auto& method_id_bitset = score_map[score.value()];
@@ -133,6 +140,18 @@ void MethodSimilarityGreedyOrderer::compute_score() {
             }
             method_id_bitset.set(static_cast<size_t>(j_id));
           }
+        };
+        if (m_use_lsh_candidates) {
+          for (auto j_id : candidates[i_id]) {
+            score_against(j_id);
+          }
+        } else {
+          for (uint32_t j_id = 0; j_id < (uint32_t)m_id_to_method.size();
+               j_id++) {
+            if (i_id != j_id) {
+              score_against(j_id);
+            }
+          }
         }
 
         if (!score_map.empty()) {
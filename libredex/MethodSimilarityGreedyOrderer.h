@@ -62,6 +62,10 @@ class MethodSimilarityGreedyOrderer {
       std::map<ScoreValue, boost::dynamic_bitset<>, std::greater<ScoreValue>>>
       m_score_map;
 
+  // Whether to only score the candidate neighbors found by MinHash LSH (see
+  // MinHashLsh.h), instead of all pairs of methods.
+  bool m_use_lsh_candidates;
+
   // Last Method Id that is ordered.
   boost::optional<MethodId> m_last_method_id;
 
@@ -83,5 +87,8 @@ class MethodSimilarityGreedyOrderer {
   void compute_score();
 
  public:
+  explicit MethodSimilarityGreedyOrderer(bool use_lsh_candidates = false)
+      : m_use_lsh_candidates(use_lsh_candidates) {}
+
   void order(std::vector<DexMethod*>& methods);
 };
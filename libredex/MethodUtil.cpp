@@ -20,6 +20,7 @@ class ClInitSideEffectsAnalysis {
   bool m_allow_benign_method_invocations;
   const method::ClInitHasNoSideEffectsPredicate* m_clinit_has_no_side_effects;
   const InsertOnlyConcurrentSet<DexMethod*>* m_non_true_virtuals;
+  std::vector<const DexMethod*>* m_analyzed_methods;
   std::unordered_set<DexMethodRef*> m_active;
   std::unordered_set<DexType*> m_initialized;
 
@@ -27,10 +28,12 @@ class ClInitSideEffectsAnalysis {
   explicit ClInitSideEffectsAnalysis(
       bool allow_benign_method_invocations,
       const method::ClInitHasNoSideEffectsPredicate* clinit_has_no_side_effects,
-      const InsertOnlyConcurrentSet<DexMethod*>* non_true_virtuals)
+      const InsertOnlyConcurrentSet<DexMethod*>* non_true_virtuals,
+      std::vector<const DexMethod*>* analyzed_methods)
       : m_allow_benign_method_invocations(allow_benign_method_invocations),
         m_clinit_has_no_side_effects(clinit_has_no_side_effects),
-        m_non_true_virtuals(non_true_virtuals) {}
+        m_non_true_virtuals(non_true_virtuals),
+        m_analyzed_methods(analyzed_methods) {}
 
   const DexClass* run(const DexClass* cls) {
     std::stack<const DexClass*> stack;
@@ -133,6 +136,9 @@ class ClInitSideEffectsAnalysis {
       // recursion
       return true;
     }
+    if (m_analyzed_methods) {
+      m_analyzed_methods->push_back(method);
+    }
     bool non_trivial = false;
     editable_cfg_adapter::iterate_with_iterator(
         method->get_code(), [&](const IRList::iterator& it) {
@@ -498,10 +504,11 @@ const DexClass* clinit_may_have_side_effects(
     const DexClass* cls,
     bool allow_benign_method_invocations,
     const ClInitHasNoSideEffectsPredicate* clinit_has_no_side_effects,
-    const InsertOnlyConcurrentSet<DexMethod*>* non_true_virtuals) {
+    const InsertOnlyConcurrentSet<DexMethod*>* non_true_virtuals,
+    std::vector<const DexMethod*>* analyzed_methods) {
   ClInitSideEffectsAnalysis analysis(allow_benign_method_invocations,
                                      clinit_has_no_side_effects,
-                                     non_true_virtuals);
+                                     non_true_virtuals, analyzed_methods);
   return analysis.run(cls);
 }
 
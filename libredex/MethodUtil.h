@@ -69,12 +69,16 @@ using ClInitHasNoSideEffectsPredicate = std::function<bool(const DexType*)>;
  * certain framework methods are benign, i.e. trigger no side effects. This is
  * somewhat optimistic, and not currently conservative.
  * TODO: Make this less optimistic and more precise.
+ *
+ * When `analyzed_methods` is given, the methods whose code was inspected are
+ * added to it, so that callers can tell when the result may have changed.
  */
 const DexClass* clinit_may_have_side_effects(
     const DexClass* cls,
     bool allow_benign_method_invocations,
     const ClInitHasNoSideEffectsPredicate* clinit_has_no_side_effects = nullptr,
-    const InsertOnlyConcurrentSet<DexMethod*>* non_true_virtuals = nullptr);
+    const InsertOnlyConcurrentSet<DexMethod*>* non_true_virtuals = nullptr,
+    std::vector<const DexMethod*>* analyzed_methods = nullptr);
 
 /**
  * Check that the method contains no invoke-super instruction; this is a
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MinHashLsh.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+#include "Debug.h"
+#include "WorkQueue.h"
+
+namespace {
+
+// The finalizer of splitmix64; a cheap bijection with good avalanche.
+uint64_t mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+// Computes the band keys of one item: each band key combines `rows_per_band`
+// MinHash values, where the k-th hash function is mix((k << 32) | feature).
+void band_keys(const std::vector<uint32_t>& features,
+               const min_hash::LshConfig& config,
+               uint64_t* keys) {
+  const size_t num_hashes = config.bands * config.rows_per_band;
+  std::vector<uint64_t> signature(num_hashes,
+                                  std::numeric_limits<uint64_t>::max());
+  for (auto feature : features) {
+    for (size_t k = 0; k < num_hashes; ++k) {
+      auto h = mix((uint64_t(k) << 32) | feature);
+      signature[k] = std::min(signature[k], h);
+    }
+  }
+  for (size_t b = 0; b < config.bands; ++b) {
+    uint64_t key = 0;
+    for (size_t r = 0; r < config.rows_per_band; ++r) {
+      key = mix(key ^ signature[b * config.rows_per_band + r]);
+    }
+    keys[b] = key;
+  }
+}
+
+// The items of one band, sorted by band key (and index), so that each bucket
+// is a contiguous range.
+struct Band {
+  std::vector<uint32_t> sorted;
+  // For each item, its position in `sorted`.
+  std::vector<uint32_t> position;
+  // For each position in `sorted`, the bounds of its bucket.
+  std::vector<uint32_t> bucket_begin;
+  std::vector<uint32_t> bucket_end;
+};
+
+} // namespace
+
+namespace min_hash {
+
+std::vector<std::vector<uint32_t>> candidate_neighbors(
+    const std::vector<std::vector<uint32_t>>& features,
+    const LshConfig& config) {
+  always_assert(config.bands > 0 && config.rows_per_band > 0);
+  always_assert(config.max_bucket_size > 1);
+  always_assert(features.size() <= std::numeric_limits<uint32_t>::max());
+  const uint32_t n = features.size();
+  const uint32_t bands = config.bands;
+
+  std::vector<uint64_t> keys(size_t(n) * bands);
+  workqueue_run_for<uint32_t>(0, n, [&](uint32_t i) {
+    band_keys(features[i], config, keys.data() + size_t(i) * bands);
+  });
+
+  std::vector<Band> band_buckets(bands);
+  workqueue_run_for<uint32_t>(0, bands, [&](uint32_t b) {
+    auto& band = band_buckets[b];
+    auto key = [&](uint32_t i) { return keys[size_t(i) * bands + b]; };
+    band.sorted.resize(n);
+    std::iota(band.sorted.begin(), band.sorted.end(), 0);
+    std::sort(band.sorted.begin(), band.sorted.end(),
+              [&](uint32_t i, uint32_t j) {
+                return std::make_pair(key(i), i) < std::make_pair(key(j), j);
+              });
+    band.position.resize(n);
+    band.bucket_begin.resize(n);
+    band.bucket_end.resize(n);
+    for (uint32_t begin = 0, end; begin < n; begin = end) {
+      for (end = begin + 1;
+           end < n && key(band.sorted[end]) == key(band.sorted[begin]);
+           ++end) {
+      }
+      for (auto p = begin; p < end; ++p) {
+        band.position[band.sorted[p]] = p;
+        band.bucket_begin[p] = begin;
+        band.bucket_end[p] = end;
+      }
+    }
+  });
+
+  std::vector<std::vector<uint32_t>> neighbors(n);
+  const uint32_t half_window = config.max_bucket_size / 2;
+  workqueue_run_for<uint32_t>(0, n, [&](uint32_t i) {
+    std::vector<uint32_t> hits;
+    for (const auto& band : band_buckets) {
+      auto p = band.position[i];
+      auto begin = band.bucket_begin[p];
+      auto end = band.bucket_end[p];
+      if (end - begin > config.max_bucket_size) {
+        begin = std::max(begin, p - std::min(p, half_window));
+        end = std::min(end, p + half_window + 1);
+      }
+      for (auto q = begin; q < end; ++q) {
+        if (q != p) {
+          hits.push_back(band.sorted[q]);
+        }
+      }
+    }
+    // Rank the candidates by the number of shared buckets.
+    std::sort(hits.begin(), hits.end());
+    std::vector<std::pair<uint32_t, uint32_t>> counted;
+    for (size_t begin = 0, end; begin < hits.size(); begin = end) {
+      for (end = begin + 1; end < hits.size() && hits[end] == hits[begin];
+           ++end) {
+      }
+      counted.emplace_back(end - begin, hits[begin]);
+    }
+    if (counted.size() > config.max_candidates) {
+      std::partial_sort(counted.begin(),
+                        counted.begin() + config.max_candidates,
+                        counted.end(), [](const auto& a, const auto& b) {
+                          return a.first != b.first ? a.first > b.first
+                                                    : a.second < b.second;
+                        });
+      counted.resize(config.max_candidates);
+    }
+    auto& res = neighbors[i];
+    res.reserve(counted.size());
+    for (auto& [count, j] : counted) {
+      res.push_back(j);
+    }
+    std::sort(res.begin(), res.end());
+  });
+  return neighbors;
+}
+
+} // namespace min_hash
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Locality-sensitive hashing of feature sets via MinHash.
+ *
+ * Every item is described by a set of (integer) features, e.g. the hashes of
+ * the instruction sequences of a method. For each item, we compute a MinHash
+ * signature of `bands * rows_per_band` values; the probability that two items
+ * agree on one signature value is their Jaccard similarity. The signature is
+ * cut into bands, and items whose signatures agree on all values of some band
+ * land in the same bucket for that band. Items sharing at least one bucket are
+ * candidate neighbors. With Jaccard similarity s, the probability of becoming
+ * candidates is 1 - (1 - s^rows_per_band)^bands, which sharply separates
+ * similar from dissimilar pairs.
+ *
+ * This takes time and memory linear in the total number of features (plus the
+ * number of reported candidates), instead of comparing all pairs of items.
+ * The result only depends on the input, not on the number of threads.
+ */
+namespace min_hash {
+
+struct LshConfig {
+  uint32_t bands{16};
+  uint32_t rows_per_band{2};
+  // Items in a bucket that is larger than this only become candidates of their
+  // closest (by index) bucket neighbors, so that very common signatures (e.g.
+  // of trivial methods) do not make the candidate sets quadratic.
+  uint32_t max_bucket_size{64};
+  // The maximum number of candidates reported per item; candidates sharing
+  // more buckets with an item are preferred, then lower indices.
+  uint32_t max_candidates{32};
+};
+
+/*
+ * Returns, for each item, the indices of its candidate neighbors in ascending
+ * order. An item is never its own candidate. The candidate relation is not
+ * necessarily symmetric, as candidates are capped per item.
+ */
+std::vector<std::vector<uint32_t>> candidate_neighbors(
+    const std::vector<std::vector<uint32_t>>& features,
+    const LshConfig& config = LshConfig());
+
+} // namespace min_hash
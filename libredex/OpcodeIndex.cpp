@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "OpcodeIndex.h"
+
+#include <algorithm>
+
+#include "ControlFlow.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "Trace.h"
+#include "Walkers.h"
+#include "WorkQueue.h"
+
+namespace opcode_index {
+
+namespace {
+
+template <typename Fn>
+void for_each_insn(const IRCode& code, const Fn& fn) {
+  if (code.editable_cfg_built()) {
+    for (const auto& mie : InstructionIterable(code.cfg())) {
+      fn(mie.insn);
+    }
+  } else {
+    for (const auto& mie : InstructionIterable(code)) {
+      fn(mie.insn);
+    }
+  }
+}
+
+void insert_sorted(std::vector<uint32_t>& ids, uint32_t id) {
+  auto it = std::lower_bound(ids.begin(), ids.end(), id);
+  if (it == ids.end() || *it != id) {
+    ids.insert(it, id);
+  }
+}
+
+void erase_sorted(std::vector<uint32_t>& ids, uint32_t id) {
+  auto it = std::lower_bound(ids.begin(), ids.end(), id);
+  if (it != ids.end() && *it == id) {
+    ids.erase(it);
+  }
+}
+
+} // namespace
+
+OpcodeSet OpcodeSet::of(const IRCode& code) {
+  OpcodeSet set;
+  for_each_insn(code, [&](const IRInstruction* insn) {
+    set.insert(insn->opcode());
+  });
+  return set;
+}
+
+OpcodeIndex::OpcodeIndex(const Scope& scope) {
+  walk::code(scope, [&](DexMethod* method, IRCode&) {
+    m_ids.emplace(method, m_methods.size());
+    m_methods.push_back(method);
+  });
+}
+
+OpcodeIndex::Summary OpcodeIndex::summarize(const DexMethod* method) {
+  Summary summary;
+  const auto* code = method->get_code();
+  if (code == nullptr) {
+    return summary;
+  }
+  for_each_insn(*code, [&](const IRInstruction* insn) {
+    summary.opcodes.insert(insn->opcode());
+    if (insn->has_method()) {
+      summary.refs.push_back(insn->get_method());
+    } else if (insn->has_field()) {
+      summary.refs.push_back(insn->get_field());
+    } else if (insn->has_type()) {
+      summary.refs.push_back(insn->get_type());
+    } else if (insn->has_string()) {
+      summary.refs.push_back(insn->get_string());
+    }
+  });
+  auto& refs = summary.refs;
+  std::sort(refs.begin(), refs.end());
+  refs.erase(std::unique(refs.begin(), refs.end()), refs.end());
+  return summary;
+}
+
+void OpcodeIndex::ensure_built() {
+  if (!m_built) {
+    m_summaries.resize(m_methods.size());
+    workqueue_run_for<size_t>(0, m_methods.size(), [&](size_t id) {
+      if (m_methods[id] != nullptr) {
+        m_summaries[id] = summarize(m_methods[id]);
+      }
+    });
+    m_by_opcode.resize(kNumOpcodes);
+    // Ids are visited in increasing order, so lists stay sorted.
+    for (MethodId id = 0; id < m_methods.size(); ++id) {
+      add_to_lists(id);
+    }
+    m_built = true;
+    std::lock_guard<std::mutex> lock(m_dirty_mutex);
+    m_dirty.clear();
+    TRACE(PM, 3, "Built opcode index of %zu methods, %zu refs",
+          m_methods.size(), m_by_ref.size());
+    return;
+  }
+
+  std::vector<MethodId> dirty;
+  {
+    std::lock_guard<std::mutex> lock(m_dirty_mutex);
+    std::swap(dirty, m_dirty);
+  }
+  std::sort(dirty.begin(), dirty.end());
+  dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+  for (auto id : dirty) {
+    if (m_methods[id] == nullptr) {
+      continue;
+    }
+    remove_from_lists(id);
+    m_summaries[id] = summarize(m_methods[id]);
+    add_to_lists(id);
+  }
+}
+
+void OpcodeIndex::add_to_lists(MethodId id) {
+  const auto& summary = m_summaries[id];
+  for (size_t op = 0; op < kNumOpcodes; ++op) {
+    if (summary.opcodes.contains(static_cast<IROpcode>(op))) {
+      insert_sorted(m_by_opcode[op], id);
+    }
+  }
+  for (const auto* ref : summary.refs) {
+    insert_sorted(m_by_ref[ref], id);
+  }
+}
+
+void OpcodeIndex::remove_from_lists(MethodId id) {
+  const auto& summary = m_summaries[id];
+  for (size_t op = 0; op < kNumOpcodes; ++op) {
+    if (summary.opcodes.contains(static_cast<IROpcode>(op))) {
+      erase_sorted(m_by_opcode[op], id);
+    }
+  }
+  for (const auto* ref : summary.refs) {
+    auto it = m_by_ref.find(ref);
+    erase_sorted(it->second, id);
+    if (it->second.empty()) {
+      m_by_ref.erase(it);
+    }
+  }
+}
+
+std::vector<DexMethod*> OpcodeIndex::to_methods(
+    const std::vector<MethodId>& ids) const {
+  std::vector<DexMethod*> methods;
+  methods.reserve(ids.size());
+  for (auto id : ids) {
+    methods.push_back(m_methods[id]);
+  }
+  return methods;
+}
+
+const OpcodeSet& OpcodeIndex::opcodes(const DexMethod* method) {
+  static const OpcodeSet empty;
+  ensure_built();
+  auto it = m_ids.find(method);
+  return it == m_ids.end() ? empty : m_summaries[it->second].opcodes;
+}
+
+std::vector<DexMethod*> OpcodeIndex::methods_with(IROpcode op) {
+  ensure_built();
+  return to_methods(m_by_opcode[op]);
+}
+
+std::vector<DexMethod*> OpcodeIndex::methods_with_any(const OpcodeSet& ops) {
+  ensure_built();
+  std::vector<MethodId> ids;
+  for (size_t op = 0; op < kNumOpcodes; ++op) {
+    if (ops.contains(static_cast<IROpcode>(op))) {
+      const auto& op_ids = m_by_opcode[op];
+      ids.insert(ids.end(), op_ids.begin(), op_ids.end());
+    }
+  }
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  return to_methods(ids);
+}
+
+std::vector<DexMethod*> OpcodeIndex::methods_referencing_impl(
+    const void* ref) {
+  ensure_built();
+  auto it = m_by_ref.find(ref);
+  if (it == m_by_ref.end()) {
+    return {};
+  }
+  return to_methods(it->second);
+}
+
+void OpcodeIndex::invalidate(const DexMethod* method) {
+  auto it = m_ids.find(method);
+  if (it == m_ids.end()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(m_dirty_mutex);
+  m_dirty.push_back(it->second);
+}
+
+void OpcodeIndex::remove_method(const DexMethod* method) {
+  auto it = m_ids.find(method);
+  if (it == m_ids.end()) {
+    return;
+  }
+  auto id = it->second;
+  if (m_built) {
+    remove_from_lists(id);
+    m_summaries[id] = Summary();
+  }
+  m_methods[id] = nullptr;
+  m_ids.erase(it);
+}
+
+} // namespace opcode_index
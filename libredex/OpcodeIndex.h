@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <bitset>
+#include <initializer_list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "DexClass.h"
+#include "IROpcode.h"
+
+namespace opcode_index {
+
+constexpr size_t kNumOpcodes = 0
+#define OP(...) +1
+#define IOP(...) +1
+#define OPRANGE(...)
+#include "IROpcodes.def"
+    ;
+
+/*
+ * The set of opcodes that occur in a method's code.
+ */
+class OpcodeSet {
+ public:
+  OpcodeSet() = default;
+
+  OpcodeSet(std::initializer_list<IROpcode> ops) {
+    for (auto op : ops) {
+      insert(op);
+    }
+  }
+
+  static OpcodeSet of(const IRCode& code);
+
+  void insert(IROpcode op) { m_bits.set(op); }
+
+  bool contains(IROpcode op) const { return m_bits.test(op); }
+
+  bool contains_any(const OpcodeSet& other) const {
+    return (m_bits & other.m_bits).any();
+  }
+
+  bool empty() const { return m_bits.none(); }
+
+ private:
+  std::bitset<kNumOpcodes> m_bits;
+};
+
+/*
+ * Inverted index from opcodes and referenced methods, fields, types and
+ * strings to the methods of a scope whose code contains them. Passes that
+ * look for rare patterns, e.g. invocations of one particular method, can
+ * use it to visit only the candidate methods instead of every method.
+ *
+ * The index is built on the first query. Code edits are not tracked: after
+ * changing a method's code, call `invalidate`, and the method is re-indexed
+ * on the next query. Methods added to the scope after construction are not
+ * indexed, and deleted methods must be dropped with `remove_method`.
+ *
+ * `invalidate` may be called concurrently, e.g. from a parallel walk; the
+ * queries must not race with it or with each other.
+ */
+class OpcodeIndex {
+ public:
+  explicit OpcodeIndex(const Scope& scope);
+
+  // The opcodes of the given method's code; empty for methods that are not
+  // in the index.
+  const OpcodeSet& opcodes(const DexMethod* method);
+
+  // All returned lists are in scope order, without duplicates.
+  std::vector<DexMethod*> methods_with(IROpcode op);
+
+  std::vector<DexMethod*> methods_with_any(const OpcodeSet& ops);
+
+  std::vector<DexMethod*> methods_referencing(const DexMethodRef* ref) {
+    return methods_referencing_impl(ref);
+  }
+
+  std::vector<DexMethod*> methods_referencing(const DexFieldRef* ref) {
+    return methods_referencing_impl(ref);
+  }
+
+  std::vector<DexMethod*> methods_referencing(const DexType* ref) {
+    return methods_referencing_impl(ref);
+  }
+
+  std::vector<DexMethod*> methods_referencing(const DexString* ref) {
+    return methods_referencing_impl(ref);
+  }
+
+  void invalidate(const DexMethod* method);
+
+  // Drops a method that is about to be deleted from the index. Unlike
+  // `invalidate`, this is not thread-safe.
+  void remove_method(const DexMethod* method);
+
+  // Builds the index and re-indexes invalidated methods, if needed. Called by
+  // all queries.
+  void ensure_built();
+
+  size_t size() const { return m_ids.size(); }
+
+ private:
+  using MethodId = uint32_t;
+
+  struct Summary {
+    OpcodeSet opcodes;
+    // Sorted, without duplicates.
+    std::vector<const void*> refs;
+  };
+
+  static Summary summarize(const DexMethod* method);
+
+  std::vector<DexMethod*> methods_referencing_impl(const void* ref);
+
+  std::vector<DexMethod*> to_methods(const std::vector<MethodId>& ids) const;
+
+  void add_to_lists(MethodId id);
+
+  void remove_from_lists(MethodId id);
+
+  // Removed methods leave a nullptr behind, so that ids remain stable.
+  std::vector<DexMethod*> m_methods;
+  std::unordered_map<const DexMethod*, MethodId> m_ids;
+  std::vector<Summary> m_summaries;
+  bool m_built{false};
+
+  // Sorted lists of method ids.
+  std::vector<std::vector<MethodId>> m_by_opcode;
+  std::unordered_map<const void*, std::vector<MethodId>> m_by_ref;
+
+  std::mutex m_dirty_mutex;
+  std::vector<MethodId> m_dirty;
+};
+
+} // namespace opcode_index
@@ -7,10 +7,14 @@
 
 #include "Pass.h"
 
+#include <atomic>
+
 #include "AnalysisUsage.h"
 #include "Debug.h"
 #include "DexUtil.h"
+#include "PassManager.h"
 #include "PassRegistry.h"
+#include "Walkers.h"
 
 Pass::Pass(const std::string& name, Kind kind) : m_name(name), m_kind(kind) {
   PassRegistry::get().register_pass(this);
@@ -52,3 +56,23 @@ Scope PartialPass::build_class_scope_with_packages_config(
     return build_class_scope_for_packages(stores, m_select_packages);
   }
 }
+
+void MethodLocalPass::run_pass(DexStoresVector& stores,
+                               ConfigFiles& conf,
+                               PassManager& mgr) {
+  auto run = start_run(stores, conf, mgr);
+  std::atomic<size_t> skipped_methods{0};
+  walk::parallel::code(build_class_scope(stores),
+                       [&](DexMethod* method, IRCode& code) {
+                         if (skips_unchanged_methods() &&
+                             mgr.is_unchanged_since_last_run(this, method)) {
+                           skipped_methods++;
+                           return;
+                         }
+                         run->run_on_method(method, code);
+                       });
+  if (skips_unchanged_methods()) {
+    mgr.set_metric("skipped_unchanged_methods", skipped_methods.load());
+  }
+  run->finish(mgr);
+}
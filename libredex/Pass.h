@@ -8,6 +8,8 @@
 #pragma once
 
 #include <algorithm>
+#include <functional>
+#include <memory>
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -19,6 +21,7 @@
 
 class AnalysisUsage;
 struct ConfigFiles;
+class IRCode;
 class PassManager;
 
 class Pass : public Configurable {
@@ -39,6 +42,34 @@ class Pass : public Configurable {
   // \returns True means this pass is NOT guaranteed to fully use editable cfg.
   virtual bool is_cfg_legacy() { return false; }
 
+  // \returns True if a run of this pass may leave alone the methods whose code
+  // did not change since the end of its previous run, as it would mostly not
+  // change them again. With the pass manager's `skip_unchanged_methods`
+  // option, such a pass can then ask PassManager::is_unchanged_since_last_run
+  // which methods to skip. MethodLocalPasses do so automatically.
+  virtual bool skips_unchanged_methods() const { return false; }
+
+  // Analysis passes whose result only depends on the classes and members of
+  // the scope, and not on any code, may return a function that computes it.
+  // With the pass manager's `prefetch_analyses` option, that function is run
+  // in the background while the checks of the preceding pass run, and is
+  // waited for before run_pass, which should then use what it computed. The
+  // function must not call into the PassManager.
+  virtual std::function<void()> prefetch_analysis(
+      const DexStoresVector& /* stores */) {
+    return nullptr;
+  }
+
+  // Preserved analyses may support being moved out of memory when the pass
+  // manager's `memory_budget_mb` is exceeded. spill_analysis_result writes the
+  // result to the given file and drops it, and returns whether it did so;
+  // reload_analysis_result reads it back when the analysis is next asked for
+  // with PassManager::get_preserved_analysis.
+  virtual bool spill_analysis_result(const std::string& /* path */) {
+    return false;
+  }
+  virtual void reload_analysis_result(const std::string& /* path */) {}
+
   virtual void destroy_analysis_result() {
     always_assert_log(m_kind != ANALYSIS,
                       "destroy_analysis_result not implemented for %s",
@@ -112,3 +143,42 @@ class PartialPass : public Pass {
  private:
   std::unordered_set<std::string> m_select_packages;
 };
+
+/**
+ * A pass that transforms each method on its own: any whole-program information
+ * it needs is computed up front, in start_run, and is not updated while the
+ * methods are being transformed.
+ *
+ * On its own, a MethodLocalPass walks the scope once, like any other pass.
+ * With the pass manager's `fuse_method_local_passes` option, a run of
+ * adjacent MethodLocalPasses is started together and then executed as one
+ * per-method pipeline in a single parallel walk, so that each method's code
+ * is visited once, while it is hot in the cache, instead of once per pass.
+ */
+class MethodLocalPass : public Pass {
+ public:
+  explicit MethodLocalPass(const std::string& name) : Pass(name) {}
+
+  class Run {
+   public:
+    virtual ~Run() = default;
+
+    // Transforms one method. Called concurrently for all methods with code,
+    // and must only touch `method` and its code.
+    virtual void run_on_method(DexMethod* method, IRCode& code) = 0;
+
+    // Called once all methods have been transformed, to report metrics.
+    virtual void finish(PassManager& /* mgr */) {}
+  };
+
+  // Computes the whole-program information that run_on_method needs. When
+  // passes are fused, this is called for all of them before any method is
+  // transformed.
+  virtual std::unique_ptr<Run> start_run(DexStoresVector& stores,
+                                         ConfigFiles& conf,
+                                         PassManager& mgr) = 0;
+
+  void run_pass(DexStoresVector& stores,
+                ConfigFiles& conf,
+                PassManager& mgr) final;
+};
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "PassCostHistory.h"
+
+#include <atomic>
+#include <fstream>
+#include <json/reader.h>
+
+#include "Debug.h"
+#include "IRCode.h"
+#include "Walkers.h"
+
+PassCostHistory::ScopeStats PassCostHistory::compute_scope_stats(
+    const Scope& scope) {
+  std::atomic<size_t> methods{0};
+  std::atomic<size_t> instructions{0};
+  walk::parallel::methods(scope, [&](DexMethod* method) {
+    methods++;
+    if (method->get_code() != nullptr) {
+      instructions += method->get_code()->count_opcodes();
+    }
+  });
+  ScopeStats stats;
+  stats.classes = scope.size();
+  stats.methods = methods;
+  stats.instructions = instructions;
+  return stats;
+}
+
+PassCostHistory::PassCostHistory(std::string path) : m_path(std::move(path)) {
+  std::ifstream input(m_path);
+  if (!input) {
+    return;
+  }
+  Json::Reader reader;
+  Json::Value runs;
+  always_assert_log(reader.parse(input, runs) && runs.isArray(),
+                    "Failed to parse pass cost history from file: %s\n%s",
+                    m_path.c_str(),
+                    reader.getFormattedErrorMessages().c_str());
+  for (const auto& run : runs) {
+    add_samples(run);
+    m_runs.append(run);
+  }
+}
+
+void PassCostHistory::add_samples(const Json::Value& run) {
+  auto instructions = run["scope"]["instructions"].asUInt64();
+  for (const auto& pass : run["passes"]) {
+    PassRecord record;
+    record.name = pass["name"].asString();
+    record.wall_time = pass["wall_time"].asDouble();
+    if (pass.isMember("vm_hwm_delta")) {
+      record.vm_hwm_delta = pass["vm_hwm_delta"].asUInt64();
+    }
+    record.removed_instructions = pass["removed_instructions"].asInt64();
+    m_samples[record.name].push_back({instructions, std::move(record)});
+  }
+}
+
+boost::optional<PassCostHistory::Prediction> PassCostHistory::predict(
+    const std::string& pass_name, const ScopeStats& scope_stats) const {
+  auto it = m_samples.find(pass_name);
+  if (it == m_samples.end()) {
+    return boost::none;
+  }
+  // For y = k * x, least squares gives k = sum(x * y) / sum(x * x).
+  double xx = 0;
+  double x_wall_time = 0;
+  double x_removed = 0;
+  double hwm_xx = 0;
+  double x_hwm = 0;
+  for (const auto& sample : it->second) {
+    double x = sample.instructions;
+    xx += x * x;
+    x_wall_time += x * sample.record.wall_time;
+    x_removed += x * sample.record.removed_instructions;
+    if (sample.record.vm_hwm_delta) {
+      hwm_xx += x * x;
+      x_hwm += x * *sample.record.vm_hwm_delta;
+    }
+  }
+  if (xx == 0) {
+    return boost::none;
+  }
+  double x = scope_stats.instructions;
+  Prediction prediction;
+  prediction.wall_time = x * x_wall_time / xx;
+  prediction.removed_instructions = x * x_removed / xx;
+  if (hwm_xx != 0) {
+    prediction.vm_hwm_delta = static_cast<uint64_t>(x * x_hwm / hwm_xx);
+  }
+  prediction.samples = it->second.size();
+  return prediction;
+}
+
+void PassCostHistory::record(const ScopeStats& scope_stats,
+                             const std::vector<PassRecord>& records) {
+  Json::Value run(Json::objectValue);
+  run["scope"]["classes"] = Json::UInt64(scope_stats.classes);
+  run["scope"]["methods"] = Json::UInt64(scope_stats.methods);
+  run["scope"]["instructions"] = Json::UInt64(scope_stats.instructions);
+  run["passes"] = Json::arrayValue;
+  for (const auto& record : records) {
+    Json::Value pass(Json::objectValue);
+    pass["name"] = record.name;
+    pass["wall_time"] = record.wall_time;
+    if (record.vm_hwm_delta) {
+      pass["vm_hwm_delta"] = Json::UInt64(*record.vm_hwm_delta);
+    }
+    pass["removed_instructions"] = Json::Int64(record.removed_instructions);
+    run["passes"].append(pass);
+  }
+  add_samples(run);
+  m_runs.append(run);
+
+  std::ofstream output(m_path);
+  always_assert_log(output, "Cannot write pass cost history to %s",
+                    m_path.c_str());
+  output << m_runs.toStyledString();
+}
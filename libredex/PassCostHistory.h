@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <json/value.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DexClass.h"
+
+/**
+ * The wall time, memory and effect of each pass of past runs, together with
+ * the size of the scope it ran on. The history is kept in a local JSON file,
+ * with one entry per run, and is used to predict what a pass will cost on
+ * another scope before running it.
+ *
+ * Costs are assumed to grow linearly with the number of instructions in the
+ * scope, so each prediction is a least-squares fit of a line through the
+ * origin over all past runs of the pass.
+ */
+class PassCostHistory {
+ public:
+  struct ScopeStats {
+    size_t classes{0};
+    size_t methods{0};
+    size_t instructions{0};
+  };
+
+  struct PassRecord {
+    // The name of the pass with "#<run>" appended, as in PassInfo.
+    std::string name;
+    double wall_time{0};
+    // Only known when memory stats are collected.
+    boost::optional<uint64_t> vm_hwm_delta;
+    // Negative when the pass added instructions.
+    int64_t removed_instructions{0};
+  };
+
+  struct Prediction {
+    double wall_time{0};
+    boost::optional<uint64_t> vm_hwm_delta;
+    double removed_instructions{0};
+    // How many past runs the prediction is based on.
+    size_t samples{0};
+  };
+
+  static ScopeStats compute_scope_stats(const Scope& scope);
+
+  // Loads the past runs in the given file, if it exists.
+  explicit PassCostHistory(std::string path);
+
+  boost::optional<Prediction> predict(const std::string& pass_name,
+                                      const ScopeStats& scope_stats) const;
+
+  // Adds a run to the history, and writes it back to its file.
+  void record(const ScopeStats& scope_stats,
+              const std::vector<PassRecord>& records);
+
+  size_t num_runs() const { return m_runs.size(); }
+
+ private:
+  struct Sample {
+    size_t instructions;
+    PassRecord record;
+  };
+
+  void add_samples(const Json::Value& run);
+
+  std::string m_path;
+  Json::Value m_runs{Json::arrayValue};
+  std::unordered_map<std::string, std::vector<Sample>> m_samples;
+};
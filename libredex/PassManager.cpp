@@ -8,17 +8,24 @@
 #include "PassManager.h"
 #include "DexAssessments.h"
 
+#include <algorithm>
+#include <atomic>
 #include <boost/filesystem.hpp>
+#include <boost/functional/hash.hpp>
 #include <cinttypes>
 #include <cstdio>
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <json/json.h>
 #include <limits>
 #include <list>
+#include <map>
+#include <future>
 #include <mutex>
+#include <optional>
 #include <sstream>
 #include <thread>
 #include <typeinfo>
@@ -35,9 +42,13 @@
 #include "AssetManager.h"
 #include "ClassChecker.h"
 #include "CommandProfiling.h"
+#include "ConcurrentContainers.h"
 #include "ConfigFiles.h"
+#include "ControlFlow.h"
+#include "CpuProfiling.h"
 #include "Debug.h"
 #include "DexClass.h"
+#include "DexHasher.h"
 #include "DexLoader.h"
 #include "DexStructure.h"
 #include "DexUtil.h"
@@ -50,6 +61,9 @@
 #include "Native.h"
 #include "OptData.h"
 #include "Pass.h"
+#include "PassCostHistory.h"
+#include "PerfCounters.h"
+#include "PersistentAnalysisCache.h"
 #include "PrintSeeds.h"
 #include "ProguardPrintConfiguration.h"
 #include "ProguardReporting.h"
@@ -62,6 +76,7 @@
 #include "SourceBlocks.h"
 #include "ThreadPool.h"
 #include "Timer.h"
+#include "TypeUtil.h"
 #include "Walkers.h"
 
 namespace {
@@ -92,6 +107,176 @@ std::string get_apk_dir(const ConfigFiles& config) {
   return apkdir;
 }
 
+// The type checker's verdict on a method depends on the method itself, and
+// on the class hierarchy and the existence, types and access flags of the
+// members it refers to. This hashes the latter for each class in the scope.
+std::unordered_map<const DexType*, size_t> type_checker_class_hashes(
+    const Scope& scope) {
+  std::vector<size_t> hashes(scope.size());
+  workqueue_run_for<size_t>(0, scope.size(), [&](size_t i) {
+    const auto* cls = scope[i];
+    size_t hash = 0;
+    boost::hash_combine(hash, cls->get_super_class());
+    boost::hash_combine(hash, cls->get_access());
+    for (const auto* intf : *cls->get_interfaces()) {
+      boost::hash_combine(hash, intf);
+    }
+    for (const auto* field : cls->get_all_fields()) {
+      boost::hash_combine(hash, field);
+      boost::hash_combine(hash, field->get_access());
+      boost::hash_combine(hash, field->get_type());
+    }
+    for (const auto* method : cls->get_all_methods()) {
+      boost::hash_combine(hash, method);
+      boost::hash_combine(hash, method->get_access());
+      boost::hash_combine(hash, method->get_proto());
+    }
+    hashes[i] = hash;
+  });
+  std::unordered_map<const DexType*, size_t> class_hashes;
+  for (size_t i = 0; i < scope.size(); ++i) {
+    class_hashes.emplace(scope[i]->get_type(), hashes[i]);
+  }
+  return class_hashes;
+}
+
+// The types whose class changed between the two sets of class hashes, and the
+// types of the scope which inherit from them.
+std::unordered_set<const DexType*> type_checker_affected_types(
+    const Scope& scope,
+    const std::unordered_map<const DexType*, size_t>& old_hashes,
+    const std::unordered_map<const DexType*, size_t>& new_hashes) {
+  std::unordered_set<const DexType*> affected;
+  for (const auto& [type, hash] : new_hashes) {
+    auto it = old_hashes.find(type);
+    if (it == old_hashes.end() || it->second != hash) {
+      affected.insert(type);
+    }
+  }
+  for (const auto& [type, _] : old_hashes) {
+    if (!new_hashes.count(type)) {
+      affected.insert(type);
+    }
+  }
+  if (affected.empty()) {
+    return affected;
+  }
+
+  std::unordered_map<const DexType*, bool> memo;
+  std::function<bool(const DexType*)> inherits_affected =
+      [&](const DexType* type) -> bool {
+    if (affected.count(type)) {
+      return true;
+    }
+    auto it = memo.find(type);
+    if (it != memo.end()) {
+      return it->second;
+    }
+    bool result = false;
+    const auto* cls = type_class(type);
+    if (cls != nullptr && !cls->is_external()) {
+      memo[type] = false; // Guards against malformed cycles.
+      if (cls->get_super_class() != nullptr) {
+        result = inherits_affected(cls->get_super_class());
+      }
+      for (const auto* intf : *cls->get_interfaces()) {
+        result = result || inherits_affected(intf);
+      }
+    }
+    memo[type] = result;
+    return result;
+  };
+  std::vector<const DexType*> inheriting;
+  for (const auto* cls : scope) {
+    if (inherits_affected(cls->get_type())) {
+      inheriting.push_back(cls->get_type());
+    }
+  }
+  affected.insert(inheriting.begin(), inheriting.end());
+  return affected;
+}
+
+// Whether the method's signature or code refers to any of the given types,
+// or to members of classes of those types.
+bool type_checker_depends_on(const DexMethod* method,
+                             const std::unordered_set<const DexType*>& types) {
+  if (types.empty()) {
+    return false;
+  }
+  auto is_affected = [&](const DexType* type) {
+    return types.count(type::get_element_type_if_array(type)) != 0;
+  };
+  auto is_affected_proto = [&](const DexProto* proto) {
+    if (is_affected(proto->get_rtype())) {
+      return true;
+    }
+    for (const auto* arg : *proto->get_args()) {
+      if (is_affected(arg)) {
+        return true;
+      }
+    }
+    return false;
+  };
+  auto is_affected_insn = [&](const IRInstruction* insn) {
+    if (insn->has_type()) {
+      return is_affected(insn->get_type());
+    }
+    if (insn->has_field()) {
+      const auto* field = insn->get_field();
+      return is_affected(field->get_class()) || is_affected(field->get_type());
+    }
+    if (insn->has_method()) {
+      const auto* callee = insn->get_method();
+      return is_affected(callee->get_class()) ||
+             is_affected_proto(callee->get_proto());
+    }
+    return false;
+  };
+
+  if (is_affected(method->get_class()) ||
+      is_affected_proto(method->get_proto())) {
+    return true;
+  }
+  const auto* code = method->get_code();
+  if (code->editable_cfg_built()) {
+    const auto& cfg = code->cfg();
+    for (const auto* block : cfg.blocks()) {
+      for (const auto* edge : block->succs()) {
+        if (edge->type() == cfg::EDGE_THROW &&
+            edge->throw_info()->catch_type != nullptr &&
+            is_affected(edge->throw_info()->catch_type)) {
+          return true;
+        }
+      }
+    }
+    for (const auto& mie : InstructionIterable(cfg)) {
+      if (is_affected_insn(mie.insn)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  for (const auto& mie : *code) {
+    if (mie.type == MFLOW_CATCH && mie.centry->catch_type != nullptr &&
+        is_affected(mie.centry->catch_type)) {
+      return true;
+    }
+    if (mie.type == MFLOW_OPCODE && is_affected_insn(mie.insn)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t method_code_hash(const DexMethod* method) {
+  auto hash = hashing::DexMethodHasher(method).run();
+  size_t res = 0;
+  boost::hash_combine(res, hash.registers_hash);
+  boost::hash_combine(res, hash.code_hash);
+  boost::hash_combine(res, hash.signature_hash);
+  return res;
+}
+
 class CheckerConfig {
  public:
   explicit CheckerConfig(const ConfigFiles& conf,
@@ -118,6 +303,12 @@ class CheckerConfig {
         type_checker_args.get("annotated_cfg_on_error_reduced", true).asBool();
 
     m_check_classes = type_checker_args.get("check_classes", true).asBool();
+    m_batch_passes =
+        std::max(1u, type_checker_args.get("batch_passes", 1).asUInt());
+
+    if (type_checker_args.get("cache_results", true).asBool()) {
+      m_verified = std::make_shared<VerifiedMethods>();
+    }
 
     for (auto& trigger_pass : type_checker_args["run_after_passes"]) {
       m_type_checker_trigger_passes.insert(trigger_pass.asString());
@@ -164,9 +355,30 @@ class CheckerConfig {
     fail_error(std::move(msg));
   }
 
+  // With `batch_passes` above one, running after each pass only happens
+  // after every that many passes, so that fewer checks hold up the pipeline.
   bool run_after_pass(const Pass* pass) {
-    return m_run_type_checker_after_each_pass ||
-           m_type_checker_trigger_passes.count(pass->name()) > 0;
+    m_unchecked_passes.push_back(pass->name());
+    if (m_type_checker_trigger_passes.count(pass->name()) > 0) {
+      return true;
+    }
+    return m_run_type_checker_after_each_pass &&
+           m_unchecked_passes.size() >= m_batch_passes;
+  }
+
+  // Names the passes that ran since the last check, for attributing a
+  // failure of the next one, and starts over.
+  std::string take_unchecked_passes() {
+    std::string res;
+    if (m_unchecked_passes.size() == 1) {
+      res = m_unchecked_passes.front();
+    } else if (!m_unchecked_passes.empty()) {
+      res = "one of the " + std::to_string(m_unchecked_passes.size()) +
+            " passes from " + m_unchecked_passes.front() + " to " +
+            m_unchecked_passes.back();
+    }
+    m_unchecked_passes.clear();
+    return res;
   }
 
   // Literate style.
@@ -181,8 +393,10 @@ class CheckerConfig {
     return ret;
   }
 
+  // A non-empty `origin` says when the check runs, and prefixes any error.
   boost::optional<std::string> run_verifier(const Scope& scope,
-                                            bool exit_on_fail = true) {
+                                            bool exit_on_fail = true,
+                                            const std::string& origin = "") {
     if (m_disabled) {
       return boost::none;
     }
@@ -244,14 +458,54 @@ class CheckerConfig {
       return code->editable_cfg_built() ? show(code->cfg()) : show(code);
     };
 
+    // Methods that passed before are not checked again as long as neither
+    // they nor the classes they depend on changed. Copies of this config
+    // share the cache, but the checker flags are part of the key.
+    auto verified = m_verified;
+    size_t flags_hash = 0;
+    std::unordered_set<const DexType*> affected_types;
+    if (verified) {
+      auto class_hashes = type_checker_class_hashes(scope);
+      affected_types = type_checker_affected_types(
+          scope, verified->class_hashes, class_hashes);
+      verified->class_hashes = std::move(class_hashes);
+      TRACE(PM, 2, "IRTypeChecker: %zu types changed or inherit changes",
+            affected_types.size());
+      boost::hash_combine(flags_hash, m_validate_access);
+      boost::hash_combine(flags_hash, m_validate_invoke_super);
+      boost::hash_combine(flags_hash, m_verify_moves);
+      boost::hash_combine(flags_hash, m_check_no_overwrite_this);
+      boost::hash_combine(flags_hash, m_relaxed_init_check);
+    }
+    std::atomic<size_t> cache_hits{0};
+
     auto res =
         walk::parallel::methods<Result>(scope, [&](DexMethod* dex_method) {
+          size_t key = 0;
+          if (verified && dex_method->get_code() != nullptr) {
+            auto hash = hashing::DexMethodHasher(dex_method).run();
+            key = flags_hash;
+            boost::hash_combine(key, hash.registers_hash);
+            boost::hash_combine(key, hash.code_hash);
+            boost::hash_combine(key, hash.signature_hash);
+            if (verified->hashes.get(dex_method, 0) == key &&
+                !type_checker_depends_on(dex_method, affected_types)) {
+              cache_hits.fetch_add(1, std::memory_order_relaxed);
+              return Result();
+            }
+          }
           auto checker = run_checker(dex_method);
           if (!checker.fail()) {
+            if (key != 0) {
+              verified->hashes.insert_or_assign(
+                  std::make_pair(dex_method, key));
+            }
             return Result();
           }
           return Result(dex_method);
         });
+    TRACE(PM, 2, "IRTypeChecker: reused %zu earlier results",
+          cache_hits.load());
 
     if (res.errors != 0) {
       // Re-run the smallest method to produce error message.
@@ -259,6 +513,9 @@ class CheckerConfig {
       redex_assert(checker.fail());
 
       std::ostringstream oss;
+      if (!origin.empty()) {
+        oss << "[" << origin << "] ";
+      }
       oss << "Inconsistency found in Dex code for "
           << show(res.smallest_error_method) << std::endl
           << " " << checker.what() << std::endl
@@ -283,7 +540,11 @@ class CheckerConfig {
     ClassChecker class_checker;
     class_checker.run(scope);
     if (class_checker.fail()) {
-      std::ostringstream oss = class_checker.print_failed_classes();
+      std::ostringstream oss;
+      if (!origin.empty()) {
+        oss << "[" << origin << "] ";
+      }
+      oss << class_checker.print_failed_classes().str();
       always_assert_log(!exit_on_fail, "%s", oss.str().c_str());
       return oss.str();
     }
@@ -316,6 +577,16 @@ class CheckerConfig {
   bool m_check_classes;
   bool m_relaxed_init_check;
   bool m_disabled;
+  size_t m_batch_passes{1};
+  std::vector<std::string> m_unchecked_passes;
+
+  struct VerifiedMethods {
+    // The structure hashes of the classes of the scope at the last run.
+    std::unordered_map<const DexType*, size_t> class_hashes;
+    // Methods that passed, with the key they passed with.
+    ConcurrentMap<const DexMethod*, size_t> hashes;
+  };
+  std::shared_ptr<VerifiedMethods> m_verified;
 };
 
 class CheckUniqueDeobfuscatedNames {
@@ -328,63 +599,118 @@ class CheckUniqueDeobfuscatedNames {
     m_after_each_pass = args.get("run_after_each_pass", false).asBool();
     m_initially = args.get("run_initially", false).asBool();
     m_finally = args.get("run_finally", false).asBool();
+    m_in_background = args.get("run_in_background", false).asBool();
   }
 
   void run_initially(const Scope& scope) {
     if (m_initially) {
-      check_unique_deobfuscated_names("<initial>", scope);
+      report(check_unique_deobfuscated_names("<initial>", collect(scope),
+                                             /* show_members */ true));
     }
   }
 
   void run_finally(const Scope& scope) {
+    wait();
     if (m_finally) {
-      check_unique_deobfuscated_names("<final>", scope);
+      report(check_unique_deobfuscated_names("<final>", collect(scope),
+                                             /* show_members */ true));
     }
   }
 
+  // With run_in_background, the names are checked on a snapshot while the
+  // next pass runs, and a failure is reported by the next call into this
+  // checker.
   void run_after_pass(const Pass* pass, const Scope& scope) {
-    if (m_after_each_pass) {
-      check_unique_deobfuscated_names(pass->name().c_str(), scope);
+    if (!m_after_each_pass) {
+      return;
+    }
+    wait();
+    auto names = collect(scope);
+    if (!m_in_background) {
+      report(check_unique_deobfuscated_names(pass->name(), names,
+                                             /* show_members */ true));
+      return;
+    }
+    // The members may be changed by the next pass, so the background check
+    // can only report their names.
+    m_pending = std::async(
+        std::launch::async,
+        [names = std::move(names), pass_name = pass->name()]() {
+          return check_unique_deobfuscated_names(pass_name, names,
+                                                 /* show_members */ false);
+        });
+  }
+
+  // Waits for the check running in the background, if any, and aborts if it
+  // failed. This must happen before forking.
+  void wait() {
+    if (m_pending.valid()) {
+      report(m_pending.get());
     }
   }
 
  private:
-  void check_unique_deobfuscated_names(const char* pass_name,
-                                       const Scope& scope) {
+  struct Names {
+    std::vector<std::pair<const DexString*, DexMethod*>> methods;
+    std::vector<std::pair<std::string, DexField*>> fields;
+  };
+
+  static Names collect(const Scope& scope) {
+    Names names;
+    walk::methods(scope, [&names](DexMethod* dex_method) {
+      names.methods.emplace_back(dex_method->get_deobfuscated_name_or_null(),
+                                 dex_method);
+    });
+    walk::fields(scope, [&names](DexField* dex_field) {
+      names.fields.emplace_back(dex_field->get_deobfuscated_name(), dex_field);
+    });
+    return names;
+  }
+
+  static void report(const boost::optional<std::string>& error) {
+    if (error) {
+      fprintf(stderr, "%s", error->c_str());
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  static boost::optional<std::string> check_unique_deobfuscated_names(
+      const std::string& pass_name, const Names& names, bool show_members) {
     TRACE(PM, 1, "Running check_unique_deobfuscated_names...");
     Timer t("check_unique_deobfuscated_names");
+    auto duplicate = [&](const char* kind, const std::string& name,
+                         const auto* member, const auto* other) {
+      std::ostringstream oss;
+      oss << "ABORT! [" << pass_name << "] Duplicate deobfuscated " << kind
+          << " name: " << name << "\n";
+      if (show_members) {
+        oss << "for " << show(member) << "\n vs " << show(other) << "\n";
+      }
+      return oss.str();
+    };
     std::unordered_map<const DexString*, DexMethod*> method_names;
-    walk::methods(scope, [&method_names, pass_name](DexMethod* dex_method) {
-      auto deob = dex_method->get_deobfuscated_name_or_null();
-      auto it = method_names.find(deob);
-      if (it != method_names.end()) {
-        fprintf(
-            stderr,
-            "ABORT! [%s] Duplicate deobfuscated method name: %s\nfor %s\n vs "
-            "%s\n",
-            pass_name, it->first->c_str(), SHOW(dex_method), SHOW(it->second));
-        exit(EXIT_FAILURE);
+    for (const auto& [deob, dex_method] : names.methods) {
+      auto [it, emplaced] = method_names.emplace(deob, dex_method);
+      if (!emplaced) {
+        return duplicate("method", deob ? deob->str_copy() : "<none>",
+                         dex_method,
+                         it->second);
       }
-      method_names.emplace(deob, dex_method);
-    });
-    std::unordered_map<std::string, DexField*> field_names;
-    walk::fields(scope, [&field_names, pass_name](DexField* dex_field) {
-      auto deob = dex_field->get_deobfuscated_name();
-      auto it = field_names.find(deob);
-      if (it != field_names.end()) {
-        fprintf(stderr,
-                "ABORT! [%s] Duplicate deobfuscated field name: %s\nfor %s\n "
-                "vs %s\n",
-                pass_name, it->first.c_str(), SHOW(dex_field),
-                SHOW(it->second));
-        exit(EXIT_FAILURE);
+    }
+    std::unordered_map<std::string_view, DexField*> field_names;
+    for (const auto& [deob, dex_field] : names.fields) {
+      auto [it, emplaced] = field_names.emplace(deob, dex_field);
+      if (!emplaced) {
+        return duplicate("field", deob, dex_field, it->second);
       }
-      field_names.emplace(deob, dex_field);
-    });
+    }
+    return boost::none;
   }
 
   bool m_initially{false};
   bool m_finally{false};
+  bool m_in_background{false};
+  std::future<boost::optional<std::string>> m_pending;
 };
 
 class VisualizerHelper {
@@ -533,6 +859,120 @@ void process_method_profiles(PassManager& mgr, ConfigFiles& conf) {
                  conf.get_method_profiles().unresolved_size());
 }
 
+void report_perf_counters(PassManager& mgr,
+                          const perf_counters::Counts& counts) {
+  for (size_t e = 0; e < perf_counters::NUM_EVENTS; ++e) {
+    if (counts[e]) {
+      mgr.set_metric(std::string("perf.") +
+                         perf_counters::event_name((perf_counters::Event)e),
+                     (int64_t)*counts[e]);
+    }
+  }
+  const auto& cycles = counts[perf_counters::CYCLES];
+  const auto& instructions = counts[perf_counters::INSTRUCTIONS];
+  if (cycles && instructions && *cycles != 0) {
+    mgr.set_metric("perf.ipc.100", (int64_t)(100 * *instructions / *cycles));
+  }
+}
+
+// Prints what each pass is predicted to cost on the given scope, and returns
+// the indexes of the passes that the fast config skips. Only passes that are
+// predicted to run for at least `min_time` seconds while removing fewer than
+// `min_benefit` instructions per second are skipped, and only if they
+// establish no properties that later passes or the output depend on.
+std::unordered_set<size_t> plan_passes(
+    const std::vector<PassManager::PassInfo>& pass_info,
+    const PassCostHistory& history,
+    const PassCostHistory::ScopeStats& scope_stats,
+    float min_benefit,
+    float min_time) {
+  std::unordered_set<size_t> skipped;
+  double total_wall_time = 0;
+  double skipped_wall_time = 0;
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(2);
+  out << "Predicted pass costs for " << scope_stats.classes << " classes, "
+      << scope_stats.methods << " methods and " << scope_stats.instructions
+      << " instructions, from " << history.num_runs() << " past runs:\n";
+  for (size_t i = 0; i < pass_info.size(); ++i) {
+    const auto& info = pass_info[i];
+    auto prediction = history.predict(info.name, scope_stats);
+    if (!prediction) {
+      out << "  " << info.name << ": unknown\n";
+      continue;
+    }
+    total_wall_time += prediction->wall_time;
+    bool establishes_properties = std::any_of(
+        info.property_interactions.begin(), info.property_interactions.end(),
+        [](const auto& p) { return p.second.establishes; });
+    bool skip = min_benefit > 0 && !info.pass->is_analysis_pass() &&
+                !establishes_properties && prediction->wall_time >= min_time &&
+                prediction->removed_instructions <
+                    min_benefit * prediction->wall_time;
+    if (skip) {
+      skipped.insert(i);
+      skipped_wall_time += prediction->wall_time;
+    }
+    out << "  " << info.name << ": " << prediction->wall_time << "s";
+    if (prediction->vm_hwm_delta) {
+      out << ", +" << pretty_bytes(*prediction->vm_hwm_delta) << " VmHWM";
+    }
+    out << ", " << (int64_t)prediction->removed_instructions
+        << " instructions removed (" << prediction->samples << " runs)"
+        << (skip ? ", skipped by the fast config" : "") << "\n";
+  }
+  out << "Predicted total: " << total_wall_time << "s";
+  if (!skipped.empty()) {
+    out << ", " << total_wall_time - skipped_wall_time
+        << "s with the fast config";
+  }
+  std::cerr << out.str() << std::endl;
+  return skipped;
+}
+
+// Runs a function on the redex thread pool, or on a thread of its own if
+// there is no pool. It is waited for on destruction at the latest.
+class BackgroundTask {
+ public:
+  explicit BackgroundTask(std::function<void()> f) {
+    auto* pool = redex_thread_pool::ThreadPool::get_instance();
+    if (pool == nullptr) {
+      m_future = std::async(std::launch::async, std::move(f));
+      return;
+    }
+    auto task = std::make_shared<std::packaged_task<void()>>(std::move(f));
+    m_future = task->get_future();
+    pool->run_async([task]() { (*task)(); });
+  }
+
+  BackgroundTask(const BackgroundTask&) = delete;
+  BackgroundTask& operator=(const BackgroundTask&) = delete;
+
+  ~BackgroundTask() {
+    if (m_future.valid()) {
+      m_future.wait();
+    }
+  }
+
+  // Rethrows what the function threw, if anything.
+  void wait() { m_future.get(); }
+
+ private:
+  std::future<void> m_future;
+};
+
+void collect_garbage(PassManager& mgr, ConfigFiles& conf) {
+  std::vector<const DexMethodRef*> roots;
+  conf.get_method_profiles().gather_methods(roots);
+  auto stats = g_redex->collect_garbage(roots);
+  mgr.set_metric("~gc.strings", stats.strings);
+  mgr.set_metric("~gc.string_storage_bytes", stats.string_storage_bytes);
+  mgr.set_metric("~gc.type_lists", stats.type_lists);
+  mgr.set_metric("~gc.protos", stats.protos);
+  mgr.set_metric("~gc.field_refs", stats.field_refs);
+  mgr.set_metric("~gc.method_refs", stats.method_refs);
+}
+
 void maybe_write_hashes_incoming(const ConfigFiles& conf, const Scope& scope) {
   if (conf.emit_incoming_hashes()) {
     TRACE(PM, 1, "Writing incoming hashes...");
@@ -652,6 +1092,8 @@ class AfterPassSizes {
     json.get("after_pass_size_queue", m_max_jobs, m_max_jobs);
   }
 
+  bool enabled() const { return m_enabled; }
+
   bool handle(PassManager::PassInfo* pass_info,
               DexStoresVector* stores,
               ConfigFiles* conf) {
@@ -1055,6 +1497,7 @@ struct JemallocStats {
   PassManager* pm;
   const ConfigFiles& c;
   bool full_stats{false};
+  bool purge{false};
 
   JemallocStats(PassManager* pm, const ConfigFiles& c) : pm(pm), c(c) {
     const auto* pmc =
@@ -1063,6 +1506,7 @@ struct JemallocStats {
     redex_assert(pmc != nullptr);
 
     full_stats = pmc->jemalloc_full_stats;
+    purge = pmc->jemalloc_purge_between_passes;
   }
 
   void process_jemalloc_stats_for_pass(const Pass* pass, size_t run) {
@@ -1080,25 +1524,88 @@ struct JemallocStats {
       std::ofstream ofs{filename};
       ofs << jemalloc_util::get_malloc_stats();
     }
+
+    // Stats are taken first, so that they still reflect the pass itself.
+    if (purge) {
+      jemalloc_util::purge_arenas();
+    }
 #endif
   }
 };
 
+// Reports per-pass hit/miss deltas of all tables of the persistent analysis
+// cache, and writes the cache back at the end.
+struct AnalysisCacheStats {
+  PassManager* pm;
+  analysis_cache::PersistentAnalysisCache* cache;
+  std::map<std::string, std::pair<size_t, size_t>> last;
+
+  AnalysisCacheStats(PassManager* pm, ConfigFiles& c)
+      : pm(pm), cache(c.get_analysis_cache()) {}
+
+  void process_for_pass() {
+    if (cache == nullptr) {
+      return;
+    }
+    cache->for_each_table([&](const std::string& name, size_t hits,
+                              size_t misses, size_t) {
+      auto& prev = last[name];
+      if (hits != prev.first || misses != prev.second) {
+        pm->set_metric("~analysis_cache." + name + ".hits", hits - prev.first);
+        pm->set_metric("~analysis_cache." + name + ".misses",
+                       misses - prev.second);
+      }
+      prev = {hits, misses};
+    });
+  }
+
+  void save() {
+    if (cache != nullptr) {
+      Timer t("Saving analysis cache");
+      cache->save();
+    }
+  }
+};
+
+// Reports per-pass how often threads had to wait for ConcurrentMap slot locks,
+// and the highest count seen on a single slot during the pass.
+struct ContentionStats {
+  PassManager* pm;
+  size_t last_contended_locks{0};
+
+  explicit ContentionStats(PassManager* pm)
+      : pm(pm), last_contended_locks(cc_impl::s_contended_locks.load()) {}
+
+  void process_for_pass() {
+    auto contended_locks = cc_impl::s_contended_locks.load();
+    auto max_slot = cc_impl::s_max_slot_contended_locks.exchange(0);
+    if (contended_locks != last_contended_locks) {
+      pm->set_metric("~concurrent_map.contended_locks",
+                     contended_locks - last_contended_locks);
+      pm->set_metric("~concurrent_map.max_slot_contended_locks", max_slot);
+    }
+    last_contended_locks = contended_locks;
+  }
+};
+
 struct ViolationsTracking {
   bool enabled{false};
+  size_t sample_every{1};
 
-  explicit ViolationsTracking(bool enabled) : enabled(enabled) {}
+  ViolationsTracking(bool enabled, size_t sample_every)
+      : enabled(enabled), sample_every(sample_every) {}
 
   struct Handler {
     PassManager* pm;
     std::unique_ptr<source_blocks::ViolationsHelper> vh;
-    Handler(PassManager* pm, DexStoresVector& stores)
+    Handler(PassManager* pm, DexStoresVector& stores, size_t sample_every)
         : pm(pm),
           vh(std::make_unique<source_blocks::ViolationsHelper>(
               source_blocks::ViolationsHelper::Violation::kChainAndDom,
               build_class_scope(stores),
               10,
-              std::vector<std::string>{})) {}
+              std::vector<std::string>{},
+              sample_every)) {}
     ~Handler() {
       if (vh != nullptr) {
         ScopedMetrics sm(*pm);
@@ -1125,7 +1632,7 @@ struct ViolationsTracking {
     if (!enabled) {
       return std::nullopt;
     }
-    return Handler(pm, stores);
+    return Handler(pm, stores, sample_every);
   }
 };
 
@@ -1137,6 +1644,14 @@ std::unique_ptr<keep_rules::ProguardConfiguration> empty_pg_config() {
 
 struct PassManager::InternalFields {
   std::mutex m_metrics_lock;
+  // The code hashes of the methods at the end of the last run of each pass
+  // that skips unchanged methods.
+  std::unordered_map<const Pass*,
+                     std::unique_ptr<ConcurrentMap<const DexMethod*, size_t>>>
+      m_method_code_hashes;
+  // The files that the results of preserved analyses were spilled to.
+  std::mutex m_spilled_analyses_lock;
+  std::unordered_map<Pass*, std::string> m_spilled_analyses;
 };
 
 PassManager::PassManager(const std::vector<Pass*>& passes)
@@ -1176,6 +1691,12 @@ PassManager::PassManager(
     fprintf(stderr, "Will run jemalloc profiler for %s\n",
             m_malloc_profile_pass->name().c_str());
   }
+  if (getenv("CPU_PROFILE_PASS")) {
+    m_cpu_profile_pass = find_pass(getenv("CPU_PROFILE_PASS"));
+    always_assert(m_cpu_profile_pass != nullptr);
+    fprintf(stderr, "Will run CPU profiler for %s\n",
+            m_cpu_profile_pass->name().c_str());
+  }
 }
 
 PassManager::~PassManager() {}
@@ -1248,7 +1769,7 @@ hashing::DexHash PassManager::run_hasher(const char* pass_name,
 }
 
 void PassManager::eval_passes(DexStoresVector& stores, ConfigFiles& conf) {
-  for (size_t i = 0; i < m_activated_passes.size(); ++i) {
+  for (size_t i = m_resume_pass_idx; i < m_activated_passes.size(); ++i) {
     Pass* pass = m_activated_passes[i];
     TRACE(PM, 1, "Evaluating %s...", pass->name().c_str());
     Timer t(pass->name() + " (eval)");
@@ -1286,6 +1807,7 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
       conf.get_global_config().get_config_by_name<PassManagerConfig>(
           "pass_manager");
   redex_assert(pm_config != nullptr);
+  IRCode::set_keep_editable_cfg(pm_config->keep_editable_cfg);
 
   auto profiler_info = ScopedCommandProfiling::maybe_info_from_env("");
   const Pass* profiler_info_pass = nullptr;
@@ -1327,6 +1849,22 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
 
   init_property_interactions(conf);
 
+  // Predict what the passes will cost from past runs, and record this run.
+  std::unique_ptr<PassCostHistory> cost_history;
+  PassCostHistory::ScopeStats initial_scope_stats;
+  std::vector<PassCostHistory::PassRecord> cost_records;
+  size_t instructions_before_pass = 0;
+  std::unordered_set<size_t> fast_config_skipped_passes;
+  if (!pm_config->cost_history.empty()) {
+    cost_history = std::make_unique<PassCostHistory>(pm_config->cost_history);
+    initial_scope_stats = PassCostHistory::compute_scope_stats(scope);
+    instructions_before_pass = initial_scope_stats.instructions;
+    fast_config_skipped_passes =
+        plan_passes(m_pass_info, *cost_history, initial_scope_stats,
+                    pm_config->fast_config_min_benefit,
+                    pm_config->fast_config_min_time);
+  }
+
   // Retrieve the hasher's settings.
   bool run_hasher_after_each_pass =
       is_run_hasher_after_each_pass(conf, get_redex_options());
@@ -1354,7 +1892,8 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
   VisualizerHelper graph_visualizer(conf);
   ViolationsTracking violatios_tracking(
       pm_config->violations_tracking ||
-      (assessor_config->run_after_each_pass && g_redex->instrument_mode));
+          (assessor_config->run_after_each_pass && g_redex->instrument_mode),
+      pm_config->violations_tracking_sample_every);
 
   sanitizers::lsan_do_recoverable_leak_check();
 
@@ -1450,7 +1989,8 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
         // output phase -- the register allocator can fix it up later.
         checker_conf.check_no_overwrite_this(false)
             .validate_access(false)
-            .run_verifier(scope);
+            .run_verifier(scope, /* exit_on_fail= */ true,
+                          "after " + checker_conf.take_unchecked_passes());
       }
       auto timer = m_check_unique_deobfuscateds_timer.scope();
       check_unique_deobfuscated.run_after_pass(pass, scope);
@@ -1472,9 +2012,146 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
       scope, m_redex_options.jni_summary_path);
 
   JemallocStats jemalloc_stats{this, conf};
+  AnalysisCacheStats analysis_cache_stats{this, conf};
+  ContentionStats contention_stats{this};
 
   std::unordered_map<const Pass*, size_t> runs;
 
+  // With fuse_method_local_passes, a sequence of adjacent method-local passes
+  // is started and executed together in the iteration of its first pass. The
+  // runs of the other passes are kept here, by pass index, and only finished
+  // in their own iterations, so that their metrics and timers are still
+  // attributed to them.
+  std::unordered_map<size_t, std::unique_ptr<MethodLocalPass::Run>>
+      pending_fused_runs;
+  std::unordered_map<size_t, size_t> fused_skipped_methods;
+  auto as_fusable = [&](size_t i) -> MethodLocalPass* {
+    Pass* pass = m_activated_passes[i];
+    if (!pm_config->fuse_method_local_passes || pass->is_cfg_legacy() ||
+        pass == profiler_info_pass || pass == m_malloc_profile_pass ||
+        pass == m_cpu_profile_pass || fast_config_skipped_passes.count(i)) {
+      return nullptr;
+    }
+    return dynamic_cast<MethodLocalPass*>(pass);
+  };
+  auto fused_group_end = [&](size_t i) {
+    size_t end = i;
+    while (end < m_activated_passes.size() && as_fusable(end) != nullptr &&
+           (end == i || std::find(pm_config->checkpoint_passes.begin(),
+                                  pm_config->checkpoint_passes.end(),
+                                  end) == pm_config->checkpoint_passes.end())) {
+      ++end;
+    }
+    return end;
+  };
+  auto run_fused_passes = [&](size_t begin, size_t end) {
+    TRACE(PM, 1, "Fusing %zu method-local passes", end - begin);
+    Timeline::Scope timeline_scope("fused method-local passes", "pass");
+    using CodeHashes = ConcurrentMap<const DexMethod*, size_t>;
+    std::vector<MethodLocalPass*> fused_passes;
+    std::vector<MethodLocalPass::Run*> fused_runs;
+    // The code each pass leaves behind is recorded within the walk, as the
+    // passes after it in the group may change it further.
+    std::vector<std::unique_ptr<CodeHashes>> code_hashes;
+    for (size_t k = begin; k < end; ++k) {
+      auto* current_pass_info = m_current_pass_info;
+      m_current_pass_info = &m_pass_info[k];
+      auto* pass = as_fusable(k);
+      auto run = pass->start_run(stores, conf, *this);
+      m_current_pass_info = current_pass_info;
+      fused_passes.push_back(pass);
+      fused_runs.push_back(run.get());
+      pending_fused_runs.emplace(k, std::move(run));
+      code_hashes.push_back(pm_config->skip_unchanged_methods &&
+                                    pass->skips_unchanged_methods()
+                                ? std::make_unique<CodeHashes>()
+                                : nullptr);
+    }
+    std::vector<std::atomic<size_t>> skipped_methods(fused_runs.size());
+    walk::parallel::code(
+        build_class_scope(stores), [&](DexMethod* method, IRCode& code) {
+          for (size_t k = 0; k < fused_runs.size(); ++k) {
+            if (k > 0) {
+              code.cfg().simplify();
+            }
+            if (fused_passes[k]->skips_unchanged_methods() &&
+                is_unchanged_since_last_run(fused_passes[k], method)) {
+              skipped_methods[k]++;
+            } else {
+              fused_runs[k]->run_on_method(method, code);
+            }
+            if (code_hashes[k] != nullptr) {
+              code.cfg().simplify();
+              code_hashes[k]->emplace(method, method_code_hash(method));
+            }
+          }
+        });
+    for (size_t k = 0; k < fused_runs.size(); ++k) {
+      if (code_hashes[k] != nullptr) {
+        m_internal_fields->m_method_code_hashes[fused_passes[k]] =
+            std::move(code_hashes[k]);
+      }
+      if (fused_passes[k]->skips_unchanged_methods()) {
+        fused_skipped_methods.emplace(begin + k, skipped_methods[k].load());
+      }
+    }
+  };
+
+  // With a memory budget, preserved analyses that the next pass does not
+  // require are spilled to disk when the RSS plus the budget of the next pass
+  // would exceed it, and reloaded when they are asked for again.
+  auto pass_memory_budget = [&](const Pass* pass) -> uint64_t {
+    const auto& budgets = pm_config->pass_memory_budgets_mb;
+    if (!budgets.isObject() || !budgets.isMember(pass->name())) {
+      return 0;
+    }
+    return budgets[pass->name()].asUInt64() << 20;
+  };
+  auto spill_analyses_over_budget = [&](const Pass* pass) {
+    uint64_t budget = uint64_t(pm_config->memory_budget_mb) << 20;
+    if (budget == 0) {
+      return;
+    }
+    uint64_t rss = get_mem_stats().vm_rss;
+    if (rss + pass_memory_budget(pass) <= budget) {
+      return;
+    }
+    AnalysisUsage analysis_usage;
+    pass->set_analysis_usage(analysis_usage);
+    const auto& required = analysis_usage.get_required_passes();
+    auto& spilled = m_internal_fields->m_spilled_analyses;
+    std::lock_guard<std::mutex> lock(
+        m_internal_fields->m_spilled_analyses_lock);
+    for (const auto& [id, analysis_pass] : m_preserved_analysis_passes) {
+      if (required.count(id) || spilled.count(analysis_pass)) {
+        continue;
+      }
+      auto path = conf.metafile("spilled." + analysis_pass->name() + ".bin");
+      Timer t("Spilling " + analysis_pass->name());
+      if (analysis_pass->spill_analysis_result(path)) {
+        TRACE(PM, 1, "Spilled %s before %s, at an RSS of %s",
+              analysis_pass->name().c_str(), pass->name().c_str(),
+              pretty_bytes(rss).c_str());
+        spilled.emplace(analysis_pass, path);
+      }
+    }
+  };
+  // Spills of analyses that are no longer preserved are not needed anymore.
+  auto drop_stale_spills = [&]() {
+    auto& spilled = m_internal_fields->m_spilled_analyses;
+    std::lock_guard<std::mutex> lock(
+        m_internal_fields->m_spilled_analyses_lock);
+    for (auto it = spilled.begin(); it != spilled.end();) {
+      auto id = get_analysis_id_by_pass(it->first);
+      if (m_preserved_analysis_passes.count(id) == 0) {
+        boost::filesystem::remove(it->second);
+        it = spilled.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  };
+
   /////////////////////
   // MAIN PASS LOOP. //
   /////////////////////
@@ -1483,15 +2160,36 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
   for (size_t i = 0; i < m_activated_passes.size(); ++i) {
     Pass* pass = m_activated_passes[i];
     const size_t pass_run = ++runs[pass];
-    AnalysisUsageHelper analysis_usage_helper{m_preserved_analysis_passes};
-    analysis_usage_helper.pre_pass(pass);
-
     if (!after_interdex && pass->name() == "InterDexPass") {
       after_interdex = true;
     }
 
+    if (i < m_resume_pass_idx) {
+      TRACE(PM, 1, "Skipping %s, resuming from a checkpoint",
+            pass->name().c_str());
+      continue;
+    }
+    if (m_checkpoint_writer && i != m_resume_pass_idx &&
+        std::find(pm_config->checkpoint_passes.begin(),
+                  pm_config->checkpoint_passes.end(),
+                  i) != pm_config->checkpoint_passes.end()) {
+      Timer t("Checkpoint before " + pass->name());
+      m_checkpoint_writer(stores, conf, *this, i);
+    }
+    if (fast_config_skipped_passes.count(i)) {
+      TRACE(PM, 1, "Skipping %s, by the fast config", pass->name().c_str());
+      m_pass_info[i].metrics["skipped_by_fast_config"] = 1;
+      continue;
+    }
+
+    AnalysisUsageHelper analysis_usage_helper{m_preserved_analysis_passes};
+    analysis_usage_helper.pre_pass(pass);
+    spill_analyses_over_budget(pass);
+
     TRACE(PM, 1, "Running %s...", pass->name().c_str());
     ScopedMemStats scoped_mem_stats{mem_pass_stats, hwm_per_pass};
+    perf_counters::ScopedCounters scoped_perf_counters{
+        pm_config->perf_counters};
     Timer t(pass->name() + " " + std::to_string(pass_run) + " (run)");
     m_current_pass_info = &m_pass_info[i];
 
@@ -1508,6 +2206,11 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
       auto scoped_command_all_prof = ScopedCommandProfiling::maybe_from_info(
           profiler_all_info, &pass->name());
       jemalloc_util::ScopedProfiling malloc_prof(m_malloc_profile_pass == pass);
+      cpu_profiling::ScopedProfiling cpu_prof(
+          m_cpu_profile_pass == pass,
+          conf.metafile("redex-cpu-profile." + pass->name() + "." +
+                        std::to_string(pass_run)),
+          cpu_profiling::options_from_env());
       auto maybe_track_violations =
           violatios_tracking.maybe_track(this, stores);
       double cpu_time_start = ((double)std::clock()) / CLOCKS_PER_SEC;
@@ -1528,8 +2231,32 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
         ensure_editable_cfg(stores);
         TRACE(PM, 2, "%s Pass uses editable cfg.\n", SHOW(pass->name()));
       }
-      pass->run_pass(stores, conf, *this);
+      auto kept_editable_cfgs_start = IRCode::get_kept_editable_cfgs();
+      if (pending_fused_runs.count(i) == 0 && as_fusable(i) != nullptr) {
+        auto end = fused_group_end(i);
+        if (end > i + 1) {
+          run_fused_passes(i, end);
+        }
+      }
+      auto fused_run = pending_fused_runs.find(i);
+      bool was_fused = fused_run != pending_fused_runs.end();
+      if (was_fused) {
+        auto skipped = fused_skipped_methods.find(i);
+        if (skipped != fused_skipped_methods.end()) {
+          set_metric("skipped_unchanged_methods", skipped->second);
+          fused_skipped_methods.erase(skipped);
+        }
+        fused_run->second->finish(*this);
+        pending_fused_runs.erase(fused_run);
+      } else {
+        pass->run_pass(stores, conf, *this);
+      }
       auto wall_time_end = std::chrono::steady_clock::now();
+      if (IRCode::keep_editable_cfg()) {
+        set_metric("kept_editable_cfgs",
+                   IRCode::get_kept_editable_cfgs() -
+                       kept_editable_cfgs_start);
+      }
       double cpu_time_end = ((double)std::clock()) / CLOCKS_PER_SEC;
 
       // Collect dex info metrics after InterDexPass.
@@ -1572,15 +2299,31 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
       }
       // Ensure the CFG is clean, e.g., no unreachable blocks.
       if (!pass->is_cfg_legacy()) {
+        Timeline::Scope timeline_scope(pass->name() + " (cfg cleanup)",
+                                       "pass");
+        // Also remember the code the pass leaves behind, for its next run.
+        ConcurrentMap<const DexMethod*, size_t>* code_hashes = nullptr;
+        if (pm_config->skip_unchanged_methods &&
+            pass->skips_unchanged_methods() && !was_fused) {
+          auto& hashes = m_internal_fields->m_method_code_hashes[pass];
+          hashes = std::make_unique<ConcurrentMap<const DexMethod*, size_t>>();
+          code_hashes = hashes.get();
+        }
         auto temp_scope = build_class_scope(stores);
         walk::parallel::code(temp_scope, [&](DexMethod* method, IRCode& code) {
           always_assert_log(code.editable_cfg_built(),
                             "%s has no editable cfg after cfg-friendly pass %s",
                             SHOW(method), pass->name().c_str());
           code.cfg().simplify();
+          if (code_hashes != nullptr) {
+            code_hashes->emplace(method, method_code_hash(method));
+          }
         });
       }
 
+      if (pm_config->collect_garbage_after_passes.count(pass->name())) {
+        collect_garbage(*this, conf);
+      }
       g_redex->compact();
 
       trace_cls.dump(pass->name(), stores);
@@ -1589,20 +2332,67 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
       wall_time = wall_time_end - wall_time_start;
     }
 
+    // The code of the scope does not change until the next pass, so an
+    // analysis pass that comes next can already compute its result while
+    // this pass is being checked.
+    std::optional<BackgroundTask> analysis_prefetch;
+    Pass* next_pass =
+        i + 1 < m_activated_passes.size() ? m_activated_passes[i + 1] : nullptr;
+    if (pm_config->prefetch_analyses && next_pass != nullptr &&
+        next_pass->is_analysis_pass()) {
+      auto prefetch = next_pass->prefetch_analysis(stores);
+      if (prefetch) {
+        TRACE(PM, 1, "Prefetching %s", next_pass->name().c_str());
+        analysis_prefetch.emplace(
+            [prefetch = std::move(prefetch), name = next_pass->name()]() {
+              Timeline::Scope timeline_scope(name + " (prefetch)", "pass");
+              prefetch();
+            });
+      }
+    }
+
     scoped_mem_stats.trace_log(this, pass);
+    if (auto budget = pass_memory_budget(pass)) {
+      const auto& metrics = m_current_pass_info->metrics;
+      auto hwm_delta = metrics.find("vm_hwm_delta");
+      if (hwm_delta != metrics.end() && (uint64_t)hwm_delta->second > budget) {
+        set_metric("over_memory_budget_mb",
+                   ((uint64_t)hwm_delta->second - budget) >> 20);
+        std::cerr << "warning: " << pass->name() << " grew VmHWM by "
+                  << pretty_bytes(hwm_delta->second) << ", over its budget of "
+                  << pretty_bytes(budget) << std::endl;
+      }
+    }
+    if (pm_config->perf_counters) {
+      report_perf_counters(*this, scoped_perf_counters.read());
+    }
 
     jemalloc_stats.process_jemalloc_stats_for_pass(pass, pass_run);
+    analysis_cache_stats.process_for_pass();
+    contention_stats.process_for_pass();
 
     sanitizers::lsan_do_recoverable_leak_check();
 
     graph_visualizer.add_pass(pass, i);
 
-    post_pass_verifiers(pass, i, m_activated_passes.size());
+    {
+      Timeline::Scope timeline_scope(pass->name() + " (checks)", "pass");
+      post_pass_verifiers(pass, i, m_activated_passes.size());
+    }
 
     analysis_usage_helper.post_pass(pass);
+    drop_stale_spills();
 
     process_method_profiles(*this, conf);
 
+    if (analysis_prefetch) {
+      Timer prefetch_timer("Waiting for the prefetch of " + next_pass->name());
+      analysis_prefetch->wait();
+    }
+
+    if (after_pass_size.enabled()) {
+      check_unique_deobfuscated.wait();
+    }
     handled_child = after_pass_size.handle(m_current_pass_info, &stores, &conf);
     if (handled_child) {
       // Measuring child. Return to write things out.
@@ -1619,20 +2409,58 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
                            redex_parallel::default_num_threads()));
     }
 
+    if (cost_history) {
+      PassCostHistory::PassRecord record;
+      record.name = m_current_pass_info->name;
+      record.wall_time = wall_time.count();
+      auto& metrics = m_current_pass_info->metrics;
+      auto hwm_delta = metrics.find("vm_hwm_delta");
+      if (hwm_delta != metrics.end()) {
+        record.vm_hwm_delta = hwm_delta->second;
+      }
+      auto instructions =
+          PassCostHistory::compute_scope_stats(build_class_scope(stores))
+              .instructions;
+      record.removed_instructions =
+          (int64_t)instructions_before_pass - (int64_t)instructions;
+      instructions_before_pass = instructions;
+      cost_records.push_back(std::move(record));
+    }
+
     m_current_pass_info = nullptr;
   }
 
+  {
+    std::lock_guard<std::mutex> lock(
+        m_internal_fields->m_spilled_analyses_lock);
+    for (const auto& [_, path] : m_internal_fields->m_spilled_analyses) {
+      boost::filesystem::remove(path);
+    }
+    m_internal_fields->m_spilled_analyses.clear();
+  }
+
+  if (cost_history && !handled_child) {
+    cost_history->record(initial_scope_stats, cost_records);
+  }
+
   after_pass_size.wait();
 
+  analysis_cache_stats.save();
+
   // Always clear cfg and run the type checker before generating the optimized
   // dex code.
+  IRCode::set_keep_editable_cfg(false);
   scope = build_class_scope(it);
   walk::parallel::code(scope,
                        [&](DexMethod*, IRCode& code) { code.clear_cfg(); });
   TRACE(PM, 1, "All opt passes are done, clear cfg\n");
+  auto unchecked_passes = checker_conf.take_unchecked_passes();
   checker_conf.check_no_overwrite_this(get_redex_options().no_overwrite_this())
       .validate_access(true)
-      .run_verifier(scope);
+      .run_verifier(scope, /* exit_on_fail= */ true,
+                    unchecked_passes.empty()
+                        ? "final"
+                        : "final, after " + unchecked_passes);
 
   jni_native_context_helper.post_passes(scope, conf);
 
@@ -1745,6 +2573,30 @@ PassManager::ActivatedPasses PassManager::compute_activated_passes(
   return result;
 }
 
+bool PassManager::is_unchanged_since_last_run(const Pass* pass,
+                                              const DexMethod* method) const {
+  const auto& all_hashes = m_internal_fields->m_method_code_hashes;
+  auto it = all_hashes.find(pass);
+  if (it == all_hashes.end()) {
+    return false;
+  }
+  auto hash = it->second->get(method, 0);
+  return hash != 0 && hash == method_code_hash(method);
+}
+
+void PassManager::reload_if_spilled(Pass* analysis_pass) const {
+  std::lock_guard<std::mutex> lock(m_internal_fields->m_spilled_analyses_lock);
+  auto& spilled = m_internal_fields->m_spilled_analyses;
+  auto it = spilled.find(analysis_pass);
+  if (it == spilled.end()) {
+    return;
+  }
+  Timer t("Reloading " + analysis_pass->name());
+  analysis_pass->reload_analysis_result(it->second);
+  boost::filesystem::remove(it->second);
+  spilled.erase(it);
+}
+
 Pass* PassManager::find_pass(const std::string& pass_name) const {
   auto pass_it = std::find_if(
       m_activated_passes.begin(),
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <boost/optional.hpp>
+#include <functional>
 #include <list>
 #include <memory>
 #include <string>
@@ -133,6 +134,7 @@ class PassManager {
     auto pass =
         m_preserved_analysis_passes.find(get_analysis_id_by_pass<PassType>());
     if (pass != m_preserved_analysis_passes.end()) {
+      reload_if_spilled(pass->second);
       return static_cast<PassType*>(pass->second);
     }
     return nullptr;
@@ -159,9 +161,29 @@ class PassManager {
 
   ReserveRefsInfo get_reserved_refs() const;
 
+  // Whether `method` has the same code as at the end of the previous run of
+  // `pass`. Only tracked for passes that skip unchanged methods, and with the
+  // skip_unchanged_methods option. Can be called concurrently.
+  bool is_unchanged_since_last_run(const Pass* pass,
+                                   const DexMethod* method) const;
+
   // FOR TESTING ONLY!
   void disable_checker() { m_checker_disabled = true; }
 
+  // Writes a checkpoint of the state before the pass with the given index.
+  using CheckpointWriter = std::function<void(
+      DexStoresVector&, ConfigFiles&, const PassManager&, size_t)>;
+
+  // The writer is called before every pass listed in the checkpoint_passes
+  // option of the pass manager config.
+  void set_checkpoint_writer(CheckpointWriter writer) {
+    m_checkpoint_writer = std::move(writer);
+  }
+
+  // Resumes from a checkpoint written before the pass with the given index,
+  // i.e. neither evaluates nor runs the passes before it.
+  void set_resume_pass_index(size_t pass_idx) { m_resume_pass_idx = pass_idx; }
+
  private:
   void init(const ConfigFiles& config);
 
@@ -193,6 +215,7 @@ class PassManager {
   bool m_unreliable_virtual_scopes{false};
   ReserveRefsInfoList m_reserved_ref_infos;
   Pass* m_malloc_profile_pass{nullptr};
+  Pass* m_cpu_profile_pass{nullptr};
 
   boost::optional<hashing::DexHash> m_initial_hash;
 
@@ -202,7 +225,14 @@ class PassManager {
   struct InternalFields;
   std::unique_ptr<InternalFields> m_internal_fields;
 
+  // Brings back the result of a preserved analysis that was spilled to disk
+  // to stay within the memory budget.
+  void reload_if_spilled(Pass* analysis_pass) const;
+
   redex_properties::Manager* m_properties_manager{nullptr};
 
   bool m_checker_disabled{false};
+
+  CheckpointWriter m_checkpoint_writer;
+  size_t m_resume_pass_idx{0};
 };
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "PersistentAnalysisCache.h"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <boost/functional/hash.hpp>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+#include "BinarySerialization.h"
+#include "Debug.h"
+#include "DexHasher.h"
+#include "Trace.h"
+
+namespace analysis_cache {
+
+namespace {
+
+constexpr uint32_t MAGIC = 0xfaceb000;
+
+template <typename T>
+bool read(std::istream& is, T* value) {
+  is.read((char*)value, sizeof(T));
+  return is.good();
+}
+
+} // namespace
+
+std::optional<std::string> Table::get(uint64_t key) {
+  auto* entry = m_entries.get(key);
+  if (entry == nullptr) {
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+  }
+  entry->used.store(true, std::memory_order_relaxed);
+  m_hits.fetch_add(1, std::memory_order_relaxed);
+  return entry->value;
+}
+
+void Table::put(uint64_t key, std::string value) {
+  m_entries.emplace(key, Entry(std::move(value), /* used */ true));
+}
+
+void Table::load(std::istream& is) {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t count;
+  if (!read(is, &magic) || magic != MAGIC || !read(is, &version) ||
+      version != m_version || !read(is, &count)) {
+    TRACE(PM, 1, "[analysis-cache] ignoring stale or corrupt table %s",
+          m_name.c_str());
+    return;
+  }
+  std::string value;
+  for (uint64_t i = 0; i < count; ++i) {
+    uint64_t key;
+    uint32_t size;
+    if (!read(is, &key) || !read(is, &size)) {
+      TRACE(PM, 1, "[analysis-cache] truncated table %s", m_name.c_str());
+      return;
+    }
+    value.resize(size);
+    is.read(value.data(), size);
+    if (!is.good()) {
+      TRACE(PM, 1, "[analysis-cache] truncated table %s", m_name.c_str());
+      return;
+    }
+    m_entries.emplace(key, Entry(value, /* used */ false));
+  }
+}
+
+void Table::save(std::ostream& os) const {
+  // Sort by key for deterministic output.
+  std::vector<std::pair<uint64_t, const std::string*>> entries;
+  for (auto& [key, entry] : m_entries) {
+    if (entry.used.load(std::memory_order_relaxed)) {
+      entries.emplace_back(key, &entry.value);
+    }
+  }
+  std::sort(entries.begin(), entries.end());
+  binary_serialization::write_header(os, m_version);
+  binary_serialization::write<uint64_t>(os, entries.size());
+  for (auto& [key, value] : entries) {
+    always_assert(value->size() <= std::numeric_limits<uint32_t>::max());
+    binary_serialization::write<uint64_t>(os, key);
+    binary_serialization::write<uint32_t>(os, value->size());
+    os.write(value->data(), value->size());
+  }
+}
+
+PersistentAnalysisCache::PersistentAnalysisCache(std::string directory)
+    : m_directory(std::move(directory)) {
+  if (is_in_memory()) {
+    return;
+  }
+  if (!boost::filesystem::exists(m_directory)) {
+    boost::filesystem::create_directories(m_directory);
+  }
+  always_assert_log(boost::filesystem::is_directory(m_directory),
+                    "Analysis cache location %s is not a directory",
+                    m_directory.c_str());
+}
+
+std::string PersistentAnalysisCache::get_table_path(
+    const std::string& name) const {
+  return (boost::filesystem::path(m_directory) / (name + ".bin")).string();
+}
+
+Table& PersistentAnalysisCache::get_table(const std::string& name,
+                                          uint32_t version) {
+  std::lock_guard<std::mutex> lock(m_tables_mutex);
+  auto it = m_tables.find(name);
+  if (it != m_tables.end()) {
+    always_assert_log(it->second->version() == version,
+                      "Analysis cache table %s requested with versions %u "
+                      "and %u",
+                      name.c_str(), it->second->version(), version);
+    return *it->second;
+  }
+  auto table = std::make_unique<Table>(name, version);
+  if (!is_in_memory()) {
+    std::ifstream is(get_table_path(name), std::ios::binary);
+    if (is) {
+      table->load(is);
+    }
+  }
+  TRACE(PM, 2, "[analysis-cache] loaded %zu entries for table %s",
+        table->size(), name.c_str());
+  return *m_tables.emplace(name, std::move(table)).first->second;
+}
+
+void PersistentAnalysisCache::save() const {
+  if (is_in_memory()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(m_tables_mutex);
+  for (auto& [name, table] : m_tables) {
+    // Write to a temporary file first, so that concurrent or interrupted runs
+    // never observe a partially written table.
+    auto path = get_table_path(name);
+    auto tmp_path = path + ".tmp";
+    {
+      std::ofstream os(tmp_path, std::ios::binary | std::ios::trunc);
+      always_assert_log(os, "Cannot write analysis cache table %s",
+                        tmp_path.c_str());
+      table->save(os);
+    }
+    boost::filesystem::rename(tmp_path, path);
+    TRACE(PM, 2, "[analysis-cache] table %s: %zu hits, %zu misses",
+          name.c_str(), table->hits(), table->misses());
+  }
+}
+
+uint64_t get_method_key(const DexMethod* method, uint64_t salt) {
+  auto hash = hashing::DexMethodHasher(method).run();
+  size_t key = salt;
+  boost::hash_combine(key, hash.signature_hash);
+  boost::hash_combine(key, hash.code_hash);
+  boost::hash_combine(key, hash.registers_hash);
+  return key;
+}
+
+} // namespace analysis_cache
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "ConcurrentContainers.h"
+
+class DexMethod;
+
+/*
+ * A content-addressed, on-disk cache for the results of pure per-method
+ * analyses. Results are keyed by a hash of whatever the analysis depends on
+ * (typically the method hash computed by hashing::DexMethodHasher, combined
+ * with any configuration that influences the result), so a cached value can
+ * be reused by a later Redex run as long as the inputs didn't change.
+ *
+ * The cache is organized in named tables, each of which is stored in its own
+ * file in the cache directory. A table carries a version; bump it whenever the
+ * encoding or the semantics of the cached values change, and the stale file
+ * will be ignored.
+ *
+ * Only entries that were looked up or inserted during the current run are
+ * written back, so the cache doesn't grow without bound as code evolves.
+ *
+ * A cache without a directory is only kept in memory, for results that are
+ * worth reusing within a single run.
+ */
+namespace analysis_cache {
+
+class Table {
+ public:
+  Table(std::string name, uint32_t version)
+      : m_name(std::move(name)), m_version(version) {}
+
+  const std::string& name() const { return m_name; }
+  uint32_t version() const { return m_version; }
+
+  // Returns the cached value, or none when the key is unknown. Thread-safe.
+  std::optional<std::string> get(uint64_t key);
+
+  // Records a value. If the key is already present, the existing value wins.
+  // Thread-safe.
+  void put(uint64_t key, std::string value);
+
+  size_t hits() const { return m_hits.load(); }
+  size_t misses() const { return m_misses.load(); }
+  size_t size() const { return m_entries.size(); }
+
+  void load(std::istream& is);
+  void save(std::ostream& os) const;
+
+ private:
+  struct Entry {
+    std::string value;
+    mutable std::atomic<bool> used{false};
+    Entry(std::string v, bool u) : value(std::move(v)), used(u) {}
+    Entry(Entry&& other) noexcept
+        : value(std::move(other.value)), used(other.used.load()) {}
+  };
+
+  std::string m_name;
+  uint32_t m_version;
+  InsertOnlyConcurrentMap<uint64_t, Entry> m_entries;
+  std::atomic<size_t> m_hits{0};
+  std::atomic<size_t> m_misses{0};
+};
+
+class PersistentAnalysisCache {
+ public:
+  // An empty directory gives an in-memory cache.
+  explicit PersistentAnalysisCache(std::string directory);
+
+  // Returns the table with the given name, loading it from disk on first
+  // access. Thread-safe.
+  Table& get_table(const std::string& name, uint32_t version);
+
+  // Writes all tables back to the cache directory. Does nothing for an
+  // in-memory cache.
+  void save() const;
+
+  bool is_in_memory() const { return m_directory.empty(); }
+
+  const std::string& directory() const { return m_directory; }
+
+  // Calls f(table_name, hits, misses, size) for each table, in name order.
+  template <typename F>
+  void for_each_table(const F& f) const {
+    std::lock_guard<std::mutex> lock(m_tables_mutex);
+    for (auto& [name, table] : m_tables) {
+      f(name, table->hits(), table->misses(), table->size());
+    }
+  }
+
+ private:
+  std::string get_table_path(const std::string& name) const;
+
+  std::string m_directory;
+  mutable std::mutex m_tables_mutex;
+  std::map<std::string, std::unique_ptr<Table>> m_tables;
+};
+
+// Combines the method hash (see hashing::DexMethodHasher) with a salt that
+// captures any other inputs of the cached analysis.
+uint64_t get_method_key(const DexMethod* method, uint64_t salt);
+
+} // namespace analysis_cache
@@ -9,16 +9,29 @@
 
 #include "ConcurrentContainers.h"
 #include "PriorityThreadPool.h"
+#include <algorithm>
 #include <cinttypes>
+#include <limits>
 #include <unordered_set>
 
+/*
+ * Runs tasks on a PriorityThreadPool such that every task runs after all of
+ * its dependencies are done. A task's priority is the length of the longest
+ * chain of tasks that (transitively) wait for it, so that the critical path
+ * starts first. By default, every task counts as one towards that length;
+ * with a weight function, the length of a chain is the sum of its weights,
+ * which lets long chains of expensive tasks start before short chains of
+ * cheap ones.
+ */
 template <class Task>
 class PriorityThreadPoolDAGScheduler {
   using Executor = std::function<void(Task)>;
+  using WeightFn = std::function<uint32_t(Task)>;
 
  private:
   PriorityThreadPool m_priority_thread_pool;
   Executor m_executor;
+  WeightFn m_weight_fn;
   std::unordered_map<Task, std::unordered_set<Task>> m_waiting_for;
   std::unordered_map<Task, std::atomic<uint32_t>> m_wait_counts;
   std::unique_ptr<std::unordered_map<Task, int>> m_priorities;
@@ -39,6 +52,13 @@ class PriorityThreadPoolDAGScheduler {
         priority = std::max(priority, compute_priority(other_task) + 1);
       }
     }
+    if (m_weight_fn) {
+      // The task itself already counted as one above.
+      auto weight = m_weight_fn(task);
+      always_assert(weight > 0);
+      priority = (int)std::min<int64_t>((int64_t)priority + weight - 1,
+                                        std::numeric_limits<int>::max() / 2);
+    }
     m_max_priority = std::max(m_max_priority, priority);
     return priority;
   }
@@ -103,6 +123,13 @@ class PriorityThreadPoolDAGScheduler {
 
   void set_executor(Executor executor) { m_executor = std::move(executor); }
 
+  // Sets the weight of each task for the computation of priorities; weights
+  // must be positive. Must be called before `run`.
+  void set_weight_fn(WeightFn weight_fn) {
+    always_assert(!m_priorities);
+    m_weight_fn = std::move(weight_fn);
+  }
+
   PriorityThreadPool& get_thread_pool() { return m_priority_thread_pool; }
 
   // The dependency must be scheduled before the task
@@ -135,7 +162,9 @@ class PriorityThreadPoolDAGScheduler {
   uint32_t run(const ForwardIt& begin, const ForwardIt& end) {
     always_assert(!m_concurrent_continuations);
     m_priorities = std::make_unique<std::unordered_map<Task, int>>();
-    std::vector<std::vector<Task>> ready_tasks;
+    // Weighted priorities can be large and sparse, so we sort the ready tasks
+    // instead of bucketing them.
+    std::vector<std::pair<int, Task>> ready_tasks;
     for (auto it = begin; it != end; it++) {
       int priority = compute_priority(*it);
       auto& wait_count = m_wait_counts.emplace(*it, 0).first->second;
@@ -143,17 +172,15 @@ class PriorityThreadPoolDAGScheduler {
         continue;
       }
       always_assert(priority >= 0);
-      if ((uint32_t)priority >= ready_tasks.size()) {
-        ready_tasks.resize(priority * 2 + 1);
-      }
-      ready_tasks[priority].push_back(*it);
+      ready_tasks.emplace_back(priority, *it);
     }
+    std::stable_sort(
+        ready_tasks.begin(), ready_tasks.end(),
+        [](const auto& a, const auto& b) { return a.first > b.first; });
     m_concurrent_continuations =
         std::make_unique<ConcurrentMap<Task, Continuations>>();
-    for (size_t i = ready_tasks.size(); i > 0; --i) {
-      for (auto task : ready_tasks[i - 1]) {
-        schedule(task);
-      }
+    for (auto& [_, task] : ready_tasks) {
+      schedule(task);
     }
     m_priority_thread_pool.join();
     always_assert(m_concurrent_continuations->empty());
@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <boost/functional/hash.hpp>
+#include <unordered_map>
 
 #include "StlUtil.h"
 
@@ -241,4 +242,17 @@ void KeepSpecSet::erase_if(const std::function<bool(const KeepSpec&)>& pred) {
       m_ordered.end());
 }
 
+void KeepSpecSet::merge(KeepSpecSet&& other) {
+  std::unordered_map<const KeepSpec*, std::unique_ptr<KeepSpec>> specs;
+  while (!other.m_unordered_set.empty()) {
+    auto node = other.m_unordered_set.extract(other.m_unordered_set.begin());
+    auto* spec = node.value().get();
+    specs.emplace(spec, std::move(node.value()));
+  }
+  for (const auto* spec : other.m_ordered) {
+    emplace(std::move(specs.at(spec)));
+  }
+  other.m_ordered.clear();
+}
+
 } // namespace keep_rules
@@ -152,6 +152,9 @@ class KeepSpecSet {
 
   void erase_if(const std::function<bool(const KeepSpec&)>&);
 
+  // Emplaces the specs of the other set in its order, leaving it empty.
+  void merge(KeepSpecSet&& other);
+
   template <typename Pred>
   iterator stable_partition(Pred p);
 
@@ -7,11 +7,15 @@
 
 #include "ProguardMap.h"
 
-#include <fstream>
+#include <boost/filesystem.hpp>
+#include <iterator>
+#include <optional>
+#include <sstream>
 
 #include "DexPosition.h"
 #include "DexUtil.h"
 #include "IRCode.h"
+#include "RedexMappedFile.h"
 #include "Show.h"
 #include "Timer.h"
 #include "Trace.h"
@@ -214,6 +218,56 @@ bool is_maybe_proguard_generated_member(const std::string& s) {
   }
   return false;
 }
+
+// Number of lines parsed by one task when parsing a map in parallel.
+constexpr size_t LINES_PER_CHUNK = 16384;
+
+/*
+ * Splits `contents` into lines like std::getline would, without copying them.
+ */
+std::vector<std::string_view> split_lines(std::string_view contents) {
+  std::vector<std::string_view> lines;
+  size_t start = 0;
+  while (start < contents.size()) {
+    auto end = contents.find('\n', start);
+    if (end == std::string_view::npos) {
+      end = contents.size();
+    }
+    lines.push_back(contents.substr(start, end - start));
+    start = end + 1;
+  }
+  return lines;
+}
+
+std::vector<size_t> uniform_chunk_starts(size_t num_lines) {
+  std::vector<size_t> starts;
+  for (size_t start = 0; start < num_lines; start += LINES_PER_CHUNK) {
+    starts.push_back(start);
+  }
+  return starts;
+}
+
+/*
+ * Runs `parse(begin, end)` in parallel over the line ranges that begin at
+ * `starts`, and returns the per-chunk results in file order, so that merging
+ * them gives the same maps as a sequential parse.
+ */
+template <typename Result, typename Fn>
+std::vector<Result> parse_chunks(const std::vector<size_t>& starts,
+                                 size_t num_lines,
+                                 const Fn& parse) {
+  std::vector<Result> results(starts.size());
+  workqueue_run_for<size_t>(0, starts.size(), [&](size_t i) {
+    auto end = i + 1 < starts.size() ? starts[i + 1] : num_lines;
+    results[i] = parse(starts[i], end);
+  });
+  return results;
+}
+
+std::string read_stream(std::istream& fp) {
+  return std::string(std::istreambuf_iterator<char>(fp),
+                     std::istreambuf_iterator<char>());
+}
 } // namespace
 
 ProguardMap::ProguardMap(const std::string& filename, bool use_new_rename_map) {
@@ -221,13 +275,19 @@ ProguardMap::ProguardMap(const std::string& filename, bool use_new_rename_map) {
     return;
   }
   Timer t("Parsing proguard map");
-  std::ifstream fp(filename);
-  always_assert_log(fp, "Can't open proguard map: %s\n", filename.c_str());
+  boost::system::error_code ec;
+  auto size = boost::filesystem::file_size(filename, ec);
+  always_assert_log(!ec, "Can't open proguard map: %s\n", filename.c_str());
+  if (size == 0) {
+    return;
+  }
+  auto file = RedexMappedFile::open(filename);
+  std::string_view contents(file.const_data(), file.size());
 
   if (use_new_rename_map) {
-    parse_full_map(fp);
+    parse_full_map(contents);
   } else {
-    parse_proguard_map(fp);
+    parse_proguard_map(contents);
   }
 }
 
@@ -290,58 +350,176 @@ ProguardLineRangeVector& ProguardMap::method_lines(
 }
 
 void ProguardMap::parse_proguard_map(std::istream& fp) {
-  std::string line;
-  while (std::getline(fp, line)) {
-    parse_class(line);
-  }
-  fp.clear();
-  fp.seekg(0);
-  assert_log(!fp.fail(), "Can't use ProguardMap with non-seekable stream");
-  while (std::getline(fp, line)) {
-    if (parse_class(line)) {
-      continue;
+  parse_proguard_map(std::string_view(read_stream(fp)));
+}
+
+void ProguardMap::parse_full_map(std::istream& fp) {
+  parse_full_map(std::string_view(read_stream(fp)));
+}
+
+void ProguardMap::add_entry(MapEntry&& entry) {
+  switch (entry.kind) {
+  case MapEntry::CLASS:
+    m_obfClassMap[entry.new_name] = entry.old_name;
+    m_classMap[std::move(entry.old_name)] = std::move(entry.new_name);
+    break;
+  case MapEntry::FIELD:
+    // Record interfaces that are coalesced by Proguard.
+    if (!entry.coalesced_interface.empty()) {
+      fprintf(stderr,
+              "Type '%s' is touched by Proguard in '%s'\n",
+              entry.coalesced_interface.c_str(),
+              entry.old_name.c_str());
+      m_pg_coalesced_interfaces.insert(entry.coalesced_interface);
     }
-    if (parse_field(line)) {
-      continue;
+    m_fieldMap[entry.old_name] = entry.new_name;
+    if (!entry.new_untyped_name.empty()) {
+      m_obfUntypedFieldMap[std::move(entry.new_untyped_name)] = entry.old_name;
     }
-    if (parse_method(line)) {
-      continue;
+    m_obfFieldMap[std::move(entry.new_name)] = std::move(entry.old_name);
+    break;
+  case MapEntry::METHOD:
+    m_methodMap[entry.old_name] = entry.new_name;
+    if (!entry.new_untyped_name.empty()) {
+      m_obfUntypedMethodMap[std::move(entry.new_untyped_name)] =
+          entry.old_name;
     }
-    if (comment(line)) {
-      continue;
+    if (entry.lines) {
+      entry.lines->original_name = entry.old_name;
+      m_obfMethodLinesMap[str_copy(pg_impl::lines_key(entry.new_name))]
+          .push_back(std::move(entry.lines));
     }
-    not_reached_log("Bogus line encountered in proguard map: %s\n",
-                    line.c_str());
+    m_obfMethodMap[std::move(entry.new_name)] = std::move(entry.old_name);
+    break;
   }
 }
 
-void ProguardMap::parse_full_map(std::istream& fp) {
-  std::string line;
-  fp.seekg(0);
-  assert_log(!fp.fail(),
-             "Can't use the full rename map with non-seekable stream");
-  while (std::getline(fp, line)) {
-    if (parse_class_full_format(line)) {
-      continue;
+/*
+ * Member lines are translated with the complete class map, so the classes are
+ * parsed first. The members are then parsed in chunks that start at class
+ * lines, which makes every chunk independent of the ones before it.
+ */
+void ProguardMap::parse_proguard_map(std::string_view contents) {
+  auto lines = split_lines(contents);
+
+  struct ClassChunk {
+    std::vector<MapEntry> entries;
+    std::vector<size_t> class_lines;
+  };
+  auto class_chunks = parse_chunks<ClassChunk>(
+      uniform_chunk_starts(lines.size()), lines.size(),
+      [&](size_t begin, size_t end) {
+        ClassChunk chunk;
+        std::string line;
+        ParseState state;
+        for (size_t i = begin; i < end; ++i) {
+          line.assign(lines[i]);
+          MapEntry entry;
+          if (parse_class(line, state, &entry)) {
+            chunk.entries.push_back(std::move(entry));
+            chunk.class_lines.push_back(i);
+          }
+        }
+        return chunk;
+      });
+  std::vector<size_t> member_chunk_starts{0};
+  for (auto& chunk : class_chunks) {
+    for (auto& entry : chunk.entries) {
+      add_entry(std::move(entry));
     }
-    if (parse_store_full_format(line)) {
-      continue;
+    for (auto i : chunk.class_lines) {
+      if (i - member_chunk_starts.back() >= LINES_PER_CHUNK) {
+        member_chunk_starts.push_back(i);
+      }
     }
-    if (parse_field_full_format(line)) {
-      continue;
+  }
+  class_chunks.clear();
+
+  struct MemberChunk {
+    std::vector<MapEntry> entries;
+    std::optional<size_t> bogus_line;
+  };
+  auto member_chunks = parse_chunks<MemberChunk>(
+      member_chunk_starts, lines.size(), [&](size_t begin, size_t end) {
+        MemberChunk chunk;
+        std::string line;
+        ParseState state;
+        for (size_t i = begin; i < end; ++i) {
+          line.assign(lines[i]);
+          MapEntry entry;
+          // Class lines were recorded above, and only update the state here.
+          if (parse_class(line, state, &entry)) {
+            continue;
+          }
+          if (parse_field(line, state, &entry) ||
+              parse_method(line, state, &entry)) {
+            chunk.entries.push_back(std::move(entry));
+            continue;
+          }
+          if (comment(line)) {
+            continue;
+          }
+          chunk.bogus_line = i;
+          break;
+        }
+        return chunk;
+      });
+  for (auto& chunk : member_chunks) {
+    if (chunk.bogus_line) {
+      not_reached_log("Bogus line encountered in proguard map: %s\n",
+                      str_copy(lines[*chunk.bogus_line]).c_str());
     }
-    if (parse_method_full_format(line)) {
-      continue;
+    for (auto& entry : chunk.entries) {
+      add_entry(std::move(entry));
     }
-    if (comment(line)) {
-      continue;
+  }
+}
+
+void ProguardMap::parse_full_map(std::string_view contents) {
+  auto lines = split_lines(contents);
+
+  struct Chunk {
+    std::vector<MapEntry> entries;
+    std::optional<size_t> bogus_line;
+  };
+  auto chunks = parse_chunks<Chunk>(
+      uniform_chunk_starts(lines.size()), lines.size(),
+      [&](size_t begin, size_t end) {
+        Chunk chunk;
+        std::string line;
+        for (size_t i = begin; i < end; ++i) {
+          line.assign(lines[i]);
+          MapEntry entry;
+          if (parse_class_full_format(line, &entry) ||
+              parse_field_full_format(line, &entry) ||
+              parse_method_full_format(line, &entry)) {
+            chunk.entries.push_back(std::move(entry));
+            continue;
+          }
+          if (parse_store_full_format(line)) {
+            continue;
+          }
+          if (comment(line)) {
+            continue;
+          }
+          chunk.bogus_line = i;
+          break;
+        }
+        return chunk;
+      });
+  for (auto& chunk : chunks) {
+    if (chunk.bogus_line) {
+      not_reached_log("Bogus line encountered in the full map: %s\n",
+                      str_copy(lines[*chunk.bogus_line]).c_str());
+    }
+    for (auto& entry : chunk.entries) {
+      add_entry(std::move(entry));
     }
-    not_reached_log("Bogus line encountered in the full map: %s\n",
-                    line.c_str());
   }
 }
 
-bool ProguardMap::parse_class_full_format(const std::string& line) {
+bool ProguardMap::parse_class_full_format(const std::string& line,
+                                          MapEntry* entry) const {
   std::string old_class_name;
   std::string new_class_name;
   auto p = line.c_str();
@@ -350,14 +528,13 @@ bool ProguardMap::parse_class_full_format(const std::string& line) {
   if (!literal(p, " -> ")) return false;
   if (!id(p, new_class_name)) return false;
 
-  m_currClass = old_class_name;
-  m_currNewClass = new_class_name;
-  m_classMap[m_currClass] = m_currNewClass;
-  m_obfClassMap[m_currNewClass] = m_currClass;
+  entry->kind = MapEntry::CLASS;
+  entry->old_name = std::move(old_class_name);
+  entry->new_name = std::move(new_class_name);
   return true;
 }
 
-bool ProguardMap::parse_store_full_format(const std::string& line) {
+bool ProguardMap::parse_store_full_format(const std::string& line) const {
   auto p = line.c_str();
   if (!literal(p, "store` ")) {
     return false;
@@ -368,7 +545,8 @@ bool ProguardMap::parse_store_full_format(const std::string& line) {
   return true;
 }
 
-bool ProguardMap::parse_field_full_format(const std::string& line) {
+bool ProguardMap::parse_field_full_format(const std::string& line,
+                                          MapEntry* entry) const {
   std::string old_field_name;
   std::string new_field_name;
 
@@ -391,15 +569,14 @@ bool ProguardMap::parse_field_full_format(const std::string& line) {
     return false;
   }
 
-  auto pgnew = new_field_name;
-  auto pgold = old_field_name;
-
-  m_fieldMap[pgold] = pgnew;
-  m_obfFieldMap[pgnew] = pgold;
+  entry->kind = MapEntry::FIELD;
+  entry->old_name = std::move(old_field_name);
+  entry->new_name = std::move(new_field_name);
   return true;
 }
 
-bool ProguardMap::parse_method_full_format(const std::string& line) {
+bool ProguardMap::parse_method_full_format(const std::string& line,
+                                           MapEntry* entry) const {
   std::string old_method_name;
   std::string new_method_name;
   auto p = line.c_str();
@@ -421,28 +598,32 @@ bool ProguardMap::parse_method_full_format(const std::string& line) {
     return false;
   }
 
-  auto pgold = old_method_name;
-  auto pgnew = new_method_name;
-  m_methodMap[pgold] = pgnew;
-  m_obfMethodMap[pgnew] = pgold;
+  entry->kind = MapEntry::METHOD;
+  entry->old_name = std::move(old_method_name);
+  entry->new_name = std::move(new_method_name);
   return true;
 }
 
-bool ProguardMap::parse_class(const std::string& line) {
+bool ProguardMap::parse_class(const std::string& line,
+                              ParseState& state,
+                              MapEntry* entry) const {
   std::string classname;
   std::string newname;
   auto p = line.c_str();
   if (!id(p, classname)) return false;
   if (!literal(p, " -> ")) return false;
   if (!id(p, newname)) return false;
-  m_currClass = convert_type(classname);
-  m_currNewClass = convert_type(newname);
-  m_classMap[m_currClass] = m_currNewClass;
-  m_obfClassMap[m_currNewClass] = m_currClass;
+  state.curr_class = convert_type(classname);
+  state.curr_new_class = convert_type(newname);
+  entry->kind = MapEntry::CLASS;
+  entry->old_name = state.curr_class;
+  entry->new_name = state.curr_new_class;
   return true;
 }
 
-bool ProguardMap::parse_field(const std::string& line) {
+bool ProguardMap::parse_field(const std::string& line,
+                              const ParseState& state,
+                              MapEntry* entry) const {
   std::string type;
   std::string fieldname;
   std::string newname;
@@ -457,27 +638,22 @@ bool ProguardMap::parse_field(const std::string& line) {
 
   auto ctype = convert_type(type);
   auto xtype = translate_type(ctype, *this);
-  auto pgnew = convert_field(m_currNewClass, xtype, newname);
-  auto pgnew_notype = convert_field(m_currNewClass, "", newname);
-  auto pgold = convert_field(m_currClass, ctype, fieldname);
-  // Record interfaces that are coalesced by Proguard.
+  entry->kind = MapEntry::FIELD;
+  entry->new_name = convert_field(state.curr_new_class, xtype, newname);
+  entry->new_untyped_name = convert_field(state.curr_new_class, "", newname);
+  entry->old_name = convert_field(state.curr_class, ctype, fieldname);
   if (ctype[0] == 'L' && is_maybe_proguard_generated_member(fieldname)) {
-    fprintf(stderr,
-            "Type '%s' is touched by Proguard in '%s'\n",
-            ctype.c_str(),
-            pgold.c_str());
-    m_pg_coalesced_interfaces.insert(ctype);
-  }
-  m_fieldMap[pgold] = pgnew;
-  m_obfFieldMap[pgnew] = pgold;
-  m_obfUntypedFieldMap[pgnew_notype] = pgold;
+    entry->coalesced_interface = ctype;
+  }
   return true;
 }
 
-bool ProguardMap::parse_method(const std::string& line) {
+bool ProguardMap::parse_method(const std::string& line,
+                               const ParseState& state,
+                               MapEntry* entry) const {
   std::string type;
   std::string methodname;
-  std::string classname = m_currClass;
+  std::string classname = state.curr_class;
   std::string old_args;
   std::string new_args;
   std::string newname;
@@ -517,15 +693,13 @@ bool ProguardMap::parse_method(const std::string& line) {
 
   auto old_rtype = convert_type(type);
   auto new_rtype = translate_type(old_rtype, *this);
-  auto pgold = convert_method(classname, old_rtype, methodname, old_args);
-  auto pgnew = convert_method(m_currNewClass, new_rtype, newname, new_args);
-  auto pgnew_no_rtype = convert_method(m_currNewClass, "", newname, new_args);
-  m_methodMap[pgold] = pgnew;
-  m_obfMethodMap[pgnew] = pgold;
-  m_obfUntypedMethodMap[pgnew_no_rtype] = pgold;
-  lines->original_name = pgold;
-  m_obfMethodLinesMap[str_copy(pg_impl::lines_key(pgnew))].push_back(
-      std::move(lines));
+  entry->kind = MapEntry::METHOD;
+  entry->old_name = convert_method(classname, old_rtype, methodname, old_args);
+  entry->new_name =
+      convert_method(state.curr_new_class, new_rtype, newname, new_args);
+  entry->new_untyped_name =
+      convert_method(state.curr_new_class, "", newname, new_args);
+  entry->lines = std::move(lines);
   return true;
 }
 
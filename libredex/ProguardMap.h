@@ -10,6 +10,7 @@
 #include <cstddef>
 #include <iosfwd>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -112,17 +113,47 @@ struct ProguardMap {
   }
 
  private:
-  void parse_proguard_map(std::istream& fp);
-  void parse_full_map(std::istream& fp);
+  // The name mappings defined by a single line of a mapping file.
+  struct MapEntry {
+    enum Kind { CLASS, FIELD, METHOD } kind;
+    std::string old_name;
+    std::string new_name;
+    // The new name without its type or return type, if recorded.
+    std::string new_untyped_name;
+    // The line ranges of a method in ProGuard's format.
+    std::unique_ptr<ProguardLineRange> lines;
+    // A type that ProGuard most likely coalesced, if the line hints at one.
+    std::string coalesced_interface;
+  };
 
-  bool parse_class(const std::string& line);
-  bool parse_field(const std::string& line);
-  bool parse_method(const std::string& line);
+  // The class whose members the following lines of the map describe.
+  struct ParseState {
+    std::string curr_class;
+    std::string curr_new_class;
+  };
 
-  bool parse_class_full_format(const std::string& line);
-  bool parse_store_full_format(const std::string& line);
-  bool parse_field_full_format(const std::string& line);
-  bool parse_method_full_format(const std::string& line);
+  void parse_proguard_map(std::istream& fp);
+  void parse_full_map(std::istream& fp);
+  void parse_proguard_map(std::string_view contents);
+  void parse_full_map(std::string_view contents);
+
+  void add_entry(MapEntry&& entry);
+
+  bool parse_class(const std::string& line,
+                   ParseState& state,
+                   MapEntry* entry) const;
+  bool parse_field(const std::string& line,
+                   const ParseState& state,
+                   MapEntry* entry) const;
+  bool parse_method(const std::string& line,
+                    const ParseState& state,
+                    MapEntry* entry) const;
+
+  bool parse_class_full_format(const std::string& line, MapEntry* entry) const;
+  bool parse_store_full_format(const std::string& line) const;
+  bool parse_field_full_format(const std::string& line, MapEntry* entry) const;
+  bool parse_method_full_format(const std::string& line,
+                                MapEntry* entry) const;
 
  private:
   // Unobfuscated to obfuscated maps
@@ -147,9 +178,6 @@ struct ProguardMap {
 
   // Interfaces that are (most likely) coalesced by Proguard.
   std::unordered_set<std::string> m_pg_coalesced_interfaces;
-
-  std::string m_currClass;
-  std::string m_currNewClass;
 };
 
 /**
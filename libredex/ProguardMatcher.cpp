@@ -6,10 +6,14 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/regex.hpp>
+#include <deque>
 #include <fstream>
 #include <iostream>
 #include <mutex>
+#include <optional>
 #include <sstream>
 #include <thread>
 #include <unordered_map>
@@ -36,7 +40,9 @@ using namespace keep_rules;
 
 namespace {
 
-using RegexMap = std::unordered_map<std::string, boost::regex>;
+// Shared by all threads matching keep rules; boost::regex is safe to match
+// against concurrently.
+using RegexMap = InsertOnlyConcurrentMap<std::string, boost::regex>;
 
 using MatchingStringsCache =
     ConcurrentMap<std::string, InsertOnlyConcurrentMap<const DexString*, bool>>;
@@ -194,10 +200,12 @@ struct ClassMatcher {
   }
 
   bool search_extends_and_interfaces(const DexClass* cls) {
-    auto cached_it = m_extends_result_cache.find(cls);
-    if (cached_it != m_extends_result_cache.end()) {
-      return cached_it->second;
+    const auto* cached = m_extends_result_cache.get(cls);
+    if (cached != nullptr) {
+      return *cached;
     }
+    // Not computed under the map's lock, since the search recurses into this
+    // function. Concurrent callers may compute the same result twice.
     auto result = search_extends_and_interfaces_nocache(cls);
     m_extends_result_cache.emplace(cls, result);
     return result;
@@ -228,7 +236,7 @@ struct ClassMatcher {
   RegexWithCache m_extends;
   RegexWithCache m_extends_anno;
 
-  std::unordered_map<const DexClass*, bool> m_extends_result_cache;
+  InsertOnlyConcurrentMap<const DexClass*, bool> m_extends_result_cache;
 };
 
 enum class RuleType {
@@ -288,22 +296,102 @@ void build_extends_or_implements_hierarchy(const Scope& scope,
   }
 }
 
+/*
+ * The literal prefixes of the class names a keep rule can match, or none if
+ * some class name pattern of the rule can match a name with any prefix.
+ * Negated class names never produce a match on their own, so they do not
+ * contribute a prefix.
+ */
+std::optional<std::vector<std::string>> class_name_prefixes(
+    const KeepSpec& keep_rule) {
+  std::vector<std::string> prefixes;
+  for (const auto& class_name : keep_rule.class_spec.classNames) {
+    if (class_name.negated) {
+      continue;
+    }
+    if (class_name.name == "*" || class_name.name == "**") {
+      return std::nullopt;
+    }
+    auto prefix = proguard_parser::type_regex_literal_prefix(
+        proguard_parser::convert_wildcard_type(class_name.name));
+    if (prefix.empty()) {
+      return std::nullopt;
+    }
+    prefixes.push_back(std::move(prefix));
+  }
+  return prefixes;
+}
+
+/*
+ * Classes sorted by deobfuscated name. This is a flattened prefix trie over
+ * the class names: all classes whose names start with a given prefix form a
+ * contiguous range. Wildcard keep rules use it to run their regexes only on
+ * the classes that share one of their literal prefixes instead of on every
+ * class in scope.
+ */
+class ClassNameIndex {
+ public:
+  explicit ClassNameIndex(const std::vector<DexClass*>& classes) {
+    std::copy_if(classes.begin(), classes.end(),
+                 std::back_inserter(m_classes),
+                 [](const DexClass* cls) { return cls != nullptr; });
+    std::sort(m_classes.begin(), m_classes.end(),
+              [](const DexClass* a, const DexClass* b) {
+                return name(a) < name(b);
+              });
+  }
+
+  // All classes whose names start with one of `prefixes`, each listed once.
+  std::vector<DexClass*> with_any_prefix(
+      std::vector<std::string> prefixes) const {
+    std::sort(prefixes.begin(), prefixes.end());
+    std::vector<DexClass*> result;
+    const std::string* last_prefix = nullptr;
+    for (const auto& prefix : prefixes) {
+      // Ranges of sorted prefixes are either nested or disjoint. Skip nested
+      // ones so that no class is visited twice.
+      if (last_prefix != nullptr &&
+          boost::starts_with(prefix, *last_prefix)) {
+        continue;
+      }
+      last_prefix = &prefix;
+      auto it = std::lower_bound(m_classes.begin(), m_classes.end(), prefix,
+                                 [](const DexClass* cls, const std::string& p) {
+                                   return name(cls) < p;
+                                 });
+      for (; it != m_classes.end() && boost::starts_with(name(*it), prefix);
+           ++it) {
+        result.push_back(*it);
+      }
+    }
+    return result;
+  }
+
+ private:
+  static std::string_view name(const DexClass* cls) {
+    return cls->get_deobfuscated_name().str();
+  }
+
+  std::vector<DexClass*> m_classes;
+};
+
 /*
  * This class contains the logic for matching against a single keep rule.
+ *
+ * A rule matched against many classes gets one instance per shard of
+ * classes, each used by a single thread. Their match counts are summed up
+ * once all shards are done.
  */
 class KeepRuleMatcher {
  public:
   KeepRuleMatcher(RuleType rule_type,
                   const KeepSpec& keep_rule,
-                  RegexMap& regex_map)
+                  RegexMap& regex_map,
+                  ConcurrentSet<std::string>& warnings)
       : m_rule_type(rule_type),
         m_keep_rule(keep_rule),
-        m_regex_map(regex_map) {}
-
-  ~KeepRuleMatcher() {
-    TRACE(PGR, 3, "%s matched %zu classes and %zu members",
-          show_keep(m_keep_rule).c_str(), m_class_matches, m_member_matches);
-  }
+        m_regex_map(regex_map),
+        m_warnings(warnings) {}
 
   void keep_processor(DexClass*);
 
@@ -362,25 +450,21 @@ class KeepRuleMatcher {
                       const std::string& annotation) const;
 
   const boost::regex& register_matcher(const std::string& regex) const {
-    auto it = m_regex_map.find(regex);
-    if (it == m_regex_map.end()) {
-      it = m_regex_map.emplace(regex, boost::regex{regex}).first;
+    const auto* matcher = m_regex_map.get(regex);
+    if (matcher != nullptr) {
+      return *matcher;
     }
-    return it->second;
+    return *m_regex_map.emplace(regex, regex).first;
   }
 
-  bool is_unused() const {
-    return m_class_matches == 0 && m_member_matches == 0;
-  }
+  size_t class_matches() const { return m_class_matches; }
+  size_t member_matches() const { return m_member_matches; }
 
  private:
   void maybe_warn(const std::string& warning) {
-    std::unique_lock<std::mutex> lock{m_warn_mutex};
-    if (m_already_warned.count(warning) > 0) {
-      return;
+    if (m_warnings.insert(warning)) {
+      std::cerr << warning << std::endl;
     }
-    m_already_warned.emplace(warning);
-    std::cerr << warning << std::endl;
   }
 
   size_t m_member_matches{0};
@@ -388,9 +472,7 @@ class KeepRuleMatcher {
   RuleType m_rule_type;
   const KeepSpec& m_keep_rule;
   RegexMap& m_regex_map;
-
-  std::mutex m_warn_mutex;
-  std::unordered_set<std::string> m_already_warned;
+  ConcurrentSet<std::string>& m_warnings;
 };
 
 class ProguardMatcher {
@@ -411,9 +493,10 @@ class ProguardMatcher {
   void process_proguard_rules(const ProguardConfiguration& pg_config);
   void mark_all_annotation_classes_as_keep();
 
-  void classify_rules(const KeepRuleMatcher& rule_matcher,
-                      const RuleType& rule_type,
-                      const KeepSpec* keep_rule);
+  void classify_rules(const RuleType& rule_type,
+                      const KeepSpec* keep_rule,
+                      size_t class_matches,
+                      size_t member_matches);
   void process_keep(KeepSpecSet::iterator keep_rules_begin,
                     KeepSpecSet::iterator keep_rules_end,
                     RuleType rule_type,
@@ -430,6 +513,8 @@ class ProguardMatcher {
   ClassHierarchy m_hierarchy;
   ProguardRuleRecorder m_recorder;
   MatchingStringsCache m_matching_strings_cache;
+  RegexMap m_regex_map;
+  ConcurrentSet<std::string> m_warnings;
 };
 
 void apply_assume_field_return_value(const MemberSpecification& field_spec,
@@ -893,26 +978,30 @@ DexClass* ProguardMatcher::find_single_class(
   return type_class(typ);
 }
 
-void ProguardMatcher::classify_rules(const KeepRuleMatcher& rule_matcher,
-                                     const RuleType& rule_type,
-                                     const KeepSpec* keep_rule) {
+void ProguardMatcher::classify_rules(const RuleType& rule_type,
+                                     const KeepSpec* keep_rule,
+                                     size_t class_matches,
+                                     size_t member_matches) {
+  TRACE(PGR, 3, "%s matched %zu classes and %zu members",
+        show_keep(*keep_rule).c_str(), class_matches, member_matches);
+  bool is_unused = class_matches == 0 && member_matches == 0;
   switch (rule_type) {
   case RuleType::KEEP:
-    if (rule_matcher.is_unused()) {
+    if (is_unused) {
       m_recorder.unused_keep_rules.insert(keep_rule);
     } else {
       m_recorder.used_keep_rules.insert(keep_rule);
     }
     break;
   case RuleType::ASSUME_NO_SIDE_EFFECTS:
-    if (rule_matcher.is_unused()) {
+    if (is_unused) {
       m_recorder.unused_assumenosideeffect_rules.insert(keep_rule);
     } else {
       m_recorder.used_assumenosideeffect_rules.insert(keep_rule);
     }
     break;
   case RuleType::ASSUME_VALUES:
-    if (rule_matcher.is_unused()) {
+    if (is_unused) {
       m_recorder.unused_assumevalues_rules.insert(keep_rule);
     } else {
       m_recorder.used_assumevalues_rules.insert(keep_rule);
@@ -952,25 +1041,24 @@ void ProguardMatcher::process_keep(KeepSpecSet::iterator keep_rules_begin,
     }
   };
 
-  // We only parallelize if keep_rule needs to be applied to all classes.
-  auto wq = workqueue_foreach<const KeepSpec*>([&](const KeepSpec* keep_rule) {
-    RegexMap regex_map;
-    ClassMatcher class_match(*keep_rule, &m_matching_strings_cache);
-    KeepRuleMatcher rule_matcher(rule_type, *keep_rule, regex_map);
-
-    for (const auto& cls : m_classes) {
-      process_single_keep(class_match, rule_matcher, cls);
-    }
-    if (process_external) {
-      for (const auto& cls : m_external_classes) {
-        process_single_keep(class_match, rule_matcher, cls);
-      }
-    }
-
-    classify_rules(rule_matcher, rule_type, keep_rule);
-  });
+  // A rule that has to be checked against many classes. Its classes are
+  // split into shards that are matched in parallel.
+  struct SlowRule {
+    SlowRule(const KeepSpec& keep_rule, MatchingStringsCache* cache)
+        : keep_rule(keep_rule), class_match(keep_rule, cache) {}
+
+    const KeepSpec& keep_rule;
+    ClassMatcher class_match;
+    // The classes sharing one of the rule's literal class name prefixes.
+    // Unused if the rule has to look at all classes.
+    std::vector<DexClass*> candidates;
+    const std::vector<DexClass*>* classes{nullptr};
+    std::atomic<size_t> class_matches{0};
+    std::atomic<size_t> member_matches{0};
+    AccumulatingTimer match_timer;
+  };
+  std::deque<SlowRule> slow_rules;
 
-  RegexMap regex_map;
   for (auto it = keep_rules_begin; it != keep_rules_end; ++it) {
     const auto& keep_rule = *(*it);
     ClassMatcher class_match(keep_rule, &m_matching_strings_cache);
@@ -985,9 +1073,11 @@ void ProguardMatcher::process_keep(KeepSpecSet::iterator keep_rules_begin,
       for (const auto& className : keep_rule.class_spec.classNames) {
         if (!classname_contains_wildcard(className.name)) {
           DexClass* cls = find_single_class(className.name);
-          KeepRuleMatcher rule_matcher(rule_type, keep_rule, regex_map);
+          KeepRuleMatcher rule_matcher(rule_type, keep_rule, m_regex_map,
+                                       m_warnings);
           process_single_keep(class_match, rule_matcher, cls);
-          classify_rules(rule_matcher, rule_type, &keep_rule);
+          classify_rules(rule_type, &keep_rule, rule_matcher.class_matches(),
+                         rule_matcher.member_matches());
         } else {
           class_with_wildcard = true;
         }
@@ -1002,24 +1092,86 @@ void ProguardMatcher::process_keep(KeepSpecSet::iterator keep_rules_begin,
           !classname_contains_wildcard(extendsClassName)) {
         DexClass* super = find_single_class(extendsClassName);
         if (super != nullptr) {
-          KeepRuleMatcher rule_matcher(rule_type, keep_rule, regex_map);
+          KeepRuleMatcher rule_matcher(rule_type, keep_rule, m_regex_map,
+                                       m_warnings);
           auto children = get_all_children(m_hierarchy, super->get_type());
           process_single_keep(class_match, rule_matcher, super);
           for (auto const* type : children) {
             process_single_keep(class_match, rule_matcher, type_class(type));
           }
-          classify_rules(rule_matcher, rule_type, &keep_rule);
+          classify_rules(rule_type, &keep_rule, rule_matcher.class_matches(),
+                         rule_matcher.member_matches());
         }
         continue;
       }
     }
 
     TRACE(PGR, 2, "Slow rule: %s", show_keep(keep_rule).c_str());
-    // Otherwise, it might take a longer time. Add to the work queue.
-    wq.add_item(&keep_rule);
+    // Otherwise, it might take a longer time. Match it in parallel below.
+    slow_rules.emplace_back(keep_rule, &m_matching_strings_cache);
+  }
+
+  if (slow_rules.empty()) {
+    return;
+  }
+
+  std::vector<DexClass*> all_classes(m_classes.begin(), m_classes.end());
+  if (process_external) {
+    all_classes.insert(all_classes.end(), m_external_classes.begin(),
+                       m_external_classes.end());
+  }
+  // Built only if some slow rule has literal class name prefixes to look up.
+  std::unique_ptr<ClassNameIndex> class_name_index;
+  for (auto& slow_rule : slow_rules) {
+    auto prefixes = class_name_prefixes(slow_rule.keep_rule);
+    if (!prefixes) {
+      slow_rule.classes = &all_classes;
+      continue;
+    }
+    if (!class_name_index) {
+      class_name_index = std::make_unique<ClassNameIndex>(all_classes);
+    }
+    slow_rule.candidates = class_name_index->with_any_prefix(*prefixes);
+    slow_rule.classes = &slow_rule.candidates;
   }
 
+  // Shard by class rather than by rule, so that a few rules that look at all
+  // classes do not leave most threads idle.
+  struct Shard {
+    SlowRule* rule;
+    size_t begin;
+    size_t end;
+  };
+  constexpr size_t CLASSES_PER_SHARD = 512;
+  auto wq = workqueue_foreach<Shard>([&](const Shard& shard) {
+    auto& slow_rule = *shard.rule;
+    auto timer_scope = slow_rule.match_timer.scope();
+    KeepRuleMatcher rule_matcher(rule_type, slow_rule.keep_rule, m_regex_map,
+                                 m_warnings);
+    for (size_t i = shard.begin; i < shard.end; i++) {
+      process_single_keep(slow_rule.class_match, rule_matcher,
+                          (*slow_rule.classes)[i]);
+    }
+    slow_rule.class_matches += rule_matcher.class_matches();
+    slow_rule.member_matches += rule_matcher.member_matches();
+  });
+  for (auto& slow_rule : slow_rules) {
+    const auto& classes = *slow_rule.classes;
+    for (size_t begin = 0; begin < classes.size();
+         begin += CLASSES_PER_SHARD) {
+      wq.add_item(
+          Shard{&slow_rule, begin,
+                std::min(begin + CLASSES_PER_SHARD, classes.size())});
+    }
+  }
   wq.run_all();
+
+  for (auto& slow_rule : slow_rules) {
+    classify_rules(rule_type, &slow_rule.keep_rule, slow_rule.class_matches,
+                   slow_rule.member_matches);
+    m_recorder.keep_rule_match_microseconds.emplace(
+        &slow_rule.keep_rule, slow_rule.match_timer.get_microseconds());
+  }
 }
 
 void ProguardMatcher::process_proguard_rules(
@@ -1120,6 +1272,11 @@ void ProguardRuleRecorder::record_accessed_rules(
   }
 }
 
+void ProguardRuleRecorder::record_rule_match_times(const std::string& path) {
+  std::ofstream ofs{path};
+  redex::print_keep_rule_match_times(ofs, keep_rule_match_microseconds);
+}
+
 ProguardRuleRecorder process_proguard_rules(
     const ProguardMap& pg_map,
     const Scope& classes,
@@ -20,12 +20,16 @@ struct ProguardRuleRecorder {
  public:
   void record_accessed_rules(const std::string& used_rule_path,
                              const std::string& unused_rule_path);
+  void record_rule_match_times(const std::string& path);
   ConcurrentSet<const KeepSpec*> unused_keep_rules;
   ConcurrentSet<const KeepSpec*> used_keep_rules;
   ConcurrentSet<const KeepSpec*> unused_assumenosideeffect_rules;
   ConcurrentSet<const KeepSpec*> used_assumenosideeffect_rules;
   ConcurrentSet<const KeepSpec*> unused_assumevalues_rules;
   ConcurrentSet<const KeepSpec*> used_assumevalues_rules;
+  // Time spent matching each rule that had to be checked against many
+  // classes.
+  ConcurrentMap<const KeepSpec*, uint64_t> keep_rule_match_microseconds;
 };
 
 ProguardRuleRecorder process_proguard_rules(
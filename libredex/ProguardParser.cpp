@@ -5,8 +5,10 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <vector>
 
 #include "Debug.h"
@@ -16,6 +18,7 @@
 #include "ProguardParser.h"
 #include "ProguardRegex.h"
 #include "ReadMaybeMapped.h"
+#include "WorkQueue.h"
 
 namespace keep_rules {
 namespace proguard_parser {
@@ -24,10 +27,13 @@ namespace {
 struct TokenIndex {
   const std::vector<Token>& vec;
   std::vector<Token>::const_iterator it;
+  // Where to report problems.
+  std::ostream& err;
 
   TokenIndex(const std::vector<Token>& vec,
-             std::vector<Token>::const_iterator it)
-      : vec(vec), it(it) {}
+             std::vector<Token>::const_iterator it,
+             std::ostream& err)
+      : vec(vec), it(it), err(err) {}
 
   void skip_comments() {
     while (it != vec.end() && it->type == TokenType::comment) {
@@ -127,24 +133,24 @@ std::optional<std::string> parse_single_filepath_command(
   idx.next(); // Consume the command token.
   // Fail without consumption if this is an end of file token.
   if (idx.type() == TokenType::eof_token) {
-    std::cerr << "Expecting at least one file as an argument but found end of "
-                 "file at line "
-              << line_number << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Expecting at least one file as an argument but found end of "
+               "file at line "
+            << line_number << std::endl
+            << idx.show_context(2) << std::endl;
     return "";
   }
   // Fail without consumption if this is a command token.
   if (idx.it->is_command()) {
-    std::cerr << "Expecting a file path argument but got command " << idx.show()
-              << " at line  " << idx.line() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Expecting a file path argument but got command " << idx.show()
+            << " at line  " << idx.line() << std::endl
+            << idx.show_context(2) << std::endl;
     return "";
   }
   // Parse the filename.
   if (idx.type() != TokenType::filepath) {
-    std::cerr << "Expected a filepath but got " << idx.show() << " at line "
-              << idx.line() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Expected a filepath but got " << idx.show() << " at line "
+            << idx.line() << std::endl
+            << idx.show_context(2) << std::endl;
     return "";
   }
   auto str = idx.str();
@@ -157,9 +163,9 @@ std::vector<std::string> parse_filepaths(TokenIndex& idx) {
   std::vector<std::string> filepaths;
   if (idx.type() != TokenType::filepath) {
     if (!kOptional) {
-      std::cerr << "Expected filepath but got " << idx.show() << " at line "
-                << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expected filepath but got " << idx.show() << " at line "
+              << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
     }
     {};
   }
@@ -183,23 +189,23 @@ std::optional<std::vector<std::string>> parse_filepath_command(
   idx.next(); // Consume the command token.
   // Fail without consumption if this is an end of file token.
   if (idx.type() == TokenType::eof_token) {
-    std::cerr << "Expecting at least one file as an argument but found end of "
-                 "file at line "
-              << line_number << std::endl;
+    idx.err << "Expecting at least one file as an argument but found end of "
+               "file at line "
+            << line_number << std::endl;
     return {};
   }
   // Fail without consumption if this is a command token.
   if (idx.it->is_command()) {
-    std::cerr << "Expecting a file path argument but got command " << idx.show()
-              << " at line  " << idx.line() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Expecting a file path argument but got command " << idx.show()
+            << " at line  " << idx.line() << std::endl
+            << idx.show_context(2) << std::endl;
     return {};
   }
   // Parse the filename.
   if (idx.type() != TokenType::filepath) {
-    std::cerr << "Expected a filepath but got " << idx.show() << " at line "
-              << idx.line() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Expected a filepath but got " << idx.show() << " at line "
+            << idx.line() << std::endl
+            << idx.show_context(2) << std::endl;
     return {};
   }
   return parse_filepaths(idx);
@@ -223,7 +229,7 @@ std::optional<std::vector<std::string>> parse_jars(TokenIndex& idx,
     idx.next(); // Consume the jar token.
     // Fail without consumption if this is an end of file token.
     if (idx.type() == TokenType::eof_token) {
-      std::cerr
+      idx.err
           << "Expecting at least one file as an argument but found end of "
              "file at line "
           << line_number << std::endl
@@ -243,8 +249,8 @@ bool parse_repackageclasses(TokenIndex& idx) {
   // Ignore repackageclasses.
   idx.next();
   if (idx.type() == TokenType::identifier) {
-    std::cerr << "Ignoring -repackageclasses " << idx.data() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Ignoring -repackageclasses " << idx.data() << std::endl
+            << idx.show_context(2) << std::endl;
     idx.next();
   }
   return true;
@@ -255,9 +261,9 @@ std::optional<std::string> parse_target(TokenIndex& idx) {
     idx.next(); // Consume the target command token.
     // Check to make sure the next TokenType is a version token.
     if (idx.type() != TokenType::target_version_token) {
-      std::cerr << "Expected a target version but got " << idx.show()
-                << " at line " << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expected a target version but got " << idx.show()
+              << " at line " << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       return "";
     }
     auto str = idx.str();
@@ -314,9 +320,9 @@ bool parse_modifiers(TokenIndex& idx, KeepSpec* keep) {
   while (idx.type() == TokenType::comma) {
     idx.next();
     if (!is_modifier(idx.type())) {
-      std::cerr << "Expected keep option modifier but found : " << idx.show()
-                << " at line number " << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expected keep option modifier but found : " << idx.show()
+              << " at line number " << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       return false;
     }
     switch (idx.type()) {
@@ -392,9 +398,9 @@ std::string parse_annotation_type(TokenIndex& idx) {
   }
   idx.next();
   if (idx.type() != TokenType::identifier) {
-    std::cerr << "Expecting a class identifier after @ but got " << idx.show()
-              << " at line " << idx.line() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Expecting a class identifier after @ but got " << idx.show()
+            << " at line " << idx.line() << std::endl
+            << idx.show_context(2) << std::endl;
     return "";
   }
   const auto& typ = idx.data();
@@ -428,20 +434,20 @@ bool parse_access_flags(TokenIndex& idx,
       idx.it = ++access_it;
       if (negated) {
         if (is_access_flag_set(setFlags_, *access_flag)) {
-          std::cerr << "Access flag " << idx.show()
-                    << " occurs with conflicting settings at line "
-                    << idx.line() << std::endl
-                    << idx.show_context(2) << std::endl;
+          idx.err << "Access flag " << idx.show()
+                  << " occurs with conflicting settings at line "
+                  << idx.line() << std::endl
+                  << idx.show_context(2) << std::endl;
           return false;
         }
         set_access_flag(unsetFlags_, *access_flag);
         negated = false;
       } else {
         if (is_access_flag_set(unsetFlags_, *access_flag)) {
-          std::cerr << "Access flag " << idx.show()
-                    << " occurs with conflicting settings at line "
-                    << idx.line() << std::endl
-                    << idx.show_context(2) << std::endl;
+          idx.err << "Access flag " << idx.show()
+                  << " occurs with conflicting settings at line "
+                  << idx.line() << std::endl
+                  << idx.show_context(2) << std::endl;
           return false;
         }
         set_access_flag(setFlags_, *access_flag);
@@ -479,9 +485,9 @@ bool parse_class_token(TokenIndex& idx,
   case TokenType::classToken:
     break;
   default:
-    std::cerr << "Expected interface, class or enum but got " << idx.show()
-              << " at line number " << idx.line() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Expected interface, class or enum but got " << idx.show()
+            << " at line number " << idx.line() << std::endl
+            << idx.show_context(2) << std::endl;
     return false;
   }
   idx.next();
@@ -493,8 +499,8 @@ bool parse_class_token(TokenIndex& idx,
 // is returned.
 bool consume_token(TokenIndex& idx, const TokenType& tok) {
   if (idx.type() != tok) {
-    std::cerr << "Unexpected TokenType " << idx.show() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Unexpected TokenType " << idx.show() << std::endl
+            << idx.show_context(2) << std::endl;
     return false;
   }
   idx.next();
@@ -504,9 +510,9 @@ bool consume_token(TokenIndex& idx, const TokenType& tok) {
 // Consume an expected semicolon, complaining if one was not found.
 bool gobble_semicolon(TokenIndex& idx) {
   if (!consume_token(idx, TokenType::semiColon)) {
-    std::cerr << "Expecting a semicolon but found " << idx.show() << " at line "
-              << idx.line() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Expecting a semicolon but found " << idx.show() << " at line "
+            << idx.line() << std::endl
+            << idx.show_context(2) << std::endl;
     return false;
   }
   return true;
@@ -532,15 +538,15 @@ bool parse_member_specification(TokenIndex& idx,
                           member_specification.requiredUnsetAccessFlags)) {
     // There was a problem parsing the access flags. Return an empty class spec
     // for now.
-    std::cerr << "Problem parsing access flags for member specification.\n";
+    idx.err << "Problem parsing access flags for member specification.\n";
     skip_to_semicolon(idx);
     return false;
   }
   // The next TokenType better be an identifier.
   if (idx.type() != TokenType::identifier) {
-    std::cerr << "Expecting field or member specification but got "
-              << idx.show() << " at line " << idx.line() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Expecting field or member specification but got "
+            << idx.show() << " at line " << idx.line() << std::endl
+            << idx.show_context(2) << std::endl;
     skip_to_semicolon(idx);
     return false;
   }
@@ -589,9 +595,9 @@ bool parse_member_specification(TokenIndex& idx,
   } else {
     // This TokenType is the type for the member specification.
     if (idx.type() != TokenType::identifier) {
-      std::cerr << "Expecting type identifier but got " << idx.show()
-                << " at line " << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expecting type identifier but got " << idx.show()
+              << " at line " << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       skip_to_semicolon(idx);
       return false;
     }
@@ -599,9 +605,9 @@ bool parse_member_specification(TokenIndex& idx,
     idx.next();
     member_specification.descriptor = convert_wildcard_type(typ);
     if (idx.type() != TokenType::identifier) {
-      std::cerr << "Expecting identifier name for class member but got "
-                << idx.show() << " at line " << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expecting identifier name for class member but got "
+              << idx.show() << " at line " << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       skip_to_semicolon(idx);
       return false;
     }
@@ -619,9 +625,9 @@ bool parse_member_specification(TokenIndex& idx,
         break;
       }
       if (idx.type() != TokenType::identifier) {
-        std::cerr << "Expecting type identifier but got " << idx.show()
-                  << " at line " << idx.line() << std::endl
-                  << idx.show_context(2) << std::endl;
+        idx.err << "Expecting type identifier but got " << idx.show()
+                << " at line " << idx.line() << std::endl
+                << idx.show_context(2) << std::endl;
         return false;
       }
       const auto& typ = idx.data();
@@ -630,9 +636,9 @@ bool parse_member_specification(TokenIndex& idx,
       // The next TokenType better be a comma or a closing bracket.
       if (idx.type() != TokenType::comma &&
           idx.type() != TokenType::closeBracket) {
-        std::cerr << "Expecting comma or ) but got " << idx.show()
-                  << " at line " << idx.line() << std::endl
-                  << idx.show_context(2) << std::endl;
+        idx.err << "Expecting comma or ) but got " << idx.show()
+                << " at line " << idx.line() << std::endl
+                << idx.show_context(2) << std::endl;
         return false;
       }
       // If the next TokenType is a comma (rather than closing bracket) consume
@@ -640,9 +646,9 @@ bool parse_member_specification(TokenIndex& idx,
       if (idx.type() == TokenType::comma) {
         consume_token(idx, TokenType::comma);
         if (idx.type() != TokenType::identifier) {
-          std::cerr << "Expecting type identifier after comma but got "
-                    << idx.show() << " at line " << idx.line() << std::endl
-                    << idx.show_context(2) << std::endl;
+          idx.err << "Expecting type identifier after comma but got "
+                  << idx.show() << " at line " << idx.line() << std::endl
+                  << idx.show_context(2) << std::endl;
           return false;
         }
       }
@@ -709,9 +715,9 @@ bool member_comparison(const MemberSpecification& m1,
 
 std::optional<std::string> parse_class_name(TokenIndex& idx) {
   if (idx.type() != TokenType::identifier) {
-    std::cerr << "Expected class name but got " << idx.show() << " at line "
-              << idx.line() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Expected class name but got " << idx.show() << " at line "
+            << idx.line() << std::endl
+            << idx.show_context(2) << std::endl;
     return std::nullopt;
   }
   auto name = idx.str();
@@ -764,7 +770,7 @@ std::optional<ClassSpecification> parse_class_specification(TokenIndex& idx,
           idx, class_spec.setAccessFlags, class_spec.unsetAccessFlags)) {
     // There was a problem parsing the access flags. Return an empty class spec
     // for now.
-    std::cerr << "Problem parsing access flags for class specification.\n";
+    idx.err << "Problem parsing access flags for class specification.\n";
     return std::nullopt;
   }
   if (!parse_class_token(
@@ -782,9 +788,9 @@ std::optional<ClassSpecification> parse_class_specification(TokenIndex& idx,
     idx.next();
     class_spec.extendsAnnotationType = parse_annotation_type(idx);
     if (idx.type() != TokenType::identifier) {
-      std::cerr << "Expecting a class name after extends/implements but got "
-                << idx.show() << " at line " << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expecting a class name after extends/implements but got "
+              << idx.show() << " at line " << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       ok = false;
       class_spec.extendsClassName = "";
     } else {
@@ -936,8 +942,9 @@ void move_vector_elements(std::vector<T>& from, std::vector<T>& to) {
 void parse(const std::vector<Token>& vec,
            ProguardConfiguration* pg_config,
            Stats& stats,
-           const std::string& filename) {
-  TokenIndex idx{vec, vec.begin()};
+           const std::string& filename,
+           std::ostream& err) {
+  TokenIndex idx{vec, vec.begin(), err};
 
   auto check_empty = [&stats](const auto& opt_val) {
     if (opt_val->empty()) {
@@ -961,9 +968,9 @@ void parse(const std::vector<Token>& vec,
     }
     uint32_t line = idx.line();
     if (!idx.it->is_command()) {
-      std::cerr << "Expecting command but found " << idx.show() << " at line "
-                << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expecting command but found " << idx.show() << " at line "
+              << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       idx.next();
       skip_to_next_command(idx);
       ++stats.unknown_commands;
@@ -1140,15 +1147,15 @@ void parse(const std::vector<Token>& vec,
       const auto& name = idx.data();
       // It is benign to drop -dontnote
       if (name != "dontnote") {
-        std::cerr << "Unimplemented command (skipping): " << idx.show()
-                  << " at line " << idx.line() << std::endl
-                  << idx.show_context(2) << std::endl;
+        idx.err << "Unimplemented command (skipping): " << idx.show()
+                << " at line " << idx.line() << std::endl
+                << idx.show_context(2) << std::endl;
         ++stats.unimplemented;
       }
     } else {
-      std::cerr << "Unexpected TokenType " << idx.show() << " at line "
-                << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Unexpected TokenType " << idx.show() << " at line "
+              << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       ++stats.parse_errors;
     }
     idx.next();
@@ -1158,7 +1165,8 @@ void parse(const std::vector<Token>& vec,
 
 Stats parse(const std::string_view& config,
             ProguardConfiguration* pg_config,
-            const std::string& filename) {
+            const std::string& filename,
+            std::ostream& err = std::cerr) {
   Stats ret{};
 
   std::vector<Token> tokens = lex(config);
@@ -1174,24 +1182,76 @@ Stats parse(const std::string_view& config,
   }
 
   if (!ok) {
-    std::cerr << "Found " << ret.unknown_tokens << " unkown tokens in "
+    err << "Found " << ret.unknown_tokens << " unkown tokens in "
               << filename << "\n";
     pg_config->ok = false;
     return ret;
   }
 
-  parse(tokens, pg_config, ret, filename);
+  parse(tokens, pg_config, ret, filename, err);
   if (ret.parse_errors == 0) {
     pg_config->ok = ok;
   } else {
     pg_config->ok = false;
-    std::cerr << "Found " << ret.parse_errors << " parse errors in " << filename
-              << "\n";
+    err << "Found " << ret.parse_errors << " parse errors in " << filename
+        << "\n";
   }
 
   return ret;
 }
 
+Stats parse_includes(ProguardConfiguration* pg_config) {
+  Stats ret{};
+  for (const auto& included_filename : pg_config->includes) {
+    if (pg_config->already_included.find(included_filename) !=
+        pg_config->already_included.end()) {
+      continue;
+    }
+    pg_config->already_included.emplace(included_filename);
+    ret += parse_file(included_filename, pg_config);
+  }
+  return ret;
+}
+
+// Appends what was parsed into `from` to `to`, as if it had been parsed into
+// `to` directly. `from` must have been parsed into an empty configuration.
+void merge(ProguardConfiguration&& from, ProguardConfiguration* to) {
+  to->ok = from.ok;
+  move_vector_elements(from.includes, to->includes);
+  if (!from.basedirectory.empty()) {
+    to->basedirectory = std::move(from.basedirectory);
+  }
+  move_vector_elements(from.injars, to->injars);
+  move_vector_elements(from.outjars, to->outjars);
+  move_vector_elements(from.libraryjars, to->libraryjars);
+  move_vector_elements(from.printmapping, to->printmapping);
+  move_vector_elements(from.printconfiguration, to->printconfiguration);
+  move_vector_elements(from.printseeds, to->printseeds);
+  move_vector_elements(from.printusage, to->printusage);
+  move_vector_elements(from.keepdirectories, to->keepdirectories);
+  // Commands can only turn these options from their default to the other
+  // value.
+  to->shrink &= from.shrink;
+  to->optimize &= from.optimize;
+  to->allowaccessmodification |= from.allowaccessmodification;
+  to->dontobfuscate |= from.dontobfuscate;
+  to->dontusemixedcaseclassnames |= from.dontusemixedcaseclassnames;
+  to->dontpreverify |= from.dontpreverify;
+  to->verbose |= from.verbose;
+  if (!from.target_version.empty()) {
+    to->target_version = std::move(from.target_version);
+  }
+  to->keep_rules.merge(std::move(from.keep_rules));
+  to->assumenosideeffects_rules.merge(
+      std::move(from.assumenosideeffects_rules));
+  to->assumevalues_rules.merge(std::move(from.assumevalues_rules));
+  to->whyareyoukeeping_rules.merge(std::move(from.whyareyoukeeping_rules));
+  move_vector_elements(from.optimization_filters, to->optimization_filters);
+  move_vector_elements(from.keepattributes, to->keepattributes);
+  move_vector_elements(from.dontwarn, to->dontwarn);
+  move_vector_elements(from.keeppackagenames, to->keeppackagenames);
+}
+
 } // namespace
 
 Stats parse(std::istream& config,
@@ -1209,15 +1269,53 @@ Stats parse_file(const std::string& filename,
     std::string_view view(data, s);
     ret += parse(view, pg_config, filename);
     // Parse the included files.
-    for (const auto& included_filename : pg_config->includes) {
-      if (pg_config->already_included.find(included_filename) !=
-          pg_config->already_included.end()) {
-        continue;
-      }
-      pg_config->already_included.emplace(included_filename);
-      ret += parse_file(included_filename, pg_config);
+    ret += parse_includes(pg_config);
+  });
+  return ret;
+}
+
+Stats parse_files(const std::vector<std::string>& filenames,
+                  ProguardConfiguration* pg_config) {
+  // Each file is parsed on its own, as if no -basedirectory had been given
+  // before it, and the problems it reports are buffered.
+  struct ParsedFile {
+    ProguardConfiguration pg_config;
+    Stats stats;
+    std::ostringstream err;
+    std::exception_ptr error;
+  };
+  std::vector<ParsedFile> parsed(filenames.size());
+  workqueue_run_for<size_t>(0, filenames.size(), [&](size_t i) {
+    auto& file = parsed[i];
+    try {
+      redex::read_file_with_contents(
+          filenames[i], [&](const char* data, size_t s) {
+            file.stats = parse(std::string_view(data, s), &file.pg_config,
+                               filenames[i], file.err);
+          });
+    } catch (...) {
+      file.error = std::current_exception();
     }
   });
+
+  // Merge the files in order, along with the files they include. A file that
+  // follows a -basedirectory command is parsed again, as that directory
+  // applies to the paths of its commands.
+  Stats ret{};
+  for (size_t i = 0; i < filenames.size(); i++) {
+    if (!pg_config->basedirectory.empty()) {
+      ret += parse_file(filenames[i], pg_config);
+      continue;
+    }
+    auto& file = parsed[i];
+    std::cerr << file.err.str();
+    if (file.error) {
+      std::rethrow_exception(file.error);
+    }
+    merge(std::move(file.pg_config), pg_config);
+    ret += file.stats;
+    ret += parse_includes(pg_config);
+  }
   return ret;
 }
 
@@ -9,6 +9,7 @@
 
 #include <iosfwd>
 #include <string>
+#include <vector>
 
 #include "ProguardConfiguration.h"
 
@@ -31,6 +32,13 @@ struct Stats {
 };
 
 Stats parse_file(const std::string& filename, ProguardConfiguration* pg_config);
+
+/*
+ * Same as calling parse_file on each file in order, but the files are parsed
+ * in parallel, then merged in order.
+ */
+Stats parse_files(const std::vector<std::string>& filenames,
+                  ProguardConfiguration* pg_config);
 Stats parse(std::istream& config,
             ProguardConfiguration* pg_config,
             const std::string& filename = "");
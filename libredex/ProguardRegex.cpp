@@ -158,6 +158,28 @@ bool has_special_char(const std::string& proguard_regex) {
   return false;
 }
 
+// Return the longest literal string that every type matched by
+// form_type_regex(proguard_regex) starts with. An empty result means the
+// pattern can match types with any prefix.
+// Example: "Lalpha/*/beta;" -> "Lalpha/"
+// Example: "Lalpha$?;" -> "Lalpha$"
+std::string type_regex_literal_prefix(const std::string& proguard_regex) {
+  // An alternation anywhere in the pattern makes any prefix unreliable.
+  if (proguard_regex.find('|') != std::string::npos) {
+    return "";
+  }
+  size_t len = 0;
+  for (; len < proguard_regex.size(); len++) {
+    // '$', '/' and '[' are escaped by form_type_regex and stay literal.
+    const char ch = proguard_regex[len];
+    if (ch != '$' && ch != '/' && ch != '[' &&
+        has_special_char(std::string(1, ch))) {
+      break;
+    }
+  }
+  return proguard_regex.substr(0, len);
+}
+
 // Convert a ProGuard Java type type which may use wildcards to
 // an internal JVM type descriptor with the wildcards preserved.
 std::string convert_wildcard_type(const std::string& typ) {
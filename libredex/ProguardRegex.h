@@ -16,6 +16,7 @@ namespace proguard_parser {
 std::string form_member_regex(const std::string& proguard_regex);
 std::string form_type_regex(const std::string& proguard_regex);
 bool has_special_char(const std::string& proguard_regex);
+std::string type_regex_literal_prefix(const std::string& proguard_regex);
 std::string convert_wildcard_type(const std::string& typ);
 std::string convert_wildcard_type(std::string_view typ);
 
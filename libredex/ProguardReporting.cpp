@@ -7,10 +7,12 @@
 
 #include "ProguardReporting.h"
 
+#include <algorithm>
 #include <iostream>
 #include <ostream>
 
 #include "DexClass.h"
+#include "ProguardPrintConfiguration.h"
 #include "ReachableClasses.h"
 
 std::string_view extract_suffix(std::string_view class_name) {
@@ -214,3 +216,23 @@ void redex::print_classes(std::ostream& output,
     }
   }
 }
+
+void redex::print_keep_rule_match_times(
+    std::ostream& output,
+    const ConcurrentMap<const keep_rules::KeepSpec*, uint64_t>& match_times) {
+  std::vector<std::pair<uint64_t, std::string>> lines;
+  lines.reserve(match_times.size());
+  for (const auto& [keep_rule, microseconds] : match_times) {
+    lines.emplace_back(microseconds, keep_rules::show_keep(*keep_rule));
+  }
+  // Slowest first; ties broken by rule text to keep the output deterministic.
+  std::sort(lines.begin(), lines.end(), [](const auto& a, const auto& b) {
+    if (a.first != b.first) {
+      return a.first > b.first;
+    }
+    return a.second < b.second;
+  });
+  for (const auto& [microseconds, rule] : lines) {
+    output << microseconds << "\t" << rule << std::endl;
+  }
+}
@@ -9,8 +9,10 @@
 
 #include <iosfwd>
 
+#include "ConcurrentContainers.h"
 #include "DexClass.h"
 #include "DexUtil.h"
+#include "ProguardConfiguration.h"
 #include "ProguardMap.h"
 
 namespace redex {
@@ -44,4 +46,10 @@ void print_class(std::ostream& output,
 void print_classes(std::ostream& output,
                    const ProguardMap& pg_map,
                    const Scope& classes);
+
+// Prints one keep rule per line, slowest first, prefixed by the number of
+// microseconds spent matching it against classes.
+void print_keep_rule_match_times(
+    std::ostream& output,
+    const ConcurrentMap<const keep_rules::KeepSpec*, uint64_t>& match_times);
 } // namespace redex
@@ -8,31 +8,25 @@
 #include "Purity.h"
 
 #include <algorithm>
+#include <atomic>
 #include <iterator>
+#include <limits>
 #include <sstream>
 #include <vector>
 
-#include <sparta/WeakTopologicalOrdering.h>
-
 #include "ConfigFiles.h"
 #include "ControlFlow.h"
 #include "DexClass.h"
+#include "DexUtil.h"
 #include "EditableCfgAdapter.h"
 #include "IRInstruction.h"
 #include "Resolver.h"
 #include "Show.h"
-#include "StlUtil.h"
 #include "Timer.h"
 #include "Trace.h"
 #include "Walkers.h"
 #include "WorkQueue.h"
 
-namespace {
-
-constexpr double kWtoOrderingThreshold = 50.0;
-
-} // namespace
-
 std::ostream& operator<<(std::ostream& o, const CseLocation& l) {
   switch (l.special_location) {
   case CseSpecialLocations::GENERAL_MEMORY_BARRIER:
@@ -458,224 +452,79 @@ bool process_base_and_overriding_methods(
 
 namespace {
 
-AccumulatingTimer s_wto_timer("compute_locations_closure_wto");
-
-class WtoOrdering {
-  static constexpr const DexMethod* WTO_ROOT = nullptr;
-
-  struct FirstIterationData {
-    std::vector<const DexMethod*> root_cache;
-    std::unordered_map<const DexMethod*, std::vector<const DexMethod*>>&
-        inverse_dependencies;
-    const std::vector<const DexMethod*> empty{};
-
-    const std::vector<const DexMethod*>& get(const DexMethod* m) {
-      if (m == WTO_ROOT) {
-        // Pre-initialized and pre-sorted
-        return root_cache;
-      }
-      auto it = inverse_dependencies.find(m);
-      if (it != inverse_dependencies.end()) {
-        // Pre-sorted
-        return it->second;
-      }
-      return empty;
-    }
+AccumulatingTimer s_closure_timer("compute_locations_closure");
+
+constexpr uint32_t kNoIndex = std::numeric_limits<uint32_t>::max();
+
+// Tarjan's algorithm, iteratively, over the dependencies between numbered
+// methods. The components are returned in reverse topological order, i.e.
+// every component comes after the components it depends on.
+std::vector<std::vector<uint32_t>> get_strongly_connected_components(
+    const std::vector<std::vector<uint32_t>>& dependencies) {
+  uint32_t size = dependencies.size();
+  std::vector<uint32_t> index(size, kNoIndex);
+  std::vector<uint32_t> lowlink(size);
+  std::vector<bool> on_stack(size, false);
+  std::vector<uint32_t> stack;
+  // The methods being visited, with the position of the next dependency.
+  std::vector<std::pair<uint32_t, size_t>> visiting;
+  uint32_t next_index = 0;
+  std::vector<std::vector<uint32_t>> components;
+  auto visit = [&](uint32_t v) {
+    index[v] = lowlink[v] = next_index++;
+    stack.push_back(v);
+    on_stack[v] = true;
+    visiting.emplace_back(v, 0);
   };
-
-  static FirstIterationData create_first_iteration_data(
-      std::unordered_map<const DexMethod*, std::vector<const DexMethod*>>&
-          inverse_dependencies,
-      const std::unordered_set<const DexMethod*>& impacted_methods) {
-    std::vector<const DexMethod*> wto_nodes{WTO_ROOT};
-    wto_nodes.reserve(wto_nodes.size() + impacted_methods.size());
-    wto_nodes.insert(wto_nodes.end(), impacted_methods.begin(),
-                     impacted_methods.end());
-
-    // In the first iteration, besides computing the sorted root successors, we
-    // also sort all inverse_dependencies entries in-place. They represent the
-    // full successor vectors.
-    std::vector<const DexMethod*> root_cache;
-    workqueue_run<const DexMethod*>(
-        [&inverse_dependencies, &root_cache,
-         &impacted_methods](const DexMethod* m) {
-          if (m == WTO_ROOT) {
-            root_cache = get_sorted_impacted_methods(impacted_methods);
-            return;
-          }
-          auto it = inverse_dependencies.find(m);
-          if (it != inverse_dependencies.end()) {
-            auto& entries = it->second;
-            entries.shrink_to_fit();
-            std::sort(entries.begin(), entries.end(), compare_dexmethods);
-          }
-        },
-        wto_nodes);
-
-    return {std::move(root_cache), inverse_dependencies};
-  }
-
-  struct OtherIterationData {
-    InsertOnlyConcurrentMap<const DexMethod*, std::vector<const DexMethod*>>
-        concurrent_cache;
-
-    const std::vector<const DexMethod*>& get(const DexMethod* const& m) {
-      return concurrent_cache.at_unsafe(m);
+  for (uint32_t root = 0; root < size; root++) {
+    if (index[root] != kNoIndex) {
+      continue;
     }
-  };
-
-  static OtherIterationData create_other_iteration_data(
-      std::unordered_map<const DexMethod*, std::vector<const DexMethod*>>&
-          inverse_dependencies,
-      const std::unordered_set<const DexMethod*>& impacted_methods) {
-    std::vector<const DexMethod*> wto_nodes{WTO_ROOT};
-    wto_nodes.reserve(wto_nodes.size() + impacted_methods.size());
-    wto_nodes.insert(wto_nodes.end(), impacted_methods.begin(),
-                     impacted_methods.end());
-
-    // In subsequent iteration, besides computing the sorted root successors
-    // again, we also filter all previously sorted inverse_dependencies entries.
-    InsertOnlyConcurrentMap<const DexMethod*, std::vector<const DexMethod*>>
-        concurrent_cache;
-    workqueue_run<const DexMethod*>(
-        [&impacted_methods, &concurrent_cache,
-         &inverse_dependencies](const DexMethod* m) {
-          std::vector<const DexMethod*> successors;
-          if (m == WTO_ROOT) {
-            // Re-initialize and re-sort
-            successors = get_sorted_impacted_methods(impacted_methods);
-          }
-          auto it = inverse_dependencies.find(m);
-          if (it != inverse_dependencies.end()) {
-            // Note that we are filtering on an already pre-sorted vector
-            for (auto n : it->second) {
-              if (impacted_methods.count(n)) {
-                successors.push_back(n);
-              }
-            }
-          }
-          auto [_, emplaced] =
-              concurrent_cache.emplace(m, std::move(successors));
-          always_assert(emplaced);
-        },
-        wto_nodes);
-
-    return {std::move(concurrent_cache)};
-  }
-
-  static std::vector<const DexMethod*> get_sorted_impacted_methods(
-      const std::unordered_set<const DexMethod*>& impacted_methods) {
-    std::vector<const DexMethod*> successors;
-    successors.reserve(impacted_methods.size());
-    successors.insert(successors.end(), impacted_methods.begin(),
-                      impacted_methods.end());
-    std::sort(successors.begin(), successors.end(), compare_dexmethods);
-    return successors;
-  }
-
-  static std::vector<const DexMethod*> sort_by_inverse_deps(
-      const std::unordered_set<const DexMethod*>& impacted_methods,
-      const std::unordered_map<const DexMethod*, std::vector<const DexMethod*>>&
-          inverse_dependencies) {
-    // First translate to pair to avoid repeated map lookups.
-    std::vector<std::pair<const DexMethod*, size_t>> sorted_by_inv_deps;
-    sorted_by_inv_deps.reserve(impacted_methods.size());
-    std::transform(impacted_methods.begin(), impacted_methods.end(),
-                   std::back_inserter(sorted_by_inv_deps),
-                   [&inverse_dependencies](auto* m) {
-                     auto it = inverse_dependencies.find(m);
-                     return std::make_pair(m, it != inverse_dependencies.end()
-                                                  ? it->second.size()
-                                                  : 0);
-                   });
-    std::sort(sorted_by_inv_deps.begin(), sorted_by_inv_deps.end(),
-              [](const std::pair<const DexMethod*, size_t>& lhs,
-                 const std::pair<const DexMethod*, size_t>& rhs) {
-                if (lhs.second != rhs.second) {
-                  return lhs.second > rhs.second;
-                }
-                return compare_dexmethods(lhs.first, rhs.first);
-              });
-    std::vector<const DexMethod*> res;
-    res.reserve(impacted_methods.size());
-    std::transform(sorted_by_inv_deps.begin(), sorted_by_inv_deps.end(),
-                   std::back_inserter(res),
-                   [](const auto& p) { return p.first; });
-    return res;
-  }
-
-  // We saw big slowdowns when there are too many components, possibly
-  // driven by the fact there is a lot of dependencies.
-  template <typename SuccFn>
-  static void run_wto(const SuccFn& succ_fn,
-                      std::vector<const DexMethod*>& ordered_impacted_methods) {
-    sparta::WeakTopologicalOrdering<const DexMethod*> wto(WTO_ROOT, succ_fn);
-    wto.visit_depth_first([&ordered_impacted_methods](const DexMethod* m) {
-      if (m) {
-        ordered_impacted_methods.push_back(m);
+    visit(root);
+    while (!visiting.empty()) {
+      uint32_t v = visiting.back().first;
+      size_t& pos = visiting.back().second;
+      if (pos < dependencies[v].size()) {
+        uint32_t w = dependencies[v][pos++];
+        if (index[w] == kNoIndex) {
+          visit(w);
+        } else if (on_stack[w]) {
+          lowlink[v] = std::min(lowlink[v], index[w]);
+        }
+        continue;
       }
-    });
-  }
-
-  static bool should_use_wto(
-      const std::unordered_set<const DexMethod*>& impacted_methods,
-      const std::unordered_map<const DexMethod*, std::vector<const DexMethod*>>&
-          inverse_dependencies) {
-    size_t impacted_methods_size = impacted_methods.size();
-    size_t inv_dep_sum{0}, inv_dep_max{0};
-    for (auto& entry : inverse_dependencies) {
-      inv_dep_sum += entry.second.size();
-      inv_dep_max = std::max(inv_dep_max, entry.second.size());
+      visiting.pop_back();
+      if (!visiting.empty()) {
+        uint32_t u = visiting.back().first;
+        lowlink[u] = std::min(lowlink[u], lowlink[v]);
+      }
+      if (lowlink[v] != index[v]) {
+        continue;
+      }
+      auto& component = components.emplace_back();
+      uint32_t w;
+      do {
+        w = stack.back();
+        stack.pop_back();
+        on_stack[w] = false;
+        component.push_back(w);
+      } while (w != v);
     }
-    auto inv_dep_avg = ((double)inv_dep_sum) / inverse_dependencies.size();
-    // Purity is too low-level for nice configuration switches. Think
-    // about it.
-    TRACE(CSE, 4,
-          "UseWto: impacted methods = %zu inverse_deps_max = %zu "
-          "inverse_deps avg = %.2f",
-          impacted_methods_size, inv_dep_max, inv_dep_avg);
-    return inv_dep_avg < kWtoOrderingThreshold;
   }
+  return components;
+}
 
- public:
-  static std::vector<const DexMethod*> order_impacted_methods(
-      const std::unordered_set<const DexMethod*>& impacted_methods,
-      std::unordered_map<const DexMethod*, std::vector<const DexMethod*>>&
-          inverse_dependencies,
-      size_t iterations) {
-    Timer prepare_wto{"Prepare Ordering"};
-    auto wto_timer_scope = s_wto_timer.scope();
-
-    std::vector<const DexMethod*> ordered_impacted_methods;
-
-    // To avoid std::function overhead we have to split here.
-    if (iterations == 1 &&
-        should_use_wto(impacted_methods, inverse_dependencies)) {
-      auto first_data =
-          create_first_iteration_data(inverse_dependencies, impacted_methods);
-      run_wto(
-          [&first_data](
-              const DexMethod* m) -> const std::vector<const DexMethod*>& {
-            return first_data.get(m);
-          },
-          ordered_impacted_methods);
-    } else if (iterations == 1) {
-      // Simple sorting for determinism.
-      ordered_impacted_methods =
-          sort_by_inverse_deps(impacted_methods, inverse_dependencies);
-    } else {
-      auto other_data =
-          create_other_iteration_data(inverse_dependencies, impacted_methods);
-      run_wto(
-          [&other_data](
-              const DexMethod* m) -> const std::vector<const DexMethod*>& {
-            return other_data.get(m);
-          },
-          ordered_impacted_methods);
-    }
-
-    return ordered_impacted_methods;
-  }
+struct Component {
+  std::vector<uint32_t> methods;
+  std::vector<uint32_t> dependencies;
+  std::vector<uint32_t> dependents;
+  // Dependencies that have not been computed yet.
+  std::atomic<size_t> pending{0};
+  // Only written by the worker computing this component, and read by the
+  // workers of its dependents after they observed pending reaching zero.
+  bool unknown{false};
+  size_t level{0};
+  CseUnorderedLocationSet locations;
 };
 
 template <typename InitFuncT>
@@ -684,6 +533,8 @@ size_t compute_locations_closure_impl(
     const method_override_graph::Graph* method_override_graph,
     const InitFuncT& init_func,
     std::unordered_map<const DexMethod*, CseUnorderedLocationSet>* result) {
+  auto timer_scope = s_closure_timer.scope();
+
   // 1. Let's initialize known method read locations and dependencies by
   //    scanning method bodies
   InsertOnlyConcurrentMap<const DexMethod*, LocationsAndDependencies>
@@ -698,100 +549,138 @@ size_t compute_locations_closure_impl(
     });
   }
 
-  // 2. Compute inverse dependencies so that we know what needs to be recomputed
-  // during the fixpoint computation, and determine set of methods that are
-  // initially "impacted" in the sense that they have dependencies.
-  std::unordered_map<const DexMethod*, std::vector<const DexMethod*>>
-      inverse_dependencies;
-  std::unordered_set<const DexMethod*> impacted_methods;
-  {
-    Timer t{"Compute inverse dependencies"};
-    for (auto&& [method, lads] : method_lads) {
-      if (!lads.dependencies.empty()) {
-        for (auto d : lads.dependencies) {
-          inverse_dependencies[d].push_back(method);
-        }
-        impacted_methods.insert(method);
-      }
-    }
+  // 2. Number the methods deterministically, and translate their
+  //    dependencies. Methods for which information is directly absent are
+  //    equivalent to a general memory barrier, and so is any method that
+  //    depends on them.
+  std::vector<const DexMethod*> methods;
+  methods.reserve(method_lads.size());
+  for (auto&& [method, _] : method_lads) {
+    methods.push_back(method);
   }
-
-  // 3. Let's try to (semantically) inline locations, computing a fixed
-  //    point. Methods for which information is directly or indirectly absent
-  //    are equivalent to a general memory barrier, and are systematically
-  //    pruned.
-
-  // TODO: Instead of custom fixpoint computation using WTO, consider using the
-  // MonotonicFixpointIterator, operating on a callgraph, capture the
-  // dependencies, and have the Locations as the abstract domain.
-
-  size_t iterations = 0;
-  while (!impacted_methods.empty()) {
-    iterations++;
-    Timer t{std::string("Iteration ") + std::to_string(iterations)};
-
-    // We order the impacted methods in a deterministic way that's likely
-    // helping to reduce the number of needed iterations.
-    auto ordered_impacted_methods = WtoOrdering::order_impacted_methods(
-        impacted_methods, inverse_dependencies, iterations);
-    impacted_methods.clear();
-
-    std::vector<const DexMethod*> changed_methods;
-    for (const DexMethod* method : ordered_impacted_methods) {
-      auto& lads = method_lads.at_unsafe(method);
-      bool unknown = false;
-      size_t lads_locations_size = lads.locations.size();
+  std::sort(methods.begin(), methods.end(), compare_dexmethods);
+  std::unordered_map<const DexMethod*, uint32_t> ids;
+  ids.reserve(methods.size());
+  for (uint32_t i = 0; i < methods.size(); i++) {
+    ids.emplace(methods[i], i);
+  }
+  std::vector<std::vector<uint32_t>> dependencies(methods.size());
+  std::vector<uint8_t> unknown(methods.size(), false);
+  {
+    Timer t{"Translate dependencies"};
+    workqueue_run_for<uint32_t>(0, methods.size(), [&](uint32_t i) {
+      auto& deps = dependencies[i];
+      const auto& lads = method_lads.at_unsafe(methods[i]);
       for (const DexMethod* d : lads.dependencies) {
-        if (d == method) {
+        if (d == methods[i]) {
           continue;
         }
-        auto it = method_lads.find(d);
-        if (it == method_lads.end()) {
-          unknown = true;
-          break;
+        auto it = ids.find(d);
+        if (it == ids.end()) {
+          unknown[i] = true;
+          deps.clear();
+          return;
         }
-        const auto& other_locations = it->second.locations;
-        lads.locations.insert(other_locations.begin(), other_locations.end());
+        deps.push_back(it->second);
       }
-      if (unknown || lads_locations_size < lads.locations.size()) {
-        // something changed
-        changed_methods.push_back(method);
-        if (unknown) {
-          method_lads.erase_unsafe(method);
-        }
+      std::sort(deps.begin(), deps.end());
+    });
+  }
+
+  // 3. Condense the dependencies into their strongly connected components.
+  //    All methods of a component end up with the same locations.
+  std::vector<std::vector<uint32_t>> sccs;
+  {
+    Timer t{"Compute strongly connected components"};
+    sccs = get_strongly_connected_components(dependencies);
+  }
+  std::vector<Component> components(sccs.size());
+  {
+    std::vector<uint32_t> component_of(methods.size());
+    for (uint32_t c = 0; c < sccs.size(); c++) {
+      for (auto m : sccs[c]) {
+        component_of[m] = c;
       }
+      components[c].methods = std::move(sccs[c]);
     }
-
-    // Given set of changed methods, determine set of dependents for which
-    // we need to re-run the analysis in another iteration.
-    for (auto changed_method : changed_methods) {
-      auto it = inverse_dependencies.find(changed_method);
-      if (it == inverse_dependencies.end()) {
-        continue;
+    for (uint32_t c = 0; c < components.size(); c++) {
+      auto& component = components[c];
+      for (auto m : component.methods) {
+        for (auto d : dependencies[m]) {
+          if (component_of[d] != c) {
+            component.dependencies.push_back(component_of[d]);
+          }
+        }
+      }
+      sort_unique(component.dependencies);
+      component.pending = component.dependencies.size();
+      for (auto d : component.dependencies) {
+        components[d].dependents.push_back(c);
       }
+    }
+  }
 
-      // remove inverse dependency entries as appropriate
-      auto& entries = it->second;
-      std20::erase_if(entries,
-                      [&](auto* m) { return !method_lads.count_unsafe(m); });
-
-      if (entries.empty()) {
-        // remove inverse dependency
-        inverse_dependencies.erase(changed_method);
-      } else {
-        // add inverse dependencies entries to impacted methods
-        impacted_methods.insert(entries.begin(), entries.end());
+  // 4. Let's (semantically) inline locations, computing each component once
+  //    all the components it depends on are done. A component that depends on
+  //    an unknown component is unknown without looking at any locations.
+  {
+    Timer t{"Compute closure"};
+    auto wq = workqueue_foreach<uint32_t>(
+        [&](sparta::WorkerState<uint32_t>* worker_state, uint32_t c) {
+          auto& component = components[c];
+          bool has_dependencies = component.methods.size() > 1 ||
+                                  !component.dependencies.empty();
+          for (auto m : component.methods) {
+            has_dependencies |= unknown[m];
+            component.unknown |= unknown[m];
+          }
+          size_t max_level = 0;
+          for (auto d : component.dependencies) {
+            component.unknown |= components[d].unknown;
+            max_level = std::max(max_level, components[d].level);
+          }
+          component.level = has_dependencies ? max_level + 1 : 0;
+          if (!component.unknown) {
+            for (auto m : component.methods) {
+              const auto& lads = method_lads.at_unsafe(methods[m]);
+              component.locations.insert(lads.locations.begin(),
+                                         lads.locations.end());
+            }
+            for (auto d : component.dependencies) {
+              const auto& locations = components[d].locations;
+              component.locations.insert(locations.begin(), locations.end());
+            }
+          }
+          for (auto d : component.dependents) {
+            if (components[d].pending.fetch_sub(1) == 1) {
+              worker_state->push_task(d);
+            }
+          }
+        },
+        redex_parallel::default_num_threads(),
+        /*push_tasks_while_running=*/true);
+    for (uint32_t c = 0; c < components.size(); c++) {
+      if (components[c].dependencies.empty()) {
+        wq.add_item(c);
       }
     }
+    wq.run_all();
   }
 
   // For all methods which have a known set of locations at this point,
   // persist that information
-  for (auto&& [method, lads] : method_lads) {
-    result->emplace(method, std::move(lads.locations));
+  size_t levels = 0;
+  for (auto& component : components) {
+    levels = std::max(levels, component.level);
+    if (component.unknown) {
+      continue;
+    }
+    for (auto m : component.methods) {
+      result->emplace(methods[m], component.locations);
+    }
   }
 
-  return iterations;
+  return levels;
 }
 
 } // namespace
@@ -147,8 +147,10 @@ bool process_base_and_overriding_methods(
 // account all overriding methods.
 // When encountering unknown method implementations, the resulting map will have
 // no entry for the relevant (base) methods.
-// The return value indicates how many iterations the fixed-point computation
-// required.
+// The closure is computed over the strongly connected components of the
+// dependencies, in parallel, each component once all the ones it depends on
+// are done. The return value is the length of the longest chain of
+// components with dependencies.
 size_t compute_locations_closure(
     const Scope& scope,
     const method_override_graph::Graph* method_override_graph,
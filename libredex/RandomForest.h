@@ -10,8 +10,11 @@
 #include <algorithm>
 #include <fstream>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <sstream>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -208,9 +211,103 @@ class Forest {
     if (c != nullptr) {
       *c = acc_sum;
     }
-    return 2 * acc_sum >= m_trees.size();
+    return accepts(acc_sum);
   }
 
+  // Whether the given sum of tree values, as computed by accept or by
+  // Flat::evaluate, accepts.
+  bool accepts(float acc_sum) const { return 2 * acc_sum >= m_trees.size(); }
+
+  // A flattened copy of a forest that evaluates many inputs at once. The
+  // feature values of all inputs are first gathered into one column per
+  // feature. Each tree is then walked for all inputs in lockstep over plain
+  // arrays. Leaves loop back to themselves, so that every walk takes as many
+  // steps as the tree is deep, and no step branches on the data.
+  class Flat {
+   public:
+    explicit Flat(const Forest& forest) {
+      std::unordered_map<std::string, uint32_t> feature_indices;
+      for (const auto& tree : forest.m_trees) {
+        m_roots.push_back(m_thresholds.size());
+        m_depths.push_back(add_node(tree.get(), &feature_indices));
+      }
+    }
+
+    size_t num_features() const { return m_feature_fns.size(); }
+
+    // Returns, for each input, the sum of the values of all trees.
+    std::vector<float> evaluate(
+        const std::vector<std::tuple<Args...>>& inputs) const {
+      const size_t n = inputs.size();
+      std::vector<float> columns(m_feature_fns.size() * n);
+      for (size_t f = 0; f < m_feature_fns.size(); ++f) {
+        auto* column = columns.data() + f * n;
+        for (size_t i = 0; i < n; ++i) {
+          column[i] = std::apply(m_feature_fns[f], inputs[i]);
+        }
+      }
+
+      std::vector<float> sums(n, 0);
+      std::vector<uint32_t> nodes(n);
+      for (size_t t = 0; t < m_roots.size(); ++t) {
+        std::fill(nodes.begin(), nodes.end(), m_roots[t]);
+        for (size_t d = 0; d < m_depths[t]; ++d) {
+          for (size_t i = 0; i < n; ++i) {
+            auto node = nodes[i];
+            auto val = columns[m_features[node] * n + i];
+            nodes[i] = m_children[2 * node + !(val <= m_thresholds[node])];
+          }
+        }
+        for (size_t i = 0; i < n; ++i) {
+          sums[i] += m_values[nodes[i]];
+        }
+      }
+      return sums;
+    }
+
+   private:
+    // Appends the given subtree, and returns its depth.
+    size_t add_node(
+        const DecisionTreeNode* node,
+        std::unordered_map<std::string, uint32_t>* feature_indices) {
+      uint32_t idx = m_thresholds.size();
+      m_features.push_back(0);
+      m_thresholds.push_back(std::numeric_limits<float>::infinity());
+      m_values.push_back(0);
+      m_children.push_back(idx);
+      m_children.push_back(idx);
+
+      if (auto* category = dynamic_cast<const DecisionTreeCategory*>(node)) {
+        m_values[idx] = category->acc;
+        return 0;
+      }
+      auto* feature = dynamic_cast<const DecisionTreeFeature*>(node);
+      always_assert(feature != nullptr);
+      auto [it, emplaced] = feature_indices->emplace(feature->feature_name,
+                                                     m_feature_fns.size());
+      if (emplaced) {
+        m_feature_fns.push_back(feature->feature_fn);
+      }
+      m_features[idx] = it->second;
+      m_thresholds[idx] = feature->threshold;
+      m_children[2 * idx] = m_thresholds.size();
+      auto true_depth = add_node(feature->true_branch.get(), feature_indices);
+      m_children[2 * idx + 1] = m_thresholds.size();
+      auto false_depth = add_node(feature->false_branch.get(), feature_indices);
+      return 1 + std::max(true_depth, false_depth);
+    }
+
+    std::vector<typename DecisionTreeFeature::FeatureFn> m_feature_fns;
+    std::vector<uint32_t> m_roots;
+    std::vector<size_t> m_depths;
+    // Per node. A leaf has an infinite threshold, and itself as children.
+    std::vector<uint32_t> m_features;
+    std::vector<float> m_thresholds;
+    std::vector<float> m_values;
+    // Per node, the true and then the false child.
+    std::vector<uint32_t> m_children;
+  };
+
   std::string dump() const {
     std::ostringstream oss;
     bool first = true;
@@ -20,6 +20,7 @@
 #include "PassManager.h"
 #include "ProguardConfiguration.h"
 #include "ReachableClasses.h"
+#include "RedexContext.h"
 #include "Resolver.h"
 #include "Show.h"
 #include "StlUtil.h"
@@ -1914,10 +1915,14 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects(
     bool cfg_gathering_check_instance_callable,
     bool cfg_gathering_check_returning,
     bool should_mark_all_as_seed,
-    bool remove_no_argument_constructors) {
+    bool remove_no_argument_constructors,
+    bool dense_marks) {
   Timer t("Marking");
   std::unordered_set<const DexClass*> scope_set(scope.begin(), scope.end());
   auto reachable_objects = std::make_unique<ReachableObjects>();
+  if (dense_marks) {
+    reachable_objects->use_dense_marks(scope);
+  }
   ConditionallyMarked cond_marked;
 
   ConcurrentSet<ReachableObject, ReachableObjectHash> root_set;
@@ -1970,6 +1975,23 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects(
   return reachable_objects;
 }
 
+void ReachableObjects::use_dense_marks(const Scope& scope) {
+  std::vector<const DexClass*> classes(scope.begin(), scope.end());
+  std::vector<const DexFieldRef*> fields;
+  std::vector<const DexMethodRef*> methods;
+  for (const auto* cls : scope) {
+    for (const auto* field : cls->get_all_fields()) {
+      fields.push_back(field);
+    }
+    for (const auto* method : cls->get_all_methods()) {
+      methods.push_back(method);
+    }
+  }
+  m_marked_classes.assign_dense_ids(classes);
+  m_marked_fields.assign_dense_ids(fields);
+  m_marked_methods.assign_dense_ids(methods);
+}
+
 void ReachableObjects::record_reachability(const DexMethodRef* member,
                                            const DexClass* cls) {
   // Each class member trivially retains its containing class; let's filter out
@@ -2143,6 +2165,7 @@ void sweep(DexStoresVector& stores,
       }
       cls->get_dmethods().clear();
       cls->get_vmethods().clear();
+      g_redex->invalidate_method_resolutions();
       auto anno_set = cls->get_anno_set();
       if (anno_set) {
         anno_set->get_annotations().clear();
@@ -2209,6 +2232,15 @@ void sweep_code(
     }
     always_assert(code->editable_cfg_built());
     auto& cfg = code->cfg();
+    // The body of an uncallable method is replaced wholesale, so there is no
+    // point in propagating throws through it first.
+    bool uncallable = uncallable_instance_methods.count(method) != 0;
+    if (uncallable &&
+        !(skip_uncallable_virtual_methods && method->is_virtual())) {
+      affected_methods->insert(method);
+      return remove_uninstantiables_impl::replace_all_with_unreachable_throw(
+          cfg);
+    }
     auto non_returning_it = reachable_aspects.non_returning_insns.find(method);
     if (non_returning_it != reachable_aspects.non_returning_insns.end()) {
       auto& non_returning_insns = non_returning_it->second;
@@ -2229,13 +2261,8 @@ void sweep_code(
       cfg.remove_unreachable_blocks();
       affected_methods->insert(method);
     }
-    if (uncallable_instance_methods.count(method)) {
-      if (skip_uncallable_virtual_methods && method->is_virtual()) {
-        return remove_uninstantiables_impl::Stats();
-      }
-      affected_methods->insert(method);
-      return remove_uninstantiables_impl::replace_all_with_unreachable_throw(
-          cfg);
+    if (uncallable) {
+      return remove_uninstantiables_impl::Stats();
     }
     auto stats = remove_uninstantiables_impl::replace_uninstantiable_refs(
         uninstantiable_types, cfg);
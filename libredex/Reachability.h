@@ -7,8 +7,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <WorkQueue.h>
 
@@ -112,6 +114,67 @@ using ReachableObjectGraph =
 
 struct ReachableAspects;
 
+/*
+ * Set of marked objects. Objects that were given a dense id up front are
+ * tracked in an atomic bitset, so that marking them only takes a lock-free
+ * fetch_or on an id looked up in a read-only map. All other objects, e.g.
+ * member refs without a definition in scope, fall back to a ConcurrentSet.
+ */
+template <typename T, size_t SLOTS>
+class DenseMarkSet {
+ public:
+  // Must be called before anything is marked.
+  void assign_dense_ids(const std::vector<const T*>& objects) {
+    always_assert(m_marked_dense == 0 && m_others.empty());
+    m_ids.reserve(objects.size());
+    for (const auto* obj : objects) {
+      m_ids.emplace(obj, m_ids.size());
+    }
+    m_words = std::vector<std::atomic<uint64_t>>((m_ids.size() + 63) / 64);
+  }
+
+  // Returns true if `obj` was not marked yet.
+  bool insert(const T* obj) {
+    auto it = m_ids.find(obj);
+    if (it == m_ids.end()) {
+      return m_others.insert(obj);
+    }
+    auto bit = uint64_t(1) << (it->second % 64);
+    if (m_words[it->second / 64].fetch_or(bit) & bit) {
+      return false;
+    }
+    m_marked_dense.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  bool count(const T* obj) const {
+    auto it = m_ids.find(obj);
+    if (it == m_ids.end()) {
+      return m_others.count(obj);
+    }
+    return m_words[it->second / 64].load() &
+           (uint64_t(1) << (it->second % 64));
+  }
+
+  bool count_unsafe(const T* obj) const {
+    auto it = m_ids.find(obj);
+    if (it == m_ids.end()) {
+      return m_others.count_unsafe(obj);
+    }
+    return m_words[it->second / 64].load(std::memory_order_relaxed) &
+           (uint64_t(1) << (it->second % 64));
+  }
+
+  size_t size() const { return m_marked_dense + m_others.size(); }
+
+ private:
+  std::unordered_map<const T*, size_t> m_ids;
+  std::vector<std::atomic<uint64_t>> m_words;
+  std::atomic<size_t> m_marked_dense{0};
+  ConcurrentSet<const T*, std::hash<const T*>, std::equal_to<const T*>, SLOTS>
+      m_others;
+};
+
 class ReachableObjects {
  public:
   const ReachableObjectGraph& retainers_of() const { return m_retainers_of; }
@@ -152,6 +215,11 @@ class ReachableObjects {
 
   size_t num_marked_methods() const { return m_marked_methods.size(); }
 
+  // Tracks the classes of `scope` and their members with dense ids in
+  // bitsets rather than in hashed concurrent sets. Must be called before
+  // anything is marked.
+  void use_dense_marks(const Scope& scope);
+
  private:
   template <class Seed>
   void record_is_seed(Seed* seed);
@@ -168,21 +236,9 @@ class ReachableObjects {
 
   static constexpr size_t MARK_SLOTS = 127;
 
-  ConcurrentSet<const DexClass*,
-                std::hash<const DexClass*>,
-                std::equal_to<const DexClass*>,
-                MARK_SLOTS>
-      m_marked_classes;
-  ConcurrentSet<const DexFieldRef*,
-                std::hash<const DexFieldRef*>,
-                std::equal_to<const DexFieldRef*>,
-                MARK_SLOTS>
-      m_marked_fields;
-  ConcurrentSet<const DexMethodRef*,
-                std::hash<const DexMethodRef*>,
-                std::equal_to<const DexMethodRef*>,
-                MARK_SLOTS>
-      m_marked_methods;
+  DenseMarkSet<DexClass, MARK_SLOTS> m_marked_classes;
+  DenseMarkSet<DexFieldRef, MARK_SLOTS> m_marked_fields;
+  DenseMarkSet<DexMethodRef, MARK_SLOTS> m_marked_methods;
   ReachableObjectGraph m_retainers_of;
 
   friend class RootSetMarker;
@@ -702,7 +758,8 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects(
     bool cfg_gathering_check_instance_callable = false,
     bool cfg_gathering_check_returning = false,
     bool should_mark_all_as_seed = false,
-    bool remove_no_argument_constructors = false);
+    bool remove_no_argument_constructors = false,
+    bool dense_marks = false);
 
 void compute_zombie_methods(
     const method_override_graph::Graph& method_override_graph,
@@ -21,8 +21,10 @@
 #include "DexClass.h"
 #include "FbjniMarker.h"
 #include "Match.h"
+#include "RedexContext.h"
 #include "RedexResources.h"
 #include "ReflectionAnalysis.h"
+#include "ReflectionAnalysisCache.h"
 #include "Show.h"
 #include "StringUtil.h"
 #include "Trace.h"
@@ -189,11 +191,11 @@ void analyze_reflection(const Scope& scope) {
     }
   };
 
-  reflection::MetadataCache refl_metadata_cache;
+  auto& reflection_analyses = g_redex->reflection_analyses();
 
   std::mutex mutation_mutex;
   walk::parallel::code(scope, [&](DexMethod* method, IRCode& code) {
-    std::unique_ptr<ReflectionAnalysis> analysis = nullptr;
+    std::shared_ptr<const ReflectionAnalysis> analysis = nullptr;
     code.build_cfg(true, false);
     auto& cfg = code.cfg();
     for (auto& mie : InstructionIterable(cfg)) {
@@ -217,15 +219,10 @@ void analyze_reflection(const Scope& scope) {
       }
       ReflectionType refl_type = refl_entry->second;
 
-      // Instantiating the analysis object also runs the reflection analysis
-      // on the method. So, we wait until we're sure we need it.
-      // We use a unique_ptr so that we'll still only have one per method.
+      // Getting the analysis may run the reflection analysis on the method.
+      // So, we wait until we're sure we need it.
       if (!analysis) {
-        analysis = std::make_unique<ReflectionAnalysis>(
-            /* dex_method */ method,
-            /* context (interprocedural only) */ nullptr,
-            /* summary_query_fn (interprocedural only) */ nullptr,
-            /* metadata_cache */ &refl_metadata_cache);
+        analysis = reflection_analyses.get(method);
       }
 
       const auto& arg_cls = analysis->get_abstract_object(insn->src(0), insn);
@@ -7,21 +7,30 @@
 
 #include "RedexContext.h"
 
+#include <algorithm>
+#include <array>
 #include <boost/thread/thread.hpp>
 #include <exception>
 #include <mutex>
 #include <regex>
 #include <sstream>
+#include <unordered_map>
 #include <unordered_set>
 
+#include "ControlFlow.h"
 #include "Debug.h"
+#include "DexAnnotation.h"
 #include "DexCallSite.h"
 #include "DexClass.h"
+#include "DexMethodHandle.h"
 #include "DexPosition.h"
 #include "DuplicateClasses.h"
+#include "IRCode.h"
 #include "KeepReason.h"
 #include "ProguardConfiguration.h"
+#include "ReflectionAnalysisCache.h"
 #include "Show.h"
+#include "StringUtil.h"
 #include "Timer.h"
 #include "Trace.h"
 #include "WorkQueue.h"
@@ -348,6 +357,41 @@ RedexContext::ConcurrentStringStorage::get_stats() const {
   return stats;
 }
 
+size_t RedexContext::ConcurrentStringStorage::release_dead_buffers(
+    const std::vector<const char*>& live) {
+  auto holds_live_string = [&live](const Container::Buffer* p) {
+    const char* begin = p->chars.get();
+    auto it = std::lower_bound(live.begin(), live.end(), begin);
+    return it != live.end() && *it < begin + p->used;
+  };
+  size_t released = 0;
+  auto release = [&](Container* storage) {
+    if (!storage || !storage->buffer) {
+      return;
+    }
+    // The head buffer is kept even if dead, as more strings get appended to
+    // it, and containers are assumed to always have one.
+    auto* prev = storage->buffer;
+    while (prev->next) {
+      const auto* p = prev->next;
+      if (holds_live_string(p)) {
+        prev = const_cast<Container::Buffer*>(p);
+        continue;
+      }
+      prev->next = p->next;
+      released += p->allocated;
+      delete p;
+    }
+  };
+  for (auto& slot : slots) {
+    release(slot.container.load());
+  }
+  for (auto& storage : pool) {
+    release(storage.get());
+  }
+  return released;
+}
+
 RedexContext::ConcurrentStringStorage::Context::~Context() {
   auto* other_container = owner->slots[index].container.exchange(container);
   if (other_container == nullptr) {
@@ -366,73 +410,72 @@ RedexContext::ConcurrentStringStorage::Context::~Context() {
   }
 }
 
-char* RedexContext::store_string(std::string_view str) {
-  ConcurrentStringStorage& concurrent_string_storage =
-      str.length() < s_small_string_storage.max_allocation
-          ? s_small_string_storage
-      : str.length() < s_medium_string_storage.max_allocation
-          ? s_medium_string_storage
-          : s_large_string_storage;
+RedexContext::ConcurrentStringStorage& RedexContext::string_storage_for(
+    size_t length) {
+  return length < s_small_string_storage.max_allocation ? s_small_string_storage
+         : length < s_medium_string_storage.max_allocation
+             ? s_medium_string_storage
+             : s_large_string_storage;
+}
+
+namespace {
+
+void copy_string(std::string_view str, char* storage) {
+  memcpy(storage, str.data(), str.length());
+  storage[str.length()] = 0;
+}
+
+uint32_t mutf8_next_cp(const char*& s) {
+  uint8_t v = *s++;
+  /* Simple common case first, a utf8 char... */
+  if (!(v & 0x80)) return v;
+  uint8_t v2 = *s++;
+  always_assert_type_log((v2 & 0xc0) == 0x80, INVALID_DEX,
+                         "Invalid 2nd byte on mutf8 string");
+  /* Two byte code point */
+  if ((v & 0xe0) == 0xc0) {
+    return (v & 0x1f) << 6 | (v2 & 0x3f);
+  }
+  /* Three byte code point */
+  always_assert_type_log((v & 0xf0) == 0xe0, INVALID_DEX,
+                         "Invalid size encoding mutf8 string");
+  uint8_t v3 = *s++;
+  always_assert_type_log((v2 & 0xc0) == 0x80, INVALID_DEX,
+                         "Invalid 3rd byte on mutf8 string");
+  return (v & 0x1f) << 12 | (v2 & 0x3f) << 6 | (v3 & 0x3f);
+}
+
+uint32_t length_of_utf8_string(const char* s) {
+  if (s == nullptr) {
+    return 0;
+  }
+  uint32_t len = 0;
+  while (*s != '\0') {
+    ++len;
+    mutf8_next_cp(s);
+  }
+  return len;
+}
+
+} // namespace
 
+char* RedexContext::store_string(std::string_view str) {
   char* storage;
   {
-    auto storage_context = concurrent_string_storage.get_context();
+    auto storage_context = string_storage_for(str.length()).get_context();
 
     // Note that DexStrings are keyed by a string_view created from the actual
     // storage. The string_view is valid until the storage is destroyed.
     storage = storage_context.container->allocate(str.length() + 1);
   }
-  memcpy(storage, str.data(), str.length());
-  storage[str.length()] = 0;
+  copy_string(str, storage);
   return storage;
 }
 
-const DexString* RedexContext::make_string(std::string_view str) {
-  auto mutf8_next_cp = [](const char*& s) -> uint32_t {
-    uint8_t v = *s++;
-    /* Simple common case first, a utf8 char... */
-    if (!(v & 0x80)) return v;
-    uint8_t v2 = *s++;
-    always_assert_type_log((v2 & 0xc0) == 0x80, INVALID_DEX,
-                           "Invalid 2nd byte on mutf8 string");
-    /* Two byte code point */
-    if ((v & 0xe0) == 0xc0) {
-      return (v & 0x1f) << 6 | (v2 & 0x3f);
-    }
-    /* Three byte code point */
-    always_assert_type_log((v & 0xf0) == 0xe0, INVALID_DEX,
-                           "Invalid size encoding mutf8 string");
-    uint8_t v3 = *s++;
-    always_assert_type_log((v2 & 0xc0) == 0x80, INVALID_DEX,
-                           "Invalid 3rd byte on mutf8 string");
-    return (v & 0x1f) << 12 | (v2 & 0x3f) << 6 | (v3 & 0x3f);
-  };
-
-  auto length_of_utf8_string = [&](const char* s) -> uint32_t {
-    if (s == nullptr) {
-      return 0;
-    }
-    uint32_t len = 0;
-    while (*s != '\0') {
-      ++len;
-      mutf8_next_cp(s);
-    }
-    return len;
-  };
-
-  // We are creating a DexString key that is just "defined enough" to be used as
-  // a key into our string set. The provided string does not have to be zero
-  // terminated, and we won't compute the utf size, as neither is needed for
-  // this purpose.
-  uint32_t dummy_utfsize{0};
-  DexStringRepr repr{str.data(), (uint32_t)str.size(), dummy_utfsize};
+const DexString* RedexContext::publish_string(std::string_view str,
+                                              char* storage) {
+  uint32_t utfsize = length_of_utf8_string(storage);
   if (str.size() < s_small_string_set.size()) {
-    auto* rv_ptr = s_small_string_set[str.size()]->get(repr);
-    if (rv_ptr != nullptr) {
-      return reinterpret_cast<const DexString*>(rv_ptr);
-    }
-    char* storage = store_string(str);
-    uint32_t utfsize = length_of_utf8_string(storage);
     return reinterpret_cast<const DexString*>(
         s_small_string_set[str.size()]
             ->insert(DexStringRepr{storage, (uint32_t)str.length(), utfsize})
@@ -440,20 +483,58 @@ const DexString* RedexContext::make_string(std::string_view str) {
     // If unsuccessful, we have wasted a bit of string storage. Oh well...
   }
 
-  auto* key = reinterpret_cast<const DexString*>(&repr);
-  auto& segment = s_large_string_set.at(key);
-  auto rv_ptr = segment.get(key);
-  if (rv_ptr != nullptr) {
-    return *rv_ptr;
-  }
-  char* storage = store_string(str);
-  uint32_t utfsize = length_of_utf8_string(storage);
   std::unique_ptr<DexString> string(
       new DexString(storage, str.length(), utfsize));
+  auto& segment = s_large_string_set.at(string.get());
   return *try_insert(std::move(string), &segment);
   // If unsuccessful, we have wasted a bit of string storage. Oh well...
 }
 
+const DexString* RedexContext::make_string(std::string_view str) {
+  auto* existing = get_string(str);
+  if (existing != nullptr) {
+    return existing;
+  }
+  return publish_string(str, store_string(str));
+}
+
+std::vector<const DexString*> RedexContext::make_strings(
+    const std::vector<std::string_view>& strs) {
+  std::vector<const DexString*> res(strs.size());
+  std::unordered_map<ConcurrentStringStorage*, std::vector<size_t>> missing;
+  for (size_t i = 0; i < strs.size(); ++i) {
+    res[i] = get_string(strs[i]);
+    if (res[i] == nullptr) {
+      missing[&string_storage_for(strs[i].length())].push_back(i);
+    }
+  }
+  // A string storage context blocks its slot for other threads while it is
+  // held, so it is only held for a bounded batch of allocations.
+  constexpr size_t kBatchSize = 256;
+  std::array<char*, kBatchSize> batch;
+  for (auto* string_storage : {&s_small_string_storage,
+                               &s_medium_string_storage,
+                               &s_large_string_storage}) {
+    const auto& indices = missing[string_storage];
+    for (size_t begin = 0; begin < indices.size(); begin += kBatchSize) {
+      auto end = std::min(begin + kBatchSize, indices.size());
+      {
+        auto storage_context = string_storage->get_context();
+        for (auto j = begin; j < end; ++j) {
+          batch[j - begin] = storage_context.container->allocate(
+              strs[indices[j]].length() + 1);
+        }
+      }
+      for (auto j = begin; j < end; ++j) {
+        auto i = indices[j];
+        copy_string(strs[i], batch[j - begin]);
+        res[i] = publish_string(strs[i], batch[j - begin]);
+      }
+    }
+  }
+  return res;
+}
+
 size_t RedexContext::StringSetKeyHash::operator()(StringSetKey k) const {
   return k->size();
 }
@@ -473,12 +554,12 @@ size_t RedexContext::TruncatedStringHash::operator()(StringSetKey k) {
   constexpr size_t offset = 32;
   size_t len = std::min<size_t>(string_size, offset + hash_prefix_len);
   size_t start = std::max<int64_t>(0, int64_t(len - hash_prefix_len));
-  return boost::hash_range(s + start, s + len);
+  return hash_bytes(s + start, len - start);
 }
 
 size_t RedexContext::DexStringReprHash::operator()(
     const DexStringRepr& k) const {
-  return boost::hash_range(k.storage, k.storage + k.length);
+  return hash_bytes(k.storage, k.length);
 }
 
 bool RedexContext::DexStringReprEqual::operator()(
@@ -525,6 +606,22 @@ void RedexContext::set_type_name(DexType* type, const DexString* new_name) {
   type->m_name = new_name;
 }
 
+void RedexContext::set_type_names(
+    const std::vector<std::pair<DexType*, const DexString*>>& renames) {
+  std::unordered_set<const DexString*> new_names;
+  for (const auto& [type, new_name] : renames) {
+    always_assert_log(
+        !s_type_map.count(new_name) && new_names.insert(new_name).second,
+        "Bailing, attempting to alias a symbol that already exists! '%s'\n",
+        new_name->c_str());
+  }
+  workqueue_run_for<size_t>(0, renames.size(), [&](size_t i) {
+    auto [type, new_name] = renames[i];
+    s_type_map.emplace(new_name, type);
+    type->m_name = new_name;
+  });
+}
+
 void RedexContext::alias_type_name(DexType* type, const DexString* new_name) {
   always_assert_log(
       !s_type_map.count(new_name),
@@ -573,6 +670,54 @@ void RedexContext::alias_field_name(DexFieldRef* field,
   s_field_map.emplace(r, field);
 }
 
+namespace {
+
+// Renames a batch of members whose specs live in `map`. A new spec may only
+// be taken already by a member of the batch that gives it up, so that all old
+// specs can be removed before all new ones are added.
+template <typename Ref, typename Spec, typename Map, typename GetSpec>
+void rename_members(
+    const std::vector<std::pair<Ref*, const DexString*>>& renames,
+    Map* map,
+    const GetSpec& get_spec) {
+  std::unordered_set<const Ref*> members;
+  for (const auto& [ref, new_name] : renames) {
+    always_assert_log(members.insert(ref).second, "Renaming %s twice",
+                      SHOW(ref));
+  }
+  std::unordered_set<Spec> new_specs;
+  for (const auto& [ref, new_name] : renames) {
+    Spec spec = get_spec(ref);
+    spec.name = new_name;
+    auto* existing = map->load(spec, nullptr);
+    always_assert_log(
+        new_specs.insert(spec).second &&
+            (existing == nullptr ||
+             (members.count(existing) && get_spec(existing) == spec)),
+        "Another member with the same signature already exists %s %s %s",
+        SHOW(spec.cls), SHOW(spec.name), SHOW(ref));
+  }
+  workqueue_run_for<size_t>(0, renames.size(), [&](size_t i) {
+    map->erase(get_spec(renames[i].first));
+  });
+  workqueue_run_for<size_t>(0, renames.size(), [&](size_t i) {
+    auto [ref, new_name] = renames[i];
+    auto& spec = get_spec(ref);
+    spec.name = new_name;
+    map->emplace(spec, ref);
+  });
+}
+
+} // namespace
+
+void RedexContext::rename_fields(
+    const std::vector<std::pair<DexFieldRef*, const DexString*>>& renames) {
+  std::lock_guard<std::mutex> lock(s_field_lock);
+  rename_members<DexFieldRef, DexFieldSpec>(
+      renames, &s_field_map,
+      [](DexFieldRef* field) -> DexFieldSpec& { return field->m_spec; });
+}
+
 void RedexContext::erase_field(DexFieldRef* field) {
   s_field_map.erase(field->m_spec);
   if (field->is_def()) {
@@ -710,8 +855,18 @@ void RedexContext::alias_method_name(DexMethodRef* method,
   s_method_map.emplace(r, method);
 }
 
+void RedexContext::rename_methods(
+    const std::vector<std::pair<DexMethodRef*, const DexString*>>& renames) {
+  std::lock_guard<std::mutex> lock(s_method_lock);
+  rename_members<DexMethodRef, DexMethodSpec>(
+      renames, &s_method_map,
+      [](DexMethodRef* method) -> DexMethodSpec& { return method->m_spec; });
+  invalidate_method_resolutions();
+}
+
 void RedexContext::erase_method(DexMethodRef* method) {
   s_method_map.erase(method->m_spec);
+  invalidate_method_resolutions();
   // Also remove the alias from the map
   if (method->is_def()) {
     if (method->DexMethodRef::as_def()->get_deobfuscated_name_or_null() !=
@@ -732,6 +887,7 @@ void RedexContext::erase_method(const DexType* type,
                   const_cast<DexProto*>(proto));
   auto* m = s_method_map.load(r, nullptr);
   s_method_map.erase(r);
+  invalidate_method_resolutions();
   if (m != nullptr && m->is_def()) {
     unset_return_value(m->as_def());
   }
@@ -744,6 +900,7 @@ void RedexContext::mutate_method(DexMethodRef* method,
   std::lock_guard<std::mutex> lock(s_method_lock);
   DexMethodSpec old_spec = method->m_spec;
   s_method_map.erase(method->m_spec);
+  invalidate_method_resolutions();
 
   DexMethodSpec& r = method->m_spec;
   r.cls = new_spec.cls != nullptr ? new_spec.cls : method->m_spec.cls;
@@ -850,6 +1007,15 @@ RedexContext::get_position_pattern_switch_manager() {
   return m_position_pattern_switch_manager;
 }
 
+reflection::ReflectionAnalysisCache& RedexContext::reflection_analyses() {
+  std::lock_guard<std::mutex> lock(m_reflection_analyses_mutex);
+  if (!m_reflection_analyses) {
+    m_reflection_analyses =
+        std::make_unique<reflection::ReflectionAnalysisCache>();
+  }
+  return *m_reflection_analyses;
+}
+
 // Return false on unique classes
 // Return true on benign duplicate classes
 // Throw RedexException on problematic duplicate classes
@@ -895,6 +1061,7 @@ void RedexContext::publish_class(DexClass* cls) {
                     cls->get_name()->c_str(),
                     cls->get_deobfuscated_name().c_str());
   m_classes.insert(cls);
+  invalidate_method_resolutions();
   if (cls->is_external()) {
     std::lock_guard<std::mutex> l(m_external_classes_mutex);
     m_external_classes.emplace_back(cls);
@@ -909,6 +1076,21 @@ DexType* RedexContext::class_type(const DexClass* cls) const {
   return cls ? cls->get_type() : nullptr;
 }
 
+uint32_t RedexContext::get_dense_id(const DexType* type) {
+  auto* t = const_cast<DexType*>(type);
+  return s_type_ids.get_or_assign(t, &t->m_dense_id);
+}
+
+uint32_t RedexContext::get_dense_id(const DexFieldRef* field) {
+  auto* f = const_cast<DexFieldRef*>(field);
+  return s_field_ids.get_or_assign(f, &f->m_dense_id);
+}
+
+uint32_t RedexContext::get_dense_id(const DexMethodRef* method) {
+  auto* m = const_cast<DexMethodRef*>(method);
+  return s_method_ids.get_or_assign(m, &m->m_dense_id);
+}
+
 void RedexContext::set_field_value(DexField* field,
                                    keep_rules::AssumeReturnValue& val) {
   field_values.emplace(field,
@@ -974,3 +1156,440 @@ void RedexContext::compact() {
       [&] { method_return_values.compact(); },
   });
 }
+
+namespace {
+
+// Everything that survives a garbage collection; see
+// `RedexContext::collect_garbage`.
+struct GarbageMarks {
+  ConcurrentSet<const DexString*> strings;
+  ConcurrentSet<const DexTypeList*> type_lists;
+  ConcurrentSet<const DexProto*> protos;
+  ConcurrentSet<const DexFieldRef*> fields;
+  ConcurrentSet<const DexMethodRef*> methods;
+
+  void mark_string(const DexString* str) {
+    if (str != nullptr) {
+      strings.insert(str);
+    }
+  }
+
+  void mark_strings(const std::vector<const DexString*>& strs) {
+    for (auto* str : strs) {
+      mark_string(str);
+    }
+  }
+
+  void mark_type_list(const DexTypeList* type_list) {
+    if (type_list != nullptr) {
+      type_lists.insert(type_list);
+    }
+  }
+
+  void mark_proto(const DexProto* proto) {
+    if (proto == nullptr || !protos.insert(proto)) {
+      return;
+    }
+    mark_string(proto->get_shorty());
+    mark_type_list(proto->get_args());
+  }
+
+  void mark_field(const DexFieldRef* field) {
+    if (field == nullptr || !fields.insert(field)) {
+      return;
+    }
+    mark_string(field->get_name());
+  }
+
+  void mark_method(const DexMethodRef* method) {
+    if (method == nullptr || !methods.insert(method)) {
+      return;
+    }
+    mark_string(method->get_name());
+    mark_proto(method->get_proto());
+  }
+
+  void mark_fields(const std::vector<DexFieldRef*>& refs) {
+    for (auto* ref : refs) {
+      mark_field(ref);
+    }
+  }
+
+  void mark_methods(const std::vector<DexMethodRef*>& refs) {
+    for (auto* ref : refs) {
+      mark_method(ref);
+    }
+  }
+
+  // Gathering covers the strings, fields and methods of encoded values, but
+  // not the protos of method types.
+  void mark_encoded_value(const DexEncodedValue* ev) {
+    if (ev == nullptr) {
+      return;
+    }
+    switch (ev->evtype()) {
+    case DEVT_METHOD_TYPE:
+      mark_proto(static_cast<const DexEncodedValueMethodType*>(ev)->proto());
+      break;
+    case DEVT_ARRAY:
+      for (auto& elem :
+           *static_cast<const DexEncodedValueArray*>(ev)->evalues()) {
+        mark_encoded_value(elem.get());
+      }
+      break;
+    case DEVT_ANNOTATION:
+      for (auto& elem :
+           static_cast<const DexEncodedValueAnnotation*>(ev)->annotations()) {
+        mark_encoded_value(elem.encoded_value.get());
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  void mark_anno_set(const DexAnnotationSet* anno_set) {
+    if (anno_set == nullptr) {
+      return;
+    }
+    for (auto& anno : anno_set->get_annotations()) {
+      for (auto& elem : anno->anno_elems()) {
+        mark_encoded_value(elem.encoded_value.get());
+      }
+    }
+  }
+
+  // Protos of instructions, and the strings of positions and source blocks,
+  // are not covered by gathering either.
+  void mark_code(const IRCode* code) {
+    auto mark_entry = [this](const MethodItemEntry& mie) {
+      switch (mie.type) {
+      case MFLOW_OPCODE:
+        if (mie.insn->has_proto()) {
+          mark_proto(mie.insn->get_proto());
+        }
+        break;
+      case MFLOW_POSITION:
+        for (auto* pos = mie.pos.get(); pos != nullptr; pos = pos->parent) {
+          mark_string(pos->method);
+          mark_string(pos->file);
+        }
+        break;
+      case MFLOW_SOURCE_BLOCK:
+        for (auto* sb = mie.src_block.get(); sb != nullptr;
+             sb = sb->next.get()) {
+          mark_string(sb->src);
+        }
+        break;
+      default:
+        break;
+      }
+    };
+    if (code->editable_cfg_built()) {
+      for (auto* block : code->cfg().blocks()) {
+        for (auto& mie : *block) {
+          mark_entry(mie);
+        }
+      }
+    } else {
+      for (auto& mie : *code) {
+        mark_entry(mie);
+      }
+    }
+  }
+
+  void mark_method_def(const DexMethod* method) {
+    mark_method(method);
+    mark_string(method->get_deobfuscated_name_or_null());
+
+    std::vector<const DexString*> strs;
+    method->gather_strings(strs);
+    mark_strings(strs);
+    std::vector<DexFieldRef*> field_refs;
+    method->gather_fields(field_refs);
+    mark_fields(field_refs);
+    std::vector<DexMethodRef*> method_refs;
+    method->gather_methods(method_refs);
+    mark_methods(method_refs);
+
+    std::vector<DexCallSite*> callsites;
+    method->gather_callsites(callsites);
+    for (auto* callsite : callsites) {
+      strs.clear();
+      callsite->gather_strings(strs);
+      mark_strings(strs);
+      field_refs.clear();
+      callsite->gather_fields(field_refs);
+      mark_fields(field_refs);
+      method_refs.clear();
+      callsite->gather_methods(method_refs);
+      mark_methods(method_refs);
+      mark_proto(callsite->method_type());
+      for (auto& arg : callsite->args()) {
+        mark_encoded_value(arg.get());
+      }
+    }
+    std::vector<DexMethodHandle*> methodhandles;
+    method->gather_methodhandles(methodhandles);
+    for (auto* methodhandle : methodhandles) {
+      field_refs.clear();
+      methodhandle->gather_fields(field_refs);
+      mark_fields(field_refs);
+      method_refs.clear();
+      methodhandle->gather_methods(method_refs);
+      mark_methods(method_refs);
+    }
+
+    mark_anno_set(method->get_anno_set());
+    if (const auto* param_annos = method->get_param_anno()) {
+      for (auto& [_, anno_set] : *param_annos) {
+        mark_anno_set(anno_set.get());
+      }
+    }
+    if (const auto* code = method->get_code()) {
+      mark_code(code);
+    }
+  }
+
+  void mark_field_def(const DexField* field) {
+    mark_field(field);
+
+    std::vector<const DexString*> strs;
+    field->gather_strings(strs);
+    mark_strings(strs);
+    std::vector<DexFieldRef*> field_refs;
+    field->gather_fields(field_refs);
+    mark_fields(field_refs);
+    std::vector<DexMethodRef*> method_refs;
+    field->gather_methods(method_refs);
+    mark_methods(method_refs);
+
+    mark_encoded_value(field->get_static_value());
+    mark_anno_set(field->get_anno_set());
+  }
+
+  // Members are marked separately.
+  void mark_class(const DexClass* cls) {
+    mark_string(cls->get_source_file());
+    mark_string(cls->get_deobfuscated_name_or_null());
+    mark_type_list(cls->get_interfaces());
+    const auto* anno_set = cls->get_anno_set();
+    if (anno_set == nullptr) {
+      return;
+    }
+    std::vector<const DexString*> strs;
+    anno_set->gather_strings(strs);
+    mark_strings(strs);
+    std::vector<DexFieldRef*> field_refs;
+    anno_set->gather_fields(field_refs);
+    mark_fields(field_refs);
+    std::vector<DexMethodRef*> method_refs;
+    anno_set->gather_methods(method_refs);
+    mark_methods(method_refs);
+    mark_anno_set(anno_set);
+  }
+};
+
+} // namespace
+
+RedexContext::GarbageCollectionStats RedexContext::collect_garbage(
+    const std::vector<const DexMethodRef*>& extra_method_roots) {
+  Timer timer("collect_garbage");
+  GarbageMarks marks;
+  // Cached resolutions are keyed by names and protos that may be collected.
+  m_method_resolutions.clear();
+  invalidate_method_resolutions();
+  // Reflection analyses hold on to strings and types that may be collected.
+  {
+    std::lock_guard<std::mutex> lock(m_reflection_analyses_mutex);
+    m_reflection_analyses.reset();
+  }
+
+  // Mark. Definitions are never collected, even after they have been removed
+  // from their class, so everything they refer to stays alive.
+  std::vector<const DexClass*> classes;
+  std::unordered_set<const DexMethod*> method_defs;
+  std::unordered_set<const DexField*> field_defs;
+  for (auto* cls : m_classes) {
+    classes.push_back(cls);
+    for (auto* method : cls->get_all_methods()) {
+      method_defs.insert(method);
+    }
+    for (auto* field : cls->get_all_fields()) {
+      field_defs.insert(field);
+    }
+  }
+  for (auto&& [_, loc] : s_method_map) {
+    if (const auto* method = loc.load()->as_def()) {
+      method_defs.insert(method);
+    }
+  }
+  for (auto&& [_, loc] : s_field_map) {
+    if (const auto* field = loc.load()->as_def()) {
+      field_defs.insert(field);
+    }
+  }
+  workqueue_run<const DexClass*>(
+      [&](const DexClass* cls) { marks.mark_class(cls); }, classes);
+  workqueue_run<const DexMethod*>(
+      [&](const DexMethod* method) { marks.mark_method_def(method); },
+      method_defs);
+  workqueue_run<const DexField*>(
+      [&](const DexField* field) { marks.mark_field_def(field); }, field_defs);
+
+  for (auto&& [name, loc] : s_type_map) {
+    marks.mark_string(name);
+    marks.mark_string(loc.load()->get_name());
+  }
+  for (auto* name : library_names) {
+    marks.mark_string(name);
+  }
+  if (m_pointers_cache_loaded) {
+    std::vector<const DexFieldRef*> field_refs;
+    std::vector<const DexMethodRef*> method_refs;
+    m_pointers_cache.gather(field_refs, method_refs);
+    for (auto* field : field_refs) {
+      marks.mark_field(field);
+    }
+    for (auto* method : method_refs) {
+      marks.mark_method(method);
+    }
+  }
+  if (m_position_pattern_switch_manager != nullptr) {
+    std::vector<const DexString*> strs;
+    m_position_pattern_switch_manager->gather_strings(strs);
+    marks.mark_strings(strs);
+  }
+  // Dense ids are never reused, so whatever has one must stay alive.
+  for (uint32_t id = 1; id < s_field_ids.end(); ++id) {
+    marks.mark_field(s_field_ids.get(id));
+  }
+  for (uint32_t id = 1; id < s_method_ids.end(); ++id) {
+    marks.mark_method(s_method_ids.get(id));
+  }
+  for (auto* method : extra_method_roots) {
+    marks.mark_method(method);
+  }
+  // Aliases keep their names alive for as long as the referenced member
+  // lives.
+  for (auto&& [spec, loc] : s_method_map) {
+    auto* method = loc.load();
+    if (method->is_def() || marks.methods.count(method)) {
+      marks.mark_string(spec.name);
+      marks.mark_proto(spec.proto);
+    }
+  }
+  for (auto&& [spec, loc] : s_field_map) {
+    auto* field = loc.load();
+    if (field->is_def() || marks.fields.count(field)) {
+      marks.mark_string(spec.name);
+    }
+  }
+
+  // Sweep, from referencing to referenced objects.
+  GarbageCollectionStats stats;
+  {
+    std::unordered_set<DexMethodRef*> dead;
+    std::vector<DexMethodSpec> dead_specs;
+    for (auto&& [spec, loc] : s_method_map) {
+      auto* method = loc.load();
+      if (!method->is_def() && !marks.methods.count(method)) {
+        dead.insert(method);
+        dead_specs.push_back(spec);
+      }
+    }
+    for (auto& spec : dead_specs) {
+      s_method_map.erase(spec);
+    }
+    for (auto* method : dead) {
+      delete static_cast<DexMethod*>(method);
+    }
+    stats.method_refs = dead.size();
+  }
+  {
+    std::unordered_set<DexFieldRef*> dead;
+    std::vector<DexFieldSpec> dead_specs;
+    for (auto&& [spec, loc] : s_field_map) {
+      auto* field = loc.load();
+      if (!field->is_def() && !marks.fields.count(field)) {
+        dead.insert(field);
+        dead_specs.push_back(spec);
+      }
+    }
+    for (auto& spec : dead_specs) {
+      s_field_map.erase(spec);
+    }
+    for (auto* field : dead) {
+      delete field;
+    }
+    stats.field_refs = dead.size();
+  }
+  {
+    std::vector<DexProto*> dead;
+    for (auto* proto : s_proto_set) {
+      if (!marks.protos.count(proto)) {
+        dead.push_back(proto);
+      }
+    }
+    // The set only supports erasure through its base.
+    auto& protos = static_cast<decltype(s_proto_set)::Base&>(s_proto_set);
+    for (auto* proto : dead) {
+      protos.erase(proto);
+    }
+    for (auto* proto : dead) {
+      delete proto;
+    }
+    stats.protos = dead.size();
+  }
+  {
+    std::vector<DexTypeList*> dead;
+    for (auto&& [_, loc] : s_typelist_map) {
+      auto* type_list = loc.load();
+      if (!marks.type_lists.count(type_list)) {
+        dead.push_back(type_list);
+      }
+    }
+    for (auto* type_list : dead) {
+      s_typelist_map.erase(&type_list->m_list);
+    }
+    for (auto* type_list : dead) {
+      delete type_list;
+    }
+    stats.type_lists = dead.size();
+  }
+  {
+    std::vector<const char*> live;
+    for (auto* small_string_set : s_small_string_set) {
+      std::vector<DexStringRepr> dead;
+      for (auto& repr : *small_string_set) {
+        if (marks.strings.count(reinterpret_cast<const DexString*>(&repr))) {
+          live.push_back(repr.storage);
+        } else {
+          dead.push_back(repr);
+        }
+      }
+      auto& set =
+          static_cast<std::remove_pointer_t<decltype(small_string_set)>::Base&>(
+              *small_string_set);
+      for (auto& repr : dead) {
+        set.erase(repr);
+      }
+      small_string_set->compact();
+      stats.strings += dead.size();
+    }
+    for (auto& segment : s_large_string_set) {
+      stats.strings += segment.erase_if(
+          [&](const DexString* str) { return !marks.strings.count(str); });
+      segment.for_each(
+          [&](const DexString* str) { live.push_back(str->c_str()); });
+    }
+    std::sort(live.begin(), live.end());
+    stats.string_storage_bytes =
+        s_small_string_storage.release_dead_buffers(live) +
+        s_medium_string_storage.release_dead_buffers(live) +
+        s_large_string_storage.release_dead_buffers(live);
+  }
+
+  compact();
+  return stats;
+}
@@ -16,6 +16,7 @@
 #include <limits>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <set>
 #include <sstream>
@@ -25,6 +26,7 @@
 
 #include "ConcurrentContainers.h"
 #include "Debug.h"
+#include "DenseIdTable.h"
 #include "DexMemberRefs.h"
 #include "FrequentlyUsedPointersCache.h"
 
@@ -50,6 +52,9 @@ struct RedexContext;
 namespace keep_rules {
 struct AssumeReturnValue;
 } // namespace keep_rules
+namespace reflection {
+class ReflectionAnalysisCache;
+} // namespace reflection
 
 extern RedexContext* g_redex;
 
@@ -62,6 +67,10 @@ struct RedexContext {
   ~RedexContext();
 
   const DexString* make_string(std::string_view s);
+  // Interns many strings at once. Instead of acquiring raw string storage for
+  // every new string, new strings are allocated in batches.
+  std::vector<const DexString*> make_strings(
+      const std::vector<std::string_view>& strs);
   const DexString* get_string(std::string_view s);
 
   DexType* make_type(const DexString* dstring);
@@ -71,6 +80,13 @@ struct RedexContext {
    * Change the name of a type, but do not remove the old name from the mapping
    */
   void set_type_name(DexType* type, const DexString* new_name);
+  /**
+   * Like set_type_name for many types at once. All new names are checked for
+   * conflicts before any type changes, and the type map is updated in
+   * parallel.
+   */
+  void set_type_names(
+      const std::vector<std::pair<DexType*, const DexString*>>& renames);
   /**
    * Add an additional name to refer to a type (a deobfuscated name for example)
    */
@@ -100,6 +116,14 @@ struct RedexContext {
   void mutate_field(DexFieldRef* field,
                     const DexFieldSpec& ref,
                     bool rename_on_collision);
+  /**
+   * Changes the names of many fields at once. Conflicts with existing fields
+   * and among the new names are checked up front; a field may take a name
+   * that another field of the batch gives up. The old entries are then
+   * removed and the new ones added in parallel.
+   */
+  void rename_fields(
+      const std::vector<std::pair<DexFieldRef*, const DexString*>>& renames);
 
   using DexTypeListContainerType = std::vector<DexType*>;
 
@@ -134,6 +158,11 @@ struct RedexContext {
   void mutate_method(DexMethodRef* method,
                      const DexMethodSpec& new_spec,
                      bool rename_on_collision);
+  /**
+   * Like rename_fields, for methods.
+   */
+  void rename_methods(
+      const std::vector<std::pair<DexMethodRef*, const DexString*>>& renames);
 
   DexLocation* make_location(std::string_view store_name,
                              std::string_view file_name);
@@ -151,6 +180,21 @@ struct RedexContext {
 
   DexClass* type_class(const DexType* t) const;
   DexType* class_type(const DexClass* cls) const;
+
+  // Dense 32-bit ids for types, field and method refs, handed out on first
+  // request. They are meant for compact keys in hot analyses; see DexIds.h.
+  uint32_t get_dense_id(const DexType* type);
+  uint32_t get_dense_id(const DexFieldRef* field);
+  uint32_t get_dense_id(const DexMethodRef* method);
+  DexType* get_type_by_dense_id(uint32_t id) const {
+    return s_type_ids.get(id);
+  }
+  DexFieldRef* get_field_by_dense_id(uint32_t id) const {
+    return s_field_ids.get(id);
+  }
+  DexMethodRef* get_method_by_dense_id(uint32_t id) const {
+    return s_method_ids.get(id);
+  }
   template <class TypeClassWalkerFn = void(const DexType*, const DexClass*)>
   void walk_type_class(TypeClassWalkerFn walker) {
     for (auto* cls : m_classes) {
@@ -170,13 +214,17 @@ struct RedexContext {
   static constexpr bool kDebugPointersCacheLoad = false;
   void load_pointers_cache() {
     m_pointers_cache.load();
-    m_pointers_cache_loaded = true;
+    m_pointers_cache_loaded.store(true, std::memory_order_release);
   }
+  // After the first load, this is a single acquire load of a flag; the lock is
+  // only taken by threads that race on the first load.
   const FrequentlyUsedPointers& pointers_cache() {
-    if (!m_pointers_cache_loaded) {
+    if (!m_pointers_cache_loaded.load(std::memory_order_acquire)) {
       redex_assert(!kDebugPointersCacheLoad);
       std::lock_guard<std::mutex> lock(m_pointers_cache_lock);
-      load_pointers_cache();
+      if (!m_pointers_cache_loaded.load(std::memory_order_relaxed)) {
+        load_pointers_cache();
+      }
     }
     return m_pointers_cache;
   }
@@ -210,6 +258,45 @@ struct RedexContext {
   void set_sb_interaction_index(
       const std::unordered_map<std::string, size_t>& input);
 
+  // A cache of method resolutions shared by all passes, used by
+  // resolve_method in Resolver.h. An entry is only valid for the generation in
+  // which it was computed; the generation is advanced whenever classes are
+  // published, methods are added, removed or renamed, or class hierarchies
+  // change. Code that edits the method vectors of a class directly must call
+  // invalidate_method_resolutions itself.
+  struct MethodResolutionKey {
+    const DexClass* cls;
+    const DexString* name;
+    const DexProto* proto;
+    uint8_t search;
+
+    bool operator==(const MethodResolutionKey& other) const {
+      return cls == other.cls && name == other.name && proto == other.proto &&
+             search == other.search;
+    }
+  };
+
+  template <typename ResolveFn>
+  DexMethod* get_or_resolve_method(const MethodResolutionKey& key,
+                                   const ResolveFn& resolve) {
+    auto generation = m_method_resolution_generation.load();
+    auto cached = m_method_resolutions.get(key, MethodResolution());
+    if (cached.generation == generation) {
+      return cached.method;
+    }
+    auto* method = resolve();
+    m_method_resolutions.insert_or_assign(
+        std::make_pair(key, MethodResolution{generation, method}));
+    return method;
+  }
+
+  void invalidate_method_resolutions() { ++m_method_resolution_generation; }
+
+  // Intraprocedural reflection analyses shared by all passes. Entries are
+  // validated against the code of their method, so passes don't need to
+  // invalidate them when they edit code.
+  reflection::ReflectionAnalysisCache& reflection_analyses();
+
   // This is for convenience.
   bool instrument_mode{false};
 
@@ -225,6 +312,28 @@ struct RedexContext {
   // versions.
   void compact();
 
+  struct GarbageCollectionStats {
+    size_t strings{0};
+    size_t string_storage_bytes{0};
+    size_t type_lists{0};
+    size_t protos{0};
+    size_t field_refs{0};
+    size_t method_refs{0};
+  };
+
+  // Frees all strings, type lists, protos and field and method references
+  // that are no longer reachable from any class, field or method definition,
+  // type, or from the given extra roots, and releases string storage buffers
+  // that no longer hold any live string. Types and definitions themselves are
+  // never collected.
+  //
+  // BE SURE YOU REALLY WANT TO DO THIS! As with `delete_method_DO_NOT_USE`,
+  // any pointer to a collected object that is cached elsewhere, e.g. by a pass
+  // or a preserved analysis, dangles afterwards. This must only run between
+  // passes, while no other thread accesses the context.
+  GarbageCollectionStats collect_garbage(
+      const std::vector<const DexMethodRef*>& extra_method_roots = {});
+
   InsertOnlyConcurrentSet<const DexString*> library_names;
 
  private:
@@ -297,6 +406,9 @@ struct RedexContext {
           max_containers(std::max(max_containers, n_slots)) {}
     Context get_context();
     Stats get_stats() const;
+    // Deletes all buffers that hold none of the given, sorted, string
+    // pointers, and returns the number of bytes released. Not thread-safe.
+    size_t release_dead_buffers(const std::vector<const char*>& live);
     ~ConcurrentStringStorage() {
       for (auto& slot : slots) {
         delete slot.container.load();
@@ -373,6 +485,33 @@ struct RedexContext {
         set.clear();
       }
     }
+
+    // Deletes all strings matching the predicate; not thread-safe.
+    template <typename Predicate>
+    size_t erase_if(const Predicate& pred) {
+      size_t res = 0;
+      for (auto& set : m_slots) {
+        for (auto it = set.begin(); it != set.end();) {
+          if (pred(*it)) {
+            delete *it;
+            it = set.erase(it);
+            res++;
+          } else {
+            ++it;
+          }
+        }
+      }
+      return res;
+    }
+
+    template <typename Fn>
+    void for_each(const Fn& fn) const {
+      for (auto& set : m_slots) {
+        for (auto* s : set) {
+          fn(s);
+        }
+      }
+    }
   };
 
   template <size_t n_slots, size_t m_slots>
@@ -425,7 +564,11 @@ struct RedexContext {
   ConcurrentStringStorage s_medium_string_storage;
   ConcurrentStringStorage s_large_string_storage;
 
+  ConcurrentStringStorage& string_storage_for(size_t length);
   char* store_string(std::string_view);
+  // Inserts a string whose characters were already copied to the given
+  // storage, or returns the string some other thread inserted first.
+  const DexString* publish_string(std::string_view str, char* storage);
 
   // DexType
   AtomicMap<const DexString*, DexType*> s_type_map;
@@ -466,6 +609,11 @@ struct RedexContext {
   AtomicMap<DexMethodSpec, DexMethodRef*> s_method_map;
   std::mutex s_method_lock;
 
+  // Dense ids
+  DenseIdTable<DexType> s_type_ids;
+  DenseIdTable<DexFieldRef> s_field_ids;
+  DenseIdTable<DexMethodRef> s_method_ids;
+
   // DexLocation
   using ClassLocationKey = std::pair<std::string_view, std::string_view>;
   struct ClassLocationKeyHash {
@@ -494,7 +642,7 @@ struct RedexContext {
 
   bool m_allow_class_duplicates;
 
-  bool m_pointers_cache_loaded{false};
+  std::atomic<bool> m_pointers_cache_loaded{false};
   std::mutex m_pointers_cache_lock;
   FrequentlyUsedPointers m_pointers_cache;
 
@@ -506,4 +654,26 @@ struct RedexContext {
       method_return_values;
 
   bool m_ordering_changes_allowed{true};
+
+  struct MethodResolution {
+    // Generations start at 1, so that a default entry never matches.
+    uint64_t generation{0};
+    DexMethod* method{nullptr};
+  };
+  struct MethodResolutionKeyHash {
+    size_t operator()(const MethodResolutionKey& key) const {
+      size_t seed = 0;
+      boost::hash_combine(seed, key.cls);
+      boost::hash_combine(seed, key.name);
+      boost::hash_combine(seed, key.proto);
+      boost::hash_combine(seed, key.search);
+      return seed;
+    }
+  };
+  std::atomic<uint64_t> m_method_resolution_generation{1};
+  ConcurrentMap<MethodResolutionKey, MethodResolution, MethodResolutionKeyHash>
+      m_method_resolutions;
+
+  std::mutex m_reflection_analyses_mutex;
+  std::unique_ptr<reflection::ReflectionAnalysisCache> m_reflection_analyses;
 };
@@ -53,6 +53,76 @@ constexpr decltype(redex_parallel::default_num_threads()) kReadNativeThreads =
 using path_t = boost::filesystem::path;
 using dir_iterator = boost::filesystem::directory_iterator;
 using rdir_iterator = boost::filesystem::recursive_directory_iterator;
+
+/*
+ * Per-file results of collect_layout_classes_and_attributes_for_file, shared
+ * by all resource readers in the process. Layouts are scanned by several
+ * passes, and most files do not change in between. Entries are dropped by
+ * resources::invalidate_xml_scan_cache(), and are also checked against the
+ * file's size and modification time in case it was rewritten elsewhere.
+ */
+class XmlScanCache {
+ public:
+  using Attributes =
+      std::unordered_multimap<std::string, resources::StringOrReference>;
+
+  bool lookup(const std::string& file_path,
+              const std::unordered_set<std::string>& attributes_to_read,
+              resources::StringOrReferenceSet* out_classes,
+              Attributes* out_attributes) {
+    auto stamp = file_stamp(file_path);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(file_path);
+    if (it == m_entries.end() || it->second.stamp != stamp ||
+        it->second.attributes_to_read != attributes_to_read) {
+      return false;
+    }
+    *out_classes = it->second.classes;
+    *out_attributes = it->second.attributes;
+    return true;
+  }
+
+  void store(const std::string& file_path,
+             const std::unordered_set<std::string>& attributes_to_read,
+             const resources::StringOrReferenceSet& classes,
+             const Attributes& attributes) {
+    auto stamp = file_stamp(file_path);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.erase(file_path);
+    m_entries.emplace(file_path,
+                      Entry{stamp, attributes_to_read, classes, attributes});
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+  }
+
+ private:
+  using FileStamp = std::pair<uintmax_t, std::time_t>;
+
+  static FileStamp file_stamp(const std::string& file_path) {
+    boost::system::error_code ec;
+    auto size = boost::filesystem::file_size(file_path, ec);
+    auto time = boost::filesystem::last_write_time(file_path, ec);
+    return {size, time};
+  }
+
+  struct Entry {
+    FileStamp stamp;
+    std::unordered_set<std::string> attributes_to_read;
+    resources::StringOrReferenceSet classes;
+    Attributes attributes;
+  };
+
+  std::mutex m_mutex;
+  std::unordered_map<std::string, Entry> m_entries;
+};
+
+XmlScanCache& xml_scan_cache() {
+  static XmlScanCache cache;
+  return cache;
+}
 } // namespace
 
 std::unique_ptr<AndroidResources> create_resource_reader(
@@ -286,8 +356,13 @@ void AndroidResources::collect_layout_classes_and_attributes(
           resources::StringOrReferenceSet local_classes;
           std::unordered_multimap<std::string, resources::StringOrReference>
               local_attributes;
-          collect_layout_classes_and_attributes_for_file(
-              input, attributes_to_read, &local_classes, &local_attributes);
+          if (!xml_scan_cache().lookup(input, attributes_to_read,
+                                       &local_classes, &local_attributes)) {
+            collect_layout_classes_and_attributes_for_file(
+                input, attributes_to_read, &local_classes, &local_attributes);
+            xml_scan_cache().store(input, attributes_to_read, local_classes,
+                                   local_attributes);
+          }
           if (!local_classes.empty() || !local_attributes.empty()) {
             std::unique_lock<std::mutex> lock(out_mutex);
             // C++17: use merge to avoid copies.
@@ -374,6 +449,7 @@ void AndroidResources::collect_xml_attribute_string_values(
 
 void AndroidResources::rename_classes_in_layouts(
     const std::map<std::string, std::string>& rename_map) {
+  resources::invalidate_xml_scan_cache();
   workqueue_run<std::string>(
       [&](sparta::WorkerState<std::string>* worker_state,
           const std::string& input) {
@@ -560,4 +636,6 @@ void resources_inlining_find_refs(
     }
   }
 }
+
+void invalidate_xml_scan_cache() { xml_scan_cache().clear(); }
 } // namespace resources
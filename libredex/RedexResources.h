@@ -110,6 +110,10 @@ void resources_inlining_find_refs(
     const std::unordered_map<uint32_t, uint32_t>& past_refs,
     std::unordered_map<uint32_t, resources::InlinableValue>*
         inlinable_resources);
+
+// Drops the cached results of scanning xml files for classes and attributes.
+// Must be called whenever xml files are rewritten.
+void invalidate_xml_scan_cache();
 } // namespace resources
 
 /*
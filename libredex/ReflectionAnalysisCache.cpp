@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ReflectionAnalysisCache.h"
+
+#include <boost/functional/hash.hpp>
+
+#include "ControlFlow.h"
+#include "IRCode.h"
+#include "Walkers.h"
+
+namespace reflection {
+
+size_t ReflectionAnalysisCache::fingerprint(const DexMethod* method) {
+  size_t seed = 0;
+  boost::hash_combine(seed, method->get_proto());
+  boost::hash_combine(seed, is_static(method));
+  const auto& cfg = method->get_code()->cfg();
+  // The analysis refers to the CFG and its exit block, which the analysis
+  // (re)computes itself.
+  boost::hash_combine(seed, &cfg);
+  boost::hash_combine(seed, cfg.exit_block());
+  for (const auto* block : cfg.blocks()) {
+    boost::hash_combine(seed, block->id());
+    // The analysis keys its results by instruction, so equal instructions at
+    // different addresses must not match.
+    for (const auto& mie : ir_list::ConstInstructionIterable(block)) {
+      boost::hash_combine(seed, mie.insn);
+      boost::hash_combine(seed, mie.insn->hash());
+    }
+    for (const auto* edge : block->succs()) {
+      boost::hash_combine(seed, edge->target()->id());
+      boost::hash_combine(seed, edge->type());
+    }
+  }
+  return seed;
+}
+
+std::shared_ptr<const ReflectionAnalysis> ReflectionAnalysisCache::analyze(
+    DexMethod* method, bool* has_reflection) {
+  m_misses++;
+  auto analysis = std::make_shared<const ReflectionAnalysis>(
+      method,
+      /* context (interprocedural only) */ nullptr,
+      /* summary_query_fn (interprocedural only) */ nullptr,
+      &m_metadata);
+  Entry entry;
+  entry.computed = true;
+  entry.fingerprint = fingerprint(method);
+  entry.has_reflection = analysis->has_found_reflection();
+  if (entry.has_reflection) {
+    entry.analysis = analysis;
+  }
+  if (has_reflection != nullptr) {
+    *has_reflection = entry.has_reflection;
+  }
+  m_entries.insert_or_assign(std::make_pair(method, std::move(entry)));
+  return analysis;
+}
+
+bool ReflectionAnalysisCache::has_reflection(DexMethod* method) {
+  if (method->get_code() == nullptr) {
+    return false;
+  }
+  auto current = fingerprint(method);
+  auto entry = m_entries.get(method, Entry());
+  if (entry.computed && entry.fingerprint == current) {
+    m_hits++;
+    return entry.has_reflection;
+  }
+  bool has_reflection;
+  analyze(method, &has_reflection);
+  return has_reflection;
+}
+
+std::shared_ptr<const ReflectionAnalysis> ReflectionAnalysisCache::get(
+    DexMethod* method) {
+  auto current = fingerprint(method);
+  auto entry = m_entries.get(method, Entry());
+  if (entry.analysis != nullptr && entry.fingerprint == current) {
+    m_hits++;
+    return entry.analysis;
+  }
+  return analyze(method);
+}
+
+void ReflectionAnalysisCache::precompute(const Scope& scope) {
+  walk::parallel::code(scope, [&](DexMethod* method, IRCode& code) {
+    if (code.editable_cfg_built()) {
+      has_reflection(method);
+    }
+  });
+}
+
+} // namespace reflection
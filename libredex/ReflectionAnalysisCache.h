@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "ConcurrentContainers.h"
+#include "DexClass.h"
+#include "ReflectionAnalysis.h"
+
+namespace reflection {
+
+/*
+ * Intraprocedural reflection analyses of methods, shared by all the passes
+ * through the RedexContext (see RedexContext::reflection_analyses).
+ *
+ * An entry is only valid for the code it was computed on: it records a
+ * fingerprint of the instructions of the method, and is recomputed when the
+ * fingerprint changes. Since the vast majority of methods don't use
+ * reflection, only the analyses that found reflection sites are kept; for the
+ * others, only that fact is, which is all most clients need to skip them.
+ *
+ * All methods require the editable CFG of the method to be built.
+ */
+class ReflectionAnalysisCache final {
+ public:
+  struct Stats {
+    size_t hits{0};
+    size_t misses{0};
+  };
+
+  // Whether the analysis of the method finds any reflection site.
+  bool has_reflection(DexMethod* method);
+
+  // The analysis of the method, which is only computed again if the method
+  // has no reflection site or if its code changed.
+  std::shared_ptr<const ReflectionAnalysis> get(DexMethod* method);
+
+  // Analyzes all the methods of the scope in parallel.
+  void precompute(const Scope& scope);
+
+  Stats get_stats() const { return {m_hits.load(), m_misses.load()}; }
+
+ private:
+  struct Entry {
+    bool computed{false};
+    size_t fingerprint{0};
+    bool has_reflection{false};
+    // Only kept when the analysis found reflection sites.
+    std::shared_ptr<const ReflectionAnalysis> analysis;
+  };
+
+  static size_t fingerprint(const DexMethod* method);
+
+  // Analyzes the method and records the fingerprint of its code as left by the
+  // analysis, which computes the exit block of the CFG.
+  std::shared_ptr<const ReflectionAnalysis> analyze(
+      DexMethod* method, bool* has_reflection = nullptr);
+
+  MetadataCache m_metadata;
+  ConcurrentMap<const DexMethod*, Entry> m_entries;
+  std::atomic<size_t> m_hits{0};
+  std::atomic<size_t> m_misses{0};
+};
+
+} // namespace reflection
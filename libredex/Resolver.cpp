@@ -7,6 +7,7 @@
 
 #include "Resolver.h"
 #include "DexUtil.h"
+#include "RedexContext.h"
 
 namespace {
 
@@ -41,31 +42,12 @@ DexMethod* resolve_intf_method_ref(const DexClass* cls,
   return nullptr;
 }
 
-} // namespace
-
-DexMethod* resolve_method(const DexClass* cls,
-                          const DexString* name,
-                          const DexProto* proto,
-                          MethodSearch search,
-                          const DexMethod* caller) {
+DexMethod* resolve_method_uncached(const DexClass* cls,
+                                   const DexString* name,
+                                   const DexProto* proto,
+                                   MethodSearch search) {
   if (search == MethodSearch::Interface) {
-    if (cls) {
-      return resolve_intf_method_ref(cls, name, proto);
-    }
-  }
-  if (search == MethodSearch::Super) {
-    if (caller) {
-      // caller must be provided. This condition is here to be compatible with
-      // old behavior.
-      DexType* containing_type = caller->get_class();
-      DexClass* containing_class = type_class(containing_type);
-      if (containing_class == nullptr) return nullptr;
-      DexType* super_class = containing_class->get_super_class();
-      if (!super_class) return nullptr;
-      cls = type_class(super_class);
-    }
-    // The rest is the same as virtual.
-    search = MethodSearch::Virtual;
+    return resolve_intf_method_ref(cls, name, proto);
   }
   while (cls) {
     if (search == MethodSearch::InterfaceVirtual) {
@@ -96,6 +78,39 @@ DexMethod* resolve_method(const DexClass* cls,
   return nullptr;
 }
 
+} // namespace
+
+DexMethod* resolve_method(const DexClass* cls,
+                          const DexString* name,
+                          const DexProto* proto,
+                          MethodSearch search,
+                          const DexMethod* caller) {
+  if (search == MethodSearch::Super) {
+    if (caller) {
+      // caller must be provided. This condition is here to be compatible with
+      // old behavior.
+      DexType* containing_type = caller->get_class();
+      DexClass* containing_class = type_class(containing_type);
+      if (containing_class == nullptr) return nullptr;
+      DexType* super_class = containing_class->get_super_class();
+      if (!super_class) return nullptr;
+      cls = type_class(super_class);
+    }
+    // The rest is the same as virtual.
+    search = MethodSearch::Virtual;
+  }
+  if (cls == nullptr) {
+    return nullptr;
+  }
+  // Direct searches only look at the given class, which is not worth caching.
+  if (search == MethodSearch::Direct) {
+    return resolve_method_uncached(cls, name, proto, search);
+  }
+  return g_redex->get_or_resolve_method(
+      {cls, name, proto, static_cast<uint8_t>(search)},
+      [&]() { return resolve_method_uncached(cls, name, proto, search); });
+}
+
 DexMethod* resolve_method_ref(const DexClass* cls,
                               const DexString* name,
                               const DexProto* proto,
@@ -111,6 +111,9 @@ inline MethodSearch opcode_to_search(const IRInstruction* insn) {
  * definition in scope.
  * The lookup is performed according to the search rules specified via
  * MethodSearch.
+ * Results of searches that walk the hierarchy are cached in the RedexContext
+ * until a class or method changes; see
+ * RedexContext::invalidate_method_resolutions.
  */
 DexMethod* resolve_method(const DexClass*,
                           const DexString*,
@@ -17,10 +17,12 @@
 #include "SourceBlocks.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 #include <algorithm>
 #include <iterator>
 #include <map>
+#include <numeric>
 #include <set>
 #include <tuple>
 #include <unordered_map>
@@ -55,34 +57,41 @@ void SourceBlockDomInfo::remove_src_blk(const SourceBlockInfo& sb_info) {
   m_dom_tree.remove_src_blk(sb_info);
 }
 
-void SourceBlockConsistencyCheck::initialize(const Scope& scope) {
+void SourceBlockConsistencyCheck::initialize(const Scope& scope,
+                                             size_t sample_every) {
   always_assert(!this->is_initialized());
   this->m_is_initialized = true;
 
+  std::vector<DexMethod*> methods;
+  size_t index{0};
+  walk::methods(scope, [&](DexMethod* dex_method) {
+    if (index++ % std::max<size_t>(sample_every, 1) == 0) {
+      methods.push_back(dex_method);
+    }
+  });
+
   // Preallocate slots in the map, so we can get
   // at them when multithreaded without needing synchronization
-  walk::methods(scope, [this](DexMethod* dex_method) {
+  this->m_context_map.reserve(methods.size());
+  for (auto* dex_method : methods) {
     this->m_context_map.insert({dex_method, SBConsistencyContext{}});
-  });
-
-  walk::parallel::methods(scope, [this](DexMethod* dex_method) {
-    auto it = this->m_context_map.find(dex_method);
-    if (it == this->m_context_map.end()) {
-      return;
-    }
+  }
 
-    IRCode* code = dex_method->get_code();
+  workqueue_run<DexMethod*>(
+      [this](DexMethod* dex_method) {
+        IRCode* code = dex_method->get_code();
 
-    if (code == nullptr) {
-      return;
-    }
+        if (code == nullptr) {
+          return;
+        }
 
-    cfg::ScopedCFG scfg(code);
-    cfg::ControlFlowGraph& cfg = code->cfg();
-    cfg.calculate_exit_block();
+        cfg::ScopedCFG scfg(code);
+        cfg::ControlFlowGraph& cfg = code->cfg();
+        cfg.calculate_exit_block();
 
-    this->rebuild_sbdi(dex_method, cfg);
-  });
+        this->rebuild_sbdi(dex_method, cfg);
+      },
+      methods);
 }
 
 void SourceBlockConsistencyCheck::rebuild_sbdi(DexMethod* dex_method,
@@ -207,6 +216,11 @@ size_t SourceBlockConsistencyCheck::run(const Scope& scope) {
       });
 
   if (!res.empty()) {
+    // The failures are merged in whichever order the threads finish.
+    std::sort(res.begin(), res.end(), [](const auto& l, const auto& r) {
+      return compare_dexmethods(l.dex_method, r.dex_method);
+    });
+
     int num_missing_blks = std::accumulate(
         res.begin(), res.end(), 0,
         [](const auto& l, const auto& r) { return l + r.src_blks.size(); });
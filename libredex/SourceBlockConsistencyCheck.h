@@ -140,7 +140,8 @@ class SourceBlockConsistencyCheck {
  public:
   SourceBlockConsistencyCheck() = default;
 
-  void initialize(const Scope& scope);
+  // Only every `sample_every`-th method of the scope is checked.
+  void initialize(const Scope& scope, size_t sample_every = 1);
 
   bool is_initialized() const;
   size_t run(const Scope& scope);
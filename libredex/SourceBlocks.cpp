@@ -7,6 +7,7 @@
 
 #include "SourceBlocks.h"
 
+#include <algorithm>
 #include <limits>
 #include <memory>
 #include <optional>
@@ -408,7 +409,7 @@ struct InsertHelper {
       for (auto* b : cfg.blocks()) {
         auto vec = gather_source_blocks(b);
         for (auto* sb : vec) {
-          const_cast<SourceBlock*>(sb)->vals[i] = val;
+          const_cast<SourceBlock*>(sb)->mutable_vals()[i] = val;
         }
       }
     }
@@ -511,6 +512,18 @@ bool has_source_block_positive_val(const SourceBlock* sb) {
   return any_positive_val;
 }
 
+boost::optional<float> get_max_val(const SourceBlock* sb) {
+  boost::optional<float> max_val;
+  if (sb != nullptr) {
+    sb->foreach_val([&max_val](const auto& val) {
+      if (val && (!max_val || val->val > *max_val)) {
+        max_val = val->val;
+      }
+    });
+  }
+  return max_val;
+}
+
 IRList::iterator find_first_block_insert_point(cfg::Block* b) {
   // Do not put source blocks before a (pseudo) move result or load-param-* at
   // the head of a block.
@@ -949,8 +962,7 @@ void track_source_block_coverage(ScopedMetrics& sm,
         }
         code->build_cfg(/* editable */ true);
         auto& cfg = code->cfg();
-        auto dominators =
-            dominators::SimpleFastDominators<cfg::GraphInterface>(cfg);
+        const auto& dominators = dominators::get_dominators(cfg);
 
         for (auto block : cfg.blocks()) {
           for (size_t i = 0; i != gCounters.size(); ++i) {
@@ -1005,7 +1017,9 @@ void track_source_block_coverage(ScopedMetrics& sm,
 
 struct ViolationsHelper::ViolationsHelperImpl {
   size_t top_n;
-  std::unordered_map<DexMethod*, size_t> violations_start;
+  size_t sample_every;
+  // The tracked methods, in the order of the scope, and their violations.
+  std::vector<std::pair<DexMethod*, size_t>> violations_start;
   std::vector<std::string> print;
   bool processed{false};
 
@@ -1015,22 +1029,23 @@ struct ViolationsHelper::ViolationsHelperImpl {
   ViolationsHelperImpl(Violation v,
                        const Scope& scope,
                        size_t top_n,
-                       std::vector<std::string> to_vis)
-      : top_n(top_n), print(std::move(to_vis)), v(v) {
-    {
-      std::mutex lock;
-      walk::parallel::methods(scope, [this, &lock, v](DexMethod* m) {
-        if (m->get_code() == nullptr) {
-          return;
-        }
-        cfg::ScopedCFG cfg(m->get_code());
-        auto val = compute(v, *cfg);
-        {
-          std::unique_lock<std::mutex> ulock{lock};
-          violations_start[m] = val;
-        }
-      });
-    }
+                       std::vector<std::string> to_vis,
+                       size_t sample_every)
+      : top_n(top_n),
+        sample_every(std::max<size_t>(sample_every, 1)),
+        print(std::move(to_vis)),
+        v(v) {
+    size_t index{0};
+    walk::code(scope, [&](DexMethod* m, IRCode&) {
+      if (index++ % this->sample_every == 0) {
+        violations_start.emplace_back(m, 0);
+      }
+    });
+    workqueue_run_for<size_t>(0, violations_start.size(), [&](size_t i) {
+      auto& [m, val] = violations_start[i];
+      cfg::ScopedCFG cfg(m->get_code());
+      val = compute(v, *cfg);
+    });
 
     print_all();
   }
@@ -1059,11 +1074,9 @@ struct ViolationsHelper::ViolationsHelperImpl {
     }
     processed = true;
 
-    std::atomic<size_t> change_sum{0};
+    size_t change_sum{0};
 
     {
-      std::mutex lock;
-
       struct MethodDelta {
         DexMethod* method;
         size_t violations_delta;
@@ -1073,53 +1086,51 @@ struct ViolationsHelper::ViolationsHelperImpl {
             : method(p1), violations_delta(p2), method_size(p3) {}
       };
 
-      std::vector<MethodDelta> top_changes;
-
-      workqueue_run<std::pair<DexMethod*, size_t>>(
-          [&](const std::pair<DexMethod*, size_t>& p) {
-            auto* m = p.first;
-            if (m->get_code() == nullptr) {
-              return;
-            }
-            cfg::ScopedCFG cfg(m->get_code());
-            auto val = compute(v, *cfg);
-            if (val <= p.second) {
-              return;
-            }
-            change_sum.fetch_add(val - p.second);
-
-            auto m_delta = val - p.second;
-            size_t s = m->get_code()->sum_opcode_sizes();
-            std::unique_lock<std::mutex> ulock{lock};
-            if (top_changes.size() < top_n) {
-              top_changes.emplace_back(m, m_delta, s);
-              return;
-            }
-            MethodDelta m_t{m, m_delta, s};
-            auto cmp = [](const auto& t1, const auto& t2) {
-              if (t1.violations_delta > t2.violations_delta) {
-                return true;
-              }
-              if (t1.violations_delta < t2.violations_delta) {
-                return false;
-              }
+      // Each method only writes its own slot, and the deltas are then merged
+      // in the order of the scope.
+      std::vector<size_t> deltas(violations_start.size(), 0);
+      workqueue_run_for<size_t>(0, violations_start.size(), [&](size_t i) {
+        auto [m, start] = violations_start[i];
+        if (m->get_code() == nullptr) {
+          return;
+        }
+        cfg::ScopedCFG cfg(m->get_code());
+        auto val = compute(v, *cfg);
+        if (val > start) {
+          deltas[i] = val - start;
+        }
+      });
 
-              if (t1.method_size < t2.method_size) {
-                return true;
-              }
-              if (t1.method_size > t2.method_size) {
-                return false;
-              }
+      std::vector<MethodDelta> top_changes;
+      for (size_t i = 0; i != deltas.size(); ++i) {
+        if (deltas[i] == 0) {
+          continue;
+        }
+        change_sum += deltas[i];
+        auto* m = violations_start[i].first;
+        top_changes.emplace_back(m, deltas[i],
+                                 m->get_code()->sum_opcode_sizes());
+      }
+      auto cmp = [](const auto& t1, const auto& t2) {
+        if (t1.violations_delta > t2.violations_delta) {
+          return true;
+        }
+        if (t1.violations_delta < t2.violations_delta) {
+          return false;
+        }
 
-              return compare_dexmethods(t1.method, t2.method);
-            };
+        if (t1.method_size < t2.method_size) {
+          return true;
+        }
+        if (t1.method_size > t2.method_size) {
+          return false;
+        }
 
-            if (cmp(m_t, top_changes.back())) {
-              top_changes.back() = m_t;
-              std::sort(top_changes.begin(), top_changes.end(), cmp);
-            }
-          },
-          violations_start);
+        return compare_dexmethods(t1.method, t2.method);
+      };
+      auto top_end = top_changes.begin() + std::min(top_n, top_changes.size());
+      std::partial_sort(top_changes.begin(), top_end, top_changes.end(), cmp);
+      top_changes.erase(top_end, top_changes.end());
 
       struct MaybeMetrics {
         ScopedMetrics* root{nullptr};
@@ -1159,9 +1170,13 @@ struct ViolationsHelper::ViolationsHelperImpl {
 
     print_all();
 
-    TRACE(MMINL, 0, "Introduced %zu violations.", change_sum.load());
+    TRACE(MMINL, 0, "Introduced %zu violations in 1/%zu of the methods.",
+          change_sum, sample_every);
     if (sm != nullptr) {
-      sm->set_metric("new_violations", change_sum.load());
+      sm->set_metric("new_violations", change_sum);
+      if (sample_every > 1) {
+        sm->set_metric("sample_every", sample_every);
+      }
     }
   }
 
@@ -1171,7 +1186,7 @@ struct ViolationsHelper::ViolationsHelperImpl {
     // Some passes may leave around unreachable blocks which the fast-dom
     // does not deal well with.
     cfg.remove_unreachable_blocks();
-    dominators::SimpleFastDominators<cfg::GraphInterface> dom{cfg};
+    const auto& dom = dominators::get_dominators(cfg);
 
     for (auto* b : cfg.blocks()) {
       sum += hot_immediate_dom_not_hot(b, dom);
@@ -1185,7 +1200,7 @@ struct ViolationsHelper::ViolationsHelperImpl {
     // Some passes may leave around unreachable blocks which the fast-dom
     // does not deal well with.
     cfg.remove_unreachable_blocks();
-    dominators::SimpleFastDominators<cfg::GraphInterface> dom{cfg};
+    const auto& dom = dominators::get_dominators(cfg);
 
     for (auto* b : cfg.blocks()) {
       sum += chain_and_dom_violations(b, dom);
@@ -1450,9 +1465,10 @@ struct ViolationsHelper::ViolationsHelperImpl {
 ViolationsHelper::ViolationsHelper(Violation v,
                                    const Scope& scope,
                                    size_t top_n,
-                                   std::vector<std::string> to_vis)
+                                   std::vector<std::string> to_vis,
+                                   size_t sample_every)
     : impl(std::make_unique<ViolationsHelperImpl>(
-          v, scope, top_n, std::move(to_vis))) {}
+          v, scope, top_n, std::move(to_vis), sample_every)) {}
 ViolationsHelper::~ViolationsHelper() {}
 
 void ViolationsHelper::process(ScopedMetrics* sm) {
@@ -1534,9 +1550,7 @@ std::unique_ptr<SourceBlock> clone_as_synthetic(SourceBlock* sb,
   if (ref) {
     new_sb->src = ref->get_deobfuscated_name_or_null();
   }
-  for (size_t i = 0; i < new_sb->vals_size; i++) {
-    new_sb->vals[i] = val;
-  }
+  new_sb->fill_vals(val);
   return new_sb;
 }
 
@@ -1551,9 +1565,7 @@ std::unique_ptr<SourceBlock> clone_as_synthetic(
     new_sb->src = ref->get_deobfuscated_name_or_null();
   }
   if (opt_val) {
-    for (size_t i = 0; i < new_sb->vals_size; i++) {
-      new_sb->vals[i] = *opt_val;
-    }
+    new_sb->fill_vals(*opt_val);
   }
   return new_sb;
 }
@@ -1566,9 +1578,7 @@ std::unique_ptr<SourceBlock> clone_as_synthetic(
   if (ref) {
     new_sb->src = ref->get_deobfuscated_name_or_null();
   }
-  for (size_t i = 0; i < new_sb->vals_size; i++) {
-    new_sb->vals[i] = SourceBlock::Val::none();
-  }
+  new_sb->fill_vals(SourceBlock::Val::none());
   for (auto& other : many) {
     new_sb->max(*other);
   }
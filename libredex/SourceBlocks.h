@@ -236,6 +236,10 @@ InsertResult insert_source_blocks(DexMethod* method,
 
 bool has_source_block_positive_val(const SourceBlock* sb);
 
+// The largest value of the source block across all interactions, or none if
+// there is no source block or it has no values.
+boost::optional<float> get_max_val(const SourceBlock* sb);
+
 inline bool has_source_blocks(const cfg::Block* b) {
   for (const auto& mie : *b) {
     if (mie.type == MFLOW_SOURCE_BLOCK) {
@@ -432,17 +436,19 @@ inline float get_factor(SourceBlock* dominating,
 
 inline void normalize(SourceBlock* sb, size_t idx, float factor) {
   if (sb->vals[idx]) {
-    sb->vals[idx]->val *= factor;
+    sb->mutable_vals()[idx]->val *= factor;
   }
 }
 
 inline void normalize(SourceBlock* dominating,
                       SourceBlock* dominated,
                       size_t interactions) {
+  std::vector<float> factors;
+  factors.reserve(interactions);
   for (size_t i = 0; i != interactions; ++i) {
-    auto sb_factor = get_factor(dominating, dominated, i);
-    normalize(dominated, i, sb_factor);
+    factors.push_back(get_factor(dominating, dominated, i));
   }
+  dominated->scale(factors.data(), factors.size());
 }
 
 inline void normalize(ControlFlowGraph& cfg,
@@ -458,11 +464,8 @@ inline void normalize(ControlFlowGraph& cfg,
     factors.push_back(get_factor(dominating, dominated, i));
   }
   for (auto* b : cfg.blocks()) {
-    source_blocks::foreach_source_block(b, [&](auto* sb) {
-      for (size_t i = 0; i != interactions; ++i) {
-        normalize(sb, i, factors[i]);
-      }
-    });
+    source_blocks::foreach_source_block(
+        b, [&](auto* sb) { sb->scale(factors.data(), factors.size()); });
   }
 }
 
@@ -494,10 +497,13 @@ struct ViolationsHelper {
     kHotMethodColdEntry,
   };
 
+  // Only tracks every `sample_every`-th method of the scope, which is much
+  // cheaper for large apps in dev builds.
   ViolationsHelper(Violation v,
                    const Scope& scope,
                    size_t top_n,
-                   std::vector<std::string> to_vis);
+                   std::vector<std::string> to_vis,
+                   size_t sample_every = 1);
   ~ViolationsHelper();
 
   void process(ScopedMetrics* sm);
@@ -7,8 +7,8 @@
 
 #include "StringTreeSet.h"
 
+#include <algorithm>
 #include <cmath>
-#include <unordered_map>
 
 #include "Debug.h"
 #include "DexEncoding.h"
@@ -43,117 +43,272 @@ size_t payload_unit_count(ValueType value) {
     return max;
   }
 }
-} // namespace
 
 template <typename ValueType>
-void StringTreeMap<ValueType>::insert(const std::string& s,
-                                      ValueType value,
-                                      size_t start) {
-  if (start == s.size()) {
-    m_terminal = true;
-    m_value = value;
-    return;
-  }
-  always_assert(start < s.size());
-  m_map[s.at(start)].insert(s, value, start + 1);
-}
-
-template <typename ValueType>
-void StringTreeMap<ValueType>::encode(std::ostringstream& oss) const {
-  if (!m_terminal && m_map.size() == 1) {
-    auto&& [c, rest] = *m_map.begin();
-    always_assert(c >= 32);
-    oss.put(c);
-    rest.encode(oss);
-    return;
-  }
-  always_assert(m_terminal || !m_map.empty());
+void encode_node_header(bool terminal,
+                        ValueType value,
+                        size_t num_children,
+                        std::ostringstream& oss) {
   // Write <= 31 to pack in the following:
   // A B C D E
   // A = non terminal?
   // B = payload is zero?
   // CDE = how many payload chars come next, each char will have 0x40 set and
   // use lowest 6 bits to denote the value.
-  size_t num_payload_chars = payload_unit_count(m_value);
+  size_t num_payload_chars = terminal ? payload_unit_count(value) : 0;
   always_assert(num_payload_chars < FLAG_NO_PAYLOAD);
-  char header = m_terminal
-                    ? (m_value == 0 ? FLAG_NO_PAYLOAD : num_payload_chars)
-                    : FLAG_NONTERMINAL;
+  char header = terminal ? (value == 0 ? FLAG_NO_PAYLOAD : num_payload_chars)
+                         : FLAG_NONTERMINAL;
   oss.put(header);
   // Each payload char will be nonzero to make string encoding work (which will
   // need to get shifted and assembled to read proper value).
-  if (m_terminal && m_value != 0) {
-    uint64_t value_to_write = m_value & 0xFFFFFFFF;
+  if (terminal && value != 0) {
+    uint64_t value_to_write = value & 0xFFFFFFFF;
     for (size_t i = 0; i < num_payload_chars; i++) {
       oss.put(FLAG_PAYLOAD_UNIT | (value_to_write & PAYLOAD_MASK));
       value_to_write = value_to_write >> BITS_PER_PAYLOAD_UNIT;
     }
   }
   // Followed by the size of this tree's map + 1.
-  size_t map_size = m_map.size() + 1;
+  size_t map_size = num_children + 1;
   always_assert(map_size < 128);
   oss.put(map_size);
+}
+
+// Writes the branch chars of a node. The first child's subtree directly follows
+// the table; every other char is followed by a 3 char slot for the offset of
+// its subtree, whose positions are returned.
+std::vector<std::ostringstream::pos_type> encode_branch_table(
+    const std::vector<char>& chars, std::ostringstream& oss) {
+  std::vector<std::ostringstream::pos_type> slots;
   bool first{true};
-  std::unordered_map<char, std::ostringstream::pos_type> offsets;
-  for (auto&& [c, nested] : m_map) {
+  for (auto c : chars) {
     oss.put(c);
     if (first) {
       first = false;
     } else {
-      offsets.emplace(c, oss.tellp());
+      slots.push_back(oss.tellp());
       oss.put(0);
       oss.put(0);
       oss.put(0);
     }
   }
-  first = true;
+  return slots;
+}
+
+// Fills in the given slot with the current position, where the next subtree is
+// about to be written.
+void patch_branch_offset(std::ostringstream::pos_type slot,
+                         std::ostringstream& oss) {
+  auto pos = oss.tellp();
+  always_assert(pos < 127 * 127 * 127);
+  oss.seekp(slot);
+  oss.put((pos % 127) + 1);
+  oss.put(((pos / 127) % 127) + 1);
+  oss.put((pos / (127 * 127)) + 1);
+  oss.seekp(pos);
+}
+
+size_t decode_branch_offset(std::string_view encoded, size_t slot) {
+  always_assert(slot + 3 <= encoded.size());
+  auto digit = [&](size_t i) { return (uint8_t)encoded[slot + i] - 1; };
+  return digit(0) + digit(1) * 127 + digit(2) * 127 * 127;
+}
+
+// Encodes the subtree of the given entries, which all share the first `depth`
+// chars and are sorted. Chains of single-child nodes are walked iteratively, so
+// recursion only happens at nodes with several children.
+template <typename ValueType>
+void encode_sorted_entries(
+    const typename StringTreeMap<ValueType>::Entry* begin,
+    const typename StringTreeMap<ValueType>::Entry* end,
+    size_t depth,
+    std::ostringstream& oss) {
+  while (true) {
+    always_assert(begin != end);
+    bool terminal{false};
+    ValueType value{0};
+    auto it = begin;
+    for (; it != end && it->first.size() == depth; ++it) {
+      terminal = true;
+      value = it->second;
+    }
+    if (!terminal && begin->first[depth] == (end - 1)->first[depth]) {
+      char c = begin->first[depth];
+      always_assert(c >= 32);
+      oss.put(c);
+      depth++;
+      continue;
+    }
+    std::vector<decltype(begin)> children;
+    std::vector<char> chars;
+    for (; it != end; ++it) {
+      if (chars.empty() || chars.back() != it->first[depth]) {
+        children.push_back(it);
+        chars.push_back(it->first[depth]);
+      }
+    }
+    encode_node_header(terminal, value, children.size(), oss);
+    auto slots = encode_branch_table(chars, oss);
+    for (size_t i = 0; i < children.size(); i++) {
+      if (i > 0) {
+        patch_branch_offset(slots[i - 1], oss);
+      }
+      auto child_end = i + 1 < children.size() ? children[i + 1] : end;
+      encode_sorted_entries<ValueType>(children[i], child_end, depth + 1, oss);
+    }
+    return;
+  }
+}
+} // namespace
+
+template <typename ValueType>
+void StringTreeMap<ValueType>::insert(const std::string& s,
+                                      ValueType value,
+                                      size_t start) {
+  if (start == s.size()) {
+    m_terminal = true;
+    m_value = value;
+    return;
+  }
+  always_assert(start < s.size());
+  m_map[s.at(start)].insert(s, value, start + 1);
+}
+
+template <typename ValueType>
+void StringTreeMap<ValueType>::encode(std::ostringstream& oss) const {
+  if (!m_terminal && m_map.size() == 1) {
+    auto&& [c, rest] = *m_map.begin();
+    always_assert(c >= 32);
+    oss.put(c);
+    rest.encode(oss);
+    return;
+  }
+  always_assert(m_terminal || !m_map.empty());
+  encode_node_header(m_terminal, m_value, m_map.size(), oss);
+  std::vector<char> chars;
+  chars.reserve(m_map.size());
+  for (auto&& [c, nested] : m_map) {
+    chars.push_back(c);
+  }
+  auto slots = encode_branch_table(chars, oss);
+  size_t i = 0;
   for (auto&& [c, rest] : m_map) {
-    if (first) {
-      first = false;
-    } else {
-      auto pos = oss.tellp();
-      always_assert(pos < 127 * 127 * 127);
-      oss.seekp(offsets.at(c));
-      oss.put((pos % 127) + 1);
-      oss.put(((pos / 127) % 127) + 1);
-      oss.put((pos / (127 * 127)) + 1);
-      oss.seekp(pos);
+    if (i > 0) {
+      patch_branch_offset(slots[i - 1], oss);
     }
     rest.encode(oss);
+    i++;
   }
 }
 
+template <typename ValueType>
+void StringTreeMap<ValueType>::encode_entries(std::vector<Entry>& entries,
+                                              std::ostringstream& oss) {
+  // Order keys the way std::map<char, ...> orders the children of a node,
+  // with prefixes first.
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const Entry& a, const Entry& b) {
+                     return std::lexicographical_compare(
+                         a.first.begin(), a.first.end(), b.first.begin(),
+                         b.first.end());
+                   });
+  encode_sorted_entries<ValueType>(entries.data(),
+                                   entries.data() + entries.size(), 0, oss);
+}
+
 template <typename ValueType>
 std::string StringTreeMap<ValueType>::encode_string_tree_map(
     const std::map<std::string, ValueType>& strings) {
-  StringTreeMap<ValueType> stm;
+  std::vector<Entry> entries;
+  entries.reserve(strings.size());
   for (const auto& [s, v] : strings) {
-    stm.insert(s, v);
+    entries.emplace_back(s, v);
   }
   std::ostringstream oss;
-  stm.encode(oss);
+  encode_entries(entries, oss);
   return oss.str();
 }
 
+template <typename ValueType>
+std::optional<ValueType> StringTreeMapView<ValueType>::find(
+    std::string_view key) const {
+  auto byte_at = [&](size_t pos) -> uint8_t {
+    always_assert(pos < m_encoded.size());
+    return m_encoded[pos];
+  };
+  size_t pos = 0;
+  size_t matched = 0;
+  while (true) {
+    uint8_t header = byte_at(pos++);
+    if (header >= 32) {
+      // A node with a single child and no value of its own.
+      if (matched == key.size() || (uint8_t)key[matched] != header) {
+        return std::nullopt;
+      }
+      matched++;
+      continue;
+    }
+    bool terminal = !(header & FLAG_NONTERMINAL);
+    uint64_t value = 0;
+    if (terminal && !(header & FLAG_NO_PAYLOAD)) {
+      for (size_t i = 0; i < header; i++) {
+        value |= (uint64_t)(byte_at(pos++) & PAYLOAD_MASK)
+                 << (i * BITS_PER_PAYLOAD_UNIT);
+      }
+    }
+    size_t num_children = byte_at(pos++) - 1;
+    if (matched == key.size()) {
+      if (!terminal) {
+        return std::nullopt;
+      }
+      return (ValueType)(uint32_t)value;
+    }
+    if (num_children == 0) {
+      return std::nullopt;
+    }
+    uint8_t c = key[matched++];
+    if (byte_at(pos) == c) {
+      pos += 1 + (num_children - 1) * 4;
+      continue;
+    }
+    size_t next = 0;
+    for (size_t i = 1; i < num_children && next == 0; i++) {
+      auto entry = pos + 1 + (i - 1) * 4;
+      if (byte_at(entry) == c) {
+        next = decode_branch_offset(m_encoded, entry + 1);
+      }
+    }
+    if (next == 0) {
+      return std::nullopt;
+    }
+    pos = next;
+  }
+}
+
 template class StringTreeMap<int16_t>;
 template class StringTreeMap<int32_t>;
+template class StringTreeMapView<int16_t>;
+template class StringTreeMapView<int32_t>;
 
 void StringTreeSet::encode(std::ostringstream& oss) const {
-  StringTreeMap<int16_t> stm;
+  std::vector<StringTreeMap<int16_t>::Entry> entries;
+  entries.reserve(m_set.size());
   for (const auto& s : m_set) {
-    stm.insert(s, 0);
+    entries.emplace_back(s, 0);
   }
-  return stm.encode(oss);
+  StringTreeMap<int16_t>::encode_entries(entries, oss);
 }
 
 std::string StringTreeSet::encode_string_tree_set(
     const std::vector<std::string>& strings) {
-  StringTreeMap<int16_t> stm;
+  std::vector<StringTreeMap<int16_t>::Entry> entries;
+  entries.reserve(strings.size());
   for (const auto& s : strings) {
-    stm.insert(s, 0);
+    entries.emplace_back(s, 0);
   }
   std::ostringstream oss;
-  stm.encode(oss);
+  StringTreeMap<int16_t>::encode_entries(entries, oss);
   return oss.str();
 }
 
@@ -199,12 +354,12 @@ std::string StringTreeStringMap::encode_string_tree_map(
   }
 
   std::ostringstream tree;
-  StringTreeMap<int32_t> stm;
+  std::vector<StringTreeMap<int32_t>::Entry> entries;
+  entries.reserve(strings.size());
   for (const auto& [key, value] : strings) {
-    auto off = value_to_offset.at(value);
-    stm.insert(key, off);
+    entries.emplace_back(key, value_to_offset.at(value));
   }
-  stm.encode(tree);
+  StringTreeMap<int32_t>::encode_entries(entries, tree);
 
   // NOTE: tellp() OK here because tree will use only non-zero ascii chars. Be
   // sure to update this if the constraint ever changes.
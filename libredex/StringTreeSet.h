@@ -8,9 +8,11 @@
 #pragma once
 
 #include <map>
+#include <optional>
 #include <set>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 // The StringTreeSet and StringTreeMap provide a compact encoding for
@@ -19,6 +21,8 @@
 template <typename ValueType>
 class StringTreeMap {
  public:
+  using Entry = std::pair<std::string_view, ValueType>;
+
   void insert(const std::string& s, ValueType value, size_t start = 0);
 
   void encode(std::ostringstream& oss) const;
@@ -26,6 +30,13 @@ class StringTreeMap {
   static std::string encode_string_tree_map(
       const std::map<std::string, ValueType>& strings);
 
+  // Writes the same encoding as building a tree from the given entries and
+  // calling encode(), without materializing the tree. The entries are sorted
+  // in place; for duplicate keys, the last one wins. Besides the output, only
+  // memory proportional to the depth of the tree is used.
+  static void encode_entries(std::vector<Entry>& entries,
+                             std::ostringstream& oss);
+
  private:
   std::map<char, StringTreeMap<ValueType>> m_map;
   bool m_terminal{false};
@@ -45,6 +56,24 @@ class StringTreeSet {
   std::set<std::string> m_set;
 };
 
+// Answers lookups directly on the output of StringTreeMap/StringTreeSet
+// encoding, without decoding it into a tree first. The view does not own the
+// encoded data, which must outlive it.
+template <typename ValueType>
+class StringTreeMapView {
+ public:
+  explicit StringTreeMapView(std::string_view encoded) : m_encoded(encoded) {}
+
+  std::optional<ValueType> find(std::string_view key) const;
+
+  bool contains(std::string_view key) const { return find(key).has_value(); }
+
+ private:
+  std::string_view m_encoded;
+};
+
+using StringTreeSetView = StringTreeMapView<int16_t>;
+
 // An map of limited string keys, with the same caveat as StringTreeMap above,
 // to string values (which can be anything).
 // NOTE: Given string values are assumed to be in MUTF-8 format! NO VALIDATION
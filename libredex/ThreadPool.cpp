@@ -7,10 +7,91 @@
 
 #include "ThreadPool.h"
 
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "JemallocUtil.h"
+
 namespace {
 
 redex_thread_pool::ThreadPool* s_threadpool{nullptr};
 
+thread_local int s_numa_node{-1};
+
+using CpusByNode = std::vector<std::vector<int>>;
+
+// Parses a sysfs cpu list such as "0-23,48-71".
+std::vector<int> parse_cpu_list(const std::string& str) {
+  std::vector<int> cpus;
+  std::istringstream iss(str);
+  std::string range;
+  while (std::getline(iss, range, ',')) {
+    auto dash = range.find('-');
+    try {
+      int first = std::stoi(range.substr(0, dash));
+      int last = dash == std::string::npos ? first
+                                            : std::stoi(range.substr(dash + 1));
+      for (int cpu = first; cpu <= last; ++cpu) {
+        cpus.push_back(cpu);
+      }
+    } catch (const std::exception&) {
+      // Ignore malformed entries.
+    }
+  }
+  return cpus;
+}
+
+// The CPUs of each NUMA node, as reported by sysfs. Machines (or platforms)
+// without that information are treated as a single node with all CPUs.
+const CpusByNode& cpus_by_node() {
+  static const CpusByNode s_cpus_by_node = []() {
+    CpusByNode result;
+    for (size_t node = 0;; ++node) {
+      std::ifstream ifs("/sys/devices/system/node/node" +
+                        std::to_string(node) + "/cpulist");
+      std::string line;
+      if (!ifs || !std::getline(ifs, line)) {
+        break;
+      }
+      auto cpus = parse_cpu_list(line);
+      if (!cpus.empty()) {
+        result.push_back(std::move(cpus));
+      }
+    }
+    if (result.empty()) {
+      std::vector<int> cpus;
+      for (unsigned cpu = 0; cpu < boost::thread::hardware_concurrency();
+           ++cpu) {
+        cpus.push_back(cpu);
+      }
+      result.push_back(std::move(cpus));
+    }
+    return result;
+  }();
+  return s_cpus_by_node;
+}
+
+bool pin_current_thread(size_t node, int cpu) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    return false;
+  }
+  s_numa_node = (int)node;
+  return true;
+#else
+  return false;
+#endif
+}
+
 } // anonymous namespace
 
 namespace redex_thread_pool {
@@ -21,14 +102,39 @@ boost::thread ThreadPool::create_thread(std::function<void()> bound_f) {
   boost::thread::attributes attrs;
   attrs.set_stack_size(8 * 1024 * 1024); // 8MB stack.
   auto bound_run = std::bind(&ThreadPool::run, this, std::move(bound_f));
-  return boost::thread(attrs, std::move(bound_run));
+  if (!m_pin_workers && !m_per_worker_arenas) {
+    return boost::thread(attrs, std::move(bound_run));
+  }
+  // Spread workers over the nodes first, and over the CPUs of a node second.
+  const auto& nodes = cpus_by_node();
+  auto worker = m_next_worker++;
+  auto node = worker % nodes.size();
+  const auto& cpus = nodes[node];
+  auto cpu = cpus[(worker / nodes.size()) % cpus.size()];
+  return boost::thread(attrs, [node, cpu, pin_workers = m_pin_workers,
+                               per_worker_arenas = m_per_worker_arenas,
+                               run = std::move(bound_run)]() {
+    bool pinned = pin_workers && pin_current_thread(node, cpu);
+    if (per_worker_arenas) {
+      jemalloc_util::use_dedicated_arena();
+    } else if (pinned) {
+      jemalloc_util::use_arena_for_node(node);
+    }
+    run();
+  });
 }
 
-void ThreadPool::create() { s_threadpool = new ThreadPool(); }
+void ThreadPool::create(bool pin_workers, bool per_worker_arenas) {
+  s_threadpool = new ThreadPool(pin_workers, per_worker_arenas);
+}
 
 void ThreadPool::destroy() {
   delete s_threadpool;
   s_threadpool = nullptr;
 }
 
+int ThreadPool::current_numa_node() { return s_numa_node; }
+
+size_t ThreadPool::numa_node_count() { return cpus_by_node().size(); }
+
 } // namespace redex_thread_pool
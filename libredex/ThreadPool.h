@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <vector>
+
 // We for now need a larger stack size than the default, and on Mac OS
 // this is the only way (or pthreads directly), as `ulimit -s` does not
 // apply to non-main threads.
@@ -20,12 +22,32 @@ class ThreadPool : public sparta::ThreadPool<boost::thread> {
  public:
   static ThreadPool* get_instance();
 
-  static void create();
+  // When pin_workers is set, every worker thread is pinned to one CPU, going
+  // round-robin over the NUMA nodes, and allocates from a jemalloc arena
+  // dedicated to its node. Pinning is only supported on Linux, and a no-op
+  // elsewhere. When per_worker_arenas is set, every worker instead allocates
+  // from a jemalloc arena of its own.
+  static void create(bool pin_workers = false, bool per_worker_arenas = false);
 
   static void destroy();
 
+  // The NUMA node the current thread is pinned to, or -1 if it is not a
+  // pinned worker.
+  static int current_numa_node();
+
+  // The number of NUMA nodes of this machine, at least 1.
+  static size_t numa_node_count();
+
  protected:
+  ThreadPool(bool pin_workers, bool per_worker_arenas)
+      : m_pin_workers(pin_workers), m_per_worker_arenas(per_worker_arenas) {}
+
   boost::thread create_thread(std::function<void()> bound_f) override;
+
+ private:
+  bool m_pin_workers;
+  bool m_per_worker_arenas;
+  size_t m_next_worker{0};
 };
 
 } // namespace redex_thread_pool
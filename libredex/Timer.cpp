@@ -8,6 +8,7 @@
 #include "Timer.h"
 
 #include <list>
+#include <unistd.h>
 
 #include "Trace.h"
 
@@ -35,6 +36,9 @@ Timer::~Timer() {
   TRACE(TIME, 1, "%*s%s completed in %.1lf seconds", 4 * s_indent, "",
         m_msg.c_str(), duration_s);
 
+  if (Timeline::enabled()) {
+    Timeline::add_event(m_msg, "timer", m_start, end);
+  }
   Timer::add_timer(std::move(m_msg), duration_s);
 }
 
@@ -67,3 +71,157 @@ void AccumulatingTimer::add_timer(
   }
   s_times->emplace_back(std::move(msg), std::move(microseconds));
 }
+
+std::atomic<bool> Timeline::s_enabled{false};
+
+namespace {
+
+struct TimelineEvent {
+  std::string name;
+  const char* category;
+  Timeline::clock::time_point begin;
+  Timeline::clock::time_point end;
+};
+
+// The events of one thread. Only that thread adds to them, so the lock is
+// hardly ever contended.
+struct ThreadTimeline {
+  size_t tid;
+  std::mutex lock;
+  std::vector<TimelineEvent> events;
+  // The batch whose items the thread processed last, still to be added.
+  size_t batch_id{0};
+  Timeline::clock::time_point batch_begin;
+  Timeline::clock::time_point batch_end;
+
+  explicit ThreadTimeline(size_t tid) : tid(tid) {}
+
+  void flush_batch() {
+    if (batch_id != 0) {
+      events.push_back(
+          TimelineEvent{"batch " + std::to_string(batch_id), "workqueue",
+                        batch_begin, batch_end});
+      batch_id = 0;
+    }
+  }
+};
+
+std::mutex s_timeline_lock;
+// Allocated dynamically and never freed, as threads may still record while
+// static objects are destroyed.
+std::vector<std::unique_ptr<ThreadTimeline>>* s_thread_timelines{nullptr};
+Timeline::clock::time_point s_timeline_start;
+std::atomic<size_t> s_next_batch_id{1};
+
+ThreadTimeline& thread_timeline() {
+  thread_local ThreadTimeline* timeline = []() {
+    std::lock_guard<std::mutex> guard(s_timeline_lock);
+    auto& timelines = *s_thread_timelines;
+    timelines.push_back(std::make_unique<ThreadTimeline>(timelines.size()));
+    return timelines.back().get();
+  }();
+  return *timeline;
+}
+
+void write_json_string(std::ostream& os, const std::string& str) {
+  os << '"';
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      os << '\\' << c;
+    } else if ((unsigned char)c < 0x20) {
+      os << ' ';
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+
+int64_t timeline_micros(Timeline::clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             time - s_timeline_start)
+      .count();
+}
+
+} // namespace
+
+void Timeline::enable() {
+  std::lock_guard<std::mutex> guard(s_timeline_lock);
+  if (s_thread_timelines == nullptr) {
+    s_thread_timelines = new std::vector<std::unique_ptr<ThreadTimeline>>();
+    s_timeline_start = clock::now();
+  }
+  s_enabled = true;
+}
+
+void Timeline::add_event(const std::string& name,
+                         const char* category,
+                         clock::time_point begin,
+                         clock::time_point end) {
+  if (!enabled()) {
+    return;
+  }
+  auto& timeline = thread_timeline();
+  std::lock_guard<std::mutex> guard(timeline.lock);
+  timeline.events.push_back(TimelineEvent{name, category, begin, end});
+}
+
+Timeline::Scope::Scope(std::string name, const char* category)
+    : m_name(std::move(name)), m_category(category) {
+  if (enabled()) {
+    m_begin = clock::now();
+  }
+}
+
+Timeline::Scope::~Scope() {
+  if (enabled() && m_begin != clock::time_point()) {
+    add_event(m_name, m_category, m_begin, clock::now());
+  }
+}
+
+size_t Timeline::new_batch_id() {
+  return s_next_batch_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Timeline::BatchItem::begin(size_t batch_id) {
+  auto& timeline = thread_timeline();
+  auto now = clock::now();
+  std::lock_guard<std::mutex> guard(timeline.lock);
+  if (timeline.batch_id != batch_id) {
+    timeline.flush_batch();
+    timeline.batch_id = batch_id;
+    timeline.batch_begin = now;
+  }
+  m_recording = true;
+}
+
+void Timeline::BatchItem::end() {
+  auto& timeline = thread_timeline();
+  auto now = clock::now();
+  std::lock_guard<std::mutex> guard(timeline.lock);
+  timeline.batch_end = now;
+}
+
+void Timeline::write(std::ostream& os) {
+  std::lock_guard<std::mutex> guard(s_timeline_lock);
+  auto pid = getpid();
+  os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  if (s_thread_timelines != nullptr) {
+    for (auto& timeline : *s_thread_timelines) {
+      std::lock_guard<std::mutex> timeline_guard(timeline->lock);
+      timeline->flush_batch();
+      for (const auto& event : timeline->events) {
+        os << (first ? "\n" : ",\n") << "{\"name\":";
+        first = false;
+        write_json_string(os, event.name);
+        os << ",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"ts\":"
+           << timeline_micros(event.begin)
+           << ",\"dur\":" << timeline_micros(event.end) -
+                                  timeline_micros(event.begin)
+           << ",\"pid\":" << pid << ",\"tid\":" << timeline->tid << "}";
+      }
+    }
+  }
+  os << "\n]}\n";
+}
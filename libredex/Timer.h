@@ -12,6 +12,7 @@
 #include <list>
 #include <memory>
 #include <mutex>
+#include <ostream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -95,3 +96,71 @@ class AccumulatingTimer {
   std::shared_ptr<std::atomic<uint64_t>> m_microseconds{
       std::make_shared<std::atomic<uint64_t>>(0)};
 };
+
+// Once enabled, records on which thread Timers, the phases of passes and the
+// batches of work queues begin and end, and writes them in the Chrome Trace
+// Event format, so that chrome://tracing or Perfetto can show the timeline of
+// a run, including how well its threads are utilized.
+class Timeline {
+ public:
+  using clock = std::chrono::high_resolution_clock;
+
+  static void enable();
+  static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+  // Records an event of the current thread.
+  static void add_event(const std::string& name,
+                        const char* category,
+                        clock::time_point begin,
+                        clock::time_point end);
+
+  // Records its lifetime as an event, if enabled.
+  class Scope {
+   public:
+    Scope(std::string name, const char* category);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    std::string m_name;
+    const char* m_category;
+    clock::time_point m_begin;
+  };
+
+  // Each work queue is a batch. The items of a batch that a thread processes
+  // are merged into a single event, from the start of its first one to the
+  // end of its last one.
+  static size_t new_batch_id();
+
+  class BatchItem {
+   public:
+    explicit BatchItem(size_t batch_id) {
+      if (enabled()) {
+        begin(batch_id);
+      }
+    }
+    ~BatchItem() {
+      if (m_recording) {
+        end();
+      }
+    }
+
+    BatchItem(const BatchItem&) = delete;
+    BatchItem& operator=(const BatchItem&) = delete;
+
+   private:
+    void begin(size_t batch_id);
+    void end();
+
+    bool m_recording{false};
+  };
+
+  // Writes all events recorded so far. Should not run concurrently with
+  // recording.
+  static void write(std::ostream& os);
+
+ private:
+  static std::atomic<bool> s_enabled;
+};
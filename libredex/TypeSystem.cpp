@@ -7,6 +7,8 @@
 
 #include "TypeSystem.h"
 
+#include <algorithm>
+
 #include "DexUtil.h"
 #include "RedexContext.h"
 #include "Resolver.h"
@@ -187,6 +189,68 @@ void TypeSystem::make_instanceof_interfaces_table() {
   for (const auto& root : no_parents) {
     make_interfaces_table(root);
   }
+  for (const auto& root : no_parents) {
+    if (m_intervals.count(root) == 0) {
+      make_intervals(root);
+    }
+  }
+  make_implementor_intervals();
+}
+
+void TypeSystem::make_intervals(const DexType* type) {
+  auto first = static_cast<uint32_t>(m_preorder.size());
+  m_preorder.push_back(type);
+  const auto& hierarchy = m_class_scopes.get_class_hierarchy();
+  const auto& children = hierarchy.find(type);
+  if (children != hierarchy.end()) {
+    for (const auto& child : children->second) {
+      make_intervals(child);
+    }
+  }
+  auto last = static_cast<uint32_t>(m_preorder.size() - 1);
+  m_intervals.emplace(type, TypeInterval{first, last});
+}
+
+void TypeSystem::make_implementor_intervals() {
+  for (const auto& [intf, implementors] : m_class_scopes.get_interface_map()) {
+    std::vector<TypeInterval> intervals;
+    for (const auto& cls : implementors) {
+      const auto& interval = m_intervals.find(cls);
+      if (interval != m_intervals.end()) {
+        intervals.push_back(interval->second);
+      }
+    }
+    std::sort(intervals.begin(), intervals.end(),
+              [](const TypeInterval& a, const TypeInterval& b) {
+                return a.first < b.first;
+              });
+    // Intervals either nest or are disjoint; only keep the outermost ones.
+    auto& disjoint = m_implementor_intervals[intf];
+    for (const auto& interval : intervals) {
+      if (disjoint.empty() || !disjoint.back().contains(interval.first)) {
+        disjoint.push_back(interval);
+      }
+    }
+  }
+}
+
+bool TypeSystem::implements(const DexType* cls, const DexType* intf) const {
+  const auto& interval = m_intervals.find(cls);
+  if (interval == m_intervals.end()) {
+    const auto& implementors = m_class_scopes.get_interface_map().find(intf);
+    if (implementors == m_class_scopes.get_interface_map().end()) return false;
+    return implementors->second.count(cls) > 0;
+  }
+  const auto& intervals = m_implementor_intervals.find(intf);
+  if (intervals == m_implementor_intervals.end()) return false;
+  auto number = interval->second.first;
+  // Find the last interval that starts at or before the class.
+  auto it = std::upper_bound(intervals->second.begin(),
+                             intervals->second.end(), number,
+                             [](uint32_t n, const TypeInterval& interval) {
+                               return n < interval.first;
+                             });
+  return it != intervals->second.begin() && std::prev(it)->contains(number);
 }
 
 void TypeSystem::make_interfaces_table(const DexType* type) {
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <unordered_map>
 
 #include "ClassHierarchy.h"
@@ -35,10 +36,31 @@ class TypeSystem {
   static const TypeSet empty_set;
   static const TypeVector empty_vec;
 
+  // The range of DFS pre-order numbers of a class and its subclasses, both
+  // inclusive. A class is a subclass of another iff its number falls within
+  // the interval of the other.
+  struct TypeInterval {
+    uint32_t first;
+    uint32_t last;
+
+    bool contains(uint32_t number) const {
+      return first <= number && number <= last;
+    }
+  };
+
   ClassScopes m_class_scopes;
   ClassHierarchy m_intf_children;
   InstanceOfTable m_instanceof_table;
   TypeToTypeSet m_interfaces;
+  // All classes of the class hierarchy, in DFS pre-order, so that the
+  // subclasses of a class follow it contiguously.
+  TypeVector m_preorder;
+  std::unordered_map<const DexType*, TypeInterval> m_intervals;
+  // For each interface, the disjoint intervals of its implementors, sorted.
+  // Implementors are closed under subclassing, so this is usually much
+  // smaller than the set of implementors.
+  std::unordered_map<const DexType*, std::vector<TypeInterval>>
+      m_implementor_intervals;
 
  public:
   explicit TypeSystem(const Scope& scope);
@@ -59,8 +81,13 @@ class TypeSystem {
    * The type must be a class (not an interface).
    */
   void get_all_children(const DexType* type, TypeSet& children) const {
-    return ::get_all_children(
-        m_class_scopes.get_class_hierarchy(), type, children);
+    const auto& interval = m_intervals.find(type);
+    if (interval == m_intervals.end()) {
+      return ::get_all_children(
+          m_class_scopes.get_class_hierarchy(), type, children);
+    }
+    children.insert(m_preorder.begin() + interval->second.first + 1,
+                    m_preorder.begin() + interval->second.last + 1);
   }
 
   /**
@@ -107,16 +134,12 @@ class TypeSystem {
    * The type must be a class (not an interface).
    */
   bool is_subtype(const DexType* parent, const DexType* child) const {
-    const auto& parent_it = m_instanceof_table.find(parent);
-    const auto& child_it = m_instanceof_table.find(child);
-    if (parent_it == m_instanceof_table.end() ||
-        child_it == m_instanceof_table.end()) {
+    const auto& parent_it = m_intervals.find(parent);
+    const auto& child_it = m_intervals.find(child);
+    if (parent_it == m_intervals.end() || child_it == m_intervals.end()) {
       return false;
     }
-    const auto& p_chain = parent_it->second;
-    const auto& c_chain = child_it->second;
-    if (p_chain.size() > c_chain.size()) return false;
-    return c_chain.at(p_chain.size() - 1) == parent;
+    return parent_it->second.contains(child_it->second.first);
   }
 
   /**
@@ -124,11 +147,7 @@ class TypeSystem {
    * The interface may be implemented via some parent of the class
    * or an interface DAG.
    */
-  bool implements(const DexType* cls, const DexType* intf) const {
-    const auto& implementors = m_class_scopes.get_interface_map().find(intf);
-    if (implementors == m_class_scopes.get_interface_map().end()) return false;
-    return implementors->second.count(cls) > 0;
-  }
+  bool implements(const DexType* cls, const DexType* intf) const;
 
   /**
    * Return all classes that implement an interface.
@@ -224,4 +243,6 @@ class TypeSystem {
  private:
   void make_instanceof_interfaces_table();
   void make_interfaces_table(const DexType* type);
+  void make_intervals(const DexType* type);
+  void make_implementor_intervals();
 };
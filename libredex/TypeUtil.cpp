@@ -355,75 +355,19 @@ DexType* get_boxed_reference_type(const DexType* type) {
 
 // Takes a reference type, returns its corresponding unboxing method
 DexMethodRef* get_unboxing_method_for_type(const DexType* type) {
-  if (type == type::java_lang_Boolean()) {
-    return DexMethod::make_method("Ljava/lang/Boolean;.booleanValue:()Z");
-  } else if (type == type::java_lang_Byte()) {
-    return DexMethod::make_method("Ljava/lang/Byte;.byteValue:()B");
-  } else if (type == type::java_lang_Short()) {
-    return DexMethod::make_method("Ljava/lang/Short;.shortValue:()S");
-  } else if (type == type::java_lang_Character()) {
-    return DexMethod::make_method("Ljava/lang/Character;.charValue:()C");
-  } else if (type == type::java_lang_Integer()) {
-    return DexMethod::make_method("Ljava/lang/Integer;.intValue:()I");
-  } else if (type == type::java_lang_Long()) {
-    return DexMethod::make_method("Ljava/lang/Long;.longValue:()J");
-  } else if (type == type::java_lang_Float()) {
-    return DexMethod::make_method("Ljava/lang/Float;.floatValue:()F");
-  } else if (type == type::java_lang_Double()) {
-    return DexMethod::make_method("Ljava/lang/Double;.doubleValue:()D");
-  }
-  return nullptr;
+  const auto* boxing = g_redex->pointers_cache().boxing(type);
+  return boxing == nullptr ? nullptr : boxing->unboxing;
 }
 
 DexMethodRef* get_Number_unboxing_method_for_type(const DexType* type) {
-  if (type == type::java_lang_Boolean()) {
-    return DexMethod::make_method("Ljava/lang/Number;.booleanValue:()Z");
-  } else if (type == type::java_lang_Byte()) {
-    return DexMethod::make_method("Ljava/lang/Number;.byteValue:()B");
-  } else if (type == type::java_lang_Short()) {
-    return DexMethod::make_method("Ljava/lang/Number;.shortValue:()S");
-  } else if (type == type::java_lang_Character()) {
-    return DexMethod::make_method("Ljava/lang/Number;.charValue:()C");
-  } else if (type == type::java_lang_Integer()) {
-    return DexMethod::make_method("Ljava/lang/Number;.intValue:()I");
-  } else if (type == type::java_lang_Long()) {
-    return DexMethod::make_method("Ljava/lang/Number;.longValue:()J");
-  } else if (type == type::java_lang_Float()) {
-    return DexMethod::make_method("Ljava/lang/Number;.floatValue:()F");
-  } else if (type == type::java_lang_Double()) {
-    return DexMethod::make_method("Ljava/lang/Number;.doubleValue:()D");
-  }
-  return nullptr;
+  const auto* boxing = g_redex->pointers_cache().boxing(type);
+  return boxing == nullptr ? nullptr : boxing->number_unboxing;
 }
 
 // Take a reference type, returns its valueOf function
 DexMethodRef* get_value_of_method_for_type(const DexType* type) {
-  if (type == type::java_lang_Boolean()) {
-    return DexMethod::make_method(
-        "Ljava/lang/Boolean;.valueOf:(Z)Ljava/lang/Boolean;");
-  } else if (type == type::java_lang_Byte()) {
-    return DexMethod::make_method(
-        "Ljava/lang/Byte;.valueOf:(B)Ljava/lang/Byte;");
-  } else if (type == type::java_lang_Short()) {
-    return DexMethod::make_method(
-        "Ljava/lang/Short;.valueOf:(S)Ljava/lang/Short;");
-  } else if (type == type::java_lang_Character()) {
-    return DexMethod::make_method(
-        "Ljava/lang/Character;.valueOf:(C)Ljava/lang/Character;");
-  } else if (type == type::java_lang_Integer()) {
-    return DexMethod::make_method(
-        "Ljava/lang/Integer;.valueOf:(I)Ljava/lang/Integer;");
-  } else if (type == type::java_lang_Long()) {
-    return DexMethod::make_method(
-        "Ljava/lang/Long;.valueOf:(J)Ljava/lang/Long;");
-  } else if (type == type::java_lang_Float()) {
-    return DexMethod::make_method(
-        "Ljava/lang/Float;.valueOf:(F)Ljava/lang/Float;");
-  } else if (type == type::java_lang_Double()) {
-    return DexMethod::make_method(
-        "Ljava/lang/Double;.valueOf:(D)Ljava/lang/Double;");
-  }
-  return nullptr;
+  const auto* boxing = g_redex->pointers_cache().boxing(type);
+  return boxing == nullptr ? nullptr : boxing->value_of;
 }
 
 DataType to_datatype(const DexType* t) {
@@ -7,8 +7,11 @@
 
 #include "VirtualScope.h"
 
+#include <algorithm>
+#include <boost/functional/hash.hpp>
 #include <map>
 #include <set>
+#include <unordered_set>
 
 #include "Creators.h"
 #include "DexAccess.h"
@@ -17,6 +20,7 @@
 #include "Show.h"
 #include "Timer.h"
 #include "Trace.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -173,28 +177,110 @@ void create_object_class() {
 
 } // namespace
 
-// map from a proto to the set of interface implementing that sig
-using IntfProtoMap = std::map<const DexProto*, TypeSet, dexprotos_comparator>;
+namespace virt_scope {
+namespace {
 
-// a map from name to signatures for a set of interfaces
-using BaseIntfSigs =
-    std::map<const DexString*, IntfProtoMap, dexstrings_comparator>;
+// A (name, proto) signature.
+using Signature = std::pair<const DexString*, const DexProto*>;
 
-// map to track signatures as (name, sig)
-using BaseSigs = std::map<const DexString*,
-                          std::set<const DexProto*, dexprotos_comparator>,
-                          dexstrings_comparator>;
+// A signature interned as a dense id (see SignatureIds).
+using SigId = uint32_t;
+
+// The virtual scopes of a type and its children, sorted by signature id.
+using SigScopes = std::vector<std::pair<SigId, VirtualScopes>>;
+
+// The signatures of the virtual methods in a type, sorted.
+using BaseSigs = std::vector<SigId>;
+
+// The signatures of the interface methods of a type, with the interfaces
+// defining each of them, sorted by signature id.
+using BaseIntfSigs = std::vector<std::pair<SigId, TypeSet>>;
+
+/**
+ * Interns the signatures of all the virtual methods under java.lang.Object,
+ * and of the interfaces they implement.
+ * Ids are handed out in the order of the signatures in a SignatureMap, so that
+ * scopes sorted by id can be moved into a SignatureMap in order.
+ */
+class SignatureIds {
+ public:
+  explicit SignatureIds(const ClassHierarchy& hierarchy) {
+    std::unordered_set<const DexType*> visited_intfs;
+    std::vector<const DexType*> stack{type::java_lang_Object()};
+    while (!stack.empty()) {
+      const auto* type = stack.back();
+      stack.pop_back();
+      add_methods(get_vmethods(type));
+      const auto* cls = type_class(type);
+      if (cls != nullptr) {
+        add_interfaces(cls->get_interfaces(), visited_intfs);
+      }
+      const auto& children = get_children(hierarchy, type);
+      stack.insert(stack.end(), children.begin(), children.end());
+    }
+    std::sort(m_sigs.begin(), m_sigs.end(),
+              [](const Signature& a, const Signature& b) {
+                if (a.first != b.first) {
+                  return compare_dexstrings(a.first, b.first);
+                }
+                return compare_dexprotos(a.second, b.second);
+              });
+    m_sigs.erase(std::unique(m_sigs.begin(), m_sigs.end()), m_sigs.end());
+    m_ids.reserve(m_sigs.size());
+    for (SigId id = 0; id < m_sigs.size(); ++id) {
+      m_ids.emplace(m_sigs[id], id);
+    }
+  }
+
+  SigId get(const DexString* name, const DexProto* proto) const {
+    return m_ids.at(Signature(name, proto));
+  }
+
+  const Signature& get_signature(SigId id) const { return m_sigs[id]; }
+
+ private:
+  void add_methods(const std::vector<DexMethod*>& methods) {
+    for (const auto* meth : methods) {
+      m_sigs.emplace_back(meth->get_name(), meth->get_proto());
+    }
+  }
+
+  void add_interfaces(const DexTypeList* interfaces,
+                      std::unordered_set<const DexType*>& visited) {
+    for (const auto* intf : *interfaces) {
+      if (!visited.insert(intf).second) continue;
+      const auto* intf_cls = type_class(intf);
+      if (intf_cls == nullptr) continue;
+      add_methods(intf_cls->get_vmethods());
+      add_interfaces(intf_cls->get_interfaces(), visited);
+    }
+  }
+
+  std::vector<Signature> m_sigs;
+  std::unordered_map<Signature, SigId, boost::hash<Signature>> m_ids;
+};
+
+template <typename Entries>
+auto find_sig(Entries& entries, SigId id) {
+  auto it = std::lower_bound(
+      entries.begin(), entries.end(), id,
+      [](const auto& entry, SigId sig) { return entry.first < sig; });
+  return it != entries.end() && it->first == id ? it : entries.end();
+}
+
+bool by_sig(const std::pair<SigId, VirtualScopes>& a,
+            const std::pair<SigId, VirtualScopes>& b) {
+  return a.first < b.first;
+}
 
-namespace virt_scope {
 /**
  * Create a BaseSig which is the set of method definitions in a type.
  */
-BaseSigs load_base_sigs(SignatureMap& sig_map) {
+BaseSigs load_base_sigs(const SigScopes& sig_map) {
   BaseSigs base_sigs;
-  for (const auto& proto_it : sig_map) {
-    for (const auto& scope : proto_it.second) {
-      base_sigs[proto_it.first].insert(scope.first);
-    }
+  base_sigs.reserve(sig_map.size());
+  for (const auto& sig_it : sig_map) {
+    base_sigs.push_back(sig_it.first);
   }
   return base_sigs;
 }
@@ -235,11 +321,9 @@ void escape_all(VirtualScopes& scopes) {
  * if an interface at the class level is marked ESCAPED
  * everything defined in base and children escapes as well.
  */
-void escape_all(SignatureMap& sig_map) {
-  for (auto& protos_it : sig_map) {
-    for (auto& scopes_it : protos_it.second) {
-      escape_all(scopes_it.second);
-    }
+void escape_all(SigScopes& sig_map) {
+  for (auto& scopes_it : sig_map) {
+    escape_all(scopes_it.second);
   }
 }
 
@@ -248,41 +332,40 @@ void escape_all(SignatureMap& sig_map) {
  * Walk through all the method definitions in base.
  */
 void mark_methods(const DexType* type,
-                  SignatureMap& sig_map,
+                  SigScopes& sig_map,
                   const BaseSigs& base_sigs,
                   bool escape) {
-  for (const auto& protos_it : base_sigs) {
-    const auto name = protos_it.first;
-    for (const auto& proto : protos_it.second) {
-      auto& scopes = sig_map[name][proto];
-      always_assert(!scopes.empty());
-      always_assert(scopes[0].type == type);
-      // mark final and override accordingly
-      auto& first_scope = scopes[0];
-      if (first_scope.methods.size() == 1) {
-        TRACE(VIRT, 6, "FINAL %s", SHOW(first_scope.methods[0].first));
-        first_scope.methods[0].second |= FINAL;
-      } else {
-        for (auto meth = first_scope.methods.begin() + 1;
-             meth != first_scope.methods.end();
-             meth++) {
-          TRACE(VIRT, 6, "OVERRIDE %s", SHOW((*meth).first));
-          (*meth).second |= OVERRIDE;
-        }
-      }
-      // all others must be interfaces but we have a definition
-      // in base so they must all be override
-      if (scopes.size() > 1) {
-        for (auto scope = scopes.begin() + 1; scope != scopes.end(); scope++) {
-          always_assert(!(*scope).methods.empty());
-          TRACE(VIRT, 6, "OVERRIDE %s", SHOW((*scope).methods[0].first));
-          (*scope).methods[0].second |= OVERRIDE;
-        }
+  for (auto sig : base_sigs) {
+    auto scopes_it = find_sig(sig_map, sig);
+    always_assert(scopes_it != sig_map.end());
+    auto& scopes = scopes_it->second;
+    always_assert(!scopes.empty());
+    always_assert(scopes[0].type == type);
+    // mark final and override accordingly
+    auto& first_scope = scopes[0];
+    if (first_scope.methods.size() == 1) {
+      TRACE(VIRT, 6, "FINAL %s", SHOW(first_scope.methods[0].first));
+      first_scope.methods[0].second |= FINAL;
+    } else {
+      for (auto meth = first_scope.methods.begin() + 1;
+           meth != first_scope.methods.end();
+           meth++) {
+        TRACE(VIRT, 6, "OVERRIDE %s", SHOW((*meth).first));
+        (*meth).second |= OVERRIDE;
       }
-      if (escape) {
-        escape_all(scopes);
+    }
+    // all others must be interfaces but we have a definition
+    // in base so they must all be override
+    if (scopes.size() > 1) {
+      for (auto scope = scopes.begin() + 1; scope != scopes.end(); scope++) {
+        always_assert(!(*scope).methods.empty());
+        TRACE(VIRT, 6, "OVERRIDE %s", SHOW((*scope).methods[0].first));
+        (*scope).methods[0].second |= OVERRIDE;
       }
     }
+    if (escape) {
+      escape_all(scopes);
+    }
   }
 }
 
@@ -295,169 +378,143 @@ void mark_methods(const DexType* type,
  * in the VirtualScope for A.m().
  */
 void build_interface_scope(const DexType* type,
-                           SignatureMap& sig_map,
+                           SigScopes& sig_map,
                            const BaseIntfSigs& intf_sig_map) {
-  for (const auto& proto_it : intf_sig_map) {
-    for (const auto& intfs_it : proto_it.second) {
-      auto& scopes = sig_map[proto_it.first][intfs_it.first];
-      // first virtual scope must be that in type, it's the first we built
-      always_assert(scopes[0].type == type);
-      // mark impl all the class virtual scope
-      for (auto& meth : scopes[0].methods) {
-        TRACE(VIRT, 6, "IMPL %s", SHOW(meth.first));
-        meth.second |= IMPL;
-      }
-      // remaining scopes must be for interfaces so they are
-      // marked IMPL already.
-      // Scope for interfaces in base are not there yet so
-      // make a copy of the class virtual scope for every
-      // interface scope
-      const auto& intfs = intfs_it.second;
-      for (const auto& intf : intfs) {
-        VirtualScope vg;
-        vg.type = intf;
-        vg.methods = scopes[0].methods;
-        scopes.push_back(vg);
-      }
+  for (const auto& [sig, intfs] : intf_sig_map) {
+    auto scopes_it = find_sig(sig_map, sig);
+    always_assert(scopes_it != sig_map.end());
+    auto& scopes = scopes_it->second;
+    // first virtual scope must be that in type, it's the first we built
+    always_assert(scopes[0].type == type);
+    // mark impl all the class virtual scope
+    for (auto& meth : scopes[0].methods) {
+      TRACE(VIRT, 6, "IMPL %s", SHOW(meth.first));
+      meth.second |= IMPL;
+    }
+    // remaining scopes must be for interfaces so they are
+    // marked IMPL already.
+    // Scope for interfaces in base are not there yet so
+    // make a copy of the class virtual scope for every
+    // interface scope
+    for (const auto& intf : intfs) {
+      VirtualScope vg;
+      vg.type = intf;
+      vg.methods = scopes[0].methods;
+      scopes.push_back(vg);
     }
   }
 }
 
 /**
- * Merge 2 signatures map. The map from derived_sig_map is copied in
- * base_sig_map.
+ * Merge the scopes of a derived type into those of base, which are walked
+ * side by side in signature order.
  * Interface methods in base don't have an entry yet, that will be build later
  * because it's a straight copy of the class virtual scope.
  */
-void merge(const BaseSigs& base_sigs,
+void merge(const SignatureIds& ids,
+           const BaseSigs& base_sigs,
            const BaseIntfSigs& base_intf_sig_map,
-           SignatureMap& base_sig_map,
-           const SignatureMap& derived_sig_map) {
+           SigScopes& base_sig_map,
+           SigScopes&& derived_sig_map) {
 
   // Helpers
 
-  // is_base_sig(name, proto) - is the (name, proto) a definition in base
-  const auto is_base_sig = [&](const DexString* name, const DexProto* proto) {
-    TRACE(VIRT, 5, "/check base sigs for %s:%s", SHOW(name), SHOW(proto));
-    const auto sigs = base_sigs.find(name);
-    if (sigs == base_sigs.end()) return false;
-    return sigs->second.count(proto) > 0;
+  // is_base_sig(sig) - is the signature a definition in base
+  const auto is_base_sig = [&](SigId sig) {
+    return std::binary_search(base_sigs.begin(), base_sigs.end(), sig);
   };
 
-  // is_base_intf_sig(name, proto) - is the (name, proto) an interface in base
-  const auto is_base_intf_sig =
-      [&](const DexString* name, const DexProto* proto, const DexType* intf) {
-        TRACE(VIRT,
-              5,
-              "/check base intf (%s) sigs for %s:%s",
-              SHOW(intf),
-              SHOW(name),
-              SHOW(proto));
-        const auto& sigs = base_intf_sig_map.find(name);
-        if (sigs == base_intf_sig_map.end()) return false;
-        const auto& intfs_it = sigs->second.find(proto);
-        if (intfs_it == sigs->second.end()) return false;
-        return intfs_it->second.count(intf) > 0;
-      };
-
-  // walk all derived signatures
-  for (const auto& derived_sig_entry : derived_sig_map) {
-    const auto name = derived_sig_entry.first;
-    auto& name_map = base_sig_map[name];
-    auto& derived_protos_map = derived_sig_entry.second;
-    for (const auto& derived_scopes_it : derived_protos_map) {
-      const auto proto = derived_scopes_it.first;
-      auto& virt_scopes = name_map[proto];
-      // the signature in derived does not exists in base
-      if (!is_base_sig(name, proto)) {
-        TRACE(VIRT,
-              4,
-              "- no scope (%s:%s) in base, copy over",
-              SHOW(name),
-              SHOW(proto));
-        // not a known signature in original base, copy over
-        const auto& scopes = derived_scopes_it.second;
-        virt_scopes.insert(virt_scopes.end(), scopes.begin(), scopes.end());
-        if (traceEnabled(VIRT, 4)) {
-          for (const auto& scope : scopes) {
-            TRACE(VIRT,
-                  4,
-                  "- copy %s (%s:%s): (%zu) %s",
-                  SHOW(scope.type),
-                  SHOW(name),
-                  SHOW(proto),
-                  scope.methods.size(),
-                  SHOW(scope.methods[0].first));
-          }
-        }
-        continue;
-      }
+  // is_base_intf_sig(sig, intf) - is the signature an interface in base
+  const auto is_base_intf_sig = [&](SigId sig, const DexType* intf) {
+    const auto intfs_it = find_sig(base_intf_sig_map, sig);
+    if (intfs_it == base_intf_sig_map.end()) return false;
+    return intfs_it->second.count(intf) > 0;
+  };
 
-      // it's a sig (name, proto) in original base, the derived entry
-      // needs to merge
-      // first scope in base_sig_map must be that of the type under
-      // analysis because we built it first and added to the empty vector
-      always_assert(!virt_scopes.empty());
+  SigScopes merged;
+  merged.reserve(base_sig_map.size() + derived_sig_map.size());
+  auto base_it = base_sig_map.begin();
+  for (auto& [sig, scopes] : derived_sig_map) {
+    while (base_it != base_sig_map.end() && base_it->first < sig) {
+      merged.push_back(std::move(*base_it++));
+    }
+    const auto& [name, proto] = ids.get_signature(sig);
+    if (base_it == base_sig_map.end() || base_it->first != sig) {
       TRACE(VIRT,
             4,
-            "- found existing scopes for %s:%s (%zu) - first: %s, %zu, %zu",
+            "- no scope (%s:%s) in base, copy over",
             SHOW(name),
-            SHOW(proto),
-            virt_scopes.size(),
-            SHOW(virt_scopes[0].type),
-            virt_scopes[0].methods.size(),
-            virt_scopes[0].interfaces.size());
-      always_assert(virt_scopes[0].type == type::java_lang_Object() ||
-                    !is_interface(type_class(virt_scopes[0].type)));
-      // walk every scope in derived that we have to merge
-      TRACE(VIRT, 4, "-- walking scopes");
-      for (const auto& scope : derived_scopes_it.second) {
-        // if the scope was for a class (!interface) we merge
-        // with that of base which is now the top definition
-        TRACE(VIRT,
-              4,
-              "-- checking scope type %s(%zu)",
-              SHOW(scope.type),
-              scope.methods.size());
-        TRACE(VIRT,
-              4,
-              "-- is interface 0x%p %d",
-              scope.type,
-              scope.type != type::java_lang_Object() &&
-                  is_interface(type_class(scope.type)));
-        if (scope.type == type::java_lang_Object() ||
-            !is_interface(type_class(scope.type))) {
-          TRACE(VIRT,
-                4,
-                "-- merging with base scopes %s(%zu) : %s",
-                SHOW(virt_scopes[0].type),
-                virt_scopes[0].methods.size(),
-                SHOW(virt_scopes[0].methods[0].first));
-          merge(virt_scopes[0], scope);
-          continue;
-        }
-        // interface case. If derived was for an interface in base
-        // do nothing because we will create those entries later
-        if (!is_base_intf_sig(name, proto, scope.type)) {
-          TRACE(VIRT,
-                4,
-                "-- unimplemented interface %s:%s - %s, %s",
-                SHOW(name),
-                SHOW(proto),
-                SHOW(scope.type),
-                SHOW(scope.methods[0].first));
-          virt_scopes.push_back(scope);
-          continue;
-        }
+            SHOW(proto));
+      merged.emplace_back(sig, std::move(scopes));
+      continue;
+    }
+    auto& virt_scopes = base_it->second;
+    // the signature in derived does not exists in base
+    if (!is_base_sig(sig)) {
+      TRACE(VIRT,
+            4,
+            "- no scope (%s:%s) in base, copy over",
+            SHOW(name),
+            SHOW(proto));
+      // not a known signature in original base, copy over
+      virt_scopes.insert(virt_scopes.end(),
+                         std::make_move_iterator(scopes.begin()),
+                         std::make_move_iterator(scopes.end()));
+      merged.push_back(std::move(*base_it++));
+      continue;
+    }
+
+    // it's a sig (name, proto) in original base, the derived entry
+    // needs to merge
+    // first scope in base_sig_map must be that of the type under
+    // analysis because we built it first and added to the empty vector
+    always_assert(!virt_scopes.empty());
+    TRACE(VIRT,
+          4,
+          "- found existing scopes for %s:%s (%zu) - first: %s, %zu, %zu",
+          SHOW(name),
+          SHOW(proto),
+          virt_scopes.size(),
+          SHOW(virt_scopes[0].type),
+          virt_scopes[0].methods.size(),
+          virt_scopes[0].interfaces.size());
+    always_assert(virt_scopes[0].type == type::java_lang_Object() ||
+                  !is_interface(type_class(virt_scopes[0].type)));
+    // walk every scope in derived that we have to merge
+    for (auto& scope : scopes) {
+      // if the scope was for a class (!interface) we merge
+      // with that of base which is now the top definition
+      if (scope.type == type::java_lang_Object() ||
+          !is_interface(type_class(scope.type))) {
+        merge(virt_scopes[0], scope);
+        continue;
+      }
+      // interface case. If derived was for an interface in base
+      // do nothing because we will create those entries later
+      if (!is_base_intf_sig(sig, scope.type)) {
         TRACE(VIRT,
               4,
-              "-- implemented interface %s:%s - %s",
+              "-- unimplemented interface %s:%s - %s, %s",
               SHOW(name),
               SHOW(proto),
-              SHOW(scope.type));
+              SHOW(scope.type),
+              SHOW(scope.methods[0].first));
+        virt_scopes.push_back(std::move(scope));
+        continue;
       }
+      TRACE(VIRT,
+            4,
+            "-- implemented interface %s:%s - %s",
+            SHOW(name),
+            SHOW(proto),
+            SHOW(scope.type));
     }
+    merged.push_back(std::move(*base_it++));
   }
+  merged.insert(merged.end(),
+                std::make_move_iterator(base_it),
+                std::make_move_iterator(base_sig_map.end()));
+  base_sig_map = std::move(merged);
 }
 
 //
@@ -481,24 +538,30 @@ DexMethod* make_miranda(const DexType* type,
   return static_cast<DexMethod*>(miranda);
 }
 
-bool load_interfaces_methods(const DexTypeList*, BaseIntfSigs&);
+// (signature, interface defining it)
+using IntfMethods = std::vector<std::pair<SigId, const DexType*>>;
+
+bool load_interfaces_methods(const SignatureIds&,
+                             const DexTypeList*,
+                             IntfMethods&);
 
 /**
  * Load methods for a given interface and its super interfaces.
  * Return true if any interface escapes (no DexClass*).
  */
-bool load_interface_methods(const DexClass* intf_cls,
-                            BaseIntfSigs& intf_methods) {
+bool load_interface_methods(const SignatureIds& ids,
+                            const DexClass* intf_cls,
+                            IntfMethods& intf_methods) {
   bool escaped = false;
   const auto* interfaces = intf_cls->get_interfaces();
   if (!interfaces->empty()) {
-    if (load_interfaces_methods(interfaces, intf_methods)) {
+    if (load_interfaces_methods(ids, interfaces, intf_methods)) {
       escaped = true;
     }
   }
   for (const auto& meth : intf_cls->get_vmethods()) {
-    intf_methods[meth->get_name()][meth->get_proto()].insert(
-        intf_cls->get_type());
+    intf_methods.emplace_back(ids.get(meth->get_name(), meth->get_proto()),
+                              intf_cls->get_type());
   }
   return escaped;
 }
@@ -507,8 +570,9 @@ bool load_interface_methods(const DexClass* intf_cls,
  * Load methods for a list of interfaces.
  * If any interface escapes (no DexClass*) return true.
  */
-bool load_interfaces_methods(const DexTypeList* interfaces,
-                             BaseIntfSigs& intf_methods) {
+bool load_interfaces_methods(const SignatureIds& ids,
+                             const DexTypeList* interfaces,
+                             IntfMethods& intf_methods) {
   bool escaped = false;
   for (const auto& intf : *interfaces) {
     auto intf_cls = type_class(intf);
@@ -517,7 +581,7 @@ bool load_interfaces_methods(const DexTypeList* interfaces,
       escaped = true;
       continue;
     }
-    if (load_interface_methods(intf_cls, intf_methods)) {
+    if (load_interface_methods(ids, intf_cls, intf_methods)) {
       escaped = true;
     }
   }
@@ -527,24 +591,33 @@ bool load_interfaces_methods(const DexTypeList* interfaces,
 /**
  * Get all interface methods for a given type.
  */
-bool get_interface_methods(const DexType* type, BaseIntfSigs& intf_methods) {
-  always_assert_log(intf_methods.empty(), "intf_methods is an out param");
+bool get_interface_methods(const SignatureIds& ids,
+                           const DexType* type,
+                           BaseIntfSigs& intf_sig_map) {
+  always_assert_log(intf_sig_map.empty(), "intf_sig_map is an out param");
   // REVIEW: should we always have a DexClass for java.lang.Object?
   if (type == type::java_lang_Object()) return false;
   auto cls = type_class(type);
   always_assert_log(
       cls != nullptr, "DexClass must exist for type %s\n", SHOW(type));
-  bool escaped = false;
   const auto* interfaces = cls->get_interfaces();
-  if (!interfaces->empty()) {
-    if (load_interfaces_methods(interfaces, intf_methods)) escaped = true;
+  if (interfaces->empty()) return false;
+  IntfMethods intf_methods;
+  bool escaped = load_interfaces_methods(ids, interfaces, intf_methods);
+  std::sort(intf_methods.begin(), intf_methods.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+  for (const auto& [sig, intf] : intf_methods) {
+    if (intf_sig_map.empty() || intf_sig_map.back().first != sig) {
+      intf_sig_map.emplace_back(sig, TypeSet());
+    }
+    intf_sig_map.back().second.insert(intf);
   }
   return escaped;
 }
 
 /**
- * Make sure all the intereface methods are added to the SignatureMap.
- * SignatureMap in input contains only scopes for virtual in the class.
+ * Make sure all the intereface methods are added to the signature map.
+ * The signature map in input contains only scopes for virtual in the class.
  * After this step a type is fully specified with all its virtual methods
  * and all interface methods that did not have an implementation created
  * (as "pure miranda" methods).
@@ -553,66 +626,86 @@ bool get_interface_methods(const DexType* type, BaseIntfSigs& intf_methods) {
  * in this case we create an entry for A.m() and mark it miranda
  * even though the method did not exist. It will not be a def (!is_def()).
  */
-bool load_interfaces(const DexType* type,
-                     SignatureMap& sig_map,
+bool load_interfaces(const SignatureIds& ids,
+                     const DexType* type,
+                     SigScopes& sig_map,
                      BaseIntfSigs& intf_sig_map) {
-  bool escaped = get_interface_methods(type, intf_sig_map);
+  bool escaped = get_interface_methods(ids, type, intf_sig_map);
   const auto intf_flags = MIRANDA | IMPL;
   // sig_map contains only the virtual methods in the class and
   // intf_sig_map only the methods in the interface.
   // For any missing methods in the class we create a new (miranda) method.
   // If the method is there already we mark it miranda.
-  for (const auto& sig_it : intf_sig_map) {
-    for (const auto& proto_it : sig_it.second) {
-      const auto& name = sig_it.first;
-      const auto& proto = proto_it.first;
-      always_assert(sig_map[name][proto].size() <= 1);
-      if (sig_map[name][proto].empty()) {
-        // the method interface is not implemented in current
-        // type. The class is abstract or a definition up the
-        // hierarchy is present.
-        // Make a pure miranda entry
-        auto mir_meth = make_miranda(type, name, proto);
-        VirtualScope scope;
-        scope.type = type;
-        scope.methods.emplace_back(mir_meth, intf_flags);
-        sig_map[name][proto].push_back(scope);
-      } else {
-        // the method interface is implemented in the current
-        // type, mark it miranda
-        auto& scope = sig_map[name][proto][0];
-        always_assert(scope.methods.size() == 1);
-        scope.methods[0].second |= intf_flags;
-      }
+  SigScopes mirandas;
+  for (const auto& [sig, intfs] : intf_sig_map) {
+    auto scopes_it = find_sig(sig_map, sig);
+    if (scopes_it == sig_map.end()) {
+      // the method interface is not implemented in current
+      // type. The class is abstract or a definition up the
+      // hierarchy is present.
+      // Make a pure miranda entry
+      const auto& [name, proto] = ids.get_signature(sig);
+      auto mir_meth = make_miranda(type, name, proto);
+      VirtualScope scope;
+      scope.type = type;
+      scope.methods.emplace_back(mir_meth, intf_flags);
       // add the implemented interfaces to the class
       // virtual scope
-      sig_map[name][proto][0].interfaces.insert(proto_it.second.begin(),
-                                                proto_it.second.end());
+      scope.interfaces.insert(intfs.begin(), intfs.end());
+      mirandas.emplace_back(sig, VirtualScopes{std::move(scope)});
+    } else {
+      // the method interface is implemented in the current
+      // type, mark it miranda
+      always_assert(scopes_it->second.size() == 1);
+      auto& scope = scopes_it->second[0];
+      always_assert(scope.methods.size() == 1);
+      scope.methods[0].second |= intf_flags;
+      scope.interfaces.insert(intfs.begin(), intfs.end());
     }
   }
+  // Both are sorted by signature.
+  auto methods_end = sig_map.size();
+  sig_map.insert(sig_map.end(),
+                 std::make_move_iterator(mirandas.begin()),
+                 std::make_move_iterator(mirandas.end()));
+  std::inplace_merge(sig_map.begin(), sig_map.begin() + methods_end,
+                     sig_map.end(), by_sig);
   return escaped;
 }
 
 /**
  * Load all virtual methods in the given type and build an entry
  * in the signature map.
- * Those should be the only entries in the SignatureMap in input.
+ * Those should be the only entries in the signature map in input.
  * They are all TOP_DEF until a parent proves otherwise.
  */
-void load_methods(const DexType* type, SignatureMap& sig_map) {
+void load_methods(const SignatureIds& ids,
+                  const DexType* type,
+                  SigScopes& sig_map) {
   auto const& vmethods = get_vmethods(type);
-  // add each virtual method to the SignatureMap
+  // add each virtual method to the signature map
   for (auto& vmeth : vmethods) {
-    auto& proto_map = sig_map[vmeth->get_name()];
-    auto& scopes = proto_map[vmeth->get_proto()];
-    always_assert(scopes.empty());
     VirtualScope scope;
     scope.type = type;
     scope.methods.emplace_back(vmeth, TOP_DEF);
-    scopes.emplace_back(scope);
+    sig_map.emplace_back(ids.get(vmeth->get_name(), vmeth->get_proto()),
+                         VirtualScopes{std::move(scope)});
   }
+  std::sort(sig_map.begin(), sig_map.end(), by_sig);
+  always_assert(std::adjacent_find(sig_map.begin(), sig_map.end(),
+                                   [](const auto& a, const auto& b) {
+                                     return a.first == b.first;
+                                   }) == sig_map.end());
 }
 
+struct SubtreeScopes {
+  SigScopes sig_map;
+  bool escape{false};
+};
+
+// The scopes of subtrees built ahead of time, by root type.
+using PrecomputedScopes = std::unordered_map<const DexType*, SubtreeScopes>;
+
 /**
  * Compute VirtualScopes and virtual method flags.
  * Starting from java.lang.Object recursively walk the type hierarchy down
@@ -650,19 +743,22 @@ void load_methods(const DexType* type, SignatureMap& sig_map) {
  * in this case, not knowing interface I, we mark all methods in A, B and C
  * ESCAPED but methods in D are not, so in this case they are just FINAL and
  * effectively D.k() would be non virtual as opposed to C.k() which is ESCAPED.
+ *
+ * Children whose subtree is in `precomputed` are not visited again.
  */
-bool build_signature_map(const ClassHierarchy& hierarchy,
-                         const DexType* type,
-                         SignatureMap& sig_map) {
-  always_assert_log(sig_map.empty(),
-                    "intf_methods and children_methods are out params");
+SubtreeScopes build_signature_map(const ClassHierarchy& hierarchy,
+                                  const SignatureIds& ids,
+                                  const DexType* type,
+                                  PrecomputedScopes& precomputed) {
   const TypeSet& children = hierarchy.at(type);
   TRACE(VIRT, 3, "* Visit %s", SHOW(type));
 
-  load_methods(type, sig_map);
+  SubtreeScopes res;
+  auto& sig_map = res.sig_map;
+  load_methods(ids, type, sig_map);
   // will hold all the signature introduced by interfaces in type
   BaseIntfSigs intf_sig_map;
-  bool escape_down = load_interfaces(type, sig_map, intf_sig_map);
+  bool escape_down = load_interfaces(ids, type, sig_map, intf_sig_map);
   BaseSigs base_sigs = load_base_sigs(sig_map);
   TRACE(VIRT, 3, "* Sig map computed for %s", SHOW(type));
 
@@ -670,15 +766,21 @@ bool build_signature_map(const ClassHierarchy& hierarchy,
   // and interface methods under type
   bool escape_up = false;
   for (const auto& child : children) {
-    SignatureMap child_sig_map;
-    escape_up =
-        build_signature_map(hierarchy, child, child_sig_map) || escape_up;
+    SubtreeScopes child_scopes;
+    auto precomputed_it = precomputed.find(child);
+    if (precomputed_it != precomputed.end()) {
+      child_scopes = std::move(precomputed_it->second);
+    } else {
+      child_scopes = build_signature_map(hierarchy, ids, child, precomputed);
+    }
+    escape_up = child_scopes.escape || escape_up;
     TRACE(VIRT,
           3,
           "* Merging sig map of %s with child %s",
           SHOW(type),
           SHOW(child));
-    merge(base_sigs, intf_sig_map, sig_map, child_sig_map);
+    merge(ids, base_sigs, intf_sig_map, sig_map,
+          std::move(child_scopes.sig_map));
   }
 
   TRACE(VIRT, 3, "* Marking methods at %s", SHOW(type));
@@ -689,7 +791,77 @@ bool build_signature_map(const ClassHierarchy& hierarchy,
   }
 
   TRACE(VIRT, 3, "* Visited %s(%d, %d)", SHOW(type), escape_up, escape_down);
-  return escape_up | escape_down;
+  res.escape = escape_up || escape_down;
+  return res;
+}
+
+size_t count_subtree(const ClassHierarchy& hierarchy,
+                     const DexType* type,
+                     std::unordered_map<const DexType*, size_t>& sizes) {
+  size_t size = 1;
+  for (const auto* child : get_children(hierarchy, type)) {
+    size += count_subtree(hierarchy, child, sizes);
+  }
+  sizes[type] = size;
+  return size;
+}
+
+/**
+ * Pick the largest subtrees under type with at most `max_size` types. They
+ * are independent, and only their roots need to be merged into the upper part
+ * of the hierarchy.
+ */
+void gather_subtrees(const ClassHierarchy& hierarchy,
+                     const DexType* type,
+                     const std::unordered_map<const DexType*, size_t>& sizes,
+                     size_t max_size,
+                     std::vector<const DexType*>& roots) {
+  for (const auto* child : get_children(hierarchy, type)) {
+    if (sizes.at(child) <= max_size) {
+      roots.push_back(child);
+    } else {
+      gather_subtrees(hierarchy, child, sizes, max_size, roots);
+    }
+  }
+}
+
+} // namespace
+
+SignatureMap build_signature_map(const ClassHierarchy& class_hierarchy) {
+  // This also creates java.lang.Object if it is missing.
+  SignatureIds ids(class_hierarchy);
+
+  // Build the scopes of many smaller subtrees in parallel, then walk the rest
+  // of the hierarchy from java.lang.Object.
+  std::unordered_map<const DexType*, size_t> sizes;
+  auto total = count_subtree(class_hierarchy, type::java_lang_Object(), sizes);
+  auto max_size =
+      std::max<size_t>(total / (redex_parallel::default_num_threads() * 4), 1);
+  std::vector<const DexType*> roots;
+  gather_subtrees(class_hierarchy, type::java_lang_Object(), sizes, max_size,
+                  roots);
+  PrecomputedScopes precomputed;
+  for (const auto* root : roots) {
+    precomputed[root];
+  }
+  // The workers only write to the entries of their own roots.
+  workqueue_run_for<size_t>(0, roots.size(), [&](size_t i) {
+    precomputed.at(roots[i]) =
+        build_signature_map(class_hierarchy, ids, roots[i], precomputed);
+  });
+  auto scopes = build_signature_map(class_hierarchy, ids,
+                                    type::java_lang_Object(), precomputed);
+
+  // Signature ids are in the order of the map.
+  SignatureMap signature_map;
+  for (auto& [sig, virt_scopes] : scopes.sig_map) {
+    const auto& [name, proto] = ids.get_signature(sig);
+    auto& protos =
+        signature_map.emplace_hint(signature_map.end(), name, ProtoMap())
+            ->second;
+    protos.emplace_hint(protos.end(), proto, std::move(virt_scopes));
+  }
+  return signature_map;
 }
 
 const VirtualScope* find_rooted_scope(const SignatureMap& sig_map,
@@ -775,12 +947,6 @@ void get_root_scopes(const SignatureMap& sig_map,
   get_rooted_interface_scope(sig_map, type, type_class(type), cls_scopes);
 }
 
-SignatureMap build_signature_map(const ClassHierarchy& class_hierarchy) {
-  SignatureMap signature_map;
-  build_signature_map(class_hierarchy, type::java_lang_Object(), signature_map);
-  return signature_map;
-}
-
 const std::vector<DexMethod*>& get_vmethods(const DexType* type) {
   const DexClass* cls = type_class(type);
   if (cls == nullptr) {
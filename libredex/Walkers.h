@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <numeric>
 #include <thread>
 #include <vector>
 
@@ -23,38 +24,6 @@
 #include "VirtualScope.h"
 #include "WorkQueue.h"
 
-/**
- * A wrapper around a type which allocates it aligned to the cache line.
- * This avoids potential cache line bouncing as different cores issue
- * concurrent writes to distinct instances of \p T that would otherwise have
- * occupied the same line.
- */
-template <typename T>
-class CacheAligned {
- public:
-  template <typename... Args>
-  // NOLINTNEXTLINE(google-explicit-constructor,hicpp-explicit-conversions)
-  CacheAligned(Args&&... args) : m_aligned(std::forward<Args>(args)...) {}
-
-  // NOLINTNEXTLINE(google-explicit-constructor,hicpp-explicit-conversions)
-  inline operator T&();
-
- private:
-  alignas(CACHE_LINE_SIZE) T m_aligned;
-};
-
-template <typename T>
-inline CacheAligned<T>::operator T&() {
-  struct Canary {
-    int x;
-    CacheAligned<T> aligned;
-  };
-  static_assert(offsetof(Canary, aligned) % CACHE_LINE_SIZE == 0,
-                "Expecting alignment to cache line size.");
-
-  return m_aligned;
-}
-
 /**
  * A collection of methods useful for iterating over elements of DexClasses.
  *
@@ -393,6 +362,73 @@ class walk {
         });
   }
 
+  // The methods of a scope, cut into contiguous chunks of roughly equal code
+  // size, for the `parallel::*_chunked` walkers.
+  struct MethodChunks {
+    std::vector<DexMethod*> methods;
+    // Chunk i covers methods[bounds[i], bounds[i + 1]).
+    std::vector<size_t> bounds;
+    // Chunk indices, heaviest chunk first.
+    std::vector<size_t> order;
+
+    size_t size() const { return order.size(); }
+  };
+
+  template <class Classes, typename FilterFn>
+  static MethodChunks make_method_chunks(const Classes& classes,
+                                         const FilterFn& filter,
+                                         bool require_code,
+                                         size_t num_threads) {
+    MethodChunks chunks;
+    for (const auto* cls : classes) {
+      iterate_methods(cls, [&](DexMethod* m) {
+        if (filter(m) && (!require_code || m->get_code() != nullptr)) {
+          chunks.methods.push_back(m);
+        }
+      });
+    }
+    auto n = chunks.methods.size();
+    // Every method weighs at least 1, so that methods without code are spread
+    // out as well.
+    std::vector<size_t> weights(n);
+    workqueue_run_for<size_t>(
+        0,
+        n,
+        [&](size_t i) {
+          const auto* code = chunks.methods[i]->get_code();
+          weights[i] = 1 + (code == nullptr ? 0 : code->sum_opcode_sizes());
+        },
+        num_threads);
+    size_t total = 0;
+    for (auto w : weights) {
+      total += w;
+    }
+    // Aim for several chunks per thread, so that work stealing can even out
+    // the remaining imbalance. A method heavier than the target gets a chunk
+    // of its own.
+    constexpr size_t kChunksPerThread = 8;
+    auto target = std::max<size_t>(
+        1, total / std::max<size_t>(1, num_threads * kChunksPerThread));
+    std::vector<size_t> chunk_weights;
+    chunks.bounds.push_back(0);
+    size_t weight = 0;
+    for (size_t i = 0; i < n; ++i) {
+      weight += weights[i];
+      if (weight >= target || i + 1 == n) {
+        chunks.bounds.push_back(i + 1);
+        chunk_weights.push_back(weight);
+        weight = 0;
+      }
+    }
+    chunks.order.resize(chunk_weights.size());
+    std::iota(chunks.order.begin(), chunks.order.end(), 0);
+    std::stable_sort(chunks.order.begin(), chunks.order.end(),
+                     [&](size_t a, size_t b) {
+                       return chunk_weights[a] > chunk_weights[b];
+                     });
+    return chunks;
+  }
+
   template <class T>
   struct plus_assign {
     void operator()(const T& addend, T* accumulator) const {
@@ -438,20 +474,14 @@ class walk {
         const WalkerFn& walker,
         size_t num_threads = redex_parallel::default_num_threads(),
         Accumulator init = Accumulator()) {
-      std::vector<CacheAligned<Accumulator>> acc_vec(num_threads, init);
       auto reduce = Reduce();
-      workqueue_run<DexClass*>( // over-parallelized maybe
-          [&walker, &acc_vec, &reduce](sparta::WorkerState<DexClass*>* state,
-                                       DexClass* cls) {
-            Accumulator& acc = acc_vec[state->worker_id()];
-            reduce(walker(cls), &acc);
+      return parallel_reduce<Accumulator, Reduce>(
+          [&walker, &reduce](DexClass* cls, Accumulator* acc) {
+            reduce(walker(cls), acc);
           },
           classes,
-          num_threads);
-      for (Accumulator& acc : acc_vec) {
-        reduce(acc, &init);
-      }
-      return init;
+          num_threads,
+          std::move(init));
     }
 
     // Call `walker` on all methods in `classes` in parallel.
@@ -470,8 +500,9 @@ class walk {
     // Call `walker` on all methods in `classes` in parallel. Then combine the
     // Accumulator objects with Sum.
     //
-    // Each thread has its own Accumulator object that the walker can modify
-    // without taking a lock.
+    // Each chunk of classes has its own Accumulator object that the walker can
+    // modify without taking a lock; they are combined in class order (see
+    // parallel_reduce).
     //
     // WalkerFn should accept `(DexMethod*, Accumulator&)`.
     template <
@@ -485,28 +516,20 @@ class walk {
         const WalkerFn& walker,
         size_t num_threads = redex_parallel::default_num_threads(),
         Accumulator init = Accumulator()) {
-      std::vector<CacheAligned<Accumulator>> acc_vec(num_threads, init);
-
-      workqueue_run<DexClass*>(
-          [&](sparta::WorkerState<DexClass*>* state, DexClass* cls) {
-            Accumulator& acc = acc_vec[state->worker_id()];
+      return parallel_reduce<Accumulator, Reduce>(
+          [&](DexClass* cls, Accumulator* acc) {
             for (auto dmethod : cls->get_dmethods()) {
               TraceContext context(dmethod);
-              walker(dmethod, &acc);
+              walker(dmethod, acc);
             }
             for (auto vmethod : cls->get_vmethods()) {
               TraceContext context(vmethod);
-              walker(vmethod, &acc);
+              walker(vmethod, acc);
             }
           },
           classes,
-          num_threads);
-
-      auto reduce = Reduce();
-      for (Accumulator& acc : acc_vec) {
-        reduce(acc, &init);
-      }
-      return init;
+          num_threads,
+          std::move(init));
     }
 
     // Call `walker` on all methods in `classes` in parallel. Then combine the
@@ -537,6 +560,69 @@ class walk {
           init);
     }
 
+    // Call `walker` on all methods in `classes` in parallel, like `methods()`,
+    // but the unit of parallelization is a chunk of methods of roughly equal
+    // code size rather than a class, so that a class with thousands of methods
+    // does not become a straggler.
+    //
+    // Unlike with `methods()`, methods of the same class may be visited
+    // concurrently, so `walker` must not modify unsynchronized per-class state.
+    //   WalkerFn should accept a `DexMethod*`.
+    template <class Classes, typename WalkerFn>
+    static void methods_chunked(
+        const Classes& classes,
+        const WalkerFn& walker,
+        size_t num_threads = redex_parallel::default_num_threads()) {
+      auto chunks = make_method_chunks(classes, all_methods,
+                                       /* require_code */ false, num_threads);
+      workqueue_run<size_t>(
+          [&](size_t c) {
+            for (auto i = chunks.bounds[c]; i < chunks.bounds[c + 1]; ++i) {
+              auto* method = chunks.methods[i];
+              TraceContext context(method);
+              walker(method);
+            }
+          },
+          chunks.order,
+          num_threads);
+    }
+
+    // Same as `methods_chunked()`, but the walker returns an Accumulator for
+    // each method. Each chunk accumulates into its own object, and the chunks
+    // are then combined in class order, so the result does not depend on
+    // scheduling, even if Reduce is not commutative.
+    //
+    // WalkerFn should accept a `DexMethod*` and return `Accumulator`.
+    template <class Accumulator,
+              class Reduce = plus_assign<Accumulator>,
+              class Classes,
+              typename WalkerFn>
+    static Accumulator methods_chunked(
+        const Classes& classes,
+        const WalkerFn& walker,
+        size_t num_threads = redex_parallel::default_num_threads(),
+        Accumulator init = Accumulator()) {
+      auto chunks = make_method_chunks(classes, all_methods,
+                                       /* require_code */ false, num_threads);
+      std::vector<CacheAligned<Accumulator>> acc_vec(chunks.size());
+      auto reduce = Reduce();
+      workqueue_run<size_t>(
+          [&](size_t c) {
+            Accumulator& acc = acc_vec[c];
+            for (auto i = chunks.bounds[c]; i < chunks.bounds[c + 1]; ++i) {
+              auto* method = chunks.methods[i];
+              TraceContext context(method);
+              reduce(walker(method), &acc);
+            }
+          },
+          chunks.order,
+          num_threads);
+      for (Accumulator& acc : acc_vec) {
+        reduce(acc, &init);
+      }
+      return init;
+    }
+
     //
     // Call `walker` on all fields in `classes` in parallel.
     //   WalkerFn should accept a `DexField*`.
@@ -560,21 +646,15 @@ class walk {
         const WalkerFn& walker,
         size_t num_threads = redex_parallel::default_num_threads(),
         Accumulator init = Accumulator()) {
-      std::vector<CacheAligned<Accumulator>> acc_vec(num_threads, init);
       auto reduce = Reduce();
-      workqueue_run<DexClass*>(
-          [&walker, &acc_vec, &reduce](sparta::WorkerState<DexClass*>* state,
-                                       DexClass* cls) {
-            Accumulator& acc = acc_vec[state->worker_id()];
+      return parallel_reduce<Accumulator, Reduce>(
+          [&walker, &reduce](DexClass* cls, Accumulator* acc) {
             walk::iterate_fields(cls,
-                                 [&](auto arg) { reduce(walker(arg), &acc); });
+                                 [&](auto arg) { reduce(walker(arg), acc); });
           },
           classes,
-          num_threads);
-      for (Accumulator& acc : acc_vec) {
-        reduce(acc, &init);
-      }
-      return init;
+          num_threads,
+          std::move(init));
     }
 
     // Call `walker` on all code (of methods approved by `filter`) in `classes`
@@ -604,6 +684,40 @@ class walk {
       walk::parallel::code(classes, all_methods, walker, num_threads);
     }
 
+    // Call `walker` on all code (of methods approved by `filter`) in `classes`
+    // in parallel, chunked like `methods_chunked()`.
+    //   FilterFn should accept a `DexMethod*` and return a bool.
+    //   WalkerFn should accept `(DexMethod*, IRCode&)`.
+    template <class Classes, typename FilterFn, typename WalkerFn>
+    static void code_chunked(
+        const Classes& classes,
+        const FilterFn& filter,
+        const WalkerFn& walker,
+        size_t num_threads = redex_parallel::default_num_threads()) {
+      auto chunks = make_method_chunks(classes, filter,
+                                       /* require_code */ true, num_threads);
+      workqueue_run<size_t>(
+          [&](size_t c) {
+            for (auto i = chunks.bounds[c]; i < chunks.bounds[c + 1]; ++i) {
+              auto* method = chunks.methods[i];
+              TraceContext context(method);
+              walker(method, *method->get_code());
+            }
+          },
+          chunks.order,
+          num_threads);
+    }
+
+    // Same as `code_chunked()` but with a filter function that accepts all
+    // methods
+    template <class Classes, typename WalkerFn>
+    static void code_chunked(
+        const Classes& classes,
+        const WalkerFn& walker,
+        size_t num_threads = redex_parallel::default_num_threads()) {
+      walk::parallel::code_chunked(classes, all_methods, walker, num_threads);
+    }
+
     // Call `walker` on all opcodes (of methods approved by `filter`) in
     // `classes` in parallel.
     //   FilterFn should accept a `DexMethod*` and return a bool.
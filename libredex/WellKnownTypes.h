@@ -78,3 +78,15 @@
   FOR_EACH(java_lang_Class_forName,                                           \
            "Ljava/lang/Class;.forName:(Ljava/lang/String;)Ljava/"             \
            "lang/Class;")
+
+// Boxed types with their primitive descriptor and the name of their unboxing
+// method. (boxed_name, primitive_name, unboxing_name)
+#define BOXED_TYPES                    \
+  FOR_EACH(Boolean, "Z", booleanValue) \
+  FOR_EACH(Byte, "B", byteValue)       \
+  FOR_EACH(Short, "S", shortValue)     \
+  FOR_EACH(Character, "C", charValue)  \
+  FOR_EACH(Integer, "I", intValue)     \
+  FOR_EACH(Long, "J", longValue)       \
+  FOR_EACH(Float, "F", floatValue)     \
+  FOR_EACH(Double, "D", doubleValue)
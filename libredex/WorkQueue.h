@@ -7,22 +7,71 @@
 
 #pragma once
 
+#include <algorithm>
 #include <boost/thread/thread.hpp>
+#include <cstddef>
 #include <exception>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <sparta/WorkQueue.h>
 
+#include "Thread.h"
 #include "ThreadPool.h"
+#include "Timer.h"
+
+/**
+ * A wrapper around a type which allocates it aligned to the cache line.
+ * This avoids potential cache line bouncing as different cores issue
+ * concurrent writes to distinct instances of \p T that would otherwise have
+ * occupied the same line.
+ */
+template <typename T>
+class CacheAligned {
+ public:
+  template <typename... Args>
+  // NOLINTNEXTLINE(google-explicit-constructor,hicpp-explicit-conversions)
+  CacheAligned(Args&&... args) : m_aligned(std::forward<Args>(args)...) {}
+
+  // NOLINTNEXTLINE(google-explicit-constructor,hicpp-explicit-conversions)
+  inline operator T&();
+
+ private:
+  alignas(CACHE_LINE_SIZE) T m_aligned;
+};
+
+template <typename T>
+inline CacheAligned<T>::operator T&() {
+  struct Canary {
+    int x;
+    CacheAligned<T> aligned;
+  };
+  static_assert(offsetof(Canary, aligned) % CACHE_LINE_SIZE == 0,
+                "Expecting alignment to cache line size.");
+
+  return m_aligned;
+}
 
 namespace redex_workqueue_impl {
 
 void redex_queue_exception_handler(std::exception& e);
 
+template <class T>
+struct plus_assign {
+  void operator()(const T& addend, T* accumulator) const {
+    *accumulator += addend;
+  }
+};
+
 // Helper classes so the type of Executor can be inferred
 template <typename Input, typename Fn>
 struct NoStateWorkQueueHelper {
   Fn fn;
+  size_t timeline_batch_id{Timeline::new_batch_id()};
   void operator()(sparta::WorkerState<Input>*, Input a) {
+    Timeline::BatchItem timeline_item(timeline_batch_id);
     try {
       fn(std::move(a));
     } catch (std::exception& e) {
@@ -35,7 +84,9 @@ struct NoStateWorkQueueHelper {
 template <typename Input, typename Fn>
 struct WithStateWorkQueueHelper {
   Fn fn;
+  size_t timeline_batch_id{Timeline::new_batch_id()};
   void operator()(sparta::WorkerState<Input>* state, Input a) {
+    Timeline::BatchItem timeline_item(timeline_batch_id);
     try {
       fn(state, std::move(a));
     } catch (std::exception& e) {
@@ -178,3 +229,82 @@ void workqueue_run_for(
   }
   wq.run_all();
 }
+
+/**
+ * Like workqueue_run, but schedules the items in order of decreasing cost, as
+ * estimated by `cost_fn(const Input&) -> size_t`.
+ *
+ * The underlying sparta::WorkQueue already steals work from random other
+ * workers once a worker's own queue is drained, but it processes every queue
+ * front to back. With heavily skewed costs this means that a few huge items
+ * which happen to be at the end of some queue get started last, and keep a
+ * couple of threads busy long after everyone else finished. Dealing the items
+ * out largest-first bounds that tail by the cost of the largest item.
+ */
+template <class Input, typename Fn, typename Items, typename CostFn>
+void workqueue_run_by_cost(
+    const Fn& fn,
+    const Items& items,
+    const CostFn& cost_fn,
+    unsigned int num_threads = redex_parallel::default_num_threads(),
+    bool push_tasks_while_running = false) {
+  std::vector<std::pair<size_t, Input>> ordered;
+  for (Input item : items) {
+    auto cost = cost_fn(static_cast<const Input&>(item));
+    ordered.emplace_back(cost, std::move(item));
+  }
+  // Stable, to keep the order of equally expensive items deterministic.
+  std::stable_sort(
+      ordered.begin(), ordered.end(),
+      [](const auto& a, const auto& b) { return a.first > b.first; });
+  auto wq = workqueue_foreach<Input>(fn, num_threads, push_tasks_while_running);
+  for (auto& p : ordered) {
+    wq.add_item(std::move(p.second));
+  }
+  wq.run_all();
+}
+
+/**
+ * Calls `fn(Input, Accumulator*)` on all items in parallel, and returns the
+ * combination of everything it accumulated.
+ *
+ * The items are cut into contiguous chunks, several per thread. Each chunk is
+ * processed by a single task into its own cache-line aligned Accumulator, so
+ * threads never write to a shared counter or take a lock. The chunks are then
+ * combined with `Reduce()(const Accumulator&, Accumulator*)` in item order, so
+ * the result does not depend on scheduling, even if Reduce is not commutative
+ * (e.g. when it appends to a vector).
+ */
+template <class Accumulator,
+          class Reduce = redex_workqueue_impl::plus_assign<Accumulator>,
+          typename Fn,
+          typename Items>
+Accumulator parallel_reduce(
+    const Fn& fn,
+    const Items& items,
+    unsigned int num_threads = redex_parallel::default_num_threads(),
+    Accumulator init = Accumulator()) {
+  using Input = std::decay_t<decltype(*std::begin(items))>;
+  std::vector<Input> inputs(std::begin(items), std::end(items));
+  constexpr size_t kChunksPerThread = 8;
+  auto num_chunks = std::min<size_t>(
+      inputs.size(), std::max(1u, num_threads) * kChunksPerThread);
+  std::vector<CacheAligned<Accumulator>> acc_vec(num_chunks);
+  workqueue_run_for<size_t>(
+      0,
+      num_chunks,
+      [&](size_t c) {
+        Accumulator& acc = acc_vec[c];
+        auto begin = inputs.size() * c / num_chunks;
+        auto end = inputs.size() * (c + 1) / num_chunks;
+        for (auto i = begin; i < end; ++i) {
+          fn(inputs[i], &acc);
+        }
+      },
+      num_threads);
+  auto reduce = Reduce();
+  for (Accumulator& acc : acc_vec) {
+    reduce(acc, &init);
+  }
+  return init;
+}
@@ -18,6 +18,7 @@
 
 #include "android-base/macros.h"
 #include <limits.h>
+#include <string.h>
 #include "utils/Unicode.h"
 
 #include "utils/Log.h"
@@ -36,6 +37,10 @@
 # include <netinet/in.h>
 #endif
 
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
 extern "C" {
 
 static const char32_t kByteMask = 0x000000BF;
@@ -66,6 +71,70 @@ static const char32_t kFirstByteMark[] = {
     0x00000000, 0x00000000, 0x000000C0, 0x000000E0, 0x000000F0
 };
 
+// --------------------------------------------------------------------------
+// ASCII runs
+// --------------------------------------------------------------------------
+
+// Resource string pools are overwhelmingly ASCII. The transcoding routines
+// below use these helpers to find the length of the leading ASCII run, which
+// can be copied (or counted) without per-character decoding. SSE2 is used
+// when available, with an 8-byte word-at-a-time scan as the fallback.
+
+static inline size_t utf8_ascii_prefix_length(const uint8_t* src, size_t len)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        int high_bits = _mm_movemask_epi8(v);
+        if (high_bits != 0) {
+            return i + __builtin_ctz(high_bits);
+        }
+    }
+#endif
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, src + i, sizeof(word));
+        if ((word & 0x8080808080808080ULL) != 0) {
+            break;
+        }
+    }
+    while (i < len && src[i] < 0x80) {
+        i++;
+    }
+    return i;
+}
+
+static inline size_t utf16_ascii_prefix_length(const char16_t* src, size_t len)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i non_ascii_mask = _mm_set1_epi16((short)0xFF80);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= len; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i is_ascii =
+            _mm_cmpeq_epi16(_mm_and_si128(v, non_ascii_mask), zero);
+        int ascii_bits = _mm_movemask_epi8(is_ascii);
+        if (ascii_bits != 0xFFFF) {
+            // Two mask bits per char16_t.
+            return i + __builtin_ctz(~ascii_bits) / 2;
+        }
+    }
+#endif
+    for (; i + 4 <= len; i += 4) {
+        uint64_t word;
+        memcpy(&word, src + i, sizeof(word));
+        if ((word & 0xFF80FF80FF80FF80ULL) != 0) {
+            break;
+        }
+    }
+    while (i < len && src[i] < 0x80) {
+        i++;
+    }
+    return i;
+}
+
 // --------------------------------------------------------------------------
 // UTF-32
 // --------------------------------------------------------------------------
@@ -335,6 +404,17 @@ void utf16_to_utf8(const char16_t* src, size_t src_len, char* dst, size_t dst_le
     const char16_t* const end_utf16 = src + src_len;
     char *cur = dst;
     while (cur_utf16 < end_utf16) {
+        if (*cur_utf16 < 0x80) {
+            const size_t run = utf16_ascii_prefix_length(cur_utf16, end_utf16 - cur_utf16);
+            LOG_ALWAYS_FATAL_IF(dst_len < run, "%zu < %zu", dst_len, run);
+            for (size_t i = 0; i < run; i++) {
+                cur[i] = (char) cur_utf16[i];
+            }
+            cur_utf16 += run;
+            cur += run;
+            dst_len -= run;
+            continue;
+        }
         char32_t utf32;
         // surrogate pairs
         if((*cur_utf16 & 0xFC00) == 0xD800 && (cur_utf16 + 1) < end_utf16
@@ -412,7 +492,10 @@ ssize_t utf16_to_utf8_length(const char16_t *src, size_t src_len)
     const char16_t* const end = src + src_len;
     while (src < end) {
         size_t char_len;
-        if ((*src & 0xFC00) == 0xD800 && (src + 1) < end
+        if (*src < 0x80) {
+            char_len = utf16_ascii_prefix_length(src, end - src);
+            src += char_len;
+        } else if ((*src & 0xFC00) == 0xD800 && (src + 1) < end
                 && (*(src + 1) & 0xFC00) == 0xDC00) {
             // surrogate pairs are always 4 bytes.
             char_len = 4;
@@ -490,6 +573,12 @@ ssize_t utf8_to_utf16_length(const uint8_t* u8str, size_t u8len, bool overreadIs
     /* Validate that the UTF-8 is the correct len */
     size_t u16measuredLen = 0;
     while (u8cur < u8end) {
+        if (*u8cur < 0x80) {
+            const size_t run = utf8_ascii_prefix_length(u8cur, u8end - u8cur);
+            u16measuredLen += run;
+            u8cur += run;
+            continue;
+        }
         u16measuredLen++;
         int u8charLen = utf8_codepoint_len(*u8cur);
         // Malformed utf8, some characters are beyond the end.
@@ -543,6 +632,18 @@ char16_t* utf8_to_utf16_no_null_terminator(
     char16_t* u16cur = dst;
 
     while (u8cur < u8end && u16cur < u16end) {
+        if (*u8cur < 0x80) {
+            size_t run = utf8_ascii_prefix_length(u8cur, u8end - u8cur);
+            if (run > (size_t)(u16end - u16cur)) {
+                run = u16end - u16cur;
+            }
+            for (size_t i = 0; i < run; i++) {
+                u16cur[i] = (char16_t) u8cur[i];
+            }
+            u8cur += run;
+            u16cur += run;
+            continue;
+        }
         size_t u8len = utf8_codepoint_len(*u8cur);
         uint32_t codepoint = utf8_to_utf32_codepoint(u8cur, u8len);
 
@@ -11,9 +11,11 @@
 
 #include "ClassHierarchy.h"
 #include "DexUtil.h"
+#include "FieldAccessAnalysisPass.h"
 #include "FieldOpTracker.h"
 #include "IRCode.h"
 #include "MethodOverrideGraph.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Mutators.h"
 #include "PassManager.h"
 #include "ReachableClasses.h"
@@ -62,12 +64,9 @@ size_t mark_methods_final(const Scope& scope,
   return n_methods_finalized;
 }
 
-size_t mark_fields_final(const Scope& scope,
+size_t mark_fields_final(const field_op_tracker::FieldStatsMap& field_stats,
                          bool consider_unwritten_fields,
                          bool consider_written_fields) {
-  field_op_tracker::FieldStatsMap field_stats =
-      field_op_tracker::analyze(scope);
-
   size_t n_fields_finalized = 0;
   for (auto& pair : field_stats) {
     auto* field = pair.first;
@@ -189,7 +188,8 @@ void AccessMarkingPass::run_pass(DexStoresVector& stores,
                                  ConfigFiles& /* conf */,
                                  PassManager& pm) {
   auto scope = build_class_scope(stores);
-  auto override_graph = mog::build_graph(scope);
+  auto override_graph =
+      MethodOverrideGraphAnalysisPass::get_or_build(pm, scope);
   if (m_finalize_classes) {
     auto n_classes_final = mark_classes_final(scope);
     pm.incr_metric("finalized_classes", n_classes_final);
@@ -201,8 +201,10 @@ void AccessMarkingPass::run_pass(DexStoresVector& stores,
     TRACE(ACCESS, 1, "Finalized %zu methods", n_methods_final);
   }
   if (m_finalize_unwritten_fields || m_finalize_written_fields) {
-    auto n_fields_final = mark_fields_final(
-        scope, m_finalize_unwritten_fields, m_finalize_written_fields);
+    auto field_accesses = FieldAccessAnalysisPass::get_or_build(pm, scope);
+    auto n_fields_final = mark_fields_final(field_accesses->get_field_stats(),
+                                            m_finalize_unwritten_fields,
+                                            m_finalize_written_fields);
     pm.incr_metric("finalized_fields", n_fields_final);
     TRACE(ACCESS, 1, "Finalized %zu fields", n_fields_final);
   }
@@ -210,6 +212,11 @@ void AccessMarkingPass::run_pass(DexStoresVector& stores,
     auto privates = find_private_methods(scope, *override_graph);
     fix_call_sites_private(scope, privates);
     mark_methods_private(privates);
+    // Privatized methods were not true virtuals, so this is usually a no-op;
+    // it keeps a preserved graph exact regardless.
+    for (auto* method : privates) {
+      override_graph->remove_method(method);
+    }
     pm.incr_metric("privatized_methods", privates.size());
     TRACE(ACCESS, 1, "Privatized %zu methods", privates.size());
   }
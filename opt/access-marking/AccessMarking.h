@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include "FieldAccessAnalysisPass.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Pass.h"
 
 class AccessMarkingPass : public Pass {
@@ -43,6 +45,11 @@ class AccessMarkingPass : public Pass {
          "Mark every eligible method as private.");
   }
 
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<FieldAccessAnalysisPass>();
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
  private:
@@ -23,6 +23,8 @@
 #include "DexUtil.h"
 #include "IRInstruction.h"
 #include "PassManager.h"
+#include "RedexContext.h"
+#include "ReflectionAnalysisCache.h"
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
@@ -215,16 +217,11 @@ AppModuleUsagePass::analyze_method_xstore_references(const Scope& scope) {
   };
 
   app_module_usage::MethodStoresReferenced method_store_refs;
-  reflection::MetadataCache refl_metadata_cache;
+  auto& reflection_analyses = g_redex->reflection_analyses();
 
   walk::parallel::code(scope, [&](DexMethod* method, IRCode& code) {
     const auto* method_store = m_type_store_map.at(method->get_class());
-    std::unique_ptr<reflection::ReflectionAnalysis> analysis =
-        std::make_unique<reflection::ReflectionAnalysis>(
-            /* dex_method */ method,
-            /* context (interprocedural only) */ nullptr,
-            /* summary_query_fn (interprocedural only) */ nullptr,
-            /* metadata_cache */ &refl_metadata_cache);
+    auto analysis = reflection_analyses.get(method);
 
     auto get_reflective_type_ref_for_insn =
         [&analysis](IRInstruction* insn) -> DexType* {
@@ -16,7 +16,9 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/regex.hpp>
 #include <fstream>
+#include <sstream>
 #include <string>
+#include <string_view>
 
 #include "BaselineProfile.h"
 #include "ConcurrentContainers.h"
@@ -30,6 +32,7 @@
 #include "Show.h"
 #include "SourceBlocks.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 const std::string BASELINE_PROFILES_FILE = "additional-baseline-profiles.list";
@@ -408,6 +411,62 @@ void never_compile(
                   methods_annotation_attached.load());
 }
 
+// Writes the given entries to the profile file. In incremental mode, an
+// existing file is only rewritten when its entries changed, which keeps it
+// up-to-date for the build steps that consume it.
+void write_baseline_profile(const std::string& path,
+                            const std::vector<std::string>& class_entries,
+                            bool incremental,
+                            PassManager& mgr) {
+  std::string content;
+  size_t size = 0;
+  for (const auto& entries : class_entries) {
+    size += entries.size();
+  }
+  content.reserve(size);
+  for (const auto& entries : class_entries) {
+    content += entries;
+  }
+
+  if (incremental) {
+    std::ifstream ifs{path, std::ios::binary};
+    if (ifs) {
+      std::string previous{std::istreambuf_iterator<char>(ifs),
+                           std::istreambuf_iterator<char>()};
+      auto split_lines = [](const std::string& str) {
+        std::unordered_set<std::string_view> lines;
+        std::string_view view{str};
+        while (!view.empty()) {
+          auto pos = view.find('\n');
+          lines.insert(view.substr(0, pos));
+          view.remove_prefix(pos == std::string_view::npos ? view.size()
+                                                            : pos + 1);
+        }
+        return lines;
+      };
+      auto previous_lines = split_lines(previous);
+      auto lines = split_lines(content);
+      size_t added = 0;
+      for (auto line : lines) {
+        added += !previous_lines.count(line);
+      }
+      size_t removed = 0;
+      for (auto line : previous_lines) {
+        removed += !lines.count(line);
+      }
+      mgr.incr_metric("baseline_profile_entries_added", added);
+      mgr.incr_metric("baseline_profile_entries_removed", removed);
+      if (previous == content) {
+        mgr.incr_metric("baseline_profile_unchanged", 1);
+        return;
+      }
+    }
+  }
+
+  std::ofstream ofs{path, std::ios::binary};
+  ofs << content;
+}
+
 } // namespace
 
 std::ostream& operator<<(std::ostream& os,
@@ -441,6 +500,9 @@ void ArtProfileWriterPass::bind_config() {
   bind("never_inline_attach_annotations", false,
        m_never_inline_attach_annotations);
   bind("legacy_mode", true, m_legacy_mode);
+  bind("incremental_output", false, m_incremental_output,
+       "Only rewrite an existing baseline profile file when its entries "
+       "changed");
   bind("never_compile_callcount_threshold", -1,
        m_never_compile_callcount_threshold);
   bind("never_compile_perf_threshold", -1, m_never_compile_perf_threshold);
@@ -570,8 +632,12 @@ void ArtProfileWriterPass::run_pass(DexStoresVector& stores,
     baseline_profile.classes.insert(store_fence_helper_cls);
   }
 
-  std::ofstream ofs{conf.metafile(BASELINE_PROFILES_FILE)};
-  walk::classes(scope, [&](DexClass* cls) {
+  // The entries of each class are rendered in parallel, and then written in
+  // scope order.
+  std::vector<std::string> class_entries(scope.size());
+  workqueue_run_for<size_t>(0, scope.size(), [&](size_t i) {
+    auto* cls = scope[i];
+    std::ostringstream oss;
     for (auto* method : cls->get_all_methods()) {
       auto it = baseline_profile.methods.find(method);
       if (it == baseline_profile.methods.end()) {
@@ -582,12 +648,15 @@ void ArtProfileWriterPass::run_pass(DexStoresVector& stores,
       // in post-process can recognize the method
       boost::replace_all(descriptor, ".", "->");
       boost::replace_all(descriptor, ":(", "(");
-      ofs << it->second << descriptor << std::endl;
+      oss << it->second << descriptor << "\n";
     }
     if (baseline_profile.classes.count(cls)) {
-      ofs << show_deobfuscated(cls) << std::endl;
+      oss << show_deobfuscated(cls) << "\n";
     }
+    class_entries[i] = oss.str();
   });
+  write_baseline_profile(conf.metafile(BASELINE_PROFILES_FILE), class_entries,
+                         m_incremental_output, mgr);
 
   std::atomic<size_t> methods_with_baseline_profile_code_units{0};
   std::atomic<size_t> compiled{0};
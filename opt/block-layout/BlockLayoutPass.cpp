@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * Profile-guided block layout. By default, the CFG is linearized structurally,
+ * in a weak topological order of its blocks. This pass switches all later
+ * linearizations, including the final one before output, to an order driven
+ * by the source block profile (see ControlFlowGraph::profile_guided_chains):
+ * hot gotos become fallthroughs, and blocks that never executed move to the
+ * end of the method, which gives the AOT compiler better code locality.
+ *
+ * A conditional branch always jumps to its taken target, so only its
+ * fallthrough successor can follow it. The pass therefore also inverts
+ * branches whose taken target is hotter than the fallthrough.
+ *
+ * The layout is recomputed from the source blocks whenever the CFG is
+ * linearized, so later passes may still change the code freely.
+ */
+
+#include "BlockLayoutPass.h"
+
+#include "ControlFlow.h"
+#include "DexClass.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "PassManager.h"
+#include "SourceBlocks.h"
+#include "Walkers.h"
+
+namespace {
+
+constexpr const char* METRIC_PROFILED_METHODS = "num_profiled_methods";
+constexpr const char* METRIC_INVERTED_BRANCHES = "num_inverted_branches";
+constexpr const char* METRIC_COLD_BLOCKS = "num_cold_blocks";
+
+boost::optional<float> get_weight(cfg::Block* block) {
+  return source_blocks::get_max_val(
+      source_blocks::get_first_source_block(block));
+}
+
+} // namespace
+
+BlockLayoutPass::Stats& BlockLayoutPass::Stats::operator+=(
+    const Stats& that) {
+  profiled_methods += that.profiled_methods;
+  inverted_branches += that.inverted_branches;
+  cold_blocks += that.cold_blocks;
+  return *this;
+}
+
+BlockLayoutPass::Stats BlockLayoutPass::invert_hot_branches(
+    cfg::ControlFlowGraph& cfg) {
+  Stats stats;
+  for (auto* block : cfg.blocks()) {
+    auto weight = get_weight(block);
+    if (!weight) {
+      continue;
+    }
+    stats.profiled_methods = 1;
+    stats.cold_blocks += *weight == 0;
+
+    auto last = block->get_last_insn();
+    if (last == block->end() ||
+        !opcode::is_a_conditional_branch(last->insn->opcode())) {
+      continue;
+    }
+    auto* goto_edge = cfg.get_succ_edge_of_type(block, cfg::EDGE_GOTO);
+    auto* branch_edge = cfg.get_succ_edge_of_type(block, cfg::EDGE_BRANCH);
+    auto* fallthrough = goto_edge->target();
+    auto* taken = branch_edge->target();
+    if (fallthrough == taken) {
+      continue;
+    }
+    auto fallthrough_weight = get_weight(fallthrough);
+    auto taken_weight = get_weight(taken);
+    if (!fallthrough_weight || !taken_weight ||
+        *taken_weight <= *fallthrough_weight) {
+      continue;
+    }
+    auto* insn = last->insn;
+    insn->set_opcode(opcode::invert_conditional_branch(insn->opcode()));
+    cfg.set_edge_target(goto_edge, taken);
+    cfg.set_edge_target(branch_edge, fallthrough);
+    stats.inverted_branches++;
+  }
+  return stats;
+}
+
+void BlockLayoutPass::run_pass(DexStoresVector& stores,
+                               ConfigFiles& /* unused */,
+                               PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  auto stats = walk::parallel::methods<Stats>(scope, [](DexMethod* method) {
+    auto* code = method->get_code();
+    if (code == nullptr || method->rstate.no_optimizations()) {
+      return Stats{};
+    }
+    always_assert(code->editable_cfg_built());
+    return invert_hot_branches(code->cfg());
+  });
+
+  cfg::ControlFlowGraph::set_profile_guided_layout(true);
+
+  mgr.incr_metric(METRIC_PROFILED_METHODS, stats.profiled_methods);
+  mgr.incr_metric(METRIC_INVERTED_BRANCHES, stats.inverted_branches);
+  mgr.incr_metric(METRIC_COLD_BLOCKS, stats.cold_blocks);
+}
+
+static BlockLayoutPass s_pass;
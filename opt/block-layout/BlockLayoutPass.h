@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "Pass.h"
+
+namespace cfg {
+class ControlFlowGraph;
+} // namespace cfg
+
+class BlockLayoutPass : public Pass {
+ public:
+  struct Stats {
+    size_t profiled_methods{0};
+    size_t inverted_branches{0};
+    size_t cold_blocks{0};
+
+    Stats& operator+=(const Stats&);
+  };
+
+  BlockLayoutPass() : Pass("BlockLayoutPass") {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {
+        {DexLimitsObeyed, Preserves},
+        {HasSourceBlocks, Preserves},
+        {NoInitClassInstructions, Preserves},
+        {NoResolvablePureRefs, Preserves},
+        {NoUnreachableInstructions, Preserves},
+        {RenameClass, Preserves},
+    };
+  }
+
+  void bind_config() override { trait(Traits::Pass::unique, true); }
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  // Inverts conditional branches whose taken target is hotter than the
+  // fallthrough target, so that the hot successor can be laid out next.
+  static Stats invert_hot_branches(cfg::ControlFlowGraph& cfg);
+};
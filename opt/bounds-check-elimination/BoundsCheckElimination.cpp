@@ -0,0 +1,405 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * This pass removes explicit index and null checks of arrays that are
+ * iterated over by counted loops.
+ *
+ * For example:
+ *
+ *       CONST v1, 0
+ *   L0: ARRAY_LENGTH v2, v0
+ *       IF_GE v1, v2, L2
+ *       IF_LTZ v1, L1
+ *       IF_EQZ v0, L1
+ *       AGET v3, v0, v1
+ *       ...
+ *       ADD_INT_LIT v1, v1, 1
+ *       GOTO L0
+ *   L1: ... (throw an exception)
+ *   L2: ...
+ *
+ * In the loop body, up to the increment of the index, we know that
+ * 0 <= v1 < length(v0), and that v0 is not null, so the IF_LTZ and IF_EQZ
+ * branches are never taken.
+ *
+ * We recognize a counted loop when:
+ * - its header ends with a comparison of the index against a bound that
+ *   exits the loop when the index reaches the bound;
+ * - the bound is the length of an array that is not written in the loop,
+ *   computed either in the header or in the loop's natural preheader;
+ * - the index starts out as a non-negative constant in the natural
+ *   preheader, and is only written in the loop by one increment by one.
+ *
+ * Dex code has no unchecked array accesses, and ART's compiler already
+ * removes the implicit checks of such accesses itself; what it cannot do is
+ * remove the explicit checks of the bytecode, which are what we handle here.
+ */
+
+#include "BoundsCheckElimination.h"
+
+#include <utility>
+
+#include "ControlFlow.h"
+#include "DexClass.h"
+#include "DexUtil.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "IROpcode.h"
+#include "LoopInfo.h"
+#include "PassManager.h"
+#include "Show.h"
+#include "Trace.h"
+#include "Walkers.h"
+
+namespace {
+
+constexpr const char* METRIC_COUNTED_LOOPS = "num_counted_loops";
+constexpr const char* METRIC_BOUNDS_CHECKS_ELIMINATED =
+    "num_bounds_checks_eliminated";
+constexpr const char* METRIC_NULL_CHECKS_ELIMINATED =
+    "num_null_checks_eliminated";
+
+bool writes_reg(const IRInstruction* insn, reg_t reg) {
+  if (!insn->has_dest()) {
+    return false;
+  }
+  auto dest = insn->dest();
+  return dest == reg || (insn->dest_is_wide() && dest + 1 == reg);
+}
+
+// Number of definitions of each register in a loop, counting both halves of
+// wide registers.
+using WriteCounts = std::unordered_map<reg_t, size_t>;
+
+size_t get_write_count(const WriteCounts& write_counts, reg_t reg) {
+  auto it = write_counts.find(reg);
+  return it == write_counts.end() ? 0 : it->second;
+}
+
+// Finds the last definition of the register in the block, and returns its
+// primary instruction, which is the one defining a move-result-pseudo.
+const IRInstruction* find_last_def(cfg::Block* block, reg_t reg) {
+  const IRInstruction* def{nullptr};
+  const IRInstruction* prev{nullptr};
+  for (const auto& mie : ir_list::InstructionIterable(block)) {
+    auto* insn = mie.insn;
+    if (writes_reg(insn, reg)) {
+      def = opcode::is_a_move_result_pseudo(insn->opcode()) ? prev : insn;
+    }
+    prev = insn;
+  }
+  return def;
+}
+
+// Whether the register is written in the block after the given instruction.
+bool is_written_after(cfg::Block* block, const IRInstruction* after,
+                      reg_t reg) {
+  bool seen{false};
+  for (const auto& mie : ir_list::InstructionIterable(block)) {
+    if (seen && writes_reg(mie.insn, reg)) {
+      return true;
+    }
+    seen = seen || mie.insn == after;
+  }
+  return false;
+}
+
+struct CountedLoop {
+  // The loop block that is entered when the index is below the bound.
+  cfg::Block* body_entry;
+  reg_t index;
+  reg_t array;
+  // A register that holds the length of the array throughout the loop body.
+  std::optional<reg_t> length;
+  const IRInstruction* increment;
+  cfg::Block* increment_block;
+};
+
+std::optional<CountedLoop> find_counted_loop(cfg::ControlFlowGraph& cfg,
+                                             loop_impl::Loop& loop) {
+  auto* header = loop.get_header();
+  cfg::Block* preheader{nullptr};
+  size_t outside_preds{0};
+  for (auto* edge : header->preds()) {
+    if (!loop.contains(edge->src())) {
+      preheader = edge->src();
+      outside_preds++;
+    }
+  }
+  if (outside_preds != 1 || preheader->succs().size() != 1) {
+    return std::nullopt;
+  }
+
+  auto last_it = header->get_last_insn();
+  if (last_it == header->end() ||
+      !opcode::is_a_conditional_branch(last_it->insn->opcode())) {
+    return std::nullopt;
+  }
+  auto* branch = last_it->insn;
+  auto* branch_edge = cfg.get_succ_edge_of_type(header, cfg::EDGE_BRANCH);
+  auto* goto_edge = cfg.get_succ_edge_of_type(header, cfg::EDGE_GOTO);
+  bool branch_stays = loop.contains(branch_edge->target());
+  if (branch_stays == loop.contains(goto_edge->target())) {
+    return std::nullopt;
+  }
+  auto* body_entry =
+      branch_stays ? branch_edge->target() : goto_edge->target();
+  if (body_entry == header) {
+    return std::nullopt;
+  }
+
+  // Normalize the comparison to "stay in the loop while index < bound".
+  reg_t index;
+  reg_t bound;
+  switch (branch->opcode()) {
+  case OPCODE_IF_GE:
+  case OPCODE_IF_LT:
+    if (branch_stays != (branch->opcode() == OPCODE_IF_LT)) {
+      return std::nullopt;
+    }
+    index = branch->src(0);
+    bound = branch->src(1);
+    break;
+  case OPCODE_IF_LE:
+  case OPCODE_IF_GT:
+    if (branch_stays != (branch->opcode() == OPCODE_IF_GT)) {
+      return std::nullopt;
+    }
+    bound = branch->src(0);
+    index = branch->src(1);
+    break;
+  default:
+    return std::nullopt;
+  }
+
+  WriteCounts write_counts;
+  const IRInstruction* increment{nullptr};
+  cfg::Block* increment_block{nullptr};
+  for (auto* block : loop) {
+    for (const auto& mie : ir_list::InstructionIterable(block)) {
+      auto* insn = mie.insn;
+      if (!insn->has_dest()) {
+        continue;
+      }
+      write_counts[insn->dest()]++;
+      if (insn->dest_is_wide()) {
+        write_counts[insn->dest() + 1]++;
+      }
+      if (writes_reg(insn, index)) {
+        increment = insn;
+        increment_block = block;
+      }
+    }
+  }
+
+  // The index only grows by one, after the check in the header.
+  if (get_write_count(write_counts, index) != 1 ||
+      increment_block == header || increment->opcode() != OPCODE_ADD_INT_LIT ||
+      increment->src(0) != index || increment->get_literal() != 1) {
+    return std::nullopt;
+  }
+  // ... and starts out non-negative.
+  auto* index_def = find_last_def(preheader, index);
+  if (index_def == nullptr || index_def->opcode() != OPCODE_CONST ||
+      index_def->get_literal() < 0) {
+    return std::nullopt;
+  }
+
+  // The bound is the length of an array that doesn't change in the loop.
+  const IRInstruction* length_def{nullptr};
+  std::optional<reg_t> length;
+  auto bound_writes = get_write_count(write_counts, bound);
+  if (bound_writes == 0) {
+    length_def = find_last_def(preheader, bound);
+    length = bound;
+  } else {
+    length_def = find_last_def(header, bound);
+    if (bound_writes == 1) {
+      length = bound;
+    }
+  }
+  if (length_def == nullptr || length_def->opcode() != OPCODE_ARRAY_LENGTH) {
+    return std::nullopt;
+  }
+  auto array = length_def->src(0);
+  if (array == bound || get_write_count(write_counts, array) != 0 ||
+      (bound_writes == 0 && is_written_after(preheader, length_def, array))) {
+    return std::nullopt;
+  }
+  return CountedLoop{body_entry, index,     array,
+                     length,     increment, increment_block};
+}
+
+// What we know about a branch of the loop body.
+enum class CheckKind { Bounds, Null };
+
+std::optional<std::pair<CheckKind, bool>> get_branch_outcome(
+    const CountedLoop& counted_loop,
+    const std::unordered_set<reg_t>& length_regs,
+    const IRInstruction* insn) {
+  auto op = insn->opcode();
+  auto index = counted_loop.index;
+  if (opcode::is_a_testz_branch(op)) {
+    auto src = insn->src(0);
+    if (src == index && (op == OPCODE_IF_LTZ || op == OPCODE_IF_GEZ)) {
+      return std::make_pair(CheckKind::Bounds, op == OPCODE_IF_GEZ);
+    }
+    if (src == counted_loop.array &&
+        (op == OPCODE_IF_EQZ || op == OPCODE_IF_NEZ)) {
+      return std::make_pair(CheckKind::Null, op == OPCODE_IF_NEZ);
+    }
+    return std::nullopt;
+  }
+  auto src0 = insn->src(0);
+  auto src1 = insn->src(1);
+  if (src0 == index && length_regs.count(src1)) {
+    if (op == OPCODE_IF_LT || op == OPCODE_IF_GE) {
+      return std::make_pair(CheckKind::Bounds, op == OPCODE_IF_LT);
+    }
+  } else if (src1 == index && length_regs.count(src0)) {
+    if (op == OPCODE_IF_GT || op == OPCODE_IF_LE) {
+      return std::make_pair(CheckKind::Bounds, op == OPCODE_IF_GT);
+    }
+  }
+  return std::nullopt;
+}
+
+} // namespace
+
+BoundsCheckEliminationPass::Stats BoundsCheckEliminationPass::process_code(
+    IRCode* code) {
+  Stats stats;
+  always_assert(code->editable_cfg_built());
+  auto& cfg = code->cfg();
+  loop_impl::LoopInfo loop_info(std::as_const(cfg));
+
+  std::vector<cfg::Edge*> dead_edges;
+  std::unordered_set<cfg::Edge*> dead_edges_set;
+  for (auto& loop : loop_info) {
+    auto counted_loop = find_counted_loop(cfg, loop);
+    if (!counted_loop) {
+      continue;
+    }
+    stats.counted_loops++;
+    auto* header = loop.get_header();
+
+    // Find the blocks that can only be reached from the body entry without
+    // passing through the increment of the index, or the header again.
+    std::unordered_map<cfg::Block*, bool> in_range;
+    for (auto* block : loop) {
+      in_range[block] = block != header;
+    }
+    bool changed;
+    do {
+      changed = false;
+      for (auto* block : loop) {
+        if (!in_range.at(block)) {
+          continue;
+        }
+        for (auto* edge : block->preds()) {
+          auto* pred = edge->src();
+          bool pred_in_range =
+              pred == header
+                  ? block == counted_loop->body_entry &&
+                        edge->type() != cfg::EDGE_THROW
+                  : loop.contains(pred) && in_range.at(pred) &&
+                        pred != counted_loop->increment_block;
+          if (!pred_in_range) {
+            in_range[block] = false;
+            changed = true;
+            break;
+          }
+        }
+      }
+    } while (changed);
+
+    for (auto* block : loop) {
+      if (!in_range.at(block) || block == counted_loop->increment_block) {
+        continue;
+      }
+      std::unordered_set<reg_t> length_regs;
+      if (counted_loop->length) {
+        length_regs.insert(*counted_loop->length);
+      }
+      const IRInstruction* prev{nullptr};
+      for (const auto& mie : ir_list::InstructionIterable(block)) {
+        auto* insn = mie.insn;
+        if (insn->has_dest()) {
+          length_regs.erase(insn->dest());
+          if (insn->dest_is_wide()) {
+            length_regs.erase(insn->dest() + 1);
+          }
+          if (opcode::is_a_move_result_pseudo(insn->opcode()) &&
+              prev->opcode() == OPCODE_ARRAY_LENGTH &&
+              prev->src(0) == counted_loop->array) {
+            length_regs.insert(insn->dest());
+          }
+        }
+        prev = insn;
+      }
+      auto last_it = block->get_last_insn();
+      if (last_it == block->end() ||
+          !opcode::is_a_conditional_branch(last_it->insn->opcode())) {
+        continue;
+      }
+      auto outcome =
+          get_branch_outcome(*counted_loop, length_regs, last_it->insn);
+      if (!outcome) {
+        continue;
+      }
+      auto [kind, taken] = *outcome;
+      TRACE(LOOP, 4, "[bce] %s is %s taken", SHOW(last_it->insn),
+            taken ? "always" : "never");
+      auto* dead_edge = cfg.get_succ_edge_of_type(
+          block, taken ? cfg::EDGE_GOTO : cfg::EDGE_BRANCH);
+      if (!dead_edges_set.insert(dead_edge).second) {
+        continue;
+      }
+      dead_edges.push_back(dead_edge);
+      if (kind == CheckKind::Bounds) {
+        stats.bounds_checks_eliminated++;
+      } else {
+        stats.null_checks_eliminated++;
+      }
+    }
+  }
+
+  if (!dead_edges.empty()) {
+    cfg.delete_edges(dead_edges.begin(), dead_edges.end());
+    cfg.remove_unreachable_blocks();
+  }
+  return stats;
+}
+
+void BoundsCheckEliminationPass::run_pass(DexStoresVector& stores,
+                                          ConfigFiles& /* unused */,
+                                          PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  Stats stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* method) {
+    const auto code = method->get_code();
+    if (!code || method->rstate.no_optimizations()) {
+      return Stats{};
+    }
+    auto method_stats = process_code(code);
+    auto eliminated = method_stats.bounds_checks_eliminated +
+                      method_stats.null_checks_eliminated;
+    if (eliminated > 0) {
+      TRACE(LOOP, 3, "[bce] Eliminated %zu checks in {%s}", eliminated,
+            SHOW(method));
+    }
+    return method_stats;
+  });
+  mgr.incr_metric(METRIC_COUNTED_LOOPS, stats.counted_loops);
+  mgr.incr_metric(METRIC_BOUNDS_CHECKS_ELIMINATED,
+                  stats.bounds_checks_eliminated);
+  mgr.incr_metric(METRIC_NULL_CHECKS_ELIMINATED, stats.null_checks_eliminated);
+  TRACE(LOOP, 1, "[bce] Eliminated %zu bounds checks and %zu null checks",
+        stats.bounds_checks_eliminated, stats.null_checks_eliminated);
+}
+
+static BoundsCheckEliminationPass s_pass;
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "Pass.h"
+
+class IRCode;
+
+class BoundsCheckEliminationPass : public Pass {
+ public:
+  struct Stats {
+    size_t counted_loops{0};
+    size_t bounds_checks_eliminated{0};
+    size_t null_checks_eliminated{0};
+
+    Stats& operator+=(const Stats& that) {
+      counted_loops += that.counted_loops;
+      bounds_checks_eliminated += that.bounds_checks_eliminated;
+      null_checks_eliminated += that.null_checks_eliminated;
+      return *this;
+    }
+  };
+
+  BoundsCheckEliminationPass() : Pass("BoundsCheckEliminationPass") {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {
+        {DexLimitsObeyed, Preserves},
+        {NoResolvablePureRefs, Preserves},
+        {InitialRenameClass, Preserves},
+    };
+  }
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  /*
+   * Removes explicit index and null checks of arrays that are iterated over
+   * by counted loops. The code must have an editable cfg.
+   */
+  static Stats process_code(IRCode* code);
+};
@@ -0,0 +1,500 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * Generic and Kotlin code often passes primitives through boxed parameters and
+ * return values, so that every call allocates a box that is unboxed right
+ * away on the other side:
+ *
+ *   caller:                              callee(Ljava/lang/Integer;)V:
+ *     invoke-static {v0} Integer.valueOf   load-param-object v1
+ *     move-result-object v1                invoke-virtual {v1} Integer.intValue
+ *     invoke-static {v1} callee            move-result v2
+ *
+ * This pass changes such parameters of non-virtual methods to the primitive
+ * type when
+ * - every call site passes the result of valueOf() of the boxed type, and
+ * - the callee only unboxes the parameter with the matching xxxValue().
+ * The boxing at the call sites is removed when the box isn't used otherwise,
+ * and the unboxing in the callee becomes a move. The same is done the other
+ * way round for boxed return values which are the result of valueOf() at all
+ * returns, and only unboxed at all call sites.
+ *
+ * As the callee only ever sees values that were boxed by valueOf(), the
+ * unboxing could not have thrown, and the boxes could not have been compared
+ * by reference. The primitive is captured right before each valueOf() call
+ * into a new register, which holds the input of the latest execution of that
+ * call wherever its result is the only definition reaching a use.
+ */
+
+#include "BoxingEliminationPass.h"
+
+#include <limits>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ConcurrentContainers.h"
+#include "ControlFlow.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "LiveRange.h"
+#include "MethodUtil.h"
+#include "PassManager.h"
+#include "ReachableClasses.h"
+#include "Resolver.h"
+#include "Show.h"
+#include "Trace.h"
+#include "TypeUtil.h"
+#include "Walkers.h"
+
+namespace {
+
+constexpr const char* METRIC_PARAMS_UNBOXED = "num_params_unboxed";
+constexpr const char* METRIC_RETURNS_UNBOXED = "num_returns_unboxed";
+constexpr const char* METRIC_BOXINGS_REMOVED = "num_boxings_removed";
+constexpr const char* METRIC_UNBOXINGS_REMOVED = "num_unboxings_removed";
+
+// Stands for the return value among the parameter indices of a method.
+constexpr size_t RETURN_INDEX = std::numeric_limits<size_t>::max();
+
+// The boxed values of a method that can become primitives, as indices into
+// its proto's arguments, or RETURN_INDEX.
+using Unboxable = std::set<size_t>;
+
+bool is_wide(const DexType* boxed) {
+  return type::is_wide_type(
+      type::get_unboxing_method_for_type(boxed)->get_proto()->get_rtype());
+}
+
+/*
+ * The definitions and uses of the registers of a method. Results of
+ * instructions are defined by their move-result, which `primary` maps back to
+ * the instruction.
+ */
+struct Chains {
+  live_range::DefUseChains du;
+  live_range::UseDefChains ud;
+  std::unordered_map<const IRInstruction*, IRInstruction*> primary;
+
+  explicit Chains(cfg::ControlFlowGraph& cfg) {
+    live_range::Chains chains(cfg);
+    du = chains.get_def_use_chains();
+    ud = chains.get_use_def_chains();
+    auto ii = cfg::InstructionIterable(cfg);
+    for (auto it = ii.begin(); it != ii.end(); ++it) {
+      if (it->insn->has_move_result_any()) {
+        auto move_result = cfg.move_result_of(it);
+        if (!move_result.is_end()) {
+          primary.emplace(move_result->insn, it->insn);
+        }
+      }
+    }
+  }
+
+  // Returns the only definition of the given use, or nullptr.
+  IRInstruction* single_def(IRInstruction* insn, src_index_t index) const {
+    auto it = ud.find(live_range::Use{insn, index});
+    if (it == ud.end() || it->second.size() != 1) {
+      return nullptr;
+    }
+    return *it->second.begin();
+  }
+
+  // Returns the valueOf() call of the boxed type that is the only definition
+  // of the given use, or nullptr.
+  IRInstruction* single_boxing(IRInstruction* insn,
+                               src_index_t index,
+                               const DexType* boxed) const {
+    auto* def = single_def(insn, index);
+    if (def == nullptr) {
+      return nullptr;
+    }
+    auto it = primary.find(def);
+    if (it == primary.end() || it->second->opcode() != OPCODE_INVOKE_STATIC ||
+        it->second->get_method() != type::get_value_of_method_for_type(boxed)) {
+      return nullptr;
+    }
+    return it->second;
+  }
+
+  // Returns true if all uses of `def` unbox it into the primitive type of
+  // `boxed`, and `def` is the only definition reaching them.
+  bool only_unboxed(IRInstruction* def, const DexType* boxed) const {
+    auto it = du.find(def);
+    if (it == du.end()) {
+      return true;
+    }
+    auto* unboxing = type::get_unboxing_method_for_type(boxed);
+    for (const auto& use : it->second) {
+      if (use.insn->opcode() != OPCODE_INVOKE_VIRTUAL ||
+          use.insn->get_method() != unboxing || use.src_index != 0 ||
+          single_def(use.insn, 0) != def) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+bool is_boxed(const DexType* type) {
+  return type::get_value_of_method_for_type(type) != nullptr;
+}
+
+/*
+ * Finds the boxed parameters that the method only unboxes, and whether all its
+ * returned values are boxed by valueOf().
+ */
+Unboxable find_unboxable(DexMethod* method) {
+  Unboxable unboxable;
+  auto* proto = method->get_proto();
+  auto* args = proto->get_args();
+  bool has_boxed = is_boxed(proto->get_rtype()) ||
+                   std::any_of(args->begin(), args->end(),
+                               [](auto* t) { return is_boxed(t); });
+  if (!has_boxed) {
+    return unboxable;
+  }
+
+  auto& cfg = method->get_code()->cfg();
+  Chains chains(cfg);
+  auto param_insns = cfg.get_param_instructions();
+  auto param_it = param_insns.begin();
+  if (!is_static(method)) {
+    ++param_it;
+  }
+  for (size_t i = 0; i < args->size(); ++i, ++param_it) {
+    if (is_boxed(args->at(i)) &&
+        chains.only_unboxed(param_it->insn, args->at(i))) {
+      unboxable.insert(i);
+    }
+  }
+
+  auto* rtype = proto->get_rtype();
+  if (is_boxed(rtype)) {
+    bool all_boxed = true;
+    bool has_return = false;
+    for (const auto& mie : cfg::InstructionIterable(cfg)) {
+      if (mie.insn->opcode() == OPCODE_RETURN_OBJECT) {
+        has_return = true;
+        all_boxed &= chains.single_boxing(mie.insn, 0, rtype) != nullptr;
+      }
+    }
+    if (has_return && all_boxed) {
+      unboxable.insert(RETURN_INDEX);
+    }
+  }
+  return unboxable;
+}
+
+size_t arg_src_index(const DexMethod* callee, size_t index) {
+  return is_static(callee) ? index : index + 1;
+}
+
+DexMethod* resolve_callee(const IRInstruction* insn) {
+  if (!opcode::is_an_invoke(insn->opcode())) {
+    return nullptr;
+  }
+  return resolve_method(insn->get_method(), opcode_to_search(insn));
+}
+
+/*
+ * Rewrites the method's own boxed parameters and return values in
+ * `unboxable`, and its calls to methods in `unboxed`.
+ */
+BoxingEliminationPass::Stats rewrite(
+    DexMethod* method,
+    const std::unordered_map<const DexMethod*, Unboxable>& unboxed) {
+  BoxingEliminationPass::Stats stats;
+  auto& cfg = method->get_code()->cfg();
+  auto insns = cfg::InstructionIterable(cfg);
+  if (!unboxed.count(method) &&
+      std::none_of(insns.begin(), insns.end(), [&](const auto& mie) {
+        auto* callee = resolve_callee(mie.insn);
+        return callee != nullptr && unboxed.count(callee);
+      })) {
+    return stats;
+  }
+  Chains chains(cfg);
+
+  // valueOf() calls -> register holding their input.
+  std::unordered_map<IRInstruction*, reg_t> box_inputs;
+  // valueOf() calls -> their uses that no longer read the box.
+  std::unordered_map<IRInstruction*, std::unordered_set<live_range::Use>>
+      unboxed_uses;
+  // Unboxing calls -> register holding the primitive.
+  std::vector<std::pair<IRInstruction*, reg_t>> unboxings;
+  auto box_input = [&](IRInstruction* value_of) {
+    auto it = box_inputs.find(value_of);
+    if (it == box_inputs.end()) {
+      auto wide = is_wide(value_of->get_method()->get_class());
+      auto reg = wide ? cfg.allocate_wide_temp() : cfg.allocate_temp();
+      it = box_inputs.emplace(value_of, reg).first;
+    }
+    return it->second;
+  };
+  auto unbox_uses = [&](IRInstruction* def, reg_t reg) {
+    auto it = chains.du.find(def);
+    if (it != chains.du.end()) {
+      for (const auto& use : it->second) {
+        unboxings.emplace_back(use.insn, reg);
+      }
+    }
+  };
+
+  auto own_it = unboxed.find(method);
+  if (own_it != unboxed.end()) {
+    auto* proto = method->get_proto();
+    auto param_insns = cfg.get_param_instructions();
+    auto param_it = param_insns.begin();
+    if (!is_static(method)) {
+      ++param_it;
+    }
+    for (size_t i = 0; i < proto->get_args()->size(); ++i, ++param_it) {
+      if (!own_it->second.count(i)) {
+        continue;
+      }
+      auto* load_param = param_it->insn;
+      auto wide = is_wide(proto->get_args()->at(i));
+      auto reg = wide ? cfg.allocate_wide_temp() : cfg.allocate_temp();
+      unbox_uses(load_param, reg);
+      load_param
+          ->set_opcode(wide ? IOPCODE_LOAD_PARAM_WIDE : IOPCODE_LOAD_PARAM)
+          ->set_dest(reg);
+      stats.params_unboxed++;
+    }
+    if (own_it->second.count(RETURN_INDEX)) {
+      auto* rtype = proto->get_rtype();
+      for (const auto& mie : cfg::InstructionIterable(cfg)) {
+        auto* insn = mie.insn;
+        if (insn->opcode() != OPCODE_RETURN_OBJECT) {
+          continue;
+        }
+        auto* value_of = chains.single_boxing(insn, 0, rtype);
+        always_assert(value_of != nullptr);
+        unboxed_uses[value_of].insert(live_range::Use{insn, 0});
+        insn->set_opcode(is_wide(rtype) ? OPCODE_RETURN_WIDE : OPCODE_RETURN)
+            ->set_src(0, box_input(value_of));
+      }
+      stats.returns_unboxed++;
+    }
+  }
+
+  auto ii = cfg::InstructionIterable(cfg);
+  for (auto it = ii.begin(); it != ii.end(); ++it) {
+    auto* insn = it->insn;
+    auto* callee = resolve_callee(insn);
+    if (callee == nullptr) {
+      continue;
+    }
+    auto callee_it = unboxed.find(callee);
+    if (callee_it == unboxed.end()) {
+      continue;
+    }
+    auto* proto = callee->get_proto();
+    for (auto index : callee_it->second) {
+      if (index == RETURN_INDEX) {
+        auto move_result = cfg.move_result_of(it);
+        if (move_result.is_end()) {
+          continue;
+        }
+        auto wide = is_wide(proto->get_rtype());
+        auto reg = wide ? cfg.allocate_wide_temp() : cfg.allocate_temp();
+        unbox_uses(move_result->insn, reg);
+        move_result->insn
+            ->set_opcode(wide ? OPCODE_MOVE_RESULT_WIDE : OPCODE_MOVE_RESULT)
+            ->set_dest(reg);
+        continue;
+      }
+      auto src_index = arg_src_index(callee, index);
+      auto* value_of =
+          chains.single_boxing(insn, src_index, proto->get_args()->at(index));
+      always_assert(value_of != nullptr);
+      unboxed_uses[value_of].insert(live_range::Use{insn, src_index});
+      insn->set_src(src_index, box_input(value_of));
+    }
+  }
+
+  for (auto [unboxing, reg] : unboxings) {
+    auto it = cfg.find_insn(unboxing);
+    auto move_result = cfg.move_result_of(it);
+    if (move_result.is_end()) {
+      cfg.remove_insn(it);
+    } else {
+      auto wide = type::is_wide_type(
+          unboxing->get_method()->get_proto()->get_rtype());
+      auto* move = new IRInstruction(wide ? OPCODE_MOVE_WIDE : OPCODE_MOVE);
+      move->set_dest(move_result->insn->dest())->set_src(0, reg);
+      cfg.replace_insns(it, {move});
+    }
+    stats.unboxings_removed++;
+  }
+
+  for (auto [value_of, reg] : box_inputs) {
+    auto it = cfg.find_insn(value_of);
+    auto wide = is_wide(value_of->get_method()->get_class());
+    auto* move = new IRInstruction(wide ? OPCODE_MOVE_WIDE : OPCODE_MOVE);
+    move->set_dest(reg)->set_src(0, value_of->src(0));
+    cfg.insert_before(it, {move});
+
+    // The box itself is gone if all its uses were rewritten.
+    it = cfg.find_insn(value_of);
+    const auto& uses = unboxed_uses.at(value_of);
+    auto def = chains.du.find(cfg.move_result_of(it)->insn);
+    if (def == chains.du.end() ||
+        std::all_of(def->second.begin(), def->second.end(),
+                    [&](const auto& use) { return uses.count(use); })) {
+      cfg.remove_insn(it);
+      stats.boxings_removed++;
+    }
+  }
+  return stats;
+}
+
+} // namespace
+
+BoxingEliminationPass::Stats& BoxingEliminationPass::Stats::operator+=(
+    const Stats& that) {
+  params_unboxed += that.params_unboxed;
+  returns_unboxed += that.returns_unboxed;
+  boxings_removed += that.boxings_removed;
+  unboxings_removed += that.unboxings_removed;
+  return *this;
+}
+
+BoxingEliminationPass::Stats BoxingEliminationPass::eliminate_boxing(
+    const Scope& scope) {
+  // 1) Find the boxed parameters and return values that non-virtual methods
+  // only unbox or only box, respectively.
+  InsertOnlyConcurrentMap<const DexMethod*, Unboxable> candidates;
+  walk::parallel::methods(scope, [&](DexMethod* method) {
+    if (method->is_virtual() || method::is_init(method) ||
+        method::is_clinit(method) || method->get_code() == nullptr ||
+        !can_rename(method) || root(method) ||
+        method->rstate.no_optimizations()) {
+      return;
+    }
+    auto unboxable = find_unboxable(method);
+    if (!unboxable.empty()) {
+      candidates.emplace(method, std::move(unboxable));
+    }
+  });
+  if (candidates.empty()) {
+    return Stats{};
+  }
+
+  // 2) Reject the ones for which some call site doesn't box the argument, or
+  // uses the returned box other than by unboxing it.
+  ConcurrentMap<const DexMethod*, Unboxable> rejected;
+  walk::parallel::code(scope, [&](DexMethod* caller, IRCode& code) {
+    auto& cfg = code.cfg();
+    std::optional<Chains> chains;
+    auto ii = cfg::InstructionIterable(cfg);
+    for (auto it = ii.begin(); it != ii.end(); ++it) {
+      auto* insn = it->insn;
+      auto* callee = resolve_callee(insn);
+      if (callee == nullptr) {
+        continue;
+      }
+      const auto* unboxable = candidates.get(callee);
+      if (unboxable == nullptr) {
+        continue;
+      }
+      Unboxable rejected_here;
+      if (insn->get_method() != callee || caller->rstate.no_optimizations()) {
+        rejected_here = *unboxable;
+      } else {
+        if (!chains) {
+          chains.emplace(cfg);
+        }
+        auto* proto = callee->get_proto();
+        for (auto index : *unboxable) {
+          if (index == RETURN_INDEX) {
+            auto move_result = cfg.move_result_of(it);
+            if (!move_result.is_end() &&
+                !chains->only_unboxed(move_result->insn, proto->get_rtype())) {
+              rejected_here.insert(index);
+            }
+          } else if (chains->single_boxing(insn, arg_src_index(callee, index),
+                                           proto->get_args()->at(index)) ==
+                     nullptr) {
+            rejected_here.insert(index);
+          }
+        }
+      }
+      if (!rejected_here.empty()) {
+        rejected.update(callee, [&](auto*, Unboxable& indices, bool) {
+          indices.insert(rejected_here.begin(), rejected_here.end());
+        });
+      }
+    }
+  });
+
+  std::unordered_map<const DexMethod*, Unboxable> unboxed;
+  for (const auto& [method, unboxable] : candidates) {
+    auto remaining = unboxable;
+    if (const auto* indices = rejected.get_unsafe(method)) {
+      for (auto index : *indices) {
+        remaining.erase(index);
+      }
+    }
+    if (!remaining.empty()) {
+      unboxed.emplace(method, std::move(remaining));
+    }
+  }
+  if (unboxed.empty()) {
+    return Stats{};
+  }
+
+  // 3) Rewrite the methods and their call sites, then their protos.
+  auto stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* method) {
+    if (method->get_code() == nullptr) {
+      return Stats{};
+    }
+    return rewrite(method, unboxed);
+  });
+  for (const auto& [const_method, unboxable] : unboxed) {
+    auto* method = const_cast<DexMethod*>(const_method);
+    auto* proto = method->get_proto();
+    DexTypeList::ContainerType args(proto->get_args()->begin(),
+                                    proto->get_args()->end());
+    auto unboxed_type = [](const DexType* boxed) {
+      return type::get_unboxing_method_for_type(boxed)
+          ->get_proto()
+          ->get_rtype();
+    };
+    auto* rtype = proto->get_rtype();
+    for (auto index : unboxable) {
+      if (index == RETURN_INDEX) {
+        rtype = unboxed_type(rtype);
+      } else {
+        args.at(index) = unboxed_type(args.at(index));
+      }
+    }
+    auto* new_proto = DexProto::make_proto(
+        rtype, DexTypeList::make_type_list(std::move(args)));
+    TRACE(ARGS, 2, "Unboxing %s to %s", SHOW(method), SHOW(new_proto));
+    DexMethodSpec spec(nullptr, nullptr, new_proto);
+    method->change(spec, /* rename_on_collision */ true);
+  }
+  return stats;
+}
+
+void BoxingEliminationPass::run_pass(DexStoresVector& stores,
+                                     ConfigFiles& /* unused */,
+                                     PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  auto stats = eliminate_boxing(scope);
+  mgr.incr_metric(METRIC_PARAMS_UNBOXED, stats.params_unboxed);
+  mgr.incr_metric(METRIC_RETURNS_UNBOXED, stats.returns_unboxed);
+  mgr.incr_metric(METRIC_BOXINGS_REMOVED, stats.boxings_removed);
+  mgr.incr_metric(METRIC_UNBOXINGS_REMOVED, stats.unboxings_removed);
+}
+
+static BoxingEliminationPass s_pass;
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "DexClass.h"
+#include "Pass.h"
+
+class BoxingEliminationPass : public Pass {
+ public:
+  struct Stats {
+    size_t params_unboxed{0};
+    size_t returns_unboxed{0};
+    size_t boxings_removed{0};
+    size_t unboxings_removed{0};
+
+    Stats& operator+=(const Stats&);
+  };
+
+  BoxingEliminationPass() : Pass("BoxingEliminationPass") {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {
+        {DexLimitsObeyed, Preserves},
+        {HasSourceBlocks, Preserves},
+        {NoInitClassInstructions, Preserves},
+        {NoResolvablePureRefs, Preserves},
+        {NoUnreachableInstructions, Preserves},
+        {RenameClass, Preserves},
+    };
+  }
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  // Changes the boxed parameters and return values of the non-virtual methods
+  // in `scope` to primitives, where every caller boxes the argument with
+  // valueOf() and the callee only unboxes it again, or the other way round
+  // for return values.
+  static Stats eliminate_boxing(const Scope& scope);
+};
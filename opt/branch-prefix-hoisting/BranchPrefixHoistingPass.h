@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Pass.h"
 
 class BranchPrefixHoistingPass : public Pass {
@@ -26,5 +27,9 @@ class BranchPrefixHoistingPass : public Pass {
     };
   }
 
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 };
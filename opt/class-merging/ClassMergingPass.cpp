@@ -273,6 +273,9 @@ void ClassMergingPass::run_pass(DexStoresVector& stores,
   }
 
   auto scope = build_class_scope(stores);
+  // Merging a model only rewrites the references to its own targets, so the
+  // summaries remain valid for the following models.
+  auto summaries = summarize_mergeability(scope, m_model_specs);
   ModelStats total_stats;
   for (ModelSpec& model_spec : m_model_specs) {
     if (!model_spec.enabled) {
@@ -284,8 +287,8 @@ void ClassMergingPass::run_pass(DexStoresVector& stores,
             "dex");
       model_spec.include_primary_dex = true;
     }
-    total_stats +=
-        class_merging::merge_model(scope, conf, mgr, stores, model_spec);
+    total_stats += class_merging::merge_model(scope, conf, mgr, stores,
+                                              model_spec, &summaries);
   }
   post_dexen_changes(scope, stores);
   total_stats.update_redex_stats(" total", mgr);
@@ -142,14 +142,18 @@ void IntraDexClassMergingPass::run_pass(DexStoresVector& stores,
     return;
   }
 
+  // Shared by the global model of the reshuffle and the merged model, as
+  // reshuffling only moves classes between dexes.
+  MergeabilitySummaries summaries(scope, m_merging_spec.merging_targets);
   auto& root_store = stores.at(0);
   auto& root_dexen = root_store.get_dexen();
   if (m_enable_reshuffle && interdex_pass->minimize_cross_dex_refs() &&
       root_dexen.size() > 1) {
     if (m_enable_mergeability_aware_reshuffle) {
       class_merging::Model merging_model =
-          class_merging::construct_global_model(
-              scope, mgr, conf, stores, m_merging_spec, m_global_min_count);
+          class_merging::construct_global_model(scope, mgr, conf, stores,
+                                                m_merging_spec,
+                                                m_global_min_count, &summaries);
       InterDexReshuffleImpl impl(
           conf, mgr, m_reshuffle_config, scope, root_dexen,
           interdex_pass->get_dynamically_dead_dexes(), merging_model);
@@ -174,7 +178,7 @@ void IntraDexClassMergingPass::run_pass(DexStoresVector& stores,
   }
 
   class_merging::merge_model(type_system, scope, conf, mgr, stores,
-                             m_merging_spec);
+                             m_merging_spec, &summaries);
 
   post_dexen_changes(scope, stores);
 
@@ -11,7 +11,9 @@
 #include "LiveRange.h"
 #include "Model.h"
 #include "PassManager.h"
+#include "RedexContext.h"
 #include "ReflectionAnalysis.h"
+#include "ReflectionAnalysisCache.h"
 #include "Show.h"
 #include "TypeUtil.h"
 #include "Walkers.h"
@@ -59,7 +61,7 @@ bool can_delete_class(const DexClass* cls, bool is_anonymous_class) {
 }
 
 TypeSet collect_reflected_mergeables(
-    reflection::MetadataCache& refl_metadata_cache,
+    reflection::ReflectionAnalysisCache& reflection_analyses,
     class_merging::ModelSpec* merging_spec,
     DexMethod* method) {
   TypeSet non_mergeables;
@@ -67,16 +69,10 @@ TypeSet collect_reflected_mergeables(
   if (!code) {
     return non_mergeables;
   }
-  std::unique_ptr<reflection::ReflectionAnalysis> analysis =
-      std::make_unique<reflection::ReflectionAnalysis>(
-          /* dex_method */ method,
-          /* context (interprocedural only) */ nullptr,
-          /* summary_query_fn (interprocedural only) */ nullptr,
-          /* metadata_cache */ &refl_metadata_cache);
-
-  if (!analysis->has_found_reflection()) {
+  if (!reflection_analyses.has_reflection(method)) {
     return non_mergeables;
   }
+  auto analysis = reflection_analyses.get(method);
 
   auto& cfg = code->cfg();
   live_range::MoveAwareChains chains(cfg);
@@ -113,11 +109,11 @@ TypeSet collect_reflected_mergeables(
 
 void drop_reflected_mergeables(const Scope& scope,
                                class_merging::ModelSpec* merging_spec) {
-  reflection::MetadataCache refl_metadata_cache;
+  auto& reflection_analyses = g_redex->reflection_analyses();
   TypeSet reflected_mergeables =
       walk::parallel::methods<TypeSet, MergeContainers<TypeSet>>(
           scope, [&](DexMethod* meth) {
-            return collect_reflected_mergeables(refl_metadata_cache,
+            return collect_reflected_mergeables(reflection_analyses,
                                                 merging_spec, meth);
           });
 
@@ -232,7 +228,8 @@ class_merging::Model construct_global_model(
     ConfigFiles& conf,
     DexStoresVector& stores,
     const class_merging::ModelSpec& merging_spec,
-    size_t global_min_count) {
+    size_t global_min_count,
+    const MergeabilitySummaries* summaries) {
   // Copy merging_spec to avoid changing the original one.
   class_merging::ModelSpec global_model_merging_spec = merging_spec;
   // The global_model_merging_spec share everything with the input merging_spec
@@ -248,7 +245,7 @@ class_merging::Model construct_global_model(
                                 /*global_min_count=*/global_min_count, mgr,
                                 &global_model_merging_spec);
   return class_merging::construct_model(type_system, scope, conf, mgr, stores,
-                                        global_model_merging_spec);
+                                        global_model_merging_spec, summaries);
 };
 
 } // namespace class_merging
@@ -24,6 +24,7 @@ using DexClasses = std::vector<DexClass*>;
 
 namespace class_merging {
 
+class MergeabilitySummaries;
 class Model;
 
 struct ModelSpec;
@@ -55,6 +56,7 @@ class_merging::Model construct_global_model(
     ConfigFiles& conf,
     DexStoresVector& stores,
     const class_merging::ModelSpec& merging_spec,
-    size_t global_min_count);
+    size_t global_min_count,
+    const MergeabilitySummaries* summaries = nullptr);
 
 } // namespace class_merging
@@ -137,11 +137,14 @@ void ClassSplittingPass::run_pass(DexStoresVector& stores,
   // where all the perf-sensitive classes are.
   auto& store = stores.at(0);
   auto& dexen = store.get_dexen();
-  DexClasses classes;
+  DexClasses classes_to_add;
   // We skip the first dex, as that's the primary dex, and we won't split
-  // classes in there anyway.
+  // classes in there anyway. Like InterDex, we finish each dex before moving
+  // on to the next, so that the per-dex limits apply. All target classes go
+  // into a new dex at the end, away from the cold-start dexes.
   for (size_t dex_nr = 1; dex_nr < dexen.size(); dex_nr++) {
     auto& dex = dexen.at(dex_nr);
+    DexClasses classes;
     for (auto cls : dex) {
       if (!coldstart_types.count(cls->get_type()) &&
           !cls->rstate.has_interdex_subgroup()) {
@@ -153,8 +156,10 @@ void ClassSplittingPass::run_pass(DexStoresVector& stores,
       classes.push_back(cls);
       class_splitter.prepare(cls, nullptr /* mrefs */, nullptr /* trefs */);
     }
+    auto dex_classes_to_add = class_splitter.additional_classes(classes);
+    classes_to_add.insert(classes_to_add.end(), dex_classes_to_add.begin(),
+                          dex_classes_to_add.end());
   }
-  auto classes_to_add = class_splitter.additional_classes(classes);
   dexen.push_back(classes_to_add);
   TRACE(CS, 1, "[class splitting] Added %zu classes", classes_to_add.size());
   auto final_scope = build_class_scope(stores);
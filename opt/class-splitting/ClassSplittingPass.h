@@ -56,6 +56,13 @@ class ClassSplittingPass : public Pass {
          m_config.blocklist_types,
          "List of types for classes to not split.");
     bind("profile_only", m_config.profile_only, m_config.profile_only);
+    bind("source_blocks", m_config.source_blocks, m_config.source_blocks,
+         "Do not relocate methods with source blocks that were hit.");
+    bind("max_relocated_methods_per_dex",
+         m_config.max_relocated_methods_per_dex,
+         m_config.max_relocated_methods_per_dex,
+         "Maximum number of methods relocated out of the classes of one dex, "
+         "or 0 for no limit.");
     always_assert(!m_config.relocate_true_virtual_methods ||
                   m_config.trampolines);
     always_assert(!m_config.trampolines ||
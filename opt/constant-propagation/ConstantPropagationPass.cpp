@@ -27,6 +27,10 @@ void ConstantPropagationPass::run_pass(DexStoresVector& stores,
 
   ScopedMetrics sm(mgr);
   stats.log_metrics(sm, /* with_scope= */ false);
+  mgr.set_metric("num_methods_over_iteration_budget",
+                 impl.num_methods_over_iteration_budget());
+  mgr.set_metric("num_methods_over_time_budget",
+                 impl.num_methods_over_time_budget());
 
   TRACE(CONSTP, 1, "num_branch_propagated: %zu", stats.branches_removed);
   TRACE(CONSTP,
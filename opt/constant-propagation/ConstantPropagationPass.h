@@ -30,6 +30,26 @@ class ConstantPropagationPass : public Pass {
          true,
          m_config.transform.replace_moves_with_consts);
     bind("remove_dead_switch", true, m_config.transform.remove_dead_switch);
+    bind("widening_thresholds",
+         false,
+         m_config.widening_thresholds,
+         "Widen the numeric ranges that grow around loops up to the "
+         "constants of the method, instead of joining them until they "
+         "stabilize.");
+    bind("fixpoint_max_iterations",
+         0u,
+         m_config.fixpoint_budget.max_iterations,
+         "Number of loop iterations after which the analysis of a method "
+         "gives up on the loops that have not stabilized. 0 means no limit.");
+    bind("fixpoint_time_limit_ms",
+         0u,
+         m_fixpoint_time_limit_ms,
+         "Time after which the analysis of a method gives up on the loops "
+         "that have not stabilized. 0 means no limit.");
+    after_configuration([this] {
+      m_config.fixpoint_budget.time_limit =
+          std::chrono::milliseconds(m_fixpoint_time_limit_ms);
+    });
   }
 
   void run_pass(DexStoresVector& stores,
@@ -38,4 +58,5 @@ class ConstantPropagationPass : public Pass {
 
  private:
   constant_propagation::Config m_config;
+  unsigned int m_fixpoint_time_limit_ms{0};
 };
@@ -61,15 +61,18 @@ class AnalyzerGenerator {
   const ImmutableAttributeAnalyzerState* m_immut_analyzer_state;
   const ApiLevelAnalyzerState* m_api_level_analyzer_state;
   const State& m_cp_state;
+  bool m_prune_dead_registers;
 
  public:
   explicit AnalyzerGenerator(
       const ImmutableAttributeAnalyzerState* immut_analyzer_state,
       const ApiLevelAnalyzerState* api_level_analyzer_state,
-      const State& cp_state)
+      const State& cp_state,
+      bool prune_dead_registers)
       : m_immut_analyzer_state(immut_analyzer_state),
         m_api_level_analyzer_state(api_level_analyzer_state),
-        m_cp_state(cp_state) {
+        m_cp_state(cp_state),
+        m_prune_dead_registers(prune_dead_registers) {
     // Initialize the singletons that `operator()` needs ahead of time to
     // avoid a data race.
     static_cast<void>(EnumFieldAnalyzerState::get());
@@ -112,7 +115,7 @@ class AnalyzerGenerator {
             nullptr, nullptr,
             *const_cast<ApiLevelAnalyzerState*>(m_api_level_analyzer_state),
             immut_analyzer_state, nullptr),
-        std::move(env));
+        std::move(env), m_prune_dead_registers);
   }
 };
 
@@ -154,7 +157,7 @@ std::unique_ptr<FixpointIterator> PassImpl::analyze(
   auto fp_iter = std::make_unique<FixpointIterator>(
       cg,
       AnalyzerGenerator(immut_analyzer_state, api_level_analyzer_state,
-                        cp_state),
+                        cp_state, m_config.prune_dead_registers),
       cg_for_wps);
   // Run the bootstrap. All field value and method return values are
   // represented by Top.
@@ -326,6 +329,10 @@ void PassImpl::run_pass(DexStoresVector& stores,
                   m_stats.fp_iter.method_cache_hits);
   mgr.incr_metric("fp_iter.method_cache_misses",
                   m_stats.fp_iter.method_cache_misses);
+  mgr.incr_metric("fp_iter.method_summary_hits",
+                  m_stats.fp_iter.method_summary_hits);
+  mgr.incr_metric("fp_iter.method_summary_misses",
+                  m_stats.fp_iter.method_summary_misses);
 }
 
 static PassImpl s_pass;
@@ -33,6 +33,7 @@ class PassImpl : public Pass {
     uint32_t big_override_threshold{5};
     std::unordered_set<const DexType*> field_blocklist;
     bool compute_definitely_assigned_ifields{true};
+    bool prune_dead_registers{false};
 
     Transform::Config transform;
     RuntimeAssertTransform::Config runtime_assert;
@@ -78,6 +79,10 @@ class PassImpl : public Pass {
          m_config.compute_definitely_assigned_ifields,
          "Whether to predict which instance fields are always written before "
          "they are read, in order to ignore the default value 0.");
+    bind("prune_dead_registers", false, m_config.prune_dead_registers,
+         "Whether the intraprocedural analyses only propagate the registers "
+         "that are live across blocks, which makes them faster on big "
+         "methods without changing their results.");
   }
 
   void run_pass(DexStoresVector& stores,
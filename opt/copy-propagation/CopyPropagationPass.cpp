@@ -8,17 +8,61 @@
 #include "CopyPropagationPass.h"
 
 #include <cinttypes>
+#include <mutex>
 
 #include "DexUtil.h"
 #include "PassManager.h"
 
 using namespace copy_propagation_impl;
 
-void CopyPropagationPass::run_pass(DexStoresVector& stores,
-                                   ConfigFiles& /* unused */,
-                                   PassManager& mgr) {
-  auto scope = build_class_scope(stores);
+namespace {
 
+class CopyPropagationRun : public MethodLocalPass::Run {
+ public:
+  explicit CopyPropagationRun(const Config& config)
+      : m_config(config), m_impl(m_config) {}
+
+  void run_on_method(DexMethod* method, IRCode& /* code */) override {
+    auto stats = m_impl.run_on_method(method);
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    m_stats += stats;
+  }
+
+  void finish(PassManager& mgr) override {
+    mgr.incr_metric("redundant_moves_eliminated", m_stats.moves_eliminated);
+    mgr.incr_metric("source_regs_replaced_with_representative",
+                    m_stats.replaced_sources);
+    mgr.incr_metric("method_type_inferences", m_stats.type_inferences);
+    mgr.incr_metric("lock_fixups", m_stats.lock_fixups);
+    mgr.incr_metric("non_singleton_lock_rdefs",
+                    m_stats.non_singleton_lock_rdefs);
+    TRACE(RME,
+          1,
+          "%" PRId64 " redundant moves eliminated",
+          mgr.get_metric("redundant_moves_eliminated"));
+    TRACE(RME,
+          1,
+          "%" PRId64 " source registers replaced with representative",
+          mgr.get_metric("source_regs_replaced_with_representative"));
+    TRACE(RME,
+          1,
+          "%" PRId64 " methods had type inference computed",
+          mgr.get_metric("method_type_inferences"));
+  }
+
+ private:
+  const Config m_config;
+  CopyPropagation m_impl;
+  std::mutex m_stats_mutex;
+  Stats m_stats;
+};
+
+} // namespace
+
+std::unique_ptr<MethodLocalPass::Run> CopyPropagationPass::start_run(
+    DexStoresVector& /* unused */,
+    ConfigFiles& /* unused */,
+    PassManager& mgr) {
   if (m_config.eliminate_const_literals &&
       !mgr.get_redex_options().verify_none_enabled) {
     // This option is not safe with the verifier
@@ -30,26 +74,7 @@ void CopyPropagationPass::run_pass(DexStoresVector& stores,
   }
   m_config.regalloc_has_run = mgr.regalloc_has_run();
 
-  CopyPropagation impl(m_config);
-  auto stats = impl.run(scope);
-  mgr.incr_metric("redundant_moves_eliminated", stats.moves_eliminated);
-  mgr.incr_metric("source_regs_replaced_with_representative",
-                  stats.replaced_sources);
-  mgr.incr_metric("method_type_inferences", stats.type_inferences);
-  mgr.incr_metric("lock_fixups", stats.lock_fixups);
-  mgr.incr_metric("non_singleton_lock_rdefs", stats.non_singleton_lock_rdefs);
-  TRACE(RME,
-        1,
-        "%" PRId64 " redundant moves eliminated",
-        mgr.get_metric("redundant_moves_eliminated"));
-  TRACE(RME,
-        1,
-        "%" PRId64 " source registers replaced with representative",
-        mgr.get_metric("source_regs_replaced_with_representative"));
-  TRACE(RME,
-        1,
-        "%" PRId64 " methods had type inference computed",
-        mgr.get_metric("method_type_inferences"));
+  return std::make_unique<CopyPropagationRun>(m_config);
 }
 
 static CopyPropagationPass s_pass;
@@ -8,11 +8,12 @@
 #pragma once
 
 #include "CopyPropagation.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Pass.h"
 
-class CopyPropagationPass : public Pass {
+class CopyPropagationPass : public MethodLocalPass {
  public:
-  CopyPropagationPass() : Pass("CopyPropagationPass") {}
+  CopyPropagationPass() : MethodLocalPass("CopyPropagationPass") {}
 
   redex_properties::PropertyInteractions get_property_interactions()
       const override {
@@ -28,10 +29,18 @@ class CopyPropagationPass : public Pass {
     };
   }
 
-  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+  }
+
+  bool skips_unchanged_methods() const override { return true; }
+
+  std::unique_ptr<Run> start_run(DexStoresVector&,
+                                 ConfigFiles&,
+                                 PassManager&) override;
 
   void bind_config() override {
-    // This option can only be safely enabled in verify-none. `run_pass` will
+    // This option can only be safely enabled in verify-none. `start_run` will
     // override this value to false if we aren't in verify-none. Here's why:
     //
     // const v0, 0
@@ -10,9 +10,9 @@
 #include "CommonSubexpressionElimination.h"
 #include "ConfigFiles.h"
 #include "CopyPropagation.h"
+#include "CseSharedStateAnalysisPass.h"
 #include "DexUtil.h"
 #include "LocalDce.h"
-#include "Purity.h"
 #include "Show.h"
 #include "Walkers.h"
 
@@ -30,6 +30,8 @@ constexpr const char* METRIC_MAX_VALUE_IDS = "max_value_ids";
 constexpr const char* METRIC_METHODS_USING_OTHER_TRACKED_LOCATION_BIT =
     "methods_using_other_tracked_location_bit";
 constexpr const char* METRIC_BRANCHES_ELIMINATED = "num_branches_eliminated";
+constexpr const char* METRIC_PARTIAL_REDUNDANCIES_ELIMINATED =
+    "num_partial_redundancies_eliminated";
 constexpr const char* METRIC_INSTR_PREFIX = "instr_";
 constexpr const char* METRIC_METHOD_BARRIERS = "num_method_barriers";
 constexpr const char* METRIC_METHOD_BARRIERS_ITERATIONS =
@@ -46,30 +48,25 @@ constexpr const char* METRIC_MAX_ITERATIONS = "num_max_iterations";
 void CommonSubexpressionEliminationPass::bind_config() {
   bind("debug", false, m_debug);
   bind("runtime_assertions", false, m_runtime_assertions);
+  bind("eliminate_partial_redundancies", false,
+       m_eliminate_partial_redundancies,
+       "Whether to also eliminate instructions whose values are only available "
+       "on some incoming edges, by evaluating them on the other edges.");
 }
 
 void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
                                                   ConfigFiles& conf,
                                                   PassManager& mgr) {
   const auto scope = build_class_scope(stores);
-  init_classes::InitClassesWithSideEffects init_classes_with_side_effects(
-      scope, conf.create_init_class_insns());
-
-  auto pure_methods = /* Android framework */ get_pure_methods();
-  auto configured_pure_methods = conf.get_pure_methods();
-  pure_methods.insert(configured_pure_methods.begin(),
-                      configured_pure_methods.end());
-  auto immutable_getters = get_immutable_getters(scope);
-  pure_methods.insert(immutable_getters.begin(), immutable_getters.end());
-
-  std::unordered_set<const DexField*> finalish_fields;
-  auto shared_state = SharedState(
-      pure_methods, conf.get_finalish_field_names(), finalish_fields);
-  method::ClInitHasNoSideEffectsPredicate clinit_has_no_side_effects =
-      [&](const DexType* type) {
-        return !init_classes_with_side_effects.refine(type);
-      };
-  shared_state.init_scope(scope, clinit_has_no_side_effects);
+  auto init_classes_with_side_effects_ptr =
+      InitClassesAnalysisPass::get_or_build(mgr, scope,
+                                            conf.create_init_class_insns());
+  const auto& init_classes_with_side_effects =
+      *init_classes_with_side_effects_ptr;
+
+  auto shared_state_ptr = CseSharedStateAnalysisPass::get_or_build(
+      mgr, conf, scope, init_classes_with_side_effects);
+  auto& shared_state = *shared_state_ptr;
 
   // The following default 'features' of copy propagation would only
   // interfere with what CSE is trying to do.
@@ -97,7 +94,8 @@ void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
           CommonSubexpressionElimination cse(
               &shared_state, code->cfg(), is_static(method),
               method::is_init(method) || method::is_clinit(method),
-              method->get_class(), method->get_proto()->get_args());
+              method->get_class(), method->get_proto()->get_args(),
+              m_eliminate_partial_redundancies);
           bool any_changes = cse.patch(m_runtime_assertions);
           stats += cse.get_stats();
 
@@ -131,6 +129,8 @@ void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
   mgr.incr_metric(METRIC_METHODS_USING_OTHER_TRACKED_LOCATION_BIT,
                   stats.methods_using_other_tracked_location_bit);
   mgr.incr_metric(METRIC_BRANCHES_ELIMINATED, stats.branches_eliminated);
+  mgr.incr_metric(METRIC_PARTIAL_REDUNDANCIES_ELIMINATED,
+                  stats.partial_redundancies_eliminated);
   auto& shared_state_stats = shared_state.get_stats();
   mgr.incr_metric(METRIC_METHOD_BARRIERS, shared_state_stats.method_barriers);
   mgr.incr_metric(METRIC_METHOD_BARRIERS_ITERATIONS,
@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include "CseSharedStateAnalysisPass.h"
+#include "InitClassesAnalysisPass.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Pass.h"
 #include "PassManager.h"
 
@@ -27,9 +30,16 @@ class CommonSubexpressionEliminationPass : public Pass {
   }
 
   void bind_config() override;
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+    au.add_preserve_specific<CseSharedStateAnalysisPass>();
+    au.add_preserve_specific<InitClassesAnalysisPass>();
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
  private:
   bool m_debug;
   bool m_runtime_assertions;
+  bool m_eliminate_partial_redundancies;
 };
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "CseSharedStateAnalysisPass.h"
+
+#include "ConfigFiles.h"
+#include "DexUtil.h"
+#include "InitClassesAnalysisPass.h"
+#include "MethodOverrideGraphAnalysisPass.h"
+#include "PassManager.h"
+#include "Purity.h"
+#include "Trace.h"
+
+namespace {
+
+std::shared_ptr<cse_impl::SharedState> build(
+    const PassManager& mgr,
+    ConfigFiles& conf,
+    const Scope& scope,
+    const init_classes::InitClassesWithSideEffects&
+        init_classes_with_side_effects) {
+  auto pure_methods = /* Android framework */ get_pure_methods();
+  auto configured_pure_methods = conf.get_pure_methods();
+  pure_methods.insert(configured_pure_methods.begin(),
+                      configured_pure_methods.end());
+  auto immutable_getters = get_immutable_getters(scope);
+  pure_methods.insert(immutable_getters.begin(), immutable_getters.end());
+
+  auto shared_state = std::make_shared<cse_impl::SharedState>(
+      pure_methods, conf.get_finalish_field_names(),
+      std::unordered_set<const DexField*>());
+  method::ClInitHasNoSideEffectsPredicate clinit_has_no_side_effects =
+      [&](const DexType* type) {
+        return !init_classes_with_side_effects.refine(type);
+      };
+  shared_state->init_scope(
+      scope, clinit_has_no_side_effects,
+      MethodOverrideGraphAnalysisPass::get_or_build(mgr, scope));
+  return shared_state;
+}
+
+} // namespace
+
+void CseSharedStateAnalysisPass::run_pass(DexStoresVector& stores,
+                                          ConfigFiles& conf,
+                                          PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  auto init_classes_with_side_effects_ptr =
+      InitClassesAnalysisPass::get_or_build(mgr, scope,
+                                            conf.create_init_class_insns());
+  const auto& init_classes_with_side_effects =
+      *init_classes_with_side_effects_ptr;
+  m_result = build(mgr, conf, scope, init_classes_with_side_effects);
+  const auto& stats = m_result->get_stats();
+  mgr.set_metric("method_barriers", stats.method_barriers);
+  mgr.set_metric("conditionally_pure_methods",
+                 stats.conditionally_pure_methods);
+  mgr.set_metric("finalizable_fields", stats.finalizable_fields);
+}
+
+std::shared_ptr<cse_impl::SharedState>
+CseSharedStateAnalysisPass::get_preserved(const PassManager& mgr) {
+  auto* analysis = mgr.get_preserved_analysis<CseSharedStateAnalysisPass>();
+  return analysis == nullptr ? nullptr : analysis->get_result();
+}
+
+std::shared_ptr<cse_impl::SharedState>
+CseSharedStateAnalysisPass::get_or_build(
+    const PassManager& mgr,
+    ConfigFiles& conf,
+    const Scope& scope,
+    const init_classes::InitClassesWithSideEffects&
+        init_classes_with_side_effects) {
+  auto shared_state = get_preserved(mgr);
+  if (shared_state != nullptr) {
+    TRACE(PM, 2, "Reusing preserved CSE shared state");
+    return shared_state;
+  }
+  return build(mgr, conf, scope, init_classes_with_side_effects);
+}
+
+static CseSharedStateAnalysisPass s_pass;
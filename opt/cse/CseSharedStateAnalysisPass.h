@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "AnalysisUsage.h"
+#include "CommonSubexpressionElimination.h"
+#include "DexClass.h"
+#include "InitClassesWithSideEffects.h"
+#include "Pass.h"
+
+class ConfigFiles;
+
+/*
+ * Builds the scope-wide state that CSE needs (pure and conditionally pure
+ * methods, the locations written by each method, finalizable fields) and keeps
+ * it around as a preserved analysis, so that CSE invocations, including the
+ * ones in the shrinker, don't each have to recompute it.
+ *
+ * The computed locations and purity facts over-approximate what the code
+ * does. Passes that only simplify method bodies without introducing new
+ * writes (e.g. CSE itself) keep them sound and may declare that they preserve
+ * this analysis. Passes that add methods, move fields or change the class
+ * hierarchy must not.
+ */
+class CseSharedStateAnalysisPass : public Pass {
+ public:
+  CseSharedStateAnalysisPass()
+      : Pass("CseSharedStateAnalysisPass", Pass::ANALYSIS) {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {};
+  }
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  std::shared_ptr<cse_impl::SharedState> get_result() { return m_result; }
+
+  void destroy_analysis_result() override { m_result = nullptr; }
+
+  // Returns the preserved shared state, if there is one.
+  static std::shared_ptr<cse_impl::SharedState> get_preserved(
+      const PassManager& mgr);
+
+  // Returns the preserved shared state if there is one, and computes a fresh
+  // one for the given scope otherwise.
+  static std::shared_ptr<cse_impl::SharedState> get_or_build(
+      const PassManager& mgr,
+      ConfigFiles& conf,
+      const Scope& scope,
+      const init_classes::InitClassesWithSideEffects&
+          init_classes_with_side_effects);
+
+ private:
+  std::shared_ptr<cse_impl::SharedState> m_result = nullptr;
+};
@@ -10,7 +10,6 @@
 #include <vector>
 
 #include "CFGMutation.h"
-#include "ConcurrentContainers.h"
 #include "Creators.h"
 #include "DexAccess.h"
 #include "DexClass.h"
@@ -22,7 +21,7 @@
 #include "RedexContext.h"
 #include "Show.h"
 #include "SourceBlocks.h"
-#include "Walkers.h"
+#include "WorkQueue.h"
 #include "locator.h"
 
 namespace {
@@ -99,43 +98,28 @@ void DedupStrings::run(DexStoresVector& stores) {
   // For now, we are only trying to optimize strings in the first store.
   // (It should be possible to generalize in the future.)
   DexClassesVector& dexen = stores[0].get_dexen();
-  const auto scope = build_class_scope(dexen);
 
-  // For each method, remember which dex it's defined in.
-  std::unordered_map<const DexMethod*, size_t> methods_to_dex =
-      get_methods_to_dex(dexen);
-
-  // Gather set of methods that must not be touched because they are
-  // in the primary dex or perf sensitive
-  std::unordered_set<const DexMethod*> perf_sensitive_methods =
-      get_perf_sensitive_methods(dexen);
-
-  // Compute set of non-load strings in each dex
-  std::vector<std::unordered_set<const DexString*>> non_load_strings(
-      dexen.size());
-  workqueue_run_for<size_t>(0, dexen.size(), [&](size_t i) {
-    auto& strings = non_load_strings[i];
-    gather_non_load_strings(dexen[i], &strings);
-  });
+  // For each method, remember which dex it's defined in, and whether it must
+  // not be touched because it's in the primary dex or perf sensitive.
+  const auto methods = get_methods(dexen);
 
   // For each string, figure out how many times it's loaded per dex
-  ConcurrentMap<const DexString*, std::unordered_map<size_t, size_t>>
-      occurrences = get_occurrences(scope, methods_to_dex,
-                                    perf_sensitive_methods, non_load_strings);
+  const auto occurrences = get_occurrences(dexen, methods);
 
-  // Use heuristics to determine which strings to dedup,
-  // and figure out factory method details
+  // Use heuristics to determine which strings to dedup, and where to host
+  // them
+  std::vector<std::vector<const DexString*>> strings_in_dexes(dexen.size());
   std::unordered_map<const DexString*, DedupStrings::DedupStringInfo>
-      strings_to_dedup =
-          get_strings_to_dedup(dexen, occurrences, methods_to_dex,
-                               perf_sensitive_methods, non_load_strings);
+      strings_to_dedup = get_strings_to_dedup(occurrences, &strings_in_dexes);
+
+  // Generate factory methods, and figure out factory method details
+  make_const_string_loader_methods(dexen, strings_in_dexes, strings_to_dedup);
 
   // Rewrite const-string instructions
-  rewrite_const_string_instructions(scope, methods_to_dex,
-                                    perf_sensitive_methods, strings_to_dedup);
+  rewrite_const_string_instructions(methods, strings_to_dedup);
 }
 
-std::unordered_set<const DexMethod*> DedupStrings::get_perf_sensitive_methods(
+std::vector<DedupStrings::MethodInfo> DedupStrings::get_methods(
     const DexClassesVector& dexen) {
   std::unordered_set<const DexMethodRef*> sufficiently_popular_methods;
   if (m_method_profiles.has_stats()) {
@@ -172,18 +156,14 @@ std::unordered_set<const DexMethod*> DedupStrings::get_perf_sensitive_methods(
     }
     return sufficiently_popular_methods.count(method);
   };
-  std::unordered_set<const DexMethod*> perf_sensitive_methods;
-  for (size_t dexnr = 0; dexnr < dexen.size(); dexnr++) {
-    auto& classes = dexen[dexnr];
-    for (auto cls : classes) {
+  std::vector<std::vector<MethodInfo>> dex_methods(dexen.size());
+  workqueue_run_for<size_t>(0, dexen.size(), [&](size_t dexnr) {
+    auto& infos = dex_methods[dexnr];
+    for (auto cls : dexen[dexnr]) {
       auto process_method = [&](DexMethod* method) {
         if (method->get_code() != nullptr) {
-          if (is_perf_sensitive(dexnr, cls, method)) {
-            perf_sensitive_methods.emplace(method);
-            m_stats.perf_sensitive_methods++;
-          } else {
-            m_stats.non_perf_sensitive_methods++;
-          }
+          infos.push_back(
+              {method, dexnr, is_perf_sensitive(dexnr, cls, method)});
         }
       };
 
@@ -192,32 +172,19 @@ std::unordered_set<const DexMethod*> DedupStrings::get_perf_sensitive_methods(
       auto& vmethods = cls->get_vmethods();
       std::for_each(vmethods.begin(), vmethods.end(), process_method);
     }
-  }
-  return perf_sensitive_methods;
-}
-
-std::unordered_map<const DexMethod*, size_t> DedupStrings::get_methods_to_dex(
-    const DexClassesVector& dexen) {
-  // Let's build a mapping that tells us for each method which dex it is
-  // defined in.
-
-  std::unordered_map<const DexMethod*, size_t> methods_to_dex;
-  for (size_t dexnr = 0; dexnr < dexen.size(); dexnr++) {
-    auto& classes = dexen[dexnr];
-    for (auto cls : classes) {
-      for (auto method : cls->get_dmethods()) {
-        if (method->get_code() != nullptr) {
-          methods_to_dex.emplace(method, dexnr);
-        }
-      }
-      for (auto method : cls->get_vmethods()) {
-        if (method->get_code() != nullptr) {
-          methods_to_dex.emplace(method, dexnr);
-        }
+  });
+  std::vector<MethodInfo> methods;
+  for (auto& infos : dex_methods) {
+    for (const auto& info : infos) {
+      if (info.perf_sensitive) {
+        m_stats.perf_sensitive_methods++;
+      } else {
+        m_stats.non_perf_sensitive_methods++;
       }
     }
+    methods.insert(methods.end(), infos.begin(), infos.end());
   }
-  return methods_to_dex;
+  return methods;
 }
 
 DexMethod* DedupStrings::make_const_string_loader_method(
@@ -300,130 +267,209 @@ void DedupStrings::gather_non_load_strings(
   strings->insert(library_names.begin(), library_names.end());
 }
 
-ConcurrentMap<const DexString*, std::unordered_map<size_t, size_t>>
-DedupStrings::get_occurrences(
-    const Scope& scope,
-    const std::unordered_map<const DexMethod*, size_t>& methods_to_dex,
-    const std::unordered_set<const DexMethod*>& perf_sensitive_methods,
-    std::vector<std::unordered_set<const DexString*>>& non_load_strings) {
-  // For each string, figure out how many times it's loaded per dex
-  ConcurrentMap<const DexString*, std::unordered_map<size_t, size_t>>
-      occurrences;
-  ConcurrentMap<const DexString*, std::unordered_set<size_t>>
-      perf_sensitive_strings;
-  std::atomic<size_t> perf_sensitive_insns{0};
-  std::atomic<size_t> non_perf_sensitive_insns{0};
-  walk::parallel::code(
-      scope, [this, &occurrences, &perf_sensitive_strings, &methods_to_dex,
-              &perf_sensitive_methods, &perf_sensitive_insns,
-              &non_perf_sensitive_insns](DexMethod* method, IRCode& code) {
-        const auto dexnr = methods_to_dex.at(method);
-        const auto perf_sensitive_method =
-            perf_sensitive_methods.count(method) != 0;
-        always_assert(code.editable_cfg_built());
-        auto& cfg = code.cfg();
-        const auto check_for_hot_blocks =
-            m_perf_mode == DedupStringsPerfMode::
-                               EXCLUDE_HOT_BLOCKS_IN_HOT_METHODS_OR_CLASSES &&
-            perf_sensitive_method && !treat_all_blocks_as_hot(dexnr, method);
-        size_t local_perf_sensitive_insns{0};
-        size_t local_non_perf_sensitive_insns{0};
-        for (auto* block : cfg.blocks()) {
-          for (auto& mie : InstructionIterable(block)) {
-            const auto insn = mie.insn;
-            if (insn->opcode() == OPCODE_CONST_STRING) {
-              const auto str = insn->get_string();
-              if (perf_sensitive_method &&
-                  (!check_for_hot_blocks || is_hot(block))) {
-                perf_sensitive_strings.update(
-                    str,
-                    [dexnr](const DexString*,
-                            std::unordered_set<size_t>& s,
-                            bool /* exists */) { s.emplace(dexnr); });
-                local_perf_sensitive_insns++;
-              } else {
-                occurrences.update(
-                    str,
-                    [dexnr](const DexString*,
-                            std::unordered_map<size_t, size_t>& m,
-                            bool /* exists */) { ++m[dexnr]; });
-                local_non_perf_sensitive_insns++;
-              }
-            }
+DedupStrings::OccurrenceIndex DedupStrings::get_occurrences(
+    DexClassesVector& dexen, const std::vector<MethodInfo>& methods) {
+  // First, collect the const-string instructions of each method, split by
+  // whether they are perf sensitive.
+  std::vector<std::vector<const DexString*>> loads(methods.size());
+  std::vector<std::vector<const DexString*>> perf_sensitive_loads(
+      methods.size());
+  workqueue_run_for<size_t>(0, methods.size(), [&](size_t i) {
+    const auto& info = methods[i];
+    auto& code = *info.method->get_code();
+    always_assert(code.editable_cfg_built());
+    auto& cfg = code.cfg();
+    const auto check_for_hot_blocks =
+        m_perf_mode == DedupStringsPerfMode::
+                           EXCLUDE_HOT_BLOCKS_IN_HOT_METHODS_OR_CLASSES &&
+        info.perf_sensitive &&
+        !treat_all_blocks_as_hot(info.dexnr, info.method);
+    for (auto* block : cfg.blocks()) {
+      for (auto& mie : InstructionIterable(block)) {
+        const auto insn = mie.insn;
+        if (insn->opcode() == OPCODE_CONST_STRING) {
+          if (info.perf_sensitive && (!check_for_hot_blocks || is_hot(block))) {
+            perf_sensitive_loads[i].push_back(insn->get_string());
+          } else {
+            loads[i].push_back(insn->get_string());
           }
         }
-        if (local_perf_sensitive_insns) {
-          perf_sensitive_insns += local_perf_sensitive_insns;
-        }
-        if (local_non_perf_sensitive_insns) {
-          non_perf_sensitive_insns += local_non_perf_sensitive_insns;
-        }
-      });
+      }
+    }
+  });
 
-  // Also, add all the strings that occurred in perf-sensitive methods
-  // to the non_load_strings datastructure, as we won't attempt to dedup them.
-  for (const auto& it : perf_sensitive_strings) {
-    const auto str = it.first;
+  // Second, count the loads per dex. Also, add all the strings that occurred
+  // in perf-sensitive methods to the non-load strings of the dex, as we won't
+  // attempt to dedup them.
+  std::vector<size_t> dex_begins(dexen.size() + 1, methods.size());
+  for (size_t i = methods.size(); i-- > 0;) {
+    dex_begins[methods[i].dexnr] = i;
+  }
+  for (size_t dexnr = dexen.size(); dexnr-- > 0;) {
+    dex_begins[dexnr] = std::min(dex_begins[dexnr], dex_begins[dexnr + 1]);
+  }
+  std::vector<std::unordered_set<const DexString*>> non_load_strings(
+      dexen.size());
+  std::vector<std::vector<std::pair<const DexString*, uint32_t>>> dex_loads(
+      dexen.size());
+  std::vector<std::vector<const DexString*>> dex_perf_sensitive_strings(
+      dexen.size());
+  workqueue_run_for<size_t>(0, dexen.size(), [&](size_t dexnr) {
+    auto& strings = non_load_strings[dexnr];
+    gather_non_load_strings(dexen[dexnr], &strings);
+    std::vector<const DexString*> dex_strings;
+    auto& perf_sensitive_strings = dex_perf_sensitive_strings[dexnr];
+    for (size_t i = dex_begins[dexnr]; i < dex_begins[dexnr + 1]; ++i) {
+      dex_strings.insert(dex_strings.end(), loads[i].begin(), loads[i].end());
+      perf_sensitive_strings.insert(perf_sensitive_strings.end(),
+                                    perf_sensitive_loads[i].begin(),
+                                    perf_sensitive_loads[i].end());
+    }
+    std::sort(perf_sensitive_strings.begin(), perf_sensitive_strings.end());
+    perf_sensitive_strings.erase(std::unique(perf_sensitive_strings.begin(),
+                                             perf_sensitive_strings.end()),
+                                 perf_sensitive_strings.end());
+    strings.insert(perf_sensitive_strings.begin(),
+                   perf_sensitive_strings.end());
+    std::sort(dex_strings.begin(), dex_strings.end());
+    auto& counts = dex_loads[dexnr];
+    for (auto* str : dex_strings) {
+      if (counts.empty() || counts.back().first != str) {
+        counts.emplace_back(str, 0);
+      }
+      counts.back().second++;
+    }
+  });
+
+  size_t perf_sensitive_insns{0};
+  size_t non_perf_sensitive_insns{0};
+  for (size_t i = 0; i < methods.size(); ++i) {
+    perf_sensitive_insns += perf_sensitive_loads[i].size();
+    non_perf_sensitive_insns += loads[i].size();
+  }
+  std::vector<const DexString*> perf_sensitive_strings;
+  for (const auto& strings : dex_perf_sensitive_strings) {
+    perf_sensitive_strings.insert(perf_sensitive_strings.end(),
+                                  strings.begin(), strings.end());
+  }
+  std::sort(perf_sensitive_strings.begin(), perf_sensitive_strings.end());
+  perf_sensitive_strings.erase(std::unique(perf_sensitive_strings.begin(),
+                                           perf_sensitive_strings.end()),
+                               perf_sensitive_strings.end());
+  for (auto* str : perf_sensitive_strings) {
     TRACE(DS, 3, "[dedup strings] perf sensitive string: {%s}", SHOW(str));
+  }
 
-    const auto& dexes = it.second;
-    for (const auto dexnr : dexes) {
-      auto& strings = non_load_strings[dexnr];
-      strings.emplace(str);
+  // Third, group the counts by string. Only the strings loaded in more than
+  // one dex are worth looking at.
+  struct Load {
+    const DexString* str;
+    uint32_t dexnr;
+    uint32_t loads;
+  };
+  std::vector<Load> all_loads;
+  for (size_t dexnr = 0; dexnr < dexen.size(); ++dexnr) {
+    for (const auto& [str, count] : dex_loads[dexnr]) {
+      all_loads.push_back({str, (uint32_t)dexnr, count});
+    }
+  }
+  std::stable_sort(all_loads.begin(), all_loads.end(),
+                   [](const Load& a, const Load& b) { return a.str < b.str; });
+  // (first load, end of loads) of each string loaded in more than one dex
+  std::vector<std::pair<size_t, size_t>> candidates;
+  size_t non_perf_sensitive_strings{0};
+  for (size_t begin = 0, end; begin < all_loads.size(); begin = end) {
+    for (end = begin + 1;
+         end < all_loads.size() && all_loads[end].str == all_loads[begin].str;
+         ++end) {
+    }
+    non_perf_sensitive_strings++;
+    if (end - begin > 1) {
+      candidates.emplace_back(begin, end);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [&](const auto& a, const auto& b) {
+              return compare_dexstrings(all_loads[a.first].str,
+                                        all_loads[b.first].str);
+            });
+
+  // Finally, lay out the entries of each string, including the dexes which
+  // reference it anyway.
+  std::vector<std::vector<OccurrenceIndex::Entry>> rows(candidates.size());
+  workqueue_run_for<size_t>(0, candidates.size(), [&](size_t i) {
+    auto [begin, end] = candidates[i];
+    const auto* str = all_loads[begin].str;
+    auto& row = rows[i];
+    for (uint32_t dexnr = 0; dexnr < dexen.size(); ++dexnr) {
+      uint32_t dex_loads_count = 0;
+      if (begin < end && all_loads[begin].dexnr == dexnr) {
+        dex_loads_count = all_loads[begin++].loads;
+      }
+      bool non_load = non_load_strings[dexnr].count(str) != 0;
+      if (dex_loads_count > 0 || non_load) {
+        row.push_back({dexnr, dex_loads_count, non_load});
+      }
     }
+  });
+  OccurrenceIndex occurrences;
+  occurrences.dexes_count = dexen.size();
+  occurrences.strings.reserve(candidates.size());
+  occurrences.offsets.reserve(candidates.size() + 1);
+  occurrences.offsets.push_back(0);
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    occurrences.strings.push_back(all_loads[candidates[i].first].str);
+    occurrences.entries.insert(occurrences.entries.end(), rows[i].begin(),
+                               rows[i].end());
+    occurrences.offsets.push_back(occurrences.entries.size());
   }
 
   m_stats.perf_sensitive_strings = perf_sensitive_strings.size();
-  m_stats.non_perf_sensitive_strings = occurrences.size();
-  m_stats.perf_sensitive_insns = (size_t)perf_sensitive_insns;
-  m_stats.non_perf_sensitive_insns = (size_t)non_perf_sensitive_insns;
+  m_stats.non_perf_sensitive_strings = non_perf_sensitive_strings;
+  m_stats.perf_sensitive_insns = perf_sensitive_insns;
+  m_stats.non_perf_sensitive_insns = non_perf_sensitive_insns;
   return occurrences;
 }
 
+size_t DedupStrings::get_min_dex_size_reduction(size_t dexnr) const {
+  // The last threshold applies to all remaining dexes.
+  if (m_min_dex_size_reductions.empty()) {
+    return 0;
+  }
+  return m_min_dex_size_reductions[std::min(
+      dexnr, m_min_dex_size_reductions.size() - 1)];
+}
+
 std::unordered_map<const DexString*, DedupStrings::DedupStringInfo>
 DedupStrings::get_strings_to_dedup(
-    DexClassesVector& dexen,
-    const ConcurrentMap<const DexString*, std::unordered_map<size_t, size_t>>&
-        occurrences,
-    std::unordered_map<const DexMethod*, size_t>& methods_to_dex,
-    std::unordered_set<const DexMethod*>& perf_sensitive_methods,
-    const std::vector<std::unordered_set<const DexString*>>& non_load_strings) {
-  // Use heuristics to determine which strings to dedup, create factory
-  // methods as appropriate, and persist relevant information to aid the later
-  // rewriting of all const-string instructions.
+    const OccurrenceIndex& occurrences,
+    std::vector<std::vector<const DexString*>>* strings_in_dexes) {
+  // Use heuristics to determine which strings to dedup, and in which dex to
+  // host each of them.
 
   std::unordered_map<const DexString*, DedupStrings::DedupStringInfo>
       strings_to_dedup;
 
   // Do a cost/benefit analysis to figure out which strings to access via
   // factory methods, and where to put to the factory method
-  std::vector<std::vector<const DexString*>> strings_in_dexes(dexen.size());
   std::unordered_set<size_t> hosting_dexnrs;
-  std::vector<const DexString*> ordered_strings;
-  ordered_strings.reserve(occurrences.size());
-  for (auto& p : occurrences) {
-    const auto& m = p.second;
-    always_assert(!m.empty());
-    if (m.size() == 1) continue;
-    ordered_strings.push_back(p.first);
-  }
-  std::sort(ordered_strings.begin(), ordered_strings.end(), compare_dexstrings);
-  for (auto* s : ordered_strings) {
+  for (size_t i = 0; i < occurrences.strings.size(); ++i) {
     // We are going to look at the situation of a particular string here
-    const auto& m = occurrences.at_unsafe(s);
-    always_assert(m.size() > 1);
+    const auto* s = occurrences.strings[i];
+    const auto* row_begin =
+        occurrences.entries.data() + occurrences.offsets[i];
+    const auto* row_end =
+        occurrences.entries.data() + occurrences.offsets[i + 1];
     const auto entry_size = s->get_entry_size();
-    const auto get_size_reduction = [entry_size, &non_load_strings](
-                                        const DexString* str, size_t dexnr,
-                                        size_t loads) -> size_t {
-      const auto has_non_load_string = non_load_strings[dexnr].count(str) != 0;
-      if (has_non_load_string) {
+    const auto get_size_reduction =
+        [entry_size](const OccurrenceIndex::Entry& entry) -> size_t {
+      if (entry.non_load) {
         // If there's a non-load string, there's nothing to gain
         return 0;
       }
 
       size_t code_size_increase =
-          loads * (6 /* invoke */ + 2 /* move-result */);
+          entry.loads * (6 /* invoke */ + 2 /* move-result */);
       if (4 + entry_size < code_size_increase) {
         // If the string itself is taking up less space than the code size
         // increase we would incur when referencing the string via a
@@ -441,7 +487,13 @@ DedupStrings::get_strings_to_dedup(
       size_t size_reduction;
     };
     boost::optional<HostInfo> host_info;
-    for (size_t dexnr = 0; dexnr < dexen.size(); ++dexnr) {
+    const auto* it = row_begin;
+    for (size_t dexnr = 0; dexnr < occurrences.dexes_count; ++dexnr) {
+      OccurrenceIndex::Entry entry{(uint32_t)dexnr, 0, false};
+      if (it != row_end && it->dexnr == dexnr) {
+        entry = *it++;
+      }
+
       // There's a configurable limit of how many factory methods / hosts we
       // can have in total
       if (hosting_dexnrs.count(dexnr) == 0 &&
@@ -456,13 +508,11 @@ DedupStrings::get_strings_to_dedup(
         continue;
       }
 
-      // So this dex could host the current string s
-      const auto mit = m.find(dexnr);
-      const auto loads = mit == m.end() ? 0 : mit->second;
+      // So this dex could host the current string s.
       // Figure out what the size reduction would be if this dex would *not*
       // be hosting string s, also considering whether we'd keep around a copy
       // of the string in this dex anyway
-      const auto size_reduction = get_size_reduction(s, dexnr, loads);
+      const auto size_reduction = get_size_reduction(entry);
       if (!host_info || size_reduction < host_info->size_reduction) {
         TRACE(DS, 4,
               "[dedup strings] non perf sensitive string: {%s} dex #%zu can "
@@ -491,16 +541,16 @@ DedupStrings::get_strings_to_dedup(
     size_t total_size_reduction = 0;
     size_t duplicate_string_loads = 0;
     std::unordered_set<size_t> dexes_to_dedup;
-    for (const auto& q : m) {
-      const auto dexnr = q.first;
-      const auto loads = q.second;
-      if (dexnr == hosting_dexnr) {
+    for (const auto* entry = row_begin; entry != row_end; ++entry) {
+      const size_t dexnr = entry->dexnr;
+      const size_t loads = entry->loads;
+      if (loads == 0 || dexnr == hosting_dexnr) {
         continue;
       }
 
-      const auto size_reduction = get_size_reduction(s, dexnr, loads);
+      const auto size_reduction = get_size_reduction(*entry);
 
-      if (non_load_strings[dexnr].count(s) != 0) {
+      if (entry->non_load) {
         always_assert(size_reduction == 0);
         TRACE(DS, 4,
               "[dedup strings] non perf sensitive string: {%s}*%zu is a "
@@ -512,13 +562,12 @@ DedupStrings::get_strings_to_dedup(
         continue;
       }
 
-      if (size_reduction > 0) {
+      if (size_reduction > get_min_dex_size_reduction(dexnr)) {
         duplicate_string_loads += loads;
         total_size_reduction += size_reduction;
         dexes_to_dedup.emplace(dexnr);
       }
     }
-
     const auto hosting_code_size_increase =
         (4 /* switch-target-offset */ + 4 /* const-string */ + 2 /* return */);
 
@@ -554,7 +603,7 @@ DedupStrings::get_strings_to_dedup(
     dedup_string_info.duplicate_string_loads = duplicate_string_loads;
     dedup_string_info.dexes_to_dedup = dexes_to_dedup;
     strings_to_dedup.emplace(s, std::move(dedup_string_info));
-    strings_in_dexes[hosting_dexnr].push_back(s);
+    (*strings_in_dexes)[hosting_dexnr].push_back(s);
 
     TRACE(DS, 3,
           "[dedup strings] non perf sensitive string: {%s} is deduped in %zu "
@@ -565,6 +614,13 @@ DedupStrings::get_strings_to_dedup(
           total_size_reduction - hosting_code_size_increase);
   }
 
+  return strings_to_dedup;
+}
+
+void DedupStrings::make_const_string_loader_methods(
+    DexClassesVector& dexen,
+    std::vector<std::vector<const DexString*>>& strings_in_dexes,
+    std::unordered_map<const DexString*, DedupStringInfo>& strings_to_dedup) {
   // Order strings to give more often used strings smaller indices;
   // generate factory methods; remember details in dedup-info data structure
   for (size_t dexnr = 0; dexnr < dexen.size(); ++dexnr) {
@@ -599,28 +655,22 @@ DedupStrings::get_strings_to_dedup(
       info.index = i;
       info.const_string_method = const_string_method;
     }
-    methods_to_dex.insert({const_string_method, dexnr});
-    perf_sensitive_methods.emplace(const_string_method);
     m_stats.factory_methods++;
   }
 
-  return strings_to_dedup;
 }
 
 void DedupStrings::rewrite_const_string_instructions(
-    const Scope& scope,
-    const std::unordered_map<const DexMethod*, size_t>& methods_to_dex,
-    const std::unordered_set<const DexMethod*>& perf_sensitive_methods,
+    const std::vector<MethodInfo>& methods,
     const std::unordered_map<const DexString*, DedupStrings::DedupStringInfo>&
         strings_to_dedup) {
 
-  walk::parallel::code(
-      scope,
-      [this, &methods_to_dex, &strings_to_dedup,
-       &perf_sensitive_methods](DexMethod* method, IRCode& code) {
-        const auto perf_sensitive_method =
-            perf_sensitive_methods.count(method) != 0;
-        const auto dexnr = methods_to_dex.at(method);
+  workqueue_run_for<size_t>(
+      0, methods.size(), [this, &methods, &strings_to_dedup](size_t i) {
+        auto* method = methods[i].method;
+        auto& code = *method->get_code();
+        const auto perf_sensitive_method = methods[i].perf_sensitive;
+        const auto dexnr = methods[i].dexnr;
         if (m_perf_mode == DedupStringsPerfMode::
                                EXCLUDE_HOT_BLOCKS_IN_HOT_METHODS_OR_CLASSES) {
           if (treat_all_blocks_as_hot(dexnr, method)) {
@@ -742,6 +792,10 @@ void DedupStringsPass::bind_config() {
   bind("method_profiles_appear_percent_threshold",
        default_method_profiles_appear_percent_threshold,
        m_method_profiles_appear_percent_threshold);
+  bind("min_dex_size_reductions", {}, m_min_dex_size_reductions,
+       "For each dex, the size reduction above which the const-string "
+       "instructions of a deduplicated string are rewritten in the dex. The "
+       "last value applies to all remaining dexes.");
   std::string perf_mode_str;
   bind("perf_mode", "exclude-hot-methods-or-classes", perf_mode_str);
 
@@ -776,7 +830,7 @@ void DedupStringsPass::run_pass(DexStoresVector& stores,
 
   DedupStrings ds(m_max_factory_methods,
                   m_method_profiles_appear_percent_threshold, m_perf_mode,
-                  conf.get_method_profiles());
+                  conf.get_method_profiles(), m_min_dex_size_reductions);
   ds.run(stores);
   const auto stats = ds.get_stats();
   mgr.incr_metric(METRIC_PERF_SENSITIVE_STRINGS, stats.perf_sensitive_strings);
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "InterDexPass.h"
 #include "Pass.h"
 #include "PassManager.h"
@@ -48,12 +50,14 @@ class DedupStrings {
   DedupStrings(size_t max_factory_methods,
                float method_profiles_appear_percent_threshold,
                DedupStringsPerfMode perf_mode,
-               const method_profiles::MethodProfiles& method_profiles)
+               const method_profiles::MethodProfiles& method_profiles,
+               std::vector<unsigned int> min_dex_size_reductions = {})
       : m_max_factory_methods(max_factory_methods),
         m_method_profiles_appear_percent_threshold(
             method_profiles_appear_percent_threshold),
         m_perf_mode(perf_mode),
-        m_method_profiles(method_profiles) {}
+        m_method_profiles(method_profiles),
+        m_min_dex_size_reductions(std::move(min_dex_size_reductions)) {}
 
   const Stats& get_stats() const { return m_stats; }
 
@@ -68,34 +72,59 @@ class DedupStrings {
     DexMethod* const_string_method{nullptr};
   };
 
-  std::unordered_map<const DexMethod*, size_t> get_methods_to_dex(
-      const DexClassesVector& dexen);
-  std::unordered_set<const DexMethod*> get_perf_sensitive_methods(
-      const DexClassesVector& dexen);
+  struct MethodInfo {
+    DexMethod* method;
+    size_t dexnr;
+    // Whether the method is in the primary dex or perf sensitive.
+    bool perf_sensitive;
+  };
+
+  /*
+   * For each string loaded outside of perf-sensitive code in more than one
+   * dex, how often it is loaded in each dex, and which dexes reference it
+   * anyway. This is all the cost model needs.
+   */
+  struct OccurrenceIndex {
+    struct Entry {
+      uint32_t dexnr;
+      // The const-string instructions loading the string that could be
+      // rewritten.
+      uint32_t loads;
+      // Whether the dex references the string by some metadata, or by a load
+      // in perf-sensitive code.
+      bool non_load;
+    };
+
+    size_t dexes_count{0};
+    // Sorted by compare_dexstrings.
+    std::vector<const DexString*> strings;
+    // The entries of strings[i] are entries[offsets[i]] to
+    // entries[offsets[i + 1]], sorted by dex. Dexes that neither load nor
+    // reference the string have no entry.
+    std::vector<uint32_t> offsets;
+    std::vector<Entry> entries;
+  };
+
+  // The methods with code of all dexes, ordered by dex.
+  std::vector<MethodInfo> get_methods(const DexClassesVector& dexen);
   DexMethod* make_const_string_loader_method(
       DexClasses& dex,
       size_t dex_id,
       const std::vector<const DexString*>& strings);
   void gather_non_load_strings(DexClasses& classes,
                                std::unordered_set<const DexString*>* strings);
-  ConcurrentMap<const DexString*, std::unordered_map<size_t, size_t>>
-  get_occurrences(
-      const Scope& scope,
-      const std::unordered_map<const DexMethod*, size_t>& methods_to_dex,
-      const std::unordered_set<const DexMethod*>& perf_sensitive_methods,
-      std::vector<std::unordered_set<const DexString*>>& non_load_strings);
+  OccurrenceIndex get_occurrences(DexClassesVector& dexen,
+                                  const std::vector<MethodInfo>& methods);
+  size_t get_min_dex_size_reduction(size_t dexnr) const;
   std::unordered_map<const DexString*, DedupStringInfo> get_strings_to_dedup(
+      const OccurrenceIndex& occurrences,
+      std::vector<std::vector<const DexString*>>* strings_in_dexes);
+  void make_const_string_loader_methods(
       DexClassesVector& dexen,
-      const ConcurrentMap<const DexString*, std::unordered_map<size_t, size_t>>&
-          occurrences,
-      std::unordered_map<const DexMethod*, size_t>& methods_to_dex,
-      std::unordered_set<const DexMethod*>& perf_sensitive_methods,
-      const std::vector<std::unordered_set<const DexString*>>&
-          non_load_strings);
+      std::vector<std::vector<const DexString*>>& strings_in_dexes,
+      std::unordered_map<const DexString*, DedupStringInfo>& strings_to_dedup);
   void rewrite_const_string_instructions(
-      const Scope& scope,
-      const std::unordered_map<const DexMethod*, size_t>& methods_to_dex,
-      const std::unordered_set<const DexMethod*>& perf_sensitive_methods,
+      const std::vector<MethodInfo>& methods,
       const std::unordered_map<const DexString*, DedupStringInfo>&
           strings_to_dedup);
 
@@ -104,6 +133,7 @@ class DedupStrings {
   float m_method_profiles_appear_percent_threshold;
   DedupStringsPerfMode m_perf_mode;
   const method_profiles::MethodProfiles& m_method_profiles;
+  std::vector<unsigned int> m_min_dex_size_reductions;
 };
 
 class DedupStringsPass : public Pass {
@@ -174,6 +204,8 @@ in a decrease in code size:
   - Rewriting a const-string reference into a hosting function invocation
     adds 8 bytes. (Sometimes less, if we can condense a const-string/jumbo,
     or if the new index fits into fewer bits.)
+  - The references from a dex are only rewritten when this saves more than
+    the dex's threshold in `min_dex_size_reductions`, which is 0 by default.
 
 Besides the space savings, there are other perf implications:
 - The string tables shrink; this is probably good, as they likely tend to
@@ -199,5 +231,6 @@ inter-dex pass, but before the replace-gotos-with-returns pass.
   int64_t m_max_factory_methods;
   float m_method_profiles_appear_percent_threshold{1.f};
   DedupStringsPerfMode m_perf_mode;
+  std::vector<unsigned int> m_min_dex_size_reductions;
   std::optional<ReserveRefsInfoHandle> m_reserved_refs_handle;
 };
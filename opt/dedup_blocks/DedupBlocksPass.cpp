@@ -18,6 +18,9 @@ const char* METRIC_INSNS_REMOVED = "insns_removed";
 const char* METRIC_BLOCKS_SPLIT = "blocks_split";
 const char* METRIC_POSITIONS_INSERTED = "positions_inserted";
 const char* METRIC_ELIGIBLE_BLOCKS = "eligible_blocks";
+const char* METRIC_CROSS_METHOD_GROUPS = "cross_method_duplicate_groups";
+const char* METRIC_CROSS_METHOD_BLOCKS = "cross_method_duplicate_blocks";
+const char* METRIC_CROSS_METHOD_INSNS = "cross_method_duplicate_insns";
 } // namespace
 
 void DedupBlocksPass::run_pass(DexStoresVector& stores,
@@ -49,6 +52,11 @@ void DedupBlocksPass::run_pass(DexStoresVector& stores,
       m_config.debug ? 1 : redex_parallel::default_num_threads());
 
   report_stats(mgr, stats);
+
+  if (m_config.cross_method) {
+    report_cross_method_duplicates(
+        mgr, dedup_blocks_impl::find_cross_method_duplicates(&m_config, scope));
+  }
 }
 
 void DedupBlocksPass::report_stats(PassManager& mgr,
@@ -77,4 +85,25 @@ void DedupBlocksPass::report_stats(PassManager& mgr,
   TRACE(DEDUP_BLOCKS, 1, "%d blocks removed", removed);
 }
 
+void DedupBlocksPass::report_cross_method_duplicates(
+    PassManager& mgr, const dedup_blocks_impl::CrossMethodDuplicates& dups) {
+  size_t blocks = 0;
+  size_t insns = 0;
+  for (const auto& group : dups) {
+    blocks += group.size();
+    // All but one copy could be replaced by an invocation of an outlined
+    // method.
+    insns += (group.size() - 1) * group.front().block->num_opcodes();
+    TRACE(DEDUP_BLOCKS, 3,
+          "found %zu duplicate blocks with %u instructions across methods, "
+          "e.g. in %s",
+          group.size(), group.front().block->num_opcodes(),
+          SHOW(group.front().method));
+  }
+  mgr.incr_metric(METRIC_CROSS_METHOD_GROUPS, dups.size());
+  mgr.incr_metric(METRIC_CROSS_METHOD_BLOCKS, blocks);
+  mgr.incr_metric(METRIC_CROSS_METHOD_INSNS, insns);
+  TRACE(DEDUP_BLOCKS, 1, "%zu duplicate blocks across methods", blocks);
+}
+
 static DedupBlocksPass s_pass;
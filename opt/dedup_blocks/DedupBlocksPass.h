@@ -8,6 +8,7 @@
 #pragma once
 
 #include "DedupBlocks.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Pass.h"
 
 class DedupBlocksPass : public Pass {
@@ -27,6 +28,10 @@ class DedupBlocksPass : public Pass {
     };
   }
 
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
   void bind_config() override {
@@ -39,9 +44,15 @@ class DedupBlocksPass : public Pass {
     bind(
         "dedup_fill_in_stack_trace", false, m_config.dedup_fill_in_stack_trace);
     bind("max_iteration", 10, m_config.max_iteration);
+    bind("cross_method", false, m_config.cross_method,
+         "Also find blocks that are duplicated across methods, and report "
+         "them as outlining candidates.");
+    bind("cross_method_min_insns", 3, m_config.cross_method_min_insns);
   }
 
  private:
   void report_stats(PassManager& mgr, const dedup_blocks_impl::Stats& stats);
+  void report_cross_method_duplicates(
+      PassManager& mgr, const dedup_blocks_impl::CrossMethodDuplicates& dups);
   dedup_blocks_impl::Config m_config;
 };
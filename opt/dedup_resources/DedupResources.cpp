@@ -35,6 +35,48 @@ namespace {
 
 constexpr decltype(redex_parallel::default_num_threads()) kReadFileThreads = 4u;
 
+// Content hashes of resource files, keyed by path and validated by file size
+// and modification time, so that files left untouched since an earlier run of
+// the pass in the same process are not read again.
+template <typename HashType>
+class FileHashCache {
+ public:
+  using FileStamp = std::pair<uintmax_t, std::time_t>;
+
+  static FileStamp file_stamp(const std::string& file_path) {
+    boost::system::error_code ec;
+    auto size = boost::filesystem::file_size(file_path, ec);
+    auto time = boost::filesystem::last_write_time(file_path, ec);
+    return {size, time};
+  }
+
+  boost::optional<HashType> lookup(const std::string& file_path,
+                                   const FileStamp& stamp) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(file_path);
+    if (it == m_entries.end() || it->second.first != stamp) {
+      return boost::none;
+    }
+    return it->second.second;
+  }
+
+  void store(const std::string& file_path,
+             const FileStamp& stamp,
+             HashType hash) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries[file_path] = {stamp, hash};
+  }
+
+ private:
+  std::mutex m_mutex;
+  std::unordered_map<std::string, std::pair<FileStamp, HashType>> m_entries;
+};
+
+FileHashCache<uint32_t>& murmur_file_hash_cache() {
+  static FileHashCache<uint32_t> cache;
+  return cache;
+}
+
 template <typename ItemType>
 void print_duplicates(
     const std::vector<std::vector<ItemType>>& duplicates,
@@ -56,37 +98,72 @@ void print_duplicates(
   }
 }
 
+template <typename ItemType>
+void get_bucket_duplicates(
+    const std::unordered_set<ItemType>& disallowed,
+    std::vector<ItemType> bucket,
+    const std::function<bool(const ItemType&, const ItemType&)>&
+        are_identical_fn,
+    std::vector<std::vector<ItemType>>* duplicates) {
+  std::sort(bucket.begin(), bucket.end());
+  std::unordered_set<ItemType> already_duped;
+  for (size_t i = 0; i < bucket.size() - 1; ++i) {
+    ItemType primary_item = bucket[i];
+    if (already_duped.count(primary_item)) {
+      continue;
+    }
+    std::vector<ItemType> sub_duplicates = {primary_item};
+    for (size_t j = i + 1; j < bucket.size(); ++j) {
+      ItemType secondary_item = bucket[j];
+      if (already_duped.count(secondary_item) ||
+          disallowed.count(secondary_item)) {
+        continue;
+      }
+      if (are_identical_fn(primary_item, secondary_item)) {
+        sub_duplicates.push_back(secondary_item);
+        already_duped.emplace(secondary_item);
+      }
+    }
+    if (sub_duplicates.size() > 1) {
+      duplicates->push_back(sub_duplicates);
+    }
+  }
+}
+
+// When num_threads > 1, buckets are checked concurrently, so are_identical_fn
+// must be thread-safe. The result does not depend on the thread count.
 template <typename ItemType>
 void get_duplicates_impl(
     const std::unordered_set<ItemType>& disallowed,
     const std::map<size_t, std::vector<ItemType>>& item_by_hash,
     std::function<bool(const ItemType&, const ItemType&)> are_identical_fn,
-    std::vector<std::vector<ItemType>>* duplicates) {
+    std::vector<std::vector<ItemType>>* duplicates,
+    unsigned int num_threads = 1) {
   // Within hash buckets, compare elements (N^2, but buckets should be small).
+  if (num_threads <= 1) {
+    for (const auto& p : item_by_hash) {
+      get_bucket_duplicates(disallowed, p.second, are_identical_fn,
+                            duplicates);
+    }
+    return;
+  }
+  std::vector<const std::vector<ItemType>*> buckets;
+  buckets.reserve(item_by_hash.size());
   for (const auto& p : item_by_hash) {
-    std::vector<ItemType> bucket = p.second;
-    std::sort(bucket.begin(), bucket.end());
-    std::unordered_set<ItemType> already_duped;
-    for (size_t i = 0; i < bucket.size() - 1; ++i) {
-      ItemType primary_item = bucket[i];
-      if (already_duped.count(primary_item)) {
-        continue;
-      }
-      std::vector<ItemType> sub_duplicates = {primary_item};
-      for (size_t j = i + 1; j < bucket.size(); ++j) {
-        ItemType secondary_item = bucket[j];
-        if (already_duped.count(secondary_item) ||
-            disallowed.count(secondary_item)) {
-          continue;
-        }
-        if (are_identical_fn(primary_item, secondary_item)) {
-          sub_duplicates.push_back(secondary_item);
-          already_duped.emplace(secondary_item);
-        }
-      }
-      if (sub_duplicates.size() > 1) {
-        duplicates->push_back(sub_duplicates);
-      }
+    buckets.push_back(&p.second);
+  }
+  std::vector<std::vector<std::vector<ItemType>>> bucket_duplicates(
+      buckets.size());
+  workqueue_run_for<size_t>(
+      0, buckets.size(),
+      [&](size_t i) {
+        get_bucket_duplicates(disallowed, *buckets[i], are_identical_fn,
+                              &bucket_duplicates[i]);
+      },
+      num_threads);
+  for (auto& vec : bucket_duplicates) {
+    for (auto& sub_duplicates : vec) {
+      duplicates->push_back(std::move(sub_duplicates));
     }
   }
 }
@@ -241,6 +318,7 @@ void compute_res_file_hashes(
     const std::vector<uint32_t>& sorted_res_ids,
     const std::function<HashType(const void* data, size_t size, HashType seed)>&
         hash_fn,
+    FileHashCache<HashType>* cache,
     std::map<size_t, std::vector<std::string>>* hash_to_absolute_paths,
     std::unordered_map<std::string, std::string>*
         absolute_path_to_device_path) {
@@ -271,21 +349,33 @@ void compute_res_file_hashes(
       }
     }
   }
-  std::mutex out_mutex;
-  workqueue_run<std::string>(
-      [&](sparta::WorkerState<std::string>* /* unused */, std::string path) {
+  // Buckets are keyed by content hash and file size, so files of different
+  // sizes never need to be compared byte by byte.
+  std::vector<size_t> keys(tasks.size());
+  workqueue_run_for<size_t>(
+      0, tasks.size(),
+      [&](size_t i) {
+        const auto& path = tasks[i];
+        auto stamp = FileHashCache<HashType>::file_stamp(path);
+        auto cached = cache->lookup(path, stamp);
         HashType hash = 31;
-        redex::read_file_with_contents(path,
-                                       [&](const char* data, size_t size) {
-                                         hash = hash_fn(data, size, hash);
-                                       });
-        {
-          std::unique_lock<std::mutex> lock(out_mutex);
-          (*hash_to_absolute_paths)[hash].push_back(std::move(path));
+        if (cached) {
+          hash = *cached;
+        } else {
+          redex::read_file_with_contents(
+              path, [&](const char* data, size_t size) {
+                hash = hash_fn(data, size, hash);
+              });
+          cache->store(path, stamp, hash);
         }
+        size_t key = hash;
+        boost::hash_combine(key, stamp.first);
+        keys[i] = key;
       },
-      tasks,
       std::min(redex_parallel::default_num_threads(), kReadFileThreads));
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    (*hash_to_absolute_paths)[keys[i]].push_back(std::move(tasks[i]));
+  }
 }
 
 bool compare_files(const std::string& p1, const std::string& p2) {
@@ -312,12 +402,14 @@ void deduplicate_resource_files(PassManager& mgr, const std::string& zip_dir) {
   std::unordered_map<std::string, std::string> absolute_path_to_device_path;
   compute_res_file_hashes<uint32_t>(
       zip_dir, res_table.get(), res_table->sorted_res_ids, murmur_hash3,
-      &hash_to_absolute_paths, &absolute_path_to_device_path);
+      &murmur_file_hash_cache(), &hash_to_absolute_paths,
+      &absolute_path_to_device_path);
 
   std::unordered_set<std::string> do_not_deduplicate;
   std::vector<std::vector<std::string>> duplicates;
-  get_duplicates_impl<std::string>(do_not_deduplicate, hash_to_absolute_paths,
-                                   compare_files, &duplicates);
+  get_duplicates_impl<std::string>(
+      do_not_deduplicate, hash_to_absolute_paths, compare_files, &duplicates,
+      std::min(redex_parallel::default_num_threads(), kReadFileThreads));
   print_duplicates<std::string>(duplicates,
                                 [](const std::string& s) { return s; });
 
@@ -10,13 +10,16 @@
 #include <algorithm>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "DexClass.h"
 #include "DexUtil.h"
+#include "EditableCfgAdapter.h"
 #include "IRInstruction.h"
 #include "PassManager.h"
 #include "ReachableClasses.h"
+#include "ReferenceIndexAnalysisPass.h"
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
@@ -291,19 +294,39 @@ class DelSuper {
         auto it2 = it->second.find(method);
         return it2 == it->second.end() ? nullptr : it2->second;
       };
-      walk::parallel::opcodes(m_scope,
-                              [&](DexMethod* meth, IRInstruction* insn) {
-                                if (opcode::is_an_invoke(insn->opcode())) {
-                                  auto method = insn->get_method()->as_def();
-                                  if (!method) {
-                                    return;
-                                  }
-                                  while (auto* m = get_delmeth(method)) {
-                                    method = m;
-                                  }
-                                  insn->set_method(method);
-                                }
-                              });
+      // Only the callers of deleted methods need to be rewritten.
+      auto index = ReferenceIndexAnalysisPass::get_or_build(mgr, m_scope);
+      std::unordered_set<DexMethod*> callers;
+      for (auto&& [_, map] : m_delmeths) {
+        for (auto&& [meth, super_meth] : map) {
+          auto users = index->methods_referencing(meth);
+          callers.insert(users.begin(), users.end());
+        }
+      }
+      workqueue_run<DexMethod*>(
+          [&](DexMethod* caller) {
+            editable_cfg_adapter::iterate(
+                caller->get_code(), [&](MethodItemEntry& mie) {
+                  auto* insn = mie.insn;
+                  if (opcode::is_an_invoke(insn->opcode())) {
+                    auto method = insn->get_method()->as_def();
+                    if (method) {
+                      while (auto* m = get_delmeth(method)) {
+                        method = m;
+                      }
+                      insn->set_method(method);
+                    }
+                  }
+                  return editable_cfg_adapter::LOOP_CONTINUE;
+                });
+            index->invalidate(caller);
+          },
+          callers);
+      for (auto&& [_, map] : m_delmeths) {
+        for (auto&& [meth, super_meth] : map) {
+          index->remove_method(meth);
+        }
+      }
       auto wq = workqueue_foreach<DexType*>([&](DexType* type) {
         auto& map = m_delmeths.at_unsafe(type);
         auto clazz = type_class(type);
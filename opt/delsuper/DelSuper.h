@@ -7,8 +7,10 @@
 
 #pragma once
 
+#include "AnalysisUsage.h"
 #include "DexClass.h"
 #include "Pass.h"
+#include "ReferenceIndexAnalysisPass.h"
 
 class DelSuperPass : public Pass {
  public:
@@ -23,5 +25,10 @@ class DelSuperPass : public Pass {
     };
   }
 
+  // Rewritten callers are invalidated and deleted methods dropped.
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<ReferenceIndexAnalysisPass>();
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 };
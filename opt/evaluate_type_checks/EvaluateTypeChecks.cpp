@@ -493,8 +493,11 @@ void EvaluateTypeChecksPass::run_pass(DexStoresVector& stores,
                                       ConfigFiles& conf,
                                       PassManager& mgr) {
   auto scope = build_class_scope(stores);
-  init_classes::InitClassesWithSideEffects init_classes_with_side_effects(
-      scope, conf.create_init_class_insns());
+  auto init_classes_with_side_effects_ptr =
+      InitClassesAnalysisPass::get_or_build(mgr, scope,
+                                            conf.create_init_class_insns());
+  const auto& init_classes_with_side_effects =
+      *init_classes_with_side_effects_ptr;
 
   shrinker::ShrinkerConfig shrinker_config;
   shrinker_config.run_const_prop = true;
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "InitClassesAnalysisPass.h"
 #include "Pass.h"
 #include "Shrinker.h"
 
@@ -34,6 +35,10 @@ class EvaluateTypeChecksPass : public Pass {
     };
   }
 
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<InitClassesAnalysisPass>();
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
   // Exposed for testing.
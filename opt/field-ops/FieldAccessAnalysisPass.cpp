@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "FieldAccessAnalysisPass.h"
+
+#include "DexUtil.h"
+#include "PassManager.h"
+#include "Trace.h"
+
+void FieldAccessAnalysisPass::run_pass(DexStoresVector& stores,
+                                       ConfigFiles&,
+                                       PassManager&) {
+  auto scope = build_class_scope(stores);
+  m_result = std::make_shared<field_op_tracker::FieldAccessIndex>(scope);
+}
+
+std::shared_ptr<field_op_tracker::FieldAccessIndex>
+FieldAccessAnalysisPass::get_or_build(PassManager& mgr, const Scope& scope) {
+  auto* analysis = mgr.get_preserved_analysis<FieldAccessAnalysisPass>();
+  if (analysis != nullptr && analysis->get_result() != nullptr) {
+    TRACE(PM, 2, "Reusing preserved field access index");
+    auto result = analysis->get_result();
+    mgr.incr_metric("field_access_methods_reanalyzed", result->update(scope));
+    return result;
+  }
+  return std::make_shared<field_op_tracker::FieldAccessIndex>(scope);
+}
+
+static FieldAccessAnalysisPass s_pass;
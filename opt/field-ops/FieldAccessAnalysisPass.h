@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "AnalysisUsage.h"
+#include "DexClass.h"
+#include "FieldOpTracker.h"
+#include "Pass.h"
+
+/*
+ * Builds the index of all field reads and writes of the program (see
+ * field_op_tracker::FieldAccessIndex) and keeps it around as a preserved
+ * analysis, so that the passes which need field access statistics, or the
+ * methods accessing some fields, don't each have to scan all code.
+ *
+ * The index is brought up to date incrementally by `get_or_build`: only the
+ * methods whose code changed since are analyzed again. Any pass may therefore
+ * declare that it preserves this analysis.
+ */
+class FieldAccessAnalysisPass : public Pass {
+ public:
+  FieldAccessAnalysisPass() : Pass("FieldAccessAnalysisPass", Pass::ANALYSIS) {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {};
+  }
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  std::shared_ptr<field_op_tracker::FieldAccessIndex> get_result() {
+    return m_result;
+  }
+
+  void destroy_analysis_result() override { m_result = nullptr; }
+
+  // Returns the preserved index, updated for the given scope, if there is one,
+  // and a fresh index of the given scope otherwise.
+  static std::shared_ptr<field_op_tracker::FieldAccessIndex> get_or_build(
+      PassManager& mgr, const Scope& scope);
+
+ private:
+  std::shared_ptr<field_op_tracker::FieldAccessIndex> m_result = nullptr;
+};
@@ -316,8 +316,8 @@ class FinalInlineImpl {
     // "sput-object Ljava/lang/CharSequence;" pair. Such pair can cause a
     // libdvm.so abort with "Bogus static initialization".
     if (insn->opcode() == OPCODE_SPUT_OBJECT &&
-        field->get_type() != DexType::get_type("Ljava/lang/String;") &&
-        field->get_type() != DexType::get_type("Ljava/lang/Class;")) {
+        field->get_type() != type::java_lang_String() &&
+        field->get_type() != type::java_lang_Class()) {
       TRACE(FINALINLINE,
             8,
             "Validating: reject SPUT_OBJECT with %s",
@@ -27,6 +27,7 @@
 #include "Timer.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 /*
  * dx-generated class initializers often use verbose bytecode sequences to
@@ -478,7 +479,8 @@ FinalInlinePassV2::Stats inline_final_gets(
     const XStoreRefs* xstores,
     const cp::WholeProgramState& wps,
     const std::unordered_set<const DexType*>& blocklist_types,
-    cp::FieldType field_type) {
+    cp::FieldType field_type,
+    const field_op_tracker::FieldAccessIndex* field_accesses) {
   std::atomic<size_t> inlined_count{0};
   std::atomic<size_t> init_classes{0};
   using namespace shrinker;
@@ -496,7 +498,7 @@ FinalInlinePassV2::Stats inline_final_gets(
                                             shrinker_config, min_sdk)
              : std::nullopt;
 
-  walk::parallel::code(scope, [&](DexMethod* method, IRCode& code) {
+  auto inline_gets = [&](DexMethod* method, IRCode& code) {
     if (field_type == cp::FieldType::STATIC && method::is_clinit(method)) {
       return;
     }
@@ -551,7 +553,31 @@ FinalInlinePassV2::Stats inline_final_gets(
       maybe_shrinker->shrink_method(method);
     }
     inlined_count.fetch_add(replacements);
-  });
+  };
+  if (field_accesses == nullptr) {
+    walk::parallel::code(scope, inline_gets);
+    return {(size_t)inlined_count, (size_t)init_classes};
+  }
+
+  // Only the methods reading a field with a known value can change. Code was
+  // only simplified since the index was last updated, which doesn't add field
+  // reads, so its readers are still a superset of the actual ones.
+  std::unordered_set<DexMethod*> readers;
+  for (const auto& [field, methods] : field_accesses->get_readers()) {
+    if (!blocklist_types.count(field->get_class()) &&
+        !wps.get_field_value(field).is_top()) {
+      readers.insert(methods.begin(), methods.end());
+    }
+  }
+  std::vector<DexMethod*> methods(readers.begin(), readers.end());
+  workqueue_run<DexMethod*>(
+      [&](DexMethod* method) {
+        auto* code = method->get_code();
+        if (code != nullptr) {
+          inline_gets(method, *code);
+        }
+      },
+      methods);
   return {(size_t)inlined_count, (size_t)init_classes};
 }
 
@@ -565,14 +591,16 @@ FinalInlinePassV2::Stats FinalInlinePassV2::run(
     const XStoreRefs* xstores,
     const cp::State& cp_state,
     const Config& config,
-    std::optional<DexStoresVector*> stores) {
+    std::optional<DexStoresVector*> stores,
+    const field_op_tracker::FieldAccessIndex* field_accesses) {
   size_t clinit_cycles = 0;
   auto wps = final_inline::analyze_and_simplify_clinits(
       scope, init_classes_with_side_effects, xstores, config.blocklist_types,
       {}, cp_state, clinit_cycles);
   auto res = inline_final_gets(stores, scope, min_sdk,
                                init_classes_with_side_effects, xstores, wps,
-                               config.blocklist_types, cp::FieldType::STATIC);
+                               config.blocklist_types, cp::FieldType::STATIC,
+                               field_accesses);
   return {res.inlined_count, res.init_classes, clinit_cycles};
 }
 
@@ -585,14 +613,16 @@ FinalInlinePassV2::Stats FinalInlinePassV2::run_inline_ifields(
     const cp::EligibleIfields& eligible_ifields,
     const cp::State& cp_state,
     const Config& config,
-    std::optional<DexStoresVector*> stores) {
+    std::optional<DexStoresVector*> stores,
+    const field_op_tracker::FieldAccessIndex* field_accesses) {
   size_t possible_cycles = 0;
   auto wps = final_inline::analyze_and_simplify_inits(
       scope, init_classes_with_side_effects, xstores, config.blocklist_types,
       eligible_ifields, cp_state, possible_cycles);
   auto ret = inline_final_gets(stores, scope, min_sdk,
                                init_classes_with_side_effects, xstores, wps,
-                               config.blocklist_types, cp::FieldType::INSTANCE);
+                               config.blocklist_types, cp::FieldType::INSTANCE,
+                               field_accesses);
   ret.possible_cycles = possible_cycles;
   return ret;
 }
@@ -606,12 +636,17 @@ void FinalInlinePassV2::run_pass(DexStoresVector& stores,
       "init-class instructions.");
   auto scope = build_class_scope(stores);
   auto min_sdk = mgr.get_redex_options().min_sdk;
-  init_classes::InitClassesWithSideEffects init_classes_with_side_effects(
-      scope, conf.create_init_class_insns());
+  auto init_classes_with_side_effects_ptr =
+      InitClassesAnalysisPass::get_or_build(mgr, scope,
+                                            conf.create_init_class_insns());
+  const auto& init_classes_with_side_effects =
+      *init_classes_with_side_effects_ptr;
+  auto field_accesses = FieldAccessAnalysisPass::get_or_build(mgr, scope);
   XStoreRefs xstores(stores);
   cp::State cp_state;
-  auto sfield_stats = run(scope, min_sdk, init_classes_with_side_effects,
-                          &xstores, cp_state, m_config, &stores);
+  auto sfield_stats =
+      run(scope, min_sdk, init_classes_with_side_effects, &xstores, cp_state,
+          m_config, &stores, field_accesses.get());
   FinalInlinePassV2::Stats ifield_stats{};
   if (m_config.inline_instance_field) {
     cp::EligibleIfields eligible_ifields =
@@ -619,7 +654,7 @@ void FinalInlinePassV2::run_pass(DexStoresVector& stores,
             scope, m_config.allowlist_method_names);
     ifield_stats = run_inline_ifields(
         scope, min_sdk, init_classes_with_side_effects, &xstores,
-        eligible_ifields, cp_state, m_config, &stores);
+        eligible_ifields, cp_state, m_config, &stores, field_accesses.get());
     always_assert(ifield_stats.init_classes == 0);
   }
   mgr.incr_metric("num_static_finals_inlined", sfield_stats.inlined_count);
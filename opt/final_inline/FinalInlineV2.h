@@ -14,7 +14,9 @@
 #include "ConstantPropagationState.h"
 #include "ConstantPropagationWholeProgramState.h"
 #include "DexClass.h"
+#include "FieldAccessAnalysisPass.h"
 #include "IRCode.h"
+#include "InitClassesAnalysisPass.h"
 #include "InitClassesWithSideEffects.h"
 #include "Pass.h"
 
@@ -64,7 +66,9 @@ class FinalInlinePassV2 : public Pass {
                    const XStoreRefs*,
                    const constant_propagation::State& cp_state,
                    const Config& config = Config(),
-                   std::optional<DexStoresVector*> stores = std::nullopt);
+                   std::optional<DexStoresVector*> stores = std::nullopt,
+                   const field_op_tracker::FieldAccessIndex* field_accesses =
+                       nullptr);
   static Stats run_inline_ifields(
       const Scope&,
       int min_sdk,
@@ -74,7 +78,13 @@ class FinalInlinePassV2 : public Pass {
       const constant_propagation::EligibleIfields& eligible_ifields,
       const constant_propagation::State& cp_state,
       const Config& config = Config(),
-      std::optional<DexStoresVector*> stores = std::nullopt);
+      std::optional<DexStoresVector*> stores = std::nullopt,
+      const field_op_tracker::FieldAccessIndex* field_accesses = nullptr);
+
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<InitClassesAnalysisPass>();
+    au.add_preserve_specific<FieldAccessAnalysisPass>();
+  }
 
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
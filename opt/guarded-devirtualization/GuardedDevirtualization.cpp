@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * This pass devirtualizes hot polymorphic call sites speculatively.
+ *
+ * Redex has no receiver type profiles, but the source blocks of method
+ * entries tell us which implementations of a virtual or interface method
+ * were executed at all. When exactly one of a callee's few implementations
+ * was executed, we guard each hot invocation of the callee with a type check
+ * for the class of that implementation:
+ *
+ *   INVOKE_INTERFACE {v0}, LI;.m:()I
+ *   MOVE_RESULT v1
+ *
+ * becomes
+ *
+ *   INSTANCE_OF v0, LA;
+ *   MOVE_RESULT_PSEUDO v2
+ *   IF_NEZ v2, L0
+ *   INVOKE_INTERFACE {v0}, LI;.m:()I
+ *   MOVE_RESULT v1
+ *   L1: ...
+ *
+ *   L0: CHECK_CAST v0, LA;
+ *   MOVE_RESULT_PSEUDO_OBJECT v3
+ *   INVOKE_VIRTUAL {v3}, LA;.m:()I
+ *   MOVE_RESULT v1
+ *   GOTO L1
+ *
+ * The implementation must not be overridden in any subclass of its class, so
+ * that the type check alone determines the target. The fast path then calls
+ * a method without overrides, which the runtime can bind statically and
+ * inline, instead of going through interface or virtual dispatch.
+ *
+ * To keep the rewrite simple, we leave call sites in try regions alone.
+ */
+
+#include "GuardedDevirtualization.h"
+
+#include "ControlFlow.h"
+#include "DexClass.h"
+#include "DexUtil.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "PassManager.h"
+#include "Resolver.h"
+#include "Show.h"
+#include "SourceBlocks.h"
+#include "Trace.h"
+#include "Walkers.h"
+
+namespace {
+
+constexpr const char* METRIC_POLYMORPHIC_CALLEES = "num_polymorphic_callees";
+constexpr const char* METRIC_CALLEES_WITH_DOMINANT_TARGET =
+    "num_callees_with_dominant_target";
+constexpr const char* METRIC_GUARDED_CALL_SITES = "num_guarded_call_sites";
+
+bool is_hot(const SourceBlock* sb) {
+  if (sb == nullptr) {
+    return false;
+  }
+  return sb->foreach_val_early(
+      [](const auto& val) { return val && val->val > 0.0f; });
+}
+
+bool is_devirtualizable_invoke(const IRInstruction* insn) {
+  return insn->opcode() == OPCODE_INVOKE_VIRTUAL ||
+         insn->opcode() == OPCODE_INVOKE_INTERFACE;
+}
+
+// Splits the block around the invocation, and adds the type check and the
+// direct fast path.
+void guard_invoke(cfg::ControlFlowGraph& cfg,
+                  IRInstruction* insn,
+                  const DexMethod* target) {
+  auto it = cfg.find_insn(insn);
+  auto* call_block = it.block();
+  auto move_result_it = cfg.move_result_of(it);
+  auto* sb = source_blocks::get_last_source_block_before(call_block,
+                                                        it.unwrap());
+
+  auto* check_block = cfg.split_block_before(it);
+  if (cfg.entry_block() == call_block) {
+    cfg.set_entry_block(check_block);
+  }
+  auto* join_block =
+      cfg.split_block(move_result_it.is_end() ? it : move_result_it);
+
+  auto* target_type = target->get_class();
+  auto receiver = cfg.allocate_temp();
+  auto* fast_block = cfg.create_block();
+  if (sb != nullptr) {
+    auto sb_copy = std::make_unique<SourceBlock>(*sb);
+    sb_copy->next = nullptr;
+    fast_block->insert_before(fast_block->end(), std::move(sb_copy));
+  }
+  fast_block->push_back(
+      (new IRInstruction(OPCODE_CHECK_CAST))
+          ->set_type(target_type)
+          ->set_src(0, insn->src(0)));
+  fast_block->push_back(
+      (new IRInstruction(IOPCODE_MOVE_RESULT_PSEUDO_OBJECT))
+          ->set_dest(receiver));
+  auto* fast_invoke = new IRInstruction(OPCODE_INVOKE_VIRTUAL);
+  fast_invoke->set_method(const_cast<DexMethod*>(target))
+      ->set_srcs_size(insn->srcs_size());
+  fast_invoke->set_src(0, receiver);
+  for (size_t i = 1; i < insn->srcs_size(); i++) {
+    fast_invoke->set_src(i, insn->src(i));
+  }
+  fast_block->push_back(fast_invoke);
+  if (!move_result_it.is_end()) {
+    fast_block->push_back(new IRInstruction(*move_result_it->insn));
+  }
+  cfg.add_edge(fast_block, join_block, cfg::EDGE_GOTO);
+
+  auto is_instance = cfg.allocate_temp();
+  check_block->push_back((new IRInstruction(OPCODE_INSTANCE_OF))
+                             ->set_type(target_type)
+                             ->set_src(0, insn->src(0)));
+  check_block->push_back(
+      (new IRInstruction(IOPCODE_MOVE_RESULT_PSEUDO))->set_dest(is_instance));
+  cfg.create_branch(check_block,
+                    (new IRInstruction(OPCODE_IF_NEZ))->set_src(0, is_instance),
+                    /* fls */ nullptr, fast_block);
+}
+
+} // namespace
+
+const DexMethod* GuardedDevirtualizationPass::find_dominant_target(
+    const method_override_graph::Graph& graph,
+    const DexMethod* callee,
+    size_t max_implementations,
+    Stats* stats) {
+  if (!callee->is_virtual()) {
+    return nullptr;
+  }
+  std::vector<const DexMethod*> implementations;
+  auto overriding_methods =
+      method_override_graph::get_overriding_methods(graph, callee);
+  overriding_methods.push_back(callee);
+  for (auto* method : overriding_methods) {
+    if (is_abstract(method)) {
+      continue;
+    }
+    if (method->get_code() == nullptr) {
+      // We know nothing about how often external or native implementations
+      // run.
+      return nullptr;
+    }
+    implementations.push_back(method);
+  }
+  if (implementations.size() < 2) {
+    return nullptr;
+  }
+  stats->polymorphic_callees++;
+  if (implementations.size() > max_implementations) {
+    return nullptr;
+  }
+
+  const DexMethod* dominant{nullptr};
+  for (auto* method : implementations) {
+    if (!is_hot(source_blocks::get_first_source_block_of_method(method))) {
+      continue;
+    }
+    if (dominant != nullptr) {
+      return nullptr;
+    }
+    dominant = method;
+  }
+  if (dominant == nullptr || !is_public(dominant)) {
+    return nullptr;
+  }
+  auto* cls = type_class(dominant->get_class());
+  if (cls == nullptr || cls->is_external() || is_interface(cls) ||
+      !is_public(cls) ||
+      method_override_graph::any_overriding_methods(graph, dominant)) {
+    return nullptr;
+  }
+  stats->callees_with_dominant_target++;
+  return dominant;
+}
+
+GuardedDevirtualizationPass::Stats GuardedDevirtualizationPass::process_code(
+    const DominantTargets& dominant_targets, IRCode* code) {
+  Stats stats;
+  always_assert(code->editable_cfg_built());
+  auto& cfg = code->cfg();
+  std::vector<std::pair<IRInstruction*, const DexMethod*>> call_sites;
+  for (auto* block : cfg.blocks()) {
+    if (cfg.get_succ_edge_of_type(block, cfg::EDGE_THROW) != nullptr) {
+      continue;
+    }
+    for (auto it = block->begin(); it != block->end(); ++it) {
+      if (it->type != MFLOW_OPCODE || !is_devirtualizable_invoke(it->insn)) {
+        continue;
+      }
+      auto* insn = it->insn;
+      auto* callee = resolve_method(insn->get_method(), opcode_to_search(insn));
+      if (callee == nullptr) {
+        continue;
+      }
+      auto target_it = dominant_targets.find(callee);
+      if (target_it == dominant_targets.end() ||
+          !is_hot(source_blocks::get_last_source_block_before(block, it))) {
+        continue;
+      }
+      call_sites.emplace_back(insn, target_it->second);
+    }
+  }
+  for (auto& [insn, target] : call_sites) {
+    TRACE(VIRT, 4, "[guarded-devirt] guarding %s with %s", SHOW(insn),
+          SHOW(target));
+    guard_invoke(cfg, insn, target);
+    stats.guarded_call_sites++;
+  }
+  return stats;
+}
+
+void GuardedDevirtualizationPass::run_pass(DexStoresVector& stores,
+                                           ConfigFiles&,
+                                           PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  auto graph = MethodOverrideGraphAnalysisPass::get_or_build(mgr, scope);
+
+  Stats stats;
+  DominantTargets dominant_targets;
+  walk::methods(scope, [&](DexMethod* method) {
+    auto* target = find_dominant_target(*graph, method,
+                                        m_max_implementations, &stats);
+    if (target != nullptr) {
+      dominant_targets.emplace(method, target);
+    }
+  });
+
+  if (!dominant_targets.empty()) {
+    stats += walk::parallel::methods<Stats>(scope, [&](DexMethod* method) {
+      const auto code = method->get_code();
+      if (!code || method->rstate.no_optimizations()) {
+        return Stats{};
+      }
+      return process_code(dominant_targets, code);
+    });
+  }
+  mgr.incr_metric(METRIC_POLYMORPHIC_CALLEES, stats.polymorphic_callees);
+  mgr.incr_metric(METRIC_CALLEES_WITH_DOMINANT_TARGET,
+                  stats.callees_with_dominant_target);
+  mgr.incr_metric(METRIC_GUARDED_CALL_SITES, stats.guarded_call_sites);
+  TRACE(VIRT, 1,
+        "[guarded-devirt] Guarded %zu call sites of %zu out of %zu polymorphic "
+        "callees",
+        stats.guarded_call_sites, stats.callees_with_dominant_target,
+        stats.polymorphic_callees);
+}
+
+static GuardedDevirtualizationPass s_pass;
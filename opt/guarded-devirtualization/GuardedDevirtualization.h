@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <unordered_map>
+
+#include "MethodOverrideGraphAnalysisPass.h"
+#include "Pass.h"
+
+class IRCode;
+
+class GuardedDevirtualizationPass : public Pass {
+ public:
+  struct Stats {
+    size_t polymorphic_callees{0};
+    size_t callees_with_dominant_target{0};
+    size_t guarded_call_sites{0};
+
+    Stats& operator+=(const Stats& that) {
+      polymorphic_callees += that.polymorphic_callees;
+      callees_with_dominant_target += that.callees_with_dominant_target;
+      guarded_call_sites += that.guarded_call_sites;
+      return *this;
+    }
+  };
+
+  // Maps resolved virtual or interface methods to the implementation that
+  // profiled executions dispatch to.
+  using DominantTargets =
+      std::unordered_map<const DexMethod*, const DexMethod*>;
+
+  GuardedDevirtualizationPass() : Pass("GuardedDevirtualizationPass") {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {
+        {DexLimitsObeyed, Preserves},
+        {NoResolvablePureRefs, Preserves},
+        {InitialRenameClass, Preserves},
+    };
+  }
+
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+  }
+
+  void bind_config() override {
+    bind("max_implementations", m_max_implementations, m_max_implementations,
+         "Callees with more implementations than this are left alone.");
+  }
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  /*
+   * Picks the implementation of a polymorphic callee that profiled executions
+   * dispatch to, if only one of a small number of implementations was ever
+   * executed and a type check can select it.
+   */
+  static const DexMethod* find_dominant_target(
+      const method_override_graph::Graph& graph,
+      const DexMethod* callee,
+      size_t max_implementations,
+      Stats* stats);
+
+  /*
+   * Guards hot invocations of callees with a dominant target with an
+   * instance-of check, calling the dominant target with an invoke-virtual
+   * on its own class when the check succeeds. The code must have an
+   * editable cfg.
+   */
+  static Stats process_code(const DominantTargets& dominant_targets,
+                            IRCode* code);
+
+ private:
+  size_t m_max_implementations{4};
+};
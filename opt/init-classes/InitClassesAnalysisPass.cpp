@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "InitClassesAnalysisPass.h"
+
+#include "ConfigFiles.h"
+#include "DexUtil.h"
+#include "PassManager.h"
+#include "Trace.h"
+
+void InitClassesAnalysisPass::run_pass(DexStoresVector& stores,
+                                       ConfigFiles& conf,
+                                       PassManager&) {
+  auto scope = build_class_scope(stores);
+  m_result = std::make_shared<init_classes::InitClassesWithSideEffects>(
+      scope, conf.create_init_class_insns());
+}
+
+std::shared_ptr<init_classes::InitClassesWithSideEffects>
+InitClassesAnalysisPass::get_or_build(
+    PassManager& mgr,
+    const Scope& scope,
+    bool create_init_class_insns,
+    const method_override_graph::Graph* method_override_graph) {
+  auto* analysis = mgr.get_preserved_analysis<InitClassesAnalysisPass>();
+  if (analysis != nullptr && analysis->get_result() != nullptr &&
+      analysis->get_result()->create_init_class_insns() ==
+          create_init_class_insns) {
+    TRACE(PM, 2, "Reusing preserved init classes with side effects");
+    auto result = analysis->get_result();
+    mgr.incr_metric("init_classes_recomputed",
+                    result->update(scope, method_override_graph));
+    return result;
+  }
+  return std::make_shared<init_classes::InitClassesWithSideEffects>(
+      scope, create_init_class_insns, method_override_graph);
+}
+
+static InitClassesAnalysisPass s_pass;
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "AnalysisUsage.h"
+#include "DexClass.h"
+#include "InitClassesWithSideEffects.h"
+#include "Pass.h"
+
+/*
+ * Computes which static initializers with side effects get triggered when a
+ * class is initialized, and keeps the result around as a preserved analysis,
+ * so that the passes which need it don't each have to analyze all static
+ * initializers again.
+ *
+ * The result is brought up to date incrementally by `get_or_build`: only the
+ * classes whose static initializers (or the code they call) or superclass
+ * chains changed since are analyzed again. Any pass may therefore declare that
+ * it preserves this analysis.
+ */
+class InitClassesAnalysisPass : public Pass {
+ public:
+  InitClassesAnalysisPass() : Pass("InitClassesAnalysisPass", Pass::ANALYSIS) {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {};
+  }
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  std::shared_ptr<init_classes::InitClassesWithSideEffects> get_result() {
+    return m_result;
+  }
+
+  void destroy_analysis_result() override { m_result = nullptr; }
+
+  // Returns the preserved result, updated for the given scope, if there is one
+  // that was built with the same `create_init_class_insns`, and a fresh result
+  // for the given scope otherwise.
+  static std::shared_ptr<init_classes::InitClassesWithSideEffects>
+  get_or_build(
+      PassManager& mgr,
+      const Scope& scope,
+      bool create_init_class_insns,
+      const method_override_graph::Graph* method_override_graph = nullptr);
+
+ private:
+  std::shared_ptr<init_classes::InitClassesWithSideEffects> m_result = nullptr;
+};
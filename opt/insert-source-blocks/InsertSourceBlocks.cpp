@@ -12,9 +12,12 @@
 #include <cstdint>
 #include <deque>
 #include <fstream>
+#include <functional>
 #include <iterator>
 #include <mutex>
+#include <optional>
 #include <string_view>
+#include <tuple>
 
 #include <boost/format.hpp>
 
@@ -250,10 +253,14 @@ is_traditional_access_method(const DexMethodRef* mref) {
 struct ProfileFile {
   RedexMappedFile mapped_file;
   std::string interaction;
+  // Where the lines of methods start, after the header.
+  size_t body_pos;
 
   using StringPos = std::pair<size_t, size_t>;
 
-  using MethodMeta = std::unordered_map<const DexMethodRef*, StringPos>;
+  // Sorted by method, see find_method. Much more compact than a hash map for
+  // the millions of methods of a large profile.
+  using MethodMeta = std::vector<std::pair<const DexMethodRef*, StringPos>>;
   MethodMeta method_meta;
 
   using UnresolvedMethods = std::unordered_set<std::string_view>;
@@ -266,26 +273,45 @@ struct ProfileFile {
 
   AccessMethods access_methods;
 
+  // The methods of a range of lines, in the order of the file.
+  struct Chunk {
+    MethodMeta methods;
+    std::vector<std::string_view> unresolved_methods;
+    std::vector<std::tuple<const DexType*, std::string_view, StringPos>>
+        access_methods;
+  };
+
   ProfileFile(RedexMappedFile mapped_file,
               std::string interaction,
-              MethodMeta method_meta,
-              UnresolvedMethods unresolved_methods,
-              AccessMethods access_methods)
+              size_t body_pos)
       : mapped_file(std::move(mapped_file)),
         interaction(std::move(interaction)),
-        method_meta(std::move(method_meta)),
-        unresolved_methods(std::move(unresolved_methods)),
-        access_methods(std::move(access_methods)) {}
+        body_pos(body_pos) {}
+
+  std::string_view data() const {
+    return {mapped_file.const_data(), mapped_file.size()};
+  }
+
+  std::optional<StringPos> find_method(const DexMethodRef* mref) const {
+    auto it = std::lower_bound(
+        method_meta.begin(), method_meta.end(), mref,
+        [](const auto& p, const DexMethodRef* m) {
+          return std::less<const DexMethodRef*>()(p.first, m);
+        });
+    if (it == method_meta.end() || it->first != mref) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
 
-  static std::unique_ptr<ProfileFile> prepare_profile_file(
+  // Maps the file and reads its header. The lines of methods are read
+  // separately, see parse_lines.
+  static std::unique_ptr<ProfileFile> open(
       const std::string& profile_file_name) {
     if (profile_file_name.empty()) {
       return std::unique_ptr<ProfileFile>();
     }
     auto file = RedexMappedFile::open(profile_file_name, /*read_only=*/true);
-    MethodMeta meta;
-    UnresolvedMethods unresolved_methods;
-    AccessMethods access_methods;
 
     std::string_view data{file.const_data(), file.size()};
     size_t pos = 0;
@@ -323,7 +349,35 @@ struct ProfileFile {
       check_components(next_line_fn(), 0, {"name", "profiled_srcblks_exprs"});
     }
 
-    while (pos < data.length()) {
+    return std::make_unique<ProfileFile>(std::move(file),
+                                         std::move(interaction), pos);
+  }
+
+  // Splits the lines of methods into ranges of about `chunk_size` bytes which
+  // start and end at line boundaries.
+  std::vector<std::pair<size_t, size_t>> split_lines(size_t chunk_size) const {
+    auto data = this->data();
+    std::vector<std::pair<size_t, size_t>> ranges;
+    size_t begin = body_pos;
+    while (begin < data.length()) {
+      size_t end = std::min(begin + chunk_size, data.length());
+      if (end < data.length()) {
+        end = data.find('\n', end);
+        end = end == std::string::npos ? data.length() : end + 1;
+      }
+      ranges.emplace_back(begin, end);
+      begin = end;
+    }
+    return ranges;
+  }
+
+  // Resolves the methods of the lines in [begin, end). Only reads the file and
+  // the RedexContext, so chunks of a file can be parsed in parallel.
+  Chunk parse_lines(size_t begin, size_t end) const {
+    auto data = this->data();
+    Chunk chunk;
+    size_t pos = begin;
+    while (pos < end) {
       const size_t src_pos = pos;
 
       // Find the next '\n' or EOF.
@@ -333,8 +387,7 @@ struct ProfileFile {
       }
       pos = linefeed_pos + 1;
       // Do not use pos anymore! Ensure by scope from lambda.
-      [&data, &src_pos, &linefeed_pos, &meta, &unresolved_methods,
-       &access_methods]() {
+      [&data, &src_pos, &linefeed_pos, &chunk]() {
         size_t comma_pos = data.find(',', src_pos);
         always_assert(comma_pos < linefeed_pos);
 
@@ -348,8 +401,8 @@ struct ProfileFile {
           if (access_class != nullptr) {
             TRACE(METH_PROF, 7, "Found access method %s",
                   std::string(method_view).c_str());
-            access_methods[access_class].emplace(access_val->second,
-                                                 string_pos);
+            chunk.access_methods.emplace_back(access_class, access_val->second,
+                                              string_pos);
             return;
           }
           TRACE(METH_PROF,
@@ -364,18 +417,47 @@ struct ProfileFile {
                 6,
                 "failed to resolve %s",
                 std::string(method_view).c_str());
-          unresolved_methods.insert(method_view);
+          chunk.unresolved_methods.push_back(method_view);
           return;
         }
         TRACE(METH_PROF, 7, "Found normal method %s.",
               std::string(method_view).c_str());
-        meta.emplace(mref, string_pos);
+        chunk.methods.emplace_back(mref, string_pos);
       }();
     }
+    return chunk;
+  }
 
-    return std::make_unique<ProfileFile>(
-        std::move(file), std::move(interaction), std::move(meta),
-        std::move(unresolved_methods), std::move(access_methods));
+  // Builds the lookup structures from the parsed chunks of the file, given in
+  // the order of the file. As before, the first line of a method wins.
+  void build_index(std::vector<Chunk>::iterator begin,
+                   std::vector<Chunk>::iterator end) {
+    size_t num_methods = 0;
+    for (auto it = begin; it != end; ++it) {
+      num_methods += it->methods.size();
+    }
+    method_meta.reserve(num_methods);
+    for (auto it = begin; it != end; ++it) {
+      method_meta.insert(method_meta.end(), it->methods.begin(),
+                         it->methods.end());
+      unresolved_methods.insert(it->unresolved_methods.begin(),
+                                it->unresolved_methods.end());
+      for (auto& [access_class, name, string_pos] : it->access_methods) {
+        access_methods[access_class].emplace(name, string_pos);
+      }
+      *it = Chunk();
+    }
+    auto less = [](const auto& lhs, const auto& rhs) {
+      return std::less<const DexMethodRef*>()(lhs.first, rhs.first);
+    };
+    std::stable_sort(method_meta.begin(), method_meta.end(), less);
+    method_meta.erase(
+        std::unique(method_meta.begin(), method_meta.end(),
+                    [](const auto& lhs, const auto& rhs) {
+                      return lhs.first == rhs.first;
+                    }),
+        method_meta.end());
+    method_meta.shrink_to_fit();
   }
 };
 
@@ -503,12 +585,7 @@ struct Injector {
           }
         }
 
-        auto it = profile_file->method_meta.find(mref);
-        if (it != profile_file->method_meta.end()) {
-          return it->second;
-        }
-
-        return std::nullopt;
+        return profile_file->find_method(mref);
       }();
 
       if (!maybe_strpos) {
@@ -670,10 +747,12 @@ struct Injector {
           return InsertResult();
         });
 
-    if (conf.get_global_config()
-            .get_config_by_name<AssessorConfig>("assessor")
-            ->run_sb_consistency) {
-      source_blocks::get_sbcc().initialize(scope);
+    const auto* assessor_config =
+        conf.get_global_config().get_config_by_name<AssessorConfig>(
+            "assessor");
+    if (assessor_config->run_sb_consistency) {
+      source_blocks::get_sbcc().initialize(
+          scope, assessor_config->sb_consistency_sample_every);
     }
 
     mgr.set_metric("inserted_source_blocks", res.blocks);
@@ -818,7 +897,35 @@ struct Injector {
 
       profile_files.resize(files.size());
       workqueue_run_for<size_t>(0, files.size(), [&](size_t i) {
-        profile_files.at(i) = ProfileFile::prepare_profile_file(files.at(i));
+        profile_files.at(i) = ProfileFile::open(files.at(i));
+      });
+
+      // Resolving the methods dominates, so parse all the files in chunks of
+      // lines at once, which also balances the work when a few files are much
+      // larger than the others.
+      constexpr size_t kChunkSize = 1 << 20;
+      std::vector<std::tuple<size_t, size_t, size_t>> ranges;
+      std::vector<size_t> first_chunk(files.size() + 1);
+      for (size_t i = 0; i < files.size(); ++i) {
+        first_chunk[i] = ranges.size();
+        if (profile_files[i]) {
+          for (auto [begin, end] : profile_files[i]->split_lines(kChunkSize)) {
+            ranges.emplace_back(i, begin, end);
+          }
+        }
+      }
+      first_chunk[files.size()] = ranges.size();
+      std::vector<ProfileFile::Chunk> chunks(ranges.size());
+      workqueue_run_for<size_t>(0, ranges.size(), [&](size_t i) {
+        auto [file, begin, end] = ranges[i];
+        chunks[i] = profile_files[file]->parse_lines(begin, end);
+      });
+      workqueue_run_for<size_t>(0, files.size(), [&](size_t i) {
+        if (!profile_files.at(i)) {
+          return;
+        }
+        profile_files.at(i)->build_index(chunks.begin() + first_chunk[i],
+                                         chunks.begin() + first_chunk[i + 1]);
         TRACE(METH_PROF, 1, "Loaded basic block profile %s",
               profile_files.at(i)->interaction.c_str());
       });
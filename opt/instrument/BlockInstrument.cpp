@@ -10,6 +10,7 @@
 #include "ConfigFiles.h"
 #include "DexClass.h"
 #include "DexUtil.h"
+#include "Dominators.h"
 #include "GraphUtil.h"
 #include "Inliner.h"
 #include "LoopInfo.h"
@@ -55,6 +56,9 @@ enum class BlockType {
   Catch = 1 << 4,
   MoveException = 1 << 5,
   NoSourceBlock = 1 << 6,
+  // Control equivalent to a later instrumented block, see
+  // merge_equivalent_blocks.
+  Equivalent = 1 << 7,
 };
 
 enum class InstrumentedType {
@@ -146,6 +150,15 @@ std::ostream& operator<<(std::ostream& os, const BlockType& bt) {
     type = type ^ BlockType::NoSourceBlock;
   }
 
+  if ((type & BlockType::Equivalent) == BlockType::Equivalent) {
+    if (written) {
+      os << ",";
+    }
+    os << "Equivalent";
+    written = true;
+    type = type ^ BlockType::Equivalent;
+  }
+
   if (type != BlockType::Unspecified) {
     if (written) {
       os << ",";
@@ -229,6 +242,7 @@ struct MethodInfo {
   size_t num_empty_blocks = 0;
   size_t num_useless_blocks = 0;
   size_t num_no_source_blocks = 0;
+  size_t num_equivalent_blocks = 0;
   size_t num_blocks_too_large = 0;
   size_t num_catches = 0;
   size_t num_instrumented_catches = 0;
@@ -253,6 +267,7 @@ struct MethodInfo {
     num_empty_blocks += rhs.num_empty_blocks;
     num_useless_blocks += rhs.num_useless_blocks;
     num_no_source_blocks += rhs.num_no_source_blocks;
+    num_equivalent_blocks += rhs.num_equivalent_blocks;
     num_blocks_too_large += rhs.num_blocks_too_large;
     num_catches += rhs.num_catches;
     num_instrumented_catches += rhs.num_instrumented_catches;
@@ -1078,8 +1093,71 @@ void create_block_info(
                                 BlockType::Instrumentable | type, insert_pos});
 }
 
+// A block A that dominates a block B which post-dominates it executes exactly
+// as often as B, when both are in the same loop. So it is enough to set B's bit
+// and attribute it to A's source blocks as well, which is what the offline
+// decoding of the metadata does for merged blocks. Following Ball and Larus,
+// this keeps one instrumented block per class of control equivalent blocks,
+// the last one, so that a set bit always implies that all its blocks ran. The
+// other way round, an exception that leaves the method between A and B is
+// not seen in A.
+void merge_equivalent_blocks(
+    cfg::ControlFlowGraph& cfg,
+    const std::unordered_map<const cfg::Block*, BlockInfo*>& block_mapping,
+    const std::vector<cfg::Block*>& blocks) {
+  std::unordered_map<const cfg::Block*, BlockInfo*> targets;
+  cfg.calculate_exit_block();
+  {
+    dominators::CfgDominators doms(cfg);
+    dominators::CfgPostDominators post_doms(cfg);
+    auto dominates = [&](cfg::Block* a, cfg::Block* b) {
+      while (b != a) {
+        auto* idom = doms.get_idom(b);
+        if (idom == b) {
+          return false;
+        }
+        b = idom;
+      }
+      return true;
+    };
+    for (auto* block : blocks) {
+      auto* info = block_mapping.at(block);
+      auto* post_dom = post_doms.get_idom(block);
+      auto it = block_mapping.find(post_dom);
+      if (!info->is_instrumentable() || post_dom == block ||
+          it == block_mapping.end() || !it->second->is_instrumentable() ||
+          it->second->loop != info->loop || !dominates(block, post_dom)) {
+        continue;
+      }
+      targets.emplace(block, it->second);
+    }
+  }
+  cfg.reset_exit_block();
+
+  for (auto* block : blocks) {
+    auto it = targets.find(block);
+    if (it == targets.end()) {
+      continue;
+    }
+    auto* target = it->second;
+    for (auto next = targets.find(target->block); next != targets.end();
+         next = targets.find(target->block)) {
+      target = next->second;
+    }
+    auto* info = block_mapping.at(block);
+    TRACE(INSTRUMENT, 9, "Merging equivalent block B%zu into B%zu", block->id(),
+          target->block->id());
+    target->merge_in.push_back(block);
+    target->merge_in.insert(target->merge_in.end(), info->merge_in.begin(),
+                            info->merge_in.end());
+    info->merge_in.clear();
+    info->type = BlockType::Equivalent;
+    info->it = std::nullopt;
+  }
+}
+
 auto get_blocks_to_instrument(const DexMethod* m,
-                              const cfg::ControlFlowGraph& cfg,
+                              cfg::ControlFlowGraph& cfg,
                               const size_t max_num_blocks,
                               const InstrumentPass::Options& options) {
   // Collect basic blocks in the order of the source blocks (DFS).
@@ -1107,7 +1185,6 @@ auto get_blocks_to_instrument(const DexMethod* m,
 
   loop_impl::LoopInfo LI(cfg);
 
-  // Future work: Pick minimal instrumentation candidates.
   std::vector<BlockInfo> block_info_list;
   block_info_list.reserve(blocks.size());
   std::unordered_map<const cfg::Block*, BlockInfo*> block_mapping;
@@ -1116,10 +1193,16 @@ auto get_blocks_to_instrument(const DexMethod* m,
     block_mapping[b] = &block_info_list.back();
   }
 
+  for (cfg::Block* b : blocks) {
+    create_block_info(m, b, options, block_mapping);
+  }
+  if (options.merge_equivalent_blocks) {
+    merge_equivalent_blocks(cfg, block_mapping, blocks);
+  }
+
   BitId id = 0;
   size_t hit_id = 0;
   for (cfg::Block* b : blocks) {
-    create_block_info(m, b, options, block_mapping);
     auto* info = block_mapping[b];
     if ((info->type & BlockType::Instrumentable) == BlockType::Instrumentable) {
       if (id >= max_num_blocks) {
@@ -1401,6 +1484,7 @@ MethodInfo instrument_basic_blocks(
   info.num_empty_blocks = count(BlockType::Empty);
   info.num_useless_blocks = count(BlockType::Useless);
   info.num_no_source_blocks = count(BlockType::NoSourceBlock);
+  info.num_equivalent_blocks = count(BlockType::Equivalent);
   info.num_blocks_too_large = too_many_blocks ? info.num_non_entry_blocks : 0;
   info.num_catches =
       count(BlockType::Catch) - count(BlockType::Catch | BlockType::Useless);
@@ -1427,7 +1511,8 @@ MethodInfo instrument_basic_blocks(
 
   const size_t num_rejected_blocks =
       info.num_empty_blocks + info.num_useless_blocks +
-      info.num_no_source_blocks + info.num_blocks_too_large +
+      info.num_no_source_blocks + info.num_equivalent_blocks +
+      info.num_blocks_too_large +
       (info.num_catches - info.num_instrumented_catches);
   always_assert(info.num_non_entry_blocks ==
                 info.num_instrumented_blocks + num_rejected_blocks);
@@ -1679,6 +1764,12 @@ void print_stats(ScopedMetrics& sm,
       TRACE(INSTRUMENT, 4, "- Skipped useless blocks: %s",
             SHOW(print_ratio(useless_blocks)));
       metric_ratio("useless_blocks", useless_blocks);
+      auto equivalent_blocks = std::accumulate(
+          instrumented_methods.begin(), instrumented_methods.end(), size_t(0),
+          [](size_t a, auto&& i) { return a + i.num_equivalent_blocks; });
+      TRACE(INSTRUMENT, 4, "- Skipped control equivalent blocks: %s",
+            SHOW(print_ratio(equivalent_blocks)));
+      metric_ratio("equivalent_blocks", equivalent_blocks);
     }
   }
 
@@ -1792,6 +1883,10 @@ void print_stats(ScopedMetrics& sm,
 //                                                     |   Return              |
 //                                                     +-----------------------+
 //
+// With `merge_equivalent_blocks`, block1 and block2 above are control
+// equivalent: block1 dominates block2, which post-dominates block1. Only block2
+// then gets a bit, which the metadata maps to the source blocks of both.
+//
 // This instrumentation includes the method tracing by inserting onMethodBegin.
 // We currently don't instrument methods with large number of basic blocks. In
 // this case, they are only instrumented for method tracing.
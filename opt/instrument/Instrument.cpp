@@ -146,6 +146,10 @@ void do_simple_method_tracing(DexClass* analysis_cls,
 
   // Write meta info of the meta file: the type of the meta file and version.
   ofs << "#,simple-method-tracing,1.0" << std::endl;
+  const bool sampled = options.sampling_rate > 1;
+  if (sampled) {
+    ofs << "#,sampling-rate," << options.sampling_rate << std::endl;
+  }
 
   size_t method_id = 0;
   size_t excluded = 0;
@@ -329,13 +333,27 @@ void do_simple_method_tracing(DexClass* analysis_cls,
   always_assert(field != nullptr);
   InstrumentPass::patch_static_field(
       analysis_cls, field->get_name()->str(),
-      static_cast<int>(ProfileTypeFlags::SimpleMethodTracing));
+      static_cast<int>(sampled ? ProfileTypeFlags::SampledMethodTracing
+                               : ProfileTypeFlags::SimpleMethodTracing));
+
+  // The countdown itself lives in the analysis class, so that the check stays
+  // out of the instrumented methods and each thread counts without
+  // contention.
+  if (sampled) {
+    field = analysis_cls->find_field_from_simple_deobfuscated_name(
+        "sSamplingRate");
+    always_assert_log(field != nullptr,
+                      "Sampling requires sSamplingRate in the analysis class");
+    InstrumentPass::patch_static_field(analysis_cls, field->get_name()->str(),
+                                       options.sampling_rate);
+  }
 
   ofs.close();
   TRACE(INSTRUMENT, 2, "Index file was written to: %s", SHOW(file_name));
 
   pm.incr_metric("Instrumented", method_id);
   pm.incr_metric("Excluded", excluded);
+  pm.incr_metric("SamplingRate", options.sampling_rate);
 }
 
 std::unordered_set<std::string> load_blocklist_file(
@@ -527,6 +545,12 @@ void InstrumentPass::bind_config() {
        m_options.metadata_file_name);
   bind("num_stats_per_method", 1, m_options.num_stats_per_method);
   bind("num_shards", 1, m_options.num_shards);
+  bind("sampling_rate", 1, m_options.sampling_rate,
+       "For simple method tracing, only record one in this many method "
+       "entries. The analysis class must then declare a `static int "
+       "sSamplingRate`, which is patched with this value, and its analysis "
+       "method must keep a per-thread countdown so that it only records when "
+       "the countdown expires.");
   // Note: only_cold_start_class is only used for block tracing.
   bind("only_cold_start_class", false, m_options.only_cold_start_class);
   bind("methods_replacement", {}, m_options.methods_replacement,
@@ -538,6 +562,9 @@ void InstrumentPass::bind_config() {
   bind("instrument_catches", true, m_options.instrument_catches);
   bind("instrument_blocks_without_source_block", true,
        m_options.instrument_blocks_without_source_block);
+  bind("merge_equivalent_blocks", false, m_options.merge_equivalent_blocks,
+       "Only instrument the last of control equivalent blocks in a loop, "
+       "which implies the execution of the others.");
   bind("instrument_only_root_store", false,
        m_options.instrument_only_root_store);
   bind("inline_onBlockHit", false, m_options.inline_onBlockHit);
@@ -559,6 +586,13 @@ void InstrumentPass::bind_config() {
           !m_options.methods_replacement.empty(),
           "Invalid configuration, `methods_replacement` should not be empty\n");
     }
+    always_assert_log(m_options.sampling_rate >= 1,
+                      "Invalid configuration, `sampling_rate` must be >= 1\n");
+    always_assert_log(
+        m_options.sampling_rate == 1 ||
+            m_options.instrumentation_strategy == SIMPLE_METHOD_TRACING,
+        "Invalid configuration, `sampling_rate` is only supported by %s\n",
+        SIMPLE_METHOD_TRACING);
   });
 }
 
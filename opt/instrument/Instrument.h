@@ -28,7 +28,9 @@ enum class ProfileTypeFlags {
   MethodCallOrder = 2,
   BlockCoverage = 4,
   BlockCount = 8,
+  MethodSampling = 16,
   SimpleMethodTracing = 1 | 2,
+  SampledMethodTracing = 1 | 2 | 16,
   BasicBlockTracing = 1 | 2 | 4,
   BasicBlockHitCount = 1 | 2 | 4 | 8,
 };
@@ -95,12 +97,14 @@ class InstrumentPass : public Pass {
     std::string metadata_file_name;
     int64_t num_stats_per_method;
     int64_t num_shards;
+    int64_t sampling_rate;
     bool only_cold_start_class;
     std::unordered_map<DexMethod*, DexMethod*> methods_replacement;
     std::vector<std::string> analysis_method_names;
     int64_t max_num_blocks;
     bool instrument_catches;
     bool instrument_blocks_without_source_block;
+    bool merge_equivalent_blocks;
     bool instrument_only_root_store;
     bool inline_onBlockHit;
     bool inline_onNonLoopBlockHit;
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ClassLoadTrace.h"
+
+#include <charconv>
+#include <fstream>
+#include <string_view>
+
+#include "Debug.h"
+#include "DexUtil.h"
+#include "Trace.h"
+
+namespace interdex {
+
+size_t ClassLoadTrace::load(std::istream& input,
+                            const ProguardMap& proguard_map) {
+  size_t malformed_lines{0};
+  for (std::string line; std::getline(input, line);) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::string_view rest(line);
+    auto first_tab = rest.find('\t');
+    auto second_tab = first_tab == std::string_view::npos
+                          ? std::string_view::npos
+                          : rest.find('\t', first_tab + 1);
+    if (second_tab == std::string_view::npos) {
+      ++malformed_lines;
+      continue;
+    }
+    auto name = rest.substr(first_tab + 1, second_tab - first_tab - 1);
+    auto ms_str = rest.substr(second_tab + 1);
+    int64_t ms;
+    auto res =
+        std::from_chars(ms_str.data(), ms_str.data() + ms_str.size(), ms);
+    if (name.empty() || res.ec != std::errc() ||
+        res.ptr != ms_str.data() + ms_str.size()) {
+      ++malformed_lines;
+      continue;
+    }
+    std::string descriptor = name.back() == ';'
+                                 ? std::string(name)
+                                 : java_names::external_to_internal(name);
+    auto* type = DexType::get_type(proguard_map.translate_class(descriptor));
+    if (type == nullptr) {
+      continue;
+    }
+    auto [it, emplaced] = m_first_load_ms.emplace(type, ms);
+    if (!emplaced) {
+      it->second = std::min(it->second, ms);
+    }
+  }
+  return malformed_lines;
+}
+
+void ClassLoadTrace::load_file(const std::string& filename,
+                               const ProguardMap& proguard_map) {
+  std::ifstream input(filename);
+  always_assert_log(input, "Can not open class-load trace %s",
+                    filename.c_str());
+  auto malformed_lines = load(input, proguard_map);
+  if (malformed_lines > 0) {
+    TRACE(IDEX, 1, "Ignored %zu malformed lines in class-load trace %s",
+          malformed_lines, filename.c_str());
+  }
+}
+
+std::optional<int64_t> ClassLoadTrace::get_first_load_ms(
+    const DexType* type) const {
+  auto it = m_first_load_ms.find(type);
+  if (it == m_first_load_ms.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+} // namespace interdex
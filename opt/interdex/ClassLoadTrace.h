@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <istream>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "DexClass.h"
+#include "ProguardMap.h"
+
+namespace interdex {
+
+/*
+ * When classes were first loaded while the app ran, as recorded by runtime
+ * class-load instrumentation. Each line of a trace is tab-separated:
+ *
+ *   <interaction id> <class name> <first load, in ms since the app started>
+ *
+ * Class names may be given as Java names or as type descriptors, and are
+ * unobfuscated. Empty lines and lines starting with '#' are ignored.
+ *
+ * A class that was loaded in several interactions, or in several traces, is
+ * considered to be loaded as early as it was loaded in any of them.
+ */
+class ClassLoadTrace {
+ public:
+  // Adds the loads of the given trace. Returns the number of lines that could
+  // not be parsed.
+  size_t load(std::istream& input, const ProguardMap& proguard_map);
+
+  void load_file(const std::string& filename, const ProguardMap& proguard_map);
+
+  // The earliest time at which the class was first loaded, if it was loaded.
+  std::optional<int64_t> get_first_load_ms(const DexType* type) const;
+
+  bool empty() const { return m_first_load_ms.empty(); }
+
+  size_t size() const { return m_first_load_ms.size(); }
+
+ private:
+  std::unordered_map<const DexType*, int64_t> m_first_load_ms;
+};
+
+} // namespace interdex
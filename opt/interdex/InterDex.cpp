@@ -31,6 +31,7 @@
 #include "Show.h"
 #include "StlUtil.h"
 #include "StringUtil.h"
+#include "Timer.h"
 #include "Walkers.h"
 #include "WorkQueue.h"
 #include "file-utils.h"
@@ -409,12 +410,9 @@ InterDex::EmitResult InterDex::emit_class(
 
   // Calculate the extra method and field refs that we would need to add to
   // the current dex if we defined clazz in it.
-  MethodRefs clazz_mrefs;
-  FieldRefs clazz_frefs;
-  TypeRefs clazz_trefs;
-  TypeRefs clazz_itrefs;
-  gather_refs(m_class_references_cache, m_plugins, clazz, &clazz_mrefs,
-              &clazz_frefs, &clazz_trefs, &clazz_itrefs);
+  ClassRefs storage;
+  const auto& [clazz_mrefs, clazz_frefs, clazz_trefs, clazz_itrefs] =
+      get_class_refs(clazz, &storage);
 
   bool fits_current_dex =
       emitting_state.dexes_structure.add_class_to_current_dex(
@@ -1192,6 +1190,45 @@ void InterDex::emit_remaining_classes_exploring_alternatives(
   }
 }
 
+void InterDex::precompute_class_refs() {
+  if (!m_precompute_class_refs) {
+    return;
+  }
+  if (!m_plugins.empty()) {
+    TRACE(IDEX, 2, "IDEX: Not precomputing class refs with plugins");
+    return;
+  }
+  Timer t("precompute_class_refs");
+  // Create all entries upfront, so that the workers only write to their own.
+  std::vector<std::pair<const DexClass*, ClassRefs*>> work;
+  work.reserve(m_scope.size());
+  m_precomputed_class_refs.reserve(m_scope.size());
+  for (auto* cls : m_scope) {
+    auto [it, emplaced] = m_precomputed_class_refs.emplace(cls, ClassRefs());
+    if (emplaced) {
+      work.emplace_back(cls, &it->second);
+    }
+  }
+  workqueue_run<std::pair<const DexClass*, ClassRefs*>>(
+      [&](const std::pair<const DexClass*, ClassRefs*>& p) {
+        auto* refs = p.second;
+        gather_refs(m_class_references_cache, m_plugins, p.first, &refs->mrefs,
+                    &refs->frefs, &refs->trefs, &refs->itrefs);
+      },
+      work);
+}
+
+const InterDex::ClassRefs& InterDex::get_class_refs(const DexClass* cls,
+                                                    ClassRefs* storage) const {
+  auto it = m_precomputed_class_refs.find(cls);
+  if (it != m_precomputed_class_refs.end()) {
+    return it->second;
+  }
+  gather_refs(m_class_references_cache, m_plugins, cls, &storage->mrefs,
+              &storage->frefs, &storage->trefs, &storage->itrefs);
+  return *storage;
+}
+
 void InterDex::run_in_force_single_dex_mode() {
   auto scope = build_class_scope(m_dexen);
 
@@ -1210,12 +1247,9 @@ void InterDex::run_in_force_single_dex_mode() {
   // force_single_dex is on. The overflow checking will be done later on at
   // the end of the pipeline (e.g. write_classes_to_dex).
   for (DexClass* cls : scope) {
-    MethodRefs clazz_mrefs;
-    FieldRefs clazz_frefs;
-    TypeRefs clazz_trefs;
-    TypeRefs clazz_itrefs;
-    gather_refs(m_class_references_cache, m_plugins, cls, &clazz_mrefs,
-                &clazz_frefs, &clazz_trefs, &clazz_itrefs);
+    ClassRefs storage;
+    const auto& [clazz_mrefs, clazz_frefs, clazz_trefs, clazz_itrefs] =
+        get_class_refs(cls, &storage);
 
     m_emitting_state.dexes_structure.add_class_no_checks(
         clazz_mrefs, clazz_frefs, clazz_trefs, clazz_itrefs, cls);
@@ -1235,6 +1269,7 @@ void InterDex::run_in_force_single_dex_mode() {
 
 void InterDex::run() {
   TRACE(IDEX, 2, "IDEX: Running on root store");
+  precompute_class_refs();
   if (m_force_single_dex) {
     run_in_force_single_dex_mode();
     return;
@@ -1399,6 +1434,7 @@ void InterDex::run() {
 
 void InterDex::run_on_nonroot_store() {
   TRACE(IDEX, 2, "IDEX: Running on non-root store");
+  precompute_class_refs();
   auto canary_cls = get_canary_cls(m_emitting_state, EMPTY_DEX_INFO);
   for (DexClass* cls : m_scope) {
     emit_class(m_emitting_state, EMPTY_DEX_INFO, cls,
@@ -34,6 +34,15 @@ class InterDex {
     DexesStructure dexes_structure;
   };
 
+  // The refs that defining a class adds to its dex, including those reported
+  // by plugins.
+  struct ClassRefs {
+    MethodRefs mrefs;
+    FieldRefs frefs;
+    TypeRefs trefs;
+    TypeRefs itrefs;
+  };
+
  public:
   InterDex(
       const Scope& original_scope,
@@ -67,6 +76,7 @@ class InterDex {
       size_t min_betamap_move_threshold,
       size_t max_betamap_move_threshold,
       int64_t stable_partitions,
+      bool precompute_class_refs,
       bool is_root_store = true)
       : m_dexen(dexen),
         m_asset_manager(asset_manager),
@@ -101,6 +111,7 @@ class InterDex {
         m_min_betamap_move_threshold(min_betamap_move_threshold),
         m_max_betamap_move_threshold(max_betamap_move_threshold),
         m_stable_partitions(stable_partitions),
+        m_precompute_class_refs(precompute_class_refs),
         m_is_root_store(is_root_store) {
     m_emitting_state.dexes_structure.set_linear_alloc_limit(linear_alloc_limit);
     m_emitting_state.dexes_structure.set_reserve_frefs(reserve_refs.frefs);
@@ -236,6 +247,20 @@ class InterDex {
 
   void initialize_baseline_profile_classes();
 
+  /*
+   * Gathers the refs of all classes in m_scope in parallel, so that emitting
+   * them doesn't have to. Plugins are not required to be thread-safe, so this
+   * does nothing when there are any.
+   */
+  void precompute_class_refs();
+
+  /*
+   * Returns the refs of the class, either precomputed, or gathered into
+   * `storage`.
+   */
+  const ClassRefs& get_class_refs(const DexClass* cls,
+                                  ClassRefs* storage) const;
+
   void get_movable_coldstart_classes(
       const std::vector<DexType*>& interdex_types,
       std::unordered_map<const DexClass*, std::string>& move_coldstart_classes);
@@ -290,6 +315,8 @@ class InterDex {
   size_t m_max_betamap_move_threshold;
 
   const uint64_t m_stable_partitions;
+  const bool m_precompute_class_refs;
+  std::unordered_map<const DexClass*, ClassRefs> m_precomputed_class_refs;
   const bool m_is_root_store;
 };
 
@@ -7,6 +7,7 @@
 
 #include "InterDexPass.h"
 
+#include "ClassLoadTrace.h"
 #include "ConfigFiles.h"
 #include "DexClass.h"
 #include "DexUtil.h"
@@ -14,7 +15,6 @@
 #include "PassManager.h"
 #include "Show.h"
 #include "StlUtil.h"
-#include "WorkQueue.h"
 
 namespace {
 
@@ -34,6 +34,16 @@ void treat_generated_stores(DexStoresVector& stores,
   });
 }
 
+void set_startup_density_metrics(PassManager& mgr,
+                                 const std::string& prefix,
+                                 size_t classes,
+                                 size_t early_loaded_classes) {
+  mgr.set_metric(prefix + "classes", classes);
+  mgr.set_metric(prefix + "early_loaded_classes", early_loaded_classes);
+  mgr.set_metric(prefix + "startup_density_percent",
+                 classes == 0 ? 0 : early_loaded_classes * 100 / classes);
+}
+
 } // namespace
 
 namespace interdex {
@@ -115,6 +125,15 @@ void InterDexPass::bind_config() {
   bind("reorder_dynamically_dead_classes", false,
        m_reorder_dynamically_dead_classes);
 
+  bind("class_load_traces", {}, m_class_load_traces,
+       "Runtime class-load traces, see ClassLoadTrace.h. With "
+       "reorder_dynamically_dead_classes, the traced classes that were not "
+       "loaded before late_class_load_ms are treated like dynamically dead "
+       "classes, and so are moved to the last dexes");
+  bind("late_class_load_ms", 1000, m_late_class_load_ms,
+       "How long after the app started a class must have been first loaded "
+       "to be considered late");
+
   bind("exclude_baseline_profile_classes", false,
        m_exclude_baseline_profile_classes);
 
@@ -128,6 +147,11 @@ void InterDexPass::bind_config() {
        "For the unordered classes, how many dexes they should be distributed "
        "over in a stable manner, or 0 if stability is not desired");
 
+  bind("precompute_class_refs", false, m_precompute_class_refs,
+       "Gather the refs of all classes in parallel before emitting them, "
+       "instead of one class at a time while emitting. This trades memory "
+       "for time on very large apps. Ignored when plugins are present.");
+
   after_configuration([=] {
     always_assert(m_stable_partitions >= 0);
     always_assert(m_stable_partitions < (int64_t)MAX_DEX_NUM);
@@ -172,6 +196,42 @@ void InterDexPass::run_pass(
   bool force_single_dex = conf.get_json_config().get("force_single_dex", false);
   mgr.set_metric("config.force_single_dex", force_single_dex);
 
+  ClassLoadTrace class_load_trace;
+  for (const auto& filename : m_class_load_traces) {
+    class_load_trace.load_file(filename, conf.get_proguard_map());
+  }
+  auto count_early_loaded = [&](const DexClasses& classes) {
+    return std::count_if(
+        classes.begin(), classes.end(), [&](const DexClass* cls) {
+          auto ms = class_load_trace.get_first_load_ms(cls->get_type());
+          return ms && *ms < m_late_class_load_ms;
+        });
+  };
+  if (!class_load_trace.empty()) {
+    mgr.set_metric("class_load_trace.classes", class_load_trace.size());
+    if (!dexen.empty()) {
+      set_startup_density_metrics(mgr, "class_load_trace.input_primary_dex.",
+                                  dexen[0].size(),
+                                  count_early_loaded(dexen[0]));
+    }
+  }
+  if (!class_load_trace.empty() && m_reorder_dynamically_dead_classes) {
+    // InterDex keeps the classes in the betamap, and their superclasses, where
+    // they are, even if they were loaded late.
+    size_t late_loaded_classes{0};
+    for (const auto& classes : dexen) {
+      for (auto* cls : classes) {
+        auto ms = class_load_trace.get_first_load_ms(cls->get_type());
+        if (ms && *ms >= m_late_class_load_ms && !cls->is_dynamically_dead()) {
+          cls->set_dynamically_dead();
+          ++late_loaded_classes;
+        }
+      }
+    }
+    mgr.set_metric("class_load_trace.late_loaded_classes",
+                   late_loaded_classes);
+  }
+
   InterDex interdex(
       original_scope, dexen, mgr.asset_manager(), conf, plugins,
       m_linear_alloc_limit, m_static_prune, m_normal_primary_dex,
@@ -184,7 +244,7 @@ void InterDexPass::run_pass(
       m_exclude_baseline_profile_classes,
       conf.get_default_baseline_profile_config(), m_move_coldstart_classes,
       m_min_betamap_move_threshold, m_max_betamap_move_threshold,
-      m_stable_partitions);
+      m_stable_partitions, m_precompute_class_refs);
 
   if (m_expect_order_list) {
     always_assert_log(
@@ -199,6 +259,26 @@ void InterDexPass::run_pass(
   mgr.set_metric("root_store.dexes", dexen.size());
   redex_assert(dexen.size() == interdex.get_dex_info().size());
 
+  if (!class_load_trace.empty()) {
+    if (!dexen.empty()) {
+      set_startup_density_metrics(mgr, "class_load_trace.primary_dex.",
+                                  dexen[0].size(),
+                                  count_early_loaded(dexen[0]));
+    }
+    size_t coldstart_classes{0};
+    size_t coldstart_early_loaded_classes{0};
+    for (size_t i = 0; i != dexen.size(); ++i) {
+      auto& info = interdex.get_dex_info()[i];
+      if (info.primary || info.coldstart) {
+        coldstart_classes += dexen[i].size();
+        coldstart_early_loaded_classes += count_early_loaded(dexen[i]);
+      }
+    }
+    set_startup_density_metrics(mgr, "class_load_trace.coldstart_dexes.",
+                                coldstart_classes,
+                                coldstart_early_loaded_classes);
+  }
+
   for (size_t i = 0; i != dexen.size(); ++i) {
     std::string key_prefix = "root_store.dexes." + std::to_string(i) + ".";
     mgr.set_metric(key_prefix + "classes", dexen[i].size());
@@ -311,7 +391,7 @@ void InterDexPass::run_pass_on_nonroot_store(
       m_exclude_baseline_profile_classes,
       conf.get_default_baseline_profile_config(), m_move_coldstart_classes,
       m_min_betamap_move_threshold, m_max_betamap_move_threshold,
-      m_stable_partitions,
+      m_stable_partitions, m_precompute_class_refs,
       /* is_root_store */ false);
 
   interdex.run_on_nonroot_store();
@@ -324,8 +404,11 @@ void InterDexPass::run_pass(DexStoresVector& stores,
                             PassManager& mgr) {
   Scope original_scope = build_class_scope(stores);
 
-  init_classes::InitClassesWithSideEffects init_classes_with_side_effects(
-      original_scope, conf.create_init_class_insns());
+  auto init_classes_with_side_effects_ptr =
+      InitClassesAnalysisPass::get_or_build(mgr, original_scope,
+                                            conf.create_init_class_insns());
+  const auto& init_classes_with_side_effects =
+      *init_classes_with_side_effects_ptr;
   XStoreRefs xstore_refs(stores);
 
   // Setup all external plugins.
@@ -352,15 +435,13 @@ void InterDexPass::run_pass(DexStoresVector& stores,
     }
   }
 
-  workqueue_run<DexStore*>(
-      [&](DexStore* store) {
-        run_pass_on_nonroot_store(
-            original_scope, xstore_refs, init_classes_with_side_effects,
-            store->get_dexen(), conf, mgr, refs_info, cache);
-        mgr.set_metric("nonroot_store." + store->get_name() + ".dexes",
-                       store->get_dexen().size());
-      },
-      parallel_stores);
+  run_on_stores_in_parallel(parallel_stores, [&](DexStore& store) {
+    run_pass_on_nonroot_store(original_scope, xstore_refs,
+                              init_classes_with_side_effects, store.get_dexen(),
+                              conf, mgr, refs_info, cache);
+    mgr.set_metric("nonroot_store." + store.get_name() + ".dexes",
+                   store.get_dexen().size());
+  });
 
   ++m_run;
   // For the last invocation, record that final interdex has been done.
@@ -10,6 +10,7 @@
 #include "BaselineProfileConfig.h"
 #include "DexClass.h"
 #include "DexStructure.h"
+#include "InitClassesAnalysisPass.h"
 #include "InterDex.h"
 #include "InterDexPassPlugin.h"
 #include "Pass.h"
@@ -85,6 +86,10 @@ class InterDexPass : public Pass {
     ++m_eval;
   }
 
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<InitClassesAnalysisPass>();
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
   bool minimize_cross_dex_refs() const { return m_minimize_cross_dex_refs; }
@@ -114,6 +119,8 @@ class InterDexPass : public Pass {
       m_minimize_cross_dex_refs_config;
   bool m_expect_order_list;
   bool m_reorder_dynamically_dead_classes;
+  std::vector<std::string> m_class_load_traces;
+  int64_t m_late_class_load_ms;
   std::unordered_set<size_t> m_dynamically_dead_dexes;
 
   std::vector<std::string> m_methods_for_canary_clinit_reference;
@@ -125,6 +132,8 @@ class InterDexPass : public Pass {
 
   int64_t m_stable_partitions;
 
+  bool m_precompute_class_refs;
+
   size_t m_run{0}; // Which iteration of `run_pass`.
   size_t m_eval{0}; // How many `eval_pass` iterations.
 
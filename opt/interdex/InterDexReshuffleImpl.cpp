@@ -278,41 +278,94 @@ void InterDexReshuffleImpl::compute_plan() {
       m_mutable_dexen, m_mutable_dexen_strings, m_dynamically_dead_dexes,
       m_class_to_merging_info, m_num_field_defs, m_mergeability_aware,
       m_config.deduped_weight, m_config.other_weight);
+  auto rescore = [&](const Move& move) {
+    return m_mergeability_aware
+               ? move_gains.compute_move_gain_after_merging(
+                     move.cls, move.target_dex_index)
+               : move_gains.compute_move_gain(move.cls, move.target_dex_index);
+  };
+
+  // The best moves are popped and rescored a window at a time, in parallel. A
+  // gain only depends on the source and target dexes of the move, so it stays
+  // exact unless one of them changed since it was scored, which we detect by
+  // versioning the dexes.
+  struct ScoredMove {
+    Move move;
+    gain_t gain;
+    size_t source_dex_index;
+    size_t source_version;
+    size_t target_version;
+  };
+  const size_t window_size =
+      std::max<size_t>(1, m_config.parallel_scoring_window);
+  std::vector<ScoredMove> window;
+  window.reserve(window_size);
+  std::vector<size_t> dex_versions(m_mutable_dexen.size(), 0);
+
   size_t batches{0};
   size_t total_moves{0};
   size_t max_move_gains{0};
+  size_t rescored_moves{0};
   for (; batches < m_config.max_batches; batches++) {
     Timer u("batch");
     move_gains.recompute_gains();
     max_move_gains = std::max(max_move_gains, move_gains.size());
 
-    while (move_gains.moves_this_epoch() < m_config.max_batch_size) {
-      std::optional<Move> move_opt = move_gains.pop_max_gain();
-      if (!move_opt) {
-        break;
+    bool exhausted = false;
+    while (!exhausted &&
+           move_gains.moves_this_epoch() < m_config.max_batch_size) {
+      window.clear();
+      while (window.size() < window_size) {
+        std::optional<Move> move_opt = move_gains.pop_max_gain();
+        if (!move_opt) {
+          exhausted = true;
+          break;
+        }
+        auto source_dex_index = m_class_dex_indices.at(move_opt->cls);
+        auto target_dex_index = move_opt->target_dex_index;
+        window.push_back((ScoredMove){*move_opt, 0, source_dex_index,
+                                      dex_versions.at(source_dex_index),
+                                      dex_versions.at(target_dex_index)});
       }
-
-      const Move& move = *move_opt;
-      gain_t recomputed_gain = 0;
-      if (m_mergeability_aware) {
-        recomputed_gain = move_gains.compute_move_gain_after_merging(
-            move.cls, move.target_dex_index);
+      if (window.size() == 1) {
+        window.front().gain = rescore(window.front().move);
       } else {
-        recomputed_gain =
-            move_gains.compute_move_gain(move.cls, move.target_dex_index);
-      }
-      if (recomputed_gain <= 0) {
-        continue;
+        workqueue_run_for<size_t>(0, window.size(), [&](size_t i) {
+          window[i].gain = rescore(window[i].move);
+        });
       }
 
-      // Check if it is a valid move.
-      if (!try_plan_move(move, /*mergeability_aware=*/m_mergeability_aware)) {
-        continue;
-      }
-      if (traceEnabled(IDEXR, 5)) {
-        print_stats();
+      for (auto& scored : window) {
+        if (move_gains.moves_this_epoch() >= m_config.max_batch_size) {
+          break;
+        }
+        const Move& move = scored.move;
+        if (move_gains.moved_this_epoch(move.cls)) {
+          // The window can hold several moves of the same class.
+          continue;
+        }
+        if (dex_versions.at(scored.source_dex_index) !=
+                scored.source_version ||
+            dex_versions.at(move.target_dex_index) != scored.target_version) {
+          scored.gain = rescore(move);
+          rescored_moves++;
+        }
+        if (scored.gain <= 0) {
+          continue;
+        }
+
+        // Check if it is a valid move.
+        if (!try_plan_move(move,
+                           /*mergeability_aware=*/m_mergeability_aware)) {
+          continue;
+        }
+        if (traceEnabled(IDEXR, 5)) {
+          print_stats();
+        }
+        move_gains.moved_class(move);
+        dex_versions.at(scored.source_dex_index)++;
+        dex_versions.at(move.target_dex_index)++;
       }
-      move_gains.moved_class(move);
     }
     total_moves += move_gains.moves_this_epoch();
     TRACE(IDEXR, 2, "executed %zu moves in epoch %zu",
@@ -325,6 +378,7 @@ void InterDexReshuffleImpl::compute_plan() {
   m_mgr.incr_metric("max_move_gains", max_move_gains);
   m_mgr.incr_metric("total_moves", total_moves);
   m_mgr.incr_metric("batches", batches);
+  m_mgr.incr_metric("rescored_moves", rescored_moves);
   m_mgr.incr_metric("first_dex_index", m_first_dex_index);
   record_stats();
   TRACE(IDEXR, 1, "executed %zu moves in %zu batches", total_moves, batches);
@@ -38,6 +38,10 @@ struct ReshuffleConfig {
   size_t extra_linear_alloc_limit{0};
   size_t max_batches{20};
   size_t max_batch_size{200000};
+  // How many of the best moves to rescore in parallel at a time. Moves whose
+  // source or target dex changed in the meantime are rescored again before
+  // they are applied, so this affects only speed, not the resulting plan.
+  size_t parallel_scoring_window{1};
   size_t interaction_frequency_threshold{0};
   bool exclude_below20pct_coldstart_classes{false};
   // Class merging related
@@ -194,6 +198,11 @@ class MoveGains {
     return std::nullopt;
   }
 
+  bool moved_this_epoch(DexClass* cls) const {
+    auto it = m_move_epoch.find(cls);
+    return it != m_move_epoch.end() && it->second >= m_epoch;
+  }
+
   void moved_class(const Move& move) {
     size_t& class_epoch = m_move_epoch[move.cls];
     const bool was_moved_last_epoch = class_epoch == m_epoch - 1;
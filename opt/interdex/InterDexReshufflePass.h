@@ -89,6 +89,12 @@ class InterDexReshufflePass : public Pass {
          m_config.max_batch_size,
          "How many class to move per batch. More might yield better results, "
          "but might take longer.");
+    bind("parallel_scoring_window",
+         m_config.parallel_scoring_window,
+         m_config.parallel_scoring_window,
+         "How many candidate moves to score in parallel at a time. This does "
+         "not change the result, but larger windows waste more work when many "
+         "moves touch the same dexes.");
     bind("exclude_below20pct_coldstart_classes",
          false,
          m_config.exclude_below20pct_coldstart_classes,
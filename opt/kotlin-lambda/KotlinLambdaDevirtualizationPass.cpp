@@ -0,0 +1,440 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * kotlinc compiles a non-capturing lambda into a final class extending
+ * kotlin/jvm/internal/Lambda, with a singleton INSTANCE created in its
+ * <clinit>, a typed `invoke` method holding the body and an erased bridge
+ * `invoke` implementing the FunctionN interface:
+ *
+ *   sget-object v0, LFoo$bar$1;.INSTANCE:LFoo$bar$1;
+ *   check-cast v0, Lkotlin/jvm/functions/Function1;
+ *   invoke-interface {v0, v1}, Lkotlin/jvm/functions/Function1;.invoke:...
+ *
+ * Once the higher-order functions taking the lambda have been inlined, most of
+ * these instances are only ever used as the receiver of such calls, which
+ * still go through interface dispatch and load the lambda class.
+ *
+ * When all the instances of a lambda class outside of the class itself are
+ * used this way, the instance is irrelevant: both `invoke` methods do not use
+ * `this` beyond the bridge calling the typed method. We make them static,
+ * rewrite the interface calls into `invoke-static` of the bridge, and delete
+ * the INSTANCE reads, allocations and casts that fed them. Nothing creates the
+ * lambda anymore, so its constructor, <clinit> and INSTANCE field become
+ * unreachable, and the small static bridge is a trivial inlining candidate.
+ */
+
+#include "KotlinLambdaDevirtualizationPass.h"
+
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "ConcurrentContainers.h"
+#include "ControlFlow.h"
+#include "DexAccess.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "LiveRange.h"
+#include "MethodUtil.h"
+#include "Mutators.h"
+#include "PassManager.h"
+#include "ReachableClasses.h"
+#include "Resolver.h"
+#include "Show.h"
+#include "Trace.h"
+#include "TypeUtil.h"
+#include "Walkers.h"
+
+namespace {
+
+constexpr const char* METRIC_LAMBDAS = "num_devirtualized_lambdas";
+constexpr const char* METRIC_INVOKES = "num_devirtualized_invokes";
+
+struct Lambda {
+  // The `invoke` method implementing the FunctionN interface.
+  DexMethod* bridge{nullptr};
+  // The typed `invoke` method called by the bridge, if any.
+  DexMethod* impl{nullptr};
+};
+
+// The instructions of a method that refer to a lambda: the rewritten
+// interface calls, and the instance reads, allocations, constructor calls and
+// casts that go away with them.
+struct Sites {
+  std::vector<IRInstruction*> invokes;
+  std::vector<IRInstruction*> dead;
+};
+
+using MethodSites = std::unordered_map<const DexType*, Sites>;
+
+const DexType* referenced_type(const IRInstruction* insn) {
+  if (insn->has_type()) {
+    return type::get_element_type_if_array(insn->get_type());
+  }
+  if (insn->has_field()) {
+    return insn->get_field()->get_class();
+  }
+  if (insn->has_method()) {
+    return insn->get_method()->get_class();
+  }
+  return nullptr;
+}
+
+// Turns a virtual call into a static call of `callee`, which takes the same
+// arguments except for the receiver.
+void drop_receiver(IRInstruction* insn, DexMethod* callee) {
+  insn->set_opcode(OPCODE_INVOKE_STATIC);
+  insn->set_method(callee);
+  for (size_t i = 1; i < insn->srcs_size(); i++) {
+    insn->set_src(i - 1, insn->src(i));
+  }
+  insn->set_srcs_size(insn->srcs_size() - 1);
+}
+
+/*
+ * Returns true if `this` is only used by the bridge to call `impl`, or not at
+ * all if `impl` is null. The register must not be moved or overwritten, so
+ * that it can be dropped from the code.
+ */
+bool only_calls_on_this(const DexMethod* method, const DexMethod* impl) {
+  auto& cfg = method->get_code()->cfg();
+  auto params = cfg.get_param_instructions();
+  auto* this_insn = params.begin()->insn;
+  auto this_reg = this_insn->dest();
+  for (const auto& mie : cfg::ConstInstructionIterable(cfg)) {
+    auto* insn = mie.insn;
+    if (insn != this_insn && insn->has_dest() &&
+        (insn->dest() == this_reg ||
+         (insn->dest_is_wide() && insn->dest() + 1 == this_reg))) {
+      return false;
+    }
+  }
+  live_range::Chains chains(cfg);
+  auto du_chains = chains.get_def_use_chains();
+  for (const auto& use : du_chains[this_insn]) {
+    if (impl == nullptr || use.src_index != 0 ||
+        !opcode::is_an_invoke(use.insn->opcode()) ||
+        resolve_method(use.insn->get_method(), opcode_to_search(use.insn),
+                       method) != impl) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Returns true if the code only consists of instructions in `allowed`, plus
+ * the usual parameter, constant, result and return instructions.
+ */
+template <typename Pred>
+bool only_contains(const DexMethod* method, const Pred& allowed) {
+  auto* code = method->get_code();
+  if (code == nullptr) {
+    return false;
+  }
+  for (const auto& mie : cfg::ConstInstructionIterable(code->cfg())) {
+    auto* insn = mie.insn;
+    auto op = insn->opcode();
+    if (!opcode::is_a_load_param(op) && !opcode::is_a_const(op) &&
+        !opcode::is_move_result_any(op) && !opcode::is_a_return(op) &&
+        !allowed(insn)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Returns the `invoke` methods of `cls` if it is a non-capturing lambda whose
+ * instance is irrelevant to its code, and whose constructor and <clinit> do
+ * nothing but creating the INSTANCE singleton.
+ */
+std::optional<Lambda> get_lambda(const DexClass* cls) {
+  if (cls->is_external() || !type::is_kotlin_non_capturing_lambda(cls) ||
+      !is_final(cls) || root(cls) || !can_rename(cls)) {
+    return std::nullopt;
+  }
+  auto* type = cls->get_type();
+  for (auto* field : cls->get_sfields()) {
+    if (field->get_type() != type) {
+      return std::nullopt;
+    }
+  }
+  auto* lambda_init =
+      DexMethod::get_method("Lkotlin/jvm/internal/Lambda;.<init>:(I)V");
+  std::vector<DexMethod*> invokes;
+  for (auto* method : cls->get_all_methods()) {
+    if (method::is_init(method)) {
+      if (!method->get_proto()->get_args()->empty() ||
+          !only_contains(method, [&](const IRInstruction* insn) {
+            return insn->opcode() == OPCODE_INVOKE_DIRECT &&
+                   (insn->get_method() == lambda_init ||
+                    insn->get_method() == method::java_lang_Object_ctor());
+          })) {
+        return std::nullopt;
+      }
+    } else if (method::is_clinit(method)) {
+      if (!only_contains(method, [&](const IRInstruction* insn) {
+            auto op = insn->opcode();
+            return (op == OPCODE_NEW_INSTANCE && insn->get_type() == type) ||
+                   (op == OPCODE_INVOKE_DIRECT &&
+                    method::is_init(insn->get_method()) &&
+                    insn->get_method()->get_class() == type) ||
+                   (op == OPCODE_SPUT_OBJECT &&
+                    insn->get_field()->get_class() == type);
+          })) {
+        return std::nullopt;
+      }
+    } else if (method->str() == "invoke" && method->get_code() != nullptr &&
+               !root(method) && can_rename(method) &&
+               !method->rstate.no_optimizations()) {
+      invokes.push_back(method);
+    } else {
+      return std::nullopt;
+    }
+  }
+
+  // The bridge may call the typed `invoke`, and neither may refer to the
+  // lambda in any other way.
+  Lambda lambda;
+  for (auto* method : invokes) {
+    for (const auto& mie :
+         cfg::ConstInstructionIterable(method->get_code()->cfg())) {
+      auto* insn = mie.insn;
+      if (referenced_type(insn) != type) {
+        continue;
+      }
+      auto* callee = insn->has_method()
+                         ? resolve_method(insn->get_method(),
+                                          opcode_to_search(insn), method)
+                         : nullptr;
+      if (callee == nullptr || callee == method || lambda.impl != nullptr ||
+          std::find(invokes.begin(), invokes.end(), callee) == invokes.end()) {
+        return std::nullopt;
+      }
+      lambda.bridge = method;
+      lambda.impl = callee;
+    }
+  }
+  if (lambda.bridge == nullptr && invokes.size() == 1) {
+    lambda.bridge = invokes.front();
+  }
+  if (lambda.bridge == nullptr || !lambda.bridge->is_virtual() ||
+      !only_calls_on_this(lambda.bridge, lambda.impl) ||
+      (lambda.impl != nullptr && !only_calls_on_this(lambda.impl, nullptr))) {
+    return std::nullopt;
+  }
+  return lambda;
+}
+
+/*
+ * Collects the sites of the lambdas referenced by `method`. Lambdas whose
+ * instances are used in any other way than as receiver of an interface
+ * `invoke` resolving to their bridge are added to `rejected`.
+ */
+MethodSites collect_sites(
+    const DexMethod* method,
+    const std::unordered_map<const DexType*, Lambda>& lambdas,
+    InsertOnlyConcurrentSet<const DexType*>* rejected) {
+  auto& cfg = method->get_code()->cfg();
+  std::unordered_map<const DexType*, std::vector<IRInstruction*>> refs;
+  for (const auto& mie : cfg::ConstInstructionIterable(cfg)) {
+    auto* type = referenced_type(mie.insn);
+    if (type != nullptr && type != method->get_class() &&
+        lambdas.count(type)) {
+      refs[type].push_back(mie.insn);
+    }
+  }
+  MethodSites sites;
+  if (refs.empty()) {
+    return sites;
+  }
+  if (method->rstate.no_optimizations()) {
+    for (const auto& [type, _] : refs) {
+      rejected->insert(type);
+    }
+    return sites;
+  }
+
+  live_range::MoveAwareChains chains(cfg);
+  auto du_chains = chains.get_def_use_chains();
+  auto ud_chains = chains.get_use_def_chains();
+  for (const auto& [type, insns] : refs) {
+    auto* cls = type_class(type);
+    auto* bridge = lambdas.at(type).bridge;
+    auto& lambda_sites = sites[type];
+    std::unordered_set<IRInstruction*> accounted;
+    auto is_instance = [&](const IRInstruction* insn) {
+      return insn->opcode() == OPCODE_NEW_INSTANCE ||
+             (insn->opcode() == OPCODE_SGET_OBJECT &&
+              insn->get_field()->get_type() == type);
+    };
+    auto follow = [&](IRInstruction* def) {
+      std::vector<IRInstruction*> work{def};
+      while (!work.empty()) {
+        auto* insn = work.back();
+        work.pop_back();
+        lambda_sites.dead.push_back(insn);
+        accounted.insert(insn);
+        for (const auto& use : du_chains[insn]) {
+          // Every use must see this instance only, so that it is rewritten
+          // exactly once.
+          if (ud_chains[use].size() != 1) {
+            return false;
+          }
+          auto op = use.insn->opcode();
+          if (op == OPCODE_CHECK_CAST &&
+              type::check_cast(type, use.insn->get_type())) {
+            work.push_back(use.insn);
+            continue;
+          }
+          if (op == OPCODE_INVOKE_DIRECT && use.src_index == 0 &&
+              def->opcode() == OPCODE_NEW_INSTANCE &&
+              method::is_init(use.insn->get_method()) &&
+              use.insn->get_method()->get_class() == type) {
+            lambda_sites.dead.push_back(use.insn);
+            accounted.insert(use.insn);
+            continue;
+          }
+          if (op != OPCODE_INVOKE_INTERFACE || use.src_index != 0) {
+            return false;
+          }
+          auto* ref = use.insn->get_method();
+          if (resolve_virtual(cls, ref->get_name(), ref->get_proto()) !=
+              bridge) {
+            return false;
+          }
+          lambda_sites.invokes.push_back(use.insn);
+        }
+      }
+      return true;
+    };
+    bool ok = true;
+    for (auto* insn : insns) {
+      if (is_instance(insn) && !follow(insn)) {
+        ok = false;
+        break;
+      }
+    }
+    for (auto* insn : insns) {
+      ok &= accounted.count(insn) != 0;
+    }
+    if (!ok) {
+      TRACE(KOTLIN_INSTANCE, 3, "%s escapes in %s", SHOW(type), SHOW(method));
+      rejected->insert(type);
+    }
+  }
+  return sites;
+}
+
+void make_bridge_static(const Lambda& lambda) {
+  if (lambda.impl != nullptr) {
+    for (const auto& mie :
+         cfg::InstructionIterable(lambda.bridge->get_code()->cfg())) {
+      auto* insn = mie.insn;
+      if (insn->has_method() &&
+          resolve_method(insn->get_method(), opcode_to_search(insn),
+                         lambda.bridge) == lambda.impl) {
+        drop_receiver(insn, lambda.impl);
+      }
+    }
+    mutators::make_static(lambda.impl, mutators::KeepThis::No);
+  }
+  mutators::make_static(lambda.bridge, mutators::KeepThis::No);
+  lambda.bridge->set_access(lambda.bridge->get_access() & ~ACC_BRIDGE);
+}
+
+} // namespace
+
+KotlinLambdaDevirtualizationPass::Stats&
+KotlinLambdaDevirtualizationPass::Stats::operator+=(const Stats& that) {
+  lambdas += that.lambdas;
+  invokes += that.invokes;
+  return *this;
+}
+
+KotlinLambdaDevirtualizationPass::Stats
+KotlinLambdaDevirtualizationPass::devirtualize_lambdas(const Scope& scope) {
+  std::unordered_map<const DexType*, Lambda> lambdas;
+  for (auto* cls : scope) {
+    if (auto lambda = get_lambda(cls)) {
+      lambdas.emplace(cls->get_type(), *lambda);
+    }
+  }
+  if (lambdas.empty()) {
+    return Stats{};
+  }
+
+  InsertOnlyConcurrentSet<const DexType*> rejected;
+  InsertOnlyConcurrentMap<DexMethod*, MethodSites> method_sites;
+  walk::parallel::code(scope, [&](DexMethod* method, IRCode& /* code */) {
+    auto sites = collect_sites(method, lambdas, &rejected);
+    if (!sites.empty()) {
+      method_sites.emplace(method, std::move(sites));
+    }
+  });
+
+  // Lambdas that are never called through their interface have nothing to
+  // gain.
+  std::unordered_set<const DexType*> used;
+  for (const auto& [_, sites] : method_sites) {
+    for (const auto& [type, lambda_sites] : sites) {
+      if (!lambda_sites.invokes.empty()) {
+        used.insert(type);
+      }
+    }
+  }
+
+  Stats stats;
+  for (const auto& [type, lambda] : lambdas) {
+    if (used.count(type) && !rejected.count(type)) {
+      TRACE(KOTLIN_INSTANCE, 2, "Devirtualizing %s", SHOW(type));
+      make_bridge_static(lambda);
+      stats.lambdas++;
+    }
+  }
+  if (stats.lambdas == 0) {
+    return stats;
+  }
+
+  stats += walk::parallel::methods<Stats>(scope, [&](DexMethod* method) {
+    Stats method_stats;
+    const auto* sites = method_sites.get(method);
+    if (sites == nullptr) {
+      return method_stats;
+    }
+    auto& cfg = method->get_code()->cfg();
+    for (const auto& [type, lambda_sites] : *sites) {
+      if (!used.count(type) || rejected.count(type)) {
+        continue;
+      }
+      auto* bridge = lambdas.at(type).bridge;
+      for (auto* insn : lambda_sites.invokes) {
+        drop_receiver(insn, bridge);
+        method_stats.invokes++;
+      }
+      for (auto* insn : lambda_sites.dead) {
+        cfg.remove_insn(cfg.find_insn(insn));
+      }
+    }
+    return method_stats;
+  });
+  return stats;
+}
+
+void KotlinLambdaDevirtualizationPass::run_pass(DexStoresVector& stores,
+                                                ConfigFiles& /* unused */,
+                                                PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  auto stats = devirtualize_lambdas(scope);
+  mgr.incr_metric(METRIC_LAMBDAS, stats.lambdas);
+  mgr.incr_metric(METRIC_INVOKES, stats.invokes);
+}
+
+static KotlinLambdaDevirtualizationPass s_pass;
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "DexClass.h"
+#include "Pass.h"
+
+class KotlinLambdaDevirtualizationPass : public Pass {
+ public:
+  struct Stats {
+    size_t lambdas{0};
+    size_t invokes{0};
+
+    Stats& operator+=(const Stats&);
+  };
+
+  KotlinLambdaDevirtualizationPass()
+      : Pass("KotlinLambdaDevirtualizationPass") {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {
+        {DexLimitsObeyed, Preserves},
+        {HasSourceBlocks, Preserves},
+        {NoInitClassInstructions, Preserves},
+        {NoResolvablePureRefs, Preserves},
+        {NoUnreachableInstructions, Preserves},
+        {RenameClass, Preserves},
+    };
+  }
+
+  std::string get_config_doc() override {
+    return trim(R"(
+Non-capturing Kotlin lambdas are singletons whose only purpose is to be
+called through `kotlin/jvm/functions/FunctionN.invoke`. When every instance
+of such a lambda, whether read from its `INSTANCE` field or freshly
+allocated, flows only into the receiver of such calls, this pass turns the
+lambda's `invoke` methods static, rewrites the interface calls into direct
+`invoke-static`s and removes the instance reads and allocations. The lambda
+class is then left with static methods only, which the inliner and
+RemoveUnreachablePass clean up.
+    )");
+  }
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  static Stats devirtualize_lambdas(const Scope& scope);
+};
@@ -8,6 +8,7 @@
 #include "LocalDcePass.h"
 
 #include <array>
+#include <mutex>
 #include <unordered_set>
 #include <vector>
 
@@ -22,6 +23,7 @@
 #include "IRInstruction.h"
 #include "InitClassesWithSideEffects.h"
 #include "MethodOverrideGraph.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "PassManager.h"
 #include "Purity.h"
 #include "Resolver.h"
@@ -54,11 +56,91 @@ constexpr const char* METRIC_INIT_CLASS_INSTRUCTIONS_REMOVED =
 constexpr const char* METRIC_INIT_CLASS_INSTRUCTIONS_REFINED =
     "num_init_class_instructions_refined";
 
+class LocalDceRun : public MethodLocalPass::Run {
+ public:
+  LocalDceRun(
+      std::unordered_set<DexMethodRef*> pure_methods,
+      std::shared_ptr<const method_override_graph::Graph> override_graph,
+      std::unique_ptr<init_classes::InitClassesWithSideEffects>
+          init_classes_with_side_effects,
+      size_t computed_no_side_effects_methods,
+      size_t computed_no_side_effects_methods_iterations,
+      bool may_allocate_registers,
+      bool may_remove_nops)
+      : m_pure_methods(std::move(pure_methods)),
+        m_override_graph(std::move(override_graph)),
+        m_init_classes_with_side_effects(
+            std::move(init_classes_with_side_effects)),
+        m_computed_no_side_effects_methods(computed_no_side_effects_methods),
+        m_computed_no_side_effects_methods_iterations(
+            computed_no_side_effects_methods_iterations),
+        m_may_allocate_registers(may_allocate_registers),
+        m_may_remove_nops(may_remove_nops) {}
+
+  void run_on_method(DexMethod* m, IRCode& code) override {
+    if (m->rstate.no_optimizations()) {
+      return;
+    }
+
+    LocalDce ldce(m_init_classes_with_side_effects.get(), m_pure_methods,
+                  m_override_graph.get(), m_may_allocate_registers,
+                  /* ignore_pure_method_init_classes */ false,
+                  m_may_remove_nops);
+    ldce.dce(&code, /* normalize_new_instances */ true, m->get_class());
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    m_stats += ldce.get_stats();
+  }
+
+  void finish(PassManager& mgr) override;
+
+ private:
+  std::unordered_set<DexMethodRef*> m_pure_methods;
+  std::shared_ptr<const method_override_graph::Graph> m_override_graph;
+  std::unique_ptr<init_classes::InitClassesWithSideEffects>
+      m_init_classes_with_side_effects;
+  size_t m_computed_no_side_effects_methods;
+  size_t m_computed_no_side_effects_methods_iterations;
+  bool m_may_allocate_registers;
+  bool m_may_remove_nops;
+  std::mutex m_stats_mutex;
+  LocalDce::Stats m_stats;
+};
+
+void LocalDceRun::finish(PassManager& mgr) {
+  const auto& stats = m_stats;
+  mgr.incr_metric(METRIC_NPE_INSTRUCTIONS, stats.npe_instruction_count);
+  mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS_ADDED,
+                  stats.init_class_instructions_added);
+  mgr.incr_metric(METRIC_DEAD_INSTRUCTIONS, stats.dead_instruction_count);
+  mgr.incr_metric(METRIC_UNREACHABLE_INSTRUCTIONS,
+                  stats.unreachable_instruction_count);
+  mgr.incr_metric(METRIC_NORMALIZED_NEW_INSTANCES,
+                  stats.normalized_new_instances);
+  mgr.incr_metric(METRIC_ALIASED_NEW_INSTANCES, stats.aliased_new_instances);
+  mgr.incr_metric(METRIC_COMPUTED_NO_SIDE_EFFECTS_METHODS,
+                  m_computed_no_side_effects_methods);
+  mgr.incr_metric(METRIC_COMPUTED_NO_SIDE_EFFECTS_METHODS_ITERATIONS,
+                  m_computed_no_side_effects_methods_iterations);
+  mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS,
+                  stats.init_classes.init_class_instructions);
+  mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS_REMOVED,
+                  stats.init_classes.init_class_instructions_removed);
+  mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS_REFINED,
+                  stats.init_classes.init_class_instructions_refined);
+  TRACE(DCE, 1,
+        "instructions removed -- npe: %zu, dead: %zu, init-class added: %zu, "
+        "unreachable: %zu; "
+        "normalized %zu new-instance instructions, %zu aliasaed",
+        stats.npe_instruction_count, stats.dead_instruction_count,
+        stats.init_class_instructions_added,
+        stats.unreachable_instruction_count, stats.normalized_new_instances,
+        stats.aliased_new_instances);
+}
+
 } // namespace
 
-void LocalDcePass::run_pass(DexStoresVector& stores,
-                            ConfigFiles& conf,
-                            PassManager& mgr) {
+std::unique_ptr<MethodLocalPass::Run> LocalDcePass::start_run(
+    DexStoresVector& stores, ConfigFiles& conf, PassManager& mgr) {
   auto scope = build_class_scope(stores);
 
   auto pure_methods = get_pure_methods();
@@ -67,9 +149,9 @@ void LocalDcePass::run_pass(DexStoresVector& stores,
                       configured_pure_methods.end());
   auto immutable_getters = get_immutable_getters(scope);
   pure_methods.insert(immutable_getters.begin(), immutable_getters.end());
-  std::unique_ptr<const method_override_graph::Graph> override_graph;
+  std::shared_ptr<const method_override_graph::Graph> override_graph;
   if (!mgr.unreliable_virtual_scopes()) {
-    override_graph = method_override_graph::build_graph(scope);
+    override_graph = MethodOverrideGraphAnalysisPass::get_or_build(mgr, scope);
   }
   std::unique_ptr<init_classes::InitClassesWithSideEffects>
       init_classes_with_side_effects;
@@ -120,47 +202,12 @@ void LocalDcePass::run_pass(DexStoresVector& stores,
 
   bool may_remove_nops = !mgr.nopper_has_run();
 
-  auto stats =
-      walk::parallel::methods<LocalDce::Stats>(scope, [&](DexMethod* m) {
-        auto* code = m->get_code();
-        if (code == nullptr || m->rstate.no_optimizations()) {
-          return LocalDce::Stats();
-        }
-
-        LocalDce ldce(init_classes_with_side_effects.get(), pure_methods,
-                      override_graph.get(), may_allocate_registers,
-                      /* ignore_pure_method_init_classes */ false,
-                      may_remove_nops);
-        ldce.dce(code, /* normalize_new_instances */ true, m->get_class());
-        return ldce.get_stats();
-      });
-  mgr.incr_metric(METRIC_NPE_INSTRUCTIONS, stats.npe_instruction_count);
-  mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS_ADDED,
-                  stats.init_class_instructions_added);
-  mgr.incr_metric(METRIC_DEAD_INSTRUCTIONS, stats.dead_instruction_count);
-  mgr.incr_metric(METRIC_UNREACHABLE_INSTRUCTIONS,
-                  stats.unreachable_instruction_count);
-  mgr.incr_metric(METRIC_NORMALIZED_NEW_INSTANCES,
-                  stats.normalized_new_instances);
-  mgr.incr_metric(METRIC_ALIASED_NEW_INSTANCES, stats.aliased_new_instances);
-  mgr.incr_metric(METRIC_COMPUTED_NO_SIDE_EFFECTS_METHODS,
-                  computed_no_side_effects_methods.size());
-  mgr.incr_metric(METRIC_COMPUTED_NO_SIDE_EFFECTS_METHODS_ITERATIONS,
-                  computed_no_side_effects_methods_iterations);
-  mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS,
-                  stats.init_classes.init_class_instructions);
-  mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS_REMOVED,
-                  stats.init_classes.init_class_instructions_removed);
-  mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS_REFINED,
-                  stats.init_classes.init_class_instructions_refined);
-  TRACE(DCE, 1,
-        "instructions removed -- npe: %zu, dead: %zu, init-class added: %zu, "
-        "unreachable: %zu; "
-        "normalized %zu new-instance instructions, %zu aliasaed",
-        stats.npe_instruction_count, stats.dead_instruction_count,
-        stats.init_class_instructions_added,
-        stats.unreachable_instruction_count, stats.normalized_new_instances,
-        stats.aliased_new_instances);
+  return std::make_unique<LocalDceRun>(
+      std::move(pure_methods), std::move(override_graph),
+      std::move(init_classes_with_side_effects),
+      computed_no_side_effects_methods.size(),
+      computed_no_side_effects_methods_iterations, may_allocate_registers,
+      may_remove_nops);
 }
 
 static LocalDcePass s_pass;
@@ -8,11 +8,12 @@
 #pragma once
 
 #include "LocalDce.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Pass.h"
 
-class LocalDcePass : public Pass {
+class LocalDcePass : public MethodLocalPass {
  public:
-  LocalDcePass() : Pass("LocalDcePass") {}
+  LocalDcePass() : MethodLocalPass("LocalDcePass") {}
 
   redex_properties::PropertyInteractions get_property_interactions()
       const override {
@@ -29,5 +30,13 @@ class LocalDcePass : public Pass {
     };
   }
 
-  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+  }
+
+  bool skips_unchanged_methods() const override { return true; }
+
+  std::unique_ptr<Run> start_run(DexStoresVector&,
+                                 ConfigFiles&,
+                                 PassManager&) override;
 };
@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * This pass hoists loop-invariant computations into the preheaders of their
+ * loops.
+ *
+ * For example:
+ *
+ *   L0: CONST v1, 10
+ *       ADD_INT v2, v0, v1
+ *       INVOKE_STATIC {v2}, LFoo;.bar:(I)V
+ *       GOTO L0
+ *
+ * becomes
+ *
+ *       CONST v1, 10
+ *       ADD_INT v2, v0, v1
+ *   L0: INVOKE_STATIC {v2}, LFoo;.bar:(I)V
+ *       GOTO L0
+ *
+ * An instruction is hoisted when none of its operands is written in the loop,
+ * its destination is only written by it, and the destination holds no value
+ * that is read in the loop before it's written, or after the loop is left.
+ *
+ * Instructions that neither read memory nor throw can be hoisted from
+ * anywhere in the loop. Instructions that may throw, but whose result only
+ * depends on their operands (const-string, const-class, sget of final
+ * fields, invocations of pure methods), are only hoisted when they would be
+ * executed at the start of the first iteration anyway: they must be in the
+ * loop header, the header must not be covered by a try, and nothing that may
+ * throw or have side effects may execute before them in the header.
+ *
+ * We only consider loops with a natural preheader, a single predecessor
+ * outside of the loop that only goes to the loop header, so that the cfg
+ * structure never changes.
+ */
+
+#include "LoopInvariantCodeMotion.h"
+
+#include <utility>
+
+#include "ConfigFiles.h"
+#include "ControlFlow.h"
+#include "DexClass.h"
+#include "DexUtil.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "IROpcode.h"
+#include "Liveness.h"
+#include "LoopInfo.h"
+#include "PassManager.h"
+#include "Resolver.h"
+#include "Show.h"
+#include "Trace.h"
+#include "Walkers.h"
+
+namespace {
+
+constexpr const char* METRIC_INSTRUCTIONS_HOISTED = "num_instructions_hoisted";
+constexpr const char* METRIC_LOOPS_WITH_HOISTED_INSTRUCTIONS =
+    "num_loops_with_hoisted_instructions";
+constexpr const char* METRIC_LOOPS_WITHOUT_PREHEADER =
+    "num_loops_without_preheader";
+
+// Number of definitions of each register, counting both halves of wide
+// registers.
+using WriteCounts = std::unordered_map<reg_t, size_t>;
+
+void add_writes(const IRInstruction* insn, WriteCounts* write_counts) {
+  if (insn->has_dest()) {
+    (*write_counts)[insn->dest()]++;
+    if (insn->dest_is_wide()) {
+      (*write_counts)[insn->dest() + 1]++;
+    }
+  }
+}
+
+void remove_writes(const IRInstruction* insn, WriteCounts* write_counts) {
+  (*write_counts)[insn->dest()]--;
+  if (insn->dest_is_wide()) {
+    (*write_counts)[insn->dest() + 1]--;
+  }
+}
+
+bool is_written(const WriteCounts& write_counts, reg_t reg) {
+  auto it = write_counts.find(reg);
+  return it != write_counts.end() && it->second > 0;
+}
+
+// Whether an instruction computes its result from its operands alone, without
+// reading or writing memory or throwing.
+bool is_speculatable(const IRInstruction* insn) {
+  auto op = insn->opcode();
+  return insn->has_dest() && !opcode::can_throw(op) &&
+         !opcode::has_side_effects(op) && !opcode::is_a_move(op) &&
+         !opcode::is_move_result_any(op) && !opcode::is_move_exception(op) &&
+         !opcode::is_an_internal(op);
+}
+
+// Whether an instruction that may throw computes its result from its operands
+// alone.
+bool is_deterministic(const std::unordered_set<DexMethodRef*>& pure_methods,
+                      bool is_clinit,
+                      const DexType* declaring_type,
+                      const IRInstruction* insn) {
+  auto op = insn->opcode();
+  switch (op) {
+  case OPCODE_CONST_STRING:
+  case OPCODE_CONST_CLASS:
+    return true;
+  case OPCODE_INVOKE_VIRTUAL:
+  case OPCODE_INVOKE_INTERFACE:
+  case OPCODE_INVOKE_DIRECT:
+  case OPCODE_INVOKE_STATIC: {
+    auto* method_ref = insn->get_method();
+    if (pure_methods.count(method_ref)) {
+      return true;
+    }
+    auto* method = resolve_method(method_ref, opcode_to_search(insn));
+    return method != nullptr && pure_methods.count(method);
+  }
+  default:
+    break;
+  }
+  if (!opcode::is_an_sget(op)) {
+    return false;
+  }
+  // Final fields are only written by the class initializer of their class.
+  auto* field = resolve_field(insn->get_field(), FieldSearch::Static);
+  return field != nullptr && is_final(field) && !is_volatile(field) &&
+         !(is_clinit && field->get_class() == declaring_type);
+}
+
+} // namespace
+
+LoopInvariantCodeMotionPass::Stats LoopInvariantCodeMotionPass::process_code(
+    const std::unordered_set<DexMethodRef*>& pure_methods,
+    bool is_clinit,
+    const DexType* declaring_type,
+    IRCode* code) {
+  Stats stats;
+  always_assert(code->editable_cfg_built());
+  auto& cfg = code->cfg();
+  loop_impl::LoopInfo loop_info(std::as_const(cfg));
+  if (loop_info.num_loops() == 0) {
+    return stats;
+  }
+
+  std::unique_ptr<LivenessFixpointIterator> liveness;
+  // Loops are in level order, so we visit inner loops before outer loops,
+  // which may then hoist further what was hoisted out of inner loops.
+  for (auto loop_it = loop_info.rbegin(); loop_it != loop_info.rend();
+       ++loop_it) {
+    auto& loop = *loop_it;
+    auto* header = loop.get_header();
+    cfg::Block* preheader{nullptr};
+    size_t outside_preds{0};
+    for (auto* edge : header->preds()) {
+      if (!loop.contains(edge->src())) {
+        preheader = edge->src();
+        outside_preds++;
+      }
+    }
+    if (outside_preds != 1 || preheader->succs().size() != 1) {
+      stats.loops_without_preheader++;
+      continue;
+    }
+
+    if (!liveness) {
+      liveness = std::make_unique<LivenessFixpointIterator>(cfg);
+      liveness->run(LivenessDomain());
+    }
+    // Registers whose values before or after the loop must not change.
+    LivenessDomain live_regs = liveness->get_live_in_vars_at(header);
+    for (auto* exit_block : loop.get_exit_blocks()) {
+      live_regs.join_with(liveness->get_live_in_vars_at(exit_block));
+    }
+
+    auto blocks = loop.get_blocks();
+    WriteCounts write_counts;
+    for (auto* block : blocks) {
+      for (const auto& mie : InstructionIterable(block)) {
+        add_writes(mie.insn, &write_counts);
+      }
+    }
+    auto is_hoistable = [&](const IRInstruction* insn,
+                            const IRInstruction* dest_insn) {
+      for (size_t i = 0; i < insn->srcs_size(); i++) {
+        auto src = insn->src(i);
+        if (is_written(write_counts, src) ||
+            (insn->src_is_wide(i) && is_written(write_counts, src + 1))) {
+          return false;
+        }
+      }
+      auto dest = dest_insn->dest();
+      auto last_dest = dest_insn->dest_is_wide() ? dest + 1 : dest;
+      for (auto reg = dest; reg <= last_dest; reg++) {
+        if (write_counts.at(reg) != 1 || live_regs.contains(reg)) {
+          return false;
+        }
+      }
+      return true;
+    };
+
+    size_t hoisted{0};
+    bool any_changes;
+    do {
+      any_changes = false;
+      for (auto* block : blocks) {
+        // Whether the instructions visited so far are known to be executed at
+        // the start of every iteration, without side effects and throws.
+        bool at_iteration_start =
+            block == header && block->get_outgoing_throws_in_order().empty();
+        std::vector<ir_list::InstructionIterator> to_remove;
+        auto iterable = ir_list::InstructionIterable(block);
+        for (auto it = iterable.begin(); it != iterable.end(); ++it) {
+          auto* insn = it->insn;
+          if (opcode::is_move_result_any(insn->opcode())) {
+            continue;
+          }
+          IRInstruction* dest_insn{nullptr};
+          if (is_speculatable(insn)) {
+            dest_insn = insn;
+          } else if (at_iteration_start &&
+                     is_deterministic(pure_methods, is_clinit, declaring_type,
+                                      insn)) {
+            auto next_it = std::next(it);
+            if (next_it != iterable.end() &&
+                opcode::is_move_result_any(next_it->insn->opcode())) {
+              dest_insn = next_it->insn;
+            }
+          }
+          if (dest_insn == nullptr || !is_hoistable(insn, dest_insn)) {
+            if (!is_speculatable(insn)) {
+              at_iteration_start = false;
+            }
+            continue;
+          }
+          TRACE(LOOP, 4, "[licm] hoisting %s out of B%zu", SHOW(insn),
+                header->id());
+          preheader->push_back(new IRInstruction(*insn));
+          if (dest_insn != insn) {
+            preheader->push_back(new IRInstruction(*dest_insn));
+          }
+          remove_writes(dest_insn, &write_counts);
+          to_remove.push_back(it);
+          hoisted++;
+          any_changes = true;
+        }
+        // This also removes move-result(-pseudo)s.
+        for (auto& it : to_remove) {
+          block->remove_insn(it);
+        }
+      }
+    } while (any_changes);
+
+    if (hoisted > 0) {
+      stats.instructions_hoisted += hoisted;
+      stats.loops_with_hoisted_instructions++;
+      liveness = nullptr;
+    }
+  }
+  return stats;
+}
+
+void LoopInvariantCodeMotionPass::run_pass(DexStoresVector& stores,
+                                           ConfigFiles& conf,
+                                           PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  const auto& pure_methods = conf.get_pure_methods();
+  Stats stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* method) {
+    const auto code = method->get_code();
+    if (!code || method->rstate.no_optimizations()) {
+      return Stats{};
+    }
+    auto method_stats = process_code(pure_methods, method::is_clinit(method),
+                                     method->get_class(), code);
+    if (method_stats.instructions_hoisted > 0) {
+      TRACE(LOOP, 3,
+            "[licm] Hoisted %zu instructions out of %zu loops in {%s}",
+            method_stats.instructions_hoisted,
+            method_stats.loops_with_hoisted_instructions, SHOW(method));
+    }
+    return method_stats;
+  });
+  mgr.incr_metric(METRIC_INSTRUCTIONS_HOISTED, stats.instructions_hoisted);
+  mgr.incr_metric(METRIC_LOOPS_WITH_HOISTED_INSTRUCTIONS,
+                  stats.loops_with_hoisted_instructions);
+  mgr.incr_metric(METRIC_LOOPS_WITHOUT_PREHEADER,
+                  stats.loops_without_preheader);
+  TRACE(LOOP, 1, "[licm] Hoisted %zu instructions out of %zu loops",
+        stats.instructions_hoisted, stats.loops_with_hoisted_instructions);
+}
+
+static LoopInvariantCodeMotionPass s_pass;
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <unordered_set>
+
+#include "Pass.h"
+
+class IRCode;
+
+class LoopInvariantCodeMotionPass : public Pass {
+ public:
+  struct Stats {
+    size_t instructions_hoisted{0};
+    size_t loops_with_hoisted_instructions{0};
+    size_t loops_without_preheader{0};
+
+    Stats& operator+=(const Stats& that) {
+      instructions_hoisted += that.instructions_hoisted;
+      loops_with_hoisted_instructions += that.loops_with_hoisted_instructions;
+      loops_without_preheader += that.loops_without_preheader;
+      return *this;
+    }
+  };
+
+  LoopInvariantCodeMotionPass() : Pass("LoopInvariantCodeMotionPass") {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {
+        {DexLimitsObeyed, Preserves},
+        {NoResolvablePureRefs, Preserves},
+        {InitialRenameClass, Preserves},
+    };
+  }
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  /*
+   * Hoists loop-invariant instructions into the preheaders of their loops.
+   * The code must have an editable cfg.
+   */
+  static Stats process_code(
+      const std::unordered_set<DexMethodRef*>& pure_methods,
+      bool is_clinit,
+      const DexType* declaring_type,
+      IRCode* code);
+};
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MethodOverrideGraphAnalysisPass.h"
+
+#include <fstream>
+
+#include "DexUtil.h"
+#include "PassManager.h"
+#include "Trace.h"
+
+std::function<void()> MethodOverrideGraphAnalysisPass::prefetch_analysis(
+    const DexStoresVector& stores) {
+  return [this, scope = build_class_scope(stores)]() {
+    m_prefetched = method_override_graph::build_graph(scope);
+  };
+}
+
+void MethodOverrideGraphAnalysisPass::run_pass(DexStoresVector& stores,
+                                               ConfigFiles&,
+                                               PassManager& mgr) {
+  if (m_prefetched != nullptr) {
+    m_result = std::move(m_prefetched);
+    mgr.set_metric("prefetched", 1);
+  } else {
+    auto scope = build_class_scope(stores);
+    m_result = method_override_graph::build_graph(scope);
+  }
+  mgr.set_metric("nodes", m_result->nodes().size());
+}
+
+bool MethodOverrideGraphAnalysisPass::spill_analysis_result(
+    const std::string& path) {
+  if (m_result == nullptr) {
+    return false;
+  }
+  std::ofstream os(path, std::ios::binary);
+  m_result->save(os);
+  always_assert_log(os, "Cannot write method override graph to %s",
+                    path.c_str());
+  m_result = nullptr;
+  return true;
+}
+
+void MethodOverrideGraphAnalysisPass::reload_analysis_result(
+    const std::string& path) {
+  std::ifstream is(path, std::ios::binary);
+  m_result = method_override_graph::Graph::load(is);
+}
+
+std::shared_ptr<method_override_graph::Graph>
+MethodOverrideGraphAnalysisPass::get_or_build(const PassManager& mgr,
+                                              const Scope& scope) {
+  auto* analysis =
+      mgr.get_preserved_analysis<MethodOverrideGraphAnalysisPass>();
+  if (analysis != nullptr && analysis->get_result() != nullptr) {
+    TRACE(PM, 2, "Reusing preserved method override graph");
+    return analysis->get_result();
+  }
+  return method_override_graph::build_graph(scope);
+}
+
+static MethodOverrideGraphAnalysisPass s_pass;
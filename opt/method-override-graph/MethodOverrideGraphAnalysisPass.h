@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "AnalysisUsage.h"
+#include "DexClass.h"
+#include "MethodOverrideGraph.h"
+#include "Pass.h"
+
+/*
+ * Builds the method override graph and keeps it around as a preserved
+ * analysis, so that passes which don't change the class hierarchy or the set
+ * of virtual methods don't each have to rebuild it.
+ *
+ * Passes that only rewrite method bodies should declare that they preserve
+ * this analysis. Passes that delete, rename or devirtualize methods can keep
+ * it valid via `method_override_graph::Graph::remove_method`.
+ */
+class MethodOverrideGraphAnalysisPass : public Pass {
+ public:
+  MethodOverrideGraphAnalysisPass()
+      : Pass("MethodOverrideGraphAnalysisPass", Pass::ANALYSIS) {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {};
+  }
+
+  std::function<void()> prefetch_analysis(
+      const DexStoresVector& stores) override;
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  std::shared_ptr<method_override_graph::Graph> get_result() {
+    return m_result;
+  }
+
+  void destroy_analysis_result() override { m_result = nullptr; }
+
+  bool spill_analysis_result(const std::string& path) override;
+
+  void reload_analysis_result(const std::string& path) override;
+
+  // Returns the preserved graph if there is one, and builds a fresh graph for
+  // the given scope otherwise.
+  static std::shared_ptr<method_override_graph::Graph> get_or_build(
+      const PassManager& mgr, const Scope& scope);
+
+ private:
+  std::shared_ptr<method_override_graph::Graph> m_result = nullptr;
+  std::shared_ptr<method_override_graph::Graph> m_prefetched = nullptr;
+};
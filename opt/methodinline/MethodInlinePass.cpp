@@ -7,6 +7,8 @@
 
 #include "MethodInlinePass.h"
 
+#include "CseSharedStateAnalysisPass.h"
+
 void MethodInlinePass::bind_config() {
   size_t cost_invoke;
   bind("cost_invoke",
@@ -108,8 +110,13 @@ void MethodInlinePass::bind_config() {
 void MethodInlinePass::run_pass(DexStoresVector& stores,
                                 ConfigFiles& conf,
                                 PassManager& mgr) {
+  // Reuse CSE's preserved shared state in the shrinker, if there is one.
   inliner::run_inliner(stores, mgr, conf, m_inliner_cost_config,
-                       m_consider_hot_cold);
+                       m_consider_hot_cold, /* intra_dex */ false,
+                       /* inline_for_speed */ nullptr,
+                       /* inline_bridge_synth_only */ false,
+                       /* local_only */ false,
+                       CseSharedStateAnalysisPass::get_preserved(mgr));
 }
 
 static MethodInlinePass s_pass;
@@ -276,12 +276,30 @@ class InlineForSpeedDecisionTrees final : public InlineForSpeedBase {
                               const DecisionTreesConfig& config)
       : m_method_context_context(method_profiles),
         m_forest(std::move(forest)),
+        m_flat_forest(m_forest),
         m_config(config) {
     if (m_config.exp_force_top_x_entries) {
       fetch_top_entries(method_profiles);
     }
   }
 
+ public:
+  // Evaluates the forest for all candidates in one batch.
+  void prepare_candidates(
+      const std::vector<std::pair<const DexMethod*, const DexMethod*>>&
+          candidates) override {
+    std::vector<std::tuple<const MethodContext&, const MethodContext&>> inputs;
+    inputs.reserve(candidates.size());
+    for (auto [caller, callee] : candidates) {
+      inputs.emplace_back(get_or_create(caller), get_or_create(callee));
+    }
+    auto sums = m_flat_forest.evaluate(inputs);
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      auto [caller, callee] = candidates[i];
+      m_forest_sums[caller][callee] = sums[i];
+    }
+  }
+
  protected:
   bool should_inline_impl(const DexMethod* caller_method,
                           const DexMethod* callee_method) override {
@@ -465,8 +483,13 @@ class InlineForSpeedDecisionTrees final : public InlineForSpeedBase {
       }
     }
 
-    bool default_ret =
-        m_forest.accept(caller_context, callee_context, &accepted);
+    bool default_ret;
+    if (auto sum = get_forest_sum(caller_method, callee_method)) {
+      accepted = *sum;
+      default_ret = m_forest.accepts(accepted);
+    } else {
+      default_ret = m_forest.accept(caller_context, callee_context, &accepted);
+    }
     if (m_config.accept_threshold == 0) {
       return default_ret;
     }
@@ -533,6 +556,19 @@ class InlineForSpeedDecisionTrees final : public InlineForSpeedBase {
   }
 
  private:
+  boost::optional<float> get_forest_sum(const DexMethod* caller_method,
+                                        const DexMethod* callee_method) const {
+    auto it = m_forest_sums.find(caller_method);
+    if (it == m_forest_sums.end()) {
+      return boost::none;
+    }
+    auto callee_it = it->second.find(callee_method);
+    if (callee_it == it->second.end()) {
+      return boost::none;
+    }
+    return callee_it->second;
+  }
+
   const MethodContext& get_or_create(const DexMethod* m) {
     auto it = m_cache.find(m);
     if (it != m_cache.end()) {
@@ -659,6 +695,11 @@ class InlineForSpeedDecisionTrees final : public InlineForSpeedBase {
   MethodContextContext m_method_context_context;
   std::unordered_map<const DexMethod*, MethodContext> m_cache;
   PGIForest m_forest;
+  PGIForest::Flat m_flat_forest;
+  // Sums of the tree values for the candidates given to prepare_candidates.
+  std::unordered_map<const DexMethod*,
+                     std::unordered_map<const DexMethod*, float>>
+      m_forest_sums;
   DecisionTreesConfig m_config;
   std::vector<std::unordered_set<const DexMethodRef*>> top_n_entries;
   // Collect "yes" decisions based on methods, possibly to break chains later.
@@ -272,6 +272,16 @@ class NameGenerator {
   virtual void bind_names() {}
 
   int next_ctr() { return ctr; }
+
+ protected:
+  // Whether a member with the given name exists, as told by `lookup`. A name
+  // that was never interned cannot be in use, so we don't intern candidate
+  // names just to look them up.
+  template <typename Lookup>
+  static bool name_in_use(std::string_view name, const Lookup& lookup) {
+    const auto* dstr = DexString::get_string(name);
+    return dstr != nullptr && lookup(dstr);
+  }
 };
 
 // We define various "biased" comparators: We re-order fields and methods
@@ -323,9 +333,10 @@ class MethodNameGenerator : public NameGenerator<DexMethod*> {
         this->used_ids.insert(new_name);
         TRACE(OBFUSCATE, 3, "\tTrying method name %s for %s",
               std::string(wrap->get_name()).c_str(), SHOW(wrap->get()));
-      } while (DexMethod::get_method(wrap->get()->get_class(),
-                                     DexString::make_string(wrap->get_name()),
-                                     wrap->get()->get_proto()) != nullptr);
+      } while (name_in_use(wrap->get_name(), [&](const DexString* name) {
+        return DexMethod::get_method(wrap->get()->get_class(), name,
+                                     wrap->get()->get_proto()) != nullptr;
+      }));
       // Keep spinning on a name until you find one that isn't used at all
       TRACE(OBFUSCATE, 2,
             "\tIntending to rename method %s (%s) to %s ids to avoid %zu",
@@ -464,9 +475,10 @@ class FieldNameGenerator : public NameGenerator<DexField*> {
         this->used_ids.insert(new_name);
         TRACE(OBFUSCATE, 2, "\tTrying field name %s for %s",
               std::string(wrap->get_name()).c_str(), SHOW(wrap->get()));
-      } while (DexField::get_field(wrap->get()->get_class(),
-                                   DexString::make_string(wrap->get_name()),
-                                   wrap->get()->get_type()) != nullptr);
+      } while (name_in_use(wrap->get_name(), [&](const DexString* name) {
+        return DexField::get_field(wrap->get()->get_class(), name,
+                                   wrap->get()->get_type()) != nullptr;
+      }));
       // Keep spinning on a name until you find one that isn't used at all
       TRACE(OBFUSCATE,
             2,
@@ -526,7 +538,10 @@ class DexElemManager {
   // underlying DexFields. Does in-place modification. Returns the number
   // of elements renamed
   int commit_renamings_to_dex() {
-    std::unordered_set<T> renamed_elems;
+    // Index of each elem in `renames`, where a later renaming of the same elem
+    // replaces the earlier one.
+    std::unordered_map<T, size_t> renamed_elems;
+    std::vector<std::pair<R, const DexString*>> renames;
     int renamings = 0;
     for (auto& class_itr : this->elements) {
       for (auto& type_itr : class_itr.second) {
@@ -552,13 +567,18 @@ class DexElemManager {
             TRACE(OBFUSCATE, 2, "Found elem we've already renamed %s",
                   SHOW(elem));
           }
-          renamed_elems.insert(elem);
-          elem->change(ref_getter_fn(wrap->get_name()),
-                       false /* rename on collision */);
+          auto new_name = ref_getter_fn(wrap->get_name()).name;
+          auto [it, emplaced] = renamed_elems.emplace(elem, renames.size());
+          if (emplaced) {
+            renames.emplace_back(elem, new_name);
+          } else {
+            renames[it->second].second = new_name;
+          }
           renamings++;
         }
       }
     }
+    std::remove_pointer_t<R>::change_names(renames);
     return renamings;
   }
 
@@ -114,26 +114,31 @@ using RefsMap =
 // const std::string prefix = __Redex__";
 const std::string prefix;
 
-const DexString* get_name(int seed) {
+std::string get_name(int seed) {
   std::string name;
   obfuscate_utils::compute_identifier(seed, &name);
   if (!prefix.empty()) {
     name = prefix + name;
   }
-  return DexString::make_string(name);
+  return name;
 }
 
+// A stack trace element is the fully qualified name of a method, sans
+// parameters. Since external class names are unique, they are counted per
+// class, by method name.
+using StackTraceElements =
+    std::unordered_map<const DexType*,
+                       std::unordered_map<const DexString*, uint32_t>>;
+
 struct VirtualRenamer {
   VirtualRenamer(
       const ClassScopes& class_scopes,
       const RefsMap& def_refs,
-      std::unordered_map<std::string, uint32_t>* elms,
-      std::unordered_map<const DexType*, std::string>* cache,
+      StackTraceElements* elms,
       const std::unordered_map<const DexClass*, int>& next_dmethod_seeds)
       : class_scopes(class_scopes),
         def_refs(def_refs),
         stack_trace_elements(elms),
-        external_name_cache(cache),
         next_dmethod_seeds(next_dmethod_seeds) {}
 
   int rename_virtual_scopes(const DexType* type, int& seed);
@@ -149,17 +154,16 @@ struct VirtualRenamer {
   // their ref counts get updated, and if the ref count drops to 0 then its
   // entry is erased. When avoid_stack_trace_collision is false then this is
   // null and collision avoidance is disabled.
-  std::unordered_map<std::string, uint32_t>* stack_trace_elements;
-  // Note these entries contain trailing periods
-  std::unordered_map<const DexType*, std::string>* external_name_cache;
+  StackTraceElements* stack_trace_elements;
   const std::unordered_map<const DexClass*, int>& next_dmethod_seeds;
   mutable std::unordered_map<const VirtualScope*, int> next_virtualscope_seeds;
   mutable std::unordered_map<const DexType*, TypeSet> hier_cache;
 
-  const std::string& get_prefix(const DexType* type) const {
-    always_assert(external_name_cache != nullptr);
-    auto iter = external_name_cache->find(type);
-    always_assert(iter != external_name_cache->end());
+  std::unordered_map<const DexString*, uint32_t>& get_stack_trace_elements(
+      const DexType* type) const {
+    always_assert(stack_trace_elements != nullptr);
+    auto iter = stack_trace_elements->find(type);
+    always_assert(iter != stack_trace_elements->end());
     return iter->second;
   }
 
@@ -189,7 +193,8 @@ struct VirtualRenamer {
       const std::vector<const VirtualScope*>& scopes, int& seed) const;
   const DexString* get_unescaped_name(const VirtualScope* scope,
                                       int& seed) const;
-  bool usable_name(const DexString* name, const VirtualScope* scope) const;
+  bool usable_name(const std::string& name_str,
+                   const VirtualScope* scope) const;
 };
 
 /**
@@ -202,23 +207,22 @@ void VirtualRenamer::rename(DexMethodRef* meth, const DexString* name) {
   spec.name = name;
   spec.proto = meth->get_proto();
   if (stack_trace_elements) {
-    std::string ste = get_prefix(meth->get_class()) + meth->str();
-    auto iter = stack_trace_elements->find(ste);
+    auto& elements = get_stack_trace_elements(meth->get_class());
+    auto iter = elements.find(meth->get_name());
     // We don't find this ste if it's a miranda method
-    if (iter != stack_trace_elements->end()) {
+    if (iter != elements.end()) {
       // We've found this ste, so let's decrement its ref count, and if it
       // reaches 0 then remove it so we don't have any empty entries
       iter->second -= 1;
       if (iter->second == 0) {
-        stack_trace_elements->erase(iter);
+        elements.erase(iter);
       }
     }
   }
   meth->change(spec, false /* rename on collision */);
 
   if (stack_trace_elements) {
-    std::string ste = get_prefix(meth->get_class()) + name->str();
-    auto res = stack_trace_elements->emplace(std::move(ste), 1);
+    auto res = get_stack_trace_elements(meth->get_class()).emplace(name, 1);
     // Ideally we've picked a new name that doesn't collide with any other
     // method, so this assert should never fire. We leave this here in case
     // my human brain foobarred the logic (or in a refactor some other
@@ -264,8 +268,14 @@ int VirtualRenamer::rename_scope(const VirtualScope* scope,
  * A name is usable if it does not collide with an existing
  * one in the def and ref space.
  */
-bool VirtualRenamer::usable_name(const DexString* name,
+bool VirtualRenamer::usable_name(const std::string& name_str,
                                  const VirtualScope* scope) const {
+  // A name that was never interned cannot collide with any method, and we
+  // don't intern the names we reject.
+  const auto* name = DexString::get_string(name_str);
+  if (name == nullptr) {
+    return true;
+  }
   const auto root = scope->type;
   auto it = hier_cache.find(root);
   if (it == hier_cache.end()) {
@@ -281,11 +291,8 @@ bool VirtualRenamer::usable_name(const DexString* name,
         nullptr) {
       return false;
     }
-    if (has_ste) {
-      auto ste = get_prefix(type) + name->str();
-      if (stack_trace_elements->find(ste) != stack_trace_elements->end()) {
-        return false;
-      }
+    if (has_ste && get_stack_trace_elements(type).count(name) != 0) {
+      return false;
     }
   }
   return true;
@@ -303,7 +310,7 @@ const DexString* VirtualRenamer::get_unescaped_name(const VirtualScope* scope,
   while (!usable_name(name, scope)) {
     name = get_name(seed++);
   }
-  return name;
+  return DexString::make_string(name);
 }
 
 /*
@@ -328,7 +335,7 @@ const DexString* VirtualRenamer::get_unescaped_name(
     if (!is_usable) {
       continue;
     }
-    return name;
+    return DexString::make_string(name);
   }
 }
 
@@ -527,31 +534,32 @@ size_t rename_virtuals(
   scope_info(class_scopes);
   RefsMap def_refs;
   collect_refs(scope, def_refs);
-  std::unordered_map<std::string, uint32_t> stack_trace_elements;
-  std::unordered_map<const DexType*, std::string> external_cache;
+  StackTraceElements stack_trace_elements;
   if (avoid_stack_trace_collision) {
     for (const auto& cls : scope) {
-      std::string pref = java_names::internal_to_external(cls->str()) + ".";
+      auto emp_res = stack_trace_elements.emplace(
+          cls->get_type(), StackTraceElements::mapped_type());
+      always_assert(emp_res.second);
+    }
+    // The set of keys is fixed now, so each class can fill in its own entry.
+    walk::parallel::classes(scope, [&](DexClass* cls) {
+      auto& elements = stack_trace_elements.at(cls->get_type());
       auto meths_visitor = [&](const std::vector<DexMethod*>& methods) {
         for (const DexMethod* method : methods) {
-          std::string ste = pref + method->str();
           // We're 100% ok with the default construction of an entry here, since
           // after this line that would give said entry the correct ref count
           // of 1.
-          stack_trace_elements[std::move(ste)] += 1;
+          elements[method->get_name()] += 1;
         }
       };
       meths_visitor(cls->get_dmethods());
       meths_visitor(cls->get_vmethods());
-      auto emp_res = external_cache.emplace(cls->get_type(), std::move(pref));
-      always_assert(emp_res.second);
-    }
+    });
   }
   VirtualRenamer vr(class_scopes,
                     def_refs,
                     avoid_stack_trace_collision ? &stack_trace_elements
                                                 : nullptr,
-                    avoid_stack_trace_collision ? &external_cache : nullptr,
                     next_dmethod_seeds);
 
   // rename virtual only first
@@ -39,6 +39,11 @@
  *   fully inlined, and the fields of allocated objects got turned into
  *   registers (and the transformation does not produce estimated negative net
  *   savings)
+ *
+ * Root methods that are hot in the cold-start profile favor scalar
+ * replacement over inlining: Large callees that only read fields of an
+ * allocated object get specialized to take the field values as arguments,
+ * instead of being inlined.
  */
 
 #include "ObjectEscapeAnalysis.h"
@@ -95,6 +100,10 @@ constexpr int64_t COST_NEW_INSTANCE = 20;
 // Minimum savings required to select a reduced method variant.
 constexpr int64_t SAVINGS_THRESHOLD = 0;
 
+// Minimum cold-start appear100 of a root method for it to be considered hot.
+// The default disables it.
+constexpr float HOT_ROOT_METHOD_APPEAR100_THRESHOLD = 101.0;
+
 using InlineAnchorsOfType =
     std::unordered_map<DexMethod*, std::unordered_set<IRInstruction*>>;
 ConcurrentMap<DexType*, InlineAnchorsOfType> compute_inline_anchors(
@@ -683,9 +692,10 @@ size_t shrink_root_methods(
       method_summaries->erase(method);
     }
   }
-  if (!methods_that_lost_allocation_insns.empty()) {
-    method_summary_cache->clear();
-  }
+  invalidate_method_summary_cache(
+      std::unordered_set<DexMethod*>(methods_that_lost_allocation_insns.begin(),
+                                     methods_that_lost_allocation_insns.end()),
+      method_summary_cache);
   return methods_that_lost_allocation_insns.size();
 }
 
@@ -708,10 +718,12 @@ struct Stats {
   std::atomic<size_t> stackify_returns_objects{0};
   std::atomic<size_t> too_costly_globally{0};
   std::atomic<size_t> expanded_methods{0};
+  std::atomic<size_t> hot_invokes_expanded{0};
   std::atomic<size_t> calls_inlined{0};
   std::atomic<size_t> new_instances_eliminated{0};
   size_t inlined_methods_removed{0};
   size_t inlinable_methods_kept{0};
+  size_t hot_root_methods{0};
 };
 
 struct ReducedMethodVariant {
@@ -829,6 +841,7 @@ class RootMethodReducer {
   const std::unordered_set<DexClass*>& m_excluded_classes;
   Stats* m_stats;
   bool m_is_init_or_clinit;
+  bool m_is_hot;
   DexMethod* m_method;
   const InlinableTypes& m_types;
   std::vector<DexType*> m_types_vec;
@@ -850,6 +863,7 @@ class RootMethodReducer {
       const std::unordered_set<DexClass*>& excluded_classes,
       Stats* stats,
       bool is_init_or_clinit,
+      bool is_hot,
       DexMethod* method,
       const InlinableTypes& types,
       CalleesCache* callees_cache,
@@ -865,6 +879,7 @@ class RootMethodReducer {
         m_excluded_classes(excluded_classes),
         m_stats(stats),
         m_is_init_or_clinit(is_init_or_clinit),
+        m_is_hot(is_hot),
         m_method(method),
         m_types(types),
         m_callees_cache(callees_cache),
@@ -1171,9 +1186,16 @@ class RootMethodReducer {
     auto [param_index, type] = *src_indices.begin();
     auto kind = m_types.at(type).kind;
     bool multiples = kind == InlinableTypeKind::CompleteMultipleRoots;
-    if (multiples && m_code_size_cache[callee] > m_config.max_inline_size &&
+    // In hot root methods, we also expand large callees of types with a single
+    // root, so that the allocation can go away without growing the hot method
+    // by the inlined callee.
+    if ((multiples || m_is_hot) &&
+        m_code_size_cache[callee] > m_config.max_inline_size &&
         m_expandable_method_params.get_expanded_method_ref(callee,
                                                            param_index)) {
+      if (!multiples) {
+        m_stats->hot_invokes_expanded++;
+      }
       return true;
     }
     return false;
@@ -1544,6 +1566,7 @@ compute_reduced_methods(
     const MethodSummaries& method_summaries,
     const std::unordered_set<DexClass*>& excluded_classes,
     const std::unordered_map<DexMethod*, InlinableTypes>& root_methods,
+    const std::unordered_set<DexMethod*>& hot_root_methods,
     const std::unordered_map<DexType*, size_t>& inlinable_type_index,
     std::unordered_set<DexType*>* irreducible_types,
     std::unordered_set<DexMethod*>* inlinable_methods_kept,
@@ -1606,6 +1629,8 @@ compute_reduced_methods(
                                               stats,
                                               method::is_init(method) ||
                                                   method::is_clinit(method),
+                                              hot_root_methods.count(method) !=
+                                                  0,
                                               copy,
                                               types,
                                               callees_cache,
@@ -1913,6 +1938,25 @@ void select_reduced_methods(
   }
 }
 
+// Root methods whose cold-start appear100 reaches the configured threshold.
+std::unordered_set<DexMethod*> get_hot_root_methods(
+    const ObjectEscapeConfig& config,
+    const std::unordered_map<DexMethod*, InlinableTypes>& root_methods,
+    const method_profiles::MethodProfiles& profiles) {
+  std::unordered_set<DexMethod*> hot_root_methods;
+  if (!profiles.has_stats()) {
+    return hot_root_methods;
+  }
+  for (auto&& [method, _] : root_methods) {
+    auto stat = profiles.get_method_stat(method_profiles::COLD_START, method);
+    if (stat &&
+        stat->appear_percent >= config.hot_root_method_appear100_threshold) {
+      hot_root_methods.insert(method);
+    }
+  }
+  return hot_root_methods;
+}
+
 void reduce(const Scope& scope,
             const ObjectEscapeConfig& config,
             const std::function<void(DexMethod*)>& apply_shrinking_plugins,
@@ -1939,12 +1983,16 @@ void reduce(const Scope& scope,
     inlinable_type_index.emplace(type, inlinable_type_index.size());
   }
 
+  auto hot_root_methods =
+      get_hot_root_methods(config, root_methods, *method_profiles);
+  stats->hot_root_methods = hot_root_methods.size();
+
   ExpandableMethodParams expandable_method_params(scope);
   std::unordered_set<DexType*> irreducible_types;
   auto reduced_methods = compute_reduced_methods(
       config, apply_shrinking_plugins, method_override_graph,
       expandable_method_params, inliner, method_summaries, excluded_classes,
-      root_methods, inlinable_type_index, &irreducible_types,
+      root_methods, hot_root_methods, inlinable_type_index, &irreducible_types,
       inlinable_methods_kept, stats, callees_cache, method_summary_cache);
   stats->reduced_methods = reduced_methods.size();
 
@@ -2006,6 +2054,9 @@ void ObjectEscapeAnalysisPass::bind_config() {
   bind("cost_move_result", COST_MOVE_RESULT, m_config.cost_move_result);
   bind("cost_new_instance", COST_NEW_INSTANCE, m_config.cost_new_instance);
   bind("savings_threshold", SAVINGS_THRESHOLD, m_config.savings_threshold);
+  bind("hot_root_method_appear100_threshold",
+       HOT_ROOT_METHOD_APPEAR100_THRESHOLD,
+       m_config.hot_root_method_appear100_threshold);
 }
 
 void ObjectEscapeAnalysisPass::run_pass(DexStoresVector& stores,
@@ -2153,6 +2204,8 @@ void ObjectEscapeAnalysisPass::run_pass(DexStoresVector& stores,
   mgr.incr_metric("root_method_too_costly_globally",
                   (size_t)stats.too_costly_globally);
   mgr.incr_metric("expanded_methods", (size_t)stats.expanded_methods);
+  mgr.incr_metric("hot_root_methods", stats.hot_root_methods);
+  mgr.incr_metric("hot_invokes_expanded", (size_t)stats.hot_invokes_expanded);
   mgr.incr_metric("calls_inlined", (size_t)stats.calls_inlined);
   mgr.incr_metric("new_instances_eliminated",
                   (size_t)stats.new_instances_eliminated);
@@ -20,6 +20,7 @@ struct ObjectEscapeConfig {
   int64_t cost_move_result;
   int64_t cost_new_instance;
   int64_t savings_threshold;
+  float hot_root_method_appear100_threshold;
 };
 
 class ObjectEscapeAnalysisPass : public Pass {
@@ -284,6 +284,25 @@ const MethodSummary* get_or_create_method_summary(
       .first;
 }
 
+void invalidate_method_summary_cache(
+    const std::unordered_set<DexMethod*>& changed_methods,
+    MethodSummaryCache* method_summary_cache) {
+  if (changed_methods.empty()) {
+    return;
+  }
+  std::vector<const Callees*> stale;
+  for (auto&& [callees, _] : *method_summary_cache) {
+    if (std::any_of(
+            callees->with_code.begin(), callees->with_code.end(),
+            [&](DexMethod* method) { return changed_methods.count(method); })) {
+      stale.push_back(callees);
+    }
+  }
+  for (const auto* callees : stale) {
+    method_summary_cache->erase_unsafe(callees);
+  }
+}
+
 const MethodSummary* resolve_invoke_method_summary(
     const method_override_graph::Graph& method_override_graph,
     const MethodSummaries& method_summaries,
@@ -481,6 +500,9 @@ MethodSummaries compute_method_summaries(
   }
 
   MethodSummaries method_summaries;
+  // Cached summaries of callee sets are only invalidated for the methods whose
+  // summaries change in an iteration.
+  method_summary_cache->clear();
   *analysis_iterations = 0;
   while (!impacted_methods.empty()) {
     Timer t2("analysis iteration");
@@ -489,7 +511,6 @@ MethodSummaries compute_method_summaries(
           *analysis_iterations);
     InsertOnlyConcurrentMap<DexMethod*, MethodSummary>
         recomputed_method_summaries;
-    *method_summary_cache = MethodSummaryCache();
     workqueue_run<DexMethod*>(
         [&](DexMethod* method) {
           MethodSummary ms;
@@ -559,6 +580,7 @@ MethodSummaries compute_method_summaries(
         always_assert(!summary.returns_allocation_or_param());
       }
     }
+    invalidate_method_summary_cache(changed_methods, method_summary_cache);
     impacted_methods.clear();
     for (auto method : changed_methods) {
       auto it = dependencies.find(method);
@@ -124,6 +124,12 @@ using MethodSummaries = std::unordered_map<DexMethod*, MethodSummary>;
 using MethodSummaryCache =
     InsertOnlyConcurrentMap<const Callees*, MethodSummary>;
 
+// Removes the cached summaries of all callee sets that involve any of the
+// given methods. Other cached summaries remain valid.
+void invalidate_method_summary_cache(
+    const std::unordered_set<DexMethod*>& changed_methods,
+    MethodSummaryCache* method_summary_cache);
+
 const MethodSummary* resolve_invoke_method_summary(
     const method_override_graph::Graph& method_override_graph,
     const MethodSummaries& method_summaries,
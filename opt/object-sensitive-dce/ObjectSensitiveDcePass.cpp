@@ -19,6 +19,7 @@
 #include "InitClassesWithSideEffects.h"
 #include "LocalPointersAnalysis.h"
 #include "ObjectSensitiveDce.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "PassManager.h"
 #include "Purity.h"
 #include "ScopedCFG.h"
@@ -36,9 +37,14 @@ void ObjectSensitiveDcePass::run_pass(DexStoresVector& stores,
       "init-class instructions.");
 
   auto scope = build_class_scope(stores);
-  auto method_override_graph = method_override_graph::build_graph(scope);
-  init_classes::InitClassesWithSideEffects init_classes_with_side_effects(
-      scope, conf.create_init_class_insns(), method_override_graph.get());
+  auto method_override_graph =
+      MethodOverrideGraphAnalysisPass::get_or_build(mgr, scope);
+  auto init_classes_with_side_effects_ptr =
+      InitClassesAnalysisPass::get_or_build(mgr, scope,
+                                            conf.create_init_class_insns(),
+                                            method_override_graph.get());
+  const auto& init_classes_with_side_effects =
+      *init_classes_with_side_effects_ptr;
 
   auto pure_methods = get_pure_methods();
   auto configured_pure_methods = conf.get_pure_methods();
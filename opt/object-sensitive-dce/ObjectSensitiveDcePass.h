@@ -9,6 +9,8 @@
 
 #include <optional>
 
+#include "InitClassesAnalysisPass.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Pass.h"
 #include "Trace.h"
 
@@ -42,6 +44,11 @@ class ObjectSensitiveDcePass final : public Pass {
     }
   }
 
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+    au.add_preserve_specific<InitClassesAnalysisPass>();
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
  private:
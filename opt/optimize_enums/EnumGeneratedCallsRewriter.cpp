@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "EnumGeneratedCallsRewriter.h"
+
+#include "ConcurrentContainers.h"
+#include "ControlFlow.h"
+#include "DexAccess.h"
+#include "EnumClinitAnalysis.h"
+#include "EnumUpcastAnalysis.h"
+#include "IRCode.h"
+#include "LiveRange.h"
+#include "MethodUtil.h"
+#include "Resolver.h"
+#include "Show.h"
+#include "Trace.h"
+#include "Walkers.h"
+
+namespace {
+
+using namespace optimize_enums;
+
+/**
+ * Returns the `$VALUES` field if `values()` has the generated shape
+ *
+ *   sget-object LSubEnum;.$VALUES:[LSubEnum;
+ *   invoke-virtual [LSubEnum;.clone:()Ljava/lang/Object;
+ *   check-cast [LSubEnum;
+ *   return-object
+ *
+ * and nullptr otherwise.
+ */
+DexField* get_values_field(const DexClass* cls, const DexMethod* method) {
+  auto* code = method->get_code();
+  if (code == nullptr) {
+    return nullptr;
+  }
+  DexField* field = nullptr;
+  for (const auto& mie : cfg::ConstInstructionIterable(code->cfg())) {
+    auto* insn = mie.insn;
+    switch (insn->opcode()) {
+    case OPCODE_SGET_OBJECT:
+      if (field != nullptr) {
+        return nullptr;
+      }
+      field = resolve_field(insn->get_field(), FieldSearch::Static);
+      if (field == nullptr) {
+        return nullptr;
+      }
+      break;
+    case OPCODE_INVOKE_VIRTUAL:
+      if (insn->get_method()->str() != "clone") {
+        return nullptr;
+      }
+      break;
+    case IOPCODE_MOVE_RESULT_PSEUDO_OBJECT:
+    case OPCODE_MOVE_RESULT_OBJECT:
+    case OPCODE_MOVE_OBJECT:
+    case OPCODE_CHECK_CAST:
+    case OPCODE_RETURN_OBJECT:
+      break;
+    default:
+      return nullptr;
+    }
+  }
+  if (field == nullptr || field->get_class() != cls->get_type() ||
+      field->get_type() != type::make_array_type(cls->get_type()) ||
+      !check_required_access_flags(synth_access(), field->get_access())) {
+    return nullptr;
+  }
+  return field;
+}
+
+/**
+ * Returns true if `valueOf()` has the generated shape
+ *
+ *   load-param-object v0
+ *   const-class LSubEnum;
+ *   invoke-static Ljava/lang/Enum;.valueOf:(Ljava/lang/Class;...)
+ *   check-cast LSubEnum;
+ *   return-object
+ */
+bool is_generated_valueof(const DexClass* cls, const DexMethod* method) {
+  auto* code = method->get_code();
+  if (code == nullptr) {
+    return false;
+  }
+  auto* enum_valueof = DexMethod::get_method(
+      "Ljava/lang/Enum;.valueOf:(Ljava/lang/Class;Ljava/lang/String;)Ljava/"
+      "lang/Enum;");
+  size_t num_invokes = 0;
+  for (const auto& mie : cfg::ConstInstructionIterable(code->cfg())) {
+    auto* insn = mie.insn;
+    switch (insn->opcode()) {
+    case OPCODE_CONST_CLASS:
+      if (insn->get_type() != cls->get_type()) {
+        return false;
+      }
+      break;
+    case OPCODE_INVOKE_STATIC:
+      if (insn->get_method() != enum_valueof) {
+        return false;
+      }
+      num_invokes++;
+      break;
+    case IOPCODE_LOAD_PARAM_OBJECT:
+    case IOPCODE_MOVE_RESULT_PSEUDO_OBJECT:
+    case OPCODE_MOVE_RESULT_OBJECT:
+    case OPCODE_MOVE_OBJECT:
+    case OPCODE_CHECK_CAST:
+    case OPCODE_RETURN_OBJECT:
+      break;
+    default:
+      return false;
+    }
+  }
+  return num_invokes == 1;
+}
+
+/**
+ * Returns true if the array returned by `invoke` is used and all its uses only
+ * read from it.
+ */
+bool is_only_read(const live_range::DefUseChains& du_chains,
+                  IRInstruction* invoke) {
+  auto it = du_chains.find(invoke);
+  if (it == du_chains.end() || it->second.empty()) {
+    return false;
+  }
+  for (const auto& use : it->second) {
+    switch (use.insn->opcode()) {
+    case OPCODE_ARRAY_LENGTH:
+    case OPCODE_MOVE_OBJECT:
+      break;
+    case OPCODE_AGET_OBJECT:
+      if (use.src_index != 0) {
+        return false;
+      }
+      break;
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+namespace optimize_enums {
+
+EnumGeneratedCallsRewriter::Stats&
+EnumGeneratedCallsRewriter::Stats::operator+=(const Stats& that) {
+  values_calls += that.values_calls;
+  valueof_calls += that.valueof_calls;
+  return *this;
+}
+
+bool EnumGeneratedCallsRewriter::consider_enum(
+    const DexClass* cls, bool support_kt_19_enum_entries) {
+  if (!is_enum(cls) || cls->is_external()) {
+    return false;
+  }
+  bool considered = false;
+  for (auto* method : cls->get_dmethods()) {
+    if (is_enum_values(method)) {
+      if (auto* field = get_values_field(cls, method)) {
+        m_values_fields.emplace(method, field);
+        considered = true;
+      }
+    } else if (is_enum_valueof(method) && is_generated_valueof(cls, method)) {
+      auto* clinit = cls->get_clinit();
+      if (clinit == nullptr || clinit->get_code() == nullptr) {
+        continue;
+      }
+      // Only Kotlin 1.9 enums have a second synthetic field, which the clinit
+      // analysis expects to know about.
+      auto synth_fields = std::count_if(
+          cls->get_sfields().begin(), cls->get_sfields().end(), [](auto* f) {
+            return check_required_access_flags(synth_access(),
+                                               f->get_access());
+          });
+      if (synth_fields > 1 && !support_kt_19_enum_entries) {
+        continue;
+      }
+      auto attributes = analyze_enum_clinit(cls, support_kt_19_enum_entries);
+      std::unordered_map<const DexString*, DexField*> constants;
+      bool unique_names = true;
+      for (const auto& [field_ref, constant] : attributes.m_constants_map) {
+        auto* field = const_cast<DexFieldRef*>(field_ref)->as_def();
+        unique_names &= field != nullptr &&
+                        constants.emplace(constant.name, field).second;
+      }
+      if (unique_names && !constants.empty()) {
+        m_valueof_constants.emplace(method, std::move(constants));
+        considered = true;
+      }
+    }
+  }
+  return considered;
+}
+
+EnumGeneratedCallsRewriter::Stats EnumGeneratedCallsRewriter::rewrite(
+    const DexType* caller,
+    cfg::ControlFlowGraph& cfg,
+    std::unordered_set<DexField*>* fields_to_publicize) const {
+  Stats stats;
+  live_range::MoveAwareChains chains(cfg);
+  auto du_chains = chains.get_def_use_chains();
+  auto ud_chains = chains.get_use_def_chains();
+
+  std::vector<std::pair<IRInstruction*, DexField*>> replacements;
+  auto ii = cfg::InstructionIterable(cfg);
+  for (auto it = ii.begin(); it != ii.end(); ++it) {
+    auto* insn = it->insn;
+    if (insn->opcode() != OPCODE_INVOKE_STATIC ||
+        cfg.move_result_of(it).is_end()) {
+      continue;
+    }
+    auto* callee = resolve_method(insn->get_method(), MethodSearch::Static);
+    if (callee == nullptr) {
+      continue;
+    }
+
+    auto values_it = m_values_fields.find(callee);
+    if (values_it != m_values_fields.end()) {
+      if (!is_only_read(du_chains, insn)) {
+        continue;
+      }
+      auto* field = values_it->second;
+      if (field->get_class() != caller && !is_public(field)) {
+        fields_to_publicize->insert(field);
+      }
+      replacements.emplace_back(insn, field);
+      stats.values_calls++;
+      continue;
+    }
+
+    auto valueof_it = m_valueof_constants.find(callee);
+    if (valueof_it == m_valueof_constants.end()) {
+      continue;
+    }
+    auto defs_it = ud_chains.find(live_range::Use{insn, 0});
+    if (defs_it == ud_chains.end() || defs_it->second.size() != 1) {
+      continue;
+    }
+    auto* def = *defs_it->second.begin();
+    if (def->opcode() != OPCODE_CONST_STRING) {
+      continue;
+    }
+    auto constant_it = valueof_it->second.find(def->get_string());
+    if (constant_it == valueof_it->second.end()) {
+      continue;
+    }
+    auto* field = constant_it->second;
+    if (field->get_class() != caller && !is_public(field)) {
+      continue;
+    }
+    replacements.emplace_back(insn, field);
+    stats.valueof_calls++;
+  }
+
+  for (auto [insn, field] : replacements) {
+    auto it = cfg.find_insn(insn);
+    auto dest = cfg.move_result_of(it)->insn->dest();
+    TRACE(ENUM, 4, "Replacing %s with a read of %s", SHOW(insn), SHOW(field));
+    cfg.replace_insns(
+        it,
+        {(new IRInstruction(OPCODE_SGET_OBJECT))->set_field(field),
+         (new IRInstruction(IOPCODE_MOVE_RESULT_PSEUDO_OBJECT))
+             ->set_dest(dest)});
+  }
+  return stats;
+}
+
+EnumGeneratedCallsRewriter::Stats EnumGeneratedCallsRewriter::transform_code(
+    const Scope& scope) const {
+  if (m_values_fields.empty() && m_valueof_constants.empty()) {
+    return Stats{};
+  }
+  ConcurrentSet<DexField*> fields_to_publicize;
+  auto stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* method) {
+    auto* code = method->get_code();
+    if (code == nullptr) {
+      return Stats{};
+    }
+    // The enum's $VALUES is not yet initialized in the middle of its clinit.
+    auto* cls = type_class(method->get_class());
+    if (method::is_clinit(method) && cls != nullptr && is_enum(cls)) {
+      return Stats{};
+    }
+    std::unordered_set<DexField*> fields;
+    auto method_stats = rewrite(method->get_class(), code->cfg(), &fields);
+    for (auto* field : fields) {
+      fields_to_publicize.insert(field);
+    }
+    return method_stats;
+  });
+  for (auto* field : fields_to_publicize) {
+    set_public(field);
+  }
+  return stats;
+}
+
+} // namespace optimize_enums
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include "DexClass.h"
+
+namespace cfg {
+class ControlFlowGraph;
+} // namespace cfg
+
+namespace optimize_enums {
+
+/**
+ * Enums that are not replaced by Integer objects still pay for their
+ * generated static methods at runtime:
+ * - `SubEnum.values()` clones the synthetic `$VALUES` array on every call, so
+ *   that callers can't modify the enum's own copy.
+ * - `SubEnum.valueOf(String)` looks the name up in a map built reflectively by
+ *   `Enum.valueOf(Class, String)`.
+ *
+ * This rewrites
+ * - calls to `values()` whose result is only read (`array-length` and
+ *   `aget-object`, possibly through moves) into a read of `$VALUES`, and
+ * - calls to `valueOf()` on a constant string naming one of the enum
+ *   constants into a read of that constant's field.
+ *
+ * Only enums whose generated methods have the shape emitted by javac and
+ * kotlinc are considered. `$VALUES` is made public when it gets read outside
+ * of its enum class.
+ */
+class EnumGeneratedCallsRewriter {
+ public:
+  struct Stats {
+    size_t values_calls{0};
+    size_t valueof_calls{0};
+
+    Stats& operator+=(const Stats&);
+  };
+
+  /**
+   * Registers the generated methods of the enum class if they have the
+   * expected shape. Returns true if at least one of them was registered.
+   */
+  bool consider_enum(const DexClass* cls, bool support_kt_19_enum_entries);
+
+  /**
+   * Rewrites the calls to the registered methods in the given code of a method
+   * of `caller`. Fields that need to become public for the rewritten code to
+   * be accessible are added to `fields_to_publicize`.
+   */
+  Stats rewrite(const DexType* caller,
+                cfg::ControlFlowGraph& cfg,
+                std::unordered_set<DexField*>* fields_to_publicize) const;
+
+  /**
+   * Rewrites the calls in the whole scope and publicizes the `$VALUES` fields
+   * that are read outside of their class.
+   */
+  Stats transform_code(const Scope& scope) const;
+
+ private:
+  // values() -> $VALUES
+  std::unordered_map<const DexMethod*, DexField*> m_values_fields;
+  // valueOf() -> enum constant name -> enum constant field
+  std::unordered_map<const DexMethod*,
+                     std::unordered_map<const DexString*, DexField*>>
+      m_valueof_constants;
+};
+
+} // namespace optimize_enums
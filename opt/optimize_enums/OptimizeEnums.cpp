@@ -19,6 +19,7 @@
 #include "DexClass.h"
 #include "EnumAnalyzeGeneratedMethods.h"
 #include "EnumClinitAnalysis.h"
+#include "EnumGeneratedCallsRewriter.h"
 #include "EnumTransformer.h"
 #include "EnumUpcastAnalysis.h"
 #include "IRCode.h"
@@ -74,6 +75,10 @@ constexpr const char* METRIC_NUM_CANDIDATE_GENERATED_METHODS =
     "num_candidate_generated_enum_methods";
 constexpr const char* METRIC_NUM_REMOVED_GENERATED_METHODS =
     "num_removed_generated_enum_methods";
+constexpr const char* METRIC_NUM_REWRITTEN_VALUES_CALLS =
+    "num_rewritten_values_calls";
+constexpr const char* METRIC_NUM_REWRITTEN_VALUEOF_CALLS =
+    "num_rewritten_valueof_calls";
 
 /**
  * Simple analysis to determine which of the enums ctor argument
@@ -236,7 +241,9 @@ void collect_generated_switch_cases(
                   .src(1, look, uniq)
                   .src(2, ordi, uniq);
 
-  auto res = f.find(clinit_cfg, aput);
+  // Both queries below run against the unchanged clinit.
+  mf::use_defs_t use_defs(clinit_cfg);
+  auto res = f.find(use_defs, aput);
 
   std::unordered_map<IRInstruction*, IRInstruction*> new_array_to_sput;
   for (auto* insn_look : res.matching(look)) {
@@ -255,7 +262,7 @@ void collect_generated_switch_cases(
     auto newa = g.insn(m::in<IRInstruction*>(new_array_to_sput));
     auto sput = g.insn(m_sput_lookup).src(0, newa, uniq);
 
-    auto res_sputs = g.find(clinit_cfg, sput);
+    auto res_sputs = g.find(use_defs, sput);
     for (auto* insn_sput : res_sputs.matching(sput)) {
       auto* insn_newa = res_sputs.matching(sput, insn_sput, 0).unique();
       new_array_to_sput[insn_newa] = insn_sput;
@@ -370,6 +377,10 @@ class OptimizeEnums {
            m_stats.num_candidate_generated_methods);
     report(METRIC_NUM_REMOVED_GENERATED_METHODS,
            m_stats.num_removed_generated_methods);
+    report(METRIC_NUM_REWRITTEN_VALUES_CALLS,
+           m_stats.num_rewritten_values_calls);
+    report(METRIC_NUM_REWRITTEN_VALUEOF_CALLS,
+           m_stats.num_rewritten_valueof_calls);
     report("num_all_enum_classes", m_stats.num_all_enum_classes);
     report("num_all_kotlin_enum_classes", m_stats.num_kotlin_enum_classes);
   }
@@ -529,6 +540,20 @@ class OptimizeEnums {
     m_stats.num_enum_classes = config.candidate_enums.size();
   }
 
+  /**
+   * Replace calls to `values()` and `valueOf()` of the remaining enums with
+   * static field reads when the result does not need a copy or a lookup.
+   */
+  void rewrite_enum_generated_method_calls(bool support_kt_19_enum_entries) {
+    optimize_enums::EnumGeneratedCallsRewriter rewriter;
+    for (auto* cls : m_scope) {
+      rewriter.consider_enum(cls, support_kt_19_enum_entries);
+    }
+    auto stats = rewriter.transform_code(m_scope);
+    m_stats.num_rewritten_values_calls = stats.values_calls;
+    m_stats.num_rewritten_valueof_calls = stats.valueof_calls;
+  }
+
   /**
    * Remove the static methods `valueOf()` and `values()` when safe.
    */
@@ -908,6 +933,8 @@ class OptimizeEnums {
     std::atomic<size_t> num_switch_equiv_finder_failures{0};
     size_t num_candidate_generated_methods{0};
     size_t num_removed_generated_methods{0};
+    size_t num_rewritten_values_calls{0};
+    size_t num_rewritten_valueof_calls{0};
     size_t num_all_enum_classes{0};
     size_t num_kotlin_enum_classes{0};
   };
@@ -933,6 +960,11 @@ void OptimizeEnumsPass::bind_config() {
   bind("skip_sanity_check", false, m_skip_sanity_check, "May skip some check.");
   bind("support_kt_19_enum_entries", false, m_support_kt_19_enum_entries,
        "Try to optimize Kotlin 1.9 Enums with EnumEntries feature.");
+  bind("rewrite_generated_method_calls", false,
+       m_rewrite_generated_method_calls,
+       "Replace calls to values() whose result is only read with reads of the "
+       "$VALUES array, and calls to valueOf() on constant names with reads of "
+       "the enum fields. This makes $VALUES public where needed.");
 }
 
 void OptimizeEnumsPass::run_pass(DexStoresVector& stores,
@@ -944,6 +976,9 @@ void OptimizeEnumsPass::run_pass(DexStoresVector& stores,
   opt_enums.replace_enum_with_int(
       mgr, m_max_enum_size, m_skip_sanity_check, m_support_kt_19_enum_entries,
       m_enum_to_integer_allowlist, conf, unsafe_counts);
+  if (m_rewrite_generated_method_calls) {
+    opt_enums.rewrite_enum_generated_method_calls(m_support_kt_19_enum_entries);
+  }
   opt_enums.remove_enum_generated_methods();
   opt_enums.stats(mgr);
   for (auto& p : unsafe_counts) {
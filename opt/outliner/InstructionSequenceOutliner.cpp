@@ -65,6 +65,7 @@
 #include "InstructionSequenceOutliner.h"
 
 #include <algorithm>
+#include <limits>
 #include <list>
 #include <map>
 #include <memory>
@@ -104,6 +105,7 @@
 #include "ReachingInitializeds.h"
 #include "RedexContext.h"
 #include "RefChecker.h"
+#include "RepeatFinder.h"
 #include "Resolver.h"
 #include "Show.h"
 #include "StlUtil.h"
@@ -339,6 +341,14 @@ using CandidateInstructionCoresSet =
     std::unordered_set<CandidateInstructionCores,
                        CandidateInstructionCoresHasher>;
 
+// What we know about the recurring instruction sequences of a dex: the set of
+// recurring cores, and, for each outlinable instruction in a big block we may
+// outline from, the length of the longest recurring sequence starting at it.
+struct RecurringSequences {
+  CandidateInstructionCoresSet cores;
+  std::unordered_map<const IRInstruction*, uint32_t> repeat_lengths;
+};
+
 // The cores builder efficiently keeps track of the last MIN_INSNS_SIZE many
 // instructions.
 class CandidateInstructionCoresBuilder {
@@ -796,7 +806,7 @@ static bool explore_candidates_from(
         reaching_initialized_init_first_param,
     const Config& config,
     const RefChecker& ref_checker,
-    const CandidateInstructionCoresSet& recurring_cores,
+    const RecurringSequences& recurring,
     PartialCandidate* pc,
     PartialCandidateNode* pcn,
     big_blocks::InstructionIterator it,
@@ -806,6 +816,17 @@ static bool explore_candidates_from(
   CandidateInstructionCoresBuilder cores_builder;
   auto first_block = it.block();
   auto& cfg = first_block->cfg();
+  // We explore a big block in the order in which its instructions were
+  // tokenized, so no sequence we find here can recur if it is longer than the
+  // longest repeat starting at the first instruction.
+  uint32_t max_repeat_length = std::numeric_limits<uint32_t>::max();
+  if (it != end) {
+    auto repeat_it = recurring.repeat_lengths.find(it->insn);
+    if (repeat_it != recurring.repeat_lengths.end()) {
+      max_repeat_length = repeat_it->second;
+    }
+  }
+  uint32_t explored_insns{0};
   for (; it != end; prev_opcode = it->insn->opcode(), it++) {
     if (pc->insns_size >= config.max_insns_size) {
       return false;
@@ -816,9 +837,12 @@ static bool explore_candidates_from(
                           insn, config.outline_control_flow)) {
       return false;
     }
+    if (++explored_insns > max_repeat_length) {
+      return false;
+    }
     cores_builder.push_back(insn);
     if (cores_builder.has_value() &&
-        !recurring_cores.count(cores_builder.get_value())) {
+        !recurring.cores.count(cores_builder.get_value())) {
       return false;
     }
     if (!append_to_partial_candidate(reaching_initialized_new_instances, insn,
@@ -858,7 +882,7 @@ static bool explore_candidates_from(
           auto succ_ii = big_blocks::InstructionIterable(*succ_big_block);
           if (!explore_candidates_from(reaching_initialized_new_instances,
                                        reaching_initialized_init_first_param,
-                                       config, ref_checker, recurring_cores, pc,
+                                       config, ref_checker, recurring, pc,
                                        succ_pcn.get(), succ_ii.begin(),
                                        succ_ii.end())) {
             return false;
@@ -936,7 +960,7 @@ static MethodCandidates find_method_candidates(
     const CanOutlineBlockDecider& block_decider,
     DexMethod* method,
     cfg::ControlFlowGraph& cfg,
-    const CandidateInstructionCoresSet& recurring_cores,
+    const RecurringSequences& recurring,
     FindCandidatesStats* stats) {
   MethodCandidates candidates;
   Lazy<LivenessFixpointIterator> liveness_fp_iter([&cfg] {
@@ -1169,7 +1193,7 @@ static MethodCandidates find_method_candidates(
       PartialCandidate pc;
       explore_candidates_from(reaching_initialized_new_instances,
                               reaching_initialized_init_first_param, config,
-                              ref_checker, recurring_cores, &pc, &pc.root, it,
+                              ref_checker, recurring, &pc, &pc.root, it,
                               end, &explored_callback);
     }
   }
@@ -1194,9 +1218,62 @@ static bool can_outline_from_method(DexMethod* method) {
   return true;
 }
 
+// We keep track of outlined methods that reside in earlier dexes of the current
+// store. Order vector is used for keeping the track of the order of each
+// candidate stored.
+struct ReusableOutlinedMethods {
+  struct OutlinedMethod {
+    const DexStore* store;
+    DexMethod* method;
+    std::set<uint32_t> pattern_ids;
+  };
+  std::unordered_map<Candidate, std::deque<OutlinedMethod>, CandidateHasher>
+      map;
+  std::vector<Candidate> order;
+};
+
+// Interns instruction cores as tokens for repeat finding. Every separator gets
+// a fresh token, so that no repeat can span it.
+class CandidateInstructionTokenizer {
+ public:
+  void push_back(const CandidateInstructionCore& core) {
+    auto it = m_ids.find(core);
+    if (it == m_ids.end()) {
+      it = m_ids.emplace(core, m_next_id++).first;
+    }
+    m_tokens.push_back(it->second);
+  }
+
+  void push_separator() { m_tokens.push_back(m_next_id++); }
+
+  const std::vector<uint32_t>& get_tokens() const { return m_tokens; }
+
+ private:
+  std::unordered_map<CandidateInstructionCore,
+                     uint32_t,
+                     CandidateInstructionCoreHasher>
+      m_ids;
+  std::vector<uint32_t> m_tokens;
+  uint32_t m_next_id{0};
+};
+
+static void tokenize_candidate_node(const CandidateNode& cn,
+                                    CandidateInstructionTokenizer* tokenizer) {
+  for (auto& ci : cn.insns) {
+    tokenizer->push_back(ci.core);
+  }
+  tokenizer->push_separator();
+  for (auto& p : cn.succs) {
+    tokenize_candidate_node(*p.second, tokenizer);
+  }
+}
+
 // Gather set of recurring small (MIN_INSNS_SIZE) adjacent instruction
 // sequences that are outlinable. Note that all longer recurring outlinable
 // instruction sequences must be comprised of shorter recurring ones.
+// In addition, we find the longest recurring outlinable sequence starting at
+// each instruction with a suffix array over the outlinable instructions of all
+// big blocks, and the previously outlined candidates that we might reuse.
 static void get_recurring_cores(
     const Config& config,
     PassManager& mgr,
@@ -1206,16 +1283,21 @@ static void get_recurring_cores(
     const std::unordered_set<DexMethod*>& sufficiently_warm_methods,
     const std::unordered_set<DexMethod*>& sufficiently_hot_methods,
     const RefChecker& ref_checker,
-    CandidateInstructionCoresSet* recurring_cores,
+    const ReusableOutlinedMethods& outlined_methods,
+    RecurringSequences* recurring,
     InsertOnlyConcurrentMap<DexMethod*, CanOutlineBlockDecider>*
         block_deciders) {
   AtomicMap<CandidateInstructionCores, size_t, CandidateInstructionCoresHasher>
       concurrent_cores;
+  // Outlinable instructions of each method, with a nullptr after each big
+  // block or unoutlinable instruction.
+  InsertOnlyConcurrentMap<DexMethod*, std::vector<IRInstruction*>>
+      concurrent_sequences;
   walk::parallel::code(
       scope,
       [&config, &ref_checker, &throughput_interaction_indices,
        &throughput_methods, &sufficiently_warm_methods,
-       &sufficiently_hot_methods, &concurrent_cores,
+       &sufficiently_hot_methods, &concurrent_cores, &concurrent_sequences,
        block_deciders](DexMethod* method, IRCode& code) {
         if (!can_outline_from_method(method)) {
           return;
@@ -1235,6 +1317,7 @@ static void get_recurring_cores(
               reaching_initializeds::get_reaching_initializeds(
                   cfg, reaching_initializeds::Mode::FirstLoadParam);
         }
+        std::vector<IRInstruction*> sequence;
         for (auto& big_block : big_blocks::get_big_blocks(cfg)) {
           if (block_decider.can_outline_from_big_block(big_block) !=
               CanOutlineBlockDecider::Result::CanOutline) {
@@ -1247,32 +1330,75 @@ static void get_recurring_cores(
                                   reaching_initialized_init_first_param, insn,
                                   config.outline_control_flow)) {
               cores_builder.clear();
+              sequence.push_back(nullptr);
               continue;
             }
+            sequence.push_back(insn);
             cores_builder.push_back(insn);
             if (cores_builder.has_value()) {
               concurrent_cores.fetch_add(cores_builder.get_value(), 1);
             }
           }
+          sequence.push_back(nullptr);
         }
         block_deciders->emplace(method, std::move(block_decider));
+        if (!sequence.empty()) {
+          concurrent_sequences.emplace(method, std::move(sequence));
+        }
       });
+  auto& recurring_cores = recurring->cores;
   size_t singleton_cores{0};
   for (auto& p : concurrent_cores) {
     auto count = p.second.load();
     always_assert(count > 0);
     if (count > 1) {
-      recurring_cores->insert(p.first);
+      recurring_cores.insert(p.first);
     } else {
       singleton_cores++;
     }
   }
   mgr.incr_metric("num_singleton_cores", singleton_cores);
-  mgr.incr_metric("num_recurring_cores", recurring_cores->size());
+  mgr.incr_metric("num_recurring_cores", recurring_cores.size());
   TRACE(ISO, 2,
         "[invoke sequence outliner] %zu singleton cores, %zu recurring "
         "cores",
-        singleton_cores, recurring_cores->size());
+        singleton_cores, recurring_cores.size());
+
+  CandidateInstructionTokenizer tokenizer;
+  std::vector<const IRInstruction*> token_insns;
+  walk::code(scope, [&](DexMethod* method, IRCode&) {
+    const auto* sequence = concurrent_sequences.get(method);
+    if (sequence == nullptr) {
+      return;
+    }
+    for (auto* insn : *sequence) {
+      if (insn == nullptr) {
+        tokenizer.push_separator();
+      } else {
+        tokenizer.push_back(to_core(insn));
+      }
+      token_insns.push_back(insn);
+    }
+  });
+  for (auto& c : outlined_methods.order) {
+    tokenize_candidate_node(c.root, &tokenizer);
+  }
+  auto repeat_lengths = get_repeat_lengths(tokenizer.get_tokens());
+  uint32_t max_repeat_length{0};
+  for (size_t i = 0; i < token_insns.size(); i++) {
+    if (token_insns[i] != nullptr) {
+      recurring->repeat_lengths.emplace(token_insns[i], repeat_lengths[i]);
+      max_repeat_length = std::max(max_repeat_length, repeat_lengths[i]);
+    }
+  }
+  mgr.incr_metric("num_repeat_tokens", repeat_lengths.size());
+  mgr.set_metric("max_repeat_length",
+                 std::max<int64_t>(mgr.get_metric("max_repeat_length"),
+                                   max_repeat_length));
+  TRACE(ISO, 2,
+        "[invoke sequence outliner] %zu tokens, longest repeat has %u "
+        "instructions",
+        repeat_lengths.size(), max_repeat_length);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1284,20 +1410,6 @@ struct CandidateInfo {
   size_t count{0};
 };
 
-// We keep track of outlined methods that reside in earlier dexes of the current
-// store. Order vector is used for keeping the track of the order of each
-// candidate stored.
-struct ReusableOutlinedMethods {
-  struct OutlinedMethod {
-    const DexStore* store;
-    DexMethod* method;
-    std::set<uint32_t> pattern_ids;
-  };
-  std::unordered_map<Candidate, std::deque<OutlinedMethod>, CandidateHasher>
-      map;
-  std::vector<Candidate> order;
-};
-
 std::unordered_set<const DexType*> get_declaring_types(
     const CandidateInfo& ci) {
   std::unordered_set<const DexType*> types;
@@ -1491,7 +1603,7 @@ static void get_beneficial_candidates(
     const DexStoreDependencies& store_dependencies,
     const Scope& dex,
     const RefChecker& ref_checker,
-    const CandidateInstructionCoresSet& recurring_cores,
+    const RecurringSequences& recurring,
     const InsertOnlyConcurrentMap<DexMethod*, CanOutlineBlockDecider>&
         block_deciders,
     const ReusableOutlinedMethods* outlined_methods,
@@ -1501,7 +1613,7 @@ static void get_beneficial_candidates(
   ConcurrentMap<Candidate, CandidateInfo, CandidateHasher>
       concurrent_candidates;
   FindCandidatesStats stats;
-  walk::parallel::code(dex, [&config, &ref_checker, &recurring_cores,
+  walk::parallel::code(dex, [&config, &ref_checker, &recurring,
                              &concurrent_candidates, &block_deciders,
                              &stats](DexMethod* method, IRCode& code) {
     if (!can_outline_from_method(method)) {
@@ -1509,7 +1621,7 @@ static void get_beneficial_candidates(
     }
     for (auto& p : find_method_candidates(
              config, ref_checker, block_deciders.at_unsafe(method), method,
-             code.cfg(), recurring_cores, &stats)) {
+             code.cfg(), recurring, &stats)) {
       std::vector<CandidateMethodLocation>& cmls = p.second;
       concurrent_candidates.update(p.first,
                                    [method, &cmls](const Candidate&,
@@ -3273,18 +3385,18 @@ void InstructionSequenceOutliner::run_pass(DexStoresVector& stores,
                                               cls->get_type()) != store_idx;
                                  }) == dex.end());
       RefChecker ref_checker{&xstores, store_idx, min_sdk_api};
-      CandidateInstructionCoresSet recurring_cores;
+      RecurringSequences recurring;
       InsertOnlyConcurrentMap<DexMethod*, CanOutlineBlockDecider>
           block_deciders;
       get_recurring_cores(m_config, mgr, dex, throughput_interaction_indices,
                           throughput_methods, sufficiently_warm_methods,
                           sufficiently_hot_methods, ref_checker,
-                          &recurring_cores, &block_deciders);
+                          outlined_methods, &recurring, &block_deciders);
       std::vector<CandidateWithInfo> candidates_with_infos;
       std::unordered_map<DexMethod*, std::unordered_set<CandidateId>>
           candidate_ids_by_methods;
       get_beneficial_candidates(m_config, mgr, store, store_dependencies, dex,
-                                ref_checker, recurring_cores, block_deciders,
+                                ref_checker, recurring, block_deciders,
                                 &outlined_methods, &candidates_with_infos,
                                 &candidate_ids_by_methods);
 
@@ -9,9 +9,13 @@
 
 #include "ClosureAggregator.h"
 #include "ConcurrentContainers.h"
+#include "Creators.h"
 #include "DexLimits.h"
+#include "DexUtil.h"
 #include "InitClassesWithSideEffects.h"
 #include "MethodClosures.h"
+#include "MethodUtil.h"
+#include "Resolver.h"
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
@@ -21,11 +25,16 @@ namespace {
 
 using namespace method_splitting_impl;
 
+constexpr const char* COLD_SPLITS_CLASS_NAME_PREFIX = "Lcom/redex/ColdSplits";
+
 class DexState {
  private:
   std::unordered_set<const DexType*> m_type_refs;
+  std::unordered_set<const DexMethodRef*> m_method_refs;
+  std::unordered_set<const DexFieldRef*> m_field_refs;
   size_t m_method_refs_count;
   size_t max_type_refs;
+  size_t max_field_refs;
 
  public:
   DexState() = delete;
@@ -35,16 +44,17 @@ class DexState {
            const init_classes::InitClassesWithSideEffects&
                init_classes_with_side_effects,
            DexClasses& dex,
+           size_t reserved_frefs,
            size_t reserved_trefs,
            size_t reserved_mrefs) {
-    std::unordered_set<DexMethodRef*> method_refs;
     std::vector<DexType*> init_classes;
     for (auto cls : dex) {
-      cls->gather_methods(method_refs);
+      cls->gather_methods(m_method_refs);
+      cls->gather_fields(m_field_refs);
       cls->gather_types(m_type_refs);
       cls->gather_init_classes(init_classes);
     }
-    m_method_refs_count = method_refs.size() + reserved_mrefs;
+    m_method_refs_count = m_method_refs.size() + reserved_mrefs;
 
     std::unordered_set<DexType*> refined_types;
     for (auto type : init_classes) {
@@ -54,6 +64,7 @@ class DexState {
       }
     }
     max_type_refs = get_max_type_refs(min_sdk) - reserved_trefs;
+    max_field_refs = kMaxFieldRefs - reserved_frefs;
   }
 
   bool can_insert_type_refs(const std::unordered_set<const DexType*>& types) {
@@ -92,6 +103,51 @@ class DexState {
     m_method_refs_count++;
     always_assert(m_method_refs_count <= kMaxMethodRefs);
   }
+
+  // Accounts for all refs of a method that is moved into this dex (into a
+  // class of the given type), if they fit.
+  bool insert_relocated_method(const init_classes::InitClassesWithSideEffects&
+                                   init_classes_with_side_effects,
+                               const DexMethod* method,
+                               const DexType* target_type) {
+    std::unordered_set<const DexMethodRef*> method_refs;
+    std::unordered_set<const DexFieldRef*> field_refs;
+    std::unordered_set<const DexType*> type_refs{target_type};
+    std::vector<DexType*> init_classes;
+    method->gather_methods(method_refs);
+    method->gather_fields(field_refs);
+    method->gather_types(type_refs);
+    method->gather_init_classes(init_classes);
+    for (auto type : init_classes) {
+      auto refined_type = init_classes_with_side_effects.refine(type);
+      if (refined_type) {
+        type_refs.insert(refined_type);
+      }
+    }
+    // The relocated method itself gets a new ref.
+    size_t new_method_refs{1};
+    for (auto* m : method_refs) {
+      if (!m_method_refs.count(m)) {
+        new_method_refs++;
+      }
+    }
+    size_t new_field_refs{0};
+    for (auto* f : field_refs) {
+      if (!m_field_refs.count(f)) {
+        new_field_refs++;
+      }
+    }
+    if (m_method_refs_count + new_method_refs > kMaxMethodRefs ||
+        m_field_refs.size() + new_field_refs >= max_field_refs ||
+        !can_insert_type_refs(type_refs)) {
+      return false;
+    }
+    m_method_refs.insert(method_refs.begin(), method_refs.end());
+    m_method_refs_count += new_method_refs;
+    m_field_refs.insert(field_refs.begin(), field_refs.end());
+    insert_type_refs(type_refs);
+    return true;
+  }
 };
 
 bool account_for_added_split_method(const std::vector<DexType*>& arg_types,
@@ -129,6 +185,7 @@ ConcurrentSet<DexMethod*> split_splittable_closures(
     int32_t min_sdk,
     const init_classes::InitClassesWithSideEffects&
         init_classes_with_side_effects,
+    size_t reserved_frefs,
     size_t reserved_trefs,
     size_t reserved_mrefs,
     const ConcurrentMap<DexType*, std::vector<SplittableClosure>>&
@@ -140,7 +197,10 @@ ConcurrentSet<DexMethod*> split_splittable_closures(
     ConcurrentSet<DexMethod*>* concurrent_added_methods,
     InsertOnlyConcurrentSet<const DexMethod*>* concurrent_hot_methods,
     InsertOnlyConcurrentMap<DexMethod*, DexMethod*>*
-        concurrent_new_hot_split_methods) {
+        concurrent_new_hot_split_methods,
+    bool relocate_hot_cold_splits,
+    const std::unordered_set<const DexMethod*>* startup_methods,
+    ConcurrentSet<DexMethod*>* concurrent_cold_split_methods) {
   Timer t("split");
   ConcurrentSet<DexMethod*> concurrent_affected_methods;
   auto process_dex = [&](DexClasses* dex) {
@@ -160,9 +220,9 @@ ConcurrentSet<DexMethod*> split_splittable_closures(
 
     auto& dex_state = dex_states->at(dex);
     if (!dex_state) {
-      dex_state =
-          std::make_unique<DexState>(min_sdk, init_classes_with_side_effects,
-                                     *dex, reserved_trefs, reserved_mrefs);
+      dex_state = std::make_unique<DexState>(
+          min_sdk, init_classes_with_side_effects, *dex, reserved_frefs,
+          reserved_trefs, reserved_mrefs);
     }
 
     std::sort(ranked_splittable_closures.begin(),
@@ -247,13 +307,26 @@ ConcurrentSet<DexMethod*> split_splittable_closures(
       }
       case HotSplitKind::HotCold:
         stats->hot_cold_split_count++;
+        if (concurrent_cold_split_methods &&
+            (relocate_hot_cold_splits ||
+             (startup_methods && startup_methods->count(method)))) {
+          concurrent_cold_split_methods->insert(new_method);
+        }
         break;
       case HotSplitKind::Cold:
         stats->cold_split_count++;
+        if (concurrent_cold_split_methods &&
+            (concurrent_cold_split_methods->count(method) ||
+             (startup_methods && startup_methods->count(method)))) {
+          concurrent_cold_split_methods->insert(new_method);
+        }
         break;
       default:
         not_reached();
       }
+      if (startup_methods && startup_methods->count(method)) {
+        stats->startup_split_count++;
+      }
       affected_methods.insert(method);
       affected_methods.insert(new_method);
       concurrent_added_methods->insert(new_method);
@@ -265,6 +338,129 @@ ConcurrentSet<DexMethod*> split_splittable_closures(
   return concurrent_affected_methods;
 }
 
+// Whether a split method can be moved into a class of another dex, widening
+// the visibility of the accessed members as needed.
+bool can_relocate(const DexMethod* method) {
+  auto& code = *method->get_code();
+  if (!method::no_invoke_super(code) ||
+      !gather_invoked_methods_that_prevent_relocation(method)) {
+    return false;
+  }
+  for (auto& mie : InstructionIterable(code.cfg())) {
+    auto insn = mie.insn;
+    if (insn->has_field()) {
+      auto field = resolve_field(insn->get_field());
+      if (field == nullptr || (field->is_external() && !is_public(field))) {
+        return false;
+      }
+    } else if (insn->has_type()) {
+      auto cls =
+          type_class(type::get_element_type_if_array(insn->get_type()));
+      if (cls != nullptr && cls->is_external() && !is_public(cls)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Moves split methods that only hold cold code of hot methods into a holder
+// class in the last dex of their store, which InterDex fills with the coldest
+// classes. This keeps the cold code off the pages of the dexes that are
+// touched at startup. Methods in the primary dex, or already in the last dex,
+// stay where they are, and nothing is moved into a last dex of the root store
+// that is among the first `num_startup_dexes` cold-start dexes.
+void relocate_cold_split_methods(
+    DexStoresVector& stores,
+    int32_t min_sdk,
+    const init_classes::InitClassesWithSideEffects&
+        init_classes_with_side_effects,
+    size_t reserved_frefs,
+    size_t reserved_trefs,
+    size_t reserved_mrefs,
+    const ConcurrentSet<DexMethod*>& cold_split_methods,
+    const std::string& name_infix,
+    size_t num_startup_dexes,
+    std::unordered_map<DexClasses*, std::unique_ptr<DexState>>* dex_states,
+    Stats* stats) {
+  Timer t("relocate_cold_split_methods");
+  std::unordered_map<const DexType*, std::pair<size_t, DexClasses*>>
+      dexes_by_types;
+  for (size_t store_idx = 0; store_idx < stores.size(); store_idx++) {
+    auto& dexen = stores[store_idx].get_dexen();
+    for (size_t dex_idx = 0; dex_idx < dexen.size(); dex_idx++) {
+      if (store_idx == 0 && dex_idx == 0) {
+        // Code in the primary dex may run before secondary dexes are loaded.
+        continue;
+      }
+      for (auto* cls : dexen[dex_idx]) {
+        dexes_by_types.emplace(cls->get_type(),
+                               std::make_pair(store_idx, &dexen[dex_idx]));
+      }
+    }
+  }
+  auto get_dex_state = [&](DexClasses* dex) -> DexState& {
+    auto& dex_state = dex_states->at(dex);
+    if (!dex_state) {
+      dex_state = std::make_unique<DexState>(
+          min_sdk, init_classes_with_side_effects, *dex, reserved_frefs,
+          reserved_trefs, reserved_mrefs);
+    }
+    return *dex_state;
+  };
+  std::vector<DexMethod*> ordered(cold_split_methods.begin(),
+                                  cold_split_methods.end());
+  std::sort(ordered.begin(), ordered.end(), compare_dexmethods);
+  for (size_t store_idx = 0; store_idx < stores.size(); store_idx++) {
+    auto& dexen = stores[store_idx].get_dexen();
+    if (dexen.size() < 2 ||
+        (store_idx == 0 && dexen.size() <= num_startup_dexes)) {
+      continue;
+    }
+    auto* cold_dex = &dexen.back();
+    DexClass* holder_cls = nullptr;
+    for (auto* method : ordered) {
+      auto it = dexes_by_types.find(method->get_class());
+      if (it == dexes_by_types.end() || it->second.first != store_idx ||
+          it->second.second == cold_dex) {
+        continue;
+      }
+      if (!can_relocate(method)) {
+        stats->relocation_prevented++;
+        continue;
+      }
+      auto& dex_state = get_dex_state(it->second.second);
+      auto& cold_dex_state = get_dex_state(cold_dex);
+      DexType* holder_type = holder_cls ? holder_cls->get_type() : nullptr;
+      if (!holder_type) {
+        for (size_t i = 0; !holder_type || type_class(holder_type); i++) {
+          holder_type = DexType::make_type(
+              std::string(COLD_SPLITS_CLASS_NAME_PREFIX) + name_infix +
+              std::to_string(store_idx) + "$" + std::to_string(i) + ";");
+        }
+      }
+      if (!dex_state.can_insert_type_refs({holder_type}) ||
+          !cold_dex_state.insert_relocated_method(
+              init_classes_with_side_effects, method, holder_type)) {
+        stats->relocation_dex_limits_hit++;
+        continue;
+      }
+      dex_state.insert_type_refs({holder_type});
+      if (!holder_cls) {
+        ClassCreator cc(holder_type);
+        cc.set_access(ACC_PUBLIC | ACC_FINAL);
+        cc.set_super(type::java_lang_Object());
+        holder_cls = cc.create();
+        holder_cls->rstate.set_generated();
+        cold_dex->push_back(holder_cls);
+      }
+      always_assert(relocate_method_if_no_changes(method, holder_type));
+      method->set_deobfuscated_name(show_deobfuscated(method));
+      stats->relocated_cold_split_methods++;
+    }
+  }
+}
+
 } // namespace
 
 namespace method_splitting_impl {
@@ -441,6 +637,7 @@ void split_methods_in_stores(
     int32_t min_sdk,
     const Config& config,
     bool create_init_class_insns,
+    size_t reserved_frefs,
     size_t reserved_mrefs,
     size_t reserved_trefs,
     Stats* stats,
@@ -449,7 +646,14 @@ void split_methods_in_stores(
     InsertOnlyConcurrentMap<DexMethod*, DexMethod*>*
         concurrent_new_hot_split_methods,
     InsertOnlyConcurrentMap<DexMethod*, size_t>*
-        concurrent_splittable_no_optimizations_methods) {
+        concurrent_splittable_no_optimizations_methods,
+    const std::unordered_set<const DexMethod*>* startup_methods,
+    size_t num_startup_dexes) {
+  if (!config.split_startup_methods) {
+    startup_methods = nullptr;
+  }
+  bool relocate =
+      config.relocate_cold_split_methods || startup_methods != nullptr;
   auto scope = build_class_scope(stores);
   init_classes::InitClassesWithSideEffects init_classes_with_side_effects(
       scope, create_init_class_insns);
@@ -486,24 +690,33 @@ void split_methods_in_stores(
 
   size_t iteration{0};
   AtomicMap<std::string, size_t> uniquifiers;
+  ConcurrentSet<DexMethod*> cold_split_methods;
   while (!methods.empty() && iteration < config.max_iteration) {
     TRACE(MS, 2, "=== iteration[%zu]", iteration);
     Timer t("iteration " + std::to_string(iteration++));
     auto splittable_closures = select_splittable_closures_based_on_costs(
         methods, config, concurrent_hot_methods,
-        concurrent_splittable_no_optimizations_methods);
+        concurrent_splittable_no_optimizations_methods, startup_methods);
     ConcurrentSet<DexMethod*> concurrent_added_methods;
     methods = split_splittable_closures(
-        dexen, min_sdk, init_classes_with_side_effects, reserved_trefs,
-        reserved_mrefs, splittable_closures, name_infix, &uniquifiers, stats,
-        &dex_states, &concurrent_added_methods, concurrent_hot_methods,
-        concurrent_new_hot_split_methods);
+        dexen, min_sdk, init_classes_with_side_effects, reserved_frefs,
+        reserved_trefs, reserved_mrefs, splittable_closures, name_infix,
+        &uniquifiers, stats, &dex_states, &concurrent_added_methods,
+        concurrent_hot_methods, concurrent_new_hot_split_methods,
+        config.relocate_cold_split_methods, startup_methods,
+        relocate ? &cold_split_methods : nullptr);
     stats->added_methods.insert(concurrent_added_methods.begin(),
                                 concurrent_added_methods.end());
     TRACE(MS, 1, "[%zu] Split out %zu methods", iteration,
           concurrent_added_methods.size());
   }
   stats->iterations = iteration;
+  if (relocate && !cold_split_methods.empty()) {
+    relocate_cold_split_methods(stores, min_sdk, init_classes_with_side_effects,
+                                reserved_frefs, reserved_trefs, reserved_mrefs,
+                                cold_split_methods, name_infix,
+                                num_startup_dexes, &dex_states, stats);
+  }
   walk::code(scope, [&](DexMethod* method, IRCode&) {
     method->rstate.reset_too_large_for_inlining_into();
   });
@@ -37,6 +37,10 @@ struct Stats {
   std::atomic<size_t> destroyed_large_packed_switches{0};
   std::unordered_set<DexMethod*> added_methods;
   std::atomic<size_t> excluded_methods{0};
+  std::atomic<size_t> relocated_cold_split_methods{0};
+  std::atomic<size_t> relocation_prevented{0};
+  std::atomic<size_t> relocation_dex_limits_hit{0};
+  std::atomic<size_t> startup_split_count{0};
   size_t iterations{0};
 };
 
@@ -77,6 +81,7 @@ void split_methods_in_stores(
     int32_t min_sdk,
     const Config& config,
     bool create_init_class_insns,
+    size_t reserved_frefs,
     size_t reserved_mrefs,
     size_t reserved_trefs,
     Stats* stats,
@@ -85,6 +90,8 @@ void split_methods_in_stores(
     InsertOnlyConcurrentMap<DexMethod*, DexMethod*>*
         concurrent_new_hot_split_methods = nullptr,
     InsertOnlyConcurrentMap<DexMethod*, size_t>*
-        concurrent_splittable_no_optimizations_methods = nullptr);
+        concurrent_splittable_no_optimizations_methods = nullptr,
+    const std::unordered_set<const DexMethod*>* startup_methods = nullptr,
+    size_t num_startup_dexes = 0);
 
 } // namespace method_splitting_impl
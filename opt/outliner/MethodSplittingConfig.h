@@ -30,6 +30,16 @@ struct Config {
   int64_t max_live_in{32};
   uint64_t max_iteration{10};
 
+  // Whether to move split methods holding only cold code of hot methods into
+  // a holder class in the last dex of the store.
+  bool relocate_cold_split_methods{false};
+
+  // Whether to split never-executed code out of startup methods of the
+  // baseline profile, and to move it behind the cold-start dexes chosen by
+  // InterDex. Hot code of startup methods is never split off.
+  bool split_startup_methods{false};
+  uint64_t min_original_size_startup_method{200};
+
   size_t min_large_switch_size{8};
 
   // Estimated overhead of having a split method and its metadata.
@@ -64,6 +64,18 @@ void MethodSplittingPass::bind_config() {
        "Maximum number of live-in registers");
   bind("max_iteration", m_config.max_iteration, m_config.max_iteration,
        "Maximum number of top-level iterations");
+  bind("relocate_cold_split_methods", m_config.relocate_cold_split_methods,
+       m_config.relocate_cold_split_methods,
+       "Whether to move split-out cold code of hot methods into the last dex "
+       "of the store");
+  bind("split_startup_methods", m_config.split_startup_methods,
+       m_config.split_startup_methods,
+       "Whether to split never-executed code out of startup methods, and to "
+       "move it behind the cold-start dexes");
+  bind("min_original_size_startup_method",
+       m_config.min_original_size_startup_method,
+       m_config.min_original_size_startup_method,
+       "Minimum size of a startup method to consider splitting");
   bind("excluded_prefices", m_config.excluded_prefices,
        m_config.excluded_prefices);
 }
@@ -72,18 +84,26 @@ void MethodSplittingPass::run_pass(DexStoresVector& stores,
                                    ConfigFiles& conf,
                                    PassManager& mgr) {
   const auto& interdex_metrics = mgr.get_interdex_metrics();
-  auto it = interdex_metrics.find(interdex::METRIC_RESERVED_MREFS);
+  auto it = interdex_metrics.find(interdex::METRIC_RESERVED_FREFS);
+  size_t reserved_frefs = it == interdex_metrics.end() ? 0 : it->second;
+  it = interdex_metrics.find(interdex::METRIC_RESERVED_MREFS);
   size_t reserved_mrefs = it == interdex_metrics.end() ? 0 : it->second;
   it = interdex_metrics.find(interdex::METRIC_RESERVED_TREFS);
   size_t reserved_trefs = it == interdex_metrics.end() ? 0 : it->second;
+  it = interdex_metrics.find(interdex::METRIC_COLD_START_SET_DEX_COUNT);
+  size_t num_startup_dexes = it == interdex_metrics.end() ? 0 : it->second;
 
   auto baseline_profile = baseline_profiles::get_baseline_profile(
       conf.get_default_baseline_profile_config(), conf.get_method_profiles());
   InsertOnlyConcurrentSet<const DexMethod*> concurrent_hot_methods;
+  std::unordered_set<const DexMethod*> startup_methods;
   for (auto&& [method, flags] : baseline_profile.methods) {
     if (flags.hot) {
       concurrent_hot_methods.insert_unsafe(method);
     }
+    if (flags.startup) {
+      startup_methods.insert(method);
+    }
   }
 
   auto name_infix = "$" + std::to_string(m_iteration) + "$";
@@ -94,9 +114,11 @@ void MethodSplittingPass::run_pass(DexStoresVector& stores,
       concurrent_splittable_no_optimizations_methods;
   split_methods_in_stores(
       stores, mgr.get_redex_options().min_sdk, m_config,
-      conf.create_init_class_insns(), reserved_mrefs, reserved_trefs, &stats,
+      conf.create_init_class_insns(), reserved_frefs, reserved_mrefs,
+      reserved_trefs, &stats,
       name_infix, &concurrent_hot_methods, &concurrent_new_hot_split_methods,
-      &concurrent_splittable_no_optimizations_methods);
+      &concurrent_splittable_no_optimizations_methods, &startup_methods,
+      num_startup_dexes);
 
   auto& method_profiles = conf.get_method_profiles();
   size_t derived_method_profile_stats{0};
@@ -127,6 +149,12 @@ void MethodSplittingPass::run_pass(DexStoresVector& stores,
   mgr.set_metric("derived_method_profile_stats", derived_method_profile_stats);
   mgr.set_metric("excluded_methods", (size_t)stats.excluded_methods);
   mgr.set_metric("iterations", stats.iterations);
+  mgr.set_metric("relocated_cold_split_methods",
+                 (size_t)stats.relocated_cold_split_methods);
+  mgr.set_metric("relocation_prevented", (size_t)stats.relocation_prevented);
+  mgr.set_metric("relocation_dex_limits_hit",
+                 (size_t)stats.relocation_dex_limits_hit);
+  mgr.set_metric("startup_split_count", (size_t)stats.startup_split_count);
   TRACE(MS, 1, "Split out %zu methods", stats.added_methods.size());
 
   for (auto [method, size] : concurrent_splittable_no_optimizations_methods) {
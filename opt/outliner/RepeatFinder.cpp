@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "RepeatFinder.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "Debug.h"
+
+namespace outliner_impl {
+
+namespace {
+
+// Stable counting sort of the given positions by their ranks, which must be
+// less than num_ranks.
+void sort_by_rank(const std::vector<uint32_t>& positions,
+                  const std::vector<uint32_t>& ranks,
+                  size_t num_ranks,
+                  std::vector<uint32_t>* sorted) {
+  std::vector<uint32_t> counts(num_ranks + 1, 0);
+  for (auto p : positions) {
+    counts[ranks[p] + 1]++;
+  }
+  for (size_t r = 1; r <= num_ranks; ++r) {
+    counts[r] += counts[r - 1];
+  }
+  for (auto p : positions) {
+    (*sorted)[counts[ranks[p]]++] = p;
+  }
+}
+
+} // namespace
+
+std::vector<uint32_t> build_suffix_array(const std::vector<uint32_t>& tokens) {
+  always_assert(tokens.size() < std::numeric_limits<uint32_t>::max());
+  const uint32_t n = tokens.size();
+  std::vector<uint32_t> sa(n);
+  if (n == 0) {
+    return sa;
+  }
+
+  // Initial ranks are the dense ranks of the tokens.
+  std::vector<uint32_t> ranks(n);
+  {
+    std::vector<uint32_t> unique_tokens(tokens);
+    std::sort(unique_tokens.begin(), unique_tokens.end());
+    unique_tokens.erase(std::unique(unique_tokens.begin(), unique_tokens.end()),
+                        unique_tokens.end());
+    for (uint32_t i = 0; i < n; ++i) {
+      ranks[i] = std::lower_bound(unique_tokens.begin(), unique_tokens.end(),
+                                  tokens[i]) -
+                 unique_tokens.begin();
+    }
+  }
+  std::vector<uint32_t> positions(n);
+  for (uint32_t i = 0; i < n; ++i) {
+    positions[i] = i;
+  }
+  sort_by_rank(positions, ranks, n, &sa);
+
+  std::vector<uint32_t> new_ranks(n);
+  for (uint32_t k = 1;; k <<= 1) {
+    // Sort by the rank of the second half (suffixes that are too short to have
+    // one go first), and then, stably, by the rank of the first half.
+    uint32_t p = 0;
+    for (uint32_t i = n - std::min(k, n); i < n; ++i) {
+      positions[p++] = i;
+    }
+    for (auto s : sa) {
+      if (s >= k) {
+        positions[p++] = s - k;
+      }
+    }
+    sort_by_rank(positions, ranks, n, &sa);
+
+    auto second = [&](uint32_t i) -> int64_t {
+      return i + k < n ? (int64_t)ranks[i + k] : -1;
+    };
+    new_ranks[sa[0]] = 0;
+    for (uint32_t i = 1; i < n; ++i) {
+      auto a = sa[i - 1];
+      auto b = sa[i];
+      bool same = ranks[a] == ranks[b] && second(a) == second(b);
+      new_ranks[b] = new_ranks[a] + (same ? 0 : 1);
+    }
+    std::swap(ranks, new_ranks);
+    if (ranks[sa[n - 1]] == n - 1 || k >= n) {
+      break;
+    }
+  }
+  return sa;
+}
+
+std::vector<uint32_t> get_repeat_lengths(const std::vector<uint32_t>& tokens) {
+  const uint32_t n = tokens.size();
+  auto sa = build_suffix_array(tokens);
+  std::vector<uint32_t> rank(n);
+  for (uint32_t r = 0; r < n; ++r) {
+    rank[sa[r]] = r;
+  }
+
+  // lcp[r] is the length of the longest common prefix of the suffixes at
+  // ranks r - 1 and r (Kasai et al.).
+  std::vector<uint32_t> lcp(n + 1, 0);
+  uint32_t h = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    if (rank[i] == 0) {
+      h = 0;
+      continue;
+    }
+    auto j = sa[rank[i] - 1];
+    while (i + h < n && j + h < n && tokens[i + h] == tokens[j + h]) {
+      h++;
+    }
+    lcp[rank[i]] = h;
+    if (h > 0) {
+      h--;
+    }
+  }
+
+  // The longest repeat at a position is shared with one of the neighbouring
+  // suffixes in suffix array order.
+  std::vector<uint32_t> lengths(n);
+  for (uint32_t i = 0; i < n; ++i) {
+    lengths[i] = std::max(lcp[rank[i]], lcp[rank[i] + 1]);
+  }
+  return lengths;
+}
+
+} // namespace outliner_impl
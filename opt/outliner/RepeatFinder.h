@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace outliner_impl {
+
+/*
+ * Suffix array based repeat finding over a sequence of tokens, e.g.
+ * abstracted instructions.
+ *
+ * The suffix array is built by prefix doubling with radix sorting, and the
+ * longest-common-prefix array with Kasai's algorithm, so that the whole
+ * analysis runs in O(n log n) time and O(n) space, independent of how long the
+ * repeats are.
+ */
+
+// Returns the start positions of all suffixes of the tokens in lexicographic
+// order.
+std::vector<uint32_t> build_suffix_array(const std::vector<uint32_t>& tokens);
+
+// Returns, for each position, the length of the longest sequence of tokens
+// starting at that position which also starts at some other position. (Tokens
+// that occur only once thus act as separators, which repeats never span.)
+std::vector<uint32_t> get_repeat_lengths(const std::vector<uint32_t>& tokens);
+
+} // namespace outliner_impl
@@ -585,12 +585,14 @@ select_splittable_closures_based_on_costs(
     const Config& config,
     InsertOnlyConcurrentSet<const DexMethod*>* concurrent_hot_methods,
     InsertOnlyConcurrentMap<DexMethod*, size_t>*
-        concurrent_splittable_no_optimizations_methods) {
+        concurrent_splittable_no_optimizations_methods,
+    const std::unordered_set<const DexMethod*>* startup_methods) {
   Timer t("select_splittable_closures_based_on_costs");
   ConcurrentMap<DexType*, std::vector<SplittableClosure>>
       concurrent_splittable_closures;
   auto concurrent_process_method = [&](DexMethod* method) {
     auto rcfg = reduce_cfg(method, config.split_block_size);
+    bool is_startup = startup_methods && startup_methods->count(method);
     auto is_sufficiently_large = [&]() {
       if (rcfg->code_size() >= config.min_original_size) {
         return true;
@@ -599,6 +601,10 @@ select_splittable_closures_based_on_costs(
           rcfg->code_size() >= config.min_original_size_hot_method) {
         return true;
       }
+      if (is_startup &&
+          rcfg->code_size() >= config.min_original_size_startup_method) {
+        return true;
+      }
       if (method->rstate.too_large_for_inlining_into() &&
           rcfg->code_size() >=
               config.min_original_size_too_large_for_inlining) {
@@ -619,9 +625,11 @@ select_splittable_closures_based_on_costs(
     std::vector<ScoredClosure> scored_closures;
     auto adjustment = cfg.get_size_adjustment(
         /* assume_no_unreachable_blocks */ true);
-    bool is_hot = concurrent_hot_methods &&
-                  concurrent_hot_methods->count(method) &&
-                  mcs->original_size >= config.min_original_size_hot_method;
+    bool is_hot = (concurrent_hot_methods &&
+                   concurrent_hot_methods->count(method) &&
+                   mcs->original_size >= config.min_original_size_hot_method) ||
+                  (is_startup && mcs->original_size >=
+                                     config.min_original_size_startup_method);
     bool is_huge =
         mcs->original_size + adjustment > config.huge_threshold ||
         (method->rstate.too_large_for_inlining_into() &&
@@ -632,6 +640,12 @@ select_splittable_closures_based_on_costs(
                         : config.max_overhead_ratio;
     for (auto r = begin; scored_closures.empty() && r <= end; r *= 2) {
       scored_closures = get_scored_closures(config, *mcs, r);
+      if (is_startup) {
+        // Splitting off hot code would add calls to the startup path.
+        std20::erase_if(scored_closures, [](auto& sc) {
+          return sc.hot_split_kind == HotSplitKind::Hot;
+        });
+      }
     }
     if (scored_closures.empty()) {
       return;
@@ -51,14 +51,15 @@ struct SplittableClosure {
 };
 
 // Selects splittable closures for a given set of methods based of configured
-// costs.
+// costs. Only cold code is selected in startup methods.
 ConcurrentMap<DexType*, std::vector<SplittableClosure>>
 select_splittable_closures_based_on_costs(
     const ConcurrentSet<DexMethod*>& methods,
     const Config& config,
     InsertOnlyConcurrentSet<const DexMethod*>* concurrent_hot_methods,
     InsertOnlyConcurrentMap<DexMethod*, size_t>*
-        concurrent_splittable_no_optimizations_methods);
+        concurrent_splittable_no_optimizations_methods,
+    const std::unordered_set<const DexMethod*>* startup_methods = nullptr);
 
 // Selects splittable closures for a given set of methods from all contained
 // top-level switch cases.
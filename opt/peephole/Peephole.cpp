@@ -25,6 +25,7 @@
 #include "DexInstruction.h"
 #include "DexUtil.h"
 #include "IRInstruction.h"
+#include "OpcodeIndex.h"
 #include "PassManager.h"
 #include "RedundantCheckCastRemover.h"
 #include "Show.h"
@@ -281,7 +282,29 @@ struct Matcher {
   std::unordered_map<Type, DexType*, EnumClassHash> matched_types;
   std::unordered_map<Field, DexFieldRef*, EnumClassHash> matched_fields;
 
-  explicit Matcher(const Pattern& pattern) : pattern(pattern), match_index(0) {}
+  // The opcodes accepted at each position of the match, as bitsets, so that
+  // checking an instruction is a single test, and so that patterns which
+  // cannot match the opcodes of a block can be skipped without looking at its
+  // instructions.
+  std::vector<opcode_index::OpcodeSet> match_opcodes;
+
+  explicit Matcher(const Pattern& pattern) : pattern(pattern), match_index(0) {
+    match_opcodes.reserve(pattern.match.size());
+    for (const auto& dex_pattern : pattern.match) {
+      auto& set = match_opcodes.emplace_back();
+      for (auto op : dex_pattern.opcodes) {
+        set.insert((IROpcode)op);
+      }
+    }
+  }
+
+  // Whether the pattern may match somewhere in code with the given opcodes.
+  bool may_match(const opcode_index::OpcodeSet& opcodes) const {
+    return std::all_of(match_opcodes.begin(), match_opcodes.end(),
+                       [&](const auto& set) {
+                         return opcodes.contains_any(set);
+                       });
+  }
 
   void reset() {
     match_index = 0;
@@ -340,10 +363,10 @@ struct Matcher {
       return newly_inserted ? true : result.first->second == insn_field;
     };
 
-    // Does 'insn' match to the given DexPattern?
-    auto match_instruction = [&](const DexPattern& dex_pattern) {
-      if (dex_pattern.opcodes.find(insn->opcode()) ==
-              end(dex_pattern.opcodes) ||
+    // Does 'insn' match to the DexPattern at the given index?
+    auto match_instruction = [&](size_t index) {
+      const auto& dex_pattern = pattern.match[index];
+      if (!match_opcodes[index].contains(insn->opcode()) ||
           dex_pattern.srcs.size() != insn->srcs_size() ||
           dex_pattern.dests.size() != insn->has_dest()) {
         return false;
@@ -382,7 +405,7 @@ struct Matcher {
     };
 
     redex_assert(match_index < pattern.match.size());
-    if (!match_instruction(pattern.match[match_index])) {
+    if (!match_instruction(match_index)) {
       // Okay, this is the PG's heuristic. Retry only if the failure occurs on
       // the second opcode of the pattern.
       bool retry = (match_index == 1);
@@ -395,7 +418,7 @@ struct Matcher {
       reset();
       if (retry) {
         redex_assert(match_index == 0);
-        if (!match_instruction(pattern.match[match_index])) {
+        if (!match_instruction(match_index)) {
           return false;
         }
       } else {
@@ -1736,15 +1759,42 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
     always_assert(code->editable_cfg_built());
     auto& cfg = code->cfg();
 
+    // The opcodes of each block, and of the whole method. Most patterns need
+    // opcodes that a method does not have at all, and are skipped without
+    // visiting its instructions. The sets are recomputed after a pattern
+    // changed the code.
+    std::vector<cfg::Block*> blocks;
+    std::vector<opcode_index::OpcodeSet> block_opcodes;
+    opcode_index::OpcodeSet method_opcodes;
+    auto compute_opcodes = [&]() {
+      blocks = cfg.blocks();
+      block_opcodes.assign(blocks.size(), opcode_index::OpcodeSet());
+      method_opcodes = opcode_index::OpcodeSet();
+      for (size_t b = 0; b < blocks.size(); ++b) {
+        for (auto& mie : InstructionIterable(blocks[b])) {
+          block_opcodes[b].insert(mie.insn->opcode());
+          method_opcodes.insert(mie.insn->opcode());
+        }
+      }
+    };
+    compute_opcodes();
+
     // do optimizations one at a time
     // so they can match on the same pattern without interfering
     for (size_t i = 0; i < m_matchers.size(); ++i) {
       auto& matcher = m_matchers[i];
+      if (!matcher.may_match(method_opcodes)) {
+        continue;
+      }
 
-      const auto& blocks = cfg.blocks();
       cfg::CFGMutation mutator(cfg);
+      size_t stats_before = m_stats[i];
 
-      for (const auto& block : blocks) {
+      for (size_t b = 0; b < blocks.size(); ++b) {
+        if (!matcher.may_match(block_opcodes[b])) {
+          continue;
+        }
+        auto* block = blocks[b];
         // Currently, all patterns do not span over multiple basic blocks. So
         // reset all matching states on visiting every basic block.
         matcher.reset();
@@ -1796,6 +1846,9 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
 
       // Apply the mutator.
       mutator.flush();
+      if (m_stats[i] != stats_before) {
+        compute_opcodes();
+      }
     }
   }
 
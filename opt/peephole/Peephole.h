@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Pass.h"
 #include <vector>
 
@@ -21,6 +22,10 @@ class PeepholePass : public Pass {
     return {};
   }
 
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
   void bind_config() override {
@@ -24,6 +24,7 @@
 
 #include "ReduceGotos.h"
 
+#include <mutex>
 #include <vector>
 
 #include "ControlFlow.h"
@@ -489,18 +490,16 @@ ReduceGotosPass::Stats ReduceGotosPass::process_code(IRCode* code) {
   return stats;
 }
 
-void ReduceGotosPass::run_pass(DexStoresVector& stores,
-                               ConfigFiles& /* unused */,
-                               PassManager& mgr) {
-  auto scope = build_class_scope(stores);
+namespace {
 
-  Stats stats = walk::parallel::methods<Stats>(scope, [](DexMethod* method) {
-    const auto code = method->get_code();
-    if (!code || method->rstate.no_optimizations()) {
-      return Stats{};
+class ReduceGotosRun : public MethodLocalPass::Run {
+ public:
+  void run_on_method(DexMethod* method, IRCode& code) override {
+    if (method->rstate.no_optimizations()) {
+      return;
     }
 
-    Stats stats = ReduceGotosPass::process_code(code);
+    auto stats = ReduceGotosPass::process_code(&code);
     if (stats.replaced_gotos_with_returns ||
         stats.inverted_conditional_branches) {
       TRACE(RG, 3,
@@ -510,33 +509,52 @@ void ReduceGotosPass::run_pass(DexStoresVector& stores,
             stats.replaced_gotos_with_returns, stats.removed_trailing_moves,
             stats.inverted_conditional_branches, SHOW(method));
     }
-    return stats;
-  });
-
-  mgr.incr_metric(METRIC_REMOVED_SWITCHES, stats.removed_switches);
-  mgr.incr_metric(METRIC_REDUCED_SWITCHES, stats.reduced_switches);
-  mgr.incr_metric(METRIC_REMAINING_TRIVIAL_SWITCHES,
-                  stats.remaining_trivial_switches);
-  mgr.incr_metric(METRIC_REPLACED_TRIVIAL_SWITCHES,
-                  stats.replaced_trivial_switches);
-  mgr.incr_metric(METRIC_REMAINING_RANGE_SWITCHES,
-                  stats.remaining_range_switches);
-  mgr.incr_metric(METRIC_REMAINING_RANGE_SWITCH_CASES,
-                  stats.remaining_range_switch_cases);
-  mgr.incr_metric(METRIC_REMAINING_TWO_CASE_SWITCHES,
-                  stats.remaining_two_case_switches);
-  mgr.incr_metric(METRIC_REMOVED_SWITCH_CASES, stats.removed_switch_cases);
-  mgr.incr_metric(METRIC_GOTOS_REPLACED_WITH_RETURNS,
-                  stats.replaced_gotos_with_returns);
-  mgr.incr_metric(METRIC_TRAILING_MOVES_REMOVED, stats.removed_trailing_moves);
-  mgr.incr_metric(METRIC_INVERTED_CONDITIONAL_BRANCHES,
-                  stats.inverted_conditional_branches);
-  mgr.incr_metric(METRIC_NUM_GOTOS_REPLACED_WITH_THROWS,
-                  stats.replaced_gotos_with_throws);
-  TRACE(RG, 1,
-        "[reduce gotos] Replaced %zu gotos with returns, inverted %zu "
-        "conditional brnaches in total",
-        stats.replaced_gotos_with_returns, stats.inverted_conditional_branches);
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    m_stats += stats;
+  }
+
+  void finish(PassManager& mgr) override {
+    const auto& stats = m_stats;
+    mgr.incr_metric(METRIC_REMOVED_SWITCHES, stats.removed_switches);
+    mgr.incr_metric(METRIC_REDUCED_SWITCHES, stats.reduced_switches);
+    mgr.incr_metric(METRIC_REMAINING_TRIVIAL_SWITCHES,
+                    stats.remaining_trivial_switches);
+    mgr.incr_metric(METRIC_REPLACED_TRIVIAL_SWITCHES,
+                    stats.replaced_trivial_switches);
+    mgr.incr_metric(METRIC_REMAINING_RANGE_SWITCHES,
+                    stats.remaining_range_switches);
+    mgr.incr_metric(METRIC_REMAINING_RANGE_SWITCH_CASES,
+                    stats.remaining_range_switch_cases);
+    mgr.incr_metric(METRIC_REMAINING_TWO_CASE_SWITCHES,
+                    stats.remaining_two_case_switches);
+    mgr.incr_metric(METRIC_REMOVED_SWITCH_CASES, stats.removed_switch_cases);
+    mgr.incr_metric(METRIC_GOTOS_REPLACED_WITH_RETURNS,
+                    stats.replaced_gotos_with_returns);
+    mgr.incr_metric(METRIC_TRAILING_MOVES_REMOVED,
+                    stats.removed_trailing_moves);
+    mgr.incr_metric(METRIC_INVERTED_CONDITIONAL_BRANCHES,
+                    stats.inverted_conditional_branches);
+    mgr.incr_metric(METRIC_NUM_GOTOS_REPLACED_WITH_THROWS,
+                    stats.replaced_gotos_with_throws);
+    TRACE(RG, 1,
+          "[reduce gotos] Replaced %zu gotos with returns, inverted %zu "
+          "conditional brnaches in total",
+          stats.replaced_gotos_with_returns,
+          stats.inverted_conditional_branches);
+  }
+
+ private:
+  std::mutex m_stats_mutex;
+  ReduceGotosPass::Stats m_stats;
+};
+
+} // namespace
+
+std::unique_ptr<MethodLocalPass::Run> ReduceGotosPass::start_run(
+    DexStoresVector& /* unused */,
+    ConfigFiles& /* unused */,
+    PassManager& /* unused */) {
+  return std::make_unique<ReduceGotosRun>();
 }
 
 ReduceGotosPass::Stats& ReduceGotosPass::Stats::operator+=(
@@ -7,13 +7,14 @@
 
 #pragma once
 
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Pass.h"
 
 namespace cfg {
 class ControlFlowGraph;
 } // namespace cfg
 
-class ReduceGotosPass : public Pass {
+class ReduceGotosPass : public MethodLocalPass {
  public:
   struct Stats {
     size_t removed_switches{0};
@@ -32,7 +33,7 @@ class ReduceGotosPass : public Pass {
     Stats& operator+=(const Stats&);
   };
 
-  ReduceGotosPass() : Pass("ReduceGotosPass") {}
+  ReduceGotosPass() : MethodLocalPass("ReduceGotosPass") {}
 
   redex_properties::PropertyInteractions get_property_interactions()
       const override {
@@ -46,7 +47,15 @@ class ReduceGotosPass : public Pass {
         {RenameClass, Preserves},
     };
   }
-  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+  }
+
+  bool skips_unchanged_methods() const override { return true; }
+
+  std::unique_ptr<Run> start_run(DexStoresVector&,
+                                 ConfigFiles&,
+                                 PassManager&) override;
 
   static Stats process_code(IRCode*);
   static void process_code_switches(cfg::ControlFlowGraph&, Stats&);
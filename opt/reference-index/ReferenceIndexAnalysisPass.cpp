@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ReferenceIndexAnalysisPass.h"
+
+#include "DexUtil.h"
+#include "PassManager.h"
+#include "Trace.h"
+
+void ReferenceIndexAnalysisPass::run_pass(DexStoresVector& stores,
+                                          ConfigFiles&,
+                                          PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  m_result = std::make_shared<opcode_index::OpcodeIndex>(scope);
+  m_result->ensure_built();
+  mgr.set_metric("methods", m_result->size());
+}
+
+std::shared_ptr<opcode_index::OpcodeIndex>
+ReferenceIndexAnalysisPass::get_or_build(const PassManager& mgr,
+                                         const Scope& scope) {
+  auto* analysis = mgr.get_preserved_analysis<ReferenceIndexAnalysisPass>();
+  if (analysis != nullptr && analysis->get_result() != nullptr) {
+    TRACE(PM, 2, "Reusing preserved reference index");
+    return analysis->get_result();
+  }
+  return std::make_shared<opcode_index::OpcodeIndex>(scope);
+}
+
+static ReferenceIndexAnalysisPass s_pass;
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "AnalysisUsage.h"
+#include "DexClass.h"
+#include "OpcodeIndex.h"
+#include "Pass.h"
+
+/*
+ * Builds the scope-wide reverse reference index (referenced method, field,
+ * type or string -> methods whose code references it) and keeps it around as
+ * a preserved analysis, so that passes looking for the users of a few members
+ * don't each have to scan all code.
+ *
+ * Only passes that keep the index exact may declare that they preserve it:
+ * they call `OpcodeIndex::invalidate` for every method whose code they change
+ * and `OpcodeIndex::remove_method` for every method they delete. Rewriting a
+ * ref in place (e.g. `DexMethodRef::change`) keeps its identity, and so keeps
+ * the index valid. Methods created after the index was built are not indexed,
+ * so passes that create methods with code must not preserve it.
+ */
+class ReferenceIndexAnalysisPass : public Pass {
+ public:
+  ReferenceIndexAnalysisPass()
+      : Pass("ReferenceIndexAnalysisPass", Pass::ANALYSIS) {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {};
+  }
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  std::shared_ptr<opcode_index::OpcodeIndex> get_result() { return m_result; }
+
+  void destroy_analysis_result() override { m_result = nullptr; }
+
+  // Returns the preserved index if there is one, and a fresh (lazily built)
+  // index of the given scope otherwise.
+  static std::shared_ptr<opcode_index::OpcodeIndex> get_or_build(
+      const PassManager& mgr, const Scope& scope);
+
+ private:
+  std::shared_ptr<opcode_index::OpcodeIndex> m_result = nullptr;
+};
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ReflectionAnalysisPass.h"
+
+#include "DexUtil.h"
+#include "PassManager.h"
+#include "RedexContext.h"
+#include "ReflectionAnalysisCache.h"
+
+void ReflectionAnalysisPass::run_pass(DexStoresVector& stores,
+                                      ConfigFiles&,
+                                      PassManager& mgr) {
+  auto& cache = g_redex->reflection_analyses();
+  auto before = cache.get_stats();
+  cache.precompute(build_class_scope(stores));
+  auto after = cache.get_stats();
+  mgr.set_metric("analyses_reused", after.hits - before.hits);
+  mgr.set_metric("analyses_computed", after.misses - before.misses);
+}
+
+static ReflectionAnalysisPass s_pass;
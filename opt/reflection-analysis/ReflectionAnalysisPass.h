@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "Pass.h"
+
+/*
+ * Runs the intraprocedural reflection analysis on all methods in parallel,
+ * filling the cache shared by all passes (see
+ * RedexContext::reflection_analyses). Passes that look up reflection sites of
+ * many methods, like class merging or the app module usage checks, then only
+ * pay for the analysis of methods whose code changed since.
+ *
+ * The analyses are owned by the RedexContext and validate themselves against
+ * the code of their method, so this pass is optional: passes don't need to
+ * require it, and no pass needs to invalidate it.
+ */
+class ReflectionAnalysisPass : public Pass {
+ public:
+  ReflectionAnalysisPass() : Pass("ReflectionAnalysisPass", Pass::ANALYSIS) {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {};
+  }
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  void destroy_analysis_result() override {}
+};
@@ -7,11 +7,21 @@
 
 #include "RegAlloc.h"
 
+#include <atomic>
+#include <optional>
+
+#include "ConfigFiles.h"
 #include "Debug.h"
+#include "DexOpcode.h"
 #include "DexUtil.h"
 #include "GraphColoring.h"
+#include "IRCode.h"
+#include "LinearScan.h"
+#include "MethodProfiles.h"
 #include "PassManager.h"
 #include "RegisterAllocation.h"
+#include "Show.h"
+#include "SourceBlocks.h"
 #include "Trace.h"
 #include "Walkers.h"
 
@@ -19,21 +29,150 @@ namespace regalloc {
 
 using Stats = graph_coloring::Allocator::Stats;
 
+namespace {
+
+/*
+ * A method is cold if it doesn't appear in any method profile, and its entry
+ * block was never hit according to its source blocks. Without either kind of
+ * profiling data, we don't know anything, and the method is not cold.
+ */
+bool is_cold(const method_profiles::MethodProfiles& method_profiles,
+             const DexMethod* method) {
+  for (const auto& [interaction_id, stats] :
+       method_profiles.all_interactions()) {
+    if (stats.count(method)) {
+      return false;
+    }
+  }
+  auto& cfg = method->get_code()->cfg();
+  const auto* sb = source_blocks::get_first_source_block(cfg.entry_block());
+  if (sb == nullptr) {
+    return method_profiles.has_stats();
+  }
+  return !sb->foreach_val_early(
+      [](const auto& val) { return val && val->val > 0; });
+}
+
+/*
+ * The linear scan allocator doesn't know about the dex encoding constraints,
+ * so we check that the registers it picked can be encoded: params in the
+ * last registers, operands within the bit widths of their instructions, and
+ * contiguous operands for instructions that need the range form.
+ */
+bool is_encodable(cfg::ControlFlowGraph& cfg,
+                  bool is_static,
+                  bool no_overwrite_this) {
+  auto params = cfg.get_param_instructions();
+  reg_t ins_size = 0;
+  for (const auto& mie : InstructionIterable(params)) {
+    ins_size += mie.insn->dest_is_wide() ? 2 : 1;
+  }
+  if (ins_size > cfg.get_registers_size()) {
+    return false;
+  }
+  reg_t next_param = cfg.get_registers_size() - ins_size;
+  for (const auto& mie : InstructionIterable(params)) {
+    if (mie.insn->dest() != next_param) {
+      return false;
+    }
+    next_param += mie.insn->dest_is_wide() ? 2 : 1;
+  }
+  std::optional<reg_t> this_reg;
+  if (!is_static && no_overwrite_this) {
+    this_reg = params.begin()->insn->dest();
+  }
+
+  auto ii = cfg::InstructionIterable(cfg);
+  for (auto it = ii.begin(); it != ii.end(); ++it) {
+    auto* insn = it->insn;
+    auto op = insn->opcode();
+    if (insn->has_dest()) {
+      auto dest = insn->dest();
+      if (dest > max_unsigned_value(interference::dest_bit_width(it))) {
+        return false;
+      }
+      if (this_reg && !opcode::is_a_load_param(op) &&
+          (dest == *this_reg ||
+           (insn->dest_is_wide() && dest + 1 == *this_reg))) {
+        return false;
+      }
+    }
+    size_t words = 0;
+    for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      words += insn->src_is_wide(i) ? 2 : 1;
+    }
+    if (opcode::has_range_form(op) && words > dex_opcode::NON_RANGE_MAX) {
+      for (size_t i = 1; i < insn->srcs_size(); ++i) {
+        auto prev_width = insn->src_is_wide(i - 1) ? 2 : 1;
+        if (insn->src(i) != insn->src(i - 1) + prev_width) {
+          return false;
+        }
+      }
+      continue;
+    }
+    for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      if (insn->src(i) >
+          interference::max_value_for_src(insn, i, insn->src_is_wide(i))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/*
+ * Runs the linear scan allocator on a copy of the method's code, and installs
+ * the result if it is encodable.
+ */
+bool allocate_with_linear_scan(DexMethod* method, bool no_overwrite_this) {
+  auto code = std::make_unique<IRCode>(*method->get_code());
+  fastregalloc::LinearScanAllocator allocator(
+      code.get(), is_static(method), [method]() { return show(method); });
+  allocator.allocate();
+  if (!is_encodable(code->cfg(), is_static(method), no_overwrite_this)) {
+    return false;
+  }
+  method->set_code(std::move(code));
+  return true;
+}
+
+} // namespace
+
 void RegAllocPass::eval_pass(DexStoresVector&, ConfigFiles&, PassManager&) {
   ++m_eval;
 }
 
 void RegAllocPass::run_pass(DexStoresVector& stores,
-                            ConfigFiles&,
+                            ConfigFiles& conf,
                             PassManager& mgr) {
   graph_coloring::Allocator::Config allocator_config;
   const auto& jw = mgr.get_current_pass_info()->config;
   jw.get("live_range_splitting", false, allocator_config.use_splitting);
+  jw.get("profile_guided_spilling", false,
+         allocator_config.profile_guided_spills);
+  jw.get("prefer_compact_encodings", false,
+         allocator_config.prefer_compact_encodings);
   allocator_config.no_overwrite_this =
       mgr.get_redex_options().no_overwrite_this();
+  bool linear_scan_cold_methods;
+  jw.get("linear_scan_cold_methods", false, linear_scan_cold_methods);
+  bool linear_scan_all_methods;
+  jw.get("linear_scan_all_methods", false, linear_scan_all_methods);
+  const auto& method_profiles = conf.get_method_profiles();
 
   auto scope = build_class_scope(stores);
+  std::atomic<size_t> linear_scan_methods{0};
+  std::atomic<size_t> linear_scan_fallbacks{0};
   auto stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* m) {
+    if (m->get_code() != nullptr &&
+        (linear_scan_all_methods ||
+         (linear_scan_cold_methods && is_cold(method_profiles, m)))) {
+      if (allocate_with_linear_scan(m, allocator_config.no_overwrite_this)) {
+        linear_scan_methods++;
+        return Stats();
+      }
+      linear_scan_fallbacks++;
+    }
     return graph_coloring::allocate(allocator_config, m);
   });
 
@@ -52,6 +191,8 @@ void RegAllocPass::run_pass(DexStoresVector& stores,
   mgr.incr_metric("spill_count", stats.moves_inserted());
   mgr.incr_metric("coalesce_count", stats.moves_coalesced);
   mgr.incr_metric("net_moves", stats.net_moves());
+  mgr.incr_metric("linear_scan_methods", linear_scan_methods);
+  mgr.incr_metric("linear_scan_fallbacks", linear_scan_fallbacks);
 
   ++m_run;
   // For the last invocation, record that final register allocation has been
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "GraphColoring.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Pass.h"
 
 class DexMethod;
@@ -35,12 +36,25 @@ class RegAllocPass : public Pass {
   void bind_config() override {
     bool unused;
     bind("live_range_splitting", false, unused);
+    bind("linear_scan_cold_methods", false, unused,
+         "Allocate registers of methods that never ran according to the "
+         "method profiles and source blocks with the linear scan allocator, "
+         "falling back to graph coloring if the result cannot be encoded.");
+    bind("linear_scan_all_methods", false, unused,
+         "Allocate registers of all methods with the linear scan allocator, "
+         "falling back to graph coloring if the result cannot be encoded. "
+         "This is much faster, at the cost of more registers and moves.");
     trait(Traits::Pass::atleast, 1);
   }
 
   void eval_pass(DexStoresVector& stores,
                  ConfigFiles& conf,
                  PassManager& mgr) override;
+
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
  private:
@@ -269,9 +269,7 @@ void remove_interface_references(
   }
   auto& parent_to_children =
       type_system.get_class_scopes().get_parent_to_children();
-  update_method_signature_type_references(scope, old_to_new,
-                                          parent_to_children);
-  update_field_type_references(scope, old_to_new);
+  update_member_type_references(scope, old_to_new, parent_to_children);
 }
 
 size_t exclude_unremovables(const Scope& scope,
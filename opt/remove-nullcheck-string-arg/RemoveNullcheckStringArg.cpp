@@ -14,6 +14,7 @@
 #include "LiveRange.h"
 #include "PassManager.h"
 #include "ReachingDefinitions.h"
+#include "ReferenceIndexAnalysisPass.h"
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
@@ -33,10 +34,22 @@ void RemoveNullcheckStringArg::run_pass(DexStoresVector& stores,
   }
 
   Scope scope = build_class_scope(stores);
+  // Only methods that call one of the assertions need the (costly) reaching
+  // definitions analysis.
+  auto index = ReferenceIndexAnalysisPass::get_or_build(mgr, scope);
+  std::unordered_set<DexMethod*> candidates;
+  auto add_candidates = [&](const auto& transfer_map) {
+    for (const auto& [assertion, _] : transfer_map) {
+      auto methods = index->methods_referencing(assertion);
+      candidates.insert(methods.begin(), methods.end());
+    }
+  };
+  add_candidates(transfer_map_param);
+  add_candidates(transfer_map_expr);
   Stats stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* method) {
     auto code = method->get_code();
     if (method->rstate.no_optimizations() || code == nullptr ||
-        new_methods.count(method)) {
+        new_methods.count(method) || !candidates.count(method)) {
       return Stats();
     }
     always_assert(code->editable_cfg_built());
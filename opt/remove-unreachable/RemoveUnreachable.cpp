@@ -8,10 +8,12 @@
 #include "RemoveUnreachable.h"
 
 #include <atomic>
+#include <boost/functional/hash.hpp>
 #include <fstream>
 #include <set>
 
 #include "ConfigFiles.h"
+#include "DexHasher.h"
 #include "DexUtil.h"
 #include "IOUtil.h"
 #include "InitClassesWithSideEffects.h"
@@ -34,6 +36,17 @@ const std::string REMOVED_SYMBOLS_REFERENCES_FILENAME =
     "redex-unreachable-removed-symbols-references.txt";
 const std::string RMU_PASS_NAME = "RemoveUnreachablePass";
 
+size_t scope_hash(const Scope& scope) {
+  Timer t("Hashing scope");
+  auto dex_hash = hashing::DexScopeHasher(scope).run();
+  size_t hash = scope.size();
+  boost::hash_combine(hash, dex_hash.positions_hash);
+  boost::hash_combine(hash, dex_hash.registers_hash);
+  boost::hash_combine(hash, dex_hash.code_hash);
+  boost::hash_combine(hash, dex_hash.signature_hash);
+  return hash;
+}
+
 void root_metrics(DexStoresVector& stores, PassManager& pm) {
   auto scope = build_class_scope(stores);
   std::atomic<size_t> root_classes{0};
@@ -214,6 +227,14 @@ void RemoveUnreachablePassBase::bind_config() {
        m_prune_uncallable_virtual_methods);
   bind("prune_unreferenced_interfaces", false, m_prune_unreferenced_interfaces);
   bind("throw_propagation", false, m_throw_propagation);
+  // Track marked classes and members of the scope in atomic bitsets instead
+  // of hashed concurrent sets.
+  bind("dense_marks", false, m_dense_marks);
+  // Skip a run when the scope is unchanged since the end of the previous run
+  // of this pass. Everything left after that run's sweep was marked, so a new
+  // run could at most remove objects that only this pass's own code pruning
+  // made unreachable.
+  bind("skip_unchanged_scope", false, m_skip_unchanged_scope);
   after_configuration([emit_on_last]() {
     if (emit_on_last) {
       s_emit_graph_on_last_run = true;
@@ -259,6 +280,12 @@ void RemoveUnreachablePassBase::run_pass(DexStoresVector& stores,
       m_always_emit_unreachable_symbols ||
       (pm.get_current_pass_info()->repeat == 0 &&
        pm.get_current_pass_info()->pass->name() == RMU_PASS_NAME);
+  if (m_skip_unchanged_scope && !emit_graph_this_run &&
+      m_scope_hash_after_last_run == scope_hash(scope)) {
+    TRACE(RMU, 1, "RMU: scope unchanged since the previous run, skipping");
+    pm.incr_metric("skipped_unchanged_scope", 1);
+    return;
+  }
   TRACE(RMU, 2, "RMU: output unreachable symbols %d",
         output_unreachable_symbols);
   TRACE(RMU, 2, "RMU: remove_no_argument_constructors %d",
@@ -331,6 +358,9 @@ void RemoveUnreachablePassBase::run_pass(DexStoresVector& stores,
   pm.incr_metric("classes_removed", before.num_classes - after.num_classes);
   pm.incr_metric("fields_removed", before.num_fields - after.num_fields);
   pm.incr_metric("methods_removed", before.num_methods - after.num_methods);
+  if (m_skip_unchanged_scope) {
+    m_scope_hash_after_last_run = scope_hash(build_class_scope(stores));
+  }
 
   if (output_unreachable_symbols) {
     std::string filepath = conf.metafile(UNREACHABLE_SYMBOLS_FILENAME);
@@ -404,7 +434,7 @@ RemoveUnreachablePass::compute_reachable_objects(
       reachable_aspects, emit_graph_this_run, relaxed_keep_class_members,
       relaxed_keep_interfaces, cfg_gathering_check_instantiable,
       cfg_gathering_check_instance_callable, cfg_gathering_check_returning,
-      false, remove_no_argument_constructors);
+      false, remove_no_argument_constructors, m_dense_marks);
 }
 
 static RemoveUnreachablePass s_pass;
@@ -73,6 +73,10 @@ class RemoveUnreachablePassBase : public Pass {
   bool m_prune_uncallable_virtual_methods = false;
   bool m_prune_unreferenced_interfaces = false;
   bool m_throw_propagation = false;
+  bool m_dense_marks = false;
+  bool m_skip_unchanged_scope = false;
+  // Hash of the scope as this pass left it at the end of its previous run.
+  std::optional<size_t> m_scope_hash_after_last_run;
 
   static bool s_emit_graph_on_last_run;
   static size_t s_all_reachability_runs;
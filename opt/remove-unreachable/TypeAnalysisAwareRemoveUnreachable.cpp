@@ -354,13 +354,17 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects_with_type_anaysis(
     bool /*unused*/,
     int* num_exact_resolved_callees,
     int* num_unreachable_invokes,
-    int* num_null_invokes) {
+    int* num_null_invokes,
+    bool dense_marks) {
   Timer t("Marking");
   std::unordered_set<const DexClass*> scope_set(scope.begin(), scope.end());
   walk::parallel::code(scope, [](DexMethod*, IRCode& code) {
     code.cfg().calculate_exit_block();
   });
   auto reachable_objects = std::make_unique<ReachableObjects>();
+  if (dense_marks) {
+    reachable_objects->use_dense_marks(scope);
+  }
   ConditionallyMarked cond_marked;
 
   ConcurrentSet<ReachableObject, ReachableObjectHash> root_set;
@@ -443,7 +447,7 @@ TypeAnalysisAwareRemoveUnreachablePass::compute_reachable_objects(
       relaxed_keep_interfaces, cfg_gathering_check_instantiable,
       cfg_gathering_check_instance_callable, cfg_gathering_check_returning,
       gta.get(), remove_no_argument_constructors, &num_exact_resolved_callees,
-      &num_unreachable_invokes, &num_null_invokes);
+      &num_unreachable_invokes, &num_null_invokes, m_dense_marks);
   pm.incr_metric("num_exact_resolved_callees", num_exact_resolved_callees);
   pm.incr_metric("num_unreachable_invokes", num_unreachable_invokes);
   pm.incr_metric("num_null_invokes", num_null_invokes);
@@ -12,6 +12,8 @@
 #include <unordered_map>
 #include <vector>
 
+#include <boost/functional/hash.hpp>
+
 #include "AnnoUtils.h"
 #include "ConfigFiles.h"
 #include "DexClass.h"
@@ -51,6 +53,8 @@ constexpr const char* METRIC_DEAD_INSTRUCTION_COUNT =
 constexpr const char* METRIC_UNREACHABLE_INSTRUCTION_COUNT =
     "num_local_dce_unreachable_instruction_count";
 constexpr const char* METRIC_ITERATIONS = "iterations";
+constexpr const char* METRIC_DEAD_ARGS_CACHE_HITS = "dead_args_cache_hits";
+constexpr const char* METRIC_DEAD_ARGS_CACHE_MISSES = "dead_args_cache_misses";
 
 /**
  * Returns metrics as listed above from running RemoveArgs:
@@ -60,7 +64,12 @@ constexpr const char* METRIC_ITERATIONS = "iterations";
 RemoveArgs::PassStats RemoveArgs::run(ConfigFiles& config) {
   RemoveArgs::PassStats pass_stats;
   gather_results_used();
-  auto override_graph = mog::build_graph(m_scope);
+  std::unique_ptr<const mog::Graph> owned_override_graph;
+  const auto* override_graph = m_override_graph;
+  if (override_graph == nullptr) {
+    owned_override_graph = mog::build_graph(m_scope);
+    override_graph = owned_override_graph.get();
+  }
   compute_reordered_protos(*override_graph);
   auto method_stats =
       update_method_protos(*override_graph, config.get_do_not_devirt_anon());
@@ -440,6 +449,54 @@ std::map<uint16_t, cfg::InstructionIterator> compute_dead_insns(
   return dead_args_and_insns;
 }
 
+size_t DeadArgsCache::fingerprint(const DexMethod* method, const IRCode& code) {
+  size_t seed = 0;
+  boost::hash_combine(seed, method->get_proto());
+  boost::hash_combine(seed, is_static(method));
+  for (const auto& mie : InstructionIterable(code.cfg())) {
+    boost::hash_combine(seed, mie.insn->hash());
+  }
+  return seed;
+}
+
+std::map<uint16_t, cfg::InstructionIterator> DeadArgsCache::get(
+    const DexMethod* method, const IRCode& code) {
+  auto current = fingerprint(method, code);
+  auto entry = m_entries.get(method, Entry());
+  if (!entry.computed || entry.fingerprint != current) {
+    m_misses++;
+    auto dead_insns = compute_dead_insns(method, code);
+    Entry updated{true, current, {}};
+    for (const auto& [idx, _] : dead_insns) {
+      updated.dead_args.push_back(idx);
+    }
+    m_entries.insert_or_assign(std::make_pair(method, std::move(updated)));
+    return dead_insns;
+  }
+  m_hits++;
+
+  // The code is unchanged, so the dead args are the same, but the iterators to
+  // their load-param instructions must be found again.
+  std::map<uint16_t, cfg::InstructionIterator> dead_insns;
+  if (entry.dead_args.empty()) {
+    return dead_insns;
+  }
+  auto* entry_block = code.cfg().entry_block();
+  uint16_t arg_idx = 0;
+  auto ii = InstructionIterable(entry_block);
+  for (auto it = ii.begin(); it != ii.end(); ++it) {
+    if (!opcode::is_a_load_param(it->insn->opcode())) {
+      continue;
+    }
+    if (std::binary_search(entry.dead_args.begin(), entry.dead_args.end(),
+                           arg_idx)) {
+      dead_insns.emplace(arg_idx, entry_block->to_cfg_instruction_iterator(it));
+    }
+    arg_idx++;
+  }
+  return dead_insns;
+}
+
 // When reordering a method's proto, we need to update the method's load-param
 // instructions accordingly. We return the accordingly reshuffled list of
 // (live) argument indices.
@@ -568,7 +625,10 @@ void RemoveArgs::gather_updated_entries(
 
   // Fill in preliminary dead instruction data for methods.
   walk::parallel::code(m_scope, [&](DexMethod* method, IRCode& code) {
-    all_dead_insns.emplace(method, compute_dead_insns(method, code));
+    all_dead_insns.emplace(method,
+                           m_dead_args_cache != nullptr
+                               ? m_dead_args_cache->get(method, code)
+                               : compute_dead_insns(method, code));
   });
 
   auto kvp_workqueue = workqueue_foreach<const MethodAndMethodSet*>(
@@ -891,8 +951,11 @@ void RemoveUnusedArgsPass::run_pass(DexStoresVector& stores,
                                     ConfigFiles& conf,
                                     PassManager& mgr) {
   auto scope = build_class_scope(stores);
-  init_classes::InitClassesWithSideEffects init_classes_with_side_effects(
-      scope, conf.create_init_class_insns());
+  auto init_classes_with_side_effects_ptr =
+      InitClassesAnalysisPass::get_or_build(mgr, scope,
+                                            conf.create_init_class_insns());
+  const auto& init_classes_with_side_effects =
+      *init_classes_with_side_effects_ptr;
 
   size_t num_callsite_args_removed = 0;
   size_t num_method_params_removed = 0;
@@ -902,10 +965,16 @@ void RemoveUnusedArgsPass::run_pass(DexStoresVector& stores,
   size_t num_iterations = 0;
   LocalDce::Stats local_dce_stats;
   auto pure_methods = get_pure_methods();
+  // Methods connected in the override graph are always updated together, and
+  // virtual methods get names that are unique to their group, so the graph
+  // stays valid across iterations.
+  auto override_graph = mog::build_graph(scope);
+  DeadArgsCache dead_args_cache;
   while (true) {
     num_iterations++;
     RemoveArgs rm_args(scope, init_classes_with_side_effects, m_blocklist,
-                       pure_methods, m_total_iterations++);
+                       pure_methods, m_total_iterations++, &dead_args_cache,
+                       override_graph.get());
     auto pass_stats = rm_args.run(conf);
     if (pass_stats.methods_updated_count == 0) {
       break;
@@ -950,6 +1019,8 @@ void RemoveUnusedArgsPass::run_pass(DexStoresVector& stores,
   mgr.set_metric(METRIC_UNREACHABLE_INSTRUCTION_COUNT,
                  local_dce_stats.unreachable_instruction_count);
   mgr.set_metric(METRIC_ITERATIONS, num_iterations);
+  mgr.set_metric(METRIC_DEAD_ARGS_CACHE_HITS, dead_args_cache.hits());
+  mgr.set_metric(METRIC_DEAD_ARGS_CACHE_MISSES, dead_args_cache.misses());
 }
 
 static RemoveUnusedArgsPass s_pass;
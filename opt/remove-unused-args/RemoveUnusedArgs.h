@@ -7,10 +7,12 @@
 
 #pragma once
 
+#include <atomic>
 #include <mutex>
 
 #include "ConcurrentContainers.h"
 #include "ControlFlow.h"
+#include "InitClassesAnalysisPass.h"
 #include "InitClassesWithSideEffects.h"
 #include "LocalDce.h"
 #include "MethodOverrideGraph.h"
@@ -23,6 +25,36 @@ namespace mog = method_override_graph;
 std::map<uint16_t, cfg::InstructionIterator> compute_dead_insns(
     const DexMethod* method, const IRCode& code);
 
+/*
+ * The dead arguments of methods, as found by compute_dead_insns, kept across
+ * the iterations of the pass. Most methods don't change from one iteration to
+ * the next, so the liveness analysis of a method only runs again when the
+ * fingerprint of its proto and code changed, e.g. because arguments were
+ * removed from one of its callsites.
+ */
+class DeadArgsCache {
+ public:
+  std::map<uint16_t, cfg::InstructionIterator> get(const DexMethod* method,
+                                                   const IRCode& code);
+
+  size_t hits() const { return m_hits; }
+  size_t misses() const { return m_misses; }
+
+ private:
+  struct Entry {
+    bool computed{false};
+    size_t fingerprint{0};
+    // Sorted.
+    std::vector<uint16_t> dead_args;
+  };
+
+  static size_t fingerprint(const DexMethod* method, const IRCode& code);
+
+  ConcurrentMap<const DexMethod*, Entry> m_entries;
+  std::atomic<size_t> m_hits{0};
+  std::atomic<size_t> m_misses{0};
+};
+
 class RemoveArgs {
  public:
   struct MethodStats {
@@ -46,12 +78,16 @@ class RemoveArgs {
                  init_classes_with_side_effects,
              const std::vector<std::string>& blocklist,
              const std::unordered_set<DexMethodRef*>& pure_methods,
-             size_t iteration = 0)
+             size_t iteration = 0,
+             DeadArgsCache* dead_args_cache = nullptr,
+             const mog::Graph* override_graph = nullptr)
       : m_scope(scope),
         m_init_classes_with_side_effects(init_classes_with_side_effects),
         m_blocklist(blocklist),
         m_iteration(iteration),
-        m_pure_methods(pure_methods) {}
+        m_pure_methods(pure_methods),
+        m_dead_args_cache(dead_args_cache),
+        m_override_graph(override_graph) {}
   RemoveArgs::PassStats run(ConfigFiles& conf);
 
  private:
@@ -80,6 +116,8 @@ class RemoveArgs {
   const std::vector<std::string>& m_blocklist;
   size_t m_iteration;
   const std::unordered_set<DexMethodRef*>& m_pure_methods;
+  DeadArgsCache* m_dead_args_cache;
+  const mog::Graph* m_override_graph;
 
   DexTypeList::ContainerType get_live_arg_type_list(
       const DexMethod* method, const std::deque<uint16_t>& live_arg_idxs);
@@ -129,6 +167,10 @@ class RemoveUnusedArgsPass : public Pass {
 
   void bind_config() override { bind("blocklist", {}, m_blocklist); }
 
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<InitClassesAnalysisPass>();
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager& mgr) override;
 
  private:
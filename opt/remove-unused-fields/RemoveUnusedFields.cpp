@@ -13,6 +13,7 @@
 #include "CFGMutation.h"
 #include "ConfigFiles.h"
 #include "DexClass.h"
+#include "FieldAccessAnalysisPass.h"
 #include "FieldOpTracker.h"
 #include "IRCode.h"
 #include "InitClassesWithSideEffects.h"
@@ -22,6 +23,7 @@
 #include "Shrinker.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 using namespace remove_unused_fields;
 using namespace shrinker;
@@ -46,9 +48,11 @@ class RemoveUnusedFields final {
                      const ShrinkerConfig& shrinker_config,
                      int min_sdk,
                      DexStoresVector& stores,
-                     const Scope& scope)
+                     const Scope& scope,
+                     const field_op_tracker::FieldAccessIndex& field_accesses)
       : m_config(config),
         m_scope(scope),
+        m_field_accesses(field_accesses),
         m_init_classes_with_side_effects(scope, create_init_class_insns),
         m_shrinker(stores,
                    scope,
@@ -115,8 +119,7 @@ class RemoveUnusedFields final {
   }
 
   void analyze() {
-    field_op_tracker::FieldStatsMap field_stats =
-        field_op_tracker::analyze(m_scope);
+    const auto& field_stats = m_field_accesses.get_field_stats();
 
     std::unique_ptr<field_op_tracker::FieldWrites> field_writes;
     if (m_config.remove_zero_written_fields ||
@@ -166,13 +169,37 @@ class RemoveUnusedFields final {
           m_vestigial_objects_written_fields.size());
   }
 
+  // The methods which write unread fields, or access unwritten or zero
+  // written fields.
+  std::vector<DexMethod*> get_methods_to_transform() const {
+    std::unordered_set<DexMethod*> methods;
+    auto add_methods = [&](const field_op_tracker::FieldAccessIndex::
+                               FieldMethods& field_methods,
+                           const std::unordered_set<const DexField*>& fields) {
+      for (const auto* field : fields) {
+        auto it = field_methods.find(field);
+        if (it != field_methods.end()) {
+          methods.insert(it->second.begin(), it->second.end());
+        }
+      }
+    };
+    add_methods(m_field_accesses.get_writers(), m_unread_fields);
+    add_methods(m_field_accesses.get_readers(), m_unwritten_fields);
+    add_methods(m_field_accesses.get_readers(), m_zero_written_fields);
+    add_methods(m_field_accesses.get_writers(), m_zero_written_fields);
+    return std::vector<DexMethod*>(methods.begin(), methods.end());
+  }
+
   void transform() {
     // Replace reads to unwritten fields with appropriate const-0 instructions,
-    // and remove the writes to unread fields.
-    walk::parallel::code(m_scope, [&](const DexMethod* method, IRCode& code) {
+    // and remove the writes to unread fields. Only the methods accessing those
+    // fields need to be looked at.
+    auto methods = get_methods_to_transform();
+    workqueue_run<DexMethod*>([&](DexMethod* method) {
       if (method->rstate.no_optimizations()) {
         return;
       }
+      auto& code = *method->get_code();
       always_assert(code.editable_cfg_built());
       auto& cfg = code.cfg();
       cfg::CFGMutation m(cfg);
@@ -244,13 +271,14 @@ class RemoveUnusedFields final {
       }
       m.flush();
       if (any_changes) {
-        m_shrinker.shrink_method(const_cast<DexMethod*>(method));
+        m_shrinker.shrink_method(method);
       }
-    });
+    }, methods);
   }
 
   const Config& m_config;
   const Scope& m_scope;
+  const field_op_tracker::FieldAccessIndex& m_field_accesses;
   const init_classes::InitClassesWithSideEffects
       m_init_classes_with_side_effects;
   Shrinker m_shrinker;
@@ -285,8 +313,10 @@ void PassImpl::run_pass(DexStoresVector& stores,
   shrinker_config.compute_pure_methods = false;
 
   int min_sdk = mgr.get_redex_options().min_sdk;
+  auto field_accesses = FieldAccessAnalysisPass::get_or_build(mgr, scope);
   RemoveUnusedFields rmuf(m_config, conf.create_init_class_insns(),
-                          shrinker_config, min_sdk, stores, scope);
+                          shrinker_config, min_sdk, stores, scope,
+                          *field_accesses);
   mgr.set_metric("unread_fields", rmuf.unread_fields().size());
   mgr.set_metric("unwritten_fields", rmuf.unwritten_fields().size());
   mgr.set_metric("zero_written_fields", rmuf.zero_written_fields().size());
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "FieldAccessAnalysisPass.h"
 #include "Pass.h"
 
 /*
@@ -54,6 +55,10 @@ class PassImpl : public Pass {
     };
   }
 
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<FieldAccessAnalysisPass>();
+  }
+
   void bind_config() override {
     bind("remove_unread_fields", true, m_config.remove_unread_fields);
     bind("remove_unwritten_fields", true, m_config.remove_unwritten_fields);
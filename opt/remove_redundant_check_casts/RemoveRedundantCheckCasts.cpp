@@ -7,6 +7,9 @@
 
 #include "RemoveRedundantCheckCasts.h"
 
+#include <atomic>
+#include <mutex>
+
 #include "CheckCastAnalysis.h"
 #include "CheckCastTransform.h"
 #include "ConfigFiles.h"
@@ -37,31 +40,48 @@ void RemoveRedundantCheckCastsPass::bind_config() {
   bind("weaken", m_config.weaken, m_config.weaken);
 }
 
-void RemoveRedundantCheckCastsPass::run_pass(DexStoresVector& stores,
-                                             ConfigFiles& conf,
-                                             PassManager& mgr) {
-  auto scope = build_class_scope(stores);
-  const auto& android_sdk =
-      conf.get_android_sdk_api(mgr.get_redex_options().min_sdk);
-
-  std::atomic<std::size_t> num_magic{0};
-
-  auto stats =
-      walk::parallel::methods<impl::Stats>(scope, [&](DexMethod* method) {
-        if (method->str().find("$xXX") != std::string::npos) {
-          // There is some Ultralight/SwitchInline magic that trips up when
-          // casts get weakened, so that we don't operate on those magic
-          // methods.
-          num_magic++;
-          return impl::Stats();
-        }
-        return remove_redundant_check_casts(m_config, method, android_sdk);
-      });
-
-  mgr.set_metric("num_magic", (size_t)num_magic);
-  mgr.set_metric("num_removed_casts", stats.removed_casts);
-  mgr.set_metric("num_replaced_casts", stats.replaced_casts);
-  mgr.set_metric("num_weakened_casts", stats.weakened_casts);
+namespace {
+
+class RemoveRedundantCheckCastsRun : public MethodLocalPass::Run {
+ public:
+  RemoveRedundantCheckCastsRun(const CheckCastConfig& config,
+                               const api::AndroidSDK& android_sdk)
+      : m_config(config), m_android_sdk(android_sdk) {}
+
+  void run_on_method(DexMethod* method, IRCode& /* code */) override {
+    if (method->str().find("$xXX") != std::string::npos) {
+      // There is some Ultralight/SwitchInline magic that trips up when
+      // casts get weakened, so that we don't operate on those magic
+      // methods.
+      m_num_magic++;
+      return;
+    }
+    auto stats = remove_redundant_check_casts(m_config, method, m_android_sdk);
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    m_stats += stats;
+  }
+
+  void finish(PassManager& mgr) override {
+    mgr.set_metric("num_magic", (size_t)m_num_magic);
+    mgr.set_metric("num_removed_casts", m_stats.removed_casts);
+    mgr.set_metric("num_replaced_casts", m_stats.replaced_casts);
+    mgr.set_metric("num_weakened_casts", m_stats.weakened_casts);
+  }
+
+ private:
+  const CheckCastConfig& m_config;
+  const api::AndroidSDK& m_android_sdk;
+  std::atomic<std::size_t> m_num_magic{0};
+  std::mutex m_stats_mutex;
+  impl::Stats m_stats;
+};
+
+} // namespace
+
+std::unique_ptr<MethodLocalPass::Run> RemoveRedundantCheckCastsPass::start_run(
+    DexStoresVector& /* stores */, ConfigFiles& conf, PassManager& mgr) {
+  return std::make_unique<RemoveRedundantCheckCastsRun>(
+      m_config, conf.get_android_sdk_api(mgr.get_redex_options().min_sdk));
 }
 
 static RemoveRedundantCheckCastsPass s_pass;
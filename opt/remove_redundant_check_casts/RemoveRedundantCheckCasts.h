@@ -12,9 +12,10 @@
 
 namespace check_casts {
 
-class RemoveRedundantCheckCastsPass : public Pass {
+class RemoveRedundantCheckCastsPass : public MethodLocalPass {
  public:
-  RemoveRedundantCheckCastsPass() : Pass("RemoveRedundantCheckCastsPass") {}
+  RemoveRedundantCheckCastsPass()
+      : MethodLocalPass("RemoveRedundantCheckCastsPass") {}
 
   redex_properties::PropertyInteractions get_property_interactions()
       const override {
@@ -29,7 +30,11 @@ class RemoveRedundantCheckCastsPass : public Pass {
 
   void bind_config() override;
 
-  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  bool skips_unchanged_methods() const override { return true; }
+
+  std::unique_ptr<Run> start_run(DexStoresVector&,
+                                 ConfigFiles&,
+                                 PassManager&) override;
 
  private:
   CheckCastConfig m_config;
@@ -958,6 +958,7 @@ void RenameClassesPassV2::rename_classes(
     const rewriter::TypeStringMap& name_mapping,
     PassManager& mgr) {
   const auto& class_map = name_mapping.get_class_map();
+  std::vector<std::pair<DexType*, const DexString*>> renames;
   for (auto* clazz : scope) {
     auto* dtype = clazz->get_type();
     const auto* oldname = dtype->get_name();
@@ -966,7 +967,7 @@ void RenameClassesPassV2::rename_classes(
       continue;
     }
     const auto* dstring = it->second;
-    dtype->set_name(dstring);
+    renames.emplace_back(dtype, dstring);
     m_base_strings_size += oldname->size();
     m_ren_strings_size += dstring->size();
 
@@ -984,9 +985,10 @@ void RenameClassesPassV2::rename_classes(
       std::string newarraytype("[");
       newarraytype += dstring->str();
       dstring = DexString::make_string(newarraytype);
-      arraytype->set_name(dstring);
+      renames.emplace_back(arraytype, dstring);
     }
   }
+  DexType::set_names(renames);
   /* Now rewrite all const-string strings for force renamed classes. */
   rewriter::TypeStringMap force_rename_map;
   for (const auto& pair : name_mapping.get_class_map()) {
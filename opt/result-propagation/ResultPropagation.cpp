@@ -7,20 +7,24 @@
 
 #include "ResultPropagation.h"
 
+#include <boost/functional/hash.hpp>
 #include <vector>
 
 #include <sparta/ConstantAbstractDomain.h>
 #include <sparta/PatriciaTreeMapAbstractEnvironment.h>
 
 #include "BaseIRAnalyzer.h"
+#include "ConcurrentContainers.h"
 #include "ControlFlow.h"
 #include "IRCode.h"
 #include "IRInstruction.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "PassManager.h"
 #include "Resolver.h"
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 using namespace sparta;
 
@@ -503,7 +507,8 @@ void ResultPropagationPass::run_pass(DexStoresVector& stores,
                                      ConfigFiles& /* conf */,
                                      PassManager& mgr) {
   const auto scope = build_class_scope(stores);
-  const auto method_override_graph = method_override_graph::build_graph(scope);
+  const auto method_override_graph =
+      MethodOverrideGraphAnalysisPass::get_or_build(mgr, scope);
   ReturnParamResolver resolver(*method_override_graph);
   const auto methods_which_return_parameter =
       find_methods_which_return_parameter(mgr, scope, resolver);
@@ -536,61 +541,86 @@ void ResultPropagationPass::run_pass(DexStoresVector& stores,
         stats.patched_move_results, stats.unverifiable_move_results);
 }
 
-using ParamIndexMap = std::unordered_map<const DexMethod*, ParamIndex>;
+using Signature = std::pair<const DexString*, const DexProto*>;
 
 std::unordered_map<const DexMethod*, ParamIndex>
 ResultPropagationPass::find_methods_which_return_parameter(
     PassManager& mgr, const Scope& scope, const ReturnParamResolver& resolver) {
+  // void methods cannot return a parameter, skip expensive analysis
+  std::vector<DexMethod*> candidates;
+  walk::methods(scope, [&](DexMethod* method) {
+    if (method->get_code() != nullptr && !method->get_proto()->is_void()) {
+      candidates.push_back(method);
+    }
+  });
+
+  // Resolving an invocation only looks up methods with the name and proto of
+  // the invoked method. So a method only needs to be analyzed again after a
+  // method with the signature of one of its invocations was found to return a
+  // parameter.
+  std::vector<std::vector<Signature>> invoked_signatures(candidates.size());
+  workqueue_run_for<size_t>(0, candidates.size(), [&](size_t i) {
+    auto& code = *candidates[i]->get_code();
+    always_assert(code.editable_cfg_built());
+    for (const auto& mie : cfg::InstructionIterable(code.cfg())) {
+      auto* insn = mie.insn;
+      if (opcode::is_an_invoke(insn->opcode())) {
+        auto* method = insn->get_method();
+        invoked_signatures[i].emplace_back(method->get_name(),
+                                           method->get_proto());
+      }
+    }
+  });
+  std::unordered_map<Signature, std::vector<DexMethod*>,
+                     boost::hash<Signature>>
+      callers;
+  for (size_t i = 0; i < candidates.size(); i++) {
+    auto& signatures = invoked_signatures[i];
+    std::sort(signatures.begin(), signatures.end());
+    signatures.erase(std::unique(signatures.begin(), signatures.end()),
+                     signatures.end());
+    for (auto& signature : signatures) {
+      callers[signature].push_back(candidates[i]);
+    }
+  }
+
+  // We iterate to capture chains of method calls that all eventually return
+  // `this`, each time only analyzing the methods whose invocations might now
+  // resolve differently.
   std::unordered_map<const DexMethod*, ParamIndex>
       methods_which_return_parameter;
-  // We iterate a few times to capture chains of method calls that all
-  // eventually return `this`.
-  // TODO(perf): Add flag to limit number of iterations
-  // TODO(perf): For each analyzed method, keep track of the reasons (a set of
-  // methods) why the call resolution gave up, and use that "dependency"
-  // information to limit what needs to be processed in subsequent iterations
-  while (true) {
+  auto worklist = std::move(candidates);
+  while (!worklist.empty()) {
     mgr.incr_metric(METRIC_METHODS_WHICH_RETURN_PARAMETER_ITERATIONS, 1);
-    const auto next_methods_which_return_parameter =
-        walk::parallel::methods<ParamIndexMap, MergeContainers<ParamIndexMap>>(
-            scope, [&](DexMethod* method) {
-              std::unordered_map<const DexMethod*, ParamIndex> res;
-
-              const auto* code = method->get_code();
-              if (code == nullptr) {
-                return res;
-              }
-              const auto* proto = method->get_proto();
-              if (proto->is_void()) {
-                // void methods cannot return a parameter, skip expensive
-                // analysis
-                return res;
-              }
-
-              const auto mwrpit = methods_which_return_parameter.find(method);
-              if (mwrpit != methods_which_return_parameter.end()) {
-                // Short-circuit re-computing for perf
-                res.insert({method, mwrpit->second});
-                return res;
-              }
-
-              always_assert(code->editable_cfg_built());
-              auto& cfg = code->cfg();
-              const auto return_param_index = resolver.get_return_param_index(
-                  cfg, methods_which_return_parameter);
-              if (return_param_index) {
-                res.insert({method, *return_param_index});
-              }
-
-              return res;
-            });
-
-    if (next_methods_which_return_parameter.size() ==
-        methods_which_return_parameter.size()) {
-      return methods_which_return_parameter;
+    InsertOnlyConcurrentMap<const DexMethod*, ParamIndex> found;
+    workqueue_run<DexMethod*>(
+        [&](DexMethod* method) {
+          const auto return_param_index = resolver.get_return_param_index(
+              method->get_code()->cfg(), methods_which_return_parameter);
+          if (return_param_index) {
+            found.emplace(method, *return_param_index);
+          }
+        },
+        worklist);
+
+    for (auto& [method, param_index] : found) {
+      methods_which_return_parameter.emplace(method, param_index);
+    }
+    std::unordered_set<DexMethod*> affected;
+    for (auto& [method, param_index] : found) {
+      auto it = callers.find({method->get_name(), method->get_proto()});
+      if (it == callers.end()) {
+        continue;
+      }
+      for (auto* caller : it->second) {
+        if (!methods_which_return_parameter.count(caller)) {
+          affected.insert(caller);
+        }
+      }
     }
-    methods_which_return_parameter = next_methods_which_return_parameter;
+    worklist.assign(affected.begin(), affected.end());
   }
+  return methods_which_return_parameter;
 }
 
 static ResultPropagationPass s_pass;
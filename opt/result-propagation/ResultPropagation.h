@@ -8,6 +8,7 @@
 #pragma once
 
 #include "MethodOverrideGraph.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Pass.h"
 #include "Resolver.h"
 
@@ -150,14 +151,18 @@ class ResultPropagationPass : public Pass {
          "Skip propagating results from selected callees.");
   }
 
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
  private:
   std::unordered_set<DexMethod*> m_callee_blocklist;
   /*
-   * Via a fixed point computation that repeatedly inspects all methods,
-   * figure out all methods which return an incoming parameter, taking into
-   * account deep call chains.
+   * Via a fixed point computation that repeatedly inspects the methods whose
+   * invocations might resolve differently, figure out all methods which
+   * return an incoming parameter, taking into account deep call chains.
    */
   static std::unordered_map<const DexMethod*, ParamIndex>
   find_methods_which_return_parameter(PassManager& mgr,
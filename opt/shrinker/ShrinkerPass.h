@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "InitClassesAnalysisPass.h"
 #include "Pass.h"
 #include "ShrinkerConfig.h"
 
@@ -28,6 +29,10 @@ class ShrinkerPass : public Pass {
   }
 
   void bind_config() override;
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_preserve_specific<InitClassesAnalysisPass>();
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
  private:
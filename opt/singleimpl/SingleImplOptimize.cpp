@@ -7,6 +7,7 @@
 
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <stdio.h>
 #include <string>
@@ -34,6 +35,7 @@
 #include "Trace.h"
 #include "TypeReference.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -222,7 +224,7 @@ struct OptimizationImpl {
   EscapeReason can_optimize(const DexType* intf,
                             const SingleImplData& data,
                             bool rename_on_collision);
-  CheckCastSet do_optimize(const DexType* intf, const SingleImplData& data);
+  void do_optimize(const DexType* intf, const SingleImplData& data);
   EscapeReason check_field_collision(const DexType* intf,
                                      const SingleImplData& data);
   EscapeReason check_method_collision(const DexType* intf,
@@ -232,8 +234,9 @@ struct OptimizationImpl {
                                   DexMethod* method);
   void set_field_defs(const DexType* intf, const SingleImplData& data);
   void set_field_refs(const DexType* intf, const SingleImplData& data);
-  CheckCastSet fix_instructions(const DexType* intf,
+  void collect_check_cast_fixes(const DexType* intf,
                                 const SingleImplData& data);
+  CheckCastSet fix_instructions();
   void set_method_defs(const DexType* intf, const SingleImplData& data);
   void set_method_refs(const DexType* intf, const SingleImplData& data);
   void rewrite_interface_methods(const DexType* intf,
@@ -246,7 +249,18 @@ struct OptimizationImpl {
       const std::unordered_set<DexMethod*>& methods,
       std::vector<IRInstruction*>* removed_instruction);
 
+  // A check-cast of a source of an instruction to the implementation.
+  struct CheckCastFix {
+    IRList::iterator insn_it;
+    IRInstruction* insn;
+    src_index_t src;
+    DexType* type;
+  };
+
   std::unique_ptr<SingleImplAnalysis> single_impls;
+  // The check-casts needed by the optimized interfaces, by code. They are all
+  // inserted at once after the interfaces are optimized.
+  std::unordered_map<IRCode*, std::vector<CheckCastFix>> m_check_cast_fixes;
   // A map from interface method to implementing method. We maintain this global
   // map for rewriting method references in annotation.
   NewMethods m_intf_meth_to_impl_meth;
@@ -346,52 +360,102 @@ void for_all_methods(const T& methods, Fn fn, bool parallel = true) {
 //     foo(i); // Java source needs cast here.
 //   }
 //
-// This method inserts check-casts for each invoke parameter and
-// field value. Expectation is that unnecessary insertions (e.g.,
-// duplicate check-casts) will be eliminated, for example, in
-// `post_process`.
-CheckCastSet OptimizationImpl::fix_instructions(const DexType* intf,
+// This method records a check-cast for each invoke parameter and field value
+// of the interface type. It must run before the refs are rewritten, as it
+// looks for the interface in them.
+void OptimizationImpl::collect_check_cast_fixes(const DexType* intf,
                                                 const SingleImplData& data) {
-  if (data.referencing_methods.empty()) {
-    return {};
-  }
-  std::vector<const DexMethod*> methods;
-  methods.reserve(data.referencing_methods.size());
-  std::transform(data.referencing_methods.begin(),
-                 data.referencing_methods.end(), std::back_inserter(methods),
-                 [](auto& p) { return p.first; });
-  // The typical number of methods is too small, it is actually significant
-  // overhead to spin up pool threads to just let them die.
-  constexpr bool PARALLEL = false;
+  for (const auto& [caller, insns] : data.referencing_methods) {
+    auto code = caller->get_code();
+    redex_assert(!code->editable_cfg_built());
+    auto& fixes = m_check_cast_fixes[code];
+    for (const auto& [insn, insn_it] : insns) {
+      auto add_fix = [&, insn = insn, insn_it = insn_it](src_index_t src) {
+        fixes.push_back({insn_it, insn, src, data.cls});
+      };
+
+      if (opcode::is_an_invoke(insn->opcode())) {
+        // We need check-casts for receiver and parameters, but not
+        // return type.
+
+        auto mref = insn->get_method();
+
+        // Receiver.
+        if (mref->get_class() == intf) {
+          add_fix(0);
+        }
+
+        // Parameters.
+        const auto* arg_list = mref->get_proto()->get_args();
+        src_index_t idx = insn->opcode() == OPCODE_INVOKE_STATIC ? 0 : 1;
+        for (const auto arg : *arg_list) {
+          if (arg == intf) {
+            add_fix(idx);
+          }
+          idx++;
+        }
+        continue;
+      }
+
+      if (opcode::is_an_iput(insn->opcode()) ||
+          opcode::is_an_sput(insn->opcode())) {
+        // If the field type is the interface, need a check-cast.
+        auto fdef = insn->get_field();
+        if (fdef->get_type() == intf) {
+          add_fix(0);
+        }
+        continue;
+      }
+
+      // Return.
+      if (opcode::is_return_object(insn->opcode())) {
+        add_fix(0);
+      }
+
+      // Others do not need fixup.
+    }
+  }
+}
+
+/**
+ * Insert the check-casts recorded for all optimized interfaces, in parallel
+ * over the code they are in.
+ */
+CheckCastSet OptimizationImpl::fix_instructions() {
+  std::vector<IRCode*> codes;
+  codes.reserve(m_check_cast_fixes.size());
+  for (auto& [code, _] : m_check_cast_fixes) {
+    codes.push_back(code);
+  }
 
   std::mutex ret_lock;
   CheckCastSet ret;
+  workqueue_run<IRCode*>(
+      [&](IRCode* code) {
+        const auto& fixes = m_check_cast_fixes.at(code);
+        // The fixes of an instruction share the temps of the method, but each
+        // of them needs its own.
+        std::vector<IRInstruction*> insns;
+        std::unordered_map<IRInstruction*, std::vector<const CheckCastFix*>>
+            insn_fixes;
+        for (const auto& fix : fixes) {
+          auto& v = insn_fixes[fix.insn];
+          if (v.empty()) {
+            insns.push_back(fix.insn);
+          }
+          v.push_back(&fix);
+        }
 
-  for_all_methods(
-      methods,
-      [&](const DexMethod* caller_const) {
-        auto caller = const_cast<DexMethod*>(caller_const);
         std::vector<reg_t> temps; // Cached temps.
-        auto code = caller->get_code();
-        redex_assert(!code->editable_cfg_built());
-
-        for (const auto& insn_it_pair : data.referencing_methods.at(caller)) {
-          auto insn_it = insn_it_pair.second;
-          auto insn = insn_it_pair.first;
-
+        std::vector<const IRInstruction*> check_casts;
+        for (auto* insn : insns) {
           auto temp_it = temps.begin();
-          auto add_check_cast = [&](reg_t reg) {
+          for (const auto* fix : insn_fixes.at(insn)) {
             auto check_cast = new IRInstruction(OPCODE_CHECK_CAST);
-            check_cast->set_src(0, reg);
-            check_cast->set_type(data.cls);
-            code->insert_before(insn_it, *new MethodItemEntry(check_cast));
-
-            if (PARALLEL) {
-              std::unique_lock<std::mutex> lock(ret_lock);
-              ret.insert(check_cast);
-            } else {
-              ret.insert(check_cast);
-            }
+            check_cast->set_src(0, insn->src(fix->src));
+            check_cast->set_type(fix->type);
+            code->insert_before(fix->insn_it, *new MethodItemEntry(check_cast));
+            check_casts.push_back(check_cast);
 
             // See if we need a new temp.
             reg_t out;
@@ -408,62 +472,17 @@ CheckCastSet OptimizationImpl::fix_instructions(const DexType* intf,
             auto pseudo_move_result =
                 new IRInstruction(IOPCODE_MOVE_RESULT_PSEUDO_OBJECT);
             pseudo_move_result->set_dest(out);
-            code->insert_before(insn_it,
+            code->insert_before(fix->insn_it,
                                 *new MethodItemEntry(pseudo_move_result));
-
-            return out;
-          };
-
-          if (opcode::is_an_invoke(insn->opcode())) {
-            // We need check-casts for receiver and parameters, but not
-            // return type.
-
-            auto mref = insn->get_method();
-
-            // Receiver.
-            if (mref->get_class() == intf) {
-              reg_t new_receiver = add_check_cast(insn->src(0));
-              insn->set_src(0, new_receiver);
-            }
-
-            // Parameters.
-            const auto* arg_list = mref->get_proto()->get_args();
-            size_t idx = insn->opcode() == OPCODE_INVOKE_STATIC ? 0 : 1;
-            for (const auto arg : *arg_list) {
-              if (arg != intf) {
-                idx++;
-                continue;
-              }
-
-              reg_t new_param = add_check_cast(insn->src(idx));
-              insn->set_src(idx, new_param);
-              idx++;
-            }
-            continue;
-          }
-
-          if (opcode::is_an_iput(insn->opcode()) ||
-              opcode::is_an_sput(insn->opcode())) {
-            // If the field type is the interface, need a check-cast.
-            auto fdef = insn->get_field();
-            if (fdef->get_type() == intf) {
-              reg_t new_param = add_check_cast(insn->src(0));
-              insn->set_src(0, new_param);
-            }
-            continue;
+            insn->set_src(fix->src, out);
           }
-
-          // Return.
-          if (opcode::is_return_object(insn->opcode())) {
-            reg_t casted = add_check_cast(insn->src(0));
-            insn->set_src(0, casted);
-          }
-
-          // Others do not need fixup.
         }
-      },
-      PARALLEL);
 
+        std::lock_guard<std::mutex> lock(ret_lock);
+        ret.insert(check_casts.begin(), check_casts.end());
+      },
+      codes);
+  m_check_cast_fixes.clear();
   return ret;
 }
 
@@ -809,9 +828,9 @@ void OptimizationImpl::rename_possible_collisions(const DexType* intf,
 /**
  * Perform the optimization.
  */
-CheckCastSet OptimizationImpl::do_optimize(const DexType* intf,
-                                           const SingleImplData& data) {
-  CheckCastSet ret = fix_instructions(intf, data);
+void OptimizationImpl::do_optimize(const DexType* intf,
+                                   const SingleImplData& data) {
+  collect_check_cast_fixes(intf, data);
   set_type_refs(intf, data);
   set_field_defs(intf, data);
   set_field_refs(intf, data);
@@ -819,7 +838,6 @@ CheckCastSet OptimizationImpl::do_optimize(const DexType* intf,
   set_method_refs(intf, data);
   rewrite_interface_methods(intf, data);
   remove_interface(intf, data);
-  return ret;
 }
 
 /**
@@ -831,7 +849,6 @@ OptimizeStats OptimizationImpl::optimize(Scope& scope,
   single_impls->get_interfaces(to_optimize);
   std::sort(to_optimize.begin(), to_optimize.end(), compare_dextypes);
   std::unordered_set<DexMethod*> for_post_processing;
-  CheckCastSet inserted_check_casts;
   for (auto intf : to_optimize) {
     auto& intf_data = single_impls->get_single_impl_data(intf);
     if (intf_data.is_escaped()) continue;
@@ -841,13 +858,13 @@ OptimizeStats OptimizationImpl::optimize(Scope& scope,
       single_impls->escape_interface(intf, escape);
       continue;
     }
-    auto check_casts = do_optimize(intf, intf_data);
-    inserted_check_casts.insert(check_casts.begin(), check_casts.end());
+    do_optimize(intf, intf_data);
     for (auto& p : intf_data.referencing_methods) {
       for_post_processing.insert(p.first);
     }
     optimized.insert(intf);
   }
+  auto inserted_check_casts = fix_instructions();
 
   // make a new scope deleting all single impl interfaces
   Scope new_scope;
@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "StartupClinitFoldingPass.h"
+
+#include <optional>
+
+#include "ConfigFiles.h"
+#include "DexAnnotation.h"
+#include "DexUtil.h"
+#include "IRCode.h"
+#include "InitClassesAnalysisPass.h"
+#include "InitDeps.h"
+#include "PassManager.h"
+#include "ReachableClasses.h"
+#include "Resolver.h"
+
+namespace {
+
+/*
+ * The classes with static initializers with side effects that the given
+ * static initializer may trigger, other than its own class.
+ */
+std::vector<const DexClass*> get_cascaded_classes(
+    const DexClass* cls,
+    const cfg::ControlFlowGraph& cfg,
+    const init_classes::InitClassesWithSideEffects&
+        init_classes_with_side_effects) {
+  std::vector<const DexClass*> cascaded;
+  auto add = [&](const DexType* type) {
+    auto* refined_type = init_classes_with_side_effects.refine(type);
+    if (refined_type == nullptr || refined_type == cls->get_type()) {
+      return;
+    }
+    auto* refined_cls = type_class(refined_type);
+    if (std::find(cascaded.begin(), cascaded.end(), refined_cls) ==
+        cascaded.end()) {
+      cascaded.push_back(refined_cls);
+    }
+  };
+  for (const auto& mie : cfg::ConstInstructionIterable(cfg)) {
+    auto* insn = mie.insn;
+    auto op = insn->opcode();
+    if (opcode::is_an_sfield_op(op)) {
+      auto* field = resolve_field(insn->get_field(), FieldSearch::Static);
+      add(field != nullptr ? field->get_class()
+                           : insn->get_field()->get_class());
+    } else if (op == OPCODE_INVOKE_STATIC) {
+      auto* method = resolve_method(insn->get_method(), MethodSearch::Static);
+      add(method != nullptr ? method->get_class()
+                            : insn->get_method()->get_class());
+    } else if (op == OPCODE_NEW_INSTANCE || op == IOPCODE_INIT_CLASS) {
+      add(insn->get_type());
+    }
+  }
+  return cascaded;
+}
+
+struct Constant {
+  int64_t literal{0};
+  const DexString* string{nullptr};
+  bool wide{false};
+};
+
+using FoldedValues =
+    std::vector<std::pair<DexField*, std::unique_ptr<DexEncodedValue>>>;
+
+/*
+ * If the static initializer only stores constants into the static fields of
+ * its class, returns the encoded values that the fields end up with.
+ */
+std::optional<FoldedValues> get_folded_values(
+    const DexClass* cls, const cfg::ControlFlowGraph& cfg) {
+  if (cfg.num_blocks() != 1) {
+    return std::nullopt;
+  }
+  std::unordered_map<reg_t, Constant> regs;
+  auto define = [&regs](reg_t reg, const Constant& constant) {
+    auto it = regs.find(reg - 1);
+    if (reg > 0 && it != regs.end() && it->second.wide) {
+      regs.erase(it);
+    }
+    if (constant.wide) {
+      regs.erase(reg + 1);
+    }
+    regs[reg] = constant;
+  };
+  const DexString* pending_string = nullptr;
+  std::unordered_map<DexField*, Constant> fields;
+  std::vector<DexField*> ordered_fields;
+  for (const auto& mie : cfg::ConstInstructionIterable(cfg)) {
+    auto* insn = mie.insn;
+    auto op = insn->opcode();
+    switch (op) {
+    case OPCODE_CONST:
+    case OPCODE_CONST_WIDE:
+      define(insn->dest(), Constant{insn->get_literal(), nullptr,
+                                    insn->dest_is_wide()});
+      break;
+    case OPCODE_CONST_STRING:
+      pending_string = insn->get_string();
+      break;
+    case IOPCODE_MOVE_RESULT_PSEUDO_OBJECT:
+      if (pending_string == nullptr) {
+        return std::nullopt;
+      }
+      define(insn->dest(), Constant{0, pending_string, false});
+      pending_string = nullptr;
+      break;
+    case OPCODE_RETURN_VOID:
+      break;
+    default: {
+      if (!opcode::is_an_sput(op)) {
+        return std::nullopt;
+      }
+      auto* field = resolve_field(insn->get_field(), FieldSearch::Static);
+      if (field == nullptr || field->get_class() != cls->get_type() ||
+          !field->is_concrete()) {
+        return std::nullopt;
+      }
+      auto it = regs.find(insn->src(0));
+      if (it == regs.end()) {
+        return std::nullopt;
+      }
+      auto [_, inserted] = fields.insert_or_assign(field, it->second);
+      if (inserted) {
+        ordered_fields.push_back(field);
+      }
+      break;
+    }
+    }
+  }
+
+  FoldedValues values;
+  for (auto* field : ordered_fields) {
+    const auto& constant = fields.at(field);
+    auto* type = field->get_type();
+    std::unique_ptr<DexEncodedValue> value;
+    if (constant.string != nullptr) {
+      // Older DalvikVMs only accept string values for fields of type String,
+      // see FinalInlineV2.
+      if (type != type::java_lang_String()) {
+        return std::nullopt;
+      }
+      value = std::make_unique<DexEncodedValueString>(constant.string);
+    } else if (type::is_primitive(type) || constant.literal == 0) {
+      value = DexEncodedValue::zero_for_type(type);
+      value->value(static_cast<uint64_t>(constant.literal));
+    } else {
+      return std::nullopt;
+    }
+    values.emplace_back(field, std::move(value));
+  }
+  return values;
+}
+
+} // namespace
+
+StartupClinitFoldingPass::Stats StartupClinitFoldingPass::run(
+    const Scope& scope,
+    const std::unordered_set<const DexType*>& startup_types,
+    const init_classes::InitClassesWithSideEffects&
+        init_classes_with_side_effects) {
+  Stats stats;
+  std::vector<DexClass*> startup_classes;
+  for (auto* cls : scope) {
+    auto* clinit = cls->get_clinit();
+    if (startup_types.count(cls->get_type()) && clinit != nullptr &&
+        clinit->get_code() != nullptr) {
+      startup_classes.push_back(cls);
+    }
+  }
+  stats.startup_clinits = startup_classes.size();
+
+  // Find the cascades of static initializers with side effects that the
+  // startup classes trigger.
+  std::unordered_map<const DexClass*, std::vector<const DexClass*>> cascades;
+  std::unordered_set<const DexClass*> visited;
+  std::vector<const DexClass*> worklist;
+  for (auto* cls : startup_classes) {
+    if (init_classes_with_side_effects.refine(cls->get_type()) == nullptr) {
+      ++stats.startup_clinits_without_side_effects;
+    }
+    visited.insert(cls);
+    worklist.push_back(cls);
+  }
+  while (!worklist.empty()) {
+    const auto* cls = worklist.back();
+    worklist.pop_back();
+    auto* clinit = cls->get_clinit();
+    if (clinit == nullptr || clinit->get_code() == nullptr) {
+      continue;
+    }
+    auto& cascaded = cascades[cls];
+    cascaded = get_cascaded_classes(cls, clinit->get_code()->cfg(),
+                                    init_classes_with_side_effects);
+    for (const auto* other : cascaded) {
+      if (visited.insert(other).second) {
+        ++stats.cascaded_clinits;
+        worklist.push_back(other);
+      }
+    }
+  }
+
+  // Visit the classes in the order in which their static initializers depend
+  // on each other, so that the depths of the cascaded ones are known first.
+  // The depths within an initialization cycle are underestimated.
+  size_t init_cycles{0};
+  std::unordered_map<const DexClass*, size_t> depths;
+  for (const auto* cls :
+       init_deps::reverse_tsort_by_clinit_deps(scope, init_cycles)) {
+    auto it = cascades.find(cls);
+    if (it == cascades.end()) {
+      continue;
+    }
+    size_t depth = 0;
+    for (const auto* other : it->second) {
+      auto depth_it = depths.find(other);
+      depth = std::max(depth, depth_it == depths.end() ? 1 : depth_it->second);
+    }
+    depths[cls] = depth + 1;
+  }
+  for (const auto* cls : startup_classes) {
+    auto it = depths.find(cls);
+    if (it != depths.end()) {
+      stats.max_cascade_depth = std::max(stats.max_cascade_depth, it->second);
+    }
+  }
+
+  // The superclasses are initialized first. A superclass static initializer
+  // with side effects might read the static fields of the class before the
+  // <clinit> of the class stores into them, so the fields are only given
+  // their values ahead of time when there is none.
+  for (auto* cls : startup_classes) {
+    auto* clinit = cls->get_clinit();
+    if (clinit->rstate.no_optimizations() || !can_delete(clinit)) {
+      continue;
+    }
+    auto* super_type = cls->get_super_class();
+    if (super_type != nullptr &&
+        init_classes_with_side_effects.refine(super_type) != nullptr) {
+      continue;
+    }
+    auto values = get_folded_values(cls, clinit->get_code()->cfg());
+    if (!values) {
+      continue;
+    }
+    for (auto& [field, value] : *values) {
+      field->set_value(std::move(value));
+    }
+    stats.folded_fields += values->size();
+    ++stats.folded_clinits;
+    cls->remove_method(clinit);
+  }
+  return stats;
+}
+
+void StartupClinitFoldingPass::run_pass(DexStoresVector& stores,
+                                        ConfigFiles& conf,
+                                        PassManager& mgr) {
+  std::unordered_set<const DexType*> startup_types;
+  for (const auto& str : conf.get_coldstart_classes()) {
+    auto* type = DexType::get_type(str);
+    if (type != nullptr) {
+      startup_types.insert(type);
+    }
+  }
+  auto scope = build_class_scope(stores);
+  auto init_classes_with_side_effects =
+      InitClassesAnalysisPass::get_or_build(mgr, scope,
+                                            conf.create_init_class_insns());
+  auto stats = run(scope, startup_types, *init_classes_with_side_effects);
+  mgr.set_metric("startup_clinits", stats.startup_clinits);
+  mgr.set_metric("startup_clinits_without_side_effects",
+                 stats.startup_clinits_without_side_effects);
+  mgr.set_metric("cascaded_clinits", stats.cascaded_clinits);
+  mgr.set_metric("max_cascade_depth", stats.max_cascade_depth);
+  mgr.set_metric("folded_clinits", stats.folded_clinits);
+  mgr.set_metric("folded_fields", stats.folded_fields);
+}
+
+static StartupClinitFoldingPass s_pass;
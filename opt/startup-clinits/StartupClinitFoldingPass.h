@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <unordered_set>
+
+#include "DexClass.h"
+#include "InitClassesWithSideEffects.h"
+#include "Pass.h"
+
+/*
+ * Looks at the static initializers of the classes in the cold-start list, and
+ * the cascades of other static initializers they trigger while the app starts.
+ *
+ * A startup class whose <clinit> only stores constants into the static fields
+ * of the class is folded: the constants become the encoded values of the
+ * fields, and the <clinit> is deleted. The class then no longer needs to run
+ * any code when it is initialized, and the VM may consider it initialized
+ * ahead of time, which saves the initialization checks and the locking that
+ * come with running the <clinit>.
+ *
+ * This only folds what it can see without any analysis, so that it can run
+ * late in the pass list, after the passes that may have simplified static
+ * initializers. FinalInlinePassV2 does the general constant propagation over
+ * static initializers.
+ */
+class StartupClinitFoldingPass : public Pass {
+ public:
+  StartupClinitFoldingPass() : Pass("StartupClinitFoldingPass") {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {
+        {NoResolvablePureRefs, Preserves},
+        {HasSourceBlocks, Preserves},
+    };
+  }
+
+  struct Stats {
+    // Startup classes with a <clinit>.
+    size_t startup_clinits{0};
+    // Those among them whose initialization has no side effects.
+    size_t startup_clinits_without_side_effects{0};
+    // Other static initializers with side effects that the startup ones
+    // trigger, directly or transitively.
+    size_t cascaded_clinits{0};
+    // The longest chain of static initializers that trigger each other,
+    // starting from a startup class.
+    size_t max_cascade_depth{0};
+    size_t folded_clinits{0};
+    size_t folded_fields{0};
+  };
+
+  static Stats run(const Scope& scope,
+                   const std::unordered_set<const DexType*>& startup_types,
+                   const init_classes::InitClassesWithSideEffects&
+                       init_classes_with_side_effects);
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+};
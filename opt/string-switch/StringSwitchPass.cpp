@@ -0,0 +1,357 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * Comparing a string against several constants is often written, or
+ * generated, as a chain of String.equals() calls:
+ *
+ *   if (s.equals("foo")) { ... }
+ *   else if (s.equals("bar")) { ... }
+ *   else if (s.equals("baz")) { ... }
+ *   else { ... }
+ *
+ * which calls equals() once per constant until one matches. This pass
+ * rewrites such chains the way javac compiles a switch over strings: a
+ * sparse switch over s.hashCode(), whose cases lead to the equals() calls for
+ * the constants with that hash code, usually a single one. String caches its
+ * hash code, so a miss costs one switch rather than a pass over the chain.
+ *
+ * Chains are found with MatchFlow, as blocks that branch on the result of
+ * String.equals() between a string and a constant, where the failing branch
+ * leads to the next such comparison of the same string. Registers defined by
+ * the chain must be dead on exit, as not every comparison runs anymore.
+ *
+ * hashCode() of constant strings is already folded by constant propagation.
+ */
+
+#include "StringSwitchPass.h"
+
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ControlFlow.h"
+#include "DexClass.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "Liveness.h"
+#include "MatchFlow.h"
+#include "PassManager.h"
+#include "SourceBlocks.h"
+#include "Walkers.h"
+#include "WellKnownTypes.h"
+
+namespace {
+
+constexpr const char* METRIC_CHAINS_TRANSFORMED = "num_chains_transformed";
+constexpr const char* METRIC_CHAIN_LINKS = "num_chain_links";
+
+// A comparison of a string against a constant, at the end of a block:
+//
+//   const-string "..."
+//   move-result-pseudo-object v_lit
+//   invoke-virtual {v_subject, v_lit} Ljava/lang/String;.equals
+//   move-result v_res
+//   if-eqz/if-nez v_res
+//
+// The operands of equals() may be swapped.
+struct Link {
+  cfg::Block* block;
+  IRInstruction* literal;
+  IRInstruction* test;
+  reg_t subject;
+  reg_t literal_reg;
+  reg_t result_reg;
+  bool subject_is_receiver;
+  // The last instruction in the block before the comparison, if any.
+  IRInstruction* before;
+};
+
+// The edge taken when the strings differ.
+cfg::Edge* miss_edge(const cfg::ControlFlowGraph& cfg, const Link& link) {
+  return cfg.get_succ_edge_of_type(link.block,
+                                   link.test->opcode() == OPCODE_IF_EQZ
+                                       ? cfg::EDGE_BRANCH
+                                       : cfg::EDGE_GOTO);
+}
+
+std::optional<Link> parse_link(cfg::Block* block,
+                               IRInstruction* literal,
+                               IRInstruction* equals,
+                               IRInstruction* test,
+                               bool subject_is_receiver) {
+  std::vector<IRInstruction*> insns;
+  for (auto& mie : InstructionIterable(block)) {
+    insns.push_back(mie.insn);
+  }
+  if (insns.size() < 5) {
+    return std::nullopt;
+  }
+  auto tail = insns.end() - 5;
+  if (tail[0] != literal || tail[2] != equals ||
+      tail[3]->opcode() != OPCODE_MOVE_RESULT || tail[4] != test) {
+    return std::nullopt;
+  }
+  Link link{block,
+            literal,
+            test,
+            equals->src(subject_is_receiver ? 0 : 1),
+            tail[1]->dest(),
+            tail[3]->dest(),
+            subject_is_receiver,
+            tail == insns.begin() ? nullptr : tail[-1]};
+  if (equals->src(subject_is_receiver ? 1 : 0) != link.literal_reg ||
+      test->src(0) != link.result_reg || link.subject == link.literal_reg ||
+      link.subject == link.result_reg) {
+    return std::nullopt;
+  }
+  return link;
+}
+
+std::unordered_map<cfg::Block*, Link> find_links(cfg::ControlFlowGraph& cfg) {
+  std::unordered_map<IRInstruction*, cfg::Block*> test_blocks;
+  for (auto* block : cfg.blocks()) {
+    auto it = block->get_last_insn();
+    if (it != block->end() && (it->insn->opcode() == OPCODE_IF_EQZ ||
+                               it->insn->opcode() == OPCODE_IF_NEZ)) {
+      test_blocks.emplace(it->insn, block);
+    }
+  }
+  if (test_blocks.empty()) {
+    return {};
+  }
+
+  auto m_equals = m::invoke_virtual_(m::has_method(
+      m::equals<DexMethodRef>(method::java_lang_String_equals())));
+  auto m_test = m::if_eqz_() || m::if_nez_();
+  auto uniq = mf::alias | mf::unique;
+
+  mf::flow_t f;
+  auto lit = f.insn(m::const_string_());
+  auto eq_recv = f.insn(m_equals).src(1, lit, uniq);
+  auto eq_arg = f.insn(m_equals).src(0, lit, uniq);
+  auto test_recv = f.insn(m_test).src(0, eq_recv, mf::result | mf::unique);
+  auto test_arg = f.insn(m_test).src(0, eq_arg, mf::result | mf::unique);
+  auto res = f.find(cfg, {test_recv, test_arg});
+
+  std::unordered_map<cfg::Block*, Link> links;
+  auto collect = [&](mf::location_t test_loc, mf::location_t eq_loc,
+                     bool subject_is_receiver) {
+    for (auto* test : res.matching(test_loc)) {
+      auto* equals = res.matching(test_loc, test, 0).unique();
+      auto* literal =
+          res.matching(eq_loc, equals, subject_is_receiver ? 1 : 0).unique();
+      auto it = test_blocks.find(test);
+      if (it == test_blocks.end()) {
+        continue;
+      }
+      auto link =
+          parse_link(it->second, literal, equals, test, subject_is_receiver);
+      if (link) {
+        links.emplace(it->second, *link);
+      }
+    }
+  };
+  collect(test_recv, eq_recv, /* subject_is_receiver */ true);
+  collect(test_arg, eq_arg, /* subject_is_receiver */ false);
+  return links;
+}
+
+// Whether any register the chain defines is live on a way out of it.
+bool defines_live_registers(const LivenessFixpointIterator& liveness,
+                            const std::vector<Link>& chain) {
+  std::unordered_set<cfg::Block*> blocks;
+  for (const auto& link : chain) {
+    blocks.insert(link.block);
+  }
+  for (const auto& link : chain) {
+    for (auto* e : link.block->succs()) {
+      if (blocks.count(e->target())) {
+        continue;
+      }
+      const auto& live_in = liveness.get_live_in_vars_at(e->target());
+      for (const auto& l : chain) {
+        if (live_in.contains(l.literal_reg) ||
+            live_in.contains(l.result_reg)) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+cfg::Block* create_block_like(cfg::ControlFlowGraph& cfg, cfg::Block* block) {
+  auto* new_block = cfg.create_block();
+  if (auto* sb = source_blocks::get_first_source_block(block)) {
+    new_block->insert_before(new_block->end(),
+                             source_blocks::clone_as_synthetic(sb));
+  }
+  return new_block;
+}
+
+void transform_chain(cfg::ControlFlowGraph& cfg, std::vector<Link> chain) {
+  auto& head = chain.front();
+  auto* default_block = miss_edge(cfg, chain.back())->target();
+
+  // Find a place for the dispatch in front of the chain.
+  cfg::Block* prefix = nullptr;
+  cfg::Block* dispatch;
+  if (head.before == nullptr) {
+    dispatch = create_block_like(cfg, head.block);
+    std::vector<cfg::Edge*> preds(head.block->preds().begin(),
+                                  head.block->preds().end());
+    for (auto* e : preds) {
+      cfg.set_edge_target(e, dispatch);
+    }
+  } else {
+    prefix = dispatch = head.block;
+    head.block = cfg.split_block(cfg.find_insn(head.before, prefix));
+    // Splitting moves all outgoing edges to the comparison.
+    cfg.copy_succ_edges_of_type(head.block, prefix, cfg::EDGE_THROW);
+    if (auto* sb = source_blocks::get_last_source_block(prefix)) {
+      head.block->insert_before(head.block->begin(),
+                                source_blocks::clone_as_synthetic(sb));
+    }
+  }
+
+  if (!head.subject_is_receiver) {
+    // The constant's equals() is false for null, where hashCode() would
+    // throw.
+    auto* non_null = create_block_like(cfg, head.block);
+    cfg.create_branch(
+        dispatch,
+        (new IRInstruction(OPCODE_IF_EQZ))->set_src(0, head.subject),
+        non_null, default_block);
+    dispatch = non_null;
+  }
+  if (dispatch != prefix) {
+    cfg.copy_succ_edges_of_type(head.block, dispatch, cfg::EDGE_THROW);
+  }
+
+  auto hash_reg = cfg.allocate_temp();
+  dispatch->push_back({(new IRInstruction(OPCODE_INVOKE_VIRTUAL))
+                           ->set_method(method::java_lang_String_hashCode())
+                           ->set_srcs_size(1)
+                           ->set_src(0, head.subject),
+                       (new IRInstruction(OPCODE_MOVE_RESULT))
+                           ->set_dest(hash_reg)});
+
+  // Comparisons against constants with the same hash code stay chained, in
+  // their original order.
+  std::map<int32_t, std::vector<const Link*>> buckets;
+  for (const auto& link : chain) {
+    buckets[link.literal->get_string()->java_hashcode()].push_back(&link);
+  }
+  std::vector<std::pair<int32_t, cfg::Block*>> cases;
+  for (const auto& [hash, bucket] : buckets) {
+    cases.emplace_back(hash, bucket.front()->block);
+    for (size_t i = 0; i < bucket.size(); i++) {
+      auto* next = i + 1 < bucket.size() ? bucket[i + 1]->block : default_block;
+      cfg.set_edge_target(miss_edge(cfg, *bucket[i]), next);
+    }
+  }
+  auto* switch_insn = new IRInstruction(OPCODE_SWITCH);
+  switch_insn->set_src(0, hash_reg);
+  cfg.create_branch(dispatch, switch_insn, default_block, cases);
+}
+
+} // namespace
+
+StringSwitchPass::Stats& StringSwitchPass::Stats::operator+=(
+    const Stats& that) {
+  chains_transformed += that.chains_transformed;
+  chain_links += that.chain_links;
+  return *this;
+}
+
+StringSwitchPass::Stats StringSwitchPass::transform_chains(
+    cfg::ControlFlowGraph& cfg, size_t min_cases) {
+  Stats stats;
+  auto links = find_links(cfg);
+  if (links.size() < min_cases) {
+    return stats;
+  }
+
+  // Connect each comparison to the one that runs when it fails, if that one
+  // does nothing else and has no other predecessors. A comparison with the
+  // string as receiver throws on null, so it must not follow one that does
+  // not.
+  std::unordered_map<cfg::Block*, const Link*> next;
+  std::unordered_set<cfg::Block*> has_prev;
+  for (const auto& [block, link] : links) {
+    auto* succ = miss_edge(cfg, link)->target();
+    auto it = links.find(succ);
+    if (it == links.end() || succ == block) {
+      continue;
+    }
+    const auto& succ_link = it->second;
+    if (succ_link.before == nullptr && succ->preds().size() == 1 &&
+        succ_link.subject == link.subject &&
+        (link.subject_is_receiver || !succ_link.subject_is_receiver)) {
+      next.emplace(block, &succ_link);
+      has_prev.insert(succ);
+    }
+  }
+
+  std::vector<std::vector<Link>> chains;
+  for (auto* block : cfg.blocks()) {
+    if (!links.count(block) || has_prev.count(block)) {
+      continue;
+    }
+    std::vector<Link> chain{links.at(block)};
+    for (auto it = next.find(block); it != next.end();
+         it = next.find(it->second->block)) {
+      chain.push_back(*it->second);
+    }
+    if (chain.size() >= min_cases &&
+        !(chain.front().before == nullptr && block == cfg.entry_block())) {
+      chains.push_back(std::move(chain));
+    }
+  }
+  if (chains.empty()) {
+    return stats;
+  }
+
+  LivenessFixpointIterator liveness(cfg);
+  liveness.run(LivenessDomain());
+  for (const auto& chain : chains) {
+    if (defines_live_registers(liveness, chain)) {
+      continue;
+    }
+    transform_chain(cfg, chain);
+    stats.chains_transformed++;
+    stats.chain_links += chain.size();
+  }
+  return stats;
+}
+
+void StringSwitchPass::bind_config() {
+  bind("min_cases", 3u, m_min_cases,
+       "Minimum number of equals() comparisons in a chain to rewrite it");
+}
+
+void StringSwitchPass::run_pass(DexStoresVector& stores,
+                                ConfigFiles& /* unused */,
+                                PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  auto stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* method) {
+    auto* code = method->get_code();
+    if (code == nullptr || method->rstate.no_optimizations()) {
+      return Stats{};
+    }
+    always_assert(code->editable_cfg_built());
+    return transform_chains(code->cfg(), m_min_cases);
+  });
+
+  mgr.incr_metric(METRIC_CHAINS_TRANSFORMED, stats.chains_transformed);
+  mgr.incr_metric(METRIC_CHAIN_LINKS, stats.chain_links);
+}
+
+static StringSwitchPass s_pass;
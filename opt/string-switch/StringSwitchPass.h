@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "Pass.h"
+
+namespace cfg {
+class ControlFlowGraph;
+} // namespace cfg
+
+class StringSwitchPass : public Pass {
+ public:
+  struct Stats {
+    size_t chains_transformed{0};
+    size_t chain_links{0};
+
+    Stats& operator+=(const Stats&);
+  };
+
+  StringSwitchPass() : Pass("StringSwitchPass") {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {
+        {DexLimitsObeyed, Preserves},
+        {HasSourceBlocks, Preserves},
+        {NoInitClassInstructions, Preserves},
+        {NoResolvablePureRefs, Preserves},
+        {NoUnreachableInstructions, Preserves},
+        {RenameClass, Preserves},
+    };
+  }
+
+  void bind_config() override;
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  // Rewrites chains of at least `min_cases` String.equals() comparisons of the
+  // same string against constants into a switch over the string's hashCode(),
+  // followed by the equals() comparisons whose constants have that hash code.
+  static Stats transform_chains(cfg::ControlFlowGraph& cfg, size_t min_cases);
+
+ private:
+  size_t m_min_cases;
+};
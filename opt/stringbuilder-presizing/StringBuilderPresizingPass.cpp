@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * String concatenation compiles to a chain of StringBuilder calls:
+ *
+ *   new-instance Ljava/lang/StringBuilder;
+ *   invoke-direct {v0} Ljava/lang/StringBuilder;.<init>:()V
+ *   invoke-virtual {v0, v1} Ljava/lang/StringBuilder;.append:(...)
+ *   ...
+ *   invoke-virtual {v0} Ljava/lang/StringBuilder;.toString:()
+ *
+ * The default constructor leaves room for 16 chars, and each append that
+ * overflows the buffer copies it into one about twice as large. This pass
+ * estimates the length of the result and passes it to the StringBuilder(int)
+ * constructor instead, so that the builder is allocated once.
+ *
+ * The appends that reach each toString() are modeled with the analysis of the
+ * StringBuilderOutliner, which only tracks builders that don't escape and are
+ * appended immutable values. Constant strings and primitives count for their
+ * exact length, other primitives for the length of their longest decimal
+ * representation, and other strings for nothing, so the estimate may still
+ * fall short. The capacity is only a hint, so a wrong estimate never changes
+ * behavior.
+ *
+ * The outliner only handles builders created with the default constructor, so
+ * this pass should run after it.
+ */
+
+#include "StringBuilderPresizingPass.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ControlFlow.h"
+#include "DexClass.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "LiveRange.h"
+#include "PassManager.h"
+#include "StringBuilderOutliner.h"
+#include "Walkers.h"
+
+namespace {
+
+constexpr const char* METRIC_BUILDERS_PRESIZED = "num_builders_presized";
+constexpr const char* METRIC_RESERVED_CHARS = "num_reserved_chars";
+
+// The capacity of a StringBuilder created with the default constructor.
+constexpr size_t DEFAULT_CAPACITY = 16;
+
+/*
+ * Returns the largest number of chars that appending a value of the given
+ * type, defined by `defs`, may add. Strings that aren't constant count for 0.
+ */
+size_t estimate_length(const DexType* type,
+                       const sparta::PatriciaTreeSet<IRInstruction*>& defs) {
+  auto all_defs_are = [&](IROpcode op) {
+    return !defs.empty() &&
+           std::all_of(defs.begin(), defs.end(),
+                       [op](auto* def) { return def->opcode() == op; });
+  };
+  size_t length = 0;
+  if (type == type::java_lang_String()) {
+    if (all_defs_are(OPCODE_CONST_STRING)) {
+      for (auto* def : defs) {
+        length = std::max<size_t>(length, def->get_string()->length());
+      }
+    }
+    return length;
+  }
+  if (type == type::_int() && all_defs_are(OPCODE_CONST)) {
+    for (auto* def : defs) {
+      auto value = static_cast<int32_t>(def->get_literal());
+      length = std::max(length, std::to_string(value).size());
+    }
+    return length;
+  }
+  if (type == type::_long() && all_defs_are(OPCODE_CONST_WIDE)) {
+    for (auto* def : defs) {
+      length = std::max(length, std::to_string(def->get_literal()).size());
+    }
+    return length;
+  }
+  if (type == type::_char()) {
+    return 1;
+  } else if (type == type::_boolean()) {
+    return 5; // false
+  } else if (type == type::_int()) {
+    return 11; // -2147483648
+  } else if (type == type::_long()) {
+    return 20; // -9223372036854775808
+  } else if (type == type::_float()) {
+    return 15; // -1.17549435E-38
+  } else if (type == type::_double()) {
+    return 24; // -2.2250738585072014E-308
+  }
+  return 0;
+}
+
+} // namespace
+
+StringBuilderPresizingPass::Stats&
+StringBuilderPresizingPass::Stats::operator+=(const Stats& that) {
+  builders_presized += that.builders_presized;
+  reserved_chars += that.reserved_chars;
+  return *this;
+}
+
+StringBuilderPresizingPass::Stats StringBuilderPresizingPass::presize_builders(
+    cfg::ControlFlowGraph& cfg, size_t max_capacity) {
+  namespace sbo = stringbuilder_outliner;
+
+  Stats stats;
+  auto* default_ctor =
+      DexMethod::get_method("Ljava/lang/StringBuilder;.<init>:()V");
+  auto* string_ctor = DexMethod::get_method(
+      "Ljava/lang/StringBuilder;.<init>:(Ljava/lang/String;)V");
+  auto* tostring = DexMethod::get_method(
+      "Ljava/lang/StringBuilder;.toString:()Ljava/lang/String;");
+  if (default_ctor == nullptr || string_ctor == nullptr ||
+      tostring == nullptr) {
+    return stats;
+  }
+  auto is_call_to = [](const IRInstruction* insn, const DexMethodRef* method) {
+    return opcode::is_an_invoke(insn->opcode()) &&
+           insn->get_method() == method;
+  };
+  auto insns = cfg::ConstInstructionIterable(cfg);
+  if (std::none_of(insns.begin(), insns.end(), [&](const auto& mie) {
+        return is_call_to(mie.insn, default_ctor);
+      })) {
+    return stats;
+  }
+
+  sbo::FixpointIterator fp_iter(cfg);
+  fp_iter.run(sbo::Environment());
+  auto ud_chains = live_range::MoveAwareChains(cfg).get_use_def_chains();
+
+  // The constructor call of each builder, in order, and the largest estimated
+  // length of the builder at one of its toString() calls. Builders are keyed
+  // by their new-instance.
+  std::vector<std::pair<const IRInstruction*, IRInstruction*>> ctors;
+  std::unordered_map<const IRInstruction*, size_t> ctor_counts;
+  std::unordered_map<const IRInstruction*, size_t> lengths;
+  for (auto* block : cfg.blocks()) {
+    auto env = fp_iter.get_entry_state_at(block);
+    for (auto& mie : InstructionIterable(block)) {
+      auto* insn = mie.insn;
+      auto get_builder = [&]() -> const IRInstruction* {
+        const auto& pointers = env.get_pointers(insn->src(0));
+        if (!pointers.is_value() || pointers.elements().size() != 1) {
+          return nullptr;
+        }
+        return *pointers.elements().begin();
+      };
+      if (is_call_to(insn, default_ctor)) {
+        if (const auto* builder = get_builder()) {
+          ctors.emplace_back(builder, insn);
+          ctor_counts[builder]++;
+        }
+      } else if (is_call_to(insn, tostring)) {
+        const auto* builder = get_builder();
+        auto state = builder == nullptr
+                         ? boost::none
+                         : env.get_store().get(builder).state();
+        if (state) {
+          size_t length = 0;
+          for (const auto* append : *state) {
+            auto defs = ud_chains.find(
+                live_range::Use{const_cast<IRInstruction*>(append), 1});
+            if (defs != ud_chains.end()) {
+              length += estimate_length(
+                  append->get_method()->get_proto()->get_args()->at(0),
+                  defs->second);
+            }
+          }
+          auto& max_length = lengths[builder];
+          max_length = std::max(max_length, length);
+        }
+      }
+      fp_iter.analyze_instruction(insn, &env);
+    }
+  }
+
+  auto* capacity_ctor =
+      DexMethod::make_method("Ljava/lang/StringBuilder;.<init>:(I)V");
+  for (auto [builder, ctor] : ctors) {
+    auto length = lengths.find(builder);
+    if (length == lengths.end() || ctor_counts.at(builder) != 1) {
+      continue;
+    }
+    auto capacity = std::min(length->second, max_capacity);
+    if (capacity <= DEFAULT_CAPACITY) {
+      continue;
+    }
+    auto reg = cfg.allocate_temp();
+    auto* const_insn = new IRInstruction(OPCODE_CONST);
+    const_insn->set_literal(capacity)->set_dest(reg);
+    cfg.insert_before(cfg.find_insn(ctor), {const_insn});
+    ctor->set_method(capacity_ctor)->set_srcs_size(2)->set_src(1, reg);
+    stats.builders_presized++;
+    stats.reserved_chars += capacity;
+  }
+  return stats;
+}
+
+void StringBuilderPresizingPass::bind_config() {
+  bind("max_capacity", 256u, m_max_capacity,
+       "Largest initial capacity given to a StringBuilder");
+}
+
+void StringBuilderPresizingPass::run_pass(DexStoresVector& stores,
+                                          ConfigFiles& /* unused */,
+                                          PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  auto stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* method) {
+    auto* code = method->get_code();
+    if (code == nullptr || method->rstate.no_optimizations()) {
+      return Stats{};
+    }
+    always_assert(code->editable_cfg_built());
+    return presize_builders(code->cfg(), m_max_capacity);
+  });
+
+  mgr.incr_metric(METRIC_BUILDERS_PRESIZED, stats.builders_presized);
+  mgr.incr_metric(METRIC_RESERVED_CHARS, stats.reserved_chars);
+}
+
+static StringBuilderPresizingPass s_pass;
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "Pass.h"
+
+namespace cfg {
+class ControlFlowGraph;
+} // namespace cfg
+
+class StringBuilderPresizingPass : public Pass {
+ public:
+  struct Stats {
+    size_t builders_presized{0};
+    size_t reserved_chars{0};
+
+    Stats& operator+=(const Stats&);
+  };
+
+  StringBuilderPresizingPass() : Pass("StringBuilderPresizingPass") {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {
+        {DexLimitsObeyed, Preserves},
+        {HasSourceBlocks, Preserves},
+        {NoInitClassInstructions, Preserves},
+        {NoResolvablePureRefs, Preserves},
+        {NoUnreachableInstructions, Preserves},
+        {RenameClass, Preserves},
+    };
+  }
+
+  void bind_config() override;
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  // Makes default-constructed StringBuilders whose appends up to toString()
+  // are known use the StringBuilder(int) constructor, with the estimated
+  // length of the result capped at `max_capacity` as the initial capacity.
+  static Stats presize_builders(cfg::ControlFlowGraph& cfg,
+                                size_t max_capacity);
+
+ private:
+  size_t m_max_capacity;
+};
@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * Instruction lowering picks a single dex format for each switch: a
+ * packed-switch (a jump table) when the case keys are dense, and a
+ * sparse-switch (sorted keys) otherwise. Sparse switches get dispatched by
+ * searching the keys, and ART compiles them into sequences of comparisons, so
+ * a sparse switch that contains a large dense cluster of keys, or one that
+ * almost always takes the same case, pays for that on every execution.
+ *
+ * This pass rewrites such switches into a dispatch tree:
+ * - Cases that the source block profile shows to be taken in most executions
+ *   of the switch are checked first, with a single if-eq each.
+ * - If the remaining keys are sparse overall, but contain dense clusters, the
+ *   key range is split by binary if-lt checks into segments, each of which is
+ *   dispatched by its own switch. Dense clusters become packed switches. The
+ *   splits balance the profiled weight of the cases, or else the number of
+ *   cases, so that hot cases are closer to the root.
+ *
+ * Switches that are dense, or that have no dense cluster and no hot case, are
+ * left alone. The pass should run late, after passes that rely on the shape of
+ * switches.
+ */
+
+#include "SwitchLoweringPass.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+#include "ControlFlow.h"
+#include "DexClass.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "InstructionLowering.h"
+#include "PassManager.h"
+#include "SourceBlocks.h"
+#include "StlUtil.h"
+#include "Walkers.h"
+
+namespace {
+
+constexpr const char* METRIC_SPLIT_SWITCHES = "num_split_switches";
+constexpr const char* METRIC_PACKED_CLUSTERS = "num_packed_clusters";
+constexpr const char* METRIC_PEELED_HOT_CASES = "num_peeled_hot_cases";
+
+struct Case {
+  int32_t key;
+  cfg::Block* target;
+  float weight;
+};
+
+// A range of cases, ordered by key, that gets dispatched by a single switch.
+struct Segment {
+  size_t begin;
+  size_t end;
+  bool packed;
+};
+
+// The profiled frequency of a block: the largest value of its first source
+// block across all interactions, or zero without a profile.
+float get_weight(cfg::Block* block) {
+  auto* sb = source_blocks::get_first_source_block(block);
+  float weight = 0;
+  if (sb != nullptr) {
+    sb->foreach_val([&](const auto& val) {
+      if (val) {
+        weight = std::max(weight, val->val);
+      }
+    });
+  }
+  return weight;
+}
+
+bool is_sparse(const std::vector<Case>& cases) {
+  instruction_lowering::CaseKeysExtentBuilder extent;
+  for (const auto& c : cases) {
+    extent.insert(c.key);
+  }
+  return extent->sufficiently_sparse();
+}
+
+// Greedily partitions the ordered cases into maximal clusters that are dense
+// enough for a packed switch. Clusters with too few cases are merged with
+// their sparse neighbors.
+std::vector<Segment> partition(const std::vector<Case>& cases,
+                               size_t min_packed_cases) {
+  std::vector<Segment> segments;
+  size_t begin = 0;
+  while (begin < cases.size()) {
+    instruction_lowering::CaseKeysExtentBuilder extent;
+    extent.insert(cases[begin].key);
+    size_t end = begin + 1;
+    for (; end < cases.size(); end++) {
+      auto extended = extent;
+      extended.insert(cases[end].key);
+      if (extended->sufficiently_sparse()) {
+        break;
+      }
+      extent = extended;
+    }
+    bool packed = end - begin >= min_packed_cases;
+    if (!packed && !segments.empty() && !segments.back().packed) {
+      segments.back().end = end;
+    } else {
+      segments.push_back({begin, end, packed});
+    }
+    begin = end;
+  }
+  return segments;
+}
+
+class SwitchLowerer {
+ public:
+  SwitchLowerer(DexMethod* method, cfg::ControlFlowGraph& cfg, cfg::Block* b)
+      : m_method(method),
+        m_cfg(cfg),
+        m_block(b),
+        m_switch_insn(b->get_last_insn()->insn),
+        m_selector(m_switch_insn->src(0)),
+        m_default(b->goes_to()),
+        m_template_sb(source_blocks::get_last_source_block(b)) {}
+
+  void run(const SwitchLoweringPass::Config& config,
+           SwitchLoweringPass::Stats* stats) {
+    for (auto* e : m_cfg.get_succ_edges_of_type(m_block, cfg::EDGE_BRANCH)) {
+      m_cases.push_back({*e->case_key(), e->target(), get_weight(e->target())});
+    }
+    if (m_cases.empty()) {
+      return;
+    }
+    std::sort(m_cases.begin(), m_cases.end(),
+              [](const auto& a, const auto& b) { return a.key < b.key; });
+
+    auto hot_cases = take_hot_cases(config.hot_case_ratio);
+    auto segments = partition(m_cases, config.min_packed_cases);
+    bool split = segments.size() > 1 &&
+                 std::any_of(segments.begin(), segments.end(),
+                             [](const auto& s) { return s.packed; }) &&
+                 is_sparse(m_cases);
+    if (!split && hot_cases.empty()) {
+      return;
+    }
+    if (!split) {
+      segments.clear();
+      if (!m_cases.empty()) {
+        segments.push_back({0, m_cases.size(), /* packed */ false});
+      }
+    }
+
+    m_key_reg = m_cfg.allocate_temp();
+    auto targets = targets_of(0, m_cases.size());
+    auto* head = build_tree(segments, 0, segments.size());
+    for (auto it = hot_cases.rbegin(); it != hot_cases.rend(); ++it) {
+      targets.push_back(it->target);
+      auto* block = make_block(targets);
+      branch_on_key(block, OPCODE_IF_EQ, it->key, head, it->target);
+      head = block;
+    }
+
+    m_cfg.remove_insn(m_cfg.find_insn(m_switch_insn, m_block));
+    m_cfg.set_edge_target(m_cfg.get_succ_edge_of_type(m_block, cfg::EDGE_GOTO),
+                          head);
+
+    if (split) {
+      stats->split_switches++;
+      for (const auto& segment : segments) {
+        stats->packed_clusters += segment.packed;
+      }
+    }
+    stats->peeled_hot_cases += hot_cases.size();
+  }
+
+ private:
+  // Removes and returns the cases that are taken in at least the given
+  // fraction of the executions of the switch, hottest first. Only cases with a
+  // target of their own qualify, so that each takes a single check.
+  std::vector<Case> take_hot_cases(float hot_case_ratio) {
+    std::vector<Case> hot_cases;
+    float switch_weight = get_weight(m_block);
+    if (switch_weight <= 0) {
+      return hot_cases;
+    }
+    std::unordered_map<cfg::Block*, size_t> keys_per_target;
+    for (const auto& c : m_cases) {
+      keys_per_target[c.target]++;
+    }
+    auto is_hot = [&](const Case& c) {
+      return c.target != m_default && keys_per_target.at(c.target) == 1 &&
+             c.weight >= hot_case_ratio * switch_weight;
+    };
+    std::copy_if(m_cases.begin(), m_cases.end(), std::back_inserter(hot_cases),
+                 is_hot);
+    std20::erase_if(m_cases, is_hot);
+    std::stable_sort(
+        hot_cases.begin(), hot_cases.end(),
+        [](const auto& a, const auto& b) { return a.weight > b.weight; });
+    return hot_cases;
+  }
+
+  std::vector<cfg::Block*> targets_of(size_t begin, size_t end) const {
+    std::vector<cfg::Block*> targets{m_default};
+    for (size_t i = begin; i < end; i++) {
+      targets.push_back(m_cases[i].target);
+    }
+    return targets;
+  }
+
+  // Creates a block whose source block reflects the hottest of the targets it
+  // dispatches to.
+  cfg::Block* make_block(const std::vector<cfg::Block*>& targets) {
+    auto* block = m_cfg.create_block();
+    if (m_template_sb != nullptr) {
+      std::vector<SourceBlock*> sbs;
+      for (auto* target : targets) {
+        if (auto* sb = source_blocks::get_first_source_block(target)) {
+          sbs.push_back(sb);
+        }
+      }
+      block->insert_before(
+          block->end(),
+          source_blocks::clone_as_synthetic(m_template_sb, m_method, sbs));
+    }
+    return block;
+  }
+
+  void branch_on_key(cfg::Block* block,
+                     IROpcode op,
+                     int32_t key,
+                     cfg::Block* fls,
+                     cfg::Block* tru) {
+    IRInstruction* if_insn;
+    if (key == 0) {
+      if_insn = new IRInstruction(op == OPCODE_IF_EQ ? OPCODE_IF_EQZ
+                                                     : OPCODE_IF_LTZ);
+      if_insn->set_src(0, m_selector);
+    } else {
+      block->push_back((new IRInstruction(OPCODE_CONST))
+                           ->set_literal(key)
+                           ->set_dest(m_key_reg));
+      if_insn = (new IRInstruction(op))
+                    ->set_src(0, m_selector)
+                    ->set_src(1, m_key_reg);
+    }
+    m_cfg.create_branch(block, if_insn, fls, tru);
+  }
+
+  cfg::Block* build_leaf(const Segment& segment) {
+    auto* block = make_block(targets_of(segment.begin, segment.end));
+    if (segment.end - segment.begin == 1) {
+      const auto& c = m_cases[segment.begin];
+      branch_on_key(block, OPCODE_IF_EQ, c.key, m_default, c.target);
+      return block;
+    }
+    std::vector<std::pair<int32_t, cfg::Block*>> case_to_block;
+    for (size_t i = segment.begin; i < segment.end; i++) {
+      case_to_block.emplace_back(m_cases[i].key, m_cases[i].target);
+    }
+    auto* switch_insn = new IRInstruction(OPCODE_SWITCH);
+    switch_insn->set_src(0, m_selector);
+    m_cfg.create_branch(block, switch_insn, m_default, case_to_block);
+    return block;
+  }
+
+  // Builds a dispatch tree over the segments [begin, end). Each inner node
+  // splits the key range such that the profiled weight, or else the number of
+  // cases, is balanced between both sides.
+  cfg::Block* build_tree(const std::vector<Segment>& segments,
+                         size_t begin,
+                         size_t end) {
+    if (begin == end) {
+      return m_default;
+    }
+    if (end - begin == 1) {
+      return build_leaf(segments[begin]);
+    }
+    auto weight_of = [&](size_t from, size_t to) {
+      float weight = 0;
+      for (size_t i = segments[from].begin; i < segments[to - 1].end; i++) {
+        weight += m_cases[i].weight;
+      }
+      return weight;
+    };
+    auto count_of = [&](size_t from, size_t to) {
+      return (int64_t)(segments[to - 1].end - segments[from].begin);
+    };
+    size_t mid = begin + 1;
+    float best_weight_delta = 0;
+    int64_t best_count_delta = 0;
+    for (size_t i = begin + 1; i < end; i++) {
+      float weight_delta =
+          std::fabs(weight_of(begin, i) - weight_of(i, end));
+      int64_t count_delta = std::abs(count_of(begin, i) - count_of(i, end));
+      if (i == begin + 1 || weight_delta < best_weight_delta ||
+          (weight_delta == best_weight_delta &&
+           count_delta < best_count_delta)) {
+        mid = i;
+        best_weight_delta = weight_delta;
+        best_count_delta = count_delta;
+      }
+    }
+    auto* left = build_tree(segments, begin, mid);
+    auto* right = build_tree(segments, mid, end);
+    auto* block = make_block(
+        targets_of(segments[begin].begin, segments[end - 1].end));
+    branch_on_key(block, OPCODE_IF_LT, m_cases[segments[mid].begin].key,
+                  right, left);
+    return block;
+  }
+
+  DexMethod* m_method;
+  cfg::ControlFlowGraph& m_cfg;
+  cfg::Block* m_block;
+  IRInstruction* m_switch_insn;
+  reg_t m_selector;
+  cfg::Block* m_default;
+  SourceBlock* m_template_sb;
+  std::vector<Case> m_cases;
+  reg_t m_key_reg{0};
+};
+
+} // namespace
+
+SwitchLoweringPass::Stats& SwitchLoweringPass::Stats::operator+=(
+    const Stats& that) {
+  split_switches += that.split_switches;
+  packed_clusters += that.packed_clusters;
+  peeled_hot_cases += that.peeled_hot_cases;
+  return *this;
+}
+
+SwitchLoweringPass::Stats SwitchLoweringPass::lower_switches(
+    const Config& config, DexMethod* method, cfg::ControlFlowGraph& cfg) {
+  Stats stats;
+  std::vector<cfg::Block*> switch_blocks;
+  for (auto* block : cfg.blocks()) {
+    auto it = block->get_last_insn();
+    if (it != block->end() && opcode::is_switch(it->insn->opcode())) {
+      switch_blocks.push_back(block);
+    }
+  }
+  for (auto* block : switch_blocks) {
+    SwitchLowerer(method, cfg, block).run(config, &stats);
+  }
+  return stats;
+}
+
+void SwitchLoweringPass::bind_config() {
+  bind("min_packed_cases", m_config.min_packed_cases,
+       m_config.min_packed_cases,
+       "Minimum number of case keys of a dense cluster to get its own packed "
+       "switch");
+  bind("hot_case_ratio", m_config.hot_case_ratio, m_config.hot_case_ratio,
+       "Fraction of the executions of a switch that makes a case get checked "
+       "first");
+}
+
+void SwitchLoweringPass::run_pass(DexStoresVector& stores,
+                                  ConfigFiles& /* unused */,
+                                  PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  auto stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* method) {
+    auto* code = method->get_code();
+    if (code == nullptr || method->rstate.no_optimizations()) {
+      return Stats{};
+    }
+    always_assert(code->editable_cfg_built());
+    return lower_switches(m_config, method, code->cfg());
+  });
+
+  mgr.incr_metric(METRIC_SPLIT_SWITCHES, stats.split_switches);
+  mgr.incr_metric(METRIC_PACKED_CLUSTERS, stats.packed_clusters);
+  mgr.incr_metric(METRIC_PEELED_HOT_CASES, stats.peeled_hot_cases);
+}
+
+static SwitchLoweringPass s_pass;
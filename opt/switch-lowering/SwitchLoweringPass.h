@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "Pass.h"
+
+class DexMethod;
+
+namespace cfg {
+class ControlFlowGraph;
+} // namespace cfg
+
+class SwitchLoweringPass : public Pass {
+ public:
+  struct Config {
+    // Minimum number of case keys of a dense cluster to get its own packed
+    // switch, when the switch as a whole would be lowered to a sparse switch.
+    size_t min_packed_cases{4};
+    // A case whose target is reached in at least this fraction of the
+    // executions of the switch is checked before all other cases.
+    float hot_case_ratio{0.8f};
+  };
+
+  struct Stats {
+    size_t split_switches{0};
+    size_t packed_clusters{0};
+    size_t peeled_hot_cases{0};
+
+    Stats& operator+=(const Stats&);
+  };
+
+  SwitchLoweringPass() : Pass("SwitchLoweringPass") {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {
+        {DexLimitsObeyed, Preserves},
+        {HasSourceBlocks, Preserves},
+        {NoInitClassInstructions, Preserves},
+        {NoResolvablePureRefs, Preserves},
+        {NoUnreachableInstructions, Preserves},
+        {RenameClass, Preserves},
+    };
+  }
+
+  void bind_config() override;
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  // Rewrites the switches of the given method's CFG into a dispatch tree of
+  // hot-case checks, binary range checks, and switches over dense clusters of
+  // case keys.
+  static Stats lower_switches(const Config& config,
+                              DexMethod* method,
+                              cfg::ControlFlowGraph& cfg);
+
+ private:
+  Config m_config;
+};
@@ -74,7 +74,7 @@ bool is_kotlin_result(const DexMethod* m) {
                             "Lkotlin/Result");
 }
 
-bool has_typedef_annos(ParamAnnotations* param_annos,
+bool has_typedef_annos(const ParamAnnotations* param_annos,
                        const std::unordered_set<DexType*>& typedef_annos) {
   if (!param_annos) {
     return false;
@@ -1419,6 +1419,68 @@ bool TypedefAnnoChecker::is_delegate(const DexMethod* m) {
   return false;
 }
 
+bool TypedefAnnoChecker::has_typedef_params(const DexMethod* m) {
+  if (m_typedef_params_cache == nullptr) {
+    return has_typedef_annos(m->get_param_anno(), m_typedef_annos);
+  }
+  return *m_typedef_params_cache
+              ->get_or_create_and_assert_equal(
+                  m,
+                  [this](const DexMethod* method) {
+                    return has_typedef_annos(method->get_param_anno(),
+                                             m_typedef_annos);
+                  })
+              .first;
+}
+
+bool TypedefAnnoChecker::has_typedef_constraints(DexMethod* m) {
+  auto* return_annos = m->get_anno_set();
+  if (return_annos && type_inference::get_typedef_annotation(
+                          return_annos->get_annotations(), m_typedef_annos)) {
+    return true;
+  }
+  for (const auto& mie : cfg::InstructionIterable(m->get_code()->cfg())) {
+    auto* insn = mie.insn;
+    switch (insn->opcode()) {
+    case OPCODE_INVOKE_VIRTUAL:
+    case OPCODE_INVOKE_SUPER:
+    case OPCODE_INVOKE_DIRECT:
+    case OPCODE_INVOKE_STATIC:
+    case OPCODE_INVOKE_INTERFACE: {
+      auto* callee_def = resolve_method(m, insn);
+      if (!callee_def) {
+        break;
+      }
+      if (has_typedef_params(callee_def)) {
+        return true;
+      }
+      if (mog::is_true_virtual(m_method_override_graph, callee_def) &&
+          !callee_def->get_code()) {
+        for (const auto* overriding : mog::get_overriding_methods(
+                 m_method_override_graph, callee_def)) {
+          if (has_typedef_params(overriding)) {
+            return true;
+          }
+        }
+      }
+      break;
+    }
+    case OPCODE_IPUT:
+    case OPCODE_SPUT:
+    case OPCODE_SPUT_OBJECT:
+    case OPCODE_IPUT_OBJECT:
+      if (type_inference::get_typedef_anno_from_member(insn->get_field(),
+                                                       m_typedef_annos)) {
+        return true;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  return false;
+}
+
 void TypedefAnnoChecker::run(DexMethod* m) {
   IRCode* code = m->get_code();
   if (!code) {
@@ -1430,11 +1492,11 @@ void TypedefAnnoChecker::run(DexMethod* m) {
   }
 
   always_assert(code->editable_cfg_built());
+  if (m_typedef_params_cache != nullptr && !has_typedef_constraints(m)) {
+    return;
+  }
   auto& cfg = code->cfg();
-  std::unordered_set<DexType*> anno_set;
-  anno_set.emplace(m_config.int_typedef);
-  anno_set.emplace(m_config.str_typedef);
-  type_inference::TypeInference inference(cfg, false, anno_set,
+  type_inference::TypeInference inference(cfg, false, m_typedef_annos,
                                           &m_method_override_graph);
   inference.run(m);
 
@@ -1931,9 +1993,11 @@ void TypedefAnnoCheckerPass::run_pass(DexStoresVector& stores,
   patcher.run(scope);
   TRACE(TAC, 2, "Finish patching synth accessors");
 
+  TypedefParamsCache typedef_params_cache;
   auto stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* m) {
-    TypedefAnnoChecker checker = TypedefAnnoChecker(
-        strdef_constants, intdef_constants, m_config, *method_override_graph);
+    TypedefAnnoChecker checker =
+        TypedefAnnoChecker(strdef_constants, intdef_constants, m_config,
+                           *method_override_graph, &typedef_params_cache);
     checker.run(m);
     if (!checker.complete()) {
       return Stats(checker.error());
@@ -71,11 +71,7 @@ struct Stats {
 
   Stats& operator+=(const Stats& other) {
     m_count += other.m_count;
-    if (m_errors.empty()) {
-      m_errors = other.m_errors;
-    } else {
-      m_errors = m_errors + other.m_errors;
-    }
+    m_errors += other.m_errors;
     return *this;
   }
 };
@@ -87,6 +83,10 @@ using StrDefConstants =
 using IntDefConstants =
     InsertOnlyConcurrentMap<const DexClass*, std::unordered_set<uint64_t>>;
 
+// Whether a method expects typedef values in its parameters, computed once
+// per method and shared by the checkers of all its callers.
+using TypedefParamsCache = InsertOnlyConcurrentMap<const DexMethod*, bool>;
+
 class SynthAccessorPatcher {
  public:
   explicit SynthAccessorPatcher(
@@ -139,15 +139,25 @@ class TypedefAnnoChecker {
       const StrDefConstants& strdef_constants,
       const IntDefConstants& intdef_constants,
       const TypedefAnnoCheckerPass::Config& config,
-      const method_override_graph::Graph& method_override_graph)
+      const method_override_graph::Graph& method_override_graph,
+      TypedefParamsCache* typedef_params_cache = nullptr)
       : m_config(config),
         m_strdef_constants(strdef_constants),
         m_intdef_constants(intdef_constants),
-        m_method_override_graph(method_override_graph) {}
+        m_method_override_graph(method_override_graph),
+        m_typedef_params_cache(typedef_params_cache) {
+    m_typedef_annos.insert(config.int_typedef);
+    m_typedef_annos.insert(config.str_typedef);
+  }
 
   bool is_value_of_opt(const DexMethod* m);
   bool is_delegate(const DexMethod* m);
 
+  // Whether the signature of the method, or any of its invocations or field
+  // writes, is subject to a typedef check. The type inference only runs for
+  // methods where this holds.
+  bool has_typedef_constraints(DexMethod* m);
+
   void run(DexMethod* m);
 
   void check_instruction(
@@ -178,4 +188,8 @@ class TypedefAnnoChecker {
   const StrDefConstants& m_strdef_constants;
   const IntDefConstants& m_intdef_constants;
   const method_override_graph::Graph& m_method_override_graph;
+  TypedefParamsCache* m_typedef_params_cache;
+  std::unordered_set<DexType*> m_typedef_annos;
+
+  bool has_typedef_params(const DexMethod* m);
 };
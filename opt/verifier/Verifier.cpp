@@ -16,8 +16,11 @@
 #include <vector>
 
 #include "ConfigFiles.h"
+#include "ControlFlow.h"
 #include "DexClass.h"
 #include "DexUtil.h"
+#include "FrameworkApi.h"
+#include "IRCode.h"
 #include "IRInstruction.h"
 #include "PassManager.h"
 #include "ReachableClasses.h"
@@ -28,6 +31,8 @@
 namespace {
 
 const std::string CLASS_DEPENDENCY_FILENAME = "redex-class-dependencies.txt";
+const std::string SOFT_VERIFICATION_FILENAME =
+    "redex-soft-verification-failures.txt";
 
 using refs_t = std::unordered_map<
     const DexStore*,
@@ -162,6 +167,99 @@ uint64_t verifyStore(const DexStoresVector& stores,
   return dependencies;
 }
 
+/**
+ * Returns a type that the method refers to and that the runtime will likely
+ * not resolve when it verifies the method, or nullptr. That is a type without
+ * any definition, a class in a store that the store of the method does not
+ * depend on, or a framework class that is missing from the minimum SDK. ART
+ * soft-fails the verification of such a method, which then runs in the
+ * interpreter.
+ */
+const DexType* find_unresolvable_type(
+    const DexMethod* method,
+    const std::unordered_set<std::string>& allowed_stores,
+    const class_to_store_map_t& map,
+    const api::AndroidSDK* min_sdk_api) {
+  auto is_unresolvable = [&](const DexType* type) {
+    type = type::get_element_type_if_array(type);
+    if (type::is_primitive(type)) {
+      return false;
+    }
+    auto* cls = type_class(type);
+    if (cls == nullptr) {
+      return true;
+    }
+    if (cls->is_external()) {
+      return min_sdk_api != nullptr && !min_sdk_api->has_type(type);
+    }
+    auto it = map.find(cls);
+    return it != map.end() && !allowed_stores.count(it->second->get_name());
+  };
+  for (const auto& mie :
+       cfg::ConstInstructionIterable(method->get_code()->cfg())) {
+    auto* insn = mie.insn;
+    const DexType* type = nullptr;
+    if (insn->has_type()) {
+      type = insn->get_type();
+    } else if (insn->has_field()) {
+      type = insn->get_field()->get_class();
+    } else if (insn->has_method()) {
+      type = insn->get_method()->get_class();
+    }
+    if (type != nullptr && is_unresolvable(type)) {
+      return type;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Estimates, for each dex, how many methods will soft-fail verification, and
+ * writes the methods along with the type that fails them.
+ */
+uint64_t report_soft_verification_failures(const DexStoresVector& stores,
+                                           const class_to_store_map_t& map,
+                                           allowed_store_map_t& store_map,
+                                           const api::AndroidSDK* min_sdk_api,
+                                           PassManager& mgr,
+                                           FILE* fd) {
+  uint64_t failures{0};
+  for (auto& store : stores) {
+    const auto& allowed_stores = getAllowedStores(stores, store, store_map);
+    const auto& dexen = store.get_dexen();
+    for (size_t dex_nr = 0; dex_nr < dexen.size(); dex_nr++) {
+      InsertOnlyConcurrentMap<const DexMethod*, const DexType*> failing;
+      walk::parallel::code(dexen[dex_nr], [&](DexMethod* method, IRCode&) {
+        auto* type =
+            find_unresolvable_type(method, allowed_stores, map, min_sdk_api);
+        if (type != nullptr) {
+          failing.emplace(method, type);
+        }
+      });
+      if (failing.empty()) {
+        continue;
+      }
+      std::vector<std::pair<std::string, std::string>> lines;
+      lines.reserve(failing.size());
+      for (auto& [method, type] : failing) {
+        lines.emplace_back(show_deobfuscated(method), show(type));
+      }
+      std::sort(lines.begin(), lines.end());
+      for (auto& [method, type] : lines) {
+        fprintf(fd, "%s:%zu:%s->%s\n", store.get_name().c_str(), dex_nr,
+                method.c_str(), type.c_str());
+      }
+      TRACE(VERIFY, 2, "%zu methods in %s dex %zu may soft-fail verification",
+            failing.size(), store.get_name().c_str(), dex_nr);
+      mgr.set_metric("soft_verification_failures_" + store.get_name() + "_" +
+                         std::to_string(dex_nr),
+                     failing.size());
+      failures += failing.size();
+    }
+  }
+  return failures;
+}
+
 } // namespace
 
 void VerifierPass::run_pass(DexStoresVector& stores,
@@ -200,6 +298,25 @@ void VerifierPass::run_pass(DexStoresVector& stores,
 
   TRACE(VERIFY, 1, "%" PRIu64 " dependencies found", dependencies);
   mgr.incr_metric("dependencies", dependencies);
+
+  auto soft_verification_out = conf.metafile(SOFT_VERIFICATION_FILENAME);
+  fd = fopen(soft_verification_out.c_str(), "w");
+  if (fd == nullptr) {
+    perror("Error opening soft verification failures output file");
+    return;
+  }
+  const api::AndroidSDK* min_sdk_api{nullptr};
+  int32_t min_sdk = mgr.get_redex_options().min_sdk;
+  if (conf.get_android_sdk_api_file(min_sdk)) {
+    min_sdk_api = &conf.get_android_sdk_api(min_sdk);
+  }
+  auto failures = report_soft_verification_failures(stores, map, store_map,
+                                                    min_sdk_api, mgr, fd);
+  fclose(fd);
+
+  TRACE(VERIFY, 1, "%" PRIu64 " methods may soft-fail verification",
+        failures);
+  mgr.incr_metric("soft_verification_failures", failures);
 }
 
 static VerifierPass s_pass;
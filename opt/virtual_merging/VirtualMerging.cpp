@@ -42,6 +42,8 @@
 
 #include "VirtualMerging.h"
 
+#include <boost/pending/disjoint_sets.hpp>
+#include <boost/property_map/property_map.hpp>
 #include <utility>
 
 #include "ConfigFiles.h"
@@ -59,6 +61,7 @@
 #include "StlUtil.h"
 #include "TypeSystem.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -1005,13 +1008,14 @@ struct SBHelper {
                                      : parent->get_arbitrary_first_sb(),
             parent->overridden);
         if (overriding_sb != nullptr && first_sb != nullptr) {
+          auto* vals = new_sb->mutable_vals();
           for (size_t i = 0; i != new_sb->vals_size; ++i) {
             if (!new_sb->get_val(i)) {
-              new_sb->vals[i] = first_sb->vals[i];
+              vals[i] = first_sb->vals[i];
             } else if (first_sb->get_val(i)) {
-              new_sb->vals[i]->val += first_sb->vals[i]->val;
-              new_sb->vals[i]->appear100 =
-                  std::max(new_sb->vals[i]->appear100, first_sb->vals[i]->val);
+              vals[i]->val += first_sb->vals[i]->val;
+              vals[i]->appear100 =
+                  std::max(vals[i]->appear100, first_sb->vals[i]->val);
             }
           }
         }
@@ -1066,17 +1070,70 @@ struct SBHelper {
   }
 };
 
-VirtualMergingStats apply_ordering(
+// Partitions the ordering into components of entries that are connected by
+// the methods they involve. Entries of a component must be merged in order,
+// but different components touch disjoint methods and can be merged
+// independently. Components are ordered by their first entry, and keep the
+// entries in the order of the ordering.
+std::vector<std::vector<MethodData*>> partition_ordering(
+    std::vector<MethodData>& ordering) {
+  using Rank = std::unordered_map<const DexMethod*, size_t>;
+  using Parent = std::unordered_map<const DexMethod*, const DexMethod*>;
+  using RankPMap = boost::associative_property_map<Rank>;
+  using ParentPMap = boost::associative_property_map<Parent>;
+  Rank rank;
+  Parent parent;
+  boost::disjoint_sets<RankPMap, ParentPMap> sets((RankPMap(rank)),
+                                                  (ParentPMap(parent)));
+  auto make_set = [&](const DexMethod* method) {
+    if (!parent.count(method)) {
+      sets.make_set(method);
+    }
+  };
+  for (const auto& p : ordering) {
+    make_set(p.first);
+    for (const auto& q : p.second) {
+      for (const auto* overriding_method : q.second) {
+        make_set(overriding_method);
+        sets.union_set(p.first, overriding_method);
+      }
+    }
+  }
+
+  std::vector<std::vector<MethodData*>> components;
+  std::unordered_map<const DexMethod*, size_t> component_indices;
+  for (auto& p : ordering) {
+    auto it = component_indices.emplace(sets.find_set(p.first),
+                                         components.size())
+                  .first;
+    if (it->second == components.size()) {
+      components.emplace_back();
+    }
+    components[it->second].push_back(&p);
+  }
+  return components;
+}
+
+struct ComponentResult {
+  VirtualMergingStats stats;
+  std::vector<const DexMethod*> removed_methods;
+  std::vector<std::pair<DexMethod*, DexMethod*>> remapped_methods;
+  VisibilityChanges visibility_changes;
+};
+
+// Merges the entries of one component, in order. This only changes the code
+// of the overridden methods of the component; access flags and visibility
+// changes are handled by the caller, as other components read them
+// concurrently.
+ComponentResult merge_component(
     MultiMethodInliner& inliner,
-    std::vector<MethodData>& ordering,
-    std::unordered_map<DexClass*, std::vector<const DexMethod*>>&
-        virtual_methods_to_remove,
-    std::unordered_map<DexMethod*, DexMethod*>& virtual_methods_to_remap,
+    const std::vector<MethodData*>& component,
     VirtualMerging::InsertionStrategy insertion_strategy) {
-  VirtualMergingStats stats;
-  for (auto& p : ordering) {
-    auto overridden_method = const_cast<DexMethod*>(p.first);
-    for (auto& q : p.second) {
+  ComponentResult result;
+  auto& stats = result.stats;
+  for (auto* p : component) {
+    auto overridden_method = const_cast<DexMethod*>(p->first);
+    for (auto& q : p->second) {
       if (q.second.empty()) {
         continue;
       }
@@ -1090,7 +1147,7 @@ VirtualMergingStats apply_ordering(
         size_t estimated_callee_size =
             overriding_method->get_code()->estimate_code_units();
         size_t estimated_insn_size =
-            is_abstract(overridden_method)
+            overridden_method->get_code() == nullptr
                 ? 64 // we'll need some extra instruction; 64 is conservative
                 : overridden_method->get_code()->estimate_code_units();
         bool is_inlineable =
@@ -1115,22 +1172,12 @@ VirtualMergingStats apply_ordering(
         std::function<uint32_t()> allocate_wide_temp;
         std::function<void()> cleanup;
         IRCode* overridden_code;
-        // We make the method public to avoid visibility issues. We could be
-        // more conservative (i.e. taking the strongest visibility control
-        // that encompasses the original pair) but I'm not sure it's worth the
-        // effort.
-        set_public(overridden_method);
-        if (is_abstract(overridden_method)) {
-          // We'll make the abstract method be not abstract, and give it a new
-          // method body.
+        if (overridden_method->get_code() == nullptr) {
+          // The formerly abstract method gets a new method body.
           // It starts out with just load-param instructions as needed, and
           // then we'll add an invoke-virtual instruction that will get
           // inlined.
-          stats.unabstracted_methods++;
-          overridden_method->make_concrete(
-              (DexAccessFlags)(overridden_method->get_access() & ~ACC_ABSTRACT),
-              std::make_unique<IRCode>(),
-              true /* is_virtual */);
+          overridden_method->set_code(std::make_unique<IRCode>());
           overridden_code = overridden_method->get_code();
           auto load_param_insn = new IRInstruction(IOPCODE_LOAD_PARAM_OBJECT);
           load_param_insn->set_dest(overridden_code->allocate_temp());
@@ -1323,9 +1370,8 @@ VirtualMergingStats apply_ordering(
             overridden_method, overriding_method, invoke_virtual_insn,
             /* needs_receiver_cast */ nullptr, /* needs_init_class */ nullptr,
             overridden_method->get_code()->cfg().get_registers_size());
-        inliner.visibility_changes_apply_and_record_make_static(
-            get_visibility_changes(overriding_method,
-                                   overridden_method->get_class()));
+        result.visibility_changes.insert(get_visibility_changes(
+            overriding_method, overridden_method->get_class()));
 
         // Check if everything was inlined.
         for (const auto& mie :
@@ -1333,17 +1379,62 @@ VirtualMergingStats apply_ordering(
           redex_assert(invoke_virtual_insn != mie.insn);
         }
 
-        virtual_methods_to_remove[type_class(overriding_method->get_class())]
-            .push_back(overriding_method);
+        result.removed_methods.push_back(overriding_method);
         auto virtual_scope_root = virtual_scope->methods.front();
         always_assert(overriding_method != virtual_scope_root.first);
-        virtual_methods_to_remap.emplace(overriding_method,
-                                         virtual_scope_root.first);
+        result.remapped_methods.emplace_back(overriding_method,
+                                             virtual_scope_root.first);
 
         stats.removed_virtual_methods++;
       }
     }
   }
+  return result;
+}
+
+VirtualMergingStats apply_ordering(
+    MultiMethodInliner& inliner,
+    std::vector<MethodData>& ordering,
+    std::unordered_map<DexClass*, std::vector<const DexMethod*>>&
+        virtual_methods_to_remove,
+    std::unordered_map<DexMethod*, DexMethod*>& virtual_methods_to_remap,
+    VirtualMerging::InsertionStrategy insertion_strategy) {
+  VirtualMergingStats stats;
+  for (auto& p : ordering) {
+    auto overridden_method = const_cast<DexMethod*>(p.first);
+    // We make the method public to avoid visibility issues. We could be
+    // more conservative (i.e. taking the strongest visibility control
+    // that encompasses the original pair) but I'm not sure it's worth the
+    // effort.
+    set_public(overridden_method);
+    if (is_abstract(overridden_method)) {
+      // We'll make the abstract method be not abstract. It gets its body
+      // when its first overriding method is merged.
+      stats.unabstracted_methods++;
+      overridden_method->make_concrete(
+          (DexAccessFlags)(overridden_method->get_access() & ~ACC_ABSTRACT),
+          std::unique_ptr<IRCode>(),
+          true /* is_virtual */);
+    }
+  }
+
+  auto components = partition_ordering(ordering);
+  std::vector<ComponentResult> results(components.size());
+  workqueue_run_for<size_t>(0, components.size(), [&](size_t i) {
+    results[i] = merge_component(inliner, components[i], insertion_strategy);
+  });
+
+  for (auto& result : results) {
+    stats += result.stats;
+    for (auto* method : result.removed_methods) {
+      virtual_methods_to_remove[type_class(method->get_class())].push_back(
+          method);
+    }
+    virtual_methods_to_remap.insert(result.remapped_methods.begin(),
+                                    result.remapped_methods.end());
+    inliner.visibility_changes_apply_and_record_make_static(
+        result.visibility_changes);
+  }
   return stats;
 }
 
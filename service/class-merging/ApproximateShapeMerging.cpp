@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <climits>
 #include <fstream>
+#include <set>
 
 #include "ConfigFiles.h"
 #include "Trace.h"
@@ -71,6 +72,9 @@ void merge_shapes(const Shape& from_shape,
  * `mergeable_count` is the total
  * mergeables of a shape A and its immediate predecessors. This is the mergeable
  * count if all its predecessors are merged into it.
+ *
+ * As the distance is the difference of field counts, only the pairs of shapes
+ * whose field counts are at most `max_distance` apart are compared.
  */
 void build_DAG(MergerType::ShapeCollector& shapes,
                size_t max_distance,
@@ -78,16 +82,29 @@ void build_DAG(MergerType::ShapeCollector& shapes,
                std::unordered_map<Shape, std::unordered_set<Shape>>& succ_map,
                std::unordered_map<Shape, size_t>& mergeable_count) {
   TRACE(CLMG, 5, "[approx] Building Shape DAG");
-  for (const auto& lhs : shapes) {
-    for (const auto& rhs : shapes) {
-      if (lhs.first == rhs.first) {
-        continue;
+  using ShapeEntry = MergerType::ShapeCollector::value_type;
+  std::vector<const ShapeEntry*> by_field_count;
+  by_field_count.reserve(shapes.size());
+  for (const auto& shape_it : shapes) {
+    by_field_count.push_back(&shape_it);
+  }
+  std::stable_sort(by_field_count.begin(), by_field_count.end(),
+                   [](const ShapeEntry* lhs, const ShapeEntry* rhs) {
+                     return lhs->first.field_count() <
+                            rhs->first.field_count();
+                   });
+  for (auto rhs_it = by_field_count.begin(); rhs_it != by_field_count.end();
+       ++rhs_it) {
+    const auto& rhs = **rhs_it;
+    // A shape including another distinct shape has more fields.
+    for (auto lhs_it = std::next(rhs_it); lhs_it != by_field_count.end();
+         ++lhs_it) {
+      const auto& lhs = **lhs_it;
+      size_t dist = lhs.first.field_count() - rhs.first.field_count();
+      if (dist > max_distance) {
+        break;
       }
-      if (lhs.first.includes(rhs.first)) {
-        size_t dist = distance(lhs.first, rhs.first);
-        if (dist > max_distance) {
-          continue;
-        }
+      if (dist > 0 && lhs.first.includes(rhs.first)) {
         TRACE(CLMG, 9, "         - Edge: %s -> %s, dist = %zu",
               rhs.first.to_string().c_str(), lhs.first.to_string().c_str(),
               dist);
@@ -354,23 +371,41 @@ void max_mergeable_greedy(const JsonWrapper& specs,
   for (const auto& s_pair : pred_map) {
     target_list.push_back(s_pair.first);
   }
+  std::unordered_map<Shape, size_t> target_index;
+  for (size_t i = 0; i < target_list.size(); ++i) {
+    target_index[target_list[i]] = i;
+  }
+
+  // The target shapes left to process, by decreasing mergeable_count and then
+  // by position in target_list. Because std::priority_queue does not support
+  // priority updates, an ordered set is used instead, and only the entries of
+  // the shapes whose mergeable_count changes are updated.
+  using QueueEntry = std::pair<size_t, size_t>;
+  auto by_count = [](const QueueEntry& lhs, const QueueEntry& rhs) {
+    return lhs.first != rhs.first ? lhs.first > rhs.first
+                                  : lhs.second < rhs.second;
+  };
+  std::set<QueueEntry, decltype(by_count)> queue(by_count);
+  for (size_t i = 0; i < target_list.size(); ++i) {
+    queue.emplace(mergeable_count[target_list[i]], i);
+  }
+  auto decrease_count = [&](const Shape& shape, size_t delta) {
+    auto& count = mergeable_count[shape];
+    auto it = target_index.find(shape);
+    if (it != target_index.end() && queue.erase({count, it->second})) {
+      queue.emplace(count - delta, it->second);
+    }
+    count -= delta;
+  };
 
   std::unordered_map<Shape, std::unordered_set<Shape>> merge_map;
 
   // Greedily select a group of shapes that can be merged into one
-  // (target_shape) in terms of total mergeable count in that group. target_list
-  // acts as a priority queue. Because std::priority_queue does not support
-  // priority updates, we have to implement one.
-  while (!target_list.empty()) {
-    // Find the target shape with the largest mergeable_count.
-    auto max_elem =
-        std::max_element(target_list.begin(), target_list.end(),
-                         [&](const Shape& lhs, const Shape& rhs) {
-                           return mergeable_count[lhs] < mergeable_count[rhs];
-                         });
-
-    Shape to_shape = *max_elem;
-    target_list.erase(max_elem);
+  // (target_shape) in terms of total mergeable count in that group.
+  while (!queue.empty()) {
+    // Take the target shape with the largest mergeable_count.
+    Shape to_shape = target_list[queue.begin()->second];
+    queue.erase(queue.begin());
 
     if (pred_map.find(to_shape) == pred_map.end()) {
       continue;
@@ -382,7 +417,7 @@ void max_mergeable_greedy(const JsonWrapper& specs,
     // Update mergeable_count of to_shape's successors
     if (succ_map.find(to_shape) != succ_map.end()) {
       for (const auto& succ : succ_map[to_shape]) {
-        mergeable_count[succ] -= shapes[to_shape].types.size();
+        decrease_count(succ, shapes[to_shape].types.size());
       }
     }
 
@@ -393,7 +428,7 @@ void max_mergeable_greedy(const JsonWrapper& specs,
       // DAG.
       always_assert(succ_map.find(from_shape) != succ_map.end());
       for (const auto& succ : succ_map[from_shape]) {
-        mergeable_count[succ] -= shapes[from_shape].types.size();
+        decrease_count(succ, shapes[from_shape].types.size());
       }
       remove_from_DAG(from_shape, pred_map, succ_map);
       // stats
@@ -99,11 +99,34 @@ void load_roots_subtypes_as_merging_targets(const TypeSystem& type_system,
 
 namespace class_merging {
 
+MergeabilitySummaries summarize_mergeability(
+    const Scope& scope, const std::vector<ModelSpec>& specs) {
+  Timer t("summarize_mergeability");
+  TypeSystem type_system(scope);
+  ConstTypeHashSet candidates;
+  for (const auto& spec : specs) {
+    if (!spec.enabled || spec.roots.empty()) {
+      continue;
+    }
+    if (spec.merging_targets.empty()) {
+      ModelSpec copy = spec;
+      load_roots_subtypes_as_merging_targets(type_system, &copy);
+      candidates.insert(copy.merging_targets.begin(),
+                        copy.merging_targets.end());
+    } else {
+      candidates.insert(spec.merging_targets.begin(),
+                        spec.merging_targets.end());
+    }
+  }
+  return MergeabilitySummaries(scope, candidates);
+}
+
 ModelStats merge_model(Scope& scope,
                        ConfigFiles& conf,
                        PassManager& mgr,
                        DexStoresVector& stores,
-                       ModelSpec& spec) {
+                       ModelSpec& spec,
+                       const MergeabilitySummaries* summaries) {
   always_assert(!spec.roots.empty());
   TypeSystem type_system(scope);
   if (spec.merging_targets.empty()) {
@@ -112,7 +135,7 @@ ModelStats merge_model(Scope& scope,
   if (spec.merging_targets.empty()) {
     return ModelStats();
   }
-  return merge_model(type_system, scope, conf, mgr, stores, spec);
+  return merge_model(type_system, scope, conf, mgr, stores, spec, summaries);
 }
 
 ModelStats merge_model(const TypeSystem& type_system,
@@ -120,7 +143,8 @@ ModelStats merge_model(const TypeSystem& type_system,
                        ConfigFiles& conf,
                        PassManager& mgr,
                        DexStoresVector& stores,
-                       ModelSpec& spec) {
+                       ModelSpec& spec,
+                       const MergeabilitySummaries* summaries) {
   TRACE(CLMG,
         2,
         "[ClassMerging] merging %s model merging targets %zu roots %zu",
@@ -132,8 +156,8 @@ ModelStats merge_model(const TypeSystem& type_system,
   XStoreRefs xstores(stores);
   auto refchecker =
       create_ref_checker(spec.per_dex_grouping, &xstores, conf, min_sdk);
-  auto model =
-      Model::build_model(scope, stores, conf, spec, type_system, *refchecker);
+  auto model = Model::build_model(scope, stores, conf, spec, type_system,
+                                  *refchecker, summaries);
   ModelStats stats = model.get_model_stats();
   bool update_method_profiles_stats;
   conf.get_json_config().get(
@@ -153,7 +177,8 @@ Model construct_model(const TypeSystem& type_system,
                       ConfigFiles& conf,
                       PassManager& mgr,
                       DexStoresVector& stores,
-                      ModelSpec& spec) {
+                      ModelSpec& spec,
+                      const MergeabilitySummaries* summaries) {
   TRACE(CLMG,
         2,
         "[ClassMerging] merging %s model merging targets %zu roots %zu",
@@ -165,8 +190,8 @@ Model construct_model(const TypeSystem& type_system,
   XStoreRefs xstores(stores);
   auto refchecker =
       create_ref_checker(spec.per_dex_grouping, &xstores, conf, min_sdk);
-  auto model =
-      Model::build_model(scope, stores, conf, spec, type_system, *refchecker);
+  auto model = Model::build_model(scope, stores, conf, spec, type_system,
+                                  *refchecker, summaries);
   return model;
 }
 
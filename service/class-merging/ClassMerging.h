@@ -7,27 +7,39 @@
 
 #pragma once
 
+#include "MergeabilityCheck.h"
 #include "Model.h"
 
 namespace class_merging {
 
+/**
+ * Summarizes the bytecode mergeability of the merging targets of all the
+ * enabled `specs` in one parallel walk of the scope. The specs with no
+ * merging targets are summarized for the subtypes of their roots.
+ */
+MergeabilitySummaries summarize_mergeability(
+    const Scope& scope, const std::vector<ModelSpec>& specs);
+
 ModelStats merge_model(Scope& scope,
                        ConfigFiles& conf,
                        PassManager& mgr,
                        DexStoresVector& stores,
-                       ModelSpec& spec);
+                       ModelSpec& spec,
+                       const MergeabilitySummaries* summaries = nullptr);
 
 ModelStats merge_model(const TypeSystem&,
                        Scope& scope,
                        ConfigFiles& conf,
                        PassManager& mgr,
                        DexStoresVector& stores,
-                       ModelSpec& spec);
+                       ModelSpec& spec,
+                       const MergeabilitySummaries* summaries = nullptr);
 
 Model construct_model(const TypeSystem& type_system,
                       Scope& scope,
                       ConfigFiles& conf,
                       PassManager& mgr,
                       DexStoresVector& stores,
-                      ModelSpec& spec);
+                      ModelSpec& spec,
+                      const MergeabilitySummaries* summaries = nullptr);
 } // namespace class_merging
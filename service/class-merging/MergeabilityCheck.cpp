@@ -7,6 +7,9 @@
 
 #include "MergeabilityCheck.h"
 
+#include <algorithm>
+#include <optional>
+
 #include "LiveRange.h"
 #include "Model.h"
 #include "ReachableClasses.h"
@@ -16,19 +19,22 @@
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 using namespace class_merging;
 
 MergeabilityChecker::MergeabilityChecker(const Scope& scope,
                                          const ModelSpec& spec,
                                          const RefChecker& ref_checker,
-                                         const TypeSet& generated)
+                                         const TypeSet& generated,
+                                         const MergeabilitySummaries* summaries)
     : m_scope(scope),
       m_spec(spec),
       m_ref_checker(ref_checker),
       m_generated(generated),
       m_const_class_safe_types(spec.const_class_safe_types),
-      m_track_use_of_reflection(spec.mergeability_checks_use_of_const_class) {}
+      m_track_use_of_reflection(spec.mergeability_checks_use_of_const_class),
+      m_summaries(summaries) {}
 
 void MergeabilityChecker::exclude_unsupported_cls_property(
     TypeSet& non_mergeables) {
@@ -64,28 +70,49 @@ void MergeabilityChecker::exclude_unsupported_cls_property(
   }
 }
 
-TypeSet MergeabilityChecker::exclude_unsupported_bytecode_refs_for(
-    DexMethod* method) {
-  TypeSet non_mergeables;
-  auto code = method->get_code();
-  if (!code || m_generated.count(method->get_class())) {
-    return non_mergeables;
+MergeabilitySummaries::MergeabilitySummaries(
+    const Scope& scope, const ConstTypeHashSet& candidates)
+    : m_candidates(candidates) {
+  if (m_candidates.empty()) {
+    return;
   }
+  std::vector<DexMethod*> methods;
+  walk::code(scope,
+             [&](DexMethod* method, IRCode&) { methods.push_back(method); });
+  std::vector<MethodSummary> summaries(methods.size());
+  workqueue_run_for<size_t>(0, methods.size(), [&](size_t i) {
+    summaries[i] = summarize(methods[i], m_candidates);
+  });
+  for (auto& summary : summaries) {
+    if (!summary.empty()) {
+      m_summaries.push_back(std::move(summary));
+    }
+  }
+  TRACE(CLMG, 4, "Summarized %zu of %zu methods for %zu candidates",
+        m_summaries.size(), methods.size(), m_candidates.size());
+}
+
+bool MergeabilitySummaries::covers(const ConstTypeHashSet& types) const {
+  return std::all_of(types.begin(), types.end(), [&](const DexType* type) {
+    return m_candidates.count(type) > 0;
+  });
+}
 
-  bool has_type_tag = m_spec.has_type_tag();
-  std::vector<std::pair<IRInstruction*, const DexType*>>
-      const_classes_to_verify;
-  std::unordered_set<const IRInstruction*> const_classes_to_verify_set;
+MergeabilitySummaries::MethodSummary MergeabilitySummaries::summarize(
+    DexMethod* method, const ConstTypeHashSet& candidates) {
+  MethodSummary summary;
+  summary.method = method;
+  std::vector<std::pair<IRInstruction*, size_t>> const_classes_to_verify;
   std::vector<IRInstruction*> new_instances_to_verify;
-  std::unordered_set<const IRInstruction*> new_instances_to_verify_set;
-  auto& cfg = code->cfg();
+  std::unordered_set<const IRInstruction*> insns_to_verify;
+  auto& cfg = method->get_code()->cfg();
   for (const auto& mie : InstructionIterable(cfg)) {
     auto insn = mie.insn;
 
     if (opcode::is_new_instance(insn->opcode()) &&
-        m_spec.merging_targets.count(insn->get_type())) {
+        candidates.count(insn->get_type())) {
       new_instances_to_verify.push_back(insn);
-      new_instances_to_verify_set.insert(insn);
+      insns_to_verify.insert(insn);
       continue;
     }
 
@@ -97,123 +124,65 @@ TypeSet MergeabilityChecker::exclude_unsupported_bytecode_refs_for(
     // method refs to external cannot be done. In this case, it's safer not to
     // merge types with existing pure method refs on the type.
     if (insn->has_method() && !insn->get_method()->is_def()) {
-      auto meth_ref = insn->get_method();
-      auto type = meth_ref->get_class();
-      if (m_spec.merging_targets.count(type) > 0) {
-        TRACE(CLMG, 5, "[non mergeable] referenced by pure ref %s in %s",
-              SHOW(meth_ref), SHOW(method));
-        non_mergeables.insert(type);
+      auto type = insn->get_method()->get_class();
+      if (candidates.count(type) > 0) {
+        summary.pure_ref_types.push_back(type);
       }
       continue;
     }
 
     // The presence of type-like strings can indicate that types are used by
     // reflection, and then it's not safe to merge those types.
-    if (m_spec.exclude_type_like_strings() &&
-        opcode::is_const_string(insn->opcode())) {
+    if (opcode::is_const_string(insn->opcode())) {
       const DexString* str = insn->get_string();
       std::string class_name = java_names::external_to_internal(str->str());
       DexType* maybe_type = DexType::get_type(class_name);
-      if (maybe_type && m_spec.merging_targets.count(maybe_type) > 0) {
-        non_mergeables.insert(maybe_type);
-        TRACE(CLMG, 5,
-              "[non mergeable] type like const string unsafe: %s in %s",
-              SHOW(insn), SHOW(method));
+      if (maybe_type && candidates.count(maybe_type) > 0) {
+        summary.type_like_strings.push_back(maybe_type);
       }
       continue;
     }
 
-    // Java language level enforcement recommended!
-    //
-    // For mergeables with type tags, it is not safe to merge those
-    // referenced by CONST_CLASS, since we will lose granularity as we can't map
-    // to the old type anymore.
-    if (has_type_tag && !opcode::is_const_class(insn->opcode())) {
+    if (!opcode::is_const_class(insn->opcode()) &&
+        !opcode::is_instance_of(insn->opcode())) {
       continue;
     }
-
-    // Java language level enforcement recommended!
-    //
-    // For mergeables without a type tag, it is not safe to merge
-    // those used in an INSTANCE_OF, since we might lose granularity.
-    //
-    // Example where both <type_0> and <type_1> have the same shape
-    // (so end
-    //        up in the same merger)
-    //
-    //    INSTANCE_OF <v_result>, <v_obj> <type_0>
-    //    then label:
-    //      CHECK_CAST <type_0>
-    //    else labe:
-    //      CHECK_CAST <type_1>
-    if (!has_type_tag && !opcode::is_instance_of(insn->opcode())) {
+    const auto* type = type::get_element_type_if_array(insn->get_type());
+    if (candidates.count(type) == 0) {
       continue;
     }
-
-    const auto* type = type::get_element_type_if_array(insn->get_type());
-    if (m_spec.merging_targets.count(type) > 0) {
-      if (m_track_use_of_reflection) {
-        // Always track the const-class usages.
-        if (!opcode::is_const_class(insn->opcode())) {
-          TRACE(CLMG, 5, "[non mergeable] unsafe opcode @ %s in %s", SHOW(insn),
-                SHOW(method));
-          non_mergeables.insert(type);
-        } else {
-          // To verify the usages
-          const_classes_to_verify.emplace_back(insn, type);
-          const_classes_to_verify_set.insert(insn);
-        }
-      } else {
-        // Old logic that also checks m_const_class_safe_types not being empty.
-        if (!opcode::is_const_class(insn->opcode()) ||
-            m_const_class_safe_types.empty()) {
-          TRACE(CLMG, 5, "[non mergeable] unsafe opcode @ %s in %s", SHOW(insn),
-                SHOW(method));
-          non_mergeables.insert(type);
-        } else {
-          // To verify the usages
-          const_classes_to_verify.emplace_back(insn, type);
-          const_classes_to_verify_set.insert(insn);
-        }
-      }
+    if (opcode::is_instance_of(insn->opcode())) {
+      summary.instance_of_types.push_back(type);
+    } else {
+      // To verify the usages
+      const_classes_to_verify.emplace_back(insn, summary.const_classes.size());
+      insns_to_verify.insert(insn);
+      summary.const_classes.push_back({type});
     }
   }
 
-  if (const_classes_to_verify.empty() && new_instances_to_verify.empty()) {
-    return non_mergeables;
+  if (insns_to_verify.empty()) {
+    return summary;
   }
 
   live_range::MoveAwareChains chains(
-      cfg, /* ignore_unreachable */ false, [&](auto* insn) {
-        return const_classes_to_verify_set.count(insn) ||
-               new_instances_to_verify_set.count(insn);
-      });
+      cfg, /* ignore_unreachable */ false,
+      [&](auto* insn) { return insns_to_verify.count(insn); });
   live_range::DefUseChains du_chains = chains.get_def_use_chains();
 
-  for (const auto& pair : const_classes_to_verify) {
-    auto const_class_insn = pair.first;
-    auto referenced_type = pair.second;
-    auto use_set = du_chains[const_class_insn];
-    for (const auto use : use_set) {
+  for (const auto& [const_class_insn, idx] : const_classes_to_verify) {
+    auto& const_class = summary.const_classes[idx];
+    for (const auto use : du_chains[const_class_insn]) {
       auto use_insn = use.insn;
       if (opcode::is_a_move(use_insn->opcode())) {
         // Ignore moves
         continue;
       }
       if (!use_insn->has_method()) {
-        TRACE(CLMG, 5, "[non mergeable] const class unsafe use @ %s in %s",
-              SHOW(use_insn), SHOW(method));
-        non_mergeables.insert(referenced_type);
-        break;
-      }
-      auto callee = use_insn->get_method();
-      auto callee_type = callee->get_class();
-      if (!m_const_class_safe_types.count(callee_type)) {
-        TRACE(CLMG, 5, "[non mergeable] const class unsafe callee %s in %s",
-              SHOW(callee), SHOW(method));
-        non_mergeables.insert(referenced_type);
-        break;
+        const_class.has_non_invoke_use = true;
+        continue;
       }
+      const_class.callee_types.push_back(use_insn->get_method()->get_class());
     }
   }
 
@@ -245,28 +214,128 @@ TypeSet MergeabilityChecker::exclude_unsupported_bytecode_refs_for(
           resolve_method(callee, opcode_to_search(use_insn), method);
       if (!resolved_callee || resolved_callee->get_class() != type) {
         TRACE(CLMG, 5,
-              "[non mergeable] new-instance %s associated with invoke init %s "
-              "defined in other type in %s",
+              "new-instance %s associated with invoke init %s defined in "
+              "other type in %s",
               SHOW(new_instance_insn), SHOW(use_insn), SHOW(method));
-        non_mergeables.insert(type);
+        summary.foreign_init_types.push_back(type);
         break;
       }
     }
   }
 
-  return non_mergeables;
+  return summary;
+}
+
+void MergeabilityChecker::exclude_unsupported_bytecode_refs_for(
+    const MergeabilitySummaries::MethodSummary& summary,
+    TypeSet& non_mergeables) {
+  auto* method = summary.method;
+  if (m_generated.count(method->get_class())) {
+    return;
+  }
+  const auto& targets = m_spec.merging_targets;
+
+  for (const auto* type : summary.foreign_init_types) {
+    if (targets.count(type)) {
+      TRACE(CLMG, 5,
+            "[non mergeable] new-instance %s with a constructor of another "
+            "type in %s",
+            SHOW(type), SHOW(method));
+      non_mergeables.insert(type);
+    }
+  }
+
+  for (const auto* type : summary.pure_ref_types) {
+    if (targets.count(type)) {
+      TRACE(CLMG, 5, "[non mergeable] %s referenced by pure ref in %s",
+            SHOW(type), SHOW(method));
+      non_mergeables.insert(type);
+    }
+  }
+
+  if (m_spec.exclude_type_like_strings()) {
+    for (const auto* type : summary.type_like_strings) {
+      if (targets.count(type)) {
+        TRACE(CLMG, 5,
+              "[non mergeable] type like const string unsafe: %s in %s",
+              SHOW(type), SHOW(method));
+        non_mergeables.insert(type);
+      }
+    }
+  }
+
+  // Java language level enforcement recommended!
+  //
+  // For mergeables with type tags, it is not safe to merge those
+  // referenced by CONST_CLASS, since we will lose granularity as we can't map
+  // to the old type anymore.
+  if (m_spec.has_type_tag()) {
+    for (const auto& const_class : summary.const_classes) {
+      const auto* type = const_class.type;
+      if (!targets.count(type)) {
+        continue;
+      }
+      // Unless tracking the use of reflection, the old logic also checks
+      // m_const_class_safe_types not being empty.
+      if (!m_track_use_of_reflection && m_const_class_safe_types.empty()) {
+        TRACE(CLMG, 5, "[non mergeable] unsafe const-class %s in %s",
+              SHOW(type), SHOW(method));
+        non_mergeables.insert(type);
+        continue;
+      }
+      if (const_class.has_non_invoke_use) {
+        TRACE(CLMG, 5, "[non mergeable] const class %s unsafe use in %s",
+              SHOW(type), SHOW(method));
+        non_mergeables.insert(type);
+        continue;
+      }
+      for (auto* callee_type : const_class.callee_types) {
+        if (!m_const_class_safe_types.count(callee_type)) {
+          TRACE(CLMG, 5,
+                "[non mergeable] const class %s unsafe callee on %s in %s",
+                SHOW(type), SHOW(callee_type), SHOW(method));
+          non_mergeables.insert(type);
+          break;
+        }
+      }
+    }
+    return;
+  }
+
+  // Java language level enforcement recommended!
+  //
+  // For mergeables without a type tag, it is not safe to merge
+  // those used in an INSTANCE_OF, since we might lose granularity.
+  //
+  // Example where both <type_0> and <type_1> have the same shape
+  // (so end
+  //        up in the same merger)
+  //
+  //    INSTANCE_OF <v_result>, <v_obj> <type_0>
+  //    then label:
+  //      CHECK_CAST <type_0>
+  //    else labe:
+  //      CHECK_CAST <type_1>
+  for (const auto* type : summary.instance_of_types) {
+    if (targets.count(type)) {
+      TRACE(CLMG, 5, "[non mergeable] unsafe instance-of %s in %s", SHOW(type),
+            SHOW(method));
+      non_mergeables.insert(type);
+    }
+  }
 }
 
 void MergeabilityChecker::exclude_unsupported_bytecode(
     TypeSet& non_mergeables) {
-  TypeSet non_mergeables_opcode =
-      walk::parallel::methods<TypeSet, MergeContainers<TypeSet>>(
-          m_scope, [this](DexMethod* meth) {
-            return exclude_unsupported_bytecode_refs_for(meth);
-          });
-
-  non_mergeables.insert(non_mergeables_opcode.begin(),
-                        non_mergeables_opcode.end());
+  std::optional<MergeabilitySummaries> local_summaries;
+  const auto* summaries = m_summaries;
+  if (summaries == nullptr || !summaries->covers(m_spec.merging_targets)) {
+    local_summaries.emplace(m_scope, m_spec.merging_targets);
+    summaries = &*local_summaries;
+  }
+  for (const auto& summary : summaries->m_summaries) {
+    exclude_unsupported_bytecode_refs_for(summary, non_mergeables);
+  }
 }
 
 void MergeabilityChecker::exclude_static_fields(TypeSet& non_mergeables) {
@@ -298,7 +367,8 @@ void MergeabilityChecker::exclude_static_fields(TypeSet& non_mergeables) {
 
 void MergeabilityChecker::exclude_unsafe_sdk_and_store_refs(
     TypeSet& non_mergeables) {
-  const auto mog = method_override_graph::build_graph(m_scope);
+  const std::unique_ptr<const method_override_graph::Graph> mog =
+      method_override_graph::build_graph(m_scope);
   for (auto type : m_spec.merging_targets) {
     if (non_mergeables.count(type)) {
       continue;
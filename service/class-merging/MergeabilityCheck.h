@@ -7,22 +7,83 @@
 
 #pragma once
 
+#include <unordered_set>
+#include <vector>
+
 #include "DexClass.h"
 
 class RefChecker;
 
+using ConstTypeHashSet = std::unordered_set<const DexType*>;
+
 namespace class_merging {
 
 using TypeSet = std::set<const DexType*, dextypes_comparator>;
 
 struct ModelSpec;
 
+/**
+ * The references of all method bodies to a set of candidate types that Class
+ * Merging may not support, summarized once per method in parallel. Each model
+ * whose merging targets are among the candidates answers its bytecode
+ * mergeability query from the summaries, instead of rescanning all the code.
+ *
+ * The summaries of a method only depend on its code and the candidates, not on
+ * the model spec. They stay valid while merging models with other targets, as
+ * that only rewrites the references to those other targets.
+ */
+class MergeabilitySummaries {
+ public:
+  MergeabilitySummaries(const Scope& scope,
+                        const ConstTypeHashSet& candidates);
+
+  bool covers(const ConstTypeHashSet& types) const;
+
+ private:
+  struct ConstClass {
+    const DexType* type;
+    // Whether the class is used by anything but moves and invocations.
+    bool has_non_invoke_use{false};
+    std::vector<DexType*> callee_types;
+  };
+
+  struct MethodSummary {
+    DexMethod* method;
+    // Classes of unresolved method refs.
+    std::vector<const DexType*> pure_ref_types;
+    std::vector<const DexType*> type_like_strings;
+    std::vector<const DexType*> instance_of_types;
+    std::vector<ConstClass> const_classes;
+    // Types instantiated with a constructor of another type.
+    std::vector<const DexType*> foreign_init_types;
+
+    bool empty() const {
+      return pure_ref_types.empty() && type_like_strings.empty() &&
+             instance_of_types.empty() && const_classes.empty() &&
+             foreign_init_types.empty();
+    }
+  };
+
+  static MethodSummary summarize(DexMethod* method,
+                                 const ConstTypeHashSet& candidates);
+
+  ConstTypeHashSet m_candidates;
+  std::vector<MethodSummary> m_summaries;
+
+  friend class MergeabilityChecker;
+};
+
 class MergeabilityChecker {
  public:
+  /**
+   * Uses `summaries`, if given and covering the merging targets of `spec`, and
+   * summarizes the scope for the merging targets otherwise.
+   */
   MergeabilityChecker(const Scope& scope,
                       const ModelSpec& spec,
                       const RefChecker& ref_checker,
-                      const TypeSet& generated);
+                      const TypeSet& generated,
+                      const MergeabilitySummaries* summaries = nullptr);
   /**
    * Try to identify types referenced by operations that Class Merging does not
    * support. Such operations include reflections, instanceof checks on
@@ -41,13 +102,16 @@ class MergeabilityChecker {
   const TypeSet& m_generated;
   const std::unordered_set<DexType*>& m_const_class_safe_types;
   bool m_track_use_of_reflection;
+  const MergeabilitySummaries* m_summaries;
 
   void exclude_unsupported_cls_property(TypeSet& non_mergeables);
   void exclude_unsupported_bytecode(TypeSet& non_mergeables);
   void exclude_static_fields(TypeSet& non_mergeables);
   void exclude_unsafe_sdk_and_store_refs(TypeSet& non_mergeables);
 
-  TypeSet exclude_unsupported_bytecode_refs_for(DexMethod* method);
+  void exclude_unsupported_bytecode_refs_for(
+      const MergeabilitySummaries::MethodSummary& summary,
+      TypeSet& non_mergeables);
 };
 
 } // namespace class_merging
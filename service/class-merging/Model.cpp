@@ -166,19 +166,21 @@ Model::Model(const Scope& scope,
              ConfigFiles& conf,
              const ModelSpec& spec,
              const TypeSystem& type_system,
-             const RefChecker& refchecker)
+             const RefChecker& refchecker,
+             const MergeabilitySummaries* summaries)
     : m_spec(spec),
       m_type_system(type_system),
       m_ref_checker(refchecker),
       m_scope(scope),
       m_conf(conf),
       m_x_dex(XDexRefs(stores)) {
-  init(scope, spec, type_system);
+  init(scope, spec, type_system, summaries);
 }
 
 void Model::init(const Scope& scope,
                  const ModelSpec& spec,
-                 const TypeSystem& type_system) {
+                 const TypeSystem& type_system,
+                 const MergeabilitySummaries* summaries) {
   build_hierarchy(spec.roots);
   for (const auto root : spec.roots) {
     build_interface_map(root, {});
@@ -196,7 +198,8 @@ void Model::init(const Scope& scope,
                        generated);
   TRACE(CLMG, 4, "Generated types %zu", generated.size());
   exclude_types(spec.exclude_types);
-  MergeabilityChecker checker(scope, spec, m_ref_checker, generated);
+  MergeabilityChecker checker(scope, spec, m_ref_checker, generated,
+                              summaries);
   m_non_mergeables = checker.get_non_mergeables();
   TRACE(CLMG, 3, "Non mergeables %zu", m_non_mergeables.size());
   m_stats.m_non_mergeables = m_non_mergeables.size();
@@ -1291,11 +1294,12 @@ Model Model::build_model(const Scope& scope,
                          ConfigFiles& conf,
                          const ModelSpec& spec,
                          const TypeSystem& type_system,
-                         const RefChecker& refchecker) {
+                         const RefChecker& refchecker,
+                         const MergeabilitySummaries* summaries) {
   Timer t("build_model");
 
   TRACE(CLMG, 3, "Build Model for %s", to_string(spec).c_str());
-  Model model(scope, stores, conf, spec, type_system, refchecker);
+  Model model(scope, stores, conf, spec, type_system, refchecker, summaries);
   TRACE(CLMG, 3, "Model:\n%s\nBuild Model done", model.print().c_str());
 
   TRACE(CLMG, 3, "Shape Model");
@@ -28,6 +28,8 @@ using ConstTypeHashSet = std::unordered_set<const DexType*>;
 
 namespace class_merging {
 
+class MergeabilitySummaries;
+
 using TypeToTypeSet = std::unordered_map<const DexType*, TypeSet>;
 using TypeGroupByDex = std::vector<std::pair<boost::optional<size_t>, TypeSet>>;
 
@@ -241,14 +243,18 @@ struct ModelStats {
 class Model {
  public:
   /**
-   * Build a Model given a scope and a specification.
+   * Build a Model given a scope and a specification, checking the
+   * mergeability of bytecode with `summaries` when they cover the merging
+   * targets.
    */
-  static Model build_model(const Scope& scope,
-                           const DexStoresVector& stores,
-                           ConfigFiles& conf,
-                           const ModelSpec& spec,
-                           const TypeSystem& type_system,
-                           const RefChecker& refchecker);
+  static Model build_model(
+      const Scope& scope,
+      const DexStoresVector& stores,
+      ConfigFiles& conf,
+      const ModelSpec& spec,
+      const TypeSystem& type_system,
+      const RefChecker& refchecker,
+      const MergeabilitySummaries* summaries = nullptr);
 
   const std::string& get_name() const { return m_spec.name; }
   std::vector<const DexType*> get_roots() const {
@@ -387,11 +393,13 @@ class Model {
         ConfigFiles& conf,
         const ModelSpec& spec,
         const TypeSystem& type_system,
-        const RefChecker& refchecker);
+        const RefChecker& refchecker,
+        const MergeabilitySummaries* summaries);
 
   void init(const Scope& scope,
             const ModelSpec& spec,
-            const TypeSystem& type_system);
+            const TypeSystem& type_system,
+            const MergeabilitySummaries* summaries);
 
   void build_hierarchy(const TypeSet& roots);
   void build_interface_map(const DexType* type, TypeSet implemented);
@@ -375,7 +375,7 @@ std::map<SwitchIndices, DexMethod*> ModelMethodMerger::get_dedupped_indices_map(
   // Find equivalent methods.
   std::vector<MethodOrderedSet> duplicates =
       method_dedup::group_identical_methods(
-          targets, m_model_spec.dedup_fill_in_stack_trace);
+          targets, m_model_spec.dedup_fill_in_stack_trace, &m_code_hashes);
   for (const auto& duplicate : duplicates) {
     SwitchIndices switch_indices;
     for (auto& meth : duplicate) {
@@ -630,6 +630,8 @@ void ModelMethodMerger::merge_ctors() {
     }
     ctor_set.insert(ctors.begin(), ctors.end());
   }
+  m_code_hashes = method_dedup::compute_code_hashes(
+      std::vector<DexMethod*>(ctor_set.begin(), ctor_set.end()));
 
   bool pass_type_tag_param = m_model_spec.pass_type_tag_to_ctor();
   TRACE(CLMG, 5, "pass type tag param %d", pass_type_tag_param);
@@ -873,6 +875,19 @@ void ModelMethodMerger::merge_virt_itf_methods() {
   std::vector<std::pair<DexClass*, DexMethod*>> dispatch_methods;
   std::unordered_map<DexMethod*, DexMethod*> old_to_new_callee;
 
+  std::vector<DexMethod*> virt_targets;
+  for (auto merger : m_mergers) {
+    for (auto& vm_lst : merger->vmethods) {
+      virt_targets.insert(virt_targets.end(), vm_lst.overrides.begin(),
+                          vm_lst.overrides.end());
+    }
+    for (auto& im : merger->intfs_methods) {
+      virt_targets.insert(virt_targets.end(), im.methods.begin(),
+                          im.methods.end());
+    }
+  }
+  m_code_hashes = method_dedup::compute_code_hashes(virt_targets);
+
   for (auto merger : m_mergers) {
     auto merger_type = const_cast<DexType*>(merger->type);
     auto merger_cls = type_class(merger_type);
@@ -11,6 +11,7 @@
 
 #include "DexClass.h"
 #include "MergerType.h"
+#include "MethodDedup.h"
 #include "MethodProfiles.h"
 #include "Model.h"
 #include "TypeTags.h"
@@ -104,6 +105,9 @@ class ModelMethodMerger {
   MethodStats m_method_stats;
   // Method dedup map
   TypeToMethodMap m_method_dedup_map;
+  // Code hashes of the methods to dedup when creating dispatches, computed
+  // in parallel up front.
+  method_dedup::CodeHashes m_code_hashes;
 
   ModelStats m_stats;
 
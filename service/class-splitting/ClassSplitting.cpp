@@ -199,6 +199,13 @@ void ClassSplitter::prepare(const DexClass* cls,
     if (requires_trampoline && !m_config.trampolines) {
       return;
     }
+    if (m_config.max_relocated_methods_per_dex > 0 &&
+        m_relocatable_methods_in_dex >=
+            m_config.max_relocated_methods_per_dex) {
+      m_stats.dex_limit_exceeded_methods++;
+      return;
+    }
+    ++m_relocatable_methods_in_dex;
     DexClass* target_cls;
     int api_level = api::LevelChecker::get_method_level(method);
     if (m_config.combine_target_classes_by_api_level) {
@@ -389,6 +396,7 @@ DexClasses ClassSplitter::additional_classes(const DexClasses& classes) {
 
   m_target_classes_by_api_level.clear();
   m_split_classes.clear();
+  m_relocatable_methods_in_dex = 0;
   return target_classes;
 }
 
@@ -556,6 +564,8 @@ void ClassSplitter::cleanup(const Scope& final_scope) {
   m_mgr.incr_metric(METRIC_RELOCATED_METHODS, m_methods_to_relocate.size());
   m_mgr.incr_metric(METRIC_TRAMPOLINES, m_methods_to_trampoline.size());
   m_mgr.incr_metric(METRIC_TOO_SMALL_METHODS, m_stats.method_size_too_small);
+  m_mgr.incr_metric(METRIC_DEX_LIMIT_EXCEEDED_METHODS,
+                    m_stats.dex_limit_exceeded_methods);
 
   TRACE(CS, 2,
         "[class splitting] Relocated {%zu} methods and created {%zu} "
@@ -42,6 +42,10 @@ struct ClassSplittingConfig {
   bool profile_only{false};
   // If true, also consider source-block info for decision making.
   bool source_blocks{true};
+  // If non-zero, at most that many methods are relocated out of the classes
+  // of any one dex; the remaining candidates stay where they are. This bounds
+  // the refs that the relocation targets add to the dexes.
+  unsigned int max_relocated_methods_per_dex{0};
 };
 
 struct ClassSplittingStats {
@@ -54,6 +58,7 @@ struct ClassSplittingStats {
   size_t popular_methods{0};
   size_t source_block_positive_vals{0};
   size_t method_size_too_small{0};
+  size_t dex_limit_exceeded_methods{0};
 };
 
 constexpr const char* METRIC_STATICIZED_METHODS =
@@ -81,6 +86,8 @@ constexpr const char* METRIC_RELOCATED_METHODS =
 constexpr const char* METRIC_TRAMPOLINES = "num_class_splitting_trampolines";
 constexpr const char* METRIC_TOO_SMALL_METHODS =
     "num_class_splitting_methods_too_small";
+constexpr const char* METRIC_DEX_LIMIT_EXCEEDED_METHODS =
+    "num_class_splitting_dex_limit_exceeded_methods";
 
 class ClassSplitter final {
  public:
@@ -139,6 +146,9 @@ class ClassSplitter final {
 
   std::unordered_map<int32_t, TargetClassInfo> m_target_classes_by_api_level;
   size_t m_next_target_class_index{0};
+  // Methods prepared for relocation since the last call to
+  // additional_classes, i.e. for the current dex.
+  size_t m_relocatable_methods_in_dex{0};
   std::unordered_map<DexType*, DexClass*> m_target_classes_by_source_classes;
   std::unordered_map<const DexClass*, SplitClass> m_split_classes;
   std::vector<std::pair<DexMethod*, DexClass*>> m_methods_to_relocate;
@@ -17,6 +17,7 @@
 #include <sparta/PatriciaTreeMapAbstractEnvironment.h>
 #include <sparta/PatriciaTreeSetAbstractDomain.h>
 #include <sparta/ReducedProductAbstractDomain.h>
+#include <sparta/SmallPatriciaTreeMapAbstractEnvironment.h>
 
 #include "ConstantArrayDomain.h"
 #include "ControlFlow.h"
@@ -100,8 +101,10 @@ struct ConstantValueDefaultValue {
 using FieldEnvironment =
     sparta::PatriciaTreeMapAbstractEnvironment<const DexField*, ConstantValue>;
 
+// Most methods only hold a few known constants at a time, which are kept
+// inline rather than in a tree.
 using ConstantRegisterEnvironment =
-    sparta::PatriciaTreeMapAbstractEnvironment<reg_t, ConstantValue>;
+    sparta::SmallPatriciaTreeMapAbstractEnvironment<reg_t, ConstantValue>;
 
 /*****************************************************************************
  * Heap values.
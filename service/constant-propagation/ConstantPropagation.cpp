@@ -31,7 +31,18 @@ Transform::Stats ConstantPropagation::run(DexMethod* method,
   {
     intraprocedural::FixpointIterator fp_iter(&state, *cfg,
                                               ConstantPrimitiveAnalyzer());
+    if (m_config.widening_thresholds) {
+      fp_iter.use_widening_thresholds();
+    }
+    fp_iter.set_budget(m_config.fixpoint_budget);
     fp_iter.run({});
+    const auto& fp_stats = fp_iter.get_stats();
+    if (fp_stats.iteration_budget_hits != 0) {
+      m_methods_over_iteration_budget++;
+    }
+    if (fp_stats.time_budget_hits != 0) {
+      m_methods_over_time_budget++;
+    }
     constant_propagation::Transform tf(m_config.transform, state);
     tf.apply(fp_iter, WholeProgramState(), code->cfg(), xstores,
              is_static(method), method->get_class(), method->get_proto());
@@ -7,6 +7,10 @@
 
 #pragma once
 
+#include <atomic>
+
+#include <sparta/MonotonicFixpointIterator.h>
+
 #include "ConstantPropagationState.h"
 #include "ConstantPropagationTransform.h"
 #include "IRCode.h"
@@ -15,12 +19,25 @@ namespace constant_propagation {
 
 struct Config {
   Transform::Config transform;
+  // Widen growing numeric ranges to the constants of the method.
+  bool widening_thresholds{false};
+  // Limits on the analysis of each method, none by default.
+  sparta::FixpointIterationBudget fixpoint_budget;
 };
 
 class ConstantPropagation final {
  public:
   explicit ConstantPropagation(const Config& config) : m_config(config) {}
 
+  // Number of methods whose analysis ran out of iterations or of time, and
+  // was completed with Top at the loops that had not stabilized.
+  size_t num_methods_over_iteration_budget() const {
+    return m_methods_over_iteration_budget;
+  }
+  size_t num_methods_over_time_budget() const {
+    return m_methods_over_time_budget;
+  }
+
   Transform::Stats run(DexMethod* method,
                        const XStoreRefs* xstores,
                        const State& state);
@@ -30,5 +47,7 @@ class ConstantPropagation final {
 
  private:
   const Config& m_config;
+  std::atomic<size_t> m_methods_over_iteration_budget{0};
+  std::atomic<size_t> m_methods_over_time_budget{0};
 };
 } // namespace constant_propagation
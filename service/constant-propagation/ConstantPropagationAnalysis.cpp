@@ -7,6 +7,7 @@
 
 #include "ConstantPropagationAnalysis.h"
 
+#include <algorithm>
 #include <boost/functional/hash.hpp>
 #include <cinttypes>
 #include <limits>
@@ -1563,6 +1564,110 @@ FixpointIterator::FixpointIterator(
       m_state(state),
       m_imprecise_switches(imprecise_switches) {}
 
+void FixpointIterator::prune_dead_registers() {
+  if (m_graph.exit_block() == nullptr) {
+    return;
+  }
+  m_liveness = std::make_unique<LivenessFixpointIterator>(m_graph);
+  m_liveness->run(LivenessDomain());
+}
+
+void FixpointIterator::use_widening_thresholds() {
+  m_widening_thresholds = collect_widening_thresholds(m_graph);
+}
+
+std::vector<int64_t> FixpointIterator::collect_widening_thresholds(
+    const cfg::ControlFlowGraph& cfg) {
+  constexpr int64_t MIN = std::numeric_limits<int64_t>::min();
+  constexpr int64_t MAX = std::numeric_limits<int64_t>::max();
+  // Comparisons with zero have no literal.
+  std::vector<int64_t> thresholds{-1, 0, 1};
+  for (const auto& mie : cfg::ConstInstructionIterable(cfg)) {
+    if (!mie.insn->has_literal()) {
+      continue;
+    }
+    auto literal = mie.insn->get_literal();
+    thresholds.push_back(literal);
+    if (literal != MIN) {
+      thresholds.push_back(literal - 1);
+    }
+    if (literal != MAX) {
+      thresholds.push_back(literal + 1);
+    }
+  }
+  std::sort(thresholds.begin(), thresholds.end());
+  thresholds.erase(std::unique(thresholds.begin(), thresholds.end()),
+                   thresholds.end());
+  return thresholds;
+}
+
+void FixpointIterator::extrapolate(const Context& context,
+                                   const NodeId& node,
+                                   ConstantEnvironment* current_state,
+                                   const ConstantEnvironment& new_state) const {
+  if (m_widening_thresholds.empty() ||
+      context.get_local_iterations_for(node) == 0 ||
+      current_state->is_bottom()) {
+    BaseEdgeAwareIRAnalyzer::extrapolate(context, node, current_state,
+                                         new_state);
+    return;
+  }
+  auto previous = current_state->get_register_environment();
+  BaseEdgeAwareIRAnalyzer::extrapolate(context, node, current_state,
+                                       new_state);
+  if (!previous.is_value() || current_state->is_bottom()) {
+    return;
+  }
+  // The other values are joined, so only the numeric ranges of the registers
+  // that grew need to be widened on top of that.
+  const auto& next = new_state.get_register_environment();
+  current_state->mutate_register_environment(
+      [&](ConstantRegisterEnvironment* env) {
+        for (const auto& [reg, value] : previous.bindings()) {
+          auto previous_value = value.maybe_get<SignedConstantDomain>();
+          if (!previous_value) {
+            continue;
+          }
+          auto next_value = next.get(reg).maybe_get<SignedConstantDomain>();
+          if (!next_value || next_value->leq(*previous_value)) {
+            continue;
+          }
+          env->set(reg, previous_value->widening_with_thresholds(
+                            *next_value, m_widening_thresholds));
+        }
+      });
+}
+
+ConstantEnvironment FixpointIterator::analyze_edge(
+    const cfg::GraphInterface::EdgeId& edge,
+    const ConstantEnvironment& exit_state_at_source) const {
+  auto env = BaseEdgeAwareIRAnalyzer::analyze_edge(edge, exit_state_at_source);
+  if (!m_liveness || env.is_bottom()) {
+    return env;
+  }
+  const auto& live_in = m_liveness->get_live_in_vars_at(edge->target());
+  const auto& reg_env = env.get_register_environment();
+  // Blocks from which the exit isn't reachable (e.g. infinite loops) have no
+  // liveness information.
+  if (live_in.is_bottom() || live_in.is_top() || !reg_env.is_value()) {
+    return env;
+  }
+  std::vector<reg_t> dead_regs;
+  for (const auto& [reg, value] : reg_env.bindings()) {
+    if (reg != RESULT_REGISTER && !live_in.contains(reg)) {
+      dead_regs.push_back(reg);
+    }
+  }
+  if (!dead_regs.empty()) {
+    env.mutate_register_environment([&](ConstantRegisterEnvironment* regs) {
+      for (auto reg : dead_regs) {
+        regs->set(reg, ConstantValue::top());
+      }
+    });
+  }
+  return env;
+}
+
 void FixpointIterator::analyze_instruction_normal(
     const IRInstruction* insn, ConstantEnvironment* env) const {
   m_insn_analyzer(insn, env);
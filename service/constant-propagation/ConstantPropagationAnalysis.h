@@ -10,6 +10,7 @@
 #include <limits>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <sparta/MonotonicFixpointIterator.h>
 
@@ -20,6 +21,7 @@
 #include "IRCode.h"
 #include "InstructionAnalyzer.h"
 #include "KotlinNullCheckMethods.h"
+#include "Liveness.h"
 #include "MethodUtil.h"
 
 class DexMethodRef;
@@ -45,6 +47,41 @@ class FixpointIterator final
 
   void clear_switch_succ_cache() const { m_switch_succs.clear(); }
 
+  /*
+   * Sparse mode: the environments that flow along CFG edges only keep the
+   * bindings of the result register and of the registers that are live at the
+   * entry of the target block. Dead registers are always redefined before
+   * being read, so the values read by any instruction are unchanged, but the
+   * states stored at block boundaries, as well as the joins and comparisons
+   * at merge points, only involve the few registers that are actually live
+   * across blocks. This requires the exit block of the CFG to have been
+   * calculated (it is a no-op otherwise), and must be called before `run`.
+   */
+  void prune_dead_registers();
+
+  /*
+   * Widening with thresholds: at loop heads, the numeric range of a register
+   * that keeps growing is relaxed up to the nearest constant that appears in
+   * the method, rather than joined until it stabilizes. This bounds the number
+   * of iterations while keeping the ranges implied by loop bounds. Must be
+   * called before `run`.
+   */
+  void use_widening_thresholds();
+
+  // The sorted literals of the method, together with their neighbours, so
+  // that the bounds of strict comparisons are thresholds too.
+  static std::vector<int64_t> collect_widening_thresholds(
+      const cfg::ControlFlowGraph& cfg);
+
+  void extrapolate(const Context& context,
+                   const NodeId& node,
+                   ConstantEnvironment* current_state,
+                   const ConstantEnvironment& new_state) const override;
+
+  ConstantEnvironment analyze_edge(
+      const cfg::GraphInterface::EdgeId& edge,
+      const ConstantEnvironment& exit_state_at_source) const override;
+
  protected:
   void analyze_instruction_normal(const IRInstruction* insn,
                                   ConstantEnvironment* env) const override;
@@ -66,6 +103,8 @@ class FixpointIterator final
   InstructionAnalyzer<ConstantEnvironment> m_insn_analyzer;
   const State* m_state;
   const bool m_imprecise_switches;
+  std::unique_ptr<LivenessFixpointIterator> m_liveness;
+  std::vector<int64_t> m_widening_thresholds;
 
   const SwitchSuccs& find_switch_succs(cfg::Block* block) const {
     auto it = m_switch_succs.find(block);
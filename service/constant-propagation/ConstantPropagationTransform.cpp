@@ -666,7 +666,7 @@ void Transform::remove_dead_switch(
       remaining_branch_targets[branch_edge->target()]++;
       continue;
     }
-    m_edge_deletes.push_back(branch_edge);
+    m_mutation->delete_edge(branch_edge);
   }
 
   bool goto_is_feasible = !intra_cp.analyze_edge(goto_edge, env).is_bottom();
@@ -691,14 +691,14 @@ void Transform::remove_dead_switch(
     }
     always_assert(most_common_target != nullptr);
     if (most_common_target != goto_target) {
-      m_edge_deletes.push_back(goto_edge);
+      m_mutation->delete_edge(goto_edge);
       goto_target = most_common_target;
-      m_edge_adds.emplace_back(block, goto_target, cfg::EDGE_GOTO);
+      m_mutation->add_edge(block, goto_target, cfg::EDGE_GOTO);
       goto_edge = nullptr;
     }
     auto removed = std20::erase_if(remaining_branch_edges, [&](auto* e) {
       if (e->target() == most_common_target) {
-        m_edge_deletes.push_back(e);
+        m_mutation->delete_edge(e);
         return true;
       }
       return false;
@@ -728,9 +728,9 @@ void Transform::remove_dead_switch(
   // We do that by deleting all but one of the remaining branch edges, and then
   // the cfg will rewrite the remaining branch into a goto and remove the switch
   // instruction.
-  m_edge_deletes.insert(m_edge_deletes.end(),
-                        remaining_branch_edges.begin(),
-                        remaining_branch_edges.end());
+  for (auto* e : remaining_branch_edges) {
+    m_mutation->delete_edge(e);
+  }
 }
 
 /*
@@ -772,7 +772,7 @@ void Transform::eliminate_dead_branch(
       ++m_stats.branches_removed;
       // We delete the infeasible edge, and then the cfg will rewrite the
       // remaining branch into a goto and remove the if- instruction.
-      m_edge_deletes.push_back(edge);
+      m_mutation->delete_edge(edge);
       // Assuming :block is reachable, then at least one of its successors must
       // be reachable, so we can break after finding one that's unreachable
       break;
@@ -814,19 +814,8 @@ bool Transform::replace_with_throw(
 }
 
 void Transform::apply_changes(cfg::ControlFlowGraph& cfg) {
-  if (!m_edge_adds.empty()) {
-    for (auto& t : m_edge_adds) {
-      cfg.add_edge(std::get<0>(t), std::get<1>(t), std::get<2>(t));
-    }
-    m_edge_adds.clear();
-  }
-  if (!m_edge_deletes.empty()) {
-    cfg.delete_edges(m_edge_deletes.begin(), m_edge_deletes.end());
-    m_edge_deletes.clear();
-  }
-
   always_assert(m_mutation != nullptr);
-  m_mutation->flush();
+  m_mutation->flush_and_simplify();
 
   if (!m_added_param_values.empty()) {
     // Insert after last load-param (and not before first non-load-param
@@ -900,7 +889,6 @@ void Transform::legacy_apply_constants_and_prune_unreachable(
   }
   apply_changes(cfg);
   m_mutation = nullptr;
-  cfg.simplify();
 }
 
 void Transform::forward_targets(
@@ -169,8 +169,6 @@ class Transform final {
   std::unique_ptr<cfg::CFGMutation> m_mutation;
   std::vector<IRInstruction*> m_added_param_values;
   std::unordered_set<IRInstruction*> m_redundant_move_results;
-  std::vector<cfg::Edge*> m_edge_deletes;
-  std::vector<std::tuple<cfg::Block*, cfg::Block*, cfg::EdgeType>> m_edge_adds;
   Stats m_stats;
 
   const State& m_state;
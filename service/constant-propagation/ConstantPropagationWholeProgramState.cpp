@@ -187,25 +187,26 @@ void WholeProgramState::collect(
   ConcurrentMap<const DexField*, ConstantValue> fields_value_tmp;
   ConcurrentMap<const DexMethod*, ConstantValue> methods_value_tmp;
   walk::parallel::methods(scope, [&](DexMethod* method) {
-    IRCode* code = method->get_code();
-    if (code == nullptr) {
+    if (method->get_code() == nullptr) {
       return;
     }
-    auto& cfg = code->cfg();
-    auto ipa = fp_iter.get_intraprocedural_analysis(method);
-    auto& intra_cp = ipa->fp_iter;
-    for (cfg::Block* b : cfg.blocks()) {
-      auto env = intra_cp.get_entry_state_at(b);
-      auto last_insn = b->get_last_insn();
-      for (auto& mie : InstructionIterable(b)) {
-        auto* insn = mie.insn;
-        intra_cp.analyze_instruction(insn, &env, insn == last_insn->insn);
-        collect_field_values(insn, env,
-                             method::is_clinit(method) ? method->get_class()
-                                                       : nullptr,
-                             &fields_value_tmp);
-        collect_return_values(insn, env, method, &methods_value_tmp);
+    auto summary = fp_iter.get_method_summary(method);
+    for (auto& [field, value] : summary.field_values) {
+      if (!m_known_fields.count(field)) {
+        continue;
       }
+      fields_value_tmp.update(field, [&value](const DexField*,
+                                              ConstantValue& current_value,
+                                              bool exists) {
+        if (exists) {
+          current_value.join_with(value);
+        } else {
+          current_value = std::move(value);
+        }
+      });
+    }
+    if (!summary.return_value.is_bottom()) {
+      methods_value_tmp.emplace(method, std::move(summary.return_value));
     }
   });
   for (const auto& pair : fields_value_tmp) {
@@ -221,79 +222,38 @@ void WholeProgramState::collect(
 }
 
 /*
- * For each field, do a join over all the values that may have been
- * written to it at any point in the program.
- *
- * If we are encountering a static field write of some value to Foo.someField
- * in the body of Foo.<clinit>, don't do anything -- that value will only be
- * visible to other methods if it remains unchanged up until the end of the
- * <clinit>. In that case, analyze_clinits() will record it.
- */
-void WholeProgramState::collect_field_values(
-    const IRInstruction* insn,
-    const ConstantEnvironment& env,
-    const DexType* clinit_cls,
-    ConcurrentMap<const DexField*, ConstantValue>* fields_value_tmp) {
-  if (!opcode::is_an_sput(insn->opcode()) &&
-      !opcode::is_an_iput(insn->opcode())) {
-    return;
-  }
-  auto field = resolve_field(insn->get_field());
-  if (field != nullptr && m_known_fields.count(field)) {
-    if (opcode::is_an_sput(insn->opcode()) &&
-        field->get_class() == clinit_cls) {
-      return;
-    }
-    auto value = env.get(insn->src(0));
-    fields_value_tmp->update(
-        field,
-        [&value](const DexField*, ConstantValue& current_value, bool exists) {
-          if (exists) {
-            current_value.join_with(value);
-          } else {
-            current_value = std::move(value);
-          }
-        });
-  }
-}
-
-/*
- * For each method, do a join over all the values that can be returned by it.
+ * For each field, do a join over all the values that may have been written to
+ * it, and for each method, do a join over all the values that can be returned
+ * by it.
  *
  * If there are no reachable return opcodes in the method, then it never
  * returns. Its return value will be represented by Bottom in our analysis.
  */
-void WholeProgramState::collect_return_values(
-    const IRInstruction* insn,
-    const ConstantEnvironment& env,
-    const DexMethod* method,
-    ConcurrentMap<const DexMethod*, ConstantValue>* methods_value_tmp) {
+void MethodSummary::update(const DexMethod* method,
+                           const IRInstruction* insn,
+                           const ConstantEnvironment& env) {
   auto op = insn->opcode();
-  if (!opcode::is_a_return(op)) {
-    return;
-  }
-  if (op == OPCODE_RETURN_VOID) {
-    // We must set the binding to Top here to record the fact that this method
-    // does indeed return -- even though `void` is not actually a return value,
-    // this tells us that the code following any invoke of this method is
-    // reachable.
-    methods_value_tmp->update(
-        method,
-        [](const DexMethod*, ConstantValue& current_value, bool /* exists */) {
-          current_value = ConstantValue::top();
-        });
-    return;
+  if (opcode::is_an_sput(op) || opcode::is_an_iput(op)) {
+    auto field = resolve_field(insn->get_field());
+    if (field == nullptr) {
+      return;
+    }
+    if (opcode::is_an_sput(op) && method::is_clinit(method) &&
+        field->get_class() == method->get_class()) {
+      return;
+    }
+    auto value = env.get(insn->src(0));
+    auto it = field_values.find(field);
+    if (it == field_values.end()) {
+      field_values.emplace(field, std::move(value));
+    } else {
+      it->second.join_with(value);
+    }
+  } else if (op == OPCODE_RETURN_VOID) {
+    return_value = ConstantValue::top();
+  } else if (opcode::is_a_return(op)) {
+    return_value.join_with(env.get(insn->src(0)));
   }
-  auto value = env.get(insn->src(0));
-  methods_value_tmp->update(
-      method,
-      [&value](const DexMethod*, ConstantValue& current_value, bool exists) {
-        if (exists) {
-          current_value.join_with(value);
-        } else {
-          current_value = std::move(value);
-        }
-      });
 }
 
 void WholeProgramState::collect_static_finals(const DexClass* cls,
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <unordered_map>
+
 #include <sparta/HashedAbstractPartition.h>
 
 #include "CallGraph.h"
@@ -31,6 +33,30 @@ using ConstantFieldPartition =
 using ConstantMethodPartition =
     sparta::HashedAbstractPartition<const DexMethod*, ConstantValue>;
 
+/*
+ * What a method contributes to the WholeProgramState for given arguments: the
+ * join of the values it writes to each field, and of the values it returns.
+ * The interprocedural fixpoint iterator caches them along with the results of
+ * the intraprocedural analyses, so that building the next WholeProgramState
+ * only reanalyzes the methods whose inputs have changed.
+ */
+struct MethodSummary {
+  std::unordered_map<const DexField*, ConstantValue> field_values;
+  // Bottom if no return instruction is reachable. Top for void methods, which
+  // records the fact that the code following their invocations is reachable.
+  ConstantValue return_value{ConstantValue::bottom()};
+
+  /*
+   * Accounts for `insn`, given the environment right after it. Static field
+   * writes of a class initializer to its own class are ignored: those values
+   * are only visible to other methods if they remain unchanged up until the
+   * end of the <clinit>, which `analyze_clinits` deals with.
+   */
+  void update(const DexMethod* method,
+              const IRInstruction* insn,
+              const ConstantEnvironment& env);
+};
+
 /*
  * This class contains flow-insensitive information about fields and method
  * return values, i.e. it can tells us if a field or a return value is constant
@@ -132,18 +158,6 @@ class WholeProgramState {
       const interprocedural::FixpointIterator& fp_iter,
       const std::unordered_set<const DexField*>& definitely_assigned_ifields);
 
-  void collect_field_values(
-      const IRInstruction* insn,
-      const ConstantEnvironment& env,
-      const DexType* clinit_cls,
-      ConcurrentMap<const DexField*, ConstantValue>* fields_value_tmp);
-
-  void collect_return_values(
-      const IRInstruction* insn,
-      const ConstantEnvironment& env,
-      const DexMethod* method,
-      ConcurrentMap<const DexMethod*, ConstantValue>* methods_value_tmp);
-
   std::shared_ptr<const call_graph::Graph> m_call_graph;
 
   // Unknown fields and methods will be treated as containing / returning Top.
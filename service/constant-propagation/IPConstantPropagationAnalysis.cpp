@@ -98,6 +98,7 @@ void FixpointIterator::analyze_node(call_graph::NodeId const& node,
     ipa->wps_accessor->start_recording(&record);
   }
   std::unordered_map<const IRInstruction*, ArgumentDomain> result;
+  MethodSummary summary;
   for (auto* block : cfg.blocks()) {
     auto state = intra_cp.get_entry_state_at(block);
     auto last_insn = block->get_last_insn();
@@ -113,6 +114,7 @@ void FixpointIterator::analyze_node(call_graph::NodeId const& node,
         }
       }
       intra_cp.analyze_instruction(insn, &state, insn == last_insn->insn);
+      summary.update(method, insn, state);
     }
   }
   if (ipa->wps_accessor) {
@@ -121,8 +123,9 @@ void FixpointIterator::analyze_node(call_graph::NodeId const& node,
   for (auto& [insn, out_args] : result) {
     current_state->set(insn, out_args);
   }
-  method_cache.push_front(std::make_shared<MethodCacheEntry>((MethodCacheEntry){
-      std::move(args), std::move(record), std::move(result)}));
+  method_cache.push_front(std::make_shared<MethodCacheEntry>(
+      (MethodCacheEntry){std::move(args), std::move(record), std::move(result),
+                         std::move(summary)}));
   std::lock_guard<std::mutex> lock_guard(m_stats_mutex);
   m_stats.method_cache_misses++;
 }
@@ -151,12 +154,45 @@ IntraproceduralAnalysis::IntraproceduralAnalysis(
     std::unique_ptr<WholeProgramStateAccessor> wps_accessor,
     const cfg::ControlFlowGraph& cfg,
     InstructionAnalyzer<ConstantEnvironment> insn_analyzer,
-    const ConstantEnvironment& env)
+    const ConstantEnvironment& env,
+    bool prune_dead_registers)
     : wps_accessor(std::move(wps_accessor)),
       fp_iter(cp_state, cfg, std::move(insn_analyzer)) {
+  if (prune_dead_registers) {
+    fp_iter.prune_dead_registers();
+  }
   fp_iter.run(env);
 }
 
+MethodSummary FixpointIterator::get_method_summary(
+    const DexMethod* method) const {
+  auto& method_cache = get_method_cache(method);
+  const auto* method_cache_entry =
+      find_matching_method_cache_entry(method_cache, get_entry_args(method));
+  if (method_cache_entry) {
+    std::lock_guard<std::mutex> lock_guard(m_stats_mutex);
+    m_stats.method_summary_hits++;
+    return method_cache_entry->summary;
+  }
+
+  auto& cfg = method->get_code()->cfg();
+  auto ipa = get_intraprocedural_analysis(method);
+  auto& intra_cp = ipa->fp_iter;
+  MethodSummary summary;
+  for (auto* block : cfg.blocks()) {
+    auto state = intra_cp.get_entry_state_at(block);
+    auto last_insn = block->get_last_insn();
+    for (auto& mie : InstructionIterable(block)) {
+      auto* insn = mie.insn;
+      intra_cp.analyze_instruction(insn, &state, insn == last_insn->insn);
+      summary.update(method, insn, state);
+    }
+  }
+  std::lock_guard<std::mutex> lock_guard(m_stats_mutex);
+  m_stats.method_summary_misses++;
+  return summary;
+}
+
 const ArgumentDomain& FixpointIterator::get_entry_args(
     const DexMethod* method) const {
   if (m_call_graph->has_node(method)) {
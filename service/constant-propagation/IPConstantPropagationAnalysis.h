@@ -63,7 +63,8 @@ struct IntraproceduralAnalysis {
       std::unique_ptr<WholeProgramStateAccessor> wps_accessor,
       const cfg::ControlFlowGraph& cfg,
       InstructionAnalyzer<ConstantEnvironment> insn_analyzer,
-      const ConstantEnvironment& env);
+      const ConstantEnvironment& env,
+      bool prune_dead_registers = false);
 };
 
 using IntraproceduralAnalysisFactory =
@@ -83,6 +84,8 @@ class FixpointIterator : public sparta::ParallelMonotonicFixpointIterator<
   struct Stats {
     size_t method_cache_hits{0};
     size_t method_cache_misses{0};
+    size_t method_summary_hits{0};
+    size_t method_summary_misses{0};
   };
   FixpointIterator(
       std::shared_ptr<const call_graph::Graph> call_graph,
@@ -107,6 +110,14 @@ class FixpointIterator : public sparta::ParallelMonotonicFixpointIterator<
   std::unique_ptr<IntraproceduralAnalysis> get_intraprocedural_analysis(
       const DexMethod*) const;
 
+  /*
+   * Returns the summary of the method for its current entry arguments. It is
+   * taken from the method cache when the last run already analyzed the method
+   * with the same arguments and the same values of the parts of the
+   * WholeProgramState it depends on, and computed from scratch otherwise.
+   */
+  MethodSummary get_method_summary(const DexMethod* method) const;
+
   const WholeProgramState& get_whole_program_state() const { return *m_wps; }
 
   void set_whole_program_state(std::unique_ptr<WholeProgramState> wps) {
@@ -127,6 +138,7 @@ class FixpointIterator : public sparta::ParallelMonotonicFixpointIterator<
     ArgumentDomain args;
     WholeProgramStateAccessorRecord wps_accessor_record;
     std::unordered_map<const IRInstruction*, ArgumentDomain> result;
+    MethodSummary summary;
   };
   using MethodCache = std::list<std::shared_ptr<const MethodCacheEntry>>;
   mutable ConcurrentMap<const DexMethod*, MethodCache> m_cache;
@@ -7,6 +7,10 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <iterator>
+
 #include <sparta/AbstractDomain.h>
 #include <sparta/ConstantAbstractDomain.h>
 #include <sparta/IntervalDomain.h>
@@ -144,8 +148,44 @@ class SignedConstantDomain final
     always_assert(m_bounds.is_normalized());
   }
 
-  void widen_with(const SignedConstantDomain&) {
-    throw std::runtime_error("widen_with not implemented!");
+  void widen_with(const SignedConstantDomain& that) {
+    widen_with_thresholds(that, std::array<int64_t, 0>());
+  }
+
+  /*
+   * Like the widening of intervals, but unstable bounds only move to the
+   * nearest of the sorted `thresholds`, rather than straight to MIN or MAX.
+   */
+  template <typename Thresholds>
+  void widen_with_thresholds(const SignedConstantDomain& that,
+                             const Thresholds& thresholds) {
+    if (is_bottom()) {
+      *this = that;
+      return;
+    }
+    if (that.is_bottom()) {
+      return;
+    }
+    if (that.m_bounds.l < m_bounds.l) {
+      auto it = std::upper_bound(thresholds.begin(), thresholds.end(),
+                                 that.m_bounds.l);
+      m_bounds.l = it == thresholds.begin() ? MIN : *std::prev(it);
+    }
+    if (m_bounds.u < that.m_bounds.u) {
+      auto it = std::lower_bound(thresholds.begin(), thresholds.end(),
+                                 that.m_bounds.u);
+      m_bounds.u = it == thresholds.end() ? MAX : *it;
+    }
+    m_bounds.nez &= that.m_bounds.nez;
+    m_bounds.normalize();
+  }
+
+  template <typename Thresholds>
+  SignedConstantDomain widening_with_thresholds(
+      const SignedConstantDomain& that, const Thresholds& thresholds) const {
+    auto copy = *this;
+    copy.widen_with_thresholds(that, thresholds);
+    return copy;
   }
 
   void meet_with(const SignedConstantDomain& that) {
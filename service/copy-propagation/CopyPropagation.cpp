@@ -512,41 +512,35 @@ Stats& Stats::operator+=(const Stats& that) {
 }
 
 Stats CopyPropagation::run(const Scope& scope) {
-  auto handle_method = [&](DexMethod* m, IRCode* code) {
-    const std::string& before_code = m_config.debug ? show(m->get_code()) : "";
-    const auto& result = run(code, m);
-
-    if (m_config.debug) {
-      // Run the IR type checker
-      IRTypeChecker checker(m);
-      checker.run();
-      if (!checker.good()) {
-        const std::string& msg = checker.what();
-        TRACE(RME, 1, "%s: Inconsistency in Dex code. %s", SHOW(m),
-              msg.c_str());
-        TRACE(RME, 1, "before code:\n%s", before_code.c_str());
-        TRACE(RME, 1, "after  code:\n%s", SHOW(m->get_code()));
-        always_assert(checker.good());
-      }
-    }
-
-    return result;
-  };
+  return walk::parallel::methods<Stats>(
+      scope, [&](DexMethod* m) { return run_on_method(m); },
+      m_config.debug ? 1 : redex_parallel::default_num_threads());
+}
 
-  auto stats = walk::parallel::methods<Stats>(
-      scope,
-      [&](DexMethod* m) {
-        IRCode* code = m->get_code();
-        if (code == nullptr ||
-            (m->rstate.no_optimizations() && !m_config.regalloc_has_run)) {
-          return Stats();
-        }
+Stats CopyPropagation::run_on_method(DexMethod* m) {
+  IRCode* code = m->get_code();
+  if (code == nullptr ||
+      (m->rstate.no_optimizations() && !m_config.regalloc_has_run)) {
+    return Stats();
+  }
 
-        return handle_method(m, code);
-      },
-      m_config.debug ? 1 : redex_parallel::default_num_threads());
+  const std::string& before_code = m_config.debug ? show(code) : "";
+  const auto& result = run(code, m);
+
+  if (m_config.debug) {
+    // Run the IR type checker
+    IRTypeChecker checker(m);
+    checker.run();
+    if (!checker.good()) {
+      const std::string& msg = checker.what();
+      TRACE(RME, 1, "%s: Inconsistency in Dex code. %s", SHOW(m), msg.c_str());
+      TRACE(RME, 1, "before code:\n%s", before_code.c_str());
+      TRACE(RME, 1, "after  code:\n%s", SHOW(code));
+      always_assert(checker.good());
+    }
+  }
 
-  return stats;
+  return result;
 }
 
 Stats CopyPropagation::run(IRCode* code, DexMethod* method) {
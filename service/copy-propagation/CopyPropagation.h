@@ -47,6 +47,10 @@ class CopyPropagation final {
 
   Stats run(const Scope& scope);
 
+  // Runs on the code of `method`, unless it must not be optimized, and
+  // type-checks the result in debug mode.
+  Stats run_on_method(DexMethod* method);
+
   Stats run(IRCode*, DexMethod* = nullptr);
 
   Stats run(IRCode*,
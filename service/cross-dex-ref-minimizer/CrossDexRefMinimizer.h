@@ -15,7 +15,7 @@
 
 #include "ClassReferencesCache.h"
 #include "DexClass.h"
-#include "MutablePriorityQueue.h"
+#include "LazyPriorityQueue.h"
 
 namespace cross_dex_ref_minimizer {
 
@@ -29,7 +29,9 @@ namespace cross_dex_ref_minimizer {
 // minimization, but also causes it to use more memory and run slower.
 constexpr uint64_t INFREQUENT_REFS_COUNT = 6;
 
-using PrioritizedDexClasses = MutablePriorityQueue<DexClass*, uint64_t>;
+// Most insertions and erasures reprioritize many classes, but only one front
+// lookup follows, so stale heap entries are cheaper than tree rebalancing.
+using PrioritizedDexClasses = LazyPriorityQueue<DexClass*, uint64_t>;
 struct CrossDexRefMinimizerStats {
   uint64_t classes{0};
   uint64_t resets{0};
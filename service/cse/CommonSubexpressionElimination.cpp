@@ -1269,9 +1269,12 @@ void SharedState::init_finalizable_fields(const Scope& scope) {
 
 void SharedState::init_scope(
     const Scope& scope,
-    const method::ClInitHasNoSideEffectsPredicate& clinit_has_no_side_effects) {
+    const method::ClInitHasNoSideEffectsPredicate& clinit_has_no_side_effects,
+    std::shared_ptr<const method_override_graph::Graph> method_override_graph) {
   always_assert(!m_method_override_graph);
-  m_method_override_graph = method_override_graph::build_graph(scope);
+  m_method_override_graph = method_override_graph
+                                ? std::move(method_override_graph)
+                                : method_override_graph::build_graph(scope);
 
   auto iterations = compute_conditionally_pure_methods(
       scope, m_method_override_graph.get(), clinit_has_no_side_effects,
@@ -1506,13 +1509,47 @@ void SharedState::cleanup() {
   }
 }
 
+static IROpcode get_move_opcode(const IRInstruction* earlier_insn) {
+  always_assert(!opcode::is_a_literal_const(earlier_insn->opcode()));
+  if (earlier_insn->has_dest()) {
+    return earlier_insn->dest_is_wide()     ? OPCODE_MOVE_WIDE
+           : earlier_insn->dest_is_object() ? OPCODE_MOVE_OBJECT
+                                            : OPCODE_MOVE;
+  } else if (earlier_insn->opcode() == OPCODE_NEW_ARRAY) {
+    return OPCODE_MOVE;
+  } else {
+    always_assert(opcode::is_an_aput(earlier_insn->opcode()) ||
+                  opcode::is_an_iput(earlier_insn->opcode()) ||
+                  opcode::is_an_sput(earlier_insn->opcode()));
+    return earlier_insn->src_is_wide(0) ? OPCODE_MOVE_WIDE
+           : (earlier_insn->opcode() == OPCODE_APUT_OBJECT ||
+              earlier_insn->opcode() == OPCODE_IPUT_OBJECT ||
+              earlier_insn->opcode() == OPCODE_SPUT_OBJECT)
+               ? OPCODE_MOVE_OBJECT
+               : OPCODE_MOVE;
+  }
+}
+
+// Whether an instruction computes its result from its operands alone, without
+// reading or writing memory or throwing, so that it can be evaluated early on
+// an incoming edge of its block.
+static bool is_speculatable(const IRInstruction* insn) {
+  auto op = insn->opcode();
+  return insn->has_dest() && !opcode::can_throw(op) &&
+         !opcode::has_side_effects(op) && !opcode::is_a_move(op) &&
+         !opcode::is_a_const(op) && !opcode::is_a_cmp(op) &&
+         !opcode::is_move_result_any(op) && !opcode::is_move_exception(op) &&
+         !opcode::is_an_internal(op);
+}
+
 CommonSubexpressionElimination::CommonSubexpressionElimination(
     SharedState* shared_state,
     cfg::ControlFlowGraph& cfg,
     bool is_static,
     bool is_init_or_clinit,
     DexType* declaring_type,
-    DexTypeList* args)
+    DexTypeList* args,
+    bool eliminate_partial_redundancies)
     : m_cfg(cfg),
       m_is_static(is_static),
       m_declaring_type(declaring_type),
@@ -1547,6 +1584,76 @@ CommonSubexpressionElimination::CommonSubexpressionElimination(
         return index;
       };
 
+  // The forward analysis only finds an instruction redundant when its value
+  // is available on all incoming edges. When it is available on some edges,
+  // and all other predecessors fall through into the block, we evaluate a
+  // clone of the instruction at the end of those predecessors, which makes
+  // the instruction fully redundant. To not grow the code, we only do that
+  // when the value is available on at least as many incoming edges as it is
+  // missing on.
+  auto find_partial_redundancy = [&](cfg::Block* block,
+                                     IRInstruction* insn,
+                                     const CseEnvironment& env,
+                                     value_id_t value_id) {
+    std::vector<cfg::Block*> missing_preds;
+    size_t available_preds{0};
+    PatriciaTreeSet<const IRInstruction*> earlier_insns;
+    for (auto* edge : block->preds()) {
+      if (edge->type() != cfg::EDGE_GOTO && edge->type() != cfg::EDGE_BRANCH) {
+        return;
+      }
+      auto* pred = edge->src();
+      auto pred_env =
+          analyzer.analyze_edge(edge, analyzer.get_exit_state_at(pred));
+      if (pred_env.is_bottom()) {
+        continue;
+      }
+      // The operands must hold the same values at the end of every
+      // predecessor as they do at the instruction.
+      for (size_t i = 0; i < insn->srcs_size(); i++) {
+        auto src_value = env.get_ref_env().get(insn->src(i));
+        if (!src_value.get_constant() ||
+            !(pred_env.get_ref_env().get(insn->src(i)) == src_value)) {
+          return;
+        }
+      }
+      auto defs = pred_env.get_def_env().get(value_id);
+      if (defs.is_top() || defs.is_bottom()) {
+        if (pred == block || pred->succs().size() != 1) {
+          return;
+        }
+        missing_preds.push_back(pred);
+        continue;
+      }
+      for (auto* earlier_insn : defs.elements()) {
+        if (earlier_insn == insn ||
+            opcode::is_a_literal_const(earlier_insn->opcode()) ||
+            get_move_opcode(earlier_insn) != get_move_opcode(insn)) {
+          return;
+        }
+        earlier_insns.insert(earlier_insn);
+      }
+      available_preds++;
+    }
+    if (available_preds == 0 || missing_preds.empty() ||
+        missing_preds.size() > available_preds) {
+      return;
+    }
+    // Make sure that the ids of the instructions in the cfg are assigned
+    // before the clones get theirs.
+    get_earlier_insn_id(insn);
+    for (auto* pred : missing_preds) {
+      auto clone = std::make_unique<IRInstruction>(*insn);
+      m_earlier_insn_ids.emplace(clone.get(), m_earlier_insn_ids.size());
+      earlier_insns.insert(clone.get());
+      m_partial_redundancy_clones.emplace_back(pred, std::move(clone));
+    }
+    TRACE(CSE, 4, "[CSE] %s is partially redundant, cloning into %zu blocks",
+          SHOW(insn), missing_preds.size());
+    m_forward.push_back({get_earlier_insns_index(earlier_insns), insn});
+    m_stats.partial_redundancies_eliminated++;
+  };
+
   // identify all instruction pairs where the result of the first instruction
   // can be forwarded to the second
 
@@ -1561,6 +1668,11 @@ CommonSubexpressionElimination::CommonSubexpressionElimination(
     }
     for (const auto& mie : InstructionIterable(block)) {
       IRInstruction* insn = mie.insn;
+      std::optional<CseEnvironment> prev_env;
+      if (eliminate_partial_redundancies && block->preds().size() > 1 &&
+          is_speculatable(insn)) {
+        prev_env = env;
+      }
       analyzer.analyze_instruction(insn, &env, insn == last_insn->insn);
       auto opcode = insn->opcode();
       if (!insn->has_dest() || opcode::is_a_move(opcode) ||
@@ -1577,6 +1689,9 @@ CommonSubexpressionElimination::CommonSubexpressionElimination(
       always_assert(!defs.is_top() && !defs.is_bottom());
       auto earlier_insns = defs.elements();
       if (earlier_insns.contains(insn)) {
+        if (prev_env && earlier_insns.size() == 1) {
+          find_partial_redundancy(block, insn, *prev_env, value_id);
+        }
         continue;
       }
       bool skip{false};
@@ -1617,6 +1732,8 @@ CommonSubexpressionElimination::CommonSubexpressionElimination(
   }
 }
 
+CommonSubexpressionElimination::~CommonSubexpressionElimination() = default;
+
 size_t CommonSubexpressionElimination::get_earlier_insn_id(
     const IRInstruction* insn) {
   // We need some helper state/functions to build the list m_earlier_insns
@@ -1630,27 +1747,6 @@ size_t CommonSubexpressionElimination::get_earlier_insn_id(
   return m_earlier_insn_ids.at(insn);
 }
 
-static IROpcode get_move_opcode(const IRInstruction* earlier_insn) {
-  always_assert(!opcode::is_a_literal_const(earlier_insn->opcode()));
-  if (earlier_insn->has_dest()) {
-    return earlier_insn->dest_is_wide()     ? OPCODE_MOVE_WIDE
-           : earlier_insn->dest_is_object() ? OPCODE_MOVE_OBJECT
-                                            : OPCODE_MOVE;
-  } else if (earlier_insn->opcode() == OPCODE_NEW_ARRAY) {
-    return OPCODE_MOVE;
-  } else {
-    always_assert(opcode::is_an_aput(earlier_insn->opcode()) ||
-                  opcode::is_an_iput(earlier_insn->opcode()) ||
-                  opcode::is_an_sput(earlier_insn->opcode()));
-    return earlier_insn->src_is_wide(0) ? OPCODE_MOVE_WIDE
-           : (earlier_insn->opcode() == OPCODE_APUT_OBJECT ||
-              earlier_insn->opcode() == OPCODE_IPUT_OBJECT ||
-              earlier_insn->opcode() == OPCODE_SPUT_OBJECT)
-               ? OPCODE_MOVE_OBJECT
-               : OPCODE_MOVE;
-  }
-}
-
 static std::pair<IROpcode, std::optional<int64_t>> get_move_or_const_literal(
     const sparta::PatriciaTreeSet<const IRInstruction*>& insns) {
   std::optional<IROpcode> opcode;
@@ -1692,6 +1788,15 @@ bool CommonSubexpressionElimination::patch(bool runtime_assertions) {
 
   TRACE(CSE, 5, "[CSE] before:\n%s", SHOW(m_cfg));
 
+  // Evaluate clones of partially redundant instructions into fresh registers
+  // at the end of the predecessors where their values are missing.
+  for (auto& [block, clone] : m_partial_redundancy_clones) {
+    clone->set_dest(clone->dest_is_wide() ? m_cfg.allocate_wide_temp()
+                                          : m_cfg.allocate_temp());
+    block->push_back(clone.release());
+  }
+  m_partial_redundancy_clones.clear();
+
   // gather relevant instructions, and allocate temp registers
 
   // We'll allocate one temp per "earlier_insns_index".
@@ -2033,6 +2138,7 @@ Stats& Stats::operator+=(const Stats& that) {
   }
   max_iterations = std::max(max_iterations, that.max_iterations);
   branches_eliminated += that.branches_eliminated;
+  partial_redundancies_eliminated += that.partial_redundancies_eliminated;
   return *this;
 }
 
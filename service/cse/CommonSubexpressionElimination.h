@@ -37,6 +37,9 @@ struct Stats {
   std::unordered_map<uint16_t, size_t> eliminated_opcodes;
   size_t max_iterations{0};
   size_t branches_eliminated{0};
+  // Instructions that were only redundant on some incoming edges, and that
+  // were made fully redundant by evaluating them on the other edges.
+  size_t partial_redundancies_eliminated{0};
 
   Stats& operator+=(const Stats&);
 };
@@ -75,9 +78,13 @@ class SharedState {
       const std::unordered_set<DexMethodRef*>& pure_methods,
       const std::unordered_set<const DexString*>& finalish_field_names,
       const std::unordered_set<const DexField*>& finalish_fields);
+  // Computes the scope-wide barrier and purity information. A given method
+  // override graph is reused; otherwise, one is built.
   void init_scope(const Scope&,
                   const method::ClInitHasNoSideEffectsPredicate&
-                      clinit_has_no_side_effects);
+                      clinit_has_no_side_effects,
+                  std::shared_ptr<const method_override_graph::Graph>
+                      method_override_graph = nullptr);
   CseUnorderedLocationSet get_relevant_written_locations(
       const IRInstruction* insn,
       DexType* exact_virtual_scope,
@@ -122,15 +129,15 @@ class SharedState {
   std::unordered_set<DexMethodRef*> m_safe_methods;
   // subset of safe methods which are in fact defs
   std::unordered_set<const DexMethod*> m_safe_method_defs;
-  const std::unordered_set<const DexString*>& m_finalish_field_names;
-  const std::unordered_set<const DexField*>& m_finalish_fields;
+  const std::unordered_set<const DexString*> m_finalish_field_names;
+  const std::unordered_set<const DexField*> m_finalish_fields;
   std::unordered_set<const DexField*> m_finalizable_fields;
   std::unique_ptr<AtomicMap<Barrier, size_t, BarrierHasher>> m_barriers;
   std::unordered_map<const DexMethod*, CseUnorderedLocationSet>
       m_method_written_locations;
   std::unordered_map<const DexMethod*, CseUnorderedLocationSet>
       m_conditionally_pure_methods;
-  std::unique_ptr<const method_override_graph::Graph> m_method_override_graph;
+  std::shared_ptr<const method_override_graph::Graph> m_method_override_graph;
   SharedStateStats m_stats;
   // boxing to unboxing mapping
   std::unordered_map<const DexMethodRef*, const DexMethodRef*> m_boxing_map;
@@ -145,7 +152,9 @@ class CommonSubexpressionElimination {
                                  bool is_static,
                                  bool is_init_or_clinit,
                                  DexType* declaring_type,
-                                 DexTypeList* args);
+                                 DexTypeList* args,
+                                 bool eliminate_partial_redundancies = false);
+  ~CommonSubexpressionElimination();
 
   const Stats& get_stats() const { return m_stats; }
 
@@ -166,6 +175,10 @@ class CommonSubexpressionElimination {
   };
   std::vector<Forward> m_forward;
   std::vector<cfg::Edge*> m_dead_edges;
+  // Clones of partially redundant instructions, and the blocks at the end of
+  // which they are to be inserted.
+  std::vector<std::pair<cfg::Block*, std::unique_ptr<IRInstruction>>>
+      m_partial_redundancy_clones;
   // List of unique sets of earlier instructions to be forwarded
   std::vector<sparta::PatriciaTreeSet<const IRInstruction*>> m_earlier_insns;
   cfg::ControlFlowGraph& m_cfg;
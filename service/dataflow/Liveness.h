@@ -7,8 +7,11 @@
 
 #pragma once
 
+#include <sparta/BitVectorSetAbstractDomain.h>
 #include <sparta/PatriciaTreeSetAbstractDomain.h>
 
+#include <unordered_map>
+
 #include "BaseIRAnalyzer.h"
 #include "ControlFlow.h"
 
@@ -38,3 +41,91 @@ class LivenessFixpointIterator final
     return get_entry_state_at(block);
   }
 };
+
+using DenseLivenessDomain = sparta::BitVectorSetAbstractDomain<reg_t>;
+
+/*
+ * Same analysis as LivenessFixpointIterator, over bit vectors of registers.
+ * The use and def sets of each block are computed once upfront, so the
+ * fixpoint iteration itself only performs two word-parallel set operations per
+ * block visit.
+ *
+ * Since each set costs registers_size / 8 bytes regardless of how many
+ * registers it contains, this is only preferable when the method does not
+ * have too many registers; see `use_dense_liveness`.
+ */
+class DenseLivenessFixpointIterator final
+    : public ir_analyzer::BaseBackwardsIRAnalyzer<DenseLivenessDomain> {
+ public:
+  explicit DenseLivenessFixpointIterator(const cfg::ControlFlowGraph& cfg)
+      : ir_analyzer::BaseBackwardsIRAnalyzer<DenseLivenessDomain>(cfg) {
+    for (auto* block : cfg.blocks()) {
+      auto& summary = m_block_summaries[block];
+      for (auto it = block->rbegin(); it != block->rend(); ++it) {
+        if (it->type != MFLOW_OPCODE) {
+          continue;
+        }
+        auto* insn = it->insn;
+        if (insn->has_dest()) {
+          summary.defs.add(insn->dest());
+          summary.uses.remove(insn->dest());
+        }
+        for (size_t i = 0; i < insn->srcs_size(); ++i) {
+          summary.uses.add(insn->src(i));
+        }
+      }
+    }
+  }
+
+  void analyze_node(const NodeId& block,
+                    DenseLivenessDomain* current_state) const override {
+    if (current_state->is_bottom()) {
+      return;
+    }
+    auto& summary = m_block_summaries.at(block);
+    current_state->difference_with(summary.defs);
+    current_state->join_with(summary.uses);
+  }
+
+  void analyze_instruction(IRInstruction* insn,
+                           DenseLivenessDomain* current_state) const override {
+    if (insn->has_dest()) {
+      current_state->remove(insn->dest());
+    }
+    for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      current_state->add(insn->src(i));
+    }
+  }
+
+  const DenseLivenessDomain& get_live_in_vars_at(const NodeId& block) const {
+    return get_exit_state_at(block);
+  }
+
+  const DenseLivenessDomain& get_live_out_vars_at(const NodeId& block) const {
+    return get_entry_state_at(block);
+  }
+
+ private:
+  struct BlockSummary {
+    // Registers read before being written in the block.
+    DenseLivenessDomain uses;
+    // Registers written in the block.
+    DenseLivenessDomain defs;
+  };
+
+  std::unordered_map<cfg::Block*, BlockSummary> m_block_summaries;
+};
+
+/*
+ * Whether DenseLivenessFixpointIterator is expected to outperform
+ * LivenessFixpointIterator on the given CFG, without using an unreasonable
+ * amount of memory for the per-block states.
+ */
+inline bool use_dense_liveness(const cfg::ControlFlowGraph& cfg) {
+  // Beyond this many bits per block state, the sets are likely to be sparse.
+  constexpr size_t kMaxRegisters = 1 << 16;
+  // The entry and exit states of all blocks together.
+  constexpr size_t kMaxTotalBits = size_t(1) << 30;
+  size_t regs = cfg.get_registers_size();
+  return regs <= kMaxRegisters && regs * cfg.num_blocks() * 2 <= kMaxTotalBits;
+}
@@ -8,10 +8,13 @@
 #pragma once
 
 #include <sparta/AbstractDomain.h>
+#include <sparta/BitVectorSetAbstractDomain.h>
 #include <sparta/PatriciaTreeMapAbstractEnvironment.h>
 #include <sparta/PatriciaTreeSetAbstractDomain.h>
 
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "BaseIRAnalyzer.h"
 #include "ControlFlow.h"
@@ -86,4 +89,146 @@ class MoveAwareFixpointIterator final
   }
 };
 
+/*
+ * Same analysis as FixpointIterator, where the state is a single bit vector
+ * over all the definitions of the method instead of a map from registers to
+ * sets of instructions. The gen and kill sets of each block are computed once
+ * upfront, so the fixpoint iteration only performs two word-parallel set
+ * operations per block visit.
+ *
+ * Bit r < registers_size stands for "register r may not have been defined",
+ * which is how the entry state makes `get` return Top for registers that are
+ * not defined along every path, just like FixpointIterator run from Top.
+ *
+ * Each block state costs one bit per definition in the method; see
+ * `use_dense_reaching_defs`.
+ */
+using DenseDomain = sparta::BitVectorSetAbstractDomain<uint32_t>;
+
+class DenseFixpointIterator final
+    : public ir_analyzer::BaseIRAnalyzer<DenseDomain> {
+ public:
+  explicit DenseFixpointIterator(const cfg::ControlFlowGraph& cfg,
+                                 Filter filter = nullptr)
+      : ir_analyzer::BaseIRAnalyzer<DenseDomain>(cfg),
+        m_filter(std::move(filter)),
+        m_registers_size(cfg.get_registers_size()),
+        m_defs_of_reg(m_registers_size) {
+    for (reg_t reg = 0; reg < m_registers_size; ++reg) {
+      m_defs_of_reg[reg].push_back(reg);
+      m_entry_state.add(reg);
+    }
+    for (auto* block : cfg.blocks()) {
+      for (auto& mie : ir_list::InstructionIterable(block)) {
+        auto* insn = mie.insn;
+        if (insn->has_dest()) {
+          auto index = (uint32_t)(m_registers_size + m_defs.size());
+          m_defs.push_back(const_cast<IRInstruction*>(insn));
+          m_def_indices.emplace(insn, index);
+          m_defs_of_reg[insn->dest()].push_back(index);
+        }
+      }
+    }
+    for (auto* block : cfg.blocks()) {
+      auto& summary = m_block_summaries[block];
+      for (auto& mie : ir_list::InstructionIterable(block)) {
+        auto* insn = mie.insn;
+        if (!insn->has_dest()) {
+          continue;
+        }
+        for (auto index : m_defs_of_reg[insn->dest()]) {
+          summary.gen.remove(index);
+          summary.kill.add(index);
+        }
+        if (!m_filter || m_filter(insn)) {
+          summary.gen.add(m_def_indices.at(insn));
+        }
+      }
+    }
+  }
+
+  using ir_analyzer::BaseIRAnalyzer<DenseDomain>::run;
+
+  // Runs the analysis from the method entry, where no register is defined.
+  void run() { run(m_entry_state); }
+
+  void analyze_node(const NodeId& block,
+                    DenseDomain* current_state) const override {
+    if (current_state->is_bottom()) {
+      return;
+    }
+    auto& summary = m_block_summaries.at(block);
+    current_state->difference_with(summary.kill);
+    current_state->join_with(summary.gen);
+  }
+
+  void analyze_instruction(const IRInstruction* insn,
+                           DenseDomain* current_state) const override {
+    if (!insn->has_dest()) {
+      return;
+    }
+    for (auto index : m_defs_of_reg[insn->dest()]) {
+      current_state->remove(index);
+    }
+    if (!m_filter || m_filter(insn)) {
+      current_state->add(m_def_indices.at(insn));
+    }
+  }
+
+  // The definitions of `reg` that reach the program point of `state`, in the
+  // same form FixpointIterator's environments would hold them.
+  Domain get(const DenseDomain& state, reg_t reg) const {
+    if (state.is_bottom()) {
+      return Domain::bottom();
+    }
+    if (reg >= m_registers_size || state.contains(reg)) {
+      return Domain::top();
+    }
+    Domain defs;
+    const auto& indices = m_defs_of_reg[reg];
+    for (auto it = std::next(indices.begin()); it != indices.end(); ++it) {
+      if (state.contains(*it)) {
+        defs.add(m_defs[*it - m_registers_size]);
+      }
+    }
+    return defs;
+  }
+
+  bool has_filter() const { return m_filter != nullptr; }
+
+ private:
+  struct BlockSummary {
+    // The last definitions of each register written in the block.
+    DenseDomain gen;
+    // All the definitions of the registers written in the block.
+    DenseDomain kill;
+  };
+
+  Filter m_filter;
+  reg_t m_registers_size;
+  std::vector<IRInstruction*> m_defs;
+  std::unordered_map<const IRInstruction*, uint32_t> m_def_indices;
+  // For each register, its "undefined" bit followed by its definitions.
+  std::vector<std::vector<uint32_t>> m_defs_of_reg;
+  DenseDomain m_entry_state;
+  std::unordered_map<cfg::Block*, BlockSummary> m_block_summaries;
+};
+
+/*
+ * Whether DenseFixpointIterator is expected to outperform FixpointIterator on
+ * the given CFG, without using an unreasonable amount of memory for the
+ * per-block states.
+ */
+inline bool use_dense_reaching_defs(const cfg::ControlFlowGraph& cfg) {
+  // The entry and exit states and the gen and kill sets of all blocks.
+  constexpr size_t kMaxTotalBits = size_t(1) << 30;
+  size_t bits = cfg.get_registers_size();
+  for (auto* block : cfg.blocks()) {
+    for (auto& mie : ir_list::InstructionIterable(block)) {
+      bits += mie.insn->has_dest() ? 1 : 0;
+    }
+  }
+  return bits * cfg.num_blocks() * 4 <= kMaxTotalBits;
+}
+
 } // namespace reaching_defs
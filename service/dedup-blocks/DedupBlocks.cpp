@@ -50,6 +50,7 @@
 
 #include <algorithm>
 
+#include "DexHasher.h"
 #include "DexPosition.h"
 #include "Lazy.h"
 #include "LiveRange.h"
@@ -62,6 +63,8 @@
 #include "StlUtil.h"
 #include "Trace.h"
 #include "TypeInference.h"
+#include "Walkers.h"
+#include "WorkQueue.h"
 #include <boost/functional/hash.hpp>
 
 namespace {
@@ -231,6 +234,93 @@ bool needs_pos(const IRList::iterator& begin, const IRList::iterator& end) {
   return true;
 }
 
+// The kinds of outgoing edges of a block, which is all we can compare across
+// methods: goto and branch edges by case key, and throw edges in order by
+// catch type.
+using EdgeSignature =
+    std::vector<std::tuple<cfg::EdgeType, cfg::Edge::CaseKey, DexType*>>;
+
+EdgeSignature get_edge_signature(const cfg::Block* block) {
+  EdgeSignature signature;
+  for (auto* edge : get_branch_or_goto_succs(block)) {
+    signature.emplace_back(edge->type(), edge->case_key().value_or(0),
+                           nullptr);
+  }
+  std::sort(signature.begin(), signature.end());
+  for (auto* edge : block->get_outgoing_throws_in_order()) {
+    signature.emplace_back(cfg::EDGE_THROW, 0,
+                           edge->throw_info()->catch_type);
+  }
+  return signature;
+}
+
+hash_t hash_edge_signature(const EdgeSignature& signature) {
+  hash_t result = 0;
+  for (const auto& [type, case_key, catch_type] : signature) {
+    boost::hash_combine(result, (int)type);
+    boost::hash_combine(result, case_key);
+    boost::hash_combine(result, catch_type);
+  }
+  return result;
+}
+
+// Whether the instructions of both blocks are the same, up to a consistent
+// renaming of registers.
+bool same_insns_modulo_registers(const cfg::Block* a, const cfg::Block* b) {
+  auto ii_a = ir_list::ConstInstructionIterable(*a);
+  auto ii_b = ir_list::ConstInstructionIterable(*b);
+  std::unordered_map<reg_t, reg_t> a_to_b;
+  std::unordered_map<reg_t, reg_t> b_to_a;
+  auto rename = [&](reg_t reg_a, reg_t reg_b) {
+    return a_to_b.emplace(reg_a, reg_b).first->second == reg_b &&
+           b_to_a.emplace(reg_b, reg_a).first->second == reg_a;
+  };
+  auto it_a = ii_a.begin();
+  auto it_b = ii_b.begin();
+  for (; it_a != ii_a.end() && it_b != ii_b.end(); ++it_a, ++it_b) {
+    const auto* insn_a = it_a->insn;
+    const auto* insn_b = it_b->insn;
+    if (insn_a->opcode() != insn_b->opcode() ||
+        insn_a->srcs_size() != insn_b->srcs_size()) {
+      return false;
+    }
+    IRInstruction renamed(*insn_a);
+    for (size_t i = 0; i < insn_a->srcs_size(); ++i) {
+      if (!rename(insn_a->src(i), insn_b->src(i))) {
+        return false;
+      }
+      renamed.set_src(i, insn_b->src(i));
+    }
+    if (insn_a->has_dest()) {
+      if (!rename(insn_a->dest(), insn_b->dest())) {
+        return false;
+      }
+      renamed.set_dest(insn_b->dest());
+    }
+    if (!(renamed == *insn_b)) {
+      return false;
+    }
+  }
+  return it_a == ii_a.end() && it_b == ii_b.end();
+}
+
+bool is_cross_method_eligible(const dedup_blocks_impl::Config* config,
+                              const cfg::Block* block) {
+  if (block->is_catch() ||
+      block->num_opcodes() < config->cross_method_min_insns) {
+    return false;
+  }
+  auto ii = ir_list::ConstInstructionIterable(*block);
+  if (opcode::is_move_result_any(ii.begin()->insn->opcode())) {
+    return false;
+  }
+  return config->dedup_fill_in_stack_trace ||
+         std::none_of(ii.begin(), ii.end(), [](auto& mie) {
+           return dedup_blocks_impl::
+               is_ineligible_because_of_fill_in_stack_trace(mie.insn);
+         });
+}
+
 } // namespace
 
 namespace dedup_blocks_impl {
@@ -1328,4 +1418,91 @@ Stats& Stats::operator+=(const Stats& that) {
   return *this;
 }
 
+CrossMethodDuplicates find_cross_method_duplicates(const Config* config,
+                                                   const Scope& scope) {
+  struct HashedBlock {
+    hash_t hash;
+    cfg::Block* block;
+  };
+  InsertOnlyConcurrentMap<DexMethod*, std::vector<HashedBlock>> hashed_blocks;
+  walk::parallel::code(scope, [&](DexMethod* method, IRCode& code) {
+    if (config->method_blocklist.count(method) != 0 ||
+        method->rstate.no_optimizations()) {
+      return;
+    }
+    always_assert(code.editable_cfg_built());
+    std::vector<HashedBlock> blocks;
+    for (auto* block : code.cfg().blocks()) {
+      if (!is_cross_method_eligible(config, block)) {
+        continue;
+      }
+      auto hash = hashing::canonical_block_hash(block);
+      boost::hash_combine(hash,
+                          hash_edge_signature(get_edge_signature(block)));
+      blocks.push_back({hash, block});
+    }
+    if (!blocks.empty()) {
+      hashed_blocks.emplace(method, std::move(blocks));
+    }
+  });
+
+  // Bucket in walk order, so that everything below is deterministic.
+  std::vector<std::vector<CrossMethodBlock>> buckets;
+  std::unordered_map<hash_t, size_t> bucket_indices;
+  walk::code(scope, [&](DexMethod* method, IRCode&) {
+    const auto* blocks = hashed_blocks.get(method);
+    if (blocks == nullptr) {
+      return;
+    }
+    for (const auto& hashed_block : *blocks) {
+      auto [it, emplaced] =
+          bucket_indices.emplace(hashed_block.hash, buckets.size());
+      if (emplaced) {
+        buckets.emplace_back();
+      }
+      buckets[it->second].push_back({method, hashed_block.block});
+    }
+  });
+
+  std::vector<CrossMethodDuplicates> bucket_groups(buckets.size());
+  workqueue_run_for<size_t>(0, buckets.size(), [&](size_t i) {
+    const auto& bucket = buckets[i];
+    if (bucket.size() < 2) {
+      return;
+    }
+    auto& groups = bucket_groups[i];
+    for (const auto& candidate : bucket) {
+      auto signature = get_edge_signature(candidate.block);
+      auto it = std::find_if(groups.begin(), groups.end(), [&](auto& group) {
+        const auto* representative = group.front().block;
+        return get_edge_signature(representative) == signature &&
+               same_insns_modulo_registers(representative, candidate.block);
+      });
+      if (it == groups.end()) {
+        groups.push_back({candidate});
+      } else if (it->back().method != candidate.method) {
+        // Duplicates within a method are left to the regular deduplication.
+        it->push_back(candidate);
+      }
+    }
+  });
+
+  CrossMethodDuplicates duplicates;
+  for (auto& groups : bucket_groups) {
+    for (auto& group : groups) {
+      if (group.size() > 1) {
+        duplicates.push_back(std::move(group));
+      }
+    }
+  }
+  auto savings = [](const std::vector<CrossMethodBlock>& group) {
+    return (group.size() - 1) * group.front().block->num_opcodes();
+  };
+  std::stable_sort(duplicates.begin(), duplicates.end(),
+                   [&](const auto& a, const auto& b) {
+                     return savings(a) > savings(b);
+                   });
+  return duplicates;
+}
+
 } // namespace dedup_blocks_impl
@@ -11,6 +11,10 @@
 
 class IRInstruction;
 
+namespace cfg {
+class Block;
+} // namespace cfg
+
 namespace dedup_blocks_impl {
 
 struct Config {
@@ -22,6 +26,10 @@ struct Config {
   bool debug = false;
   bool dedup_fill_in_stack_trace = false;
   uint32_t max_iteration = 6;
+  // Whether to also look for duplicate blocks across methods, and the minimum
+  // number of instructions such blocks must have.
+  bool cross_method = false;
+  uint32_t cross_method_min_insns = 3;
 };
 
 struct Stats {
@@ -59,4 +67,21 @@ class DedupBlocks {
   Stats m_stats;
 };
 
+struct CrossMethodBlock {
+  DexMethod* method;
+  cfg::Block* block;
+};
+
+// Groups of blocks in different methods with the same instructions up to a
+// consistent renaming of registers, and outgoing edges of the same kinds. A
+// block cannot be merged with its duplicates in other methods, but each group
+// is a ready-made candidate for outlining. Groups are ordered by decreasing
+// potential savings, and otherwise in walk order.
+using CrossMethodDuplicates = std::vector<std::vector<CrossMethodBlock>>;
+
+// Hashes the eligible blocks of all methods in parallel, and verifies the
+// blocks in each hash bucket. Methods must have an editable CFG.
+CrossMethodDuplicates find_cross_method_duplicates(const Config* config,
+                                                   const Scope& scope);
+
 } // namespace dedup_blocks_impl
@@ -7,6 +7,9 @@
 
 #include "FieldOpTracker.h"
 
+#include <optional>
+
+#include <boost/functional/hash.hpp>
 #include <sparta/ConstantAbstractDomain.h>
 #include <sparta/PatriciaTreeMapAbstractEnvironment.h>
 
@@ -21,6 +24,7 @@
 #include "ScopedCFG.h"
 #include "TypeInference.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -381,6 +385,80 @@ class WritesAnalyzer {
   }
 };
 
+field_op_tracker::FieldStatsMap analyze_method(DexMethod* method) {
+  field_op_tracker::FieldStatsMap field_stats;
+  if (method::is_init(method)) {
+    // compute init_writes by checking receiver of each iput
+    cfg::ScopedCFG cfg(method->get_code());
+    reaching_defs::MoveAwareFixpointIterator reaching_definitions(*cfg);
+    reaching_definitions.run(reaching_defs::Environment());
+    auto first_load_param = cfg->get_param_instructions().begin()->insn;
+    always_assert(first_load_param->opcode() == IOPCODE_LOAD_PARAM_OBJECT);
+    for (cfg::Block* block : cfg->blocks()) {
+      auto env = reaching_definitions.get_entry_state_at(block);
+      auto insns = InstructionIterable(block);
+      for (auto it = insns.begin(); it != insns.end();
+           reaching_definitions.analyze_instruction(it++->insn, &env)) {
+        IRInstruction* insn = it->insn;
+        if (!opcode::is_an_iput(insn->opcode())) {
+          continue;
+        }
+        auto field = resolve_field(insn->get_field());
+        if (field == nullptr || field->get_class() != method->get_class()) {
+          continue;
+        }
+        // We only consider for init_writes those iputs where the obj is the
+        // receiver. I cannot see where the JVM spec this would be enforced,
+        // we'll be conservative to be safe.
+        auto obj_defs = env.get(insn->src(1));
+        if (!obj_defs.is_top() && !obj_defs.is_bottom() &&
+            obj_defs.elements().size() == 1 &&
+            *obj_defs.elements().begin() == first_load_param) {
+          ++field_stats[field].init_writes;
+        }
+      }
+    }
+  }
+  bool is_clinit = method::is_clinit(method);
+  editable_cfg_adapter::iterate(
+      method->get_code(), [&](const MethodItemEntry& mie) {
+        auto insn = mie.insn;
+        auto op = insn->opcode();
+        if (!insn->has_field()) {
+          return editable_cfg_adapter::LOOP_CONTINUE;
+        }
+        auto field = resolve_field(insn->get_field());
+        if (field == nullptr) {
+          return editable_cfg_adapter::LOOP_CONTINUE;
+        }
+        if (opcode::is_an_sget(op) || opcode::is_an_iget(op)) {
+          ++field_stats[field].reads;
+        } else if (opcode::is_an_sput(op) || opcode::is_an_iput(op)) {
+          ++field_stats[field].writes;
+          if (is_clinit && is_static(field) &&
+              field->get_class() == method->get_class()) {
+            ++field_stats[field].init_writes;
+          }
+        }
+        return editable_cfg_adapter::LOOP_CONTINUE;
+      });
+  return field_stats;
+}
+
+void analyze_annotations(const Scope& scope,
+                         field_op_tracker::FieldStatsMap* field_stats) {
+  walk::annotations(scope, [&](DexAnnotation* anno) {
+    std::vector<DexFieldRef*> fields_in_anno;
+    anno->gather_fields(fields_in_anno);
+    for (const auto& field_ref : fields_in_anno) {
+      auto field = resolve_field(field_ref);
+      if (field) {
+        ++(*field_stats)[field].reads;
+      }
+    }
+  });
+}
+
 } // namespace
 
 namespace field_op_tracker {
@@ -434,63 +512,7 @@ FieldStatsMap analyze(const Scope& scope) {
     if (!method->get_code()) {
       return;
     }
-    std::unordered_map<DexField*, FieldStats> field_stats;
-    if (method::is_init(method)) {
-      // compute init_writes by checking receiver of each iput
-      cfg::ScopedCFG cfg(method->get_code());
-      reaching_defs::MoveAwareFixpointIterator reaching_definitions(*cfg);
-      reaching_definitions.run(reaching_defs::Environment());
-      auto first_load_param = cfg->get_param_instructions().begin()->insn;
-      always_assert(first_load_param->opcode() == IOPCODE_LOAD_PARAM_OBJECT);
-      for (cfg::Block* block : cfg->blocks()) {
-        auto env = reaching_definitions.get_entry_state_at(block);
-        auto insns = InstructionIterable(block);
-        for (auto it = insns.begin(); it != insns.end();
-             reaching_definitions.analyze_instruction(it++->insn, &env)) {
-          IRInstruction* insn = it->insn;
-          if (!opcode::is_an_iput(insn->opcode())) {
-            continue;
-          }
-          auto field = resolve_field(insn->get_field());
-          if (field == nullptr || field->get_class() != method->get_class()) {
-            continue;
-          }
-          // We only consider for init_writes those iputs where the obj is the
-          // receiver. I cannot see where the JVM spec this would be enforced,
-          // we'll be conservative to be safe.
-          auto obj_defs = env.get(insn->src(1));
-          if (!obj_defs.is_top() && !obj_defs.is_bottom() &&
-              obj_defs.elements().size() == 1 &&
-              *obj_defs.elements().begin() == first_load_param) {
-            ++field_stats[field].init_writes;
-          }
-        }
-      }
-    }
-    bool is_clinit = method::is_clinit(method);
-    editable_cfg_adapter::iterate(
-        method->get_code(), [&](const MethodItemEntry& mie) {
-          auto insn = mie.insn;
-          auto op = insn->opcode();
-          if (!insn->has_field()) {
-            return editable_cfg_adapter::LOOP_CONTINUE;
-          }
-          auto field = resolve_field(insn->get_field());
-          if (field == nullptr) {
-            return editable_cfg_adapter::LOOP_CONTINUE;
-          }
-          if (opcode::is_an_sget(op) || opcode::is_an_iget(op)) {
-            ++field_stats[field].reads;
-          } else if (opcode::is_an_sput(op) || opcode::is_an_iput(op)) {
-            ++field_stats[field].writes;
-            if (is_clinit && is_static(field) &&
-                field->get_class() == method->get_class()) {
-              ++field_stats[field].init_writes;
-            }
-          }
-          return editable_cfg_adapter::LOOP_CONTINUE;
-        });
-    for (auto& p : field_stats) {
+    for (auto& p : analyze_method(method)) {
       concurrent_field_stats.update(
           p.first, [&](DexField*, FieldStats& fs, bool) { fs += p.second; });
     }
@@ -500,17 +522,117 @@ FieldStatsMap analyze(const Scope& scope) {
                             concurrent_field_stats.end());
 
   // Gather field reads from annotations.
-  walk::annotations(scope, [&](DexAnnotation* anno) {
-    std::vector<DexFieldRef*> fields_in_anno;
-    anno->gather_fields(fields_in_anno);
-    for (const auto& field_ref : fields_in_anno) {
-      auto field = resolve_field(field_ref);
-      if (field) {
-        ++field_stats[field].reads;
+  analyze_annotations(scope, &field_stats);
+  return field_stats;
+}
+
+size_t FieldAccessIndex::fingerprint(const DexMethod* method) {
+  size_t seed = 0;
+  boost::hash_combine(seed, method->get_class());
+  boost::hash_combine(seed, method->get_name());
+  editable_cfg_adapter::iterate(
+      method->get_code(), [&](const MethodItemEntry& mie) {
+        boost::hash_combine(seed, mie.insn->hash());
+        // What a field ref resolves to may change without the code changing.
+        if (mie.insn->has_field()) {
+          boost::hash_combine(seed, resolve_field(mie.insn->get_field()));
+        }
+        return editable_cfg_adapter::LOOP_CONTINUE;
+      });
+  return seed;
+}
+
+void FieldAccessIndex::add(DexMethod* method, const FieldStatsMap& accesses) {
+  for (auto& [field, stats] : accesses) {
+    m_field_stats[field] += stats;
+    if (method == nullptr) {
+      continue;
+    }
+    if (stats.reads > 0) {
+      m_readers[field].insert(method);
+    }
+    if (stats.writes > 0) {
+      m_writers[field].insert(method);
+    }
+  }
+}
+
+void FieldAccessIndex::remove(DexMethod* method,
+                              const FieldStatsMap& accesses) {
+  auto remove_method = [method](FieldMethods& field_methods,
+                                const DexField* field) {
+    auto it = field_methods.find(field);
+    if (it != field_methods.end()) {
+      it->second.erase(method);
+      if (it->second.empty()) {
+        field_methods.erase(it);
       }
     }
+  };
+  for (auto& [field, stats] : accesses) {
+    auto it = m_field_stats.find(field);
+    always_assert(it != m_field_stats.end());
+    auto& total = it->second;
+    total.reads -= stats.reads;
+    total.writes -= stats.writes;
+    total.init_writes -= stats.init_writes;
+    // Like `analyze`, only keep fields that are accessed.
+    if (total.reads == 0 && total.writes == 0 && total.init_writes == 0) {
+      m_field_stats.erase(it);
+    }
+    if (method != nullptr) {
+      remove_method(m_readers, field);
+      remove_method(m_writers, field);
+    }
+  }
+}
+
+size_t FieldAccessIndex::update(const Scope& scope) {
+  std::vector<DexMethod*> methods;
+  walk::code(scope, [&](DexMethod* method, const IRCode&) {
+    methods.push_back(method);
+  });
+  std::vector<std::optional<MethodAccesses>> analyzed(methods.size());
+  workqueue_run_for<size_t>(0, methods.size(), [&](size_t i) {
+    auto* method = methods[i];
+    auto current = fingerprint(method);
+    auto it = m_methods.find(method);
+    if (it == m_methods.end() || it->second.fingerprint != current) {
+      analyzed[i] = MethodAccesses{current, analyze_method(method)};
+    }
   });
-  return field_stats;
+
+  // Forget about the methods which are gone, or lost their code.
+  std::unordered_set<const DexMethod*> present(methods.begin(), methods.end());
+  for (auto it = m_methods.begin(); it != m_methods.end();) {
+    if (present.count(it->first)) {
+      ++it;
+      continue;
+    }
+    remove(it->first, it->second.field_stats);
+    it = m_methods.erase(it);
+  }
+
+  size_t reanalyzed = 0;
+  for (size_t i = 0; i < methods.size(); i++) {
+    if (!analyzed[i]) {
+      continue;
+    }
+    auto* method = methods[i];
+    auto& entry = m_methods[method];
+    remove(method, entry.field_stats);
+    entry = std::move(*analyzed[i]);
+    add(method, entry.field_stats);
+    reanalyzed++;
+  }
+
+  // Annotations are cheap to walk, so their reads are just gathered again.
+  FieldStatsMap annotation_reads;
+  analyze_annotations(scope, &annotation_reads);
+  remove(nullptr, m_annotation_reads);
+  m_annotation_reads = std::move(annotation_reads);
+  add(nullptr, m_annotation_reads);
+  return reanalyzed;
 }
 
 } // namespace field_op_tracker
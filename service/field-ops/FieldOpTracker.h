@@ -11,6 +11,7 @@
 #include "DexClass.h"
 
 #include <unordered_map>
+#include <unordered_set>
 
 namespace field_op_tracker {
 
@@ -48,6 +49,55 @@ using FieldStatsMap = std::unordered_map<DexField*, FieldStats>;
 
 FieldStatsMap analyze(const Scope& scope);
 
+/*
+ * The field accesses of all the code of a scope: the statistics computed by
+ * `analyze`, and for each field, the methods whose code reads or writes it.
+ *
+ * The index can be brought up to date after the code changed by `update`. The
+ * accesses of each method are recorded along with a fingerprint of its code,
+ * and only the methods whose code changed since are analyzed again.
+ */
+class FieldAccessIndex {
+ public:
+  using FieldMethods =
+      std::unordered_map<const DexField*, std::unordered_set<DexMethod*>>;
+
+  explicit FieldAccessIndex(const Scope& scope) { update(scope); }
+
+  // Analyzes the methods of the scope which are new or whose code changed,
+  // and forgets the methods which are gone. Returns the number of methods
+  // analyzed.
+  size_t update(const Scope& scope);
+
+  // The same as `analyze` returns for the scope of the last update.
+  const FieldStatsMap& get_field_stats() const { return m_field_stats; }
+
+  // The methods whose code reads a field, by field.
+  const FieldMethods& get_readers() const { return m_readers; }
+
+  // The methods whose code writes a field, by field.
+  const FieldMethods& get_writers() const { return m_writers; }
+
+ private:
+  struct MethodAccesses {
+    size_t fingerprint{0};
+    FieldStatsMap field_stats;
+  };
+
+  static size_t fingerprint(const DexMethod* method);
+
+  // Adds or removes the accesses of a method, or of annotations if the method
+  // is null.
+  void add(DexMethod* method, const FieldStatsMap& accesses);
+  void remove(DexMethod* method, const FieldStatsMap& accesses);
+
+  std::unordered_map<DexMethod*, MethodAccesses> m_methods;
+  FieldStatsMap m_annotation_reads;
+  FieldStatsMap m_field_stats;
+  FieldMethods m_readers;
+  FieldMethods m_writers;
+};
+
 struct FieldWrites {
   // All fields to which some potentially non-zero value is written.
   ConcurrentSet<DexField*> non_zero_written_fields;
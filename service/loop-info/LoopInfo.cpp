@@ -222,12 +222,26 @@ Loop* LoopInfo::get_loop_for(cfg::Block* block) {
   return it != m_block_location.end() ? it->second : nullptr;
 }
 
-size_t LoopInfo::num_loops() { return m_loops.size(); }
+const Loop* LoopInfo::get_loop_for(cfg::Block* block) const {
+  auto it = m_block_location.find(block);
+  return it != m_block_location.end() ? it->second : nullptr;
+}
+
+size_t LoopInfo::num_loops() const { return m_loops.size(); }
 
 LoopInfo::iterator LoopInfo::begin() { return m_loops.begin(); }
 
 LoopInfo::iterator LoopInfo::end() { return m_loops.end(); }
 
+LoopInfo::const_iterator LoopInfo::begin() const { return m_loops.begin(); }
+
+LoopInfo::const_iterator LoopInfo::end() const { return m_loops.end(); }
+
 LoopInfo::reverse_iterator LoopInfo::rbegin() { return m_loops.rbegin(); }
 
 LoopInfo::reverse_iterator LoopInfo::rend() { return m_loops.rend(); }
+
+const LoopInfo& loop_impl::get_loop_info(const cfg::ControlFlowGraph& cfg) {
+  return cfg.get_cached_analysis<LoopInfo>(
+      [&]() { return std::make_unique<LoopInfo>(cfg); });
+}
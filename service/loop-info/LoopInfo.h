@@ -129,13 +129,17 @@ class Loop {
 class LoopInfo {
  public:
   using iterator = std::deque<Loop>::iterator;
+  using const_iterator = std::deque<Loop>::const_iterator;
   using reverse_iterator = std::deque<Loop>::reverse_iterator;
   explicit LoopInfo(const cfg::ControlFlowGraph& cfg);
   explicit LoopInfo(cfg::ControlFlowGraph& cfg);
   Loop* get_loop_for(cfg::Block* block);
-  size_t num_loops();
+  const Loop* get_loop_for(cfg::Block* block) const;
+  size_t num_loops() const;
   iterator begin();
   iterator end();
+  const_iterator begin() const;
+  const_iterator end() const;
   reverse_iterator rbegin();
   reverse_iterator rend();
 
@@ -148,4 +152,10 @@ class LoopInfo {
   std::unordered_map<cfg::Block*, Loop*> m_block_location;
 };
 
+/*
+ * The loops of the given cfg, found without inserting preheaders. They are
+ * computed lazily, and cached on the cfg until its structure changes.
+ */
+const LoopInfo& get_loop_info(const cfg::ControlFlowGraph& cfg);
+
 } // namespace loop_impl
@@ -7,13 +7,18 @@
 
 #include "MethodDedup.h"
 
+#include <algorithm>
+#include <boost/functional/hash.hpp>
+
 #include "DedupBlocks.h"
+#include "DexHasher.h"
 #include "DexOpcode.h"
 #include "IRCode.h"
 #include "MethodReference.h"
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -38,42 +43,29 @@ struct CodeAsKey {
   }
 };
 
-struct CodeHasher {
-  size_t operator()(const CodeAsKey& key) const {
-    size_t result = 0;
-    for (auto& mie : cfg::InstructionIterable(
-             const_cast<cfg::ControlFlowGraph&>(key.cfg))) {
-      result ^= mie.insn->hash();
-    }
-    return result;
-  }
-};
-
-using DuplicateMethods =
-    std::unordered_map<CodeAsKey, MethodOrderedSet, CodeHasher>;
-
-std::vector<MethodOrderedSet> get_duplicate_methods_simple(
-    const MethodOrderedSet& methods, bool dedup_fill_in_stack_trace) {
-  DuplicateMethods duplicates;
-  for (DexMethod* method : methods) {
-    always_assert(method->get_code());
-    always_assert(method->get_code()->editable_cfg_built());
-    duplicates[CodeAsKey(method->get_code()->cfg(), dedup_fill_in_stack_trace)]
-        .emplace(method);
-  }
-
-  std::vector<MethodOrderedSet> result;
-  for (auto& duplicate : duplicates) {
-    result.push_back(std::move(duplicate.second));
-  }
-
-  return result;
+size_t code_hash(const DexMethod* method) {
+  always_assert(method->get_code());
+  always_assert(method->get_code()->editable_cfg_built());
+  return hashing::canonical_code_hash(method->get_code()->cfg());
 }
 
 } // namespace
 
 namespace method_dedup {
 
+CodeHashes compute_code_hashes(const std::vector<DexMethod*>& methods) {
+  std::vector<size_t> hashes(methods.size());
+  workqueue_run_for<size_t>(0, methods.size(), [&](size_t i) {
+    hashes[i] = code_hash(methods[i]);
+  });
+  CodeHashes result;
+  result.reserve(methods.size());
+  for (size_t i = 0; i < methods.size(); ++i) {
+    result.emplace(methods[i], hashes[i]);
+  }
+  return result;
+}
+
 std::vector<MethodOrderedSet> group_similar_methods(
     const std::vector<DexMethod*>& methods) {
 
@@ -104,16 +96,51 @@ std::vector<MethodOrderedSet> group_similar_methods(
 }
 
 std::vector<MethodOrderedSet> group_identical_methods(
-    const std::vector<DexMethod*>& methods, bool dedup_fill_in_stack_trace) {
-  std::vector<MethodOrderedSet> result;
-  std::vector<MethodOrderedSet> same_protos = group_similar_methods(methods);
-
-  // Find actual duplicates.
-  for (const auto& same_proto : same_protos) {
-    std::vector<MethodOrderedSet> duplicates =
-        get_duplicate_methods_simple(same_proto, dedup_fill_in_stack_trace);
+    const std::vector<DexMethod*>& methods,
+    bool dedup_fill_in_stack_trace,
+    const CodeHashes* code_hashes) {
+  auto get_code_hash = [code_hashes](const DexMethod* method) {
+    if (code_hashes != nullptr) {
+      auto it = code_hashes->find(method);
+      if (it != code_hashes->end()) {
+        return it->second;
+      }
+    }
+    return code_hash(method);
+  };
+
+  // Bucket by signature and code hash.
+  using BucketKey = std::pair<const DexProto*, size_t>;
+  std::unordered_map<BucketKey, size_t, boost::hash<BucketKey>> bucket_ids;
+  std::vector<std::vector<DexMethod*>> buckets;
+  for (auto* method : methods) {
+    auto [bucket_it, emplaced] = bucket_ids.emplace(
+        BucketKey(method->get_proto(), get_code_hash(method)), buckets.size());
+    if (emplaced) {
+      buckets.emplace_back();
+    }
+    buckets[bucket_it->second].push_back(method);
+  }
 
-    result.insert(result.end(), duplicates.begin(), duplicates.end());
+  // Find actual duplicates, comparing each method to the first method of the
+  // groups of its bucket.
+  std::vector<MethodOrderedSet> result;
+  for (const auto& bucket : buckets) {
+    std::vector<std::pair<CodeAsKey, size_t>> representatives;
+    for (auto* method : bucket) {
+      CodeAsKey key(method->get_code()->cfg(), dedup_fill_in_stack_trace);
+      auto rep_it = std::find_if(representatives.begin(),
+                                 representatives.end(),
+                                 [&](const auto& representative) {
+                                   return representative.first == key;
+                                 });
+      if (rep_it != representatives.end()) {
+        result[rep_it->second].emplace(method);
+      } else {
+        representatives.emplace_back(key, result.size());
+        result.emplace_back(MethodOrderedSet{method});
+      }
+    }
   }
 
   return result;
@@ -141,8 +168,10 @@ size_t dedup_methods_helper(
     return 0;
   }
   size_t dedup_count = 0;
-  auto grouped_methods =
-      group_identical_methods(to_dedup, dedup_fill_in_stack_trace);
+  // Recomputed in every round, as updating the call refs changes the code.
+  auto code_hashes = compute_code_hashes(to_dedup);
+  auto grouped_methods = group_identical_methods(
+      to_dedup, dedup_fill_in_stack_trace, &code_hashes);
   std::unordered_map<DexMethod*, DexMethod*> duplicates_to_replacement;
   for (auto& group : grouped_methods) {
     auto replacement = *group.begin();
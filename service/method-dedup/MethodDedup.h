@@ -9,6 +9,7 @@
 
 #include <boost/optional.hpp>
 #include <set>
+#include <unordered_map>
 
 #include "DexClass.h"
 
@@ -16,6 +17,15 @@ using MethodOrderedSet = std::set<DexMethod*, dexmethods_comparator>;
 
 namespace method_dedup {
 
+// Canonical code hashes (see hashing::canonical_code_hash) by method.
+using CodeHashes = std::unordered_map<const DexMethod*, size_t>;
+
+/**
+ * Computes the canonical code hashes of the given methods, which must have
+ * editable CFGs, in parallel.
+ */
+CodeHashes compute_code_hashes(const std::vector<DexMethod*>&);
+
 /**
  * Group methods that are similar in that they share the same signature and of
  * the same size. It is useful for pre-sorting a method list before a custom
@@ -29,10 +39,15 @@ std::vector<MethodOrderedSet> group_similar_methods(
 /**
  * Group methods that are identical in that they share the same signature and
  * identical code. We ignore non-opcodes like debug info.
+ * Methods are bucketed by their canonical code hash, taken from `code_hashes`
+ * when present there, and only compared within buckets. The groups are in the
+ * order of their first method in the input.
  * Note that there's no side affects other than the grouping here.
  */
 std::vector<MethodOrderedSet> group_identical_methods(
-    const std::vector<DexMethod*>&, bool dedup_fill_in_stack_trace);
+    const std::vector<DexMethod*>&,
+    bool dedup_fill_in_stack_trace,
+    const CodeHashes* code_hashes = nullptr);
 
 /**
  * Check if the given list of methods share the same signature and identical
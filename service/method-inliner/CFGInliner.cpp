@@ -318,10 +318,12 @@ void CFGInliner::steal_contents(ControlFlowGraph* caller,
                                 Block* callsite,
                                 ControlFlowGraph* callee) {
   always_assert(!caller->m_blocks.empty());
-  for (auto& entry : callee->m_blocks) {
+  caller->m_blocks.reserve(caller->m_blocks.next_id() +
+                           callee->m_blocks.size());
+  for (const auto& entry : callee->m_blocks) {
     Block* b = entry.second;
     b->m_parent = caller;
-    size_t id = caller->m_blocks.rbegin()->first + 1;
+    size_t id = caller->m_blocks.next_id();
     b->m_id = id;
     caller->m_blocks.emplace(id, b);
   }
@@ -331,6 +333,8 @@ void CFGInliner::steal_contents(ControlFlowGraph* caller,
   caller->m_edges.reserve(caller->m_edges.size() + callee->m_edges.size());
   caller->m_edges.insert(callee->m_edges.begin(), callee->m_edges.end());
   callee->m_edges.clear();
+  caller->structure_changed();
+  callee->structure_changed();
 }
 
 /*
@@ -554,7 +558,7 @@ void CFGInliner::add_callee_throws_to_caller(
 
 void CFGInliner::set_dbg_pos_parents(ControlFlowGraph* callee,
                                      DexPosition* callsite_dbg_pos) {
-  for (auto& entry : callee->m_blocks) {
+  for (const auto& entry : callee->m_blocks) {
     Block* b = entry.second;
     for (auto& mie : *b) {
       // Don't overwrite existing parent pointers because those are probably
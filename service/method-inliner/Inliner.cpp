@@ -7,6 +7,7 @@
 
 #include "Inliner.h"
 
+#include <boost/functional/hash.hpp>
 #include <cstdint>
 #include <utility>
 
@@ -28,6 +29,7 @@
 #include "Mutators.h"
 #include "OptData.h"
 #include "OutlinedMethods.h"
+#include "PersistentAnalysisCache.h"
 #include "RecursionPruner.h"
 #include "SourceBlocks.h"
 #include "StlUtil.h"
@@ -111,6 +113,93 @@ bool is_finalizable(DexType* type) {
   return false;
 }
 
+// Bump whenever the inlined cost computation or the encoding below changes.
+constexpr uint32_t FULLY_INLINED_COSTS_CACHE_VERSION = 1;
+
+size_t get_cost_config_hash(const InlinerCostConfig& c) {
+  size_t hash = 0;
+  for (float f :
+       {c.cost_invoke, c.cost_move_result, c.unused_args_discount,
+        c.cross_dex_penalty_coe1, c.cross_dex_penalty_coe2,
+        c.cross_dex_penalty_const, c.cross_dex_bonus_const,
+        c.unused_arg_zero_multiplier, c.unused_arg_non_zero_constant_multiplier,
+        c.unused_arg_nez_multiplier, c.unused_arg_interval_multiplier,
+        c.unused_arg_singleton_object_multiplier,
+        c.unused_arg_object_with_immutable_attr_multiplier,
+        c.unused_arg_string_multiplier, c.unused_arg_class_object_multiplier,
+        c.unused_arg_new_object_multiplier,
+        c.unused_arg_other_object_multiplier,
+        c.unused_arg_not_top_multiplier}) {
+    boost::hash_combine(hash, f);
+  }
+  for (size_t v :
+       {c.cost_method, c.reg_threshold_1, c.reg_threshold_2,
+        c.op_init_class_cost, c.op_injection_id_cost, c.op_unreachable_cost,
+        c.op_move_exception_cost, c.insn_cost_1, c.insn_has_data_cost,
+        c.insn_has_lit_cost_1, c.insn_has_lit_cost_2, c.insn_has_lit_cost_3}) {
+    boost::hash_combine(hash, v);
+  }
+  return hash;
+}
+
+// Fixed-size encoding of a fully inlined cost, which never has reduced code.
+PACKED(struct EncodedInlinedCost {
+  uint64_t full_code;
+  float code;
+  float method_refs;
+  float other_refs;
+  float result_used;
+  float unused_args;
+  uint64_t insn_size;
+  uint8_t no_return;
+});
+
+// A rough estimate of the memory held by a cached cost, dominated by the
+// reduced code.
+size_t get_inlined_cost_size(const InlinedCost& cost) {
+  size_t size = sizeof(InlinedCost);
+  if (cost.reduced_code) {
+    auto& cfg = cost.reduced_code->cfg();
+    size += sizeof(ReducedCode) +
+            cfg.num_opcodes() *
+                (sizeof(IRInstruction) + sizeof(MethodItemEntry)) +
+            cfg.num_blocks() * sizeof(cfg::Block) +
+            cfg.num_edges() * sizeof(cfg::Edge);
+  }
+  return size;
+}
+
+std::string encode_inlined_cost(const InlinedCost& cost) {
+  always_assert(!cost.reduced_code);
+  EncodedInlinedCost e;
+  e.full_code = cost.full_code;
+  e.code = cost.code;
+  e.method_refs = cost.method_refs;
+  e.other_refs = cost.other_refs;
+  e.result_used = cost.result_used;
+  e.unused_args = cost.unused_args;
+  e.insn_size = cost.insn_size;
+  e.no_return = cost.no_return;
+  return std::string((const char*)&e, sizeof(e));
+}
+
+boost::optional<InlinedCost> decode_inlined_cost(const std::string& str) {
+  if (str.size() != sizeof(EncodedInlinedCost)) {
+    return boost::none;
+  }
+  EncodedInlinedCost e;
+  memcpy(&e, str.data(), sizeof(e));
+  return InlinedCost{e.full_code,
+                     e.code,
+                     e.method_refs,
+                     e.other_refs,
+                     e.no_return != 0,
+                     e.result_used,
+                     e.unused_args,
+                     /* reduced_code */ nullptr,
+                     e.insn_size};
+}
+
 } // namespace
 
 MultiMethodInliner::MultiMethodInliner(
@@ -134,8 +223,16 @@ MultiMethodInliner::MultiMethodInliner(
     bool local_only,
     bool consider_hot_cold,
     InlinerCostConfig inliner_cost_config,
-    const std::unordered_set<const DexMethod*>* unfinalized_init_methods)
+    const std::unordered_set<const DexMethod*>* unfinalized_init_methods,
+    analysis_cache::PersistentAnalysisCache* analysis_cache)
     : m_concurrent_resolver(std::move(concurrent_resolve_fn)),
+      // The fully inlined costs are small, the reduced code of call-site
+      // specific costs dominates.
+      m_fully_inlined_costs(config.inlined_costs_cache_mb * (1 << 20) / 8,
+                            get_inlined_cost_size),
+      m_call_site_inlined_costs(config.inlined_costs_cache_mb * (1 << 20) / 8 *
+                                    7,
+                                get_inlined_cost_size),
       m_scheduler(
           [this](DexMethod* method) {
             auto it = caller_callee.find(method);
@@ -175,6 +272,12 @@ MultiMethodInliner::MultiMethodInliner(
       m_inliner_cost_config(inliner_cost_config),
       m_unfinalized_init_methods(unfinalized_init_methods) {
   Timer t("MultiMethodInliner construction");
+  if (analysis_cache != nullptr) {
+    m_fully_inlined_costs_cache = &analysis_cache->get_table(
+        "inliner_fully_inlined_costs", FULLY_INLINED_COSTS_CACHE_VERSION);
+    m_fully_inlined_costs_cache_salt =
+        get_cost_config_hash(m_inliner_cost_config);
+  }
   for (const auto& callee_callers : true_virtual_callers) {
     auto callee = callee_callers.first;
     if (callee_callers.second.other_call_sites) {
@@ -330,6 +433,15 @@ void MultiMethodInliner::inline_methods() {
   // inlining from there. First, we just gather data on
   // caller/non-recursive-callees pairs for each stack depth.
   {
+    if (for_speed()) {
+      std::vector<std::pair<const DexMethod*, const DexMethod*>> candidates;
+      for (auto&& [caller, callees] : caller_callee) {
+        for (auto&& [callee, _] : callees) {
+          candidates.emplace_back(caller, callee);
+        }
+      }
+      m_inline_for_speed->prepare_candidates(candidates);
+    }
     auto exclude_fn = [this](DexMethod* caller, DexMethod* callee) {
       return for_speed() &&
              !m_inline_for_speed->should_inline_generic(caller, callee);
@@ -389,6 +501,10 @@ void MultiMethodInliner::inline_methods() {
     }
   }
 
+  if (m_config.schedule_by_cost) {
+    set_scheduler_weights(methods_to_schedule);
+  }
+
   info.critical_path_length =
       m_scheduler.run(methods_to_schedule.begin(), methods_to_schedule.end());
 
@@ -396,6 +512,33 @@ void MultiMethodInliner::inline_methods() {
   info.waited_seconds = m_scheduler.get_thread_pool().get_waited_seconds();
 }
 
+void MultiMethodInliner::set_scheduler_weights(
+    const std::unordered_set<DexMethod*>& methods) {
+  // Estimate the work for each method by its size, which is what the shrinker
+  // works on, plus the size of the code that will get inlined into it.
+  auto sizes = std::make_shared<
+      InsertOnlyConcurrentMap<const DexMethod*, uint32_t>>();
+  workqueue_run<DexMethod*>(
+      [&](DexMethod* method) {
+        sizes->emplace(method,
+                       method->get_code()->cfg().estimate_code_units());
+      },
+      methods);
+  m_scheduler.set_weight_fn([this, sizes](DexMethod* method) -> uint32_t {
+    auto* own_size = sizes->get(method);
+    uint64_t weight = 1 + (own_size ? *own_size : 0);
+    auto it = caller_callee.find(method);
+    if (it != caller_callee.end()) {
+      for (auto& [callee, count] : it->second) {
+        auto* size = sizes->get(callee);
+        weight += (uint64_t)count * (size ? *size : 0);
+      }
+    }
+    return (uint32_t)std::min<uint64_t>(weight,
+                                        std::numeric_limits<uint32_t>::max());
+  });
+}
+
 DexMethod* MultiMethodInliner::get_callee(DexMethod* caller,
                                           IRInstruction* insn) {
   if (!opcode::is_an_invoke(insn->opcode())) {
@@ -597,6 +740,31 @@ std::string create_inlining_trace_msg(const DexMethod* caller,
   return oss.str();
 }
 
+// Whether inlining just removes the invoke: the callee is an empty static
+// method without arguments, so no argument computations become dead, and the
+// shrinker has nothing to gain from the inlining.
+bool is_trivial_inlinable(const Inlinable& inlinable) {
+  auto* callee = inlinable.callee;
+  if (inlinable.no_return || !is_static(callee) ||
+      !callee->get_proto()->get_args()->empty()) {
+    return false;
+  }
+  const cfg::ControlFlowGraph* cfg;
+  if (inlinable.reduced_code) {
+    cfg = &inlinable.reduced_code->cfg();
+  } else if (callee->get_code()->editable_cfg_built()) {
+    cfg = &callee->get_code()->cfg();
+  } else {
+    return false;
+  }
+  for (const auto& mie : InstructionIterable(*cfg)) {
+    if (mie.insn->opcode() != OPCODE_RETURN_VOID) {
+      return false;
+    }
+  }
+  return true;
+}
+
 } // namespace
 
 DexType* MultiMethodInliner::get_needs_init_class(DexMethod* callee) const {
@@ -645,6 +813,13 @@ size_t MultiMethodInliner::inline_inlinables(
   std::vector<Inlinable> ordered_inlinables(inlinables.begin(),
                                             inlinables.end());
 
+  // If the caller is already shrunk and we only inline trivial callees, it
+  // stays shrunk, and postprocessing doesn't need to shrink it again.
+  bool stays_shrunk = !inlinables.empty() &&
+                      std::all_of(inlinables.begin(), inlinables.end(),
+                                  is_trivial_inlinable) &&
+                      m_shrinker.is_shrunk(caller_method);
+
   bool consider_not_cold =
       m_consider_hot_cold && m_not_cold_methods.count_unsafe(caller_method);
   std::stable_sort(
@@ -908,6 +1083,10 @@ size_t MultiMethodInliner::inline_inlinables(
       }
     }
     m_inlined.insert(inlined_callees.begin(), inlined_callees.end());
+    if (stays_shrunk && intermediate_shrinkings == 0) {
+      m_shrinker.mark_shrunk(caller_method);
+      info.trivially_inlined_callers++;
+    }
   }
 
   info.calls_inlined += inlined_callees.size();
@@ -991,9 +1170,11 @@ void MultiMethodInliner::compute_callee_costs(DexMethod* method) {
         }
         if (!keep_reduced_code) {
           CalleeCallSiteSummary key{method, call_site_summary};
-          const auto* cached = m_call_site_inlined_costs.get(key);
+          // If this entry gets evicted and recomputed, it will hold on to
+          // reduced code again, which is wasteful but harmless.
+          auto cached = m_call_site_inlined_costs.get(key);
           if (cached) {
-            const_cast<InlinedCost*>(cached)->reduced_code.reset();
+            cached->reduced_code.reset();
           }
         }
       });
@@ -1540,48 +1721,56 @@ float MultiMethodInliner::get_unused_arg_multiplier(
   return m_inliner_cost_config.unused_arg_not_top_multiplier;
 }
 
-const InlinedCost* MultiMethodInliner::get_fully_inlined_cost(
-    const DexMethod* callee) {
-  return m_fully_inlined_costs
-      .get_or_create_and_assert_equal(
-          callee,
-          [&](const auto&) {
-            InlinedCost inlined_cost(
-                get_inlined_cost(is_static(callee), callee->get_class(),
-                                 callee->get_proto(), callee->get_code()));
-            TRACE(INLINE, 4,
-                  "get_fully_inlined_cost(%s) = {%zu,%f,%f,%f,%s,%f,%d,%zu}",
-                  SHOW(callee), inlined_cost.full_code, inlined_cost.code,
-                  inlined_cost.method_refs, inlined_cost.other_refs,
-                  inlined_cost.no_return ? "no_return" : "return",
-                  inlined_cost.result_used, !!inlined_cost.reduced_code,
-                  inlined_cost.insn_size);
-            return inlined_cost;
-          })
-      .first;
+std::shared_ptr<const InlinedCost>
+MultiMethodInliner::get_fully_inlined_cost(const DexMethod* callee) {
+  return m_fully_inlined_costs.get_or_create(callee, [&](const auto&) {
+    uint64_t cache_key{0};
+    if (m_fully_inlined_costs_cache != nullptr) {
+      // Note that the method hash covers the code and all referenced
+      // members, but not whether referenced types are external; that
+      // only changes with the set of input libraries.
+      cache_key = analysis_cache::get_method_key(
+          callee, m_fully_inlined_costs_cache_salt);
+      if (auto cached = m_fully_inlined_costs_cache->get(cache_key)) {
+        if (auto decoded = decode_inlined_cost(*cached)) {
+          return *decoded;
+        }
+      }
+    }
+    InlinedCost inlined_cost(get_inlined_cost(is_static(callee),
+                                              callee->get_class(),
+                                              callee->get_proto(),
+                                              callee->get_code()));
+    if (m_fully_inlined_costs_cache != nullptr) {
+      m_fully_inlined_costs_cache->put(cache_key,
+                                       encode_inlined_cost(inlined_cost));
+    }
+    TRACE(INLINE, 4,
+          "get_fully_inlined_cost(%s) = {%zu,%f,%f,%f,%s,%f,%d,%zu}",
+          SHOW(callee), inlined_cost.full_code, inlined_cost.code,
+          inlined_cost.method_refs, inlined_cost.other_refs,
+          inlined_cost.no_return ? "no_return" : "return",
+          inlined_cost.result_used, !!inlined_cost.reduced_code,
+          inlined_cost.insn_size);
+    return inlined_cost;
+  });
 }
 
-const InlinedCost* MultiMethodInliner::get_call_site_inlined_cost(
-    const IRInstruction* invoke_insn, const DexMethod* callee) {
-  return *m_invoke_call_site_inlined_costs
-              .get_or_create_and_assert_equal(
-                  invoke_insn,
-                  [&](const auto&) {
-                    auto call_site_summary =
-                        m_call_site_summarizer
-                            ? m_call_site_summarizer
-                                  ->get_instruction_call_site_summary(
-                                      invoke_insn)
-                            : nullptr;
-                    return call_site_summary == nullptr
-                               ? nullptr
-                               : get_call_site_inlined_cost(call_site_summary,
-                                                            callee);
-                  })
-              .first;
+std::shared_ptr<const InlinedCost>
+MultiMethodInliner::get_call_site_inlined_cost(const IRInstruction* invoke_insn,
+                                               const DexMethod* callee) {
+  auto call_site_summary =
+      m_call_site_summarizer
+          ? m_call_site_summarizer->get_instruction_call_site_summary(
+                invoke_insn)
+          : nullptr;
+  return call_site_summary == nullptr
+             ? nullptr
+             : get_call_site_inlined_cost(call_site_summary, callee);
 }
 
-const InlinedCost* MultiMethodInliner::get_call_site_inlined_cost(
+std::shared_ptr<const InlinedCost>
+MultiMethodInliner::get_call_site_inlined_cost(
     const CallSiteSummary* call_site_summary, const DexMethod* callee) {
   auto fully_inlined_cost = get_fully_inlined_cost(callee);
   always_assert(fully_inlined_cost);
@@ -1591,28 +1780,23 @@ const InlinedCost* MultiMethodInliner::get_call_site_inlined_cost(
   }
 
   CalleeCallSiteSummary key{callee, call_site_summary};
-  return m_call_site_inlined_costs
-      .get_or_create_and_assert_equal(
-          key,
-          [&](const auto&) {
-            auto inlined_cost = get_inlined_cost(
-                is_static(callee), callee->get_class(), callee->get_proto(),
-                callee->get_code(), call_site_summary);
-            TRACE(
-                INLINE, 4,
-                "get_call_site_inlined_cost(%s) = {%zu,%f,%f,%f,%s,%f,%d,%zu}",
-                call_site_summary->get_key().c_str(), inlined_cost.full_code,
-                inlined_cost.code, inlined_cost.method_refs,
-                inlined_cost.other_refs,
-                inlined_cost.no_return ? "no_return" : "return",
-                inlined_cost.result_used, !!inlined_cost.reduced_code,
-                inlined_cost.insn_size);
-            if (inlined_cost.insn_size >= fully_inlined_cost->insn_size) {
-              inlined_cost.reduced_code.reset();
-            }
-            return inlined_cost;
-          })
-      .first;
+  return m_call_site_inlined_costs.get_or_create(key, [&](const auto&) {
+    auto inlined_cost =
+        get_inlined_cost(is_static(callee), callee->get_class(),
+                         callee->get_proto(), callee->get_code(),
+                         call_site_summary);
+    TRACE(INLINE, 4,
+          "get_call_site_inlined_cost(%s) = {%zu,%f,%f,%f,%s,%f,%d,%zu}",
+          call_site_summary->get_key().c_str(), inlined_cost.full_code,
+          inlined_cost.code, inlined_cost.method_refs, inlined_cost.other_refs,
+          inlined_cost.no_return ? "no_return" : "return",
+          inlined_cost.result_used, !!inlined_cost.reduced_code,
+          inlined_cost.insn_size);
+    if (inlined_cost.insn_size >= fully_inlined_cost->insn_size) {
+      inlined_cost.reduced_code.reset();
+    }
+    return inlined_cost;
+  });
 }
 
 const InlinedCost* MultiMethodInliner::get_average_inlined_cost(
@@ -1896,7 +2080,8 @@ bool MultiMethodInliner::should_inline_at_call_site(
     // Inlining methods into different classes might lead to worse
     // cross-dex-ref minimization results.
     cross_dex_penalty =
-        estimate_cross_dex_penalty(inlined_cost, m_inliner_cost_config, true);
+        estimate_cross_dex_penalty(inlined_cost.get(), m_inliner_cost_config,
+                                   /* use_other_refs */ true);
   }
 
   float invoke_cost =
@@ -18,6 +18,11 @@
 
 class InlineForSpeed;
 
+namespace analysis_cache {
+class PersistentAnalysisCache;
+class Table;
+} // namespace analysis_cache
+
 namespace inliner {
 
 struct InlinerConfig;
@@ -255,7 +260,8 @@ class MultiMethodInliner {
       bool consider_hot_cold = false,
       InlinerCostConfig inliner_cost_config = DEFAULT_COST_CONFIG,
       const std::unordered_set<const DexMethod*>* unfinalized_init_methods =
-          nullptr);
+          nullptr,
+      analysis_cache::PersistentAnalysisCache* analysis_cache = nullptr);
 
   /*
    * Applies certain delayed scope-wide changes, including in particular
@@ -529,7 +535,8 @@ class MultiMethodInliner {
    * Estimate inlined cost for fully inlining a callee without using any
    * summaries for pruning.
    */
-  const InlinedCost* get_fully_inlined_cost(const DexMethod* callee);
+  std::shared_ptr<const InlinedCost> get_fully_inlined_cost(
+      const DexMethod* callee);
 
   /**
    * Estimate average inlined cost when inlining a callee, considering all
@@ -540,13 +547,13 @@ class MultiMethodInliner {
   /**
    * Estimate inlined cost for a particular call-site, if available.
    */
-  const InlinedCost* get_call_site_inlined_cost(
+  std::shared_ptr<const InlinedCost> get_call_site_inlined_cost(
       const IRInstruction* invoke_insn, const DexMethod* callee);
 
   /**
    * Estimate inlined cost for a particular call-site summary, if available.
    */
-  const InlinedCost* get_call_site_inlined_cost(
+  std::shared_ptr<const InlinedCost> get_call_site_inlined_cost(
       const CallSiteSummary* call_site_summary, const DexMethod* callee);
 
   /**
@@ -571,6 +578,10 @@ class MultiMethodInliner {
    */
   void postprocess_method(DexMethod* method);
 
+  // Lets the scheduler prioritize methods by the estimated work along the
+  // longest chain of callers waiting for them.
+  void set_scheduler_weights(const std::unordered_set<DexMethod*>& methods);
+
   /**
    * Shrink a method (run constant-prop, cse, copy-prop, local-dce,
    * dedup-blocks) synchronously.
@@ -636,24 +647,26 @@ class MultiMethodInliner {
   std::unordered_set<const DexMethod*> m_x_dex_callees;
 
   // Cache of the inlined costs of fully inlining a calle without using any
-  // summaries for pruning.
-  mutable InsertOnlyConcurrentMap<const DexMethod*, InlinedCost>
-      m_fully_inlined_costs;
+  // summaries for pruning. (Evicted costs are simply recomputed: callees don't
+  // change any more once their costs are queried.)
+  ConcurrentClockCache<const DexMethod*, InlinedCost> m_fully_inlined_costs;
+
+  // Optional persistent cache of fully inlined costs across Redex runs, keyed
+  // by the callee's content hash and the cost configuration.
+  analysis_cache::Table* m_fully_inlined_costs_cache{nullptr};
+  uint64_t m_fully_inlined_costs_cache_salt{0};
 
   // Cache of the average inlined costs of each method.
   mutable InsertOnlyConcurrentMap<const DexMethod*, InlinedCost>
       m_average_inlined_costs;
 
-  // Cache of the inlined costs of each call-site summary after pruning.
-  mutable InsertOnlyConcurrentMap<CalleeCallSiteSummary,
-                                  InlinedCost,
-                                  boost::hash<CalleeCallSiteSummary>>
+  // Cache of the inlined costs of each call-site summary after pruning. This
+  // is where the reduced code lives, which makes it the largest cache.
+  ConcurrentClockCache<CalleeCallSiteSummary,
+                       InlinedCost,
+                       boost::hash<CalleeCallSiteSummary>>
       m_call_site_inlined_costs;
 
-  // Cache of the inlined costs of each call-site after pruning.
-  mutable InsertOnlyConcurrentMap<const IRInstruction*, const InlinedCost*>
-      m_invoke_call_site_inlined_costs;
-
   // Priority thread pool to handle parallel processing of methods, either
   // shrinking initially / after inlining into them, or even to inline in
   // parallel. By default, parallelism is disabled num_threads = 0).
@@ -718,6 +731,7 @@ class MultiMethodInliner {
     std::atomic<size_t> no_returns{0};
     std::atomic<size_t> unreachable_insns{0};
     std::atomic<size_t> intermediate_shrinkings{0};
+    std::atomic<size_t> trivially_inlined_callers{0};
     std::atomic<size_t> intermediate_remove_unreachable_blocks{0};
     std::atomic<size_t> not_found{0};
     std::atomic<size_t> blocklisted{0};
@@ -787,6 +801,18 @@ class MultiMethodInliner {
 
   size_t get_x_dex_callees() { return m_x_dex_callees.size(); }
 
+  const ConcurrentClockCache<const DexMethod*, InlinedCost>&
+  get_fully_inlined_costs() const {
+    return m_fully_inlined_costs;
+  }
+
+  const ConcurrentClockCache<CalleeCallSiteSummary,
+                             InlinedCost,
+                             boost::hash<CalleeCallSiteSummary>>&
+  get_call_site_inlined_costs() const {
+    return m_call_site_inlined_costs;
+  }
+
   double get_call_site_inlined_cost_seconds() const {
     return m_call_site_inlined_cost_timer.get_seconds();
   }
@@ -786,7 +786,8 @@ void run_inliner(
     bool intra_dex /* false */,
     InlineForSpeed* inline_for_speed /* nullptr */,
     bool inline_bridge_synth_only /* false */,
-    bool local_only /* false */) {
+    bool local_only /* false */,
+    std::shared_ptr<cse_impl::SharedState> cse_shared_state /* nullptr */) {
   always_assert_log(
       !mgr.init_class_lowering_has_run(),
       "Implementation limitation: The inliner could introduce new "
@@ -926,7 +927,15 @@ void run_inliner(
       analyze_and_prune_inits, conf.get_pure_methods(), min_sdk_api,
       cross_dex_penalty,
       /* configured_finalish_field_names */ {}, local_only, consider_hot_cold,
-      inliner_cost_config, &unfinalized_init_methods);
+      inliner_cost_config, &unfinalized_init_methods,
+      conf.get_analysis_cache());
+  if (inliner_config.cache_shrunk_methods) {
+    inliner.get_shrinker().enable_shrunk_methods_cache(
+        conf.get_run_analysis_cache());
+  }
+  if (cse_shared_state) {
+    inliner.get_shrinker().set_cse_shared_state(std::move(cse_shared_state));
+  }
   inliner.inline_methods();
 
   // refinalize where possible
@@ -1072,6 +1081,18 @@ void run_inliner(
   mgr.incr_metric("critical_path_length",
                   inliner.get_info().critical_path_length);
   mgr.incr_metric("methods_shrunk", shrinker.get_methods_shrunk());
+  mgr.incr_metric("methods_shrink_skipped",
+                  shrinker.get_methods_shrink_skipped());
+  mgr.incr_metric("trivially_inlined_callers",
+                  inliner.get_info().trivially_inlined_callers);
+  auto log_cache_metrics = [&](const std::string& name, const auto& cache) {
+    mgr.incr_metric(name + "_cache_hits", cache.hits());
+    mgr.incr_metric(name + "_cache_misses", cache.misses());
+    mgr.incr_metric(name + "_cache_evictions", cache.evictions());
+  };
+  log_cache_metrics("fully_inlined_costs", inliner.get_fully_inlined_costs());
+  log_cache_metrics("call_site_inlined_costs",
+                    inliner.get_call_site_inlined_costs());
   mgr.incr_metric("callers", inliner.get_callers());
   if (intra_dex) {
     mgr.incr_metric("x-dex-callees", inliner.get_x_dex_callees());
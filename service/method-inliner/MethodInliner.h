@@ -25,5 +25,7 @@ void run_inliner(DexStoresVector& stores,
                  bool intra_dex = false,
                  InlineForSpeed* inline_for_speed = nullptr,
                  bool inline_bridge_synth_only = false,
-                 bool local_only = false);
+                 bool local_only = false,
+                 std::shared_ptr<cse_impl::SharedState> cse_shared_state =
+                     nullptr);
 } // namespace inliner
@@ -198,49 +198,196 @@ void update_vmethods_group_one_type_ref(const VMethodGroup& group,
     method->change(spec, false /* rename on collision */);
   }
 }
-} // namespace
 
-namespace type_reference {
+void update_method_signatures(
+    const Scope& scope,
+    const std::unordered_map<const DexType*, DexType*>& old_to_new,
+    const ClassHierarchy& ch,
+    boost::optional<std::unordered_map<DexMethod*, std::string>&>
+        method_debug_map) {
+  // Virtual methods.
+  // The key is the hash of signature and an old type reference. Group the
+  // methods by key.
+  VMethodsGroups vmethods_groups;
+  // Colliding direct methods.
+  std::vector<std::pair<DexMethod*, DexProto*>> colliding_directs;
 
-void TypeRefUpdater::update_methods_fields(const Scope& scope) {
-  // Change specs of all the other methods and fields if their specs contain
-  // any candidate types.
-  walk::parallel::methods(scope, [this](DexMethod* method) {
-    if (mangling(method)) {
-      always_assert_log(
-          can_rename(method), "Method %s can not be renamed\n", SHOW(method));
+  // Callback for updating method debug map.
+  std::function<void(DexMethod*)> update_method_debug_map = [](DexMethod*) {};
+  if (method_debug_map != boost::none) {
+    update_method_debug_map = [&method_debug_map](DexMethod* method) {
+      method_debug_map.get()[method] =
+          type_reference::get_method_signature(method);
+    };
+  }
+
+  UnorderedTypeSet old_types;
+  for (auto& pair : old_to_new) {
+    old_types.insert(pair.first);
+  }
+
+  // Finding the affected methods and making their new protos does not depend
+  // on the order in which methods get updated, so it happens in parallel.
+  // Only the updates themselves, which check for collisions with the methods
+  // updated so far, run sequentially.
+  InsertOnlyConcurrentMap<DexMethod*, DexProto*> new_protos;
+  walk::parallel::methods(scope, [&](DexMethod* method) {
+    auto proto = method->get_proto();
+    if (type_reference::proto_has_reference_to(proto, old_types)) {
+      new_protos.emplace(method,
+                         type_reference::get_new_proto(proto, old_to_new));
     }
   });
-  walk::parallel::fields(scope, [this](DexField* field) {
-    if (mangling(field)) {
-      always_assert_log(
-          can_rename(field), "Field %s can not be renamed\n", SHOW(field));
+
+  walk::methods(scope, [&](DexMethod* method) {
+    auto* new_proto_ptr = new_protos.get(method);
+    if (new_proto_ptr == nullptr) {
+      return;
+    }
+    update_method_debug_map(method);
+    if (!method->is_virtual()) {
+      auto new_proto = *new_proto_ptr;
+      /// A. For direct methods:
+      // If there is no collision, update spec directly.
+      // If it's not constructor and renamable, rename on collision.
+      // Otherwise, add it to colliding_directs.
+      auto collision = DexMethod::get_method(
+          method->get_class(), method->get_name(), new_proto);
+      if (!collision || (!method::is_init(method) && can_rename(method))) {
+        TRACE(REFU, 8, "sig: updating direct method %s", SHOW(method));
+        DexMethodSpec spec;
+        spec.proto = new_proto;
+        method->change(spec, true /* rename on collision */);
+      } else {
+        colliding_directs.emplace_back(std::make_pair(method, new_proto));
+      }
+      return;
     }
+    // B. For virtual methods: Collect the methods that reference the old
+    // types to oldtype_to_vmethods. Calculate new proto for each method and
+    // store to method_to_new_proto.
+    add_vmethod_to_groups(old_to_new, method, &vmethods_groups);
   });
-  // Update all the method refs and field refs.
-  ConcurrentSet<DexMethodRef*> methods;
-  ConcurrentSet<DexFieldRef*> fields;
-  walk::parallel::code(scope, [&](DexMethod* method, IRCode& code) {
+
+  // Solve updating collision for direct methods by appending primitive
+  // arguments.
+  type_reference::fix_colliding_dmethods(scope, colliding_directs);
+
+  // Update virtual methods group by group.
+  for (auto& key_and_group : vmethods_groups) {
+    auto& group = key_and_group.second;
+    update_vmethods_group_one_type_ref(group, ch);
+  }
+}
+
+void update_field_types(
+    const Scope& scope,
+    const std::unordered_map<const DexType*, DexType*>& old_to_new) {
+  TRACE(REFU, 4, " updating field refs");
+  const auto update_field = [&](DexFieldRef* field) {
+    const auto ref_type = field->get_type();
+    const auto type = type::get_element_type_if_array(ref_type);
+    if (old_to_new.count(type) == 0) {
+      return;
+    }
+    DexFieldSpec spec;
+    auto new_type = old_to_new.at(type);
+    auto level = type::get_array_level(ref_type);
+    auto new_type_incl_array = type::make_array_type(new_type, level);
+    spec.type = new_type_incl_array;
+    field->change(spec);
+    TRACE(REFU, 9, " updating field ref to %s", SHOW(type));
+  };
+  walk::parallel::fields(scope, update_field);
+}
+
+// Ensure that no method or field references are left that still refer to old
+// types, with one walk over the code for both kinds of references.
+void check_no_old_type_references(
+    const Scope& scope,
+    const std::unordered_map<const DexType*, DexType*>& old_to_new,
+    bool check_methods,
+    bool check_fields) {
+  UnorderedTypeSet old_types;
+  for (auto& pair : old_to_new) {
+    old_types.insert(pair.first);
+  }
+  auto check = [&](const IRInstruction* insn) {
+    if (check_methods && insn->has_method()) {
+      auto proto = insn->get_method()->get_proto();
+      always_assert_log(
+          !type_reference::proto_has_reference_to(proto, old_types),
+          "Find old type in method reference %s, please make sure that "
+          "ReBindRefsPass is enabled before the crashed pass.\n",
+          SHOW(insn));
+    } else if (check_fields && insn->has_field()) {
+      const auto ref_type = insn->get_field()->get_type();
+      const auto type = type::get_element_type_if_array(ref_type);
+      always_assert_log(
+          old_types.count(type) == 0,
+          "Find old type in field reference %s, please make sure that "
+          "ReBindRefsPass is enabled before ClassMergingPass\n",
+          SHOW(insn));
+    }
+  };
+  walk::parallel::code(scope, [&](DexMethod*, IRCode& code) {
     if (code.editable_cfg_built()) {
       for (auto& mie : InstructionIterable(code.cfg())) {
-        auto insn = mie.insn;
-        if (insn->has_field()) {
-          fields.insert(insn->get_field());
-        } else if (insn->has_method()) {
-          methods.insert(insn->get_method());
-        }
+        check(mie.insn);
       }
     } else {
       for (auto& mie : InstructionIterable(code)) {
-        auto insn = mie.insn;
-        if (insn->has_field()) {
-          fields.insert(insn->get_field());
-        } else if (insn->has_method()) {
-          methods.insert(insn->get_method());
+        check(mie.insn);
+      }
+    }
+  });
+}
+} // namespace
+
+namespace type_reference {
+
+void TypeRefUpdater::update_methods_fields(const Scope& scope) {
+  // Change specs of all the other methods and fields if their specs contain
+  // any candidate types, and collect the method refs and field refs of their
+  // code, all in one walk.
+  ConcurrentSet<DexMethodRef*> methods;
+  ConcurrentSet<DexFieldRef*> fields;
+  auto collect_refs = [&](const IRInstruction* insn) {
+    if (insn->has_field()) {
+      fields.insert(insn->get_field());
+    } else if (insn->has_method()) {
+      methods.insert(insn->get_method());
+    }
+  };
+  walk::parallel::classes(scope, [&](DexClass* cls) {
+    for (auto* method : cls->get_all_methods()) {
+      if (mangling(method)) {
+        always_assert_log(
+            can_rename(method), "Method %s can not be renamed\n", SHOW(method));
+      }
+      auto* code = method->get_code();
+      if (code == nullptr) {
+        continue;
+      }
+      if (code->editable_cfg_built()) {
+        for (auto& mie : InstructionIterable(code->cfg())) {
+          collect_refs(mie.insn);
         }
+      } else {
+        for (auto& mie : InstructionIterable(*code)) {
+          collect_refs(mie.insn);
+        }
+      }
+    }
+    for (auto* field : cls->get_all_fields()) {
+      if (mangling(field)) {
+        always_assert_log(
+            can_rename(field), "Field %s can not be renamed\n", SHOW(field));
       }
     }
   });
+  // Update all the method refs and field refs. Definitions among them were
+  // already updated above, and are left alone.
   workqueue_run<DexFieldRef*>([this](DexFieldRef* field) { mangling(field); },
                               fields);
   workqueue_run<DexMethodRef*>(
@@ -436,147 +583,29 @@ void update_method_signature_type_references(
     const ClassHierarchy& ch,
     boost::optional<std::unordered_map<DexMethod*, std::string>&>
         method_debug_map) {
-  // Virtual methods.
-  // The key is the hash of signature and an old type reference. Group the
-  // methods by key.
-  VMethodsGroups vmethods_groups;
-  // Colliding direct methods.
-  std::vector<std::pair<DexMethod*, DexProto*>> colliding_directs;
-
-  // Callback for updating method debug map.
-  std::function<void(DexMethod*)> update_method_debug_map = [](DexMethod*) {};
-  if (method_debug_map != boost::none) {
-    update_method_debug_map = [&method_debug_map](DexMethod* method) {
-      method_debug_map.get()[method] = get_method_signature(method);
-    };
-  }
-
-  UnorderedTypeSet old_types;
-  for (auto& pair : old_to_new) {
-    old_types.insert(pair.first);
-  }
-
-  walk::methods(scope, [&](DexMethod* method) {
-    auto proto = method->get_proto();
-    if (!proto_has_reference_to(proto, old_types)) {
-      return;
-    }
-    update_method_debug_map(method);
-    if (!method->is_virtual()) {
-      auto new_proto = get_new_proto(proto, old_to_new);
-      /// A. For direct methods:
-      // If there is no collision, update spec directly.
-      // If it's not constructor and renamable, rename on collision.
-      // Otherwise, add it to colliding_directs.
-      auto collision = DexMethod::get_method(
-          method->get_class(), method->get_name(), new_proto);
-      if (!collision || (!method::is_init(method) && can_rename(method))) {
-        TRACE(REFU, 8, "sig: updating direct method %s", SHOW(method));
-        DexMethodSpec spec;
-        spec.proto = new_proto;
-        method->change(spec, true /* rename on collision */);
-      } else {
-        colliding_directs.emplace_back(std::make_pair(method, new_proto));
-      }
-      return;
-    }
-    // B. For virtual methods: Collect the methods that reference the old
-    // types to oldtype_to_vmethods. Calculate new proto for each method and
-    // store to method_to_new_proto.
-    add_vmethod_to_groups(old_to_new, method, &vmethods_groups);
-  });
-
-  // Solve updating collision for direct methods by appending primitive
-  // arguments.
-  fix_colliding_dmethods(scope, colliding_directs);
-
-  // Update virtual methods group by group.
-  for (auto& key_and_group : vmethods_groups) {
-    auto& group = key_and_group.second;
-    update_vmethods_group_one_type_ref(group, ch);
-  }
-
-  // Ensure that no method references left that still refer old types.
-  walk::parallel::code(scope, [&old_types](DexMethod*, IRCode& code) {
-    if (code.editable_cfg_built()) {
-      auto& cfg = code.cfg();
-      for (auto& mie : InstructionIterable(cfg)) {
-        auto insn = mie.insn;
-        if (insn->has_method()) {
-          auto proto = insn->get_method()->get_proto();
-          always_assert_log(
-              !proto_has_reference_to(proto, old_types),
-              "Find old type in method reference %s, please make sure that "
-              "ReBindRefsPass is enabled before the crashed pass.\n",
-              SHOW(insn));
-        }
-      }
-    } else {
-      for (auto& mie : InstructionIterable(code)) {
-        auto insn = mie.insn;
-        if (insn->has_method()) {
-          auto proto = insn->get_method()->get_proto();
-          always_assert_log(
-              !proto_has_reference_to(proto, old_types),
-              "Find old type in method reference %s, please make sure that "
-              "ReBindRefsPass is enabled before the crashed pass.\n",
-              SHOW(insn));
-        }
-      }
-    }
-  });
+  update_method_signatures(scope, old_to_new, ch, method_debug_map);
+  check_no_old_type_references(scope, old_to_new, /* check_methods */ true,
+                               /* check_fields */ false);
 }
 
 void update_field_type_references(
     const Scope& scope,
     const std::unordered_map<const DexType*, DexType*>& old_to_new) {
-  TRACE(REFU, 4, " updating field refs");
-  const auto update_field = [&](DexFieldRef* field) {
-    const auto ref_type = field->get_type();
-    const auto type = type::get_element_type_if_array(ref_type);
-    if (old_to_new.count(type) == 0) {
-      return;
-    }
-    DexFieldSpec spec;
-    auto new_type = old_to_new.at(type);
-    auto level = type::get_array_level(ref_type);
-    auto new_type_incl_array = type::make_array_type(new_type, level);
-    spec.type = new_type_incl_array;
-    field->change(spec);
-    TRACE(REFU, 9, " updating field ref to %s", SHOW(type));
-  };
-  walk::parallel::fields(scope, update_field);
+  update_field_types(scope, old_to_new);
+  check_no_old_type_references(scope, old_to_new, /* check_methods */ false,
+                               /* check_fields */ true);
+}
 
-  walk::parallel::code(scope, [&old_to_new](DexMethod*, IRCode& code) {
-    if (code.editable_cfg_built()) {
-      auto& cfg = code.cfg();
-      for (auto& mie : InstructionIterable(cfg)) {
-        auto insn = mie.insn;
-        if (insn->has_field()) {
-          const auto ref_type = insn->get_field()->get_type();
-          const auto type = type::get_element_type_if_array(ref_type);
-          always_assert_log(
-              old_to_new.count(type) == 0,
-              "Find old type in field reference %s, please make sure that "
-              "ReBindRefsPass is enabled before ClassMergingPass\n",
-              SHOW(insn));
-        }
-      }
-    } else {
-      for (auto& mie : InstructionIterable(code)) {
-        auto insn = mie.insn;
-        if (insn->has_field()) {
-          const auto ref_type = insn->get_field()->get_type();
-          const auto type = type::get_element_type_if_array(ref_type);
-          always_assert_log(
-              old_to_new.count(type) == 0,
-              "Find old type in field reference %s, please make sure that "
-              "ReBindRefsPass is enabled before ClassMergingPass\n",
-              SHOW(insn));
-        }
-      }
-    }
-  });
+void update_member_type_references(
+    const Scope& scope,
+    const std::unordered_map<const DexType*, DexType*>& old_to_new,
+    const ClassHierarchy& ch,
+    boost::optional<std::unordered_map<DexMethod*, std::string>&>
+        method_debug_map) {
+  update_method_signatures(scope, old_to_new, ch, method_debug_map);
+  update_field_types(scope, old_to_new);
+  check_no_old_type_references(scope, old_to_new, /* check_methods */ true,
+                               /* check_fields */ true);
 }
 
 void fix_colliding_dmethods(
@@ -108,6 +108,19 @@ void update_field_type_references(
     const Scope& scope,
     const std::unordered_map<const DexType*, DexType*>& old_to_new);
 
+/**
+ * Update the method signatures and the field types at once, like
+ * update_method_signature_type_references followed by
+ * update_field_type_references, but with a single walk over the code to check
+ * that no references to old types are left.
+ */
+void update_member_type_references(
+    const Scope& scope,
+    const std::unordered_map<const DexType*, DexType*>& old_to_new,
+    const ClassHierarchy& ch,
+    boost::optional<std::unordered_map<DexMethod*, std::string>&>
+        method_debug_map = boost::none);
+
 void fix_colliding_dmethods(
     const Scope& scope,
     const std::vector<std::pair<DexMethod*, DexProto*>>& colliding_methods);
@@ -129,6 +129,10 @@ void mark_adjacent(const interference::Graph& ig,
 
 constexpr int INVALID_SCORE = std::numeric_limits<int>::max();
 
+// How much more a spill move in a block that may run costs than one in a
+// block that the profile shows to be cold.
+constexpr uint32_t HOT_SPILL_COST_FACTOR = 8;
+
 /*
  * If :reg is mapped to something other than :vreg, then we'll need to insert a
  * move instruction to remap :reg.
@@ -327,7 +331,8 @@ static bool has_2addr_form(IROpcode op) {
  *   * move instructions whose src and dest don't interfere can be removed
  *
  *   * instructions like add-int whose src(0) and dest don't interfere may
- *     be encoded as add-int/2addr
+ *     be encoded as add-int/2addr; with prefer_compact_encodings, so may
+ *     commutative ones whose src(1) and dest don't interfere
  *
  *   * check-cast instructions with identical src and dest won't need to be
  *     preceded by a move opcode in the output
@@ -381,6 +386,12 @@ bool Allocator::coalesce(interference::Graph* ig, cfg::ControlFlowGraph& cfg) {
     }
     dest = aliases.find_set(dest);
     auto src = aliases.find_set(insn->src(0));
+    if (m_config.prefer_compact_encodings && opcode::is_commutative(op) &&
+        dest != src && !ig->is_coalesceable(dest, src)) {
+      // A commutative binop whose dest is its second source can use the
+      // /2addr encoding as well.
+      src = aliases.find_set(insn->src(1));
+    }
     if (dest == src) {
       if (opcode::is_a_move(op)) {
         ++m_stats.moves_coalesced;
@@ -440,7 +451,21 @@ void Allocator::simplify(interference::Graph* ig,
   // Nodes of low weight that we know are colorable. Note that even if all
   // the nodes in `low` have a max_vreg of 15, we can still have more than 16
   // of them here since some of them can have zero weight.
-  std::set<reg_t> low;
+  //
+  // The nodes that get removed last are the first ones to be colored, and so
+  // get the lowest vregs. When preferring compact encodings, we thus remove
+  // the nodes with the most hot binop uses last.
+  auto low_order = [this, ig](reg_t a, reg_t b) {
+    if (m_config.prefer_compact_encodings) {
+      auto a_uses = ig->get_node(a).hot_binop_uses();
+      auto b_uses = ig->get_node(b).hot_binop_uses();
+      if (a_uses != b_uses) {
+        return a_uses < b_uses;
+      }
+    }
+    return a < b;
+  };
+  std::set<reg_t, decltype(low_order)> low(low_order);
   // Nodes that may not be colorable
   std::unordered_set<reg_t> high;
 
@@ -503,16 +528,28 @@ void Allocator::simplify(interference::Graph* ig,
     // uses (high spill cost), and interfere with fewer live ranges (have lower
     // weight) compared to v2 and v3 (tying with v4, but v4 still has a lower
     // spill cost).
-    auto spill_candidate_it =
-        std::min_element(high.begin(), high.end(), [ig](reg_t a, reg_t b) {
+    //
+    // With profile-guided spills, a move in a cold block counts for much less
+    // than one in a block that may run, so that the moves stay out of hot
+    // code where possible. Without a profile, every block may run, and the
+    // ratios are only scaled.
+    auto spill_cost = [this](const interference::Node& node) -> uint64_t {
+      if (!m_config.profile_guided_spills) {
+        return node.spill_cost();
+      }
+      return node.spill_cost() +
+             uint64_t(HOT_SPILL_COST_FACTOR - 1) * node.hot_spill_cost();
+    };
+    auto spill_candidate_it = std::min_element(
+        high.begin(), high.end(), [ig, &spill_cost](reg_t a, reg_t b) {
           auto& node_a = ig->get_node(a);
           auto& node_b = ig->get_node(b);
           if (node_a.is_spilt() != node_b.is_spilt()) {
             return !node_a.is_spilt() && node_b.is_spilt();
           }
           // Note that a / b < c / d <=> a * d < c * b.
-          auto a_value = node_a.spill_cost() * node_b.weight();
-          auto b_value = node_b.spill_cost() * node_a.weight();
+          auto a_value = spill_cost(node_a) * node_b.weight();
+          auto b_value = spill_cost(node_b) * node_a.weight();
           if (a_value != b_value) {
             return a_value < b_value;
           }
@@ -799,7 +836,7 @@ Allocator::find_param_splits(const std::unordered_set<reg_t>& orig_params,
   }
 
   cfg::Block* start_block = cfg.entry_block();
-  auto doms = dominators::SimpleFastDominators<cfg::GraphInterface>(cfg);
+  const auto& doms = dominators::get_dominators(cfg);
   for (auto param : params) {
     auto block_uses = find_first_uses(param, start_block);
     // Since this function only gets called for param regs that need to be
@@ -1050,13 +1087,24 @@ void Allocator::allocate(cfg::ControlFlowGraph& cfg, bool is_static) {
     RegisterTransform reg_transform;
 
     cfg.calculate_exit_block();
-    auto fixpoint_iter = std::make_unique<LivenessFixpointIterator>(cfg);
-    fixpoint_iter->run(LivenessDomain());
-
     TRACE(REG, 5, "Allocating:\n%s", ::SHOW(cfg));
-    auto ig = interference::build_graph(
-        *fixpoint_iter, cfg, initial_regs, range_set,
-        /* containment_edges */ m_config.use_splitting);
+    // Splitting needs the liveness results after building the graph, and
+    // only works with the sparse representation.
+    std::unique_ptr<LivenessFixpointIterator> fixpoint_iter;
+    auto ig = [&]() {
+      if (!m_config.use_splitting && use_dense_liveness(cfg)) {
+        DenseLivenessFixpointIterator dense_fixpoint_iter(cfg);
+        dense_fixpoint_iter.run(DenseLivenessDomain());
+        return interference::build_graph(dense_fixpoint_iter, cfg,
+                                         initial_regs, range_set,
+                                         /* containment_edges */ false);
+      }
+      fixpoint_iter = std::make_unique<LivenessFixpointIterator>(cfg);
+      fixpoint_iter->run(LivenessDomain());
+      return interference::build_graph(
+          *fixpoint_iter, cfg, initial_regs, range_set,
+          /* containment_edges */ m_config.use_splitting);
+    }();
 
     // Make the `this` symreg conflict with every other one so that it never
     // gets overwritten in the method. See check_no_overwrite_this in
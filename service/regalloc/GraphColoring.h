@@ -83,6 +83,13 @@ class Allocator {
   struct Config {
     bool no_overwrite_this{false};
     bool use_splitting{false};
+    // Prefer spilling live ranges whose spill moves would land in blocks
+    // that the source block profile shows to be cold.
+    bool profile_guided_spills{false};
+    // Coalesce commutative binops with either source, and give the low vregs
+    // to the operands of hot binops first, so that more of them can use the
+    // compact /2addr encoding.
+    bool prefer_compact_encodings{false};
   };
 
   struct Stats {
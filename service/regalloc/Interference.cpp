@@ -12,6 +12,7 @@
 #include "DexOpcode.h"
 #include "DexUtil.h"
 #include "Show.h"
+#include "SourceBlocks.h"
 
 namespace regalloc {
 
@@ -88,8 +89,7 @@ void Graph::add_edge(reg_t u, reg_t v, bool can_coalesce) {
   //
   // then the final state of the edge between s0 and s1 must be
   // non-coalesceable.
-  m_adj_matrix[build_edge(u, v)] =
-      m_adj_matrix[build_edge(u, v)] || !can_coalesce;
+  m_adj_matrix.add(u, v, can_coalesce);
 }
 
 uint32_t Node::colorable_limit() const {
@@ -114,6 +114,8 @@ void Graph::combine(reg_t u, reg_t v) {
   u_node.m_type_domain.meet_with(v_node.m_type_domain);
   u_node.m_props |= v_node.m_props;
   u_node.m_spill_cost += v_node.m_spill_cost;
+  u_node.m_hot_spill_cost += v_node.m_hot_spill_cost;
+  u_node.m_hot_binop_uses += v_node.m_hot_binop_uses;
   v_node.m_props.reset(Node::ACTIVE);
   for (auto t : v_node.adjacent()) {
     auto& t_node = m_nodes.at(t);
@@ -199,12 +201,15 @@ vreg_t max_value_for_src(const IRInstruction* insn,
 
 void GraphBuilder::update_node_constraints(const cfg::InstructionIterator& it,
                                            const RangeSet& range_set,
+                                           bool hot,
                                            Graph* graph) {
   auto insn = it->insn;
   auto op = insn->opcode();
+  bool hot_binop = hot && op >= OPCODE_ADD_INT && op <= OPCODE_REM_DOUBLE;
   if (insn->has_dest()) {
     auto dest = insn->dest();
     auto& node = graph->m_nodes[dest];
+    node.m_hot_binop_uses += hot_binop;
     if (opcode::is_a_load_param(op)) {
       node.m_props.set(Node::PARAM);
     }
@@ -214,12 +219,14 @@ void GraphBuilder::update_node_constraints(const cfg::InstructionIterator& it,
     node.m_width = insn->dest_is_wide() ? 2 : 1;
     if (max_vreg < max_unsigned_value(16)) {
       ++node.m_spill_cost;
+      node.m_hot_spill_cost += hot;
     }
   }
 
   for (size_t i = 0; i < insn->srcs_size(); ++i) {
     auto src = insn->src(i);
     auto& node = graph->m_nodes[src];
+    node.m_hot_binop_uses += hot_binop;
     auto type = src_reg_type(insn, i);
     node.m_type_domain.meet_with(RegisterTypeDomain(type));
     vreg_t max_vreg;
@@ -232,6 +239,7 @@ void GraphBuilder::update_node_constraints(const cfg::InstructionIterator& it,
     node.m_max_vreg = std::min(node.m_max_vreg, max_vreg);
     if (max_vreg < max_unsigned_value(16)) {
       ++node.m_spill_cost;
+      node.m_hot_spill_cost += hot;
     }
   }
 }
@@ -279,19 +287,30 @@ void GraphBuilder::update_node_constraints(const cfg::InstructionIterator& it,
  * register interfere with the live registers in both B0 and B1, so that when
  * the move gets inserted, it does not clobber any live registers.
  */
-Graph GraphBuilder::build(const LivenessFixpointIterator& fixpoint_iter,
+template <typename LivenessIterator>
+Graph GraphBuilder::build(const LivenessIterator& fixpoint_iter,
                           cfg::ControlFlowGraph& cfg,
                           reg_t initial_regs,
                           const RangeSet& range_set,
                           bool containment_edges) {
   Graph graph;
+  graph.m_adj_matrix.init(cfg.get_registers_size());
+  graph.m_nodes.reserve(cfg.get_registers_size());
   auto ii = cfg::InstructionIterable(cfg);
+  const cfg::Block* block = nullptr;
+  bool hot = true;
   for (auto it = ii.begin(); it != ii.end(); ++it) {
-    GraphBuilder::update_node_constraints(it, range_set, &graph);
+    if (it.block() != block) {
+      block = it.block();
+      auto val = source_blocks::get_max_val(
+          source_blocks::get_first_source_block(block));
+      hot = !val || *val > 0;
+    }
+    GraphBuilder::update_node_constraints(it, range_set, hot, &graph);
   }
 
   for (cfg::Block* block : cfg.blocks()) {
-    LivenessDomain live_out = fixpoint_iter.get_live_out_vars_at(block);
+    auto live_out = fixpoint_iter.get_live_out_vars_at(block);
     for (auto it = block->rbegin(); it != block->rend(); ++it) {
       if (it->type != MFLOW_OPCODE) {
         continue;
@@ -363,6 +382,17 @@ Graph GraphBuilder::build(const LivenessFixpointIterator& fixpoint_iter,
   return graph;
 }
 
+template Graph GraphBuilder::build(const LivenessFixpointIterator&,
+                                   cfg::ControlFlowGraph&,
+                                   reg_t,
+                                   const RangeSet&,
+                                   bool);
+template Graph GraphBuilder::build(const DenseLivenessFixpointIterator&,
+                                   cfg::ControlFlowGraph&,
+                                   reg_t,
+                                   const RangeSet&,
+                                   bool);
+
 std::ostream& Graph::write_dot_format(std::ostream& o) const {
   o << "graph {\n";
   for (const auto& pair : nodes()) {
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <boost/functional/hash.hpp>
 #include <boost/range/adaptor/filtered.hpp>
 #include <unordered_map>
@@ -88,6 +89,73 @@ inline reg_pair_t build_edge(reg_t u, reg_t v) {
   return (hi << (sizeof(reg_t) * 8)) | lo;
 }
 
+/*
+ * The set of interference edges, and whether each of them can be coalesced.
+ *
+ * Edges between registers below the size given to `init` are stored in a
+ * lower-triangular bit matrix, two bits per pair, which is far cheaper to
+ * build and query than a hash map. Edges involving higher registers (e.g., in
+ * graphs built by hand in tests) go into a hash map instead.
+ */
+class AdjacencyMatrix {
+ public:
+  // Beyond this many registers, the matrix would take more than 8MB.
+  static constexpr reg_t kMaxDenseRegisters = 1 << 13;
+
+  void init(reg_t registers_size) {
+    m_dense_size = std::min(registers_size, kMaxDenseRegisters);
+    m_bits.assign((index(0, m_dense_size) * 2 + 63) / 64, 0);
+  }
+
+  bool contains(reg_t u, reg_t v) const {
+    if (u == v) {
+      return false;
+    }
+    if (std::max(u, v) < m_dense_size) {
+      return get_bit(index(u, v) * 2);
+    }
+    return m_sparse.count(build_edge(u, v)) != 0;
+  }
+
+  // Whether the edge, which must exist, can be coalesced.
+  bool can_coalesce(reg_t u, reg_t v) const {
+    if (std::max(u, v) < m_dense_size) {
+      return !get_bit(index(u, v) * 2 + 1);
+    }
+    return !m_sparse.at(build_edge(u, v));
+  }
+
+  // Adds the edge. A non-coalesceable edge stays non-coalesceable.
+  void add(reg_t u, reg_t v, bool can_coalesce) {
+    if (std::max(u, v) < m_dense_size) {
+      auto i = index(u, v) * 2;
+      set_bit(i);
+      if (!can_coalesce) {
+        set_bit(i + 1);
+      }
+      return;
+    }
+    auto& non_coalesceable = m_sparse[build_edge(u, v)];
+    non_coalesceable = non_coalesceable || !can_coalesce;
+  }
+
+ private:
+  // The index of the pair {u, v}, u != v, in the lower triangle.
+  static size_t index(reg_t u, reg_t v) {
+    size_t lo = std::min(u, v);
+    size_t hi = std::max(u, v);
+    return hi * (hi - 1) / 2 + lo;
+  }
+
+  bool get_bit(size_t i) const { return (m_bits[i / 64] >> (i % 64)) & 1; }
+
+  void set_bit(size_t i) { m_bits[i / 64] |= uint64_t(1) << (i % 64); }
+
+  reg_t m_dense_size{0};
+  std::vector<uint64_t> m_bits;
+  std::unordered_map<reg_pair_t, bool> m_sparse;
+};
+
 } // namespace impl
 
 class Node {
@@ -127,6 +195,20 @@ class Node {
    */
   uint32_t spill_cost() const { return m_spill_cost; }
 
+  /*
+   * The part of spill_cost() incurred in blocks that the source block profile
+   * does not show to be cold. Without a profile, this is all of it.
+   */
+  uint32_t hot_spill_cost() const { return m_hot_spill_cost; }
+
+  /*
+   * The number of times this register is an operand of an arithmetic binop in
+   * a block that the source block profile does not show to be cold. Those
+   * binops only get the compact /2addr encoding if all their operands fit in
+   * 4 bits.
+   */
+  uint32_t hot_binop_uses() const { return m_hot_binop_uses; }
+
   /*
    * The maximum vreg this node can be mapped to without spilling. Since
    * different opcodes have different maximums, this ends up being a per-node
@@ -158,6 +240,8 @@ class Node {
  private:
   uint32_t m_weight{0};
   uint32_t m_spill_cost{0};
+  uint32_t m_hot_spill_cost{0};
+  uint32_t m_hot_binop_uses{0};
   vreg_t m_max_vreg{max_unsigned_value(16)};
   // While the width is implicit in the register type, looking up the type to
   // determine the width is a little more expensive than storing the width
@@ -191,11 +275,11 @@ class Graph {
   }
 
   bool is_adjacent(reg_t u, reg_t v) const {
-    return m_adj_matrix.find(impl::build_edge(u, v)) != m_adj_matrix.end();
+    return m_adj_matrix.contains(u, v);
   }
 
   bool is_coalesceable(reg_t u, reg_t v) const {
-    return !is_adjacent(u, v) || !m_adj_matrix.at(impl::build_edge(u, v));
+    return !is_adjacent(u, v) || m_adj_matrix.can_coalesce(u, v);
   }
 
   bool has_containment_edge(reg_t u, reg_t v) const {
@@ -229,7 +313,7 @@ class Graph {
 
  private:
   std::unordered_map<reg_t, Node> m_nodes;
-  std::unordered_map<reg_pair_t, bool> m_adj_matrix;
+  impl::AdjacencyMatrix m_adj_matrix;
   std::unordered_set<reg_pair_t> m_containment_graph;
 
   friend class impl::GraphBuilder;
@@ -262,10 +346,14 @@ inline uint32_t div_ceil(uint32_t a, uint32_t b) { return (a + b - 1) / b; }
 class GraphBuilder {
   static void update_node_constraints(const cfg::InstructionIterator&,
                                       const RangeSet&,
+                                      bool hot,
                                       Graph*);
 
  public:
-  static Graph build(const LivenessFixpointIterator&,
+  // Instantiated for LivenessFixpointIterator and
+  // DenseLivenessFixpointIterator.
+  template <typename LivenessIterator>
+  static Graph build(const LivenessIterator&,
                      cfg::ControlFlowGraph&,
                      reg_t initial_regs,
                      const RangeSet&,
@@ -281,7 +369,8 @@ uint32_t edge_weight_helper(uint8_t, uint8_t);
 
 } // namespace impl
 
-inline Graph build_graph(const LivenessFixpointIterator& fixpoint_iter,
+template <typename LivenessIterator>
+inline Graph build_graph(const LivenessIterator& fixpoint_iter,
                          cfg::ControlFlowGraph& cfg,
                          reg_t initial_regs,
                          const RangeSet& range_set,
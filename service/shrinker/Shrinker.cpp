@@ -7,12 +7,14 @@
 
 #include "Shrinker.h"
 
+#include <boost/functional/hash.hpp>
 #include <fstream>
 
 #include "BranchPrefixHoisting.h"
 #include "ConstantUses.h"
 #include "ConstructorParams.h"
 #include "LinearScan.h"
+#include "PersistentAnalysisCache.h"
 #include "RandomForest.h"
 #include "RegisterAllocation.h"
 #include "ScopedMetrics.h"
@@ -22,6 +24,24 @@ namespace shrinker {
 
 namespace {
 
+// Bump when the shrinker changes in a way that makes it produce different code
+// for the same input.
+constexpr uint32_t SHRUNK_METHODS_CACHE_VERSION = 1;
+
+uint64_t get_config_hash(const ShrinkerConfig& config, int min_sdk) {
+  size_t hash = min_sdk;
+  for (bool b :
+       {config.run_const_prop, config.run_cse, config.run_copy_prop,
+        config.run_local_dce, config.run_reg_alloc, config.run_fast_reg_alloc,
+        config.run_dedup_blocks, config.run_branch_prefix_hoisting,
+        config.normalize_new_instances, config.compute_pure_methods,
+        config.analyze_constructors}) {
+    boost::hash_combine(hash, b);
+  }
+  boost::hash_combine(hash, config.reg_alloc_random_forest);
+  return hash;
+}
+
 inline Shrinker::ShrinkerForest::FeatureFunctionMap
 get_default_feature_function_map() {
   return {
@@ -107,7 +127,7 @@ Shrinker::Shrinker(
       m_pure_methods.insert(immutable_getters.begin(), immutable_getters.end());
     }
     if (config.run_cse) {
-      m_cse_shared_state = std::make_unique<cse_impl::SharedState>(
+      m_cse_shared_state = std::make_shared<cse_impl::SharedState>(
           m_pure_methods, m_finalish_field_names, m_finalish_fields);
     }
     if (config.run_local_dce && config.compute_pure_methods) {
@@ -193,13 +213,52 @@ copy_propagation_impl::Stats Shrinker::copy_propagation(
   return copy_propagation.run(code, is_static, declaring_type, rtype, args,
                               std::move(method_describer));
 }
+void Shrinker::enable_shrunk_methods_cache(
+    analysis_cache::PersistentAnalysisCache& cache) {
+  m_shrunk_methods_cache =
+      &cache.get_table("shrinker_shrunk_methods", SHRUNK_METHODS_CACHE_VERSION);
+  m_shrunk_methods_cache_salt = get_config_hash(m_config, m_min_sdk);
+}
+
+void Shrinker::set_cse_shared_state(
+    std::shared_ptr<cse_impl::SharedState> cse_shared_state) {
+  if (m_config.run_cse) {
+    always_assert(cse_shared_state);
+    m_cse_shared_state = std::move(cse_shared_state);
+  }
+}
+
+bool Shrinker::is_shrunk(const DexMethod* method) {
+  if (m_shrunk_methods_cache == nullptr) {
+    return false;
+  }
+  auto key =
+      analysis_cache::get_method_key(method, m_shrunk_methods_cache_salt);
+  return !!m_shrunk_methods_cache->get(key);
+}
+
+void Shrinker::mark_shrunk(const DexMethod* method) {
+  if (m_shrunk_methods_cache == nullptr) {
+    return;
+  }
+  auto key =
+      analysis_cache::get_method_key(method, m_shrunk_methods_cache_salt);
+  m_shrunk_methods_cache->put(key, "");
+}
+
 void Shrinker::shrink_method(DexMethod* method) {
+  if (is_shrunk(method)) {
+    TRACE(MMINL, 5, "Skipping shrinking of unchanged %s", SHOW(method));
+    m_methods_shrink_skipped++;
+    return;
+  }
   shrink_code(method->get_code(),
               is_static(method),
               method::is_init(method) || method::is_clinit(method),
               method->get_class(),
               method->get_proto(),
               [method]() { return show(method); });
+  mark_shrunk(method);
 }
 
 void Shrinker::shrink_code(
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <atomic>
+
 #include "CommonSubexpressionElimination.h"
 #include "ConstantEnvironment.h"
 #include "ConstantPropagationState.h"
@@ -26,6 +28,11 @@
 
 class ScopedMetrics;
 
+namespace analysis_cache {
+class PersistentAnalysisCache;
+class Table;
+} // namespace analysis_cache
+
 namespace shrinker {
 
 class Shrinker {
@@ -62,7 +69,29 @@ class Shrinker {
       DexTypeList* args,
       std::function<std::string()> method_describer);
 
+  // Shrinks the method, unless the shrunk methods cache says that its current
+  // code is already the result of shrinking with this configuration.
   void shrink_method(DexMethod* method);
+
+  // Remembers the code that this shrinker produces by content (method hash and
+  // shrinker configuration), so that shrinking can be skipped for methods that
+  // didn't change since they were last shrunk, e.g. by an earlier inliner
+  // invocation sharing the same cache.
+  void enable_shrunk_methods_cache(analysis_cache::PersistentAnalysisCache&);
+
+  // Makes CSE use the given scope-wide shared state (e.g. a preserved one of
+  // CseSharedStateAnalysisPass) instead of the shrinker's own, which doesn't
+  // know about method barriers. No-op when CSE isn't enabled.
+  void set_cse_shared_state(std::shared_ptr<cse_impl::SharedState>);
+
+  // Whether the current code of the method is known to be shrunk. Always false
+  // when the shrunk methods cache isn't enabled.
+  bool is_shrunk(const DexMethod* method);
+
+  // Records the current code of the method as shrunk, for a change that is
+  // known not to create any opportunities for the shrinker.
+  void mark_shrunk(const DexMethod* method);
+
   void shrink_code(IRCode* code,
                    bool is_static,
                    bool is_init_or_clinit,
@@ -86,6 +115,9 @@ class Shrinker {
     return m_branch_prefix_hoisting_stats;
   }
   size_t get_methods_shrunk() const { return m_methods_shrunk; }
+  size_t get_methods_shrink_skipped() const {
+    return m_methods_shrink_skipped;
+  }
   size_t get_methods_reg_alloced() const { return m_methods_reg_alloced; }
 
   bool enabled() const { return m_enabled; }
@@ -152,7 +184,7 @@ class Shrinker {
   const ShrinkerConfig m_config;
   const int m_min_sdk;
   const bool m_enabled;
-  std::unique_ptr<cse_impl::SharedState> m_cse_shared_state;
+  std::shared_ptr<cse_impl::SharedState> m_cse_shared_state;
 
   const init_classes::InitClassesWithSideEffects&
       m_init_classes_with_side_effects;
@@ -163,6 +195,9 @@ class Shrinker {
   constant_propagation::ImmutableAttributeAnalyzerState m_immut_analyzer_state;
   constant_propagation::State m_cp_state;
 
+  analysis_cache::Table* m_shrunk_methods_cache{nullptr};
+  uint64_t m_shrunk_methods_cache_salt{0};
+
   // THe mutex protects all other mutable (stats) fields.
   std::mutex m_stats_mutex;
   AccumulatingTimer m_const_prop_timer;
@@ -179,6 +214,7 @@ class Shrinker {
   dedup_blocks_impl::Stats m_dedup_blocks_stats;
   AccumulatingTimer m_reg_alloc_timer;
   size_t m_methods_shrunk{0};
+  std::atomic<size_t> m_methods_shrink_skipped{0};
   size_t m_methods_reg_alloced{0};
 };
 
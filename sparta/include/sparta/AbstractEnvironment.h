@@ -11,6 +11,7 @@
 #include <initializer_list>
 #include <ostream>
 #include <sstream>
+#include <type_traits>
 #include <utility>
 
 #include <sparta/AbstractDomain.h>
@@ -30,6 +31,22 @@ class MapValue;
 
 class value_is_bottom {};
 
+// Whether the map can be hash-consed, see `AbstractEnvironment::intern`.
+template <typename Map, typename = void>
+struct supports_interning : std::false_type {};
+
+template <typename Map>
+struct supports_interning<
+    Map,
+    std::void_t<decltype(std::declval<const Map&>().is_interned())>>
+    : std::true_type {};
+
+// Tags of the memoized operations.
+struct JoinTag {};
+struct WideningTag {};
+struct MeetTag {};
+struct NarrowingTag {};
+
 } // namespace environment_impl
 
 /*
@@ -206,6 +223,21 @@ class AbstractEnvironment final
     this->get_value()->m_map.visit(std::forward<Visitor>(visitor));
   }
 
+  /*
+   * Hash-conses the bindings, if the underlying map supports it. Lattice
+   * operations between interned environments are memoized, and their results
+   * are interned in turn, so it is enough to intern the initial values of an
+   * analysis (and the environments read back from other threads) for equal
+   * environments to share memory and to compare in constant time.
+   */
+  void intern() {
+    if constexpr (environment_impl::supports_interning<Map>::value) {
+      if (this->kind() == AbstractValueKind::Value) {
+        this->get_value()->m_map.intern();
+      }
+    }
+  }
+
   static AbstractEnvironment bottom() {
     return AbstractEnvironment(AbstractValueKind::Bottom);
   }
@@ -284,46 +316,46 @@ class MapValue final : public AbstractValue<MapValue<Map>> {
 
   AbstractValueKind join_with(const MapValue& other) {
     if constexpr (Map::mutability == AbstractMapMutability::Immutable) {
-      return join_like_operation(
+      return join_like_operation<JoinTag>(
           other,
           [](const Domain& x, const Domain& y) -> Domain { return x.join(y); });
     } else if constexpr (Map::mutability == AbstractMapMutability::Mutable) {
-      return join_like_operation(
+      return join_like_operation<JoinTag>(
           other, [](Domain* x, const Domain& y) -> void { x->join_with(y); });
     }
   }
 
   AbstractValueKind widen_with(const MapValue& other) {
     if constexpr (Map::mutability == AbstractMapMutability::Immutable) {
-      return join_like_operation(
+      return join_like_operation<WideningTag>(
           other, [](const Domain& x, const Domain& y) -> Domain {
             return x.widening(y);
           });
     } else if constexpr (Map::mutability == AbstractMapMutability::Mutable) {
-      return join_like_operation(
+      return join_like_operation<WideningTag>(
           other, [](Domain* x, const Domain& y) -> void { x->widen_with(y); });
     }
   }
 
   AbstractValueKind meet_with(const MapValue& other) {
     if constexpr (Map::mutability == AbstractMapMutability::Immutable) {
-      return meet_like_operation(
+      return meet_like_operation<MeetTag>(
           other,
           [](const Domain& x, const Domain& y) -> Domain { return x.meet(y); });
     } else if constexpr (Map::mutability == AbstractMapMutability::Mutable) {
-      return meet_like_operation(
+      return meet_like_operation<MeetTag>(
           other, [](Domain* x, const Domain& y) -> void { x->meet_with(y); });
     }
   }
 
   AbstractValueKind narrow_with(const MapValue& other) {
     if constexpr (Map::mutability == AbstractMapMutability::Immutable) {
-      return meet_like_operation(
+      return meet_like_operation<NarrowingTag>(
           other, [](const Domain& x, const Domain& y) -> Domain {
             return x.narrowing(y);
           });
     } else if constexpr (Map::mutability == AbstractMapMutability::Mutable) {
-      return meet_like_operation(
+      return meet_like_operation<NarrowingTag>(
           other, [](Domain* x, const Domain& y) -> void { x->narrow_with(y); });
     }
   }
@@ -337,36 +369,55 @@ class MapValue final : public AbstractValue<MapValue<Map>> {
     m_map.insert_or_assign(variable, std::forward<D>(value));
   }
 
-  template <typename Operation>
+  // Applies `operation` to the bindings, through the memo cache of the map
+  // when both operands are interned.
+  template <typename Tag, typename Operation>
+  void apply_to_map(const MapValue& other, Operation&& operation) {
+    if constexpr (supports_interning<Map>::value) {
+      if (m_map.is_interned() && other.m_map.is_interned()) {
+        m_map.template memoized<Tag>(other.m_map, operation);
+        return;
+      }
+    }
+    operation(&m_map);
+  }
+
+  template <typename Tag, typename Operation>
   AbstractValueKind join_like_operation(const MapValue& other,
                                         const Operation& operation) {
-    m_map.intersection_with(operation, other.m_map);
+    apply_to_map<Tag>(other, [&](Map* map) {
+      map->intersection_with(operation, other.m_map);
+    });
     return kind();
   }
 
-  template <typename Operation>
+  template <typename Tag, typename Operation>
   AbstractValueKind meet_like_operation(const MapValue& other,
                                         const Operation& operation) {
     try {
       if constexpr (Map::mutability == AbstractMapMutability::Immutable) {
-        m_map.union_with(
-            [&operation](const Domain& x, const Domain& y) -> Domain {
-              Domain result = operation(x, y);
-              if (result.is_bottom()) {
-                throw value_is_bottom();
-              }
-              return result;
-            },
-            other.m_map);
+        apply_to_map<Tag>(other, [&](Map* map) {
+          map->union_with(
+              [&operation](const Domain& x, const Domain& y) -> Domain {
+                Domain result = operation(x, y);
+                if (result.is_bottom()) {
+                  throw value_is_bottom();
+                }
+                return result;
+              },
+              other.m_map);
+        });
       } else if constexpr (Map::mutability == AbstractMapMutability::Mutable) {
-        m_map.union_with(
-            [&operation](Domain* x, const Domain& y) -> void {
-              operation(x, y);
-              if (x->is_bottom()) {
-                throw value_is_bottom();
-              }
-            },
-            other.m_map);
+        apply_to_map<Tag>(other, [&](Map* map) {
+          map->union_with(
+              [&operation](Domain* x, const Domain& y) -> void {
+                operation(x, y);
+                if (x->is_bottom()) {
+                  throw value_is_bottom();
+                }
+              },
+              other.m_map);
+        });
       }
     } catch (const value_is_bottom&) {
       clear();
@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <sparta/PowersetAbstractDomain.h>
+
+namespace sparta {
+
+namespace bvsad_impl {
+
+/*
+ * Word-parallel kernels over arrays of 64-bit words. When the target supports
+ * AVX2 or NEON, four (resp. two) words are processed per instruction;
+ * otherwise we fall back to a scalar loop, which compilers usually vectorize
+ * for whatever the baseline instruction set provides.
+ */
+
+// dst |= src
+inline void or_words(uint64_t* dst, const uint64_t* src, size_t n) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 4 <= n; i += 4) {
+    auto* d = reinterpret_cast<__m256i*>(dst + i);
+    auto s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    _mm256_storeu_si256(d, _mm256_or_si256(_mm256_loadu_si256(d), s));
+  }
+#elif defined(__ARM_NEON)
+  for (; i + 2 <= n; i += 2) {
+    vst1q_u64(dst + i, vorrq_u64(vld1q_u64(dst + i), vld1q_u64(src + i)));
+  }
+#endif
+  for (; i < n; ++i) {
+    dst[i] |= src[i];
+  }
+}
+
+// dst &= src
+inline void and_words(uint64_t* dst, const uint64_t* src, size_t n) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 4 <= n; i += 4) {
+    auto* d = reinterpret_cast<__m256i*>(dst + i);
+    auto s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    _mm256_storeu_si256(d, _mm256_and_si256(_mm256_loadu_si256(d), s));
+  }
+#elif defined(__ARM_NEON)
+  for (; i + 2 <= n; i += 2) {
+    vst1q_u64(dst + i, vandq_u64(vld1q_u64(dst + i), vld1q_u64(src + i)));
+  }
+#endif
+  for (; i < n; ++i) {
+    dst[i] &= src[i];
+  }
+}
+
+// dst &= ~src
+inline void andnot_words(uint64_t* dst, const uint64_t* src, size_t n) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 4 <= n; i += 4) {
+    auto* d = reinterpret_cast<__m256i*>(dst + i);
+    auto s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    _mm256_storeu_si256(d, _mm256_andnot_si256(s, _mm256_loadu_si256(d)));
+  }
+#elif defined(__ARM_NEON)
+  for (; i + 2 <= n; i += 2) {
+    vst1q_u64(dst + i, vbicq_u64(vld1q_u64(dst + i), vld1q_u64(src + i)));
+  }
+#endif
+  for (; i < n; ++i) {
+    dst[i] &= ~src[i];
+  }
+}
+
+// (a & ~b) == 0
+inline bool is_subset_words(const uint64_t* a, const uint64_t* b, size_t n) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 4 <= n; i += 4) {
+    auto va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    auto vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    if (!_mm256_testc_si256(vb, va)) {
+      return false;
+    }
+  }
+#elif defined(__ARM_NEON)
+  for (; i + 2 <= n; i += 2) {
+    auto diff = vbicq_u64(vld1q_u64(a + i), vld1q_u64(b + i));
+    if ((vgetq_lane_u64(diff, 0) | vgetq_lane_u64(diff, 1)) != 0) {
+      return false;
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    if ((a[i] & ~b[i]) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline bool is_zero_words(const uint64_t* a, size_t n) {
+  return std::all_of(a, a + n, [](uint64_t w) { return w == 0; });
+}
+
+/*
+ * A read-only view of the elements of a bit vector, in increasing order. It
+ * refers to the storage of the set it was taken from, and is invalidated by
+ * any modification of that set.
+ */
+template <typename IntegerType>
+class BitVectorElements final {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = IntegerType;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const IntegerType*;
+    using reference = IntegerType;
+
+    iterator(const uint64_t* words, size_t size, size_t index)
+        : m_words(words), m_size(size), m_index(index) {
+      m_word = m_index < m_size ? m_words[m_index] : 0;
+      skip_empty_words();
+    }
+
+    IntegerType operator*() const {
+      return static_cast<IntegerType>(m_index * 64 + __builtin_ctzll(m_word));
+    }
+
+    iterator& operator++() {
+      m_word &= m_word - 1;
+      skip_empty_words();
+      return *this;
+    }
+
+    iterator operator++(int) {
+      iterator tmp(*this);
+      ++(*this);
+      return tmp;
+    }
+
+    bool operator==(const iterator& other) const {
+      return m_index == other.m_index && m_word == other.m_word;
+    }
+
+    bool operator!=(const iterator& other) const { return !(*this == other); }
+
+   private:
+    void skip_empty_words() {
+      while (m_word == 0 && m_index < m_size) {
+        if (++m_index < m_size) {
+          m_word = m_words[m_index];
+        }
+      }
+    }
+
+    const uint64_t* m_words;
+    size_t m_size;
+    size_t m_index;
+    uint64_t m_word;
+  };
+
+  using const_iterator = iterator;
+  using value_type = IntegerType;
+
+  BitVectorElements(const uint64_t* words, size_t size)
+      : m_words(words), m_size(size) {}
+
+  iterator begin() const { return iterator(m_words, m_size, 0); }
+
+  iterator end() const { return iterator(m_words, m_size, m_size); }
+
+  bool empty() const { return begin() == end(); }
+
+ private:
+  const uint64_t* m_words;
+  size_t m_size;
+};
+
+/*
+ * A dense representation of sets of small unsigned integers as bit vectors.
+ * Unlike SparseSetValue, there is no fixed universe: the vector grows as
+ * needed to accommodate the largest element. The cost of the binary
+ * operations is linear in the size of the universe rather than in the number
+ * of elements, which pays off when the sets are dense, e.g., the sets of live
+ * registers of a method.
+ */
+template <typename IntegerType>
+class BitVectorSetValue final
+    : public PowersetImplementation<IntegerType,
+                                    BitVectorElements<IntegerType>,
+                                    BitVectorSetValue<IntegerType>> {
+ public:
+  BitVectorSetValue() = default;
+
+  // Preallocates space for the elements {0, ..., max_size-1}.
+  explicit BitVectorSetValue(size_t max_size) : m_words((max_size + 63) / 64) {}
+
+  void clear() { std::fill(m_words.begin(), m_words.end(), 0); }
+
+  BitVectorElements<IntegerType> elements() const {
+    return BitVectorElements<IntegerType>(m_words.data(), m_words.size());
+  }
+
+  AbstractValueKind kind() const { return AbstractValueKind::Value; }
+
+  bool contains(const IntegerType& element) const {
+    size_t index = element / 64;
+    return index < m_words.size() &&
+           ((m_words[index] >> (element % 64)) & 1) != 0;
+  }
+
+  bool leq(const BitVectorSetValue& other) const {
+    size_t n = std::min(m_words.size(), other.m_words.size());
+    return is_subset_words(m_words.data(), other.m_words.data(), n) &&
+           is_zero_words(m_words.data() + n, m_words.size() - n);
+  }
+
+  bool equals(const BitVectorSetValue& other) const {
+    size_t n = std::min(m_words.size(), other.m_words.size());
+    return std::equal(m_words.begin(), m_words.begin() + n,
+                      other.m_words.begin()) &&
+           is_zero_words(m_words.data() + n, m_words.size() - n) &&
+           is_zero_words(other.m_words.data() + n, other.m_words.size() - n);
+  }
+
+  void add(const IntegerType& element) {
+    size_t index = element / 64;
+    if (index >= m_words.size()) {
+      m_words.resize(index + 1);
+    }
+    m_words[index] |= uint64_t(1) << (element % 64);
+  }
+
+  void add(IntegerType&& element) {
+    add(static_cast<const IntegerType&>(element));
+  }
+
+  void remove(const IntegerType& element) {
+    size_t index = element / 64;
+    if (index < m_words.size()) {
+      m_words[index] &= ~(uint64_t(1) << (element % 64));
+    }
+  }
+
+  AbstractValueKind join_with(const BitVectorSetValue& other) {
+    if (other.m_words.size() > m_words.size()) {
+      m_words.resize(other.m_words.size());
+    }
+    or_words(m_words.data(), other.m_words.data(), other.m_words.size());
+    return AbstractValueKind::Value;
+  }
+
+  AbstractValueKind meet_with(const BitVectorSetValue& other) {
+    if (other.m_words.size() < m_words.size()) {
+      m_words.resize(other.m_words.size());
+    }
+    and_words(m_words.data(), other.m_words.data(), m_words.size());
+    return AbstractValueKind::Value;
+  }
+
+  AbstractValueKind difference_with(const BitVectorSetValue& other) {
+    andnot_words(m_words.data(), other.m_words.data(),
+                 std::min(m_words.size(), other.m_words.size()));
+    return AbstractValueKind::Value;
+  }
+
+  bool empty() const { return is_zero_words(m_words.data(), m_words.size()); }
+
+  size_t size() const {
+    size_t count = 0;
+    for (auto word : m_words) {
+      count += __builtin_popcountll(word);
+    }
+    return count;
+  }
+
+  friend std::ostream& operator<<(std::ostream& o,
+                                  const BitVectorSetValue& value) {
+    o << "[#" << value.size() << "]";
+    o << "{";
+    bool first = true;
+    for (auto e : value.elements()) {
+      if (!first) {
+        o << ", ";
+      }
+      o << e;
+      first = false;
+    }
+    o << "}";
+    return o;
+  }
+
+ private:
+  std::vector<uint64_t> m_words;
+};
+
+} // namespace bvsad_impl
+
+/*
+ * A powerset abstract domain over small unsigned integers, represented as bit
+ * vectors. The default constructor produces the empty set.
+ */
+template <typename IntegerType>
+class BitVectorSetAbstractDomain final
+    : public PowersetAbstractDomain<
+          IntegerType,
+          bvsad_impl::BitVectorSetValue<IntegerType>,
+          bvsad_impl::BitVectorElements<IntegerType>,
+          BitVectorSetAbstractDomain<IntegerType>> {
+ public:
+  using Value = bvsad_impl::BitVectorSetValue<IntegerType>;
+  using Elements = bvsad_impl::BitVectorElements<IntegerType>;
+
+  static_assert(std::is_unsigned_v<IntegerType>,
+                "IntegerType is not an unsigned arithmetic type");
+
+  BitVectorSetAbstractDomain()
+      : PowersetAbstractDomain<IntegerType,
+                               Value,
+                               Elements,
+                               BitVectorSetAbstractDomain>() {}
+
+  explicit BitVectorSetAbstractDomain(AbstractValueKind kind)
+      : PowersetAbstractDomain<IntegerType,
+                               Value,
+                               Elements,
+                               BitVectorSetAbstractDomain>(kind) {}
+
+  explicit BitVectorSetAbstractDomain(IntegerType e) { this->add(e); }
+
+  explicit BitVectorSetAbstractDomain(std::initializer_list<IntegerType> l) {
+    this->add(l.begin(), l.end());
+  }
+
+  static BitVectorSetAbstractDomain bottom() {
+    return BitVectorSetAbstractDomain(AbstractValueKind::Bottom);
+  }
+
+  static BitVectorSetAbstractDomain top() {
+    return BitVectorSetAbstractDomain(AbstractValueKind::Top);
+  }
+};
+
+} // namespace sparta
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <iterator>
 #include <limits>
 #include <ostream>
 
@@ -186,6 +188,50 @@ class IntervalDomain final : public AbstractDomain<IntervalDomain<Num>> {
     }
   }
 
+  /*
+   * Widening with thresholds: an unstable bound is only relaxed up to the
+   * nearest of the `thresholds` that covers it, typically the constants that
+   * appear in the program, rather than straight to infinity. Since there are
+   * finitely many thresholds, increasing sequences still stabilize.
+   *
+   *   [a,b] W_T [c,d] = [ c < a ? max{t in T | t <= c} : a
+   *                     , b < d ? min{t in T | d <= t} : b]
+   *
+   * where the max and min of an empty set are -inf and +inf respectively.
+   * `thresholds` must be sorted in increasing order.
+   */
+  template <typename Thresholds>
+  void widen_with_thresholds(const IntervalDomain& that,
+                             const Thresholds& thresholds) {
+    if (is_bottom()) {
+      *this = that;
+      return;
+    }
+    if (that.is_bottom()) {
+      return;
+    }
+
+    if (that.m_lb < m_lb) {
+      auto it = std::upper_bound(thresholds.begin(), thresholds.end(),
+                                 that.m_lb);
+      m_lb = it == thresholds.begin() ? MIN : *std::prev(it);
+    }
+
+    if (m_ub < that.m_ub) {
+      auto it = std::lower_bound(thresholds.begin(), thresholds.end(),
+                                 that.m_ub);
+      m_ub = it == thresholds.end() ? MAX : *it;
+    }
+  }
+
+  template <typename Thresholds>
+  IntervalDomain widening_with_thresholds(const IntervalDomain& that,
+                                          const Thresholds& thresholds) const {
+    auto cpy = *this;
+    cpy.widen_with_thresholds(that, thresholds);
+    return cpy;
+  }
+
   /*
    *   _|_  /\   _   = _|_
    *    _   /\  _|_  = _|_
@@ -8,11 +8,14 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <functional>
 #include <iterator>
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <sparta/AbstractDomain.h>
@@ -23,6 +26,33 @@
 
 namespace sparta {
 
+/*
+ * Limits on the work done by a single run of a fixpoint iterator, where zero
+ * means unlimited. Once the components of the graph have been extrapolated
+ * `max_iterations` times in total, or once `time_limit` has elapsed since the
+ * start of the run, the entry state of every component that has not yet
+ * stabilized is set to Top. This is always a post-fixpoint, so the component
+ * stabilizes at the next iteration, at the cost of precision.
+ */
+struct FixpointIterationBudget {
+  uint32_t max_iterations{0};
+  std::chrono::milliseconds time_limit{0};
+};
+
+/*
+ * Statistics on the last run of a fixpoint iterator.
+ */
+struct FixpointIterationStats {
+  uint32_t extrapolations{0};
+  // Number of components set to Top because a limit was reached.
+  uint32_t iteration_budget_hits{0};
+  uint32_t time_budget_hits{0};
+
+  bool budget_exceeded() const {
+    return iteration_budget_hits != 0 || time_budget_hits != 0;
+  }
+};
+
 namespace fp_impl {
 
 /*
@@ -60,8 +90,9 @@ class MonotonicFixpointIteratorContext final {
   explicit MonotonicFixpointIteratorContext(const Domain& init)
       : m_init(init) {}
 
-  explicit MonotonicFixpointIteratorContext(
-      const Domain& init, const std::unordered_set<NodeId>& nodes)
+  template <typename Nodes>
+  explicit MonotonicFixpointIteratorContext(const Domain& init,
+                                            const Nodes& nodes)
       : m_init(init) {
     // Pre-populate hash table for all the nodes.
     for (auto& node : nodes) {
@@ -90,8 +121,39 @@ class MonotonicFixpointIteratorContext final {
     m_local_iterations[node] = 0;
   }
 
+  /*
+   * Accounts for one more extrapolation step, and returns whether it goes
+   * over the budget. This may be called concurrently.
+   */
+  bool exceeds_budget(const FixpointIterationBudget& budget) {
+    uint32_t extrapolations = ++m_extrapolations;
+    if (budget.max_iterations != 0 && extrapolations > budget.max_iterations) {
+      ++m_iteration_budget_hits;
+      return true;
+    }
+    if (budget.time_limit.count() != 0 &&
+        std::chrono::steady_clock::now() - m_start > budget.time_limit) {
+      ++m_time_budget_hits;
+      return true;
+    }
+    return false;
+  }
+
+  FixpointIterationStats get_stats() const {
+    FixpointIterationStats stats;
+    stats.extrapolations = m_extrapolations;
+    stats.iteration_budget_hits = m_iteration_budget_hits;
+    stats.time_budget_hits = m_time_budget_hits;
+    return stats;
+  }
+
  private:
   const Domain& m_init;
+  const std::chrono::steady_clock::time_point m_start{
+      std::chrono::steady_clock::now()};
+  std::atomic<uint32_t> m_extrapolations{0};
+  std::atomic<uint32_t> m_iteration_budget_hits{0};
+  std::atomic<uint32_t> m_time_budget_hits{0};
   std::unordered_map<NodeId, uint32_t, NodeHash> m_global_iterations;
   std::unordered_map<NodeId, uint32_t, NodeHash> m_local_iterations;
 };
@@ -144,6 +206,18 @@ class MonotonicFixpointIteratorBase
     }
   }
 
+  /*
+   * Sets the limits on the work done by each subsequent run. There are none
+   * by default.
+   */
+  void set_budget(const FixpointIterationBudget& budget) { m_budget = budget; }
+
+  /*
+   * Returns how much work the last run did, and how often it went over
+   * budget.
+   */
+  const FixpointIterationStats& get_stats() const { return m_stats; }
+
   /*
    * Returns the invariant computed by the fixpoint iterator at a node entry.
    */
@@ -209,12 +283,132 @@ class MonotonicFixpointIteratorBase
     this->analyze_node(node, &exit_state);
   }
 
+  // Applies the user's extrapolation, unless the budget is exhausted.
+  void extrapolate_within_budget(Context* context,
+                                 const NodeId& head,
+                                 Domain* current_state,
+                                 const Domain& new_state) {
+    if (context->exceeds_budget(m_budget)) {
+      current_state->set_to_top();
+    } else {
+      this->extrapolate(*context, head, current_state, new_state);
+    }
+  }
+
   const Graph& m_graph;
   const Domain m_bottom_state = Domain::bottom();
   std::unordered_map<NodeId, Domain, NodeHash> m_entry_states;
   std::unordered_map<NodeId, Domain, NodeHash> m_exit_states;
+  FixpointIterationBudget m_budget;
+  FixpointIterationStats m_stats;
 };
 
+/*
+ * The concurrent fixpoint algorithm for Weak Partial Ordering, as described in
+ * https://dl.acm.org/ft_gateway.cfm?id=3371082. Shared by
+ * ParallelMonotonicFixpointIterator and the parallel mode of
+ * MonotonicFixpointIterator; the entry and exit states of all the nodes, as
+ * well as the iteration counts of the context, must have been pre-populated,
+ * so that the hash tables are not modified concurrently.
+ */
+template <typename Domain, typename Iterator, typename WPO>
+void run_wpo_in_parallel(Iterator* iterator,
+                         const WPO& wpo,
+                         typename Iterator::Context* context,
+                         size_t num_threads) {
+  using NodeId = typename Iterator::NodeId;
+  std::unique_ptr<std::atomic<uint32_t>[]> wpo_counter(
+      new std::atomic<uint32_t>[wpo.size()]);
+  std::fill_n(wpo_counter.get(), wpo.size(), 0);
+  auto entry_idx = wpo.get_entry();
+  assert(wpo.get_num_preds(entry_idx) == 0);
+  // Prepare work queue.
+  auto wq = sparta::work_queue<uint32_t>(
+      [context, &entry_idx, &wpo_counter, &wpo, iterator](
+          WorkerState<uint32_t>* worker_state, uint32_t wpo_idx) {
+        std::atomic<uint32_t>& current_counter = wpo_counter[wpo_idx];
+        assert(current_counter == wpo.get_num_preds(wpo_idx));
+        current_counter = 0;
+        // NonExit node
+        if (!wpo.is_exit(wpo_idx)) {
+          iterator->analyze_vertex(context, wpo.get_node(wpo_idx));
+          for (auto succ_idx : wpo.get_successors(wpo_idx)) {
+            std::atomic<uint32_t>& succ_counter = wpo_counter[succ_idx];
+            // Increase succ node's counter, push succ nodes in work queue if
+            // their counter number matches their NumSchedPreds.
+            if (++succ_counter == wpo.get_num_preds(succ_idx)) {
+              worker_state->push_task(succ_idx);
+            }
+          }
+          return nullptr;
+        }
+        // Exit node
+        // Check if component of the exit node has stabilized.
+        auto head_idx = wpo.get_head_of_exit(wpo_idx);
+        NodeId head = wpo.get_node(head_idx);
+        Domain* current_state = &iterator->m_entry_states[head];
+        Domain new_state = Domain::bottom();
+        iterator->compute_entry_state(context, head, &new_state);
+        if (new_state.leq(*current_state)) {
+          // Component stabilized.
+          context->reset_local_iteration_count_for(head);
+          *current_state = std::move(new_state);
+          for (auto succ_idx : wpo.get_successors(wpo_idx)) {
+            std::atomic<uint32_t>& succ_counter = wpo_counter[succ_idx];
+            // Increase succ node's counter, push succ nodes in work queue if
+            // their counter number matches their NumSchedPreds.
+            if (++succ_counter == wpo.get_num_preds(succ_idx)) {
+              worker_state->push_task(succ_idx);
+            }
+          }
+        } else {
+          // Component didn't stabilize.
+          iterator->extrapolate_within_budget(
+              context, head, current_state, new_state);
+          context->increase_iteration_count_for(head);
+          // Set component nodes v's counter to their
+          // NumOuterSchedPreds(v, wpo_idx)
+          for (auto pred_pair : wpo.get_num_outer_preds(wpo_idx)) {
+            auto component_idx = pred_pair.first;
+            assert(component_idx != entry_idx);
+            std::atomic<uint32_t>& component_counter =
+                wpo_counter[component_idx];
+            // Push component nodes in work queue if their counter number
+            // matches their NumSchedPreds.
+
+            // Note: On page 10, https://dl.acm.org/ft_gateway.cfm?id=3371082
+            // suggests to set the counter to be *equal* to the number of
+            // predecessors not in our component. However, that is only
+            // correct when all counter updates of a scheduling step are done
+            // together as a single atomic update. Instead, we choose to
+            // update point-wise, in which case we have to *add* the number of
+            // predecessors, and update our own counter to 0 before updating
+            // any other dependent counters.
+            if ((component_counter += pred_pair.second) ==
+                wpo.get_num_preds(component_idx)) {
+              worker_state->push_task(component_idx);
+            }
+          }
+          if (head_idx == entry_idx) {
+            // Handle special case when there is a loop on entry node.
+            // Because entry node have num_preds = 0, and for
+            // get_num_outer_preds the nodes with num_outer_preds are ignored.
+            // So we need to manually add entry node back to work queue if
+            // the component didn't stabilize.
+            worker_state->push_task(head_idx);
+          }
+        }
+        return nullptr;
+      },
+      num_threads,
+      /*push_tasks_while_running=*/true);
+  wq.add_item(wpo.get_entry());
+  wq.run_all();
+  for (uint32_t idx = 0; idx < wpo.size(); ++idx) {
+    assert(wpo_counter[idx] == 0);
+  }
+}
+
 template <typename GraphInterface, typename NodeHash>
 class SuccessorNodeListBuilder {
   using Graph = typename GraphInterface::Graph;
@@ -307,6 +501,7 @@ class WTOMonotonicFixpointIterator
     for (const WtoComponent<NodeId>& component : m_wto) {
       analyze_component(&context, component);
     }
+    this->m_stats = context.get_stats();
   }
 
  private:
@@ -347,7 +542,8 @@ class WTOMonotonicFixpointIterator
         *current_state = std::move(new_state);
         iterate = false;
       } else {
-        this->extrapolate(*context, head, current_state, new_state);
+        this->extrapolate_within_budget(
+            context, head, current_state, new_state);
       }
     }
   }
@@ -386,7 +582,8 @@ class ParallelMonotonicFixpointIterator
         m_wpo(
             GraphInterface::entry(graph),
             fp_impl::SuccessorNodeListBuilder<GraphInterface, NodeHash>(graph),
-            false),
+            false,
+            num_thread),
         m_num_thread(num_thread) {
     // Gathering all reachable nodes in graph.
     std::stack<NodeId> node_queue;
@@ -458,95 +655,8 @@ class ParallelMonotonicFixpointIterator
   void run(const Domain& init) {
     this->set_all_to_bottom();
     Context context(init, m_all_nodes);
-    std::unique_ptr<std::atomic<uint32_t>[]> wpo_counter(
-        new std::atomic<uint32_t>[m_wpo.size()]);
-    std::fill_n(wpo_counter.get(), m_wpo.size(), 0);
-    auto entry_idx = m_wpo.get_entry();
-    assert(m_wpo.get_num_preds(entry_idx) == 0);
-    // Prepare work queue.
-    auto wq = sparta::work_queue<uint32_t>(
-        [&context, &entry_idx, &wpo_counter, this](WPOWorkerState* worker_state,
-                                                   uint32_t wpo_idx) {
-          std::atomic<uint32_t>& current_counter = wpo_counter[wpo_idx];
-          assert(current_counter == m_wpo.get_num_preds(wpo_idx));
-          current_counter = 0;
-          // NonExit node
-          if (!m_wpo.is_exit(wpo_idx)) {
-            this->analyze_vertex(&context, m_wpo.get_node(wpo_idx));
-            for (auto succ_idx : m_wpo.get_successors(wpo_idx)) {
-              std::atomic<uint32_t>& succ_counter = wpo_counter[succ_idx];
-              // Increase succ node's counter, push succ nodes in work queue if
-              // their counter number matches their NumSchedPreds.
-              if (++succ_counter == m_wpo.get_num_preds(succ_idx)) {
-                worker_state->push_task(succ_idx);
-              }
-            }
-            return nullptr;
-          }
-          // Exit node
-          // Check if component of the exit node has stabilized.
-          auto head_idx = m_wpo.get_head_of_exit(wpo_idx);
-          NodeId head = m_wpo.get_node(head_idx);
-          Domain* current_state = &this->m_entry_states[head];
-          Domain new_state = Domain::bottom();
-          this->compute_entry_state(&context, head, &new_state);
-          if (new_state.leq(*current_state)) {
-            // Component stabilized.
-            context.reset_local_iteration_count_for(head);
-            *current_state = std::move(new_state);
-            for (auto succ_idx : m_wpo.get_successors(wpo_idx)) {
-              std::atomic<uint32_t>& succ_counter = wpo_counter[succ_idx];
-              // Increase succ node's counter, push succ nodes in work queue if
-              // their counter number matches their NumSchedPreds.
-              if (++succ_counter == m_wpo.get_num_preds(succ_idx)) {
-                worker_state->push_task(succ_idx);
-              }
-            }
-          } else {
-            // Component didn't stabilize.
-            this->extrapolate(context, head, current_state, new_state);
-            context.increase_iteration_count_for(head);
-            // Set component nodes v's counter to their
-            // NumOuterSchedPreds(v, wpo_idx)
-            for (auto pred_pair : m_wpo.get_num_outer_preds(wpo_idx)) {
-              auto component_idx = pred_pair.first;
-              assert(component_idx != entry_idx);
-              std::atomic<uint32_t>& component_counter =
-                  wpo_counter[component_idx];
-              // Push component nodes in work queue if their counter number
-              // matches their NumSchedPreds.
-
-              // Note: On page 10, https://dl.acm.org/ft_gateway.cfm?id=3371082
-              // suggests to set the counter to be *equal* to the number of
-              // predecessors not in our component. However, that is only
-              // correct when all counter updates of a scheduling step are done
-              // together as a single atomic update. Instead, we choose to
-              // update point-wise, in which case we have to *add* the number of
-              // predecessors, and update our own counter to 0 before updating
-              // any other dependent counters.
-              if ((component_counter += pred_pair.second) ==
-                  m_wpo.get_num_preds(component_idx)) {
-                worker_state->push_task(component_idx);
-              }
-            }
-            if (head_idx == entry_idx) {
-              // Handle special case when there is a loop on entry node.
-              // Because entry node have num_preds = 0, and for
-              // get_num_outer_preds the nodes with num_outer_preds are ignored.
-              // So we need to manually add entry node back to work queue if
-              // the component didn't stabilize.
-              worker_state->push_task(head_idx);
-            }
-          }
-          return nullptr;
-        },
-        m_num_thread,
-        /*push_tasks_while_running=*/true);
-    wq.add_item(m_wpo.get_entry());
-    wq.run_all();
-    for (uint32_t idx = 0; idx < m_wpo.size(); ++idx) {
-      assert(wpo_counter[idx] == 0);
-    }
+    fp_impl::run_wpo_in_parallel<Domain>(this, m_wpo, &context, m_num_thread);
+    this->m_stats = context.get_stats();
   }
 
  private:
@@ -585,6 +695,21 @@ class MonotonicFixpointIterator
             fp_impl::SuccessorNodeListBuilder<GraphInterface, NodeHash>(graph),
             false) {}
 
+  /*
+   * Analyzes graphs whose weak partial ordering has at least `min_size`
+   * elements with `num_threads` threads, using the same algorithm as
+   * ParallelMonotonicFixpointIterator: independent components, such as the
+   * cases of a huge switch, are then stabilized concurrently. Smaller graphs
+   * are still analyzed sequentially, as scheduling would cost more than it
+   * saves. In that mode, the node and edge transformers, as well as
+   * `extrapolate`, are invoked concurrently and must be thread-safe. The
+   * result of the analysis is the same in both modes.
+   */
+  void set_parallel_mode(size_t num_threads, size_t min_size) {
+    m_num_threads = num_threads;
+    m_parallel_min_size = min_size;
+  }
+
   /*
    * Executes the fixpoint iterator given an abstract value describing the
    * initial program configuration. This method can be invoked multiple times
@@ -593,6 +718,10 @@ class MonotonicFixpointIterator
    */
   void run(const Domain& init) {
     this->clear();
+    if (m_num_threads > 1 && m_wpo.size() >= m_parallel_min_size) {
+      run_in_parallel(init);
+      return;
+    }
     Context context(init);
     std::unique_ptr<std::atomic<uint32_t>[]> wpo_counter(
         new std::atomic<uint32_t>[m_wpo.size()]);
@@ -636,7 +765,8 @@ class MonotonicFixpointIterator
         }
       } else {
         // Component didn't stabilize.
-        this->extrapolate(context, head, current_state, new_state);
+        this->extrapolate_within_budget(
+            &context, head, current_state, new_state);
         context.increase_iteration_count_for(head);
         // Set component nodes v's counter to their
         // NumOuterSchedPreds(v, wpo_idx)
@@ -671,11 +801,35 @@ class MonotonicFixpointIterator
     for (uint32_t idx = 0; idx < m_wpo.size(); ++idx) {
       assert(wpo_counter[idx] == 0);
     }
+    this->m_stats = context.get_stats();
   }
 
  private:
+  void run_in_parallel(const Domain& init) {
+    // The nodes of the ordering are exactly the nodes reachable from the
+    // entry. Pre-populate all the tables that are updated concurrently.
+    std::vector<NodeId> nodes;
+    nodes.reserve(m_wpo.size());
+    for (uint32_t idx = 0; idx < m_wpo.size(); ++idx) {
+      if (!m_wpo.is_exit(idx)) {
+        nodes.push_back(m_wpo.get_node(idx));
+      }
+    }
+    this->m_entry_states.reserve(nodes.size());
+    this->m_exit_states.reserve(nodes.size());
+    for (auto& node : nodes) {
+      this->m_entry_states.emplace(node, Domain::bottom());
+      this->m_exit_states.emplace(node, Domain::bottom());
+    }
+    Context context(init, nodes);
+    fp_impl::run_wpo_in_parallel<Domain>(this, m_wpo, &context, m_num_threads);
+    this->m_stats = context.get_stats();
+  }
+
   WeakPartialOrdering<NodeId, NodeHash, /*Support_is_from_outside=*/false>
       m_wpo;
+  size_t m_num_threads{1};
+  size_t m_parallel_min_size{0};
 };
 
 /*
@@ -7,14 +7,18 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
 #include <limits>
+#include <mutex>
 #include <stack>
 #include <tuple>
 #include <type_traits>
+#include <unordered_set>
 #include <utility>
 
 #include <boost/functional/hash.hpp>
@@ -99,6 +103,9 @@ class PatriciaTreeLeaf;
 template <typename IntegerType, typename Value>
 class PatriciaTreeBranch;
 
+template <typename IntegerType, typename Value>
+class HashConsingTable;
+
 /*
  * Base node common to branches and leafs.
  */
@@ -121,6 +128,12 @@ class PatriciaTreeNode {
 
   bool is_branch() const { return !is_leaf(); }
 
+  // Whether this node is the representative of its structure in the
+  // HashConsingTable. Structurally equal canonical trees are pointer-equal.
+  bool is_canonical() const {
+    return m_reference_count.load(std::memory_order_relaxed) & CANONICAL_MASK;
+  }
+
   // Returns nullptr if this node is not a leaf.
   const LeafType* as_leaf() const {
     return is_leaf() ? static_cast<const LeafType*>(this) : nullptr;
@@ -190,16 +203,30 @@ class PatriciaTreeNode {
   friend void intrusive_ptr_release(const PatriciaTreeNode* p) {
     size_t prev_reference_count =
         p->m_reference_count.fetch_sub(1, std::memory_order_release);
-    const bool is_unique = (prev_reference_count & ~LEAF_MASK) == 1;
+    const bool is_unique =
+        (prev_reference_count & ~(LEAF_MASK | CANONICAL_MASK)) == 1;
     if (is_unique) {
       intrusive_ptr_delete(p);
     }
   }
 
+  size_t use_count() const {
+    return m_reference_count.load(std::memory_order_relaxed) &
+           ~(LEAF_MASK | CANONICAL_MASK);
+  }
+
+  void set_canonical() const {
+    m_reference_count.fetch_or(CANONICAL_MASK, std::memory_order_relaxed);
+  }
+
   // We are stealing the highest bit of our reference counter to indicate
-  // whether this tree is a leaf (or, otherwise, branch).
+  // whether this tree is a leaf (or, otherwise, branch), and the next one to
+  // indicate whether it has been hash-consed.
   static constexpr size_t LEAF_MASK = ~(static_cast<size_t>(-1) >> 1);
+  static constexpr size_t CANONICAL_MASK = LEAF_MASK >> 1;
   mutable std::atomic<size_t> m_reference_count;
+
+  friend class HashConsingTable<IntegerType, Value>;
 };
 
 /*
@@ -1325,6 +1352,158 @@ inline intrusive_ptr<PatriciaTreeNode<IntegerType, Value>> erase_keys_matching(
   }
 }
 
+/*
+ * A process-wide table of canonical Patricia tree nodes, used to hash-cons
+ * trees on request (see `PatriciaTreeCore::intern`).
+ *
+ * Interning a tree replaces each of its nodes by the canonical node of the
+ * same structure, so that structurally equal trees end up pointer-equal. All
+ * the tree operations already short-circuit on pointer equality, which makes
+ * equality and inclusion checks between interned trees O(1) in the common
+ * case, and lets equal environments stored at many program points share their
+ * memory. Leaves are compared with `Value::equals`, branches by the addresses
+ * of their (canonical) subtrees, so interning only visits the nodes that are
+ * not canonical yet.
+ *
+ * The table holds a reference to its nodes. Nodes that nobody else refers to
+ * anymore are swept whenever a shard has doubled in size since the last sweep,
+ * so the table stays proportional to the number of live canonical nodes.
+ */
+template <typename IntegerType, typename Value>
+class HashConsingTable final {
+  using Node = PatriciaTreeNode<IntegerType, Value>;
+  using Leaf = PatriciaTreeLeaf<IntegerType, Value>;
+  using Branch = PatriciaTreeBranch<IntegerType, Value>;
+
+ public:
+  static HashConsingTable& get() {
+    static HashConsingTable table;
+    return table;
+  }
+
+  intrusive_ptr<Node> intern(intrusive_ptr<Node> tree) {
+    if (tree == nullptr || tree->is_canonical()) {
+      return tree;
+    }
+    if (const auto* branch = tree->as_branch()) {
+      auto left_tree = intern(branch->left_tree());
+      auto right_tree = intern(branch->right_tree());
+      if (left_tree != branch->left_tree() ||
+          right_tree != branch->right_tree()) {
+        tree = Branch::make(branch->prefix(),
+                            branch->branching_bit(),
+                            std::move(left_tree),
+                            std::move(right_tree));
+      }
+    }
+    auto& shard = m_shards[NodeHash{}(tree) % kNumShards];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.nodes.find(tree);
+    if (it != shard.nodes.end()) {
+      return *it;
+    }
+    if (shard.nodes.size() >= shard.next_sweep) {
+      sweep(&shard);
+    }
+    tree->set_canonical();
+    shard.nodes.insert(tree);
+    return tree;
+  }
+
+ private:
+  struct NodeHash {
+    size_t operator()(const intrusive_ptr<Node>& node) const {
+      size_t seed = 0;
+      if (const auto* leaf = node->as_leaf()) {
+        boost::hash_combine(seed, leaf->key());
+      } else {
+        const auto* branch = node->as_branch();
+        boost::hash_combine(seed, branch->prefix());
+        boost::hash_combine(seed, branch->branching_bit());
+        boost::hash_combine(seed, branch->left_tree().get());
+        boost::hash_combine(seed, branch->right_tree().get());
+      }
+      return seed;
+    }
+  };
+
+  struct NodeEqual {
+    bool operator()(const intrusive_ptr<Node>& x,
+                    const intrusive_ptr<Node>& y) const {
+      if (x == y) {
+        return true;
+      }
+      if (const auto* x_leaf = x->as_leaf()) {
+        const auto* y_leaf = y->as_leaf();
+        return y_leaf != nullptr && x_leaf->key() == y_leaf->key() &&
+               Value::equals(x_leaf->value(), y_leaf->value());
+      }
+      const auto* x_branch = x->as_branch();
+      const auto* y_branch = y->as_branch();
+      return y_branch != nullptr &&
+             x_branch->prefix() == y_branch->prefix() &&
+             x_branch->branching_bit() == y_branch->branching_bit() &&
+             x_branch->left_tree() == y_branch->left_tree() &&
+             x_branch->right_tree() == y_branch->right_tree();
+    }
+  };
+
+  static constexpr size_t kNumShards = 64;
+  static constexpr size_t kMinSweepSize = 1024;
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_set<intrusive_ptr<Node>, NodeHash, NodeEqual> nodes;
+    size_t next_sweep{kMinSweepSize};
+  };
+
+  // Only the table can hand out new references to nodes it holds the last
+  // reference to, and it does so under the lock of their shard.
+  static void sweep(Shard* shard) {
+    for (auto it = shard->nodes.begin(); it != shard->nodes.end();) {
+      if ((*it)->use_count() == 1) {
+        it = shard->nodes.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    shard->next_sweep = std::max(kMinSweepSize, 2 * shard->nodes.size());
+  }
+
+  std::array<Shard, kNumShards> m_shards;
+};
+
+/*
+ * A small direct-mapped cache of the results of a binary operation on
+ * Patricia trees, keyed by the pair of operands. It holds references to the
+ * operands and the result, so a matching pair of pointers always denotes the
+ * same pair of trees. It is thread-local and needs no synchronization.
+ */
+template <typename IntegerType, typename Value, typename Tag>
+class OperationMemoCache final {
+  using Node = PatriciaTreeNode<IntegerType, Value>;
+
+ public:
+  struct Entry {
+    bool valid{false};
+    intrusive_ptr<Node> left;
+    intrusive_ptr<Node> right;
+    intrusive_ptr<Node> result;
+  };
+
+  static Entry& get(const intrusive_ptr<Node>& left,
+                    const intrusive_ptr<Node>& right) {
+    thread_local std::array<Entry, kSize> entries;
+    size_t seed = 0;
+    boost::hash_combine(seed, left.get());
+    boost::hash_combine(seed, right.get());
+    return entries[seed % kSize];
+  }
+
+ private:
+  static constexpr size_t kSize = 256;
+};
+
 template <typename Key, typename Value>
 class PatriciaTreeCore {
  public:
@@ -1490,6 +1669,47 @@ class PatriciaTreeCore {
     return m_tree != old_tree;
   }
 
+  /*
+   * Hash-conses the tree, see HashConsingTable. This is optional: operations
+   * work the same on interned and non-interned trees, and a tree derived from
+   * an interned one is only partially interned.
+   */
+  inline void intern() {
+    m_tree = HashConsingTable<IntegerType, Value>::get().intern(
+        std::move(m_tree));
+  }
+
+  inline bool is_interned() const {
+    return m_tree == nullptr || m_tree->is_canonical();
+  }
+
+  /*
+   * Applies `operation`, which updates this tree from its current value and
+   * `other`, unless its result for the same operands is memoized. The result
+   * is interned. `Tag` identifies the operation: the same tag must always
+   * denote the same function of the two trees.
+   */
+  template <typename Tag, typename Operation>
+  inline void memoize(const PatriciaTreeCore& other, Operation&& operation) {
+    using Cache = OperationMemoCache<IntegerType, Value, Tag>;
+    {
+      const auto& entry = Cache::get(m_tree, other.m_tree);
+      if (entry.valid && entry.left == m_tree && entry.right == other.m_tree) {
+        m_tree = entry.result;
+        return;
+      }
+    }
+    auto left = m_tree;
+    operation();
+    intern();
+    // The operation may have used the cache recursively.
+    auto& entry = Cache::get(left, other.m_tree);
+    entry.valid = true;
+    entry.left = std::move(left);
+    entry.right = other.m_tree;
+    entry.result = m_tree;
+  }
+
   inline size_t hash() const { return m_tree == nullptr ? 0 : m_tree->hash(); }
 
   inline void clear() { m_tree.reset(); }
@@ -147,6 +147,26 @@ class PatriciaTreeMap final
     return m_core.reference_equals(other.m_core);
   }
 
+  /*
+   * Hash-conses the underlying tree (see pt_core::HashConsingTable), so that
+   * equal interned maps share their memory and compare in constant time.
+   */
+  void intern() { m_core.intern(); }
+
+  bool is_interned() const { return m_core.is_interned(); }
+
+  /*
+   * Applies `operation`, which updates this map from `other` (e.g., a
+   * `union_with` with a fixed combining function), unless its result for the
+   * same operands is memoized. See `pt_core::PatriciaTreeCore::memoize`.
+   */
+  template <typename Tag, typename Operation> // void(PatriciaTreeMap*)
+  PatriciaTreeMap& memoized(const PatriciaTreeMap& other,
+                            Operation&& operation) {
+    m_core.template memoize<Tag>(other.m_core, [&]() { operation(this); });
+    return *this;
+  }
+
   PatriciaTreeMap& insert_or_assign(Key key, mapped_type value) {
     m_core.upsert(key, keep_if_non_default(std::move(value)));
     return *this;
@@ -125,6 +125,14 @@ class PatriciaTreeSet final : public AbstractSet<PatriciaTreeSet<Element>> {
     return m_core.reference_equals(other.m_core);
   }
 
+  /*
+   * Hash-conses the underlying tree (see pt_core::HashConsingTable), so that
+   * equal interned sets share their memory and compare in constant time.
+   */
+  void intern() { m_core.intern(); }
+
+  bool is_interned() const { return m_core.is_interned(); }
+
   PatriciaTreeSet& insert(Element key) {
     m_core.upsert(key, Empty{});
     return *this;
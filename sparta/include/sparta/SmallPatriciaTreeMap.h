@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+#include <boost/container/small_vector.hpp>
+
+#include <sparta/AbstractMap.h>
+#include <sparta/AbstractMapValue.h>
+#include <sparta/FlatMap.h>
+#include <sparta/PatriciaTreeMap.h>
+#include <sparta/PatriciaTreeUtil.h>
+#include <sparta/PerfectForwardCapture.h>
+
+namespace sparta {
+namespace sptm_impl {
+template <typename Key, typename Value, typename ValueInterface>
+class SmallPatriciaTreeMapStaticAssert;
+}
+
+/*
+ * A map with the same interface and semantics as `PatriciaTreeMap`, which
+ * stores up to `InlineCapacity` bindings in a sorted array held inline, and
+ * only switches to a Patricia tree when it grows past that.
+ *
+ * Most abstract environments of an intraprocedural analysis only bind a
+ * handful of registers. For those, the inline array avoids allocating a tree
+ * node per binding, and copies, lookups and merges are linear scans over a
+ * contiguous block of memory.
+ *
+ * Once the map has grown past `InlineCapacity` it stays a tree until it is
+ * cleared. Operations that mix a small map and a tree first convert the small
+ * one, so they are slower than on two maps of the same kind.
+ */
+template <typename Key,
+          typename Value,
+          typename ValueInterface = pt_core::SimpleValue<Value>,
+          size_t InlineCapacity = 8>
+class SmallPatriciaTreeMap final
+    : public AbstractMap<
+          SmallPatriciaTreeMap<Key, Value, ValueInterface, InlineCapacity>>,
+      private sptm_impl::
+          SmallPatriciaTreeMapStaticAssert<Key, Value, ValueInterface> {
+ private:
+  using SmallVector =
+      boost::container::small_vector<std::pair<Key, Value>, InlineCapacity>;
+  using FlatMapT = FlatMap<Key,
+                           Value,
+                           ValueInterface,
+                           std::less<Key>,
+                           std::equal_to<Key>,
+                           SmallVector>;
+  using PatriciaTreeT = PatriciaTreeMap<Key, Value, ValueInterface>;
+  using Codec = pt_util::Codec<Key>;
+
+ public:
+  /*
+   * Iterates over either the inline array or the tree, whichever holds the
+   * bindings.
+   */
+  class Iterator final {
+   public:
+    // C++ iterator concept member types
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename PatriciaTreeT::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    Iterator() = default;
+
+    Iterator& operator++() {
+      if (m_in_tree) {
+        ++m_tree_it;
+      } else {
+        ++m_flat_it;
+      }
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      auto retval = *this;
+      ++(*this);
+      return retval;
+    }
+
+    bool operator==(const Iterator& other) const {
+      return m_in_tree == other.m_in_tree &&
+             (m_in_tree ? m_tree_it == other.m_tree_it
+                        : m_flat_it == other.m_flat_it);
+    }
+
+    bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+    reference operator*() const {
+      return m_in_tree ? *m_tree_it : *m_flat_it;
+    }
+
+    pointer operator->() const { return &(**this); }
+
+   private:
+    explicit Iterator(typename FlatMapT::iterator it)
+        : m_in_tree(false), m_flat_it(std::move(it)) {}
+
+    explicit Iterator(typename PatriciaTreeT::iterator it)
+        : m_in_tree(true), m_tree_it(std::move(it)) {}
+
+    bool m_in_tree{false};
+    typename FlatMapT::iterator m_flat_it;
+    typename PatriciaTreeT::iterator m_tree_it;
+
+    friend class SmallPatriciaTreeMap;
+  };
+
+  // C++ container concept member types
+  using key_type = Key;
+  using mapped_type = typename PatriciaTreeT::mapped_type;
+  using value_type = typename PatriciaTreeT::value_type;
+  using iterator = Iterator;
+  using const_iterator = iterator;
+  using difference_type = std::ptrdiff_t;
+  using size_type = size_t;
+  using const_reference = const value_type&;
+  using const_pointer = const value_type*;
+
+  using value_interface = ValueInterface;
+  constexpr static AbstractMapMutability mutability =
+      AbstractMapMutability::Immutable;
+
+  bool empty() const { return m_small.empty() && m_tree.empty(); }
+
+  size_t size() const { return is_tree() ? m_tree.size() : m_small.size(); }
+
+  size_t max_size() const { return m_tree.max_size(); }
+
+  // Whether the bindings are held in a Patricia tree rather than inline.
+  bool is_tree() const { return !m_tree.empty(); }
+
+  iterator begin() const {
+    return is_tree() ? Iterator(m_tree.begin()) : Iterator(m_small.begin());
+  }
+
+  iterator end() const {
+    return is_tree() ? Iterator(m_tree.end()) : Iterator(m_small.end());
+  }
+
+  const mapped_type& at(const Key& key) const {
+    return is_tree() ? m_tree.at(key) : m_small.at(key);
+  }
+
+  bool leq(const SmallPatriciaTreeMap& other) const {
+    if (!is_tree() && !other.is_tree()) {
+      return m_small.leq(other.m_small);
+    }
+    return as_tree().leq(other.as_tree());
+  }
+
+  bool equals(const SmallPatriciaTreeMap& other) const {
+    if (!is_tree() && !other.is_tree()) {
+      return m_small.equals(other.m_small);
+    }
+    if (is_tree() && other.is_tree()) {
+      return m_tree.equals(other.m_tree);
+    }
+    return as_tree().equals(other.as_tree());
+  }
+
+  /*
+   * See `PatriciaTreeMap::reference_equals`. Inline bindings have no identity,
+   * so they are compared by value.
+   */
+  bool reference_equals(const SmallPatriciaTreeMap& other) const {
+    if (is_tree() != other.is_tree()) {
+      return false;
+    }
+    return is_tree() ? m_tree.reference_equals(other.m_tree)
+                     : m_small.equals(other.m_small);
+  }
+
+  SmallPatriciaTreeMap& insert_or_assign(const Key& key, mapped_type value) {
+    if (is_tree()) {
+      m_tree.insert_or_assign(key, std::move(value));
+    } else {
+      m_small.insert_or_assign(key, std::move(value));
+      grow_if_needed();
+    }
+    return *this;
+  }
+
+  template <typename Operation> // mapped_type(const mapped_type&)
+  SmallPatriciaTreeMap& update(Operation&& operation, const Key& key) {
+    if (is_tree()) {
+      m_tree.update(std::forward<Operation>(operation), key);
+    } else {
+      m_small.update(
+          [&operation](mapped_type* value) { *value = operation(*value); },
+          key);
+      grow_if_needed();
+    }
+    return *this;
+  }
+
+  template <typename MappingFunction> // mapped_type(const mapped_type&)
+  bool transform(MappingFunction&& f) {
+    if (is_tree()) {
+      return m_tree.transform(std::forward<MappingFunction>(f));
+    }
+    bool changed = false;
+    m_small.transform([&f, &changed](mapped_type* value) {
+      auto new_value = f(*value);
+      if (!ValueInterface::equals(new_value, *value)) {
+        *value = std::move(new_value);
+        changed = true;
+      }
+    });
+    return changed;
+  }
+
+  /*
+   * Visit all key-value pairs.
+   * This does NOT allocate memory, unlike the iterators.
+   */
+  template <typename Visitor> // void(const value_type&)
+  void visit(Visitor&& visitor) const {
+    if (is_tree()) {
+      m_tree.visit(std::forward<Visitor>(visitor));
+    } else {
+      m_small.visit(std::forward<Visitor>(visitor));
+    }
+  }
+
+  SmallPatriciaTreeMap& remove(const Key& key) {
+    if (is_tree()) {
+      m_tree.remove(key);
+    } else {
+      m_small.remove(key);
+    }
+    return *this;
+  }
+
+  template <typename Predicate> // bool(const Key&, const mapped_type&)
+  SmallPatriciaTreeMap& filter(Predicate&& predicate) {
+    if (is_tree()) {
+      m_tree.filter(std::forward<Predicate>(predicate));
+    } else {
+      m_small.filter(std::forward<Predicate>(predicate));
+    }
+    return *this;
+  }
+
+  bool erase_all_matching(const Key& key_mask) {
+    if (is_tree()) {
+      return m_tree.erase_all_matching(key_mask);
+    }
+    auto size = m_small.size();
+    const auto& mask = Codec::encode(key_mask);
+    m_small.filter([&mask](const Key& key, const mapped_type&) {
+      return (mask & Codec::encode(key)) == 0;
+    });
+    return m_small.size() != size;
+  }
+
+  // Requires CombiningFunction to coerce to
+  // std::function<mapped_type(const mapped_type&, const mapped_type&)>
+  template <typename CombiningFunction>
+  SmallPatriciaTreeMap& union_with(CombiningFunction&& combine,
+                                   const SmallPatriciaTreeMap& other) {
+    if (!is_tree() && !other.is_tree()) {
+      m_small.union_with(mutable_combine(combine), other.m_small);
+      grow_if_needed();
+    } else {
+      become_tree();
+      m_tree.union_with(std::forward<CombiningFunction>(combine),
+                        other.as_tree());
+    }
+    return *this;
+  }
+
+  template <typename CombiningFunction>
+  SmallPatriciaTreeMap& intersection_with(CombiningFunction&& combine,
+                                          const SmallPatriciaTreeMap& other) {
+    if (!is_tree() && !other.is_tree()) {
+      m_small.intersection_with(mutable_combine(combine), other.m_small);
+    } else {
+      become_tree();
+      m_tree.intersection_with(std::forward<CombiningFunction>(combine),
+                               other.as_tree());
+    }
+    return *this;
+  }
+
+  // Requires that `combine(bottom, ...) = bottom`.
+  template <typename CombiningFunction>
+  SmallPatriciaTreeMap& difference_with(CombiningFunction&& combine,
+                                        const SmallPatriciaTreeMap& other) {
+    if (!is_tree() && !other.is_tree()) {
+      m_small.difference_with(mutable_combine(combine), other.m_small);
+    } else {
+      become_tree();
+      m_tree.difference_with(std::forward<CombiningFunction>(combine),
+                             other.as_tree());
+    }
+    return *this;
+  }
+
+  void clear() {
+    m_small.clear();
+    m_tree.clear();
+  }
+
+  friend std::ostream& operator<<(std::ostream& o,
+                                  const SmallPatriciaTreeMap& s) {
+    using namespace sparta;
+    o << "{";
+    for (auto it = s.begin(); it != s.end(); ++it) {
+      o << pt_util::deref(it->first) << " -> " << it->second;
+      if (std::next(it) != s.end()) {
+        o << ", ";
+      }
+    }
+    o << "}";
+    return o;
+  }
+
+ private:
+  // Adapts a combining function of `PatriciaTreeMap` to the in-place
+  // interface of `FlatMap`.
+  template <typename CombiningFunction>
+  static auto mutable_combine(CombiningFunction& combine) {
+    return [&combine](mapped_type* left, const mapped_type& right) {
+      *left = combine(*left, right);
+    };
+  }
+
+  // Returns the bindings as a tree, building one if they are held inline.
+  PatriciaTreeT as_tree() const {
+    if (is_tree()) {
+      return m_tree;
+    }
+    PatriciaTreeT tree;
+    for (const auto& binding : m_small) {
+      tree.insert_or_assign(binding.first, binding.second);
+    }
+    return tree;
+  }
+
+  void become_tree() {
+    if (!is_tree()) {
+      m_tree = as_tree();
+      m_small.clear();
+    }
+  }
+
+  void grow_if_needed() {
+    if (m_small.size() > InlineCapacity) {
+      become_tree();
+    }
+  }
+
+  // At most one of the two is non-empty.
+  FlatMapT m_small;
+  PatriciaTreeT m_tree;
+};
+
+namespace sptm_impl {
+template <typename Key, typename Value, typename ValueInterface>
+class SmallPatriciaTreeMapStaticAssert {
+ protected:
+  ~SmallPatriciaTreeMapStaticAssert() {
+    static_assert(std::is_same_v<Value, typename ValueInterface::type>,
+                  "Value must be equal to ValueInterface::type");
+    static_assert(std::is_base_of<AbstractMapValue<ValueInterface>,
+                                  ValueInterface>::value,
+                  "ValueInterface doesn't inherit from AbstractMapValue");
+    ValueInterface::check_interface();
+  }
+};
+} // namespace sptm_impl
+
+} // namespace sparta
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <sparta/AbstractEnvironment.h>
+#include <sparta/SmallPatriciaTreeMap.h>
+
+namespace sparta {
+
+/*
+ * An abstract environment based on `SmallPatriciaTreeMap`, for analyses where
+ * most environments only bind a few variables. It is a drop-in replacement
+ * for `PatriciaTreeMapAbstractEnvironment`.
+ *
+ * See `AbstractEnvironment` for more information.
+ */
+template <typename Variable, typename Domain, size_t InlineCapacity = 8>
+using SmallPatriciaTreeMapAbstractEnvironment =
+    AbstractEnvironment<SmallPatriciaTreeMap<Variable,
+                                             Domain,
+                                             TopValueInterface<Domain>,
+                                             InlineCapacity>>;
+
+} // namespace sparta
@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <boost/pending/disjoint_sets.hpp>
 #include <cstddef>
 #include <functional>
@@ -33,6 +34,7 @@
 #include <vector>
 
 #include <sparta/Exceptions.h>
+#include <sparta/WorkQueue.h>
 
 namespace sparta {
 
@@ -48,6 +50,9 @@ namespace wpo_impl {
 template <typename NodeId, typename NodeHash, bool Support_is_from_outside>
 class WpoBuilder;
 
+template <typename NodeId, typename NodeHash, bool Support_is_from_outside>
+class ParallelWpoBuilder;
+
 } // end namespace wpo_impl
 
 /*
@@ -133,6 +138,9 @@ class WpoNode final {
 
   template <typename T1, typename T2, bool B>
   friend class wpo_impl::WpoBuilder;
+
+  template <typename T1, typename T2, bool B>
+  friend class wpo_impl::ParallelWpoBuilder;
 }; // end class WpoNode
 
 /*
@@ -181,6 +189,17 @@ class WeakPartialOrdering final {
       const NodeId& root,
       std::function<std::vector<NodeId>(const NodeId&)> successors,
       bool lift)
+      : WeakPartialOrdering(root, std::move(successors), lift, 1) {}
+
+  // Construct a WPO for the given CFG, building the WPOs of its strongly
+  // connected components on `num_threads` threads. The result is the same for
+  // any number of threads, and `successors` is only called from the calling
+  // thread.
+  WeakPartialOrdering(
+      const NodeId& root,
+      std::function<std::vector<NodeId>(const NodeId&)> successors,
+      bool lift,
+      size_t num_threads)
       : m_lifted(lift) {
     if (successors(root).empty()) {
       m_nodes.emplace_back(root, Type::Plain, /*size=*/1);
@@ -188,16 +207,23 @@ class WeakPartialOrdering final {
       m_post_dfn[root] = 1;
       return;
     }
-    wpo_impl::WpoBuilder<NodeId, NodeHash, Support_is_from_outside> builder(
-        successors, m_nodes, m_toplevel, m_post_dfn, lift);
-    builder.build(root);
+    if (num_threads <= 1) {
+      wpo_impl::WpoBuilder<NodeId, NodeHash, Support_is_from_outside> builder(
+          successors, m_nodes, m_toplevel, m_post_dfn, lift);
+      builder.build(root);
+    } else {
+      wpo_impl::ParallelWpoBuilder<NodeId, NodeHash, Support_is_from_outside>
+          builder(successors, m_nodes, m_toplevel, m_post_dfn, lift,
+                  num_threads);
+      builder.build(root);
+    }
   }
 
   // Total number of nodes in this wpo.
   uint32_t size() const { return m_nodes.size(); }
 
   // Entry node of this wpo.
-  WpoIdx get_entry() { return m_nodes.size() - 1; }
+  WpoIdx get_entry() const { return m_nodes.size() - 1; }
 
   // Successors of the node.
   const std::set<WpoIdx>& get_successors(WpoIdx idx) const {
@@ -309,21 +335,37 @@ class WpoBuilder final {
     construct_wpo();
     // Compute num_outer_preds.
     for (auto& p : m_for_outer_preds) {
-      auto& v = p.first;
-      auto& x_max = p.second;
-      auto h = m_wpo_space[v].is_head() ? v : m_parent[v];
-      // index of exit == index of head - 1.
-      auto x = h - 1;
-      while (x != x_max) {
-        m_wpo_space[x].inc_num_outer_preds(v);
-        h = m_parent[h];
-        x = h - 1;
-      }
-      m_wpo_space[x].inc_num_outer_preds(v);
+      inc_num_outer_preds(/*v=*/p.first, /*x_max=*/p.second);
     }
   }
 
+  // Once the WPO is built, accounts for a scheduling constraint to `node`
+  // from outside of the graph, e.g. when the graph is a component of a larger
+  // one. The constraint is an outer predecessor of all the components that
+  // contain `node`.
+  void add_outer_pred_from_outside(const NodeId& node) {
+    auto v = index_of(get_dfn(node));
+    // The root is the last node, right after its exit.
+    auto x_max = static_cast<WpoIdx>(m_wpo_space.size() - 2);
+    SPARTA_RUNTIME_CHECK(m_wpo_space[x_max].is_exit(), internal_error());
+    inc_num_outer_preds(v, x_max);
+  }
+
  private:
+  // Increments the number of outer predecessors of v of the exits of the
+  // components that contain v, up to x_max.
+  void inc_num_outer_preds(WpoIdx v, WpoIdx x_max) {
+    auto h = m_wpo_space[v].is_head() ? v : m_parent[v];
+    // index of exit == index of head - 1.
+    auto x = h - 1;
+    while (x != x_max) {
+      m_wpo_space[x].inc_num_outer_preds(v);
+      h = m_parent[h];
+      x = h - 1;
+    }
+    m_wpo_space[x].inc_num_outer_preds(v);
+  }
+
   // Construct auxilary data-structures.
   // Performs DFS iteratively to classify the edges and find lowest common
   // ancestors of cross/forward edges.
@@ -670,6 +712,359 @@ class WpoBuilder final {
   bool m_lift;
 }; // end class wpo_builder
 
+/*
+ * Builds the same WPO as `WpoBuilder`, but builds the WPOs of the maximal
+ * strongly connected components (SCCs) of the graph in parallel.
+ *
+ * A first depth-first search, which visits the nodes in the same order as the
+ * one of `WpoBuilder`, classifies the edges and finds the maximal SCCs with
+ * Tarjan's algorithm. A DFS restricted to a maximal SCC and started from its
+ * head visits the nodes of the SCC in the same order as the DFS of the whole
+ * graph, so the WPO that `WpoBuilder` computes for the SCC on its own is the
+ * one it computes for it as part of the whole graph. The WPOs of the SCCs are
+ * then placed at the indices the sequential construction would give them,
+ * and linked by the edges between the SCCs.
+ */
+template <typename NodeId, typename NodeHash, bool Support_is_from_outside>
+class ParallelWpoBuilder final {
+ private:
+  using WpoNodeT = WpoNode<NodeId>;
+  using Type = typename WpoNodeT::Type;
+  using WpoIdx = uint32_t;
+  using ComponentBuilder =
+      WpoBuilder<NodeId, NodeHash, /*Support_is_from_outside=*/false>;
+  // An edge between the DFNs of two nodes.
+  using Edge = std::pair<uint32_t, uint32_t>;
+
+  struct Component {
+    // DFN of the head.
+    uint32_t head;
+    // Number of nodes.
+    uint32_t size;
+    // Edges that enter and leave the component.
+    std::vector<Edge> in_edges;
+    std::vector<Edge> out_edges;
+    // The WPO of the component on its own, if it is not a single node
+    // without a self-loop.
+    std::vector<WpoNodeT> wpo;
+  };
+
+ public:
+  ParallelWpoBuilder(
+      std::function<std::vector<NodeId>(const NodeId&)> successors,
+      std::vector<WpoNodeT>& wpo_space,
+      std::vector<WpoIdx>& toplevel,
+      std::unordered_map<NodeId, uint32_t, NodeHash>& post_dfn,
+      bool lift,
+      size_t num_threads)
+      : m_successors(std::move(successors)),
+        m_wpo_space(wpo_space),
+        m_toplevel(toplevel),
+        m_post_dfn(post_dfn),
+        m_lift(lift),
+        m_num_threads(num_threads) {}
+
+  void build(const NodeId& root) {
+    find_components(root);
+    run_on_components([this](Component& component) {
+      if (is_trivial(component)) {
+        return;
+      }
+      build_component_wpo(component);
+    });
+    lay_out();
+    run_on_components(
+        [this](Component& component) { link_component(component); });
+    for (const auto& component : m_components) {
+      m_toplevel.push_back(index_of(component.head));
+    }
+  }
+
+ private:
+  // Iterative DFS, in the same order as `WpoBuilder::construct_auxilary`,
+  // which finds the maximal SCCs with Tarjan's algorithm. Nodes are
+  // identified by their DFNs, starting at 1.
+  void find_components(const NodeId& root) {
+    struct StackEntry {
+      NodeId vertex_ref;
+      uint32_t pred;
+      uint32_t finished_vertex;
+    };
+    std::stack<StackEntry> stack;
+    // The nodes whose SCC is not known yet.
+    std::vector<uint32_t> scc_stack;
+    std::vector<Edge> cross_edges;
+    // Index 0 does not stand for a node.
+    m_parent.push_back(0);
+    m_low.push_back(0);
+    m_component.push_back(0);
+    m_self_loop.push_back(false);
+    m_succs.emplace_back();
+    std::vector<bool> black{false};
+    std::vector<bool> on_scc_stack{false};
+
+    stack.push(StackEntry{root, 0, 0});
+    while (!stack.empty()) {
+      auto [vertex_ref, pred, finished_vertex] = stack.top();
+      stack.pop();
+
+      if (finished_vertex != 0) {
+        if (Support_is_from_outside) {
+          m_post_dfn[vertex_ref] = m_next_post_dfn++;
+        }
+        black[finished_vertex] = true;
+        if (m_low[finished_vertex] == finished_vertex) {
+          // This is the head of a maximal SCC.
+          uint32_t v;
+          do {
+            v = scc_stack.back();
+            scc_stack.pop_back();
+            on_scc_stack[v] = false;
+            m_component[v] = m_components.size();
+          } while (v != finished_vertex);
+          m_components.push_back(Component{finished_vertex, 0, {}, {}, {}});
+        }
+        if (pred != 0) {
+          m_low[pred] = std::min(m_low[pred], m_low[finished_vertex]);
+        }
+        continue;
+      }
+
+      if (get_dfn(vertex_ref) != 0) {
+        // A forward edge.
+        continue;
+      }
+      // New vertex is discovered.
+      uint32_t vertex = m_ref.size() + 1;
+      m_dfn[vertex_ref] = vertex;
+      m_ref.push_back(vertex_ref);
+      m_parent.push_back(pred);
+      m_low.push_back(vertex);
+      m_component.push_back(0);
+      m_self_loop.push_back(false);
+      black.push_back(false);
+      on_scc_stack.push_back(true);
+      scc_stack.push_back(vertex);
+
+      // This will be popped after all its successors are finished.
+      stack.push(StackEntry{vertex_ref, pred, vertex});
+
+      const auto& successors = m_succs.emplace_back(m_successors(vertex_ref));
+      for (auto rit = successors.rbegin(); rit != successors.rend(); ++rit) {
+        auto succ = get_dfn(*rit);
+        if (succ == 0) {
+          stack.push(StackEntry{*rit, vertex, 0});
+        } else if (black[succ]) {
+          // A cross edge.
+          if (on_scc_stack[succ]) {
+            m_low[vertex] = std::min(m_low[vertex], succ);
+          }
+          cross_edges.emplace_back(vertex, succ);
+        } else {
+          // A back edge.
+          m_low[vertex] = std::min(m_low[vertex], succ);
+          if (succ == vertex) {
+            m_self_loop[vertex] = true;
+          }
+        }
+      }
+    }
+
+    // Tarjan's algorithm finds the SCCs in reverse topological order. Number
+    // them by the DFNs of their heads instead, as the sequential
+    // construction does.
+    std::vector<uint32_t> heads;
+    heads.reserve(m_components.size());
+    for (const auto& component : m_components) {
+      heads.push_back(component.head);
+    }
+    std::sort(m_components.begin(), m_components.end(),
+              [](const Component& a, const Component& b) {
+                return a.head < b.head;
+              });
+    std::vector<uint32_t> component_of_head(m_ref.size() + 1);
+    for (uint32_t i = 0; i < m_components.size(); i++) {
+      component_of_head[m_components[i].head] = i;
+    }
+    for (uint32_t v = 1; v <= m_ref.size(); v++) {
+      m_component[v] = component_of_head[heads[m_component[v]]];
+      m_components[m_component[v]].size++;
+    }
+
+    // The edges between the SCCs, besides forward edges, are the tree edges
+    // to their heads and the cross edges.
+    auto add_edge = [this](uint32_t u, uint32_t v) {
+      m_components[m_component[u]].out_edges.emplace_back(u, v);
+      m_components[m_component[v]].in_edges.emplace_back(u, v);
+    };
+    for (const auto& component : m_components) {
+      if (m_parent[component.head] != 0) {
+        add_edge(m_parent[component.head], component.head);
+      }
+    }
+    for (const auto& [u, v] : cross_edges) {
+      if (m_component[u] != m_component[v]) {
+        add_edge(u, v);
+      }
+    }
+  }
+
+  template <typename Fn>
+  void run_on_components(const Fn& fn) {
+    auto wq = sparta::work_queue<uint32_t>(
+        [&](uint32_t i) { fn(m_components[i]); }, m_num_threads);
+    for (uint32_t i = 0; i < m_components.size(); i++) {
+      wq.add_item(i);
+    }
+    wq.run_all();
+  }
+
+  bool is_trivial(const Component& component) const {
+    return component.size == 1 && !m_self_loop[component.head];
+  }
+
+  void build_component_wpo(Component& component) {
+    auto c = m_component[component.head];
+    std::vector<WpoIdx> toplevel;
+    std::unordered_map<NodeId, uint32_t, NodeHash> post_dfn;
+    ComponentBuilder builder(
+        [this, c](const NodeId& node) {
+          std::vector<NodeId> succs;
+          for (const auto& succ : m_succs[m_dfn.at(node)]) {
+            if (m_component[m_dfn.at(succ)] == c) {
+              succs.push_back(succ);
+            }
+          }
+          return succs;
+        },
+        component.wpo, toplevel, post_dfn, m_lift);
+    builder.build(get_ref(component.head));
+
+    // The edges from other components are outer predecessors. Edges from
+    // the same component to the same node are only counted once.
+    std::unordered_set<uint64_t> seen;
+    for (const auto& [u, v] : component.in_edges) {
+      auto to = m_lift ? component.head : v;
+      if (seen.insert(uint64_t(m_component[u]) << 32 | to).second) {
+        builder.add_outer_pred_from_outside(get_ref(to));
+      }
+    }
+  }
+
+  // Gives the WPO nodes the indices the sequential construction gives them:
+  // in reverse DFS order, with the exit of a component right before its
+  // head.
+  void lay_out() {
+    std::vector<uint32_t> head_size(m_ref.size() + 1, 0);
+    for (const auto& component : m_components) {
+      for (const auto& node : component.wpo) {
+        if (node.is_head()) {
+          head_size[m_dfn.at(node.get_node())] = node.get_size();
+        }
+      }
+    }
+    m_index.resize(m_ref.size() + 1);
+    m_is_head.resize(m_ref.size() + 1);
+    m_wpo_space.reserve(m_ref.size() + m_components.size());
+    for (uint32_t v = m_ref.size(); v > 0; v--) {
+      m_index[v] = m_wpo_space.size();
+      if (head_size[v] != 0) {
+        m_is_head[v] = true;
+        m_wpo_space.emplace_back(get_ref(v), Type::Exit, head_size[v]);
+        m_wpo_space.emplace_back(get_ref(v), Type::Head, head_size[v]);
+      } else {
+        m_wpo_space.emplace_back(get_ref(v), Type::Plain, /*size=*/1);
+      }
+    }
+  }
+
+  // Copies the scheduling constraints within the component, and adds the
+  // ones between the component and others. Only modifies the nodes of the
+  // component.
+  void link_component(const Component& component) {
+    std::vector<WpoIdx> indices;
+    indices.reserve(component.wpo.size());
+    for (const auto& node : component.wpo) {
+      auto v = m_dfn.at(node.get_node());
+      indices.push_back(node.is_exit() ? m_index[v] : index_of(v));
+    }
+    for (WpoIdx i = 0; i < component.wpo.size(); i++) {
+      const auto& node = component.wpo[i];
+      auto& global_node = m_wpo_space[indices[i]];
+      for (auto succ : node.get_successors()) {
+        global_node.add_successor(indices[succ]);
+      }
+      for (auto pred : node.get_predecessors()) {
+        global_node.add_predecessor(indices[pred]);
+      }
+      if (node.is_exit()) {
+        for (const auto& [v, count] : node.get_num_outer_preds()) {
+          global_node.m_num_outer_preds[indices[v]] = count;
+        }
+      }
+    }
+
+    // Scheduling constraints start at the exits of the components.
+    for (const auto& [u, v] : component.in_edges) {
+      auto to = m_lift ? component.head : v;
+      m_wpo_space[index_of(to)].add_predecessor(
+          exit_of(m_components[m_component[u]]));
+    }
+    auto from = exit_of(component);
+    for (const auto& [u, v] : component.out_edges) {
+      auto to = m_lift ? m_components[m_component[v]].head : v;
+      m_wpo_space[from].add_successor(index_of(to));
+    }
+  }
+
+  WpoIdx index_of(uint32_t dfn) const {
+    return m_is_head[dfn] ? m_index[dfn] + 1 : m_index[dfn];
+  }
+
+  WpoIdx exit_of(const Component& component) const {
+    return m_index[component.head];
+  }
+
+  uint32_t get_dfn(const NodeId& n) const {
+    auto it = m_dfn.find(n);
+    if (it != m_dfn.end()) {
+      return it->second;
+    }
+    return 0;
+  }
+
+  const NodeId& get_ref(uint32_t num) const { return m_ref.at(num - 1); }
+
+  std::function<std::vector<NodeId>(const NodeId&)> m_successors;
+  // A reference to Wpo space (array of Wpo nodes).
+  std::vector<WpoNodeT>& m_wpo_space;
+  // A reference to Wpo space that contains only the top level nodes.
+  std::vector<WpoIdx>& m_toplevel;
+  // A reference to the map from NodeId to post DFN.
+  std::unordered_map<NodeId, uint32_t, NodeHash>& m_post_dfn;
+  // A map from NodeId to DFN.
+  std::unordered_map<NodeId, uint32_t, NodeHash> m_dfn;
+  // A map from DFN to NodeId.
+  std::vector<NodeId> m_ref;
+  // The following are indexed by DFN.
+  std::vector<std::vector<NodeId>> m_succs;
+  std::vector<uint32_t> m_parent;
+  // Lowest DFN reachable through the DFS subtree, as in Tarjan's algorithm.
+  std::vector<uint32_t> m_low;
+  // Index of the maximal SCC in m_components.
+  std::vector<uint32_t> m_component;
+  std::vector<bool> m_self_loop;
+  // Index of the WpoNode, or of the exit for heads.
+  std::vector<WpoIdx> m_index;
+  std::vector<bool> m_is_head;
+  // The maximal SCCs, by DFN of their heads.
+  std::vector<Component> m_components;
+  // Next post DFN to assign.
+  uint32_t m_next_post_dfn{1};
+  bool m_lift;
+  size_t m_num_threads;
+}; // end class ParallelWpoBuilder
+
 } // end namespace wpo_impl
 
 } // end namespace sparta
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <sparta/BitVectorSetAbstractDomain.h>
+
+#include <cstdint>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace sparta;
+
+using Domain = BitVectorSetAbstractDomain<uint32_t>;
+
+namespace {
+
+Domain difference(Domain a, const Domain& b) {
+  a.difference_with(b);
+  return a;
+}
+
+} // namespace
+
+TEST(BitVectorSetAbstractDomainTest, latticeOperations) {
+  Domain e1{1};
+  Domain e2{1, 2, 3};
+  Domain e3{2, 3, 4};
+  EXPECT_THAT(e1.elements(), ::testing::ElementsAre(1));
+  EXPECT_THAT(e2.elements(), ::testing::ElementsAre(1, 2, 3));
+  EXPECT_THAT(e3.elements(), ::testing::ElementsAre(2, 3, 4));
+  e3.add(4);
+  EXPECT_THAT(e3.elements(), ::testing::ElementsAre(2, 3, 4));
+
+  std::ostringstream out;
+  out << e2;
+  EXPECT_EQ("[#3]{1, 2, 3}", out.str());
+
+  EXPECT_TRUE(Domain::bottom().leq(Domain::top()));
+  EXPECT_FALSE(Domain::top().leq(Domain::bottom()));
+  EXPECT_FALSE(e2.is_top());
+  EXPECT_FALSE(e2.is_bottom());
+
+  Domain e4{3, 2, 1};
+  EXPECT_TRUE(e1.leq(e2));
+  EXPECT_FALSE(e1.leq(e3));
+  EXPECT_TRUE(e2.equals(e4));
+  EXPECT_FALSE(e2.equals(e3));
+
+  EXPECT_THAT(e2.join(e3).elements(), ::testing::ElementsAre(1, 2, 3, 4));
+  EXPECT_TRUE(e1.join(e2).equals(e2));
+  EXPECT_TRUE(e2.join(Domain::bottom()).equals(e2));
+  EXPECT_TRUE(e2.join(Domain::top()).is_top());
+  EXPECT_TRUE(e1.widening(e2).equals(e2));
+
+  EXPECT_THAT(e2.meet(e3).elements(), ::testing::ElementsAre(2, 3));
+  EXPECT_TRUE(e1.meet(e2).equals(e1));
+  EXPECT_TRUE(e2.meet(Domain::bottom()).is_bottom());
+  EXPECT_TRUE(e2.meet(Domain::top()).equals(e2));
+  EXPECT_FALSE(e1.meet(e3).is_bottom());
+  EXPECT_TRUE(e1.meet(e3).elements().empty());
+  EXPECT_TRUE(e1.narrowing(e2).equals(e1));
+
+  EXPECT_THAT(difference(e2, e3).elements(), ::testing::ElementsAre(1));
+
+  EXPECT_TRUE(e2.contains(1));
+  EXPECT_FALSE(e3.contains(1));
+  EXPECT_FALSE(e3.contains(1000));
+
+  // Making sure no side effect happened.
+  EXPECT_THAT(e1.elements(), ::testing::ElementsAre(1));
+  EXPECT_THAT(e2.elements(), ::testing::ElementsAre(1, 2, 3));
+  EXPECT_THAT(e3.elements(), ::testing::ElementsAre(2, 3, 4));
+}
+
+TEST(BitVectorSetAbstractDomainTest, differentCapacities) {
+  // Sets grow on demand, so their underlying vectors may have different
+  // lengths. Trailing zero words must not affect the comparisons.
+  Domain small{3};
+  Domain large{3, 700};
+  large.remove(700);
+  EXPECT_TRUE(small.equals(large));
+  EXPECT_TRUE(large.equals(small));
+  EXPECT_TRUE(large.leq(small));
+  EXPECT_EQ(large.size(), 1);
+
+  large.add(700);
+  EXPECT_TRUE(small.leq(large));
+  EXPECT_FALSE(large.leq(small));
+  EXPECT_THAT(small.join(large).elements(), ::testing::ElementsAre(3, 700));
+  EXPECT_THAT(large.meet(small).elements(), ::testing::ElementsAre(3));
+  EXPECT_THAT(difference(large, small).elements(), ::testing::ElementsAre(700));
+  EXPECT_TRUE(difference(small, large).empty());
+}
+
+TEST(BitVectorSetAbstractDomainTest, wordBoundaries) {
+  // Exercise both the vectorized and the scalar tails of the kernels.
+  Domain even;
+  Domain odd;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    (i % 2 == 0 ? even : odd).add(i);
+  }
+  EXPECT_EQ(even.size(), 500);
+  EXPECT_TRUE(even.meet(odd).empty());
+  auto all = even.join(odd);
+  EXPECT_EQ(all.size(), 1000);
+  EXPECT_TRUE(even.leq(all));
+  EXPECT_FALSE(all.leq(odd));
+  EXPECT_TRUE(difference(all, even).equals(odd));
+
+  std::vector<uint32_t> elements(odd.elements().begin(), odd.elements().end());
+  EXPECT_EQ(elements.size(), 500);
+  EXPECT_EQ(elements.front(), 1);
+  EXPECT_EQ(elements.back(), 999);
+}
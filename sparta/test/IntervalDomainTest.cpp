@@ -10,6 +10,7 @@
 #include <gtest/gtest.h>
 #include <limits>
 #include <sstream>
+#include <vector>
 
 using namespace sparta;
 
@@ -148,6 +149,40 @@ TEST(IntervalDomainTest, lattice) {
   EXPECT_EQ(top.narrowing(b).narrowing(a), Domain::finite(0, 4));
 }
 
+TEST(IntervalDomainTest, wideningWithThresholds) {
+  const std::vector<int> thresholds{-10, 0, 10, 100};
+  const auto bot = Domain::bottom();
+  const auto a = Domain::finite(1, 2);
+
+  EXPECT_EQ(bot.widening_with_thresholds(a, thresholds), a);
+  EXPECT_EQ(a.widening_with_thresholds(bot, thresholds), a);
+  EXPECT_EQ(a.widening_with_thresholds(Domain::finite(1, 1), thresholds), a);
+
+  // Unstable bounds move to the nearest threshold, or to infinity.
+  EXPECT_EQ(a.widening_with_thresholds(Domain::finite(1, 3), thresholds),
+            Domain::finite(1, 10));
+  EXPECT_EQ(a.widening_with_thresholds(Domain::finite(0, 10), thresholds),
+            Domain::finite(0, 10));
+  EXPECT_EQ(a.widening_with_thresholds(Domain::finite(-3, 101), thresholds),
+            Domain::bounded_below(-10));
+  EXPECT_EQ(a.widening_with_thresholds(Domain::finite(-11, 2), thresholds),
+            Domain::bounded_above(2));
+  EXPECT_EQ(a.widening_with_thresholds(Domain::finite(-11, 2),
+                                       std::vector<int>()),
+            a.widening(Domain::finite(-11, 2)));
+
+  // An increasing sequence stabilizes after a few steps.
+  auto x = Domain::finite(0, 0);
+  size_t steps = 0;
+  const auto one = Domain::finite(1, 1);
+  for (auto next = x + one; !next.leq(x); next = x + one) {
+    x.widen_with_thresholds(next.join(x), thresholds);
+    ++steps;
+  }
+  EXPECT_EQ(x, Domain::bounded_below(0));
+  EXPECT_EQ(steps, 3);
+}
+
 TEST(IntervalDomainTest, hash) {
   const auto top = Domain::top();
   const auto bot = Domain::bottom();
@@ -10,6 +10,7 @@
 #include <sparta/PatriciaTreeMapAbstractEnvironment.h>
 #include <sparta/PatriciaTreeSet.h>
 
+#include <chrono>
 #include <functional>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -749,6 +750,23 @@ class FixpointEngine final : public FixpointIteratorBase<
       const EdgeId&, const AbstractEnvironmentT& state) const override {
     return state;
   }
+
+  void extrapolate(const typename Base::Context& context,
+                   const NodeId& node,
+                   AbstractEnvironmentT* current_state,
+                   const AbstractEnvironmentT& new_state) const override {
+    if (m_join_only) {
+      current_state->join_with(new_state);
+    } else {
+      Base::extrapolate(context, node, current_state, new_state);
+    }
+  }
+
+  // Without widening, loops only stabilize when the budget runs out.
+  void set_join_only() { m_join_only = true; }
+
+ private:
+  bool m_join_only{false};
 };
 
 } // namespace numerical
@@ -860,3 +878,59 @@ TYPED_TEST(MonotonicFixpointIteratorNumericalTest, program2) {
             IntegerSetAbstractDomain::top());
   EXPECT_EQ(fp.get_exit_state_at(bb3).get(&x), IntegerSetAbstractDomain::top());
 }
+
+TYPED_TEST(MonotonicFixpointIteratorNumericalTest, budget) {
+  using namespace numerical;
+
+  /*
+   * bb1: x = 1;
+   *      while (...) {
+   * bb2:   x = x + 1;
+   *      }
+   * bb3: return
+   */
+  Program program;
+
+  BasicBlock* bb1 = program.create_block();
+  BasicBlock* bb2 = program.create_block();
+  BasicBlock* bb3 = program.create_block();
+
+  std::string x = "x";
+
+  bb1->add(std::make_unique<Assignment>(&x, 1));
+  bb1->add_successor(bb2);
+
+  bb2->add(std::make_unique<Addition>(&x, &x, 1));
+  bb2->add_successor(bb2);
+  bb2->add_successor(bb3);
+
+  program.set_entry(bb1);
+  program.set_exit(bb3);
+
+  TypeParam fp(program);
+  fp.run(AbstractEnvironmentT::top());
+  EXPECT_FALSE(fp.get_stats().budget_exceeded());
+  EXPECT_EQ(fp.get_stats().extrapolations, 2);
+
+  fp.set_join_only();
+  sparta::FixpointIterationBudget budget;
+  budget.max_iterations = 10;
+  fp.set_budget(budget);
+  fp.run(AbstractEnvironmentT::top());
+  EXPECT_EQ(fp.get_stats().iteration_budget_hits, 1);
+  EXPECT_EQ(fp.get_stats().time_budget_hits, 0);
+  EXPECT_EQ(fp.get_stats().extrapolations, 11);
+  EXPECT_EQ(fp.get_entry_state_at(bb2).get(&x),
+            IntegerSetAbstractDomain::top());
+  EXPECT_EQ(fp.get_entry_state_at(bb3).get(&x),
+            IntegerSetAbstractDomain::top());
+
+  budget.max_iterations = 0;
+  budget.time_limit = std::chrono::milliseconds(1);
+  fp.set_budget(budget);
+  fp.run(AbstractEnvironmentT::top());
+  EXPECT_EQ(fp.get_stats().iteration_budget_hits, 0);
+  EXPECT_EQ(fp.get_stats().time_budget_hits, 1);
+  EXPECT_EQ(fp.get_entry_state_at(bb3).get(&x),
+            IntegerSetAbstractDomain::top());
+}
@@ -250,6 +250,41 @@ TEST_F(PatriciaTreeMapAbstractEnvironmentTest, whiteBox) {
   EXPECT_TRUE(e.bindings().reference_equals(before));
 }
 
+TEST_F(PatriciaTreeMapAbstractEnvironmentTest, interning) {
+  Environment e1({{1, Domain({"a"})}, {2, Domain({"b"})}, {3, Domain("c")}});
+  Environment e2({{3, Domain("c")}, {2, Domain({"b"})}, {1, Domain({"a"})}});
+  EXPECT_FALSE(e1.bindings().reference_equals(e2.bindings()));
+  e1.intern();
+  e2.intern();
+  EXPECT_TRUE(e1.bindings().is_interned());
+  EXPECT_TRUE(e1.bindings().reference_equals(e2.bindings()));
+
+  Environment e3({{2, Domain({"b", "d"})}, {4, Domain("e")}});
+  e3.intern();
+  auto join = e1.join(e3);
+  EXPECT_TRUE(join.bindings().is_interned());
+  EXPECT_TRUE(join.bindings().reference_equals(e2.join(e3).bindings()));
+  EXPECT_EQ(join, Environment({{2, Domain({"b", "d"})}}));
+  auto meet = e1.meet(e3);
+  EXPECT_TRUE(meet.bindings().reference_equals(e2.meet(e3).bindings()));
+  EXPECT_EQ(meet.get(2), Domain("b"));
+
+  // Memoized operations must agree with the plain ones.
+  for (size_t k = 0; k < 100; ++k) {
+    Environment x = this->generate_random_environment();
+    Environment y = this->generate_random_environment();
+    Environment interned_x = x;
+    Environment interned_y = y;
+    interned_x.intern();
+    interned_y.intern();
+    EXPECT_EQ(x.join(y), interned_x.join(interned_y));
+    EXPECT_EQ(x.join(y), interned_x.join(interned_y));
+    EXPECT_EQ(x.meet(y), interned_x.meet(interned_y));
+    EXPECT_EQ(x.meet(y), interned_x.meet(interned_y));
+    EXPECT_EQ(x.leq(y), interned_x.leq(interned_y));
+  }
+}
+
 TEST_F(PatriciaTreeMapAbstractEnvironmentTest, erase_all_matching) {
   Environment e1({{1, Domain({"a", "b"})}});
   bool any_changes = e1.erase_all_matching(0);
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <sparta/HashedAbstractEnvironment.h>
+#include <sparta/HashedSetAbstractDomain.h>
+#include <sparta/SmallPatriciaTreeMapAbstractEnvironment.h>
+
+#include <cstdint>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <limits>
+#include <random>
+#include <sstream>
+
+using namespace sparta;
+
+using Domain = HashedSetAbstractDomain<std::string>;
+// A small inline capacity, so that the tests cover both representations.
+using Environment = SmallPatriciaTreeMapAbstractEnvironment<uint32_t,
+                                                            Domain,
+                                                            /* capacity */ 4>;
+
+class SmallPatriciaTreeMapAbstractEnvironmentTest : public ::testing::Test {
+ protected:
+  SmallPatriciaTreeMapAbstractEnvironmentTest()
+      : m_rd_device(),
+        m_generator(m_rd_device()),
+        m_size_dist(0, 8),
+        m_elem_dist(0, 16) {}
+
+  Environment generate_random_environment() {
+    Environment env;
+    size_t size = m_size_dist(m_generator);
+    for (size_t i = 0; i < size; ++i) {
+      auto rnd = m_elem_dist(m_generator);
+      auto rnd_string = std::to_string(m_elem_dist(m_generator));
+      env.set(rnd, Domain({rnd_string}));
+    }
+    return env;
+  }
+
+  std::random_device m_rd_device;
+  std::mt19937 m_generator;
+  std::uniform_int_distribution<uint32_t> m_size_dist;
+  std::uniform_int_distribution<uint32_t> m_elem_dist;
+};
+
+static HashedAbstractEnvironment<uint32_t, Domain> hae_from_sptae(
+    const Environment& env) {
+  HashedAbstractEnvironment<uint32_t, Domain> hae;
+  if (env.is_value()) {
+    for (const auto& pair : env.bindings()) {
+      hae.set(pair.first, pair.second);
+    }
+  } else if (env.is_top()) {
+    hae.set_to_top();
+  } else {
+    hae.set_to_bottom();
+  }
+  return hae;
+}
+
+TEST_F(SmallPatriciaTreeMapAbstractEnvironmentTest, latticeOperations) {
+  Environment e1({{1, Domain({"a", "b"})},
+                  {2, Domain("c")},
+                  {3, Domain({"d", "e", "f"})},
+                  {4, Domain({"a", "f"})},
+                  {5, Domain("g")}});
+  Environment e2({{0, Domain({"c", "f"})},
+                  {2, Domain({"c", "d"})},
+                  {3, Domain({"d", "e", "g", "h"})}});
+
+  EXPECT_EQ(5, e1.size());
+  EXPECT_TRUE(e1.bindings().is_tree());
+  EXPECT_EQ(3, e2.size());
+  EXPECT_FALSE(e2.bindings().is_tree());
+
+  EXPECT_TRUE(Environment::bottom().leq(e1));
+  EXPECT_FALSE(e1.leq(Environment::bottom()));
+  EXPECT_FALSE(Environment::top().leq(e1));
+  EXPECT_TRUE(e1.leq(Environment::top()));
+  EXPECT_FALSE(e1.leq(e2));
+  EXPECT_FALSE(e2.leq(e1));
+
+  EXPECT_TRUE(e1.equals(e1));
+  EXPECT_FALSE(e1.equals(e2));
+
+  Environment join = e1.join(e2);
+  EXPECT_TRUE(e1.leq(join));
+  EXPECT_TRUE(e2.leq(join));
+  EXPECT_EQ(2, join.size());
+  EXPECT_THAT(join.get(2).elements(),
+              ::testing::UnorderedElementsAre("c", "d"));
+  EXPECT_THAT(join.get(3).elements(),
+              ::testing::UnorderedElementsAre("d", "e", "f", "g", "h"));
+  EXPECT_TRUE(join.equals(e1.widening(e2)));
+  EXPECT_TRUE(join.equals(e2.join(e1)));
+
+  Environment meet = e1.meet(e2);
+  EXPECT_TRUE(meet.leq(e1));
+  EXPECT_TRUE(meet.leq(e2));
+  EXPECT_EQ(6, meet.size());
+  EXPECT_THAT(meet.get(0).elements(),
+              ::testing::UnorderedElementsAre("c", "f"));
+  EXPECT_THAT(meet.get(2).elements(), ::testing::ElementsAre("c"));
+  EXPECT_THAT(meet.get(3).elements(),
+              ::testing::UnorderedElementsAre("d", "e"));
+  EXPECT_TRUE(meet.equals(e1.narrowing(e2)));
+  EXPECT_TRUE(meet.equals(e2.meet(e1)));
+
+  // A tree and an inline array with the same bindings are equal.
+  Environment small({{2, Domain("c")}});
+  Environment tree = e1;
+  tree.update(1, [](const Domain&) { return Domain::top(); });
+  tree.update(3, [](const Domain&) { return Domain::top(); });
+  tree.update(4, [](const Domain&) { return Domain::top(); });
+  tree.update(5, [](const Domain&) { return Domain::top(); });
+  EXPECT_TRUE(tree.bindings().is_tree());
+  EXPECT_TRUE(tree.equals(small));
+  EXPECT_TRUE(small.equals(tree));
+  EXPECT_TRUE(tree.leq(small));
+  EXPECT_TRUE(small.leq(tree));
+}
+
+TEST_F(SmallPatriciaTreeMapAbstractEnvironmentTest, destructiveOperations) {
+  Environment e1({{1, Domain({"a", "b"})}});
+  Environment e2({{2, Domain({"c", "d"})}, {3, Domain({"g", "h"})}});
+
+  e1.set(2, Domain({"c", "f"})).set(4, Domain({"e", "f", "g"}));
+  EXPECT_EQ(3, e1.size());
+  EXPECT_FALSE(e1.bindings().is_tree());
+
+  Environment join = e1;
+  join.join_with(e2);
+  EXPECT_EQ(1, join.size()) << join;
+  EXPECT_THAT(join.get(2).elements(),
+              ::testing::UnorderedElementsAre("c", "d", "f"));
+
+  // The meet has more bindings than fit inline.
+  Environment meet = e1;
+  meet.set(5, Domain("x"));
+  meet.meet_with(e2);
+  EXPECT_EQ(5, meet.size());
+  EXPECT_TRUE(meet.bindings().is_tree());
+  EXPECT_THAT(meet.get(2).elements(), ::testing::ElementsAre("c"));
+  EXPECT_THAT(meet.get(3).elements(),
+              ::testing::UnorderedElementsAre("g", "h"));
+  EXPECT_THAT(meet.get(5).elements(), ::testing::ElementsAre("x"));
+
+  auto add_e = [](const Domain& s) {
+    auto copy = s;
+    copy.add("e");
+    return copy;
+  };
+  e1.set(6, Domain("x")).set(7, Domain("y"));
+  e1.update(1, add_e).update(7, add_e);
+  EXPECT_EQ(5, e1.size());
+  EXPECT_TRUE(e1.bindings().is_tree());
+  EXPECT_THAT(e1.get(1).elements(),
+              ::testing::UnorderedElementsAre("a", "b", "e"));
+  EXPECT_THAT(e1.get(7).elements(), ::testing::UnorderedElementsAre("e", "y"));
+
+  auto make_bottom = [](const Domain&) { return Domain::bottom(); };
+  Environment e3 = e2;
+  e3.update(1, make_bottom);
+  EXPECT_TRUE(e3.is_bottom());
+
+  e1.set_to_top();
+  EXPECT_TRUE(e1.is_top());
+  e1.set(1, Domain("a"));
+  EXPECT_FALSE(e1.bindings().is_tree());
+}
+
+TEST_F(SmallPatriciaTreeMapAbstractEnvironmentTest, robustness) {
+  for (size_t k = 0; k < 100; ++k) {
+    Environment e1 = this->generate_random_environment();
+    Environment e2 = this->generate_random_environment();
+
+    auto ref_meet = hae_from_sptae(e1);
+    ref_meet.meet_with(hae_from_sptae(e2));
+    auto meet = e1;
+    meet.meet_with(e2);
+    EXPECT_EQ(hae_from_sptae(meet), ref_meet);
+    EXPECT_TRUE(meet.leq(e1));
+    EXPECT_TRUE(meet.leq(e2));
+
+    auto ref_join = hae_from_sptae(e1);
+    ref_join.join_with(hae_from_sptae(e2));
+    auto join = e1;
+    join.join_with(e2);
+    EXPECT_EQ(hae_from_sptae(join), ref_join);
+    EXPECT_TRUE(e1.leq(join));
+    EXPECT_TRUE(e2.leq(join));
+  }
+}
+
+TEST_F(SmallPatriciaTreeMapAbstractEnvironmentTest, erase_all_matching) {
+  Environment e1({{1, Domain({"a", "b"})}, {2, Domain("c")}});
+  EXPECT_FALSE(e1.erase_all_matching(4));
+  EXPECT_TRUE(e1.erase_all_matching(1));
+  EXPECT_EQ(1, e1.size());
+  EXPECT_TRUE(e1.erase_all_matching(2));
+  EXPECT_TRUE(e1.is_top());
+}
+
+TEST_F(SmallPatriciaTreeMapAbstractEnvironmentTest, transform) {
+  Environment e1({{1, Domain({"a", "b"})}});
+  bool any_changes = e1.transform([](Domain d) { return d; });
+  EXPECT_FALSE(any_changes);
+
+  any_changes = e1.transform([](Domain d) { return Domain::top(); });
+  EXPECT_TRUE(any_changes);
+  EXPECT_TRUE(e1.is_top());
+}
+
+TEST_F(SmallPatriciaTreeMapAbstractEnvironmentTest, prettyPrinting) {
+  using StringEnvironment =
+      SmallPatriciaTreeMapAbstractEnvironment<std::string*, Domain>;
+  std::string a = "a";
+  StringEnvironment e({{&a, Domain("A")}});
+
+  std::ostringstream out;
+  out << e.bindings();
+  EXPECT_EQ("{a -> [#1]{A}}", out.str());
+}
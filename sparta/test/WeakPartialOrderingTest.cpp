@@ -7,7 +7,10 @@
 
 #include <sparta/WeakPartialOrdering.h>
 
+#include <chrono>
 #include <gtest/gtest.h>
+#include <iostream>
+#include <random>
 #include <set>
 #include <sstream>
 #include <stack>
@@ -1333,3 +1336,130 @@ TEST(WeakPartialOrderingTest, handleNestedLoopsWithBranch) {
     EXPECT_EQ(wto.str(), "(1 (2 3) 4 5)");
   }
 }
+
+namespace {
+
+using IntGraph = std::vector<std::vector<uint32_t>>;
+
+template <typename Wpo>
+void expect_same_wpo(const Wpo& expected, Wpo& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  EXPECT_EQ(expected.get_entry(), actual.get_entry());
+  for (WpoIdx v = 0; v < expected.size(); v++) {
+    EXPECT_EQ(expected.get_node(v), actual.get_node(v));
+    EXPECT_EQ(expected.is_plain(v), actual.is_plain(v));
+    EXPECT_EQ(expected.is_head(v), actual.is_head(v));
+    EXPECT_EQ(expected.is_exit(v), actual.is_exit(v));
+    EXPECT_EQ(expected.get_successors(v), actual.get_successors(v));
+    EXPECT_EQ(expected.get_predecessors(v), actual.get_predecessors(v));
+    if (expected.is_exit(v)) {
+      EXPECT_EQ(expected.get_num_outer_preds(v),
+                actual.get_num_outer_preds(v));
+    }
+  }
+}
+
+/*
+ * A chain of `num_blocks` blocks of `block_size` nodes, with random edges
+ * within each block, from each block to the next ones and sometimes back to
+ * the previous one.
+ */
+IntGraph make_random_graph(std::mt19937& generator,
+                           uint32_t num_blocks,
+                           uint32_t block_size) {
+  IntGraph graph(num_blocks * block_size);
+  std::uniform_int_distribution<uint32_t> node_dist(0, block_size - 1);
+  std::uniform_int_distribution<uint32_t> degree_dist(1, 3);
+  for (uint32_t block = 0; block < num_blocks; block++) {
+    auto first = block * block_size;
+    for (uint32_t i = 0; i < block_size; i++) {
+      auto& succs = graph[first + i];
+      auto degree = degree_dist(generator);
+      for (uint32_t k = 0; k < degree; k++) {
+        succs.push_back(first + node_dist(generator));
+      }
+      if (block + 1 < num_blocks) {
+        // Ensures that all the nodes are reachable from the entry.
+        succs.push_back(first + block_size + i);
+      }
+    }
+    if (block + 2 < num_blocks) {
+      graph[first].push_back(first + 2 * block_size + node_dist(generator));
+    }
+    if (block > 0 && node_dist(generator) == 0) {
+      // Merges the block with the previous one into a larger loop.
+      graph[first + block_size - 1].push_back(first - block_size);
+    }
+  }
+  return graph;
+}
+
+} // namespace
+
+TEST(WeakPartialOrderingTest, parallelConstructionMatchesSequential) {
+  SimpleGraph2 g;
+  g.add_edge("1", "2");
+  g.add_edge("2", "3");
+  g.add_edge("3", "4");
+  g.add_edge("4", "5");
+  g.add_edge("5", "6");
+  g.add_edge("6", "7");
+  g.add_edge("7", "8");
+  g.add_edge("2", "8");
+  g.add_edge("4", "7");
+  g.add_edge("6", "5");
+  g.add_edge("7", "3");
+  g.add_edge("8", "8");
+  g.add_edge("8", "9");
+  auto successors = [&g](const std::string& n) { return g.successors(n); };
+  for (bool lift : {false, true}) {
+    WeakPartialOrdering<std::string> expected("1", successors, lift);
+    WeakPartialOrdering<std::string> actual("1", successors, lift,
+                                            /* num_threads */ 4);
+    expect_same_wpo(expected, actual);
+    for (const auto* head : {"3", "5", "8"}) {
+      for (const auto* pred : {"2", "4", "6", "7", "8"}) {
+        EXPECT_EQ(expected.is_from_outside(head, pred),
+                  actual.is_from_outside(head, pred));
+      }
+    }
+  }
+
+  std::mt19937 generator(42);
+  for (size_t k = 0; k < 50; ++k) {
+    auto graph = make_random_graph(generator, /* num_blocks */ 5,
+                                   /* block_size */ 6);
+    auto int_successors = [&graph](const uint32_t& n) { return graph[n]; };
+    for (bool lift : {false, true}) {
+      WeakPartialOrdering<uint32_t> expected(0, int_successors, lift);
+      WeakPartialOrdering<uint32_t> actual(0, int_successors, lift,
+                                           /* num_threads */ 4);
+      expect_same_wpo(expected, actual);
+    }
+  }
+}
+
+TEST(WeakPartialOrderingTest, parallelConstructionBenchmark) {
+  std::mt19937 generator(42);
+  auto graph = make_random_graph(generator, /* num_blocks */ 20000,
+                                 /* block_size */ 10);
+  auto successors = [&graph](const uint32_t& n) { return graph[n]; };
+  using Wpo = WeakPartialOrdering<uint32_t, std::hash<uint32_t>,
+                                  /* Support_is_from_outside */ false>;
+
+  auto start = std::chrono::steady_clock::now();
+  Wpo expected(0, successors, /* lift */ false);
+  auto sequential = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  Wpo actual(0, successors, /* lift */ false, /* num_threads */ 4);
+  auto parallel = std::chrono::steady_clock::now() - start;
+
+  expect_same_wpo(expected, actual);
+  using std::chrono::milliseconds;
+  std::cout << "WPO of " << graph.size() << " nodes built in "
+            << std::chrono::duration_cast<milliseconds>(sequential).count()
+            << "ms sequentially, "
+            << std::chrono::duration_cast<milliseconds>(parallel).count()
+            << "ms on 4 threads" << std::endl;
+}
@@ -10,6 +10,7 @@
 #include <boost/algorithm/string/join.hpp>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <sstream>
 
 #include "DexLoader.h"
 #include "RedexTest.h"
@@ -117,3 +118,35 @@ TEST_F(MethodOverrideGraphTest, verify) {
     EXPECT_EQ(node.parents.size(), parents.size());
   }
 }
+
+TEST_F(MethodOverrideGraphTest, saveAndLoad) {
+  const char* IA_M = "Lcom/facebook/redextest/IA;.m:()V";
+  const char* IB_N = "Lcom/facebook/redextest/IB;.n:()V";
+  const char* B_M = "Lcom/facebook/redextest/B;.m:()V";
+
+  auto graph = mog::build_graph(build_class_scope(stores));
+  std::stringstream ss;
+  graph->save(ss);
+  auto loaded = mog::Graph::load(ss);
+
+  EXPECT_EQ(graph->nodes().size(), loaded->nodes().size());
+  for (const auto* name : {IA_M, IB_N, B_M}) {
+    auto* method = DexMethod::get_method(name);
+    for (bool include_interfaces : {false, true}) {
+      EXPECT_THAT(
+          get_overriding_methods(*loaded, method, include_interfaces),
+          ::testing::UnorderedElementsAreArray(
+              get_overriding_methods(*graph, method, include_interfaces)));
+      EXPECT_THAT(
+          get_overridden_methods(*loaded, method, include_interfaces),
+          ::testing::UnorderedElementsAreArray(
+              get_overridden_methods(*graph, method, include_interfaces)));
+    }
+  }
+  for (auto&& [method, node] : graph->nodes()) {
+    const auto& loaded_node = loaded->get_node(method);
+    EXPECT_EQ(node.is_interface, loaded_node.is_interface);
+    EXPECT_EQ(node.other_interface_implementations != nullptr,
+              loaded_node.other_interface_implementations != nullptr);
+  }
+}
@@ -58,6 +58,56 @@ TEST_F(ReachabilityTest, ReachabilityFromProguardTest) {
   EXPECT_EQ(after.num_fields, 2);
 }
 
+TEST_F(ReachabilityTest, ReachabilityFromProguardWithDenseMarksTest) {
+  const auto& dexen = stores[0].get_dexen();
+  auto pg_config = process_and_get_proguard_config(dexen, R"(
+    -keepclasseswithmembers public class RemoveUnreachableTest {
+      public void testMethod();
+    }
+    -keepclasseswithmembers class A {
+      int foo;
+      <init>();
+      int bar();
+    }
+  )");
+
+  EXPECT_TRUE(pg_config->ok);
+  EXPECT_EQ(pg_config->keep_rules.size(), 2);
+
+  int num_ignore_check_strings = 0;
+  reachability::IgnoreSets ig_sets;
+  reachability::ReachableAspects reachable_aspects;
+  auto scope = build_class_scope(stores);
+  walk::parallel::code(scope, [&](auto*, auto& code) { code.build_cfg(); });
+  auto method_override_graph = method_override_graph::build_graph(scope);
+
+  auto reachable_objects = reachability::compute_reachable_objects(
+      scope, *method_override_graph, ig_sets, &num_ignore_check_strings,
+      &reachable_aspects,
+      /* record_reachability */ false, /* relaxed_keep_class_members */ false,
+      /* relaxed_keep_interfaces */ false,
+      /* cfg_gathering_check_instantiable */ false,
+      /* cfg_gathering_check_instance_callable */ false,
+      /* cfg_gathering_check_returning */ false,
+      /* should_mark_all_as_seed */ false,
+      /* remove_no_argument_constructors */ false,
+      /* dense_marks */ true);
+  walk::parallel::code(scope, [&](auto*, auto& code) { code.clear_cfg(); });
+
+  EXPECT_GT(reachable_objects->num_marked_classes(), 0);
+
+  reachability::mark_classes_abstract(stores, *reachable_objects,
+                                      reachable_aspects);
+  reachability::sweep(stores, *reachable_objects, nullptr);
+
+  // Same result as marking with hashed sets in ReachabilityFromProguardTest.
+  reachability::ObjectCounts after = reachability::count_objects(stores);
+
+  EXPECT_EQ(after.num_classes, 7);
+  EXPECT_EQ(after.num_methods, 14);
+  EXPECT_EQ(after.num_fields, 2);
+}
+
 TEST_F(ReachabilityTest, ReachabilityMarkAllTest) {
   const auto& dexen = stores[0].get_dexen();
   auto pg_config = process_and_get_proguard_config(dexen, R"(
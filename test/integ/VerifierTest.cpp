@@ -42,3 +42,13 @@ TEST_F(VerifierArtifactsTest, file_exists) {
   EXPECT_TRUE(lines[1].find("Lredex/VerifierTest;") <
               lines[1].find("Lredex/B;"));
 }
+
+TEST_F(VerifierArtifactsTest, soft_verification_file_exists) {
+  run_passes({
+      new VerifierPass(),
+  });
+  fs::path out_dir(get_configfiles_out_dir());
+  fs::path artifacts_path =
+      out_dir / "meta" / "redex-soft-verification-failures.txt";
+  ASSERT_TRUE(boost::filesystem::exists(artifacts_path));
+}
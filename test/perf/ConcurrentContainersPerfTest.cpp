@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "ConcurrentContainers.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kThreads = 64;
+constexpr size_t kKeys = 200000;
+
+long long ms_since(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() -
+                                                               start)
+      .count();
+}
+
+// Every thread emplaces all keys, in its own order, and then looks all of them
+// up, so that most operations contend with other threads on the same entries.
+template <typename Map>
+long long run_contended(Map& map, const std::vector<const int*>& keys) {
+  std::vector<std::vector<const int*>> orders(kThreads, keys);
+  for (size_t t = 0; t < kThreads; ++t) {
+    std::shuffle(orders[t].begin(), orders[t].end(), std::mt19937(t));
+  }
+  auto start = Clock::now();
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&map, &order = orders[t]]() {
+      for (auto* key : order) {
+        map.emplace(key, *key);
+      }
+      size_t sum = 0;
+      for (auto* key : order) {
+        sum += *map.get(key);
+      }
+      EXPECT_EQ(kKeys * (kKeys - 1) / 2, sum);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return ms_since(start);
+}
+
+} // namespace
+
+TEST(ConcurrentContainersPerfTest, pointer_keys) {
+  std::vector<int> values(kKeys);
+  std::vector<const int*> keys;
+  for (size_t i = 0; i < kKeys; ++i) {
+    values[i] = i;
+    keys.push_back(&values[i]);
+  }
+
+  InsertOnlyConcurrentMap<const int*, size_t> chained;
+  auto chained_ms = run_contended(chained, keys);
+  EXPECT_EQ(kKeys, chained.size());
+
+  InsertOnlyConcurrentPointerMap<const int*, size_t> open_addressing(kKeys);
+  auto open_addressing_ms = run_contended(open_addressing, keys);
+  EXPECT_EQ(kKeys, open_addressing.size());
+
+  printf("Execution time (ms) with %zu threads: InsertOnlyConcurrentMap: %lld "
+         "InsertOnlyConcurrentPointerMap: %lld (overflow: %zu)\n",
+         kThreads, chained_ms, open_addressing_ms,
+         open_addressing.overflow_size());
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <boost/functional/hash.hpp>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DexClass.h"
+#include "RedexTest.h"
+#include "StringUtil.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+long long ms_since(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() -
+                                                               start)
+      .count();
+}
+
+// Type-descriptor-like strings that share long package prefixes, some of
+// them with non-ASCII characters.
+std::vector<std::string> make_strings(size_t n) {
+  const std::vector<std::string> packages = {
+      "Lcom/facebook/", "Lcom/facebook/katana/", "Landroidx/appcompat/widget/",
+      "Lkotlin/jvm/internal/"};
+  const std::vector<std::string> pieces = {"Foo", "Bar$", "Baz", "\303\251",
+                                           "\342\202\254", "1", "$Inner"};
+  std::mt19937 gen(0);
+  std::vector<std::string> strings;
+  for (size_t i = 0; i < n; ++i) {
+    auto str = packages[gen() % packages.size()];
+    auto len = 1 + gen() % 8;
+    for (size_t j = 0; j < len; ++j) {
+      str += pieces[gen() % pieces.size()];
+    }
+    strings.push_back(str + ";");
+  }
+  return strings;
+}
+
+} // namespace
+
+class DexStringPerfTest : public RedexTest {};
+
+TEST_F(DexStringPerfTest, hash) {
+  auto strings = make_strings(200000);
+  size_t result1 = 0;
+  size_t result2 = 0;
+  auto start = Clock::now();
+  for (size_t iter = 0; iter < 50; ++iter) {
+    for (const auto& str : strings) {
+      result1 += boost::hash_range(str.data(), str.data() + str.size());
+    }
+  }
+  auto boost_ms = ms_since(start);
+  start = Clock::now();
+  for (size_t iter = 0; iter < 50; ++iter) {
+    for (const auto& str : strings) {
+      result2 += hash_bytes(str.data(), str.size());
+    }
+  }
+  auto hash_bytes_ms = ms_since(start);
+  printf("Execution time (ms) boost::hash_range: %lld hash_bytes: %lld\n",
+         boost_ms, hash_bytes_ms);
+  EXPECT_NE(result1, result2);
+}
+
+TEST_F(DexStringPerfTest, make_and_sort) {
+  auto strings = make_strings(500000);
+  auto start = Clock::now();
+  std::vector<const DexString*> dex_strings;
+  for (const auto& str : strings) {
+    dex_strings.push_back(DexString::make_string(str));
+  }
+  auto make_ms = ms_since(start);
+  start = Clock::now();
+  std::sort(dex_strings.begin(), dex_strings.end(), compare_dexstrings);
+  auto sort_ms = ms_since(start);
+  printf("Execution time (ms) make_string: %lld sort: %lld\n", make_ms,
+         sort_ms);
+  EXPECT_TRUE(std::is_sorted(dex_strings.begin(), dex_strings.end(),
+                             compare_dexstrings));
+}
@@ -183,11 +183,15 @@ class ParallelFixpointEngine final
 
 class MonotonicFixpointIteratorTest {
  public:
-  MonotonicFixpointIteratorTest() : m_program1(1) {}
+  MonotonicFixpointIteratorTest() : m_program1(1), m_program2(1) {}
 
-  void SetUp() { build_program1(); }
+  void SetUp() {
+    build_program1();
+    build_program2();
+  }
 
   Program m_program1;
+  Program m_program2;
 
  private:
   /*
@@ -211,6 +215,38 @@ class MonotonicFixpointIteratorTest {
     }
     m_program1.set_exit(2001);
   }
+
+  /*
+   * A synthetic huge method, as produced by code generators: a switch over
+   * many cases, each of which contains a loop.
+   *
+   *  1: a = 0; Switch to 3i + 2, for i in [0, 1000)
+   *     3i + 2: while (c_i < a) {
+   *     3i + 3:   c_i = c_i + d_i;
+   *             }
+   *     3i + 4: b = c_i;
+   *  3002:   return b;
+   */
+  void build_program2() {
+    const uint32_t num_cases = 1000;
+    const uint32_t exit = 3 * num_cases + 2;
+    m_program2.add(1, Statement(/* use: */ {}, /* def: */ {0}));
+    for (uint32_t i = 0; i < num_cases; ++i) {
+      uint32_t head = 3 * i + 2;
+      uint32_t c = 2 * i + 2;
+      uint32_t d = 2 * i + 3;
+      m_program2.add(head, Statement(/* use: */ {c, 0}, /* def: */ {}));
+      m_program2.add(head + 1, Statement(/* use: */ {c, d}, /* def: */ {c}));
+      m_program2.add(head + 2, Statement(/* use: */ {c}, /* def: */ {1}));
+      m_program2.add_edge(1, head);
+      m_program2.add_edge(head, head + 1);
+      m_program2.add_edge(head + 1, head);
+      m_program2.add_edge(head, head + 2);
+      m_program2.add_edge(head + 2, exit);
+    }
+    m_program2.add(exit, Statement(/* use: */ {1}, /* def: */ {}));
+    m_program2.set_exit(exit);
+  }
 };
 
 double calculate_speedup(const MonotonicFixpointIteratorTest& test,
@@ -241,4 +277,28 @@ int main() {
   for (uint32_t i = 1; i <= redex_parallel::default_num_threads(); ++i) {
     printf("%u %lf\n", i, duration1 / calculate_speedup(test, i));
   }
+
+  printf("Huge method, parallel mode of MonotonicFixpointIterator\n");
+  FixpointEngine huge_fp(test.m_program2);
+  auto huge_start = std::chrono::high_resolution_clock::now();
+  huge_fp.run(LivenessDomain());
+  auto huge_end = std::chrono::high_resolution_clock::now();
+  double huge_duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                             huge_end - huge_start)
+                             .count();
+  for (uint32_t i = 2; i <= redex_parallel::default_num_threads(); ++i) {
+    FixpointEngine para_fp(test.m_program2);
+    para_fp.set_parallel_mode(i, /* min_size */ 1);
+    auto para_start = std::chrono::high_resolution_clock::now();
+    para_fp.run(LivenessDomain());
+    auto para_end = std::chrono::high_resolution_clock::now();
+    double duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                          para_end - para_start)
+                          .count();
+    if (!(para_fp.get_exit_state_at(1) == huge_fp.get_exit_state_at(1))) {
+      printf("Mismatching results with %u threads\n", i);
+      return 1;
+    }
+    printf("%u %lf\n", i, huge_duration / duration);
+  }
 }
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <chrono>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ConfigFiles.h"
+#include "Creators.h"
+#include "DexStore.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "PassManager.h"
+#include "Peephole.h"
+#include "RedexTest.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+long long ms_since(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() -
+                                                               start)
+      .count();
+}
+
+// Straight-line pieces of code like the ones found in app code. Only the
+// last one is rewritten by a peephole pattern.
+const std::vector<std::string> kSnippets = {
+    "(const v1 1) (add-int v2 v1 v1)",
+    "(iget-object v0 \"LFoo;.bar:LBar;\") (move-result-pseudo-object v3)",
+    "(invoke-virtual (v0) \"LFoo;.baz:()I\") (move-result v2)",
+    "(new-instance \"LBar;\") (move-result-pseudo-object v3)",
+    "(invoke-static (v2) \"LFoo;.qux:(I)V\")",
+    "(const-string \"hello\") (move-result-pseudo-object v4)",
+    "(mul-int v2 v2 v1) (sub-int v1 v2 v1)",
+    "(const-string \"hello\") (move-result-pseudo-object v5)"
+    "(invoke-virtual (v5) \"Ljava/lang/String;.length:()I\") (move-result v2)",
+};
+
+std::string make_code(std::mt19937& gen, size_t num_snippets) {
+  std::string code =
+      "((load-param-object v0) (const v1 0) (const v2 0)"
+      "(const-string \"\") (move-result-pseudo-object v4)";
+  for (size_t i = 0; i < num_snippets; ++i) {
+    code += kSnippets[gen() % kSnippets.size()];
+  }
+  return code + "(return-void))";
+}
+
+// Times the pass alone, without the checks that the PassManager runs around
+// it. The first run does the rewrites; like the later runs of Peephole in a
+// pass list, the others only match.
+class TimedPeepholePass : public PeepholePass {
+ public:
+  void run_pass(DexStoresVector& stores,
+                ConfigFiles& conf,
+                PassManager& mgr) override {
+    for (size_t run = 0; run < 3; ++run) {
+      auto start = Clock::now();
+      PeepholePass::run_pass(stores, conf, mgr);
+      times_ms.push_back(ms_since(start));
+    }
+  }
+
+  std::vector<long long> times_ms;
+};
+
+} // namespace
+
+class PeepholePerfTest : public RedexTest {};
+
+TEST_F(PeepholePerfTest, throughput) {
+  const size_t kNumMethods = 5000;
+  std::mt19937 gen(0);
+  ClassCreator creator(DexType::make_type("LPeepholePerf;"));
+  creator.set_super(type::java_lang_Object());
+  size_t num_insns = 0;
+  for (size_t i = 0; i < kNumMethods; ++i) {
+    auto* method = DexMethod::make_method("LPeepholePerf;.m" +
+                                          std::to_string(i) +
+                                          ":(LFoo;)V")
+                       ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+    method->set_code(assembler::ircode_from_string(make_code(gen, 40)));
+    num_insns += method->get_code()->count_opcodes();
+    creator.add_method(method);
+  }
+
+  TimedPeepholePass peephole_pass;
+  PassManager manager({&peephole_pass});
+  ConfigFiles config(Json::nullValue);
+  config.parse_global_config();
+  DexStore store("classes");
+  store.add_classes({creator.create()});
+  std::vector<DexStore> stores;
+  stores.emplace_back(std::move(store));
+  manager.run_passes(stores, config);
+  for (size_t run = 0; run < peephole_pass.times_ms.size(); ++run) {
+    printf("Execution time (ms) of run %zu for %zu instructions: %lld\n", run,
+           num_insns, peephole_pass.times_ms[run]);
+  }
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <chrono>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "utils/Unicode.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+long long ms_since(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() -
+                                                               start)
+      .count();
+}
+
+// Strings shaped like a resource string pool: file paths, class names and
+// user-facing text, a fraction of it non-ASCII.
+std::vector<std::string> make_pool(size_t n) {
+  const std::vector<std::string> pieces = {
+      "res/layout/activity_main.xml", "com.facebook.katana.ui.", "Settings",
+      "@string/app_name",             " ",                       "Caf\303\251",
+      "\342\202\254",                 "\360\237\230\200",        "_v21"};
+  std::mt19937 gen(0);
+  std::vector<std::string> pool;
+  for (size_t i = 0; i < n; ++i) {
+    std::string str;
+    auto len = 1 + gen() % 6;
+    for (size_t j = 0; j < len; ++j) {
+      str += pieces[gen() % pieces.size()];
+    }
+    pool.push_back(std::move(str));
+  }
+  return pool;
+}
+
+} // namespace
+
+TEST(UnicodePerfTest, round_trip) {
+  auto pool = make_pool(300000);
+  size_t total = 0;
+  auto start = Clock::now();
+  for (size_t iter = 0; iter < 20; ++iter) {
+    for (const auto& str : pool) {
+      const auto* u8 = reinterpret_cast<const uint8_t*>(str.data());
+      auto u16_len = utf8_to_utf16_length(u8, str.size());
+      ASSERT_GE(u16_len, 0);
+      std::u16string u16(u16_len, u'\0');
+      utf8_to_utf16(u8, str.size(), u16.data(), u16_len + 1);
+      auto u8_len = utf16_to_utf8_length(u16.data(), u16.size());
+      ASSERT_EQ(u8_len, (ssize_t)str.size());
+      std::string back(u8_len, '\0');
+      utf16_to_utf8(u16.data(), u16.size(), back.data(), u8_len + 1);
+      ASSERT_EQ(back, str);
+      total += u16_len;
+    }
+  }
+  printf("Execution time (ms) for %zu UTF-16 chars: %lld\n", total,
+         ms_since(start));
+}
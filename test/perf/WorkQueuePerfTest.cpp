@@ -73,9 +73,45 @@ void smallLengthTasks() {
   printf("speedup small length tasks: %f\n", speedup);
 }
 
+// A handful of huge items at the end of an otherwise uniform workload, as seen
+// with a few giant methods in method-level passes. Compares the plain
+// round-robin distribution against scheduling the items by decreasing cost.
+void skewedLengthTasks() {
+  constexpr unsigned int num_threads = 8;
+  std::vector<int> times;
+  for (int i = 0; i < 400; ++i) {
+    times.push_back(5);
+  }
+  for (unsigned int i = 0; i < num_threads / 2; ++i) {
+    times.push_back(400);
+  }
+
+  auto sleep = [](int a) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(a));
+  };
+  auto time_it = [](const auto& f) {
+    auto start = std::chrono::high_resolution_clock::now();
+    f();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end - start)
+        .count();
+  };
+
+  auto plain =
+      time_it([&]() { workqueue_run<int>(sleep, times, num_threads); });
+  auto by_cost = time_it([&]() {
+    workqueue_run_by_cost<int>(
+        sleep, times, [](const int& a) { return (size_t)a; }, num_threads);
+  });
+  // The ideal makespan is max(400, total / num_threads) = 450ms.
+  printf("skewed length tasks: plain %lldms, by cost %lldms\n",
+         (long long)plain, (long long)by_cost);
+}
+
 int main() {
   printf("Begin!\n");
   profileBusyLoop();
   variableLengthTasks();
   smallLengthTasks();
+  skewedLengthTasks();
 }
@@ -5,12 +5,20 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <boost/filesystem.hpp>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <json/value.h>
+#include <thread>
 
 #include "RedexTest.h"
+#include "RedexTestUtils.h"
 
 #include "AnalysisUsage.h"
+#include "ConfigFiles.h"
+#include "Creators.h"
 #include "Pass.h"
+#include "PassManager.h"
 
 struct AnalysisUsageTest : public RedexTest {
   template <typename P>
@@ -188,6 +196,193 @@ class ConsumeAnalysis2Pass : public Pass {
                 PassManager& /* mgr */) override {}
 };
 
+class PrefetchingAnalysisPass : public Pass {
+ public:
+  using Result = int;
+
+  PrefetchingAnalysisPass() : Pass("PrefetchingAnalysisPass", Pass::ANALYSIS) {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {};
+  }
+
+  std::function<void()> prefetch_analysis(const DexStoresVector&) override {
+    return [this]() {
+      m_prefetch_thread = std::this_thread::get_id();
+      m_prefetched = std::make_shared<Result>(42);
+    };
+  }
+
+  void run_pass(DexStoresVector& /* stores */,
+                ConfigFiles& /* conf */,
+                PassManager& /* mgr */) override {
+    m_used_prefetched = m_prefetched != nullptr;
+    m_result = m_used_prefetched ? std::move(m_prefetched)
+                                 : std::make_shared<Result>(42);
+  }
+
+  std::shared_ptr<Result> get_result() { return m_result; }
+
+  void destroy_analysis_result() override { m_result = nullptr; }
+
+  std::thread::id m_prefetch_thread;
+  bool m_used_prefetched{false};
+
+ private:
+  std::shared_ptr<Result> m_result = nullptr;
+  std::shared_ptr<Result> m_prefetched = nullptr;
+};
+
+// Spills its result to a file with the integer in it.
+class SpillingAnalysisPass : public Pass {
+ public:
+  using Result = int;
+
+  SpillingAnalysisPass() : Pass("SpillingAnalysisPass", Pass::ANALYSIS) {}
+
+  redex_properties::PropertyInteractions get_property_interactions()
+      const override {
+    using namespace redex_properties::interactions;
+    using namespace redex_properties::names;
+    return {};
+  }
+
+  void run_pass(DexStoresVector& /* stores */,
+                ConfigFiles& /* conf */,
+                PassManager& /* mgr */) override {
+    m_result = std::make_shared<Result>(42);
+  }
+
+  bool spill_analysis_result(const std::string& path) override {
+    std::ofstream(path) << *m_result;
+    m_result = nullptr;
+    m_spill_path = path;
+    return true;
+  }
+
+  void reload_analysis_result(const std::string& path) override {
+    m_result = std::make_shared<Result>();
+    std::ifstream(path) >> *m_result;
+  }
+
+  std::shared_ptr<Result> get_result() { return m_result; }
+
+  void destroy_analysis_result() override { m_result = nullptr; }
+
+  std::string m_spill_path;
+
+ private:
+  std::shared_ptr<Result> m_result = nullptr;
+};
+
+class ConsumeSpillingAnalysisPass : public Pass {
+ public:
+  ConsumeSpillingAnalysisPass() : Pass("ConsumeSpillingAnalysisPass") {}
+
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.add_required<SpillingAnalysisPass>();
+    au.set_preserve_all();
+  }
+
+  void run_pass(DexStoresVector& /* stores */,
+                ConfigFiles& /* conf */,
+                PassManager& mgr) override {
+    auto* preserved = mgr.get_preserved_analysis<SpillingAnalysisPass>();
+    always_assert(preserved);
+    m_result = preserved->get_result();
+  }
+
+  std::shared_ptr<int> m_result;
+};
+
+class NopPass : public Pass {
+ public:
+  explicit NopPass(bool preserve_all = false)
+      : Pass("NopPass"), m_preserve_all(preserve_all) {}
+
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    if (m_preserve_all) {
+      au.set_preserve_all();
+    }
+  }
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override {}
+
+ private:
+  bool m_preserve_all;
+};
+
+void run_passes(const std::vector<Pass*>& passes,
+                bool prefetch_analyses,
+                unsigned int memory_budget_mb = 0,
+                const std::string& outdir = "") {
+  Json::Value config(Json::objectValue);
+  config["redex"]["passes"] = Json::arrayValue;
+  for (auto* pass : passes) {
+    config["redex"]["passes"].append(pass->name());
+  }
+  config["pass_manager"]["prefetch_analyses"] = prefetch_analyses;
+  config["pass_manager"]["memory_budget_mb"] = memory_budget_mb;
+
+  ClassCreator cc(DexType::make_type("LFoo;"));
+  cc.set_super(type::java_lang_Object());
+  DexStore store("classes");
+  store.add_classes({cc.create()});
+  DexStoresVector stores{store};
+
+  ConfigFiles conf(config, outdir);
+  conf.parse_global_config();
+  PassManager manager(passes, conf);
+  manager.set_testing_mode();
+  manager.run_passes(stores, conf);
+}
+
+TEST_F(AnalysisUsageTest, analysisIsPrefetchedInBackground) {
+  NopPass nop;
+  PrefetchingAnalysisPass analysis;
+  run_passes({&nop, &analysis}, /* prefetch_analyses */ true);
+  EXPECT_TRUE(analysis.m_used_prefetched);
+  EXPECT_NE(std::this_thread::get_id(), analysis.m_prefetch_thread);
+  EXPECT_NE(nullptr, analysis.get_result());
+}
+
+TEST_F(AnalysisUsageTest, analysisIsNotPrefetchedByDefault) {
+  NopPass nop;
+  PrefetchingAnalysisPass analysis;
+  run_passes({&nop, &analysis}, /* prefetch_analyses */ false);
+  EXPECT_FALSE(analysis.m_used_prefetched);
+  EXPECT_NE(nullptr, analysis.get_result());
+}
+
+TEST_F(AnalysisUsageTest, analysisIsSpilledOverMemoryBudget) {
+  auto tmp_dir = redex::make_tmp_dir("AnalysisUsageTest%%%%%%%%");
+  boost::filesystem::create_directory(tmp_dir.path + "/meta");
+  SpillingAnalysisPass analysis;
+  NopPass nop(/* preserve_all */ true);
+  ConsumeSpillingAnalysisPass consumer;
+  // Any process is over a budget of 1MB, so the analysis is spilled before
+  // the pass that does not require it, and reloaded by the one that does.
+  run_passes({&analysis, &nop, &consumer}, /* prefetch_analyses */ false,
+             /* memory_budget_mb */ 1, tmp_dir.path);
+  EXPECT_FALSE(analysis.m_spill_path.empty());
+  ASSERT_NE(nullptr, consumer.m_result);
+  EXPECT_EQ(42, *consumer.m_result);
+  EXPECT_FALSE(boost::filesystem::exists(analysis.m_spill_path));
+}
+
+TEST_F(AnalysisUsageTest, analysisIsNotSpilledWithoutMemoryBudget) {
+  SpillingAnalysisPass analysis;
+  NopPass nop(/* preserve_all */ true);
+  ConsumeSpillingAnalysisPass consumer;
+  run_passes({&analysis, &nop, &consumer}, /* prefetch_analyses */ false);
+  EXPECT_TRUE(analysis.m_spill_path.empty());
+  ASSERT_NE(nullptr, consumer.m_result);
+  EXPECT_EQ(42, *consumer.m_result);
+}
+
 TEST_F(AnalysisUsageTest, testAnalysisInvalidation) {
   auto get_preserved_passes = []() {
     std::unordered_map<AnalysisID, Pass*> ret;
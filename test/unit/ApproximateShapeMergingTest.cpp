@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <json/value.h>
+
+#include "ApproximateShapeMerging.h"
+#include "ConfigFiles.h"
+#include "JsonWrapper.h"
+#include "RedexTest.h"
+
+using namespace class_merging;
+
+using Shape = MergerType::Shape;
+
+class ApproximateShapeMergingTest : public RedexTest {
+ public:
+  static Shape make_shape(int int_fields, int reference_fields) {
+    Shape shape;
+    shape.int_fields = int_fields;
+    shape.reference_fields = reference_fields;
+    return shape;
+  }
+
+  void add_shape(const Shape& shape, size_t num_types) {
+    auto& types = m_shapes[shape].types;
+    for (size_t i = 0; i < num_types; ++i) {
+      types.insert(DexType::make_type("LT" + std::to_string(m_num_types++) +
+                                      ";"));
+    }
+  }
+
+  JsonWrapper spec(size_t distance) {
+    Json::Value json;
+    json["distance"] = (Json::UInt64)distance;
+    return JsonWrapper(json);
+  }
+
+ protected:
+  MergerType::ShapeCollector m_shapes;
+  size_t m_num_types{0};
+};
+
+TEST_F(ApproximateShapeMergingTest, maxMergeableGreedy) {
+  // Shapes are (int fields, reference fields). With a distance of 1, the
+  // shape DAG is
+  //
+  //   (0, 0) -> (1, 0) -> (1, 1) -> (2, 1)
+  //                  \--> (2, 0) --^
+  //                          \----> (3, 0)
+  //
+  // (2, 1) has the most mergeables with its predecessors and takes (1, 1)
+  // and (2, 0), which leaves (3, 0) without predecessors. (1, 0) then takes
+  // (0, 0).
+  add_shape(make_shape(0, 0), 1);
+  add_shape(make_shape(1, 0), 3);
+  add_shape(make_shape(1, 1), 2);
+  add_shape(make_shape(2, 0), 2);
+  add_shape(make_shape(2, 1), 4);
+  add_shape(make_shape(3, 0), 1);
+
+  ConfigFiles conf(Json::nullValue);
+  ApproximateStats stats;
+  max_mergeable_greedy(spec(1), conf, m_shapes, stats);
+
+  EXPECT_EQ(3, stats.m_shapes_merged);
+  EXPECT_EQ(5, stats.m_mergeables);
+  EXPECT_EQ(5, stats.m_fields_added);
+  ASSERT_EQ(3, m_shapes.size());
+  EXPECT_EQ(4, m_shapes.at(make_shape(1, 0)).types.size());
+  EXPECT_EQ(8, m_shapes.at(make_shape(2, 1)).types.size());
+  EXPECT_EQ(1, m_shapes.at(make_shape(3, 0)).types.size());
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "BlockLayoutPass.h"
+
+#include "ControlFlow.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+
+class BlockLayoutTest : public RedexTest {
+ public:
+  ~BlockLayoutTest() override {
+    cfg::ControlFlowGraph::set_profile_guided_layout(false);
+  }
+};
+
+TEST_F(BlockLayoutTest, invertHotBranch) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+      (.src_block "LFoo;.bar:(I)I" 0 (1.0 1.0))
+      (if-eqz v0 :hot)
+      (.src_block "LFoo;.bar:(I)I" 1 (0.1 1.0))
+      (const v1 1)
+      (return v1)
+      (:hot)
+      (.src_block "LFoo;.bar:(I)I" 2 (0.9 1.0))
+      (const v1 2)
+      (return v1)
+    )
+  )");
+  code->build_cfg();
+
+  auto stats = BlockLayoutPass::invert_hot_branches(code->cfg());
+  EXPECT_EQ(1, stats.profiled_methods);
+  EXPECT_EQ(1, stats.inverted_branches);
+  EXPECT_EQ(0, stats.cold_blocks);
+
+  code->clear_cfg();
+  auto expected = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+      (.src_block "LFoo;.bar:(I)I" 0 (1.0 1.0))
+      (if-nez v0 :cold)
+      (.src_block "LFoo;.bar:(I)I" 2 (0.9 1.0))
+      (const v1 2)
+      (return v1)
+      (:cold)
+      (.src_block "LFoo;.bar:(I)I" 1 (0.1 1.0))
+      (const v1 1)
+      (return v1)
+    )
+  )");
+  EXPECT_CODE_EQ(expected.get(), code.get());
+}
+
+TEST_F(BlockLayoutTest, coldBlocksLast) {
+  const char* code_str = R"(
+    (
+      (load-param v0)
+      (.src_block "LFoo;.bar:(I)I" 0 (1.0 1.0))
+      (if-eqz v0 :hot)
+      (.src_block "LFoo;.bar:(I)I" 1 (1.0 1.0))
+      (if-gtz v0 :cold)
+      (.src_block "LFoo;.bar:(I)I" 2 (1.0 1.0))
+      (const v1 1)
+      (return v1)
+      (:hot)
+      (.src_block "LFoo;.bar:(I)I" 3 (1.0 1.0))
+      (const v1 2)
+      (return v1)
+      (:cold)
+      (.src_block "LFoo;.bar:(I)I" 4 (0.0 0.0))
+      (const v1 3)
+      (return v1)
+    )
+  )";
+
+  auto literals = [](IRCode* code) {
+    std::vector<int64_t> res;
+    for (const auto& mie : InstructionIterable(code)) {
+      if (mie.insn->opcode() == OPCODE_CONST) {
+        res.push_back(mie.insn->get_literal());
+      }
+    }
+    return res;
+  };
+
+  // Structurally, the cold block comes before the hot one.
+  auto code = assembler::ircode_from_string(code_str);
+  code->build_cfg();
+  code->clear_cfg();
+  EXPECT_EQ(std::vector<int64_t>({1, 3, 2}), literals(code.get()));
+
+  cfg::ControlFlowGraph::set_profile_guided_layout(true);
+  code->build_cfg();
+  EXPECT_EQ(1, BlockLayoutPass::invert_hot_branches(code->cfg()).cold_blocks);
+  code->clear_cfg();
+  EXPECT_EQ(std::vector<int64_t>({1, 2, 3}), literals(code.get()));
+}
+
+TEST_F(BlockLayoutTest, unprofiledLayoutUnchanged) {
+  const char* code_str = R"(
+    (
+      (load-param v0)
+      (if-eqz v0 :a)
+      (const v1 1)
+      (:join)
+      (return v1)
+      (:a)
+      (const v1 2)
+      (goto :join)
+    )
+  )";
+
+  auto code = assembler::ircode_from_string(code_str);
+  code->build_cfg();
+  code->clear_cfg();
+  cfg::ControlFlowGraph::set_profile_guided_layout(true);
+  auto code_guided = assembler::ircode_from_string(code_str);
+  code_guided->build_cfg();
+  code_guided->clear_cfg();
+  EXPECT_CODE_EQ(code.get(), code_guided.get());
+}
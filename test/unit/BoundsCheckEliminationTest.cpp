@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "BoundsCheckElimination.h"
+#include "ControlFlow.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+
+class BoundsCheckEliminationTest : public RedexTest {};
+
+void test(const std::string& code_str,
+          const std::string& expected_str,
+          size_t expected_bounds_checks_eliminated,
+          size_t expected_null_checks_eliminated) {
+  auto code = assembler::ircode_from_string(code_str);
+  auto expected = assembler::ircode_from_string(expected_str);
+
+  code->build_cfg();
+  auto stats = BoundsCheckEliminationPass::process_code(code.get());
+  EXPECT_EQ(expected_bounds_checks_eliminated, stats.bounds_checks_eliminated);
+  EXPECT_EQ(expected_null_checks_eliminated, stats.null_checks_eliminated);
+
+  code->clear_cfg();
+  EXPECT_CODE_EQ(code.get(), expected.get());
+}
+
+TEST_F(BoundsCheckEliminationTest, length_in_header) {
+  const auto& code_str = R"(
+    (
+      (load-param-object v0)
+      (const v1 0)
+      (:loop)
+      (array-length v0)
+      (move-result-pseudo v2)
+      (if-ge v1 v2 :end)
+      (if-ltz v1 :fail)
+      (if-eqz v0 :fail)
+      (array-length v0)
+      (move-result-pseudo v3)
+      (if-ge v1 v3 :fail)
+      (aget v0 v1)
+      (move-result-pseudo v4)
+      (invoke-static (v4) "LFoo;.bar:(I)V")
+      (add-int/lit v1 v1 1)
+      (goto :loop)
+      (:fail)
+      (const v5 0)
+      (throw v5)
+      (:end)
+      (return-void)
+    )
+  )";
+  const auto& expected_str = R"(
+    (
+      (load-param-object v0)
+      (const v1 0)
+      (:loop)
+      (array-length v0)
+      (move-result-pseudo v2)
+      (if-ge v1 v2 :end)
+      (array-length v0)
+      (move-result-pseudo v3)
+      (aget v0 v1)
+      (move-result-pseudo v4)
+      (invoke-static (v4) "LFoo;.bar:(I)V")
+      (add-int/lit v1 v1 1)
+      (goto :loop)
+      (:end)
+      (return-void)
+    )
+  )";
+  test(code_str, expected_str, 2, 1);
+}
+
+TEST_F(BoundsCheckEliminationTest, length_in_preheader) {
+  const auto& code_str = R"(
+    (
+      (load-param-object v0)
+      (array-length v0)
+      (move-result-pseudo v2)
+      (const v1 0)
+      (:loop)
+      (if-le v2 v1 :end)
+      (if-lt v1 v2 :ok)
+      (const v5 0)
+      (throw v5)
+      (:ok)
+      (aget v0 v1)
+      (move-result-pseudo v4)
+      (invoke-static (v4) "LFoo;.bar:(I)V")
+      (add-int/lit v1 v1 1)
+      (goto :loop)
+      (:end)
+      (return-void)
+    )
+  )";
+  const auto& expected_str = R"(
+    (
+      (load-param-object v0)
+      (array-length v0)
+      (move-result-pseudo v2)
+      (const v1 0)
+      (:loop)
+      (if-le v2 v1 :end)
+      (aget v0 v1)
+      (move-result-pseudo v4)
+      (invoke-static (v4) "LFoo;.bar:(I)V")
+      (add-int/lit v1 v1 1)
+      (goto :loop)
+      (:end)
+      (return-void)
+    )
+  )";
+  test(code_str, expected_str, 1, 0);
+}
+
+TEST_F(BoundsCheckEliminationTest, check_after_increment_stays) {
+  const auto& code_str = R"(
+    (
+      (load-param-object v0)
+      (const v1 0)
+      (:loop)
+      (array-length v0)
+      (move-result-pseudo v2)
+      (if-ge v1 v2 :end)
+      (add-int/lit v1 v1 1)
+      (if-ge v1 v2 :end)
+      (aget v0 v1)
+      (move-result-pseudo v4)
+      (invoke-static (v4) "LFoo;.bar:(I)V")
+      (goto :loop)
+      (:end)
+      (return-void)
+    )
+  )";
+  test(code_str, code_str, 0, 0);
+}
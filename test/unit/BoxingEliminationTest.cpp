@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "BoxingEliminationPass.h"
+
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+#include "Show.h"
+
+class BoxingEliminationTest : public RedexTest {
+ public:
+  static DexMethod* make_method(const std::string& str) {
+    auto* method = assembler::method_from_string(str);
+    method->get_code()->build_cfg();
+    return method;
+  }
+
+  static void expect_code(DexMethod* method, const std::string& expected) {
+    method->get_code()->clear_cfg();
+    auto expected_code = assembler::ircode_from_string(expected);
+    EXPECT_CODE_EQ(expected_code.get(), method->get_code());
+  }
+};
+
+TEST_F(BoxingEliminationTest, paramAndReturnRoundTrip) {
+  auto* callee = make_method(R"(
+    (method (private static) "LFoo;.inc:(Ljava/lang/Integer;)Ljava/lang/Integer;"
+      (
+        (load-param-object v0)
+        (invoke-virtual (v0) "Ljava/lang/Integer;.intValue:()I")
+        (move-result v1)
+        (add-int/lit v1 v1 1)
+        (invoke-static (v1) "Ljava/lang/Integer;.valueOf:(I)Ljava/lang/Integer;")
+        (move-result-object v2)
+        (return-object v2)
+      )
+    )
+  )");
+  auto* caller = make_method(R"(
+    (method (public static) "LFoo;.caller:(I)I"
+      (
+        (load-param v0)
+        (invoke-static (v0) "Ljava/lang/Integer;.valueOf:(I)Ljava/lang/Integer;")
+        (move-result-object v1)
+        (invoke-static (v1) "LFoo;.inc:(Ljava/lang/Integer;)Ljava/lang/Integer;")
+        (move-result-object v2)
+        (invoke-virtual (v2) "Ljava/lang/Integer;.intValue:()I")
+        (move-result v3)
+        (return v3)
+      )
+    )
+  )");
+  Scope scope{assembler::class_with_methods("LFoo;", {callee, caller})};
+
+  auto stats = BoxingEliminationPass::eliminate_boxing(scope);
+  EXPECT_EQ(1, stats.params_unboxed);
+  EXPECT_EQ(1, stats.returns_unboxed);
+  EXPECT_EQ(2, stats.boxings_removed);
+  EXPECT_EQ(2, stats.unboxings_removed);
+
+  EXPECT_EQ("LFoo;.inc:(I)I", show(callee));
+  expect_code(callee, R"(
+    (
+      (load-param v3)
+      (move v1 v3)
+      (add-int/lit v1 v1 1)
+      (move v4 v1)
+      (return v4)
+    )
+  )");
+  expect_code(caller, R"(
+    (
+      (load-param v0)
+      (move v4 v0)
+      (invoke-static (v4) "LFoo;.inc:(I)I")
+      (move-result v5)
+      (move v3 v5)
+      (return v3)
+    )
+  )");
+}
+
+TEST_F(BoxingEliminationTest, escapingBoxUnchanged) {
+  const char* callee_str = R"(
+    (method (private static) "LFoo;.use:(Ljava/lang/Long;)J"
+      (
+        (load-param-object v0)
+        (invoke-virtual (v0) "Ljava/lang/Long;.longValue:()J")
+        (move-result-wide v1)
+        (return-wide v1)
+      )
+    )
+  )";
+  const char* caller_str = R"(
+    (method (public static) "LFoo;.caller:(Ljava/lang/Long;)J"
+      (
+        (load-param-object v0)
+        (invoke-static (v0) "LFoo;.use:(Ljava/lang/Long;)J")
+        (move-result-wide v1)
+        (return-wide v1)
+      )
+    )
+  )";
+  auto* callee = make_method(callee_str);
+  auto* caller = make_method(caller_str);
+  Scope scope{assembler::class_with_methods("LFoo;", {callee, caller})};
+
+  // The caller passes its own parameter, which may be null or shared.
+  auto stats = BoxingEliminationPass::eliminate_boxing(scope);
+  EXPECT_EQ(0, stats.params_unboxed);
+  EXPECT_EQ("LFoo;.use:(Ljava/lang/Long;)J", show(callee));
+  expect_code(callee, R"(
+    (
+      (load-param-object v0)
+      (invoke-virtual (v0) "Ljava/lang/Long;.longValue:()J")
+      (move-result-wide v1)
+      (return-wide v1)
+    )
+  )");
+}
@@ -507,4 +507,33 @@ TEST_F(CFGMutationTest, InsertAfterVariant) {
       ))");
 }
 
+TEST_F(CFGMutationTest, FlushAndSimplify) {
+  EXPECT_MUTATION(
+      [](ControlFlowGraph& cfg) {
+        CFGMutation m(cfg);
+
+        auto* branch =
+            cfg.get_succ_edge_of_type(cfg.entry_block(), EDGE_BRANCH);
+        ASSERT_NE(branch, nullptr);
+        m.delete_edge(branch);
+        m.insert_after(nth_insn(cfg, 0), {dasm(OPCODE_CONST, {1_v, 1_L})});
+
+        // The loop becomes unreachable, even though it's its own predecessor.
+        EXPECT_EQ(m.flush_and_simplify(), 1);
+      },
+      /* ACTUAL */ R"((
+        (load-param v0)
+        (if-eqz v0 :loop)
+        (return-void)
+        (:loop)
+        (add-int/lit8 v0 v0 1)
+        (goto :loop)
+      ))",
+      /* EXPECTED */ R"((
+        (load-param v0)
+        (const v1 1)
+        (return-void)
+      ))");
+}
+
 } // namespace
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <sparta/HashedSetAbstractDomain.h>
+#include <sparta/MonotonicFixpointIterator.h>
+
+#include "CallGraph.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+
+using namespace call_graph;
+
+namespace {
+
+// Resolves every invoke to its referenced method definition.
+class DirectCallStrategy : public BuildStrategy {
+ public:
+  explicit DirectCallStrategy(call_graph::MethodSet roots) : m_roots(std::move(roots)) {}
+
+  CallSites get_callsites(const DexMethod* method) const override {
+    CallSites callsites;
+    auto* code = const_cast<DexMethod*>(method)->get_code();
+    if (code == nullptr) {
+      return callsites;
+    }
+    for (auto& mie : InstructionIterable(code)) {
+      auto* insn = mie.insn;
+      if (opcode::is_an_invoke(insn->opcode())) {
+        auto* callee = insn->get_method()->as_def();
+        if (callee != nullptr) {
+          callsites.emplace_back(callee, insn);
+        }
+      }
+    }
+    return callsites;
+  }
+
+  RootAndDynamic get_roots() const override {
+    return RootAndDynamic{m_roots, {}};
+  }
+
+  call_graph::MethodSet m_roots;
+};
+
+using EdgeDesc = std::tuple<const DexMethod*, const DexMethod*, IRInstruction*>;
+
+// All edges reachable from the entry, and the predecessors of each reachable
+// node, in graph order.
+std::pair<std::vector<EdgeDesc>,
+          std::unordered_map<const DexMethod*, std::vector<const DexMethod*>>>
+describe(const Graph& graph) {
+  std::vector<EdgeDesc> edges;
+  std::unordered_map<const DexMethod*, std::vector<const DexMethod*>> preds;
+  std::set<NodeId> visited{graph.entry()};
+  std::vector<NodeId> stack{graph.entry()};
+  while (!stack.empty()) {
+    auto node = stack.back();
+    stack.pop_back();
+    if (node->method() != nullptr) {
+      auto& node_preds = preds[node->method()];
+      for (const auto* edge : node->callers()) {
+        node_preds.push_back(edge->caller()->method());
+      }
+    }
+    for (const auto* edge : node->callees()) {
+      edges.emplace_back(node->method(), edge->callee()->method(),
+                         edge->invoke_insn());
+      if (visited.insert(edge->callee()).second) {
+        stack.push_back(edge->callee());
+      }
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  return {edges, preds};
+}
+
+DexMethod* make_method(const std::string& name, const std::string& body) {
+  return assembler::method_from_string(
+      "(method (public static) \"LFoo;." + name + ":()V\" (" + body +
+      " (return-void)))");
+}
+
+using MethodsDomain = sparta::HashedSetAbstractDomain<const DexMethod*>;
+
+// Computes the methods on some call chain from a root to each node.
+class CallChainsFixpointIterator
+    : public sparta::ParallelMonotonicFixpointIterator<CompactGraphInterface,
+                                                       MethodsDomain> {
+ public:
+  explicit CallChainsFixpointIterator(const CompactGraph& graph)
+      : ParallelMonotonicFixpointIterator(graph), m_graph(graph) {}
+
+  void analyze_node(const CompactGraph::NodeId& node,
+                    MethodsDomain* current_state) const override {
+    if (m_graph.method(node) != nullptr) {
+      current_state->add(m_graph.method(node));
+    }
+  }
+
+  MethodsDomain analyze_edge(
+      const CompactGraph::EdgeId&,
+      const MethodsDomain& exit_state_at_source) const override {
+    return exit_state_at_source;
+  }
+
+ private:
+  const CompactGraph& m_graph;
+};
+
+} // namespace
+
+class CallGraphTest : public RedexTest {};
+
+TEST_F(CallGraphTest, IncrementalUpdateMatchesRebuild) {
+  auto* c = make_method("c", "");
+  auto* d = make_method("d", "");
+  auto* b = make_method("b", "(invoke-static () \"LFoo;.c:()V\")");
+  auto* a = make_method("a",
+                        "(invoke-static () \"LFoo;.b:()V\")"
+                        "(invoke-static () \"LFoo;.c:()V\")");
+  DirectCallStrategy strat({a});
+  Graph graph(strat);
+  EXPECT_TRUE(graph.has_node(b));
+  EXPECT_FALSE(graph.has_node(d));
+
+  // a no longer calls b, but now calls d twice.
+  a->set_code(assembler::ircode_from_string(R"(
+    (
+      (invoke-static () "LFoo;.c:()V")
+      (invoke-static () "LFoo;.d:()V")
+      (invoke-static () "LFoo;.d:()V")
+      (return-void)
+    )
+  )"));
+  graph.update(strat, {a}, {});
+
+  EXPECT_FALSE(graph.has_node(b));
+  EXPECT_TRUE(graph.has_node(d));
+  EXPECT_EQ(graph.get_callers(c), MethodVector{a});
+  EXPECT_EQ(graph.node(d)->callers().size(), 2u);
+
+  Graph rebuilt(strat);
+  EXPECT_EQ(describe(graph), describe(rebuilt));
+  for (const auto& [insn, callees] : rebuilt.get_insn_to_callee()) {
+    EXPECT_EQ(resolve_callees_in_graph(graph, insn), callees);
+  }
+  EXPECT_EQ(graph.get_insn_to_callee().size(),
+            rebuilt.get_insn_to_callee().size());
+}
+
+TEST_F(CallGraphTest, IncrementalUpdateWithRemovedMethod) {
+  auto* c = make_method("c", "");
+  auto* b = make_method("b", "(invoke-static () \"LFoo;.c:()V\")");
+  auto* a = make_method("a", "(invoke-static () \"LFoo;.b:()V\")");
+  DirectCallStrategy strat({a, c});
+  Graph graph(strat);
+
+  // Remove b by redirecting its only caller.
+  a->set_code(assembler::ircode_from_string("((return-void))"));
+  graph.update(strat, {}, {b});
+
+  EXPECT_FALSE(graph.has_node(b));
+  EXPECT_TRUE(graph.get_callers(c).empty());
+
+  Graph rebuilt(strat);
+  EXPECT_EQ(describe(graph), describe(rebuilt));
+}
+
+TEST_F(CallGraphTest, CompactGraphMatchesGraph) {
+  auto* c = make_method("c", "");
+  auto* d = make_method("d", "");
+  auto* b = make_method("b", "(invoke-static () \"LFoo;.c:()V\")");
+  auto* a = make_method("a",
+                        "(invoke-static () \"LFoo;.c:()V\")"
+                        "(invoke-static () \"LFoo;.b:()V\")"
+                        "(invoke-static () \"LFoo;.c:()V\")");
+  DirectCallStrategy strat({a, b});
+  Graph graph(strat);
+  CompactGraph compact(strat);
+
+  EXPECT_EQ(compact.num_nodes(), 5u);
+  EXPECT_FALSE(compact.has_node(d));
+  auto callees = [&](const DexMethod* m) {
+    std::vector<std::pair<const DexMethod*, IRInstruction*>> res;
+    for (auto e : compact.callees(compact.node(m))) {
+      EXPECT_EQ(compact.method(compact.caller(e)), m);
+      res.emplace_back(compact.method(compact.callee(e)),
+                       compact.invoke_insn(e));
+    }
+    return res;
+  };
+  auto graph_callees = [&](const DexMethod* m) {
+    std::vector<std::pair<const DexMethod*, IRInstruction*>> res;
+    for (const auto* edge : graph.node(m)->callees()) {
+      res.emplace_back(edge->callee()->method(), edge->invoke_insn());
+    }
+    return res;
+  };
+  auto callers = [&](const DexMethod* m) {
+    std::vector<const DexMethod*> res;
+    for (auto e : compact.callers(compact.node(m))) {
+      EXPECT_EQ(compact.method(compact.callee(e)), m);
+      res.push_back(compact.method(compact.caller(e)));
+    }
+    return res;
+  };
+  auto graph_callers = [&](const DexMethod* m) {
+    std::vector<const DexMethod*> res;
+    for (const auto* edge : graph.node(m)->callers()) {
+      res.push_back(edge->caller()->method());
+    }
+    return res;
+  };
+  for (const DexMethod* m : MethodVector{nullptr, a, b, c}) {
+    EXPECT_EQ(callees(m), graph_callees(m));
+  }
+  for (const DexMethod* m : MethodVector{a, b, c}) {
+    EXPECT_EQ(callers(m), graph_callers(m));
+  }
+  EXPECT_EQ(callers(c), (std::vector<const DexMethod*>{a, a, b}));
+  EXPECT_EQ(compact.callers(compact.exit()).size(), 1u);
+
+  CallChainsFixpointIterator fp(compact);
+  fp.run(MethodsDomain());
+  EXPECT_TRUE(
+      fp.get_exit_state_at(compact.node(c)).equals(MethodsDomain({a, b, c})));
+  EXPECT_TRUE(
+      fp.get_exit_state_at(compact.node(b)).equals(MethodsDomain({a, b})));
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <sstream>
+
+#include "ClassLoadTrace.h"
+#include "RedexTest.h"
+
+using namespace interdex;
+
+class ClassLoadTraceTest : public RedexTest {};
+
+TEST_F(ClassLoadTraceTest, load) {
+  auto* foo = DexType::make_type("Lcom/Foo;");
+  auto* bar = DexType::make_type("Lcom/Bar;");
+  auto* baz = DexType::make_type("LA;");
+  std::istringstream pg_map("com.Baz -> A:\n");
+  ProguardMap proguard_map(pg_map);
+
+  std::istringstream input(
+      "# interaction\tclass\tms\n"
+      "cold_start\tcom.Foo\t1500\n"
+      "scroll\tLcom/Foo;\t200\n"
+      "cold_start\tcom.Bar\t3000\n"
+      "cold_start\tcom.Baz\t10\n"
+      "cold_start\tcom.Unknown\t10\n"
+      "\n"
+      "cold_start\tcom.Bar\n"
+      "cold_start\tcom.Bar\tsoon\n");
+  ClassLoadTrace trace;
+  EXPECT_EQ(trace.load(input, proguard_map), 2);
+
+  EXPECT_EQ(trace.size(), 3);
+  EXPECT_EQ(trace.get_first_load_ms(foo), 200);
+  EXPECT_EQ(trace.get_first_load_ms(bar), 3000);
+  EXPECT_EQ(trace.get_first_load_ms(baz), 10);
+  EXPECT_EQ(trace.get_first_load_ms(DexType::make_type("Lcom/Qux;")),
+            std::nullopt);
+}
@@ -36,7 +36,8 @@ void test(
     bool is_init_or_clinit = false,
     DexType* declaring_type = nullptr,
     DexTypeList* args = DexTypeList::make_type_list({}),
-    const std::unordered_set<const DexString*>& finalish_field_names = {}) {
+    const std::unordered_set<const DexString*>& finalish_field_names = {},
+    bool eliminate_partial_redundancies = false) {
   [[maybe_unused]] auto field_a =
       DexField::make_field("LFoo;.a:I")->make_concrete(ACC_PUBLIC);
 
@@ -75,7 +76,8 @@ void test(
   shared_state.init_scope(scope, clinit_has_no_side_effects);
   cse_impl::CommonSubexpressionElimination cse(&shared_state, code->cfg(),
                                                is_static, is_init_or_clinit,
-                                               declaring_type, args);
+                                               declaring_type, args,
+                                               eliminate_partial_redundancies);
   cse.patch();
   code->clear_cfg();
   walk::code(scope, [&](DexMethod*, IRCode& code) { code.clear_cfg(); });
@@ -2485,3 +2487,64 @@ TEST_F(CommonSubexpressionEliminationTest, if_lt_memory) {
   )";
   test(Scope{type_class(type::java_lang_Object())}, code_str, expected_str, 1);
 }
+
+TEST_F(CommonSubexpressionEliminationTest, partial_redundancy) {
+  auto code_str = R"(
+    (
+      (load-param v0)
+      (load-param v1)
+      (load-param v2)
+      (if-eqz v2 :L1)
+      (add-int v3 v0 v1)
+      (goto :L2)
+    (:L1)
+      (const v5 0)
+    (:L2)
+      (add-int v4 v0 v1)
+      (return v4)
+    )
+  )";
+  auto expected_str = R"(
+    (
+      (load-param v0)
+      (load-param v1)
+      (load-param v2)
+      (if-eqz v2 :L1)
+      (add-int v3 v0 v1)
+      (move v7 v3)
+    (:L2)
+      (add-int v4 v0 v1)
+      (move v4 v7)
+      (return v4)
+    (:L1)
+      (const v5 0)
+      (add-int v6 v0 v1)
+      (move v7 v6)
+      (goto :L2)
+    )
+  )";
+  test(Scope{type_class(type::java_lang_Object())}, code_str, expected_str, 1,
+       /* is_static */ true, /* is_init_or_clinit */ false,
+       /* declaring_type */ nullptr, DexTypeList::make_type_list({}),
+       /* finalish_field_names */ {},
+       /* eliminate_partial_redundancies */ true);
+}
+
+TEST_F(CommonSubexpressionEliminationTest, partial_redundancy_disabled) {
+  auto code_str = R"(
+    (
+      (load-param v0)
+      (load-param v1)
+      (load-param v2)
+      (if-eqz v2 :L1)
+      (add-int v3 v0 v1)
+      (goto :L2)
+    (:L1)
+      (const v5 0)
+    (:L2)
+      (add-int v4 v0 v1)
+      (return v4)
+    )
+  )";
+  test(Scope{type_class(type::java_lang_Object())}, code_str, code_str, 0);
+}
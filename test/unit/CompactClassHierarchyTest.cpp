@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "ClassHierarchy.h"
+#include "CompactClassHierarchy.h"
+#include "RedexTest.h"
+#include "ScopeHelper.h"
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+/**
+ * class java.lang.Object
+ * interface I1 {}
+ * interface I2 extends I1 {}
+ * interface I3 extends IOut {}
+ * external class Ext implements I3 {}
+ *  class A extends Ext implements I2 {}
+ *    class C extends A {}
+ *    class B extends A implements I1 {}
+ *      class D extends B {}
+ * // unknown super type
+ *  class Odd1 extends Odd implements I1 {}
+ */
+class CompactClassHierarchyTest : public RedexTest {
+ public:
+  CompactClassHierarchyTest() {
+    auto intf_flags = ACC_PUBLIC | ACC_INTERFACE;
+    scope = create_empty_scope();
+    auto* obj_t = type::java_lang_Object();
+    i1 = DexType::make_type("LI1;");
+    i2 = DexType::make_type("LI2;");
+    i3 = DexType::make_type("LI3;");
+    iout = DexType::make_type("LIOut;");
+    scope.push_back(create_internal_class(i1, obj_t, {}, intf_flags));
+    scope.push_back(create_internal_class(i2, obj_t, {i1}, intf_flags));
+    ext = DexType::make_type("LExt;");
+    create_external_class(ext, obj_t, {i3});
+    create_external_class(i3, obj_t, {iout}, intf_flags);
+    a = DexType::make_type("LA;");
+    b = DexType::make_type("LB;");
+    c = DexType::make_type("LC;");
+    d = DexType::make_type("LD;");
+    scope.push_back(create_internal_class(a, ext, {i2}));
+    scope.push_back(create_internal_class(c, a, {}));
+    scope.push_back(create_internal_class(b, a, {i1}));
+    scope.push_back(create_internal_class(d, b, {}));
+    odd = DexType::make_type("LOdd;");
+    odd1 = DexType::make_type("LOdd1;");
+    scope.push_back(create_internal_class(odd1, odd, {i1}));
+  }
+
+  Scope scope;
+  DexType* i1;
+  DexType* i2;
+  DexType* i3;
+  DexType* iout;
+  DexType* ext;
+  DexType* a;
+  DexType* b;
+  DexType* c;
+  DexType* d;
+  DexType* odd;
+  DexType* odd1;
+};
+
+TEST_F(CompactClassHierarchyTest, internal) {
+  CompactClassHierarchy ch(scope, /* include_external */ false);
+  EXPECT_THAT(ch.get_children(ext), ElementsAre(a));
+  EXPECT_THAT(ch.get_children(a), ElementsAre(b, c));
+  EXPECT_THAT(ch.get_children(b), ElementsAre(d));
+  EXPECT_THAT(ch.get_children(d), IsEmpty());
+  EXPECT_THAT(ch.get_children(odd), ElementsAre(odd1));
+  EXPECT_THAT(ch.get_children(i1), IsEmpty());
+
+  TypeSet all_children;
+  ch.get_all_children(ext, all_children);
+  EXPECT_THAT(all_children, ElementsAre(a, b, c, d));
+
+  // Ext is only known as a super class, but its interfaces are still
+  // inherited.
+  EXPECT_THAT(ch.get_implementors(i1), ElementsAre(a, b, c, d, odd1));
+  EXPECT_THAT(ch.get_implementors(i2), ElementsAre(a, b, c, d));
+  EXPECT_THAT(ch.get_implementors(i3), ElementsAre(a, b, c, d, ext));
+  EXPECT_THAT(ch.get_implementors(iout), ElementsAre(a, b, c, d, ext));
+  EXPECT_TRUE(ch.implements(d, i1));
+  EXPECT_TRUE(ch.implements(d, i3));
+  EXPECT_FALSE(ch.implements(i2, i1));
+  EXPECT_FALSE(ch.implements(odd, i1));
+
+  EXPECT_EQ(ch.to_class_hierarchy(), build_internal_type_hierarchy(scope));
+}
+
+TEST_F(CompactClassHierarchyTest, external) {
+  CompactClassHierarchy ch(scope, /* include_external */ true);
+  EXPECT_THAT(ch.get_children(type::java_lang_Object()), ElementsAre(ext));
+  EXPECT_TRUE(ch.implements(d, iout));
+
+  auto hierarchy = build_type_hierarchy(scope);
+  EXPECT_EQ(ch.to_class_hierarchy(), hierarchy);
+
+  // The compact form of the map-based hierarchy is the same.
+  CompactClassHierarchy from_map(hierarchy);
+  EXPECT_EQ(from_map.to_class_hierarchy(), hierarchy);
+  EXPECT_EQ(from_map.to_interface_map(), ch.to_interface_map());
+
+  auto interfaces = build_interface_map(hierarchy);
+  EXPECT_EQ(interfaces.size(), 4);
+  EXPECT_THAT(interfaces.at(i1), ElementsAre(a, b, c, d, odd1));
+  EXPECT_THAT(interfaces.at(i2), ElementsAre(a, b, c, d));
+  EXPECT_THAT(interfaces.at(iout), ElementsAre(a, b, c, d, ext));
+  EXPECT_TRUE(implements(interfaces, c, i3));
+}
@@ -14,6 +14,7 @@
 #include <gtest/gtest.h>
 #include <random>
 #include <string>
+#include <thread>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -367,6 +368,73 @@ TEST_F(ConcurrentContainersTest, insertOnlyConcurrentMapTest) {
   EXPECT_EQ(m_data_set.size(), map.size());
 }
 
+TEST_F(ConcurrentContainersTest, insertOnlyConcurrentPointerMapTest) {
+  auto to_key = [](uint32_t x) {
+    return reinterpret_cast<const void*>((uintptr_t(x) + 1) * 8);
+  };
+  // A small table pushes most keys into the overflow map.
+  for (size_t expected_size : {size_t(0), size_t(kSampleSize)}) {
+    InsertOnlyConcurrentPointerMap<const void*, uint32_t> map(expected_size);
+    InsertOnlyConcurrentMap<const void*, const uint32_t*> ptrs;
+    run_on_samples([&](const std::vector<uint32_t>& sample) {
+      for (auto x : sample) {
+        auto [ptr, emplaced] = map.emplace(to_key(x), x);
+        EXPECT_EQ(x, *ptr);
+        ptrs.emplace(to_key(x), ptr);
+        EXPECT_EQ(ptr, map.get(to_key(x)));
+      }
+    });
+    run_on_samples([&](const std::vector<uint32_t>& sample) {
+      for (auto x : sample) {
+        auto [ptr, emplaced] = map.emplace(to_key(x), x + 1);
+        EXPECT_FALSE(emplaced);
+        EXPECT_EQ(ptrs.at(to_key(x)), ptr);
+        EXPECT_EQ(x, map.at(to_key(x)));
+      }
+    });
+    EXPECT_EQ(m_data_set.size(), map.size());
+    size_t visited = 0;
+    map.for_each([&](const void* key, uint32_t value) {
+      EXPECT_EQ(to_key(value), key);
+      visited++;
+    });
+    EXPECT_EQ(m_data_set.size(), visited);
+    EXPECT_EQ(nullptr, map.get(to_key(1000000001)));
+    if (expected_size == 0) {
+      EXPECT_LT(0, map.overflow_size());
+    }
+  }
+}
+
+TEST_F(ConcurrentContainersTest, concurrentMapContention) {
+  ConcurrentMap<uint32_t, uint32_t> map;
+  map.emplace(1, 0);
+  EXPECT_EQ(0, map.contended_lock_acquisitions());
+
+  // Hold the slot lock for a while on one thread, so that the other one has
+  // to wait for it.
+  auto contended_before = cc_impl::s_contended_locks.load();
+  std::atomic<bool> holding{false};
+  boost::thread holder([&]() {
+    map.update(1, [&](uint32_t, uint32_t& value, bool) {
+      holding = true;
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      value++;
+    });
+  });
+  while (!holding) {
+  }
+  map.update(1, [](uint32_t, uint32_t& value, bool) { value++; });
+  holder.join();
+
+  EXPECT_EQ(2, map.at(1));
+  size_t slot = std::hash<uint32_t>()(1) % cc_impl::kDefaultSlots;
+  EXPECT_EQ(1, map.contended_lock_acquisitions(slot));
+  EXPECT_EQ(1, map.contended_lock_acquisitions());
+  EXPECT_LE(contended_before + 1, cc_impl::s_contended_locks.load());
+  EXPECT_LE(1, cc_impl::s_max_slot_contended_locks.load());
+}
+
 TEST_F(ConcurrentContainersTest, move) {
   ConcurrentMap<void*, void*> map1;
   map1.emplace(nullptr, nullptr);
@@ -426,3 +494,44 @@ TEST_F(ConcurrentContainersTest, atThrows) {
   }
   EXPECT_TRUE(threw);
 }
+
+TEST_F(ConcurrentContainersTest, concurrentClockCacheTest) {
+  ConcurrentClockCache<uint32_t, uint32_t> unbounded;
+  run_on_samples([&unbounded](const std::vector<uint32_t>& sample) {
+    for (auto x : sample) {
+      auto value = unbounded.get_or_create(x, [](uint32_t k) { return k + 1; });
+      EXPECT_EQ(x + 1, *value);
+    }
+  });
+  EXPECT_EQ(m_data_set.size(), unbounded.size());
+  EXPECT_EQ(0, unbounded.evictions());
+  for (uint32_t x : m_data) {
+    auto value = unbounded.get(x);
+    ASSERT_TRUE(value);
+    EXPECT_EQ(x + 1, *value);
+  }
+
+  // Each entry is accounted at least sizeof(uint32_t) bytes, so a budget of
+  // that many bytes per slot forces evictions; values handed out stay valid.
+  ConcurrentClockCache<uint32_t, uint32_t> bounded(
+      sizeof(uint32_t) * cc_impl::kDefaultSlots);
+  std::vector<std::shared_ptr<uint32_t>> values;
+  for (uint32_t x : m_data) {
+    values.push_back(bounded.get_or_create(x, [](uint32_t k) { return k; }));
+  }
+  EXPECT_GT(bounded.evictions(), 0);
+  EXPECT_LE(bounded.size(), cc_impl::kDefaultSlots);
+  for (size_t i = 0; i < m_data.size(); ++i) {
+    EXPECT_EQ(m_data[i], *values[i]);
+  }
+
+  // Recently used entries survive.
+  ConcurrentClockCache<uint32_t, std::string, std::hash<uint32_t>,
+                       std::equal_to<uint32_t>, /* n_slots */ 1>
+      small(1000, [](const std::string& s) { return s.size(); });
+  for (uint32_t i = 0; i < 100; ++i) {
+    small.get_or_create(i, [](uint32_t) { return std::string(50, 'x'); });
+    EXPECT_TRUE(small.get(0));
+  }
+  EXPECT_LE(small.size_in_bytes(), 1000);
+}
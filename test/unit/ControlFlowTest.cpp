@@ -11,6 +11,7 @@
 
 #include "ControlFlow.h"
 #include "DexAsm.h"
+#include "Dominators.h"
 #include "IRAssembler.h"
 #include "IRCode.h"
 #include "RedexTest.h"
@@ -359,6 +360,94 @@ TEST_F(ControlFlowTest, nullForwardIterators) {
   }
 }
 
+TEST_F(ControlFlowTest, blockMap) {
+  auto fake_block = [](size_t i) {
+    return reinterpret_cast<cfg::Block*>(sizeof(void*) * (i + 1));
+  };
+  auto ids = [](const cfg::BlockMap& blocks) {
+    std::vector<BlockId> res;
+    for (const auto& entry : blocks) {
+      res.push_back(entry.first);
+    }
+    return res;
+  };
+
+  cfg::BlockMap blocks;
+  EXPECT_TRUE(blocks.empty());
+  EXPECT_EQ(blocks.begin(), blocks.end());
+  for (size_t i = 0; i < 5; i++) {
+    blocks.emplace(blocks.next_id(), fake_block(i));
+  }
+  EXPECT_EQ(blocks.erase(1), 1);
+  EXPECT_EQ(blocks.erase(3), 1);
+  EXPECT_EQ(blocks.erase(3), 0);
+  EXPECT_EQ(blocks.size(), 3);
+  EXPECT_EQ(ids(blocks), std::vector<BlockId>({0, 2, 4}));
+  EXPECT_EQ(blocks.count(1), 0);
+  EXPECT_EQ(blocks.find(1), blocks.end());
+  EXPECT_EQ(blocks.at(2), fake_block(2));
+
+  // Iterators survive growing the storage.
+  auto it = blocks.find(2);
+  auto end = blocks.end();
+  for (size_t i = 5; i < 100; i++) {
+    blocks.emplace(blocks.next_id(), fake_block(i));
+  }
+  EXPECT_EQ(it->second, fake_block(2));
+  ++it;
+  EXPECT_EQ(it->first, 4);
+  EXPECT_EQ((--end)->first, 99);
+
+  // Removing the last blocks makes their ids available again.
+  it = blocks.find(99);
+  EXPECT_EQ(blocks.erase(it), blocks.end());
+  EXPECT_EQ(blocks.next_id(), 99);
+  for (size_t i = 5; i < 99; i++) {
+    blocks.erase(i);
+  }
+  EXPECT_EQ(blocks.next_id(), 5);
+  EXPECT_EQ(blocks.last(), fake_block(4));
+  blocks.erase(4);
+  EXPECT_EQ(blocks.next_id(), 3);
+  EXPECT_EQ(blocks.last(), fake_block(2));
+}
+
+TEST_F(ControlFlowTest, cachedAnalyses) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+      (if-eqz v0 :true)
+      (const v1 1)
+      (:true)
+      (return-void)
+    )
+  )");
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+  auto* entry = cfg.entry_block();
+  auto* exit = cfg.exit_block();
+
+  const auto& doms = dominators::get_dominators(cfg);
+  EXPECT_EQ(&doms, &dominators::get_dominators(cfg));
+  EXPECT_EQ(doms.get_idom(exit), entry);
+  EXPECT_EQ(dominators::get_post_dominators(cfg).get_idom(entry), exit);
+
+  // Editing instructions doesn't invalidate the cached analyses.
+  auto generation = cfg.structure_generation();
+  exit->push_front(new IRInstruction(OPCODE_NOP));
+  EXPECT_EQ(cfg.structure_generation(), generation);
+  EXPECT_EQ(&doms, &dominators::get_dominators(cfg));
+
+  // Splitting a block does.
+  auto* split = cfg.split_block(exit, exit->get_first_insn());
+  EXPECT_NE(cfg.structure_generation(), generation);
+  EXPECT_EQ(dominators::get_dominators(cfg).get_idom(exit), entry);
+  EXPECT_EQ(dominators::get_dominators(cfg).get_idom(split), exit);
+
+  code->clear_cfg();
+}
+
 TEST_F(ControlFlowTest, copyConstructibleIterator) {
   auto code = assembler::ircode_from_string(R"(
     (
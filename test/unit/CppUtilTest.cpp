@@ -79,3 +79,10 @@ TEST(CppUtilTest, testThreeColumnEmptyCSV) {
   std::vector<std::string_view> expected{"", "", ""};
   test_iterators(split_string(str, ","), expected);
 }
+
+TEST(CppUtilTest, testViewIntoLargerString) {
+  std::string str = "a,b\nc,d";
+  std::vector<std::string_view> expected{"a", "b"};
+  test_iterators(split_string(std::string_view(str).substr(0, 3), ","),
+                 expected);
+}
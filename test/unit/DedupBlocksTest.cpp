@@ -1996,3 +1996,57 @@ TEST_F(DedupBlocksTest, blockWithIterativeLimit2) {
 
   EXPECT_CODE_EQ(expected_code.get(), code);
 }
+
+TEST_F(DedupBlocksTest, crossMethodDuplicates) {
+  auto make_method = [&](const std::string& name, const char* code) {
+    auto* method = get_fresh_method(name);
+    method->set_code(assembler::ircode_from_string(code));
+    method->get_code()->build_cfg();
+    return method;
+  };
+  auto* a = make_method("a", R"(
+    (
+      (const v0 0)
+      (if-eqz v0 :other)
+      (const v1 1)
+      (add-int v1 v1 v1)
+      (mul-int v1 v1 v1)
+      (return-void)
+      (:other)
+      (return-void)
+    )
+  )");
+  // Same block as in `a`, up to register names.
+  auto* b = make_method("b", R"(
+    (
+      (const v2 1)
+      (add-int v2 v2 v2)
+      (mul-int v2 v2 v2)
+      (return-void)
+    )
+  )");
+  // Not consistently renamed.
+  auto* c = make_method("c", R"(
+    (
+      (const v2 1)
+      (add-int v2 v3 v2)
+      (mul-int v2 v2 v2)
+      (return-void)
+    )
+  )");
+  std::vector<DexClass*> scope{m_creator->create()};
+
+  dedup_blocks_impl::Config config;
+  auto dups = dedup_blocks_impl::find_cross_method_duplicates(&config, scope);
+  ASSERT_EQ(1, dups.size());
+  ASSERT_EQ(2, dups[0].size());
+  std::unordered_set<DexMethod*> methods{dups[0][0].method,
+                                         dups[0][1].method};
+  EXPECT_EQ(std::unordered_set<DexMethod*>({a, b}), methods);
+  EXPECT_EQ(4, dups[0][0].block->num_opcodes());
+  EXPECT_EQ(0, methods.count(c));
+
+  config.cross_method_min_insns = 5;
+  EXPECT_TRUE(
+      dedup_blocks_impl::find_cross_method_duplicates(&config, scope).empty());
+}
@@ -214,3 +214,97 @@ Methods:
 
   EXPECT_EQ(c->show_structure(), expected);
 }
+
+TEST_F(DexClassTest, collectGarbage) {
+  assembler::class_with_method("LLive;",
+                               R"(
+      (method (public static) "LLive;.foo:()V"
+       (
+        (const-string "live string")
+        (move-result-pseudo-object v0)
+        (invoke-static (v0) "LExternal;.used:(Ljava/lang/String;)V")
+        (sget "LExternal;.usedField:I")
+        (move-result-pseudo v1)
+        (return-void)
+       )
+      )
+    )");
+  DexMethod::make_method("LExternal;.unused:(Ljava/lang/String;J)V");
+  DexField::make_field("LExternal;.unusedField:I");
+  DexString::make_string("dead string");
+  DexString::make_string(std::string(300, 'x'));
+  auto* kept = DexMethod::make_method("LExternal;.kept:(J)V");
+
+  auto stats = g_redex->collect_garbage({kept});
+
+  EXPECT_NE(DexString::get_string("live string"), nullptr);
+  EXPECT_NE(DexString::get_string("foo"), nullptr);
+  EXPECT_NE(DexMethod::get_method("LExternal;.used:(Ljava/lang/String;)V"),
+            nullptr);
+  EXPECT_NE(DexField::get_field("LExternal;.usedField:I"), nullptr);
+  EXPECT_EQ(DexMethod::get_method("LExternal;.kept:(J)V"), kept);
+
+  EXPECT_EQ(DexString::get_string("dead string"), nullptr);
+  EXPECT_EQ(DexString::get_string(std::string(300, 'x')), nullptr);
+  EXPECT_EQ(DexString::get_string("unused"), nullptr);
+  EXPECT_EQ(DexString::get_string("unusedField"), nullptr);
+  EXPECT_EQ(DexMethod::get_method("LExternal;.unused:(Ljava/lang/String;J)V"),
+            nullptr);
+  EXPECT_EQ(DexField::get_field("LExternal;.unusedField:I"), nullptr);
+  EXPECT_EQ(DexProto::get_proto(
+                DexType::make_type("V"),
+                DexTypeList::make_type_list(
+                    {DexType::make_type("Ljava/lang/String;"),
+                     DexType::make_type("J")})),
+            nullptr);
+  EXPECT_GE(stats.strings, 4u);
+  EXPECT_EQ(stats.method_refs, 1u);
+  EXPECT_EQ(stats.field_refs, 1u);
+  EXPECT_GE(stats.protos, 1u);
+
+  // Collected objects can be recreated.
+  EXPECT_NE(DexMethod::make_method("LExternal;.unused:(Ljava/lang/String;J)V"),
+            nullptr);
+}
+
+TEST_F(DexClassTest, makeStrings) {
+  auto* existing = DexString::make_string("existing");
+  std::string large(300, 'x');
+  std::vector<std::string_view> strs{"existing", "new", large,
+                                     "new",      "",    "caf\xc3\xa9"};
+  auto dex_strings = DexString::make_strings(strs);
+  ASSERT_EQ(strs.size(), dex_strings.size());
+  EXPECT_EQ(existing, dex_strings[0]);
+  for (size_t i = 0; i < strs.size(); ++i) {
+    EXPECT_EQ(DexString::make_string(strs[i]), dex_strings[i]);
+    EXPECT_EQ(strs[i], dex_strings[i]->str());
+  }
+  EXPECT_EQ(dex_strings[1], dex_strings[3]);
+  EXPECT_EQ(4, dex_strings[5]->length());
+}
+
+TEST_F(DexClassTest, batchRenames) {
+  auto* a = DexMethod::make_method("LFoo;.a:()V");
+  auto* b = DexMethod::make_method("LFoo;.b:()V");
+  // Names can be swapped within a batch.
+  DexMethodRef::change_names(
+      {{a, DexString::make_string("b")}, {b, DexString::make_string("a")}});
+  EXPECT_EQ("b", a->get_name()->str());
+  EXPECT_EQ(a, DexMethod::get_method("LFoo;.b:()V"));
+  EXPECT_EQ(b, DexMethod::get_method("LFoo;.a:()V"));
+
+  auto* f = DexField::make_field("LFoo;.f:I");
+  DexFieldRef::change_names({{f, DexString::make_string("g")}});
+  EXPECT_EQ(f, DexField::get_field("LFoo;.g:I"));
+  EXPECT_EQ(nullptr, DexField::get_field("LFoo;.f:I"));
+
+  auto* foo = DexType::make_type("LFoo;");
+  auto* foo_array = DexType::make_type("[LFoo;");
+  DexType::set_names({{foo, DexString::make_string("LBar;")},
+                      {foo_array, DexString::make_string("[LBar;")}});
+  EXPECT_EQ("LBar;", foo->str());
+  EXPECT_EQ(foo, DexType::get_type("LBar;"));
+  EXPECT_EQ(foo_array, DexType::get_type("[LBar;"));
+  // Old names are kept, as with set_name.
+  EXPECT_EQ(foo, DexType::get_type("LFoo;"));
+}
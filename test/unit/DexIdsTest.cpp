@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <unordered_set>
+
+#include <sparta/PatriciaTreeMap.h>
+#include <sparta/PatriciaTreeSet.h>
+
+#include "DenseIdTable.h"
+#include "DexIds.h"
+#include "RedexTest.h"
+#include "WorkQueue.h"
+
+class DexIdsTest : public RedexTest {};
+
+TEST_F(DexIdsTest, DenseIdTable) {
+  struct Obj {
+    std::atomic<uint32_t> id{0};
+  };
+  DenseIdTable<Obj> table;
+  std::vector<Obj> objs(100);
+  EXPECT_EQ(table.get(1), nullptr);
+  workqueue_run_for<size_t>(0, 1000, [&](size_t i) {
+    auto& obj = objs[i % objs.size()];
+    auto id = table.get_or_assign(&obj, &obj.id);
+    EXPECT_NE(id, 0u);
+    EXPECT_EQ(table.get(id), &obj);
+  });
+  std::unordered_set<uint32_t> ids;
+  for (auto& obj : objs) {
+    EXPECT_TRUE(ids.insert(obj.id.load()).second);
+  }
+  EXPECT_GE(table.end(), 101u);
+}
+
+TEST_F(DexIdsTest, RoundTrip) {
+  auto* foo = DexType::make_type("LFoo;");
+  auto* bar = DexType::make_type("LBar;");
+  DexTypeId foo_id(foo);
+  DexTypeId bar_id(bar);
+  EXPECT_TRUE(foo_id);
+  EXPECT_NE(foo_id, bar_id);
+  EXPECT_EQ(foo_id, DexTypeId(foo));
+  EXPECT_EQ(foo_id.get(), foo);
+  EXPECT_EQ(bar_id.get(), bar);
+  EXPECT_FALSE(DexTypeId());
+  EXPECT_EQ(DexTypeId().get(), nullptr);
+  EXPECT_EQ(DexTypeId(nullptr).get(), nullptr);
+
+  auto* field = DexField::make_field("LFoo;.f:I");
+  auto* method = DexMethod::make_method("LFoo;.m:()V");
+  EXPECT_EQ(DexFieldRefId(field).get(), field);
+  EXPECT_EQ(DexMethodRefId(method).get(), method);
+}
+
+TEST_F(DexIdsTest, PatriciaTreeKeys) {
+  auto* foo = DexType::make_type("LFoo;");
+  auto* bar = DexType::make_type("LBar;");
+
+  sparta::PatriciaTreeMap<DexTypeId, uint32_t> map;
+  map.insert_or_assign(DexTypeId(foo), 1);
+  map.insert_or_assign(DexTypeId(bar), 2);
+  EXPECT_EQ(map.at(DexTypeId(foo)), 1u);
+  EXPECT_EQ(map.at(DexTypeId(bar)), 2u);
+
+  sparta::PatriciaTreeSet<DexTypeId> set;
+  set.insert(DexTypeId(foo));
+  EXPECT_TRUE(set.contains(DexTypeId(foo)));
+  EXPECT_FALSE(set.contains(DexTypeId(bar)));
+  for (auto id : set) {
+    EXPECT_EQ(id.get(), foo);
+  }
+}
@@ -8,6 +8,7 @@
 #include "DexOutput.h"
 #include <gtest/gtest.h>
 #include <json/json.h>
+#include <random>
 
 TEST(DexOutput, checkMethodInstructionSizeLimit) {
 
@@ -24,3 +25,30 @@ TEST(DexOutput, checkMethodInstructionSizeLimit) {
       DexOutput::check_method_instruction_size_limit(conf, 65537, "method"),
       RedexException);
 }
+
+TEST(DexOutput, estimateDeflatedSize) {
+  EXPECT_EQ(0, estimate_deflated_size(nullptr, 0));
+
+  std::vector<uint8_t> repetitive(1024 * 1024);
+  for (size_t i = 0; i < repetitive.size(); i++) {
+    repetitive[i] = i % 16;
+  }
+  std::vector<uint8_t> noisy(repetitive.size());
+  std::mt19937 gen(0);
+  for (auto& byte : noisy) {
+    byte = gen();
+  }
+  auto repetitive_size =
+      estimate_deflated_size(repetitive.data(), repetitive.size());
+  auto noisy_size = estimate_deflated_size(noisy.data(), noisy.size());
+  EXPECT_LT(repetitive_size, repetitive.size() / 10);
+  EXPECT_GT(noisy_size, noisy.size() * 9 / 10);
+
+  // Beyond 64 windows of 64KB, only every n-th window is compressed.
+  std::vector<uint8_t> large(16 * 1024 * 1024);
+  for (size_t i = 0; i < large.size(); i++) {
+    large[i] = i % 16;
+  }
+  auto large_size = estimate_deflated_size(large.data(), large.size());
+  EXPECT_NEAR(repetitive_size * 16.0, large_size, repetitive_size);
+}
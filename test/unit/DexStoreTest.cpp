@@ -58,3 +58,28 @@ TEST_F(DexStoreTest, squash_dexes) {
   stores.emplace_back(std::move(non_root_store));
   squash_and_check(stores);
 }
+
+TEST_F(DexStoreTest, run_on_stores_in_parallel) {
+  DexStoresVector stores;
+  for (size_t i = 0; i < 8; i++) {
+    DexStore store("store" + std::to_string(i));
+    DexClasses classes;
+    for (size_t j = 0; j < i; j++) {
+      classes.push_back(create_class(
+          ("Lstore" + std::to_string(i) + "_" + std::to_string(j) + ";")
+              .c_str()));
+    }
+    store.add_classes(std::move(classes));
+    stores.emplace_back(std::move(store));
+  }
+  std::vector<DexStore*> store_ptrs;
+  for (auto& store : stores) {
+    store_ptrs.push_back(&store);
+  }
+
+  std::vector<size_t> visits(stores.size());
+  run_on_stores_in_parallel(store_ptrs, [&](DexStore& store) {
+    visits[&store - stores.data()]++;
+  });
+  EXPECT_THAT(visits, ::testing::Each(1));
+}
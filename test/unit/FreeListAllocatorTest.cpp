@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "FreeListAllocator.h"
+
+namespace {
+
+struct Foo {
+  uint64_t a;
+  uint64_t b;
+
+  static void* operator new(size_t size) {
+    return FreeListAllocator<sizeof(Foo), 4>::allocate(size);
+  }
+  static void operator delete(void* ptr, size_t size) {
+    FreeListAllocator<sizeof(Foo), 4>::deallocate(ptr, size);
+  }
+};
+
+using Allocator = FreeListAllocator<sizeof(Foo), 4>;
+
+} // namespace
+
+TEST(FreeListAllocatorTest, ReusesFreedObjects) {
+  auto* foo = new Foo{1, 2};
+  auto cached = Allocator::cached();
+  delete foo;
+  EXPECT_EQ(Allocator::cached(), cached + 1);
+  auto* bar = new Foo{3, 4};
+  EXPECT_EQ(bar, foo);
+  EXPECT_EQ(Allocator::cached(), cached);
+  EXPECT_EQ(bar->a, 3u);
+  delete bar;
+}
+
+TEST(FreeListAllocatorTest, CacheIsBounded) {
+  std::vector<Foo*> foos;
+  for (size_t i = 0; i < 10; ++i) {
+    foos.push_back(new Foo{i, i});
+  }
+  for (auto* foo : foos) {
+    delete foo;
+  }
+  EXPECT_EQ(Allocator::cached(), 4u);
+}
+
+TEST(FreeListAllocatorTest, FreeOnOtherThread) {
+  std::vector<Foo*> foos;
+  for (size_t i = 0; i < 3; ++i) {
+    foos.push_back(new Foo{i, i});
+  }
+  size_t cached_on_other_thread = 0;
+  std::thread thread([&]() {
+    for (auto* foo : foos) {
+      delete foo;
+    }
+    cached_on_other_thread = Allocator::cached();
+  });
+  thread.join();
+  EXPECT_EQ(cached_on_other_thread, 3u);
+}
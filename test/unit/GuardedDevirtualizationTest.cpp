@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "ControlFlow.h"
+#include "Creators.h"
+#include "DexClass.h"
+#include "GuardedDevirtualization.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+
+class GuardedDevirtualizationTest : public RedexTest {
+ public:
+  void SetUp() override {
+    auto i_type = DexType::make_type("LI;");
+    ClassCreator i_creator(i_type);
+    i_creator.set_access(ACC_PUBLIC | ACC_INTERFACE | ACC_ABSTRACT);
+    i_creator.set_super(type::java_lang_Object());
+    m_callee = DexMethod::make_method("LI;.m:()I")
+                   ->make_concrete(ACC_PUBLIC | ACC_ABSTRACT, true);
+    i_creator.add_method(m_callee);
+    i_creator.create();
+
+    auto a_type = DexType::make_type("LA;");
+    ClassCreator a_creator(a_type);
+    a_creator.set_access(ACC_PUBLIC);
+    a_creator.set_super(type::java_lang_Object());
+    a_creator.add_interface(i_type);
+    m_target = DexMethod::make_method("LA;.m:()I")
+                   ->make_concrete(ACC_PUBLIC, true);
+    a_creator.add_method(m_target);
+    a_creator.create();
+  }
+
+  void test(const std::string& code_str,
+            const std::string& expected_str,
+            size_t expected_guarded_call_sites) {
+    auto code = assembler::ircode_from_string(code_str);
+    auto expected = assembler::ircode_from_string(expected_str);
+
+    GuardedDevirtualizationPass::DominantTargets dominant_targets{
+        {m_callee, m_target}};
+    code->build_cfg();
+    auto stats =
+        GuardedDevirtualizationPass::process_code(dominant_targets, code.get());
+    EXPECT_EQ(expected_guarded_call_sites, stats.guarded_call_sites);
+
+    code->clear_cfg();
+    EXPECT_CODE_EQ(code.get(), expected.get());
+  }
+
+ private:
+  DexMethod* m_callee;
+  DexMethod* m_target;
+};
+
+TEST_F(GuardedDevirtualizationTest, hot_call_site) {
+  const auto& code_str = R"(
+    (
+      (load-param-object v0)
+      (.src_block "LFoo;.bar:()V" 0 (1.0 1.0))
+      (invoke-interface (v0) "LI;.m:()I")
+      (move-result v1)
+      (return v1)
+    )
+  )";
+  const auto& expected_str = R"(
+    (
+      (load-param-object v0)
+      (.src_block "LFoo;.bar:()V" 0 (1.0 1.0))
+      (instance-of v0 "LA;")
+      (move-result-pseudo v3)
+      (if-nez v3 :fast)
+      (invoke-interface (v0) "LI;.m:()I")
+      (move-result v1)
+      (:join)
+      (return v1)
+      (:fast)
+      (.src_block "LFoo;.bar:()V" 0 (1.0 1.0))
+      (check-cast v0 "LA;")
+      (move-result-pseudo-object v2)
+      (invoke-virtual (v2) "LA;.m:()I")
+      (move-result v1)
+      (goto :join)
+    )
+  )";
+  test(code_str, expected_str, 1);
+}
+
+TEST_F(GuardedDevirtualizationTest, cold_call_site_stays) {
+  const auto& code_str = R"(
+    (
+      (load-param-object v0)
+      (.src_block "LFoo;.bar:()V" 0 (0.0 0.0))
+      (invoke-interface (v0) "LI;.m:()I")
+      (move-result v1)
+      (return v1)
+    )
+  )";
+  test(code_str, code_str, 0);
+}
+
+TEST_F(GuardedDevirtualizationTest, call_site_in_try_stays) {
+  const auto& code_str = R"(
+    (
+      (load-param-object v0)
+      (.src_block "LFoo;.bar:()V" 0 (1.0 1.0))
+      (.try_start a)
+      (invoke-interface (v0) "LI;.m:()I")
+      (move-result v1)
+      (.try_end a)
+      (return v1)
+      (.catch (a))
+      (const v1 0)
+      (return v1)
+    )
+  )";
+  test(code_str, code_str, 0);
+}
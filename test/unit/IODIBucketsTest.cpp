@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <gtest/gtest.h>
+#include <random>
+
+#include "IODIBuckets.h"
+
+namespace {
+
+constexpr size_t kLimit = 8192;
+constexpr uint32_t kHeader = 4;
+
+std::vector<uint32_t> random_sizes(size_t n, uint32_t seed) {
+  std::mt19937 gen(seed);
+  std::lognormal_distribution<double> dist(3.0, 1.2);
+  std::vector<uint32_t> sizes;
+  for (size_t i = 0; i < n; ++i) {
+    sizes.push_back(1 + (uint32_t)std::min(dist(gen), 20000.0));
+  }
+  std::sort(sizes.begin(), sizes.end(), std::greater<uint32_t>());
+  return sizes;
+}
+
+} // namespace
+
+TEST(IODIBucketsTest, bucketsRespectLimit) {
+  auto sizes = random_sizes(20000, 1);
+  auto buckets = iodi::optimal_buckets(sizes, kLimit, kHeader);
+  ASSERT_FALSE(buckets.empty());
+  uint32_t total = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    total += buckets[i].count;
+    if (i > 0) {
+      EXPECT_LT(buckets[i].size, buckets[i - 1].size);
+    }
+    // Only buckets of equally sized methods may exceed the limit.
+    if ((size_t)buckets[i].size * buckets[i].count > kLimit) {
+      EXPECT_EQ(buckets[i].count,
+                std::count(sizes.begin(), sizes.end(), buckets[i].size));
+    }
+  }
+  EXPECT_EQ(sizes.size(), total);
+  EXPECT_EQ(sizes.front(), buckets.front().size);
+
+  // The bucket counts match the methods that end up using each program.
+  auto cost = iodi::evaluate_buckets(sizes, buckets, kHeader);
+  EXPECT_EQ(buckets.size(), cost.programs);
+  uint64_t inflated = 0;
+  for (const auto& bucket : buckets) {
+    inflated += (uint64_t)bucket.size * bucket.count;
+  }
+  EXPECT_EQ(inflated, cost.inflated_size);
+}
+
+TEST(IODIBucketsTest, greedyMayExceedLimit) {
+  // The greedy bucketing closes the bucket {100, 60} when 50 does not fit,
+  // but does not open a new one for 50, which then uses the program of 100.
+  std::vector<uint32_t> sizes = {100, 60, 50};
+  auto greedy = iodi::evaluate_buckets(
+      sizes, iodi::greedy_buckets(sizes, 250), kHeader);
+  EXPECT_EQ(1, greedy.programs);
+  EXPECT_EQ(300, greedy.max_bucket_inflated_size);
+
+  auto optimal = iodi::evaluate_buckets(
+      sizes, iodi::optimal_buckets(sizes, 250, kHeader), kHeader);
+  EXPECT_EQ(2, optimal.programs);
+  EXPECT_EQ(200, optimal.max_bucket_inflated_size);
+  EXPECT_EQ(2 * kHeader + 100 + 50, optimal.program_bytes);
+}
+
+TEST(IODIBucketsTest, smallInputs) {
+  EXPECT_TRUE(iodi::optimal_buckets({}, kLimit, kHeader).empty());
+
+  // Everything fits into one program.
+  auto buckets = iodi::optimal_buckets({10, 5, 5, 1}, kLimit, kHeader);
+  ASSERT_EQ(1, buckets.size());
+  EXPECT_EQ(10, buckets[0].size);
+  EXPECT_EQ(4, buckets[0].count);
+
+  // Splitting {100, 50, 50} after 100 and after the first 50 would take as
+  // many program bytes, but methods of the same size share a program.
+  buckets = iodi::optimal_buckets({100, 50, 50}, 250, kHeader);
+  ASSERT_EQ(2, buckets.size());
+  EXPECT_EQ(100, buckets[0].size);
+  EXPECT_EQ(1, buckets[0].count);
+  EXPECT_EQ(50, buckets[1].size);
+  EXPECT_EQ(2, buckets[1].count);
+
+  // Closing a bucket late is cheaper than closing it early: {100, 10}, {9}
+  // takes one program byte less than {100}, {10, 9}.
+  buckets = iodi::optimal_buckets({100, 10, 9}, 250, kHeader);
+  ASSERT_EQ(2, buckets.size());
+  EXPECT_EQ(2, buckets[0].count);
+  EXPECT_EQ(9, buckets[1].size);
+
+  // Methods of the same size share a program, even beyond the limit.
+  buckets = iodi::optimal_buckets({300, 300, 2}, 250, kHeader);
+  ASSERT_EQ(2, buckets.size());
+  EXPECT_EQ(300, buckets[0].size);
+  EXPECT_EQ(2, buckets[0].count);
+}
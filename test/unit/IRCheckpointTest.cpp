@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fstream>
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "IRAssembler.h"
+#include "IRCheckpoint.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+#include "RedexTestUtils.h"
+
+class IRCheckpointTest : public RedexTest {
+ public:
+  void SetUp() override {
+    auto* type = DexType::make_type("LFoo;");
+    ClassCreator cc(type);
+    cc.set_super(type::java_lang_Object());
+    m_bar = DexMethod::make_method("LFoo;.bar:(I)I")
+                ->make_concrete(ACC_PUBLIC | ACC_STATIC,
+                                /*is_virtual=*/false);
+    m_bar->set_code(assembler::ircode_from_string(R"(
+      (
+        (load-param v0)
+        (.src_block "LFoo;.bar:(I)I" 0 (1.0 0.5))
+        (.pos:dbg_0 "LFoo;.bar:(I)I" "Foo.java" 10)
+        (.pos:dbg_1 "LFoo;.baz:()V" "Foo.java" 20 dbg_0)
+        (.try_start a)
+        (div-int v0 v0)
+        (move-result-pseudo v1)
+        (.try_end a)
+        (return v1)
+        (.catch (a) "Ljava/lang/ArithmeticException;")
+        (const v1 0)
+        (return v1)
+      )
+    )"));
+    m_bar->get_code()->set_registers_size(5);
+    // Values the assembler syntax would round, and a chained block it drops.
+    for (auto& mie : *m_bar->get_code()) {
+      if (mie.type == MFLOW_SOURCE_BLOCK) {
+        mie.src_block = std::make_unique<SourceBlock>(
+            mie.src_block->src, mie.src_block->id,
+            std::vector<SourceBlock::Val>{
+                SourceBlock::Val(1.0f / 3, 100.0f / 7),
+                SourceBlock::Val::none()});
+        mie.src_block->append(std::make_unique<SourceBlock>(
+            DexString::make_string("LFoo;.baz:()V"), 3,
+            std::vector<SourceBlock::Val>{SourceBlock::Val(0.1f, 0.2f)}));
+      }
+    }
+    m_bar->get_code()->build_cfg();
+    cc.add_method(m_bar);
+
+    m_baz = DexMethod::make_method("LFoo;.baz:()V")
+                ->make_concrete(ACC_PUBLIC | ACC_STATIC,
+                                /*is_virtual=*/false);
+    m_baz->set_code(assembler::ircode_from_string("((return-void))"));
+    cc.add_method(m_baz);
+    m_cls = cc.create();
+  }
+
+  static std::string to_string(const IRCode* code) {
+    IRCode copy(*code);
+    if (copy.editable_cfg_built()) {
+      copy.clear_cfg();
+    }
+    return assembler::to_string(&copy);
+  }
+
+  static const SourceBlock* first_source_block(IRCode* code) {
+    code->clear_cfg();
+    for (const auto& mie : *code) {
+      if (mie.type == MFLOW_SOURCE_BLOCK) {
+        return mie.src_block.get();
+      }
+    }
+    return nullptr;
+  }
+
+  void clobber() {
+    m_bar->set_code(assembler::ircode_from_string("((return-void))"));
+    m_baz->set_code(
+        assembler::ircode_from_string("((const v0 0) (return-void))"));
+  }
+
+ protected:
+  DexClass* m_cls;
+  DexMethod* m_bar;
+  DexMethod* m_baz;
+};
+
+TEST_F(IRCheckpointTest, roundTrip) {
+  auto bar_code = to_string(m_bar->get_code());
+  auto baz_code = to_string(m_baz->get_code());
+  auto tmp_dir = redex::make_tmp_dir("IRCheckpointTest%%%%%%%%");
+  ir_checkpoint::dump({m_cls}, tmp_dir.path);
+  // Dumping leaves the CFG alone.
+  EXPECT_TRUE(m_bar->get_code()->editable_cfg_built());
+
+  clobber();
+  ASSERT_TRUE(ir_checkpoint::load(tmp_dir.path));
+
+  auto* bar = m_bar->get_code();
+  EXPECT_TRUE(bar->editable_cfg_built());
+  EXPECT_EQ(5, bar->get_registers_size());
+  EXPECT_EQ(bar_code, to_string(bar));
+  EXPECT_FALSE(m_baz->get_code()->editable_cfg_built());
+  EXPECT_EQ(baz_code, to_string(m_baz->get_code()));
+
+  auto* sb = first_source_block(bar);
+  ASSERT_NE(nullptr, sb);
+  ASSERT_EQ(2, sb->vals_size);
+  EXPECT_EQ(1.0f / 3, sb->vals[0]->val);
+  EXPECT_EQ(100.0f / 7, sb->vals[0]->appear100);
+  EXPECT_FALSE(sb->vals[1]);
+  ASSERT_NE(nullptr, sb->next);
+  EXPECT_EQ("LFoo;.baz:()V", sb->next->src->str());
+  EXPECT_EQ(3, sb->next->id);
+  ASSERT_EQ(1, sb->next->vals_size);
+  EXPECT_EQ(0.1f, sb->next->vals[0]->val);
+  EXPECT_EQ(nullptr, sb->next->next);
+}
+
+TEST_F(IRCheckpointTest, rejectsCorruptedFiles) {
+  auto tmp_dir = redex::make_tmp_dir("IRCheckpointTest%%%%%%%%");
+  EXPECT_FALSE(ir_checkpoint::load(tmp_dir.path));
+
+  ir_checkpoint::dump({m_cls}, tmp_dir.path);
+  auto file = tmp_dir.path + "/ir_code.bin";
+  std::string contents;
+  {
+    std::ifstream in(file, std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(in),
+                    std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), contents.size() - 1);
+  }
+  clobber();
+  auto baz_code = to_string(m_baz->get_code());
+  EXPECT_FALSE(ir_checkpoint::load(tmp_dir.path));
+  // No method was touched.
+  EXPECT_EQ(baz_code, to_string(m_baz->get_code()));
+}
@@ -252,3 +252,35 @@ TEST_F(IRCodeTest, encode_large_packed_switch) {
   EXPECT_EQ(dod->data_size(), 1 + 2 + 2 * kTargetCount);
   EXPECT_EQ(dod->data()[0], kTargetCount);
 }
+
+TEST_F(IRCodeTest, keep_editable_cfg) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (const v0 0)
+      (if-eqz v0 :lbl)
+      (const v1 1)
+      (:lbl)
+      (return-void)
+    )
+  )");
+  auto kept = IRCode::get_kept_editable_cfgs();
+  code->build_cfg();
+
+  // By default, build_cfg starts over with a fresh graph.
+  code->build_cfg();
+  EXPECT_EQ(kept, IRCode::get_kept_editable_cfgs());
+
+  IRCode::set_keep_editable_cfg(true);
+  auto* cfg = &code->cfg();
+  code->build_cfg();
+  EXPECT_EQ(cfg, &code->cfg());
+  EXPECT_EQ(kept + 1, IRCode::get_kept_editable_cfgs());
+
+  // Explicitly clearing still linearizes, and the next build is fresh.
+  code->clear_cfg();
+  EXPECT_FALSE(code->cfg_built());
+  code->build_cfg();
+  EXPECT_TRUE(code->editable_cfg_built());
+  IRCode::set_keep_editable_cfg(false);
+  code->clear_cfg();
+}
@@ -212,6 +212,25 @@ TEST_F(IRInstructionTest, TwoAddr) {
               ->set_src(1, 17));
 }
 
+TEST_F(IRInstructionTest, CompactEncodingStats) {
+  using namespace dex_asm;
+
+  auto* method =
+      static_cast<DexMethod*>(DexMethod::make_method("Lfoo;", "bar", "V", {}));
+  method->make_concrete(ACC_PUBLIC | ACC_STATIC, /* is_virtual */ false);
+  method->set_code(std::make_unique<IRCode>(method, 0));
+  auto* code = method->get_code();
+  code->push_back(dasm(OPCODE_CONST, {1_v, 0_L}));
+  code->push_back(dasm(OPCODE_ADD_INT, {0_v, 0_v, 1_v}));
+  code->push_back(dasm(OPCODE_ADD_INT, {17_v, 17_v, 1_v}));
+  code->push_back(dasm(OPCODE_RETURN_VOID));
+  auto stats = instruction_lowering::lower(method);
+  EXPECT_EQ(stats.binops, 2);
+  EXPECT_EQ(stats.to_2addr, 1);
+  EXPECT_EQ(stats.reg_insns, 3);
+  EXPECT_EQ(stats.compact_reg_insns, 2);
+}
+
 TEST_F(IRInstructionTest, SelectCheckCast) {
   using namespace dex_asm;
 
@@ -431,3 +450,31 @@ TEST_F(IRInstructionTest, CopyInstructionWithData) {
   delete insn;
   delete copy;
 }
+
+TEST_F(IRInstructionTest, ResizeSources) {
+  IRInstruction insn(OPCODE_INVOKE_STATIC);
+  insn.set_srcs_size(2);
+  insn.set_src(0, 1);
+  insn.set_src(1, 2);
+
+  // Growing out of the inline storage keeps the registers, and zeroes the new
+  // ones.
+  insn.set_srcs_size(4);
+  insn.set_src(3, 4);
+  EXPECT_EQ(insn.srcs_vec(), std::vector<reg_t>({1, 2, 0, 4}));
+
+  IRInstruction copy(insn);
+  EXPECT_EQ(copy, insn);
+  copy.set_src(2, 3);
+  EXPECT_NE(copy, insn);
+  EXPECT_EQ(insn.src(2), 0);
+
+  insn.set_srcs_size(5);
+  EXPECT_EQ(insn.srcs_vec(), std::vector<reg_t>({1, 2, 0, 4, 0}));
+
+  // Back to inline storage.
+  copy.set_srcs_size(1);
+  EXPECT_EQ(copy.srcs_vec(), std::vector<reg_t>({1}));
+  copy.set_srcs_size(2);
+  EXPECT_EQ(copy.srcs_vec(), std::vector<reg_t>({1, 0}));
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fstream>
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "IRMetaIO.h"
+#include "RedexTest.h"
+#include "RedexTestUtils.h"
+#include "Show.h"
+
+class IRMetaIOTest : public RedexTest {
+ public:
+  void SetUp() override { create_class(); }
+
+  // Starts over with a fresh context, with the same class.
+  void reset() {
+    delete g_redex;
+    g_redex = new RedexContext();
+    create_class();
+  }
+
+  void create_class() {
+    auto* type = DexType::make_type("LFoo;");
+    ClassCreator cc(type);
+    cc.set_super(type::java_lang_Object());
+    auto* field = DexField::make_field("LFoo;.f:I")->make_concrete(ACC_PUBLIC);
+    cc.add_field(field);
+    auto* method =
+        DexMethod::make_method("LFoo;.bar:(I)V")
+            ->make_concrete(ACC_PUBLIC | ACC_STATIC, /*is_virtual=*/false);
+    cc.add_method(method);
+    auto* plain =
+        DexMethod::make_method("LFoo;.baz:()V")
+            ->make_concrete(ACC_PUBLIC | ACC_STATIC, /*is_virtual=*/false);
+    cc.add_method(plain);
+    m_cls = cc.create();
+    m_field = field;
+    m_method = method;
+    m_plain = plain;
+  }
+
+ protected:
+  DexClass* m_cls;
+  DexField* m_field;
+  DexMethod* m_method;
+  DexMethod* m_plain;
+};
+
+TEST_F(IRMetaIOTest, roundTrip) {
+  m_cls->set_deobfuscated_name("Lcom/example/Foo;");
+  m_cls->rstate.referenced_by_string();
+  m_field->set_deobfuscated_name("Lcom/example/Foo;.field:I");
+  m_method->rstate.set_root();
+  m_plain->set_deobfuscated_name(show(m_plain));
+
+  auto tmp_dir = redex::make_tmp_dir("IRMetaIOTest%%%%%%%%");
+  ir_meta_io::dump({m_cls}, tmp_dir.path);
+
+  reset();
+  ASSERT_TRUE(m_method->rstate.can_delete());
+
+  ASSERT_TRUE(ir_meta_io::load(tmp_dir.path));
+  EXPECT_EQ("Lcom/example/Foo;", m_cls->get_deobfuscated_name_or_empty());
+  EXPECT_TRUE(m_cls->rstate.is_referenced_by_string());
+  EXPECT_EQ("Lcom/example/Foo;.field:I",
+            m_field->get_deobfuscated_name_or_empty());
+  EXPECT_FALSE(m_method->rstate.can_delete());
+  EXPECT_EQ(show(m_method), m_method->get_deobfuscated_name_or_empty());
+}
+
+TEST_F(IRMetaIOTest, rejectsCorruptedFiles) {
+  m_method->rstate.set_root();
+  auto tmp_dir = redex::make_tmp_dir("IRMetaIOTest%%%%%%%%");
+  ir_meta_io::dump({m_cls}, tmp_dir.path);
+
+  auto file = tmp_dir.path + "/irmeta.bin";
+  std::string contents;
+  {
+    std::ifstream in(file, std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(in),
+                    std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), contents.size() - 1);
+  }
+  reset();
+  EXPECT_FALSE(ir_meta_io::load(tmp_dir.path));
+}
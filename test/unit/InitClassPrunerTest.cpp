@@ -244,3 +244,24 @@ TEST_F(InitClassPrunerTest, remove_after_ifield_access) {
   run_init_class_pruner(code.get());
   EXPECT_CODE_EQ(code.get(), expected_code.get());
 }
+
+TEST_F(InitClassPrunerTest, update_init_classes_with_side_effects) {
+  Scope scope{type_class(type::java_lang_Object()), type_class(a_type),
+              type_class(b_type), type_class(c_type), type_class(d_type)};
+  init_classes::InitClassesWithSideEffects init_classes_with_side_effects(
+      scope, /* create_init_class_insns */ true);
+  EXPECT_EQ(init_classes_with_side_effects.refine(d_type), c_type);
+  EXPECT_EQ(init_classes_with_side_effects.get(d_type)->size(), 2);
+  EXPECT_EQ(init_classes_with_side_effects.update(scope), 0);
+
+  // Once B's clinit has no side effects, the results of its subclasses that
+  // included it are recomputed as well.
+  type_class(b_type)->get_clinit()->set_code(
+      assembler::ircode_from_string("((return-void))"));
+  EXPECT_GE(init_classes_with_side_effects.update(scope), 3);
+  EXPECT_EQ(init_classes_with_side_effects.refine(d_type), c_type);
+  EXPECT_EQ(init_classes_with_side_effects.get(d_type)->size(), 1);
+  EXPECT_EQ(init_classes_with_side_effects.refine(b_type), nullptr);
+  EXPECT_EQ(init_classes_with_side_effects.refine(a_type), nullptr);
+  EXPECT_EQ(init_classes_with_side_effects.update(scope), 0);
+}
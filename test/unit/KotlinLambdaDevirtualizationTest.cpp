@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "KotlinLambdaDevirtualizationPass.h"
+
+#include "Creators.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+#include "Show.h"
+
+class KotlinLambdaDevirtualizationTest : public RedexTest {
+ public:
+  static DexMethod* make_method(const std::string& str) {
+    auto* method = assembler::method_from_string(str);
+    method->get_code()->build_cfg();
+    return method;
+  }
+
+  // A non-capturing `(String) -> String` lambda, with its INSTANCE singleton,
+  // typed `invoke` and bridge.
+  static DexClass* create_lambda() {
+    auto* type = DexType::make_type("LFoo$bar$1;");
+    ClassCreator cc(type);
+    cc.set_super(DexType::make_type("Lkotlin/jvm/internal/Lambda;"));
+    cc.add_interface(DexType::make_type("Lkotlin/jvm/functions/Function1;"));
+    cc.set_access(ACC_PUBLIC | ACC_FINAL);
+    auto* instance = DexField::make_field("LFoo$bar$1;.INSTANCE:LFoo$bar$1;")
+                         ->make_concrete(ACC_PUBLIC | ACC_STATIC | ACC_FINAL);
+    cc.add_field(instance);
+    cc.add_method(make_method(R"(
+      (method (static constructor) "LFoo$bar$1;.<clinit>:()V"
+        (
+          (new-instance "LFoo$bar$1;")
+          (move-result-pseudo-object v0)
+          (invoke-direct (v0) "LFoo$bar$1;.<init>:()V")
+          (sput-object v0 "LFoo$bar$1;.INSTANCE:LFoo$bar$1;")
+          (return-void)
+        )
+      )
+    )"));
+    cc.add_method(make_method(R"(
+      (method (public constructor) "LFoo$bar$1;.<init>:()V"
+        (
+          (load-param-object v0)
+          (const v1 1)
+          (invoke-direct (v0 v1) "Lkotlin/jvm/internal/Lambda;.<init>:(I)V")
+          (return-void)
+        )
+      )
+    )"));
+    cc.add_method(make_method(R"(
+      (method (public final) "LFoo$bar$1;.invoke:(Ljava/lang/String;)Ljava/lang/String;"
+        (
+          (load-param-object v0)
+          (load-param-object v1)
+          (return-object v1)
+        )
+      )
+    )"));
+    cc.add_method(make_method(R"(
+      (method (public bridge synthetic) "LFoo$bar$1;.invoke:(Ljava/lang/Object;)Ljava/lang/Object;"
+        (
+          (load-param-object v0)
+          (load-param-object v1)
+          (check-cast v1 "Ljava/lang/String;")
+          (move-result-pseudo-object v1)
+          (invoke-virtual (v0 v1) "LFoo$bar$1;.invoke:(Ljava/lang/String;)Ljava/lang/String;")
+          (move-result-object v2)
+          (return-object v2)
+        )
+      )
+    )"));
+    return cc.create();
+  }
+
+  static void expect_code(DexMethod* method, const std::string& expected) {
+    method->get_code()->clear_cfg();
+    auto expected_code = assembler::ircode_from_string(expected);
+    EXPECT_CODE_EQ(expected_code.get(), method->get_code());
+  }
+};
+
+TEST_F(KotlinLambdaDevirtualizationTest, interfaceCallBecomesStatic) {
+  auto* lambda = create_lambda();
+  auto* caller = make_method(R"(
+    (method (public static) "LFoo;.bar:(Ljava/lang/String;)Ljava/lang/Object;"
+      (
+        (load-param-object v0)
+        (sget-object "LFoo$bar$1;.INSTANCE:LFoo$bar$1;")
+        (move-result-pseudo-object v1)
+        (check-cast v1 "Lkotlin/jvm/functions/Function1;")
+        (move-result-pseudo-object v1)
+        (invoke-interface (v1 v0) "Lkotlin/jvm/functions/Function1;.invoke:(Ljava/lang/Object;)Ljava/lang/Object;")
+        (move-result-object v2)
+        (return-object v2)
+      )
+    )
+  )");
+  Scope scope{lambda, assembler::class_with_methods("LFoo;", {caller})};
+
+  auto stats = KotlinLambdaDevirtualizationPass::devirtualize_lambdas(scope);
+  EXPECT_EQ(1, stats.lambdas);
+  EXPECT_EQ(1, stats.invokes);
+
+  expect_code(caller, R"(
+    (
+      (load-param-object v0)
+      (invoke-static (v0) "LFoo$bar$1;.invoke:(Ljava/lang/Object;)Ljava/lang/Object;")
+      (move-result-object v2)
+      (return-object v2)
+    )
+  )");
+  auto* bridge = DexMethod::get_method(
+                     "LFoo$bar$1;.invoke:(Ljava/lang/Object;)Ljava/lang/Object;")
+                     ->as_def();
+  EXPECT_TRUE(is_static(bridge));
+  expect_code(bridge, R"(
+    (
+      (load-param-object v0)
+      (check-cast v0 "Ljava/lang/String;")
+      (move-result-pseudo-object v0)
+      (invoke-static (v0) "LFoo$bar$1;.invoke:(Ljava/lang/String;)Ljava/lang/String;")
+      (move-result-object v1)
+      (return-object v1)
+    )
+  )");
+  EXPECT_TRUE(lambda->get_vmethods().empty());
+}
+
+TEST_F(KotlinLambdaDevirtualizationTest, escapingInstanceUnchanged) {
+  auto* lambda = create_lambda();
+  auto* caller = make_method(R"(
+    (method (public static) "LFoo;.bar:(Ljava/lang/String;)Ljava/lang/Object;"
+      (
+        (load-param-object v0)
+        (sget-object "LFoo$bar$1;.INSTANCE:LFoo$bar$1;")
+        (move-result-pseudo-object v1)
+        (invoke-interface (v1 v0) "Lkotlin/jvm/functions/Function1;.invoke:(Ljava/lang/Object;)Ljava/lang/Object;")
+        (move-result-object v2)
+        (invoke-static (v1) "LFoo;.keep:(Ljava/lang/Object;)V")
+        (return-object v2)
+      )
+    )
+  )");
+  Scope scope{lambda, assembler::class_with_methods("LFoo;", {caller})};
+
+  // The instance is also passed elsewhere, where it may be called through
+  // its interface.
+  auto stats = KotlinLambdaDevirtualizationPass::devirtualize_lambdas(scope);
+  EXPECT_EQ(0, stats.lambdas);
+  EXPECT_EQ(2, lambda->get_vmethods().size());
+  expect_code(caller, R"(
+    (
+      (load-param-object v0)
+      (sget-object "LFoo$bar$1;.INSTANCE:LFoo$bar$1;")
+      (move-result-pseudo-object v1)
+      (invoke-interface (v1 v0) "Lkotlin/jvm/functions/Function1;.invoke:(Ljava/lang/Object;)Ljava/lang/Object;")
+      (move-result-object v2)
+      (invoke-static (v1) "LFoo;.keep:(Ljava/lang/Object;)V")
+      (return-object v2)
+    )
+  )");
+}
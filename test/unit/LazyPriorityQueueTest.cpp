@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <random>
+
+#include "LazyPriorityQueue.h"
+#include "MutablePriorityQueue.h"
+
+TEST(LazyPriorityQueueTest, basic) {
+  LazyPriorityQueue<int, uint64_t> pq;
+  EXPECT_TRUE(pq.empty());
+  pq.insert(1, 10);
+  pq.insert(2, 20);
+  pq.insert(3, 5);
+  EXPECT_EQ(pq.front(), 2);
+  pq.update_priority(2, 1);
+  EXPECT_EQ(pq.front(), 1);
+  EXPECT_EQ(pq.get_priority(2), 1);
+  pq.erase(1);
+  EXPECT_FALSE(pq.contains(1));
+  EXPECT_EQ(pq.front(), 3);
+  pq.update_priority(2, 30);
+  EXPECT_EQ(pq.front(), 2);
+  pq.clear();
+  EXPECT_TRUE(pq.empty());
+}
+
+TEST(LazyPriorityQueueTest, matches_mutable_priority_queue) {
+  std::mt19937 gen(0);
+  LazyPriorityQueue<uint32_t, uint64_t> lazy;
+  MutablePriorityQueue<uint32_t, uint64_t> reference;
+  // Priorities carry the value in the low bits to keep them unique.
+  auto make_priority = [&](uint32_t value) {
+    return (uint64_t(gen() % 16) << 32) | value;
+  };
+  for (size_t step = 0; step < 20000; ++step) {
+    uint32_t value = gen() % 200;
+    switch (gen() % 4) {
+    case 0:
+    case 1:
+      if (reference.contains(value)) {
+        auto priority = make_priority(value);
+        lazy.update_priority(value, priority);
+        reference.update_priority(value, priority);
+      } else {
+        auto priority = make_priority(value);
+        lazy.insert(value, priority);
+        reference.insert(value, priority);
+      }
+      break;
+    case 2:
+      if (reference.contains(value)) {
+        lazy.erase(value);
+        reference.erase(value);
+      }
+      break;
+    default:
+      if (!reference.empty()) {
+        auto front = reference.front();
+        ASSERT_EQ(lazy.front(), front);
+        lazy.erase(front);
+        reference.erase(front);
+      }
+      break;
+    }
+    ASSERT_EQ(lazy.empty(), reference.empty());
+    ASSERT_LE(lazy.heap_size(), 2 * 200 + 64 + 1);
+  }
+}
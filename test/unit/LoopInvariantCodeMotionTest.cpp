@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "ControlFlow.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "LoopInvariantCodeMotion.h"
+#include "Purity.h"
+#include "RedexTest.h"
+
+class LoopInvariantCodeMotionTest : public RedexTest {};
+
+void test(const std::string& code_str,
+          const std::string& expected_str,
+          size_t expected_instructions_hoisted) {
+  auto code = assembler::ircode_from_string(code_str);
+  auto expected = assembler::ircode_from_string(expected_str);
+
+  auto pure_methods = get_pure_methods();
+  code->build_cfg();
+  auto stats = LoopInvariantCodeMotionPass::process_code(
+      pure_methods, /* is_clinit */ false, /* declaring_type */ nullptr,
+      code.get());
+  EXPECT_EQ(expected_instructions_hoisted, stats.instructions_hoisted);
+
+  code->clear_cfg();
+  EXPECT_CODE_EQ(code.get(), expected.get());
+}
+
+TEST_F(LoopInvariantCodeMotionTest, hoist_arithmetic) {
+  const auto& code_str = R"(
+    (
+      (load-param v0)
+      (:loop)
+      (const v1 10)
+      (add-int v2 v0 v1)
+      (invoke-static (v2) "LFoo;.bar:(I)V")
+      (goto :loop)
+    )
+  )";
+  const auto& expected_str = R"(
+    (
+      (load-param v0)
+      (const v1 10)
+      (add-int v2 v0 v1)
+      (:loop)
+      (invoke-static (v2) "LFoo;.bar:(I)V")
+      (goto :loop)
+    )
+  )";
+  test(code_str, expected_str, 2);
+}
+
+TEST_F(LoopInvariantCodeMotionTest, loop_carried_registers_stay) {
+  const auto& code_str = R"(
+    (
+      (load-param v0)
+      (const v1 0)
+      (:loop)
+      (if-ge v1 v0 :end)
+      (const v2 1)
+      (add-int v1 v1 v2)
+      (goto :loop)
+      (:end)
+      (return v1)
+    )
+  )";
+  const auto& expected_str = R"(
+    (
+      (load-param v0)
+      (const v1 0)
+      (const v2 1)
+      (:loop)
+      (if-ge v1 v0 :end)
+      (add-int v1 v1 v2)
+      (goto :loop)
+      (:end)
+      (return v1)
+    )
+  )";
+  test(code_str, expected_str, 1);
+}
+
+TEST_F(LoopInvariantCodeMotionTest, hoist_pure_invoke_from_header) {
+  const auto& code_str = R"(
+    (
+      (load-param-object v0)
+      (load-param v1)
+      (:loop)
+      (invoke-virtual (v0) "Ljava/lang/String;.length:()I")
+      (move-result v2)
+      (if-ge v1 v2 :end)
+      (add-int/lit v1 v1 1)
+      (goto :loop)
+      (:end)
+      (return v1)
+    )
+  )";
+  const auto& expected_str = R"(
+    (
+      (load-param-object v0)
+      (load-param v1)
+      (invoke-virtual (v0) "Ljava/lang/String;.length:()I")
+      (move-result v2)
+      (:loop)
+      (if-ge v1 v2 :end)
+      (add-int/lit v1 v1 1)
+      (goto :loop)
+      (:end)
+      (return v1)
+    )
+  )";
+  test(code_str, expected_str, 1);
+}
+
+TEST_F(LoopInvariantCodeMotionTest, pure_invoke_after_side_effect_stays) {
+  const auto& code_str = R"(
+    (
+      (load-param-object v0)
+      (load-param v1)
+      (:loop)
+      (invoke-static () "LFoo;.bar:()V")
+      (invoke-virtual (v0) "Ljava/lang/String;.length:()I")
+      (move-result v2)
+      (if-ge v1 v2 :end)
+      (add-int/lit v1 v1 1)
+      (goto :loop)
+      (:end)
+      (return v1)
+    )
+  )";
+  test(code_str, code_str, 0);
+}
+
+TEST_F(LoopInvariantCodeMotionTest, value_live_after_loop_stays) {
+  const auto& code_str = R"(
+    (
+      (load-param v0)
+      (const v2 0)
+      (:loop)
+      (if-eqz v0 :end)
+      (const v2 1)
+      (invoke-static (v2) "LFoo;.bar:(I)V")
+      (goto :loop)
+      (:end)
+      (return v2)
+    )
+  )";
+  test(code_str, code_str, 0);
+}
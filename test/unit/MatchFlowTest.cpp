@@ -467,6 +467,44 @@ TEST_F(MatchFlowTest, ResultFlagHidesMoveResult) {
   EXPECT_INSNS(res.matching(ret, ret_0, 0), invoke);
 }
 
+TEST_F(MatchFlowTest, SharedUseDefs) {
+  flow_t f;
+  auto lit_f = f.insn(m::const_());
+  auto add = f.insn(m::add_int_()).src(0, lit_f, exists | alias);
+
+  flow_t g;
+  auto lit_g = g.insn(m::const_());
+  auto sub = g.insn(m::sub_int_()).src(1, lit_g, forall | dest);
+
+  auto code = assembler::ircode_from_string(R"((
+    (const v0 0)
+    (move v1 v0)
+    (add-int v2 v1 v1)
+    (sub-int v3 v2 v0)
+    (sub-int v4 v2 v1)
+    (return-void)
+  ))");
+
+  cfg::ScopedCFG cfg{code.get()};
+  auto ii = InstructionIterable(*cfg);
+  auto mies = IndexedWrapper{ii};
+
+  ASSERT_INSN(const_0, mies[0], OPCODE_CONST);
+  ASSERT_INSN(add_int, mies[2], OPCODE_ADD_INT);
+  ASSERT_INSN(sub_int, mies[3], OPCODE_SUB_INT);
+
+  use_defs_t use_defs{*cfg};
+  auto res_f = f.find(use_defs, add);
+  auto res_g = g.find(use_defs, sub);
+
+  EXPECT_INSNS(res_f.matching(add), add_int);
+  EXPECT_INSNS(res_f.matching(add, add_int, 0), const_0);
+
+  // The second sub-int reads a move, which is not looked through.
+  EXPECT_INSNS(res_g.matching(sub), sub_int);
+  EXPECT_INSNS(res_g.matching(sub, sub_int, 1), const_0);
+}
+
 TEST_F(MatchFlowTest, ResultSrc) {
   [[maybe_unused]] auto* Foo_src = DexMethod::make_method("LFoo;.src:()I");
 
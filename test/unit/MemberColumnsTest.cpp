@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "DexAccess.h"
+#include "IRAssembler.h"
+#include "MemberColumns.h"
+#include "RedexTest.h"
+
+class MemberColumnsTest : public RedexTest {};
+
+TEST_F(MemberColumnsTest, methods) {
+  auto* cls = assembler::class_with_methods(
+      "LFoo;",
+      {
+          assembler::method_from_string(R"(
+            (method (public static) "LFoo;.a:()V"
+             ((return-void)))
+          )"),
+          assembler::method_from_string(R"(
+            (method (public) "LFoo;.b:()I"
+             ((const v0 0)
+              (return v0)))
+          )"),
+      });
+  auto* a = static_cast<DexMethod*>(DexMethod::get_method("LFoo;.a:()V"));
+  auto* b = static_cast<DexMethod*>(DexMethod::get_method("LFoo;.b:()I"));
+  b->rstate.set_root();
+
+  MethodColumns columns({cls});
+  ASSERT_EQ(columns.size(), 2u);
+  auto ra = columns.row(a);
+  auto rb = columns.row(b);
+  ASSERT_NE(ra, MethodColumns::NONE);
+  ASSERT_NE(rb, MethodColumns::NONE);
+  EXPECT_EQ(columns.member(ra), a);
+  EXPECT_EQ(columns.member(rb), b);
+  EXPECT_TRUE(is_static(columns.access(ra)));
+  EXPECT_FALSE(is_static(columns.access(rb)));
+  EXPECT_TRUE(columns.can_delete(ra));
+  EXPECT_FALSE(columns.can_delete(rb));
+  EXPECT_FALSE(columns.is_external(ra));
+  EXPECT_EQ(columns.code_size(ra), a->get_code()->sum_opcode_sizes());
+  EXPECT_GT(columns.code_size(rb), columns.code_size(ra));
+
+  auto deletable =
+      columns.filter([&](uint32_t r) { return columns.can_delete(r); });
+  EXPECT_EQ(deletable, std::vector<DexMethod*>{a});
+
+  auto* other = DexMethod::make_method("LBar;.c:()V");
+  EXPECT_EQ(columns.row(static_cast<DexMethod*>(other)), MethodColumns::NONE);
+
+  a->set_access(a->get_access() | ACC_FINAL);
+  EXPECT_FALSE(is_final(columns.access(ra)));
+  columns.update(a);
+  EXPECT_TRUE(is_final(columns.access(ra)));
+}
+
+TEST_F(MemberColumnsTest, fields) {
+  auto* cls = assembler::class_with_methods("LFoo;", {});
+  auto* f = DexField::make_field("LFoo;.f:I")->make_concrete(ACC_PUBLIC);
+  auto* g = DexField::make_field("LFoo;.g:I")->make_concrete(ACC_STATIC);
+  cls->add_field(f);
+  cls->add_field(g);
+
+  FieldColumns columns({cls});
+  ASSERT_EQ(columns.size(), 2u);
+  EXPECT_TRUE(is_static(columns.access(columns.row(g))));
+  EXPECT_FALSE(is_static(columns.access(columns.row(f))));
+  EXPECT_EQ(columns.code_size(columns.row(f)), 0u);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "IRAssembler.h"
+#include "MergeabilityCheck.h"
+#include "Model.h"
+#include "RedexTest.h"
+#include "RefChecker.h"
+
+using namespace class_merging;
+
+class MergeabilityCheckTest : public RedexTest {
+ public:
+  void SetUp() override {
+    auto* base = make_class("LBase;", type::java_lang_Object());
+    m_a = make_class("LA;", base->get_type())->get_type();
+    m_b = make_class("LB;", base->get_type())->get_type();
+    m_c = make_class("LC;", base->get_type())->get_type();
+    m_safe = DexType::make_type("LSafe;");
+
+    ClassCreator cc(DexType::make_type("LUser;"));
+    cc.set_super(type::java_lang_Object());
+    auto* method =
+        DexMethod::make_method(
+            "LUser;.use:(Ljava/lang/Object;)Ljava/lang/Class;")
+            ->make_concrete(ACC_PUBLIC | ACC_STATIC, /* is_virtual */ false);
+    method->set_code(assembler::ircode_from_string(R"(
+      (
+        (load-param-object v0)
+        (const-class "LA;")
+        (move-result-pseudo-object v1)
+        (invoke-static (v1) "LSafe;.take:(Ljava/lang/Class;)V")
+        (instance-of v0 "LC;")
+        (move-result-pseudo v2)
+        (const-class "LB;")
+        (move-result-pseudo-object v1)
+        (return-object v1)
+      )
+    )"));
+    method->get_code()->build_cfg();
+    cc.add_method(method);
+    m_scope.push_back(cc.create());
+
+    m_spec.merging_targets = {m_a, m_b, m_c};
+    m_spec.const_class_safe_types = {m_safe};
+    m_spec.include_primary_dex = true;
+  }
+
+  DexClass* make_class(const char* name, DexType* super) {
+    ClassCreator cc(DexType::make_type(name));
+    cc.set_super(super);
+    auto* ctor = DexMethod::make_method(std::string(name) + ".<init>:()V")
+                     ->make_concrete(ACC_PUBLIC | ACC_CONSTRUCTOR,
+                                     /* is_virtual */ false);
+    ctor->set_code(assembler::ircode_from_string("((return-void))"));
+    ctor->get_code()->build_cfg();
+    cc.add_method(ctor);
+    auto* cls = cc.create();
+    m_scope.push_back(cls);
+    return cls;
+  }
+
+  TypeSet non_mergeables(const MergeabilitySummaries* summaries = nullptr) {
+    RefChecker ref_checker(nullptr, 0, nullptr);
+    TypeSet generated;
+    MergeabilityChecker checker(m_scope, m_spec, ref_checker, generated,
+                                summaries);
+    return checker.get_non_mergeables();
+  }
+
+ protected:
+  Scope m_scope;
+  ModelSpec m_spec;
+  DexType* m_a;
+  DexType* m_b;
+  DexType* m_c;
+  DexType* m_safe;
+};
+
+TEST_F(MergeabilityCheckTest, typeTagChecksConstClassUses) {
+  EXPECT_EQ(TypeSet({m_b}), non_mergeables());
+  m_spec.const_class_safe_types.clear();
+  EXPECT_EQ(TypeSet({m_a, m_b}), non_mergeables());
+}
+
+TEST_F(MergeabilityCheckTest, noTypeTagChecksInstanceOf) {
+  m_spec.type_tag_config = TypeTagConfig::NONE;
+  EXPECT_EQ(TypeSet({m_c}), non_mergeables());
+}
+
+TEST_F(MergeabilityCheckTest, sharedSummaries) {
+  MergeabilitySummaries summaries(m_scope, {m_a, m_b, m_c, m_safe});
+  EXPECT_EQ(TypeSet({m_b}), non_mergeables(&summaries));
+
+  // A model of a subset of the candidates gets the same answer.
+  m_spec.merging_targets = {m_a, m_c};
+  EXPECT_EQ(TypeSet(), non_mergeables(&summaries));
+  m_spec.type_tag_config = TypeTagConfig::NONE;
+  EXPECT_EQ(TypeSet({m_c}), non_mergeables(&summaries));
+
+  // Summaries that do not cover the targets are not used.
+  MergeabilitySummaries partial(m_scope, {m_a});
+  EXPECT_EQ(TypeSet({m_c}), non_mergeables(&partial));
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "DexHasher.h"
+#include "IRAssembler.h"
+#include "MethodDedup.h"
+#include "RedexTest.h"
+
+class MethodDedupTest : public RedexTest {
+ public:
+  DexMethod* make_method(const std::string& cls_name, const char* code) {
+    auto* type = DexType::make_type(cls_name);
+    auto* cls = type_class(type);
+    if (cls == nullptr) {
+      ClassCreator cc(type);
+      cc.set_super(type::java_lang_Object());
+      cls = cc.create();
+    }
+    auto* method =
+        DexMethod::make_method(cls_name + ".foo:(I)I")
+            ->make_concrete(ACC_PUBLIC | ACC_STATIC, /* is_virtual */ false);
+    method->set_code(assembler::ircode_from_string(code));
+    method->get_code()->build_cfg();
+    cls->add_method(method);
+    return method;
+  }
+
+  static size_t hash(DexMethod* method) {
+    return hashing::canonical_code_hash(method->get_code()->cfg());
+  }
+};
+
+const char* kAddOne = R"(
+  (
+    (load-param v0)
+    (add-int/lit v0 v0 1)
+    (return v0)
+  )
+)";
+
+TEST_F(MethodDedupTest, groupIdenticalMethods) {
+  auto* a = make_method("LA;", kAddOne);
+  auto* b = make_method("LB;", R"(
+    (
+      (load-param v0)
+      (add-int/lit v0 v0 2)
+      (return v0)
+    )
+  )");
+  auto* c = make_method("LC;", kAddOne);
+  auto* renamed = make_method("LD;", R"(
+    (
+      (load-param v1)
+      (add-int/lit v1 v1 1)
+      (return v1)
+    )
+  )");
+
+  // The hash ignores registers, but the grouping still compares them.
+  EXPECT_EQ(hash(a), hash(renamed));
+  EXPECT_NE(hash(a), hash(b));
+
+  auto groups = method_dedup::group_identical_methods(
+      {b, a, renamed, c}, /* dedup_fill_in_stack_trace */ false);
+  ASSERT_EQ(3, groups.size());
+  EXPECT_EQ(MethodOrderedSet({b}), groups[0]);
+  EXPECT_EQ(MethodOrderedSet({a, c}), groups[1]);
+  EXPECT_EQ(MethodOrderedSet({renamed}), groups[2]);
+
+  auto code_hashes = method_dedup::compute_code_hashes({a, b, c, renamed});
+  EXPECT_EQ(hash(a), code_hashes.at(a));
+  EXPECT_EQ(groups, method_dedup::group_identical_methods(
+                        {b, a, renamed, c},
+                        /* dedup_fill_in_stack_trace */ false, &code_hashes));
+}
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <json/value.h>
+#include <mutex>
+#include <unordered_map>
+
+#include "ConfigFiles.h"
+#include "Creators.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "Pass.h"
+#include "PassManager.h"
+#include "RedexTest.h"
+
+namespace {
+
+using Events = std::vector<std::string>;
+
+// Records when it is started and finished, and appends its name to a
+// per-method log, so that the tests can see how the passes were interleaved.
+class RecordingPass : public MethodLocalPass {
+ public:
+  RecordingPass(const std::string& name,
+                Events* events,
+                std::unordered_map<const DexMethod*, Events>* method_logs,
+                std::mutex* mutex)
+      : MethodLocalPass(name),
+        m_events(events),
+        m_method_logs(method_logs),
+        m_mutex(mutex) {}
+
+  class RecordingRun : public Run {
+   public:
+    explicit RecordingRun(RecordingPass* pass) : m_pass(pass) {}
+
+    void run_on_method(DexMethod* method, IRCode& code) override {
+      EXPECT_TRUE(code.editable_cfg_built());
+      std::lock_guard<std::mutex> lock(*m_pass->m_mutex);
+      (*m_pass->m_method_logs)[method].push_back(m_pass->name());
+      m_methods++;
+    }
+
+    void finish(PassManager& mgr) override {
+      m_pass->m_events->push_back("finish " + m_pass->name());
+      mgr.set_metric("methods", m_methods);
+    }
+
+   private:
+    RecordingPass* m_pass;
+    size_t m_methods{0};
+  };
+
+  std::unique_ptr<Run> start_run(DexStoresVector&,
+                                 ConfigFiles&,
+                                 PassManager&) override {
+    m_events->push_back("start " + name());
+    return std::make_unique<RecordingRun>(this);
+  }
+
+  bool skips_unchanged_methods() const override { return m_skip_unchanged; }
+
+  bool m_skip_unchanged{false};
+
+ private:
+  Events* m_events;
+  std::unordered_map<const DexMethod*, Events>* m_method_logs;
+  std::mutex* m_mutex;
+};
+
+// Adds an instruction to LFoo;.m0.
+class ModifyingPass : public MethodLocalPass {
+ public:
+  ModifyingPass() : MethodLocalPass("ModifyingPass") {}
+
+  class ModifyingRun : public Run {
+   public:
+    void run_on_method(DexMethod* method, IRCode& code) override {
+      if (method->get_name()->str() != "m0") {
+        return;
+      }
+      auto& cfg = code.cfg();
+      auto* insn = new IRInstruction(OPCODE_CONST);
+      insn->set_dest(cfg.allocate_temp())->set_literal(42);
+      cfg.entry_block()->push_front(insn);
+    }
+  };
+
+  std::unique_ptr<Run> start_run(DexStoresVector&,
+                                 ConfigFiles&,
+                                 PassManager&) override {
+    return std::make_unique<ModifyingRun>();
+  }
+};
+
+class OtherPass : public Pass {
+ public:
+  explicit OtherPass(Events* events) : Pass("OtherPass"), m_events(events) {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override {
+    m_events->push_back("run OtherPass");
+  }
+
+ private:
+  Events* m_events;
+};
+
+} // namespace
+
+class MethodLocalPassTest : public RedexTest {
+ public:
+  MethodLocalPassTest()
+      : m_first("FirstPass", &m_events, &m_method_logs, &m_mutex),
+        m_second("SecondPass", &m_events, &m_method_logs, &m_mutex),
+        m_third("ThirdPass", &m_events, &m_method_logs, &m_mutex),
+        m_other(&m_events) {}
+
+  void run_passes(const std::vector<Pass*>& passes,
+                  bool fuse,
+                  bool skip_unchanged = false) {
+    Json::Value config(Json::objectValue);
+    config["redex"]["passes"] = Json::arrayValue;
+    for (auto* pass : passes) {
+      config["redex"]["passes"].append(pass->name());
+    }
+    config["pass_manager"]["fuse_method_local_passes"] = fuse;
+    config["pass_manager"]["skip_unchanged_methods"] = skip_unchanged;
+
+    std::vector<DexMethod*> methods;
+    for (size_t i = 0; i < 3; ++i) {
+      auto* method = assembler::method_from_string(
+          "(method (public static) \"LFoo;.m" + std::to_string(i) +
+          ":()V\" ((return-void)))");
+      methods.push_back(method);
+      m_methods.push_back(method);
+    }
+    DexStore store("classes");
+    store.add_classes({assembler::class_with_methods("LFoo;", methods)});
+    DexStoresVector stores{store};
+
+    ConfigFiles conf(config);
+    conf.parse_global_config();
+    PassManager manager(passes, conf);
+    manager.set_testing_mode();
+    manager.run_passes(stores, conf);
+    for (const auto& info : manager.get_pass_info()) {
+      m_metrics[info.pass->name()] = info.metrics;
+    }
+  }
+
+  Events method_log(const DexMethod* method) { return m_method_logs[method]; }
+
+ protected:
+  Events m_events;
+  std::unordered_map<const DexMethod*, Events> m_method_logs;
+  std::mutex m_mutex;
+  std::vector<DexMethod*> m_methods;
+  std::map<std::string, std::unordered_map<std::string, int64_t>> m_metrics;
+  RecordingPass m_first;
+  RecordingPass m_second;
+  RecordingPass m_third;
+  OtherPass m_other;
+  ModifyingPass m_modifying;
+};
+
+TEST_F(MethodLocalPassTest, unfusedPassesRunOneAfterAnother) {
+  run_passes({&m_first, &m_second}, /* fuse */ false);
+  EXPECT_EQ(Events({"start FirstPass", "finish FirstPass", "start SecondPass",
+                    "finish SecondPass"}),
+            m_events);
+  for (auto* method : m_methods) {
+    EXPECT_EQ(Events({"FirstPass", "SecondPass"}), method_log(method));
+  }
+  EXPECT_EQ(3, m_metrics["FirstPass"]["methods"]);
+  EXPECT_EQ(3, m_metrics["SecondPass"]["methods"]);
+}
+
+TEST_F(MethodLocalPassTest, adjacentPassesAreFused) {
+  run_passes({&m_first, &m_second, &m_other, &m_third}, /* fuse */ true);
+  // The first two passes are started before either visits a method, while
+  // the third one is separated from them by a pass that is not method-local.
+  EXPECT_EQ(Events({"start FirstPass", "start SecondPass", "finish FirstPass",
+                    "finish SecondPass", "run OtherPass", "start ThirdPass",
+                    "finish ThirdPass"}),
+            m_events);
+  for (auto* method : m_methods) {
+    EXPECT_EQ(Events({"FirstPass", "SecondPass", "ThirdPass"}),
+              method_log(method));
+  }
+  // Metrics are still reported per pass.
+  EXPECT_EQ(3, m_metrics["FirstPass"]["methods"]);
+  EXPECT_EQ(3, m_metrics["SecondPass"]["methods"]);
+  EXPECT_EQ(3, m_metrics["ThirdPass"]["methods"]);
+}
+
+TEST_F(MethodLocalPassTest, unchangedMethodsAreSkipped) {
+  m_first.m_skip_unchanged = true;
+  run_passes({&m_first, &m_modifying, &m_first}, /* fuse */ false,
+             /* skip_unchanged */ true);
+  // Only the method that changed since its first run is visited again.
+  EXPECT_EQ(Events({"FirstPass", "FirstPass"}), method_log(m_methods[0]));
+  EXPECT_EQ(Events({"FirstPass"}), method_log(m_methods[1]));
+  EXPECT_EQ(Events({"FirstPass"}), method_log(m_methods[2]));
+  EXPECT_EQ(1, m_metrics["FirstPass"]["methods"]);
+  EXPECT_EQ(2, m_metrics["FirstPass"]["skipped_unchanged_methods"]);
+}
+
+TEST_F(MethodLocalPassTest, unchangedMethodsAreSkippedWhenFused) {
+  m_first.m_skip_unchanged = true;
+  // The changes of the pass fused after FirstPass count as changes since its
+  // first run.
+  run_passes({&m_first, &m_modifying, &m_other, &m_first, &m_second},
+             /* fuse */ true, /* skip_unchanged */ true);
+  EXPECT_EQ(Events({"FirstPass", "FirstPass", "SecondPass"}),
+            method_log(m_methods[0]));
+  EXPECT_EQ(Events({"FirstPass", "SecondPass"}), method_log(m_methods[1]));
+  EXPECT_EQ(2, m_metrics["FirstPass"]["skipped_unchanged_methods"]);
+}
+
+TEST_F(MethodLocalPassTest, allMethodsRunWithoutSkipUnchanged) {
+  m_first.m_skip_unchanged = true;
+  run_passes({&m_first, &m_modifying, &m_first}, /* fuse */ false);
+  for (auto* method : m_methods) {
+    EXPECT_EQ(Events({"FirstPass", "FirstPass"}), method_log(method));
+  }
+}
@@ -87,7 +87,7 @@ class MethodSplitterTest : public RedexTest {
     method_splitting_impl::Stats stats;
     method_splitting_impl::split_methods_in_stores(
         stores, /* min_sdk */ 0, config,
-        /* create_init_class_insns */ false,
+        /* create_init_class_insns */ false, /* reserved_frefs */ 0,
         /* reserved_mrefs */ 0, /* reserved_trefs */ 0, &stats);
     m->get_code()->cfg().simplify();
     for (auto* out : stats.added_methods) {
@@ -546,6 +546,194 @@ TEST_F(MethodSplitterTest, SplitHotColdSwitch) {
   ASSERT_TRUE(res);
 }
 
+TEST_F(MethodSplitterTest, RelocateColdSplitMethods) {
+  auto code = R"(
+    (
+      (load-param v0)
+      (.src_block "LFoo;.bar:()V" 1 (0.5 0.5))
+      (add-int v0 v0 v0)
+      (if-eqz v0 :cold)
+      (.src_block "LFoo;.bar:()V" 2 (0.5 0.5))
+      (return v0)
+    (:cold)
+      (.src_block "LFoo;.bar:()V" 3 (0.0 0.0))
+      (add-int v0 v0 v0)
+      (add-int v0 v0 v0)
+      (add-int v0 v0 v0)
+      (add-int v0 v0 v0)
+      (add-int v0 v0 v0)
+      (return v0)
+    ))";
+  auto [cls, m] = create("(I)I", code);
+  m->get_code()->build_cfg();
+  auto primary_cls = create("()V", "((return-void))").first;
+  auto cold_cls = create("()V", "((return-void))").first;
+  for (auto* c : {primary_cls, cold_cls}) {
+    c->get_dmethods().front()->get_code()->build_cfg();
+  }
+  DexStoresVector stores;
+  stores.emplace_back("test_store");
+  auto& dexen = stores.front().get_dexen();
+  dexen.push_back({primary_cls});
+  dexen.push_back({cls});
+  dexen.push_back({cold_cls});
+  auto config = defaultConfig();
+  config.split_block_size = 100;
+  config.min_hot_cold_split_size = 4;
+  config.min_hot_split_size = 3;
+  config.min_cold_split_size = 1000;
+  config.max_overhead_ratio = 1;
+  config.relocate_cold_split_methods = true;
+  method_splitting_impl::Stats stats;
+  method_splitting_impl::split_methods_in_stores(
+      stores, /* min_sdk */ 0, config,
+      /* create_init_class_insns */ false, /* reserved_frefs */ 0,
+      /* reserved_mrefs */ 0, /* reserved_trefs */ 0, &stats);
+
+  ASSERT_EQ(stats.hot_cold_split_count, 1);
+  EXPECT_EQ(stats.relocated_cold_split_methods, 1);
+  auto* split = *stats.added_methods.begin();
+  ASSERT_EQ(dexen.back().size(), 2);
+  auto* holder_cls = dexen.back().back();
+  EXPECT_EQ(split->get_class(), holder_cls->get_type());
+  EXPECT_EQ(holder_cls->get_dmethods(), std::vector<DexMethod*>{split});
+  EXPECT_TRUE(is_public(split));
+  EXPECT_TRUE(is_public(holder_cls));
+  EXPECT_EQ(dexen[1].size(), 1);
+  EXPECT_TRUE(cls->get_dmethods() == std::vector<DexMethod*>{m});
+  bool invokes_split = false;
+  for (auto& mie : cfg::InstructionIterable(m->get_code()->cfg())) {
+    invokes_split |= mie.insn->has_method() && mie.insn->get_method() == split;
+  }
+  EXPECT_TRUE(invokes_split);
+}
+
+TEST_F(MethodSplitterTest, SplitStartupMethods) {
+  auto code = R"(
+    (
+      (load-param v0)
+      (.src_block "LFoo;.bar:()V" 1 (0.5 0.5))
+      (add-int v0 v0 v0)
+      (if-eqz v0 :cold)
+      (.src_block "LFoo;.bar:()V" 2 (0.5 0.5))
+      (add-int v0 v0 v0)
+      (add-int v0 v0 v0)
+      (add-int v0 v0 v0)
+      (add-int v0 v0 v0)
+      (add-int v0 v0 v0)
+      (return v0)
+    (:cold)
+      (.src_block "LFoo;.bar:()V" 3 (0.0 0.0))
+      (add-int v0 v0 v0)
+      (add-int v0 v0 v0)
+      (add-int v0 v0 v0)
+      (add-int v0 v0 v0)
+      (add-int v0 v0 v0)
+      (return v0)
+    ))";
+  auto [cls, m] = create("(I)I", code);
+  m->get_code()->build_cfg();
+  auto primary_cls = create("()V", "((return-void))").first;
+  auto cold_cls = create("()V", "((return-void))").first;
+  for (auto* c : {primary_cls, cold_cls}) {
+    c->get_dmethods().front()->get_code()->build_cfg();
+  }
+  DexStoresVector stores;
+  stores.emplace_back("test_store");
+  auto& dexen = stores.front().get_dexen();
+  dexen.push_back({primary_cls});
+  dexen.push_back({cls});
+  dexen.push_back({cold_cls});
+  auto config = defaultConfig();
+  config.split_block_size = 100;
+  config.min_original_size = 1000;
+  config.min_hot_cold_split_size = 4;
+  config.min_hot_split_size = 1;
+  config.min_cold_split_size = 1000;
+  config.max_overhead_ratio = 1;
+  config.max_hot_overhead_ratio = 1;
+  config.split_startup_methods = true;
+  config.min_original_size_startup_method = 1;
+  std::unordered_set<const DexMethod*> startup_methods{m};
+  method_splitting_impl::Stats stats;
+  method_splitting_impl::split_methods_in_stores(
+      stores, /* min_sdk */ 0, config,
+      /* create_init_class_insns */ false, /* reserved_frefs */ 0,
+      /* reserved_mrefs */ 0, /* reserved_trefs */ 0, &stats,
+      /* name_infix */ "", /* concurrent_hot_methods */ nullptr,
+      /* concurrent_new_hot_split_methods */ nullptr,
+      /* concurrent_splittable_no_optimizations_methods */ nullptr,
+      &startup_methods, /* num_startup_dexes */ 2);
+
+  // Only the never-executed code is split off, and moved into the last dex.
+  EXPECT_EQ(stats.hot_split_count, 0);
+  ASSERT_EQ(stats.hot_cold_split_count, 1);
+  EXPECT_EQ(stats.startup_split_count, 1);
+  EXPECT_EQ(stats.relocated_cold_split_methods, 1);
+  auto* split = *stats.added_methods.begin();
+  ASSERT_EQ(dexen.back().size(), 2);
+  EXPECT_EQ(split->get_class(), dexen.back().back()->get_type());
+}
+
+TEST_F(MethodSplitterTest, DontRelocateIntoStartupDexes) {
+  auto code = R"(
+    (
+      (load-param v0)
+      (.src_block "LFoo;.bar:()V" 1 (0.5 0.5))
+      (add-int v0 v0 v0)
+      (if-eqz v0 :cold)
+      (.src_block "LFoo;.bar:()V" 2 (0.5 0.5))
+      (return v0)
+    (:cold)
+      (.src_block "LFoo;.bar:()V" 3 (0.0 0.0))
+      (add-int v0 v0 v0)
+      (add-int v0 v0 v0)
+      (add-int v0 v0 v0)
+      (add-int v0 v0 v0)
+      (add-int v0 v0 v0)
+      (return v0)
+    ))";
+  auto [cls, m] = create("(I)I", code);
+  m->get_code()->build_cfg();
+  auto primary_cls = create("()V", "((return-void))").first;
+  auto other_cls = create("()V", "((return-void))").first;
+  for (auto* c : {primary_cls, other_cls}) {
+    c->get_dmethods().front()->get_code()->build_cfg();
+  }
+  DexStoresVector stores;
+  stores.emplace_back("test_store");
+  auto& dexen = stores.front().get_dexen();
+  dexen.push_back({primary_cls});
+  dexen.push_back({cls});
+  dexen.push_back({other_cls});
+  auto config = defaultConfig();
+  config.split_block_size = 100;
+  config.min_original_size = 1000;
+  config.min_hot_cold_split_size = 4;
+  config.min_hot_split_size = 1;
+  config.min_cold_split_size = 1000;
+  config.max_overhead_ratio = 1;
+  config.max_hot_overhead_ratio = 1;
+  config.split_startup_methods = true;
+  config.min_original_size_startup_method = 1;
+  std::unordered_set<const DexMethod*> startup_methods{m};
+  method_splitting_impl::Stats stats;
+  method_splitting_impl::split_methods_in_stores(
+      stores, /* min_sdk */ 0, config,
+      /* create_init_class_insns */ false, /* reserved_frefs */ 0,
+      /* reserved_mrefs */ 0, /* reserved_trefs */ 0, &stats,
+      /* name_infix */ "", /* concurrent_hot_methods */ nullptr,
+      /* concurrent_new_hot_split_methods */ nullptr,
+      /* concurrent_splittable_no_optimizations_methods */ nullptr,
+      &startup_methods, /* num_startup_dexes */ 3);
+
+  // All dexes hold startup classes, so the split method stays put.
+  ASSERT_EQ(stats.hot_cold_split_count, 1);
+  EXPECT_EQ(stats.relocated_cold_split_methods, 0);
+  auto* split = *stats.added_methods.begin();
+  EXPECT_EQ(split->get_class(), cls->get_type());
+}
+
 TEST_F(MethodSplitterTest, SplitSwitchPreferCasesWithSharedCode) {
   auto before = R"(
     (
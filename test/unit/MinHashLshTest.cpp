@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <gtest/gtest.h>
+
+#include "MinHashLsh.h"
+
+namespace {
+
+bool contains(const std::vector<uint32_t>& vec, uint32_t value) {
+  return std::find(vec.begin(), vec.end(), value) != vec.end();
+}
+
+} // namespace
+
+TEST(MinHashLshTest, similarSetsAreCandidates) {
+  std::vector<std::vector<uint32_t>> features;
+  // Items 0 and 1 share 99 of 101 features; item 2 is disjoint from both.
+  std::vector<uint32_t> a, b, c;
+  for (uint32_t f = 0; f < 100; ++f) {
+    a.push_back(f);
+    b.push_back(f + 1);
+    c.push_back(f + 1000);
+  }
+  features = {a, b, c};
+
+  auto neighbors = min_hash::candidate_neighbors(features);
+  ASSERT_EQ(3, neighbors.size());
+  EXPECT_TRUE(contains(neighbors[0], 1));
+  EXPECT_TRUE(contains(neighbors[1], 0));
+  EXPECT_FALSE(contains(neighbors[0], 2));
+  EXPECT_FALSE(contains(neighbors[1], 2));
+  EXPECT_TRUE(neighbors[2].empty());
+}
+
+TEST(MinHashLshTest, largeBucketsAreCapped) {
+  // All items are identical, and thus end up in the same bucket of every band.
+  std::vector<std::vector<uint32_t>> features(200, {1, 2, 3});
+  min_hash::LshConfig config;
+  config.max_bucket_size = 8;
+  config.max_candidates = 100;
+  auto neighbors = min_hash::candidate_neighbors(features, config);
+  ASSERT_EQ(200, neighbors.size());
+  for (uint32_t i = 0; i < neighbors.size(); ++i) {
+    EXPECT_FALSE(neighbors[i].empty());
+    EXPECT_LE(neighbors[i].size(), 8);
+    EXPECT_FALSE(contains(neighbors[i], i));
+    EXPECT_TRUE(std::is_sorted(neighbors[i].begin(), neighbors[i].end()));
+  }
+  // Within a capped bucket, items are linked to their closest neighbors.
+  EXPECT_TRUE(contains(neighbors[100], 99));
+  EXPECT_TRUE(contains(neighbors[100], 101));
+}
+
+TEST(MinHashLshTest, candidatesAreCapped) {
+  std::vector<std::vector<uint32_t>> features(20, {7});
+  min_hash::LshConfig config;
+  config.max_candidates = 5;
+  auto neighbors = min_hash::candidate_neighbors(features, config);
+  for (uint32_t i = 0; i < neighbors.size(); ++i) {
+    EXPECT_EQ(5, neighbors[i].size());
+  }
+  // Ties in the number of shared buckets are broken by index.
+  EXPECT_EQ(std::vector<uint32_t>({1, 2, 3, 4, 5}), neighbors[0]);
+}
@@ -5,8 +5,12 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
 #include <gtest/gtest.h>
 #include <memory>
+#include <random>
+#include <string>
+#include <vector>
 
 #include "DexClass.h"
 #include "RedexTest.h"
@@ -19,3 +23,49 @@ TEST_F(Mutf8CompareTest, empty) {
   EXPECT_TRUE(compare_dexstrings(s1, s2));
   EXPECT_FALSE(compare_dexstrings(s2, s1));
 }
+
+namespace {
+
+// Code-point by code-point reference ordering.
+bool compare_code_points(const DexString* a, const DexString* b) {
+  auto decode = [](const DexString* s) {
+    std::vector<uint32_t> cps;
+    const char* p = s->c_str();
+    const char* end = p + s->size();
+    while (p < end) {
+      cps.push_back(mutf8_next_code_point(p));
+    }
+    return cps;
+  };
+  auto cpa = decode(a);
+  auto cpb = decode(b);
+  return std::lexicographical_compare(cpa.begin(), cpa.end(), cpb.begin(),
+                                      cpb.end());
+}
+
+} // namespace
+
+TEST_F(Mutf8CompareTest, matches_code_point_order) {
+  // ASCII, the encoded zero, and two- and three-byte code points, which
+  // share lead and continuation bytes to exercise the prefix skipping.
+  const std::vector<std::string> pieces = {
+      "a",        "b",        "\x01",     "\x7f",     "\300\200",
+      "\302\200", "\302\277", "\303\200", "\337\277", "\340\240\200",
+      "\340\240\201", "\355\240\200", "\357\277\277", "Lcom/foo/"};
+  std::mt19937 gen(0);
+  std::vector<const DexString*> strings;
+  for (size_t i = 0; i < 400; ++i) {
+    std::string str = "Lcom/some/prefix/";
+    auto n = gen() % 6;
+    for (size_t j = 0; j < n; ++j) {
+      str += pieces[gen() % pieces.size()];
+    }
+    strings.push_back(DexString::make_string(str));
+  }
+  for (const auto* a : strings) {
+    for (const auto* b : strings) {
+      ASSERT_EQ(compare_dexstrings(a, b), compare_code_points(a, b))
+          << "\"" << a->str() << "\" vs \"" << b->str() << "\"";
+    }
+  }
+}
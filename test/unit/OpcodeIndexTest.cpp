@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "OpcodeIndex.h"
+#include "RedexTest.h"
+
+using namespace opcode_index;
+
+class OpcodeIndexTest : public RedexTest {};
+
+TEST_F(OpcodeIndexTest, basic) {
+  auto* caller = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.caller:()V"
+     (
+      (invoke-static () "LFoo;.callee:()V")
+      (return-void)
+     )
+    )
+  )");
+  auto* loader = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.loader:()V"
+     (
+      (const-string "hello")
+      (move-result-pseudo-object v0)
+      (const-class "LBar;")
+      (move-result-pseudo-object v0)
+      (return-void)
+     )
+    )
+  )");
+  auto* cls = assembler::class_with_methods("LFoo;", {caller, loader});
+  Scope scope{cls};
+
+  OpcodeIndex index(scope);
+  EXPECT_EQ(index.size(), 2);
+
+  auto* callee = DexMethod::get_method("LFoo;.callee:()V");
+  ASSERT_NE(callee, nullptr);
+  EXPECT_EQ(index.methods_referencing(callee),
+            std::vector<DexMethod*>{caller});
+  EXPECT_EQ(index.methods_referencing(DexType::make_type("LBar;")),
+            std::vector<DexMethod*>{loader});
+  EXPECT_EQ(index.methods_referencing(DexString::make_string("hello")),
+            std::vector<DexMethod*>{loader});
+  EXPECT_TRUE(index.methods_with(OPCODE_CHECK_CAST).empty());
+  EXPECT_EQ(index.methods_with(OPCODE_RETURN_VOID),
+            (std::vector<DexMethod*>{caller, loader}));
+  EXPECT_EQ(index.methods_with_any({OPCODE_CONST_CLASS, OPCODE_INVOKE_STATIC}),
+            (std::vector<DexMethod*>{caller, loader}));
+
+  EXPECT_TRUE(index.opcodes(caller).contains(OPCODE_INVOKE_STATIC));
+  EXPECT_FALSE(index.opcodes(caller).contains(OPCODE_CONST_CLASS));
+  EXPECT_TRUE(index.opcodes(caller).contains_any(OpcodeSet::of(
+      *loader->get_code())));
+
+  // Edits are only picked up after invalidation.
+  caller->set_code(assembler::ircode_from_string(R"(
+    (
+      (check-cast v0 "LBar;")
+      (move-result-pseudo-object v0)
+      (return-void)
+    )
+  )"));
+  EXPECT_EQ(index.methods_referencing(callee),
+            std::vector<DexMethod*>{caller});
+  index.invalidate(caller);
+  EXPECT_TRUE(index.methods_referencing(callee).empty());
+  EXPECT_EQ(index.methods_with(OPCODE_CHECK_CAST),
+            std::vector<DexMethod*>{caller});
+  EXPECT_EQ(index.methods_referencing(DexType::make_type("LBar;")),
+            (std::vector<DexMethod*>{caller, loader}));
+}
+
+TEST_F(OpcodeIndexTest, remove_method) {
+  auto* first = assembler::method_from_string(R"(
+    (method (public static) "LBaz;.first:()V"
+     (
+      (const-class "LBar;")
+      (move-result-pseudo-object v0)
+      (return-void)
+     )
+    )
+  )");
+  auto* second = assembler::method_from_string(R"(
+    (method (public static) "LBaz;.second:()V"
+     (
+      (const-class "LBar;")
+      (move-result-pseudo-object v0)
+      (return-void)
+     )
+    )
+  )");
+  auto* cls = assembler::class_with_methods("LBaz;", {first, second});
+  Scope scope{cls};
+  auto* bar = DexType::make_type("LBar;");
+
+  OpcodeIndex index(scope);
+  index.remove_method(first);
+  EXPECT_EQ(index.size(), 1);
+  EXPECT_EQ(index.methods_referencing(bar), std::vector<DexMethod*>{second});
+
+  index.invalidate(second);
+  index.remove_method(second);
+  EXPECT_EQ(index.size(), 0);
+  EXPECT_TRUE(index.methods_referencing(bar).empty());
+  EXPECT_TRUE(index.methods_with(OPCODE_CONST_CLASS).empty());
+}
@@ -9,7 +9,10 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "Creators.h"
+#include "DexAccess.h"
 #include "EnumConfig.h"
+#include "EnumGeneratedCallsRewriter.h"
 #include "IRAssembler.h"
 #include "RedexTest.h"
 
@@ -88,3 +91,169 @@ TEST_F(OptimizeEnumsTest, test_param_summary_generating) {
   EXPECT_EQ(summary4.returned_param, boost::none);
   EXPECT_TRUE(summary4.safe_params.empty());
 }
+
+// An enum LFoo; with the constants A and B, as generated by javac.
+DexClass* create_enum() {
+  // The clinit analysis models the name and ordinal set by Enum's constructor.
+  ClassCreator enum_creator(type::java_lang_Enum());
+  enum_creator.set_super(type::java_lang_Object());
+  enum_creator.set_external();
+  enum_creator.add_method(
+      DexMethod::make_method("Ljava/lang/Enum;.<init>:(Ljava/lang/String;I)V")
+          ->make_concrete(ACC_PROTECTED | ACC_CONSTRUCTOR, false));
+  enum_creator.create();
+
+  auto* type = DexType::make_type("LFoo;");
+  ClassCreator creator(type);
+  creator.set_super(type::java_lang_Enum());
+  creator.set_access(ACC_PUBLIC | ACC_FINAL | ACC_ENUM);
+  for (const auto* name : {"LFoo;.A:LFoo;", "LFoo;.B:LFoo;"}) {
+    auto* field = DexField::make_field(name)->make_concrete(
+        ACC_PUBLIC | ACC_STATIC | ACC_FINAL | ACC_ENUM);
+    creator.add_field(field);
+  }
+  creator.add_field(DexField::make_field("LFoo;.$VALUES:[LFoo;")
+                        ->make_concrete(ACC_PRIVATE | ACC_STATIC | ACC_FINAL |
+                                        ACC_SYNTHETIC));
+  for (const auto* method : {
+           R"(
+      (method (private constructor) "LFoo;.<init>:(Ljava/lang/String;I)V"
+        (
+          (load-param-object v0)
+          (load-param-object v1)
+          (load-param v2)
+          (invoke-direct (v0 v1 v2) "Ljava/lang/Enum;.<init>:(Ljava/lang/String;I)V")
+          (return-void)
+        )
+      ))",
+           R"(
+      (method (static constructor) "LFoo;.<clinit>:()V"
+        (
+          (new-instance "LFoo;")
+          (move-result-pseudo-object v0)
+          (const-string "A")
+          (move-result-pseudo-object v1)
+          (const v2 0)
+          (invoke-direct (v0 v1 v2) "LFoo;.<init>:(Ljava/lang/String;I)V")
+          (sput-object v0 "LFoo;.A:LFoo;")
+          (new-instance "LFoo;")
+          (move-result-pseudo-object v0)
+          (const-string "B")
+          (move-result-pseudo-object v1)
+          (const v2 1)
+          (invoke-direct (v0 v1 v2) "LFoo;.<init>:(Ljava/lang/String;I)V")
+          (sput-object v0 "LFoo;.B:LFoo;")
+          (const v2 2)
+          (new-array v2 "[LFoo;")
+          (move-result-pseudo-object v0)
+          (sget-object "LFoo;.A:LFoo;")
+          (move-result-pseudo-object v1)
+          (const v2 0)
+          (aput-object v1 v0 v2)
+          (sget-object "LFoo;.B:LFoo;")
+          (move-result-pseudo-object v1)
+          (const v2 1)
+          (aput-object v1 v0 v2)
+          (sput-object v0 "LFoo;.$VALUES:[LFoo;")
+          (return-void)
+        )
+      ))",
+           R"(
+      (method (public static) "LFoo;.values:()[LFoo;"
+        (
+          (sget-object "LFoo;.$VALUES:[LFoo;")
+          (move-result-pseudo-object v0)
+          (invoke-virtual (v0) "[LFoo;.clone:()Ljava/lang/Object;")
+          (move-result-object v0)
+          (check-cast v0 "[LFoo;")
+          (move-result-pseudo-object v0)
+          (return-object v0)
+        )
+      ))",
+           R"(
+      (method (public static) "LFoo;.valueOf:(Ljava/lang/String;)LFoo;"
+        (
+          (load-param-object v0)
+          (const-class "LFoo;")
+          (move-result-pseudo-object v1)
+          (invoke-static (v1 v0) "Ljava/lang/Enum;.valueOf:(Ljava/lang/Class;Ljava/lang/String;)Ljava/lang/Enum;")
+          (move-result-object v0)
+          (check-cast v0 "LFoo;")
+          (move-result-pseudo-object v0)
+          (return-object v0)
+        )
+      ))"}) {
+    auto* m = assembler::method_from_string(method);
+    m->get_code()->build_cfg();
+    creator.add_method(m);
+  }
+  return creator.create();
+}
+
+TEST_F(OptimizeEnumsTest, test_rewrite_generated_method_calls) {
+  auto* cls = create_enum();
+  optimize_enums::EnumGeneratedCallsRewriter rewriter;
+  EXPECT_TRUE(rewriter.consider_enum(cls,
+                                     /* support_kt_19_enum_entries */ false));
+
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (invoke-static () "LFoo;.values:()[LFoo;")
+      (move-result-object v0)
+      (move-object v1 v0)
+      (array-length v1)
+      (move-result-pseudo v2)
+      (const v3 0)
+      (aget-object v0 v3)
+      (move-result-pseudo-object v4)
+      (invoke-static () "LFoo;.values:()[LFoo;")
+      (move-result-object v5)
+      (const-string "B")
+      (move-result-pseudo-object v6)
+      (invoke-static (v6) "LFoo;.valueOf:(Ljava/lang/String;)LFoo;")
+      (move-result-object v7)
+      (const-string "C")
+      (move-result-pseudo-object v6)
+      (invoke-static (v6) "LFoo;.valueOf:(Ljava/lang/String;)LFoo;")
+      (move-result-object v8)
+      (return-object v5)
+    )
+  )");
+  code->build_cfg();
+  std::unordered_set<DexField*> fields_to_publicize;
+  auto stats = rewriter.rewrite(DexType::make_type("LBar;"), code->cfg(),
+                                &fields_to_publicize);
+  code->clear_cfg();
+  EXPECT_EQ(1, stats.values_calls);
+  EXPECT_EQ(1, stats.valueof_calls);
+  auto* values_field =
+      DexField::get_field("LFoo;.$VALUES:[LFoo;")->as_def();
+  EXPECT_THAT(fields_to_publicize, UnorderedElementsAre(values_field));
+
+  // The escaping values() result still needs its own copy, and "C" does not
+  // name a constant.
+  auto expected = assembler::ircode_from_string(R"(
+    (
+      (sget-object "LFoo;.$VALUES:[LFoo;")
+      (move-result-pseudo-object v0)
+      (move-object v1 v0)
+      (array-length v1)
+      (move-result-pseudo v2)
+      (const v3 0)
+      (aget-object v0 v3)
+      (move-result-pseudo-object v4)
+      (invoke-static () "LFoo;.values:()[LFoo;")
+      (move-result-object v5)
+      (const-string "B")
+      (move-result-pseudo-object v6)
+      (sget-object "LFoo;.B:LFoo;")
+      (move-result-pseudo-object v7)
+      (const-string "C")
+      (move-result-pseudo-object v6)
+      (invoke-static (v6) "LFoo;.valueOf:(Ljava/lang/String;)LFoo;")
+      (move-result-object v8)
+      (return-object v5)
+    )
+  )");
+  EXPECT_CODE_EQ(expected.get(), code.get());
+}
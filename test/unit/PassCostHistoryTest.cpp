@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <json/value.h>
+
+#include "ConfigFiles.h"
+#include "IRAssembler.h"
+#include "Pass.h"
+#include "PassCostHistory.h"
+#include "PassManager.h"
+#include "RedexTest.h"
+#include "RedexTestUtils.h"
+
+namespace {
+
+class CountingPass : public Pass {
+ public:
+  explicit CountingPass(const std::string& name) : Pass(name) {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override {
+    runs++;
+  }
+
+  size_t runs{0};
+};
+
+PassCostHistory::ScopeStats scope_stats(size_t instructions) {
+  PassCostHistory::ScopeStats stats;
+  stats.classes = 1;
+  stats.methods = 1;
+  stats.instructions = instructions;
+  return stats;
+}
+
+PassCostHistory::PassRecord pass_record(const std::string& name,
+                                        double wall_time,
+                                        int64_t removed_instructions) {
+  PassCostHistory::PassRecord record;
+  record.name = name;
+  record.wall_time = wall_time;
+  record.removed_instructions = removed_instructions;
+  return record;
+}
+
+} // namespace
+
+class PassCostHistoryTest : public RedexTest {
+ public:
+  PassCostHistoryTest()
+      : m_tmp_dir(redex::make_tmp_dir("PassCostHistoryTest%%%%%%%%")),
+        m_path(m_tmp_dir.path + "/history.json"),
+        m_slow("SlowPass"),
+        m_useful("UsefulPass") {}
+
+  void run_passes(float fast_config_min_benefit) {
+    Json::Value config(Json::objectValue);
+    config["redex"]["passes"] = Json::arrayValue;
+    for (auto* pass : {&m_slow, &m_useful}) {
+      config["redex"]["passes"].append(pass->name());
+    }
+    config["pass_manager"]["cost_history"] = m_path;
+    config["pass_manager"]["fast_config_min_benefit"] =
+        fast_config_min_benefit;
+
+    auto* method = assembler::method_from_string(R"(
+      (method (public static) "LFoo;.bar:()V"
+        (
+          (const v0 0)
+          (return-void)
+        )
+      )
+    )");
+    DexStore store("classes");
+    store.add_classes({assembler::class_with_methods("LFoo;", {method})});
+    DexStoresVector stores{store};
+
+    ConfigFiles conf(config);
+    conf.parse_global_config();
+    PassManager manager({&m_slow, &m_useful}, conf);
+    manager.set_testing_mode();
+    manager.run_passes(stores, conf);
+  }
+
+ protected:
+  redex::TempDir m_tmp_dir;
+  std::string m_path;
+  CountingPass m_slow;
+  CountingPass m_useful;
+};
+
+TEST_F(PassCostHistoryTest, predictsFromPastRuns) {
+  {
+    PassCostHistory history(m_path);
+    EXPECT_EQ(0, history.num_runs());
+    EXPECT_FALSE(history.predict("SlowPass#1", scope_stats(100)));
+    history.record(scope_stats(100), {pass_record("SlowPass#1", 2, 10)});
+    history.record(scope_stats(200), {pass_record("SlowPass#1", 4, 20)});
+  }
+
+  // The history is read back from its file.
+  PassCostHistory history(m_path);
+  EXPECT_EQ(2, history.num_runs());
+  auto prediction = history.predict("SlowPass#1", scope_stats(300));
+  ASSERT_TRUE(prediction);
+  EXPECT_DOUBLE_EQ(6, prediction->wall_time);
+  EXPECT_DOUBLE_EQ(30, prediction->removed_instructions);
+  EXPECT_FALSE(prediction->vm_hwm_delta);
+  EXPECT_EQ(2, prediction->samples);
+  EXPECT_FALSE(history.predict("SlowPass#2", scope_stats(300)));
+}
+
+TEST_F(PassCostHistoryTest, fastConfigSkipsPassesWithLowBenefit) {
+  {
+    PassCostHistory history(m_path);
+    history.record(scope_stats(2), {pass_record("SlowPass#1", 10, 0),
+                                    pass_record("UsefulPass#1", 10, 1000)});
+  }
+
+  run_passes(/* fast_config_min_benefit */ 1);
+  EXPECT_EQ(0, m_slow.runs);
+  EXPECT_EQ(1, m_useful.runs);
+
+  // Only the passes that ran are recorded.
+  PassCostHistory history(m_path);
+  EXPECT_EQ(2, history.num_runs());
+  EXPECT_EQ(1, history.predict("SlowPass#1", scope_stats(2))->samples);
+  EXPECT_EQ(2, history.predict("UsefulPass#1", scope_stats(2))->samples);
+}
+
+TEST_F(PassCostHistoryTest, allPassesRunWithoutFastConfig) {
+  {
+    PassCostHistory history(m_path);
+    history.record(scope_stats(2), {pass_record("SlowPass#1", 10, 0)});
+  }
+
+  run_passes(/* fast_config_min_benefit */ 0);
+  EXPECT_EQ(1, m_slow.runs);
+  EXPECT_EQ(1, m_useful.runs);
+}
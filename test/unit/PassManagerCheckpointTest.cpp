@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <json/value.h>
+
+#include "ConfigFiles.h"
+#include "Creators.h"
+#include "Pass.h"
+#include "PassManager.h"
+#include "RedexTest.h"
+
+namespace {
+
+class CountingPass : public Pass {
+ public:
+  explicit CountingPass(const std::string& name) : Pass(name) {}
+
+  void eval_pass(DexStoresVector&, ConfigFiles&, PassManager&) override {
+    evals++;
+  }
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override {
+    runs++;
+  }
+
+  size_t evals{0};
+  size_t runs{0};
+};
+
+} // namespace
+
+class PassManagerCheckpointTest : public RedexTest {
+ public:
+  PassManagerCheckpointTest()
+      : m_first("FirstCountingPass"),
+        m_second("SecondCountingPass"),
+        m_third("ThirdCountingPass") {}
+
+  std::vector<size_t> run_passes(size_t resume_pass_idx) {
+    Json::Value config(Json::objectValue);
+    config["redex"]["passes"] = Json::arrayValue;
+    for (auto* pass : {&m_first, &m_second, &m_third}) {
+      config["redex"]["passes"].append(pass->name());
+    }
+    config["pass_manager"]["checkpoint_passes"] = Json::arrayValue;
+    config["pass_manager"]["checkpoint_passes"].append(1);
+    config["pass_manager"]["checkpoint_passes"].append(2);
+
+    ClassCreator cc(DexType::make_type("LFoo;"));
+    cc.set_super(type::java_lang_Object());
+    DexStore store("classes");
+    store.add_classes({cc.create()});
+    DexStoresVector stores{store};
+
+    ConfigFiles conf(config);
+    conf.parse_global_config();
+    PassManager manager({&m_first, &m_second, &m_third}, conf);
+    manager.set_testing_mode();
+    std::vector<size_t> checkpoints;
+    manager.set_checkpoint_writer(
+        [&](DexStoresVector&, ConfigFiles&, const PassManager& mgr,
+            size_t pass_idx) {
+          EXPECT_EQ(&manager, &mgr);
+          checkpoints.push_back(pass_idx);
+        });
+    manager.set_resume_pass_index(resume_pass_idx);
+    manager.run_passes(stores, conf);
+    return checkpoints;
+  }
+
+ protected:
+  CountingPass m_first;
+  CountingPass m_second;
+  CountingPass m_third;
+};
+
+TEST_F(PassManagerCheckpointTest, writesCheckpointsBeforeConfiguredPasses) {
+  EXPECT_EQ(std::vector<size_t>({1, 2}), run_passes(0));
+  for (auto* pass : {&m_first, &m_second, &m_third}) {
+    EXPECT_EQ(1, pass->evals) << pass->name();
+    EXPECT_EQ(1, pass->runs) << pass->name();
+  }
+}
+
+TEST_F(PassManagerCheckpointTest, resumesFromCheckpoint) {
+  // The checkpoint resumed from is not written again.
+  EXPECT_TRUE(run_passes(2).empty());
+  EXPECT_EQ(0, m_first.evals);
+  EXPECT_EQ(0, m_first.runs);
+  EXPECT_EQ(0, m_second.evals);
+  EXPECT_EQ(0, m_second.runs);
+  EXPECT_EQ(1, m_third.evals);
+  EXPECT_EQ(1, m_third.runs);
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <json/value.h>
+
+#include "ConfigFiles.h"
+#include "Creators.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "Pass.h"
+#include "PassManager.h"
+#include "RedexException.h"
+#include "RedexTest.h"
+#include "Show.h"
+
+namespace {
+
+class NopPass : public Pass {
+ public:
+  explicit NopPass(const std::string& name) : Pass(name) {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override {
+    runs++;
+  }
+
+  size_t runs{0};
+};
+
+// Makes LFoo;.bar return an integer as an object.
+class BreakingPass : public Pass {
+ public:
+  BreakingPass() : Pass("BreakingPass") {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override {
+    auto* method = DexMethod::get_method("LFoo;.bar:()Ljava/lang/Object;")
+                       ->as_def();
+    method->set_code(assembler::ircode_from_string(R"(
+      (
+        (const v0 1)
+        (return-object v0)
+      )
+    )"));
+    method->get_code()->build_cfg();
+  }
+};
+
+} // namespace
+
+class PassManagerPostPassChecksTest : public RedexTest {
+ public:
+  PassManagerPostPassChecksTest() : m_first("FirstPass"), m_last("LastPass") {}
+
+  void run_passes(const std::vector<Pass*>& passes, Json::Value config) {
+    config["redex"]["passes"] = Json::arrayValue;
+    for (auto* pass : passes) {
+      config["redex"]["passes"].append(pass->name());
+    }
+
+    std::vector<DexMethod*> methods;
+    for (const auto* name : {"bar", "baz"}) {
+      auto* method = assembler::method_from_string(
+          std::string("(method (public static) \"LFoo;.") + name +
+          ":()Ljava/lang/Object;\" ((const v0 0) (return-object v0)))");
+      method->set_deobfuscated_name(show(method));
+      methods.push_back(method);
+    }
+    DexStore store("classes");
+    store.add_classes({assembler::class_with_methods("LFoo;", methods)});
+    DexStoresVector stores{store};
+
+    ConfigFiles conf(config);
+    conf.parse_global_config();
+    PassManager manager(passes, conf);
+    manager.set_testing_mode();
+    manager.run_passes(stores, conf);
+  }
+
+  // Runs the passes, expecting the type checker to fail, and returns what
+  // its error message is prefixed with.
+  std::string type_check_failure_origin(const std::vector<Pass*>& passes,
+                                        size_t batch_passes) {
+    Json::Value config(Json::objectValue);
+    config["ir_type_checker"]["run_after_each_pass"] = true;
+    config["ir_type_checker"]["batch_passes"] = Json::UInt(batch_passes);
+    try {
+      run_passes(passes, config);
+    } catch (const RedexException& e) {
+      std::string what = e.what();
+      auto begin = what.find('[');
+      auto end = what.find("] Inconsistency found");
+      if (begin != std::string::npos && end != std::string::npos) {
+        return what.substr(begin + 1, end - begin - 1);
+      }
+      return what;
+    }
+    ADD_FAILURE() << "The type checker did not fail";
+    return "";
+  }
+
+ protected:
+  NopPass m_first;
+  NopPass m_last;
+  BreakingPass m_breaking;
+};
+
+TEST_F(PassManagerPostPassChecksTest, typeCheckFailureNamesPass) {
+  EXPECT_EQ("after BreakingPass",
+            type_check_failure_origin({&m_first, &m_breaking, &m_last},
+                                      /* batch_passes */ 1));
+  EXPECT_EQ(0, m_last.runs);
+}
+
+TEST_F(PassManagerPostPassChecksTest, batchedTypeCheckNamesUncheckedPasses) {
+  EXPECT_EQ("after one of the 2 passes from FirstPass to BreakingPass",
+            type_check_failure_origin({&m_first, &m_breaking, &m_last},
+                                      /* batch_passes */ 2));
+  EXPECT_EQ(0, m_last.runs);
+}
+
+TEST_F(PassManagerPostPassChecksTest, finalTypeCheckCoversLastBatch) {
+  EXPECT_EQ("final, after one of the 3 passes from FirstPass to LastPass",
+            type_check_failure_origin({&m_first, &m_breaking, &m_last},
+                                      /* batch_passes */ 4));
+  EXPECT_EQ(1, m_last.runs);
+}
+
+TEST_F(PassManagerPostPassChecksTest, uniqueNamesCheckedInBackground) {
+  Json::Value config(Json::objectValue);
+  config["check_unique_deobfuscated_names"]["run_after_each_pass"] = true;
+  config["check_unique_deobfuscated_names"]["run_in_background"] = true;
+  config["check_unique_deobfuscated_names"]["run_finally"] = true;
+  run_passes({&m_first, &m_last}, config);
+  EXPECT_EQ(1, m_first.runs);
+  EXPECT_EQ(1, m_last.runs);
+}
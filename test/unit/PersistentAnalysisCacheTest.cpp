@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include "DexHasher.h"
+#include "IRAssembler.h"
+#include "PersistentAnalysisCache.h"
+#include "RedexTest.h"
+
+using namespace analysis_cache;
+
+class PersistentAnalysisCacheTest : public RedexTest {};
+
+TEST_F(PersistentAnalysisCacheTest, RoundTrip) {
+  auto tmp_dir = redex::make_tmp_dir("PersistentAnalysisCacheTest%%%%%%%%");
+  {
+    PersistentAnalysisCache cache(tmp_dir.path);
+    auto& table = cache.get_table("test", 1);
+    EXPECT_FALSE(table.get(42));
+    table.put(42, "forty-two");
+    table.put(7, std::string("\0seven", 6));
+    EXPECT_EQ(*table.get(42), "forty-two");
+    EXPECT_EQ(table.hits(), 1);
+    EXPECT_EQ(table.misses(), 1);
+    cache.save();
+  }
+  {
+    PersistentAnalysisCache cache(tmp_dir.path);
+    auto& table = cache.get_table("test", 1);
+    EXPECT_EQ(table.size(), 2);
+    EXPECT_EQ(*table.get(42), "forty-two");
+    EXPECT_EQ(*table.get(7), std::string("\0seven", 6));
+    EXPECT_FALSE(table.get(8));
+    cache.save();
+  }
+  {
+    // A different version invalidates all entries.
+    PersistentAnalysisCache cache(tmp_dir.path);
+    auto& table = cache.get_table("test", 2);
+    EXPECT_EQ(table.size(), 0);
+  }
+}
+
+TEST_F(PersistentAnalysisCacheTest, UnusedEntriesAreDropped) {
+  auto tmp_dir = redex::make_tmp_dir("PersistentAnalysisCacheTest%%%%%%%%");
+  {
+    PersistentAnalysisCache cache(tmp_dir.path);
+    auto& table = cache.get_table("test", 1);
+    table.put(1, "one");
+    table.put(2, "two");
+    cache.save();
+  }
+  {
+    PersistentAnalysisCache cache(tmp_dir.path);
+    auto& table = cache.get_table("test", 1);
+    EXPECT_EQ(*table.get(1), "one");
+    cache.save();
+  }
+  {
+    PersistentAnalysisCache cache(tmp_dir.path);
+    auto& table = cache.get_table("test", 1);
+    EXPECT_EQ(table.size(), 1);
+    EXPECT_FALSE(table.get(2));
+  }
+}
+
+TEST_F(PersistentAnalysisCacheTest, MethodKeyIsContentBased) {
+  auto make_method = [](const std::string& name, const std::string& literal) {
+    return assembler::method_from_string(R"(
+      (method (public static) "LFoo;.)" + name + R"(:()I"
+        (
+          (const v0 )" + literal + R"()
+          (return v0)
+        )
+      )
+    )");
+  };
+  auto* a = make_method("a", "1");
+  auto* b = make_method("b", "1");
+  auto* c = make_method("c", "2");
+  auto key_a = get_method_key(a, 0);
+
+  // Same method, different salt.
+  EXPECT_NE(key_a, get_method_key(a, 1));
+  // Same code, different name.
+  EXPECT_NE(key_a, get_method_key(b, 0));
+
+  auto hash_b = hashing::DexMethodHasher(b).run();
+  auto hash_c = hashing::DexMethodHasher(c).run();
+  EXPECT_NE(hash_b.code_hash, hash_c.code_hash);
+
+  // Rehashing after a round-trip through the CFG is stable.
+  a->get_code()->build_cfg();
+  a->get_code()->clear_cfg();
+  EXPECT_EQ(key_a, get_method_key(a, 0));
+}
+
+TEST_F(PersistentAnalysisCacheTest, InMemory) {
+  PersistentAnalysisCache cache("");
+  EXPECT_TRUE(cache.is_in_memory());
+  auto& table = cache.get_table("test", 1);
+  table.put(1, "one");
+  EXPECT_EQ(*cache.get_table("test", 1).get(1), "one");
+  // Saving an in-memory cache doesn't write anything.
+  cache.save();
+  EXPECT_FALSE(boost::filesystem::exists("test.bin"));
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "DexClass.h"
+#include "DexPosition.h"
+#include "RedexTest.h"
+
+class PositionMapperTest : public RedexTest {};
+
+TEST_F(PositionMapperTest, equalChainsShareLines) {
+  auto* file = DexString::make_string("Foo.java");
+  auto* caller = DexString::make_string("LFoo;.caller:()V");
+  auto* callee = DexString::make_string("LFoo;.callee:()V");
+
+  // The same callee inlined twice at the same callsite, and once more at
+  // another callsite.
+  DexPosition callsite1(caller, file, 10);
+  DexPosition callsite2(caller, file, 10);
+  DexPosition callsite3(caller, file, 11);
+  DexPosition inlined1(callee, file, 5);
+  inlined1.parent = &callsite1;
+  DexPosition inlined2(callee, file, 5);
+  inlined2.parent = &callsite2;
+  DexPosition inlined3(callee, file, 5);
+  inlined3.parent = &callsite3;
+
+  RealPositionMapper pos_mapper("unused");
+  auto line1 = pos_mapper.position_to_line(&inlined1);
+  auto line2 = pos_mapper.position_to_line(&inlined2);
+  auto line3 = pos_mapper.position_to_line(&inlined3);
+  EXPECT_EQ(line1, line2);
+  EXPECT_NE(line1, line3);
+  EXPECT_EQ(pos_mapper.size(), 2);
+
+  EXPECT_EQ(pos_mapper.position_to_line(&callsite2),
+            pos_mapper.position_to_line(&callsite1));
+  EXPECT_EQ(pos_mapper.size(), 3);
+}
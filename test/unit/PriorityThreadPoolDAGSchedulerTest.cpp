@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <mutex>
+#include <vector>
+
+#include "PriorityThreadPoolDAGScheduler.h"
+
+namespace {
+
+// Runs a chain 10 -> 11 -> 12 (12 waits for 11, which waits for 10) and a
+// standalone task 20 on a single thread, and returns the execution order.
+// Ready tasks are posted in priority order, so the first task to run is the
+// one with the highest priority.
+std::vector<int> run(bool weighted) {
+  std::mutex mutex;
+  std::vector<int> order;
+  PriorityThreadPoolDAGScheduler<int> scheduler(
+      [&](int task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(task);
+      },
+      /* num_threads */ 1);
+  scheduler.add_dependency(11, 10);
+  scheduler.add_dependency(12, 11);
+  if (weighted) {
+    scheduler.set_weight_fn([](int task) { return task == 20 ? 100 : 1; });
+  }
+  std::vector<int> tasks{20, 12, 11, 10};
+  auto critical_path_length = scheduler.run(tasks.begin(), tasks.end());
+  EXPECT_EQ(critical_path_length, weighted ? 99 : 2);
+  return order;
+}
+
+} // namespace
+
+TEST(PriorityThreadPoolDAGSchedulerTest, chain_length) {
+  auto order = run(/* weighted */ false);
+  ASSERT_EQ(order.size(), 4);
+  EXPECT_EQ(order.front(), 10);
+}
+
+TEST(PriorityThreadPoolDAGSchedulerTest, weights) {
+  auto order = run(/* weighted */ true);
+  ASSERT_EQ(order.size(), 4);
+  EXPECT_EQ(order.front(), 20);
+}
@@ -8,11 +8,14 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <fstream>
 #include <istream>
 #include <vector>
 
 #include "ProguardConfiguration.h"
 #include "ProguardParser.h"
+#include "ProguardPrintConfiguration.h"
+#include "RedexTestUtils.h"
 
 using namespace keep_rules;
 
@@ -1100,3 +1103,51 @@ TEST(ProguardParserTest, assumevalues_fields) {
               keep_rules::AssumeReturnValue::ValueNone);
   }
 }
+
+// Parsing files in parallel gives the same configuration as parsing them one
+// after the other.
+TEST(ProguardParserTest, parse_files) {
+  auto tmp_dir = redex::make_tmp_dir("proguard_parser_test_%%%%%%%%");
+  auto write = [&](const std::string& name, const std::string& contents) {
+    auto path = tmp_dir.path + "/" + name;
+    std::ofstream(path) << contents;
+    return path;
+  };
+  write("c.pro", "-keep class C\n");
+  std::vector<std::string> files{
+      write("a.pro",
+            "-include " + tmp_dir.path +
+                "/c.pro\n-keep class A\n-dontwarn foo.**\n"),
+      write("b.pro",
+            "-dontshrink\n-keep class A\n-keep class B\n-basedirectory " +
+                tmp_dir.path + "\n"),
+      write("d.pro", "-injars in.jar\n-keep class D\n-keep class C\n"),
+  };
+
+  ProguardConfiguration serial;
+  proguard_parser::Stats serial_stats;
+  for (const auto& file : files) {
+    serial_stats += proguard_parser::parse_file(file, &serial);
+  }
+  ProguardConfiguration parallel;
+  auto parallel_stats = proguard_parser::parse_files(files, &parallel);
+
+  auto show_rules = [](const ProguardConfiguration& config) {
+    std::vector<std::string> rules;
+    for (const auto* rule : config.keep_rules) {
+      rules.push_back(show_keep(*rule));
+    }
+    return rules;
+  };
+  ASSERT_TRUE(parallel.ok);
+  EXPECT_EQ(parallel_stats.parse_errors, serial_stats.parse_errors);
+  EXPECT_EQ(show_rules(parallel), show_rules(serial));
+  EXPECT_EQ(parallel.includes, serial.includes);
+  EXPECT_EQ(parallel.already_included, serial.already_included);
+  EXPECT_EQ(parallel.basedirectory, serial.basedirectory);
+  EXPECT_THAT(parallel.injars, ::testing::ElementsAre("in.jar"));
+  EXPECT_EQ(parallel.injars, serial.injars);
+  EXPECT_EQ(parallel.dontwarn, serial.dontwarn);
+  EXPECT_FALSE(parallel.shrink);
+  EXPECT_TRUE(parallel.optimize);
+}
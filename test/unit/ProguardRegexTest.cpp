@@ -271,3 +271,23 @@ TEST(ProguardRegexTest, types) {
     EXPECT_EQ("Lalpha/**/beta;", descriptor);
   }
 }
+
+TEST(ProguardRegexTest, literal_prefix) {
+  auto prefix = [](std::string_view proguard_regex) {
+    return proguard_parser::type_regex_literal_prefix(
+        proguard_parser::convert_wildcard_type(proguard_regex));
+  };
+  EXPECT_EQ("Lalpha/beta;", prefix("alpha.beta"));
+  EXPECT_EQ("Lalpha/", prefix("alpha.*.beta"));
+  EXPECT_EQ("Lalpha/", prefix("alpha.**"));
+  EXPECT_EQ("Lalpha/Beta$", prefix("alpha.Beta$?"));
+  EXPECT_EQ("L", prefix("**"));
+  EXPECT_EQ("", prefix("%"));
+  EXPECT_EQ("", proguard_parser::type_regex_literal_prefix("Lalpha;|Lbeta;"));
+
+  // Every type matched by the regex starts with the prefix.
+  std::string_view proguard_regex = "alpha.*.beta";
+  boost::regex matcher(proguard_parser::form_type_regex(
+      proguard_parser::convert_wildcard_type(proguard_regex)));
+  EXPECT_TRUE(boost::regex_match("Lalpha/gamma/beta;", matcher));
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "DexClass.h"
+#include "Purity.h"
+#include "RedexTest.h"
+
+class PurityTest : public RedexTest {};
+
+TEST_F(PurityTest, locationsClosureOverCycles) {
+  ClassCreator creator(DexType::make_type("LFoo;"));
+  creator.set_super(type::java_lang_Object());
+  auto make_method = [&](const char* name) {
+    auto* method = DexMethod::make_method(std::string("LFoo;.") + name + ":()V")
+                       ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+    creator.add_method(method);
+    return method;
+  };
+  auto* a = make_method("a");
+  auto* b = make_method("b");
+  auto* c = make_method("c");
+  auto* d = make_method("d");
+  auto* e = make_method("e");
+  auto* f = make_method("f");
+  auto* g = make_method("g");
+  auto* cls = creator.create();
+
+  auto make_field = [](const char* name) {
+    return static_cast<DexField*>(DexField::make_field(name))
+        ->make_concrete(ACC_PUBLIC | ACC_STATIC);
+  };
+  CseLocation la(make_field("LFoo;.la:I"));
+  CseLocation lb(make_field("LFoo;.lb:I"));
+  CseLocation lc(make_field("LFoo;.lc:I"));
+  CseLocation lg(make_field("LFoo;.lg:I"));
+
+  // a and b depend on each other, and on c. d depends on e, which has no
+  // known locations, and f depends on d. g only depends on itself.
+  std::unordered_map<const DexMethod*, LocationsAndDependencies> lads;
+  lads[a] = {{la}, {b, c}};
+  lads[b] = {{lb}, {a}};
+  lads[c] = {{lc}, {}};
+  lads[d] = {{}, {e}};
+  lads[f] = {{}, {d}};
+  lads[g] = {{lg}, {g}};
+
+  std::unordered_map<const DexMethod*, CseUnorderedLocationSet> result;
+  auto levels = compute_locations_closure(
+      {cls}, /* method_override_graph */ nullptr,
+      [&](DexMethod* method) -> boost::optional<LocationsAndDependencies> {
+        auto it = lads.find(method);
+        if (it == lads.end()) {
+          return boost::none;
+        }
+        return it->second;
+      },
+      &result);
+
+  EXPECT_EQ(levels, 2);
+  EXPECT_EQ(result.size(), 4);
+  EXPECT_EQ(result.at(a), (CseUnorderedLocationSet{la, lb, lc}));
+  EXPECT_EQ(result.at(b), (CseUnorderedLocationSet{la, lb, lc}));
+  EXPECT_EQ(result.at(c), (CseUnorderedLocationSet{lc}));
+  EXPECT_EQ(result.at(g), (CseUnorderedLocationSet{lg}));
+  EXPECT_EQ(result.count(d), 0);
+  EXPECT_EQ(result.count(e), 0);
+  EXPECT_EQ(result.count(f), 0);
+}
@@ -132,4 +132,37 @@ TEST_F(RandomForestTest, accept_feat_caller) {
   }
 }
 
+TEST_F(RandomForestTest, evaluate_flat) {
+  RandomForestTestHelper mfth{};
+  [[maybe_unused]] auto& context = mfth.context;
+  auto& caller = mfth.caller;
+  auto& callee = mfth.callee;
+  caller.m_insns = 7;
+  callee.m_insns = 5;
+  callee.m_regs = 3;
+  caller.m_regs = 4;
+
+  auto forest = deserialize(
+      "(forest "
+      "(feat \"caller_insns\" 6 (accf 0.25) "
+      "(feat \"callee_regs\" 3 (accf 0.5) (accf 0.75))) "
+      "(accf 1) "
+      "(feat \"callee_insns\" 5 (accf 0.125) (accf 0)))");
+  PGIForest::Flat flat(forest);
+  EXPECT_EQ(flat.num_features(), 3);
+
+  // Each input walks the trees to different leaves.
+  std::vector<std::tuple<const MethodContext&, const MethodContext&>> inputs{
+      {caller, callee}, {callee, caller}, {callee, callee}, {caller, caller}};
+  auto sums = flat.evaluate(inputs);
+  ASSERT_EQ(sums.size(), inputs.size());
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    float expected;
+    forest.accept(std::get<0>(inputs[i]), std::get<1>(inputs[i]), &expected);
+    EXPECT_EQ(sums[i], expected) << i;
+  }
+  EXPECT_EQ(sums[0], 0.5 + 1 + 0.125);
+  EXPECT_EQ(sums[3], 0.75 + 1 + 0);
+}
+
 } // namespace random_forest
@@ -69,4 +69,50 @@ TEST_F(ReachingDefinitionsTest, ResetMoveResult) {
   code->clear_cfg();
 }
 
+TEST_F(ReachingDefinitionsTest, DenseMatchesSparse) {
+  auto code = assembler::ircode_from_string(R"((
+    (load-param v0)
+    (if-eqz v0 :else)
+    (const v1 1)
+    (const v2 2)
+    (goto :end)
+    (:else)
+    (const v1 3)
+    (:end)
+    (add-int v1 v1 v0)
+    (return v2)
+  ))");
+
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+  EXPECT_TRUE(reaching_defs::use_dense_reaching_defs(cfg));
+
+  reaching_defs::FixpointIterator fp_iter(cfg);
+  fp_iter.run({});
+  reaching_defs::DenseFixpointIterator dense_fp_iter(cfg);
+  dense_fp_iter.run();
+
+  for (auto* block : cfg.blocks()) {
+    auto env = fp_iter.get_entry_state_at(block);
+    auto dense_env = dense_fp_iter.get_entry_state_at(block);
+    for (auto& mie : InstructionIterable(block)) {
+      for (reg_t reg = 0; reg < cfg.get_registers_size(); ++reg) {
+        EXPECT_TRUE(env.get(reg).equals(dense_fp_iter.get(dense_env, reg)));
+      }
+      fp_iter.analyze_instruction(mie.insn, &env);
+      dense_fp_iter.analyze_instruction(mie.insn, &dense_env);
+    }
+  }
+
+  // v2 is only defined along one path.
+  auto exit_env = dense_fp_iter.get_exit_state_at(cfg.exit_block());
+  EXPECT_TRUE(dense_fp_iter.get(exit_env, 2).is_top());
+  auto v1_defs = dense_fp_iter.get(exit_env, 1);
+  ASSERT_EQ(1, v1_defs.size());
+  EXPECT_EQ(OPCODE_ADD_INT, (*v1_defs.elements().begin())->opcode());
+
+  code->clear_cfg();
+}
+
 } // namespace
@@ -22,6 +22,7 @@
 #include "LocalDce.h"
 #include "RedexTest.h"
 #include "ReflectionAnalysis.h"
+#include "ReflectionAnalysisCache.h"
 #include "Show.h"
 
 using namespace testing;
@@ -106,6 +107,51 @@ TEST_F(ReflectionAnalysisTest, constClass) {
   // clang-format on
 }
 
+TEST_F(ReflectionAnalysisTest, cacheNoReflection) {
+  auto insns = assembler::ircode_from_string(R"(
+    (
+      (const-string "S1")
+      (move-result-pseudo-object v1)
+    )
+  )");
+  add_code(std::move(insns));
+  ReflectionAnalysisCache cache;
+  EXPECT_FALSE(cache.has_reflection(m_method));
+  EXPECT_FALSE(cache.has_reflection(m_method));
+  EXPECT_EQ(cache.get_stats().hits, 1);
+  EXPECT_EQ(cache.get_stats().misses, 1);
+
+  // Analyses without reflection sites are not kept.
+  EXPECT_FALSE(cache.get(m_method)->has_found_reflection());
+  EXPECT_EQ(cache.get_stats().misses, 2);
+}
+
+TEST_F(ReflectionAnalysisTest, cacheInvalidatedByCodeChange) {
+  auto insns = assembler::ircode_from_string(R"(
+    (
+      (const-class "LFoo;")
+      (move-result-pseudo-object v1)
+    )
+  )");
+  add_code(std::move(insns));
+  ReflectionAnalysisCache cache;
+  EXPECT_TRUE(cache.has_reflection(m_method));
+  auto analysis = cache.get(m_method);
+  EXPECT_TRUE(analysis->has_found_reflection());
+  EXPECT_EQ(cache.get(m_method), analysis);
+  EXPECT_EQ(cache.get_stats().hits, 2);
+  EXPECT_EQ(cache.get_stats().misses, 1);
+
+  auto& cfg = m_method->get_code()->cfg();
+  auto* insn = new IRInstruction(OPCODE_CONST);
+  insn->set_dest(0)->set_literal(0);
+  cfg.entry_block()->push_front(insn);
+  auto updated = cache.get(m_method);
+  EXPECT_NE(updated, analysis);
+  EXPECT_TRUE(updated->has_found_reflection());
+  EXPECT_EQ(cache.get_stats().misses, 2);
+}
+
 TEST_F(ReflectionAnalysisTest, getClassOnParam) {
   auto insns = assembler::ircode_from_string(R"(
     (
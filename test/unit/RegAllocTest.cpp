@@ -204,6 +204,122 @@ TEST_F(RegAllocTest, BuildInterferenceGraph) {
   }
 }
 
+TEST_F(RegAllocTest, HotSpillCost) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+     (load-param v0)
+     (.src_block "LFoo;.bar:(I)I" 0 (1.0 1.0))
+     (if-eqz v0 :cold)
+     (const v1 1)
+     (return v1)
+     (:cold)
+     (.src_block "LFoo;.bar:(I)I" 1 (0.0 0.0))
+     (const v2 2)
+     (return v2)
+    )
+)");
+  code->set_registers_size(3);
+
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+  LivenessFixpointIterator fixpoint_iter(cfg);
+  fixpoint_iter.run(LivenessDomain());
+
+  RangeSet range_set;
+  interference::Graph ig = interference::build_graph(
+      fixpoint_iter, cfg, code->get_registers_size(), range_set);
+  EXPECT_EQ(ig.get_node(1).spill_cost(), 2);
+  EXPECT_EQ(ig.get_node(1).hot_spill_cost(), 2);
+  EXPECT_EQ(ig.get_node(2).spill_cost(), 2);
+  EXPECT_EQ(ig.get_node(2).hot_spill_cost(), 0);
+}
+
+TEST_F(RegAllocTest, DenseLivenessMatchesSparse) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+     (load-param v0)
+     (load-param v1)
+     (const v2 0)
+     (:loop)
+     (if-eqz v0 :end)
+     (add-int v3 v1 v2)
+     (move v2 v3)
+     (add-int/lit v0 v0 -1)
+     (goto :loop)
+     (:end)
+     (return v2)
+    )
+)");
+  code->set_registers_size(4);
+
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+  EXPECT_TRUE(use_dense_liveness(cfg));
+
+  LivenessFixpointIterator fixpoint_iter(cfg);
+  fixpoint_iter.run(LivenessDomain());
+  DenseLivenessFixpointIterator dense_fixpoint_iter(cfg);
+  dense_fixpoint_iter.run(DenseLivenessDomain());
+
+  auto to_vector = [](const auto& domain) {
+    return std::vector<reg_t>(domain.elements().begin(),
+                              domain.elements().end());
+  };
+  for (auto* block : cfg.blocks()) {
+    EXPECT_THAT(
+        to_vector(dense_fixpoint_iter.get_live_in_vars_at(block)),
+        ::testing::UnorderedElementsAreArray(
+            to_vector(fixpoint_iter.get_live_in_vars_at(block))));
+    EXPECT_THAT(
+        to_vector(dense_fixpoint_iter.get_live_out_vars_at(block)),
+        ::testing::UnorderedElementsAreArray(
+            to_vector(fixpoint_iter.get_live_out_vars_at(block))));
+  }
+  EXPECT_THAT(to_vector(dense_fixpoint_iter.get_live_in_vars_at(
+                  cfg.entry_block())),
+              ::testing::IsEmpty());
+
+  RangeSet range_set;
+  auto ig = interference::build_graph(fixpoint_iter, cfg,
+                                      code->get_registers_size(), range_set);
+  auto dense_ig = interference::build_graph(
+      dense_fixpoint_iter, cfg, code->get_registers_size(), range_set);
+  EXPECT_EQ(ig.nodes().size(), dense_ig.nodes().size());
+  for (auto& pair : ig.nodes()) {
+    EXPECT_THAT(dense_ig.get_node(pair.first).adjacent(),
+                ::testing::UnorderedElementsAreArray(pair.second.adjacent()));
+  }
+
+  code->clear_cfg();
+}
+
+TEST_F(RegAllocTest, AdjacencyMatrix) {
+  interference::impl::AdjacencyMatrix matrix;
+  matrix.init(4);
+  // Both the triangular bit matrix and the hash map fallback for registers
+  // beyond the initial size.
+  for (reg_t base : {0u, 10u}) {
+    reg_t u = base + 1;
+    reg_t v = base + 3;
+    EXPECT_FALSE(matrix.contains(u, v));
+    matrix.add(u, v, /* can_coalesce */ true);
+    EXPECT_TRUE(matrix.contains(u, v));
+    EXPECT_TRUE(matrix.contains(v, u));
+    EXPECT_TRUE(matrix.can_coalesce(v, u));
+    EXPECT_FALSE(matrix.contains(u, u));
+    EXPECT_FALSE(matrix.contains(base, v));
+    matrix.add(v, u, /* can_coalesce */ false);
+    EXPECT_FALSE(matrix.can_coalesce(u, v));
+    matrix.add(u, v, /* can_coalesce */ true);
+    EXPECT_FALSE(matrix.can_coalesce(u, v));
+  }
+  EXPECT_FALSE(matrix.contains(0, 1));
+  EXPECT_FALSE(matrix.contains(2, 3));
+  EXPECT_FALSE(matrix.contains(1, 2));
+}
+
 TEST_F(RegAllocTest, CombineNonAdjacentNodes) {
   using namespace interference::impl;
   auto ig = GraphBuilder::create_empty();
@@ -328,6 +444,46 @@ TEST_F(RegAllocTest, MoveWideCoalesce) {
   EXPECT_CODE_EQ(code.get(), expected_code.get());
 }
 
+TEST_F(RegAllocTest, CoalesceCommutativeSecondSource) {
+  auto coalesce = [](const graph_coloring::Allocator::Config& config) {
+    auto code = assembler::ircode_from_string(R"(
+      (
+       (const v0 0)
+       (const v1 1)
+       (add-int v2 v1 v0)
+       (add-int v3 v2 v1)
+       (return v3)
+      )
+  )");
+    code->set_registers_size(4);
+    code->build_cfg();
+    auto& cfg = code->cfg();
+    cfg.calculate_exit_block();
+    LivenessFixpointIterator fixpoint_iter(cfg);
+    fixpoint_iter.run(LivenessDomain());
+
+    RangeSet range_set;
+    interference::Graph ig = interference::build_graph(
+        fixpoint_iter, cfg, code->get_registers_size(), range_set);
+    graph_coloring::Allocator allocator(config);
+    allocator.coalesce(&ig, cfg);
+    code->clear_cfg();
+    for (const auto& mie : InstructionIterable(code.get())) {
+      if (mie.insn->opcode() == OPCODE_ADD_INT) {
+        return mie.insn->dest() == mie.insn->src(1);
+      }
+    }
+    not_reached();
+  };
+
+  // v1 is still live after the first add-int, so its dest can only be
+  // coalesced with its second source.
+  graph_coloring::Allocator::Config config;
+  EXPECT_FALSE(coalesce(config));
+  config.prefer_compact_encodings = true;
+  EXPECT_TRUE(coalesce(config));
+}
+
 TEST_F(RegAllocTest, NoCoalesceWide) {
   auto code = assembler::ircode_from_string(R"(
     (
@@ -267,3 +267,42 @@ TEST_F(RemoveUnusedArgsTest, multipleBlocksMixedArgs) {
       remove_unused_args::compute_dead_insns(method, *(method->get_code())));
   EXPECT_THAT(dead_args, ::testing::ElementsAre());
 }
+
+// Checks that the cached dead args are reused while the code is unchanged, and
+// computed again once it changes
+TEST_F(RemoveUnusedArgsTest, deadArgsCache) {
+  auto method = assembler::method_from_string(R"(
+    (method (static) "LFoo;.baz:(II)I"
+      (
+        (load-param v0)
+        (load-param v1)
+        (return v1)
+      )
+    )
+  )");
+
+  method->get_code()->build_cfg();
+  calculate_exit_block(method);
+  remove_unused_args::DeadArgsCache cache;
+  auto dead_insns = cache.get(method, *method->get_code());
+  EXPECT_THAT(vector_from_map(dead_insns), ::testing::ElementsAre(0));
+  EXPECT_EQ(cache.misses(), 1);
+
+  auto cached_dead_insns = cache.get(method, *method->get_code());
+  EXPECT_THAT(vector_from_map(cached_dead_insns), ::testing::ElementsAre(0));
+  EXPECT_EQ(cached_dead_insns.at(0)->insn, dead_insns.at(0)->insn);
+  EXPECT_EQ(cache.hits(), 1);
+
+  // Once v1 is no longer used, both args are dead.
+  auto& cfg = method->get_code()->cfg();
+  for (const auto& mie : InstructionIterable(cfg)) {
+    if (opcode::is_a_return_value(mie.insn->opcode())) {
+      mie.insn->set_opcode(OPCODE_RETURN_VOID);
+      mie.insn->set_srcs_size(0);
+    }
+  }
+  auto updated_dead_insns = cache.get(method, *method->get_code());
+  EXPECT_THAT(vector_from_map(updated_dead_insns),
+              ::testing::ElementsAre(0, 1));
+  EXPECT_EQ(cache.misses(), 2);
+}
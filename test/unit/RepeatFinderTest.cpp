@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+
+#include "RepeatFinder.h"
+
+using namespace outliner_impl;
+
+namespace {
+
+// Quadratic reference implementation.
+std::vector<uint32_t> naive_repeat_lengths(
+    const std::vector<uint32_t>& tokens) {
+  std::vector<uint32_t> lengths(tokens.size(), 0);
+  for (size_t i = 0; i < tokens.size(); i++) {
+    for (size_t j = 0; j < tokens.size(); j++) {
+      if (i == j) {
+        continue;
+      }
+      uint32_t h = 0;
+      while (i + h < tokens.size() && j + h < tokens.size() &&
+             tokens[i + h] == tokens[j + h]) {
+        h++;
+      }
+      lengths[i] = std::max(lengths[i], h);
+    }
+  }
+  return lengths;
+}
+
+} // namespace
+
+TEST(RepeatFinderTest, suffix_array) {
+  // "banana"
+  std::vector<uint32_t> tokens{'b', 'a', 'n', 'a', 'n', 'a'};
+  EXPECT_EQ(build_suffix_array(tokens),
+            (std::vector<uint32_t>{5, 3, 1, 0, 4, 2}));
+  EXPECT_TRUE(build_suffix_array({}).empty());
+  EXPECT_EQ(build_suffix_array({7}), std::vector<uint32_t>{0});
+}
+
+TEST(RepeatFinderTest, repeat_lengths) {
+  // Unique separators (100, 101) stop repeats.
+  std::vector<uint32_t> tokens{1, 2, 3, 4, 100, 1, 2, 3, 5, 101, 2, 3};
+  EXPECT_EQ(get_repeat_lengths(tokens),
+            (std::vector<uint32_t>{3, 2, 1, 0, 0, 3, 2, 1, 0, 0, 2, 1}));
+}
+
+TEST(RepeatFinderTest, random) {
+  std::mt19937 gen(0);
+  for (size_t iter = 0; iter < 200; iter++) {
+    std::vector<uint32_t> tokens(gen() % 64);
+    for (auto& t : tokens) {
+      t = gen() % (1 + iter % 4);
+    }
+    auto sa = build_suffix_array(tokens);
+    EXPECT_TRUE(std::is_sorted(sa.begin(), sa.end(), [&](auto a, auto b) {
+      return std::lexicographical_compare(tokens.begin() + a, tokens.end(),
+                                          tokens.begin() + b, tokens.end());
+    }));
+    EXPECT_EQ(get_repeat_lengths(tokens), naive_repeat_lengths(tokens));
+  }
+}
@@ -422,3 +422,27 @@ TEST_F(ResolverTest, ResolveMethod) {
   EXPECT_TRUE(resolve_method(g_method, MethodSearch::InterfaceVirtual) ==
               e_method);
 }
+
+TEST_F(ResolverTest, ResolveMethodAfterHierarchyChanges) {
+  auto obj_t = DexType::make_type("Ljava/lang/Object;");
+  auto x = DexType::make_type("X");
+  auto y = DexType::make_type("Y");
+  auto z = DexType::make_type("Z");
+  std::vector<DexField*> no_fields;
+  auto cls_X = create_class(x, obj_t, no_fields);
+  auto cls_Y = create_class(y, x, no_fields);
+  auto cls_Z = create_class(z, y, no_fields);
+  auto x_method = create_method(cls_X, "method");
+  auto z_method = create_method(cls_Z, "method", ACC_PUBLIC, false);
+
+  // Resolutions are cached, but changes to methods and super classes are
+  // seen by the next resolution.
+  EXPECT_EQ(resolve_method(z_method, MethodSearch::Virtual), x_method);
+  EXPECT_EQ(resolve_method(z_method, MethodSearch::Virtual), x_method);
+  auto y_method = create_method(cls_Y, "method");
+  EXPECT_EQ(resolve_method(z_method, MethodSearch::Virtual), y_method);
+  cls_Y->remove_method(y_method->as_def());
+  EXPECT_EQ(resolve_method(z_method, MethodSearch::Virtual), x_method);
+  cls_Z->set_super_class(obj_t);
+  EXPECT_EQ(resolve_method(z_method, MethodSearch::Virtual), nullptr);
+}
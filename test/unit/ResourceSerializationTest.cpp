@@ -1053,6 +1053,18 @@ TEST(ResTable, TestBuilderRoundTrip) {
   EXPECT_TRUE(are_files_equal(get_env("test_arsc_path"), res_path));
 }
 
+TEST(ResTable, RemapWithoutStructuralChangesKeepsFile) {
+  auto tmp_dir = redex::make_tmp_dir("ResTable%%%%%%%%");
+  auto res_path = tmp_dir.path + "/resources.arsc";
+  copy_file(get_env("test_arsc_path"), res_path);
+  {
+    ResourcesArscFile res_table(res_path);
+    res_table.remap_res_ids_and_serialize({}, {});
+  }
+  // Remapping is done in place; no re-serialization of the table happens.
+  EXPECT_TRUE(are_files_equal(get_env("test_arsc_path"), res_path));
+}
+
 TEST(ResTable, BuildNewTable) {
   build_arsc_file_and_validate([&](const std::string& /* unused */,
                                    const std::string& arsc_path) {
@@ -8,9 +8,12 @@
 #include <boost/optional/optional_io.hpp>
 #include <gtest/gtest.h>
 
+#include "ConfigFiles.h"
 #include "ControlFlow.h"
+#include "Creators.h"
 #include "IRAssembler.h"
 #include "IRCode.h"
+#include "PassManager.h"
 #include "RedexTest.h"
 #include "ResultPropagation.h"
 #include "Show.h"
@@ -191,3 +194,57 @@ TEST_F(ResultPropagationTest, return_receiver_of_framework_bridge_method) {
   )";
   test_get_return_param_index(code_str, 0);
 }
+
+TEST_F(ResultPropagationTest, pass_propagates_through_call_chain) {
+  // It takes several iterations to find out that all these methods return
+  // their parameter.
+  auto* main = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.main:(I)I"
+     (
+      (load-param v0)
+      (invoke-static (v0) "LFoo;.a:(I)I")
+      (move-result v1)
+      (return v1)
+     )
+    )
+  )");
+  auto* a = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.a:(I)I"
+     (
+      (load-param v0)
+      (invoke-static (v0) "LFoo;.b:(I)I")
+      (move-result v1)
+      (return v1)
+     )
+    )
+  )");
+  auto* b = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.b:(I)I"
+     (
+      (load-param v0)
+      (return v0)
+     )
+    )
+  )");
+  ClassCreator creator(DexType::make_type("LFoo;"));
+  creator.set_super(type::java_lang_Object());
+  for (auto* method : {main, a, b}) {
+    creator.add_method(method);
+  }
+
+  ResultPropagationPass pass;
+  PassManager manager({&pass});
+  ConfigFiles config(Json::nullValue);
+  config.parse_global_config();
+  DexStore store("classes");
+  store.add_classes({creator.create()});
+  std::vector<DexStore> stores;
+  stores.emplace_back(std::move(store));
+  manager.run_passes(stores, config);
+
+  for (auto* method : {main, a}) {
+    for (const auto& mie : InstructionIterable(method->get_code())) {
+      EXPECT_NE(mie.insn->opcode(), OPCODE_MOVE_RESULT) << SHOW(method);
+    }
+  }
+}
@@ -1196,3 +1196,38 @@ TEST_F(SourceBlocksTest, create_synth_sb_from_val_list) {
   EXPECT_EQ(get_blocks_as_txt(bar_method->get_code()->cfg().blocks()),
             R"(B0: LFoo;.bar:()V@4294967295(1:1|0:1|1:0.4))");
 }
+
+TEST_F(SourceBlocksTest, copies_share_vals) {
+  using Val = SourceBlock::Val;
+  auto* src = DexString::make_string("LFoo;.bar:()V");
+  SourceBlock sb(src, 0, {Val(1, 1), Val::none(), Val(0.5, 0.4)});
+
+  SourceBlock copy(sb);
+  EXPECT_TRUE(copy.vals.is_shared_with(sb.vals));
+
+  // Scaling by one doesn't change anything.
+  std::vector<float> ones{1, 1, 1};
+  copy.scale(ones.data(), ones.size());
+  EXPECT_TRUE(copy.vals.is_shared_with(sb.vals));
+
+  std::vector<float> factors{0.5, 2, 2};
+  copy.scale(factors.data(), factors.size());
+  EXPECT_FALSE(copy.vals.is_shared_with(sb.vals));
+  EXPECT_EQ(sb.show(), "LFoo;.bar:()V@0(1:1|x|0.5:0.4|)");
+  EXPECT_EQ(copy.show(), "LFoo;.bar:()V@0(0.5:1|x|1:0.4|)");
+
+  // Taking the maximum of equal values shares them.
+  SourceBlock other(src, 1, {Val(0.5, 1), Val::none(), Val(1, 0.4)});
+  copy.max(other);
+  EXPECT_TRUE(copy.vals.is_shared_with(other.vals));
+
+  copy.max(sb);
+  EXPECT_FALSE(copy.vals.is_shared_with(other.vals));
+  EXPECT_EQ(copy.show(), "LFoo;.bar:()V@0(1:1|x|1:0.4|)");
+  EXPECT_EQ(other.show(), "LFoo;.bar:()V@1(0.5:1|x|1:0.4|)");
+
+  SourceBlock filled(sb);
+  filled.fill_vals(Val(0, 0));
+  EXPECT_EQ(filled.show(), "LFoo;.bar:()V@0(0:0|0:0|0:0|)");
+  EXPECT_EQ(sb.show(), "LFoo;.bar:()V@0(1:1|x|0.5:0.4|)");
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "DexAnnotation.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+#include "StartupClinitFoldingPass.h"
+#include "Walkers.h"
+
+struct StartupClinitFoldingTest : public RedexTest {
+ protected:
+  DexClass* create_class(const char* type,
+                         const std::vector<const char*>& fields,
+                         const char* clinit) {
+    ClassCreator cc(DexType::make_type(type));
+    cc.set_super(type::java_lang_Object());
+    for (const auto* name : fields) {
+      auto* field = static_cast<DexField*>(DexField::make_field(name));
+      field->make_concrete(ACC_PUBLIC | ACC_STATIC,
+                           DexEncodedValue::zero_for_type(field->get_type()));
+      cc.add_field(field);
+    }
+    cc.add_method(assembler::method_from_string(clinit));
+    return cc.create();
+  }
+
+  static StartupClinitFoldingPass::Stats run(
+      const Scope& scope,
+      const std::unordered_set<const DexType*>& startup_types) {
+    init_classes::InitClassesWithSideEffects init_classes_with_side_effects(
+        scope, /* create_init_class_insns */ false);
+    walk::code(scope, [&](DexMethod*, IRCode& code) { code.build_cfg(); });
+    auto stats = StartupClinitFoldingPass::run(scope, startup_types,
+                                               init_classes_with_side_effects);
+    walk::code(scope, [&](DexMethod*, IRCode& code) { code.clear_cfg(); });
+    return stats;
+  }
+};
+
+TEST_F(StartupClinitFoldingTest, foldConstants) {
+  auto* cls = create_class("LFoo;", {"LFoo;.a:I", "LFoo;.b:Ljava/lang/String;"},
+                           R"(
+    (method (public static) "LFoo;.<clinit>:()V"
+     (
+      (const v0 1)
+      (sput v0 "LFoo;.a:I")
+      (const-string "hello")
+      (move-result-pseudo-object v1)
+      (sput-object v1 "LFoo;.b:Ljava/lang/String;")
+      (const v0 2)
+      (sput v0 "LFoo;.a:I")
+      (return-void)
+     )
+    )
+  )");
+  auto* not_startup_cls = create_class("LBar;", {"LBar;.a:I"}, R"(
+    (method (public static) "LBar;.<clinit>:()V"
+     (
+      (const v0 1)
+      (sput v0 "LBar;.a:I")
+      (return-void)
+     )
+    )
+  )");
+
+  auto stats = run({cls, not_startup_cls}, {cls->get_type()});
+
+  EXPECT_EQ(stats.startup_clinits, 1);
+  EXPECT_EQ(stats.startup_clinits_without_side_effects, 1);
+  EXPECT_EQ(stats.folded_clinits, 1);
+  EXPECT_EQ(stats.folded_fields, 2);
+  EXPECT_EQ(cls->get_clinit(), nullptr);
+  auto* a = cls->find_sfield("a", type::_int());
+  ASSERT_NE(a, nullptr);
+  EXPECT_EQ(a->get_static_value()->value(), 2);
+  auto* b = cls->find_sfield("b", type::java_lang_String());
+  ASSERT_NE(b, nullptr);
+  ASSERT_EQ(b->get_static_value()->evtype(), DEVT_STRING);
+  EXPECT_EQ(
+      static_cast<DexEncodedValueString*>(b->get_static_value())->string(),
+      DexString::make_string("hello"));
+  EXPECT_NE(not_startup_cls->get_clinit(), nullptr);
+}
+
+TEST_F(StartupClinitFoldingTest, cascade) {
+  auto* baz = create_class("LBaz;", {"LBaz;.a:I"}, R"(
+    (method (public static) "LBaz;.<clinit>:()V"
+     (
+      (sget "LQux;.a:I")
+      (move-result-pseudo v0)
+      (sput v0 "LBaz;.a:I")
+      (return-void)
+     )
+    )
+  )");
+  auto* qux = create_class("LQux;", {"LQux;.a:I"}, R"(
+    (method (public static) "LQux;.<clinit>:()V"
+     (
+      (invoke-static () "LUnknown;.run:()I")
+      (move-result v0)
+      (sput v0 "LQux;.a:I")
+      (return-void)
+     )
+    )
+  )");
+
+  auto stats = run({qux, baz}, {baz->get_type()});
+
+  EXPECT_EQ(stats.startup_clinits, 1);
+  EXPECT_EQ(stats.startup_clinits_without_side_effects, 0);
+  EXPECT_EQ(stats.cascaded_clinits, 1);
+  EXPECT_EQ(stats.max_cascade_depth, 2);
+  EXPECT_EQ(stats.folded_clinits, 0);
+  EXPECT_NE(baz->get_clinit(), nullptr);
+}
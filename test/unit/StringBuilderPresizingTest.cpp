@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "StringBuilderPresizingPass.h"
+
+#include "ControlFlow.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+
+class StringBuilderPresizingTest : public RedexTest {
+ public:
+  void SetUp() override {
+    // The builder analysis expects the StringBuilder constructors to exist.
+    DexMethod::make_method("Ljava/lang/StringBuilder;.<init>:()V");
+    DexMethod::make_method(
+        "Ljava/lang/StringBuilder;.<init>:(Ljava/lang/String;)V");
+    DexMethod::make_method(
+        "Ljava/lang/StringBuilder;.toString:()Ljava/lang/String;");
+  }
+
+  static StringBuilderPresizingPass::Stats presize(IRCode* code) {
+    code->build_cfg();
+    auto stats = StringBuilderPresizingPass::presize_builders(
+        code->cfg(), /* max_capacity */ 64);
+    code->clear_cfg();
+    return stats;
+  }
+};
+
+TEST_F(StringBuilderPresizingTest, constantPartsAndPrimitives) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+      (load-param-object v1)
+      (new-instance "Ljava/lang/StringBuilder;")
+      (move-result-pseudo-object v2)
+      (invoke-direct (v2) "Ljava/lang/StringBuilder;.<init>:()V")
+      (const-string "Loading the item with id ")
+      (move-result-pseudo-object v3)
+      (invoke-virtual (v2 v3) "Ljava/lang/StringBuilder;.append:(Ljava/lang/String;)Ljava/lang/StringBuilder;")
+      (invoke-virtual (v2 v0) "Ljava/lang/StringBuilder;.append:(I)Ljava/lang/StringBuilder;")
+      (invoke-virtual (v2 v1) "Ljava/lang/StringBuilder;.append:(Ljava/lang/String;)Ljava/lang/StringBuilder;")
+      (invoke-virtual (v2) "Ljava/lang/StringBuilder;.toString:()Ljava/lang/String;")
+      (move-result-object v3)
+      (return-object v3)
+    )
+  )");
+
+  auto stats = presize(code.get());
+  EXPECT_EQ(1, stats.builders_presized);
+  // 25 chars of the constant string, 11 for the int and 0 for the unknown
+  // string.
+  EXPECT_EQ(36, stats.reserved_chars);
+
+  auto expected = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+      (load-param-object v1)
+      (new-instance "Ljava/lang/StringBuilder;")
+      (move-result-pseudo-object v2)
+      (const v4 36)
+      (invoke-direct (v2 v4) "Ljava/lang/StringBuilder;.<init>:(I)V")
+      (const-string "Loading the item with id ")
+      (move-result-pseudo-object v3)
+      (invoke-virtual (v2 v3) "Ljava/lang/StringBuilder;.append:(Ljava/lang/String;)Ljava/lang/StringBuilder;")
+      (invoke-virtual (v2 v0) "Ljava/lang/StringBuilder;.append:(I)Ljava/lang/StringBuilder;")
+      (invoke-virtual (v2 v1) "Ljava/lang/StringBuilder;.append:(Ljava/lang/String;)Ljava/lang/StringBuilder;")
+      (invoke-virtual (v2) "Ljava/lang/StringBuilder;.toString:()Ljava/lang/String;")
+      (move-result-object v3)
+      (return-object v3)
+    )
+  )");
+  EXPECT_CODE_EQ(expected.get(), code.get());
+}
+
+TEST_F(StringBuilderPresizingTest, smallOrUnknownUnchanged) {
+  const char* code_str = R"(
+    (
+      (load-param-object v0)
+      (load-param-object v1)
+      (new-instance "Ljava/lang/StringBuilder;")
+      (move-result-pseudo-object v2)
+      (invoke-direct (v2) "Ljava/lang/StringBuilder;.<init>:()V")
+      (const-string "id: ")
+      (move-result-pseudo-object v3)
+      (invoke-virtual (v2 v3) "Ljava/lang/StringBuilder;.append:(Ljava/lang/String;)Ljava/lang/StringBuilder;")
+      (invoke-virtual (v2 v0) "Ljava/lang/StringBuilder;.append:(Ljava/lang/String;)Ljava/lang/StringBuilder;")
+      (invoke-virtual (v2) "Ljava/lang/StringBuilder;.toString:()Ljava/lang/String;")
+      (move-result-object v3)
+      (new-instance "Ljava/lang/StringBuilder;")
+      (move-result-pseudo-object v2)
+      (invoke-direct (v2) "Ljava/lang/StringBuilder;.<init>:()V")
+      (const-string "a string that is long enough for presizing")
+      (move-result-pseudo-object v3)
+      (invoke-virtual (v2 v3) "Ljava/lang/StringBuilder;.append:(Ljava/lang/String;)Ljava/lang/StringBuilder;")
+      (invoke-virtual (v2 v1) "Ljava/lang/StringBuilder;.append:(Ljava/lang/Object;)Ljava/lang/StringBuilder;")
+      (invoke-virtual (v2) "Ljava/lang/StringBuilder;.toString:()Ljava/lang/String;")
+      (move-result-object v3)
+      (return-object v3)
+    )
+  )";
+
+  // The first builder fits in the default capacity. The second one escapes
+  // into append(Object), so its contents are unknown.
+  auto code = assembler::ircode_from_string(code_str);
+  auto stats = presize(code.get());
+  EXPECT_EQ(0, stats.builders_presized);
+  auto expected = assembler::ircode_from_string(code_str);
+  EXPECT_CODE_EQ(expected.get(), code.get());
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "StringSwitchPass.h"
+
+#include "ControlFlow.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+
+class StringSwitchTest : public RedexTest {
+ public:
+  static StringSwitchPass::Stats transform(IRCode* code) {
+    code->build_cfg();
+    return StringSwitchPass::transform_chains(code->cfg(), /* min_cases */ 3);
+  }
+
+  static int32_t hash(const char* s) {
+    return DexString::make_string(s)->java_hashcode();
+  }
+
+  static cfg::Block* find_switch(const cfg::ControlFlowGraph& cfg) {
+    for (auto* block : cfg.blocks()) {
+      auto it = block->get_last_insn();
+      if (it != block->end() && opcode::is_switch(it->insn->opcode())) {
+        return block;
+      }
+    }
+    return nullptr;
+  }
+};
+
+TEST_F(StringSwitchTest, equalsChainBecomesSwitch) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param-object v0)
+      (const-string "foo")
+      (move-result-pseudo-object v1)
+      (invoke-virtual (v0 v1) "Ljava/lang/String;.equals:(Ljava/lang/Object;)Z")
+      (move-result v2)
+      (if-nez v2 :foo)
+      (const-string "bar")
+      (move-result-pseudo-object v1)
+      (invoke-virtual (v0 v1) "Ljava/lang/String;.equals:(Ljava/lang/Object;)Z")
+      (move-result v2)
+      (if-nez v2 :bar)
+      (const-string "baz")
+      (move-result-pseudo-object v1)
+      (invoke-virtual (v0 v1) "Ljava/lang/String;.equals:(Ljava/lang/Object;)Z")
+      (move-result v2)
+      (if-eqz v2 :default)
+      (const v3 3)
+      (return v3)
+      (:foo)
+      (const v3 1)
+      (return v3)
+      (:bar)
+      (const v3 2)
+      (return v3)
+      (:default)
+      (const v3 0)
+      (return v3)
+    )
+  )");
+
+  auto stats = transform(code.get());
+  EXPECT_EQ(1, stats.chains_transformed);
+  EXPECT_EQ(3, stats.chain_links);
+
+  // Each case of the switch over the hash code leads to a single equals()
+  // comparison, which falls back to the default case on a miss.
+  auto& cfg = code->cfg();
+  auto* switch_block = find_switch(cfg);
+  ASSERT_NE(nullptr, switch_block);
+  auto* default_block = switch_block->goes_to();
+  std::vector<int32_t> keys;
+  for (auto* e : cfg.get_succ_edges_of_type(switch_block, cfg::EDGE_BRANCH)) {
+    keys.push_back(*e->case_key());
+    for (auto* succ : e->target()->succs()) {
+      EXPECT_NE(e->target(), succ->target());
+      EXPECT_TRUE(succ->target() == default_block ||
+                  succ->target()->get_first_insn()->insn->opcode() ==
+                      OPCODE_CONST);
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+  std::vector<int32_t> expected{hash("foo"), hash("bar"), hash("baz")};
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(expected, keys);
+
+  auto last = default_block->get_last_insn();
+  ASSERT_NE(default_block->end(), last);
+  EXPECT_EQ(OPCODE_RETURN, last->insn->opcode());
+}
+
+TEST_F(StringSwitchTest, constantReceiverChecksNull) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param-object v0)
+      (const-string "foo")
+      (move-result-pseudo-object v1)
+      (invoke-virtual (v1 v0) "Ljava/lang/String;.equals:(Ljava/lang/Object;)Z")
+      (move-result v2)
+      (if-nez v2 :foo)
+      (const-string "bar")
+      (move-result-pseudo-object v1)
+      (invoke-virtual (v1 v0) "Ljava/lang/String;.equals:(Ljava/lang/Object;)Z")
+      (move-result v2)
+      (if-nez v2 :bar)
+      (const-string "baz")
+      (move-result-pseudo-object v1)
+      (invoke-virtual (v1 v0) "Ljava/lang/String;.equals:(Ljava/lang/Object;)Z")
+      (move-result v2)
+      (if-nez v2 :baz)
+      (const v3 0)
+      (return v3)
+      (:foo)
+      (const v3 1)
+      (return v3)
+      (:bar)
+      (const v3 2)
+      (return v3)
+      (:baz)
+      (const v3 3)
+      (return v3)
+    )
+  )");
+
+  auto stats = transform(code.get());
+  EXPECT_EQ(1, stats.chains_transformed);
+
+  // null goes to the default case instead of reaching hashCode().
+  auto& cfg = code->cfg();
+  auto last = cfg.entry_block()->get_last_insn();
+  ASSERT_NE(cfg.entry_block()->end(), last);
+  EXPECT_EQ(OPCODE_IF_EQZ, last->insn->opcode());
+  EXPECT_EQ(0, last->insn->src(0));
+  auto* switch_block = find_switch(cfg);
+  ASSERT_NE(nullptr, switch_block);
+  EXPECT_EQ(cfg.entry_block()->goes_to(), switch_block);
+  EXPECT_EQ(switch_block->goes_to(),
+            cfg.get_succ_edge_of_type(cfg.entry_block(), cfg::EDGE_BRANCH)
+                ->target());
+}
+
+TEST_F(StringSwitchTest, liveResultUnchanged) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param-object v0)
+      (const-string "foo")
+      (move-result-pseudo-object v1)
+      (invoke-virtual (v0 v1) "Ljava/lang/String;.equals:(Ljava/lang/Object;)Z")
+      (move-result v2)
+      (if-nez v2 :match)
+      (const-string "bar")
+      (move-result-pseudo-object v1)
+      (invoke-virtual (v0 v1) "Ljava/lang/String;.equals:(Ljava/lang/Object;)Z")
+      (move-result v2)
+      (if-nez v2 :match)
+      (const-string "baz")
+      (move-result-pseudo-object v1)
+      (invoke-virtual (v0 v1) "Ljava/lang/String;.equals:(Ljava/lang/Object;)Z")
+      (move-result v2)
+      (if-nez v2 :match)
+      (return v2)
+      (:match)
+      (const v3 1)
+      (return v3)
+    )
+  )");
+
+  // The result of the last comparison is returned on a miss.
+  auto stats = transform(code.get());
+  EXPECT_EQ(0, stats.chains_transformed);
+  EXPECT_EQ(nullptr, find_switch(code->cfg()));
+}
@@ -598,3 +598,47 @@ TEST_F(StringTreeTest, testStringToStringWithComplexStrings) {
             "4f0175010401013a3a2c0e010128706172656e746865736573290401016f6e6507"
             "01016f6e655f7630060101646173682d060101746872656504010174776f");
 }
+
+TEST_F(StringTreeTest, testEncodeEntriesMatchesTree) {
+  std::vector<std::pair<std::string, int32_t>> pairs = {
+      {"com.facebook.Foo", 7},  {"com.facebook.Bar", -1},
+      {"com.facebook", 0},      {"com.facebook.Foo$1", 4096},
+      {"com.example.Baz", 63},  {"com.facebook.Bar", 12}};
+  StringTreeMap<int32_t> stm;
+  std::vector<StringTreeMap<int32_t>::Entry> entries;
+  for (const auto& [s, v] : pairs) {
+    stm.insert(s, v);
+    entries.emplace_back(s, v);
+  }
+  std::ostringstream from_tree;
+  stm.encode(from_tree);
+  std::ostringstream from_entries;
+  StringTreeMap<int32_t>::encode_entries(entries, from_entries);
+  EXPECT_EQ(toHexRepresentation(from_entries.str()),
+            toHexRepresentation(from_tree.str()));
+}
+
+TEST_F(StringTreeTest, testMapView) {
+  std::map<std::string, int32_t> values = {
+      {"a", 1},     {"ab", 0},    {"abc", 4096}, {"abd", -2147483648},
+      {"b", 63},    {"bcd", -1},  {"xyz", 2147483647}};
+  auto encoded = StringTreeMap<int32_t>::encode_string_tree_map(values);
+  StringTreeMapView<int32_t> view(encoded);
+  for (const auto& [key, value] : values) {
+    auto found = view.find(key);
+    ASSERT_TRUE(found) << key;
+    EXPECT_EQ(*found, value) << key;
+  }
+  for (const auto* key : {"", "abcd", "bc", "c", "x", "xyzz", "abe"}) {
+    EXPECT_FALSE(view.contains(key)) << key;
+  }
+
+  auto encoded_set = StringTreeSet::encode_string_tree_set(
+      {"com.facebook.Foo", "com.facebook.Bar", "com.facebook.Foo$1"});
+  StringTreeSetView set_view(encoded_set);
+  EXPECT_TRUE(set_view.contains("com.facebook.Foo"));
+  EXPECT_TRUE(set_view.contains("com.facebook.Foo$1"));
+  EXPECT_TRUE(set_view.contains("com.facebook.Bar"));
+  EXPECT_FALSE(set_view.contains("com.facebook.Fo"));
+  EXPECT_FALSE(set_view.contains("com.facebook.Baz"));
+}
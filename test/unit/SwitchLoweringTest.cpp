@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "SwitchLoweringPass.h"
+
+#include "ControlFlow.h"
+#include "Creators.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+#include "SourceBlocks.h"
+
+class SwitchLoweringTest : public RedexTest {
+ public:
+  DexMethod* make_method(const char* code) {
+    ClassCreator cc(DexType::make_type("LFoo;"));
+    cc.set_super(type::java_lang_Object());
+    auto* method =
+        DexMethod::make_method("LFoo;.bar:(I)I")
+            ->make_concrete(ACC_PUBLIC | ACC_STATIC, /* is_virtual */ false);
+    method->set_code(assembler::ircode_from_string(code));
+    method->get_code()->build_cfg();
+    cc.add_method(method);
+    cc.create();
+    return method;
+  }
+
+  static SwitchLoweringPass::Stats lower(DexMethod* method) {
+    SwitchLoweringPass::Config config;
+    return SwitchLoweringPass::lower_switches(config, method,
+                                              method->get_code()->cfg());
+  }
+
+  // The sorted case keys of all switches in the method, one list per switch.
+  static std::vector<std::vector<int32_t>> switch_keys(DexMethod* method) {
+    auto& cfg = method->get_code()->cfg();
+    std::vector<std::vector<int32_t>> res;
+    for (auto* block : cfg.blocks()) {
+      auto it = block->get_last_insn();
+      if (it == block->end() || !opcode::is_switch(it->insn->opcode())) {
+        continue;
+      }
+      std::vector<int32_t> keys;
+      for (auto* e : cfg.get_succ_edges_of_type(block, cfg::EDGE_BRANCH)) {
+        keys.push_back(*e->case_key());
+      }
+      std::sort(keys.begin(), keys.end());
+      res.push_back(std::move(keys));
+    }
+    std::sort(res.begin(), res.end());
+    return res;
+  }
+
+  static size_t count_opcode(DexMethod* method, IROpcode op) {
+    size_t count = 0;
+    for (const auto& mie :
+         cfg::InstructionIterable(method->get_code()->cfg())) {
+      count += mie.insn->opcode() == op;
+    }
+    return count;
+  }
+};
+
+TEST_F(SwitchLoweringTest, splitDenseCluster) {
+  auto* method = make_method(R"(
+    (
+      (load-param v0)
+      (switch v0 (:a :b :c :d :e :f :g :h))
+      (const v1 0)
+      (return v1)
+      (:a 0)
+      (:b 1)
+      (:c 2)
+      (:d 3)
+      (:e 4)
+      (const v1 1)
+      (return v1)
+      (:f 1000)
+      (const v1 2)
+      (return v1)
+      (:g 2000)
+      (:h 3000)
+      (const v1 3)
+      (return v1)
+    )
+  )");
+
+  auto stats = lower(method);
+  EXPECT_EQ(1, stats.split_switches);
+  EXPECT_EQ(1, stats.packed_clusters);
+  EXPECT_EQ(0, stats.peeled_hot_cases);
+
+  // The dense cluster gets its own switch behind a single range check.
+  std::vector<std::vector<int32_t>> expected{{0, 1, 2, 3, 4},
+                                             {1000, 2000, 3000}};
+  EXPECT_EQ(expected, switch_keys(method));
+  EXPECT_EQ(1, count_opcode(method, OPCODE_IF_LT));
+}
+
+TEST_F(SwitchLoweringTest, peelHotCase) {
+  auto* method = make_method(R"(
+    (
+      (load-param v0)
+      (.src_block "LFoo;.bar:(I)I" 0 (1.0 1.0))
+      (switch v0 (:a :b :c))
+      (.src_block "LFoo;.bar:(I)I" 1 (0.0 0.0))
+      (const v1 0)
+      (return v1)
+      (:a 0)
+      (.src_block "LFoo;.bar:(I)I" 2 (0.1 1.0))
+      (const v1 1)
+      (return v1)
+      (:b 1)
+      (.src_block "LFoo;.bar:(I)I" 3 (0.9 1.0))
+      (const v1 2)
+      (return v1)
+      (:c 2)
+      (.src_block "LFoo;.bar:(I)I" 4 (0.0 0.0))
+      (const v1 3)
+      (return v1)
+    )
+  )");
+
+  auto stats = lower(method);
+  EXPECT_EQ(0, stats.split_switches);
+  EXPECT_EQ(1, stats.peeled_hot_cases);
+
+  // The hot case is checked first, and the switch handles the rest.
+  std::vector<std::vector<int32_t>> expected{{0, 2}};
+  EXPECT_EQ(expected, switch_keys(method));
+  auto& cfg = method->get_code()->cfg();
+  auto* check = cfg.entry_block()->goes_to();
+  auto last = check->get_last_insn();
+  ASSERT_NE(check->end(), last);
+  EXPECT_EQ(OPCODE_IF_EQ, last->insn->opcode());
+  EXPECT_NE(nullptr, source_blocks::get_first_source_block(check));
+}
+
+TEST_F(SwitchLoweringTest, denseSwitchUnchanged) {
+  const char* code = R"(
+    (
+      (load-param v0)
+      (switch v0 (:a :b :c :d))
+      (const v1 0)
+      (return v1)
+      (:a 0)
+      (:b 1)
+      (const v1 1)
+      (return v1)
+      (:c 2)
+      (:d 3)
+      (const v1 2)
+      (return v1)
+    )
+  )";
+  auto* method = make_method(code);
+
+  auto stats = lower(method);
+  EXPECT_EQ(0, stats.split_switches);
+  EXPECT_EQ(0, stats.peeled_hot_cases);
+
+  method->get_code()->clear_cfg();
+  auto expected = assembler::ircode_from_string(code);
+  expected->build_cfg();
+  expected->clear_cfg();
+  EXPECT_CODE_EQ(expected.get(), method->get_code());
+}
@@ -6,14 +6,17 @@
  */
 
 #include <chrono>
+#include <sstream>
 #include <thread>
 #include <vector>
 
 #include <gtest/gtest.h>
+#include <json/json.h>
 
 #include "Timer.h"
 
 #include "Sanitizers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -121,3 +124,37 @@ TEST(AccumulatingTimer, multipleThreadsMultipleScopes) {
   // Assume that thread startup is not too expensive.
   EXPECT_TRUE(is_close(NUM_ITERS * kOneSecInMus, global_mus, NUM_ITERS));
 }
+
+TEST(Timeline, recordsTimersAndWorkQueueBatches) {
+  Timeline::enable();
+  {
+    Timer timer("timeline \"test\"");
+    std::vector<int> items(100);
+    workqueue_run<int>(
+        [](int) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); },
+        items, /* num_threads */ 4);
+  }
+  std::ostringstream oss;
+  Timeline::write(oss);
+
+  Json::Value trace;
+  std::istringstream iss(oss.str());
+  iss >> trace;
+  size_t timers = 0;
+  std::set<Json::UInt64> batch_tids;
+  for (const auto& event : trace["traceEvents"]) {
+    EXPECT_EQ("X", event["ph"].asString());
+    EXPECT_GE(event["dur"].asInt64(), 0);
+    if (event["cat"].asString() == "timer") {
+      EXPECT_EQ("timeline \"test\"", event["name"].asString());
+      EXPECT_GE(event["dur"].asInt64(), 25 * 1000);
+      timers++;
+    } else if (event["cat"].asString() == "workqueue") {
+      // The items of a batch that a thread processes form one event.
+      EXPECT_TRUE(batch_tids.insert(event["tid"].asUInt64()).second);
+    }
+  }
+  EXPECT_EQ(1, timers);
+  EXPECT_GE(batch_tids.size(), 1);
+  EXPECT_LE(batch_tids.size(), 4);
+}
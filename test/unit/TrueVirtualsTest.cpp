@@ -508,3 +508,47 @@ TEST_F(DevirtualizerTest, GenericRichHierarchy) {
                   "LA;.final1:()V", "LABA;.final2:()V", "LAA;.final1:(I)V",
                   "LAAB;.final2:()V", "LAAA;.final2:()V"));
 }
+
+TEST_F(DevirtualizerTest, RemoveMethodFromOverrideChain) {
+  std::vector<DexClass*> scope = create_empty_scope();
+  auto obj_t = type::java_lang_Object();
+  auto void_void =
+      DexProto::make_proto(type::_void(), DexTypeList::make_type_list({}));
+
+  auto a_t = DexType::make_type("LA;");
+  auto a_cls = create_internal_class(a_t, obj_t, {});
+  auto a_m = create_empty_method(a_cls, "m", void_void);
+  scope.push_back(a_cls);
+
+  auto b_t = DexType::make_type("LB;");
+  auto b_cls = create_internal_class(b_t, a_t, {});
+  auto b_m = create_empty_method(b_cls, "m", void_void);
+  scope.push_back(b_cls);
+
+  auto c_t = DexType::make_type("LC;");
+  auto c_cls = create_internal_class(c_t, b_t, {});
+  auto c_m = create_empty_method(c_cls, "m", void_void);
+  auto c_final = create_empty_method(c_cls, "final1", void_void);
+  scope.push_back(c_cls);
+
+  auto graph = mog::build_graph(scope);
+  EXPECT_TRUE(mog::is_true_virtual(*graph, b_m));
+
+  // Not a true virtual, so there's nothing to fix up.
+  graph->remove_method(c_final);
+  EXPECT_EQ(graph->nodes().size(), 3u);
+
+  graph->remove_method(b_m);
+  EXPECT_FALSE(mog::is_true_virtual(*graph, b_m));
+  EXPECT_THAT(mog::get_overriding_methods(*graph, a_m),
+              ::testing::UnorderedElementsAre(c_m));
+  EXPECT_THAT(mog::get_overridden_methods(*graph, c_m),
+              ::testing::UnorderedElementsAre(a_m));
+
+  // The fixed-up graph agrees with a rebuild after actually deleting B.m.
+  b_cls->remove_method(b_m);
+  auto rebuilt = mog::build_graph(scope);
+  EXPECT_EQ(graph->nodes().size(), rebuilt->nodes().size());
+  EXPECT_THAT(mog::get_overriding_methods(*rebuilt, a_m),
+              ::testing::UnorderedElementsAre(c_m));
+}
@@ -109,3 +109,31 @@ TEST_F(TypeReferenceTest, update_field_type_references) {
             type::make_array_type(
                 type::make_array_type(type::make_array_type(type::_int()))));
 }
+
+TEST_F(TypeReferenceTest, update_member_type_references) {
+  auto f_e = make_a_field("f_e", type::java_lang_Enum());
+  auto* method =
+      DexMethod::make_method("Lcom/TestClass;.foo:(Ljava/lang/Enum;)V")
+          ->make_concrete(ACC_PUBLIC | ACC_STATIC, /* is_virtual */ false);
+  m_class->add_method(method);
+  // Takes the signature that foo is updated to.
+  auto* existing = DexMethod::make_method("Lcom/TestClass;.foo:(I)V")
+                       ->make_concrete(ACC_PUBLIC | ACC_STATIC,
+                                       /* is_virtual */ false);
+  m_class->add_method(existing);
+
+  ClassHierarchy ch;
+  std::unordered_map<DexMethod*, std::string> method_debug_map;
+  update_member_type_references(
+      m_scope, m_old_to_new, ch,
+      boost::optional<std::unordered_map<DexMethod*, std::string>&>(
+          method_debug_map));
+  EXPECT_EQ(f_e->get_type(), type::_int());
+  // The direct method is renamed on collision.
+  EXPECT_EQ(method->get_proto(), existing->get_proto());
+  EXPECT_NE(method->get_name(), existing->get_name());
+  ASSERT_EQ(1, method_debug_map.size());
+  // The debug map has the original signature.
+  EXPECT_NE(std::string::npos,
+            method_debug_map.at(method).find("foo(Ljava/lang/Enum;)"));
+}
@@ -278,6 +278,8 @@ TEST_F(TypeSystemTest, empty) {
   EXPECT_FALSE(type_system.implements(odd1_t, i1_t));
   EXPECT_FALSE(type_system.implements(odd12_t, iout2_t));
   EXPECT_FALSE(type_system.implements(odd2_t, i2_t));
+  EXPECT_FALSE(type_system.implements(h_t, i1_1_t));
+  EXPECT_FALSE(type_system.implements(q_t, i1_t));
 
   EXPECT_EQ(type_system.get_implementors(i1_t).size(), 6);
   EXPECT_THAT(
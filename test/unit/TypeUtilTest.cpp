@@ -35,6 +35,27 @@ TEST_F(TypeUtilTest, test_reference_type_wrappers) {
             DexType::make_type("Ljava/lang/Double;"));
 }
 
+TEST_F(TypeUtilTest, boxing_methods) {
+  auto* integer = DexType::make_type("Ljava/lang/Integer;");
+  EXPECT_EQ(type::get_unboxing_method_for_type(integer),
+            DexMethod::make_method("Ljava/lang/Integer;.intValue:()I"));
+  EXPECT_EQ(type::get_Number_unboxing_method_for_type(integer),
+            DexMethod::make_method("Ljava/lang/Number;.intValue:()I"));
+  EXPECT_EQ(type::get_value_of_method_for_type(integer),
+            DexMethod::make_method(
+                "Ljava/lang/Integer;.valueOf:(I)Ljava/lang/Integer;"));
+  auto* character = DexType::make_type("Ljava/lang/Character;");
+  EXPECT_EQ(type::get_unboxing_method_for_type(character),
+            DexMethod::make_method("Ljava/lang/Character;.charValue:()C"));
+  EXPECT_EQ(type::get_value_of_method_for_type(character),
+            DexMethod::make_method(
+                "Ljava/lang/Character;.valueOf:(C)Ljava/lang/Character;"));
+
+  EXPECT_EQ(type::get_unboxing_method_for_type(type::java_lang_String()),
+            nullptr);
+  EXPECT_EQ(type::get_value_of_method_for_type(type::_int()), nullptr);
+}
+
 TEST_F(TypeUtilTest, is_valid_empty) {
   using namespace type;
 
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "IRAssembler.h"
+#include "ObfuscateUtils.h"
+#include "RedexTest.h"
+#include "VirtualRenamer.h"
+
+class VirtualRenamerTest : public RedexTest {
+ public:
+  void SetUp() override {
+    ClassCreator cc(DexType::make_type("LFoo;"));
+    cc.set_super(type::java_lang_Object());
+    m_virtual = DexMethod::make_method("LFoo;.foo:()V")
+                    ->make_concrete(ACC_PUBLIC, /* is_virtual */ true);
+    m_virtual->set_code(assembler::ircode_from_string("((return-void))"));
+    cc.add_method(m_virtual);
+    // A direct method that takes the first obfuscated name, with a different
+    // proto.
+    auto* direct =
+        DexMethod::make_method("LFoo;." + name(0) + ":(I)V")
+            ->make_concrete(ACC_PRIVATE | ACC_STATIC, /* is_virtual */ false);
+    direct->set_code(assembler::ircode_from_string("((return-void))"));
+    cc.add_method(direct);
+    m_scope.push_back(cc.create());
+  }
+
+  static std::string name(int seed) {
+    std::string res;
+    obfuscate_utils::compute_identifier(seed, &res);
+    return res;
+  }
+
+ protected:
+  Scope m_scope;
+  DexMethod* m_virtual;
+};
+
+TEST_F(VirtualRenamerTest, renameVirtuals) {
+  EXPECT_EQ(1, rename_virtuals(m_scope));
+  EXPECT_EQ(name(0), m_virtual->get_name()->str());
+}
+
+TEST_F(VirtualRenamerTest, avoidStackTraceCollision) {
+  EXPECT_EQ(1, rename_virtuals(m_scope, /* avoid_stack_trace_collision */
+                               true));
+  EXPECT_EQ(name(1), m_virtual->get_name()->str());
+}
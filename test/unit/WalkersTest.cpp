@@ -7,7 +7,9 @@
 
 #include "Walkers.h"
 
+#include <atomic>
 #include <gmock/gmock.h>
+#include <mutex>
 
 #include "Creators.h"
 #include "DexUtil.h"
@@ -38,3 +40,76 @@ TEST_F(WalkersTest, accumlate) {
       ::testing::UnorderedElementsAre(
           "LFoo;.bar:()V", "LFoo;.baz:()V", "LFoo;.qux:()V", "LFoo;.quux:()V"));
 }
+
+namespace {
+
+Scope make_chunking_scope() {
+  Scope scope;
+  for (auto cls_name : {"LFoo;", "LBar;"}) {
+    ClassCreator cc(DexType::make_type(cls_name));
+    cc.set_super(type::java_lang_Object());
+    for (int i = 0; i < 20; ++i) {
+      auto* method =
+          DexMethod::make_method(std::string(cls_name) + ".m" +
+                                 std::to_string(i) + ":()V")
+              ->make_concrete(ACC_PUBLIC | ACC_STATIC, i % 2 == 0);
+      if (i % 2 == 0) {
+        method->set_code(std::make_unique<IRCode>(method, 1));
+      }
+      cc.add_method(method);
+    }
+    scope.push_back(cc.create());
+  }
+  return scope;
+}
+
+struct Concatenate {
+  void operator()(const std::vector<std::string>& addend,
+                  std::vector<std::string>* accumulator) const {
+    accumulator->insert(accumulator->end(), addend.begin(), addend.end());
+  }
+};
+
+} // namespace
+
+TEST_F(WalkersTest, methods_chunked) {
+  auto scope = make_chunking_scope();
+  std::vector<std::string> expected;
+  walk::methods(scope, [&](DexMethod* m) { expected.push_back(show(m)); });
+
+  constexpr size_t num_threads = 3;
+  std::mutex mutex;
+  std::vector<std::string> visited;
+  walk::parallel::methods_chunked(
+      scope,
+      [&](DexMethod* m) {
+        std::lock_guard<std::mutex> lock(mutex);
+        visited.push_back(show(m));
+      },
+      num_threads);
+  EXPECT_THAT(visited, ::testing::UnorderedElementsAreArray(expected));
+
+  // Chunks are merged in class order, whatever the schedule.
+  auto merged =
+      walk::parallel::methods_chunked<std::vector<std::string>, Concatenate>(
+          scope,
+          [&](DexMethod* m) { return std::vector<std::string>{show(m)}; },
+          num_threads);
+  EXPECT_EQ(merged, expected);
+}
+
+TEST_F(WalkersTest, code_chunked) {
+  auto scope = make_chunking_scope();
+  std::atomic<size_t> with_code{0};
+  walk::parallel::code_chunked(scope,
+                               [&](DexMethod*, IRCode&) { with_code++; });
+  EXPECT_EQ(with_code, 20);
+
+  std::atomic<size_t> filtered{0};
+  walk::parallel::code_chunked(
+      scope,
+      [](DexMethod* m) { return m->get_class()->str() == "LFoo;"; },
+      [&](DexMethod*, IRCode&) { filtered++; },
+      3);
+  EXPECT_EQ(filtered, 10);
+}
@@ -11,6 +11,7 @@
 #include <atomic>
 #include <chrono>
 #include <gtest/gtest.h>
+#include <numeric>
 #include <random>
 
 #include "Macros.h"
@@ -119,3 +120,60 @@ TEST(WorkQueueTest, checkDynamicallyAddingTasks) {
   // 10 + 9 + ... + 1 + 0 = 55
   EXPECT_EQ(55, result);
 }
+
+TEST(WorkQueueTest, RunByCostTest) {
+  std::array<int, NUM_INTS> array{};
+
+  std::vector<int*> items;
+  items.reserve(NUM_INTS);
+  std::transform(array.begin(), array.end(), std::back_inserter(items),
+                 [](auto& i) { return &i; });
+
+  workqueue_run_by_cost<int*>(
+      [](int* a) { (*a)++; }, items,
+      [&array](int* const& a) { return (size_t)(a - array.data()) % 7; });
+
+  for (const auto& e : array) {
+    EXPECT_EQ(1, e);
+  }
+}
+
+TEST(WorkQueueTest, RunByCostSchedulesLargestFirst) {
+  // With a single thread, items are processed exactly in scheduling order.
+  std::vector<int> items{3, 1, 4, 1, 5, 9, 2, 6};
+  std::vector<int> order;
+  workqueue_run_by_cost<int>([&order](int a) { order.push_back(a); }, items,
+                             [](const int& a) { return (size_t)a; },
+                             /* num_threads */ 1);
+  EXPECT_EQ(order, std::vector<int>({9, 6, 5, 4, 3, 2, 1, 1}));
+}
+
+TEST(WorkQueueTest, ParallelReduceSum) {
+  std::vector<size_t> items(NUM_INTS);
+  std::iota(items.begin(), items.end(), 1);
+  auto sum = parallel_reduce<size_t>(
+      [](size_t a, size_t* acc) { *acc += a; }, items, /* num_threads */ 4);
+  EXPECT_EQ(NUM_INTS * (NUM_INTS + 1) / 2, sum);
+
+  EXPECT_EQ(7, parallel_reduce<size_t>([](size_t a, size_t* acc) { *acc += a; },
+                                       std::vector<size_t>(), 4, 7));
+}
+
+namespace {
+struct Append {
+  void operator()(const std::vector<int>& addend,
+                  std::vector<int>* accumulator) const {
+    accumulator->insert(accumulator->end(), addend.begin(), addend.end());
+  }
+};
+} // namespace
+
+TEST(WorkQueueTest, ParallelReduceIsOrdered) {
+  std::vector<int> items(NUM_INTS);
+  std::iota(items.begin(), items.end(), 0);
+  // Appending is not commutative, but chunks are combined in item order.
+  auto result = parallel_reduce<std::vector<int>, Append>(
+      [](int a, std::vector<int>* acc) { acc->push_back(a); }, items,
+      /* num_threads */ 8);
+  EXPECT_EQ(items, result);
+}
@@ -893,6 +893,59 @@ TEST_F(ConstantPropagationTest, WhiteBox2) {
   EXPECT_EQ(exit_state.get<SignedConstantDomain>(1), SignedConstantDomain(0));
 }
 
+TEST_F(ConstantPropagationTest, PruneDeadRegisters) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+     (load-param v0)
+     (const v1 1)
+     (const v2 2)
+     (if-eqz v0 :join)
+
+     (const v1 3)
+
+     (:join)
+     (add-int v3 v2 v2)
+     (return v3)
+    )
+  )");
+
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+  cp::State cp_state;
+  cp::intraprocedural::FixpointIterator intra_cp(
+      &cp_state, cfg, cp::ConstantPrimitiveAnalyzer());
+  cp::intraprocedural::FixpointIterator sparse_intra_cp(
+      &cp_state, cfg, cp::ConstantPrimitiveAnalyzer());
+  sparse_intra_cp.prune_dead_registers();
+  intra_cp.run(ConstantEnvironment());
+  sparse_intra_cp.run(ConstantEnvironment());
+
+  cfg::Block* join_block = nullptr;
+  for (auto* block : cfg.blocks()) {
+    auto last_insn = block->get_last_insn();
+    if (last_insn != block->end() &&
+        opcode::is_a_return(last_insn->insn->opcode())) {
+      join_block = block;
+    }
+  }
+  ASSERT_NE(join_block, nullptr);
+
+  auto entry_state = intra_cp.get_entry_state_at(join_block);
+  EXPECT_EQ(entry_state.get<SignedConstantDomain>(1),
+            SignedConstantDomain(1, 3));
+  EXPECT_EQ(entry_state.get<SignedConstantDomain>(2), SignedConstantDomain(2));
+  // v1 is dead at the join point.
+  auto sparse_entry_state = sparse_intra_cp.get_entry_state_at(join_block);
+  EXPECT_EQ(sparse_entry_state.get<SignedConstantDomain>(1),
+            SignedConstantDomain::top());
+  EXPECT_EQ(sparse_entry_state.get<SignedConstantDomain>(2),
+            SignedConstantDomain(2));
+  EXPECT_EQ(sparse_intra_cp.get_exit_state_at(join_block)
+                .get<SignedConstantDomain>(3),
+            SignedConstantDomain(4));
+}
+
 TEST_F(ConstantPropagationTest, ForwardBranchesIf) {
   auto code = assembler::ircode_from_string(R"(
     (
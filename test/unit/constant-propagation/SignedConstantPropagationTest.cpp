@@ -126,6 +126,33 @@ TEST_F(SignedConstantDomainOperationsTest, binaryOperations) {
   EXPECT_EQ(not_zero.meet(min_val), min_val);
 }
 
+TEST_F(SignedConstantDomainOperationsTest, widening) {
+  const std::vector<int64_t> thresholds{0, 10, 100};
+  auto range = SignedConstantDomain(1, 5);
+
+  EXPECT_EQ(range.widening(SignedConstantDomain(1, 6)),
+            SignedConstantDomain(1, std::numeric_limits<int64_t>::max()));
+  EXPECT_EQ(range.widening(zero),
+            SignedConstantDomain(std::numeric_limits<int64_t>::min(), 5));
+  EXPECT_EQ(range.widening(one), range);
+  EXPECT_EQ(SignedConstantDomain::bottom().widening(range), range);
+
+  EXPECT_EQ(range.widening_with_thresholds(SignedConstantDomain(1, 6),
+                                           thresholds),
+            SignedConstantDomain(1, 10));
+  EXPECT_EQ(range.widening_with_thresholds(SignedConstantDomain(2, 101),
+                                           thresholds),
+            positive);
+  // The range of a non-zero value does not include the threshold at zero.
+  EXPECT_EQ(SignedConstantDomain(5, 6).widening_with_thresholds(
+                SignedConstantDomain(3, 3), thresholds),
+            SignedConstantDomain(1, 6));
+  auto widened = range.widening_with_thresholds(minus_one, thresholds);
+  EXPECT_TRUE(widened.is_nez());
+  EXPECT_EQ(widened.min_element(), std::numeric_limits<int64_t>::min());
+  EXPECT_EQ(widened.max_element(), 5);
+}
+
 class ConstantNezTest : public RedexTest {};
 
 TEST_F(ConstantNezTest, DeterminableNezTrue) {
@@ -905,3 +932,83 @@ TEST_F(ConstantPropagationTest, NeAtBoundaryOfNez) {
 )");
   EXPECT_CODE_EQ(code.get(), expected_code.get());
 }
+
+namespace {
+
+// Also adds literals to ranges, so that the range of a loop counter grows at
+// each iteration.
+void analyze_with_range_addition(const IRInstruction* insn,
+                                 ConstantEnvironment* env) {
+  if (insn->opcode() == OPCODE_ADD_INT_LIT) {
+    auto value = env->get<SignedConstantDomain>(insn->src(0));
+    if (!value.is_bottom() && !value.is_top()) {
+      env->set(insn->dest(),
+               SignedConstantDomain(value.min_element() + insn->get_literal(),
+                                    value.max_element() + insn->get_literal()));
+      return;
+    }
+  }
+  cp::ConstantPrimitiveAnalyzer()(insn, env);
+}
+
+} // namespace
+
+TEST_F(ConstantPropagationTest, WideningThresholdsAndBudget) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+     (const v0 0)
+     (const v1 100)
+
+     (:loop)
+     (if-ge v0 v1 :exit)
+     (add-int/lit v0 v0 1)
+     (goto :loop)
+
+     (:exit)
+     (return v0)
+    )
+)");
+
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+  cp::State cp_state;
+
+  {
+    // The range of v0 is joined a hundred times.
+    cp::intraprocedural::FixpointIterator intra_cp(
+        &cp_state, cfg, analyze_with_range_addition);
+    intra_cp.run(ConstantEnvironment());
+    EXPECT_EQ(intra_cp.get_stats().extrapolations, 100);
+    EXPECT_EQ(intra_cp.get_exit_state_at(cfg.exit_block())
+                  .get<SignedConstantDomain>(0u),
+              SignedConstantDomain(100));
+  }
+
+  {
+    // The range of v0 is widened to [0, 2], [0, 99], then [0, 100].
+    cp::intraprocedural::FixpointIterator intra_cp(
+        &cp_state, cfg, analyze_with_range_addition);
+    intra_cp.use_widening_thresholds();
+    intra_cp.run(ConstantEnvironment());
+    EXPECT_EQ(intra_cp.get_stats().extrapolations, 4);
+    EXPECT_EQ(intra_cp.get_exit_state_at(cfg.exit_block())
+                  .get<SignedConstantDomain>(0u),
+              SignedConstantDomain(100));
+  }
+
+  {
+    // The loop is given up on, and only the type of v0 is known past it.
+    cp::intraprocedural::FixpointIterator intra_cp(
+        &cp_state, cfg, analyze_with_range_addition);
+    sparta::FixpointIterationBudget budget;
+    budget.max_iterations = 10;
+    intra_cp.set_budget(budget);
+    intra_cp.run(ConstantEnvironment());
+    EXPECT_EQ(intra_cp.get_stats().iteration_budget_hits, 1);
+    EXPECT_EQ(intra_cp.get_exit_state_at(cfg.exit_block())
+                  .get<SignedConstantDomain>(0u),
+              SignedConstantDomain(std::numeric_limits<int32_t>::min(),
+                                   std::numeric_limits<int32_t>::max()));
+  }
+}
@@ -41,7 +41,7 @@ dex_map_item* get_dex_map_item(ddump_data* rd, uint16_t type) {
 }
 
 void open_dex_file(const char* filename, ddump_data* rd) {
-  int fd = open(filename, O_RDWR);
+  int fd = open(filename, O_RDONLY);
   struct stat stat;
   rd->dex_filename = filename;
   if (fd < 0) {
@@ -56,11 +56,11 @@ void open_dex_file(const char* filename, ddump_data* rd) {
   rd->dexmmap = (char*)mmap(nullptr,
                             rd->dex_size,
                             PROT_READ | PROT_WRITE,
-                            MAP_FILE | MAP_SHARED,
+                            MAP_FILE | MAP_PRIVATE,
                             fd,
                             0);
   close(fd);
-  if (rd->dexmmap == nullptr) {
+  if (rd->dexmmap == MAP_FAILED) {
     fprintf(stderr, "Address space allocation failed for mmap, bailing\n");
     exit(1);
   }
@@ -83,6 +83,12 @@ void open_dex_file(const char* filename, ddump_data* rd) {
   rd->dex_proto_ids = (dex_proto_id*)(rd->dexmmap + rd->dexh->proto_ids_off);
 }
 
+void close_dex_file(ddump_data* rd) {
+  munmap(rd->dexmmap, rd->dex_size);
+  rd->dexmmap = nullptr;
+  rd->dexh = nullptr;
+}
+
 void get_type_extent(ddump_data* rd,
                      uint16_t type,
                      uint32_t& start,
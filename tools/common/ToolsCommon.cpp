@@ -25,7 +25,10 @@
 #include "DexOutput.h"
 #include "DexPosition.h"
 #include "DexUtil.h"
+#include "IRCheckpoint.h"
+#include "IRCode.h"
 #include "IRMetaIO.h"
+#include "IRInstruction.h"
 #include "InstructionLowering.h"
 #include "JarLoader.h"
 #include "Macros.h"
@@ -88,6 +91,16 @@ void write_ir_meta(const std::string& output_ir_dir, DexStoresVector& stores) {
   ir_meta_io::dump(classes, output_ir_dir);
 }
 
+/**
+ * Write the IR checkpoint, before instruction lowering.
+ */
+void write_ir_checkpoint(const std::string& output_ir_dir,
+                         DexStoresVector& stores) {
+  Timer t("Dumping IR checkpoint");
+  Scope classes = build_class_scope(stores);
+  ir_checkpoint::dump(classes, output_ir_dir);
+}
+
 /**
  * Write intermediate dex to files.
  * Development usage only
@@ -170,6 +183,87 @@ bool load_ir_meta(const std::string& input_ir_dir) {
   return ir_meta_io::load(input_ir_dir);
 }
 
+/**
+ * Restore the IR of the previous stage, if it wrote a checkpoint.
+ */
+bool load_ir_checkpoint(const std::string& input_ir_dir) {
+  Timer t("Loading IR checkpoint");
+  return ir_checkpoint::load(input_ir_dir);
+}
+
+const std::string CHECKPOINT_PREFIX = "pass_";
+
+std::string checkpoint_path(const std::string& checkpoints_dir,
+                            size_t pass_idx) {
+  return checkpoints_dir + "/" + CHECKPOINT_PREFIX + std::to_string(pass_idx);
+}
+
+/**
+ * Write the intermediate dexes of a checkpoint. They only carry the class
+ * structure, as the IR checkpoint holds the code: every method gets a stub
+ * body, so that its IR needs neither register allocation nor lowering.
+ */
+void write_checkpoint_dex(const RedexOptions& redex_options,
+                          ConfigFiles& conf,
+                          const std::string& output_ir_dir,
+                          DexStoresVector& stores,
+                          Json::Value& dex_files) {
+  std::vector<std::pair<DexMethod*, std::unique_ptr<IRCode>>> codes;
+  walk::code(build_class_scope(stores), [&](DexMethod* method, IRCode&) {
+    codes.emplace_back(method, nullptr);
+  });
+  for (auto& [method, code] : codes) {
+    code = method->release_code();
+    auto stub = std::make_unique<IRCode>(method, 0);
+    stub->push_back(new IRInstruction(OPCODE_RETURN_VOID));
+    if (code->get_debug_item() != nullptr) {
+      stub->set_debug_item(
+          std::make_unique<DexDebugItem>(*code->get_debug_item()));
+    }
+    method->set_code(std::move(stub));
+  }
+  write_intermediate_dex(redex_options, conf, output_ir_dir, stores, dex_files);
+  for (auto& [method, code] : codes) {
+    method->set_dex_code(nullptr);
+    method->set_code(std::move(code));
+  }
+}
+
+Json::Value pass_manager_state(const PassManager& manager) {
+  Json::Value state;
+  state["regalloc_has_run"] = manager.regalloc_has_run();
+  state["nopper_has_run"] = manager.nopper_has_run();
+  state["init_class_lowering_has_run"] =
+      manager.init_class_lowering_has_run();
+  state["materialize_nullchecks_has_run"] =
+      manager.materialize_nullchecks_has_run();
+  state["interdex_has_run"] = manager.interdex_has_run();
+  state["unreliable_virtual_scopes"] = manager.unreliable_virtual_scopes();
+  return state;
+}
+
+void restore_pass_manager_state(const Json::Value& state,
+                                PassManager& manager) {
+  if (state["regalloc_has_run"].asBool()) {
+    manager.record_running_regalloc();
+  }
+  if (state["nopper_has_run"].asBool()) {
+    manager.record_running_nopper();
+  }
+  if (state["init_class_lowering_has_run"].asBool()) {
+    manager.record_init_class_lowering();
+  }
+  if (state["materialize_nullchecks_has_run"].asBool()) {
+    manager.record_materialize_nullchecks();
+  }
+  if (state["interdex_has_run"].asBool()) {
+    manager.record_running_interdex();
+  }
+  if (state["unreliable_virtual_scopes"].asBool()) {
+    manager.record_unreliable_virtual_scopes();
+  }
+}
+
 static void assert_dex_magic_consistency(const std::string& source,
                                          const std::string& target) {
   always_assert_log(source.compare(target) == 0,
@@ -216,7 +310,7 @@ Json::Value parse_config(const std::string& config_file) {
 }
 
 /**
- * Dumping dex, IR meta data and entry file
+ * Dumping dex, IR meta data, IR checkpoint and entry file
  */
 void write_all_intermediate(ConfigFiles& conf,
                             const std::string& output_ir_dir,
@@ -227,13 +321,14 @@ void write_all_intermediate(ConfigFiles& conf,
   redex_options.serialize(entry_data);
   entry_data["dex_list"] = Json::arrayValue;
   write_ir_meta(output_ir_dir, stores);
+  write_ir_checkpoint(output_ir_dir, stores);
   write_intermediate_dex(redex_options, conf, output_ir_dir, stores,
                          entry_data["dex_list"]);
   write_entry_file(output_ir_dir, entry_data);
 }
 
 /**
- * Loading entry file, dex files and IR meta data
+ * Loading entry file, dex files, IR meta data and IR checkpoint
  */
 void load_all_intermediate(const std::string& input_ir_dir,
                            DexStoresVector& stores,
@@ -261,6 +356,104 @@ void load_all_intermediate(const std::string& input_ir_dir,
     std::cerr << error;
     TRACE_NO_LINE(MAIN, 1, "%s", error.c_str());
   }
+  if (!load_ir_checkpoint(input_ir_dir)) {
+    TRACE(MAIN, 1, "No IR checkpoint, using the IR of the intermediate dexes");
+  }
+}
+
+void write_checkpoint(ConfigFiles& conf,
+                      const std::string& checkpoints_dir,
+                      const RedexOptions& redex_options,
+                      DexStoresVector& stores,
+                      const PassManager& manager,
+                      size_t pass_idx) {
+  Timer t("Writing checkpoint");
+  auto dir = checkpoint_path(checkpoints_dir, pass_idx);
+  boost::filesystem::create_directories(dir);
+  Json::Value entry_data;
+  entry_data["pass_index"] = (Json::UInt64)pass_idx;
+  entry_data["pass_manager"] = pass_manager_state(manager);
+  entry_data["dex_list"] = Json::arrayValue;
+  write_ir_meta(dir, stores);
+  write_ir_checkpoint(dir, stores);
+  write_checkpoint_dex(redex_options, conf, dir, stores,
+                       entry_data["dex_list"]);
+  // Written last, so that an interrupted checkpoint is never picked up.
+  write_entry_file(dir, entry_data);
+}
+
+boost::optional<std::pair<size_t, std::string>> find_checkpoint(
+    const std::string& checkpoints_dir, size_t max_pass_idx) {
+  boost::optional<std::pair<size_t, std::string>> result;
+  if (!boost::filesystem::is_directory(checkpoints_dir)) {
+    return result;
+  }
+  for (const auto& entry :
+       boost::filesystem::directory_iterator(checkpoints_dir)) {
+    auto name = entry.path().filename().string();
+    if (name.rfind(CHECKPOINT_PREFIX, 0) != 0 ||
+        !boost::filesystem::exists(entry.path().string() + ENTRY_FILE)) {
+      continue;
+    }
+    size_t pass_idx;
+    try {
+      pass_idx = std::stoull(name.substr(CHECKPOINT_PREFIX.size()));
+    } catch (const std::exception&) {
+      continue;
+    }
+    if (pass_idx <= max_pass_idx && (!result || pass_idx > result->first)) {
+      result = std::make_pair(pass_idx, entry.path().string());
+    }
+  }
+  return result;
+}
+
+void load_checkpoint_classes(const std::string& checkpoint_dir,
+                             DexStoresVector& stores,
+                             dex_stats_t& input_totals,
+                             std::vector<dex_stats_t>& input_dexes_stats) {
+  Timer t("Load checkpoint dex");
+  Json::Value entry_data;
+  load_entry_file(checkpoint_dir, &entry_data);
+  for (const Json::Value& store_files : entry_data["dex_list"]) {
+    std::string store_name = store_files["name"].asString();
+    auto store_it = std::find_if(
+        stores.begin(), stores.end(),
+        [&](const DexStore& store) { return store.get_name() == store_name; });
+    if (store_it == stores.end()) {
+      stores.emplace_back(store_name);
+      store_it = std::prev(stores.end());
+    }
+    for (const Json::Value& file_name : store_files["list"]) {
+      auto location = boost::filesystem::path(checkpoint_dir);
+      location /= file_name.asString();
+      dex_stats_t dex_stats;
+      DexClasses classes = load_classes_from_dex(
+          DexLocation::make_location(store_name, location.string()),
+          &dex_stats);
+      input_totals += dex_stats;
+      input_dexes_stats.push_back(dex_stats);
+      store_it->add_classes(std::move(classes));
+    }
+  }
+}
+
+void load_checkpoint_state(const std::string& checkpoint_dir,
+                           DexStoresVector& stores,
+                           PassManager& manager) {
+  Timer t("Load checkpoint state");
+  Json::Value entry_data;
+  load_entry_file(checkpoint_dir, &entry_data);
+  // The IR meta data only lists non-default names.
+  init_ir_meta(stores);
+  always_assert_log(load_ir_meta(checkpoint_dir),
+                    "Cannot load the IR meta data of checkpoint %s",
+                    checkpoint_dir.c_str());
+  always_assert_log(load_ir_checkpoint(checkpoint_dir),
+                    "Cannot load the IR of checkpoint %s",
+                    checkpoint_dir.c_str());
+  restore_pass_manager_state(entry_data["pass_manager"], manager);
+  manager.set_resume_pass_index(entry_data["pass_index"].asUInt64());
 }
 
 /**
@@ -274,17 +467,18 @@ void load_classes_from_dexes_and_metadata(
     std::vector<dex_stats_t>& input_dexes_stats) {
   always_assert_log(!stores.empty(),
                     "Cannot load classes into empty DexStoresVector");
+  // Collect all dex files first, so that their classes can be loaded together.
+  // Each one is tagged with the index of the store it belongs to.
+  std::vector<const DexLocation*> locations;
+  std::vector<size_t> store_indices;
   for (const auto& filename : dex_files) {
     if (filename.size() >= 5 &&
         filename.compare(filename.size() - 4, 4, ".dex") == 0) {
       auto location = DexLocation::make_location("dex", filename);
       assert_dex_magic_consistency(stores[0].get_dex_magic(),
                                    load_dex_magic_from_dex(location));
-      dex_stats_t dex_stats;
-      DexClasses classes = load_classes_from_dex(location, &dex_stats);
-      input_totals += dex_stats;
-      input_dexes_stats.push_back(dex_stats);
-      stores[0].add_classes(std::move(classes));
+      locations.push_back(location);
+      store_indices.push_back(0);
     } else if (is_zip(filename)) {
       std::cerr << "error: Input files are expected to be DEX (with filename "
                    "ending in "
@@ -301,16 +495,20 @@ void load_classes_from_dexes_and_metadata(
         auto location = DexLocation::make_location(store.get_name(), file_path);
         assert_dex_magic_consistency(stores[0].get_dex_magic(),
                                      load_dex_magic_from_dex(location));
-        dex_stats_t dex_stats;
-        DexClasses classes = load_classes_from_dex(location, &dex_stats);
-
-        input_totals += dex_stats;
-        input_dexes_stats.push_back(dex_stats);
-        store.add_classes(std::move(classes));
+        locations.push_back(location);
+        store_indices.push_back(stores.size());
       }
       stores.emplace_back(std::move(store));
     }
   }
+
+  std::vector<dex_stats_t> dex_stats;
+  auto all_classes = load_classes_from_dexes(locations, &dex_stats);
+  for (size_t i = 0; i < locations.size(); ++i) {
+    input_totals += dex_stats[i];
+    input_dexes_stats.push_back(dex_stats[i]);
+    stores[store_indices[i]].add_classes(std::move(all_classes[i]));
+  }
 }
 
 /**
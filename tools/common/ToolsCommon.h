@@ -5,6 +5,9 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <boost/optional.hpp>
+#include <utility>
+
 #include "ConfigFiles.h"
 #include "DexStats.h"
 #include "DexStore.h"
@@ -26,6 +29,40 @@ void load_all_intermediate(const std::string& input_ir_dir,
                            DexStoresVector& stores,
                            Json::Value* entry_data);
 
+/**
+ * Checkpoints of the state before a pass, which redex-all writes before the
+ * passes listed in the checkpoint_passes option of the pass manager config,
+ * and resumes from with --resume-from-checkpoints. Each checkpoint is a
+ * directory pass_<index> with the intermediate dexes, the IR meta data, the
+ * IR checkpoint and the state of the pass manager.
+ */
+void write_checkpoint(ConfigFiles& conf,
+                      const std::string& checkpoints_dir,
+                      const RedexOptions& redex_options,
+                      DexStoresVector& stores,
+                      const PassManager& manager,
+                      size_t pass_idx);
+
+/**
+ * Returns the index and the directory of the latest checkpoint written before
+ * pass `max_pass_idx` or earlier, if any.
+ */
+boost::optional<std::pair<size_t, std::string>> find_checkpoint(
+    const std::string& checkpoints_dir, size_t max_pass_idx);
+
+void load_checkpoint_classes(const std::string& checkpoint_dir,
+                             DexStoresVector& stores,
+                             dex_stats_t& input_totals,
+                             std::vector<dex_stats_t>& input_dexes_stats);
+
+/**
+ * Restores the IR meta data, the IR and the pass manager state of a
+ * checkpoint, after its classes were loaded and the frontend ran.
+ */
+void load_checkpoint_state(const std::string& checkpoint_dir,
+                           DexStoresVector& stores,
+                           PassManager& manager);
+
 void load_classes_from_dexes_and_metadata(
     const std::vector<std::string>& dex_files,
     DexStoresVector& stores,
@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * Replays the classes and refs recorded by InterDexPass with
+ * minimize_cross_dex_refs_emit_json (interdex-cross-ref-minimization.json)
+ * through the CrossDexRefMinimizer, without running the rest of Redex.
+ *
+ * Dex boundaries are simulated from the recorded method, field and type ref
+ * limits. For each run, this prints how long building and draining the
+ * minimizer took, and the resulting number of dexes and cross-dex refs, next
+ * to the same numbers for the recorded solution. Weights can be overridden to
+ * tune the minimizer, e.g. --method_ref_weight=80.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <json/json.h>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ClassReferencesCache.h"
+#include "Creators.h"
+#include "CrossDexRefMinimizer.h"
+#include "DexClass.h"
+#include "RedexContext.h"
+
+namespace {
+
+using namespace cross_dex_ref_minimizer;
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+bool parse_option(const std::string& arg, CrossDexRefMinimizerConfig* config) {
+  auto eq = arg.find('=');
+  if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+    return false;
+  }
+  auto key = arg.substr(2, eq - 2);
+  auto value = std::stoull(arg.substr(eq + 1));
+  std::map<std::string, uint64_t*> weights = {
+      {"method_ref_weight", &config->method_ref_weight},
+      {"field_ref_weight", &config->field_ref_weight},
+      {"type_ref_weight", &config->type_ref_weight},
+      {"large_string_ref_weight", &config->large_string_ref_weight},
+      {"small_string_ref_weight", &config->small_string_ref_weight},
+      {"method_seed_weight", &config->method_seed_weight},
+      {"field_seed_weight", &config->field_seed_weight},
+      {"type_seed_weight", &config->type_seed_weight},
+      {"large_string_seed_weight", &config->large_string_seed_weight},
+      {"small_string_seed_weight", &config->small_string_seed_weight},
+  };
+  auto it = weights.find(key);
+  if (it != weights.end()) {
+    *it->second = value;
+    return true;
+  }
+  if (key == "min_large_string_size") {
+    config->min_large_string_size = (uint32_t)value;
+    return true;
+  }
+  return false;
+}
+
+// Recreates the recorded classes and refs, keyed by their JSON indices.
+class Replay {
+ public:
+  explicit Replay(const Json::Value& json) : m_json(json), m_cache({}) {
+    const auto& mapping = json["mapping"];
+    auto* holder = DexType::make_type("Lredex/bench/Refs;");
+    auto* field_type = DexType::make_type("I");
+    for (const auto& key : mapping.getMemberNames()) {
+      void* ref{nullptr};
+      switch (key.front()) {
+      case 'M':
+        // Only the identity of method and field refs matters.
+        ref = DexMethod::make_method("Lredex/bench/Refs;", "m" + key, {}, "V");
+        break;
+      case 'F':
+        ref = DexField::make_field(holder, DexString::make_string("f" + key),
+                                   field_type);
+        break;
+      case 'T':
+        ref = DexType::make_type(mapping[key].asString());
+        break;
+      case 'S':
+        // The length of strings matters.
+        ref = const_cast<DexString*>(
+            DexString::make_string(mapping[key].asString()));
+        break;
+      default:
+        continue;
+      }
+      m_refs.emplace(key, ref);
+    }
+
+    const auto& classes = json["classes"];
+    for (const auto& key : classes.getMemberNames()) {
+      const auto& json_class = classes[key];
+      ClassCreator cc(static_cast<DexType*>(m_refs.at(key)));
+      cc.set_super(DexType::make_type(json_class["super_cls"].asString()));
+      auto* cls = cc.create();
+      if (json_class["is_generated"].asBool()) {
+        cls->rstate.set_generated();
+      }
+      ClassReferences refs;
+      get_refs(json_class["method_refs"], &refs.method_refs);
+      get_refs(json_class["field_refs"], &refs.field_refs);
+      get_refs(json_class["types"], &refs.types);
+      get_refs(json_class["strings"], &refs.strings);
+      m_cache.insert(cls, std::move(refs));
+      m_classes.emplace(key, cls);
+      m_sampled.push_back(cls);
+      auto insert_index = json_class["insert_index"].asInt();
+      if (insert_index >= 0) {
+        m_inserted.emplace_back(insert_index, cls);
+      }
+    }
+    std::sort(m_inserted.begin(), m_inserted.end());
+
+    for (const auto& key : json["first_dex"]) {
+      m_first_dex.insert(m_classes.at(key.asString()));
+    }
+  }
+
+  size_t num_classes() const { return m_classes.size(); }
+
+  // Builds a minimizer in the same way as
+  // InterDex::init_cross_dex_ref_minimizer, and drains it like
+  // InterDex::emit_remaining_classes_legacy. Returns the emitted dexes.
+  std::vector<std::vector<DexClass*>> run(
+      const CrossDexRefMinimizerConfig& config) {
+    auto start = Clock::now();
+    CrossDexRefMinimizer minimizer(config, m_cache);
+    for (auto* cls : m_sampled) {
+      minimizer.sample(cls);
+    }
+    for (auto& [_, cls] : m_inserted) {
+      minimizer.insert(cls);
+      if (m_first_dex.count(cls)) {
+        minimizer.erase(cls, /* emitted */ true);
+      }
+    }
+    std::cout << "  build: " << seconds_since(start) << "s" << std::endl;
+
+    start = Clock::now();
+    std::vector<std::vector<DexClass*>> dexes(1);
+    DexRefs dex_refs;
+    for (auto* cls : m_first_dex) {
+      dex_refs.add(m_cache.get(cls));
+      dexes.back().push_back(cls);
+    }
+    bool pick_worst = true;
+    while (!minimizer.empty()) {
+      DexClass* cls{nullptr};
+      if (pick_worst) {
+        auto worst = minimizer.worst();
+        if (minimizer.get_unapplied_refs(worst) >
+            minimizer.get_applied_refs()) {
+          cls = worst;
+        }
+      }
+      if (!cls) {
+        cls = minimizer.front();
+      }
+      const auto& refs = m_cache.get(cls);
+      if (!dexes.back().empty() && !dex_refs.fits(refs, m_json["limits"])) {
+        dexes.emplace_back();
+        dex_refs = DexRefs();
+        minimizer.reset();
+        pick_worst = true;
+        continue;
+      }
+      dex_refs.add(refs);
+      dexes.back().push_back(cls);
+      minimizer.erase(cls, /* emitted */ true);
+      pick_worst = false;
+    }
+    std::cout << "  emit: " << seconds_since(start) << "s ("
+              << minimizer.stats().reprioritizations << " reprioritizations, "
+              << minimizer.stats().resets << " resets)" << std::endl;
+    return dexes;
+  }
+
+  // The recorded solution. Its first dex includes the first_dex classes.
+  std::vector<std::vector<DexClass*>> recorded_dexes() const {
+    std::vector<std::vector<DexClass*>> dexes;
+    for (const auto& json_dex : m_json["solution"]) {
+      auto& dex = dexes.emplace_back();
+      for (const auto& key : json_dex) {
+        // Canaries and other classes the minimizer didn't see are ignored.
+        auto it = m_classes.find(key.asString());
+        if (it != m_classes.end()) {
+          dex.push_back(it->second);
+        }
+      }
+    }
+    return dexes;
+  }
+
+  // The sum of the distinct refs over all dexes.
+  size_t count_refs(const std::vector<std::vector<DexClass*>>& dexes) const {
+    size_t total{0};
+    for (const auto& dex : dexes) {
+      DexRefs dex_refs;
+      for (auto* cls : dex) {
+        dex_refs.add(m_cache.get(cls));
+      }
+      total += dex_refs.size();
+    }
+    return total;
+  }
+
+ private:
+  // The distinct refs of one dex.
+  struct DexRefs {
+    std::unordered_set<const void*> methods;
+    std::unordered_set<const void*> fields;
+    std::unordered_set<const void*> types;
+    std::unordered_set<const void*> strings;
+
+    template <class Ref>
+    static size_t count_new(const std::unordered_set<const void*>& set,
+                            const std::vector<Ref>& refs) {
+      return std::count_if(refs.begin(), refs.end(),
+                           [&](auto* ref) { return !set.count(ref); });
+    }
+
+    bool fits(const ClassReferences& refs, const Json::Value& limits) const {
+      return methods.size() + count_new(methods, refs.method_refs) <=
+                 limits["methods"].asUInt64() &&
+             fields.size() + count_new(fields, refs.field_refs) <=
+                 limits["fields"].asUInt64() &&
+             types.size() + count_new(types, refs.types) <=
+                 limits["types"].asUInt64();
+    }
+
+    void add(const ClassReferences& refs) {
+      methods.insert(refs.method_refs.begin(), refs.method_refs.end());
+      fields.insert(refs.field_refs.begin(), refs.field_refs.end());
+      types.insert(refs.types.begin(), refs.types.end());
+      strings.insert(refs.strings.begin(), refs.strings.end());
+    }
+
+    size_t size() const {
+      return methods.size() + fields.size() + types.size() + strings.size();
+    }
+  };
+
+  template <class Ref>
+  void get_refs(const Json::Value& keys, std::vector<Ref>* refs) const {
+    for (const auto& key : keys) {
+      refs->push_back(static_cast<Ref>(m_refs.at(key.asString())));
+    }
+  }
+
+  const Json::Value& m_json;
+  std::unordered_map<std::string, void*> m_refs;
+  std::unordered_map<std::string, DexClass*> m_classes;
+  std::vector<DexClass*> m_sampled;
+  std::vector<std::pair<int, DexClass*>> m_inserted;
+  std::unordered_set<DexClass*> m_first_dex;
+  ClassReferencesCache m_cache;
+};
+
+void print_solution(const std::string& name,
+                    const Replay& replay,
+                    const std::vector<std::vector<DexClass*>>& dexes) {
+  std::cout << name << ": " << dexes.size() << " dexes, "
+            << replay.count_refs(dexes) << " refs" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc == 1 || std::string("--help") == argv[1] ||
+      std::string("-h") == argv[1]) {
+    std::cerr << "Usage: cross-dex-ref-minimizer-bench JSON-FILE "
+                 "[--<weight>=<value>...] [--runs=<n>]"
+              << std::endl;
+    return argc == 1 ? 1 : 0;
+  }
+
+  CrossDexRefMinimizerConfig config;
+  size_t runs = 1;
+  for (int i = 2; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.rfind("--runs=", 0) == 0) {
+      runs = std::stoull(arg.substr(7));
+    } else if (!parse_option(arg, &config)) {
+      std::cerr << "Unknown option " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  Json::Value json;
+  std::ifstream in(argv[1]);
+  in >> json;
+
+  RedexContext rc;
+  g_redex = &rc;
+  {
+    auto start = Clock::now();
+    Replay replay(json);
+    std::cout << "Loaded " << replay.num_classes() << " classes in "
+              << seconds_since(start) << "s" << std::endl;
+    print_solution("recorded", replay, replay.recorded_dexes());
+    for (size_t run = 0; run < runs; ++run) {
+      std::cout << "run " << run << ":" << std::endl;
+      print_solution("replayed", replay, replay.run(config));
+    }
+  }
+  g_redex = nullptr;
+}
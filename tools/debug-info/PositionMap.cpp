@@ -6,15 +6,21 @@
  */
 
 #include <boost/scope_exit.hpp>
+#include <cstring>
 #include <fcntl.h>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include "PositionMap.h"
 
+PositionMap::~PositionMap() {
+  munmap(const_cast<uint8_t*>(mapping), mapping_size);
+}
+
 std::unique_ptr<PositionMap> read_map(const char* filename) {
   int fd = open(filename, O_RDONLY);
   if (fd == -1) {
@@ -22,59 +28,80 @@ std::unique_ptr<PositionMap> read_map(const char* filename) {
               << ") with error: " << strerror(errno) << std::endl;
     return nullptr;
   }
+  BOOST_SCOPE_EXIT_ALL(=) { close(fd); };
   struct stat buf;
   if (fstat(fd, &buf)) {
     std::cerr << "Cannot fstat file (" << filename
               << ") with error: " << strerror(errno) << std::endl;
     return nullptr;
   }
-  uint8_t* mapping = (uint8_t*)mmap(
-      nullptr, buf.st_size, PROT_READ, MAP_FILE | MAP_SHARED, fd, 0);
-  uint32_t magic = *(uint32_t*)mapping;
-  mapping += sizeof(uint32_t);
+  size_t size = buf.st_size;
+  uint8_t* mapping =
+      (uint8_t*)mmap(nullptr, size, PROT_READ, MAP_FILE | MAP_SHARED, fd, 0);
   if (mapping == MAP_FAILED) {
     std::cerr << "mmap failed for file (" << filename
               << ") with error: " << strerror(errno) << std::endl;
     return nullptr;
   }
-  BOOST_SCOPE_EXIT_ALL(=, &buf) { munmap(mapping, buf.st_size); };
-  if (magic != 0xfaceb000) {
+  // From here on, the map owns the mapping and views into it.
+  std::unique_ptr<PositionMap> map(new PositionMap(mapping, size));
+  const uint8_t* cur = mapping;
+  const uint8_t* end = mapping + size;
+  auto read_u32 = [&](uint32_t* value) {
+    if (end - cur < (ptrdiff_t)sizeof(uint32_t)) {
+      return false;
+    }
+    memcpy(value, cur, sizeof(uint32_t));
+    cur += sizeof(uint32_t);
+    return true;
+  };
+  auto truncated = [&]() {
+    std::cerr << "Truncated file (" << filename << ")\n";
+    return nullptr;
+  };
+
+  uint32_t magic;
+  if (!read_u32(&magic) || magic != 0xfaceb000) {
     std::cerr << "Magic number mismatch\n";
     return nullptr;
   }
-  uint32_t version = *(uint32_t*)mapping;
-  mapping += sizeof(uint32_t);
-  if (version != 2) {
+  uint32_t version;
+  if (!read_u32(&version) || version != 2) {
     std::cerr << "Version mismatch\n";
     return nullptr;
   }
 
-  std::unique_ptr<PositionMap> map(new PositionMap());
-  std::vector<std::string> string_pool;
-  uint32_t spool_count = *(uint32_t*)mapping;
-  mapping += sizeof(uint32_t);
+  uint32_t spool_count;
+  if (!read_u32(&spool_count)) {
+    return truncated();
+  }
+  map->string_pool.reserve(spool_count);
   for (uint32_t i = 0; i < spool_count; ++i) {
-    uint32_t ssize = *(uint32_t*)mapping;
-    mapping += sizeof(uint32_t);
-    map->string_pool.emplace_back((const char*)mapping, ssize);
-    mapping += ssize;
+    uint32_t ssize;
+    if (!read_u32(&ssize) || (size_t)(end - cur) < ssize) {
+      return truncated();
+    }
+    map->string_pool.emplace_back((const char*)cur, ssize);
+    cur += ssize;
+  }
+  uint32_t pos_count;
+  if (!read_u32(&pos_count) ||
+      (size_t)(end - cur) < pos_count * sizeof(PositionItem)) {
+    return truncated();
   }
-  uint32_t pos_count = *(uint32_t*)mapping;
-  mapping += sizeof(uint32_t);
-  map->positions.reset(new PositionItem[pos_count]);
+  map->positions = (const PositionItem*)cur;
   map->positions_size = pos_count;
-  memcpy(map->positions.get(), mapping, pos_count * sizeof(PositionItem));
   return map;
 }
 
 std::vector<Position> get_stack(const PositionMap& map, int64_t idx) {
   std::vector<Position> stack;
   while (idx >= 0 && (size_t)idx < map.positions_size) {
-    auto pi = map.positions[idx];
-    stack.push_back(Position(map.string_pool[pi.class_id],
-                             map.string_pool[pi.method_id],
-                             map.string_pool[pi.file_id],
-                             pi.line));
+    const auto& pi = map.positions[idx];
+    stack.emplace_back(map.string_pool.at(pi.class_id),
+                       map.string_pool.at(pi.method_id),
+                       map.string_pool.at(pi.file_id),
+                       pi.line);
     idx = (int64_t)pi.parent - 1;
   }
   return stack;
@@ -7,6 +7,7 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 struct __attribute__((packed)) PositionItem {
@@ -17,22 +18,36 @@ struct __attribute__((packed)) PositionItem {
   uint32_t parent;
 };
 
+// The strings point into the PositionMap the position was read from.
 struct Position {
-  std::string cls;
-  std::string method;
-  std::string filename;
+  std::string_view cls;
+  std::string_view method;
+  std::string_view filename;
   uint32_t line;
-  Position(const std::string& cls,
-           const std::string& method,
-           const std::string& filename,
+  Position(std::string_view cls,
+           std::string_view method,
+           std::string_view filename,
            uint32_t line)
       : cls(cls), method(method), filename(filename), line(line) {}
 };
 
+// A read-only view of a memory-mapped line number map. Positions are indexed
+// directly by the line numbers in the symbolicated traces, so lookups do not
+// copy or search anything, and the map is unmapped when this is destroyed.
 struct PositionMap {
-  std::vector<std::string> string_pool;
-  std::unique_ptr<PositionItem[]> positions;
+  std::vector<std::string_view> string_pool;
+  const PositionItem* positions;
   size_t positions_size;
+
+  PositionMap(const uint8_t* mapping, size_t mapping_size)
+      : mapping(mapping), mapping_size(mapping_size) {}
+  ~PositionMap();
+  PositionMap(const PositionMap&) = delete;
+  PositionMap& operator=(const PositionMap&) = delete;
+
+ private:
+  const uint8_t* mapping;
+  size_t mapping_size;
 };
 
 std::unique_ptr<PositionMap> read_map(const char* filename);
@@ -6,30 +6,101 @@
  */
 
 #include <boost/regex.hpp>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "PositionMap.h"
 
 boost::regex trace_regex(R"/(((\s+at\s+)[^(]*)\(:(\d+)\)\s?)/");
 
+// Upper bound on the number of lines symbolicated together.
+constexpr size_t kMaxBatchLines = 16384;
+
+void symbolicate_line(const PositionMap& map,
+                      const std::string& line,
+                      std::string* out) {
+  boost::smatch matches;
+  if (!boost::regex_match(line, matches, trace_regex)) {
+    *out += line;
+    *out += '\n';
+    return;
+  }
+  auto idx = std::stoll(matches[3]) - 1;
+  for (const auto& pos : get_stack(map, idx)) {
+    *out += matches[2];
+    *out += pos.cls;
+    *out += '.';
+    *out += pos.method;
+    *out += '(';
+    *out += pos.filename;
+    *out += ':';
+    *out += std::to_string(pos.line);
+    *out += ")\n";
+  }
+}
+
+/*
+ * Reads at least one line, and then keeps reading for as long as input is
+ * already buffered. A stream of traces is therefore processed in large
+ * batches, while an interactive client still gets each answer right away.
+ */
+bool read_batch(std::vector<std::string>* lines) {
+  lines->clear();
+  std::string line;
+  while (lines->size() < kMaxBatchLines && std::getline(std::cin, line)) {
+    lines->push_back(std::move(line));
+    if (std::cin.rdbuf()->in_avail() <= 0) {
+      break;
+    }
+  }
+  return !lines->empty();
+}
+
 int main(int argc, char** argv) {
-  if (argc < 2) {
-    std::cerr << "Usage: cat trace | remap mapping_file\n";
+  size_t jobs = 1;
+  int argi = 1;
+  if (argi + 1 < argc && strcmp(argv[argi], "-j") == 0) {
+    jobs = std::max(1L, std::atol(argv[argi + 1]));
+    argi += 2;
+  }
+  if (argi + 1 != argc) {
+    std::cerr << "Usage: cat trace | remap [-j jobs] mapping_file\n";
     abort();
   }
-  auto map = read_map(argv[1]);
-  for (std::string line; std::getline(std::cin, line);) {
-    boost::smatch matches;
-    if (boost::regex_match(line, matches, trace_regex)) {
-      auto idx = std::stoi(matches[3]) - 1;
-      auto stack = get_stack(*map, idx);
-      for (const auto& pos : stack) {
-        std::cout << matches[2] << pos.cls << "." << pos.method << "("
-                  << pos.filename << ":" << pos.line << ")" << std::endl;
+  auto map = read_map(argv[argi]);
+  if (!map) {
+    return 1;
+  }
+  std::ios::sync_with_stdio(false);
+
+  // Each batch is split into one contiguous chunk per job, so the output
+  // can be written in input order once all chunks are done.
+  std::vector<std::string> lines;
+  std::vector<std::string> outputs(jobs);
+  while (read_batch(&lines)) {
+    size_t chunk = (lines.size() + jobs - 1) / jobs;
+    auto work = [&](size_t job) {
+      outputs[job].clear();
+      size_t end = std::min(lines.size(), (job + 1) * chunk);
+      for (size_t i = job * chunk; i < end; i++) {
+        symbolicate_line(*map, lines[i], &outputs[job]);
       }
-    } else {
-      std::cout << line << std::endl;
+    };
+    std::vector<std::thread> threads;
+    for (size_t job = 1; job < jobs && job * chunk < lines.size(); job++) {
+      threads.emplace_back(work, job);
+    }
+    work(0);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (size_t job = 0; job <= threads.size(); job++) {
+      std::cout << outputs[job];
     }
+    std::cout.flush();
   }
 }
@@ -5,28 +5,509 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+#include <cctype>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
 #include <getopt.h>
+#include <map>
 #include <regex>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
 
 #include "DexCommon.h"
 
 void print_usage() {
-  fprintf(stderr, "Usage: dexgrep <classname> <dexfile 1> <dexfile 2> ...\n");
+  fprintf(stderr,
+          "Usage: dexgrep [-l] [-M] [-F] <regex> <dexfile 1> <dexfile 2> ...\n"
+          "       dexgrep --build-index=<index> <dexfile 1> <dexfile 2> ...\n"
+          "       dexgrep --index=<index> [-l] [-M] [-F] <regex>\n"
+          "\n"
+          "-l: only print the names of the dex files with a match\n"
+          "-M, --methods: also match method names, as Lcls;.name:(args)ret\n"
+          "-F, --fields: also match field names, as Lcls;.name:type\n"
+          "--build-index=<index>: write a trigram index over the class,\n"
+          "                       method and field names of the given dex\n"
+          "                       files\n"
+          "--index=<index>: answer the query from an index written by\n"
+          "                 --build-index instead of scanning dex files\n");
 }
 
+namespace {
+
+enum EntryKind : uint8_t {
+  CLASS = 1,
+  METHOD = 2,
+  FIELD = 4,
+};
+
+std::string format_proto(ddump_data* rd, uint32_t protoidx) {
+  dex_proto_id* proto = rd->dex_proto_ids + protoidx;
+  std::string str = "(";
+  if (proto->param_off) {
+    uint32_t* tl = (uint32_t*)(rd->dexmmap + proto->param_off);
+    uint32_t count = *tl++;
+    uint16_t* types = (uint16_t*)tl;
+    for (uint32_t i = 0; i < count; i++) {
+      str += dex_string_by_type_idx(rd, types[i]);
+    }
+  }
+  str += ")";
+  str += dex_string_by_type_idx(rd, proto->rtypeidx);
+  return str;
+}
+
+/*
+ * Calls `fn(kind, name)` for every class defined in the dex file and, if
+ * requested, for the methods and fields of those classes.
+ */
+template <typename Fn>
+void for_each_entry(ddump_data* rd, uint8_t kinds, const Fn& fn) {
+  std::vector<bool> defined(rd->dexh->type_ids_size, false);
+  for (uint32_t i = 0; i < rd->dexh->class_defs_size; i++) {
+    dex_class_def* cls_def = rd->dex_class_defs + i;
+    defined[cls_def->typeidx] = true;
+    if (kinds & CLASS) {
+      fn(CLASS, std::string(dex_string_by_type_idx(rd, cls_def->typeidx)));
+    }
+  }
+  if (kinds & METHOD) {
+    for (uint32_t i = 0; i < rd->dexh->method_ids_size; i++) {
+      dex_method_id* method = rd->dex_method_ids + i;
+      if (!defined[method->classidx]) {
+        continue;
+      }
+      std::string name = dex_string_by_type_idx(rd, method->classidx);
+      name += ".";
+      name += dex_string_by_idx(rd, method->nameidx);
+      name += ":";
+      name += format_proto(rd, method->protoidx);
+      fn(METHOD, name);
+    }
+  }
+  if (kinds & FIELD) {
+    for (uint32_t i = 0; i < rd->dexh->field_ids_size; i++) {
+      dex_field_id* field = rd->dex_field_ids + i;
+      if (!defined[field->classidx]) {
+        continue;
+      }
+      std::string name = dex_string_by_type_idx(rd, field->classidx);
+      name += ".";
+      name += dex_string_by_idx(rd, field->nameidx);
+      name += ":";
+      name += dex_string_by_type_idx(rd, field->typeidx);
+      fn(FIELD, name);
+    }
+  }
+}
+
+uint32_t make_trigram(const char* s) {
+  return (uint32_t(uint8_t(s[0])) << 16) | (uint32_t(uint8_t(s[1])) << 8) |
+         uint32_t(uint8_t(s[2]));
+}
+
+/*
+ * Returns literal strings of at least three characters that every match of
+ * the ECMAScript regex `pattern` has to contain. This is conservative: only
+ * literals outside of groups are considered, characters made optional by a
+ * quantifier are dropped, and a pattern with an alternation yields nothing.
+ */
+std::vector<std::string> required_literals(const std::string& pattern) {
+  std::vector<std::string> literals;
+  std::string run;
+  auto flush = [&]() {
+    if (run.size() >= 3) {
+      literals.push_back(run);
+    }
+    run.clear();
+  };
+  int depth = 0;
+  size_t i = 0;
+  while (i < pattern.size()) {
+    char c = pattern[i++];
+    switch (c) {
+    case '|':
+      return {};
+    case '(':
+      depth++;
+      flush();
+      break;
+    case ')':
+      depth--;
+      flush();
+      break;
+    case '[':
+      // Skip the character class, which may start with `^` or `]`.
+      if (i < pattern.size() && pattern[i] == '^') {
+        i++;
+      }
+      if (i < pattern.size() && pattern[i] == ']') {
+        i++;
+      }
+      while (i < pattern.size() && pattern[i] != ']') {
+        i += pattern[i] == '\\' ? 2 : 1;
+      }
+      i++;
+      flush();
+      break;
+    case '*':
+    case '?':
+    case '{':
+      // The quantified character may not occur at all.
+      if (!run.empty()) {
+        run.pop_back();
+      }
+      flush();
+      if (c == '{') {
+        while (i < pattern.size() && pattern[i++] != '}') {
+        }
+      }
+      break;
+    case '+':
+    case '.':
+    case '^':
+    case '$':
+      flush();
+      break;
+    case '\\': {
+      if (i == pattern.size()) {
+        return {};
+      }
+      char e = pattern[i++];
+      if (!isalnum((unsigned char)e)) {
+        if (depth == 0) {
+          run.push_back(e);
+        }
+        break;
+      }
+      // Character class escapes, assertions, back references and escaped
+      // code points.
+      flush();
+      if (e == 'x') {
+        i += 2;
+      } else if (e == 'u') {
+        i += 4;
+      } else if (e == 'c') {
+        i += 1;
+      } else if (isdigit((unsigned char)e)) {
+        while (i < pattern.size() && isdigit((unsigned char)pattern[i])) {
+          i++;
+        }
+      }
+      break;
+    }
+    default:
+      if (depth == 0) {
+        run.push_back(c);
+      } else {
+        flush();
+      }
+      break;
+    }
+  }
+  flush();
+  return literals;
+}
+
+/*
+ * On-disk index layout. All integers are native-endian uint32_t, except for
+ * the entry kinds which are single bytes, padded to a multiple of four.
+ *
+ *   index_header
+ *   file_names[num_files]         offsets into the string table
+ *   entry_names[num_entries]      offsets into the string table
+ *   entry_files[num_entries]      indices into file_names
+ *   entry_kinds[num_entries]      EntryKind
+ *   trigrams[num_trigrams]        sorted trigrams
+ *   posting_starts[num_trigrams + 1]
+ *   postings[num_postings]        sorted entry ids, per trigram
+ *   string table                  NUL-terminated strings
+ */
+constexpr char INDEX_MAGIC[4] = {'D', 'X', 'G', 'I'};
+constexpr uint32_t INDEX_VERSION = 1;
+
+struct index_header {
+  char magic[4];
+  uint32_t version;
+  uint32_t num_files;
+  uint32_t num_entries;
+  uint32_t num_trigrams;
+  uint32_t num_postings;
+  uint32_t strtab_size;
+};
+
+size_t padded(size_t size) { return (size + 3) & ~size_t(3); }
+
+template <typename T>
+void write_array(FILE* out, const std::vector<T>& array) {
+  fwrite(array.data(), sizeof(T), array.size(), out);
+}
+
+int build_index(const char* index_file, int argc, char* argv[], int first) {
+  std::string strtab;
+  auto add_string = [&](const std::string& str) {
+    uint32_t off = strtab.size();
+    strtab.append(str.c_str(), str.size() + 1);
+    return off;
+  };
+  std::vector<uint32_t> file_names;
+  std::vector<uint32_t> entry_names;
+  std::vector<uint32_t> entry_files;
+  std::vector<uint8_t> entry_kinds;
+  std::map<uint32_t, std::vector<uint32_t>> postings;
+
+  for (int i = first; i < argc; ++i) {
+    uint32_t file = file_names.size();
+    file_names.push_back(add_string(argv[i]));
+    ddump_data rd;
+    open_dex_file(argv[i], &rd);
+    for_each_entry(&rd, CLASS | METHOD | FIELD,
+                   [&](EntryKind kind, const std::string& name) {
+                     uint32_t id = entry_names.size();
+                     entry_names.push_back(add_string(name));
+                     entry_files.push_back(file);
+                     entry_kinds.push_back(kind);
+                     for (size_t j = 0; j + 3 <= name.size(); j++) {
+                       auto& list = postings[make_trigram(&name[j])];
+                       if (list.empty() || list.back() != id) {
+                         list.push_back(id);
+                       }
+                     }
+                   });
+    close_dex_file(&rd);
+  }
+
+  std::vector<uint32_t> trigrams;
+  std::vector<uint32_t> posting_starts;
+  std::vector<uint32_t> all_postings;
+  for (const auto& [trigram, list] : postings) {
+    trigrams.push_back(trigram);
+    posting_starts.push_back(all_postings.size());
+    all_postings.insert(all_postings.end(), list.begin(), list.end());
+  }
+  posting_starts.push_back(all_postings.size());
+  entry_kinds.resize(padded(entry_kinds.size()), 0);
+
+  index_header header;
+  memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+  header.version = INDEX_VERSION;
+  header.num_files = file_names.size();
+  header.num_entries = entry_names.size();
+  header.num_trigrams = trigrams.size();
+  header.num_postings = all_postings.size();
+  header.strtab_size = strtab.size();
+
+  FILE* out = fopen(index_file, "wb");
+  if (out == nullptr) {
+    fprintf(stderr, "Cannot open %s for writing, bailing\n", index_file);
+    return 1;
+  }
+  fwrite(&header, sizeof(header), 1, out);
+  write_array(out, file_names);
+  write_array(out, entry_names);
+  write_array(out, entry_files);
+  write_array(out, entry_kinds);
+  write_array(out, trigrams);
+  write_array(out, posting_starts);
+  write_array(out, all_postings);
+  fwrite(strtab.data(), 1, strtab.size(), out);
+  if (fclose(out) != 0) {
+    fprintf(stderr, "Failed to write %s, bailing\n", index_file);
+    return 1;
+  }
+  fprintf(stderr, "Indexed %u names from %u dex files into %s\n",
+          header.num_entries, header.num_files, index_file);
+  return 0;
+}
+
+struct dex_index {
+  const index_header* header;
+  const uint32_t* file_names;
+  const uint32_t* entry_names;
+  const uint32_t* entry_files;
+  const uint8_t* entry_kinds;
+  const uint32_t* trigrams;
+  const uint32_t* posting_starts;
+  const uint32_t* postings;
+  const char* strtab;
+};
+
+bool open_index(const char* index_file, dex_index* index) {
+  int fd = open(index_file, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Cannot open index %s\n", index_file);
+    return false;
+  }
+  struct stat st;
+  fstat(fd, &st);
+  size_t size = st.st_size;
+  if (size < sizeof(index_header)) {
+    fprintf(stderr, "%s is not a dexgrep index\n", index_file);
+    close(fd);
+    return false;
+  }
+  auto* base =
+      (const char*)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    fprintf(stderr, "Cannot map index %s\n", index_file);
+    return false;
+  }
+  index->header = (const index_header*)base;
+  const index_header& h = *index->header;
+  if (memcmp(h.magic, INDEX_MAGIC, sizeof(h.magic)) != 0 ||
+      h.version != INDEX_VERSION) {
+    fprintf(stderr, "%s is not a dexgrep index\n", index_file);
+    return false;
+  }
+  size_t expected = sizeof(index_header) +
+                    sizeof(uint32_t) * (h.num_files + 2 * h.num_entries +
+                                        2 * h.num_trigrams + 1 +
+                                        h.num_postings) +
+                    padded(h.num_entries) + h.strtab_size;
+  if (size != expected) {
+    fprintf(stderr, "Index %s is truncated or corrupt\n", index_file);
+    return false;
+  }
+  const char* p = base + sizeof(index_header);
+  auto take = [&](size_t bytes) {
+    const char* ret = p;
+    p += bytes;
+    return ret;
+  };
+  index->file_names = (const uint32_t*)take(4 * h.num_files);
+  index->entry_names = (const uint32_t*)take(4 * h.num_entries);
+  index->entry_files = (const uint32_t*)take(4 * h.num_entries);
+  index->entry_kinds = (const uint8_t*)take(padded(h.num_entries));
+  index->trigrams = (const uint32_t*)take(4 * h.num_trigrams);
+  index->posting_starts = (const uint32_t*)take(4 * (h.num_trigrams + 1));
+  index->postings = (const uint32_t*)take(4 * h.num_postings);
+  index->strtab = take(h.strtab_size);
+  return true;
+}
+
+/*
+ * Returns the sorted ids of the entries containing all trigrams of the
+ * required literals of `pattern`, or all entries if there are none.
+ */
+std::vector<uint32_t> find_candidates(const dex_index& index,
+                                      const std::string& pattern) {
+  std::vector<uint32_t> trigrams;
+  for (const auto& literal : required_literals(pattern)) {
+    for (size_t i = 0; i + 3 <= literal.size(); i++) {
+      trigrams.push_back(make_trigram(&literal[i]));
+    }
+  }
+  std::sort(trigrams.begin(), trigrams.end());
+  trigrams.erase(std::unique(trigrams.begin(), trigrams.end()),
+                 trigrams.end());
+
+  std::vector<std::pair<const uint32_t*, const uint32_t*>> lists;
+  const uint32_t* begin = index.trigrams;
+  const uint32_t* end = index.trigrams + index.header->num_trigrams;
+  for (auto trigram : trigrams) {
+    auto* it = std::lower_bound(begin, end, trigram);
+    if (it == end || *it != trigram) {
+      return {};
+    }
+    size_t t = it - begin;
+    lists.emplace_back(index.postings + index.posting_starts[t],
+                       index.postings + index.posting_starts[t + 1]);
+  }
+
+  std::vector<uint32_t> candidates;
+  if (lists.empty()) {
+    candidates.resize(index.header->num_entries);
+    for (uint32_t i = 0; i < candidates.size(); i++) {
+      candidates[i] = i;
+    }
+    return candidates;
+  }
+  // Intersect starting from the shortest posting list.
+  std::sort(lists.begin(), lists.end(), [](const auto& a, const auto& b) {
+    return a.second - a.first < b.second - b.first;
+  });
+  candidates.assign(lists[0].first, lists[0].second);
+  for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+    std::vector<uint32_t> next;
+    std::set_intersection(candidates.begin(), candidates.end(),
+                          lists[i].first, lists[i].second,
+                          std::back_inserter(next));
+    candidates.swap(next);
+  }
+  return candidates;
+}
+
+int query_index(const char* index_file,
+                const char* search_str,
+                uint8_t kinds,
+                bool files_only) {
+  dex_index index;
+  if (!open_index(index_file, &index)) {
+    return 1;
+  }
+  std::regex re(search_str);
+  std::vector<bool> printed_files(index.header->num_files, false);
+  for (auto id : find_candidates(index, search_str)) {
+    uint32_t file = index.entry_files[id];
+    if (!(index.entry_kinds[id] & kinds) ||
+        (files_only && printed_files[file])) {
+      continue;
+    }
+    const char* name = index.strtab + index.entry_names[id];
+    if (!std::regex_search(name, re)) {
+      continue;
+    }
+    const char* dexfile = index.strtab + index.file_names[file];
+    if (files_only) {
+      printf("%s\n", dexfile);
+      printed_files[file] = true;
+    } else {
+      printf("%s: %s\n", dexfile, name);
+    }
+  }
+  return 0;
+}
+
+} // namespace
+
 int main(int argc, char* argv[]) {
   bool files_only = false;
+  uint8_t kinds = CLASS;
+  const char* build_index_file = nullptr;
+  const char* index_file = nullptr;
   char c;
   static const struct option options[] = {
       {"files-without-match", no_argument, nullptr, 'l'},
+      {"methods", no_argument, nullptr, 'M'},
+      {"fields", no_argument, nullptr, 'F'},
+      {"build-index", required_argument, nullptr, 'B'},
+      {"index", required_argument, nullptr, 'I'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, 0, nullptr, 0},
   };
-  while ((c = getopt_long(argc, argv, "hl", &options[0], nullptr)) != -1) {
+  while ((c = getopt_long(argc, argv, "hlMF", &options[0], nullptr)) != -1) {
     switch (c) {
     case 'l':
       files_only = true;
       break;
+    case 'M':
+      kinds |= METHOD;
+      break;
+    case 'F':
+      kinds |= FIELD;
+      break;
+    case 'B':
+      build_index_file = optarg;
+      break;
+    case 'I':
+      index_file = optarg;
+      break;
     case 'h':
       print_usage();
       return 0;
@@ -36,6 +517,24 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  if (build_index_file != nullptr) {
+    if (optind == argc) {
+      fprintf(stderr, "%s: no dex files given\n", argv[0]);
+      print_usage();
+      return 1;
+    }
+    return build_index(build_index_file, argc, argv, optind);
+  }
+
+  if (index_file != nullptr) {
+    if (optind + 1 != argc) {
+      fprintf(stderr, "%s: expected a single regex\n", argv[0]);
+      print_usage();
+      return 1;
+    }
+    return query_index(index_file, argv[optind], kinds, files_only);
+  }
+
   if (optind == argc) {
     fprintf(stderr, "%s: no dex files given\n", argv[0]);
     print_usage();
@@ -50,17 +549,18 @@ int main(int argc, char* argv[]) {
     ddump_data rd;
     open_dex_file(dexfile, &rd);
 
-    auto size = rd.dexh->class_defs_size;
-    for (uint32_t j = 0; j < size; j++) {
-      dex_class_def* cls_def = rd.dex_class_defs + j;
-      char* name = dex_string_by_type_idx(&rd, cls_def->typeidx);
-      if (std::regex_search(name, re)) {
-        if (files_only) {
-          printf("%s\n", dexfile);
-        } else {
-          printf("%s: %s\n", dexfile, name);
-        }
+    bool matched = false;
+    for_each_entry(&rd, kinds, [&](EntryKind, const std::string& name) {
+      if ((files_only && matched) || !std::regex_search(name, re)) {
+        return;
       }
-    }
+      matched = true;
+      if (files_only) {
+        printf("%s\n", dexfile);
+      } else {
+        printf("%s: %s\n", dexfile, name.c_str());
+      }
+    });
+    close_dex_file(&rd);
   }
 }
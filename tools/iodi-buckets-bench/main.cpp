@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * Replays a recorded distribution of IODI method sizes through the greedy and
+ * the optimal bucketing of IODIBuckets.h, without running the rest of Redex.
+ *
+ * The input is a text file with one "<arity> <size>" pair per line. Redex
+ * records these with TRACE=IODI:5, as lines containing "[IODI][size]", which
+ * can be passed as-is; all other lines are ignored. For each bucketing, this
+ * prints how long it took, and the resulting number of programs, program
+ * bytes, and total and maximum inflated sizes.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "IODIBuckets.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Mirrors the header size of IODI programs in DexOutput.
+uint32_t header_size(uint32_t arity) {
+  return 1 + 1 + arity + 1 + (arity >= 128) + (arity >= 16384);
+}
+
+bool parse_line(std::string line, uint32_t* arity, uint32_t* size) {
+  static const std::string kTag = "[IODI][size]";
+  auto tag = line.find(kTag);
+  if (tag != std::string::npos) {
+    line = line.substr(tag + kTag.size());
+  }
+  std::istringstream in(line);
+  std::string rest;
+  return (in >> *arity >> *size) && !(in >> rest);
+}
+
+template <typename BucketFn>
+void run(const std::string& name,
+         const std::map<uint32_t, std::vector<uint32_t>>& sizes_by_arity,
+         size_t runs,
+         const BucketFn& bucket_fn) {
+  iodi::BucketingCost total;
+  double seconds = 0;
+  for (size_t run = 0; run < runs; ++run) {
+    total = iodi::BucketingCost();
+    for (const auto& [arity, sizes] : sizes_by_arity) {
+      auto start = Clock::now();
+      auto buckets = bucket_fn(sizes, header_size(arity));
+      seconds += seconds_since(start);
+      auto cost = iodi::evaluate_buckets(sizes, buckets, header_size(arity));
+      total.programs += cost.programs;
+      total.program_bytes += cost.program_bytes;
+      total.inflated_size += cost.inflated_size;
+      total.max_bucket_inflated_size = std::max(
+          total.max_bucket_inflated_size, cost.max_bucket_inflated_size);
+    }
+  }
+  std::cout << name << ": " << total.programs << " programs, "
+            << total.program_bytes << " bytes, inflated size "
+            << total.inflated_size << " (max "
+            << total.max_bucket_inflated_size << "), "
+            << seconds / runs << "s per run" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc == 1 || std::string("--help") == argv[1] ||
+      std::string("-h") == argv[1]) {
+    std::cerr << "Usage: iodi-buckets-bench SIZES-FILE "
+                 "[--max_bucket_inflated_size=<n>] [--runs=<n>]"
+              << std::endl;
+    return argc == 1 ? 1 : 0;
+  }
+
+  // The limit DexOutput uses.
+  size_t max_bucket_inflated_size = 8 * 1024;
+  size_t runs = 1;
+  for (int i = 2; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.rfind("--runs=", 0) == 0) {
+      runs = std::max<size_t>(1, std::stoull(arg.substr(7)));
+    } else if (arg.rfind("--max_bucket_inflated_size=", 0) == 0) {
+      max_bucket_inflated_size = std::stoull(arg.substr(27));
+    } else {
+      std::cerr << "Unknown option " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  std::ifstream in(argv[1]);
+  if (!in) {
+    std::cerr << "Cannot read " << argv[1] << std::endl;
+    return 1;
+  }
+  std::map<uint32_t, std::vector<uint32_t>> sizes_by_arity;
+  size_t num_methods = 0;
+  std::string line;
+  while (std::getline(in, line)) {
+    uint32_t arity;
+    uint32_t size;
+    if (parse_line(line, &arity, &size)) {
+      sizes_by_arity[arity].push_back(size);
+      num_methods++;
+    }
+  }
+  for (auto& [arity, sizes] : sizes_by_arity) {
+    std::sort(sizes.begin(), sizes.end(), std::greater<uint32_t>());
+  }
+  std::cout << "Loaded " << num_methods << " methods of "
+            << sizes_by_arity.size() << " arities" << std::endl;
+
+  run("greedy", sizes_by_arity, runs,
+      [&](const std::vector<uint32_t>& sizes, uint32_t) {
+        return iodi::greedy_buckets(sizes, max_bucket_inflated_size);
+      });
+  run("optimal", sizes_by_arity, runs,
+      [&](const std::vector<uint32_t>& sizes, uint32_t header_bytes) {
+        return iodi::optimal_buckets(sizes, max_bucket_inflated_size,
+                                     header_bytes);
+      });
+}
@@ -17,7 +17,10 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <thread>
 #include <unordered_map>
 
 #define WRITE16_TO_BUFFER(buffer, to_write, file_ptr) \
@@ -773,3 +776,67 @@ void stream::stream_dex(const uint8_t* begin,
     }
   }
 }
+
+uint32_t compute_dex_checksum(ConstBuffer dex) {
+  constexpr size_t kChecksumStart =
+      offsetof(DexFileHeader, checksum) + sizeof(uint32_t);
+  constexpr uint32_t kMod = 65521;
+  // The largest n such that 255n(n+1)/2 + (n+1)(kMod-1) fits in 32 bits, so
+  // that the sums only need to be reduced once per block.
+  constexpr size_t kBlock = 5552;
+
+  if (dex.len < kChecksumStart) {
+    return 0;
+  }
+  auto data = reinterpret_cast<const uint8_t*>(dex.ptr) + kChecksumStart;
+  size_t len = dex.len - kChecksumStart;
+  uint32_t a = 1;
+  uint32_t b = 0;
+  while (len > 0) {
+    size_t n = std::min(len, kBlock);
+    len -= n;
+    while (n--) {
+      a += *data++;
+      b += a;
+    }
+    a %= kMod;
+    b %= kMod;
+  }
+  return (b << 16) | a;
+}
+
+bool verify_dex_checksums(const std::vector<DexFileHeader>& headers,
+                          const std::vector<ConstBuffer>& dexes) {
+  CHECK(headers.size() == dexes.size());
+  std::vector<uint32_t> computed(dexes.size());
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+    for (size_t i = next++; i < dexes.size(); i = next++) {
+      computed[i] = compute_dex_checksum(dexes[i]);
+    }
+  };
+  size_t num_threads = std::min<size_t>(
+      std::max(1u, std::thread::hardware_concurrency()), dexes.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  bool ok = true;
+  for (size_t i = 0; i < dexes.size(); ++i) {
+    if (computed[i] == headers[i].checksum) {
+      printf("DexFile %zu checksum: 0x%08x OK\n", i, computed[i]);
+    } else {
+      printf("DexFile %zu checksum: 0x%08x MISMATCH (computed 0x%08x)\n",
+             i,
+             headers[i].checksum,
+             computed[i]);
+      ok = false;
+    }
+  }
+  return ok;
+}
@@ -102,3 +102,13 @@ class stream {
 };
 
 void print_dex_opcodes(const uint8_t* begin, const size_t size);
+
+// Adler-32 checksum of a dex file, as stored in its header: everything after
+// the magic and checksum fields.
+uint32_t compute_dex_checksum(ConstBuffer dex);
+
+// Checks the checksums of all dex files in their headers, spreading the files
+// over the available cores, and prints a line per file. Returns false if any
+// checksum does not match.
+bool verify_dex_checksums(const std::vector<DexFileHeader>& headers,
+                          const std::vector<ConstBuffer>& dexes);
@@ -1280,6 +1280,10 @@ class DexFiles {
 
   const std::vector<DexFileHeader>& headers() const { return headers_; }
 
+  bool verify_checksums() const {
+    return verify_dex_checksums(headers_, dexes_);
+  }
+
  private:
   std::vector<DexFileHeader> headers_;
   std::vector<ConstBuffer> dexes_;
@@ -2024,6 +2028,10 @@ class OatFile_064 : public OatFile {
 
   Status status() override { return Status::PARSE_SUCCESS; }
 
+  bool verify_dex_checksums() override {
+    return dex_files_.verify_checksums();
+  }
+
   std::vector<OatDexFile> get_oat_dexfiles() override {
     std::vector<OatDexFile> ret;
     ret.reserve(dex_file_listing_.dex_files().size());
@@ -2164,6 +2172,10 @@ class OatFile_079 : public OatFile {
                       bool samsung_mode,
                       const QuickData* quick_data);
 
+  bool verify_dex_checksums() override {
+    return dex_files_.verify_checksums();
+  }
+
   std::vector<OatDexFile> get_oat_dexfiles() override {
     std::vector<OatDexFile> ret;
     ret.reserve(dex_file_listing_.dex_files().size());
@@ -2357,6 +2369,10 @@ class OatFile_124 : public OatFile {
                       bool samsung_mode,
                       const QuickData* quick_data);
 
+  bool verify_dex_checksums() override {
+    return dex_files_.verify_checksums();
+  }
+
   std::vector<OatDexFile> get_oat_dexfiles() override {
     std::vector<OatDexFile> ret;
     ret.reserve(dex_file_listing_->dex_files().size());
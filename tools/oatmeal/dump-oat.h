@@ -89,6 +89,10 @@ class OatFile {
 
   virtual Status status() = 0;
 
+  // Checks the checksums of the embedded dex files against their headers, in
+  // parallel, and prints the results. Returns false on any mismatch.
+  virtual bool verify_dex_checksums() { return true; }
+
   // Return the version number as a string, e.g. "039", "079", etc.
   virtual std::string version_string() const = 0;
 
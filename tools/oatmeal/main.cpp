@@ -8,9 +8,11 @@
 #include "OatmealUtil.h"
 #include "dump-oat.h"
 #include "memory-accounter.h"
+#include "mmap.h"
 #include "vdex.h"
 
 #include <getopt.h>
+#include <sys/mman.h>
 
 #ifndef ANDROID
 #include <wordexp.h>
@@ -51,6 +53,9 @@ struct Arguments {
 
   bool print_unverified_classes = false;
 
+  // if true, check the checksums of the embedded dex files.
+  bool verify_dex_checksums = false;
+
   std::string arch;
 
   std::string art_image_location;
@@ -100,6 +105,7 @@ Arguments parse_args(int argc, char* argv[]) {
       {"test-is-oatmeal", no_argument, nullptr, 1},
       {"samsung-oatformat", no_argument, nullptr, 2},
       {"one-oat-per-dex", no_argument, nullptr, 3},
+      {"verify-dex-checksums", no_argument, nullptr, 4},
       {"quickening-data", required_argument, nullptr, 'q'},
       {nullptr, 0, nullptr, 0}};
 
@@ -187,6 +193,10 @@ Arguments parse_args(int argc, char* argv[]) {
       ret.one_oat_per_dex = true;
       break;
 
+    case 4:
+      ret.verify_dex_checksums = true;
+      break;
+
     case 'q':
       ret.quick_data_location = expand(optarg);
       break;
@@ -209,6 +219,12 @@ Arguments parse_args(int argc, char* argv[]) {
     exit(1);
   }
 
+  if (ret.action != Action::DUMP && ret.verify_dex_checksums) {
+    fprintf(stderr,
+            "--verify-dex-checksums can only be used with -d/--dump\n");
+    exit(1);
+  }
+
   if (!dex_locations.empty()) {
     if (dex_locations.size() != dex_files.size()) {
       fprintf(
@@ -249,20 +265,23 @@ int dump(const Arguments& args) {
 
   auto oat_file_size = get_filesize(oat_file);
 
-  // We don't run dumping during install on device, so it is allowed to consume
-  // lots of memory.
-  auto oat_file_contents = std::make_unique<char[]>(oat_file_size);
-  auto oatFileBytesRead =
-      fread(oat_file_contents.get(), 1, oat_file_size, oat_file.get());
-  if (oatFileBytesRead != oat_file_size) {
+  // Map the file rather than reading it, so that only the parts that are
+  // actually parsed are paged in.
+  std::string error_msg;
+  std::unique_ptr<MappedFile> oat_file_map(
+      MappedFile::mmap_file(oat_file_size, PROT_READ, MAP_PRIVATE,
+                            fileno(oat_file.get()), oat_file_name.c_str(),
+                            &error_msg));
+  if (oat_file_map == nullptr) {
     fprintf(stderr,
-            "Failed to read file %s (%zd)\n",
-            std::strerror(errno),
-            oatFileBytesRead);
+            "Failed to map file %s: %s\n",
+            oat_file_name.c_str(),
+            std::strerror(errno));
     return 1;
   }
 
-  ConstBuffer oatfile_buffer{oat_file_contents.get(), oat_file_size};
+  ConstBuffer oatfile_buffer{
+      reinterpret_cast<const char*>(oat_file_map->begin()), oat_file_size};
   auto ma_scope = MemoryAccounter::NewScope(oatfile_buffer);
 
   CHECK(oatfile_buffer.len > 4);
@@ -270,6 +289,9 @@ int dump(const Arguments& args) {
       kVdexMagicNum) {
     auto vdexfile = VdexFile::parse(oatfile_buffer);
     vdexfile->print();
+    if (args.verify_dex_checksums && !vdexfile->verify_dex_checksums()) {
+      return 1;
+    }
     return 0;
   }
   auto oatfile =
@@ -291,6 +313,10 @@ int dump(const Arguments& args) {
     cur_ma()->print();
   }
 
+  if (args.verify_dex_checksums && !oatfile->verify_dex_checksums()) {
+    return 1;
+  }
+
   return oatfile->status() == OatFile::Status::PARSE_SUCCESS ? 0 : 1;
 }
 
@@ -63,6 +63,9 @@ class MemoryAccounterImpl : public MemoryAccounter {
       printf("  no unconsumed memory found\n");
     }
 
+    // prev.end is the furthest end seen so far, so that a range nested inside
+    // an earlier, larger one doesn't make the tail of that one look
+    // unconsumed.
     for (const auto& cur : consumed_ranges_) {
       if (prev.end < cur.begin) {
         printf("  unconsumed memory in range 0x%08x to 0x%08x\n",
@@ -72,9 +75,10 @@ class MemoryAccounterImpl : public MemoryAccounter {
       if (cur.begin < prev.end) {
         printf("  double consumed memory in range 0x%08x to 0x%08x\n",
                cur.begin,
-               prev.end);
+               std::min(prev.end, cur.end));
       }
-      prev = cur;
+      prev.begin = cur.begin;
+      prev.end = std::max(prev.end, cur.end);
     }
   }
 
@@ -129,6 +133,15 @@ class MemoryAccounterImpl : public MemoryAccounter {
   void markRangeImpl(uint32_t begin, uint32_t end) {
     CHECK(begin <= end);
     CHECK(end <= buf_.len);
+    // Most parsing is sequential, so extend the last range when the new one
+    // directly follows it instead of recording one range per read.
+    if (!consumed_ranges_.empty()) {
+      auto& last = consumed_ranges_.back();
+      if (last.end == begin && last.begin < last.end) {
+        last.end = end;
+        return;
+      }
+    }
     consumed_ranges_.emplace_back(begin, end);
   }
 };
@@ -162,8 +175,7 @@ void MultiBufferMemoryAccounter::memcpyAndMark(void* dest,
                                                size_t count) {
   for (auto& a : accounters_) {
     auto ptr = a.buf_.ptr;
-    char* dst_ptr = reinterpret_cast<char*>(dest);
-    if (ptr <= dest && dest <= dst_ptr + count) {
+    if (ptr <= src && src + count <= ptr + a.buf_.len) {
       a.memcpyAndMark(dest, src, count);
       return;
     }
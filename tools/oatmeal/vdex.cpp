@@ -60,3 +60,11 @@ void VdexFile::print() const {
     index++;
   }
 }
+
+bool VdexFile::verify_dex_checksums() const {
+  // Parsing stops at the first dex file with a bad magic number, after
+  // recording its header.
+  std::vector<DexFileHeader> headers(dex_headers_.begin(),
+                                     dex_headers_.begin() + dexes_.size());
+  return ::verify_dex_checksums(headers, dexes_);
+}
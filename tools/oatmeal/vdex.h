@@ -65,6 +65,7 @@ class VdexFile {
 
   static std::unique_ptr<VdexFile> parse(ConstBuffer buf);
   void print() const;
+  bool verify_dex_checksums() const;
 
  private:
   VdexFile(VdexFileHeader& header, ConstBuffer buf);
@@ -6,6 +6,7 @@
  */
 
 #include "json/value.h"
+#include <algorithm>
 #include <boost/thread/thread.hpp>
 #include <cinttypes>
 #include <cstring>
@@ -108,6 +109,8 @@ struct Arguments {
   // command line arguments. For development usage
   Json::Value entry_data;
   boost::optional<int> stop_pass_idx;
+  // The checkpoint to resume from, if any.
+  std::string resume_checkpoint_dir;
   RedexOptions redex_options;
   bool properties_check{false};
   bool properties_check_allow_disabled{false};
@@ -182,6 +185,39 @@ bool add_value_to_config(Json::Value& config,
   return true;
 }
 
+// Turns off what only matters for release builds: the global orderings of
+// the output, whole-program checks between passes, and the expensive register
+// allocation. Dexes are written concurrently. Values given with -S and -J
+// still take precedence.
+void apply_fast_dev_config(Json::Value& config, RedexOptions& options) {
+  config.removeMember("string_sort_mode");
+  config.removeMember("bytecode_sort_mode");
+  config.removeMember("bytecode_sort_mode_candidates");
+  config["method_similarity_order"]["disable"] = true;
+  config["dex_output"]["startup_data_first"] = false;
+  config["dex_output"]["pack_startup_code_pages"] = false;
+  config["dex_output_threads"] =
+      Json::UInt(std::max(1u, boost::thread::hardware_concurrency()));
+
+  config["RegAllocPass"]["linear_scan_all_methods"] = true;
+
+  // The type checker still runs on the final code.
+  auto& type_checker = config["ir_type_checker"];
+  type_checker["run_on_input"] = false;
+  type_checker["run_after_each_pass"] = false;
+  type_checker["run_after_passes"] = Json::arrayValue;
+  type_checker["check_classes"] = false;
+  for (const auto* name : {"assessor", "check_unique_deobfuscated_names"}) {
+    config[name]["run_initially"] = false;
+    config[name]["run_after_each_pass"] = false;
+    config[name]["run_finally"] = false;
+  }
+  config["hasher"]["run_after_each_pass"] = false;
+  config["pass_manager"]["check_properties_deep"] = false;
+  config["slow_invariants_debug"] = false;
+  options.disable_dex_hasher = true;
+}
+
 Json::Value default_config() {
   const auto passes = {
       "ReBindRefsPass",   "BridgeSynthInlinePass", "FinalInlinePassV2",
@@ -383,6 +419,12 @@ Arguments parse_args(int argc, char* argv[]) {
       po::bool_switch(&args.redex_options.disable_dex_hasher)
           ->default_value(false),
       "If specified, states that the current run disables dex hasher.\n");
+  od.add_options()(
+      "fast-dev",
+      "Trade output quality for a quicker build while iterating locally.\n"
+      "  \tSkips the global string and code orderings and the checks between "
+      "passes, allocates registers with linear scan, and writes dexes "
+      "concurrently.");
   od.add_options()(
       "arch,A",
       po::value<std::vector<std::string>>(),
@@ -424,6 +466,10 @@ Arguments parse_args(int argc, char* argv[]) {
                    "Stop before pass n and output IR to file");
   od.add_options()("output-ir", po::value<std::string>(),
                    "IR output directory, used with --stop-pass");
+  od.add_options()("resume-from-checkpoints", po::value<std::string>(),
+                   "Directory of the checkpoints of an earlier run (its "
+                   "output directory's checkpoints/), to resume from the "
+                   "latest one before --stop-pass or the end");
   od.add_options()("jni-summary",
                    po::value<std::string>(),
                    "Path to JNI summary directory of json files.");
@@ -577,6 +623,10 @@ Arguments parse_args(int argc, char* argv[]) {
     }
   }
 
+  if (vm.count("fast-dev")) {
+    apply_fast_dev_config(args.config, args.redex_options);
+  }
+
   if (vm.count("-S")) {
     for (auto& key_value : vm["-S"].as<std::vector<std::string>>()) {
       if (!add_value_to_config(args.config, key_value, false)) {
@@ -632,6 +682,21 @@ Arguments parse_args(int argc, char* argv[]) {
     }
   }
 
+  if (vm.count("resume-from-checkpoints")) {
+    auto checkpoints_dir = vm["resume-from-checkpoints"].as<std::string>();
+    size_t max_pass_idx = args.stop_pass_idx != boost::none
+                              ? *args.stop_pass_idx
+                              : args.config["redex"]["passes"].size();
+    auto checkpoint = redex::find_checkpoint(checkpoints_dir, max_pass_idx);
+    if (checkpoint) {
+      std::cerr << "Resuming from " << checkpoint->second << std::endl;
+      args.resume_checkpoint_dir = checkpoint->second;
+    } else {
+      std::cerr << "warning: no checkpoint in " << checkpoints_dir
+                << ", running all passes" << std::endl;
+    }
+  }
+
   std::string metafiles = args.out_dir + "/meta/";
   int status = [&metafiles]() -> int {
 #if !IS_WINDOWS
@@ -693,6 +758,14 @@ Json::Value get_stats(const dex_stats_t& stats) {
 
   val["instruction_bytes"] = stats.instruction_bytes;
 
+  val["num_code_sort_candidate_wins"] = stats.num_code_sort_candidate_wins;
+  val["code_estimated_deflated_bytes"] = stats.code_estimated_deflated_bytes;
+  val["code_estimated_deflated_savings"] =
+      stats.code_estimated_deflated_savings;
+  val["num_startup_pages"] = stats.num_startup_pages;
+  val["num_startup_code_page_crossings"] =
+      stats.num_startup_code_page_crossings;
+
   val["header_item_count"] = stats.header_item_count;
   val["header_item_bytes"] = stats.header_item_bytes;
   val["string_id_count"] = stats.string_id_count;
@@ -784,6 +857,16 @@ Json::Value get_lowering_stats(const instruction_lowering::Stats& stats) {
 
   Json::Value obj(Json::ValueType::objectValue);
   obj["num_2addr_instructions"] = Json::UInt(stats.to_2addr);
+  obj["num_binop_instructions"] = Json::UInt(stats.binops);
+  if (stats.binops > 0) {
+    obj["2addr_percent"] = Json::UInt(stats.to_2addr * 100 / stats.binops);
+  }
+  obj["num_register_instructions"] = Json::UInt(stats.reg_insns);
+  obj["num_4bit_register_instructions"] = Json::UInt(stats.compact_reg_insns);
+  if (stats.reg_insns > 0) {
+    obj["4bit_register_percent"] =
+        Json::UInt(stats.compact_reg_insns * 100 / stats.reg_insns);
+  }
   obj["num_move_added_for_check_cast"] = Json::UInt(stats.move_for_check_cast);
 
   if (!stats.sparse_switches.data.empty()) {
@@ -1086,6 +1169,8 @@ void process_proguard_rules(ConfigFiles& conf,
     proguard_rule_recorder.record_accessed_rules(
         conf.metafile("redex-used-proguard-rules.txt"),
         conf.metafile("redex-unused-proguard-rules.txt"));
+    proguard_rule_recorder.record_rule_match_times(
+        conf.metafile("redex-proguard-rule-match-times.txt"));
   }
   if (unused_rule_abort) {
     std::vector<std::string> unused_out;
@@ -1113,17 +1198,27 @@ void process_proguard_rules(ConfigFiles& conf,
 void load_library_jars(Arguments& args,
                        Scope& external_classes,
                        const std::set<std::string>& library_jars,
-                       const std::string& base_dir) {
+                       const std::string& base_dir,
+                       analysis_cache::PersistentAnalysisCache* cache) {
   args.entry_data["jars"] = Json::arrayValue;
   if (library_jars.empty()) {
     return;
   }
 
   auto load = [&](const auto& allowed_fn) {
+    // With an analysis cache, the classes of library jars are only parsed
+    // again when the jars change.
+    auto load_jar = [&](const std::string& path, Scope* classes) {
+      auto* location = DexLocation::make_location("", path);
+      if (cache != nullptr) {
+        return load_jar_file_cached(location, *cache, classes, allowed_fn);
+      }
+      return load_jar_file(location, classes, /*attr_hook=*/nullptr,
+                           allowed_fn);
+    };
     for (const auto& library_jar : library_jars) {
       TRACE(MAIN, 1, "LIBRARY JAR: %s", library_jar.c_str());
-      if (load_jar_file(DexLocation::make_location("", library_jar),
-                        &external_classes, /*attr_hook=*/nullptr, allowed_fn)) {
+      if (load_jar(library_jar, &external_classes)) {
         auto abs_path = boost::filesystem::absolute(library_jar);
         args.entry_data["jars"].append(abs_path.string());
         continue;
@@ -1131,9 +1226,7 @@ void load_library_jars(Arguments& args,
 
       // Try again with the basedir
       std::string basedir_path = base_dir + "/" + library_jar;
-      if (load_jar_file(DexLocation::make_location("", basedir_path),
-                        /*classes=*/nullptr, /*attr_hook=*/nullptr,
-                        allowed_fn)) {
+      if (load_jar(basedir_path, /*classes=*/nullptr)) {
         args.entry_data["jars"].append(basedir_path);
         continue;
       }
@@ -1181,10 +1274,10 @@ void redex_frontend(ConfigFiles& conf, /* input */
   g_redex->load_pointers_cache();
 
   keep_rules::proguard_parser::Stats parser_stats{};
-  for (const auto& pg_config_path : args.proguard_config_paths) {
-    Timer time_pg_parsing("Parsed ProGuard config file");
-    parser_stats +=
-        keep_rules::proguard_parser::parse_file(pg_config_path, &pg_config);
+  {
+    Timer time_pg_parsing("Parsed ProGuard config files");
+    parser_stats = keep_rules::proguard_parser::parse_files(
+        args.proguard_config_paths, &pg_config);
   }
 
   size_t blocklisted_rules{0};
@@ -1275,14 +1368,19 @@ void redex_frontend(ConfigFiles& conf, /* input */
     Timer t("Load classes from dexes");
     dex_stats_t input_totals;
     std::vector<dex_stats_t> input_dexes_stats;
-    redex::load_classes_from_dexes_and_metadata(
-        args.dex_files, stores, input_totals, input_dexes_stats);
+    if (!args.resume_checkpoint_dir.empty()) {
+      redex::load_checkpoint_classes(args.resume_checkpoint_dir, stores,
+                                     input_totals, input_dexes_stats);
+    } else {
+      redex::load_classes_from_dexes_and_metadata(
+          args.dex_files, stores, input_totals, input_dexes_stats);
+    }
     stats["input_stats"] = get_input_stats(input_totals, input_dexes_stats);
   });
 
   Scope external_classes;
   load_library_jars(args, external_classes, library_jars,
-                    pg_config.basedirectory);
+                    pg_config.basedirectory, conf.get_analysis_cache());
 
   {
     Timer t("Deobfuscating dex elements");
@@ -1367,8 +1465,7 @@ void finalize_resource_table(ConfigFiles& conf) {
   res_table->finalize_resource_table(*global_resources_config);
 }
 
-void collect_classes_for_full_json(const DexStore& store,
-                                   Json::Value* full_map_root) {
+Json::Value collect_classes_for_full_json(const DexStore& store) {
   Json::Value store_entry;
 
   Json::Value classes_entry;
@@ -1405,8 +1502,7 @@ void collect_classes_for_full_json(const DexStore& store,
     deps_entry.append(dep);
   }
   store_entry["dependencies"] = std::move(deps_entry);
-
-  (*full_map_root)[store.get_name()] = std::move(store_entry);
+  return store_entry;
 }
 
 /**
@@ -1491,52 +1587,60 @@ void redex_backend(ConfigFiles& conf,
     auto min_sdk = manager.get_redex_options().min_sdk;
     ScopedMemStats wod_mem_stats{mem_stats_enabled, reset_hwm};
     Json::Value full_json_root{Json::ValueType::objectValue};
-    constexpr const char* kJsonTimerName =
-        "Collecting full-rename-map-json data";
-    AccumulatingTimer json_timer{kJsonTimerName};
+    std::vector<std::vector<SortMode>> code_sort_modes;
+    code_sort_modes.reserve(stores.size());
+    std::vector<DexOutputJob> jobs;
     for (size_t store_number = 0; store_number < stores.size();
          ++store_number) {
       auto& store = stores[store_number];
-      const auto& store_name = store.get_name();
-      auto code_sort_mode = get_code_sort_mode(conf, store_name);
-      Timer t("Writing optimized dexes");
+      code_sort_modes.push_back(get_code_sort_mode(conf, store.get_name()));
       for (size_t i = 0; i < store.get_dexen().size(); i++) {
-        DexClasses* classes = &store.get_dexen()[i];
-        auto gtypes = std::make_shared<GatheredTypes>(classes);
-
-        auto this_dex_stats = write_classes_to_dex(
-            redex::get_dex_output_name(output_dir, store, i),
-            classes,
-            gtypes,
-            store_number,
-            &store_name,
-            i,
-            conf,
-            pos_mapper.get(),
-            redex_options.debug_info_kind,
-            needs_addresses ? &method_to_id : nullptr,
-            needs_addresses ? &code_debug_lines : nullptr,
-            is_iodi(dik) ? &iodi_metadata : nullptr,
-            dex_magic,
-            dex_output_config,
-            min_sdk,
-            code_sort_mode,
-            string_sort_mode);
-
-        output_totals += this_dex_stats;
-        // Remove class sizes here to free up memory.
-        this_dex_stats.class_size.clear();
-        signatures.insert(
-            *reinterpret_cast<uint32_t*>(this_dex_stats.signature));
-        output_dexes_stats.push_back(
-            std::make_pair(store.get_name(), std::move(this_dex_stats)));
+        jobs.push_back({redex::get_dex_output_name(output_dir, store, i),
+                        &store.get_dexen()[i], store_number, &store.get_name(),
+                        i, &code_sort_modes.back()});
       }
-      {
-        auto timer_scope = json_timer.scope();
-        collect_classes_for_full_json(store, &full_json_root);
+    }
+    // Dexes are identical regardless of the number of concurrent writers,
+    // but each one holds an output buffer for the dex.
+    size_t dex_output_threads;
+    conf.get_json_config().get("dex_output_threads", size_t(1),
+                               dex_output_threads);
+    std::vector<enhanced_dex_stats_t> dexes_stats;
+    {
+      Timer t("Writing optimized dexes");
+      dexes_stats = write_classes_to_dexes(
+          jobs, conf, pos_mapper.get(), redex_options.debug_info_kind,
+          needs_addresses ? &method_to_id : nullptr,
+          needs_addresses ? &code_debug_lines : nullptr,
+          is_iodi(dik) ? &iodi_metadata : nullptr, dex_magic,
+          dex_output_config, min_sdk, string_sort_mode, dex_output_threads);
+    }
+    for (size_t i = 0; i < jobs.size(); i++) {
+      auto& this_dex_stats = dexes_stats[i];
+      output_totals += this_dex_stats;
+      // Remove class sizes here to free up memory.
+      this_dex_stats.class_size.clear();
+      signatures.insert(*reinterpret_cast<uint32_t*>(this_dex_stats.signature));
+      output_dexes_stats.push_back(
+          std::make_pair(*jobs[i].store_name, std::move(this_dex_stats)));
+    }
+    {
+      Timer t("Collecting full-rename-map-json data");
+      std::vector<DexStore*> json_stores;
+      for (auto& store : stores) {
+        json_stores.push_back(&store);
+      }
+      // Stores are independent, so their entries are built concurrently and
+      // then added in store order.
+      std::vector<Json::Value> store_entries(stores.size());
+      run_on_stores_in_parallel(json_stores, [&](DexStore& store) {
+        store_entries[&store - stores.data()] =
+            collect_classes_for_full_json(store);
+      });
+      for (size_t i = 0; i < stores.size(); i++) {
+        full_json_root[stores[i].get_name()] = std::move(store_entries[i]);
       }
     }
-    Timer::add_timer(kJsonTimerName, json_timer.get_seconds());
     wod_mem_stats.trace_log("Writing optimized dexes");
 
     {
@@ -1795,6 +1899,7 @@ int main(int argc, char* argv[]) {
       concurrent_container_destruction_scope;
 
   std::string stats_output_path;
+  std::string timeline_output_path;
   Json::Value stats;
   double cpu_time_s;
   {
@@ -1818,6 +1923,10 @@ int main(int argc, char* argv[]) {
       return check_pass_properties(args);
     }
 
+    if (!args.config.get("timeline_output", "").asString().empty()) {
+      Timeline::enable();
+    }
+
     keep_reason::Reason::set_record_keep_reasons(
         args.config.get("record_keep_reasons", false).asBool());
 
@@ -1887,6 +1996,17 @@ int main(int argc, char* argv[]) {
         conf, redex_properties::PropertyCheckerRegistry::get().get_checkers());
     PassManager manager(passes, std::move(pg_config), conf, args.redex_options,
                         &props_manager);
+    manager.set_checkpoint_writer([&args](DexStoresVector& stores,
+                                          ConfigFiles& conf,
+                                          const PassManager& mgr,
+                                          size_t pass_idx) {
+      redex::write_checkpoint(conf, args.out_dir + "/checkpoints",
+                              args.redex_options, stores, mgr, pass_idx);
+    });
+    if (!args.resume_checkpoint_dir.empty()) {
+      redex::load_checkpoint_state(args.resume_checkpoint_dir, stores,
+                                   manager);
+    }
 
     {
       Timer t("Running optimization passes");
@@ -1911,6 +2031,10 @@ int main(int argc, char* argv[]) {
 
     stats_output_path = conf.metafile(
         args.config.get("stats_output", "redex-stats.txt").asString());
+    if (Timeline::enabled()) {
+      timeline_output_path =
+          conf.metafile(args.config.get("timeline_output", "").asString());
+    }
 
     {
       Timer t("Freeing global memory");
@@ -1937,6 +2061,11 @@ int main(int argc, char* argv[]) {
     out << stats;
   }
 
+  if (!timeline_output_path.empty()) {
+    std::ofstream out(timeline_output_path);
+    Timeline::write(out);
+  }
+
   TRACE(MAIN, 1, "Done.");
   if (traceEnabled(MAIN, 1) || traceEnabled(STATS, 1)) {
     TRACE(STATS, 0, "Memory stats: VmPeak=%s VmHWM=%s",
@@ -0,0 +1,370 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * Benchmarks one pass, or a range of passes, on a recorded scope: the dex and
+ * IR meta directory that redex-all writes with --stop-pass and --output-ir,
+ * and that redex-opt reads with --input-ir.
+ *
+ * Every run reloads the scope into a fresh RedexContext, so that all runs see
+ * the same input, and then times PassManager::run_passes only. The first
+ * --warmup runs are discarded. For the measured runs, this prints the wall
+ * time, the CPU time, the CPU utilization of the worker threads and the peak
+ * resident set size, followed by the medians.
+ *
+ * The medians can be written to a baseline JSON file with --write-baseline
+ * and checked against one with --baseline, in which case the exit code is 1
+ * when the wall time, the CPU time or the peak memory grew by more than
+ * --tolerance percent.
+ */
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <json/json.h>
+#include <sys/resource.h>
+
+#include "DebugUtils.h"
+#include "DexClass.h"
+#include "DexLoader.h"
+#include "PassManager.h"
+#include "PassRegistry.h"
+#include "RedexContext.h"
+#include "ToolsCommon.h"
+#include "WorkQueue.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Arguments {
+  std::string input_ir_dir;
+  std::string output_dir;
+  std::string config_file;
+  std::vector<std::string> pass_names;
+  std::string first_pass;
+  std::string last_pass;
+  size_t runs{5};
+  size_t warmup{1};
+  std::string baseline;
+  std::string write_baseline;
+  double tolerance{10};
+};
+
+struct Sample {
+  double wall_seconds{0};
+  double cpu_seconds{0};
+  uint64_t peak_rss_bytes{0};
+};
+
+Arguments parse_args(int argc, char* argv[]) {
+  namespace po = boost::program_options;
+  po::options_description desc(
+      "Benchmark passes on a recorded dex and IR meta directory");
+  desc.add_options()("help,h", "produce help message");
+  desc.add_options()("input-ir,i", po::value<std::string>(),
+                     "input dex and IR meta directory");
+  desc.add_options()("output-dir,o",
+                     po::value<std::string>(),
+                     "directory for the files written by the passes "
+                     "(default: a temporary directory)");
+  desc.add_options()("config,c",
+                     po::value<std::string>(),
+                     "A JSON-formatted config file to replace the one from "
+                     "{input-ir}/entry.json");
+  desc.add_options()("pass-name,p", po::value<std::vector<std::string>>(),
+                     "pass to run, may be repeated");
+  desc.add_options()("first-pass",
+                     po::value<std::string>(),
+                     "run the passes of the config starting with this one");
+  desc.add_options()("last-pass",
+                     po::value<std::string>(),
+                     "run the passes of the config up to and including this "
+                     "one");
+  desc.add_options()("runs,n", po::value<size_t>(), "measured runs (5)");
+  desc.add_options()("warmup,w", po::value<size_t>(), "discarded runs (1)");
+  desc.add_options()("baseline,b",
+                     po::value<std::string>(),
+                     "baseline JSON file to compare against");
+  desc.add_options()("write-baseline",
+                     po::value<std::string>(),
+                     "write the measured medians to this JSON file");
+  desc.add_options()("tolerance,t",
+                     po::value<double>(),
+                     "allowed regression against the baseline, in percent "
+                     "(10)");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    desc.print(std::cout);
+    exit(EXIT_SUCCESS);
+  }
+
+  Arguments args;
+  if (!vm.count("input-ir")) {
+    std::cerr << "input-ir is required\n";
+    exit(EXIT_FAILURE);
+  }
+  args.input_ir_dir = vm["input-ir"].as<std::string>();
+  if (vm.count("output-dir")) {
+    args.output_dir = vm["output-dir"].as<std::string>();
+  } else {
+    args.output_dir = (boost::filesystem::temp_directory_path() /
+                       boost::filesystem::unique_path("redex-pass-bench-%%%%"))
+                          .string();
+  }
+  boost::filesystem::create_directories(args.output_dir + "/meta");
+  if (vm.count("config")) {
+    args.config_file = vm["config"].as<std::string>();
+  }
+  if (vm.count("pass-name")) {
+    args.pass_names = vm["pass-name"].as<std::vector<std::string>>();
+  }
+  if (vm.count("first-pass")) {
+    args.first_pass = vm["first-pass"].as<std::string>();
+  }
+  if (vm.count("last-pass")) {
+    args.last_pass = vm["last-pass"].as<std::string>();
+  }
+  if (!args.pass_names.empty() &&
+      (!args.first_pass.empty() || !args.last_pass.empty())) {
+    std::cerr << "pass-name cannot be combined with first-pass/last-pass\n";
+    exit(EXIT_FAILURE);
+  }
+  if (vm.count("runs")) {
+    args.runs = std::max<size_t>(vm["runs"].as<size_t>(), 1);
+  }
+  if (vm.count("warmup")) {
+    args.warmup = vm["warmup"].as<size_t>();
+  }
+  if (vm.count("baseline")) {
+    args.baseline = vm["baseline"].as<std::string>();
+  }
+  if (vm.count("write-baseline")) {
+    args.write_baseline = vm["write-baseline"].as<std::string>();
+  }
+  if (vm.count("tolerance")) {
+    args.tolerance = vm["tolerance"].as<double>();
+  }
+  return args;
+}
+
+/**
+ * The passes to run: either the ones given with --pass-name, or the slice of
+ * the config's pass list selected with --first-pass and --last-pass.
+ */
+Json::Value select_passes(const Json::Value& config_passes,
+                          const Arguments& args) {
+  Json::Value passes = Json::arrayValue;
+  if (!args.pass_names.empty()) {
+    for (const auto& name : args.pass_names) {
+      passes.append(name);
+    }
+    return passes;
+  }
+  bool in_range = args.first_pass.empty();
+  bool found_last = false;
+  for (const auto& pass : config_passes) {
+    if (!in_range && pass.asString() == args.first_pass) {
+      in_range = true;
+    }
+    if (in_range) {
+      passes.append(pass);
+    }
+    if (in_range && pass.asString() == args.last_pass) {
+      found_last = true;
+      break;
+    }
+  }
+  if (!in_range || (!args.last_pass.empty() && !found_last)) {
+    std::cerr << "pass range not found in the config's pass list\n";
+    exit(EXIT_FAILURE);
+  }
+  return passes;
+}
+
+double cpu_seconds() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  auto to_seconds = [](const timeval& tv) {
+    return tv.tv_sec + tv.tv_usec / 1e6;
+  };
+  return to_seconds(usage.ru_utime) + to_seconds(usage.ru_stime);
+}
+
+Sample run_once(const Arguments& args,
+                const Json::Value& entry_data,
+                const Json::Value& config_data) {
+  g_redex = new RedexContext();
+
+  DexStoresVector stores;
+  Json::Value loaded_entry_data;
+  redex::load_all_intermediate(args.input_ir_dir, stores, &loaded_entry_data);
+  if (!stores.empty()) {
+    auto first_dex_path = boost::filesystem::path(args.input_ir_dir) /
+                          entry_data["dex_list"][0]["list"][0].asString();
+    auto location = DexLocation::make_location("dex", first_dex_path.string());
+    stores[0].set_dex_magic(load_dex_magic_from_dex(location));
+  }
+
+  RedexOptions redex_options;
+  redex_options.deserialize(entry_data);
+  Sample sample;
+  {
+    ConfigFiles conf(config_data, args.output_dir);
+    const auto& passes = PassRegistry::get().get_passes();
+    PassManager manager(passes, conf, redex_options);
+    manager.set_testing_mode();
+
+    try_reset_hwm_mem_stat();
+    auto cpu_start = cpu_seconds();
+    auto wall_start = Clock::now();
+    manager.run_passes(stores, conf);
+    sample.wall_seconds =
+        std::chrono::duration<double>(Clock::now() - wall_start).count();
+    sample.cpu_seconds = cpu_seconds() - cpu_start;
+    sample.peak_rss_bytes = get_mem_stats().vm_hwm;
+  }
+
+  stores.clear();
+  delete g_redex;
+  g_redex = nullptr;
+  return sample;
+}
+
+template <typename T>
+T median(std::vector<T> values) {
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+void print_sample(const std::string& label,
+                  const Sample& sample,
+                  size_t num_threads) {
+  double utilization =
+      sample.wall_seconds > 0
+          ? 100 * sample.cpu_seconds / (sample.wall_seconds * num_threads)
+          : 0;
+  printf("%-8s wall %9.3fs  cpu %9.3fs  util/thread %5.1f%%  "
+         "peak rss %8.1fMB\n",
+         label.c_str(), sample.wall_seconds, sample.cpu_seconds, utilization,
+         sample.peak_rss_bytes / (1024.0 * 1024.0));
+}
+
+Json::Value to_json(const Sample& sample, const Json::Value& passes) {
+  Json::Value json;
+  json["passes"] = passes;
+  json["wall_seconds"] = sample.wall_seconds;
+  json["cpu_seconds"] = sample.cpu_seconds;
+  json["peak_rss_bytes"] = Json::UInt64(sample.peak_rss_bytes);
+  return json;
+}
+
+/**
+ * Returns false if any metric of `sample` exceeds the baseline by more than
+ * `tolerance` percent.
+ */
+bool check_baseline(const Sample& sample,
+                    const Json::Value& baseline,
+                    double tolerance) {
+  bool ok = true;
+  auto check = [&](const char* name, double value) {
+    if (!baseline.isMember(name)) {
+      return;
+    }
+    double base = baseline[name].asDouble();
+    double change = base > 0 ? 100 * (value - base) / base : 0;
+    bool regressed = change > tolerance;
+    printf("%-16s baseline %14.3f  now %14.3f  %+6.1f%%%s\n", name, base, value,
+           change, regressed ? "  REGRESSION" : "");
+    ok &= !regressed;
+  };
+  check("wall_seconds", sample.wall_seconds);
+  check("cpu_seconds", sample.cpu_seconds);
+  check("peak_rss_bytes", sample.peak_rss_bytes);
+  return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  Arguments args = parse_args(argc, argv);
+
+  Json::Value entry_data;
+  {
+    std::ifstream entry_file(args.input_ir_dir + "/entry.json");
+    if (!entry_file) {
+      std::cerr << "cannot read " << args.input_ir_dir << "/entry.json\n";
+      return EXIT_FAILURE;
+    }
+    entry_file >> entry_data;
+  }
+  if (!args.config_file.empty()) {
+    entry_data["config"] = args.config_file;
+  }
+  Json::Value config_data =
+      redex::parse_config(entry_data["config"].asString());
+  if (entry_data.isMember("apk_dir")) {
+    config_data["apk_dir"] = entry_data["apk_dir"].asString();
+  }
+  Json::Value passes = select_passes(config_data["redex"]["passes"], args);
+  config_data["redex"]["passes"] = passes;
+
+  size_t num_threads = redex_parallel::default_num_threads();
+  printf("Benchmarking %u pass(es) on %s with %zu thread(s)\n",
+         passes.size(), args.input_ir_dir.c_str(), num_threads);
+
+  std::vector<Sample> samples;
+  for (size_t i = 0; i < args.warmup + args.runs; ++i) {
+    auto sample = run_once(args, entry_data, config_data);
+    bool is_warmup = i < args.warmup;
+    auto label =
+        is_warmup ? "warmup" : "run " + std::to_string(i - args.warmup);
+    print_sample(label, sample, num_threads);
+    if (!is_warmup) {
+      samples.push_back(sample);
+    }
+  }
+
+  std::vector<double> walls;
+  std::vector<double> cpus;
+  std::vector<uint64_t> rss;
+  for (const auto& sample : samples) {
+    walls.push_back(sample.wall_seconds);
+    cpus.push_back(sample.cpu_seconds);
+    rss.push_back(sample.peak_rss_bytes);
+  }
+  Sample result{median(walls), median(cpus), median(rss)};
+  print_sample("median", result, num_threads);
+
+  if (!args.write_baseline.empty()) {
+    std::ofstream out(args.write_baseline);
+    out << to_json(result, passes);
+  }
+
+  if (!args.baseline.empty()) {
+    Json::Value baseline;
+    std::ifstream in(args.baseline);
+    if (!(in >> baseline)) {
+      std::cerr << "cannot read baseline " << args.baseline << "\n";
+      return EXIT_FAILURE;
+    }
+    if (baseline["passes"] != passes) {
+      std::cerr << "warning: the baseline was recorded for other passes\n";
+    }
+    if (!check_baseline(result, baseline, args.tolerance)) {
+      return 1;
+    }
+  }
+  return 0;
+}
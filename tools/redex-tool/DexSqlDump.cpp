@@ -19,9 +19,16 @@ $ sqlite3 dex.db "SELECT COUNT(*) FROM dex;"   # verify sane-looking value
 $ ./native/redex/tools/redex-tool/DexSqlQuery.py dex.db
 <..enter queries..>
 
+For large apps, `--format csv --output <DIR>` writes one CSV file per table
+instead, plus a `<DIR>/load.sql` script that creates the tables and bulk
+loads the files through the sqlite3 shell's `.import`:
+
+$ sqlite3 dex.db < <DIR>/load.sql
+
 */
 
-#include <boost/algorithm/string/replace.hpp>
+#include <initializer_list>
+#include <map>
 #include <queue>
 #include <unordered_map>
 #include <vector>
@@ -34,6 +41,7 @@ $ ./native/redex/tools/redex-tool/DexSqlQuery.py dex.db
 #include "Show.h"
 #include "Tool.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -42,163 +50,7 @@ static std::unordered_map<DexMethod*, int> method_ids;
 static std::unordered_map<DexField*, int> field_ids;
 static std::unordered_map<const DexString*, int> string_ids;
 
-void dump_field_refs(FILE* fdout,
-                     const char* prefix,
-                     DexField* field,
-                     int field_id) {
-  static int next_string_ref = 0;
-  auto* static_value = field->get_static_value();
-  if (!static_value || (static_value->evtype() != DEVT_STRING)) return;
-  auto* static_string_value = static_cast<DexEncodedValueString*>(static_value);
-  auto string_id = string_ids[static_string_value->string()];
-  fprintf(fdout,
-          "INSERT INTO %sfield_string_refs VALUES (%d, %d, %d);\n",
-          prefix,
-          next_string_ref++,
-          field_id,
-          string_id);
-}
-
-void dump_method_refs(FILE* fdout,
-                      const char* prefix,
-                      DexMethod* method,
-                      int method_id) {
-  auto code = method->get_code();
-  if (!code) return;
-
-  static int next_string_ref = 0;
-  static int next_class_ref = 0;
-  static int next_field_ref = 0;
-  static int next_method_ref = 0;
-
-  for (auto& mie : InstructionIterable(code)) {
-    auto insn = mie.insn;
-    if (insn->has_string()) {
-      if (string_ids.count(insn->get_string())) {
-        auto string_id = string_ids[insn->get_string()];
-        fprintf(fdout,
-                "INSERT INTO %smethod_string_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_string_ref++,
-                method_id,
-                string_id,
-                insn->opcode());
-      }
-    }
-    if (insn->has_type()) {
-      auto cls = type_class(insn->get_type());
-      if (cls && class_ids.count(cls)) {
-        auto class_id = class_ids[cls];
-        fprintf(fdout,
-                "INSERT INTO %smethod_class_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_class_ref++,
-                method_id,
-                class_id,
-                insn->opcode());
-      }
-    }
-    if (insn->has_field()) {
-      auto field = resolve_field(insn->get_field());
-      if (field != nullptr && field_ids.count(field)) {
-        auto field_id = field_ids[field];
-        fprintf(fdout,
-                "INSERT INTO %smethod_field_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_field_ref++,
-                method_id,
-                field_id,
-                insn->opcode());
-      }
-    }
-    if (insn->has_method()) {
-      auto meth =
-          resolve_method(insn->get_method(), opcode_to_search(insn), method);
-      if (meth != nullptr && method_ids.count(meth)) {
-        auto method_ref_id = method_ids[meth];
-        fprintf(fdout,
-                "INSERT INTO %smethod_method_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_method_ref++,
-                method_id,
-                method_ref_id,
-                insn->opcode());
-      }
-    }
-  }
-}
-
-void dump_class(FILE* fdout,
-                const char* prefix,
-                const char* dex_id,
-                DexClass* cls,
-                int class_id) {
-  // TODO: annotations?
-  // TODO: inheritance?
-  // TODO: string usage
-  // TODO: size estimate
-  const auto& deobfuscated_name = cls->get_deobfuscated_name();
-  fprintf(fdout,
-          "INSERT INTO %sclasses VALUES (%d,'%s','%s','%s',%u);\n",
-          prefix,
-          class_id,
-          dex_id,
-          deobfuscated_name.c_str(),
-          cls->get_name()->c_str(),
-          cls->get_access());
-}
-
-void dump_field(FILE* fdout,
-                const char* prefix,
-                int class_id,
-                DexField* field,
-                int field_id) {
-  // TODO: more fixup here on this crapped up name/signature
-  // TODO: break down signature
-  // TODO: annotations?
-  // TODO: string usage (encoded_value for static fields)
-  const auto& deobfuscated_name = field->get_deobfuscated_name();
-  auto field_name = strchr(deobfuscated_name.c_str(), ';');
-  fprintf(fdout,
-          "INSERT INTO %sfields VALUES(%d, %d, '%s', '%s', %u);\n",
-          prefix,
-          field_id,
-          class_id,
-          field_name,
-          field->get_name()->c_str(),
-          field->get_access());
-}
-
-void dump_method(FILE* fdout,
-                 const char* prefix,
-                 int class_id,
-                 DexMethod* method,
-                 int method_id) {
-  // TODO: more fixup here on this crapped up name/signature
-  // TODO: break down signature
-  // TODO: throws?
-  // TODO: annotations?
-  // TODO: string usage
-  // TODO: size estimate
-  const auto& deobfuscated_name = method->get_deobfuscated_name();
-  auto method_name = strchr(deobfuscated_name.c_str(), ';');
-  fprintf(fdout,
-          "INSERT INTO %smethods VALUES (%d,%d,'%s','%s',%d,%zu);\n",
-          prefix,
-          method_id,
-          class_id,
-          method_name,
-          method->get_name()->c_str(),
-          method->get_access(),
-          method->get_code() ? method->get_code()->sum_opcode_sizes() : 0);
-}
-
-void dump_sql(FILE* fdout,
-              DexStoresVector& stores,
-              ProguardMap& pg_map,
-              const char* prefix) {
-  fprintf(fdout,
-          R"___(
+constexpr const char* SCHEMA = R"___(
 DROP TABLE IF EXISTS %1$sfield_string_refs;
 DROP TABLE IF EXISTS %1$smethod_string_refs;
 DROP TABLE IF EXISTS %1$smethod_field_refs;
@@ -269,15 +121,298 @@ CREATE TABLE %1$smethod_string_refs (
   ref_string_id INTEGER NOT NULL, -- fk:strings.id
   opcode INTEGER NOT NULL
 );
-)___",
-          prefix);
+)___";
+
+constexpr const char* TABLES[] = {
+    "classes",           "methods",           "is_a",
+    "strings",           "fields",            "field_string_refs",
+    "method_class_refs", "method_method_refs", "method_field_refs",
+    "method_string_refs",
+};
+
+/*
+ * A value in a row. Text values are quoted and escaped by the writer.
+ */
+struct Cell {
+  Cell(int64_t integer) : integer(integer) {}
+  Cell(const char* text) : text(text) {}
+  Cell(const std::string& text) : text(text.c_str()) {}
+
+  int64_t integer{0};
+  const char* text{nullptr};
+};
+
+/*
+ * Writes rows either as INSERT statements into a single SQL script, or as one
+ * CSV file per table, along with a script that creates the tables and bulk
+ * loads the files with the sqlite3 shell's `.import`.
+ */
+class RowWriter {
+ public:
+  RowWriter(FILE* sql_out, std::string prefix)
+      : m_sql_out(sql_out), m_prefix(std::move(prefix)) {}
+
+  RowWriter(std::string csv_dir, std::string prefix)
+      : m_csv_dir(std::move(csv_dir)), m_prefix(std::move(prefix)) {}
+
+  ~RowWriter() {
+    for (auto& [_, out] : m_csv_outs) {
+      fclose(out);
+    }
+  }
+
+  bool is_csv() const { return m_sql_out == nullptr; }
+
+  /*
+   * Creates the tables. In CSV mode, this writes `load.sql`, which also
+   * imports the CSV files of all tables.
+   */
+  void write_schema() {
+    if (!is_csv()) {
+      fprintf(m_sql_out, SCHEMA, m_prefix.c_str());
+      return;
+    }
+    std::string path = m_csv_dir + "/load.sql";
+    FILE* out = fopen(path.c_str(), "w");
+    if (!out) {
+      fprintf(stderr,
+              "Could not open %s for writing; terminating\n",
+              path.c_str());
+      exit(EXIT_FAILURE);
+    }
+    fprintf(out, SCHEMA, m_prefix.c_str());
+    for (const auto* table : TABLES) {
+      fprintf(out,
+              ".import --csv \"%s\" %s%s\n",
+              csv_path(table).c_str(),
+              m_prefix.c_str(),
+              table);
+    }
+    fclose(out);
+  }
+
+  void begin_transaction() {
+    if (!is_csv()) {
+      fprintf(m_sql_out, "BEGIN TRANSACTION;\n");
+    }
+  }
+
+  void end_transaction() {
+    if (!is_csv()) {
+      fprintf(m_sql_out, "END TRANSACTION;\n");
+    }
+  }
+
+  void row(const char* table, std::initializer_list<Cell> cells) {
+    m_buffer.clear();
+    if (!is_csv()) {
+      m_buffer += "INSERT INTO ";
+      m_buffer += m_prefix;
+      m_buffer += table;
+      m_buffer += " VALUES (";
+    }
+    bool first = true;
+    for (const auto& cell : cells) {
+      if (!first) {
+        m_buffer += ',';
+      }
+      first = false;
+      if (cell.text == nullptr) {
+        m_buffer += std::to_string(cell.integer);
+      } else if (is_csv()) {
+        append_quoted(cell.text, '"');
+      } else {
+        append_quoted(cell.text, '\'');
+      }
+    }
+    m_buffer += is_csv() ? "\n" : ");\n";
+    fwrite(m_buffer.data(), 1, m_buffer.size(), out(table));
+  }
+
+ private:
+  std::string csv_path(const char* table) const {
+    return m_csv_dir + "/" + m_prefix + table + ".csv";
+  }
+
+  FILE* out(const char* table) {
+    if (!is_csv()) {
+      return m_sql_out;
+    }
+    auto it = m_csv_outs.find(table);
+    if (it != m_csv_outs.end()) {
+      return it->second;
+    }
+    std::string path = csv_path(table);
+    FILE* out = fopen(path.c_str(), "w");
+    if (!out) {
+      fprintf(stderr,
+              "Could not open %s for writing; terminating\n",
+              path.c_str());
+      exit(EXIT_FAILURE);
+    }
+    m_csv_outs.emplace(table, out);
+    return out;
+  }
+
+  // Both SQL and CSV escape a quote character by doubling it.
+  void append_quoted(const char* text, char quote) {
+    m_buffer += quote;
+    for (const char* c = text; *c; c++) {
+      if (*c == quote) {
+        m_buffer += quote;
+      }
+      m_buffer += *c;
+    }
+    m_buffer += quote;
+  }
+
+  FILE* m_sql_out{nullptr};
+  std::string m_csv_dir;
+  std::string m_prefix;
+  std::map<std::string, FILE*> m_csv_outs;
+  std::string m_buffer;
+};
+
+void dump_field_refs(RowWriter& writer, DexField* field, int field_id) {
+  static int next_string_ref = 0;
+  auto* static_value = field->get_static_value();
+  if (!static_value || (static_value->evtype() != DEVT_STRING)) return;
+  auto* static_string_value = static_cast<DexEncodedValueString*>(static_value);
+  auto string_id = string_ids[static_string_value->string()];
+  writer.row("field_string_refs", {next_string_ref++, field_id, string_id});
+}
+
+enum MethodRefKind {
+  STRING_REF,
+  CLASS_REF,
+  FIELD_REF,
+  METHOD_REF,
+  NUM_METHOD_REF_KINDS,
+};
+
+constexpr const char* METHOD_REF_TABLES[] = {
+    "method_string_refs",
+    "method_class_refs",
+    "method_field_refs",
+    "method_method_refs",
+};
+
+struct MethodRef {
+  MethodRefKind kind;
+  int ref_id;
+  IROpcode opcode;
+};
+
+/*
+ * Resolves the references of a method's code. This only reads the id maps, so
+ * it runs in parallel over all methods.
+ */
+std::vector<MethodRef> collect_method_refs(DexMethod* method) {
+  std::vector<MethodRef> refs;
+  auto code = method->get_code();
+  if (!code) return refs;
+
+  for (auto& mie : InstructionIterable(code)) {
+    auto insn = mie.insn;
+    if (insn->has_string()) {
+      auto it = string_ids.find(insn->get_string());
+      if (it != string_ids.end()) {
+        refs.push_back({STRING_REF, it->second, insn->opcode()});
+      }
+    }
+    if (insn->has_type()) {
+      auto cls = type_class(insn->get_type());
+      auto it = cls ? class_ids.find(cls) : class_ids.end();
+      if (it != class_ids.end()) {
+        refs.push_back({CLASS_REF, it->second, insn->opcode()});
+      }
+    }
+    if (insn->has_field()) {
+      auto field = resolve_field(insn->get_field());
+      auto it = field != nullptr ? field_ids.find(field) : field_ids.end();
+      if (it != field_ids.end()) {
+        refs.push_back({FIELD_REF, it->second, insn->opcode()});
+      }
+    }
+    if (insn->has_method()) {
+      auto meth =
+          resolve_method(insn->get_method(), opcode_to_search(insn), method);
+      auto it = meth != nullptr ? method_ids.find(meth) : method_ids.end();
+      if (it != method_ids.end()) {
+        refs.push_back({METHOD_REF, it->second, insn->opcode()});
+      }
+    }
+  }
+  return refs;
+}
+
+void dump_method_refs(RowWriter& writer,
+                      const std::vector<MethodRef>& refs,
+                      int method_id) {
+  static int next_ref_ids[NUM_METHOD_REF_KINDS] = {0};
+  for (const auto& ref : refs) {
+    writer.row(METHOD_REF_TABLES[ref.kind],
+               {next_ref_ids[ref.kind]++, method_id, ref.ref_id, ref.opcode});
+  }
+}
+
+void dump_class(RowWriter& writer,
+                const char* dex_id,
+                DexClass* cls,
+                int class_id) {
+  // TODO: annotations?
+  // TODO: inheritance?
+  // TODO: string usage
+  // TODO: size estimate
+  const auto& deobfuscated_name = cls->get_deobfuscated_name();
+  writer.row("classes",
+             {class_id, dex_id, deobfuscated_name.c_str(),
+              cls->get_name()->c_str(), cls->get_access()});
+}
+
+void dump_field(RowWriter& writer,
+                int class_id,
+                DexField* field,
+                int field_id) {
+  // TODO: more fixup here on this crapped up name/signature
+  // TODO: break down signature
+  // TODO: annotations?
+  // TODO: string usage (encoded_value for static fields)
+  const auto& deobfuscated_name = field->get_deobfuscated_name();
+  auto field_name = strchr(deobfuscated_name.c_str(), ';');
+  writer.row("fields",
+             {field_id, class_id, field_name, field->get_name()->c_str(),
+              field->get_access()});
+}
+
+void dump_method(RowWriter& writer,
+                 int class_id,
+                 DexMethod* method,
+                 int method_id) {
+  // TODO: more fixup here on this crapped up name/signature
+  // TODO: break down signature
+  // TODO: throws?
+  // TODO: annotations?
+  // TODO: string usage
+  // TODO: size estimate
+  const auto& deobfuscated_name = method->get_deobfuscated_name();
+  auto method_name = strchr(deobfuscated_name.c_str(), ';');
+  size_t code_size =
+      method->get_code() ? method->get_code()->sum_opcode_sizes() : 0;
+  writer.row("methods",
+             {method_id, class_id, method_name, method->get_name()->c_str(),
+              method->get_access(), (int64_t)code_size});
+}
+
+void dump_sql(RowWriter& writer, DexStoresVector& stores, ProguardMap& pg_map) {
+  writer.write_schema();
   int next_class_id = 0;
   int next_method_id = 0;
   int next_field_id = 0;
   int next_string_id = 0;
 
   // Dump all dex items
-  fprintf(fdout, "BEGIN TRANSACTION;\n");
+  writer.begin_transaction();
   for (auto& store : stores) {
     auto store_name = store.get_name();
     auto& dexen = store.get_dexen();
@@ -289,48 +424,62 @@ CREATE TABLE %1$smethod_string_refs (
       for (auto dexstr : strings) {
         int id = next_string_id++;
         string_ids[dexstr] = id;
-        // Escape string before inserting. ' -> ''
-        std::string esc(dexstr->c_str());
-        boost::replace_all(esc, "'", "''");
-        fprintf(fdout,
-                "INSERT INTO %sstrings VALUES(%d, '%s');\n",
-                prefix,
-                id,
-                esc.c_str());
+        writer.row("strings", {id, dexstr->c_str()});
       }
       std::string dex_id_str(store_name + "/" + std::to_string(dex_idx));
       const char* dex_id = dex_id_str.c_str();
       for (const auto& cls : dex) {
         int class_id = next_class_id++;
-        dump_class(fdout, prefix, dex_id, cls, class_id);
+        dump_class(writer, dex_id, cls, class_id);
         class_ids[cls] = class_id;
         for (auto field : cls->get_ifields()) {
           int field_id = next_field_id++;
           field_ids[field] = field_id;
-          dump_field(fdout, prefix, class_id, field, field_id);
+          dump_field(writer, class_id, field, field_id);
         }
         for (auto field : cls->get_sfields()) {
           int field_id = next_field_id++;
           field_ids[field] = field_id;
-          dump_field(fdout, prefix, class_id, field, field_id);
+          dump_field(writer, class_id, field, field_id);
         }
         for (const auto& meth : cls->get_dmethods()) {
           int meth_id = next_method_id++;
           method_ids[meth] = meth_id;
-          dump_method(fdout, prefix, class_id, meth, meth_id);
+          dump_method(writer, class_id, meth, meth_id);
         }
         for (auto& meth : cls->get_vmethods()) {
           int meth_id = next_method_id++;
           method_ids[meth] = meth_id;
-          dump_method(fdout, prefix, class_id, meth, meth_id);
+          dump_method(writer, class_id, meth, meth_id);
         }
       }
     }
   }
-  fprintf(fdout, "END TRANSACTION;\n");
+  writer.end_transaction();
+
+  // Resolve the references of all methods in parallel, then dump them in
+  // order, so the row ids do not depend on the scheduling.
+  std::vector<DexMethod*> methods;
+  for (auto& store : stores) {
+    for (auto& dex : store.get_dexen()) {
+      for (const auto& cls : dex) {
+        for (const auto& meth : cls->get_dmethods()) {
+          methods.push_back(meth);
+        }
+        for (auto& meth : cls->get_vmethods()) {
+          methods.push_back(meth);
+        }
+      }
+    }
+  }
+  std::vector<std::vector<MethodRef>> method_refs(methods.size());
+  workqueue_run_for<size_t>(0, methods.size(), [&](size_t i) {
+    method_refs[i] = collect_method_refs(methods[i]);
+  });
 
   // Dump references
-  fprintf(fdout, "BEGIN TRANSACTION;\n");
+  writer.begin_transaction();
+  size_t method_idx = 0;
   for (auto& store : stores) {
     auto& dexen = store.get_dexen();
     for (size_t dex_idx = 0; dex_idx < dexen.size(); ++dex_idx) {
@@ -338,46 +487,42 @@ CREATE TABLE %1$smethod_string_refs (
       for (const auto& cls : dex) {
         for (const auto& meth : cls->get_dmethods()) {
           int meth_id = method_ids[meth];
-          dump_method_refs(fdout, prefix, meth, meth_id);
+          dump_method_refs(writer, method_refs[method_idx++], meth_id);
         }
         for (auto& meth : cls->get_vmethods()) {
           int meth_id = method_ids[meth];
-          dump_method_refs(fdout, prefix, meth, meth_id);
+          dump_method_refs(writer, method_refs[method_idx++], meth_id);
         }
         for (const auto& field : cls->get_sfields()) {
           int field_id = field_ids[field];
-          dump_field_refs(fdout, prefix, field, field_id);
+          dump_field_refs(writer, field, field_id);
         }
         for (const auto& field : cls->get_ifields()) {
           int field_id = field_ids[field];
-          dump_field_refs(fdout, prefix, field, field_id);
+          dump_field_refs(writer, field, field_id);
         }
       }
     }
   }
-  fprintf(fdout, "END TRANSACTION;\n");
+  writer.end_transaction();
 
   // Dump hierarchy
   auto scope = build_class_scope(stores);
   ClassHierarchy ch = build_type_hierarchy(scope);
   int next_is_a_id = 0;
-  fprintf(fdout, "BEGIN TRANSACTION;\n");
+  writer.begin_transaction();
   for (auto& cls : scope) {
     TypeSet results;
     get_all_children_or_implementors(ch, scope, cls, results);
     for (auto type : results) {
       auto type_cls = type_class(type);
       if (type_cls) {
-        fprintf(fdout,
-                "INSERT INTO %sis_a VALUES(%d, %d, %d);\n",
-                prefix,
-                next_is_a_id++,
-                class_ids[type_cls],
-                class_ids[cls]);
+        writer.row("is_a",
+                   {next_is_a_id++, class_ids[type_cls], class_ids[cls]});
       }
     }
   }
-  fprintf(fdout, "END TRANSACTION;\n");
+  writer.end_transaction();
 }
 
 class DexSqlDump : public Tool {
@@ -393,10 +538,15 @@ class DexSqlDump : public Tool {
         "path to a rename map")("output,o",
                                 po::value<std::string>()->value_name("dex.sql"),
                                 "path to output sql dump file (defaults to "
-                                "stdout)")(
+                                "stdout), or to the output directory for "
+                                "csv")(
         "table-prefix,t",
         po::value<std::string>()->value_name("pre_"),
-        "prefix to use on all table names");
+        "prefix to use on all table names")(
+        "format,f",
+        po::value<std::string>()->value_name("sql|csv")->default_value("sql"),
+        "sql writes a script of INSERT statements; csv writes one file per "
+        "table and a load.sql script that bulk imports them");
   }
 
   void run(const po::variables_map& options) override {
@@ -406,20 +556,36 @@ class DexSqlDump : public Tool {
     ProguardMap pgmap(options.count("proguard-map")
                           ? options["proguard-map"].as<std::string>()
                           : "/dev/null");
-    const std::string& filename = options["output"].as<std::string>();
-    FILE* fdout =
-        options.count("output") ? fopen(filename.c_str(), "w") : stdout;
     std::string prefix = options.count("table-prefix")
                              ? options["table-prefix"].as<std::string>()
                              : "";
+    const std::string& format = options["format"].as<std::string>();
+    if (format == "csv") {
+      if (!options.count("output")) {
+        fprintf(stderr, "csv output needs an output directory; terminating\n");
+        exit(EXIT_FAILURE);
+      }
+      RowWriter writer(options["output"].as<std::string>(), prefix);
+      dump_sql(writer, stores, pgmap);
+      return;
+    }
+    if (format != "sql") {
+      fprintf(stderr, "Unknown format %s; terminating\n", format.c_str());
+      exit(EXIT_FAILURE);
+    }
+    const std::string& filename = options["output"].as<std::string>();
+    FILE* fdout =
+        options.count("output") ? fopen(filename.c_str(), "w") : stdout;
     if (!fdout) {
       fprintf(stderr,
               "Could not open %s for writing; terminating\n",
               filename.c_str());
       exit(EXIT_FAILURE);
     }
-    auto* pfx_cstr = prefix.c_str();
-    dump_sql(fdout, stores, pgmap, pfx_cstr);
+    {
+      RowWriter writer(fdout, prefix);
+      dump_sql(writer, stores, pgmap);
+    }
     fclose(fdout);
   }
 };
@@ -17,6 +17,17 @@
 #include <string>
 #include <vector>
 
+const char* class_filter = nullptr;
+
+static bool matches_class_filter(ddump_data* rd, uint32_t idx) {
+  if (class_filter == nullptr) {
+    return true;
+  }
+  const char* name =
+      dex_string_by_type_idx(rd, rd->dex_class_defs[idx].typeidx);
+  return strncmp(name, class_filter, strlen(class_filter)) == 0;
+}
+
 /**
  * Return a proto string in the form
  * [shorty] (argTypes)returnType
@@ -599,7 +610,9 @@ void dump_clsdefs(ddump_data* rd, bool print_headers) {
         "[static values: static_value_off]\n");
   }
   for (uint32_t i = 0; i < size; i++) {
-    redump(i, "%s\n", get_class_def(rd, i).c_str());
+    if (matches_class_filter(rd, i)) {
+      redump(i, "%s\n", get_class_def(rd, i).c_str());
+    }
   }
 }
 
@@ -615,6 +628,9 @@ void dump_clsdata(ddump_data* rd, bool print_headers) {
         "vmethods: <count> followed by vmethods\n");
   }
   for (uint32_t i = 0; i < size; i++) {
+    if (!matches_class_filter(rd, i)) {
+      continue;
+    }
     const dex_class_def* class_defs =
         (dex_class_def*)(rd->dexmmap + rd->dexh->class_defs_off) + i;
     redump(class_defs->class_data_offset,
@@ -783,7 +799,9 @@ static void dump_class_annotations(ddump_data* rd, dex_class_def* df) {
 
 void dump_anno(ddump_data* rd) {
   for (uint32_t i = 0; i < rd->dexh->class_defs_size; i++) {
-    dump_class_annotations(rd, &rd->dex_class_defs[i]);
+    if (matches_class_filter(rd, i)) {
+      dump_class_annotations(rd, &rd->dex_class_defs[i]);
+    }
   }
 }
 
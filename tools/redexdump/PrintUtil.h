@@ -8,11 +8,15 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdio.h>
 
 extern bool clean;
 extern bool raw;
 extern bool escape;
 
+// Where redump prints to on the current thread; stdout if null.
+extern thread_local FILE* redump_file;
+
 void redump(const char* format, ...);
 void redump(uint32_t off, const char* format, ...);
 void redump(uint32_t pos, uint32_t off, const char* format, ...);
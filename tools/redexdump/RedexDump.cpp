@@ -6,10 +6,16 @@
  */
 
 #include "RedexDump.h"
+#include <atomic>
+#include <condition_variable>
 #include <getopt.h>
+#include <mutex>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "Formatters.h"
 #include "PrintUtil.h"
@@ -47,10 +53,15 @@ static const char ddump_usage_string[] =
     "printing options:\n"
     "--clean: suppress indices and offsets\n"
     "--no-headers: suppress headers\n"
-    "--raw: print all bytes, even control characters\n";
+    "--raw: print all bytes, even control characters\n"
+    "--class=<prefix>: only print the class defs, class data and annotations\n"
+    "                  of classes whose descriptor starts with <prefix>\n"
+    "-j, --jobs=<n>: dump up to <n> dex files in parallel; the output\n"
+    "                stays in the order of the files on the command line\n";
 
-int main(int argc, char* argv[]) {
+namespace {
 
+struct dump_options {
   bool all = false;
   bool string = false;
   bool stringdata = false;
@@ -68,9 +79,128 @@ int main(int argc, char* argv[]) {
   bool redexdump_debug = false;
   uint32_t ddebug_offset = 0;
   int no_headers = 0;
+};
+
+void dump_dex_file(const char* dexfile, const dump_options& opts) {
+  ddump_data rd;
+  open_dex_file(dexfile, &rd);
+  if (!opts.no_headers) {
+    redump(format_map(&rd).c_str());
+  }
+  if (opts.string || opts.all) {
+    dump_strings(&rd, !opts.no_headers);
+  }
+  if (opts.stringdata || opts.all) {
+    dump_stringdata(&rd, !opts.no_headers);
+  }
+  if (opts.type || opts.all) {
+    dump_types(&rd);
+  }
+  if (opts.proto || opts.all) {
+    dump_protos(&rd, !opts.no_headers);
+  }
+  if (opts.field || opts.all) {
+    dump_fields(&rd, !opts.no_headers);
+  }
+  if (opts.meth || opts.all) {
+    dump_methods(&rd, !opts.no_headers);
+  }
+  if (opts.methodhandle || opts.all) {
+    dump_methodhandles(&rd, !opts.no_headers);
+  }
+  if (opts.callsite || opts.all) {
+    dump_callsites(&rd, !opts.no_headers);
+  }
+  if (opts.clsdef || opts.all) {
+    dump_clsdefs(&rd, !opts.no_headers);
+  }
+  if (opts.clsdata || opts.all) {
+    dump_clsdata(&rd, !opts.no_headers);
+  }
+  if (opts.code || opts.all) {
+    dump_code(&rd);
+  }
+  if (opts.enarr || opts.all) {
+    dump_enarr(&rd);
+  }
+  if (opts.anno || opts.all) {
+    dump_anno(&rd);
+  }
+
+  if (opts.redexdump_debug || opts.all) {
+    dump_debug(&rd);
+  }
+  if (opts.ddebug_offset != 0) {
+    disassemble_debug(&rd, opts.ddebug_offset);
+  }
+  redump("\n");
+  close_dex_file(&rd);
+}
+
+/*
+ * Dumps the files on `jobs` threads, each into its own in-memory stream. The
+ * buffers are written to stdout in order as soon as all the files before them
+ * are done.
+ */
+void dump_dex_files_in_parallel(const std::vector<const char*>& dexfiles,
+                                const dump_options& opts,
+                                size_t jobs) {
+  std::vector<std::string> outputs(dexfiles.size());
+  std::vector<bool> done(dexfiles.size(), false);
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::atomic<size_t> next{0};
+
+  auto worker = [&]() {
+    for (size_t i = next++; i < dexfiles.size(); i = next++) {
+      char* buf = nullptr;
+      size_t len = 0;
+      redump_file = open_memstream(&buf, &len);
+      if (redump_file == nullptr) {
+        fprintf(stderr, "Cannot allocate output buffer, bailing\n");
+        exit(1);
+      }
+      dump_dex_file(dexfiles[i], opts);
+      fclose(redump_file);
+      redump_file = nullptr;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        outputs[i].assign(buf, len);
+        done[i] = true;
+      }
+      free(buf);
+      cv.notify_one();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < std::min(jobs, dexfiles.size()); i++) {
+    threads.emplace_back(worker);
+  }
+  for (size_t i = 0; i < dexfiles.size(); i++) {
+    std::string output;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&]() { return done[i]; });
+      output.swap(outputs[i]);
+    }
+    fwrite(output.data(), 1, output.size(), stdout);
+    fflush(stdout);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+
+  dump_options opts;
+  size_t jobs = 1;
 
   char c;
-  static const struct option options[] = {
+  const struct option options[] = {
       {"all", no_argument, nullptr, 'a'},
       {"string", no_argument, nullptr, 's'},
       {"stringdata", no_argument, nullptr, 'S'},
@@ -90,61 +220,73 @@ int main(int argc, char* argv[]) {
       {"clean", no_argument, (int*)&clean, 1},
       {"raw", no_argument, (int*)&raw, 1},
       {"escape", no_argument, (int*)&escape, 1},
-      {"no-headers", no_argument, &no_headers, 1},
+      {"no-headers", no_argument, &opts.no_headers, 1},
+      {"class", required_argument, nullptr, 'F'},
+      {"jobs", required_argument, nullptr, 'j'},
       {"help", no_argument, nullptr, 'h'},
       {nullptr, 0, nullptr, 0},
   };
 
-  while ((c = getopt_long(argc, argv, "asStpfmcCxeAdD:h", &options[0],
+  while ((c = getopt_long(argc, argv, "asStpfmcCxeAdD:j:h", &options[0],
                           nullptr)) != -1) {
     switch (c) {
     case 'a':
-      all = true;
+      opts.all = true;
       break;
     case 's':
-      string = true;
+      opts.string = true;
       break;
     case 'S':
-      stringdata = true;
+      opts.stringdata = true;
       break;
     case 't':
-      type = true;
+      opts.type = true;
       break;
     case 'p':
-      proto = true;
+      opts.proto = true;
       break;
     case 'f':
-      field = true;
+      opts.field = true;
       break;
     case 'm':
-      meth = true;
+      opts.meth = true;
       break;
     case 'H':
-      methodhandle = true;
+      opts.methodhandle = true;
       break;
     case 'k':
-      callsite = true;
+      opts.callsite = true;
       break;
     case 'c':
-      clsdef = true;
+      opts.clsdef = true;
       break;
     case 'C':
-      clsdata = true;
+      opts.clsdata = true;
       break;
     case 'x':
-      code = true;
+      opts.code = true;
       break;
     case 'e':
-      enarr = true;
+      opts.enarr = true;
       break;
     case 'A':
-      anno = true;
+      opts.anno = true;
       break;
     case 'd':
-      redexdump_debug = true;
+      opts.redexdump_debug = true;
       break;
     case 'D':
-      sscanf(optarg, "%x", &ddebug_offset);
+      sscanf(optarg, "%x", &opts.ddebug_offset);
+      break;
+    case 'F':
+      class_filter = optarg;
+      break;
+    case 'j':
+      jobs = strtoul(optarg, nullptr, 10);
+      if (jobs == 0) {
+        fprintf(stderr, "%s: invalid number of jobs: %s\n", argv[0], optarg);
+        return 1;
+      }
       break;
     case 'h':
       puts(ddump_usage_string);
@@ -164,60 +306,14 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
-  while (optind < argc) {
-    const char* dexfile = argv[optind++];
-    ddump_data rd;
-    open_dex_file(dexfile, &rd);
-    if (!no_headers) {
-      redump(format_map(&rd).c_str());
-    }
-    if (string || all) {
-      dump_strings(&rd, !no_headers);
-    }
-    if (stringdata || all) {
-      dump_stringdata(&rd, !no_headers);
-    }
-    if (type || all) {
-      dump_types(&rd);
-    }
-    if (proto || all) {
-      dump_protos(&rd, !no_headers);
-    }
-    if (field || all) {
-      dump_fields(&rd, !no_headers);
-    }
-    if (meth || all) {
-      dump_methods(&rd, !no_headers);
-    }
-    if (methodhandle || all) {
-      dump_methodhandles(&rd, !no_headers);
-    }
-    if (callsite || all) {
-      dump_callsites(&rd, !no_headers);
-    }
-    if (clsdef || all) {
-      dump_clsdefs(&rd, !no_headers);
-    }
-    if (clsdata || all) {
-      dump_clsdata(&rd, !no_headers);
-    }
-    if (code || all) {
-      dump_code(&rd);
-    }
-    if (enarr || all) {
-      dump_enarr(&rd);
-    }
-    if (anno || all) {
-      dump_anno(&rd);
-    }
+  if (jobs > 1) {
+    std::vector<const char*> dexfiles(argv + optind, argv + argc);
+    dump_dex_files_in_parallel(dexfiles, opts, jobs);
+    return 0;
+  }
 
-    if (redexdump_debug || all) {
-      dump_debug(&rd);
-    }
-    if (ddebug_offset != 0) {
-      disassemble_debug(&rd, ddebug_offset);
-    }
-    fprintf(stdout, "\n");
+  while (optind < argc) {
+    dump_dex_file(argv[optind++], opts);
     fflush(stdout);
   }
 
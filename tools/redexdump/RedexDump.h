@@ -9,6 +9,10 @@
 
 #include "DexCommon.h"
 
+// Only classes whose descriptor starts with this prefix are printed in the
+// class def, class data and annotation sections; all classes if null.
+extern const char* class_filter;
+
 void dump_strings(ddump_data* rd, bool print_headers);
 void dump_stringdata(ddump_data* rd, bool print_headers);
 void dump_types(ddump_data* rd);
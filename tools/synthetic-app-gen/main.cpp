@@ -0,0 +1,503 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * Generates synthetic dex inputs of configurable size and shape, to measure
+ * how passes scale with the size of an app.
+ *
+ * The app consists of
+ * - chains of classes of --hierarchy-depth, each with a constructor, static
+ *   methods and virtual methods that override the ones of their super class,
+ * - method bodies with a geometric size distribution around --method-size,
+ *   made of arithmetic, branches and calls to random other methods,
+ * - Kotlin-like non-capturing lambdas (Function0 singletons with an INSTANCE
+ *   field), invoked through the interface,
+ * - methods with huge packed and sparse switches,
+ * - R classes with resource id fields, read from the method bodies,
+ * - a Main class calling a random subset of the static methods, which
+ *   proguard-rules.pro keeps.
+ *
+ * Everything is derived from --seed, so a given command line always produces
+ * the same dexes. --scale multiplies all counts, to generate the same shape
+ * at different sizes.
+ */
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+
+#include "ConfigFiles.h"
+#include "Creators.h"
+#include "DexClass.h"
+#include "DexOutput.h"
+#include "DexPosition.h"
+#include "DexStore.h"
+#include "IRAssembler.h"
+#include "InstructionLowering.h"
+#include "RedexContext.h"
+#include "RedexOptions.h"
+
+namespace {
+
+struct Options {
+  std::string out_dir;
+  double scale{1};
+  size_t classes{1000};
+  size_t hierarchy_depth{4};
+  double methods_per_class{8};
+  double method_size{20};
+  double call_density{2};
+  size_t lambdas{100};
+  double lambda_uses{0.2};
+  size_t switch_methods{10};
+  size_t switch_cases{1000};
+  size_t resources{1000};
+  double resource_uses{0.5};
+  double root_fraction{0.05};
+  uint32_t seed{0};
+};
+
+Options parse_args(int argc, char* argv[]) {
+  namespace po = boost::program_options;
+  Options o;
+  po::options_description desc("Generate a synthetic app as dex files");
+  desc.add_options()("help,h", "produce help message");
+  desc.add_options()("out,o", po::value<std::string>(&o.out_dir),
+                     "output directory");
+  desc.add_options()("scale", po::value<double>(&o.scale),
+                     "multiplies all counts (1)");
+  desc.add_options()("classes", po::value<size_t>(&o.classes),
+                     "number of regular classes (1000)");
+  desc.add_options()("hierarchy-depth", po::value<size_t>(&o.hierarchy_depth),
+                     "length of the class inheritance chains (4)");
+  desc.add_options()("methods-per-class",
+                     po::value<double>(&o.methods_per_class),
+                     "mean number of methods per class (8)");
+  desc.add_options()("method-size", po::value<double>(&o.method_size),
+                     "mean number of statements per method (20)");
+  desc.add_options()("call-density", po::value<double>(&o.call_density),
+                     "mean number of calls per method (2)");
+  desc.add_options()("lambdas", po::value<size_t>(&o.lambdas),
+                     "number of Kotlin-like lambda classes (100)");
+  desc.add_options()("lambda-uses", po::value<double>(&o.lambda_uses),
+                     "mean number of lambda invocations per method (0.2)");
+  desc.add_options()("switch-methods", po::value<size_t>(&o.switch_methods),
+                     "number of methods with a huge switch (10)");
+  desc.add_options()("switch-cases", po::value<size_t>(&o.switch_cases),
+                     "number of cases of each huge switch (1000)");
+  desc.add_options()("resources", po::value<size_t>(&o.resources),
+                     "number of resource id fields in R classes (1000)");
+  desc.add_options()("resource-uses", po::value<double>(&o.resource_uses),
+                     "mean number of resource reads per method (0.5)");
+  desc.add_options()("root-fraction", po::value<double>(&o.root_fraction),
+                     "fraction of the static methods called from Main "
+                     "(0.05)");
+  desc.add_options()("seed", po::value<uint32_t>(&o.seed),
+                     "random seed (0)");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    desc.print(std::cout);
+    exit(EXIT_SUCCESS);
+  }
+  if (o.out_dir.empty()) {
+    std::cerr << "--out is required\n";
+    exit(EXIT_FAILURE);
+  }
+  if (o.hierarchy_depth == 0) {
+    o.hierarchy_depth = 1;
+  }
+  auto scaled = [&](size_t n) {
+    return static_cast<size_t>(std::llround(n * o.scale));
+  };
+  o.classes = std::max<size_t>(scaled(o.classes), 1);
+  o.lambdas = scaled(o.lambdas);
+  o.switch_methods = scaled(o.switch_methods);
+  o.resources = scaled(o.resources);
+  return o;
+}
+
+constexpr const char* kIntMethodProto = ":(I)I";
+constexpr const char* kResourceTypes[] = {"string", "drawable", "layout", "id",
+                                          "dimen"};
+
+struct MethodPlan {
+  std::string cls;
+  std::string name;
+  bool is_static;
+  // Number of cases if this is a switch method.
+  size_t switch_cases{0};
+
+  std::string ref() const { return cls + "." + name + kIntMethodProto; }
+};
+
+struct ClassPlan {
+  std::string name;
+  std::string super;
+  std::vector<size_t> methods;
+};
+
+class AppGenerator {
+ public:
+  explicit AppGenerator(const Options& options)
+      : m_options(options), m_rng(options.seed) {
+    plan_classes();
+    plan_resources();
+  }
+
+  /**
+   * Creates all classes, in an order in which every super class precedes its
+   * subclasses.
+   */
+  std::vector<DexClass*> generate() {
+    std::vector<DexClass*> classes;
+    for (size_t i = 0; i < m_resource_fields.size(); ++i) {
+      classes.push_back(make_resource_class(i));
+    }
+    for (size_t i = 0; i < m_options.lambdas; ++i) {
+      classes.push_back(make_lambda(i));
+    }
+    for (const auto& plan : m_classes) {
+      classes.push_back(make_class(plan));
+    }
+    classes.push_back(make_main());
+    return classes;
+  }
+
+  size_t num_methods() const { return m_methods.size(); }
+
+ private:
+  size_t uniform(size_t n) {
+    return std::uniform_int_distribution<size_t>(0, n - 1)(m_rng);
+  }
+
+  bool chance(double p) {
+    return std::uniform_real_distribution<double>(0, 1)(m_rng) < p;
+  }
+
+  void plan_classes() {
+    std::geometric_distribution<size_t> methods_dist(
+        1 / (1 + m_options.methods_per_class));
+    for (size_t i = 0; i < m_options.classes; ++i) {
+      ClassPlan plan;
+      plan.name = "Lcom/synth/p" + std::to_string(i / 256) + "/C" +
+                  std::to_string(i) + ";";
+      plan.super = i % m_options.hierarchy_depth == 0
+                       ? "Ljava/lang/Object;"
+                       : m_classes.back().name;
+      auto num_methods = methods_dist(m_rng);
+      for (size_t j = 0; j < num_methods; ++j) {
+        bool is_static = chance(0.5);
+        plan.methods.push_back(m_methods.size());
+        m_methods.push_back({plan.name,
+                             (is_static ? "s" : "v") + std::to_string(j),
+                             is_static});
+      }
+      m_classes.push_back(std::move(plan));
+    }
+    for (size_t i = 0; i < m_options.switch_methods; ++i) {
+      auto& plan = m_classes[uniform(m_classes.size())];
+      plan.methods.push_back(m_methods.size());
+      m_methods.push_back({plan.name, "sw" + std::to_string(i), true,
+                           m_options.switch_cases});
+    }
+  }
+
+  void plan_resources() {
+    size_t num_types = std::min(m_options.resources, std::size(kResourceTypes));
+    m_resource_fields.resize(num_types);
+    for (size_t i = 0; i < m_options.resources; ++i) {
+      auto type = i % num_types;
+      auto& fields = m_resource_fields[type];
+      fields.push_back("Lcom/synth/R$" + std::string(kResourceTypes[type]) +
+                       ";." + kResourceTypes[type] + "_" +
+                       std::to_string(fields.size()) + ":I");
+    }
+  }
+
+  DexClass* make_resource_class(size_t type) {
+    ClassCreator cc(DexType::make_type("Lcom/synth/R$" +
+                                       std::string(kResourceTypes[type]) +
+                                       ";"));
+    cc.set_super(type::java_lang_Object());
+    cc.set_access(ACC_PUBLIC | ACC_FINAL);
+    for (size_t i = 0; i < m_resource_fields[type].size(); ++i) {
+      uint32_t id = 0x7f000000 | ((type + 1) << 16) | i;
+      cc.add_field(
+          DexField::make_field(m_resource_fields[type][i])
+              ->make_concrete(
+                  ACC_PUBLIC | ACC_STATIC | ACC_FINAL,
+                  std::make_unique<DexEncodedValuePrimitive>(DEVT_INT, id)));
+    }
+    return cc.create();
+  }
+
+  static std::string lambda_name(size_t i) {
+    return "Lcom/synth/lambdas/L" + std::to_string(i) + ";";
+  }
+
+  DexClass* make_lambda(size_t i) {
+    auto name = lambda_name(i);
+    ClassCreator cc(DexType::make_type(name));
+    cc.set_super(DexType::make_type("Lkotlin/jvm/internal/Lambda;"));
+    cc.add_interface(DexType::make_type("Lkotlin/jvm/functions/Function0;"));
+    cc.set_access(ACC_PUBLIC | ACC_FINAL);
+    cc.add_field(DexField::make_field(name + ".INSTANCE:" + name)
+                     ->make_concrete(ACC_PUBLIC | ACC_STATIC | ACC_FINAL));
+    std::ostringstream clinit;
+    clinit << "(method (public static constructor) \"" << name
+           << ".<clinit>:()V\" ((new-instance \"" << name
+           << "\") (move-result-pseudo-object v0) (invoke-direct (v0) \""
+           << name << ".<init>:()V\") (sput-object v0 \"" << name
+           << ".INSTANCE:" << name << "\") (return-void)))";
+    cc.add_method(assembler::method_from_string(clinit.str()));
+    std::ostringstream init;
+    init << "(method (public constructor) \"" << name
+         << ".<init>:()V\" ((load-param-object v1) (const v0 0) "
+            "(invoke-direct (v1 v0) "
+            "\"Lkotlin/jvm/internal/Lambda;.<init>:(I)V\") (return-void)))";
+    cc.add_method(assembler::method_from_string(init.str()));
+    std::ostringstream invoke;
+    invoke << "(method (public final) \"" << name
+           << ".invoke:()Ljava/lang/Object;\" ((load-param-object v1) "
+              "(const-string \"lambda"
+           << i << "\") (move-result-pseudo-object v0) (return-object v0)))";
+    cc.add_method(assembler::method_from_string(invoke.str()));
+    return cc.create();
+  }
+
+  void emit_call(std::ostringstream& out) {
+    const auto& target = m_methods[uniform(m_methods.size())];
+    if (target.is_static) {
+      out << "(invoke-static (v0) \"" << target.ref() << "\")";
+    } else {
+      out << "(new-instance \"" << target.cls
+          << "\") (move-result-pseudo-object v2) (invoke-direct (v2) \""
+          << target.cls << ".<init>:()V\") (invoke-virtual (v2 v0) \""
+          << target.ref() << "\")";
+    }
+    out << " (move-result v0)\n";
+  }
+
+  static const char* param_reg(const MethodPlan& plan) {
+    return plan.is_static ? "v4" : "v5";
+  }
+
+  void emit_body(std::ostringstream& out, const char* param, size_t size) {
+    // Spread calls, lambda invocations and resource reads over the body so
+    // that each method gets the requested number on average.
+    double per_statement = 1.0 / std::max<size_t>(size, 1);
+    double p_call = m_options.call_density * per_statement;
+    double p_lambda = m_options.lambda_uses * per_statement;
+    double p_resource = m_options.resource_uses * per_statement;
+    size_t labels = 0;
+    out << "(const v0 " << uniform(1000) << ")\n";
+    for (size_t i = 0; i < size; ++i) {
+      if (chance(p_call)) {
+        emit_call(out);
+      } else if (m_options.lambdas > 0 && chance(p_lambda)) {
+        auto lambda = lambda_name(uniform(m_options.lambdas));
+        out << "(sget-object \"" << lambda << ".INSTANCE:" << lambda
+            << "\") (move-result-pseudo-object v2) (invoke-interface (v2) "
+               "\"Lkotlin/jvm/functions/Function0;.invoke:()"
+               "Ljava/lang/Object;\") (move-result-object v2)\n";
+      } else if (!m_resource_fields.empty() && chance(p_resource)) {
+        const auto& fields =
+            m_resource_fields[uniform(m_resource_fields.size())];
+        out << "(sget \"" << fields[uniform(fields.size())]
+            << "\") (move-result-pseudo v3) (add-int v0 v0 v3)\n";
+      } else if (chance(0.1)) {
+        out << "(if-lez v0 :L" << labels << ") (add-int/lit v0 v0 "
+            << uniform(100) << ") (:L" << labels << ")\n";
+        ++labels;
+      } else {
+        static const char* ops[] = {"add-int/lit", "mul-int/lit",
+                                    "xor-int/lit"};
+        switch (uniform(4)) {
+        case 0:
+          out << "(add-int v0 v0 " << param << ")\n";
+          break;
+        default:
+          out << "(" << ops[uniform(3)] << " v0 v0 " << uniform(128) << ")\n";
+          break;
+        }
+      }
+    }
+    out << "(return v0)";
+  }
+
+  void emit_switch(std::ostringstream& out, const char* param, size_t cases) {
+    // Every other switch method uses spread-out keys, which become a
+    // sparse-switch.
+    size_t stride = chance(0.5) ? 1 : 7;
+    out << "(switch " << param << " (";
+    for (size_t i = 0; i < cases; ++i) {
+      out << (i ? " " : "") << ":c" << i;
+    }
+    out << "))\n(const v0 -1)\n(return v0)\n";
+    for (size_t i = 0; i < cases; ++i) {
+      out << "(:c" << i << " " << i * stride << ") (const v0 " << uniform(1000)
+          << ") (return v0)\n";
+    }
+  }
+
+  DexMethod* make_method(const MethodPlan& plan) {
+    std::ostringstream out;
+    out << "(method (public" << (plan.is_static ? " static" : "") << ") \""
+        << plan.ref() << "\" (\n";
+    // The parameters come last: v0, v2 and v3 are temporaries.
+    if (!plan.is_static) {
+      out << "(load-param-object v4)\n";
+    }
+    out << "(load-param " << param_reg(plan) << ")\n";
+    if (plan.switch_cases > 0) {
+      emit_switch(out, param_reg(plan), plan.switch_cases);
+    } else {
+      std::geometric_distribution<size_t> size_dist(
+          1 / (1 + m_options.method_size));
+      emit_body(out, param_reg(plan), size_dist(m_rng));
+    }
+    out << "))";
+    return assembler::method_from_string(out.str());
+  }
+
+  DexClass* make_class(const ClassPlan& plan) {
+    ClassCreator cc(DexType::make_type(plan.name));
+    cc.set_super(DexType::make_type(plan.super));
+    cc.set_access(ACC_PUBLIC);
+    cc.add_method(assembler::method_from_string(
+        "(method (public constructor) \"" + plan.name +
+        ".<init>:()V\" ((load-param-object v0) (invoke-direct (v0) \"" +
+        plan.super + ".<init>:()V\") (return-void)))"));
+    for (auto index : plan.methods) {
+      cc.add_method(make_method(m_methods[index]));
+    }
+    return cc.create();
+  }
+
+  DexClass* make_main() {
+    std::ostringstream out;
+    out << "(method (public static) "
+           "\"Lcom/synth/Main;.main:([Ljava/lang/String;)V\" (\n"
+           "(load-param-object v1)\n(const v0 0)\n";
+    for (const auto& method : m_methods) {
+      if (method.is_static && chance(m_options.root_fraction)) {
+        out << "(invoke-static (v0) \"" << method.ref()
+            << "\") (move-result v0)\n";
+      }
+    }
+    out << "(return-void)))";
+    ClassCreator cc(DexType::make_type("Lcom/synth/Main;"));
+    cc.set_super(type::java_lang_Object());
+    cc.set_access(ACC_PUBLIC | ACC_FINAL);
+    cc.add_method(assembler::method_from_string(out.str()));
+    return cc.create();
+  }
+
+  const Options& m_options;
+  std::mt19937 m_rng;
+  std::vector<ClassPlan> m_classes;
+  std::vector<MethodPlan> m_methods;
+  std::vector<std::vector<std::string>> m_resource_fields;
+};
+
+/**
+ * Splits the classes into dexes, keeping an upper bound of the method and
+ * field refs of each dex below the 64K limit.
+ */
+std::vector<DexClasses> split_into_dexes(const std::vector<DexClass*>& all) {
+  constexpr size_t kMaxRefs = 60000;
+  std::vector<DexClasses> dexes(1);
+  size_t method_refs = 0;
+  size_t field_refs = 0;
+  for (auto* cls : all) {
+    std::vector<DexMethodRef*> methods;
+    std::vector<DexFieldRef*> fields;
+    cls->gather_methods(methods);
+    cls->gather_fields(fields);
+    if (!dexes.back().empty() && (method_refs + methods.size() > kMaxRefs ||
+                                  field_refs + fields.size() > kMaxRefs)) {
+      dexes.emplace_back();
+      method_refs = 0;
+      field_refs = 0;
+    }
+    method_refs += methods.size();
+    field_refs += fields.size();
+    dexes.back().push_back(cls);
+  }
+  return dexes;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  auto options = parse_args(argc, argv);
+  boost::filesystem::create_directories(options.out_dir);
+
+  g_redex = new RedexContext();
+  AppGenerator generator(options);
+  auto classes = generator.generate();
+
+  DexStore store("classes");
+  store.set_dex_magic(DEX_HEADER_DEXMAGIC_V35);
+  for (auto& dex : split_into_dexes(classes)) {
+    store.add_classes(std::move(dex));
+  }
+  DexStoresVector stores;
+  stores.emplace_back(std::move(store));
+  instruction_lowering::run(stores);
+
+  // The symbol files that DexOutput writes next to the dexes are of no use
+  // here, so they go to a temporary directory.
+  auto meta_dir = boost::filesystem::temp_directory_path() /
+                  boost::filesystem::unique_path("synthetic-app-gen-%%%%%%%%");
+  boost::filesystem::create_directories(meta_dir / "meta");
+  Json::Value json(Json::objectValue);
+  ConfigFiles conf(json, meta_dir.string());
+  std::unique_ptr<PositionMapper> pos_mapper(PositionMapper::make(""));
+  auto& dexen = stores[0].get_dexen();
+  for (size_t i = 0; i < dexen.size(); ++i) {
+    auto filename =
+        options.out_dir + "/classes" + (i ? std::to_string(i + 1) : "") +
+        ".dex";
+    auto gtypes = std::make_shared<GatheredTypes>(&dexen[i]);
+    write_classes_to_dex(filename,
+                         &dexen[i],
+                         std::move(gtypes),
+                         0,
+                         &stores[0].get_name(),
+                         i,
+                         conf,
+                         pos_mapper.get(),
+                         DebugInfoKind::NoCustomSymbolication,
+                         nullptr,
+                         nullptr,
+                         nullptr /* IODIMetadata* */,
+                         stores[0].get_dex_magic());
+  }
+
+  std::ofstream rules(options.out_dir + "/proguard-rules.pro");
+  rules << "-keep class com.synth.Main {\n"
+        << "  public static void main(java.lang.String[]);\n"
+        << "}\n";
+
+  std::cout << "Generated " << classes.size() << " classes with "
+            << generator.num_methods() << " methods in " << dexen.size()
+            << " dex files" << std::endl;
+
+  boost::filesystem::remove_all(meta_dir);
+  delete g_redex;
+  return 0;
+}
@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "CpuProfiling.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <cerrno>
+#include <csignal>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "Debug.h"
+
+namespace cpu_profiling {
+
+namespace {
+
+size_t get_env_size(const char* name, size_t dflt) {
+  auto* val = getenv(name);
+  return val == nullptr ? dflt : std::stoull(val);
+}
+
+} // namespace
+
+Options options_from_env() {
+  Options options;
+  options.interval_us = (uint32_t)get_env_size("CPU_PROFILE_INTERVAL_US",
+                                               options.interval_us);
+  options.max_samples =
+      get_env_size("CPU_PROFILE_MAX_SAMPLES", options.max_samples);
+  options.bucket_ms =
+      (uint32_t)get_env_size("CPU_PROFILE_BUCKET_MS", options.bucket_ms);
+  return options;
+}
+
+#ifdef __linux__
+
+namespace {
+
+constexpr size_t kMaxDepth = 48;
+// The signal handler and the signal trampoline.
+constexpr size_t kSkippedFrames = 2;
+
+struct Sample {
+  uint64_t time_ns;
+  int32_t tid;
+  // Written last; zero while the sample is incomplete.
+  std::atomic<uint32_t> depth;
+  void* pcs[kMaxDepth];
+};
+
+Sample* s_samples{nullptr};
+size_t s_capacity{0};
+std::atomic<size_t> s_next{0};
+std::atomic<bool> s_active{false};
+struct sigaction s_old_action;
+
+uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void handle_sigprof(int, siginfo_t*, void*) {
+  auto saved_errno = errno;
+  auto idx = s_next.fetch_add(1, std::memory_order_relaxed);
+  if (idx < s_capacity) {
+    auto& sample = s_samples[idx];
+    sample.time_ns = now_ns();
+    sample.tid = (int32_t)syscall(SYS_gettid);
+    auto depth = backtrace(sample.pcs, kMaxDepth);
+    sample.depth.store(std::max(depth, 1), std::memory_order_release);
+  }
+  errno = saved_errno;
+}
+
+void set_timer(uint32_t interval_us) {
+  struct itimerval timer;
+  timer.it_interval.tv_sec = interval_us / 1000000;
+  timer.it_interval.tv_usec = interval_us % 1000000;
+  timer.it_value = timer.it_interval;
+  setitimer(ITIMER_PROF, &timer, nullptr);
+}
+
+std::string symbolize(void* pc) {
+  Dl_info info;
+  // Return addresses point after the call.
+  auto* addr = static_cast<char*>(pc) - 1;
+  if (dladdr(addr, &info) == 0) {
+    std::ostringstream oss;
+    oss << pc;
+    return oss.str();
+  }
+  if (info.dli_sname != nullptr) {
+    int status;
+    char* demangled =
+        abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    std::string name = status == 0 ? demangled : info.dli_sname;
+    free(demangled);
+    return name;
+  }
+  std::string module = info.dli_fname == nullptr ? "?" : info.dli_fname;
+  module = module.substr(module.rfind('/') + 1);
+  std::ostringstream oss;
+  oss << module << "+0x" << std::hex
+      << (uintptr_t)(addr - static_cast<char*>(info.dli_fbase));
+  return oss.str();
+}
+
+// Frame separators are significant in the collapsed format.
+std::string sanitize(std::string frame) {
+  std::replace(frame.begin(), frame.end(), ';', ':');
+  std::replace(frame.begin(), frame.end(), '\n', ' ');
+  return frame;
+}
+
+void write_collapsed_stacks(const std::string& file_name,
+                            const Sample* samples,
+                            size_t count) {
+  std::unordered_map<void*, std::string> symbols;
+  auto get_symbol = [&](void* pc) -> const std::string& {
+    auto it = symbols.find(pc);
+    if (it == symbols.end()) {
+      it = symbols.emplace(pc, sanitize(symbolize(pc))).first;
+    }
+    return it->second;
+  };
+  // Sorted, for deterministic output.
+  std::map<std::string, size_t> stacks;
+  for (size_t i = 0; i < count; ++i) {
+    auto& sample = samples[i];
+    auto depth = sample.depth.load(std::memory_order_acquire);
+    if (depth == 0) {
+      continue;
+    }
+    std::string stack;
+    for (size_t j = depth; j > kSkippedFrames; --j) {
+      if (!stack.empty()) {
+        stack += ';';
+      }
+      stack += get_symbol(sample.pcs[j - 1]);
+    }
+    ++stacks[stack.empty() ? "[unknown]" : stack];
+  }
+  std::ofstream out(file_name);
+  for (auto& [stack, samples_count] : stacks) {
+    out << stack << ' ' << samples_count << '\n';
+  }
+}
+
+uint64_t process_cpu_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// The kernel delivers profiling signals at tick granularity, so the actual
+// sampling rate can be well below the requested one. Utilization is computed
+// from the CPU time that each sample actually accounts for.
+void write_thread_timeline(const std::string& file_name,
+                           const Sample* samples,
+                           size_t count,
+                           uint64_t start_ns,
+                           double ns_per_sample,
+                           const Options& options) {
+  uint64_t bucket_ns = uint64_t(std::max(options.bucket_ms, 1u)) * 1000000;
+  std::map<std::pair<int32_t, uint64_t>, size_t> buckets;
+  for (size_t i = 0; i < count; ++i) {
+    auto& sample = samples[i];
+    if (sample.depth.load(std::memory_order_acquire) == 0) {
+      continue;
+    }
+    auto bucket = (sample.time_ns - std::min(sample.time_ns, start_ns)) /
+                  bucket_ns;
+    ++buckets[{sample.tid, bucket}];
+  }
+  std::ofstream out(file_name);
+  out << "tid,start_ms,samples,utilization\n";
+  for (auto& [key, samples_count] : buckets) {
+    double cpu_ns = samples_count * ns_per_sample;
+    out << key.first << ',' << key.second * options.bucket_ms << ','
+        << samples_count << ',' << std::min(1.0, cpu_ns / bucket_ns) << '\n';
+  }
+}
+
+} // namespace
+
+ScopedProfiling::ScopedProfiling(bool enable,
+                                 std::string output_prefix,
+                                 const Options& options)
+    : m_output_prefix(std::move(output_prefix)), m_options(options) {
+  if (!enable) {
+    return;
+  }
+  always_assert_log(!s_active.exchange(true),
+                    "Only one CPU profiler can be active at a time");
+  always_assert(m_options.interval_us > 0);
+  m_enabled = true;
+  fprintf(stderr, "Enabling CPU profiling (%s)...\n", m_output_prefix.c_str());
+
+  // calloc'ed, so that only the pages of samples actually taken get
+  // committed.
+  s_capacity = m_options.max_samples;
+  s_samples = static_cast<Sample*>(calloc(s_capacity, sizeof(Sample)));
+  always_assert_log(s_samples != nullptr, "Cannot allocate %zu samples",
+                    s_capacity);
+  s_next.store(0, std::memory_order_relaxed);
+
+  // The first call of backtrace may allocate while loading the unwinder, which
+  // must not happen in the signal handler.
+  void* warmup[1];
+  backtrace(warmup, 1);
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = handle_sigprof;
+  action.sa_flags = SA_RESTART | SA_SIGINFO;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGPROF, &action, &s_old_action);
+  m_start_ns = now_ns();
+  m_start_cpu_ns = process_cpu_ns();
+  set_timer(m_options.interval_us);
+}
+
+ScopedProfiling::~ScopedProfiling() {
+  if (!m_enabled) {
+    return;
+  }
+  set_timer(0);
+  auto cpu_ns = process_cpu_ns() - m_start_cpu_ns;
+  auto count = std::min(s_next.load(), s_capacity);
+  auto dropped = s_next.load() - count;
+  // A handler may still be running on another thread; those samples will be
+  // skipped as incomplete. Keep ignoring SIGPROF until the buffer is gone.
+  signal(SIGPROF, SIG_IGN);
+
+  write_collapsed_stacks(m_output_prefix + ".collapsed", s_samples, count);
+  auto ns_per_sample = s_next.load() == 0
+                           ? 0.0
+                           : double(cpu_ns) / double(s_next.load());
+  write_thread_timeline(m_output_prefix + ".threads.csv", s_samples, count,
+                        m_start_ns, ns_per_sample, m_options);
+  fprintf(stderr, "CPU profiling done: %zu samples, %zu dropped\n", count,
+          dropped);
+
+  sigaction(SIGPROF, &s_old_action, nullptr);
+  free(s_samples);
+  s_samples = nullptr;
+  s_capacity = 0;
+  s_active.store(false);
+}
+
+#else
+
+ScopedProfiling::ScopedProfiling(bool enable,
+                                 std::string output_prefix,
+                                 const Options& options)
+    : m_output_prefix(std::move(output_prefix)), m_options(options) {
+  if (enable) {
+    std::cerr << "CPU profiling is not supported on this platform"
+              << std::endl;
+  }
+}
+
+ScopedProfiling::~ScopedProfiling() {}
+
+#endif
+
+} // namespace cpu_profiling
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * A built-in, signal-based sampling CPU profiler. While a ScopedProfiling is
+ * alive, the process receives SIGPROF for every `interval_us` microseconds of
+ * CPU time consumed by any of its threads, and the signal handler records the
+ * interrupted thread's stack into a preallocated buffer.
+ *
+ * When the scope ends, two files are written:
+ *  - `<output_prefix>.collapsed`: one line per distinct stack, root first,
+ *    frames separated by ';', followed by the sample count. This is the input
+ *    format of flamegraph.pl and most flame graph viewers. Frames that cannot
+ *    be symbolized (e.g. static functions of a binary that wasn't linked with
+ *    -rdynamic) are written as `module+0xoffset`, for offline symbolization.
+ *  - `<output_prefix>.threads.csv`: for each thread and each time bucket, the
+ *    fraction of the bucket the thread spent on a CPU. This shows how well
+ *    the profiled code is parallelized over time.
+ *
+ * Only one profiler can be active at a time. On platforms without the
+ * required support, this is a no-op.
+ *
+ * The PassManager profiles the pass named by the CPU_PROFILE_PASS environment
+ * variable, and writes the files into the meta directory, next to the stats.
+ */
+namespace cpu_profiling {
+
+struct Options {
+  // Requested CPU time between two samples. Signals are delivered at the
+  // granularity of the kernel's tick, so effective rates may be lower.
+  uint32_t interval_us{10000};
+  // Samples beyond this are dropped. The buffer is lazily committed.
+  size_t max_samples{1 << 20};
+  // Width of the buckets of the utilization timeline.
+  uint32_t bucket_ms{100};
+};
+
+// Reads the options from CPU_PROFILE_INTERVAL_US, CPU_PROFILE_MAX_SAMPLES and
+// CPU_PROFILE_BUCKET_MS, where set.
+Options options_from_env();
+
+class ScopedProfiling final {
+ public:
+  ScopedProfiling(bool enable,
+                  std::string output_prefix,
+                  const Options& options = Options());
+  ~ScopedProfiling();
+
+  ScopedProfiling(const ScopedProfiling&) = delete;
+  ScopedProfiling& operator=(const ScopedProfiling&) = delete;
+
+ private:
+  bool m_enabled{false};
+  std::string m_output_prefix;
+  Options m_options;
+  uint64_t m_start_ns{0};
+  uint64_t m_start_cpu_ns{0};
+};
+
+} // namespace cpu_profiling
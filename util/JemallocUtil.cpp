@@ -12,7 +12,9 @@
 #ifdef USE_JEMALLOC
 #include <jemalloc/jemalloc.h>
 #include <json/json.h>
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 
 #include "Debug.h"
 #endif
@@ -43,6 +45,52 @@ void dump(const std::string& file_name) {
   }
 }
 
+void use_arena_for_node(size_t node) {
+  static std::mutex s_mutex;
+  static std::unordered_map<size_t, unsigned> s_arenas;
+  unsigned arena;
+  {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto it = s_arenas.find(node);
+    if (it == s_arenas.end()) {
+      size_t len = sizeof(arena);
+      int err = mallctl("arenas.create", &arena, &len, nullptr, 0);
+      if (err != 0) {
+        std::cerr << "Failed creating arena: " << err << std::endl;
+        return;
+      }
+      it = s_arenas.emplace(node, arena).first;
+    }
+    arena = it->second;
+  }
+  int err = mallctl("thread.arena", nullptr, nullptr, &arena, sizeof(arena));
+  if (err != 0) {
+    std::cerr << "Failed setting thread arena: " << err << std::endl;
+  }
+}
+
+void use_dedicated_arena() {
+  unsigned arena;
+  size_t len = sizeof(arena);
+  int err = mallctl("arenas.create", &arena, &len, nullptr, 0);
+  if (err != 0) {
+    std::cerr << "Failed creating arena: " << err << std::endl;
+    return;
+  }
+  err = mallctl("thread.arena", nullptr, nullptr, &arena, sizeof(arena));
+  if (err != 0) {
+    std::cerr << "Failed setting thread arena: " << err << std::endl;
+  }
+}
+
+void purge_arenas() {
+  auto name = "arena." + std::to_string(MALLCTL_ARENAS_ALL) + ".purge";
+  int err = mallctl(name.c_str(), nullptr, nullptr, nullptr, 0);
+  if (err != 0) {
+    std::cerr << "Failed purging arenas: " << err << std::endl;
+  }
+}
+
 std::string get_malloc_stats() {
   std::string res;
   malloc_stats_print(
@@ -82,6 +130,12 @@ void dump(const std::string&) {
   std::cerr << "Jemalloc dump unsupported" << std::endl;
 }
 
+void use_arena_for_node(size_t) {}
+
+void use_dedicated_arena() {}
+
+void purge_arenas() {}
+
 std::string get_malloc_stats() { return ""; }
 void some_malloc_stats(const std::function<void(const char*, uint64_t)>&) {}
 
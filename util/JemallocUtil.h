@@ -30,6 +30,20 @@ class ScopedProfiling final {
   ~ScopedProfiling() { disable_profiling(); }
 };
 
+// Makes the current thread allocate from a jemalloc arena shared only by
+// threads using the same node, so that its memory is first touched (and thus
+// placed) on that NUMA node. Does nothing without jemalloc.
+void use_arena_for_node(size_t node);
+
+// Makes the current thread allocate from a newly created arena of its own, so
+// that it does not contend with other threads on arena locks. Does nothing
+// without jemalloc.
+void use_dedicated_arena();
+
+// Returns unused dirty pages of all arenas to the OS. Does nothing without
+// jemalloc.
+void purge_arenas();
+
 std::string get_malloc_stats();
 void some_malloc_stats(const std::function<void(const char*, uint64_t)>& fn);
 
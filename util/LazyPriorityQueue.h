@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "Debug.h"
+
+/*
+ * Drop-in alternative to MutablePriorityQueue for workloads that update
+ * priorities much more often than they retrieve the front element.
+ *
+ * Elements live in a binary heap. Updating a priority doesn't search the heap;
+ * it just pushes a new entry, and the old entry becomes stale. Stale entries
+ * are recognized by comparing against the current priority of their value, and
+ * discarded when they surface at the top. When stale entries outnumber live
+ * ones, the heap is rebuilt in linear time, which amortizes large batches of
+ * updates.
+ *
+ * Same limitations as MutablePriorityQueue:
+ * - The same value cannot be present twice (even with a different priority)
+ * - No two values can exist in the queue with the same priority at the same
+ *   time
+ */
+template <class Value,
+          class Priority,
+          class ValueHash = std::hash<Value>,
+          class PriorityCompare = std::less<Priority>>
+class LazyPriorityQueue {
+ private:
+  struct Entry {
+    Priority priority;
+    Value value;
+  };
+
+  // Mutable, as dropping stale entries doesn't change the observable state.
+  mutable std::vector<Entry> m_heap;
+  std::unordered_map<Value, Priority, ValueHash> m_priorities;
+  PriorityCompare m_compare;
+
+  auto heap_compare() const {
+    return [this](const Entry& a, const Entry& b) {
+      return m_compare(a.priority, b.priority);
+    };
+  }
+
+  bool is_stale(const Entry& entry) const {
+    auto it = m_priorities.find(entry.value);
+    return it == m_priorities.end() ||
+           m_compare(it->second, entry.priority) ||
+           m_compare(entry.priority, it->second);
+  }
+
+  // Brings a live entry to the top of the heap.
+  void drop_stale_top() const {
+    while (!m_heap.empty() && is_stale(m_heap.front())) {
+      std::pop_heap(m_heap.begin(), m_heap.end(), heap_compare());
+      m_heap.pop_back();
+    }
+  }
+
+  void push(const Value& value, const Priority& priority) {
+    m_heap.push_back({priority, value});
+    std::push_heap(m_heap.begin(), m_heap.end(), heap_compare());
+    if (m_heap.size() > 2 * m_priorities.size() + 64) {
+      rebuild();
+    }
+  }
+
+  void rebuild() {
+    m_heap.clear();
+    m_heap.reserve(m_priorities.size());
+    for (auto& [value, priority] : m_priorities) {
+      m_heap.push_back({priority, value});
+    }
+    std::make_heap(m_heap.begin(), m_heap.end(), heap_compare());
+  }
+
+ public:
+  // Inserts a value with a priority; neither value or priority can already be
+  // present.
+  void insert(const Value& value, const Priority& priority) {
+    auto priorities_result = m_priorities.insert({value, priority});
+    always_assert(priorities_result.second);
+    push(value, priority);
+  }
+
+  // Erases a value that's currently in the queue.
+  void erase(const Value& value) {
+    const auto erased = m_priorities.erase(value);
+    always_assert(erased);
+    if (m_priorities.empty()) {
+      m_heap.clear();
+    }
+  }
+
+  // Changes the priority of a value. The value must already be in the queue.
+  // No current queue element may already have the new priority.
+  void update_priority(const Value& value, const Priority& priority) {
+    auto it = m_priorities.find(value);
+    always_assert(it != m_priorities.end());
+    if (!m_compare(it->second, priority) && !m_compare(priority, it->second)) {
+      return;
+    }
+    it->second = priority;
+    push(value, priority);
+  }
+
+  // Removes all elements.
+  void clear() {
+    m_heap.clear();
+    m_priorities.clear();
+  }
+
+  // Checks if queue is empty.
+  bool empty() const { return m_priorities.empty(); }
+
+  // Returns element with highest priority.
+  Value front() const {
+    always_assert(!empty());
+    drop_stale_top();
+    return m_heap.front().value;
+  }
+
+  // Returns whether a value is currently in the queue.
+  bool contains(const Value& value) const { return m_priorities.count(value); }
+
+  // Returns the priority of a value currently in the queue.
+  const Priority& get_priority(const Value& value) const {
+    return m_priorities.at(value);
+  }
+
+  // Number of heap entries, including stale ones.
+  size_t heap_size() const { return m_heap.size(); }
+};
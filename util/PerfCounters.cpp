@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "PerfCounters.h"
+
+#include <cstdlib>
+#include <iostream>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace perf_counters {
+
+const char* event_name(Event event) {
+  switch (event) {
+  case CYCLES:
+    return "cycles";
+  case INSTRUCTIONS:
+    return "instructions";
+  case CACHE_MISSES:
+    return "cache_misses";
+  case BRANCH_MISSES:
+    return "branch_misses";
+  case NUM_EVENTS:
+    break;
+  }
+  std::abort();
+}
+
+#ifdef __linux__
+
+namespace {
+
+uint64_t event_config(Event event) {
+  switch (event) {
+  case CYCLES:
+    return PERF_COUNT_HW_CPU_CYCLES;
+  case INSTRUCTIONS:
+    return PERF_COUNT_HW_INSTRUCTIONS;
+  case CACHE_MISSES:
+    return PERF_COUNT_HW_CACHE_MISSES;
+  case BRANCH_MISSES:
+    return PERF_COUNT_HW_BRANCH_MISSES;
+  case NUM_EVENTS:
+    break;
+  }
+  std::abort();
+}
+
+int open_counter(Event event, pid_t tid) {
+  struct perf_event_attr attr {};
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = event_config(event);
+  // Counting user space only is allowed at the default paranoia level.
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return (int)syscall(SYS_perf_event_open, &attr, tid, /* cpu */ -1,
+                      /* group_fd */ -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+std::vector<pid_t> get_thread_ids() {
+  std::vector<pid_t> tids;
+  auto* dir = opendir("/proc/self/task");
+  if (dir == nullptr) {
+    return tids;
+  }
+  while (auto* entry = readdir(dir)) {
+    if (entry->d_name[0] != '.') {
+      tids.push_back((pid_t)atoi(entry->d_name));
+    }
+  }
+  closedir(dir);
+  return tids;
+}
+
+} // namespace
+
+ScopedCounters::ScopedCounters(bool enable) {
+  if (!enable) {
+    return;
+  }
+  auto main_tid = getpid();
+  auto tids = get_thread_ids();
+  bool any_supported = false;
+  for (size_t e = 0; e < NUM_EVENTS; ++e) {
+    // The main thread does not go away, so failing on it means that the event
+    // is not supported. Other threads may exit before they are opened.
+    auto main_fd = open_counter((Event)e, main_tid);
+    if (main_fd < 0) {
+      continue;
+    }
+    m_fds[e].push_back(main_fd);
+    for (auto tid : tids) {
+      if (tid == main_tid) {
+        continue;
+      }
+      auto fd = open_counter((Event)e, tid);
+      if (fd >= 0) {
+        m_fds[e].push_back(fd);
+      }
+    }
+    any_supported = true;
+  }
+  static bool warned = false;
+  if (!any_supported && !warned) {
+    std::cerr << "Warning: hardware performance counters are not available."
+              << std::endl;
+    warned = true;
+  }
+}
+
+ScopedCounters::~ScopedCounters() {
+  for (auto& fds : m_fds) {
+    for (auto fd : fds) {
+      close(fd);
+    }
+  }
+}
+
+Counts ScopedCounters::read() const {
+  Counts counts;
+  for (size_t e = 0; e < NUM_EVENTS; ++e) {
+    if (m_fds[e].empty()) {
+      continue;
+    }
+    uint64_t sum = 0;
+    for (auto fd : m_fds[e]) {
+      uint64_t values[3];
+      if (::read(fd, values, sizeof(values)) != sizeof(values)) {
+        continue;
+      }
+      auto [value, enabled, running] = values;
+      // Scale up for the time the counter was multiplexed out.
+      if (running != 0) {
+        sum += running == enabled
+                   ? value
+                   : (uint64_t)((double)value * enabled / running);
+      }
+    }
+    counts[e] = sum;
+  }
+  return counts;
+}
+
+#else
+
+ScopedCounters::ScopedCounters(bool) {}
+
+ScopedCounters::~ScopedCounters() {}
+
+Counts ScopedCounters::read() const { return Counts(); }
+
+#endif
+
+} // namespace perf_counters
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/*
+ * Counts hardware events with perf_event_open while a ScopedCounters is alive,
+ * summed over the threads of the process, in user space only. Threads that
+ * are started while the scope is alive are not counted, which is fine for the
+ * long-lived worker threads of the thread pool.
+ *
+ * Comparing the counts of, e.g., a pass, tells whether it is mostly waiting
+ * for memory (many cache misses, few instructions per cycle) or computing.
+ *
+ * Events that the kernel or hardware does not support, e.g. in a VM or with a
+ * restrictive kernel.perf_event_paranoid, are not reported. On platforms other
+ * than Linux, nothing is.
+ */
+namespace perf_counters {
+
+enum Event : size_t {
+  CYCLES,
+  INSTRUCTIONS,
+  CACHE_MISSES,
+  BRANCH_MISSES,
+  NUM_EVENTS,
+};
+
+const char* event_name(Event event);
+
+// Unsupported events have no count.
+using Counts = std::array<std::optional<uint64_t>, NUM_EVENTS>;
+
+class ScopedCounters final {
+ public:
+  explicit ScopedCounters(bool enable);
+  ~ScopedCounters();
+
+  ScopedCounters(const ScopedCounters&) = delete;
+  ScopedCounters& operator=(const ScopedCounters&) = delete;
+
+  // The counts since the scope started.
+  Counts read() const;
+
+ private:
+  // File descriptors of the counters of each event, one per thread.
+  std::array<std::vector<int>, NUM_EVENTS> m_fds;
+};
+
+} // namespace perf_counters
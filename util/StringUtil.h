@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <cstring>
 #include <memory>
 #include <string>
@@ -46,6 +47,52 @@ inline std::string operator+(const std::string_view s, char t) {
   return tmp;
 }
 
+// A fast, non-cryptographic hash of a byte string, consuming eight bytes at a
+// time. The result depends on the host's endianness, so it must not leak into
+// any output.
+inline size_t hash_bytes(const char* data, size_t size) {
+  constexpr uint64_t k_mul = 0x9ddfea08eb382d69ULL;
+  auto mix = [&](uint64_t h, uint64_t word) {
+    h = (h ^ word) * k_mul;
+    return h ^ (h >> 47);
+  };
+  uint64_t h = size * k_mul;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    memcpy(&word, data + i, 8);
+    h = mix(h, word);
+  }
+  if (i < size) {
+    uint64_t word = 0;
+    memcpy(&word, data + i, size - i);
+    h = mix(h, word);
+  }
+  h *= k_mul;
+  return h ^ (h >> 47);
+}
+
+// The offset of the first byte in which a[0, size) and b[0, size) differ, or
+// size if they are equal. Compares eight bytes at a time.
+inline size_t mismatch_offset(const char* a, const char* b, size_t size) {
+  size_t i = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  for (; i + 8 <= size; i += 8) {
+    uint64_t wa;
+    uint64_t wb;
+    memcpy(&wa, a + i, 8);
+    memcpy(&wb, b + i, 8);
+    if (wa != wb) {
+      return i + (__builtin_ctzll(wa ^ wb) / 8);
+    }
+  }
+#endif
+  while (i < size && a[i] == b[i]) {
+    ++i;
+  }
+  return i;
+}
+
 class StringStorage {
  private:
   std::unordered_set<std::string_view> m_set;